@@ -7,6 +7,17 @@ public:
     GeneratorParam<bool>  auto_schedule{"auto_schedule", false};
     GeneratorParam<int>   s_sigma{"s_sigma", 8};
 
+    // Build the grid by scattering each pixel into its cell with an
+    // atomic add, instead of gathering the pixels of each cell with a
+    // serial reduction. This parallelizes over pixels rather than
+    // cells.
+    GeneratorParam<bool>  scatter{"scatter", false};
+
+    // Store the blurred grids in half precision, to halve the memory
+    // and bandwidth they use. The histogram itself stays in float.
+    // Needs a GPU target, or a CPU target with f16c.
+    GeneratorParam<bool>  half_grid{"half_grid", false};
+
     Input<Buffer<float>>  input{"input", 2};
     Input<float>          r_sigma{"r_sigma"};
 
@@ -15,53 +26,82 @@ public:
     void generate() {
         Var x("x"), y("y"), z("z"), c("c");
 
+        _halide_user_assert(!half_grid || get_target().has_gpu_feature() ||
+                            get_target().has_feature(Target::F16C))
+            << "half_grid needs a GPU target, or a CPU target with f16c\n";
+        _halide_user_assert(!scatter || !auto_schedule)
+            << "scatter is not supported with the auto scheduler\n";
+
+        const int s = s_sigma;
+
         // Add a boundary condition
         Func clamped = Halide::BoundaryConditions::repeat_edge(input);
 
         // Construct the bilateral grid
-        RDom r(0, s_sigma, 0, s_sigma);
-        Expr val = clamped(x * s_sigma + r.x - s_sigma/2, y * s_sigma + r.y - s_sigma/2);
-        val = clamp(val, 0.0f, 1.0f);
-
-        Expr zi = cast<int>(val * (1.0f/r_sigma) + 0.5f);
-
         Func histogram("histogram");
         histogram(x, y, z, c) = 0.0f;
-        histogram(x, y, zi, c) += select(c == 0, val, 1.0f);
+        RDom r;
+        if (scatter) {
+            // Iterate over every pixel that lands in a cell the output
+            // uses, and add it to its cell. Cell x holds the pixels
+            // [x * s - s/2, x * s + s/2), as when gathering.
+            Expr cell_x0 = bilateral_grid.dim(0).min() / s - 2;
+            Expr cell_y0 = bilateral_grid.dim(1).min() / s - 2;
+            Expr cells_x = (bilateral_grid.dim(0).max() / s + 3) - cell_x0 + 1;
+            Expr cells_y = (bilateral_grid.dim(1).max() / s + 3) - cell_y0 + 1;
+            r = RDom(cell_x0 * s - s/2, cells_x * s, cell_y0 * s - s/2, cells_y * s);
+            Expr val = clamp(clamped(r.x, r.y), 0.0f, 1.0f);
+            Expr zi = cast<int>(val * (1.0f/r_sigma) + 0.5f);
+            histogram((r.x + s/2) / s, (r.y + s/2) / s, zi, c) += select(c == 0, val, 1.0f);
+        } else {
+            r = RDom(0, s, 0, s);
+            Expr val = clamped(x * s + r.x - s/2, y * s + r.y - s/2);
+            val = clamp(val, 0.0f, 1.0f);
+            Expr zi = cast<int>(val * (1.0f/r_sigma) + 0.5f);
+            histogram(x, y, zi, c) += select(c == 0, val, 1.0f);
+        }
+
+        // The type the blurred grids are stored in
+        Type grid_type = half_grid ? Float(16) : Float(32);
+        auto load = [](Expr e) { return cast<float>(e); };
 
         // Blur the grid using a five-tap filter
         Func blurx("blurx"), blury("blury"), blurz("blurz");
-        blurz(x, y, z, c) = (histogram(x, y, z-2, c) +
-                             histogram(x, y, z-1, c)*4 +
-                             histogram(x, y, z  , c)*6 +
-                             histogram(x, y, z+1, c)*4 +
-                             histogram(x, y, z+2, c));
-        blurx(x, y, z, c) = (blurz(x-2, y, z, c) +
-                             blurz(x-1, y, z, c)*4 +
-                             blurz(x  , y, z, c)*6 +
-                             blurz(x+1, y, z, c)*4 +
-                             blurz(x+2, y, z, c));
-        blury(x, y, z, c) = (blurx(x, y-2, z, c) +
-                             blurx(x, y-1, z, c)*4 +
-                             blurx(x, y  , z, c)*6 +
-                             blurx(x, y+1, z, c)*4 +
-                             blurx(x, y+2, z, c));
+        blurz(x, y, z, c) = cast(grid_type,
+                                 histogram(x, y, z-2, c) +
+                                 histogram(x, y, z-1, c)*4 +
+                                 histogram(x, y, z  , c)*6 +
+                                 histogram(x, y, z+1, c)*4 +
+                                 histogram(x, y, z+2, c));
+        blurx(x, y, z, c) = cast(grid_type,
+                                 load(blurz(x-2, y, z, c)) +
+                                 load(blurz(x-1, y, z, c))*4 +
+                                 load(blurz(x  , y, z, c))*6 +
+                                 load(blurz(x+1, y, z, c))*4 +
+                                 load(blurz(x+2, y, z, c)));
+        blury(x, y, z, c) = cast(grid_type,
+                                 load(blurx(x, y-2, z, c)) +
+                                 load(blurx(x, y-1, z, c))*4 +
+                                 load(blurx(x, y  , z, c))*6 +
+                                 load(blurx(x, y+1, z, c))*4 +
+                                 load(blurx(x, y+2, z, c)));
 
         // Take trilinear samples to compute the output
-        val = clamp(input(x, y), 0.0f, 1.0f);
+        Expr val = clamp(input(x, y), 0.0f, 1.0f);
         Expr zv = val * (1.0f/r_sigma);
-        zi = cast<int>(zv);
+        Expr zi = cast<int>(zv);
         Expr zf = zv - zi;
         Expr xf = cast<float>(x % s_sigma) / s_sigma;
         Expr yf = cast<float>(y % s_sigma) / s_sigma;
         Expr xi = x/s_sigma;
         Expr yi = y/s_sigma;
+        auto grid = [&](Expr x, Expr y, Expr z) { return load(blury(x, y, z, c)); };
         Func interpolated("interpolated");
         interpolated(x, y, c) =
-            lerp(lerp(lerp(blury(xi, yi, zi, c), blury(xi+1, yi, zi, c), xf),
-                      lerp(blury(xi, yi+1, zi, c), blury(xi+1, yi+1, zi, c), xf), yf),
-                 lerp(lerp(blury(xi, yi, zi+1, c), blury(xi+1, yi, zi+1, c), xf),
-                      lerp(blury(xi, yi+1, zi+1, c), blury(xi+1, yi+1, zi+1, c), xf), yf), zf);
+            lerp(lerp(lerp(grid(xi, yi, zi), grid(xi+1, yi, zi), xf),
+                      lerp(grid(xi, yi+1, zi), grid(xi+1, yi+1, zi), xf), yf),
+                 lerp(lerp(grid(xi, yi, zi+1), grid(xi+1, yi, zi+1), xf),
+                      lerp(grid(xi, yi+1, zi+1), grid(xi+1, yi+1, zi+1), xf), yf), zf);
 
         // Normalize
         bilateral_grid(x, y) = interpolated(x, y, 0)/interpolated(x, y, 1);
@@ -81,6 +121,41 @@ public:
             // Auto schedule the pipeline: this calls auto_schedule() for
             // all of the Outputs in this Generator
             auto_schedule_outputs();
+        } else if (scatter && get_target().has_gpu_feature()) {
+            Var xi("xi"), yi("yi"), zi("zi");
+            Halide::RVar rxo("rxo"), rxi("rxi"), ryo("ryo"), ryi("ryi");
+
+            // Zero the grid, and then scatter into it with a thread
+            // per input pixel.
+            histogram.compute_root().bound(c, 0, 2)
+                .reorder(c, z, x, y).unroll(c)
+                .gpu_tile(x, y, xi, yi, 8, 8);
+            histogram.update().atomic()
+                .split(r.x, rxo, rxi, 32)
+                .split(r.y, ryo, ryi, 8)
+                .reorder(c, rxi, ryi, rxo, ryo)
+                .unroll(c)
+                .gpu_blocks(rxo, ryo)
+                .gpu_threads(rxi, ryi);
+
+            blurz.compute_root().reorder(c, z, x, y).unroll(c).gpu_tile(x, y, xi, yi, 8, 8);
+            blurx.compute_root().gpu_tile(x, y, z, xi, yi, zi, 8, 8, 1);
+            blury.compute_root().gpu_tile(x, y, z, xi, yi, zi, 8, 8, 1);
+            bilateral_grid.compute_root().gpu_tile(x, y, xi, yi, s_sigma, s_sigma);
+        } else if (scatter) {
+            // The scatter is parallel over strips of input rows.
+            Halide::RVar ryo("ryo"), ryi("ryi");
+            histogram.compute_root().bound(c, 0, 2)
+                .reorder(c, z, x, y).parallel(y).vectorize(x, 8).unroll(c);
+            histogram.update().atomic()
+                .split(r.y, ryo, ryi, 16)
+                .reorder(c, r.x, ryi, ryo)
+                .unroll(c)
+                .parallel(ryo);
+            blurz.compute_root().reorder(c, z, x, y).parallel(y).vectorize(x, 8).unroll(c);
+            blurx.compute_root().reorder(c, x, y, z).parallel(z).vectorize(x, 8).unroll(c);
+            blury.compute_root().reorder(c, x, y, z).parallel(z).vectorize(x, 8).unroll(c);
+            bilateral_grid.compute_root().parallel(y).vectorize(x, 8);
         } else if (get_target().has_gpu_feature()) {
             Var xi("xi"), yi("yi"), zi("zi");
 
@@ -4,6 +4,8 @@
 
 #include "bilateral_grid.h"
 #include "bilateral_grid_auto_schedule.h"
+#include "bilateral_grid_scatter.h"
+#include "bilateral_grid_scatter_half.h"
 
 #include "halide_benchmark.h"
 #include "HalideBuffer.h"
@@ -44,5 +46,31 @@ int main(int argc, char **argv) {
 
     convert_and_save_image(output, argv[2]);
 
+    // Time the gather and scatter grid construction at 4K and 8K,
+    // on inputs made by tiling the input image.
+    const int sizes[][2] = {{3840, 2160}, {7680, 4320}};
+    for (const auto &size : sizes) {
+        Buffer<float> big_input(size[0], size[1]);
+        big_input.for_each_element([&](int x, int y) {
+            big_input(x, y) = input(x % input.width(), y % input.height());
+        });
+        Buffer<float> big_output(size[0], size[1]);
+
+        double t_gather = benchmark(timing_iterations, 1, [&]() {
+            bilateral_grid(big_input, r_sigma, big_output);
+            big_output.device_sync();
+        });
+        double t_scatter = benchmark(timing_iterations, 1, [&]() {
+            bilateral_grid_scatter(big_input, r_sigma, big_output);
+            big_output.device_sync();
+        });
+        double t_scatter_half = benchmark(timing_iterations, 1, [&]() {
+            bilateral_grid_scatter_half(big_input, r_sigma, big_output);
+            big_output.device_sync();
+        });
+        printf("%dx%d: gather %gms, scatter %gms, scatter with a half grid %gms\n",
+               size[0], size[1], t_gather * 1e3, t_scatter * 1e3, t_scatter_half * 1e3);
+    }
+
     return 0;
 }
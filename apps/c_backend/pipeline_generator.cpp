@@ -20,6 +20,7 @@ public:
 
         f.compute_root().vectorize(x, 8);
         h.compute_root();
+        output.parallel(y);
     }
 };
 
@@ -189,6 +189,17 @@ public:
     GeneratorParam<bool>  auto_schedule{"auto_schedule", false};
     GeneratorParam<Type> result_type{"result_type", UInt(8)};
 
+    // Compute one strip of output rows per call, for processing frames
+    // as they arrive from a sensor. The input only needs to hold the
+    // raw rows the strip uses (a bounds query returns them), so the
+    // caller can keep a small window of rows, carrying the overlap from
+    // one strip to the next. Within a call the strip is computed
+    // serially, sliding the line buffers of the denoise, deinterleave
+    // and demosaic stages down it in folded storage, so the working
+    // set is a few rows. Run calls for different strips concurrently
+    // for throughput.
+    GeneratorParam<bool> strip_mode{"strip_mode", false};
+
     Input<Buffer<uint16_t>> input{"input", 2};
     Input<Buffer<float>> matrix_3200{"matrix_3200", 2};
     Input<Buffer<float>> matrix_7000{"matrix_7000", 2};
@@ -379,7 +390,9 @@ void CameraPipe::generate() {
         //and in HVX 64 we need 4 threads, and on other devices,
         // we might need many threads.
         Expr strip_size;
-        if (get_target().has_feature(Target::HVX_128)) {
+        if (strip_mode) {
+            strip_size = processed.dim(1).extent();
+        } else if (get_target().has_feature(Target::HVX_128)) {
             strip_size = processed.dim(1).extent() / 2;
         } else if (get_target().has_feature(Target::HVX_64)) {
             strip_size = processed.dim(1).extent() / 4;
@@ -433,8 +446,13 @@ void CameraPipe::generate() {
         // We can generate slightly better code if we know the splits divide the extent.
         processed
             .bound(c, 0, 3)
-            .bound(x, 0, ((out_width)/(2*vec))*(2*vec))
-            .bound(y, 0, (out_height/strip_size)*strip_size);
+            .bound(x, 0, ((out_width)/(2*vec))*(2*vec));
+        if (strip_mode) {
+            // A strip can start at any row.
+            processed.bound(y, processed.dim(1).min(), strip_size);
+        } else {
+            processed.bound(y, 0, (out_height/strip_size)*strip_size);
+        }
     }
 };
 
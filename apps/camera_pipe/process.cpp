@@ -5,19 +5,56 @@
 
 #include "camera_pipe.h"
 #include "camera_pipe_auto_schedule.h"
+#include "camera_pipe_strip.h"
 
 #include "HalideBuffer.h"
 #include "halide_image_io.h"
 #include "halide_malloc_trace.h"
 
+#include <algorithm>
+#include <chrono>
 #include <cstdint>
 #include <cstdio>
 #include <cstdlib>
 #include <cassert>
+#include <mutex>
 
 using namespace Halide::Runtime;
 using namespace Halide::Tools;
 
+namespace {
+
+// Track the bytes Halide has allocated, to measure a pipeline's
+// working set.
+std::mutex allocation_mutex;
+size_t bytes_allocated = 0, peak_bytes_allocated = 0;
+
+void *counting_malloc(void *user_context, size_t size) {
+    // Align to 128 bytes, and store the original pointer and the size
+    // just before the allocation.
+    void *orig = malloc(size + 128);
+    if (orig == NULL) {
+        return NULL;
+    }
+    void *ptr = (void *)((((size_t)orig + 128) >> 7) << 7);
+    ((void **)ptr)[-1] = orig;
+    ((size_t *)ptr)[-2] = size;
+    std::lock_guard<std::mutex> lock(allocation_mutex);
+    bytes_allocated += size;
+    peak_bytes_allocated = std::max(peak_bytes_allocated, bytes_allocated);
+    return ptr;
+}
+
+void counting_free(void *user_context, void *ptr) {
+    {
+        std::lock_guard<std::mutex> lock(allocation_mutex);
+        bytes_allocated -= ((size_t *)ptr)[-2];
+    }
+    free(((void **)ptr)[-1]);
+}
+
+}  // namespace
+
 int main(int argc, char **argv) {
     if (argc < 7) {
         printf("Usage: ./process raw.png color_temp gamma contrast timing_iterations output.png\n"
@@ -79,6 +116,81 @@ int main(int argc, char **argv) {
             output);
     });
     fprintf(stderr, "Halide (auto):\t%gus\n", best * 1e6);
+
+    // Measure the working set of the whole-frame pipeline, and then
+    // process the frame in strips, as the rows would arrive from a
+    // sensor.
+    halide_malloc_t old_malloc = halide_set_custom_malloc(counting_malloc);
+    halide_free_t old_free = halide_set_custom_free(counting_free);
+
+    peak_bytes_allocated = 0;
+    camera_pipe(input, matrix_3200, matrix_7000,
+                color_temp, gamma, contrast, blackLevel, whiteLevel,
+                output);
+    fprintf(stderr, "Halide (manual) working set:\t%.2f MB\n", peak_bytes_allocated / (1024.0 * 1024.0));
+
+    const int strip_rows = 32;
+    Buffer<uint8_t> output_strips(output.width(), output.height(), output.channels());
+    Buffer<uint16_t> window;
+    double total_latency = 0, worst_latency = 0;
+    size_t window_bytes = 0;
+    int strips = 0;
+    peak_bytes_allocated = 0;
+    for (int y = 0; y + strip_rows <= output.height(); y += strip_rows) {
+        Buffer<uint8_t> strip = output_strips.cropped(1, y, strip_rows);
+
+        // Ask the pipeline which raw rows this strip needs.
+        Buffer<uint16_t> query((uint16_t *)nullptr, 0, 0);
+        camera_pipe_strip(query, matrix_3200, matrix_7000,
+                          color_temp, gamma, contrast, blackLevel, whiteLevel,
+                          strip);
+
+        // Carry over the rows shared with the previous strip, and read
+        // the rest from the sensor.
+        Buffer<uint16_t> next(query.dim(0).extent(), query.dim(1).extent());
+        next.set_min(query.dim(0).min(), query.dim(1).min());
+        int first_new_row = next.dim(1).min();
+        if (strips > 0) {
+            next.copy_from(window);
+            first_new_row = std::max(first_new_row, window.dim(1).max() + 1);
+        }
+        Buffer<uint16_t> new_rows = next.cropped(1, first_new_row, next.dim(1).max() + 1 - first_new_row);
+        new_rows.copy_from(input);
+        window = next;
+        window_bytes = std::max(window_bytes, window.size_in_bytes());
+
+        auto start = std::chrono::high_resolution_clock::now();
+        camera_pipe_strip(window, matrix_3200, matrix_7000,
+                          color_temp, gamma, contrast, blackLevel, whiteLevel,
+                          strip);
+        auto end = std::chrono::high_resolution_clock::now();
+        double latency = std::chrono::duration<double>(end - start).count();
+        total_latency += latency;
+        worst_latency = std::max(worst_latency, latency);
+        strips++;
+    }
+
+    halide_set_custom_malloc(old_malloc);
+    halide_set_custom_free(old_free);
+
+    fprintf(stderr, "Halide (strips of %d rows):\t%gus per strip, %gus worst, %gus per frame\n",
+            strip_rows, total_latency / strips * 1e6, worst_latency * 1e6, total_latency * 1e6);
+    fprintf(stderr, "Halide (strips) working set:\t%.2f MB, plus %.2f MB of raw rows\n",
+            peak_bytes_allocated / (1024.0 * 1024.0), window_bytes / (1024.0 * 1024.0));
+
+    int mismatches = 0;
+    for (int y = 0; y < strips * strip_rows; y++) {
+        for (int c = 0; c < output.channels(); c++) {
+            for (int x = 0; x < output.width(); x++) {
+                mismatches += output_strips(x, y, c) != output(x, y, c);
+            }
+        }
+    }
+    if (mismatches) {
+        fprintf(stderr, "Processing in strips changed %d values\n", mismatches);
+        return -1;
+    }
+
     fprintf(stderr, "output: %s\n", argv[6]);
     convert_and_save_image(output, argv[6]);
     fprintf(stderr, "        %d %d\n", output.width(), output.height());
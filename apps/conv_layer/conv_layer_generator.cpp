@@ -4,10 +4,40 @@ namespace {
 
 using namespace Halide;
 
+enum class ConvAlgorithm { Direct, Im2col, Winograd2x2, Winograd4x4 };
+
+// Build an Expr that looks up the entry of a small constant matrix
+// at (row, col). Once the loops over row and col are unrolled, the
+// selects fold away, and so do the multiplies by zero.
+Expr matrix_entry(const std::vector<std::vector<float>> &m, Expr row, Expr col) {
+    Expr result = 0.0f;
+    for (size_t i = 0; i < m.size(); i++) {
+        for (size_t j = 0; j < m[i].size(); j++) {
+            if (m[i][j] != 0.0f) {
+                result = select(row == (int)i && col == (int)j, m[i][j], result);
+            }
+        }
+    }
+    return result;
+}
+
 class ConvolutionLayer : public Halide::Generator<ConvolutionLayer> {
 public:
     GeneratorParam<bool>  auto_schedule{"auto_schedule", false};
 
+    // The algorithm used to compute the convolution. The Winograd
+    // variants compute F(2x2, 3x3) and F(4x4, 3x3), and require a 3x3
+    // filter and a stride of 1. The auto scheduler is only supported
+    // for the direct algorithm.
+    GeneratorParam<ConvAlgorithm> algorithm{"algorithm", ConvAlgorithm::Direct,
+        {{"direct", ConvAlgorithm::Direct},
+         {"im2col", ConvAlgorithm::Im2col},
+         {"winograd_2x2", ConvAlgorithm::Winograd2x2},
+         {"winograd_4x4", ConvAlgorithm::Winograd4x4}}};
+
+    // The stride of the convolution.
+    GeneratorParam<int>   stride{"stride", 1};
+
     Input<Buffer<float>>  input{"input", 4};
     Input<Buffer<float>>  filter{"filter", 4};
     Input<Buffer<float>>  bias{"bias", 1};
@@ -15,9 +45,34 @@ public:
     Output<Buffer<float>> f_ReLU{"ReLU", 4};
 
     void generate() {
+        const ConvAlgorithm a = algorithm;
+        _halide_user_assert(stride >= 1) << "stride must be positive\n";
+        _halide_user_assert(!auto_schedule || a == ConvAlgorithm::Direct)
+            << "auto_schedule is only supported for the direct algorithm\n";
+
+        switch (a) {
+        case ConvAlgorithm::Direct:
+            direct();
+            break;
+        case ConvAlgorithm::Im2col:
+            im2col();
+            break;
+        case ConvAlgorithm::Winograd2x2:
+            winograd(2);
+            break;
+        case ConvAlgorithm::Winograd4x4:
+            winograd(4);
+            break;
+        }
+    }
+
+private:
+    Var x{"x"}, y{"y"}, z{"z"}, n{"n"};
+
+    void direct() {
         /* THE ALGORITHM */
 
-        Var x("x"), y("y"), z("z"), n("n");
+        const int s = stride;
 
         Func f_conv("conv");
         RDom r(filter.dim(0).min(), filter.dim(0).extent(),
@@ -26,7 +81,7 @@ public:
 
         f_conv(x, y, z, n) = bias(z);
 
-        f_conv(x, y, z, n) += filter(r.x, r.y, r.z, z) * input(x + r.x, y + r.y, r.z, n);
+        f_conv(x, y, z, n) += filter(r.x, r.y, r.z, z) * input(x * s + r.x, y * s + r.y, r.z, n);
 
         f_ReLU(x, y, z, n) = max(0, f_conv(x, y, z, n));
 
@@ -95,10 +150,270 @@ public:
                 .parallel(par);
             f_ReLU.reorder(n, z).parallel(z).vectorize(x, 8);
         }
-   }
+    }
+
+    // Lower the input to a matrix with one column per output pixel of a
+    // row, and one row per filter tap, and multiply it by the filter.
+    void im2col() {
+        Var k("k"), t("t"), xo("xo"), xi("xi"), zo("zo"), zi("zi");
+        const int s = stride;
+
+        filter.dim(0).set_min(0).dim(1).set_min(0).dim(2).set_min(0);
+
+        const Expr filter_w = filter.dim(0).extent();
+        const Expr filter_h = filter.dim(1).extent();
+        const Expr num_taps = filter_w * filter_h * filter.dim(2).extent();
+
+        // The filter tap k of a pixel.
+        const Expr kx = k % filter_w;
+        const Expr ky = (k / filter_w) % filter_h;
+        const Expr kc = k / (filter_w * filter_h);
+
+        Func col("col");
+        col(x, k, y, n) = input(x * s + kx, y * s + ky, kc, n);
+
+        Func filter_matrix("filter_matrix");
+        filter_matrix(k, z) = filter(kx, ky, kc, z);
+
+        Func f_conv("conv");
+        RDom r(0, num_taps);
+        f_conv(x, y, z, n) = bias(z);
+        f_conv(x, y, z, n) += filter_matrix(r, z) * col(x, r, y, n);
+
+        f_ReLU(x, y, z, n) = max(0, f_conv(x, y, z, n));
+
+        // Each task computes a row of the output from a row of the
+        // lowered input. The multiply is done in register blocks of
+        // two vectors of pixels by four output channels.
+        const int vec = natural_vector_size<float>();
+        f_ReLU.tile(x, z, xo, zo, xi, zi, vec * 2, 4)
+            .reorder(xi, zi, xo, zo, y, n)
+            .vectorize(xi).unroll(zi)
+            .fuse(y, n, t).parallel(t);
+
+        col.compute_at(f_ReLU, t).vectorize(x, vec);
+        filter_matrix.compute_root();
+
+        f_conv.compute_at(f_ReLU, xo)
+            .vectorize(x).unroll(z)
+            .update()
+            .reorder(x, z, r)
+            .vectorize(x).unroll(z);
+    }
+
+    // Winograd F(m x m, 3 x 3). Each m x m tile of the output is
+    // computed from a (m + 2) x (m + 2) tile of the input as
+    //   Y = A^T [ sum_c (G g G^T) . (B^T d B) ] A
+    // with the matrices from Lavin and Gray, "Fast Algorithms for
+    // Convolutional Neural Networks".
+    void winograd(int m) {
+        _halide_user_assert((int)stride == 1) << "The Winograd algorithms require a stride of 1\n";
+
+        const int t = m + 2;
+
+        std::vector<std::vector<float>> BT, G, AT;
+        if (m == 2) {
+            BT = {{1,  0, -1,  0},
+                  {0,  1,  1,  0},
+                  {0, -1,  1,  0},
+                  {0,  1,  0, -1}};
+            G = {{1.0f,  0.0f, 0.0f},
+                 {0.5f,  0.5f, 0.5f},
+                 {0.5f, -0.5f, 0.5f},
+                 {0.0f,  0.0f, 1.0f}};
+            AT = {{1, 1,  1,  0},
+                  {0, 1, -1, -1}};
+        } else {
+            BT = {{4,  0, -5,  0, 1, 0},
+                  {0, -4, -4,  1, 1, 0},
+                  {0,  4, -4, -1, 1, 0},
+                  {0, -2, -1,  2, 1, 0},
+                  {0,  2, -1, -2, 1, 0},
+                  {0,  4,  0, -5, 0, 1}};
+            G = {{ 1.0f / 4,   0.0f,       0.0f},
+                 {-1.0f / 6,  -1.0f / 6,  -1.0f / 6},
+                 {-1.0f / 6,   1.0f / 6,  -1.0f / 6},
+                 { 1.0f / 24,  1.0f / 12,  1.0f / 6},
+                 { 1.0f / 24, -1.0f / 12,  1.0f / 6},
+                 { 0.0f,       0.0f,       1.0f}};
+            AT = {{1, 1,  1, 1,  1, 0},
+                  {0, 1, -1, 2, -2, 0},
+                  {0, 1,  1, 4,  4, 0},
+                  {0, 1, -1, 8, -8, 1}};
+        }
+
+        filter.dim(0).set_bounds(0, 3).dim(1).set_bounds(0, 3).dim(2).set_min(0);
+
+        Var u("u"), v("v"), j("j"), c("c"), k("k");
+        Var tx("tx"), ty("ty"), px("px"), py("py"), par("par");
+        Var txo("txo"), txi("txi"), ko("ko"), ki("ki");
+
+        // The tiles at the right and bottom edges can extend past the
+        // input. The results computed from there are never stored, so
+        // clamping is enough.
+        Func in("in");
+        in(x, y, c, n) = input(clamp(x, input.dim(0).min(), input.dim(0).max()),
+                               clamp(y, input.dim(1).min(), input.dim(1).max()),
+                               c, n);
+
+        // Transform the filter: U = G g G^T. In a real network this
+        // would be done once, when the weights are loaded.
+        Func Gg("Gg"), U("U");
+        Expr Gg_value = 0.0f;
+        for (int i = 0; i < 3; i++) {
+            Gg_value += matrix_entry(G, u, i) * filter(i, j, c, k);
+        }
+        Gg(u, j, c, k) = Gg_value;
+        Expr U_value = 0.0f;
+        for (int i = 0; i < 3; i++) {
+            U_value += matrix_entry(G, v, i) * Gg(u, i, c, k);
+        }
+        U(u, v, c, k) = U_value;
+
+        // Transform the input tiles: V = B^T d B. tx is innermost, so
+        // that it can be vectorized.
+        Func BTd("BTd"), V("V");
+        Expr BTd_value = 0.0f;
+        for (int i = 0; i < t; i++) {
+            BTd_value += matrix_entry(BT, u, i) * in(tx * m + i, ty * m + j, c, n);
+        }
+        BTd(tx, u, j, c, ty, n) = BTd_value;
+        Expr V_value = 0.0f;
+        for (int i = 0; i < t; i++) {
+            V_value += matrix_entry(BT, v, i) * BTd(tx, u, i, c, ty, n);
+        }
+        V(tx, u, v, c, ty, n) = V_value;
+
+        // Multiply pointwise and sum over the input channels. This is
+        // t * t independent matrix multiplies, and where the time goes.
+        Func M("M");
+        RDom rc(0, filter.dim(2).extent());
+        M(tx, u, v, k, ty, n) = 0.0f;
+        M(tx, u, v, k, ty, n) += U(u, v, rc, k) * V(tx, u, v, rc, ty, n);
+
+        // Transform the output tiles: Y = A^T M A. Storing px innermost
+        // and then tx makes x = tx * m + px dense.
+        Func MA("MA"), Y("Y");
+        Expr MA_value = 0.0f;
+        for (int i = 0; i < t; i++) {
+            MA_value += matrix_entry(AT, px, i) * M(tx, i, v, k, ty, n);
+        }
+        MA(tx, px, v, k, ty, n) = MA_value;
+        Expr Y_value = 0.0f;
+        for (int i = 0; i < t; i++) {
+            Y_value += matrix_entry(AT, py, i) * MA(tx, px, i, k, ty, n);
+        }
+        Y(px, tx, py, k, ty, n) = Y_value;
+
+        f_ReLU(x, y, z, n) = max(0, bias(z) + Y(x % m, x / m, y % m, z, y / m, n));
+
+        // Each task computes one row of tiles.
+        const int vec = natural_vector_size<float>();
+        f_ReLU.split(y, ty, py, m)
+            .reorder(x, py, z, ty, n)
+            .fuse(ty, n, par).parallel(par)
+            .vectorize(x, vec);
+
+        U.compute_root().unroll(u).unroll(v).parallel(k);
+        Gg.compute_at(U, k).unroll(u).unroll(j);
+
+        V.compute_at(f_ReLU, par)
+            .reorder(tx, u, v, c)
+            .vectorize(tx, vec).unroll(u).unroll(v);
+        BTd.compute_at(V, c)
+            .reorder(tx, u, j)
+            .vectorize(tx, vec).unroll(u).unroll(j);
+
+        M.compute_at(f_ReLU, par)
+            .vectorize(tx, vec);
+        M.update()
+            .split(tx, txo, txi, vec)
+            .split(k, ko, ki, 4)
+            .reorder(txi, ki, rc, txo, ko, u, v)
+            .vectorize(txi).unroll(ki);
+
+        MA.compute_at(f_ReLU, par)
+            .reorder(tx, px, v)
+            .vectorize(tx, vec).unroll(px).unroll(v);
+        Y.compute_at(f_ReLU, par)
+            .reorder(tx, px, py)
+            .vectorize(tx, vec).unroll(px).unroll(py);
+    }
+};
+
+// An int8 quantized convolution. The input and output are uint8 with
+// zero points, the filter is int8 and symmetric, and the products are
+// accumulated in int32.
+class QuantizedConvolutionLayer : public Halide::Generator<QuantizedConvolutionLayer> {
+public:
+    // The stride of the convolution.
+    GeneratorParam<int>   stride{"stride", 1};
+
+    Input<Buffer<uint8_t>> input{"input", 4};
+    Input<Buffer<int8_t>>  filter{"filter", 4};
+    Input<Buffer<int32_t>> bias{"bias", 1};
+
+    // The input value that represents zero.
+    Input<uint8_t>         input_zero{"input_zero"};
+    // The scale from the accumulator to the output, and the output
+    // value that represents zero.
+    Input<float>           output_scale{"output_scale"};
+    Input<uint8_t>         output_zero{"output_zero"};
+
+    Output<Buffer<uint8_t>> f_ReLU{"ReLU", 4};
+
+    void generate() {
+        /* THE ALGORITHM */
+
+        Var x("x"), y("y"), z("z"), n("n");
+        const int s = stride;
+
+        filter.dim(0).set_min(0).dim(1).set_min(0).dim(2).set_min(0);
+
+        // Widen to 16 bits before subtracting the zero point, and to 32
+        // bits before multiplying, so that nothing overflows.
+        Func input_16("input_16");
+        input_16(x, y, z, n) = cast<int16_t>(input(x, y, z, n)) - cast<int16_t>(input_zero);
+
+        Func f_conv("conv");
+        RDom r(0, filter.dim(0).extent(),
+               0, filter.dim(1).extent(),
+               0, filter.dim(2).extent());
+
+        f_conv(x, y, z, n) = bias(z);
+
+        f_conv(x, y, z, n) += (cast<int32_t>(filter(r.x, r.y, r.z, z)) *
+                               cast<int32_t>(input_16(x * s + r.x, y * s + r.y, r.z, n)));
+
+        // Requantize. The ReLU clamps at the output's zero point.
+        Expr scaled = cast<int32_t>(round(cast<float>(f_conv(x, y, z, n)) * output_scale)) + output_zero;
+        f_ReLU(x, y, z, n) = cast<uint8_t>(clamp(scaled, cast<int32_t>(output_zero), 255));
+
+        /* THE SCHEDULE */
+
+        // The same blocking as the float direct convolution, with the
+        // accumulator's vector width.
+        Var z_t("z_t"), y_t("y_t"), par("par");
+        const int vec_len = natural_vector_size<int32_t>();
+        int o_block_size = 32;
+        int y_block = 32;
+        f_conv.compute_root();
+        f_conv.fuse(z, n, par).parallel(par);
+        f_conv.update()
+            .reorder(x, y, r.z)
+            .split(y, y, y_t, y_block)
+            .split(z, z, z_t, o_block_size)
+            .reorder(y_t, z_t, y, r.z, z)
+            .vectorize(x, vec_len)
+            .unroll(r.x, 3)
+            .unroll(r.y, 3)
+            .fuse(z, n, par)
+            .parallel(par);
+        f_ReLU.reorder(n, z).parallel(z).vectorize(x, natural_vector_size<uint8_t>());
+    }
 };
 
 }  // namespace
 
 HALIDE_REGISTER_GENERATOR(ConvolutionLayer, conv_layer)
-
+HALIDE_REGISTER_GENERATOR(QuantizedConvolutionLayer, conv_layer_int8)
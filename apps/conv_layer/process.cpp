@@ -1,8 +1,17 @@
+#include <cmath>
 #include <cstdio>
+#include <cstdlib>
 #include <chrono>
+#include <map>
+#include <tuple>
+#include <vector>
 
 #include "conv_layer.h"
 #include "conv_layer_auto_schedule.h"
+#include "conv_layer_im2col.h"
+#include "conv_layer_winograd_2x2.h"
+#include "conv_layer_winograd_4x4.h"
+#include "conv_layer_int8.h"
 
 #include "halide_benchmark.h"
 #include "HalideBuffer.h"
@@ -10,52 +19,156 @@
 using namespace Halide::Tools;
 using namespace Halide::Runtime;
 
+namespace {
+
+// The properties of a convolution that decide which algorithm is fastest.
+struct ConvShape {
+    int filter_width, filter_height, stride, input_channels, output_channels;
+
+    bool operator<(const ConvShape &other) const {
+        return std::tie(filter_width, filter_height, stride, input_channels, output_channels) <
+            std::tie(other.filter_width, other.filter_height, other.stride, other.input_channels, other.output_channels);
+    }
+};
+
+typedef int (*ConvFunction)(halide_buffer_t *, halide_buffer_t *, halide_buffer_t *, halide_buffer_t *);
+
+struct ConvVariant {
+    const char *name;
+    ConvFunction f;
+    // The output width and height must be multiples of this.
+    int tile;
+    // Whether the variant only handles 3x3 filters with a stride of 1.
+    bool only_3x3;
+};
+
+const ConvVariant variants[] = {
+    {"direct", conv_layer, 1, false},
+    {"auto-scheduled direct", conv_layer_auto_schedule, 1, false},
+    {"im2col", conv_layer_im2col, 1, false},
+    {"winograd F(2x2, 3x3)", conv_layer_winograd_2x2, 2, true},
+    {"winograd F(4x4, 3x3)", conv_layer_winograd_4x4, 4, true},
+};
+
+bool applicable(const ConvVariant &v, const ConvShape &shape) {
+    // The generated variants other than the direct ones are compiled
+    // for a stride of 1.
+    if (shape.stride != 1) {
+        return v.f == conv_layer || v.f == conv_layer_auto_schedule;
+    }
+    return !v.only_3x3 || (shape.filter_width == 3 && shape.filter_height == 3);
+}
+
+// Pick the fastest variant for a shape by timing each variant that
+// handles it. The choice is remembered, so each shape is only timed
+// once.
+const ConvVariant &select_variant(const ConvShape &shape,
+                                  Buffer<float> &input, Buffer<float> &filter,
+                                  Buffer<float> &bias, Buffer<float> &output) {
+    static std::map<ConvShape, const ConvVariant *> choices;
+    auto it = choices.find(shape);
+    if (it != choices.end()) {
+        return *it->second;
+    }
+
+    const ConvVariant *best = nullptr;
+    double best_time = 0;
+    for (const ConvVariant &v : variants) {
+        if (!applicable(v, shape) ||
+            output.width() % v.tile != 0 || output.height() % v.tile != 0) {
+            continue;
+        }
+        double t = benchmark(3, 3, [&]() {
+            v.f(input, filter, bias, output);
+        });
+        if (!best || t < best_time) {
+            best = &v;
+            best_time = t;
+        }
+    }
+    choices[shape] = best;
+    return *best;
+}
+
+}  // namespace
+
 int main(int argc, char **argv) {
     Buffer<float> input(67, 67, 32, 4);
     Buffer<float> filter(3, 3, 32, 32);
     Buffer<float> bias(32);
 
-    for (int c = 0; c < input.dim(3).extent(); c++) {
-        for (int z = 0; z < input.channels(); z++) {
-            for (int y = 0; y < input.height(); y++) {
-                for (int x = 0; x < input.width(); x++) {
-                    input(x, y) = rand();
-                }
-            }
-        }
-    }
+    input.for_each_value([](float &v) { v = (float)rand() / RAND_MAX; });
+    filter.for_each_value([](float &v) { v = (float)rand() / RAND_MAX - 0.5f; });
+    bias.for_each_value([](float &v) { v = (float)rand() / RAND_MAX - 0.5f; });
+
+    Buffer<float> output(64, 64, 32, 4);
+    Buffer<float> reference(64, 64, 32, 4);
 
-    for (int c = 0; c < filter.dim(3).extent(); c++) {
-        for (int z = 0; z < filter.channels(); z++) {
-            for (int y = 0; y < filter.height(); y++) {
-                for (int x = 0; x < filter.width(); x++) {
-                    filter(x, y) = rand();
-                }
-            }
+    conv_layer(input, filter, bias, reference);
+
+    // Timing code. Every variant must also agree with the direct
+    // convolution. The Winograd transforms lose a little precision.
+    for (const ConvVariant &v : variants) {
+        v.f(input, filter, bias, output);
+        float max_error = 0.0f;
+        reference.for_each_element([&](int x, int y, int c, int n) {
+            float error = std::abs(output(x, y, c, n) - reference(x, y, c, n));
+            max_error = std::max(max_error, error / std::max(1.0f, std::abs(reference(x, y, c, n))));
+        });
+        if (max_error > 1e-3f) {
+            printf("The %s convolution has a relative error of %g\n", v.name, max_error);
+            return -1;
         }
-    }
 
-    for (int x = 0; x < bias.width(); x++) {
-        bias(x) = rand();
+        double t = benchmark(10, 10, [&]() {
+            v.f(input, filter, bias, output);
+        });
+        printf("%s time: %gms\n", v.name, t * 1e3);
     }
 
-    Buffer<float> output(64, 64, 32, 4);
+    ConvShape shape = {filter.width(), filter.height(), 1, filter.channels(), filter.dim(3).extent()};
+    const ConvVariant &choice = select_variant(shape, input, filter, bias, output);
+    printf("Selected algorithm for a %dx%d filter, stride %d, %d -> %d channels: %s\n",
+           shape.filter_width, shape.filter_height, shape.stride,
+           shape.input_channels, shape.output_channels, choice.name);
 
-    conv_layer(input, filter, bias, output);
+    // The int8 quantized version, on the same data quantized to 8 bits.
+    const float input_scale = 1.0f / 255, filter_scale = 0.5f / 127;
+    const uint8_t output_zero = 128;
+    const float output_scale = 1.0f / 32;
+    Buffer<uint8_t> input_q(67, 67, 32, 4);
+    Buffer<int8_t> filter_q(3, 3, 32, 32);
+    Buffer<int32_t> bias_q(32);
+    Buffer<uint8_t> output_q(64, 64, 32, 4);
+    input_q.for_each_element([&](int x, int y, int c, int n) {
+        input_q(x, y, c, n) = (uint8_t)std::lround(input(x, y, c, n) / input_scale);
+    });
+    filter_q.for_each_element([&](int x, int y, int c, int n) {
+        filter_q(x, y, c, n) = (int8_t)std::lround(filter(x, y, c, n) / filter_scale);
+    });
+    bias_q.for_each_element([&](int x) {
+        bias_q(x) = (int32_t)std::lround(bias(x) / (input_scale * filter_scale));
+    });
+    // The scale from the int32 accumulator to the output.
+    const float requantize = input_scale * filter_scale / output_scale;
 
-    // Timing code
+    conv_layer_int8(input_q, filter_q, bias_q, 0, requantize, output_zero, output_q);
 
-    // Manually-tuned version
-    double min_t_manual = benchmark(10, 10, [&]() {
-        conv_layer(input, filter, bias, output);
+    int max_error = 0;
+    reference.for_each_element([&](int x, int y, int c, int n) {
+        float expected = std::max(0.0f, reference(x, y, c, n)) / output_scale + output_zero;
+        expected = std::min(expected, 255.0f);
+        max_error = std::max(max_error, (int)std::abs(output_q(x, y, c, n) - expected));
     });
-    printf("Manually-tuned time: %gms\n", min_t_manual * 1e3);
+    if (max_error > 2) {
+        printf("The int8 convolution is off by up to %d\n", max_error);
+        return -1;
+    }
 
-    // Auto-scheduled version
-    double min_t_auto = benchmark(10, 10, [&]() {
-        conv_layer_auto_schedule(input, filter, bias, output);
+    double min_t_int8 = benchmark(10, 10, [&]() {
+        conv_layer_int8(input_q, filter_q, bias_q, 0, requantize, output_zero, output_q);
     });
-    printf("Auto-scheduled time: %gms\n", min_t_auto * 1e3);
+    printf("int8 quantized time: %gms\n", min_t_int8 * 1e3);
 
     return 0;
 }
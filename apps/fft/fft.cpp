@@ -9,10 +9,13 @@
 #include <cstddef>
 #include <limits>
 #include <map>
+#include <mutex>
 #include <ostream>
+#include <set>
 #include <string>
 
 #include "funct.h"
+#include "halide_benchmark.h"
 
 using std::vector;
 using std::string;
@@ -1034,26 +1037,181 @@ vector<int> radix_factor(int N) {
     return R;
 }
 
+// Factor N greedily into the given radices, in the order given.
+vector<int> greedy_factor(int N, const vector<int> &radices) {
+    vector<int> R;
+    for (int r : radices) {
+        while (N % r == 0) {
+            R.push_back(r);
+            N /= r;
+        }
+    }
+    if (N != 1 || R.empty()) {
+        R.push_back(N);
+    }
+    return R;
+}
+
+// The plans worth timing for an FFT of size N: the heuristic plan,
+// and greedy factorizations into a few sets of radices, each in
+// decreasing and increasing order of radix.
+vector<vector<int>> candidate_plans(int N) {
+    std::set<vector<int>> unique;
+    vector<vector<int>> candidates;
+    auto add = [&](const vector<int> &R) {
+        if (unique.insert(R).second) {
+            candidates.push_back(R);
+        }
+    };
+
+    add(radix_factor(N));
+    const vector<vector<int>> radix_sets = {
+        { 8, 6, 4, 2 },
+        { 8, 4, 2 },
+        { 4, 6, 2 },
+        { 6, 2 },
+        { 2 },
+    };
+    for (const vector<int> &radices : radix_sets) {
+        vector<int> R = greedy_factor(N, radices);
+        add(R);
+        std::reverse(R.begin(), R.end());
+        add(R);
+    }
+    return candidates;
+}
+
+// Time a plan by transforming dimension 1 of a batch of columns,
+// which is the pass every dimension of a multi-dimensional FFT
+// reduces to.
+double time_plan(const vector<int> &R, const Target &target) {
+    const int N = product(R);
+    const int columns = 16;
+
+    Var x("x"), y("y");
+    ComplexFunc in("plan_in");
+    in(x, y) = ComplexExpr(cast<float>(x + y) / N, 0.0f);
+    in.compute_root();
+
+    Fft2dDesc desc;
+    desc.name = "plan";
+    ComplexFunc dft = fft2d_c2c(in, { columns }, R, -1, target, desc);
+
+    Realization result = dft.realize(columns, N, target);
+    return Halide::Tools::benchmark(3, 10, [&]() { dft.realize(result, target); });
+}
+
 }  // namespace
 
+vector<int> fft_plan(int N, const Target &target, bool measure) {
+    if (!measure) {
+        return radix_factor(N);
+    }
+
+    // We can only time plans we can run.
+    const Target host = get_host_target();
+    if (target.os != host.os || target.arch != host.arch || target.bits != host.bits) {
+        return radix_factor(N);
+    }
+
+    static std::mutex cache_mutex;
+    static std::map<std::pair<int, string>, vector<int>> cache;
+    const std::pair<int, string> key(N, target.to_string());
+    {
+        std::lock_guard<std::mutex> lock(cache_mutex);
+        auto it = cache.find(key);
+        if (it != cache.end()) {
+            return it->second;
+        }
+    }
+
+    vector<int> best;
+    double best_time = std::numeric_limits<double>::infinity();
+    for (const vector<int> &R : candidate_plans(N)) {
+        double t = time_plan(R, target);
+        if (t < best_time) {
+            best = R;
+            best_time = t;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    cache[key] = best;
+    return best;
+}
+
 ComplexFunc fft2d_c2c(ComplexFunc x,
                       int N0, int N1,
                       int sign,
                       const Target& target,
                       const Fft2dDesc& desc) {
-    return fft2d_c2c(x, radix_factor(N0), radix_factor(N1), sign, target, desc);
+    return fft2d_c2c(x, fft_plan(N0, target, desc.measure), fft_plan(N1, target, desc.measure),
+                     sign, target, desc);
 }
 
 ComplexFunc fft2d_r2c(Func r,
                       int N0, int N1,
                       const Target& target,
                       const Fft2dDesc& desc) {
-    return fft2d_r2c(r, radix_factor(N0), radix_factor(N1), target, desc);
+    return fft2d_r2c(r, fft_plan(N0, target, desc.measure), fft_plan(N1, target, desc.measure),
+                     target, desc);
 }
 
 Func fft2d_c2r(ComplexFunc c,
                int N0, int N1,
                const Target& target,
                const Fft2dDesc& desc) {
-    return fft2d_c2r(c, radix_factor(N0), radix_factor(N1), target, desc);
+    return fft2d_c2r(c, fft_plan(N0, target, desc.measure), fft_plan(N1, target, desc.measure),
+                     target, desc);
+}
+
+ComplexFunc fft3d_c2c(ComplexFunc x,
+                      int N0, int N1, int N2,
+                      int sign,
+                      const Target& target,
+                      const Fft2dDesc& desc) {
+    string prefix = desc.name.empty() ? "c2c3d_" : desc.name + "_";
+
+    // Transform dimensions 0 and 1 first, without the gain, which is
+    // applied by the last pass.
+    Fft2dDesc desc_2d = desc;
+    desc_2d.gain = 1.0f;
+    desc_2d.name = prefix + "xy";
+    ComplexFunc dft_2d = fft2d_c2c(x, N0, N1, sign, target, desc_2d);
+
+    vector<Var> args = dft_2d.args();
+    Var n0(args[0]), n1(args[1]), n2(args[2]);
+    args.erase(args.begin(), args.begin() + 3);
+
+    // Get the innermost variable outside the FFT.
+    Var outer = args.empty() ? Var::outermost() : args[0];
+
+    // Swap dimensions 1 and 2, so that fft_dim1 transforms dimension 2
+    // while still vectorizing across dimension 0.
+    ComplexFunc dft_2dT(prefix + "xyT");
+    dft_2dT(A({n0, n2, n1}, args)) = dft_2d(A({n0, n1, n2}, args));
+
+    TwiddleFactorSet twiddle_cache;
+    ComplexFunc dft_zT = fft_dim1(dft_2dT,
+                                  fft_plan(N2, target, desc.measure),
+                                  sign,
+                                  N0,  // extent of dim 0
+                                  desc.gain,
+                                  desc.parallel,
+                                  prefix,
+                                  target,
+                                  &twiddle_cache);
+
+    ComplexFunc dft(prefix + "xyz");
+    dft(A({n0, n1, n2}, args)) = dft_zT(A({n0, n2, n1}, args));
+
+    // Each pass needs the whole volume produced by the one before it.
+    dft_2d.compute_at(dft, outer);
+    dft_zT.compute_at(dft, outer);
+
+    const int vector_width = std::min(N0, target.natural_vector_size<float>());
+    dft.bound(n0, 0, N0).bound(n1, 0, N1).bound(n2, 0, N2)
+        .vectorize(n0, vector_width);
+
+    return dft;
 }
@@ -36,8 +36,20 @@ struct Fft2dDesc {
 
     // A name to prepend to the name of the Funcs the FFT defines.
     std::string name = "";
+
+    // If true, choose the radices for each dimension by timing candidate
+    // plans on this machine (see fft_plan) instead of by a fixed heuristic.
+    bool measure = false;
 };
 
+// Choose the radices to decompose an FFT of size N into. If measure is
+// false, this is a fixed heuristic. Otherwise, a set of candidate plans
+// is compiled and timed, and the fastest is returned. Measured plans
+// are cached for each size and target for the lifetime of the process.
+// Plans can only be measured for targets that can run on the host; for
+// any other target this falls back to the heuristic.
+std::vector<int> fft_plan(int N, const Halide::Target& target, bool measure = false);
+
 // Compute the N0 x N1 2D complex DFT of the first 2 dimensions of a complex
 // valued function x. The first 2 dimensions of x should be defined on at least
 // [0, N0) and [0, N1) for dimensions 0, 1, respectively. sign = -1 indicates a
@@ -46,6 +58,10 @@ struct Fft2dDesc {
 //
 //   X = fft2d_c2c(x, N0, N1, -1);
 //   x = fft2d_c2c(X, N0, N1, 1) / (N0 * N1);
+//
+// Any dimensions of x after the first 2 are batch dimensions: the FFT
+// is computed independently for each value of them, one at a time, so
+// they can be parallelized by the caller.
 ComplexFunc fft2d_c2c(ComplexFunc x, int N0, int N1, int sign,
                       const Halide::Target& target,
                       const Fft2dDesc& desc = Fft2dDesc());
@@ -66,4 +82,11 @@ Halide::Func fft2d_c2r(ComplexFunc c, int N0, int N1,
                        const Halide::Target& target,
                        const Fft2dDesc& desc = Fft2dDesc());
 
+// Compute the N0 x N1 x N2 3D complex DFT of the first 3 dimensions of a
+// complex valued function x, with the same conventions as fft2d_c2c. Any
+// dimensions after the first 3 are batch dimensions.
+ComplexFunc fft3d_c2c(ComplexFunc x, int N0, int N1, int N2, int sign,
+                      const Halide::Target& target,
+                      const Fft2dDesc& desc = Fft2dDesc());
+
 #endif
@@ -20,8 +20,15 @@ std::map<std::string, FFTDirection> fft_direction_enum_map() {
            { "frequency_to_samples", FFTDirection::FrequencyToSamples } };
 }
 
-class FFTGenerator : public Halide::Generator<FFTGenerator> {
+// If batched is true, the input and output have an extra outermost
+// dimension, and an FFT is computed for each value of it.
+template<bool batched>
+class FFTGenerator : public Halide::Generator<FFTGenerator<batched>> {
 public:
+    typedef Halide::Generator<FFTGenerator<batched>> Base;
+    using Base::target;
+    template<typename T2> using Input = typename Base::template Input<T2>;
+    template<typename T2> using Output = typename Base::template Output<T2>;
 
     // Gain to apply to the FFT. This is folded into gains already
     // being applied to the FFT. A gain of 1.0f indicates an
@@ -68,6 +75,11 @@ public:
     GeneratorParam<int32_t> size1{"size1", 0};
     // TODO(zalman): Add support for 3D and maybe 4D FFTs
 
+    // Whether to choose the radices by timing candidate plans when the
+    // generator runs, rather than by a fixed heuristic. Only has an
+    // effect when generating code for the host.
+    GeneratorParam<bool> measure{"measure", false};
+
     // The input buffer. Must be separate from the output.
     // Only Float(32) is supported.
     //
@@ -80,8 +92,11 @@ public:
     // Dim0: extent = size0, stride = 2
     // Dim1: extent = size1, stride = size0 * 2
     // Dim2: extent = 2, stride = 1 (real followed by imaginary components)
-    Input<Buffer<float>>  input{"input", 3};
-    Output<Buffer<float>> output{"output", 3};
+    //
+    // The batched generator takes one more dimension, the index of the
+    // FFT in the batch. The FFTs in a batch are computed in parallel.
+    Input<Buffer<float>>  input{"input", batched ? 4 : 3};
+    Output<Buffer<float>> output{"output", batched ? 4 : 3};
 
     void generate() {
         _halide_user_assert(size0 > 0) << "FFT must be at least 1D\n";
@@ -90,6 +105,22 @@ public:
 
         desc.gain = gain;
         desc.vector_width = vector_width;
+        desc.parallel = parallel;
+        desc.measure = measure;
+
+        // The arguments of the transformed Funcs, and a helper to
+        // index the input or output at a component.
+        std::vector<Var> args = {x, y};
+        if (batched) {
+            args.push_back(b);
+        }
+        auto at = [&](Expr comp) -> std::vector<Expr> {
+            std::vector<Expr> result = {x, y, comp};
+            if (batched) {
+                result.push_back(b);
+            }
+            return result;
+        };
 
         // The logic below calls the specialized r2c or c2r version if
         // applicable to take advantage of better scheduling. It is
@@ -104,18 +135,18 @@ public:
                 // -> Func conversion should happen, It may not work
                 // with implicit dimension (use of _) logic in FFT.
                 Func in;
-                in(x, y) = input(x, y, 0);
+                in(args) = input(at(0));
 
                 complex_result = fft2d_r2c(in, size0, size1, target, desc);
             } else {
                 ComplexFunc in;
-                in(x, y) = ComplexExpr(input(x, y, 0), 0);
+                in(args) = ComplexExpr(input(at(0)), 0);
 
                 complex_result = fft2d_c2c(in, size0, size1, sign, target, desc);
             }
         } else {
             ComplexFunc in;
-            in(x, y) = ComplexExpr(input(x, y, 0), input(x, y, 1));
+            in(args) = ComplexExpr(input(at(0)), input(at(1)));
             if (output_number_type == FFTNumberType::Real &&
                 direction == FFTDirection::FrequencyToSamples) {
                 real_result = fft2d_c2r(in, size0, size1, target, desc);
@@ -126,14 +157,14 @@ public:
 
         if (output_number_type == FFTNumberType::Real) {
             if (real_result.defined()) {
-                 output(x, y, c) = real_result(x, y);
+                 output(at(c)) = real_result(args);
             } else {
-                 output(x, y, c) = re(complex_result(x, y));
+                 output(at(c)) = re(complex_result(args));
             }
         } else {
-            output(x, y, c) = select(c == 0,
-                                     re(complex_result(x, y)),
-                                     im(complex_result(x, y)));
+            output(at(c)) = select(c == 0,
+                                   re(complex_result(args)),
+                                   im(complex_result(args)));
         }
     }
 
@@ -151,19 +182,27 @@ public:
             output.reorder(c, x, y).unroll(c);
         }
 
+        // Compute each FFT of a batch separately, in parallel.
+        Var outer = Var::outermost();
+        if (batched) {
+            outer = b;
+            output.parallel(b);
+        }
+
         if (real_result.defined()) {
-            real_result.compute_at(output, Var::outermost());
+            real_result.compute_at(output, outer);
         } else {
             assert(complex_result.defined());
-            complex_result.compute_at(output, Var::outermost());
+            complex_result.compute_at(output, outer);
         }
     }
 private:
-    Var x{"x"}, y{"y"}, c{"c"};
+    Var x{"x"}, y{"y"}, c{"c"}, b{"b"};
     Func real_result;
     ComplexFunc complex_result;
 };
 
 }  // namespace
 
-HALIDE_REGISTER_GENERATOR(FFTGenerator, fft)
+HALIDE_REGISTER_GENERATOR(FFTGenerator<false>, fft)
+HALIDE_REGISTER_GENERATOR(FFTGenerator<true>, fft_batched)
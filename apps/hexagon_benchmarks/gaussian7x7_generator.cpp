@@ -0,0 +1,69 @@
+#include "Halide.h"
+
+using namespace Halide;
+
+class Gaussian7x7 : public Generator<Gaussian7x7> {
+public:
+    Input<Buffer<uint8_t>> input{"input", 2};
+    Output<Buffer<uint8_t>> output{"output", 2};
+
+    void generate() {
+        bounded_input(x, y) = BoundaryConditions::repeat_edge(input)(x, y);
+
+        Func input_16("input_16");
+        input_16(x, y) = cast<int16_t>(bounded_input(x, y));
+
+        // The sum of the rows fits in 16 bits, but the sum of the
+        // columns needs 32.
+        rows(x, y) = input_16(x, y-3) + 6*input_16(x, y-2) + 15*input_16(x, y-1) + 20*input_16(x, y) +
+                     15*input_16(x, y+1) + 6*input_16(x, y+2) + input_16(x, y+3);
+        Func rows_32("rows_32");
+        rows_32(x, y) = cast<int32_t>(rows(x, y));
+        cols(x, y) = rows_32(x-3, y) + 6*rows_32(x-2, y) + 15*rows_32(x-1, y) + 20*rows_32(x, y) +
+                     15*rows_32(x+1, y) + 6*rows_32(x+2, y) + rows_32(x+3, y);
+
+        output(x, y)  = cast<uint8_t> (cols(x, y) >> 12);
+    }
+
+    void schedule() {
+        Var xi{"xi"}, yi{"yi"};
+
+        input.dim(0).set_min(0);
+        input.dim(1).set_min(0);
+
+        output.dim(0).set_min(0);
+        output.dim(1).set_min(0);
+
+        if (get_target().features_any_of({Target::HVX_64, Target::HVX_128})) {
+            const int vector_size = get_target().has_feature(Target::HVX_128) ? 128 : 64;
+            Expr input_stride = input.dim(1).stride();
+            input.dim(1).set_stride((input_stride/vector_size) * vector_size);
+
+            Expr output_stride = output.dim(1).stride();
+            bounded_input
+                .compute_at(Func(output), y)
+                .align_storage(x, 128)
+                .vectorize(x, vector_size, TailStrategy::RoundUp);
+            output.dim(1).set_stride((output_stride/vector_size) * vector_size);
+            output
+                .hexagon()
+                .tile(x, y, xi, yi, vector_size*2, 4, TailStrategy::RoundUp)
+                .vectorize(xi)
+                .unroll(yi);
+            rows.compute_at(Func(output), y)
+                .tile(x, y, x, y, xi, yi, vector_size, 4, TailStrategy::RoundUp)
+                .vectorize(xi)
+                .unroll(yi);
+        } else {
+            const int vector_size = natural_vector_size<uint8_t>();
+            output
+                .vectorize(x, vector_size)
+                .parallel(y, 16);
+        }
+    }
+private:
+    Func rows{"rows"}, cols{"cols"}, bounded_input{"bounded_input"};
+    Var x{"x"}, y{"y"};
+};
+
+HALIDE_REGISTER_GENERATOR(Gaussian7x7, gaussian7x7)
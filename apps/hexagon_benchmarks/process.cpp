@@ -10,6 +10,7 @@ void usage(char *prg_name) {
     const char usage_string[] = " Run a bunch of small filters\n\n"
                                 "\t -m -> hvx_mode - options are hvx64, hvx128. Default is to run hvx64, hvx128 and cpu\n"
                                 "\t -n -> number of iterations\n"
+                                "\t -c -> clock rate in MHz of the processor running the filters, to report cycles per pixel\n"
                                 "\t -h -> print this help message\n";
     printf ("%s - %s", prg_name, usage_string);
 
@@ -31,6 +32,7 @@ int main(int argc, char **argv) {
     const int H = 1024;
     std::vector<bmark_run_mode_t> modes;
     int iterations = 10;
+    double clock_mhz = 0;
 
     // Process command line args.
     for (int i = 1; i < argc; ++i) {
@@ -60,6 +62,10 @@ int main(int argc, char **argv) {
                 iterations = atoi(argv[i+1]);
                 i++;
                 break;
+            case 'c':
+                clock_mhz = atof(argv[i+1]);
+                i++;
+                break;
             }
         }
     }
@@ -72,12 +78,14 @@ int main(int argc, char **argv) {
     Dilate3x3Descriptor dilate3x3_pipeine(W, H);
     Median3x3Descriptor median3x3_pipeline(W, H);
     Gaussian5x5Descriptor gaussian5x5_pipeline(W, H);
+    Gaussian7x7Descriptor gaussian7x7_pipeline(W, H);
     SobelDescriptor sobel_pipeline(W, H);
     Conv3x3a32Descriptor conv3x3a32_pipeline(W, H);
 
 
     std::vector<PipelineDescriptorBase *> pipelines = {&conv3x3a16_pipeline, &dilate3x3_pipeine, &median3x3_pipeline,
-                                                       &gaussian5x5_pipeline, &sobel_pipeline, &conv3x3a32_pipeline};
+                                                       &gaussian5x5_pipeline, &gaussian7x7_pipeline, &sobel_pipeline,
+                                                       &conv3x3a32_pipeline};
 
     for (bmark_run_mode_t m : modes) {
         for (PipelineDescriptorBase *p : pipelines) {
@@ -99,6 +107,15 @@ int main(int argc, char **argv) {
                     }
                 });
             printf("Done, time (%s): %g s %s\n", p->name(), time, to_string(m));
+            // Report the time per pixel, which is comparable across
+            // filters, and the cycles per pixel if we know the clock rate.
+            double ns_per_pixel = time * 1e9 / (W * H);
+            if (clock_mhz > 0) {
+                printf("    %g ns/pixel, %g cycles/pixel at %g MHz\n",
+                       ns_per_pixel, ns_per_pixel * clock_mhz / 1000, clock_mhz);
+            } else {
+                printf("    %g ns/pixel\n", ns_per_pixel);
+            }
 
             // We're done with HVX, power it off, and reset the performance mode
             // to default to save power.
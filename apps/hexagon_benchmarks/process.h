@@ -28,6 +28,12 @@
 #include "gaussian5x5_cpu.h"
 #endif
 
+#ifdef GAUSSIAN7X7
+#include "gaussian7x7_hvx128.h"
+#include "gaussian7x7_hvx64.h"
+#include "gaussian7x7_cpu.h"
+#endif
+
 #ifdef SOBEL
 #include "sobel_hvx128.h"
 #include "sobel_hvx64.h"
@@ -352,6 +358,74 @@ class Gaussian5x5Descriptor : public PipelineDescriptorBase {
     }
 };
 
+class Gaussian7x7Descriptor : public PipelineDescriptorBase {
+    Halide::Runtime::Buffer<uint8_t> u8_in, u8_out;
+
+ public:
+     Gaussian7x7Descriptor(int W, int H) : u8_in(nullptr, W, H, 2),
+                                           u8_out(nullptr, W, H, 2) {}
+
+    void init() {
+        u8_in.device_malloc(halide_hexagon_device_interface());
+        u8_out.device_malloc(halide_hexagon_device_interface());
+
+        u8_in.for_each_value([&](uint8_t &x) {
+            x = static_cast<uint8_t>(rand());
+        });
+        u8_out.fill(0);
+    }
+
+    const char *name() { return "gaussian7x7"; };
+
+    bool defined() {
+#ifdef GAUSSIAN7X7
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    bool verify(const int W, const int H) {
+        const int16_t coeffs[7] = { 1, 6, 15, 20, 15, 6, 1 };
+        u8_out.copy_to_host();
+        u8_out.for_each_element([&](int x, int y) {
+            int32_t blur = 0;
+            for (int rx = -3; rx < 4; ++rx) {
+                int16_t blur_y = 0;
+                for (int ry = -3; ry < 4; ++ry) {
+                    int16_t val = static_cast<int16_t>(u8_in(clamp(x+rx, 0, W-1), clamp(y+ry, 0, H-1)));
+                    blur_y += val * coeffs[ry + 3];
+                }
+                blur += blur_y * coeffs[rx + 3];
+            }
+            uint8_t blur_val = blur >> 12;
+            uint8_t out_xy = u8_out(x, y);
+            if (blur_val != out_xy) {
+                printf("Gaussian7x7: Mismatch at %d %d : %d != %d\n", x, y, out_xy, blur_val);
+                abort();
+            }
+        });
+        return true;
+    }
+
+    int run(bmark_run_mode_t mode) {
+#ifdef GAUSSIAN7X7
+        if (mode == bmark_run_mode_t::hvx64) {
+            return gaussian7x7_hvx64(u8_in, u8_out);
+        } else if (mode == bmark_run_mode_t::hvx128) {
+            return gaussian7x7_hvx128(u8_in, u8_out);
+        } else if (mode == bmark_run_mode_t::cpu) {
+            return gaussian7x7_cpu(u8_in, u8_out);
+        }
+#endif
+        return 1;
+    }
+    void finalize() {
+        u8_in.device_free();
+        u8_out.device_free();
+    }
+};
+
 class SobelDescriptor : public PipelineDescriptorBase {
     Halide::Runtime::Buffer<uint8_t> u8_in, u8_out;
 
@@ -9,6 +9,9 @@ using namespace Halide;
 class LensBlur : public Halide::Generator<LensBlur> {
 public:
     GeneratorParam<bool>    auto_schedule{"auto_schedule", false};
+    // Render each depth slice with a disc blur instead of sampling the
+    // aperture.
+    GeneratorParam<bool>    layered{"layered", false};
 
     Input<Buffer<uint8_t>>  left_im{"left_im", 3};
     Input<Buffer<uint8_t>>  right_im{"right_im", 3};
@@ -18,7 +21,8 @@ public:
     Input<int>              focus_depth{"focus_depth", 13, 1, 32};
     // The increase in blur radius with misfocus depth
     Input<float>            blur_radius_scale{"blur_radius_scale", 0.5f, 0.0f, 1.0f};
-    // The number of samples of the aperture to use
+    // The number of samples of the aperture to use. Unused by the
+    // layered variant.
     Input<int>              aperture_samples{"aperture_samples", 32, 1, 64};
 
     Output<Buffer<float>>   final{"final", 3};
@@ -150,8 +154,55 @@ public:
         sample_y = y + sample_locations(x, y, s)[1];
         output(x, y, c) += sample_weight(x, y, s) * input_with_alpha(sample_x, sample_y, c);
 
+        // Alternatively, render the image one depth slice at a time,
+        // from back to front. Each slice is blurred by a disc of the
+        // radius for its depth. The disc is a sum of one box filter
+        // per row, and each box filter is a difference of two values
+        // of a running sum along the row, so the cost per pixel grows
+        // linearly with the radius rather than with its square.
+        Func layer;
+        layer(x, y, z, c) = select(depth(x, y) == z, input_with_alpha(x, y, c), 0.0f);
+
+        // The running sums cover every pixel the discs can reach.
+        RDom rx(left_im.dim(0).min() - maximum_blur_radius - 1,
+                left_im.dim(0).extent() + 2*maximum_blur_radius + 2);
+        Func prefix;
+        prefix(x, y, z, c) = 0.0f;
+        prefix(rx, y, z, c) = prefix(rx - 1, y, z, c) + layer(rx, y, z, c);
+
+        // The rows of the disc for slice z, and their half-widths.
+        Expr radius = abs(z - focus_depth) * blur_radius_scale;
+        RDom ry(-maximum_blur_radius, 2*maximum_blur_radius + 1);
+        ry.where(ry * ry <= radius * radius);
+        Expr half_width = cast<int>(sqrt(radius * radius - ry * ry));
+
+        Func disc_area;
+        disc_area(z) = 0;
+        disc_area(z) += 2 * half_width + 1;
+
+        Func blurred;
+        blurred(x, y, z, c) = 0.0f;
+        blurred(x, y, z, c) += (prefix(x + half_width, y + ry, z, c) -
+                                prefix(x - half_width - 1, y + ry, z, c));
+
+        // Composite the blurred slices over each other, with the
+        // nearest slice (the smallest depth) on top. The alpha channel
+        // gives the coverage of each slice.
+        RDom rz(0, slices);
+        Expr slice = slices - 1 - rz;
+        Expr area = cast<float>(disc_area(slice));
+        Expr coverage = blurred(x, y, slice, 3) / (area * 255.0f);
+        Func composite;
+        composite(x, y, c) = 0.0f;
+        composite(x, y, c) = (blurred(x, y, slice, c) / area +
+                              composite(x, y, c) * (1.0f - coverage));
+
         // Normalize
-        final(x, y, c) = output(x, y, c) / output(x, y, 3);
+        if (layered) {
+            final(x, y, c) = composite(x, y, c) / composite(x, y, 3);
+        } else {
+            final(x, y, c) = output(x, y, c) / output(x, y, 3);
+        }
 
         /* THE SCHEDULE */
         if (auto_schedule) {
@@ -196,22 +247,51 @@ public:
                 .gpu_tile(x, y, xi, yi, 16, 16);
             input_with_alpha.compute_root()
                 .reorder(c, x, y).unroll(c).gpu_tile(x, y, xi, yi, 16, 16);
-            worst_case_bokeh_radius_y
-                .compute_root()
-                .gpu_tile(x, y, xi, yi, 16, 16);
-            worst_case_bokeh_radius
-                .compute_root()
-                .gpu_tile(x, y, xi, yi, 16, 16);
             final.compute_root()
                 .reorder(c, x, y)
                 .bound(c, 0, 3)
                 .unroll(c)
                 .gpu_tile(x, y, xi, yi, 16, 16);
 
-            output.compute_at(final, xi);
-            output.update().reorder(c, x, s).unroll(c);
-            sample_weight.compute_at(output, x);
-            sample_locations.compute_at(output, x);
+            if (layered) {
+                // Each slice is composited by its own kernel, after
+                // kernels that compute its running sums one thread
+                // per row.
+                Var yo("yo");
+                composite.compute_root()
+                    .bound(c, 0, 4)
+                    .reorder(c, x, y)
+                    .unroll(c)
+                    .gpu_tile(x, y, xi, yi, 16, 16);
+                composite.update()
+                    .reorder(c, x, y, rz)
+                    .unroll(c)
+                    .gpu_tile(x, y, xi, yi, 16, 16);
+                prefix.compute_at(composite, rz)
+                    .bound(c, 0, 4)
+                    .reorder(c, x, y)
+                    .unroll(c)
+                    .gpu_tile(x, y, xi, yi, 16, 16);
+                prefix.update()
+                    .reorder(c, rx, y)
+                    .unroll(c)
+                    .gpu_tile(y, yo, yi, 64);
+                blurred.compute_at(composite, xi);
+                blurred.update().reorder(c, x, ry).unroll(c);
+                disc_area.compute_root();
+            } else {
+                worst_case_bokeh_radius_y
+                    .compute_root()
+                    .gpu_tile(x, y, xi, yi, 16, 16);
+                worst_case_bokeh_radius
+                    .compute_root()
+                    .gpu_tile(x, y, xi, yi, 16, 16);
+
+                output.compute_at(final, xi);
+                output.update().reorder(c, x, s).unroll(c);
+                sample_weight.compute_at(output, x);
+                sample_locations.compute_at(output, x);
+            }
         } else {
             // Manual CPU schedule
             cost_pyramid_push[0].compute_root()
@@ -248,24 +328,55 @@ public:
                 .unroll(c)
                 .vectorize(x, 8)
                 .parallel(y, 8);
-            worst_case_bokeh_radius_y
-                .compute_at(final, y)
-                .vectorize(x, 8);
-            final.compute_root()
-                .reorder(c, x, y)
-                .bound(c, 0, 3)
-                .unroll(c).vectorize(x, 8)
-                .parallel(y);
-            worst_case_bokeh_radius
-                .compute_at(final, y)
-                .vectorize(x, 8);
-            output.compute_at(final, x)
-                .vectorize(x);
-            output.update()
-                .reorder(c, x, s)
-                .vectorize(x).unroll(c);
-            sample_weight.compute_at(output, x).unroll(x);
-            sample_locations.compute_at(output, x).vectorize(x);
+            if (layered) {
+                // Composite strips of rows one slice at a time. The
+                // running sums of a slice slide down the strip.
+                final.compute_root()
+                    .reorder(c, x, y)
+                    .bound(c, 0, 3)
+                    .unroll(c).vectorize(x, 8)
+                    .parallel(y, 32);
+                composite.compute_at(final, y)
+                    .bound(c, 0, 4)
+                    .reorder(c, x, y)
+                    .unroll(c).vectorize(x, 8);
+                composite.update()
+                    .reorder(c, x, y, rz)
+                    .unroll(c).vectorize(x, 8);
+                prefix.store_at(composite, rz)
+                    .compute_at(composite, y)
+                    .bound(c, 0, 4)
+                    .reorder(c, x, y)
+                    .unroll(c).vectorize(x, 8);
+                prefix.update()
+                    .reorder(c, rx, y)
+                    .unroll(c);
+                blurred.compute_at(composite, x)
+                    .vectorize(x);
+                blurred.update()
+                    .reorder(c, x, ry)
+                    .vectorize(x).unroll(c);
+                disc_area.compute_root();
+            } else {
+                worst_case_bokeh_radius_y
+                    .compute_at(final, y)
+                    .vectorize(x, 8);
+                final.compute_root()
+                    .reorder(c, x, y)
+                    .bound(c, 0, 3)
+                    .unroll(c).vectorize(x, 8)
+                    .parallel(y);
+                worst_case_bokeh_radius
+                    .compute_at(final, y)
+                    .vectorize(x, 8);
+                output.compute_at(final, x)
+                    .vectorize(x);
+                output.update()
+                    .reorder(c, x, s)
+                    .vectorize(x).unroll(c);
+                sample_weight.compute_at(output, x).unroll(x);
+                sample_locations.compute_at(output, x).vectorize(x);
+            }
         }
     }
 private:
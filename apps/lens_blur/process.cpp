@@ -1,8 +1,10 @@
 #include <cstdio>
 #include <chrono>
+#include <algorithm>
 
 #include "lens_blur.h"
 #include "lens_blur_auto_schedule.h"
+#include "lens_blur_layered.h"
 
 #include "halide_benchmark.h"
 #include "HalideBuffer.h"
@@ -46,6 +48,32 @@ int main(int argc, char **argv) {
     });
     printf("Auto-scheduled time: %gms\n", min_t_auto * 1e3);
 
+    // Depth-layered version
+    Buffer<float> scratch(left_im.width(), left_im.height(), 3);
+    double min_t_layered = benchmark(timing_iterations, 10, [&]() {
+        lens_blur_layered(left_im, right_im, slices, focus_depth,
+                          blur_radius_scale, aperture_samples, scratch);
+    });
+    printf("Depth-layered time: %gms\n", min_t_layered * 1e3);
+
+    // The cost of sampling the aperture depends on the number of
+    // samples, and the cost of the layered version on the aperture
+    // radius. Compare them over a range of radii.
+    printf("Time against aperture radius:\n"
+           "  radius  manually-tuned  depth-layered\n");
+    for (float scale : {0.125f, 0.25f, 0.5f, 1.0f}) {
+        int radius = (int)(std::max((int)slices - (int)focus_depth, (int)focus_depth) * scale);
+        double t_manual = benchmark(timing_iterations, 1, [&]() {
+            lens_blur(left_im, right_im, slices, focus_depth, scale,
+                      aperture_samples, scratch);
+        });
+        double t_layered = benchmark(timing_iterations, 1, [&]() {
+            lens_blur_layered(left_im, right_im, slices, focus_depth, scale,
+                              aperture_samples, scratch);
+        });
+        printf("  %6d  %12gms  %11gms\n", radius, t_manual * 1e3, t_layered * 1e3);
+    }
+
     convert_and_save_image(output, argv[7]);
 
     return 0;
@@ -65,7 +65,7 @@ inline void set_math_flags() {
                   << std::endl;                                         \
     }
 
-#define L3GFLOPS(N) (3.0 + N) * N * N * 1e-3 / elapsed
+#define L3GFLOPS(N) (3.0 + 2.0 * N) * N * N * 1e-3 / elapsed
 #define L3Benchmark(benchmark, type, code)                              \
     virtual void bench_##benchmark(int N) {                             \
         Scalar alpha = random_scalar();                                 \
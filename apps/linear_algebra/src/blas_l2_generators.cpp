@@ -221,9 +221,87 @@ class GERGenerator :
 };
 
 
+// Generator class for batched BLAS gemv operations: many independent
+// products of small matrices and vectors, stacked along the last
+// dimension.
+template<class T>
+class BatchedGEMVGenerator :
+        public Generator<BatchedGEMVGenerator<T>> {
+  public:
+    typedef Generator<BatchedGEMVGenerator<T>> Base;
+    using Base::target;
+    using Base::get_target;
+    using Base::natural_vector_size;
+    template<typename T2> using Input = typename Base::template Input<T2>;
+    template<typename T2> using Output = typename Base::template Output<T2>;
+
+    GeneratorParam<bool> transpose_ = {"transpose", false};
+
+    // Standard ordering of parameters in GEMV functions.
+    Input<T>         a_ = {"a", 1};
+    Input<Buffer<T>> A_ = {"A", 3};
+    Input<Buffer<T>> x_ = {"x", 2};
+    Input<T>         b_ = {"b", 1};
+    Input<Buffer<T>> y_ = {"y", 2};
+
+    Output<Buffer<T>> output_ = {"output", 2};
+
+    void generate() {
+        const Expr size = transpose_ ? A_.height() : A_.width();
+        const Expr sum_size = transpose_ ? A_.width() : A_.height();
+        const Expr batch_size = y_.dim(1).extent();
+
+        const int vec = natural_vector_size(a_.type());
+
+        Var i("i"), j("j"), n("n"), ii("ii");
+
+        Func A("A");
+        if (transpose_) {
+            A(i, j, n) = A_(j, i, n);
+        } else {
+            A(i, j, n) = A_(i, j, n);
+        }
+
+        Func Ax("Ax");
+        RDom k(0, sum_size, "k");
+        Ax(i, n) += A(i, k, n) * x_(k, n);
+
+        output_(i, n) = a_ * Ax(i, n) + b_ * y_(i, n);
+
+        output_.split(i, i, ii, vec, TailStrategy::GuardWithIf).vectorize(ii);
+
+        // Parallelize across the batch, grouping enough products into
+        // each task to amortize the cost of launching it.
+        Expr work = max(1, size * sum_size);
+        Expr products_per_task = max(1, (1 << 16) / work);
+        output_.parallel(n, products_per_task, TailStrategy::GuardWithIf);
+
+        // In the transposed case the vectorized loads of A are
+        // strided. For matrices this small that is cheaper than
+        // reducing across vector lanes.
+        Ax.compute_at(output_, i)
+            .vectorize(i, vec, TailStrategy::GuardWithIf)
+            .update()
+            .reorder(i, k)
+            .vectorize(i, vec, TailStrategy::GuardWithIf)
+            .unroll(k, 4, TailStrategy::GuardWithIf);
+
+        for (int s : {4, 8, 16, 32, 64}) {
+            output_.specialize(size == s && sum_size == s);
+        }
+
+        A_.dim(0).set_min(0).dim(1).set_min(0).dim(2).set_bounds(0, batch_size);
+        x_.dim(0).set_bounds(0, sum_size).dim(1).set_bounds(0, batch_size);
+        y_.dim(0).set_bounds(0, size).dim(1).set_min(0);
+        output_.dim(0).set_bounds(0, size).dim(1).set_bounds(0, batch_size);
+    }
+};
+
 }  // namespace
 
 HALIDE_REGISTER_GENERATOR(GEMVGenerator<float>, sgemv)
 HALIDE_REGISTER_GENERATOR(GEMVGenerator<double>, dgemv)
 HALIDE_REGISTER_GENERATOR(GERGenerator<float>, sger)
 HALIDE_REGISTER_GENERATOR(GERGenerator<double>, dger)
+HALIDE_REGISTER_GENERATOR(BatchedGEMVGenerator<float>, sgemv_batched)
+HALIDE_REGISTER_GENERATOR(BatchedGEMVGenerator<double>, dgemv_batched)
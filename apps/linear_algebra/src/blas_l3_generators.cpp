@@ -29,6 +29,25 @@ class GEMMGenerator :
 
     Output<Buffer<T>> result_ = {"result", 2};
 
+    // The number of columns of the result in each register-blocked
+    // micro-kernel. Each micro-kernel accumulates a (2 vectors) x
+    // (this many columns) tile of the result, which should fill most
+    // of the vector register file without spilling.
+    int micro_kernel_columns() {
+        const Target t = get_target();
+        if (t.arch == Target::X86) {
+            // 16 registers. With AVX, 12 accumulators, two vectors of A
+            // and a broadcast of B. Without it, stay well clear of
+            // spilling, as SSE has no separate destination operand.
+            return t.has_feature(Target::AVX) ? 6 : 4;
+        } else if (t.arch == Target::ARM && t.bits == 64) {
+            // 32 registers.
+            return 8;
+        } else {
+            return 4;
+        }
+    }
+
     void generate() {
         // Matrices are interpreted as column-major by default. The
         // transpose GeneratorParams are used to handle cases where
@@ -37,8 +56,18 @@ class GEMMGenerator :
         const Expr num_cols = B_.height();
         const Expr sum_size = A_.height();
 
+        // The micro-kernel computes an mr x nr tile of A*B.
         const int vec = natural_vector_size(a_.type());
-        const int s = vec * 2;
+        const int mr = vec * 2;
+        const int nr = micro_kernel_columns();
+
+        // The number of micro-kernels along each side of the blocks
+        // of the result that are distributed across threads. Within a
+        // block, the micro-kernels walk down a column of the block
+        // first, so that the packed panel of B each one reads stays in
+        // L1 while the packed panels of A stream through L2.
+        const int block_m = 8;
+        const int block_n = 4;
 
         Input<Buffer<T>> *A_in = &A_;
         Input<Buffer<T>> *B_in = &B_;
@@ -51,29 +80,37 @@ class GEMMGenerator :
             std::swap(A_in, B_in);
         }
 
-        Var i, j, ii, ji, jii, iii, io, jo, t;
-        Var ti[3], tj[3];
+        Var i("i"), j("j"), k("k"), io("io"), jo("jo"), ii("ii"), ji("ji"), t("t");
+        Var ti("ti"), tj("tj"), ko("ko"), ki("ki");
 
-        // Swizzle A for better memory order in the inner loop.
-        Func A("A"), B("B"), Btmp("Btmp"), As("As"), Atmp("Atmp");
+        // Pack A into panels of mr rows, so that the micro-kernel
+        // reads A contiguously along k. The panels are padded with
+        // zeros to a whole number of rows.
+        Func A("A"), As("As"), Atmp("Atmp");
         Atmp(i, j) = BoundaryConditions::constant_exterior(*A_in, cast<T>(0))(i, j);
 
         if (transpose_A) {
-            As(i, j, io) = Atmp(j, io*s + i);
+            As(i, k, io) = Atmp(k, io*mr + i);
         } else {
-            As(i, j, io) = Atmp(io*s + i, j);
+            As(i, k, io) = Atmp(io*mr + i, k);
         }
 
-        A(i, j) = As(i % s, j, i / s);
+        A(i, k) = As(i % mr, k, i / mr);
+
+        // Pack B into panels of nr columns in the same way, so that
+        // the nr values of B the micro-kernel broadcasts at each k are
+        // adjacent.
+        Func B("B"), Bs("Bs"), Btmp("Btmp");
+        Btmp(i, j) = BoundaryConditions::constant_exterior(*B_in, cast<T>(0))(i, j);
 
-        Btmp(i, j) = (*B_in)(i, j);
         if (transpose_B) {
-            B(i, j) = Btmp(j, i);
+            Bs(j, k, jo) = Btmp(jo*nr + j, k);
         } else {
-            B(i, j) = Btmp(i, j);
+            Bs(j, k, jo) = Btmp(k, jo*nr + j);
         }
 
-        Var k("k");
+        B(k, j) = Bs(j % nr, k, j / nr);
+
         Func prod;
         // Express all the products we need to do a matrix multiply as a 3D Func.
         prod(k, i, j) = A(i, k) * B(k, j);
@@ -94,60 +131,60 @@ class GEMMGenerator :
         // Do the part that makes it a 'general' matrix multiply.
         result_(i, j) = (a_ * ABt(i, j) + b_ * C_(i, j));
 
-        result_.tile(i, j, ti[1], tj[1], i, j, 2*s, 2*s, TailStrategy::GuardWithIf);
+        // Tile the result into micro-kernels, and the micro-kernels
+        // into blocks. The micro-kernel loop that walks down a column
+        // of a block is the innermost one, which is i, or j when the
+        // result is transposed.
+        Var micro = transpose_AB ? j : i;
         if (transpose_AB) {
             result_
-                .tile(i, j, ii, ji, 4, s)
-                .tile(i, j, ti[0], tj[0], i, j, s/4, 1);
-
+                .tile(i, j, ii, ji, nr, mr, TailStrategy::GuardWithIf)
+                .tile(i, j, ti, tj, i, j, block_n, block_m, TailStrategy::GuardWithIf)
+                .reorder(ii, ji, j, i, ti, tj);
         } else {
             result_
-                .tile(i, j, ii, ji, s, 4)
-                .tile(i, j, ti[0], tj[0], i, j, 1, s/4);
+                .tile(i, j, ii, ji, mr, nr, TailStrategy::GuardWithIf)
+                .tile(i, j, ti, tj, i, j, block_m, block_n, TailStrategy::GuardWithIf);
         }
 
-        // If we have enough work per task, parallelize over these tiles.
-        result_.specialize(num_rows >= 512 && num_cols >= 512)
-            .fuse(tj[1], ti[1], t).parallel(t);
-
-        // Otherwise tile one more time before parallelizing, or don't
-        // parallelize at all.
+        // Distribute the blocks across threads if there are enough
+        // of them.
         result_.specialize(num_rows >= 128 && num_cols >= 128)
-            .tile(ti[1], tj[1], ti[2], tj[2], ti[1], tj[1], 2, 2)
-            .fuse(tj[2], ti[2], t).parallel(t);
-
-        result_.rename(tj[0], t);
+            .fuse(ti, tj, t).parallel(t);
 
         result_.bound(i, 0, num_rows).bound(j, 0, num_cols);
 
+        // The packing stages touch each element of A and B once, and
+        // are parallelized over panels when the matrices are large.
         As.compute_root()
-            .split(j, jo, ji, s).reorder(i, ji, io, jo)
-            .unroll(i).vectorize(ji)
-            .specialize(A_.width() >= 256 && A_.height() >= 256).parallel(jo, 4);
+            .split(k, ko, ki, mr).reorder(i, ki, io, ko)
+            .unroll(i).vectorize(ki)
+            .specialize(A_.width() >= 256 && A_.height() >= 256).parallel(ko, 4);
 
         Atmp.compute_at(As, io)
             .vectorize(i).unroll(j);
 
-        if (transpose_B) {
-            B.compute_at(result_, t)
-                .tile(i, j, ii, ji, 8, 8)
-                .vectorize(ii).unroll(ji);
-            Btmp.reorder_storage(j, i)
-                .compute_at(B, i)
-                .vectorize(i)
-                .unroll(j);
+        Bs.compute_root()
+            .bound(j, 0, nr).unroll(j);
+        if (!transpose_B) {
+            // Columns of B are dense along k, so vectorize the loads
+            // along k. Otherwise the unrolled loads along j are the
+            // dense ones already.
+            Bs.split(k, ko, ki, vec).reorder(ki, j, ko, jo).vectorize(ki);
         }
+        Bs.specialize(num_cols >= 256 && sum_size >= 256).parallel(jo);
 
-
-        AB.compute_at(result_, i)
-            .bound_extent(j, 4).unroll(j)
-            .bound_extent(i, s).vectorize(i)
+        // The micro-kernel. The accumulators are the mr x nr tile of
+        // AB, which stays in registers for the whole reduction.
+        AB.compute_at(result_, micro)
+            .bound_extent(i, mr).vectorize(i)
+            .bound_extent(j, nr).unroll(j)
             .update()
-            .reorder(i, j, rv).unroll(j).unroll(rv, 2).vectorize(i);
+            .reorder(i, j, rv).vectorize(i).unroll(j).unroll(rv, 2);
         if (transpose_AB) {
-            ABt.compute_at(result_, i)
-                .bound_extent(i, 4).unroll(i)
-                .bound_extent(j, s).vectorize(j);
+            ABt.compute_at(result_, micro)
+                .bound_extent(i, nr).unroll(i)
+                .bound_extent(j, mr).vectorize(j);
         }
 
         A_.dim(0).set_min(0).dim(1).set_min(0);
@@ -158,7 +195,100 @@ class GEMMGenerator :
     }
 };
 
+// Generator class for batched BLAS gemm operations: many independent
+// multiplies of small matrices, stacked along the third dimension.
+template<class T>
+class BatchedGEMMGenerator :
+        public Generator<BatchedGEMMGenerator<T>> {
+  public:
+    typedef Generator<BatchedGEMMGenerator<T>> Base;
+    using Base::target;
+    using Base::get_target;
+    using Base::natural_vector_size;
+    template<typename T2> using Input = typename Base::template Input<T2>;
+    template<typename T2> using Output = typename Base::template Output<T2>;
+
+    GeneratorParam<bool> transpose_A_ = {"transpose_A", false};
+    GeneratorParam<bool> transpose_B_ = {"transpose_B", false};
+
+    // Standard ordering of parameters in GEMM functions.
+    Input<T>         a_ = {"a_", 1};
+    Input<Buffer<T>> A_ = {"A_", 3};
+    Input<Buffer<T>> B_ = {"B_", 3};
+    Input<T>         b_ = {"b_", 1};
+    Input<Buffer<T>> C_ = {"C_", 3};
+
+    Output<Buffer<T>> result_ = {"result", 3};
+
+    void generate() {
+        const Expr num_rows = transpose_A_ ? A_.height() : A_.width();
+        const Expr num_cols = transpose_B_ ? B_.width() : B_.height();
+        const Expr sum_size = transpose_A_ ? A_.width() : A_.height();
+        const Expr batch_size = C_.dim(2).extent();
+
+        const int vec = natural_vector_size(a_.type());
+        const int nr = 4;
+
+        Var i("i"), j("j"), k("k"), n("n"), ii("ii"), ji("ji");
+
+        Func A("A"), B("B");
+        if (transpose_A_) {
+            A(i, k, n) = A_(k, i, n);
+        } else {
+            A(i, k, n) = A_(i, k, n);
+        }
+        if (transpose_B_) {
+            B(k, j, n) = B_(j, k, n);
+        } else {
+            B(k, j, n) = B_(k, j, n);
+        }
+
+        Func AB("AB");
+        RDom rv(0, sum_size);
+        AB(i, j, n) += A(i, rv, n) * B(rv, j, n);
+
+        result_(i, j, n) = a_ * AB(i, j, n) + b_ * C_(i, j, n);
+
+        // Each matrix is computed in vec x nr tiles, accumulated in
+        // registers. The matrices are small, so the tails are guarded
+        // rather than padded.
+        result_
+            .tile(i, j, ii, ji, vec, nr, TailStrategy::GuardWithIf)
+            .vectorize(ii).unroll(ji);
+
+        // Parallelize across the batch, grouping enough matrices into
+        // each task to amortize the cost of launching it.
+        Expr work = max(1, num_rows * num_cols * sum_size);
+        Expr matrices_per_task = max(1, (1 << 16) / work);
+        result_.parallel(n, matrices_per_task, TailStrategy::GuardWithIf);
+
+        AB.compute_at(result_, i)
+            .vectorize(i, vec, TailStrategy::GuardWithIf)
+            .unroll(j, nr, TailStrategy::GuardWithIf)
+            .update()
+            .reorder(i, j, rv)
+            .vectorize(i, vec, TailStrategy::GuardWithIf)
+            .unroll(j, nr, TailStrategy::GuardWithIf);
+
+        // Compile fast paths for common square sizes, where all the
+        // loop bounds are known, the tail guards vanish, and the
+        // task size is a constant.
+        for (int size : {4, 8, 16, 32, 64}) {
+            result_.specialize(num_rows == size && num_cols == size && sum_size == size);
+        }
+
+        A_.dim(0).set_min(0).dim(1).set_min(0).dim(2).set_bounds(0, batch_size);
+        B_.dim(0).set_min(0).dim(1).set_min(0).dim(2).set_bounds(0, batch_size);
+        C_.dim(0).set_bounds(0, num_rows).dim(1).set_bounds(0, num_cols).dim(2).set_min(0);
+        result_.dim(0).set_bounds(0, num_rows)
+            .dim(1).set_bounds(0, num_cols)
+            .dim(2).set_bounds(0, batch_size);
+    }
+};
+
 }  // namespace
 
 HALIDE_REGISTER_GENERATOR(GEMMGenerator<float>, sgemm)
 HALIDE_REGISTER_GENERATOR(GEMMGenerator<double>, dgemm)
+HALIDE_REGISTER_GENERATOR(BatchedGEMMGenerator<float>, sgemm_batched)
+HALIDE_REGISTER_GENERATOR(BatchedGEMMGenerator<double>, dgemm_batched)
@@ -1,3 +1,4 @@
+#include <stdint.h>
 #include <string.h>
 #include <iostream>
 #include "halide_blas.h"
@@ -29,6 +30,73 @@ Buffer<T> init_matrix_buffer(const int M, const int N, T *A, const int lda) {
     return Buffer<T>(A, 2, shape);
 }
 
+template<typename T>
+Buffer<T> init_vector_batch_buffer(const int N, T *x, const int incx,
+                                   const int stride, const int count) {
+    halide_dimension_t shape[] = {{0, N, incx}, {0, count, stride}};
+    return Buffer<T>(x, 2, shape);
+}
+
+template<typename T>
+Buffer<T> init_matrix_batch_buffer(const int M, const int N, T *A, const int lda,
+                                   const int stride, const int count) {
+    halide_dimension_t shape[] = {{0, M, 1}, {0, N, lda}, {0, count, stride}};
+    return Buffer<T>(A, 3, shape);
+}
+
+bool is_transposed(const enum HBLAS_TRANSPOSE trans) {
+    return trans == HblasTrans || trans == HblasConjTrans;
+}
+
+// The pointer-array batched routines hand each run of consecutive
+// entries whose pointers are equally spaced in all three arrays to the
+// strided kernels in one call. Arrays allocated in one block are a
+// single run.
+template<typename T, typename F>
+void for_each_strided_run(const T *const *A, const T *const *B, const T *const *C,
+                          const int batch_count, F f) {
+    const T *const *ptrs[] = {A, B, C};
+
+    // The distance in elements of entry e from entry start in array
+    // p, if it is a whole number of elements that fits in an int.
+    auto offset = [&](int p, int start, int e, int *result) {
+        intptr_t bytes = (intptr_t)ptrs[p][e] - (intptr_t)ptrs[p][start];
+        if (bytes % (intptr_t)sizeof(T) != 0) {
+            return false;
+        }
+        intptr_t elems = bytes / (intptr_t)sizeof(T);
+        if (elems != (intptr_t)(int)elems) {
+            return false;
+        }
+        *result = (int)elems;
+        return true;
+    };
+
+    int start = 0;
+    while (start < batch_count) {
+        int stride[3] = {0, 0, 0};
+        int end = start + 1;
+        if (end < batch_count &&
+            offset(0, start, end, &stride[0]) &&
+            offset(1, start, end, &stride[1]) &&
+            offset(2, start, end, &stride[2])) {
+            for (end++; end < batch_count; end++) {
+                bool continues = true;
+                for (int p = 0; p < 3 && continues; p++) {
+                    int o;
+                    continues = (offset(p, start, end, &o) &&
+                                 (int64_t)o == (int64_t)stride[p] * (end - start));
+                }
+                if (!continues) {
+                    break;
+                }
+            }
+        }
+        f(start, end - start, stride);
+        start = end;
+    }
+}
+
 }
 
 #ifdef __cplusplus
@@ -191,6 +259,58 @@ void hblas_dgemv(const enum HBLAS_ORDER Order, const enum HBLAS_TRANSPOSE trans,
     assert_no_error(halide_dgemv(t, a, buff_A, buff_x, b, buff_y));
 }
 
+///////////////////
+// batched gemv  //
+///////////////////
+
+void hblas_sgemv_batch_strided(const enum HBLAS_ORDER Order, const enum HBLAS_TRANSPOSE trans,
+                               const int M, const int N, const float a, const float *A, const int lda,
+                               const int strideA, const float *x, const int incx, const int stridex,
+                               const float b, float *y, const int incy, const int stridey,
+                               const int batch_count) {
+    bool t = is_transposed(trans);
+
+    auto buff_A = init_matrix_batch_buffer(M, N, const_cast<float*>(A), lda, strideA, batch_count);
+    auto buff_x = init_vector_batch_buffer(t ? M : N, const_cast<float*>(x), incx, stridex, batch_count);
+    auto buff_y = init_vector_batch_buffer(t ? N : M, y, incy, stridey, batch_count);
+
+    assert_no_error(halide_sgemv_batched(t, a, buff_A, buff_x, b, buff_y));
+}
+
+void hblas_sgemv_batch(const enum HBLAS_ORDER Order, const enum HBLAS_TRANSPOSE trans,
+                       const int M, const int N, const float a, const float *const *A, const int lda,
+                       const float *const *x, const int incx, const float b, float *const *y,
+                       const int incy, const int batch_count) {
+    for_each_strided_run(A, x, y, batch_count, [&](int start, int count, const int *stride) {
+        hblas_sgemv_batch_strided(Order, trans, M, N, a, A[start], lda, stride[0],
+                                  x[start], incx, stride[1], b, y[start], incy, stride[2], count);
+    });
+}
+
+void hblas_dgemv_batch_strided(const enum HBLAS_ORDER Order, const enum HBLAS_TRANSPOSE trans,
+                               const int M, const int N, const double a, const double *A, const int lda,
+                               const int strideA, const double *x, const int incx, const int stridex,
+                               const double b, double *y, const int incy, const int stridey,
+                               const int batch_count) {
+    bool t = is_transposed(trans);
+
+    auto buff_A = init_matrix_batch_buffer(M, N, const_cast<double*>(A), lda, strideA, batch_count);
+    auto buff_x = init_vector_batch_buffer(t ? M : N, const_cast<double*>(x), incx, stridex, batch_count);
+    auto buff_y = init_vector_batch_buffer(t ? N : M, y, incy, stridey, batch_count);
+
+    assert_no_error(halide_dgemv_batched(t, a, buff_A, buff_x, b, buff_y));
+}
+
+void hblas_dgemv_batch(const enum HBLAS_ORDER Order, const enum HBLAS_TRANSPOSE trans,
+                       const int M, const int N, const double a, const double *const *A, const int lda,
+                       const double *const *x, const int incx, const double b, double *const *y,
+                       const int incy, const int batch_count) {
+    for_each_strided_run(A, x, y, batch_count, [&](int start, int count, const int *stride) {
+        hblas_dgemv_batch_strided(Order, trans, M, N, a, A[start], lda, stride[0],
+                                  x[start], incx, stride[1], b, y[start], incy, stride[2], count);
+    });
+}
+
 //////////
 // ger  //
 //////////
@@ -280,6 +400,65 @@ void hblas_dgemm(const enum HBLAS_ORDER Order, const enum HBLAS_TRANSPOSE TransA
 }
 
 
+///////////////////
+// batched gemm  //
+///////////////////
+
+void hblas_sgemm_batch_strided(const enum HBLAS_ORDER Order, const enum HBLAS_TRANSPOSE TransA,
+                               const enum HBLAS_TRANSPOSE TransB, const int M, const int N,
+                               const int K, const float alpha, const float *A,
+                               const int lda, const int strideA, const float *B,
+                               const int ldb, const int strideB, const float beta,
+                               float *C, const int ldc, const int strideC, const int batch_count) {
+    bool tA = is_transposed(TransA), tB = is_transposed(TransB);
+
+    auto buff_A = init_matrix_batch_buffer(tA ? K : M, tA ? M : K, const_cast<float*>(A), lda, strideA, batch_count);
+    auto buff_B = init_matrix_batch_buffer(tB ? N : K, tB ? K : N, const_cast<float*>(B), ldb, strideB, batch_count);
+    auto buff_C = init_matrix_batch_buffer(M, N, C, ldc, strideC, batch_count);
+
+    assert_no_error(halide_sgemm_batched(tA, tB, alpha, buff_A, buff_B, beta, buff_C));
+}
+
+void hblas_sgemm_batch(const enum HBLAS_ORDER Order, const enum HBLAS_TRANSPOSE TransA,
+                       const enum HBLAS_TRANSPOSE TransB, const int M, const int N,
+                       const int K, const float alpha, const float *const *A,
+                       const int lda, const float *const *B, const int ldb,
+                       const float beta, float *const *C, const int ldc, const int batch_count) {
+    for_each_strided_run(A, B, C, batch_count, [&](int start, int count, const int *stride) {
+        hblas_sgemm_batch_strided(Order, TransA, TransB, M, N, K, alpha,
+                                  A[start], lda, stride[0], B[start], ldb, stride[1],
+                                  beta, C[start], ldc, stride[2], count);
+    });
+}
+
+void hblas_dgemm_batch_strided(const enum HBLAS_ORDER Order, const enum HBLAS_TRANSPOSE TransA,
+                               const enum HBLAS_TRANSPOSE TransB, const int M, const int N,
+                               const int K, const double alpha, const double *A,
+                               const int lda, const int strideA, const double *B,
+                               const int ldb, const int strideB, const double beta,
+                               double *C, const int ldc, const int strideC, const int batch_count) {
+    bool tA = is_transposed(TransA), tB = is_transposed(TransB);
+
+    auto buff_A = init_matrix_batch_buffer(tA ? K : M, tA ? M : K, const_cast<double*>(A), lda, strideA, batch_count);
+    auto buff_B = init_matrix_batch_buffer(tB ? N : K, tB ? K : N, const_cast<double*>(B), ldb, strideB, batch_count);
+    auto buff_C = init_matrix_batch_buffer(M, N, C, ldc, strideC, batch_count);
+
+    assert_no_error(halide_dgemm_batched(tA, tB, alpha, buff_A, buff_B, beta, buff_C));
+}
+
+void hblas_dgemm_batch(const enum HBLAS_ORDER Order, const enum HBLAS_TRANSPOSE TransA,
+                       const enum HBLAS_TRANSPOSE TransB, const int M, const int N,
+                       const int K, const double alpha, const double *const *A,
+                       const int lda, const double *const *B, const int ldb,
+                       const double beta, double *const *C, const int ldc, const int batch_count) {
+    for_each_strided_run(A, B, C, batch_count, [&](int start, int count, const int *stride) {
+        hblas_dgemm_batch_strided(Order, TransA, TransB, M, N, K, alpha,
+                                  A[start], lda, stride[0], B[start], ldb, stride[1],
+                                  beta, C[start], ldc, stride[2], count);
+    });
+}
+
+
 #ifdef __cplusplus
 }
 #endif
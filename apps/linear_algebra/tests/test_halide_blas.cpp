@@ -112,6 +112,47 @@
     }
 
 
+// The batched tests multiply N small matrices stored one after the
+// other. hblas_code can pass them as one strided block, through A, B
+// and C, or as arrays of pointers, through As, Bs and Cs. The arrays
+// swap each pair of neighbours, which splits the batch into many
+// strided runs.
+#define L3_BATCH_TEST(method, cblas_code, hblas_code)                   \
+    bool test_##method(int N) {                                         \
+        const int M = 8;                                                \
+        Scalar alpha = random_scalar();                                 \
+        Scalar beta = random_scalar();                                  \
+        Vector eA(random_vector(M * M * N));                            \
+        Vector eB(random_vector(M * M * N));                            \
+        Vector eC(random_vector(M * M * N));                            \
+        Vector aA(eA), aB(eB), aC(eC);                                  \
+                                                                        \
+        for (int i = 0; i < N; i++) {                                   \
+            Scalar *A = &(eA[i * M * M]);                               \
+            Scalar *B = &(eB[i * M * M]);                               \
+            Scalar *C = &(eC[i * M * M]);                               \
+            cblas_code;                                                 \
+        }                                                               \
+                                                                        \
+        {                                                               \
+            std::vector<const Scalar *> As(N), Bs(N);                   \
+            std::vector<Scalar *> Cs(N);                                \
+            for (int i = 0; i < N; i++) {                               \
+                int j = (i ^ 1) < N ? (i ^ 1) : i;                      \
+                As[i] = &(aA[j * M * M]);                               \
+                Bs[i] = &(aB[j * M * M]);                               \
+                Cs[i] = &(aC[j * M * M]);                               \
+            }                                                           \
+            Scalar *A = &(aA[0]);                                       \
+            Scalar *B = &(aB[0]);                                       \
+            Scalar *C = &(aC[0]);                                       \
+            (void)A; (void)B; (void)C;                                  \
+            hblas_code;                                                 \
+        }                                                               \
+                                                                        \
+        return compareVectors(M * M * N, eC, aC);                       \
+    }
+
 template<class T>
 struct BLASTestBase {
     typedef T Scalar;
@@ -210,6 +251,9 @@ struct BLASFloatTests : public BLASTestBase<float> {
         RUN_TEST(sgemm_transA);
         RUN_TEST(sgemm_transB);
         RUN_TEST(sgemm_transAB);
+        RUN_TEST(sgemm_batch_strided);
+        RUN_TEST(sgemm_batch_transA);
+        RUN_TEST(sgemv_batch);
     }
 
     L1_VECTOR_TEST(scopy, scopy(N, x, 1, y, 1))
@@ -241,6 +285,20 @@ struct BLASFloatTests : public BLASTestBase<float> {
     L3_TEST(sgemm_transAB,
             cblas_sgemm(CblasColMajor, CblasTrans, CblasTrans, N, N, N, alpha, A, N, B, N, beta, C, N),
             hblas_sgemm(HblasColMajor, HblasTrans, HblasTrans, N, N, N, alpha, A, N, B, N, beta, C, N));
+
+    L3_BATCH_TEST(sgemm_batch_strided,
+                  cblas_sgemm(CblasColMajor, CblasNoTrans, CblasNoTrans, M, M, M, alpha, A, M, B, M, beta, C, M),
+                  hblas_sgemm_batch_strided(HblasColMajor, HblasNoTrans, HblasNoTrans, M, M, M, alpha,
+                                            A, M, M * M, B, M, M * M, beta, C, M, M * M, N));
+    L3_BATCH_TEST(sgemm_batch_transA,
+                  cblas_sgemm(CblasColMajor, CblasTrans, CblasNoTrans, M, M, M, alpha, A, M, B, M, beta, C, M),
+                  hblas_sgemm_batch(HblasColMajor, HblasTrans, HblasNoTrans, M, M, M, alpha,
+                                    As.data(), M, Bs.data(), M, beta, Cs.data(), M, N));
+    // Uses the first column of each B as x, and of each C as y.
+    L3_BATCH_TEST(sgemv_batch,
+                  cblas_sgemv(CblasColMajor, CblasNoTrans, M, M, alpha, A, M, B, 1, beta, C, 1),
+                  hblas_sgemv_batch(HblasColMajor, HblasNoTrans, M, M, alpha,
+                                    As.data(), M, Bs.data(), 1, beta, Cs.data(), 1, N));
 };
 
 struct BLASDoubleTests : public BLASTestBase<double> {
@@ -257,6 +315,9 @@ struct BLASDoubleTests : public BLASTestBase<double> {
         RUN_TEST(dgemm_transA);
         RUN_TEST(dgemm_transB);
         RUN_TEST(dgemm_transAB);
+        RUN_TEST(dgemm_batch_strided);
+        RUN_TEST(dgemm_batch_transA);
+        RUN_TEST(dgemv_batch);
     }
 
     L1_VECTOR_TEST(dcopy, dcopy(N, x, 1, y, 1))
@@ -288,6 +349,20 @@ struct BLASDoubleTests : public BLASTestBase<double> {
     L3_TEST(dgemm_transAB,
             cblas_dgemm(CblasColMajor, CblasTrans, CblasTrans, N, N, N, alpha, A, N, B, N, beta, C, N),
             hblas_dgemm(HblasColMajor, HblasTrans, HblasTrans, N, N, N, alpha, A, N, B, N, beta, C, N));
+
+    L3_BATCH_TEST(dgemm_batch_strided,
+                  cblas_dgemm(CblasColMajor, CblasNoTrans, CblasNoTrans, M, M, M, alpha, A, M, B, M, beta, C, M),
+                  hblas_dgemm_batch_strided(HblasColMajor, HblasNoTrans, HblasNoTrans, M, M, M, alpha,
+                                            A, M, M * M, B, M, M * M, beta, C, M, M * M, N));
+    L3_BATCH_TEST(dgemm_batch_transA,
+                  cblas_dgemm(CblasColMajor, CblasTrans, CblasNoTrans, M, M, M, alpha, A, M, B, M, beta, C, M),
+                  hblas_dgemm_batch(HblasColMajor, HblasTrans, HblasNoTrans, M, M, M, alpha,
+                                    As.data(), M, Bs.data(), M, beta, Cs.data(), M, N));
+    // Uses the first column of each B as x, and of each C as y.
+    L3_BATCH_TEST(dgemv_batch,
+                  cblas_dgemv(CblasColMajor, CblasNoTrans, M, M, alpha, A, M, B, 1, beta, C, 1),
+                  hblas_dgemv_batch(HblasColMajor, HblasNoTrans, M, M, alpha,
+                                    As.data(), M, Bs.data(), 1, beta, Cs.data(), 1, N));
 };
 
 int main(int argc, char *argv[]) {
@@ -9,6 +9,13 @@ public:
     GeneratorParam<bool>    auto_schedule{"auto_schedule", false};
     GeneratorParam<int>     pyramid_levels{"pyramid_levels", 8, 1, maxJ};
 
+    // Compute the fine levels of all the pyramids a tile of the output
+    // at a time, merging them into the output as it goes, instead of
+    // computing each level for the whole image. Only the coarse levels
+    // are stored for the whole image, so peak memory no longer grows
+    // with levels times the image size.
+    GeneratorParam<bool>    fused{"fused", false};
+
     Input<Buffer<uint16_t>> input{"input", 3};
     Input<int>              levels{"levels"};
     Input<float>            alpha{"alpha"};
@@ -20,6 +27,11 @@ public:
         /* THE ALGORITHM */
         const int J = pyramid_levels;
 
+        // The number of pyramid levels, starting from the finest, that
+        // the fused schedule computes per tile.
+        const bool gpu = get_target().has_gpu_feature();
+        const int F = (fused && !auto_schedule) ? std::min(J, gpu ? 2 : 4) : J;
+
         // Make the remapping function as a lookup table.
         Func remap;
         Expr fx = cast<float>(x) / 256.0f;
@@ -43,8 +55,20 @@ public:
         Expr idx = gray(x, y)*cast<float>(levels-1)*256.0f;
         idx = clamp(cast<int>(idx), 0, (levels-1)*256);
         gPyramid[0](x, y, k) = beta*(gray(x, y) - level) + level + remap(idx - 256*k);
+        // The first coarse level is computed for the whole image, so it
+        // can't use the fine levels, which are computed per tile. When
+        // fusing, give it its own copy of them.
+        Func gCoarse[maxJ];
         for (int j = 1; j < J; j++) {
-            gPyramid[j](x, y, k) = downsample(gPyramid[j-1])(x, y, k);
+            Func finer = gPyramid[j-1];
+            if (j == F) {
+                finer = gPyramid[0];
+                for (int i = 1; i < F; i++) {
+                    gCoarse[i](x, y, k) = downsample(finer)(x, y, k);
+                    finer = gCoarse[i];
+                }
+            }
+            gPyramid[j](x, y, k) = downsample(finer)(x, y, k);
         }
 
         // Get its laplacian pyramid
@@ -57,8 +81,17 @@ public:
         // Make the Gaussian pyramid of the input
         Func inGPyramid[maxJ];
         inGPyramid[0](x, y) = gray(x, y);
+        Func inCoarse[maxJ];
         for (int j = 1; j < J; j++) {
-            inGPyramid[j](x, y) = downsample(inGPyramid[j-1])(x, y);
+            Func finer = inGPyramid[j-1];
+            if (j == F) {
+                finer = inGPyramid[0];
+                for (int i = 1; i < F; i++) {
+                    inCoarse[i](x, y) = downsample(finer)(x, y);
+                    finer = inCoarse[i];
+                }
+            }
+            inGPyramid[j](x, y) = downsample(finer)(x, y);
         }
 
         // Make the laplacian pyramid of the output
@@ -105,7 +138,70 @@ public:
             // Auto schedule the pipeline: this calls auto_schedule() for
             // all of the Outputs in this Generator
             auto_schedule_outputs();
-        } else if (get_target().has_gpu_feature()) {
+        } else if (fused && gpu) {
+            // Compute the second level per block of the output, in
+            // shared memory. The full-resolution level is inlined.
+            remap.compute_root();
+            Var xi, yi;
+            output.compute_root()
+                .reorder(c, x, y).bound(c, 0, 3).unroll(c)
+                .gpu_tile(x, y, xi, yi, 32, 16);
+            for (int j = 1; j < F; j++) {
+                inGPyramid[j].compute_at(output, x).gpu_threads(x, y);
+                gPyramid[j].compute_at(output, x).reorder(k, x, y).gpu_threads(x, y);
+                outGPyramid[j].compute_at(output, x).gpu_threads(x, y);
+                if (F < J) {
+                    inCoarse[j].compute_at(inGPyramid[F], x).gpu_threads(x, y);
+                    gCoarse[j].compute_at(gPyramid[F], x).reorder(k, x, y).gpu_threads(x, y);
+                }
+            }
+            for (int j = F; j < J; j++) {
+                int blockw = 16, blockh = 8;
+                if (j > 3) {
+                    blockw = 2;
+                    blockh = 2;
+                }
+                inGPyramid[j].compute_root().gpu_tile(x, y, xi, yi, blockw, blockh);
+                gPyramid[j].compute_root().reorder(k, x, y).gpu_tile(x, y, xi, yi, blockw, blockh);
+                outGPyramid[j].compute_root().gpu_tile(x, y, xi, yi, blockw, blockh);
+            }
+        } else if (fused) {
+            // Compute the fine levels per tile of the output. Only the
+            // coarse levels, which are small, are computed for the
+            // whole image.
+            remap.compute_root();
+            Var xo, yo, xi, yi, t;
+            output.reorder(c, x, y)
+                .tile(x, y, xo, yo, xi, yi, 256, 128)
+                .fuse(xo, yo, t).parallel(t)
+                .vectorize(xi, 8);
+            outGPyramid[0].compute_at(output, yi).vectorize(x, 8);
+            for (int j = 1; j < F; j++) {
+                inGPyramid[j]
+                    .compute_at(output, t).vectorize(x, 8);
+                gPyramid[j]
+                    .compute_at(output, t).reorder_storage(x, k, y)
+                    .reorder(x, k, y).vectorize(x, 8);
+                outGPyramid[j]
+                    .compute_at(output, t).vectorize(x, 8);
+                if (F < J) {
+                    inCoarse[j]
+                        .compute_at(inGPyramid[F], y).vectorize(x, 8);
+                    gCoarse[j]
+                        .compute_at(gPyramid[F], y).reorder_storage(x, k, y)
+                        .reorder(x, k, y).vectorize(x, 8);
+                }
+            }
+            for (int j = F; j < J; j++) {
+                inGPyramid[j]
+                    .compute_root().parallel(y, 8).vectorize(x, 8);
+                gPyramid[j]
+                    .compute_root().reorder_storage(x, k, y)
+                    .reorder(k, y).parallel(y, 8).vectorize(x, 8);
+                outGPyramid[j]
+                    .compute_root().parallel(y, 8).vectorize(x, 8);
+            }
+        } else if (gpu) {
             // gpu schedule
             remap.compute_root();
             Var xi, yi;
@@ -3,6 +3,9 @@
 
 #include "local_laplacian.h"
 #include "local_laplacian_auto_schedule.h"
+#include "local_laplacian_fused.h"
+#include "local_laplacian_profile.h"
+#include "local_laplacian_fused_profile.h"
 
 #include "halide_benchmark.h"
 #include "HalideBuffer.h"
@@ -42,6 +45,28 @@ int main(int argc, char **argv) {
     });
     printf("Auto-scheduled time: %gms\n", best_auto * 1e3);
 
+    // Fused version, which computes the fine pyramid levels per tile
+    double best_fused = benchmark(timing, 1, [&]() {
+        local_laplacian_fused(input, levels, alpha/(levels-1), beta, output);
+        output.device_sync();
+    });
+    printf("Fused time: %gms\n", best_fused * 1e3);
+
+    // Report peak heap usage, as measured by the profiler
+    halide_profiler_reset();
+    local_laplacian_profile(input, levels, alpha/(levels-1), beta, output);
+    local_laplacian_fused_profile(input, levels, alpha/(levels-1), beta, output);
+    output.device_sync();
+    halide_profiler_state *state = halide_profiler_get_state();
+    halide_mutex_lock(&state->lock);
+    for (halide_profiler_pipeline_stats *p = state->pipelines; p;
+         p = (halide_profiler_pipeline_stats *)(p->next)) {
+        printf("%s peak heap usage: %.2f MB\n", p->name, p->memory_peak / (1024.0 * 1024.0));
+    }
+    halide_mutex_unlock(&state->lock);
+
+    output.copy_to_host();
+
     convert_and_save_image(output, argv[6]);
 
     return 0;
@@ -8,6 +8,12 @@ class NonLocalMeans : public Halide::Generator<NonLocalMeans> {
 public:
     GeneratorParam<bool>  auto_schedule{"auto_schedule", false};
 
+    // Compute the patch distances from an integral image of the
+    // difference image, computed per tile of the output, instead of
+    // blurring it directly. The cost then doesn't depend on the patch
+    // size. Not supported with the auto scheduler.
+    GeneratorParam<bool>  integral_image{"integral_image", true};
+
     Input<Buffer<float>>  input{"input", 3};
     Input<int>            patch_size{"patch_size"};
     Input<int>            search_area{"search_area"};
@@ -34,17 +40,40 @@ public:
         dc(x, y, dx, dy, c) = pow(clamped(x, y, c) - clamped(x + dx, y + dy, c), 2);
 
         // Sum across color channels
-        RDom channels(0, 3);
         Func d("d");
-        d(x, y, dx, dy) = sum(dc(x, y, dx, dy, channels));
+        d(x, y, dx, dy) = dc(x, y, dx, dy, 0) + dc(x, y, dx, dy, 1) + dc(x, y, dx, dy, 2);
 
-        // Find the patch differences by blurring the difference images
-        RDom patch_dom(-patch_size/2, patch_size);
-        Func blur_d_y("blur_d_y");
-        blur_d_y(x, y, dx, dy) = sum(d(x, y + patch_dom, dx, dy));
+        // The tile size of the output. The integral images are
+        // computed one tile and one offset at a time.
+        const bool gpu = get_target().has_gpu_feature();
+        const int tile_x = gpu ? 16 : 32, tile_y = 16;
 
-        Func blur_d("blur_d");
-        blur_d(x, y, dx, dy) = sum(blur_d_y(x + patch_dom, y, dx, dy));
+        Func blur_d("blur_d"), blur_d_y("blur_d_y"), integral("integral");
+        RDom patch_dom(-patch_size/2, patch_size);
+        RDom ru(1, tile_x + patch_size - 1), rv(1, tile_y + patch_size - 1);
+        Var u("u"), v("v"), t_x("t_x"), t_y("t_y");
+        if (integral_image) {
+            // The integral image of the difference image over output tile
+            // (t_x, t_y), and the pixels around it that its patches touch.
+            // (u, v) = (0, 0) is just outside the first patch.
+            integral(u, v, t_x, t_y, dx, dy) =
+                d(t_x * tile_x + u - patch_size/2 - 1, t_y * tile_y + v - patch_size/2 - 1, dx, dy);
+            integral(ru, v, t_x, t_y, dx, dy) += integral(ru - 1, v, t_x, t_y, dx, dy);
+            integral(u, rv, t_x, t_y, dx, dy) += integral(u, rv - 1, t_x, t_y, dx, dy);
+
+            // Find the patch differences from four taps of the integral image
+            Expr i = x % tile_x, j = y % tile_y;
+            Expr tile_i = x / tile_x, tile_j = y / tile_y;
+            blur_d(x, y, dx, dy) =
+                (integral(i + patch_size, j + patch_size, tile_i, tile_j, dx, dy) -
+                 integral(i, j + patch_size, tile_i, tile_j, dx, dy) -
+                 integral(i + patch_size, j, tile_i, tile_j, dx, dy) +
+                 integral(i, j, tile_i, tile_j, dx, dy));
+        } else {
+            // Find the patch differences by blurring the difference images
+            blur_d_y(x, y, dx, dy) = sum(d(x, y + patch_dom, dx, dy));
+            blur_d(x, y, dx, dy) = sum(blur_d_y(x + patch_dom, y, dx, dy));
+        }
 
         // Compute the weights from the patch differences
         Func w("w");
@@ -74,6 +103,9 @@ public:
 
         Var tx("tx"), ty("ty"), xi("xi"), yi("yi");
 
+        _halide_user_assert(!((bool)auto_schedule && (bool)integral_image))
+            << "Build with integral_image=false to use the auto scheduler\n";
+
         if (auto_schedule) {
             // Provide estimates on the input image
             input.dim(0).set_bounds_estimate(0, 614);
@@ -90,29 +122,61 @@ public:
             // Auto schedule the pipeline: this calls auto_schedule() for
             // all of the Outputs in this Generator
             auto_schedule_outputs();
-        } /*else if (get_target().has_gpu_feature()) {
-            // TODO: the GPU schedule is currently using to much shared memory
-            // because the simplifier can't simplify the expr (it can't cancel
-            // the 'x' term in min(((a + (x + b)) + c) - min(x + d + e))) so
-            // it ends up using the entire image size as the shared memory size.
-            non_local_means.compute_root()
-                .reorder(c, x, y).unroll(c)
-                .gpu_tile(x, y, xi, yi, 16, 8);
-            d.compute_at(non_local_means_sum, s_dom.x)
-                .tile(x, y, xi, yi, 2, 2)
-                .unroll(xi)
-                .unroll(yi)
-                .gpu_threads(x, y);
-            blur_d_y.compute_at(non_local_means_sum, s_dom.x)
-                .unroll(x, 2).gpu_threads(x, y);
-            blur_d.compute_at(non_local_means_sum, s_dom.x)
-                .gpu_threads(x, y);
-            non_local_means_sum.compute_at(non_local_means, x)
-                .gpu_threads(x, y)
-                .update()
-                .reorder(x, y, c, s_dom.x, s_dom.y)
-                .gpu_threads(x, y);
-        }*/ else {
+        } else if (integral_image) {
+            // The tile an output pixel belongs to is part of the
+            // algorithm, so the tiles must start at zero and must not
+            // be shifted inwards at the edges.
+            non_local_means.dim(0).set_min(0).dim(1).set_min(0);
+
+            if (gpu) {
+                // One block per tile. The block loops over the offsets,
+                // and builds the integral image for each one in shared
+                // memory.
+                non_local_means.compute_root()
+                    .reorder(c, x, y).unroll(c)
+                    .gpu_tile(x, y, tx, ty, xi, yi, tile_x, tile_y, TailStrategy::GuardWithIf);
+                non_local_means_sum.compute_at(non_local_means, tx)
+                    .reorder(c, x, y)
+                    .bound(c, 0, 4).unroll(c)
+                    .gpu_threads(x, y);
+                non_local_means_sum.update(0)
+                    .reorder(c, x, y, s_dom.x, s_dom.y)
+                    .unroll(c)
+                    .gpu_threads(x, y);
+                integral.compute_at(non_local_means_sum, s_dom.x)
+                    .gpu_threads(u, v);
+                integral.update(0)
+                    .reorder(v, ru)
+                    .gpu_threads(v);
+                integral.update(1)
+                    .reorder(u, rv)
+                    .gpu_threads(u);
+            } else {
+                non_local_means.compute_root()
+                    .reorder(c, x, y)
+                    .tile(x, y, tx, ty, xi, yi, tile_x, tile_y, TailStrategy::GuardWithIf)
+                    .parallel(ty)
+                    .vectorize(xi, 8);
+                non_local_means_sum.compute_at(non_local_means, tx)
+                    .reorder(c, x, y)
+                    .bound(c, 0, 4).unroll(c)
+                    .vectorize(x, 8);
+                non_local_means_sum.update(0)
+                    .reorder(c, x, y, s_dom.x, s_dom.y)
+                    .unroll(c)
+                    .vectorize(x, 8);
+                // The scan in u is vectorized across rows, and the scan
+                // in v across columns.
+                integral.compute_at(non_local_means_sum, s_dom.x)
+                    .vectorize(u, 8);
+                integral.update(0)
+                    .reorder(v, ru)
+                    .vectorize(v, 8);
+                integral.update(1)
+                    .reorder(u, rv)
+                    .vectorize(u, 8);
+            }
+        } else {
             non_local_means.compute_root()
                 .reorder(c, x, y)
                 .tile(x, y, tx, ty, x, y, 16, 8)
@@ -29,16 +29,23 @@
 #include "resize_cubic_uint16_down.h"
 #include "resize_linear_uint16_down.h"
 #include "resize_lanczos_uint16_down.h"
+#include "resize_box_uint8_down_halved.h"
+#include "resize_cubic_uint8_down_halved.h"
+#include "resize_linear_uint8_down_halved.h"
+#include "resize_lanczos_uint8_down_halved.h"
 
 std::string infile, outfile, input_type, interpolation_type;
 float scale_factor = 1.0f;
+bool multi_stage = false;
 
 void show_usage_and_exit() {
     fprintf(stderr,
             "Usage:\n"
             "\t./resample [-f scalefactor] "
             "[-i box|linear|cubic|lanczos] "
-            "[-t float32|uint8|uint16] in.png out.png\n");
+            "[-t float32|uint8|uint16] [-m] in.png out.png\n"
+            "\t-m halves the input twice before the final resample. It\n"
+            "\t   requires -t uint8 and a scale factor of at most 0.25.\n");
     exit(1);
 }
 
@@ -51,6 +58,8 @@ for (int i = 1; i < argc; i++) {
             interpolation_type = argv[++i];
         } else if (arg == "-t" && i+1 < argc) {
             input_type = argv[++i];
+        } else if (arg == "-m") {
+            multi_stage = true;
         } else if (infile.empty()) {
             infile = arg;
         } else if (outfile.empty()) {
@@ -115,6 +124,12 @@ int main(int argc, char **argv) {
         show_usage_and_exit();
     }
 
+    decltype(&resize_box_float32_up) multi_stage_variants[4] =
+        {&resize_box_uint8_down_halved,
+         &resize_cubic_uint8_down_halved,
+         &resize_linear_uint8_down_halved,
+         &resize_lanczos_uint8_down_halved};
+
     int upsample_idx = scale_factor > 1.0f ? 0 : 1;
 
     // Instead of just adapting to the actual type of the input, we'll
@@ -138,6 +153,17 @@ int main(int argc, char **argv) {
     Halide::Runtime::Buffer<> out(in.type(), out_width, out_height, 3);
 
     auto resize_fn = variants[type_idx][upsample_idx][interpolation_idx];
+    if (multi_stage) {
+        if (type_idx != 1 || scale_factor > 0.25f) {
+            fprintf(stderr, "Multi-stage resizing requires -t uint8 and a scale factor of at most 0.25\n");
+            show_usage_and_exit();
+        }
+        // Also time the single-stage resize, to compare against.
+        double time = Halide::Tools::benchmark(10, 10, [&]() { resize_fn(in, scale_factor, out); });
+        printf("single  %8s  %8s  %1.2f  time: %f ms\n",
+               interpolation_type.c_str(), input_type.c_str(), scale_factor, time * 1000);
+        resize_fn = multi_stage_variants[interpolation_idx];
+    }
 
     double time = Halide::Tools::benchmark(10, 10, [&]() { resize_fn(in, scale_factor, out); });
     printf("planar  %8s  %8s  %1.2f  time: %f ms\n",
@@ -66,6 +66,12 @@ public:
     // resample in x and in y).
     GeneratorParam<bool> upsample{"upsample", false};
 
+    // When downsampling, first halve the input this many times with a
+    // 2x2 box filter, and then resample the smaller image by the
+    // remaining factor. This is much cheaper than a wide kernel on the
+    // full image. The scale factor should be at most 1 / 2^halvings.
+    GeneratorParam<int> halvings{"halvings", 0};
+
     Input<Buffer<>> input{"input", 3};
     Input<float> scale_factor{"scale_factor"};
     Output<Buffer<>> output{"output", 3};
@@ -77,29 +83,63 @@ public:
     Func as_float, clamped, resized_x, resized_y,
         unnormalized_kernel_x, unnormalized_kernel_y,
         kernel_x, kernel_y,
-        kernel_sum_x, kernel_sum_y;
+        kernel_sum_x, kernel_sum_y,
+        fixed_kernel_x, fixed_kernel_y;
+    std::vector<Func> halved;
+
+    // 8-bit images are resampled in fixed point. The kernel weights
+    // have kernel_bits fractional bits, and the result of the first
+    // resample keeps intermediate_bits fractional bits in 16 bits.
+    static const int kernel_bits = 14;
+    static const int intermediate_bits = 6;
+
+    bool use_fixed_point() const {
+        return input.type() == UInt(8);
+    }
 
     void generate() {
+        const int num_halvings = halvings;
+        _halide_user_assert(num_halvings >= 0 && (num_halvings == 0 || !upsample))
+            << "halvings must be non-negative, and can only be used when downsampling\n";
 
         clamped = BoundaryConditions::repeat_edge(input,
                  {{input.dim(0).min(), input.dim(0).extent()},
                   {input.dim(1).min(), input.dim(1).extent()}});
 
+        // Halve the image, rounding to nearest for integer types.
+        Func source = clamped;
+        for (int i = 0; i < num_halvings; i++) {
+            Func h("halved_" + std::to_string(i));
+            if (input.type().is_float()) {
+                h(x, y, c) = (source(2 * x, 2 * y, c) + source(2 * x + 1, 2 * y, c) +
+                              source(2 * x, 2 * y + 1, c) + source(2 * x + 1, 2 * y + 1, c)) * 0.25f;
+            } else {
+                Expr sum = (cast<uint32_t>(source(2 * x, 2 * y, c)) + source(2 * x + 1, 2 * y, c) +
+                            source(2 * x, 2 * y + 1, c) + source(2 * x + 1, 2 * y + 1, c));
+                h(x, y, c) = cast(input.type(), (sum + 2) / 4);
+            }
+            halved.push_back(h);
+            source = h;
+        }
+
         // Handle different types by just casting to float
-        as_float(x, y, c) = cast<float>(clamped(x, y, c));
+        as_float(x, y, c) = cast<float>(source(x, y, c));
+
+        // The scale of the remaining resample.
+        Expr scale = scale_factor * (1 << num_halvings);
 
         // For downscaling, widen the interpolation kernel to perform lowpass
         // filtering.
 
-        Expr kernel_scaling = upsample ? Expr(1.0f) : scale_factor;
+        Expr kernel_scaling = upsample ? Expr(1.0f) : scale;
 
         Expr kernel_radius = 0.5f * kernel_info[interpolation_type].taps / kernel_scaling;
 
         Expr kernel_taps = ceil(kernel_info[interpolation_type].taps / kernel_scaling);
 
         // source[xy] are the (non-integer) coordinates inside the source image
-        Expr sourcex = (x + 0.5f) / scale_factor - 0.5f;
-        Expr sourcey = (y + 0.5f) / scale_factor - 0.5f;
+        Expr sourcex = (x + 0.5f) / scale - 0.5f;
+        Expr sourcey = (y + 0.5f) / scale - 0.5f;
 
         // Initialize interpolation kernels. Since we allow an arbitrary
         // scaling factor, the filter coefficients are different for each x
@@ -119,24 +159,50 @@ public:
         kernel_x(x, k) = unnormalized_kernel_x(x, k) / kernel_sum_x(x);
         kernel_y(y, k) = unnormalized_kernel_y(y, k) / kernel_sum_y(y);
 
+        fixed_kernel_x(x, k) = cast<int16_t>(round(kernel_x(x, k) * (1 << kernel_bits)));
+        fixed_kernel_y(y, k) = cast<int16_t>(round(kernel_y(y, k) * (1 << kernel_bits)));
+
         // Perform separable resizing. The resize in x vectorizes
         // poorly compared to the resize in y, so do it first if we're
         // upsampling, and do it second if we're downsampling.
         Func resized;
-        if (upsample) {
-            resized_x(x, y, c) = sum(kernel_x(x, r) * as_float(r + beginx, y, c));
-            resized_y(x, y, c) = sum(kernel_y(y, r) * resized_x(x, r + beginy, c));
-            resized = resized_y;
+        if (use_fixed_point()) {
+            // Widen to 32 bits to accumulate, and narrow the first
+            // resample to 16 bits with some extra precision.
+            const int first_shift = kernel_bits - intermediate_bits;
+            const int second_shift = kernel_bits + intermediate_bits;
+            if (upsample) {
+                resized_x(x, y, c) =
+                    cast<int16_t>((sum(cast<int32_t>(fixed_kernel_x(x, r)) * source(r + beginx, y, c)) +
+                                   (1 << (first_shift - 1))) >> first_shift);
+                resized_y(x, y, c) =
+                    sum(cast<int32_t>(fixed_kernel_y(y, r)) * resized_x(x, r + beginy, c));
+                resized = resized_y;
+            } else {
+                resized_y(x, y, c) =
+                    cast<int16_t>((sum(cast<int32_t>(fixed_kernel_y(y, r)) * source(x, r + beginy, c)) +
+                                   (1 << (first_shift - 1))) >> first_shift);
+                resized_x(x, y, c) =
+                    sum(cast<int32_t>(fixed_kernel_x(x, r)) * resized_y(r + beginx, y, c));
+                resized = resized_x;
+            }
+            output(x, y, c) = saturating_cast<uint8_t>((resized(x, y, c) + (1 << (second_shift - 1))) >> second_shift);
         } else {
-            resized_y(x, y, c) = sum(kernel_y(y, r) * as_float(x, r + beginy, c));
-            resized_x(x, y, c) = sum(kernel_x(x, r) * resized_y(r + beginx, y, c));
-            resized = resized_x;
-        }
-
-        if (input.type().is_float()) {
-            output(x, y, c) = clamp(resized(x, y, c), 0.0f, 1.0f);
-        } else {
-            output(x, y, c) = saturating_cast(input.type(), resized(x, y, c));
+            if (upsample) {
+                resized_x(x, y, c) = sum(kernel_x(x, r) * as_float(r + beginx, y, c));
+                resized_y(x, y, c) = sum(kernel_y(y, r) * resized_x(x, r + beginy, c));
+                resized = resized_y;
+            } else {
+                resized_y(x, y, c) = sum(kernel_y(y, r) * as_float(x, r + beginy, c));
+                resized_x(x, y, c) = sum(kernel_x(x, r) * resized_y(r + beginx, y, c));
+                resized = resized_x;
+            }
+
+            if (input.type().is_float()) {
+                output(x, y, c) = clamp(resized(x, y, c), 0.0f, 1.0f);
+            } else {
+                output(x, y, c) = saturating_cast(input.type(), resized(x, y, c));
+            }
         }
     }
 
@@ -159,10 +225,23 @@ public:
         kernel_sum_y
             .compute_at(kernel_y, y)
             .vectorize(y);
+        // Both weight tables depend only on the output coordinate, so
+        // compute them once for the whole image.
         kernel_y
-            .compute_at(output, y)
+            .compute_root()
             .reorder(k, y).vectorize(y, 8);
 
+        if (use_fixed_point()) {
+            fixed_kernel_x
+                .compute_root()
+                .reorder(k, x)
+                .vectorize(x, 8);
+            fixed_kernel_y
+                .compute_root()
+                .reorder(k, y)
+                .vectorize(y, 8);
+        }
+
         if (upsample) {
             output
                 .tile(x, y, xi, yi, 16, 64)
@@ -186,6 +265,12 @@ public:
                 .compute_at(output, xi);
         }
 
+        // The halvings are computed a strip of output tiles at a time.
+        for (Func h : halved) {
+            h.compute_at(output, y)
+                .vectorize(x, 8);
+        }
+
         // Allow the input and output to have arbitrary memory layout,
         // and add some specializations for a few common cases. If
         // your case is not covered (e.g. planar input, packed rgb
@@ -0,0 +1,203 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <map>
+#include <string>
+#include <HalideRuntime.h>
+#include "halide_benchmark.h"
+#include "bench_headers.h"
+
+#ifndef __APPLE__
+extern "C" void *memalign(size_t alignment, size_t size);
+#endif
+
+// Runs the vectorized Func of each test in simd_op_check over large
+// buffers, and reports the time it takes per element of the
+// output. If given a baseline file written by an earlier run, it
+// reports the tests that got slower than the baseline by more than a
+// given ratio, and fails if there are any.
+//
+// Usage: benchmark [-w output.txt] [-b baseline.txt] [-r ratio] [-ghz clock]
+//
+// With -ghz, the times are reported in cycles of a clock at that rate
+// instead of in nanoseconds.
+
+struct benchmark_filter {
+    const char *name;
+    int (*fn)(halide_buffer_t *, // float32
+              halide_buffer_t *, // float64
+              halide_buffer_t *, // int8
+              halide_buffer_t *, // uint8
+              halide_buffer_t *, // int16
+              halide_buffer_t *, // uint16
+              halide_buffer_t *, // int32
+              halide_buffer_t *, // uint32
+              halide_buffer_t *, // int64
+              halide_buffer_t *, // uint64
+              halide_buffer_t *); // output
+    const halide_filter_metadata_t *(*metadata)();
+};
+
+#include "benchmarks.h"
+
+// Even on android, we want errors to stdout
+extern "C" void halide_print(void *, const char *msg) {
+    printf("%s\n", msg);
+}
+
+void *aligned_alloc_128(size_t size) {
+    void *mem = NULL;
+#ifdef __APPLE__
+    if (posix_memalign(&mem, 128, size) != 0) {
+        mem = NULL;
+    }
+#else
+    mem = memalign(128, size);
+#endif
+    if (mem == NULL) {
+        exit(-1);
+    }
+    return mem;
+}
+
+halide_buffer_t make_buffer(halide_type_t type, int w, int h, int min_x) {
+    halide_buffer_t buf = {0};
+    buf.dim = (halide_dimension_t *)malloc(sizeof(halide_dimension_t)*2);
+    buf.host = (uint8_t *)aligned_alloc_128((size_t)w * h * type.bytes());
+    buf.type = type;
+    buf.dimensions = 2;
+    buf.dim[0].min = min_x;
+    buf.dim[0].extent = w;
+    buf.dim[0].stride = 1;
+    buf.dim[1].min = 0;
+    buf.dim[1].extent = h;
+    buf.dim[1].stride = w;
+
+    // Fill it with small values, so that no test hits a slow path on
+    // e.g. denormals.
+    for (size_t i = 0; i < (size_t)w * h * type.bytes(); i++) {
+        buf.host[i] = (uint8_t)(rand() & 0x3f);
+    }
+    return buf;
+}
+
+std::map<std::string, double> read_results(const char *filename) {
+    std::map<std::string, double> results;
+    FILE *f = fopen(filename, "r");
+    if (!f) {
+        printf("Could not open baseline %s\n", filename);
+        exit(-1);
+    }
+    char name[1024];
+    double value;
+    while (fscanf(f, "%1023s %lf", name, &value) == 2) {
+        results[name] = value;
+    }
+    fclose(f);
+    return results;
+}
+
+int main(int argc, char **argv) {
+    const char *output_file = NULL, *baseline_file = NULL;
+    double max_ratio = 1.25, ghz = 0;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (!strcmp(argv[i], "-w")) {
+            output_file = argv[i + 1];
+        } else if (!strcmp(argv[i], "-b")) {
+            baseline_file = argv[i + 1];
+        } else if (!strcmp(argv[i], "-r")) {
+            max_ratio = atof(argv[i + 1]);
+        } else if (!strcmp(argv[i], "-ghz")) {
+            ghz = atof(argv[i + 1]);
+        } else {
+            printf("Unknown argument %s\n", argv[i]);
+            return -1;
+        }
+    }
+
+    // These match the sizes of the buffers that simd_op_check
+    // compiles the tests for.
+    const int W = 256*3, H = 1024, PAD = 128;
+    const halide_type_t types[] = {
+        halide_type_of<float>(),
+        halide_type_of<double>(),
+        halide_type_of<int8_t>(),
+        halide_type_of<uint8_t>(),
+        halide_type_of<int16_t>(),
+        halide_type_of<uint16_t>(),
+        halide_type_of<int32_t>(),
+        halide_type_of<uint32_t>(),
+        halide_type_of<int64_t>(),
+        halide_type_of<uint64_t>()
+    };
+    const int num_inputs = sizeof(types)/sizeof(types[0]);
+    halide_buffer_t bufs[num_inputs];
+    for (int i = 0; i < num_inputs; i++) {
+        bufs[i] = make_buffer(types[i], W + 2 * PAD, H, -PAD);
+    }
+
+    std::map<std::string, double> baseline;
+    if (baseline_file) {
+        baseline = read_results(baseline_file);
+    }
+    FILE *output = NULL;
+    if (output_file) {
+        output = fopen(output_file, "w");
+        if (!output) {
+            printf("Could not open %s\n", output_file);
+            return -1;
+        }
+    }
+
+    const char *units = ghz > 0 ? "cycles" : "ns";
+    int regressions = 0;
+    for (int i = 0; filters[i].fn; i++) {
+        const benchmark_filter &f = filters[i];
+
+        // The output is the last argument.
+        const halide_filter_metadata_t *md = f.metadata();
+        halide_buffer_t out = make_buffer(md->arguments[md->num_arguments - 1].type, W, H, 0);
+
+        double t = Halide::Tools::benchmark([&]() {
+            f.fn(bufs + 0, bufs + 1, bufs + 2, bufs + 3, bufs + 4,
+                 bufs + 5, bufs + 6, bufs + 7, bufs + 8, bufs + 9, &out);
+        });
+        double per_element = t * 1e9 / ((double)W * H);
+        if (ghz > 0) {
+            per_element *= ghz;
+        }
+
+        printf("%s: %.4f %s per element", f.name, per_element, units);
+        auto it = baseline.find(f.name);
+        if (it != baseline.end()) {
+            double ratio = per_element / it->second;
+            printf(" (%.2fx the baseline)", ratio);
+            if (ratio > max_ratio) {
+                printf(" REGRESSION");
+                regressions++;
+            }
+        }
+        printf("\n");
+        if (output) {
+            fprintf(output, "%s %f\n", f.name, per_element);
+        }
+
+        free(out.dim);
+        free(out.host);
+    }
+
+    if (output) {
+        fclose(output);
+    }
+    for (int i = 0; i < num_inputs; i++) {
+        free(bufs[i].dim);
+        free(bufs[i].host);
+    }
+
+    if (regressions) {
+        printf("%d tests got more than %.2fx slower than the baseline\n", regressions, max_ratio);
+        return -1;
+    }
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,62 @@
+#!/bin/bash
+
+# Compare benchmark results written by RunGen's --benchmark_json
+# against a file of baselines, and fail if any pipeline got slower
+# by more than the given fraction (e.g. 0.1 for 10%).
+#
+# The baselines file has one "name median_seconds" pair per line;
+# lines starting with '#' are comments. Pipelines with no baseline
+# are reported but don't fail. With UPDATE=1, the baselines file is
+# rewritten from the results instead.
+#
+# Usage: compare_benchmarks.sh BASELINES THRESHOLD RESULT.json...
+
+if [ $# -lt 3 ]; then
+    echo "Usage: $0 BASELINES THRESHOLD RESULT.json..."
+    exit 1
+fi
+
+BASELINES=$1
+THRESHOLD=$2
+shift 2
+
+json_field() {
+    sed -n "s/^ *\"$2\": *\"\{0,1\}\([^\",]*\)\"\{0,1\},\{0,1\}$/\1/p" $1
+}
+
+if [ "$UPDATE" == "1" ]; then
+    TMP=$(mktemp)
+    grep '^#' ${BASELINES} > ${TMP} 2>/dev/null
+    for RESULT in "$@"; do
+        echo "$(json_field ${RESULT} name) $(json_field ${RESULT} median_time)" >> ${TMP}
+    done
+    mv ${TMP} ${BASELINES}
+    echo "Updated ${BASELINES}"
+    exit 0
+fi
+
+FAILED=0
+for RESULT in "$@"; do
+    NAME=$(json_field ${RESULT} name)
+    TIME=$(json_field ${RESULT} median_time)
+    if [ -z "${NAME}" -o -z "${TIME}" ]; then
+        echo "Could not read benchmark results from ${RESULT}"
+        FAILED=1
+        continue
+    fi
+    BASELINE=$(awk -v n=${NAME} '$1 == n { print $2 }' ${BASELINES})
+    if [ -z "${BASELINE}" ]; then
+        printf "%-24s %12.6f s   (no baseline)\n" ${NAME} ${TIME}
+        continue
+    fi
+    if awk -v t=${TIME} -v b=${BASELINE} -v th=${THRESHOLD} 'BEGIN { exit !(t > b * (1 + th)) }'; then
+        STATUS="REGRESSION"
+        FAILED=1
+    else
+        STATUS="ok"
+    fi
+    printf "%-24s %12.6f s   baseline %12.6f s   %+6.1f%%   %s\n" ${NAME} ${TIME} ${BASELINE} \
+        $(awk -v t=${TIME} -v b=${BASELINE} 'BEGIN { print 100 * (t - b) / b }') ${STATUS}
+done
+
+exit ${FAILED}
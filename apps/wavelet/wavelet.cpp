@@ -1,9 +1,16 @@
+#include <cmath>
 #include <stdio.h>
 
 #include "haar_x.h"
 #include "inverse_haar_x.h"
 #include "daubechies_x.h"
 #include "inverse_daubechies_x.h"
+#include "wavelet_2d.h"
+#include "wavelet_2d_1level.h"
+#include "daubechies_2d.h"
+#include "daubechies_2d_1level.h"
+
+#include "halide_benchmark.h"
 
 #include "HalideBuffer.h"
 #include "halide_image_io.h"
@@ -49,6 +56,67 @@ void save_transformed(Buffer<T> t, const std::string& filename) {
     printf("Saved %s\n", filename.c_str());
 }
 
+// Save a multi-level transform in the Mallat layout, with the detail
+// bands brightened so that they are visible.
+template<typename T>
+void save_mallat(Buffer<T> t, int levels, const std::string& filename) {
+    const int low_w = t.width() >> levels, low_h = t.height() >> levels;
+    Buffer<T> rearranged(t.width(), t.height(), 1);
+    for (int y = 0; y < t.height(); y++) {
+        for (int x = 0; x < t.width(); x++) {
+            bool low = x < low_w && y < low_h;
+            rearranged(x, y, 0) = clamp(low ? t(x, y) : t(x, y)*4.f + 0.5f, 0.0f, 1.0f);
+        }
+    }
+    convert_and_save_image(rearranged, filename);
+    printf("Saved %s\n", filename.c_str());
+}
+
+typedef int (*Transform2D)(halide_buffer_t *, halide_buffer_t *);
+
+// Compute a multi-level transform the way it would be done with only a
+// single-level transform: decompose the image, copy the result into
+// place, then decompose the low band of that, and so on.
+void chain_levels(Transform2D one_level, Buffer<float> input, Buffer<float> out,
+                  Buffer<float> scratch, int levels) {
+    Buffer<float> src = input;
+    for (int j = 0; j < levels; j++) {
+        const int w = input.width() >> j, h = input.height() >> j;
+        Buffer<float> level_out = scratch.cropped(0, 0, w).cropped(1, 0, h);
+        _assert(one_level(src, level_out) == 0, "single-level transform failed");
+        Buffer<float> dst = out.cropped(0, 0, w).cropped(1, 0, h);
+        dst.copy_from(level_out);
+        src = out.cropped(0, 0, w / 2).cropped(1, 0, h / 2);
+    }
+}
+
+// Check the multi-level transform against the chain of single-level
+// transforms, then time both.
+void compare_levels(const char *name, Transform2D multi_level, Transform2D one_level,
+                    Buffer<float> input, int levels, const std::string& filename) {
+    Buffer<float> out(input.width(), input.height());
+    Buffer<float> chained(input.width(), input.height());
+    Buffer<float> scratch(input.width(), input.height());
+
+    _assert(multi_level(input, out) == 0, "%s failed\n", name);
+    chain_levels(one_level, input, chained, scratch, levels);
+    out.for_each_element([&](int x, int y) {
+        float error = std::abs(out(x, y) - chained(x, y));
+        _assert(error < 1e-4f * std::max(1.0f, std::abs(chained(x, y))), "%s(%d, %d) = %f instead of %f\n",
+                name, x, y, out(x, y), chained(x, y));
+    });
+    save_mallat(out, levels, filename);
+
+    double t_multi = Halide::Tools::benchmark(3, 10, [&]() {
+        multi_level(input, out);
+    });
+    double t_chain = Halide::Tools::benchmark(3, 10, [&]() {
+        chain_levels(one_level, input, chained, scratch, levels);
+    });
+    printf("%s, %d levels: %gms (chain of single-level transforms: %gms)\n",
+           name, levels, t_multi * 1e3, t_chain * 1e3);
+}
+
 }  // namespace
 
 int main(int argc, char **argv) {
@@ -73,6 +141,15 @@ int main(int argc, char **argv) {
     _assert(inverse_daubechies_x(transformed, inverse_transformed) == 0, "inverse_daubechies_x failed");
     save_untransformed(inverse_transformed, dirname + "/inverse_daubechies_x.png");
 
+    // The multi-level transforms need dimensions divisible by 2^levels.
+    const int levels = 5;
+    const int w = input.width() & ~((1 << levels) - 1);
+    const int h = input.height() & ~((1 << levels) - 1);
+    Buffer<float> cropped = input.cropped(0, 0, w).cropped(1, 0, h);
+
+    compare_levels("haar_2d", wavelet_2d, wavelet_2d_1level, cropped, levels, dirname + "/haar_2d.png");
+    compare_levels("daubechies_2d", daubechies_2d, daubechies_2d_1level, cropped, levels, dirname + "/daubechies_2d.png");
+
     printf("Done.\n");
     return 0;
 }
@@ -0,0 +1,135 @@
+#include "Halide.h"
+
+namespace {
+
+Halide::Var x("x"), y("y"), c("c");
+
+enum class WaveletType { Haar, Daubechies };
+
+// A multi-level 2-D wavelet transform, computed with the lifting
+// scheme. The output is in the usual Mallat layout: the first level
+// writes its three detail bands into the right and bottom halves of
+// the output, the next level decomposes the top-left quarter, and so
+// on. The low band of the last level ends up in the top-left corner.
+//
+// The pure definition of the output is undefined, so each level only
+// writes the part of the output it owns, in place. The input width and
+// height must be multiples of 2^levels.
+class wavelet_2d : public Halide::Generator<wavelet_2d> {
+public:
+    GeneratorParam<WaveletType> wavelet{"wavelet", WaveletType::Haar,
+                                        {{"haar", WaveletType::Haar},
+                                         {"daubechies", WaveletType::Daubechies}}};
+    GeneratorParam<int> levels{"levels", 5};
+
+    Input<Buffer<float>> in_{"in" , 2};
+    Output<Buffer<float>> out_{"out" , 2};
+
+    // One lifting step of f along dimension dim, over which f has the
+    // given extent. The low band is at c == 0 and the high band at c == 1.
+    Func lift(Func f, int dim, Expr extent, const std::string &name) {
+        Func in = dim == 0 ?
+            Halide::BoundaryConditions::repeat_edge(f, {{0, extent}, {Expr(), Expr()}}) :
+            Halide::BoundaryConditions::repeat_edge(f, {{Expr(), Expr()}, {0, extent}});
+        Expr n = dim == 0 ? x : y;
+        auto at = [&](Expr i) { return dim == 0 ? in(i, y) : in(x, i); };
+
+        Expr low, high;
+        if (wavelet == WaveletType::Haar) {
+            Expr d = at(2*n + 1) - at(2*n);
+            low = at(2*n) + d/2;
+            high = -d/2;
+        } else {
+            // The factorization of D4 into lifting steps from
+            // Daubechies and Sweldens.
+            const float sqrt3 = 1.7320508075688772f, sqrt2 = 1.4142135623730951f;
+            auto s1 = [&](Expr i) { return at(2*i) + sqrt3*at(2*i + 1); };
+            auto d1 = [&](Expr i) {
+                return at(2*i + 1) - (sqrt3/4)*s1(i) - ((sqrt3 - 2)/4)*s1(i - 1);
+            };
+            low = ((sqrt3 - 1)/sqrt2)*(s1(n) - d1(n + 1));
+            high = ((sqrt3 + 1)/sqrt2)*d1(n);
+        }
+
+        Func result(name);
+        result(x, y, c) = select(c == 0, low, high);
+        return result;
+    }
+
+    // One level of the 2-D transform of ll, which is w x h. The bands
+    // are numbered by their position in the Mallat layout: 0 is the
+    // low band, 1 is high in x, 2 is high in y, and 3 is high in both.
+    struct Level {
+        Func rows, bands;
+    };
+
+    Level lift_2d(Func ll, Expr w, Expr h, const std::string &name) {
+        Level l;
+        l.rows = lift(ll, 0, w, name + "_rows");
+        Func rows_low, rows_high;
+        rows_low(x, y) = l.rows(x, y, 0);
+        rows_high(x, y) = l.rows(x, y, 1);
+        Func cols_low = lift(rows_low, 1, h, name + "_cols_low");
+        Func cols_high = lift(rows_high, 1, h, name + "_cols_high");
+        l.bands = Func(name + "_bands");
+        l.bands(x, y, c) = select(c % 2 == 0, cols_low(x, y, c / 2), cols_high(x, y, c / 2));
+        return l;
+    }
+
+    void generate() {
+        const int num_levels = levels;
+        assert(num_levels >= 1);
+
+        out_(x, y) = Halide::undef<float>();
+
+        Func ll = in_;
+        for (int j = 1; j <= num_levels; j++) {
+            const std::string name = "level_" + std::to_string(j);
+            Expr w = in_.width() >> (j - 1), h = in_.height() >> (j - 1);
+            Expr w2 = w / 2, h2 = h / 2;
+            bool last = j == num_levels;
+
+            Level details = lift_2d(ll, w, h, name);
+
+            // Each band of this level goes into its own quadrant of the
+            // previous level's low band. The low band is only written
+            // by the last level; earlier levels pass it on instead.
+            RDom r(0, w2, 0, h2, last ? 0 : 1, last ? 4 : 3);
+            out_(r.x + select(r.z % 2 == 1, w2, 0), r.y + select(r.z >= 2, h2, 0)) =
+                details.bands(r.x, r.y, r.z);
+
+            // Work in tiles that fit in cache. The quadrants don't
+            // overlap, so the update can be computed in parallel.
+            Halide::RVar rxo("rxo_" + name), rxi("rxi"), ryo("ryo_" + name), ryi("ryi");
+            out_.update(j - 1)
+                .split(r.x, rxo, rxi, 128)
+                .split(r.y, ryo, ryi, 32)
+                .reorder(rxi, r.z, ryi, rxo, ryo)
+                .vectorize(rxi, 8)
+                .unroll(r.z)
+                .parallel(ryo)
+                .allow_race_conditions();
+            details.bands.compute_at(out_, rxo).unroll(c).vectorize(x, 8);
+            details.rows.compute_at(out_, rxo).unroll(c).vectorize(x, 8);
+
+            if (!last) {
+                // The next level needs the low band, which is
+                // computed separately so that only a quarter of this
+                // level's output is stored.
+                Level low = lift_2d(ll, w, h, name + "_low");
+                Func next("ll_" + std::to_string(j));
+                next(x, y) = low.bands(x, y, 0);
+
+                Var yo, yi;
+                next.compute_root()
+                    .split(y, yo, yi, 16).parallel(yo).vectorize(x, 8);
+                low.rows.compute_at(next, yo).vectorize(x, 8);
+                ll = next;
+            }
+        }
+    }
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(wavelet_2d, wavelet_2d)
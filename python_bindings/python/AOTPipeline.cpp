@@ -0,0 +1,169 @@
+#include "AOTPipeline.h"
+
+// to avoid compiler confusion, python.hpp must be include before Halide headers
+#include <boost/python.hpp>
+#include <boost/python/raw_function.hpp>
+
+#include "Halide.h"
+
+#include "Func.h"
+#include "Image.h"
+
+#include <dlfcn.h>
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace h = Halide;
+namespace p = boost::python;
+
+/** A pipeline compiled ahead of time into a shared library (e.g. the
+ * object file from Func::compile_to_file or a Generator, linked with
+ * -shared), called through its argv entry point. This avoids paying
+ * the JIT compile time in every process. The library is never
+ * unloaded, because its runtime may have threads running. */
+class AOTPipeline {
+    typedef int (*ArgvFunction)(void **);
+    typedef const halide_filter_metadata_t *(*MetadataFunction)();
+
+    ArgvFunction argv_function;
+    const halide_filter_metadata_t *metadata;
+
+    // Convert a Python value to the scalar type the pipeline expects.
+    static halide_scalar_value_t to_scalar(p::object obj, const halide_filter_argument_t &arg) {
+        halide_scalar_value_t v;
+        const halide_type_t &t = arg.type;
+        if (t.code == halide_type_float) {
+            double d = p::extract<double>(obj);
+            if (t.bits == 32) {
+                v.u.f32 = (float)d;
+            } else {
+                v.u.f64 = d;
+            }
+        } else if (t.code == halide_type_uint && t.bits == 1) {
+            v.u.b = p::extract<bool>(obj);
+        } else if (t.code == halide_type_int || t.code == halide_type_uint) {
+            // Scalars are passed by pointer with their natural width,
+            // so store them in the member of the union of that width.
+            int64_t i = p::extract<int64_t>(obj);
+            switch (t.bits) {
+            case 8: v.u.i8 = (int8_t)i; break;
+            case 16: v.u.i16 = (int16_t)i; break;
+            case 32: v.u.i32 = (int32_t)i; break;
+            default: v.u.i64 = i; break;
+            }
+        } else {
+            throw std::invalid_argument(std::string("AOTPipeline can't pass argument ") +
+                                        arg.name + ": handle arguments aren't supported");
+        }
+        return v;
+    }
+
+public:
+    AOTPipeline(const std::string &path, const std::string &function_name) {
+        void *lib = dlopen(path.c_str(), RTLD_LAZY | RTLD_LOCAL);
+        if (!lib) {
+            throw std::invalid_argument("AOTPipeline couldn't load " + path + ": " + dlerror());
+        }
+        argv_function = (ArgvFunction)dlsym(lib, (function_name + "_argv").c_str());
+        MetadataFunction metadata_function =
+            (MetadataFunction)dlsym(lib, (function_name + "_metadata").c_str());
+        if (!argv_function || !metadata_function) {
+            throw std::invalid_argument("AOTPipeline couldn't find the pipeline " + function_name + " in " + path);
+        }
+        metadata = metadata_function();
+    }
+
+    std::string target() const {
+        return metadata->target;
+    }
+
+    p::list argument_names() const {
+        p::list names;
+        for (int i = 0; i < metadata->num_arguments; i++) {
+            names.append(std::string(metadata->arguments[i].name));
+        }
+        return names;
+    }
+
+    // Call the pipeline with one Python value per argument, in the
+    // order of argument_names(). Buffers may be Halide Buffers or any
+    // object that supports the buffer protocol, such as numpy arrays;
+    // either is used in place.
+    void call(p::tuple args) {
+        const int n = metadata->num_arguments;
+        if (p::len(args) != n) {
+            throw std::invalid_argument("AOTPipeline " + std::string(metadata->name) + " takes " +
+                                        std::to_string(n) + " arguments");
+        }
+
+        // Both vectors are sized up front, so the pointers into them
+        // stay valid.
+        std::vector<h::Buffer<>> buffers(n);
+        std::vector<halide_scalar_value_t> scalars(n);
+        std::vector<void *> argv(n);
+        for (int i = 0; i < n; i++) {
+            const halide_filter_argument_t &arg = metadata->arguments[i];
+            if (arg.kind == halide_argument_kind_input_scalar) {
+                scalars[i] = to_scalar(args[i], arg);
+                argv[i] = &scalars[i];
+            } else {
+                buffers[i] = python_object_to_buffer(args[i]);
+                if (buffers[i].type() != h::Type(arg.type) || buffers[i].dimensions() != arg.dimensions) {
+                    throw std::invalid_argument(std::string("AOTPipeline argument ") + arg.name +
+                                                " has the wrong type or number of dimensions");
+                }
+                argv[i] = buffers[i].raw_buffer();
+            }
+        }
+
+        int result;
+        {
+            ScopedGILRelease release;
+            result = argv_function(argv.data());
+            // Outputs on a device are copied back into the caller's memory.
+            for (int i = 0; result == 0 && i < n; i++) {
+                if (metadata->arguments[i].kind == halide_argument_kind_output_buffer) {
+                    result = buffers[i].copy_to_host();
+                }
+            }
+            for (int i = 0; i < n; i++) {
+                if (buffers[i].defined()) {
+                    buffers[i].device_free();
+                }
+            }
+        }
+        if (result != 0) {
+            throw std::runtime_error("AOTPipeline " + std::string(metadata->name) +
+                                     " failed with error code " + std::to_string(result));
+        }
+    }
+};
+
+namespace {
+
+p::object aot_pipeline_call(p::tuple args, p::dict kwargs) {
+    if (p::len(kwargs) != 0) {
+        throw std::invalid_argument("AOTPipeline arguments must be positional");
+    }
+    AOTPipeline &self = p::extract<AOTPipeline &>(args[0]);
+    self.call(p::tuple(args.slice(1, p::_)));
+    return p::object();
+}
+
+}  // namespace
+
+void defineAOTPipeline() {
+    p::class_<AOTPipeline>("AOTPipeline",
+                           "A pipeline compiled ahead of time, loaded from a shared library. "
+                           "Calling it runs the pipeline with the GIL released.",
+                           p::init<std::string, std::string>(p::args("self", "path", "function_name")))
+        .def("__call__", p::raw_function(aot_pipeline_call, 1),
+             "Run the pipeline. Pass one value per argument, in the order given by argument_names(). "
+             "Outputs are written in-place.")
+        .def("argument_names", &AOTPipeline::argument_names, p::arg("self"),
+             "The names of the pipeline's arguments, in the order it takes them.")
+        .def("target", &AOTPipeline::target, p::arg("self"),
+             "The target the pipeline was compiled for.");
+}
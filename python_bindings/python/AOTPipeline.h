@@ -0,0 +1,6 @@
+#ifndef AOT_PIPELINE_H
+#define AOT_PIPELINE_H
+
+void defineAOTPipeline();
+
+#endif  // AOT_PIPELINE_H
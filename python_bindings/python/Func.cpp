@@ -15,6 +15,7 @@
 #include "Func_VarOrRVar.h"
 #include "Func_gpu.h"
 
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -47,19 +48,63 @@ h::Realization python_object_to_realization(p::object obj) {
     return h::Realization(buffers);
 }
 
+// The target realize will compile for: the trailing Target argument,
+// if there is one.
+h::Target realize_target() {
+    return h::get_jit_target_from_environment();
+}
+
+h::Target realize_target(const h::Target &t) {
+    return t;
+}
+
+template <typename T, typename... Rest>
+h::Target realize_target(const T &, const Rest &... rest) {
+    return realize_target(rest...);
+}
+
+// A Func can be realized from several Python threads at once once it
+// is compiled, but compilation itself must not race, so it is done
+// first under a lock. Compiling again for the same target is a no-op.
+void compile_jit_locked(h::Func &f, const h::Target &target) {
+    static std::mutex compile_mutex;
+    std::lock_guard<std::mutex> lock(compile_mutex);
+    f.compile_jit(target);
+}
+
 template <typename... Args>
 p::object func_realize(h::Func &f, Args... args) {
-    return realization_to_python_object(f.realize(args...));
+    h::Realization r = [&]() {
+        ScopedGILRelease release;
+        compile_jit_locked(f, realize_target(args...));
+        return f.realize(args...);
+    }();
+    return realization_to_python_object(r);
 }
 
 template <typename... Args>
 void func_realize_into(h::Func &f, Args... args) {
+    ScopedGILRelease release;
+    compile_jit_locked(f, realize_target(args...));
     f.realize(args...);
 }
 
 template <typename... Args>
 void func_realize_tuple(h::Func &f, p::tuple obj, Args... args) {
-    f.realize(python_object_to_realization(obj), args...);
+    h::Realization r = python_object_to_realization(obj);
+    ScopedGILRelease release;
+    compile_jit_locked(f, realize_target(args...));
+    f.realize(r, args...);
+}
+
+// Realize directly into the memory of a numpy array, or of any other
+// object that supports the buffer protocol.
+template <typename... Args>
+void func_realize_into_object(h::Func &f, p::object obj, Args... args) {
+    h::Realization r = python_object_to_realization(obj);
+    ScopedGILRelease release;
+    compile_jit_locked(f, realize_target(args...));
+    f.realize(r, args...);
 }
 
 void func_compile_jit0(h::Func &that) {
@@ -246,9 +291,19 @@ void defineFunc() {
         "the resulting buffer.";
 
     const char *realize_into_doc =
-        "Evaluate this function into the given buffer.";
+        "Evaluate this function into the given buffer. The output may also be "
+        "a numpy array (or any object that supports the buffer protocol), "
+        "which is written in-place.";
 
+    // Overloads are tried in the reverse of the order they are defined
+    // in, so the catch-all for buffer-protocol objects comes first.
     func_class
+        .def("realize", &func_realize_into_object<>,
+             p::args("self", "output"),
+             realize_into_doc)
+        .def("realize", &func_realize_into_object<h::Target>,
+             p::args("self", "output", "target"),
+             realize_into_doc)
         .def("realize", &func_realize<>,
              p::args("self"),
              realize_doc)
@@ -12,6 +12,15 @@
 
 void defineFunc();
 
+// Release the GIL while a pipeline compiles and runs, so that other
+// Python threads can make progress. Nothing inside a pipeline calls
+// back into Python.
+struct ScopedGILRelease {
+    PyThreadState *state;
+    ScopedGILRelease() : state(PyEval_SaveThread()) {}
+    ~ScopedGILRelease() { PyEval_RestoreThread(state); }
+};
+
 namespace func_and_stage_implementation_details {
 // These are methods shared with Stage
 
@@ -1,5 +1,6 @@
 #include <boost/python.hpp>
 
+#include "AOTPipeline.h"
 #include "Argument.h"
 #include "BoundaryConditions.h"
 #include "Error.h"
@@ -42,6 +43,7 @@ BOOST_PYTHON_MODULE(halide) {
     using namespace boost::python;
 
     // we include all the pieces and bits from the Halide API
+    defineAOTPipeline();
     defineArgument();
     defineBoundaryConditions();
     defineBuffer();
@@ -470,12 +470,98 @@ h::Buffer<> python_object_to_buffer(p::object obj) {
         return buffer_extract_float();
     } else if (buffer_extract_double.check()) {
         return buffer_extract_double();
+    } else if (PyObject_CheckBuffer(obj.ptr())) {
+        return python_buffer_to_buffer(obj);
     } else {
-        throw std::invalid_argument("python_object_to_buffer received an object that is not an Buffer<T>");
+        throw std::invalid_argument("python_object_to_buffer received an object that is neither an Buffer<T> "
+                                    "nor supports the buffer protocol");
     }
     return h::Buffer<>();
 }
 
+namespace {
+
+// Map a struct-module format string from the buffer protocol to a Halide type.
+h::Type buffer_format_to_type(const char *format, Py_ssize_t itemsize) {
+    if (format == nullptr) {
+        // A null format means unsigned bytes.
+        return h::UInt(8);
+    }
+    // Skip the byte order and alignment prefix. The data is used
+    // in-place, so only native byte order is supported.
+    if (*format == '@' || *format == '=') {
+        format++;
+    } else if (*format == '<' || *format == '>' || *format == '!') {
+        uint16_t one = 1;
+        bool little_endian = *reinterpret_cast<uint8_t *>(&one) == 1;
+        if ((*format == '<') != little_endian) {
+            throw std::invalid_argument("Buffers with a non-native byte order can't be used in-place");
+        }
+        format++;
+    }
+    if (format[0] == 0 || format[1] != 0) {
+        throw std::invalid_argument(std::string("Unsupported buffer format: ") + format);
+    }
+    const int bits = (int)itemsize * 8;
+    switch (format[0]) {
+    case 'b': case 'h': case 'i': case 'l': case 'q':
+        return h::Int(bits);
+    case 'B': case 'H': case 'I': case 'L': case 'Q': case '?':
+        return h::UInt(bits);
+    case 'e': case 'f': case 'd':
+        return h::Float(bits);
+    default:
+        throw std::invalid_argument(std::string("Unsupported buffer format: ") + format);
+    }
+    return h::Type();
+}
+
+}  // namespace
+
+/// Wrap the memory of any object that supports the buffer protocol
+/// (a numpy array, a memoryview, an array.array, a bytearray...) in a
+/// Halide::Buffer, with its strides preserved. The data is not copied,
+/// so the caller must keep the object alive while the Buffer is in use.
+h::Buffer<> python_buffer_to_buffer(p::object obj) {
+    Py_buffer view;
+    if (PyObject_GetBuffer(obj.ptr(), &view, PyBUF_RECORDS) != 0) {
+        // Read-only objects can still be used as inputs.
+        PyErr_Clear();
+        if (PyObject_GetBuffer(obj.ptr(), &view, PyBUF_RECORDS_RO) != 0) {
+            p::throw_error_already_set();
+        }
+    }
+    // The view only pins the memory until it is released; obj stays
+    // alive for as long as the Buffer, so releasing it here is safe
+    // for everything that doesn't resize in place.
+    struct ViewReleaser {
+        Py_buffer *view;
+        ~ViewReleaser() { PyBuffer_Release(view); }
+    } releaser{&view};
+
+    h::Type t = buffer_format_to_type(view.format, view.itemsize);
+    if (t.bytes() != view.itemsize) {
+        throw std::invalid_argument("Buffer format and item size disagree");
+    }
+
+    const int dims = view.ndim;
+    std::vector<halide_dimension_t> shape(dims);
+    for (int i = 0; i < dims; i++) {
+        if (view.strides[i] % view.itemsize != 0) {
+            throw std::invalid_argument("Buffer strides must be a multiple of the element size");
+        }
+        shape[i].min = 0;
+        shape[i].extent = (int32_t)view.shape[i];
+        shape[i].stride = (int32_t)(view.strides[i] / view.itemsize);
+    }
+
+    return h::Buffer<>(t, view.buf, dims, shape.data());
+}
+
+p::object python_buffer_to_buffer_object(p::object obj) {
+    return buffer_to_python_object(python_buffer_to_buffer(obj));
+}
+
 #ifdef USE_NUMPY
 
 bn::dtype type_to_dtype(const h::Type &t) {
@@ -609,7 +695,16 @@ void defineBuffer() {
     defineBuffer_impl<float>("_float32", h::Float(32));
     defineBuffer_impl<double>("_float64", h::Float(64));
 
-    // "Buffer" will look as a class, but instead it will be simply a factory method
+    // "Buffer" will look as a class, but instead it will be simply a factory method.
+    // Overloads are tried in the reverse of the order they are defined in,
+    // so this catch-all is defined first.
+    p::def("Buffer", &python_buffer_to_buffer_object,
+           p::args("obj"),
+           p::with_custodian_and_ward_postcall<0, 1>(),  // the object reference count is increased
+           "Wrap any object that supports the buffer protocol (e.g. a memoryview "
+           "or an array.array) in a Halide::Buffer. "
+           "Created Buffer refers to the object's data, with its strides (no copy).");
+
     p::def("Buffer", &BufferFactory::create_buffer0,
            p::args("type"),
            "Construct a zero-dimensional buffer of type T");
@@ -99,9 +99,23 @@ void defineTarget() {
 
         .value("ARMv7s", Target::Feature::ARMv7s)
         .value("NoNEON", Target::Feature::NoNEON)
+        .value("ARMDotProd", Target::Feature::ARMDotProd)
+        .value("LoopCarry", Target::Feature::LoopCarry)
+        .value("FuseGPUKernels", Target::Feature::FuseGPUKernels)
+        .value("SpecializeUnitStride", Target::Feature::SpecializeUnitStride)
+        .value("LazySpecializations", Target::Feature::LazySpecializations)
+        .value("OptLevel0", Target::Feature::OptLevel0)
+        .value("OptLevel1", Target::Feature::OptLevel1)
+        .value("PreciseMath", Target::Feature::PreciseMath)
+        .value("FastMath", Target::Feature::FastMath)
+        .value("ARMFp16", Target::Feature::ARMFp16)
+        .value("SharedMemoizationCache", Target::Feature::SharedMemoizationCache)
+        .value("SoftwarePipeline", Target::Feature::SoftwarePipeline)
+        .value("OpenMP", Target::Feature::OpenMP)
 
         .value("VSX", Target::Feature::VSX)
         .value("POWER_ARCH_2_07", Target::Feature::POWER_ARCH_2_07)
+        .value("POWER_ARCH_3_00", Target::Feature::POWER_ARCH_3_00)
 
         .value("CUDA", Target::Feature::CUDA)
         .value("CUDACapability30", Target::Feature::CUDACapability30)
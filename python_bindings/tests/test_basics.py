@@ -270,6 +270,37 @@ def test_image_to_ndarray():
 
     return
 
+def test_realize_into_ndarray():
+
+    try:
+        import numpy
+    except ImportError:
+        print("Skipping test_realize_into_ndarray")
+        return
+
+    x, y = Var('x'), Var('y')
+    f = Func('f')
+    f[x, y] = cast(Int(32), x + 10 * y)
+
+    # Realizing into the array writes its memory in-place, including
+    # through a strided view. The first dimension must be dense.
+    a = numpy.zeros((8, 20), dtype=numpy.int32, order="F")
+    view = a[:, ::2]
+    f.realize(view)
+    assert view[3, 5] == 3 + 10 * 5
+    assert a[3, 10] == 3 + 10 * 5
+    assert a[3, 11] == 0
+
+    # Other buffer-protocol objects can be wrapped too.
+    import array
+    data = array.array('f', [1.0, 2.0, 3.0, 4.0])
+    b = Buffer(data)
+    assert b.type() == Float(32)
+    b[1] = 5.0
+    assert data[1] == 5.0
+
+    return
+
 def test_param_bug():
     "see https://github.com/rodrigob/Halide/issues/1"
 
@@ -297,6 +328,7 @@ if __name__ == "__main__":
     test_float_or_int()
     test_ndarray_to_image()
     test_image_to_ndarray()
+    test_realize_into_ndarray()
     test_types()
     test_operator_order()
     test_basics()
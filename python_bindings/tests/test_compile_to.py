@@ -1,6 +1,8 @@
 #!/usr/bin/python3
 
 import os.path
+import shutil
+import subprocess
 
 import halide as h
 
@@ -35,9 +37,26 @@ def main():
     assert os.path.isfile("f_all.h")
     assert os.path.isfile("f_all.o")
 
+    test_aot_pipeline(f, args)
+
     print("Success!")
 
     return 0
 
+def test_aot_pipeline(f, args):
+    # Load the pipeline from a shared library, and call it from Python.
+    if shutil.which("cc") is None:
+        print("Skipping test_aot_pipeline")
+        return
+
+    f.compile_to_file("f_aot", args, "f_aot")
+    subprocess.check_call(["cc", "-shared", "f_aot.o", "-o", "libf_aot.so", "-lpthread", "-ldl"])
+    pipeline = h.AOTPipeline(os.path.abspath("libf_aot.so"), "f_aot")
+    assert pipeline.argument_names() == ["f_aot"]
+
+    output = h.Buffer(h.Int(32), 10)
+    pipeline(output)
+    assert output(7) == 700
+
 if __name__ == "__main__":
     main()
@@ -1,4 +1,6 @@
 #include "AddImageChecks.h"
+#include "AffectedRegion.h"
+#include "IROperator.h"
 #include "Target.h"
 #include "IRVisitor.h"
 #include "Substitute.h"
@@ -90,12 +92,77 @@ public:
     }
 };
 
+// Check that it's safe for the output f to be computed in place over
+// the given input: every site of the output must be written once,
+// after everything reading the input at that site, and no other site.
+void check_in_place(Function f, const string &input, const vector<Function> &outputs) {
+    string prefix = "Output " + f.name() + " can't be computed in place over input " + input;
+
+    user_assert(f.updates().empty())
+        << prefix << ", because it has update definitions.\n";
+
+    for (const Split &split : f.definition().schedule().splits()) {
+        user_assert(!(split.is_split() && split.tail == TailStrategy::ShiftInwards))
+            << prefix << ", because the split of " << split.old_var
+            << " uses TailStrategy::ShiftInwards, which computes some sites twice. "
+            << "Use TailStrategy::GuardWithIf instead.\n";
+    }
+
+    vector<Expr> site;
+    for (int i = 0; i < f.dimensions(); i++) {
+        site.push_back(Variable::make(Int(32), unique_name(f.name() + ".in_place." + std::to_string(i))));
+    }
+    map<string, Box> required;
+    user_assert(site_footprint(f, site, required))
+        << prefix << ", because the inputs it reads at each site can't be determined.\n";
+    auto it = required.find(input);
+    if (it != required.end()) {
+        const Box &b = it->second;
+        bool same_site = b.size() == site.size();
+        for (size_t i = 0; same_site && i < b.size(); i++) {
+            same_site = (b[i].is_bounded() &&
+                         can_prove(b[i].min == site[i]) &&
+                         can_prove(b[i].max == site[i]));
+        }
+        user_assert(same_site)
+            << prefix << ", because computing a site reads other sites of " << input << ".\n";
+    }
+
+    for (Function other : outputs) {
+        if (other.name() == f.name()) {
+            continue;
+        }
+        map<string, Box> other_required;
+        vector<Expr> other_site;
+        for (int i = 0; i < other.dimensions(); i++) {
+            other_site.push_back(Variable::make(Int(32), unique_name(other.name() + ".in_place." + std::to_string(i))));
+        }
+        bool ok = site_footprint(other, other_site, other_required);
+        user_assert(ok && !other_required.count(input))
+            << prefix << ", because output " << other.name() << " also reads it.\n";
+    }
+}
+
+Stmt combine_asserts(const vector<Stmt> &asserts) {
+    if (asserts.size() <= 1) {
+        return asserts.empty() ? Stmt() : asserts[0];
+    }
+    Expr all_pass;
+    for (const Stmt &a : asserts) {
+        const AssertStmt *check = a.as<AssertStmt>();
+        internal_assert(check);
+        all_pass = all_pass.defined() ? (all_pass && check->condition) : check->condition;
+    }
+    return IfThenElse::make(!all_pass, Block::make(asserts));
+}
+
 Stmt add_image_checks(Stmt s,
                       const vector<Function> &outputs,
                       const Target &t,
                       const vector<string> &order,
                       const map<string, Function> &env,
-                      const FuncValueBounds &fb) {
+                      const FuncValueBounds &fb,
+                      map<string, vector<halide_dimension_t>> *fixed_shapes) {
 
     bool no_asserts = t.has_feature(Target::NoAsserts);
     bool no_bounds_query = t.has_feature(Target::NoBoundsQuery);
@@ -123,6 +190,23 @@ Stmt add_image_checks(Stmt s,
     // used on host.
     s.accept(&finder);
 
+    // Check that the outputs that may alias inputs can safely be
+    // computed in place, and collect the pairs to check at runtime.
+    vector<pair<Parameter, Parameter>> aliases;
+    for (Function f : outputs) {
+        for (Parameter out : f.output_buffers()) {
+            for (const string &input : out.aliased_inputs()) {
+                auto it = bufs.find(input);
+                user_assert(it != bufs.end() && it->second.param.defined() &&
+                            !it->second.param.same_as(out))
+                    << "Output buffer " << out.name() << " is declared to alias "
+                    << input << ", which is not an input buffer of the pipeline.\n";
+                check_in_place(f, input, outputs);
+                aliases.push_back({out, it->second.param});
+            }
+        }
+    }
+
     Scope<Interval> empty_scope;
     map<string, Box> boxes = boxes_touched(s, empty_scope, fb);
 
@@ -173,6 +257,13 @@ Stmt add_image_checks(Stmt s,
     // e.g. for constant folding.
     map<string, Expr> replace_with_constrained;
 
+    // The constraints of the buffers whose constraints are trusted,
+    // which aren't checked, but are used to prove the other checks.
+    map<string, Expr> trusted_constraints;
+
+    // All of the constraints, trusted or not.
+    map<string, Expr> all_constraints;
+
     for (pair<const string, FindBuffers::Result> &buf : bufs) {
         const string &name = buf.first;
         Buffer<> &image = buf.second.image;
@@ -180,6 +271,7 @@ Stmt add_image_checks(Stmt s,
         Type type = buf.second.type;
         int dimensions = buf.second.dimensions;
         bool used_on_host = buf.second.used_on_host;
+        bool trusted = param.defined() && param.constraints_trusted();
 
         // Detect if this is one of the outputs of a multi-output pipeline.
         bool is_output_buffer = false;
@@ -526,6 +618,12 @@ Stmt add_image_checks(Stmt s,
             replace_with_constrained[name] = constrained_var;
 
             lets_constrained.push_back({ name + ".constrained", constraints[i].second });
+            all_constraints[name] = constraints[i].second;
+
+            if (trusted) {
+                trusted_constraints[name] = constraints[i].second;
+                continue;
+            }
 
             Expr error = Call::make(Int(32), "halide_error_constraint_violated",
                                     {name, var, constrained_var_str, constrained_var},
@@ -548,7 +646,7 @@ Stmt add_image_checks(Stmt s,
         }
 
         // and check alignment of the host field
-        if (param.defined() && param.host_alignment() != param.type().bytes()) {
+        if (param.defined() && param.host_alignment() != param.type().bytes() && !trusted) {
             int alignment_required = param.host_alignment();
             Expr u64t_host_ptr = reinterpret<uint64_t>(host_ptr);
             Expr align_condition = (u64t_host_ptr % alignment_required) == 0;
@@ -558,8 +656,110 @@ Stmt add_image_checks(Stmt s,
         }
     }
 
+    // Remove the checks that the trusted constraints prove to pass,
+    // given the values of the lets they depend on.
+    if (!trusted_constraints.empty()) {
+        auto proven = [&](const Stmt &check) {
+            Expr c = check.as<AssertStmt>()->condition;
+            for (size_t i = lets_overflow.size(); i > 0; i--) {
+                c = substitute(lets_overflow[i-1].first, lets_overflow[i-1].second, c);
+            }
+            for (size_t i = lets_required.size(); i > 0; i--) {
+                c = substitute(lets_required[i-1].first, lets_required[i-1].second, c);
+            }
+            // A constraint may refer to the shape of another buffer,
+            // which may be constrained too.
+            c = substitute(trusted_constraints, c);
+            c = substitute(trusted_constraints, c);
+            return is_one(simplify(c));
+        };
+        for (vector<Stmt> *checks : {&asserts_required, &dims_no_overflow_asserts}) {
+            vector<Stmt> remaining;
+            for (const Stmt &check : *checks) {
+                if (proven(check)) {
+                    debug(3) << "Trusted constraints prove: " << check;
+                } else {
+                    remaining.push_back(check);
+                }
+            }
+            checks->swap(remaining);
+        }
+    }
+
+    // Work out the shapes a bounds query proposes for the buffers
+    // passed in when they all satisfy their constraints. If the
+    // constraints fix the shape of a buffer, callers can allocate it
+    // from the metadata of the pipeline without a bounds query.
+    if (fixed_shapes) {
+        map<string, Expr> proposed;
+        for (const auto &let : lets_proposed) {
+            proposed[let.first] = let.second;
+        }
+        auto fixed_value = [&](const string &var, int *result) {
+            Expr e = proposed[var + ".proposed"];
+            for (size_t i = lets_required.size(); i > 0; i--) {
+                e = substitute(lets_required[i-1].first, lets_required[i-1].second, e);
+            }
+            // A constraint may refer to the shape of another buffer,
+            // which may be constrained too.
+            e = substitute(all_constraints, e);
+            e = substitute(all_constraints, e);
+            const int64_t *i = as_const_int(simplify(e));
+            if (i && *i == (int32_t)(*i)) {
+                *result = (int32_t)(*i);
+                return true;
+            }
+            return false;
+        };
+        for (const pair<string, FindBuffers::Result> &buf : bufs) {
+            const Parameter &param = buf.second.param;
+            if (!param.defined()) continue;
+            const string &name = buf.first;
+            vector<halide_dimension_t> shape;
+            for (int i = 0; i < buf.second.dimensions; i++) {
+                string dim = std::to_string(i);
+                halide_dimension_t d;
+                if (!fixed_value(name + ".min." + dim, &d.min) ||
+                    !fixed_value(name + ".extent." + dim, &d.extent)) {
+                    break;
+                }
+                // The stride is left as zero when it isn't fixed.
+                fixed_value(name + ".stride." + dim, &d.stride);
+                shape.push_back(d);
+            }
+            if ((int)shape.size() == buf.second.dimensions) {
+                debug(3) << "The shape of " << param.name() << " is fixed by its constraints\n";
+                (*fixed_shapes)[param.name()] = shape;
+            }
+        }
+    }
+
+    // An output computed in place must either not share memory with
+    // the input, or be exactly the same buffer.
+    vector<Stmt> asserts_aliasing;
+    for (const auto &a : aliases) {
+        const Parameter &out = a.first, &in = a.second;
+        Expr out_host = Variable::make(Handle(), out.name(), Buffer<>(), out, ReductionDomain());
+        Expr in_host = Variable::make(Handle(), in.name(), Buffer<>(), in, ReductionDomain());
+        Expr same_layout = const_true();
+        for (int j = 0; j < out.dimensions(); j++) {
+            string dim = std::to_string(j);
+            for (const char *field : {".min.", ".stride."}) {
+                Expr out_var = Variable::make(Int(32), out.name() + field + dim, Buffer<>(), out, ReductionDomain());
+                Expr in_var = Variable::make(Int(32), in.name() + field + dim, Buffer<>(), in, ReductionDomain());
+                same_layout = same_layout && (out_var == in_var);
+            }
+        }
+        Expr error = Call::make(Int(32), "halide_error_bad_alias",
+                                {out.name(), in.name()}, Call::Extern);
+        asserts_aliasing.push_back(AssertStmt::make(out_host != in_host || same_layout, error));
+    }
+
     // Inject the code that checks the host pointers.
     if (!no_asserts) {
+        for (size_t i = asserts_aliasing.size(); i > 0; i--) {
+            s = Block::make(asserts_aliasing[i-1], s);
+        }
         for (size_t i = asserts_host_non_null.size(); i > 0; i--) {
             s = Block::make(asserts_host_non_null[i-1], s);
         }
@@ -590,19 +790,17 @@ Stmt add_image_checks(Stmt s,
     // prepending code.
 
     if (!no_asserts) {
-        // Inject the code that checks the constraints are correct.
-        for (size_t i = asserts_constrained.size(); i > 0; i--) {
-            s = Block::make(asserts_constrained[i-1], s);
-        }
-
-        // Inject the code that checks for out-of-bounds access to the buffers.
-        for (size_t i = asserts_required.size(); i > 0; i--) {
-            s = Block::make(asserts_required[i-1], s);
-        }
-
-        // Inject the code that checks that elem_sizes are ok.
-        for (size_t i = asserts_elem_size.size(); i > 0; i--) {
-            s = Block::make(asserts_elem_size[i-1], s);
+        // Inject the code that checks that elem_sizes are ok, then
+        // checks for out-of-bounds access to the buffers, then checks
+        // the constraints are correct. These are all comparisons of
+        // the fields of the buffers, so they are made with a single
+        // branch, and only checked one by one when one of them fails.
+        vector<Stmt> checks = asserts_elem_size;
+        checks.insert(checks.end(), asserts_required.begin(), asserts_required.end());
+        checks.insert(checks.end(), asserts_constrained.begin(), asserts_constrained.end());
+        Stmt combined = combine_asserts(checks);
+        if (combined.defined()) {
+            s = Block::make(combined, s);
         }
     }
 
@@ -20,14 +20,24 @@ namespace Internal {
 
 /** Insert checks to make sure a statement doesn't read out of bounds
  * on inputs or outputs, and that the inputs and outputs conform to
- * the format required (e.g. stride.0 must be 1).
+ * the format required (e.g. stride.0 must be 1). If fixed_shapes is
+ * non-null, it is filled in with the shape a bounds query proposes
+ * for each buffer argument whose shape is fixed by the constraints,
+ * keyed by the name of the argument.
  */
 Stmt add_image_checks(Stmt s,
                       const std::vector<Function> &outputs,
                       const Target &t,
                       const std::vector<std::string> &order,
                       const std::map<std::string, Function> &env,
-                      const FuncValueBounds &fb);
+                      const FuncValueBounds &fb,
+                      std::map<std::string, std::vector<halide_dimension_t>> *fixed_shapes = nullptr);
+
+/** Make a statement that checks a list of AssertStmts with a single
+ * branch on whether they all pass, and only evaluates them one at a
+ * time, in order, if one of them fails. Returns an undefined Stmt if
+ * the list is empty. */
+Stmt combine_asserts(const std::vector<Stmt> &asserts);
 
 
 }
@@ -1,4 +1,5 @@
 #include "AddParameterChecks.h"
+#include "AddImageChecks.h"
 #include "IRVisitor.h"
 #include "Substitute.h"
 #include "Target.h"
@@ -94,9 +95,11 @@ Stmt add_parameter_checks(Stmt s, const Target &t) {
         asserts.clear();
     }
 
-    // Inject the assert statements
-    for (size_t i = 0; i < asserts.size(); i++) {
-        ParamAssert p = asserts[i];
+    // Inject the assert statements, behind a single branch on whether
+    // they all pass.
+    vector<Stmt> checks;
+    for (size_t i = asserts.size(); i > 0; i--) {
+        ParamAssert p = asserts[i-1];
         // Upgrade the types to 64-bit versions for the error call
         Type wider = p.value.type().with_bits(64);
         p.limit_value = cast(wider, p.limit_value);
@@ -124,7 +127,11 @@ Stmt add_parameter_checks(Stmt s, const Target &t) {
                                 {p.param_name, p.value, p.limit_value},
                                 Call::Extern);
 
-        s = Block::make(AssertStmt::make(p.condition, error), s);
+        checks.push_back(AssertStmt::make(p.condition, error));
+    }
+    Stmt combined = combine_asserts(checks);
+    if (combined.defined()) {
+        s = Block::make(combined, s);
     }
 
     return s;
@@ -0,0 +1,319 @@
+#include "AffectedRegion.h"
+#include "Bounds.h"
+#include "ExprUsesVar.h"
+#include "FindCalls.h"
+#include "IREquality.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+#include "Monotonic.h"
+#include "RealizationOrder.h"
+#include "Simplify.h"
+#include "Substitute.h"
+#include "Util.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::string;
+using std::vector;
+
+namespace {
+
+void add_definition_footprint(const Definition &def, const Scope<Interval> &scope,
+                              map<string, Box> &required) {
+    Scope<Interval> inner;
+    inner.set_containing_scope(&scope);
+    for (const ReductionVariable &rv : def.schedule().rvars()) {
+        inner.push(rv.var, Interval(rv.min, simplify(rv.min + rv.extent - 1)));
+    }
+    vector<Expr> exprs = def.args();
+    exprs.insert(exprs.end(), def.values().begin(), def.values().end());
+    if (def.predicate().defined()) {
+        exprs.push_back(def.predicate());
+    }
+    for (const Expr &e : exprs) {
+        for (const auto &b : boxes_required(e, inner)) {
+            merge_boxes(required[b.first], b.second);
+        }
+    }
+    for (const Specialization &s : def.specializations()) {
+        add_definition_footprint(s.definition, inner, required);
+    }
+}
+
+// Replace references to the dimensions of bound buffers and to the
+// values of scalar parameters with the values they currently have.
+class SubstituteParamValues : public IRMutator {
+    using IRMutator::visit;
+
+    Buffer<> buffer_of(const Variable *op) {
+        if (op->image.defined()) {
+            return op->image;
+        } else if (op->param.defined() && op->param.is_buffer()) {
+            return op->param.get_buffer();
+        }
+        return Buffer<>();
+    }
+
+    void visit(const Variable *op) {
+        Buffer<> b = buffer_of(op);
+        if (b.defined()) {
+            string prefix = b.name() + ".";
+            if (op->param.defined()) {
+                prefix = op->param.name() + ".";
+            }
+            if (starts_with(op->name, prefix)) {
+                string rest = op->name.substr(prefix.size());
+                for (int d = 0; d < b.dimensions(); d++) {
+                    string dim = "." + std::to_string(d);
+                    if (rest == "min" + dim) {
+                        expr = b.dim(d).min();
+                        return;
+                    } else if (rest == "extent" + dim) {
+                        expr = b.dim(d).extent();
+                        return;
+                    } else if (rest == "stride" + dim) {
+                        expr = b.dim(d).stride();
+                        return;
+                    }
+                }
+            }
+        } else if (op->param.defined() && !op->param.is_buffer()) {
+            expr = op->param.get_scalar_expr();
+            return;
+        }
+        expr = op;
+    }
+};
+
+// Evaluate a footprint bound at the given site, or return false if it
+// doesn't reduce to a constant.
+bool evaluate_at(Expr e, const string &var, int64_t site, int64_t *result) {
+    e = substitute(var, make_const(Int(32), site), e);
+    e = simplify(SubstituteParamValues().mutate(e));
+    const int64_t *i = as_const_int(e);
+    if (i) {
+        *result = *i;
+    }
+    return i != nullptr;
+}
+
+// Find the sites in [out_min, out_max] whose footprint [lo(x), hi(x)]
+// overlaps [d_min, d_max], for footprints that are non-decreasing in
+// x (such as stencils with clamped coordinates), by binary search.
+Range search_affected_sites(Expr lo, Expr hi, const string &var,
+                            int64_t out_min, int64_t out_max,
+                            int64_t d_min, int64_t d_max) {
+    // The first site with hi(x) >= d_min...
+    int64_t a = out_min, b = out_max + 1;
+    while (a < b) {
+        int64_t mid = a + (b - a) / 2, v;
+        if (!evaluate_at(hi, var, mid, &v)) {
+            return Range();
+        }
+        if (v >= d_min) {
+            b = mid;
+        } else {
+            a = mid + 1;
+        }
+    }
+    const int64_t first = a;
+    // ...and the first site with lo(x) > d_max.
+    a = out_min;
+    b = out_max + 1;
+    while (a < b) {
+        int64_t mid = a + (b - a) / 2, v;
+        if (!evaluate_at(lo, var, mid, &v)) {
+            return Range();
+        }
+        if (v > d_max) {
+            b = mid;
+        } else {
+            a = mid + 1;
+        }
+    }
+    const int64_t end = a;
+    return Range(make_const(Int(32), first), make_const(Int(32), std::max(end - first, (int64_t)0)));
+}
+
+bool is_non_decreasing(Expr e, const string &var) {
+    Monotonic m = is_monotonic(e, var);
+    return m == Monotonic::Constant || m == Monotonic::Increasing;
+}
+
+}  // namespace
+
+bool site_footprint(Function output, const vector<Expr> &site, map<string, Box> &required) {
+    map<string, Function> env = find_transitive_calls(output);
+    vector<string> order = realization_order({output}, env);
+
+    Box seed;
+    for (const Expr &e : site) {
+        seed.push_back(Interval(e, e));
+    }
+    required[output.name()] = seed;
+
+    for (auto it = order.rbegin(); it != order.rend(); it++) {
+        auto r = required.find(*it);
+        if (r == required.end()) {
+            continue;
+        }
+        Function f = env.at(*it);
+        if (f.has_extern_definition()) {
+            return false;
+        }
+        const Box box = r->second;
+        const vector<string> args = f.args();
+        if (box.size() != args.size()) {
+            return false;
+        }
+
+        Scope<Interval> scope;
+        for (size_t i = 0; i < args.size(); i++) {
+            scope.push(args[i], box[i]);
+        }
+
+        // An update that writes to sites other than the one being
+        // computed, or that reads other sites of the same Func, lets
+        // values flow between sites, which a footprint of one site
+        // doesn't capture.
+        for (const Definition &u : f.updates()) {
+            for (size_t i = 0; i < args.size(); i++) {
+                const Variable *v = u.args()[i].as<Variable>();
+                if (!v || v->name != args[i]) {
+                    return false;
+                }
+            }
+        }
+
+        map<string, Box> from_f;
+        add_definition_footprint(f.definition(), scope, from_f);
+        for (const Definition &u : f.updates()) {
+            add_definition_footprint(u, scope, from_f);
+        }
+
+        for (auto &b : from_f) {
+            if (b.first == f.name()) {
+                const Box &self = b.second;
+                for (size_t i = 0; i < self.size(); i++) {
+                    if (!self[i].is_bounded() ||
+                        !equal(simplify(self[i].min), simplify(box[i].min)) ||
+                        !equal(simplify(self[i].max), simplify(box[i].max))) {
+                        return false;
+                    }
+                }
+                continue;
+            }
+            merge_boxes(required[b.first], b.second);
+        }
+    }
+    return true;
+}
+
+Region affected_region(const vector<Function> &outputs,
+                       const string &input,
+                       const Region &dirty,
+                       const Region &output_bounds) {
+    internal_assert(!outputs.empty());
+    const int dims = outputs[0].dimensions();
+    Region result(dims);
+    bool first = true;
+
+    for (Function output : outputs) {
+        user_assert(output.dimensions() == dims)
+            << "Can't compute the region of the outputs affected by a change to "
+            << input << ", because the outputs have different dimensionalities\n";
+
+        vector<Expr> site;
+        for (int i = 0; i < dims; i++) {
+            site.push_back(Variable::make(Int(32), unique_name(output.name() + ".affected." + std::to_string(i))));
+        }
+
+        map<string, Box> required;
+        Region region(dims);
+        if (site_footprint(output, site, required)) {
+            auto it = required.find(input);
+            if (it == required.end()) {
+                // This output doesn't read the input at all.
+                continue;
+            }
+            const Box &box = it->second;
+            user_assert(box.size() == dirty.size())
+                << "The dirty region of " << input << " has " << dirty.size()
+                << " dimensions, but " << input << " has " << box.size() << "\n";
+            for (int i = 0; i < std::min(dims, (int)box.size()); i++) {
+                if (!box[i].is_bounded()) {
+                    continue;
+                }
+                // The offsets of the footprint in this dimension from
+                // the site, which must not depend on the site.
+                Expr lo = simplify(box[i].min - site[i]);
+                Expr hi = simplify(box[i].max - site[i]);
+                const string &var = site[i].as<Variable>()->name;
+                bool uses_site = false, uses_other_sites = false;
+                for (const Expr &s : site) {
+                    const string &name = s.as<Variable>()->name;
+                    bool uses = expr_uses_var(lo, name) || expr_uses_var(hi, name);
+                    uses_site |= uses;
+                    uses_other_sites |= uses && name != var;
+                }
+                if (!uses_site) {
+                    // A site x reads [x + lo, x + hi], so it's affected if
+                    // that overlaps [dirty.min, dirty.min + dirty.extent - 1].
+                    region[i] = Range(simplify(dirty[i].min - hi),
+                                      simplify(dirty[i].extent + hi - lo));
+                    continue;
+                }
+
+                // Otherwise, if we know the extent of the outputs and
+                // the footprint grows with the site, search for the
+                // affected sites.
+                if (uses_other_sites || i >= (int)output_bounds.size() ||
+                    !output_bounds[i].min.defined()) {
+                    continue;
+                }
+                Expr fp_min = simplify(box[i].min), fp_max = simplify(box[i].max);
+                if (!is_non_decreasing(fp_min, var) || !is_non_decreasing(fp_max, var)) {
+                    continue;
+                }
+                const int64_t *out_min = as_const_int(output_bounds[i].min);
+                const int64_t *out_extent = as_const_int(output_bounds[i].extent);
+                const int64_t *d_min = as_const_int(simplify(dirty[i].min));
+                const int64_t *d_extent = as_const_int(simplify(dirty[i].extent));
+                if (!out_min || !out_extent || !d_min || !d_extent) {
+                    continue;
+                }
+                region[i] = search_affected_sites(fp_min, fp_max, var,
+                                                  *out_min, *out_min + *out_extent - 1,
+                                                  *d_min, *d_min + *d_extent - 1);
+            }
+        }
+
+        if (first) {
+            result = region;
+            first = false;
+            continue;
+        }
+        for (int i = 0; i < dims; i++) {
+            if (!result[i].min.defined() || !region[i].min.defined()) {
+                result[i] = Range();
+            } else {
+                Expr min_val = min(result[i].min, region[i].min);
+                Expr max_val = max(result[i].min + result[i].extent, region[i].min + region[i].extent);
+                result[i] = Range(simplify(min_val), simplify(max_val - min_val));
+            }
+        }
+    }
+
+    if (first) {
+        // None of the outputs read the input, so nothing is affected.
+        for (int i = 0; i < dims; i++) {
+            result[i] = Range(0, 0);
+        }
+    }
+    return result;
+}
+
+}
+}
@@ -0,0 +1,49 @@
+#ifndef HALIDE_AFFECTED_REGION_H
+#define HALIDE_AFFECTED_REGION_H
+
+/** \file
+ * Defines an analysis to find which part of the outputs of a pipeline
+ * a change to part of one of its inputs can affect.
+ */
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Function.h"
+#include "IR.h"
+#include "Bounds.h"
+
+namespace Halide {
+namespace Internal {
+
+/** Compute the box of each Func and input that the value of a single
+ * site of an output depends on, in terms of the given coordinates of
+ * the site. Returns false if some Func the output depends on can't be
+ * analyzed this way: extern stages, and update definitions that move
+ * values between sites. */
+bool site_footprint(Function output, const std::vector<Expr> &site,
+                    std::map<std::string, Box> &required);
+
+/** Compute a region of the outputs of a pipeline that contains every
+ * site whose value may change when the values of the named input (an
+ * ImageParam, Buffer, or Func) change over the given region. This
+ * inverts the footprint that bounds inference computes for a single
+ * output site: a dimension of the outputs is only narrowed if the
+ * same dimension of the input is read at a constant offset from it
+ * (as stencils do), or, if output_bounds gives the extent of the
+ * outputs in that dimension, if the footprint of a site grows with
+ * the site (as it does for stencils with clamped coordinates), in
+ * which case the affected sites are found numerically. Other
+ * dimensions are left undefined, meaning the whole extent of the
+ * outputs. All the outputs are assumed to share one coordinate
+ * system, so the result is the union over them. */
+Region affected_region(const std::vector<Function> &outputs,
+                       const std::string &input,
+                       const Region &dirty,
+                       const Region &output_bounds = Region());
+
+}
+}
+
+#endif
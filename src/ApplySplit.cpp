@@ -1,4 +1,5 @@
 #include "ApplySplit.h"
+#include "IROperator.h"
 #include "Simplify.h"
 #include "Substitute.h"
 
@@ -9,6 +10,27 @@ using std::map;
 using std::string;
 using std::vector;
 
+namespace {
+
+// Gather the even bits of a non-negative 32-bit integer into its low
+// 16 bits.
+Expr compact_even_bits(Expr x) {
+    x = x & 0x55555555;
+    x = (x | (x >> 1)) & 0x33333333;
+    x = (x | (x >> 2)) & 0x0f0f0f0f;
+    x = (x | (x >> 4)) & 0x00ff00ff;
+    x = (x | (x >> 8)) & 0x0000ffff;
+    return x;
+}
+
+// The number of bits needed to count up to an extent, or zero for
+// extents of one or less.
+Expr ceil_log2(Expr extent) {
+    return 32 - count_leading_zeros(max(extent, 1) - 1);
+}
+
+}
+
 vector<ApplySplitResult> apply_split(const Split &split, bool is_update, string prefix,
                                      map<string, Expr> &dim_extent_alignment) {
     vector<ApplySplitResult> result;
@@ -47,7 +69,8 @@ vector<ApplySplitResult> apply_split(const Split &split, bool is_update, string
         } else if (is_one(split.factor)) {
             // The split factor trivially divides the old extent,
             // but we know nothing new about the outer dimension.
-        } else if (tail == TailStrategy::GuardWithIf) {
+        } else if (tail == TailStrategy::GuardWithIf ||
+                   tail == TailStrategy::Predicate) {
             // It's an exact split but we failed to prove that the
             // extent divides the factor. Use predication.
 
@@ -64,7 +87,10 @@ vector<ApplySplitResult> apply_split(const Split &split, bool is_update, string
                 prefix + split.old_var, rebased_var + old_min, ApplySplitResult::Substitution));
 
             // Tell Halide to optimize for the case in which this
-            // condition is true by partitioning some outer loop.
+            // condition is true by partitioning some outer loop. For
+            // TailStrategy::Predicate, vectorize_loops turns what's
+            // left of the if in the tail into predicated loads and
+            // stores.
             Expr cond = likely(rebased_var < old_extent);
             result.push_back(ApplySplitResult(cond));
             result.push_back(ApplySplitResult(rebased_var_name, rebased, ApplySplitResult::LetStmt));
@@ -89,6 +115,44 @@ vector<ApplySplitResult> apply_split(const Split &split, bool is_update, string
         result.push_back(ApplySplitResult(old_var_name, base_var + inner, ApplySplitResult::LetStmt));
         result.push_back(ApplySplitResult(base_name, base, ApplySplitResult::LetStmt));
 
+    } else if (split.is_fuse() && split.z_order) {
+        // Take the inner and outer from the even and odd bits of the
+        // fused var. Whichever has the larger power of two extent
+        // also gets the bits above those shared with the other.
+        Expr fused = Variable::make(Int(32), prefix + split.old_var);
+        Expr inner_min = Variable::make(Int(32), prefix + split.inner + ".loop_min");
+        Expr outer_min = Variable::make(Int(32), prefix + split.outer + ".loop_min");
+        Expr inner_extent = Variable::make(Int(32), prefix + split.inner + ".loop_extent");
+        Expr outer_extent = Variable::make(Int(32), prefix + split.outer + ".loop_extent");
+        Expr inner_bits = Variable::make(Int(32), prefix + split.old_var + ".inner_bits");
+        Expr outer_bits = Variable::make(Int(32), prefix + split.old_var + ".outer_bits");
+
+        Expr shared_bits = min(inner_bits, outer_bits);
+        Expr interleaved = fused & ((1 << (2 * shared_bits)) - 1);
+        Expr rest = fused >> (2 * shared_bits);
+        Expr inner = compact_even_bits(interleaved) |
+            (select(inner_bits > outer_bits, rest, 0) << shared_bits);
+        Expr outer = compact_even_bits(interleaved >> 1) |
+            (select(inner_bits > outer_bits, 0, rest) << shared_bits);
+
+        string inner_name = prefix + split.inner + ".z_order";
+        string outer_name = prefix + split.outer + ".z_order";
+        Expr inner_var = Variable::make(Int(32), inner_name);
+        Expr outer_var = Variable::make(Int(32), outer_name);
+
+        // Clamp the coordinates so that anything computed at the
+        // fused loop level stays in bounds, and skip the iterations
+        // outside the original extents.
+        Expr clamped_inner = clamp(inner_var, 0, max(inner_extent, 1) - 1) + inner_min;
+        Expr clamped_outer = clamp(outer_var, 0, max(outer_extent, 1) - 1) + outer_min;
+
+        result.push_back(ApplySplitResult(prefix + split.inner, clamped_inner, ApplySplitResult::Substitution));
+        result.push_back(ApplySplitResult(prefix + split.outer, clamped_outer, ApplySplitResult::Substitution));
+        result.push_back(ApplySplitResult(likely(inner_var < inner_extent && outer_var < outer_extent)));
+        result.push_back(ApplySplitResult(prefix + split.inner, clamped_inner, ApplySplitResult::LetStmt));
+        result.push_back(ApplySplitResult(prefix + split.outer, clamped_outer, ApplySplitResult::LetStmt));
+        result.push_back(ApplySplitResult(inner_name, inner, ApplySplitResult::LetStmt));
+        result.push_back(ApplySplitResult(outer_name, outer, ApplySplitResult::LetStmt));
     } else if (split.is_fuse()) {
         // Define the inner and outer in terms of the fused var
         Expr fused = Variable::make(Int(32), prefix + split.old_var);
@@ -146,6 +210,19 @@ vector<std::pair<string, Expr>> compute_loop_bounds_after_split(const Split &spl
         let_stmts.push_back({ prefix + split.outer + ".loop_min", 0 });
         let_stmts.push_back({ prefix + split.outer + ".loop_max", outer_extent-1 });
         let_stmts.push_back({ prefix + split.outer + ".loop_extent", outer_extent });
+    } else if (split.is_fuse() && split.z_order) {
+        // The fused var covers the smallest power of two square or
+        // rectangle containing the inner and outer extents.
+        Expr inner_extent = Variable::make(Int(32), prefix + split.inner + ".loop_extent");
+        Expr outer_extent = Variable::make(Int(32), prefix + split.outer + ".loop_extent");
+        Expr inner_bits = Variable::make(Int(32), prefix + split.old_var + ".inner_bits");
+        Expr outer_bits = Variable::make(Int(32), prefix + split.old_var + ".outer_bits");
+        Expr fused_extent = 1 << (inner_bits + outer_bits);
+        let_stmts.push_back({ prefix + split.old_var + ".loop_min", 0 });
+        let_stmts.push_back({ prefix + split.old_var + ".loop_max", fused_extent - 1 });
+        let_stmts.push_back({ prefix + split.old_var + ".loop_extent", fused_extent });
+        let_stmts.push_back({ prefix + split.old_var + ".inner_bits", ceil_log2(inner_extent) });
+        let_stmts.push_back({ prefix + split.old_var + ".outer_bits", ceil_log2(outer_extent) });
     } else if (split.is_fuse()) {
         // Define bounds on the fused var using the bounds on the inner and outer
         Expr inner_extent = Variable::make(Int(32), prefix + split.inner + ".loop_extent");
@@ -0,0 +1,58 @@
+#include "ArithmeticIntrinsics.h"
+#include "IROperator.h"
+
+namespace Halide {
+namespace Internal {
+
+namespace {
+
+Type widen(Type t) {
+    return t.with_bits(t.bits() * 2);
+}
+
+}
+
+bool is_arithmetic_intrinsic(const Call *op) {
+    return (op->is_intrinsic(Call::saturating_add) ||
+            op->is_intrinsic(Call::saturating_sub) ||
+            op->is_intrinsic(Call::halving_add) ||
+            op->is_intrinsic(Call::rounding_halving_add) ||
+            op->is_intrinsic(Call::rounding_shift_right) ||
+            op->is_intrinsic(Call::widening_mul));
+}
+
+Expr lower_arithmetic_intrinsic(const Call *op) {
+    internal_assert(is_arithmetic_intrinsic(op));
+    internal_assert(op->args.size() == 2);
+    Expr a = op->args[0], b = op->args[1];
+    Type t = a.type();
+    internal_assert(t == b.type() && (t.is_int() || t.is_uint()) && t.bits() <= 32);
+    Type w = widen(t);
+
+    if (op->is_intrinsic(Call::saturating_add)) {
+        return saturating_cast(t, cast(w, a) + cast(w, b));
+    } else if (op->is_intrinsic(Call::saturating_sub)) {
+        if (t.is_uint()) {
+            // The difference of two unsigned values needs a signed
+            // type, but can only saturate at zero.
+            Type ws = w.with_code(Type::Int);
+            return cast(t, max(cast(ws, a) - cast(ws, b), 0));
+        } else {
+            return saturating_cast(t, cast(w, a) - cast(w, b));
+        }
+    } else if (op->is_intrinsic(Call::halving_add)) {
+        return cast(t, (cast(w, a) + cast(w, b)) / 2);
+    } else if (op->is_intrinsic(Call::rounding_halving_add)) {
+        return cast(t, (cast(w, a) + cast(w, b) + 1) / 2);
+    } else if (op->is_intrinsic(Call::rounding_shift_right)) {
+        Expr shift = cast(w, b);
+        Expr half = (make_one(w) << shift) >> 1;
+        return cast(t, (cast(w, a) + half) >> shift);
+    } else {
+        internal_assert(op->is_intrinsic(Call::widening_mul));
+        return cast(w, a) * cast(w, b);
+    }
+}
+
+}
+}
@@ -0,0 +1,27 @@
+#ifndef HALIDE_ARITHMETIC_INTRINSICS_H
+#define HALIDE_ARITHMETIC_INTRINSICS_H
+
+/** \file
+ * Defines methods for converting the saturating, halving, rounding
+ * and widening arithmetic intrinsics into Halide IR.
+ */
+
+#include "IR.h"
+
+namespace Halide {
+namespace Internal {
+
+/** Is the call one of saturating_add, saturating_sub, halving_add,
+ * rounding_halving_add, rounding_shift_right or widening_mul. */
+EXPORT bool is_arithmetic_intrinsic(const Call *op);
+
+/** Build Halide IR that computes one of the intrinsics above using
+ * wider integer types. The IR is written in the form the backends
+ * pattern match to single instructions, so backends without a better
+ * lowering can just codegen the result. */
+EXPORT Expr lower_arithmetic_intrinsic(const Call *op);
+
+}
+}
+
+#endif
@@ -0,0 +1,342 @@
+#include <algorithm>
+
+#include "AsyncProducers.h"
+#include "ExprUsesVar.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+#include "Function.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::set;
+using std::string;
+using std::vector;
+
+namespace {
+
+// Find the Funcs produced directly by a loop body, rather than by a
+// loop or a producer nested inside it.
+class FindProducersAtLoopLevel : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const For *op) {
+    }
+
+    void visit(const ProducerConsumer *op) {
+        if (op->is_producer) {
+            if (std::find(producers.begin(), producers.end(), op->name) == producers.end()) {
+                producers.push_back(op->name);
+            }
+        } else {
+            IRVisitor::visit(op);
+        }
+    }
+
+public:
+    vector<string> producers;
+};
+
+// Find all the Funcs produced or realized anywhere in a statement.
+class FindProducersAndRealizations : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const ProducerConsumer *op) {
+        if (op->is_producer) {
+            producers.insert(op->name);
+        }
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Realize *op) {
+        realizations.insert(op->name);
+        IRVisitor::visit(op);
+    }
+
+public:
+    set<string> producers, realizations;
+};
+
+// Check if a statement uses the values of a Func outside of its
+// produce nodes.
+class UsesFunc : public IRVisitor {
+    const string &func;
+
+    using IRVisitor::visit;
+
+    void visit(const ProducerConsumer *op) {
+        if (!(op->is_producer && op->name == func)) {
+            IRVisitor::visit(op);
+        }
+    }
+
+    void visit(const Call *op) {
+        if (op->call_type == Call::Halide && op->name == func) {
+            result = true;
+        } else {
+            IRVisitor::visit(op);
+        }
+    }
+
+    void visit(const Variable *op) {
+        // Extern consumers refer to the buffer instead.
+        if (op->name == func + ".buffer") {
+            result = true;
+        }
+    }
+
+public:
+    bool result = false;
+
+    UsesFunc(const string &func) : func(func) {}
+};
+
+bool uses_func(Stmt s, const string &func) {
+    UsesFunc u(func);
+    s.accept(&u);
+    return u.result;
+}
+
+// Make one of the two tasks of a fork from the body of the loop an
+// async Func is computed in. The producer task keeps the produce node
+// of the Func, and releases the semaphore after it. The consumer task
+// waits on the semaphore instead of producing the Func. Each keeps
+// its own half of the calls on the folding semaphore, if any.
+class GenerateTask : public IRMutator {
+    const string &func;
+    bool producer_task;
+    Expr semaphore;
+
+    using IRMutator::visit;
+
+    bool is_folding_semaphore_call(Expr e, const string &fn) {
+        const Call *call = e.as<Call>();
+        if (!call || call->name != fn || call->args.empty()) {
+            return false;
+        }
+        const Variable *sema = call->args[0].as<Variable>();
+        return sema && starts_with(sema->name, func + ".folding_semaphore.");
+    }
+
+    void visit(const For *op) {
+        // Loops nested inside the body belong wholly to one of the
+        // produce or consume nodes at this level.
+        stmt = op;
+    }
+
+    void visit(const ProducerConsumer *op) {
+        if (op->name == func) {
+            if (op->is_producer && producer_task) {
+                Expr release = Call::make(Int(32), "halide_semaphore_release",
+                                          {semaphore, 1}, Call::Extern);
+                stmt = Block::make(op, Evaluate::make(release));
+            } else if (op->is_producer) {
+                string result_name = unique_name('t');
+                Expr result = Variable::make(Int(32), result_name);
+                Expr acquire = Call::make(Int(32), "halide_semaphore_acquire",
+                                          {semaphore, 1}, Call::Extern);
+                stmt = LetStmt::make(result_name, acquire,
+                                     AssertStmt::make(result == 0, result));
+            } else if (producer_task) {
+                stmt = Evaluate::make(0);
+            } else {
+                stmt = op;
+            }
+        } else if (op->is_producer) {
+            // Whether other producers at this level are needed is
+            // decided once the whole task is built.
+            stmt = op;
+        } else {
+            IRMutator::visit(op);
+        }
+    }
+
+    void visit(const LetStmt *op) {
+        if (!producer_task && is_folding_semaphore_call(op->value, "halide_semaphore_acquire")) {
+            stmt = Evaluate::make(0);
+        } else {
+            IRMutator::visit(op);
+        }
+    }
+
+    void visit(const Evaluate *op) {
+        if (producer_task && is_folding_semaphore_call(op->value, "halide_semaphore_release")) {
+            stmt = Evaluate::make(0);
+        } else {
+            stmt = op;
+        }
+    }
+
+public:
+    GenerateTask(const string &func, bool producer_task, Expr semaphore)
+        : func(func), producer_task(producer_task), semaphore(semaphore) {}
+};
+
+// Remove the produce nodes of the other Funcs computed at the loop
+// level of a task that the task doesn't use.
+class RemoveUnusedProducers : public IRMutator {
+    const string &func;
+    Stmt task;
+
+    using IRMutator::visit;
+
+    void visit(const For *op) {
+        stmt = op;
+    }
+
+    void visit(const ProducerConsumer *op) {
+        if (op->is_producer && op->name != func) {
+            if (uses_func(task, op->name)) {
+                kept.push_back(op->name);
+                stmt = op;
+            } else {
+                stmt = Evaluate::make(0);
+            }
+        } else if (op->is_producer) {
+            stmt = op;
+        } else {
+            IRMutator::visit(op);
+        }
+    }
+
+public:
+    vector<string> kept;
+
+    RemoveUnusedProducers(const string &func, Stmt task) : func(func), task(task) {}
+};
+
+Stmt remove_unused_producers(const string &func, Stmt task, vector<string> *kept) {
+    // Removing one producer can make the ones it uses unused too.
+    while (true) {
+        RemoveUnusedProducers remover(func, task);
+        Stmt new_task = remover.mutate(task);
+        if (new_task.same_as(task)) {
+            *kept = remover.kept;
+            return task;
+        }
+        task = new_task;
+    }
+}
+
+class ForkAsyncProducers : public IRMutator {
+    const map<string, Function> &env;
+
+    using IRMutator::visit;
+
+    void visit(const For *op) {
+        Stmt body = mutate(op->body);
+
+        FindProducersAtLoopLevel finder;
+        body.accept(&finder);
+        vector<string> async_funcs;
+        for (const string &name : finder.producers) {
+            auto it = env.find(name);
+            if (it != env.end() && it->second.schedule().async()) {
+                async_funcs.push_back(name);
+            }
+        }
+
+        if (async_funcs.empty()) {
+            if (body.same_as(op->body)) {
+                stmt = op;
+            } else {
+                stmt = For::make(op->name, op->min, op->extent, op->for_type, op->device_api, body);
+            }
+            return;
+        }
+
+        const string &func = async_funcs[0];
+        user_assert(async_funcs.size() == 1)
+            << "Funcs " << async_funcs[0] << " and " << async_funcs[1]
+            << " are both scheduled async, and computed at the same loop level ("
+            << op->name << "). Only one of them may be.\n";
+        user_assert(op->for_type == ForType::Serial || op->for_type == ForType::Unrolled)
+            << "Func " << func << " is scheduled async, but is computed in the loop "
+            << op->name << ", which is not serial.\n";
+
+        FindProducersAndRealizations realizations;
+        body.accept(&realizations);
+        user_assert(!realizations.realizations.count(func))
+            << "Func " << func << " is scheduled async, but is stored at the same loop level "
+            << "it is computed at (" << op->name << "). Its storage must be hoisted outside "
+            << "of that loop (e.g. with store_root) so that the producer can run ahead of "
+            << "the consumer.\n";
+
+        string semaphore_name = func + ".semaphore." + op->name;
+        Expr semaphore = Variable::make(Handle(), semaphore_name);
+        string folding_semaphore_name = func + ".folding_semaphore." + op->name;
+        Expr folding_semaphore = Variable::make(Handle(), folding_semaphore_name);
+
+        vector<string> producer_needs, consumer_needs;
+        Stmt producer = GenerateTask(func, true, semaphore).mutate(body);
+        producer = remove_unused_producers(func, producer, &producer_needs);
+        Stmt consumer = GenerateTask(func, false, semaphore).mutate(body);
+        consumer = remove_unused_producers(func, consumer, &consumer_needs);
+
+        for (const string &f : producer_needs) {
+            user_assert(std::find(consumer_needs.begin(), consumer_needs.end(), f) == consumer_needs.end())
+                << "Func " << func << " is scheduled async, but " << f
+                << ", which is computed at the same loop level (" << op->name
+                << "), is used by it and by its consumer. Compute " << f
+                << " at a loop level of one of them.\n";
+        }
+
+        producer = For::make(op->name, op->min, op->extent, op->for_type, op->device_api, producer);
+        consumer = For::make(op->name, op->min, op->extent, op->for_type, op->device_api, consumer);
+
+        // Whichever way each task exits, it won't release any more,
+        // so it aborts the semaphore the other task waits on. Then if
+        // one of them fails, the other fails too instead of waiting
+        // forever.
+        Expr abort_semaphore =
+            Call::make(Int(32), Call::register_destructor,
+                       {Expr("halide_semaphore_abort_as_destructor"), semaphore}, Call::Intrinsic);
+        producer = Block::make(Evaluate::make(abort_semaphore), producer);
+        if (stmt_uses_var(consumer, folding_semaphore_name)) {
+            Expr abort_folding_semaphore =
+                Call::make(Int(32), Call::register_destructor,
+                           {Expr("halide_semaphore_abort_as_destructor"), folding_semaphore}, Call::Intrinsic);
+            consumer = Block::make(Evaluate::make(abort_folding_semaphore), consumer);
+        }
+
+        // The tasks must run concurrently, so the fork loop is lowered
+        // to a call to halide_do_fork rather than halide_do_par_for.
+        string fork_name = op->name + ".async_fork";
+        Expr fork_var = Variable::make(Int(32), fork_name);
+        stmt = IfThenElse::make(fork_var == 0, producer, consumer);
+        stmt = For::make(fork_name, 0, 2, ForType::Parallel, op->device_api, stmt);
+
+        Expr semaphore_init = Call::make(Handle(), Call::make_struct, {0, 0, 0, 0}, Call::Intrinsic);
+        stmt = LetStmt::make(semaphore_name, semaphore_init, stmt);
+
+        forked.insert(func);
+    }
+
+public:
+    set<string> forked;
+
+    ForkAsyncProducers(const map<string, Function> &env) : env(env) {}
+};
+
+}  // namespace
+
+Stmt fork_async_producers(Stmt s, const map<string, Function> &env) {
+    ForkAsyncProducers forker(env);
+    s = forker.mutate(s);
+
+    FindProducersAndRealizations producers;
+    s.accept(&producers);
+    for (const string &name : producers.producers) {
+        auto it = env.find(name);
+        user_assert(it == env.end() || !it->second.schedule().async() || forker.forked.count(name))
+            << "Func " << name << " is scheduled async, but is not computed inside a loop "
+            << "of its consumer. Compute it at a serial loop of its consumer (e.g. with "
+            << "compute_at), and store it outside of that loop (e.g. with store_root).\n";
+    }
+
+    return s;
+}
+
+}
+}
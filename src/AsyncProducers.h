@@ -0,0 +1,30 @@
+#ifndef HALIDE_ASYNC_PRODUCERS_H
+#define HALIDE_ASYNC_PRODUCERS_H
+
+/** \file
+ * Defines the lowering pass that runs producers scheduled with
+ * Func::async in a separate thread from their consumers.
+ */
+
+#include <map>
+
+#include "IR.h"
+
+namespace Halide {
+namespace Internal {
+
+/** Fork the loop each async Func is computed in into two loops that
+ * run concurrently: one that only produces the Func, and one that
+ * only consumes it. The consumer waits on a semaphore before each
+ * iteration until the producer has finished the same iteration. If
+ * storage folding gave the Func a semaphore tracking the free slots
+ * in its fold, the producer waits on that before each iteration, and
+ * the consumer releases slots after each one. Should be run after
+ * storage folding, and before anything that removes produce/consume
+ * nodes. */
+Stmt fork_async_producers(Stmt s, const std::map<std::string, Function> &env);
+
+}
+}
+
+#endif
@@ -1,13 +1,17 @@
 #include <algorithm>
+#include <chrono>
+#include <functional>
 #include <regex>
 
 #include "AutoSchedule.h"
 #include "AutoScheduleUtils.h"
+#include "Associativity.h"
 #include "ExprUsesVar.h"
 #include "FindCalls.h"
 #include "Func.h"
 #include "Inline.h"
 #include "IREquality.h"
+#include "IRVisitor.h"
 #include "ParallelRVar.h"
 #include "RealizationOrder.h"
 #include "RegionCosts.h"
@@ -836,6 +840,221 @@ struct AutoSchedule {
     }
 };
 
+// Times the pipeline on the host machine under candidate schedules, so that
+// the partitioner can compare its choices by measured run time rather than by
+// the analytic cost model. The schedules of all the functions are restored
+// after each measurement, and the measurements are cached by the text of the
+// schedule, as the search often arrives at the same schedule more than once.
+class PipelineBenchmark {
+    const vector<Function> &outputs;
+    const map<string, Function> &env;
+    const vector<string> &full_order;
+    map<string, double> measurements;
+
+    // Find the Params and ImageParams the pipeline uses.
+    class FindParameters : public IRVisitor {
+        using IRVisitor::visit;
+
+        void visit(const Variable *op) {
+            if (op->param.defined()) {
+                params.emplace(op->param.name(), op->param);
+            }
+        }
+
+        void visit(const Call *op) {
+            IRVisitor::visit(op);
+            if (op->param.defined()) {
+                params.emplace(op->param.name(), op->param);
+            }
+        }
+    public:
+        map<string, Parameter> params;
+    };
+
+    template<typename T>
+    static void store_scalar(void *addr, T val) {
+        memcpy(addr, &val, sizeof(T));
+    }
+
+    // Set a scalar parameter to the constant value 'e'. Returns false
+    // if 'e' isn't a constant.
+    static bool set_scalar(Parameter &param, Expr e) {
+        Type t = param.type();
+        e = simplify(cast(t, e));
+        void *addr = param.get_scalar_address();
+        if (const int64_t *i = as_const_int(e)) {
+            switch (t.bits()) {
+            case 8: store_scalar(addr, (int8_t)*i); return true;
+            case 16: store_scalar(addr, (int16_t)*i); return true;
+            case 32: store_scalar(addr, (int32_t)*i); return true;
+            case 64: store_scalar(addr, (int64_t)*i); return true;
+            }
+        } else if (const uint64_t *u = as_const_uint(e)) {
+            switch (t.bits()) {
+            case 1: store_scalar(addr, (bool)*u); return true;
+            case 8: store_scalar(addr, (uint8_t)*u); return true;
+            case 16: store_scalar(addr, (uint16_t)*u); return true;
+            case 32: store_scalar(addr, (uint32_t)*u); return true;
+            case 64: store_scalar(addr, (uint64_t)*u); return true;
+            }
+        } else if (const double *f = as_const_float(e)) {
+            switch (t.bits()) {
+            case 32: store_scalar(addr, (float)*f); return true;
+            case 64: store_scalar(addr, (double)*f); return true;
+            }
+        }
+        return false;
+    }
+
+    // Run the pipeline with its current schedules, and return the
+    // best of a few run times in seconds, or a negative value if the
+    // sizes of the outputs aren't known.
+    double run() {
+        vector<Buffer<>> output_buffers;
+        for (const Function &f : outputs) {
+            vector<int> mins, extents;
+            for (const string &arg : f.args()) {
+                const int64_t *min = nullptr, *extent = nullptr;
+                for (const Bound &b : f.schedule().estimates()) {
+                    if (b.var == arg) {
+                        min = as_const_int(b.min);
+                        extent = as_const_int(b.extent);
+                    }
+                }
+                if (!min || !extent) {
+                    return -1;
+                }
+                mins.push_back((int)*min);
+                extents.push_back((int)*extent);
+            }
+            for (Type t : f.output_types()) {
+                Buffer<> b(t, extents);
+                for (size_t d = 0; d < mins.size(); d++) {
+                    b.translate((int)d, mins[d]);
+                }
+                output_buffers.push_back(b);
+            }
+        }
+        Realization dst(output_buffers);
+
+        // Use the estimates as the values of scalar Params, and bind
+        // zero-filled buffers to any ImageParams that don't already
+        // have one. Both are undone afterwards.
+        FindParameters find;
+        for (const auto &iter : env) {
+            iter.second.accept(&find);
+        }
+        vector<pair<Parameter, vector<uint8_t>>> old_scalars;
+        vector<Parameter> unbound_buffers;
+        for (auto &iter : find.params) {
+            Parameter &param = iter.second;
+            if (param.is_buffer()) {
+                if (!param.get_buffer().defined()) {
+                    unbound_buffers.push_back(param);
+                }
+            } else if (param.get_estimate().defined()) {
+                const uint8_t *addr = (const uint8_t *)param.get_scalar_address();
+                vector<uint8_t> old_value(addr, addr + param.type().bytes());
+                if (set_scalar(param, param.get_estimate())) {
+                    old_scalars.push_back(make_pair(param, old_value));
+                }
+            }
+        }
+
+        vector<Func> funcs;
+        for (const Function &f : outputs) {
+            funcs.push_back(Func(f));
+        }
+        Pipeline p(funcs);
+        Target target = get_jit_target_from_environment();
+        p.compile_jit(target);
+        p.infer_input_bounds(dst);
+        for (Parameter &param : unbound_buffers) {
+            Buffer<> b = param.get_buffer();
+            memset(b.data(), 0, b.raw_buffer()->size_in_bytes());
+        }
+
+        // Run it once to warm up, then take the fastest of a few runs.
+        p.realize(dst, target);
+        double best = -1;
+        const int samples = 3;
+        for (int i = 0; i < samples; i++) {
+            auto start = std::chrono::steady_clock::now();
+            p.realize(dst, target);
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            if (best < 0 || elapsed.count() < best) {
+                best = elapsed.count();
+            }
+        }
+
+        for (Parameter &param : unbound_buffers) {
+            param.set_buffer(Buffer<>());
+        }
+        for (auto &s : old_scalars) {
+            memcpy(s.first.get_scalar_address(), s.second.data(), s.second.size());
+        }
+        return best;
+    }
+
+public:
+    // The target to generate schedules for. It must be runnable on
+    // the host.
+    const Target &target;
+
+    PipelineBenchmark(const vector<Function> &outputs, const map<string, Function> &env,
+                      const vector<string> &full_order, const Target &target)
+        : outputs(outputs), env(env), full_order(full_order), target(target) {}
+
+    // Schedule the pipeline with 'apply', and return the time in seconds
+    // it takes to run, or a negative value if it can't be measured.
+    double measure(const std::function<void(AutoSchedule &)> &apply) {
+        // The (shallow) copies of the schedules below are put back in
+        // place afterwards; scheduling only ever modifies the deep
+        // copies that replace them.
+        map<string, pair<FuncSchedule, vector<StageSchedule>>> saved;
+        for (const auto &iter : env) {
+            Function f = iter.second;
+            std::map<FunctionPtr, FunctionPtr> copied;
+            vector<StageSchedule> stages;
+            stages.push_back(f.definition().schedule());
+            f.definition().schedule() = stages.back().get_copy();
+            for (size_t u = 0; u < f.updates().size(); u++) {
+                stages.push_back(f.update(u).schedule());
+                f.update(u).schedule() = stages.back().get_copy();
+            }
+            saved.emplace(iter.first, make_pair(f.schedule(), stages));
+            f.schedule() = f.schedule().deep_copy(copied);
+        }
+
+        AutoSchedule sched(env, full_order);
+        apply(sched);
+        std::ostringstream oss;
+        oss << sched;
+        string key = oss.str();
+
+        double t;
+        const auto &iter = measurements.find(key);
+        if (iter != measurements.end()) {
+            t = iter->second;
+        } else {
+            t = run();
+            debug(3) << "Measured " << t * 1000 << " ms for schedule:\n" << key << "\n";
+            measurements.emplace(key, t);
+        }
+
+        for (const auto &iter : env) {
+            Function f = iter.second;
+            const auto &s = get_element(saved, iter.first);
+            f.schedule() = s.first;
+            f.definition().schedule() = s.second[0];
+            for (size_t u = 0; u < f.updates().size(); u++) {
+                f.update(u).schedule() = s.second[u + 1];
+            }
+        }
+        return t;
+    }
+};
+
 // Implement the grouping algorithm and the cost model for making the grouping
 // choices.
 struct Partitioner {
@@ -961,6 +1180,9 @@ struct Partitioner {
         // Estimate of the parallelism that can be exploited while computing
         // the group.
         Expr parallelism;
+        // The dimension of the group output along which the tiles of the group
+        // are computed with a sliding window, or empty if they aren't.
+        string sliding_dim;
 
         GroupAnalysis() : cost(Cost()) , parallelism(Expr()) {}
         GroupAnalysis(const Cost &c, Expr p) : cost(c), parallelism(std::move(p)) {}
@@ -1002,6 +1224,17 @@ struct Partitioner {
     // re-evaluated and caching them improves performance significantly.
     map<GroupingChoice, GroupConfig> grouping_cache;
 
+    // Cache of the analysis of each group that has been analyzed, keyed by
+    // the printed form of the group (its members, inlined functions and tile
+    // sizes). Unlike 'grouping_cache', entries never become stale, since they
+    // don't depend on the rest of the grouping.
+    map<string, GroupAnalysis> analysis_cache;
+
+    // When to give up searching for better groupings. Only meaningful if
+    // 'has_deadline' is set.
+    std::chrono::steady_clock::time_point deadline;
+    bool has_deadline = false;
+
     // Each group in the pipeline has a single output stage. A group is comprised
     // of function stages that are computed together in tiles (stages of a function
     // are always grouped together). 'groups' is the mapping from the output stage
@@ -1034,6 +1267,19 @@ struct Partitioner {
     RegionCosts &costs;
     // Output functions of the pipeline.
     const vector<Function> &outputs;
+    // If set, grouping and tiling choices are made by measuring the run
+    // time of the pipeline instead of by the analytic cost model. The
+    // analytic model is still used to rule out choices that aren't viable,
+    // and to decide which tile configurations are worth measuring.
+    PipelineBenchmark *benchmark = nullptr;
+    // Whether the tiles of a group may be computed with a sliding window
+    // (see \ref Partitioner::analyze_group). This isn't possible when the
+    // tiles are computed by different GPU blocks.
+    bool allow_sliding = true;
+    // Whether update stages may be rfactored (see \ref Partitioner::rfactor_stage).
+    // rfactor changes the definitions of the Funcs, not just their schedules, so
+    // it can't be undone after measuring a candidate schedule.
+    bool allow_rfactor = true;
 
     Partitioner(const map<string, Box> &_pipeline_bounds, const MachineParams &_arch_params,
                 DependenceAnalysis &_dep_analysis, RegionCosts &_costs,
@@ -1053,8 +1299,12 @@ struct Partitioner {
 
     // Given a grouping 'g', compute the estimated cost (arithmetic + memory) and
     // parallelism that can be potentially exploited when computing that group.
+    // The results are cached in 'analysis_cache'.
     GroupAnalysis analyze_group(const Group &g, bool show_analysis);
 
+    // Same as \ref Partitioner::analyze_group, without the cache.
+    GroupAnalysis compute_group_analysis(const Group &g, bool show_analysis);
+
     // For each group in the partition, return the regions of the producers
     // need to be allocated to compute a tile of the group's output.
     map<FStage, map<string, Box>> group_storage_bounds();
@@ -1078,6 +1328,29 @@ struct Partitioner {
     choose_candidate_grouping(const vector<pair<string, string>> &cands,
                               Partitioner::Level level);
 
+    // Same as \ref Partitioner::choose_candidate_grouping, but this returns all the
+    // choices with a positive estimated benefit along with that benefit, from the
+    // most beneficial to the least.
+    vector<pair<vector<pair<GroupingChoice, GroupConfig>>, Expr>>
+    rank_candidate_groupings(const vector<pair<string, string>> &cands,
+                             Partitioner::Level level);
+
+    // Return the producer and consumer pairs that may currently be grouped at
+    // 'level'.
+    vector<pair<string, string>> grouping_candidates(Partitioner::Level level);
+
+    // Merge the producer of the grouping choice 'best' into its consumers, and
+    // update the children mapping and the grouping cache accordingly.
+    void apply_grouping(const vector<pair<GroupingChoice, GroupConfig>> &best,
+                        Partitioner::Level level);
+
+    // Same as \ref Partitioner::group, but searches for the grouping by keeping
+    // the 'arch_params.beam_width' best partial groupings at each step.
+    void beam_group(Partitioner::Level level);
+
+    // Return true if the time budget for searching for a grouping has run out.
+    bool out_of_time() const;
+
     // Return the bounds required to produce a function stage.
     DimBounds get_bounds(const FStage &stg);
 
@@ -1116,6 +1389,19 @@ struct Partitioner {
     // groups within the pipeline.
     Cost get_pipeline_cost();
 
+    // Return the current grouping with 'g' replacing the groups of its members.
+    map<FStage, Group> grouping_with(const Group &g);
+
+    // Return the current grouping after merging the producer in 'grouping'
+    // into its consumers.
+    map<FStage, Group> grouping_with(const vector<pair<GroupingChoice, GroupConfig>> &grouping,
+                                     Partitioner::Level level);
+
+    // Return the measured run time in seconds of the pipeline scheduled
+    // according to 'candidate' instead of the current grouping, or a
+    // negative value if it can't be measured. Requires 'benchmark'.
+    double measure_grouping(const map<FStage, Group> &candidate);
+
     // Return the maximum access stride to allocation of 'func_acc' along any
     // loop variable specified in 'vars'. Access expressions along each dimension
     // of the allocation are specified by 'acc_exprs'. The dimension bounds of the
@@ -1156,6 +1442,44 @@ struct Partitioner {
                                      const set<string> &inlines,
                                      AutoSchedule &sched);
 
+    // Same as \ref Partitioner::generate_cpu_schedule, but this maps the
+    // groups onto a GPU. The tiles of each group output become GPU blocks,
+    // and the members of the group are computed per block (in shared memory)
+    // by the threads of the block.
+    void generate_gpu_schedule(const Target &t, AutoSchedule &sched);
+
+    // Same as \ref Partitioner::generate_gpu_schedule, but this generates and
+    // applies schedules for a group of function stages.
+    void generate_group_gpu_schedule(const Group &g, const Target &t,
+                                     const map<FStage, DimBounds> &group_loop_bounds,
+                                     const map<string, Box> &group_storage_bounds,
+                                     const set<string> &inlines,
+                                     AutoSchedule &sched);
+
+    // Map up to three of the pure dimensions in 'inner' of stage 'f_handle'
+    // onto GPU threads, splitting those that are too large. If 'make_blocks'
+    // is true, the outer parts of the splits become GPU blocks, and the stage
+    // is computed at root; otherwise, the dimensions in 'blocks' do. The
+    // remaining dimensions in 'inner' become serial loops within each thread.
+    // Return the innermost block dimension, with an empty name if there isn't
+    // one.
+    VarOrRVar map_stage_to_gpu(
+        const Group &g, Stage f_handle, int stage_num, Definition def,
+        bool is_group_output, const set<string> &inner, bool make_blocks,
+        vector<VarOrRVar> blocks, const set<string> &rvars,
+        map<string, Expr> &estimates, AutoSchedule &sched);
+
+    // If the update stage that is the output of group 'g' has too little
+    // parallelism along its pure dimensions, split the outermost RVar of the
+    // stage and rfactor the outer part of it, so that partial reductions over
+    // slices of the reduction domain are computed in parallel by an
+    // intermediate Func and then merged. This is only done if the reduction is
+    // associative and the merge costs less than the parallelism saves. Return
+    // true if the stage was rfactored, in which case it needs no further
+    // scheduling.
+    bool rfactor_stage(const Group &g, Stage f_handle, Definition def, const Target &t,
+                       map<string, Expr> &estimates, AutoSchedule &sched);
+
     // Split the dimension of stage 'f_handle' along 'v' into inner and outer
     // dimensions. Modify 'estimates' according to the split and append the split
     // schedule to 'sched'.
@@ -1415,11 +1739,11 @@ map<string, Expr> Partitioner::evaluate_reuse(const FStage &stg,
     return reuse;
 }
 
-vector<pair<Partitioner::GroupingChoice, Partitioner::GroupConfig>>
-Partitioner::choose_candidate_grouping(const vector<pair<string, string>> &cands,
-                                       Partitioner::Level level) {
-    vector<pair<GroupingChoice, GroupConfig>> best_grouping;
-    Expr best_benefit = make_zero(Int(64));
+vector<pair<vector<pair<Partitioner::GroupingChoice, Partitioner::GroupConfig>>, Expr>>
+Partitioner::rank_candidate_groupings(const vector<pair<string, string>> &cands,
+                                      Partitioner::Level level) {
+    vector<pair<vector<pair<GroupingChoice, GroupConfig>>, Expr>> ranked;
+    double current_time = benchmark ? measure_grouping(groups) : -1;
     for (const auto &p : cands) {
         // Compute the aggregate benefit of inlining into all the children.
         vector<pair<GroupingChoice, GroupConfig>> grouping;
@@ -1449,17 +1773,45 @@ Partitioner::choose_candidate_grouping(const vector<pair<string, string>> &cands
         bool no_redundant_work = false;
         Expr overall_benefit = estimate_benefit(grouping, no_redundant_work, true);
 
+        if (overall_benefit.defined() && current_time >= 0) {
+            // Replace the estimate by the measured saving, in nanoseconds.
+            double t = measure_grouping(grouping_with(grouping, level));
+            if (t >= 0) {
+                overall_benefit = make_const(Int(64), (int64_t)((current_time - t) * 1e9));
+            }
+        }
+
         debug(3) << "Candidate grouping:\n";
         for (const auto &g : grouping) {
             debug(3) << "  " << g.first;
         }
         debug(3) << "Candidate benefit: " << overall_benefit << '\n';
+        if (!overall_benefit.defined() || !can_prove(overall_benefit > 0)) {
+            continue;
+        }
+
+        // Keep the ranking sorted. Choices whose benefits can't be compared
+        // go after the ones they can't be proven better than.
         // TODO: The grouping process can be non-deterministic when the costs
         // of two choices are equal
-        if (overall_benefit.defined() && can_prove(best_benefit < overall_benefit)) {
-            best_grouping = grouping;
-            best_benefit = overall_benefit;
+        size_t pos = ranked.size();
+        while (pos > 0 && can_prove(ranked[pos - 1].second < overall_benefit)) {
+            pos--;
         }
+        ranked.insert(ranked.begin() + pos, make_pair(grouping, overall_benefit));
+    }
+    return ranked;
+}
+
+vector<pair<Partitioner::GroupingChoice, Partitioner::GroupConfig>>
+Partitioner::choose_candidate_grouping(const vector<pair<string, string>> &cands,
+                                       Partitioner::Level level) {
+    vector<pair<vector<pair<GroupingChoice, GroupConfig>>, Expr>> ranked =
+        rank_candidate_groupings(cands, level);
+
+    vector<pair<GroupingChoice, GroupConfig>> best_grouping;
+    if (!ranked.empty()) {
+        best_grouping = ranked[0].first;
     }
 
     debug(3) << "\nBest grouping:\n";
@@ -1467,7 +1819,7 @@ Partitioner::choose_candidate_grouping(const vector<pair<string, string>> &cands
         debug(3) << "  " << g.first;
     }
     if (best_grouping.size() > 0) {
-        debug(3) << "Best benefit: " << best_benefit << '\n';
+        debug(3) << "Best benefit: " << ranked[0].second << '\n';
     }
 
     return best_grouping;
@@ -1602,6 +1954,42 @@ Partitioner::find_best_tile_config(const Group &g) {
     // Generate tiling configurations
     vector<map<string, Expr>> configs = generate_tile_configs(g.output);
 
+    if (benchmark) {
+        // Measure the few configurations the analytic model thinks are
+        // best, and keep the fastest.
+        const size_t max_measured_configs = 4;
+        vector<pair<int64_t, Group>> viable;
+        for (const auto &config : configs) {
+            Group new_group = g;
+            new_group.tile_sizes = config;
+            GroupAnalysis new_analysis = analyze_group(new_group, show_analysis);
+            Expr benefit = estimate_benefit(no_tile_analysis, new_analysis, false, true);
+            if (benefit.defined()) {
+                const int64_t *b = as_const_int(benefit);
+                viable.push_back(make_pair(b ? *b : 0, new_group));
+            }
+        }
+        std::stable_sort(viable.begin(), viable.end(),
+                         [](const pair<int64_t, Group> &a, const pair<int64_t, Group> &b) {
+                             return a.first > b.first;
+                         });
+        if (viable.size() > max_measured_configs) {
+            viable.erase(viable.begin() + max_measured_configs, viable.end());
+        }
+
+        double best_time = measure_grouping(grouping_with(no_tile));
+        for (const auto &v : viable) {
+            double t = measure_grouping(grouping_with(v.second));
+            debug(3) << "Measured tile config for " << g.output << ": " << t * 1000 << " ms\n";
+            if (t >= 0 && (best_time < 0 || t < best_time)) {
+                best_time = t;
+                best_config = v.second.tile_sizes;
+                best_analysis = analyze_group(v.second, show_analysis);
+            }
+        }
+        return make_pair(best_config, best_analysis);
+    }
+
     Group best_group = g;
     for (const auto &config : configs) {
         Group new_group = g;
@@ -1632,65 +2020,137 @@ Partitioner::find_best_tile_config(const Group &g) {
     return make_pair(best_config, best_analysis);
 }
 
-void Partitioner::group(Partitioner::Level level) {
-    bool fixpoint = false;
-    while (!fixpoint) {
-        Cost pre_merge = get_pipeline_cost();
+vector<pair<string, string>> Partitioner::grouping_candidates(Partitioner::Level level) {
+    vector<pair<string, string>> cand;
+    for (const pair<FStage, Group> &g : groups) {
+        bool is_output = false;
+        for (const Function &f : outputs) {
+            if (g.first.func.name() == f.name()) {
+                is_output = true;
+                break;
+            }
+        }
 
-        fixpoint = true;
-        vector<pair<string, string>> cand;
-        for (const pair<FStage, Group> &g : groups) {
-            bool is_output = false;
-            for (const Function &f : outputs) {
-                if (g.first.func.name() == f.name()) {
-                    is_output = true;
-                    break;
-                }
+        // All stages of a function are computed at a single location.
+        // The last stage of the function represents the candidate choice
+        // of grouping the function into a consumer.
+
+        const Function &prod_f = get_element(dep_analysis.env, g.first.func.name());
+        bool is_final_stage = (g.first.stage_num == prod_f.updates().size());
+
+        if (is_output || !is_final_stage) {
+            continue;
+        }
+
+        const auto &iter = children.find(g.first);
+        if (iter != children.end()) {
+            // All the stages belonging to a function are considered to be a
+            // single child.
+            set<string> child_groups;
+            for (const FStage &s : iter->second) {
+                child_groups.insert(s.func.name());
             }
 
-            // All stages of a function are computed at a single location.
-            // The last stage of the function represents the candidate choice
-            // of grouping the function into a consumer.
+            int num_children = child_groups.size();
+            // Only groups with a single child are considered for grouping
+            // when grouping for computing in tiles.
+            // TODO: The current scheduling model does not allow functions
+            // to be computed at different points.
+            if ((num_children == 1) && (level == Partitioner::Level::FastMem)) {
+                const string &prod_name = prod_f.name();
+                const string &cons_name = (*child_groups.begin());
+                cand.push_back(make_pair(prod_name, cons_name));
+            } else if((level == Partitioner::Level::Inline) && prod_f.is_pure()) {
+                const string &prod_name = prod_f.name();
+                cand.push_back(make_pair(prod_name, ""));
+            }
+        }
+    }
 
-            const Function &prod_f = get_element(dep_analysis.env, g.first.func.name());
-            bool is_final_stage = (g.first.stage_num == prod_f.updates().size());
+    debug(3) << "\n============================" << '\n';
+    debug(3) << "Current grouping candidates:" << '\n';
+    debug(3) << "============================" << '\n';
+    for (size_t i = 0; i < cand.size(); ++i) {
+        debug(3) << "{" << cand[i].first << ", " << cand[i].second << "}" << '\n';
+    }
+    return cand;
+}
 
-            if (is_output || !is_final_stage) {
-                continue;
+void Partitioner::apply_grouping(const vector<pair<GroupingChoice, GroupConfig>> &best,
+                                 Partitioner::Level level) {
+    // The following code makes the assumption that all the stages of a function
+    // will be in the same group. 'choose_candidate_grouping' ensures that the
+    // grouping choice being returned adheres to this constraint.
+    const string &prod = best[0].first.prod;
+
+    const Function &prod_f = get_element(dep_analysis.env, prod);
+    size_t num_stages = prod_f.updates().size() + 1;
+
+    FStage final_stage(prod_f, num_stages - 1);
+    set<FStage> prod_group_children = get_element(children, final_stage);
+
+    // Invalidate entries of the grouping cache
+    set<GroupingChoice> invalid_keys;
+    for (const auto &c : prod_group_children) {
+        for (const auto &entry : grouping_cache) {
+            if ((entry.first.prod == c.func.name()) || (entry.first.cons == c)) {
+                invalid_keys.insert(entry.first);
             }
+        }
+    }
+    for (const auto &key : invalid_keys) {
+        grouping_cache.erase(key);
+    }
 
-            const auto &iter = children.find(g.first);
-            if (iter != children.end()) {
-                // All the stages belonging to a function are considered to be a
-                // single child.
-                set<string> child_groups;
-                for (const FStage &s : iter->second) {
-                    child_groups.insert(s.func.name());
-                }
+    for (const auto &group : best) {
+        internal_assert(group.first.prod == prod);
+        merge_groups(group.first, group.second, level);
+    }
 
-                int num_children = child_groups.size();
-                // Only groups with a single child are considered for grouping
-                // when grouping for computing in tiles.
-                // TODO: The current scheduling model does not allow functions
-                // to be computed at different points.
-                if ((num_children == 1) && (level == Partitioner::Level::FastMem)) {
-                    const string &prod_name = prod_f.name();
-                    const string &cons_name = (*child_groups.begin());
-                    cand.push_back(make_pair(prod_name, cons_name));
-                } else if((level == Partitioner::Level::Inline) && prod_f.is_pure()) {
-                    const string &prod_name = prod_f.name();
-                    cand.push_back(make_pair(prod_name, ""));
-                }
+    for (size_t s = 0; s < num_stages; s++) {
+        FStage prod_group(prod_f, s);
+        groups.erase(prod_group);
+        group_costs.erase(prod_group);
+
+        // Update the children mapping
+        children.erase(prod_group);
+        for (auto &f : children) {
+            set<FStage> &cons = f.second;
+            auto iter = cons.find(prod_group);
+            if (iter != cons.end()) {
+                cons.erase(iter);
+                // For a function with multiple stages, all the stages will
+                // be in the same group and the consumers of the function
+                // only depend on the last stage. Therefore, when the
+                // producer group has multiple stages, parents of the
+                // producers should point to the consumers of the last
+                // stage of the producer.
+                cons.insert(prod_group_children.begin(), prod_group_children.end());
             }
         }
+    }
+}
 
-        debug(3) << "\n============================" << '\n';
-        debug(3) << "Current grouping candidates:" << '\n';
-        debug(3) << "============================" << '\n';
-        for (size_t i = 0; i < cand.size(); ++i) {
-            debug(3) << "{" << cand[i].first << ", " << cand[i].second << "}" << '\n';
+bool Partitioner::out_of_time() const {
+    return has_deadline && std::chrono::steady_clock::now() > deadline;
+}
+
+void Partitioner::group(Partitioner::Level level) {
+    if (arch_params.beam_width > 1) {
+        beam_group(level);
+        return;
+    }
+
+    bool fixpoint = false;
+    while (!fixpoint) {
+        if (out_of_time()) {
+            debug(1) << "Auto-scheduler time budget exceeded; stopping the grouping search\n";
+            break;
         }
 
+        fixpoint = true;
+        vector<pair<string, string>> cand = grouping_candidates(level);
+
         vector<pair<GroupingChoice, GroupConfig>> best = choose_candidate_grouping(cand, level);
         if (best.empty()) {
             continue;
@@ -1698,63 +2158,139 @@ void Partitioner::group(Partitioner::Level level) {
             fixpoint = false;
         }
 
-        // The following code makes the assumption that all the stages of a function
-        // will be in the same group. 'choose_candidate_grouping' ensures that the
-        // grouping choice being returned adheres to this constraint.
-        const string &prod = best[0].first.prod;
+        apply_grouping(best, level);
 
-        const Function &prod_f = get_element(dep_analysis.env, prod);
-        size_t num_stages = prod_f.updates().size() + 1;
+        if (debug::debug_level() >= 3) {
+            disp_pipeline_costs();
+        }
+    }
+}
 
-        FStage final_stage(prod_f, num_stages - 1);
-        set<FStage> prod_group_children = get_element(children, final_stage);
+void Partitioner::beam_group(Partitioner::Level level) {
+    // A partial grouping, along with the sum of the estimated benefits of
+    // the merges that led to it.
+    struct State {
+        map<FStage, Group> groups;
+        map<FStage, set<FStage>> children;
+        map<FStage, GroupAnalysis> group_costs;
+        map<GroupingChoice, GroupConfig> grouping_cache;
+        Expr benefit;
+    };
 
-        // Invalidate entries of the grouping cache
-        set<GroupingChoice> invalid_keys;
-        for (const auto &c : prod_group_children) {
-            for (const auto &entry : grouping_cache) {
-                if ((entry.first.prod == c.func.name()) || (entry.first.cons == c)) {
-                    invalid_keys.insert(entry.first);
-                }
-            }
-        }
-        for (const auto &key : invalid_keys) {
-            grouping_cache.erase(key);
+    auto save = [&](const Expr &benefit) {
+        return State{groups, children, group_costs, grouping_cache, benefit};
+    };
+    auto load = [&](const State &state) {
+        groups = state.groups;
+        children = state.children;
+        group_costs = state.group_costs;
+        grouping_cache = state.grouping_cache;
+    };
+    // Groupings reached through merges in a different order are the same.
+    auto key = [&](const State &state) {
+        std::ostringstream stream;
+        for (const auto &g : state.groups) {
+            stream << g.second;
         }
+        return stream.str();
+    };
 
-        for (const auto &group : best) {
-            internal_assert(group.first.prod == prod);
-            merge_groups(group.first, group.second, level);
+    const size_t width = arch_params.beam_width;
+    vector<State> beam = {save(make_zero(Int(64)))};
+    State best = beam[0];
+    while (!beam.empty()) {
+        if (out_of_time()) {
+            debug(1) << "Auto-scheduler time budget exceeded; stopping the grouping search\n";
+            break;
         }
 
-        for (size_t s = 0; s < num_stages; s++) {
-            FStage prod_group(prod_f, s);
-            groups.erase(prod_group);
-            group_costs.erase(prod_group);
+        vector<State> next;
+        for (State &state : beam) {
+            load(state);
+            vector<pair<vector<pair<GroupingChoice, GroupConfig>>, Expr>> ranked =
+                rank_candidate_groupings(grouping_candidates(level), level);
+            // Keep the evaluations for the children of this state.
+            state.grouping_cache = grouping_cache;
+            for (size_t i = 0; i < ranked.size() && i < width; i++) {
+                load(state);
+                apply_grouping(ranked[i].first, level);
+                next.push_back(save(simplify(state.benefit + ranked[i].second)));
+            }
+        }
 
-            // Update the children mapping
-            children.erase(prod_group);
-            for (auto &f : children) {
-                set<FStage> &cons = f.second;
-                auto iter = cons.find(prod_group);
-                if (iter != cons.end()) {
-                    cons.erase(iter);
-                    // For a function with multiple stages, all the stages will
-                    // be in the same group and the consumers of the function
-                    // only depend on the last stage. Therefore, when the
-                    // producer group has multiple stages, parents of the
-                    // producers should point to the consumers of the last
-                    // stage of the producer.
-                    cons.insert(prod_group_children.begin(), prod_group_children.end());
-                }
+        // Keep the best 'width' distinct groupings.
+        std::stable_sort(next.begin(), next.end(), [](const State &a, const State &b) {
+            return can_prove(a.benefit > b.benefit);
+        });
+        beam.clear();
+        set<string> seen;
+        for (State &state : next) {
+            if (beam.size() == width) {
+                break;
+            }
+            if (seen.insert(key(state)).second) {
+                beam.push_back(std::move(state));
             }
         }
 
-        Cost post_merge = get_pipeline_cost();
-        if (debug::debug_level() >= 3) {
-            disp_pipeline_costs();
+        if (!beam.empty() && can_prove(beam[0].benefit > best.benefit)) {
+            best = beam[0];
         }
     }
+
+    load(best);
+    if (debug::debug_level() >= 3) {
+        disp_pipeline_costs();
+    }
+}
+
+map<FStage, Partitioner::Group> Partitioner::grouping_with(const Group &g) {
+    map<FStage, Group> result = groups;
+    for (const FStage &s : g.members) {
+        result.erase(s);
+    }
+    result.erase(g.output);
+    result.emplace(g.output, g);
+    return result;
+}
+
+map<FStage, Partitioner::Group> Partitioner::grouping_with(
+        const vector<pair<GroupingChoice, GroupConfig>> &grouping, Partitioner::Level level) {
+    internal_assert(!grouping.empty());
+    map<FStage, Group> saved_groups = groups;
+    map<FStage, GroupAnalysis> saved_costs = group_costs;
+
+    // Merge the groups the same way group() does.
+    for (const auto &g : grouping) {
+        merge_groups(g.first, g.second, level);
+    }
+    const Function &prod_f = get_element(dep_analysis.env, grouping[0].first.prod);
+    for (size_t s = 0; s < prod_f.updates().size() + 1; s++) {
+        groups.erase(FStage(prod_f, s));
+    }
+
+    map<FStage, Group> result;
+    std::swap(result, groups);
+    groups = saved_groups;
+    group_costs = saved_costs;
+    return result;
+}
+
+double Partitioner::measure_grouping(const map<FStage, Group> &candidate) {
+    internal_assert(benchmark);
+    map<FStage, Group> current = candidate;
+    std::swap(groups, current);
+    allow_rfactor = false;
+    double t = benchmark->measure([&](AutoSchedule &sched) {
+        if (benchmark->target.has_gpu_feature()) {
+            generate_gpu_schedule(benchmark->target, sched);
+        } else {
+            generate_cpu_schedule(benchmark->target, sched);
+        }
+    });
+    std::swap(groups, current);
+    allow_rfactor = true;
+    return t;
 }
 
 DimBounds Partitioner::get_bounds(const FStage &s) {
@@ -1804,6 +2340,21 @@ DimBounds Partitioner::get_bounds_from_tile_sizes(const FStage &s,
 }
 
 Partitioner::GroupAnalysis Partitioner::analyze_group(const Group &g, bool show_analysis) {
+    if (show_analysis) {
+        return compute_group_analysis(g, show_analysis);
+    }
+    std::ostringstream key;
+    key << g;
+    const auto &iter = analysis_cache.find(key.str());
+    if (iter != analysis_cache.end()) {
+        return iter->second;
+    }
+    GroupAnalysis analysis = compute_group_analysis(g, show_analysis);
+    analysis_cache.emplace(key.str(), analysis);
+    return analysis;
+}
+
+Partitioner::GroupAnalysis Partitioner::compute_group_analysis(const Group &g, bool show_analysis) {
     // Get the definition corresponding to the group output
     Definition def = get_stage_definition(g.output.func, g.output.stage_num);
 
@@ -1888,6 +2439,56 @@ Partitioner::GroupAnalysis Partitioner::analyze_group(const Group &g, bool show_
         return GroupAnalysis();
     }
 
+    // Consecutive tiles along the innermost tiled dimension overlap when the
+    // intermediates are stencils. If that loop is serial, the intermediates
+    // can be stored outside of it instead, so that the sliding window
+    // optimization only computes the new part of them for each tile. Storage
+    // folding then keeps their footprint to about that of a tile, which the
+    // load costs below already assume.
+    string sliding_dim;
+    for (int d = 0; allow_sliding && d < (int)dims.size() - 1 && !group_reg.empty(); d++) {
+        const string &var = dims[d].var;
+        const auto &iter = g.tile_sizes.find(var);
+        if (iter == g.tile_sizes.end()) {
+            continue;
+        }
+        if (dims[d].is_rvar()) {
+            break;
+        }
+        Expr extent = get_extent(get_element(stg_bounds, var));
+        Expr dim_tiles = simplify((extent + iter->second - 1) / iter->second);
+        Expr other_parallelism = simplify(parallelism / dim_tiles);
+        if (!can_prove(dim_tiles > 1) ||
+            !can_prove(other_parallelism >= arch_params.parallelism)) {
+            break;
+        }
+
+        // Compute the cost of the intermediates of a whole row of tiles
+        // along 'var', and share it out between the tiles.
+        map<string, Expr> row_sizes = g.tile_sizes;
+        row_sizes[var] = extent;
+        DimBounds row_bounds = get_bounds_from_tile_sizes(g.output, row_sizes);
+        map<string, Box> row_regions = dep_analysis.regions_required(
+            g.output.func, g.output.stage_num, row_bounds, group_members, true, &costs.input_estimates);
+        map<string, Box> row_group_reg;
+        for (const auto &reg : row_regions) {
+            if (group_reg.find(reg.first) != group_reg.end()) {
+                row_group_reg.emplace(reg.first, reg.second);
+            }
+        }
+        Cost row_cost = costs.region_cost(row_group_reg, g.inlined);
+        if (row_cost.defined()) {
+            Cost slid_cost(simplify(row_cost.arith / dim_tiles),
+                           simplify(row_cost.memory / dim_tiles));
+            if (can_prove(slid_cost.arith < tile_cost.arith)) {
+                tile_cost = slid_cost;
+                parallelism = other_parallelism;
+                sliding_dim = var;
+            }
+        }
+        break;
+    }
+
     Cost out_cost = costs.stage_region_cost(g.output.func.name(),
                                             g.output.stage_num,
                                             tile_bounds, g.inlined);
@@ -2033,6 +2634,7 @@ Partitioner::GroupAnalysis Partitioner::analyze_group(const Group &g, bool show_
     GroupAnalysis g_analysis(
         Cost(per_tile_cost.arith * estimate_tiles, per_tile_cost.memory * estimate_tiles),
         parallelism);
+    g_analysis.sliding_dim = sliding_dim;
     g_analysis.simplify();
 
     return g_analysis;
@@ -2429,6 +3031,9 @@ pair<VarOrRVar, VarOrRVar> Partitioner::split_dim(
         case TailStrategy::ShiftInwards:
             oss << ", TailStrategy::ShiftInwards)";
             break;
+        case TailStrategy::Predicate:
+            oss << ", TailStrategy::Predicate)";
+            break;
         case TailStrategy::Auto:
             oss << ")";
             break;
@@ -2649,6 +3254,121 @@ public :
     }
 };
 
+bool Partitioner::rfactor_stage(const Group &g, Stage f_handle, Definition def, const Target &t,
+                                map<string, Expr> &estimates, AutoSchedule &sched) {
+    const Function &g_out = g.output.func;
+    int stage_num = g.output.stage_num;
+    if (!allow_rfactor || (stage_num == 0)) {
+        return false;
+    }
+
+    // Members computed within the tiles of the stage would have nowhere to
+    // go, since rfactor moves the loops of the stage into the intermediate.
+    for (const FStage &mem : g.members) {
+        if ((mem.func.name() != g_out.name()) &&
+            (g.inlined.find(mem.func.name()) == g.inlined.end())) {
+            return false;
+        }
+    }
+
+    const vector<Dim> &dims = def.schedule().dims();
+    Expr pure_par = make_one(Int(64));
+    Expr reduction_size = make_one(Int(64));
+    int outer_rvar = -1;
+    for (int d = 0; d < (int)dims.size() - 1; d++) {
+        string var = get_base_name(dims[d].var);
+        const auto &iter = estimates.find(var);
+        if ((iter == estimates.end()) || !iter->second.defined()) {
+            return false;
+        }
+        if (dims[d].is_rvar()) {
+            reduction_size *= iter->second;
+            outer_rvar = d;
+        } else {
+            pure_par *= iter->second;
+        }
+    }
+    if ((outer_rvar < 0) || can_prove(pure_par >= arch_params.parallelism)) {
+        return false;
+    }
+
+    const auto &prover_result = prove_associativity(g_out.name(), def.args(), def.values());
+    if (!prover_result.associative()) {
+        return false;
+    }
+
+    // Split the outermost RVar into about as many slices as there are
+    // cores. Each slice is reduced into its own copy of the Func, and the
+    // copies are then merged serially, which costs 'num_slices' times the
+    // size of the Func.
+    string rvar = get_base_name(dims[outer_rvar].var);
+    Expr extent = simplify(cast<int64_t>(get_element(estimates, rvar)));
+    Expr slice_size = simplify(max((extent + arch_params.parallelism - 1) / arch_params.parallelism, 1));
+    Expr num_slices = simplify((extent + slice_size - 1) / slice_size);
+    if (!is_const(slice_size) || !can_prove(num_slices > 1)) {
+        return false;
+    }
+
+    const auto &bounds_iter = pipeline_bounds.find(g_out.name());
+    if (bounds_iter == pipeline_bounds.end()) {
+        return false;
+    }
+    Expr func_size = box_size(bounds_iter->second);
+    if (!func_size.defined()) {
+        return false;
+    }
+    Expr parallel_cost = simplify(reduction_size * pure_par / num_slices + num_slices * func_size);
+    Expr serial_cost = simplify(reduction_size * pure_par);
+    if (!can_prove(parallel_cost < serial_cost)) {
+        return false;
+    }
+
+    // The innermost dimension, which is vectorized in the intermediate if
+    // it's pure. The schedule of the stage changes from here on.
+    string inner_var = get_base_name(dims[0].var);
+    bool inner_is_pure = !dims[0].is_rvar();
+
+    pair<VarOrRVar, VarOrRVar> split_vars =
+        split_dim(g, f_handle, stage_num, def, true, VarOrRVar(rvar, true),
+                  simplify(cast<int32_t>(slice_size)), "_i", "_o", estimates, sched);
+    const VarOrRVar &slices = split_vars.second;
+
+    string v_name = get_sanitized_name(g_out.name()) + "_rf";
+    VarOrRVar v(v_name, false);
+    internal_assert(sched.internal_vars.find(v_name) == sched.internal_vars.end());
+    sched.internal_vars.emplace(v_name, v);
+
+    // The intermediate isn't part of the pipeline as far as 'sched' is
+    // concerned, so its schedule is chained onto the rfactor call.
+    Func intm = f_handle.rfactor(slices.rvar, v.var);
+    intm.compute_root();
+    Stage intm_update = intm.update(0);
+    intm_update.parallel(v.var);
+    string intm_sched = "rfactor(" + slices.name() + ", " + v_name + ")"
+                        ".compute_root().update(0).parallel(" + v_name + ")";
+    set<string> used = {slices.name(), v_name};
+
+    // Vectorize the innermost dimension of the partial reductions if it's
+    // pure, as the intermediate keeps its name.
+    if (inner_is_pure) {
+        const string &var = inner_var;
+        int vec_len = 0;
+        for (const auto &type : g_out.output_types()) {
+            vec_len = std::max(vec_len, t.natural_vector_size(type));
+        }
+        const auto &iter = estimates.find(var);
+        if ((iter != estimates.end()) && iter->second.defined() &&
+            can_prove(iter->second >= vec_len)) {
+            intm_update.vectorize(Var(var), vec_len);
+            intm_sched += ".vectorize(" + var + ", " + std::to_string(vec_len) + ")";
+            used.insert(var);
+        }
+    }
+
+    sched.push_schedule(f_handle.name(), stage_num, intm_sched, used);
+    return true;
+}
+
 void Partitioner::generate_group_cpu_schedule(
         const Group &g, const Target &t,
         const map<FStage, DimBounds> &group_loop_bounds,
@@ -2702,6 +3422,10 @@ void Partitioner::generate_group_cpu_schedule(
         }
     }
 
+    if (rfactor_stage(g, f_handle, def, t, stg_estimates, sched)) {
+        return;
+    }
+
     // Reorder the dimensions for better spatial locality (i.e. smallest stride
     // is innermost). If we only have one dimension (excluding __outermost),
     // there is nothing to reorder.
@@ -2749,6 +3473,28 @@ void Partitioner::generate_group_cpu_schedule(
         }
     }
 
+    // If the analysis chose to compute the tiles with a sliding window, make
+    // the tile loop of the sliding dimension the innermost one, so that the
+    // members can be computed within it and stored outside of it.
+    string sliding_dim;
+    {
+        const auto &iter = group_costs.find(g.output);
+        if ((iter != group_costs.end()) && !iter->second.sliding_dim.empty()) {
+            sliding_dim = iter->second.sliding_dim;
+        }
+    }
+    bool sliding = false;
+    for (size_t i = 0; i < outer_dims.size() && !sliding_dim.empty(); i++) {
+        if ((outer_dims[i].name() == sliding_dim) ||
+            (outer_dims[i].name() == sliding_dim + "_o")) {
+            VarOrRVar v = outer_dims[i];
+            outer_dims.erase(outer_dims.begin() + i);
+            outer_dims.insert(outer_dims.begin(), v);
+            sliding = !v.is_rvar;
+            break;
+        }
+    }
+
     // Reorder the tile dimensions
     if (!outer_dims.empty()) {
 
@@ -2844,6 +3590,22 @@ void Partitioner::generate_group_cpu_schedule(
         tile_inner_var = VarOrRVar(var_name, is_rvar);
     }
 
+    // Find the level at which group members will be stored, if they are to
+    // be computed with a sliding window. The loop between the two levels has
+    // to be serial, and nothing else may come between them. An empty name
+    // means storing at root.
+    VarOrRVar tile_store_var("", false);
+    if (sliding && (dims[tile_inner_index].for_type == ForType::Serial) &&
+        (get_base_name(dims[tile_inner_index].var) == outer_dims[0].name())) {
+        if (tile_inner_index + 1 < (int)dims.size() - 1) {
+            string var_name = get_base_name(dims[tile_inner_index + 1].var);
+            bool is_rvar = (rvars.find(var_name) != rvars.end());
+            tile_store_var = VarOrRVar(var_name, is_rvar);
+        }
+    } else {
+        sliding = false;
+    }
+
     for (const FStage &mem : g.members) {
         // Skip member stages that have been inlined or stage that is the
         // output stage of the group
@@ -2883,6 +3645,19 @@ void Partitioner::generate_group_cpu_schedule(
                 sched.push_schedule(mem_handle.name(), mem.stage_num,
                                     "compute_at(" + sanitized_g_out + ", " + tile_inner_var.name() + ")",
                                     {sanitized_g_out, tile_inner_var.name()});
+                if (sliding && tile_store_var.name().empty()) {
+                    Func(mem.func).store_root();
+                    sched.push_schedule(mem_handle.name(), mem.stage_num, "store_root()", {});
+                } else if (sliding) {
+                    if (tile_store_var.is_rvar) {
+                        Func(mem.func).store_at(Func(g_out), tile_store_var.rvar);
+                    } else {
+                        Func(mem.func).store_at(Func(g_out), tile_store_var.var);
+                    }
+                    sched.push_schedule(mem_handle.name(), mem.stage_num,
+                                        "store_at(" + sanitized_g_out + ", " + tile_store_var.name() + ")",
+                                        {sanitized_g_out, tile_store_var.name()});
+                }
             } else {
                 user_warning << "Degenerate tiling. No dimensions are tiled" << '\n';
                 user_warning << "Computing \"" <<  mem.func.name() << "\" at root" << '\n';
@@ -2935,6 +3710,329 @@ void Partitioner::generate_cpu_schedule(const Target &t, AutoSchedule &sched) {
     }
 }
 
+VarOrRVar Partitioner::map_stage_to_gpu(
+        const Group &g, Stage f_handle, int stage_num, Definition def,
+        bool is_group_output, const set<string> &inner, bool make_blocks,
+        vector<VarOrRVar> blocks, const set<string> &rvars,
+        map<string, Expr> &estimates, AutoSchedule &sched) {
+    // Threads along the innermost dimension are 32 wide so that their
+    // accesses coalesce, for at most 32 * 8 * 4 threads per block.
+    const int thread_extents[] = {32, 8, 4};
+
+    vector<Dim> &dims = def.schedule().dims();
+
+    vector<string> dim_vars(dims.size() - 1);
+    for (int d = 0; d < (int)dims.size() - 1; d++) {
+        dim_vars[d] = get_base_name(dims[d].var);
+    }
+
+    vector<VarOrRVar> threads, serial;
+    set<string> mapped;
+    for (const string &var : dim_vars) {
+        if (threads.size() == 3) {
+            break;
+        }
+        // Reduction variables stay serial, so that the order of the updates
+        // doesn't change.
+        if ((rvars.find(var) != rvars.end()) || (inner.find(var) == inner.end())) {
+            continue;
+        }
+        VarOrRVar v(var, false);
+        int extent = thread_extents[threads.size()];
+        const auto &iter = estimates.find(var);
+        if ((iter != estimates.end()) && iter->second.defined() &&
+            can_prove(iter->second <= extent)) {
+            threads.push_back(v);
+        } else {
+            pair<VarOrRVar, VarOrRVar> split_vars =
+                split_dim(g, f_handle, stage_num, def, is_group_output, v, extent,
+                          "_ti", "_to", estimates, sched);
+            threads.push_back(split_vars.first);
+            if (make_blocks) {
+                blocks.push_back(split_vars.second);
+            } else {
+                serial.push_back(split_vars.second);
+            }
+            mapped.insert(split_vars.second.name());
+        }
+        mapped.insert(threads.back().name());
+    }
+    if (blocks.size() > 3) {
+        blocks.erase(blocks.begin() + 3, blocks.end());
+    }
+    // Thread loops have to be within block loops, so a kernel small enough
+    // to fit in a single block uses its outermost thread dimension as the
+    // blocks instead.
+    bool at_root = is_group_output || make_blocks;
+    if (at_root && blocks.empty() && !threads.empty()) {
+        blocks.push_back(threads.back());
+        threads.pop_back();
+    }
+    for (const auto &v : blocks) {
+        mapped.insert(v.name());
+    }
+
+    // From innermost to outermost: the serial loops within each thread, the
+    // thread loops, the block loops, and whatever is left over, which is
+    // run on the host for each kernel launch.
+    vector<VarOrRVar> ordering, outer;
+    for (int d = 0; d < (int)dims.size() - 1; d++) {
+        string var = get_base_name(dims[d].var);
+        if (mapped.find(var) != mapped.end()) {
+            continue;
+        }
+        VarOrRVar v(var, dims[d].is_rvar());
+        if (inner.find(var) != inner.end()) {
+            ordering.push_back(v);
+        } else {
+            outer.push_back(v);
+        }
+    }
+    ordering.insert(ordering.end(), serial.begin(), serial.end());
+    ordering.insert(ordering.end(), threads.begin(), threads.end());
+    ordering.insert(ordering.end(), blocks.begin(), blocks.end());
+    ordering.insert(ordering.end(), outer.begin(), outer.end());
+
+    if (!ordering.empty() && (dims != ordering)) {
+        set<string> var_list;
+        string var_order = ordering[0].name();
+        for (size_t o = 1; o < ordering.size(); o++) {
+            var_order += ", " + ordering[o].name();
+            var_list.insert(ordering[o].name());
+        }
+        f_handle.reorder(ordering);
+        sched.push_schedule(f_handle.name(), stage_num, "reorder(" + var_order + ")", var_list);
+    }
+
+    if (!threads.empty()) {
+        string thread_list = threads[0].name();
+        set<string> thread_vars = {threads[0].name()};
+        for (size_t i = 1; i < threads.size(); i++) {
+            thread_list += ", " + threads[i].name();
+            thread_vars.insert(threads[i].name());
+        }
+        for (const auto &v : threads) {
+            f_handle.gpu_threads(v);
+        }
+        sched.push_schedule(f_handle.name(), stage_num,
+                            "gpu_threads(" + thread_list + ")", thread_vars);
+    }
+
+    if (blocks.empty()) {
+        if (at_root) {
+            // Nothing can run in parallel, but keep the data on the device.
+            f_handle.gpu_single_thread();
+            sched.push_schedule(f_handle.name(), stage_num, "gpu_single_thread()", {});
+        }
+        return VarOrRVar("", false);
+    }
+
+    string block_list = blocks[0].name();
+    set<string> block_vars = {blocks[0].name()};
+    for (size_t i = 1; i < blocks.size(); i++) {
+        block_list += ", " + blocks[i].name();
+        block_vars.insert(blocks[i].name());
+    }
+    for (const auto &v : blocks) {
+        f_handle.gpu_blocks(v);
+    }
+    sched.push_schedule(f_handle.name(), stage_num, "gpu_blocks(" + block_list + ")", block_vars);
+
+    return blocks[0];
+}
+
+void Partitioner::generate_group_gpu_schedule(
+        const Group &g, const Target &t,
+        const map<FStage, DimBounds> &group_loop_bounds,
+        const map<string, Box> &group_storage_bounds,
+        const set<string> &inlines,
+        AutoSchedule &sched) {
+    string out_f_name = g.output.func.name();
+    Function g_out = g.output.func;
+
+    debug(3) << "\n================\n";
+    debug(3) << "Scheduling group for GPU:\n";
+    debug(3) << "================\n";
+    debug(3) << g;
+
+    // Get the definition corresponding to the stage
+    Definition def = get_stage_definition(g_out, g.output.stage_num);
+
+    // Get the estimates for stage bounds
+    DimBounds stg_bounds = get_bounds(g.output);
+    map<string, Expr> stg_estimates = bounds_to_estimates(stg_bounds);
+
+    Stage f_handle = Stage(Func(g_out));
+
+    // Get a function handle for scheduling the stage
+    if (g.output.stage_num > 0) {
+        int stage_num = g.output.stage_num;
+        f_handle = Func(g_out).update(stage_num - 1);
+    } else {
+        Func(g_out).compute_root();
+        sched.push_schedule(f_handle.name(), g.output.stage_num, "compute_root()", {});
+    }
+
+    if (g.output.func.has_extern_definition()) {
+        internal_assert(g.members.size() == 1);
+        return;
+    }
+
+    vector<Dim> &dims = def.schedule().dims();
+
+    // Keep track of the rvars
+    set<string> rvars;
+    for (int d = 0; d < (int)dims.size() - 1; d++) {
+        if (dims[d].is_rvar()) {
+            rvars.insert(get_base_name(dims[d].var));
+        }
+    }
+
+    // Reorder the dimensions so that the smallest stride is innermost. That
+    // dimension is mapped to the innermost thread dimension below, so that
+    // the accesses of adjacent threads coalesce.
+    if (dims.size() > 2) {
+        map<string, Expr> strides =
+            analyze_spatial_locality(g.output, group_storage_bounds, inlines);
+        if (!strides.empty()) {
+            reorder_dims(f_handle, g.output.stage_num, def, strides, sched);
+        }
+    }
+
+    vector<string> dim_vars(dims.size() - 1);
+    for (int d = 0; d < (int)dims.size() - 1; d++) {
+        dim_vars[d] = get_base_name(dims[d].var);
+    }
+
+    // Apply tiling to output of the group. The analysis sized the tiles so
+    // that the intermediates of a tile fit in shared memory.
+    set<string> inner_dims;
+    vector<VarOrRVar> outer_dims;
+    for (const auto &var : dim_vars) {
+        bool is_rvar = (rvars.find(var) != rvars.end());
+        VarOrRVar v(var, is_rvar);
+
+        const auto &iter = g.tile_sizes.find(var);
+        if ((iter != g.tile_sizes.end()) &&
+            get_element(stg_estimates, var).defined() &&
+            can_prove(get_element(stg_estimates, var) > iter->second)) {
+            const Expr &tile_size = iter->second;
+            if (can_prove(tile_size == 1)) {
+                if (!is_rvar) {
+                    outer_dims.push_back(v);
+                }
+            } else {
+                pair<VarOrRVar, VarOrRVar> tile_vars =
+                    split_dim(g, f_handle, g.output.stage_num, def, true, v,
+                              tile_size, "_i", "_o", stg_estimates, sched);
+
+                inner_dims.insert(tile_vars.first.name());
+                if (is_rvar) {
+                    rvars.erase(var);
+                    rvars.insert(tile_vars.first.name());
+                    rvars.insert(tile_vars.second.name());
+                } else {
+                    outer_dims.push_back(tile_vars.second);
+                }
+            }
+        } else {
+            inner_dims.insert(var);
+        }
+    }
+
+    // If there are no tiles, derive the blocks from the thread dimensions
+    // instead. The group members are then computed at root.
+    bool make_blocks = outer_dims.empty();
+    VarOrRVar block_var =
+        map_stage_to_gpu(g, f_handle, g.output.stage_num, def, true, inner_dims,
+                         make_blocks, outer_dims, rvars, stg_estimates, sched);
+    if (make_blocks) {
+        block_var = VarOrRVar("", false);
+    }
+
+    for (const FStage &mem : g.members) {
+        // Skip member stages that have been inlined or stage that is the
+        // output stage of the group
+        if ((g.inlined.find(mem.func.name()) != g.inlined.end()) ||
+            (mem.func.name() == g_out.name())) {
+            continue;
+        }
+
+        // Get the definition corresponding to the stage
+        Definition mem_def = get_stage_definition(mem.func, mem.stage_num);
+
+        // Get the estimates for the dimensions of the member stage
+        map<string, Expr> mem_estimates =
+            bounds_to_estimates(get_element(group_loop_bounds, mem));
+
+        set<string> mem_rvars, mem_dims;
+        vector<Dim> &mem_dim_list = mem_def.schedule().dims();
+        for (int d = 0; d < (int)mem_dim_list.size() - 1; d++) {
+            string var = get_base_name(mem_dim_list[d].var);
+            if (mem_dim_list[d].is_rvar()) {
+                mem_rvars.insert(var);
+            }
+            mem_dims.insert(var);
+        }
+
+        // Get a function handle for scheduling the stage
+        Stage mem_handle = Stage(Func(mem.func));
+
+        if (mem.stage_num > 0) {
+            mem_handle = Func(mem.func).update(mem.stage_num - 1);
+        } else {
+            if (!block_var.name().empty()) {
+                // This places the member in shared memory.
+                Func(mem.func).compute_at(Func(g_out), block_var.var);
+                string sanitized_g_out = get_sanitized_name(g_out.name());
+                sched.push_schedule(mem_handle.name(), mem.stage_num,
+                                    "compute_at(" + sanitized_g_out + ", " + block_var.name() + ")",
+                                    {sanitized_g_out, block_var.name()});
+            } else {
+                user_warning << "Degenerate tiling. No dimensions are tiled" << '\n';
+                user_warning << "Computing \"" <<  mem.func.name() << "\" at root" << '\n';
+                Func(mem.func).compute_root();
+                sched.push_schedule(mem_handle.name(), mem.stage_num, "compute_root()", {});
+            }
+        }
+
+        if (mem_dim_list.size() > 2) {
+            map<string, Expr> mem_strides =
+                analyze_spatial_locality(mem, group_storage_bounds, inlines);
+            if (!mem_strides.empty()) {
+                reorder_dims(mem_handle, mem.stage_num, mem_def, mem_strides, sched);
+            }
+        }
+
+        // Members computed per block only use the threads of the block;
+        // members computed at root are kernels of their own.
+        map_stage_to_gpu(g, mem_handle, mem.stage_num, mem_def, false,
+                         mem_dims, block_var.name().empty(), {}, mem_rvars,
+                         mem_estimates, sched);
+    }
+}
+
+void Partitioner::generate_gpu_schedule(const Target &t, AutoSchedule &sched) {
+    // Grab the group bounds early as they rely on the dimensions of the group
+    // outputs which will be altered by modifying schedules.
+    map<FStage, map<FStage, DimBounds>> loop_bounds = group_loop_bounds();
+    map<FStage, map<string, Box>> storage_bounds = group_storage_bounds();
+
+    set<string> inlines;
+    // Mark all functions that are inlined.
+    for (const pair<FStage, Group> &g : groups) {
+        for (const string &inline_func : g.second.inlined) {
+            inlines.insert(inline_func);
+        }
+    }
+
+    // Realize schedule for each group in the pipeline.
+    for (const auto &g : groups) {
+        generate_group_gpu_schedule(g.second, t, get_element(loop_bounds, g.first),
+                                    get_element(storage_bounds, g.first), inlines, sched);
+    }
+}
+
 Expr Partitioner::find_max_access_stride(const Scope<int> &vars,
                                          const string &func_acc,
                                          const vector<Expr> &acc_exprs,
@@ -3414,8 +4512,35 @@ string generate_schedules(const vector<Function> &outputs, const Target &target,
     debug(2) << "Determining all unbounded functions...\n";
     set<string> unbounded = get_unbounded_functions(pipeline_bounds, env);
 
+    // On a GPU, the intermediates of the tiles of a group go in the shared
+    // memory of the block computing the tile, so that's the fast memory
+    // the grouping has to fit in.
+    MachineParams params = arch_params;
+    if (target.has_gpu_feature()) {
+        const int gpu_shared_memory_size = 48 * 1024;
+        params.last_level_cache_size =
+            simplify(min(arch_params.last_level_cache_size, gpu_shared_memory_size));
+    }
+
     debug(2) << "Initializing partitioner...\n";
-    Partitioner part(pipeline_bounds, arch_params, dep_analysis, costs, outputs, unbounded);
+    Partitioner part(pipeline_bounds, params, dep_analysis, costs, outputs, unbounded);
+    part.allow_sliding = !target.has_gpu_feature();
+    if (arch_params.time_budget > 0) {
+        part.has_deadline = true;
+        part.deadline = std::chrono::steady_clock::now() +
+            std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<double>(arch_params.time_budget));
+    }
+
+    std::unique_ptr<PipelineBenchmark> benchmark;
+    if (arch_params.cost_model == MachineParams::CostModel::Measured) {
+        Target host = get_host_target();
+        user_assert(target.arch == host.arch && target.bits == host.bits && target.os == host.os)
+            << "AutoSchedule: The measured cost model requires a target that can run "
+            << "on the host, but the target is " << target.to_string() << "\n";
+        benchmark.reset(new PipelineBenchmark(outputs, env, full_order, target));
+        part.benchmark = benchmark.get();
+    }
 
     // Compute and display reuse
     /* TODO: Use the reuse estimates to reorder loops
@@ -3464,8 +4589,13 @@ string generate_schedules(const vector<Function> &outputs, const Target &target,
 
     debug(2) << "Initializing AutoSchedule...\n";
     AutoSchedule sched(env, full_order);
-    debug(2) << "Generating CPU schedule...\n";
-    part.generate_cpu_schedule(target, sched);
+    if (target.has_gpu_feature()) {
+        debug(2) << "Generating GPU schedule...\n";
+        part.generate_gpu_schedule(target, sched);
+    } else {
+        debug(2) << "Generating CPU schedule...\n";
+        part.generate_cpu_schedule(target, sched);
+    }
 
     std::ostringstream oss;
     oss << sched;
@@ -3475,7 +4605,6 @@ string generate_schedules(const vector<Function> &outputs, const Target &target,
              << "*******************************\n" << sched_string << "\n\n";
 
     // TODO: Unify both inlining and grouping for fast mem
-    // TODO: GPU scheduling
     // TODO: Hierarchical tiling
 
     return sched_string;
@@ -22,8 +22,34 @@ struct MachineParams {
      * the cost of an arithmetic operation at last level cache. */
     Expr balance;
 
-    explicit MachineParams(int32_t parallelism, int32_t llc, int32_t balance)
-        : parallelism(parallelism), last_level_cache_size(llc), balance(balance) {}
+    /** How the auto-scheduler compares its choices of grouping and tiling. */
+    enum class CostModel {
+        /** Estimate the arithmetic and memory cost of each choice from
+         * the definitions of the Funcs and the parameters above. */
+        Analytic,
+        /** JIT compile and time the pipeline on the host machine for
+         * the choices the analytic model considers viable, and pick
+         * the fastest. The output estimates are used as the size of
+         * the output, and the estimates on scalar Params as their
+         * values. This is much slower, and requires the target to be
+         * runnable on the host. */
+        Measured
+    };
+    CostModel cost_model;
+    /** Number of partial groupings kept at each step of the search for a
+     * grouping. 1 is a greedy search, which merges the best candidate at
+     * each step; larger widths are slower but less likely to get stuck in
+     * a local optimum. */
+    int beam_width;
+    /** Wall-clock limit on the time spent searching for a grouping, in
+     * seconds. If it runs out, the best grouping found so far is
+     * used. Zero means no limit. */
+    double time_budget;
+
+    explicit MachineParams(int32_t parallelism, int32_t llc, int32_t balance,
+                           CostModel cost_model = CostModel::Analytic)
+        : parallelism(parallelism), last_level_cache_size(llc), balance(balance),
+          cost_model(cost_model), beam_width(1), time_budget(0) {}
 };
 
 namespace Internal {
@@ -46,31 +46,41 @@ Func constant_exterior(const Func &source, Tuple value,
         ") than dimensions (" << source_args.size() << ") Func " <<
         source.name() << "has.\n";
 
-    Expr out_of_bounds = cast<bool>(false);
+    // Check the bounds one dimension at a time, and mark the interior
+    // as likely in each, so that loop partitioning can find a steady
+    // state in every dimension. The interior of a single condition
+    // over all of the dimensions can't be solved for in terms of any
+    // one loop variable.
+    std::vector<Expr> in_bounds;
     for (size_t i = 0; i < bounds.size(); i++) {
         Var arg_var = source_args[i];
         Expr min = bounds[i].first;
         Expr extent = bounds[i].second;
 
         if (min.defined() && extent.defined()) {
-            out_of_bounds = (out_of_bounds ||
-                             arg_var < min ||
-                             arg_var >= min + extent);
+            in_bounds.push_back(arg_var >= min && arg_var < min + extent);
         } else if (min.defined() || extent.defined()) {
             user_error << "Partially undefined bounds for dimension " << arg_var
                        << " of Func " << source.name() << "\n";
         }
     }
 
+    auto with_exterior = [&](Expr interior, Expr exterior) {
+        for (auto it = in_bounds.rbegin(); it != in_bounds.rend(); it++) {
+            interior = select(*it, likely(interior), exterior);
+        }
+        return interior;
+    };
+
     Func bounded("constant_exterior");
     if (value.as_vector().size() > 1) {
         std::vector<Expr> def;
         for (size_t i = 0; i < value.as_vector().size(); i++) {
-            def.push_back(select(out_of_bounds, value[i], repeat_edge(source, bounds)(args)[i]));
+            def.push_back(with_exterior(repeat_edge(source, bounds)(args)[i], value[i]));
         }
         bounded(args) = Tuple(def);
     } else {
-        bounded(args) = select(out_of_bounds, value[0], repeat_edge(source, bounds)(args));
+        bounded(args) = with_exterior(repeat_edge(source, bounds)(args), value[0]);
     }
 
     return bounded;
@@ -82,11 +92,38 @@ Func constant_exterior(const Func &source, Expr value,
 }
 
 
-Func repeat_image(const Func &source,
-                  const std::vector<std::pair<Expr, Expr>> &bounds) {
+namespace {
+
+// Where repeat_image reads from for a coordinate outside the image.
+Expr repeat_image_coord(Expr arg_var, Expr min, Expr extent) {
+    Expr coord = arg_var - min;  // Enforce zero origin.
+    coord = coord % extent;      // Range is 0 to w-1
+    coord = coord + min;         // Restore correct min
+    return coord;
+}
+
+// Where mirror_image reads from for a coordinate outside the image.
+Expr mirror_image_coord(Expr arg_var, Expr min, Expr extent) {
+    Expr coord = arg_var - min;    // Enforce zero origin.
+    coord = coord % (2 * extent);  // Range is 0 to 2w-1
+    coord = select(coord >= extent, 2 * extent - 1 - coord, coord);  // Range is -w+1, w
+    coord = coord + min; // Restore correct min
+    coord = clamp(coord, min, min + extent - 1);
+    return coord;
+}
+
+// The implementation of repeat_image and mirror_image. With index
+// tables, the coordinate outside the image in each dimension is
+// looked up in a table computed at root, instead of being computed
+// with a modulus at every access. The tables have one entry per
+// coordinate used, so they're small, and in a vectorized loop the
+// lookups are dense vector loads.
+Func wrap_image(const char *name, Expr (*wrapped_coord)(Expr, Expr, Expr),
+                const Func &source, const std::vector<std::pair<Expr, Expr>> &bounds,
+                bool use_index_tables) {
     std::vector<Var> args(source.args());
     user_assert(args.size() >= bounds.size()) <<
-        "repeat_image called with more bounds (" << bounds.size() <<
+        name << " called with more bounds (" << bounds.size() <<
         ") than dimensions (" << args.size() << ") Func " <<
         source.name() << "has.\n";
 
@@ -97,14 +134,15 @@ Func repeat_image(const Func &source,
         Expr extent = bounds[i].second;
 
         if (min.defined() && extent.defined()) {
-            Expr coord = arg_var - min;  // Enforce zero origin.
-            coord = coord % extent;      // Range is 0 to w-1
-            coord = coord + min;         // Restore correct min
-
-
+            Expr coord = wrapped_coord(arg_var, min, extent);
+            if (use_index_tables) {
+                Func table(std::string(name) + "_index_" + std::to_string(i));
+                table(arg_var) = coord;
+                table.compute_root();
+                coord = table(arg_var);
+            }
             coord = select(arg_var < min || arg_var >= min + extent, coord,
                            clamp(likely(arg_var), min, min + extent - 1));
-
             actuals.push_back(coord);
         } else if (!min.defined() && !extent.defined()) {
             actuals.push_back(arg_var);
@@ -117,51 +155,32 @@ Func repeat_image(const Func &source,
     // If there were fewer bounds than dimensions, regard the ones at the end as unbounded.
     actuals.insert(actuals.end(), args.begin() + actuals.size(), args.end());
 
-    Func bounded("repeat_image");
+    Func bounded(name);
     bounded(args) = source(actuals);
 
     return bounded;
 }
 
-Func mirror_image(const Func &source,
-                  const std::vector<std::pair<Expr, Expr>> &bounds) {
-    std::vector<Var> args(source.args());
-    user_assert(args.size() >= bounds.size()) <<
-        "mirror_image called with more bounds (" << bounds.size() <<
-        ") than dimensions (" << args.size() << ") Func " <<
-        source.name() << "has.\n";
-
-    std::vector<Expr> actuals;
-    for (size_t i = 0; i < bounds.size(); i++) {
-        Var arg_var = args[i];
-
-        Expr min = bounds[i].first;
-        Expr extent = bounds[i].second;
+}  // namespace
 
-        if (min.defined() && extent.defined()) {
-            Expr coord = arg_var - min;    // Enforce zero origin.
-            coord = coord % (2 * extent);  // Range is 0 to 2w-1
-            coord = select(coord >= extent, 2 * extent - 1 - coord, coord);  // Range is -w+1, w
-            coord = coord + min; // Restore correct min
-            coord = clamp(coord, min, min + extent - 1);
-            coord = select(arg_var < min || arg_var >= min + extent, coord,
-                           clamp(likely(arg_var), min, min + extent-1));
-            actuals.push_back(coord);
-        } else if (!min.defined() && !extent.defined()) {
-            actuals.push_back(arg_var);
-        } else {
-            user_error << "Partially undefined bounds for dimension " << arg_var
-                       << " of Func " << source.name() << "\n";
-        }
-    }
+Func repeat_image(const Func &source,
+                  const std::vector<std::pair<Expr, Expr>> &bounds) {
+    return wrap_image("repeat_image", repeat_image_coord, source, bounds, false);
+}
 
-    // If there were fewer bounds than dimensions, regard the ones at the end as unbounded.
-    actuals.insert(actuals.end(), args.begin() + actuals.size(), args.end());
+Func repeat_image_with_index_tables(const Func &source,
+                                    const std::vector<std::pair<Expr, Expr>> &bounds) {
+    return wrap_image("repeat_image", repeat_image_coord, source, bounds, true);
+}
 
-    Func bounded("mirror_image");
-    bounded(args) = source(actuals);
+Func mirror_image(const Func &source,
+                  const std::vector<std::pair<Expr, Expr>> &bounds) {
+    return wrap_image("mirror_image", mirror_image_coord, source, bounds, false);
+}
 
-    return bounded;
+Func mirror_image_with_index_tables(const Func &source,
+                                    const std::vector<std::pair<Expr, Expr>> &bounds) {
+    return wrap_image("mirror_image", mirror_image_coord, source, bounds, true);
 }
 
 Func mirror_interior(const Func &source,
@@ -222,6 +222,59 @@ inline NO_INLINE Func mirror_image(const T &func_like, Bounds&&... bounds) {
 }
 // @}
 
+/** Versions of repeat_image and mirror_image that look up the
+ *  coordinate to read from outside the image in a small table per
+ *  dimension, instead of computing it with a modulus at every
+ *  access. The tables are computed at root, and have one entry for
+ *  each coordinate used in that dimension. This is faster when a
+ *  vectorized loop spends much of its time outside the image, e.g.
+ *  one that isn't partitioned, or with a large stencil. Inside the
+ *  image, the result is the same as with no tables.
+ */
+// @{
+EXPORT Func repeat_image_with_index_tables(const Func &source,
+                                           const std::vector<std::pair<Expr, Expr>> &bounds);
+
+template <typename T>
+inline NO_INLINE Func repeat_image_with_index_tables(const T &func_like) {
+    std::vector<std::pair<Expr, Expr>> object_bounds;
+    for (int i = 0; i < func_like.dimensions(); i++) {
+        object_bounds.push_back({ Expr(func_like.dim(i).min()), Expr(func_like.dim(i).extent()) });
+    }
+
+    return repeat_image_with_index_tables(Internal::func_like_to_func(func_like), object_bounds);
+}
+
+template <typename T, typename ...Bounds,
+          typename std::enable_if<Halide::Internal::all_are_convertible<Expr, Bounds...>::value>::type* = nullptr>
+inline NO_INLINE Func repeat_image_with_index_tables(const T &func_like, Bounds&&... bounds) {
+    std::vector<std::pair<Expr, Expr>> collected_bounds;
+    ::Halide::Internal::collect_paired_args(collected_bounds, std::forward<Bounds>(bounds)...);
+    return repeat_image_with_index_tables(Internal::func_like_to_func(func_like), collected_bounds);
+}
+
+EXPORT Func mirror_image_with_index_tables(const Func &source,
+                                           const std::vector<std::pair<Expr, Expr>> &bounds);
+
+template <typename T>
+inline NO_INLINE Func mirror_image_with_index_tables(const T &func_like) {
+    std::vector<std::pair<Expr, Expr>> object_bounds;
+    for (int i = 0; i < func_like.dimensions(); i++) {
+        object_bounds.push_back({ Expr(func_like.dim(i).min()), Expr(func_like.dim(i).extent()) });
+    }
+
+    return mirror_image_with_index_tables(Internal::func_like_to_func(func_like), object_bounds);
+}
+
+template <typename T, typename ...Bounds,
+          typename std::enable_if<Halide::Internal::all_are_convertible<Expr, Bounds...>::value>::type* = nullptr>
+inline NO_INLINE Func mirror_image_with_index_tables(const T &func_like, Bounds&&... bounds) {
+    std::vector<std::pair<Expr, Expr>> collected_bounds;
+    ::Halide::Internal::collect_paired_args(collected_bounds, std::forward<Bounds>(bounds)...);
+    return mirror_image_with_index_tables(Internal::func_like_to_func(func_like), collected_bounds);
+}
+// @}
+
 /** Impose a boundary condition such that the entire coordinate space is
  *  tiled with copies of the image abutted against each other, but mirror
  *  them such that adjacent edges are the same and then overlap the edges.
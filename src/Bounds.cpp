@@ -16,6 +16,7 @@
 #include "Deinterleave.h"
 #include "Param.h"
 #include "Solve.h"
+#include "ArithmeticIntrinsics.h"
 
 namespace Halide {
 namespace Internal {
@@ -745,6 +746,8 @@ private:
         } else if (op->is_intrinsic(Call::memoize_expr)) {
             internal_assert(op->args.size() >= 1);
             op->args[0].accept(this);
+        } else if (is_arithmetic_intrinsic(op)) {
+            lower_arithmetic_intrinsic(op).accept(this);
         } else if (op->call_type == Call::Halide) {
             bounds_of_func(op->name, op->value_index, op->type);
         } else {
@@ -816,6 +819,42 @@ private:
         interval = result;
     }
 
+    void visit(const VectorReduce *op) {
+        op->value.accept(this);
+        int factor = op->value.type().lanes() / op->type.lanes();
+        switch (op->op) {
+        case VectorReduce::Add:
+            // Assume no overflow for float, int32, and int64
+            if (!op->type.is_float() && (!op->type.is_int() || op->type.bits() < 32)) {
+                Type t = op->type.element_of();
+                if (!interval.is_bounded() ||
+                    !can_prove(cast<int64_t>(interval.max) * factor <= t.max() &&
+                               cast<int64_t>(interval.min) * factor >= t.min())) {
+                    bounds_of_type(op->type);
+                    break;
+                }
+            }
+            if (interval.has_upper_bound()) {
+                interval.max *= factor;
+            }
+            if (interval.has_lower_bound()) {
+                interval.min *= factor;
+            }
+            break;
+        case VectorReduce::Mul:
+            // Don't try to bound products.
+            bounds_of_type(op->type);
+            break;
+        case VectorReduce::Min:
+        case VectorReduce::Max:
+        case VectorReduce::And:
+        case VectorReduce::Or:
+            // The result is one of the lanes, or for bools is
+            // bounded by the bounds of the lanes.
+            break;
+        }
+    }
+
     void visit(const LetStmt *) {
         internal_error << "Bounds of statement\n";
     }
@@ -1599,14 +1638,21 @@ private:
             op->extent.accept(this);
         }
 
+        // Loops made from a schedule start at their loop_min, and
+        // end at their loop_max. Loops that don't (such as the loops
+        // fused by Func::compute_with) are bounded by their min and
+        // extent instead.
+        const Variable *min_var = op->min.as<Variable>();
+        bool has_loop_bounds = min_var && min_var->name == op->name + ".loop_min";
+
         Expr min_val, max_val;
-        if (scope.contains(op->name + ".loop_min")) {
+        if (has_loop_bounds && scope.contains(op->name + ".loop_min")) {
             min_val = scope.get(op->name + ".loop_min").min;
         } else {
             min_val = bounds_of_expr_in_scope(op->min, scope, func_bounds).min;
         }
 
-        if (scope.contains(op->name + ".loop_max")) {
+        if (has_loop_bounds && scope.contains(op->name + ".loop_max")) {
             max_val = scope.get(op->name + ".loop_max").max;
         } else {
             max_val = bounds_of_expr_in_scope(op->extent, scope, func_bounds).max;
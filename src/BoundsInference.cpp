@@ -2,6 +2,7 @@
 #include "IRMutator.h"
 #include "Scope.h"
 #include "Bounds.h"
+#include "FuseLoops.h"
 #include "IROperator.h"
 #include "Inline.h"
 #include "Simplify.h"
@@ -244,6 +245,12 @@ public:
                 exprs.push_back(CondValue(const_true(), func.extern_definition_proxy_expr()));
             }
 
+            if (!is_update && func.schedule().compute_if().defined()) {
+                // The condition is evaluated before the stage is
+                // computed, so it needs whatever it calls to exist.
+                exprs.push_back(CondValue(const_true(), func.schedule().compute_if()));
+            }
+
             exprs.insert(exprs.end(), result[1].begin(), result[1].end());
         }
 
@@ -266,7 +273,7 @@ public:
 
         // Wrap a statement in let stmts defining the box
         Stmt define_bounds(Stmt s,
-                           string producing_stage,
+                           const set<string> &producing_stages,
                            string loop_level,
                            const Scope<int> &in_stages,
                            const set<string> &in_pipeline,
@@ -281,7 +288,7 @@ public:
             for (const pair<pair<string, int>, Box> &i : bounds) {
                 string func_name = i.first.first;
                 string stage_name = func_name + ".s" + std::to_string(i.first.second);
-                if (stage_name == producing_stage ||
+                if (producing_stages.count(stage_name) ||
                     inner_productions.count(func_name)) {
                     merge_boxes(b, i.second);
                 }
@@ -683,16 +690,23 @@ public:
 
         }
 
-        // Do any pure inlining (TODO: This is currently slow)
+        // Do any pure inlining (TODO: This is currently slow). The
+        // specializations of a definition mostly share their values,
+        // so only inline each distinct value once.
         for (size_t i = f.size(); i > 0; i--) {
             Function func = f[i-1];
             if (inlined[i-1]) {
+                map<Expr, Expr, ExprCompare> inlined_values;
                 for (size_t j = 0; j < stages.size(); j++) {
                     Stage &s = stages[j];
                     for (size_t k = 0; k < s.exprs.size(); k++) {
                         CondValue &cond_val = s.exprs[k];
                         internal_assert(cond_val.value.defined());
-                        cond_val.value = inline_function(cond_val.value, func);
+                        Expr &inlined_value = inlined_values[cond_val.value];
+                        if (!inlined_value.defined()) {
+                            inlined_value = inline_function(cond_val.value, func);
+                        }
+                        cond_val.value = inlined_value;
                     }
                 }
             }
@@ -754,9 +768,16 @@ public:
                     }
                 }
             } else {
+                // Different specializations often use the same
+                // values under different conditions, so compute the
+                // boxes required by each distinct value only once.
+                map<Expr, map<string, Box>, IRDeepCompare> boxes_of_value;
                 for (const auto &cval : consumer.exprs) {
-                    map<string, Box> new_boxes;
-                    new_boxes = boxes_required(cval.value, scope, func_bounds);
+                    auto cached = boxes_of_value.find(cval.value);
+                    if (cached == boxes_of_value.end()) {
+                        cached = boxes_of_value.emplace(cval.value, boxes_required(cval.value, scope, func_bounds)).first;
+                    }
+                    map<string, Box> new_boxes = cached->second;
                     for (auto &i : new_boxes) {
                         // Add the condition on which this value is evaluated to the box before merging
                         Box &box = i.second;
@@ -842,6 +863,24 @@ public:
         }
     }
 
+    // The fused loops iterate over the union of the regions of the
+    // Funcs merged into them, so some iterations compute nothing of
+    // some of them. Clamp the region one iteration produces to the
+    // region of the whole Func, so that the Funcs computed inside the
+    // fused loops don't compute more than they are required to.
+    Stmt define_fused_production_bounds(Stmt body, const Stage &s, const Box &box) {
+        const vector<string> args = s.func.args();
+        for (size_t i = 0; i < box.size(); i++) {
+            internal_assert(box[i].is_bounded());
+            string var = s.stage_prefix + args[i];
+            Expr min = Variable::make(Int(32), var + ".loop_min");
+            Expr max = Variable::make(Int(32), var + ".loop_max");
+            body = LetStmt::make(var + ".max", Halide::min(box[i].max, max), body);
+            body = LetStmt::make(var + ".min", Halide::max(box[i].min, min), body);
+        }
+        return body;
+    }
+
     using IRMutator::visit;
 
     void visit(const For *op) {
@@ -879,14 +918,37 @@ public:
             }
         }
 
+        // If the loop nests of other Funcs were merged into this one
+        // (see Func::compute_with), this loop produces them too.
+        vector<int> fused;
+        if (producing >= 0 && stages[producing].stage == 0) {
+            for (size_t i = 0; i < stages.size(); i++) {
+                if (stages[i].stage == 0 && is_fused_loop(op->name, f, stages[i].func)) {
+                    fused.push_back(i);
+                }
+            }
+        }
+
         in_stages.push(stage_name, 0);
 
+        set<string> producing_stages;
+        if (producing >= 0) {
+            producing_stages.insert(stage_name);
+        }
+        for (int i : fused) {
+            producing_stages.insert(stages[i].name + ".s0");
+        }
+
         // Figure out how much of it we're producing
         Box box;
+        vector<Box> fused_boxes;
         if (!no_pipelines && producing >= 0) {
             Scope<Interval> empty_scope;
             box = box_provided(body, stages[producing].name, empty_scope, func_bounds);
             internal_assert((int)box.size() == f.dimensions());
+            for (int i : fused) {
+                fused_boxes.push_back(box_provided(body, stages[i].name, empty_scope, func_bounds));
+            }
         }
 
         // Recurse.
@@ -912,13 +974,18 @@ public:
                     for (size_t j = 0; j < stages[i].consumers.size(); j++) {
                         bounds_needed[stages[i].consumers[j]] = true;
                     }
-                    body = stages[i].define_bounds(body, stage_name, op->name, in_stages, in_pipeline, inner_productions, target);
+                    body = stages[i].define_bounds(body, producing_stages, op->name, in_stages, in_pipeline, inner_productions, target);
                 }
             }
 
             // Finally, define the production bounds for the thing
             // we're producing.
-            if (producing >= 0 && !inner_productions.empty()) {
+            if (producing >= 0 && !inner_productions.empty() && !fused.empty()) {
+                body = define_fused_production_bounds(body, stages[producing], box);
+                for (size_t i = 0; i < fused.size(); i++) {
+                    body = define_fused_production_bounds(body, stages[fused[i]], fused_boxes[i]);
+                }
+            } else if (producing >= 0 && !inner_productions.empty()) {
                 const vector<string> f_args = f.args();
                 for (size_t i = 0; i < box.size(); i++) {
                     internal_assert(box[i].is_bounded());
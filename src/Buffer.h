@@ -122,8 +122,8 @@ public:
     }
 
     /** Construct a Buffer that captures and owns an rvalue Runtime::Buffer */
-    template<int D>
-    Buffer(Runtime::Buffer<T, D> &&buf, const std::string &name = "") :
+    template<int D, int Dims>
+    Buffer(Runtime::Buffer<T, D, Dims> &&buf, const std::string &name = "") :
         contents(new Internal::BufferContents) {
         contents->buf = std::move(buf);
         if (name.empty()) {
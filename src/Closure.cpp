@@ -44,8 +44,10 @@ void Closure::found_buffer_ref(const string &name, Type type,
         debug(3) << "Adding buffer " << name << " to closure\n";
         Buffer &ref = buffers[name];
         ref.type = type.element_of(); // TODO: Validate type is the same as existing refs?
-        ref.read = read;
-        ref.write = written;
+        // A buffer both read and written in different places is
+        // both, whatever order they are visited in.
+        ref.read = ref.read || read;
+        ref.write = ref.write || written;
 
         // If reading an image/buffer, compute the size.
         if (image.defined()) {
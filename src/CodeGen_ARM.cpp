@@ -427,7 +427,70 @@ void CodeGen_ARM::visit(const Div *op) {
     CodeGen_Posix::visit(op);
 }
 
+namespace {
+
+// Flatten a sum into the products of two factors that can be
+// losslessly narrowed to the given type, and everything else.
+void find_narrow_products(Expr e, Type narrow, vector<pair<Expr, Expr>> &products, Expr &rest) {
+    if (const Add *add = e.as<Add>()) {
+        find_narrow_products(add->a, narrow, products, rest);
+        find_narrow_products(add->b, narrow, products, rest);
+        return;
+    } else if (const Mul *mul = e.as<Mul>()) {
+        Expr a = lossless_cast(narrow, mul->a);
+        Expr b = lossless_cast(narrow, mul->b);
+        if (a.defined() && b.defined()) {
+            products.push_back({a, b});
+            return;
+        }
+    }
+    rest = rest.defined() ? Add::make(rest, e) : e;
+}
+
+}
+
 void CodeGen_ARM::visit(const Add *op) {
+#if LLVM_VERSION >= 60
+    // Sums of four widening 8-bit multiplies can use the ARMv8.2
+    // dot product instructions, which compute four of them per
+    // 32-bit lane. These typically come from reductions over an
+    // unrolled dimension, in which case the interleaves below
+    // simplify to dense loads.
+    if (target.bits == 64 && target.has_feature(Target::ARMDotProd) &&
+        !neon_intrinsics_disabled() &&
+        op->type.is_vector() && op->type.bits() == 32 && op->type.lanes() >= 2) {
+        int lanes = op->type.lanes();
+        vector<Type> narrow_types;
+        if (op->type.is_int()) {
+            narrow_types = {UInt(8, lanes), Int(8, lanes)};
+        } else if (op->type.is_uint()) {
+            narrow_types = {UInt(8, lanes)};
+        }
+        for (Type narrow : narrow_types) {
+            vector<pair<Expr, Expr>> products;
+            Expr rest;
+            find_narrow_products(op, narrow, products, rest);
+            if (products.empty() || products.size() % 4 != 0) {
+                continue;
+            }
+
+            string intrin = narrow.is_uint() ? "llvm.aarch64.neon.udot" : "llvm.aarch64.neon.sdot";
+            int intrin_lanes = lanes == 2 ? 2 : 4;
+            intrin += intrin_lanes == 2 ? ".v2i32.v8i8" : ".v4i32.v16i8";
+
+            Value *acc = rest.defined() ? codegen(rest) : codegen(make_zero(op->type));
+            for (size_t i = 0; i < products.size(); i += 4) {
+                Expr a = simplify(Shuffle::make_interleave({products[i].first, products[i+1].first,
+                                                            products[i+2].first, products[i+3].first}));
+                Expr b = simplify(Shuffle::make_interleave({products[i].second, products[i+1].second,
+                                                            products[i+2].second, products[i+3].second}));
+                acc = call_intrin(llvm_type_of(op->type), intrin_lanes, intrin, {acc, codegen(a), codegen(b)});
+            }
+            value = acc;
+            return;
+        }
+    }
+#endif
     CodeGen_Posix::visit(op);
 }
 
@@ -543,6 +606,50 @@ void CodeGen_ARM::visit(const Min *op) {
     CodeGen_Posix::visit(op);
 }
 
+void CodeGen_ARM::visit(const VectorReduce *op) {
+    if (neon_intrinsics_disabled()) {
+        CodeGen_Posix::visit(op);
+        return;
+    }
+
+    const int lanes = op->value.type().lanes();
+    const int factor = lanes / op->type.lanes();
+
+    // Sums of widened integers can start with a widening pairwise
+    // add, which halves the number of lanes in one instruction.
+    const Cast *cast = op->value.as<Cast>();
+    if (op->op == VectorReduce::Add && cast && factor % 2 == 0) {
+        Type narrow = cast->value.type();
+        int bits = narrow.bits();
+        if ((narrow.is_int() || narrow.is_uint()) &&
+            narrow.code() == op->type.code() &&
+            op->type.bits() >= bits * 2 &&
+            bits <= 32 && lanes % (128 / bits) == 0) {
+            Type wide = narrow.with_bits(bits * 2).with_lanes(lanes / 2);
+            ostringstream intrin;
+            if (target.bits == 32) {
+                intrin << "llvm.arm.neon.vpaddl" << (narrow.is_uint() ? "u" : "s");
+            } else {
+                intrin << "llvm.aarch64.neon." << (narrow.is_uint() ? "u" : "s") << "addlp";
+            }
+            intrin << ".v" << (64 / bits) << "i" << (bits * 2)
+                   << ".v" << (128 / bits) << "i" << bits;
+            Value *pairs = call_intrin(wide, 64 / bits, intrin.str(), {cast->value});
+            string name = unique_name('p');
+            sym_push(name, pairs);
+            Expr partial = Variable::make(wide, name);
+            if (wide.bits() != op->type.bits()) {
+                partial = Cast::make(op->type.with_lanes(lanes / 2), partial);
+            }
+            codegen(VectorReduce::make(VectorReduce::Add, partial, op->type.lanes()));
+            sym_pop(name);
+            return;
+        }
+    }
+
+    CodeGen_Posix::visit(op);
+}
+
 void CodeGen_ARM::visit(const Max *op) {
     if (neon_intrinsics_disabled()) {
         CodeGen_Posix::visit(op);
@@ -973,19 +1080,28 @@ string CodeGen_ARM::mcpu() const {
 
 string CodeGen_ARM::mattrs() const {
     if (target.bits == 32) {
+        string fp16_flags = target.has_feature(Target::ARMFp16) ? ",+fp16,+fullfp16" : "";
         if (target.has_feature(Target::ARMv7s)) {
-            return "+neon";
+            return "+neon" + fp16_flags;
         } if (!target.has_feature(Target::NoNEON)) {
-            return "+neon";
+            return "+neon" + fp16_flags;
         } else {
-            return "-neon";
+            return "-neon" + fp16_flags;
         }
     } else {
+        string arch_flags;
+        if (target.has_feature(Target::ARMDotProd)) {
+            arch_flags = "+dotprod";
+        }
+        if (target.has_feature(Target::ARMFp16)) {
+            // AArch64 always has the conversions. This adds native
+            // half-precision arithmetic, scalar and vector.
+            arch_flags += arch_flags.empty() ? "+fullfp16" : ",+fullfp16";
+        }
         if (target.os == Target::IOS || target.os == Target::OSX) {
-            return "+reserve-x18";
-        } else {
-            return "";
+            arch_flags += arch_flags.empty() ? "+reserve-x18" : ",+reserve-x18";
         }
+        return arch_flags;
     }
 }
 
@@ -8,6 +8,7 @@
 #include "Param.h"
 #include "Var.h"
 #include "Lerp.h"
+#include "ArithmeticIntrinsics.h"
 #include "Simplify.h"
 #include "Deinterleave.h"
 
@@ -817,6 +818,14 @@ private:
 
         const char *native_vector_decl = R"INLINE_CODE(
 #if __has_attribute(ext_vector_type) || __has_attribute(vector_size)
+// The signed integer type with the same size as a vector element; vector
+// comparisons produce lanes of this type that are all ones or all zeros.
+template <size_t Bytes> struct NativeVectorIntOfSize;
+template <> struct NativeVectorIntOfSize<1> { typedef int8_t type; };
+template <> struct NativeVectorIntOfSize<2> { typedef int16_t type; };
+template <> struct NativeVectorIntOfSize<4> { typedef int32_t type; };
+template <> struct NativeVectorIntOfSize<8> { typedef int64_t type; };
+
 template <typename ElementType_, size_t Lanes_>
 class NativeVector {
 public:
@@ -825,10 +834,16 @@ public:
     typedef NativeVector<ElementType, Lanes> Vec;
     typedef NativeVector<uint8_t, Lanes> Mask;
 
+    typedef typename NativeVectorIntOfSize<sizeof(ElementType)>::type IntElementType;
+
 #if __has_attribute(ext_vector_type)
     typedef ElementType_ NativeVectorType __attribute__((ext_vector_type(Lanes), aligned(sizeof(ElementType))));
+    typedef IntElementType NativeIntVectorType __attribute__((ext_vector_type(Lanes), aligned(sizeof(ElementType))));
+    typedef int8_t NativeInt8VectorType __attribute__((ext_vector_type(Lanes), aligned(1)));
 #elif __has_attribute(vector_size) || __GNUC__
     typedef ElementType_ NativeVectorType __attribute__((vector_size(Lanes * sizeof(ElementType)), aligned(sizeof(ElementType))));
+    typedef IntElementType NativeIntVectorType __attribute__((vector_size(Lanes * sizeof(ElementType)), aligned(sizeof(ElementType))));
+    typedef int8_t NativeInt8VectorType __attribute__((vector_size(Lanes), aligned(1)));
 #endif
 
     NativeVector &operator=(const Vec &src) {
@@ -1011,67 +1026,34 @@ public:
         return Vec(from_native_vector, a | b.native_vector);
     }
 
-    // TODO: this should be improved by taking advantage of native operator support.
     friend Mask operator<(const Vec &a, const Vec &b) {
-        Mask r;
-        for (size_t i = 0; i < Lanes; i++) {
-            r.native_vector[i] = a[i] < b[i] ? 0xff : 0x00;
-        }
-        return r;
+        return mask_from_comparison(a.native_vector < b.native_vector);
     }
 
-    // TODO: this should be improved by taking advantage of native operator support.
     friend Mask operator<=(const Vec &a, const Vec &b) {
-        Mask r;
-        for (size_t i = 0; i < Lanes; i++) {
-            r.native_vector[i] = a[i] <= b[i] ? 0xff : 0x00;
-        }
-        return r;
+        return mask_from_comparison(a.native_vector <= b.native_vector);
     }
 
-    // TODO: this should be improved by taking advantage of native operator support.
     friend Mask operator>(const Vec &a, const Vec &b) {
-        Mask r;
-        for (size_t i = 0; i < Lanes; i++) {
-            r.native_vector[i] = a[i] > b[i] ? 0xff : 0x00;
-        }
-        return r;
+        return mask_from_comparison(a.native_vector > b.native_vector);
     }
 
-    // TODO: this should be improved by taking advantage of native operator support.
     friend Mask operator>=(const Vec &a, const Vec &b) {
-        Mask r;
-        for (size_t i = 0; i < Lanes; i++) {
-            r.native_vector[i] = a[i] >= b[i] ? 0xff : 0x00;
-        }
-        return r;
+        return mask_from_comparison(a.native_vector >= b.native_vector);
     }
 
-    // TODO: this should be improved by taking advantage of native operator support.
     friend Mask operator==(const Vec &a, const Vec &b) {
-        Mask r;
-        for (size_t i = 0; i < Lanes; i++) {
-            r.native_vector[i] = a[i] == b[i] ? 0xff : 0x00;
-        }
-        return r;
+        return mask_from_comparison(a.native_vector == b.native_vector);
     }
 
-    // TODO: this should be improved by taking advantage of native operator support.
     friend Mask operator!=(const Vec &a, const Vec &b) {
-        Mask r;
-        for (size_t i = 0; i < Lanes; i++) {
-            r.native_vector[i] = a[i] != b[i] ? 0xff : 0x00;
-        }
-        return r;
+        return mask_from_comparison(a.native_vector != b.native_vector);
     }
 
-    // TODO: this should be improved by taking advantage of native operator support.
     static Vec select(const Mask &cond, const Vec &true_value, const Vec &false_value) {
-        Vec r(empty);
-        for (size_t i = 0; i < Lanes; i++) {
-            r.native_vector[i] = cond[i] ? true_value[i] : false_value[i];
-        }
-        return r;
+        NativeIntVectorType cmp;
+        comparison_from_mask(cond, cmp);
+        return blend(cmp, true_value.native_vector, false_value.native_vector);
     }
 
     template <typename OtherVec>
@@ -1094,22 +1076,13 @@ public:
 #endif
     }
 
-    // TODO: this should be improved by taking advantage of native operator support.
+    // These match halide_cpp_max and halide_cpp_min, including for NaNs.
     static Vec max(const Vec &a, const Vec &b) {
-        Vec r(empty);
-        for (size_t i = 0; i < Lanes; i++) {
-            r.native_vector[i] = ::halide_cpp_max(a[i], b[i]);
-        }
-        return r;
+        return blend(a.native_vector > b.native_vector, a.native_vector, b.native_vector);
     }
 
-    // TODO: this should be improved by taking advantage of native operator support.
     static Vec min(const Vec &a, const Vec &b) {
-        Vec r(empty);
-        for (size_t i = 0; i < Lanes; i++) {
-            r.native_vector[i] = ::halide_cpp_min(a[i], b[i]);
-        }
-        return r;
+        return blend(a.native_vector < b.native_vector, a.native_vector, b.native_vector);
     }
 
 private:
@@ -1117,6 +1090,40 @@ private:
 
     NativeVectorType native_vector;
 
+    // Pick lanes from a where the comparison result is all ones, and
+    // from b where it is zero, without leaving vector registers.
+    static Vec blend(const NativeIntVectorType &cmp, const NativeVectorType &a, const NativeVectorType &b) {
+        NativeIntVectorType bits = ((NativeIntVectorType)a & cmp) | ((NativeIntVectorType)b & ~cmp);
+        return Vec(from_native_vector, (NativeVectorType)bits);
+    }
+
+    // Narrow the result of a native comparison to a Mask of 0xff/0x00 bytes.
+    static Mask mask_from_comparison(const NativeIntVectorType &cmp) {
+        Mask r(Mask::empty);
+#if __has_builtin(__builtin_convertvector)
+        r.native_vector = (typename Mask::NativeVectorType)__builtin_convertvector(cmp, NativeInt8VectorType);
+#else
+        for (size_t i = 0; i < Lanes; i++) {
+            r.native_vector[i] = cmp[i] ? 0xff : 0x00;
+        }
+#endif
+        return r;
+    }
+
+    // Widen a Mask to the all-ones/all-zeros lanes a comparison would
+    // produce. (This doesn't return the vector by value, because that
+    // changes the ABI depending on the instruction set.)
+    static void comparison_from_mask(const Mask &cond, NativeIntVectorType &r) {
+#if __has_builtin(__builtin_convertvector)
+        // Reinterpreting as signed first makes 0xff widen to all ones.
+        r = __builtin_convertvector((NativeInt8VectorType)cond.native_vector, NativeIntVectorType);
+#else
+        for (size_t i = 0; i < Lanes; i++) {
+            r[i] = cond.native_vector[i] ? -1 : 0;
+        }
+#endif
+    }
+
     // Leave vector uninitialized for cases where we overwrite every entry
     enum Empty { empty };
     inline NativeVector(Empty) {}
@@ -1950,6 +1957,8 @@ void CodeGen_C::visit(const Call *op) {
         internal_assert(op->args.size() == 3);
         Expr e = lower_lerp(op->args[0], op->args[1], op->args[2]);
         rhs << print_expr(e);
+    } else if (is_arithmetic_intrinsic(op)) {
+        rhs << print_expr(lower_arithmetic_intrinsic(op));
     } else if (op->is_intrinsic(Call::absd)) {
         internal_assert(op->args.size() == 2);
         Expr a = op->args[0];
@@ -2137,6 +2146,12 @@ void CodeGen_C::visit(const Call *op) {
         user_error << "Indeterminate expression occurred during constant-folding.\n";
     } else if (op->is_intrinsic(Call::size_of_halide_buffer_t)) {
         rhs << "(sizeof(halide_buffer_t))";
+    } else if (op->is_intrinsic(Call::atomic_update)) {
+        user_error << "Atomic stores (see Stage::atomic) are not supported by this backend.\n";
+    } else if (op->is_intrinsic(Call::nontemporal_store)) {
+        // This backend ignores the hint.
+        internal_assert(op->args.size() == 1);
+        rhs << print_expr(op->args[0]);
     } else if (op->is_intrinsic()) {
         // TODO: other intrinsics
         internal_error << "Unhandled intrinsic in C backend: " << op->name << '\n';
@@ -2308,8 +2323,15 @@ void CodeGen_C::visit(const LetStmt *op) {
         // The body might contain a Load or Store that references this
         // directly by name, so we can't rewrite the name.
         do_indent();
-        stream << print_type(op->value.type())
-               << " " << print_name(op->name)
+        stream << print_type(op->value.type()) << " ";
+        // Halide assumes that distinct buffers don't alias, as the
+        // LLVM backends do. Saying so lets the C compiler vectorize
+        // loops that load from one buffer and store to another.
+        const Call *call = op->value.as<Call>();
+        if (call && call->name == Call::buffer_get_host) {
+            stream << "__restrict ";
+        }
+        stream << print_name(op->name)
                << " = " << id_value << ";\n";
     } else {
         Expr new_var = Variable::make(op->value.type(), id_value);
@@ -2369,17 +2391,45 @@ void CodeGen_C::visit(const ProducerConsumer *op) {
 }
 
 void CodeGen_C::visit(const For *op) {
-    if (op->for_type == ForType::Parallel) {
-        do_indent();
-        stream << "#pragma omp parallel for\n";
-    } else {
-        internal_assert(op->for_type == ForType::Serial)
-            << "Can only emit serial or parallel for loops to C\n";
-    }
+    internal_assert(op->for_type == ForType::Serial || op->for_type == ForType::Parallel)
+        << "Can only emit serial or parallel for loops to C\n";
 
     string id_min = print_expr(op->min);
     string id_extent = print_expr(op->extent);
 
+    if (op->for_type == ForType::Parallel) {
+        // Run the body as a task on the Halide thread pool, so that the
+        // parallelism doesn't depend on the compiler supporting
+        // OpenMP. The body is a lambda that captures everything by
+        // reference; halide_do_par_for calls it through a trampoline
+        // that is passed the lambda as its closure. Assertions in the
+        // body return their error code from the task.
+        string task = unique_name('t');
+        do_indent();
+        stream << "auto " << task << " = [&](int " << print_name(op->name) << ") -> int\n";
+        open_scope();
+        op->body.accept(this);
+        do_indent();
+        stream << "return 0;\n";
+        cache.clear();
+        indent--;
+        do_indent();
+        stream << "};\n";
+
+        string result = unique_name('r');
+        do_indent();
+        stream << "int " << result << " = halide_do_par_for(_ucon, "
+               << "[](void *, int i, uint8_t *c) -> int { return (*(decltype(" << task << ") *)c)(i); }, "
+               << id_min << ", " << id_extent << ", (uint8_t *)&" << task << ");\n";
+        do_indent();
+        stream << "if (" << result << ")\n";
+        open_scope();
+        do_indent();
+        stream << "return " << result << ";\n";
+        close_scope("par for " + print_name(op->name));
+        return;
+    }
+
     do_indent();
     stream << "for (int "
            << print_name(op->name)
@@ -2437,7 +2487,7 @@ void CodeGen_C::visit(const Allocate *op) {
         alloc.type = op->type;
         allocations.push(op->name, alloc);
         heap_allocations.push(op->name, 0);
-        stream << op_type << "*" << op_name << " = (" << print_expr(op->new_expr) << ");\n";
+        stream << op_type << "*" << op_name << " = (" << op_type << "*)(" << print_expr(op->new_expr) << ");\n";
     } else {
         constant_size = op->constant_allocation_size();
         if (constant_size > 0) {
@@ -2572,11 +2622,19 @@ void CodeGen_C::visit(const IfThenElse *op) {
 
 void CodeGen_C::visit(const Evaluate *op) {
     if (is_const(op->value)) return;
+    // This backend doesn't weight branches.
+    if (const Call *c = op->value.as<Call>()) {
+        if (c->is_intrinsic(Call::branch_profile)) return;
+    }
     string id = print_expr(op->value);
     do_indent();
     stream << "(void)" << id << ";\n";
 }
 
+void CodeGen_C::visit(const VectorReduce *op) {
+    print_expr(lower_vector_reduce(op));
+}
+
 void CodeGen_C::visit(const Shuffle *op) {
     internal_assert(op->vectors.size() >= 1);
     internal_assert(op->vectors[0].type().is_vector());
@@ -2662,7 +2720,7 @@ extern "C" {
 int test1(struct halide_buffer_t *_buf_buffer, float _alpha, int32_t _beta, void const *__user_context) HALIDE_FUNCTION_ATTRS {
  void * const _ucon = const_cast<void *>(__user_context);
  void *_0 = _halide_buffer_get_host(_buf_buffer);
- void * _buf = _0;
+ void * __restrict _buf = _0;
  {
   int64_t _1 = 43;
   int64_t _2 = _1 * _beta;
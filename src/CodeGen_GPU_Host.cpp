@@ -205,6 +205,14 @@ void CodeGen_GPU_Host<CodeGen_CPU>::compile_func(const LoweredFunc &f,
         Value *result = builder->CreateCall(init, init_kernels_args);
         Value *did_succeed = builder->CreateICmpEQ(result, ConstantInt::get(i32_t, 0));
         CodeGen_CPU::create_assertion(did_succeed, Expr(), result);
+
+        if (i.first == DeviceAPI::Metal) {
+            // The Metal runtime batches up the kernel dispatches, and
+            // commits them when the pipeline returns.
+            llvm::Function *finish = module->getFunction("halide_metal_finish_pipeline_as_destructor");
+            internal_assert(finish) << "Could not find halide_metal_finish_pipeline_as_destructor in initial module\n";
+            CodeGen_CPU::register_destructor(finish, module_state, CodeGen_CPU::Always);
+        }
     }
 
     // the init kernels block should branch to the post-entry block
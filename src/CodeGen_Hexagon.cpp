@@ -202,12 +202,9 @@ void CodeGen_Hexagon::compile_func(const LoweredFunc &f,
 
     // Generating vtmpy before CSE and align_loads makes it easier to match
     // patterns for vtmpy.
-    #if 0
-    // TODO(aankit): Re-enable this after fixing complexity issue.
     debug(1) << "Generating vtmpy...\n";
     body = vtmpy_generator(body);
     debug(2) << "Lowering after generating vtmpy:\n" << body << "\n\n";
-    #endif
 
     debug(1) << "Aligning loads for HVX....\n";
     body = align_loads(body, target.natural_vector_size(Int(8)));
@@ -218,7 +215,7 @@ void CodeGen_Hexagon::compile_func(const LoweredFunc &f,
 
     debug(1) << "Carrying values across loop iterations...\n";
     // Use at most 16 vector registers for carrying values.
-    body = loop_carry(body, 16);
+    body = loop_carry(body, 16, target.natural_vector_size(Int(8)));
     body = simplify(body);
     debug(2) << "Lowering after forwarding stores:\n" << body << "\n\n";
 
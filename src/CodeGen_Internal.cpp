@@ -1,6 +1,7 @@
 #include "CodeGen_Internal.h"
 #include "IROperator.h"
 #include "IRMutator.h"
+#include "IREquality.h"
 #include "CSE.h"
 #include "Debug.h"
 
@@ -151,18 +152,36 @@ bool function_takes_user_context(const std::string &name) {
         "halide_device_malloc",
         "halide_device_and_host_malloc",
         "halide_device_sync",
+        "halide_do_fork",
         "halide_do_par_for",
         "halide_do_task",
         "halide_error",
         "halide_free",
         "halide_malloc",
+        "halide_parallel_task_size",
+        "halide_parallel_task_size_feedback",
         "halide_print",
+        "halide_profiler_branch_taken",
         "halide_profiler_memory_allocate",
         "halide_profiler_memory_free",
         "halide_profiler_pipeline_start",
         "halide_profiler_pipeline_end",
+        "halide_profiler_register_branches",
+        "halide_profiler_release_thread_slot",
         "halide_profiler_stack_peak_update",
+        "halide_schedule_variant_begin",
+        "halide_schedule_variant_end",
+        "halide_scratch_arena_acquire",
+        "halide_scratch_arena_alloc",
+        "halide_scratch_arena_free",
+        "halide_scratch_arena_release",
+        "halide_scratch_arenas_create",
+        "halide_scratch_arenas_destroy",
+        "halide_semaphore_abort_as_destructor",
         "halide_spawn_thread",
+        "halide_stream_state_acquire",
+        "halide_stream_state_data",
+        "halide_stream_state_release",
         "halide_device_release",
         "halide_start_clock",
         "halide_trace",
@@ -170,11 +189,13 @@ bool function_takes_user_context(const std::string &name) {
         "halide_memoization_cache_lookup",
         "halide_memoization_cache_store",
         "halide_memoization_cache_release",
+        "halide_memoization_hash_buffer",
         "halide_cuda_run",
         "halide_opencl_run",
         "halide_opengl_run",
         "halide_openglcompute_run",
         "halide_metal_run",
+        "halide_metal_finish_pipeline_as_destructor",
         "halide_msan_annotate_buffer_is_initialized_as_destructor",
         "halide_msan_annotate_buffer_is_initialized",
         "halide_msan_annotate_memory_is_initialized",
@@ -272,6 +293,64 @@ Expr lower_euclidean_mod(Expr a, Expr b) {
 
 namespace {
 
+Expr vector_reduce_binop(VectorReduce::Operator op, Expr a, Expr b) {
+    switch (op) {
+    case VectorReduce::Add:
+        return Add::make(a, b);
+    case VectorReduce::Mul:
+        return Mul::make(a, b);
+    case VectorReduce::Min:
+        return Min::make(a, b);
+    case VectorReduce::Max:
+        return Max::make(a, b);
+    case VectorReduce::And:
+        return And::make(a, b);
+    case VectorReduce::Or:
+        return Or::make(a, b);
+    }
+    return Expr();
+}
+
+}
+
+Expr lower_vector_reduce(const VectorReduce *op) {
+    const int output_lanes = op->type.lanes();
+    const int factor = op->value.type().lanes() / output_lanes;
+    if (factor == 1) {
+        return op->value;
+    }
+
+    vector<pair<string, Expr>> lets;
+    Expr result;
+    if (output_lanes == 1 && (factor & (factor - 1)) == 0) {
+        result = op->value;
+        for (int lanes = factor / 2; lanes > 0; lanes /= 2) {
+            string name = unique_name('r');
+            lets.push_back({name, result});
+            Expr v = Variable::make(result.type(), name);
+            result = vector_reduce_binop(op->op,
+                                         Shuffle::make_slice(v, 0, 1, lanes),
+                                         Shuffle::make_slice(v, lanes, 1, lanes));
+        }
+    } else {
+        string name = unique_name('r');
+        lets.push_back({name, op->value});
+        Expr v = Variable::make(op->value.type(), name);
+        result = Shuffle::make_slice(v, 0, factor, output_lanes);
+        for (int i = 1; i < factor; i++) {
+            result = vector_reduce_binop(op->op, result,
+                                         Shuffle::make_slice(v, i, factor, output_lanes));
+        }
+    }
+
+    for (size_t i = lets.size(); i > 0; i--) {
+        result = Let::make(lets[i-1].first, lets[i-1].second, result);
+    }
+    return result;
+}
+
+namespace {
+
 // This mutator rewrites predicated loads and stores as unpredicated
 // loads/stores with explicit conditions, scalarizing if necessary.
 class UnpredicateLoadsStores : public IRMutator {
@@ -358,6 +437,78 @@ Stmt unpredicate_loads_stores(Stmt s) {
     return UnpredicateLoadsStores().mutate(s);
 }
 
+namespace {
+
+// Remove a marker intrinsic from the top of the value of a store,
+// sinking any lets lifted out of it back into its argument.
+Expr unwrap_store_marker(Expr value, const char *marker) {
+    if (const Let *let = value.as<Let>()) {
+        Expr body = unwrap_store_marker(let->body, marker);
+        if (body.defined()) {
+            return Let::make(let->name, let->value, body);
+        }
+    } else if (const Call *call = value.as<Call>()) {
+        if (call->is_intrinsic(marker)) {
+            internal_assert(call->args.size() == 1);
+            return call->args[0];
+        }
+    }
+    return Expr();
+}
+
+}  // namespace
+
+Expr unwrap_atomic_update(Expr value) {
+    return unwrap_store_marker(value, Call::atomic_update);
+}
+
+Expr unwrap_nontemporal_store(Expr value) {
+    return unwrap_store_marker(value, Call::nontemporal_store);
+}
+
+namespace {
+
+class SubstituteAtomicLocation : public IRMutator {
+    const string &buffer;
+    Expr index, replacement;
+
+    using IRMutator::visit;
+
+    void visit(const Load *op) {
+        if (op->name == buffer && equal(op->index, index)) {
+            expr = replacement;
+        } else {
+            IRMutator::visit(op);
+        }
+    }
+
+public:
+    SubstituteAtomicLocation(const string &buffer, Expr index, Expr replacement)
+        : buffer(buffer), index(index), replacement(replacement) {}
+};
+
+}  // namespace
+
+Expr substitute_atomic_location(Expr value, const string &buffer, Expr index, Expr replacement) {
+    return SubstituteAtomicLocation(buffer, index, replacement).mutate(value);
+}
+
+Expr atomic_add_operand(Expr value, const string &buffer, Expr index) {
+    const Add *add = value.as<Add>();
+    if (!add) {
+        return Expr();
+    }
+    for (int i = 0; i < 2; i++) {
+        const Load *load = (i == 0 ? add->a : add->b).as<Load>();
+        Expr other = i == 0 ? add->b : add->a;
+        if (load && load->name == buffer && equal(load->index, index) &&
+            substitute_atomic_location(other, buffer, index, 0).same_as(other)) {
+            return other;
+        }
+    }
+    return Expr();
+}
+
 bool get_md_bool(llvm::Metadata *value, bool &result) {
     if (!value) {
         return false;
@@ -62,10 +62,37 @@ Expr lower_euclidean_div(Expr a, Expr b);
 Expr lower_euclidean_mod(Expr a, Expr b);
 ///@}
 
+/** Given a Halide horizontal vector reduction, define it in terms of
+ * shuffles and binary operators. Reductions to a scalar repeatedly
+ * combine the two halves of the vector, and other reductions combine
+ * strided slices of the vector. */
+Expr lower_vector_reduce(const VectorReduce *op);
+
 /** Replace predicated loads/stores with unpredicated equivalents
  * inside branches. */
 Stmt unpredicate_loads_stores(Stmt s);
 
+/** If the value of a store is marked as an atomic update (see
+ * Stage::atomic), return the value being stored, with any lets that
+ * were lifted out of the marker pushed back into it. Otherwise return
+ * an undefined Expr. */
+Expr unwrap_atomic_update(Expr value);
+
+/** If the value of a store is marked with the hint that it should be
+ * non-temporal (see Func::store_nontemporal), return the value being
+ * stored, as for unwrap_atomic_update above. Otherwise return an
+ * undefined Expr. */
+Expr unwrap_nontemporal_store(Expr value);
+
+/** Replace the loads of the given location within the value of an
+ * atomic update with some other Expr. */
+Expr substitute_atomic_location(Expr value, const std::string &buffer, Expr index, Expr replacement);
+
+/** If the value of an atomic update is the sum of the old value at
+ * the location and some term that doesn't depend on it, return that
+ * term. Otherwise return an undefined Expr. */
+Expr atomic_add_operand(Expr value, const std::string &buffer, Expr index);
+
 /** Given an llvm::Module, set llvm:TargetOptions, cpu and attr information */
 void get_target_options(const llvm::Module &module, llvm::TargetOptions &options, std::string &mcpu, std::string &mattrs);
 
@@ -13,6 +13,7 @@
 #include "JITModule.h"
 #include "CodeGen_Internal.h"
 #include "Lerp.h"
+#include "ArithmeticIntrinsics.h"
 #include "Util.h"
 #include "LLVM_Runtime_Linker.h"
 #include "MatlabWrapper.h"
@@ -250,7 +251,8 @@ CodeGen_LLVM::CodeGen_LLVM(Target t) :
 
     min_f64(Float(64).min()),
     max_f64(Float(64).max()),
-    destructor_block(nullptr) {
+    destructor_block(nullptr),
+    emit_nontemporal_stores(false) {
     initialize_llvm();
 }
 
@@ -872,6 +874,34 @@ Constant* CodeGen_LLVM::embed_constant_expr(Expr e) {
         scalar_value_t_type->getPointerTo());
 }
 
+Constant *CodeGen_LLVM::embed_fixed_shape(const LoweredArgument &arg) {
+    if (arg.fixed_shape.empty()) {
+        return ConstantPointerNull::get(dimension_t_type->getPointerTo());
+    }
+
+    vector<Constant *> dims;
+    for (const halide_dimension_t &d : arg.fixed_shape) {
+        Constant *fields[] = {
+            ConstantInt::get(i32_t, d.min),
+            ConstantInt::get(i32_t, d.extent),
+            ConstantInt::get(i32_t, d.stride),
+            ConstantInt::get(i32_t, d.flags)
+        };
+        dims.push_back(ConstantStruct::get(dimension_t_type, fields));
+    }
+    llvm::ArrayType *shape_type = ArrayType::get(dimension_t_type, dims.size());
+    GlobalVariable *storage = new GlobalVariable(
+        *module,
+        shape_type,
+        /*isConstant*/ true,
+        GlobalValue::PrivateLinkage,
+        ConstantArray::get(shape_type, dims),
+        arg.name + ".fixed_shape");
+
+    Constant *zero[] = {ConstantInt::get(i32_t, 0), ConstantInt::get(i32_t, 0)};
+    return ConstantExpr::getInBoundsGetElementPtr(shape_type, storage, zero);
+}
+
 // Make a wrapper to call the function with an array of pointer
 // args. This is easier for the JIT to call than a function with an
 // unknown (at compile time) argument list.
@@ -942,7 +972,8 @@ llvm::Function *CodeGen_LLVM::embed_metadata_getter(const std::string &metadata_
             type,
             embed_constant_expr(def),
             embed_constant_expr(min),
-            embed_constant_expr(max)
+            embed_constant_expr(max),
+            embed_fixed_shape(args[arg])
         };
         arguments_array_entries.push_back(ConstantStruct::get(argument_t_type, argument_fields));
     }
@@ -956,7 +987,7 @@ llvm::Function *CodeGen_LLVM::embed_metadata_getter(const std::string &metadata_
 
     Value *zeros[] = {zero, zero};
     Constant *metadata_fields[] = {
-        /* version */ zero,
+        /* version */ ConstantInt::get(i32_t, 1),
         /* num_arguments */ ConstantInt::get(i32_t, num_args),
         /* arguments */ ConstantExpr::getInBoundsGetElementPtr(arguments_array, arguments_array_storage, zeros),
         /* target */ create_string_constant(target.to_string()),
@@ -1030,15 +1061,28 @@ void CodeGen_LLVM::optimize_module() {
     module_pass_manager.add(createTargetTransformInfoWrapperPass(TM ? TM->getTargetIRAnalysis() : TargetIRAnalysis()));
     function_pass_manager.add(createTargetTransformInfoWrapperPass(TM ? TM->getTargetIRAnalysis() : TargetIRAnalysis()));
 
+    // At lower optimization levels we trade the quality of the code
+    // for compile time. At level 0 only the functions that must be
+    // inlined are.
+    int opt_level = target.opt_level();
+
     PassManagerBuilder b;
-    b.OptLevel = 3;
+    b.OptLevel = opt_level == 2 ? 3 : opt_level;
+    if (opt_level == 0) {
+#if LLVM_VERSION >= 40
+        b.Inliner = createAlwaysInlinerLegacyPass();
+#else
+        b.Inliner = createAlwaysInlinerPass();
+#endif
+    } else {
 #if LLVM_VERSION >= 50
-    b.Inliner = createFunctionInliningPass(b.OptLevel, 0, false);
+        b.Inliner = createFunctionInliningPass(b.OptLevel, 0, false);
 #else
-    b.Inliner = createFunctionInliningPass(b.OptLevel, 0);
+        b.Inliner = createFunctionInliningPass(b.OptLevel, 0);
 #endif
-    b.LoopVectorize = true;
-    b.SLPVectorize = true;
+    }
+    b.LoopVectorize = opt_level >= 2;
+    b.SLPVectorize = opt_level >= 2;
 
 #if LLVM_VERSION >= 50
     if (TM) {
@@ -2237,6 +2281,9 @@ void CodeGen_LLVM::visit(const Call *op) {
     } else if (op->is_intrinsic(Call::lerp)) {
         internal_assert(op->args.size() == 3);
         value = codegen(lower_lerp(op->args[0], op->args[1], op->args[2]));
+    } else if (is_arithmetic_intrinsic(op)) {
+        // Written in the form that the backends' patterns match.
+        value = codegen(lower_arithmetic_intrinsic(op));
     } else if (op->is_intrinsic(Call::popcount)) {
         internal_assert(op->args.size() == 1);
         std::vector<llvm::Type*> arg_type(1);
@@ -2596,17 +2643,27 @@ void CodeGen_LLVM::visit(const Call *op) {
         builder->CreateCondBr(builder->CreateIsNotNull(loaded_value),
             global_inited_bb, global_not_inited_bb, very_likely_branch);
 
-        // Build the not-already-inited case
+        // Build the not-already-inited case. The conditions are
+        // tested in order with branches rather than selects, so that
+        // we stop at the first one that holds, and the feature
+        // queries for the remaining sub-functions are never made.
         builder->SetInsertPoint(global_not_inited_bb);
-        llvm::Value *selected_value = nullptr;
-        for (int i = sub_fns.size() - 1; i >= 0; i--) {
-            const auto sub_fn = sub_fns[i];
-            if (!selected_value) {
-                selected_value = sub_fn.fn_ptr;
-            } else {
-                selected_value = builder->CreateSelect(codegen(sub_fn.cond),
-                                                       sub_fn.fn_ptr, selected_value);
-            }
+        BasicBlock *selected_bb = BasicBlock::Create(*context, "selected_bb", function);
+        vector<pair<llvm::Value *, BasicBlock *>> candidates;
+        for (size_t i = 0; i + 1 < sub_fns.size(); i++) {
+            llvm::Value *cond = codegen(sub_fns[i].cond);
+            BasicBlock *next_bb = BasicBlock::Create(*context, "try_next_fn_bb", function);
+            candidates.push_back({sub_fns[i].fn_ptr, builder->GetInsertBlock()});
+            builder->CreateCondBr(cond, selected_bb, next_bb);
+            builder->SetInsertPoint(next_bb);
+        }
+        candidates.push_back({sub_fns.back().fn_ptr, builder->GetInsertBlock()});
+        builder->CreateBr(selected_bb);
+
+        builder->SetInsertPoint(selected_bb);
+        PHINode *selected_value = builder->CreatePHI(sub_fns.back().fn_ptr->getType(), candidates.size());
+        for (const auto &c : candidates) {
+            selected_value->addIncoming(c.first, c.second);
         }
         builder->CreateStore(selected_value, global);
         builder->CreateBr(call_fn_bb);
@@ -2617,7 +2674,7 @@ void CodeGen_LLVM::visit(const Call *op) {
 
         builder->SetInsertPoint(call_fn_bb);
         PHINode *phi = builder->CreatePHI(selected_value->getType(), 2);
-        phi->addIncoming(selected_value, global_not_inited_bb);
+        phi->addIncoming(selected_value, selected_bb);
         phi->addIncoming(loaded_value, global_inited_bb);
 
         std::vector<llvm::Value *> call_args;
@@ -2653,21 +2710,62 @@ void CodeGen_LLVM::visit(const Call *op) {
     } else if (op->is_intrinsic(Call::size_of_halide_buffer_t)) {
         llvm::DataLayout d(module.get());
         value = ConstantInt::get(i32_t, (int)d.getTypeAllocSize(buffer_t_type));
+    } else if (op->is_intrinsic(Call::atomic_update)) {
+        internal_error << "atomic_update should only appear at the top of the value of a Store\n";
+    } else if (op->is_intrinsic(Call::nontemporal_store)) {
+        // The hint got separated from its store, so just drop it.
+        internal_assert(op->args.size() == 1);
+        value = codegen(op->args[0]);
+    } else if (op->is_intrinsic(Call::branch_profile)) {
+        // The marker is only read by visit(IfThenElse).
+        value = ConstantInt::get(i32_t, 0);
     } else if (op->is_intrinsic()) {
         internal_error << "Unknown intrinsic: " << op->name << "\n";
-    } else if (op->call_type == Call::PureExtern && op->name == "pow_f32") {
+    } else if (op->call_type == Call::PureExtern && op->name == "pow_f32" &&
+               !target.has_feature(Target::PreciseMath)) {
         internal_assert(op->args.size() == 2);
         Expr x = op->args[0];
         Expr y = op->args[1];
-        Expr e = Internal::halide_exp(Internal::halide_log(x) * y);
+        Expr e;
+        if (target.has_feature(Target::FastMath)) {
+            // Halide::fast_pow casts to scalar float, so spell it
+            // out in a form that also works for vectors.
+            e = select(x == 0.0f, make_zero(x.type()),
+                       Halide::fast_exp(Halide::fast_log(x) * y));
+        } else {
+            e = Internal::halide_exp(Internal::halide_log(x) * y);
+        }
         e.accept(this);
-    } else if (op->call_type == Call::PureExtern && op->name == "log_f32") {
+    } else if (op->call_type == Call::PureExtern && op->name == "log_f32" &&
+               !target.has_feature(Target::PreciseMath)) {
         internal_assert(op->args.size() == 1);
-        Expr e = Internal::halide_log(op->args[0]);
+        Expr e;
+        if (target.has_feature(Target::FastMath)) {
+            e = Halide::fast_log(op->args[0]);
+        } else {
+            e = Internal::halide_log(op->args[0]);
+        }
         e.accept(this);
-    } else if (op->call_type == Call::PureExtern && op->name == "exp_f32") {
+    } else if (op->call_type == Call::PureExtern && op->name == "exp_f32" &&
+               !target.has_feature(Target::PreciseMath)) {
+        internal_assert(op->args.size() == 1);
+        Expr e;
+        if (target.has_feature(Target::FastMath)) {
+            e = Halide::fast_exp(op->args[0]);
+        } else {
+            e = Internal::halide_exp(op->args[0]);
+        }
+        e.accept(this);
+    } else if (op->call_type == Call::PureExtern &&
+               (op->name == "sin_f32" || op->name == "cos_f32") &&
+               op->type.is_vector() &&
+               !target.has_feature(Target::PreciseMath)) {
+        // A scalar libm call per lane would stop the vector code and
+        // be slower than evaluating a polynomial in vector registers.
         internal_assert(op->args.size() == 1);
-        Expr e = Internal::halide_exp(op->args[0]);
+        Expr e = (op->name == "sin_f32" ?
+                  Internal::halide_sin(op->args[0]) :
+                  Internal::halide_cos(op->args[0]));
         e.accept(this);
     } else if (op->call_type == Call::PureExtern &&
                (op->name == "is_nan_f32" || op->name == "is_nan_f64")) {
@@ -3064,8 +3162,12 @@ void CodeGen_LLVM::visit(const For *op) {
 
         // Move the builder back to the main function and call do_par_for
         builder->restoreIP(call_site);
-        llvm::Function *do_par_for = module->getFunction("halide_do_par_for");
-        internal_assert(do_par_for) << "Could not find halide_do_par_for in initial module\n";
+        // The tasks of a fork made for an async producer block on
+        // each other, so they must each get a thread of their own.
+        const char *do_par_for_name =
+            ends_with(op->name, ".async_fork") ? "halide_do_fork" : "halide_do_par_for";
+        llvm::Function *do_par_for = module->getFunction(do_par_for_name);
+        internal_assert(do_par_for) << "Could not find " << do_par_for_name << " in initial module\n";
         #if LLVM_VERSION < 50
         do_par_for->setDoesNotAlias(5);
         #else
@@ -3095,7 +3197,72 @@ void CodeGen_LLVM::visit(const For *op) {
     }
 }
 
+void CodeGen_LLVM::codegen_atomic_store(const Store *op, Expr value) {
+    Halide::Type t = value.type();
+    user_assert(t.is_scalar() && is_one(op->predicate))
+        << "The stores to " << op->name << " are atomic, so they can't be vectorized.\n";
+    user_assert(!t.is_bool() && !t.is_handle())
+        << "Atomic stores of type " << t << " to " << op->name << " are not supported.\n";
+
+    Value *ptr = codegen_buffer_pointer(op->name, t, op->index);
+
+    // Integer additions of something that doesn't depend on the old
+    // value map to a native atomic add.
+    Expr addend = t.is_float() ? Expr() : atomic_add_operand(value, op->name, op->index);
+    if (addend.defined()) {
+        builder->CreateAtomicRMW(AtomicRMWInst::Add, ptr, codegen(addend), AtomicOrdering::Monotonic);
+        return;
+    }
+
+    // Anything else is a compare-and-swap loop on the bits of the
+    // value: compute the new value from the old one, and try again if
+    // another thread changed it in the meantime.
+    llvm::Type *bits_t = llvm_type_of(UInt(t.bits()));
+    unsigned address_space = ptr->getType()->getPointerAddressSpace();
+    Value *bits_ptr = builder->CreatePointerCast(ptr, bits_t->getPointerTo(address_space));
+    LoadInst *initial = builder->CreateAlignedLoad(bits_ptr, t.bytes());
+    add_tbaa_metadata(initial, op->name, op->index);
+
+    BasicBlock *preheader_bb = builder->GetInsertBlock();
+    BasicBlock *loop_bb = BasicBlock::Create(*context, std::string("atomic ") + op->name, function);
+    BasicBlock *after_bb = BasicBlock::Create(*context, std::string("end atomic ") + op->name, function);
+    builder->CreateBr(loop_bb);
+    builder->SetInsertPoint(loop_bb);
+
+    PHINode *old_bits = builder->CreatePHI(bits_t, 2);
+    old_bits->addIncoming(initial, preheader_bb);
+
+    string old_name = unique_name(op->name + ".old");
+    sym_push(old_name, builder->CreateBitCast(old_bits, llvm_type_of(t)));
+    Expr new_value = substitute_atomic_location(value, op->name, op->index, Variable::make(t, old_name));
+    Value *new_bits = builder->CreateBitCast(codegen(new_value), bits_t);
+    sym_pop(old_name);
+
+    Value *cmpxchg = builder->CreateAtomicCmpXchg(bits_ptr, old_bits, new_bits,
+                                                  AtomicOrdering::Monotonic,
+                                                  AtomicOrdering::Monotonic);
+    old_bits->addIncoming(builder->CreateExtractValue(cmpxchg, 0), builder->GetInsertBlock());
+    builder->CreateCondBr(builder->CreateExtractValue(cmpxchg, 1), after_bb, loop_bb);
+
+    builder->SetInsertPoint(after_bb);
+}
+
 void CodeGen_LLVM::visit(const Store *op) {
+    Expr atomic_value = unwrap_atomic_update(op->value);
+    if (atomic_value.defined()) {
+        codegen_atomic_store(op, atomic_value);
+        return;
+    }
+
+    Expr nontemporal_value = unwrap_nontemporal_store(op->value);
+    if (nontemporal_value.defined()) {
+        bool old_emit_nontemporal_stores = emit_nontemporal_stores;
+        emit_nontemporal_stores = true;
+        codegen(Store::make(op->name, nontemporal_value, op->index, op->param, op->predicate));
+        emit_nontemporal_stores = old_emit_nontemporal_stores;
+        return;
+    }
+
     // Even on 32-bit systems, Handles are treated as 64-bit in
     // memory, so convert stores of handles to stores of uint64_ts.
     if (op->value.type().is_handle()) {
@@ -3162,6 +3329,12 @@ void CodeGen_LLVM::visit(const Store *op) {
                 Value *vec_ptr = builder->CreatePointerCast(elt_ptr, slice_val->getType()->getPointerTo());
                 StoreInst *store = builder->CreateAlignedStore(slice_val, vec_ptr, alignment);
                 add_tbaa_metadata(store, op->name, slice_index);
+                // Non-temporal stores must be aligned to their full
+                // width, or they fall back to ordinary stores anyway.
+                if (emit_nontemporal_stores && alignment >= slice_lanes * value_type.bytes()) {
+                    llvm::Metadata *one = ConstantAsMetadata::get(ConstantInt::get(i32_t, 1));
+                    store->setMetadata(LLVMContext::MD_nontemporal, MDNode::get(*context, {one}));
+                }
             }
         } else if (ramp) {
             Type ptr_type = value_type.element_of();
@@ -3218,11 +3391,59 @@ void CodeGen_LLVM::visit(const Provide *op) {
     internal_error << "Provide encountered during codegen\n";
 }
 
+namespace {
+
+// Get the number of times a profile saw a branch taken, if the branch
+// starts with a branch_profile marker that has a count. The rest of a
+// chain of specializations counts as taken whenever one of its
+// branches was.
+bool get_branch_profile_count(const Stmt &s, uint64_t &count) {
+    if (const IfThenElse *op = s.as<IfThenElse>()) {
+        uint64_t then_count, else_count;
+        if (op->else_case.defined() &&
+            get_branch_profile_count(op->then_case, then_count) &&
+            get_branch_profile_count(op->else_case, else_count)) {
+            count = then_count + else_count;
+            return true;
+        }
+        return false;
+    }
+    const Block *block = s.as<Block>();
+    const Evaluate *eval = block ? block->first.as<Evaluate>() : s.as<Evaluate>();
+    const Call *call = eval ? eval->value.as<Call>() : nullptr;
+    if (call && call->is_intrinsic(Call::branch_profile) && call->args.size() == 2) {
+        const uint64_t *c = as_const_uint(call->args[1]);
+        internal_assert(c);
+        count = *c;
+        return true;
+    }
+    return false;
+}
+
+}
+
 void CodeGen_LLVM::visit(const IfThenElse *op) {
     BasicBlock *true_bb = BasicBlock::Create(*context, "true_bb", function);
     BasicBlock *false_bb = BasicBlock::Create(*context, "false_bb", function);
     BasicBlock *after_bb = BasicBlock::Create(*context, "after_bb", function);
-    builder->CreateCondBr(codegen(op->condition), true_bb, false_bb);
+
+    // If there's a profile of the branch, pass it on to LLVM, which
+    // lays out and optimizes the cold side accordingly.
+    MDNode *weights = nullptr;
+    uint64_t then_count, else_count;
+    if (op->else_case.defined() &&
+        get_branch_profile_count(op->then_case, then_count) &&
+        get_branch_profile_count(op->else_case, else_count) &&
+        (then_count || else_count)) {
+        // Branch weights are 32-bit.
+        while (then_count > 0xffffffff || else_count > 0xffffffff) {
+            then_count >>= 1;
+            else_count >>= 1;
+        }
+        MDBuilder md_builder(*context);
+        weights = md_builder.createBranchWeights((uint32_t)then_count, (uint32_t)else_count);
+    }
+    builder->CreateCondBr(codegen(op->condition), true_bb, false_bb, weights);
 
     builder->SetInsertPoint(true_bb);
     codegen(op->then_case);
@@ -3244,6 +3465,11 @@ void CodeGen_LLVM::visit(const Evaluate *op) {
     value = nullptr;
 }
 
+void CodeGen_LLVM::visit(const VectorReduce *op) {
+    // Targets with native horizontal reductions override this.
+    codegen(lower_vector_reduce(op));
+}
+
 void CodeGen_LLVM::visit(const Shuffle *op) {
     if (op->is_interleave()) {
         vector<Value *> vecs;
@@ -276,6 +276,14 @@ protected:
     llvm::Value *codegen_buffer_pointer(llvm::Value *base_address, Type type, llvm::Value *index);
     // @}
 
+    /** Generate a load or store whose predicate isn't trivially
+     * true. Dense ones become masked loads and stores, and the rest
+     * are scalarized. */
+    // @{
+    virtual void codegen_predicated_vector_load(const Load *op);
+    virtual void codegen_predicated_vector_store(const Store *op);
+    // @}
+
     /** Turn a Halide Type into an llvm::Value representing a constant halide_type_t */
     llvm::Value *make_halide_type_t(Type);
 
@@ -344,6 +352,7 @@ protected:
     virtual void visit(const Evaluate *);
     virtual void visit(const Shuffle *);
     virtual void visit(const Prefetch *);
+    virtual void visit(const VectorReduce *);
     // @}
 
     /** Generate code for an allocate node. It has no default
@@ -457,6 +466,10 @@ private:
      * to this block. */
     llvm::BasicBlock *destructor_block;
 
+    /** Whether the store being generated was marked with the hint
+     * that it should be non-temporal. See Func::store_nontemporal */
+    bool emit_nontemporal_stores;
+
     /** Embed an instance of halide_filter_metadata_t in the code, using
      * the given name (by convention, this should be ${FUNCTIONNAME}_metadata)
      * as extern "C" linkage. Note that the return value is a function-returning-
@@ -468,12 +481,18 @@ private:
     /** Embed a constant expression as a global variable. */
     llvm::Constant *embed_constant_expr(Expr e);
 
+    /** Embed the fixed shape of a buffer argument as a global array
+     * of halide_dimension_t, or return null if it has none. */
+    llvm::Constant *embed_fixed_shape(const LoweredArgument &arg);
+
     llvm::Function *add_argv_wrapper(const std::string &name);
 
     llvm::Value *codegen_dense_vector_load(const Load *load, llvm::Value *vpred = nullptr);
 
-    virtual void codegen_predicated_vector_load(const Load *op);
-    virtual void codegen_predicated_vector_store(const Store *op);
+    /** Generate an atomic read-modify-write of the location a store
+     * writes to. The value is the stored value with the atomic
+     * update marker removed. See Stage::atomic */
+    void codegen_atomic_store(const Store *op, Expr value);
 };
 
 }
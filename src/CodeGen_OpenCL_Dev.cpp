@@ -289,6 +289,58 @@ void CodeGen_OpenCL_Dev::CodeGen_OpenCL_C::visit(const Load *op) {
 void CodeGen_OpenCL_Dev::CodeGen_OpenCL_C::visit(const Store *op) {
     user_assert(is_one(op->predicate)) << "Predicated store is not supported inside OpenCL kernel.\n";
 
+    Expr atomic_value = unwrap_atomic_update(op->value);
+    if (atomic_value.defined()) {
+        Type t = atomic_value.type();
+        user_assert(t.is_scalar() && t.bits() == 32)
+            << "OpenCL only supports atomic stores of 32-bit scalars, but the stores to "
+            << op->name << " are of type " << t << ".\n";
+
+        string id_index = print_expr(op->index);
+        string id_ptr = "&((" + get_memory_space(op->name) + " " + print_type(t) + " *)" +
+            print_name(op->name) + ")[" + id_index + "]";
+
+        Expr addend = t.is_float() ? Expr() : atomic_add_operand(atomic_value, op->name, op->index);
+        if (addend.defined()) {
+            string id_addend = print_expr(addend);
+            do_indent();
+            stream << "atomic_add(" << id_ptr << ", " << id_addend << ");\n";
+            cache.clear();
+            return;
+        }
+
+        // A compare-and-swap loop on the bits of the value.
+        string id_bits_ptr = unique_name('_');
+        string id_old_bits = unique_name('_');
+        string old_name = unique_name(op->name + ".old");
+        open_scope();
+        do_indent();
+        stream << get_memory_space(op->name) << " uint *" << id_bits_ptr
+               << " = (" << get_memory_space(op->name) << " uint *)" << id_ptr << ";\n";
+        do_indent();
+        stream << "uint " << id_old_bits << " = *" << id_bits_ptr << ";\n";
+        do_indent();
+        stream << "while (1)\n";
+        open_scope();
+        do_indent();
+        stream << print_type(t) << " " << print_name(old_name)
+               << " = as_" << print_type(t) << "(" << id_old_bits << ");\n";
+        Expr new_value = substitute_atomic_location(atomic_value, op->name, op->index,
+                                                    Variable::make(t, old_name));
+        string id_new_value = print_expr(new_value);
+        string id_prev_bits = unique_name('_');
+        do_indent();
+        stream << "uint " << id_prev_bits << " = atomic_cmpxchg(" << id_bits_ptr << ", "
+               << id_old_bits << ", as_uint(" << id_new_value << "));\n";
+        do_indent();
+        stream << "if (" << id_prev_bits << " == " << id_old_bits << ") break;\n";
+        do_indent();
+        stream << id_old_bits << " = " << id_prev_bits << ";\n";
+        close_scope("");
+        close_scope("");
+        return;
+    }
+
     string id_value = print_expr(op->value);
     Type t = op->value.type();
 
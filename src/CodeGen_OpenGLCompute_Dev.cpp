@@ -112,6 +112,11 @@ void CodeGen_OpenGLCompute_Dev::CodeGen_OpenGLCompute_C::visit(const Cast *op) {
 
 void CodeGen_OpenGLCompute_Dev::CodeGen_OpenGLCompute_C::visit(const Call *op) {
     if (op->name == "halide_gpu_thread_barrier") {
+        // barrier() only synchronizes execution. Shared memory writes
+        // made before it also need a memory barrier to be visible to
+        // the other invocations in the workgroup afterwards.
+        do_indent();
+        stream << "memoryBarrierShared();\n";
         do_indent();
         stream << "barrier();\n";
     } else {
@@ -290,11 +295,19 @@ void CodeGen_OpenGLCompute_Dev::CodeGen_OpenGLCompute_C::add_kernel(Stmt s,
     FindSharedAllocations fsa;
     s.accept(&fsa);
     for (const Allocate *op : fsa.allocs) {
-        internal_assert(op->extents.size() == 1 && is_const(op->extents[0]));
+        internal_assert(op->extents.size() == 1);
+        // GLSL shared arrays must have a size known at compile
+        // time. Use an upper bound for sizes that depend on the block
+        // being computed.
+        int32_t size = get_constant_bound_allocation_size(op);
+        user_assert(size > 0)
+            << "Shared allocation " << op->name << " has a dynamic size. "
+            << "OpenGLCompute requires shared memory allocations to have "
+            << "a size known at compile time.\n";
         stream << "shared "
                << print_type(op->type) << " "
                << print_name(op->name) << "["
-               << op->extents[0] << "];\n";
+               << size << "];\n";
     }
 
     // We'll figure out the workgroup size while traversing the stmt
@@ -325,24 +338,27 @@ void CodeGen_OpenGLCompute_Dev::init_module() {
 void CodeGen_OpenGLCompute_Dev::CodeGen_OpenGLCompute_C::visit(const Allocate *op) {
     debug(2) << "OpenGLCompute: Allocate " << op->name << " of type " << op->type << " on device\n";
 
-    do_indent();
+    user_assert(!op->new_expr.defined()) << "Allocate node inside OpenGLCompute kernel has custom new expression.\n" <<
+        "(Memoization is not supported inside GPU kernels at present.)\n";
+
     Allocation alloc;
     alloc.type = op->type;
     allocations.push(op->name, alloc);
 
-    internal_assert(op->extents.size() >= 1);
-    Expr extent = 1;
-    for (Expr e : op->extents) {
-        extent *= e;
-    }
-    extent = simplify(extent);
-    internal_assert(is_const(extent));
-
     if (!starts_with(op->name, "__shared_")) {
-        // Shared allocations were already declared at global scope.
+        // Shared allocations were already declared at global
+        // scope. Everything else is a local array, which must have a
+        // constant size.
+        internal_assert(op->extents.size() >= 1);
+        int32_t size = get_constant_bound_allocation_size(op);
+        user_assert(size > 0)
+            << "Allocation " << op->name << " has a dynamic size. "
+            << "Only fixed-size allocations are supported on the gpu. "
+            << "Try storing into shared memory instead.";
+        do_indent();
         stream << print_type(op->type) << " "
                << print_name(op->name) << "["
-               << op->extents[0] << "];\n";
+               << size << "];\n";
     }
     op->body.accept(this);
 }
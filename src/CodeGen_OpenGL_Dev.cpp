@@ -190,6 +190,13 @@ void CodeGen_GLSLBase::visit(const Mod *op) {
 }
 
 void CodeGen_GLSLBase::visit(const Call *op) {
+    if (op->is_intrinsic(Call::nontemporal_store)) {
+        // GLSL has no non-temporal stores, so ignore the hint.
+        internal_assert(op->args.size() == 1);
+        print_assignment(op->type, print_expr(op->args[0]));
+        return;
+    }
+
     ostringstream rhs;
     if (builtin.count(op->name) == 0) {
         user_error << "GLSL: unknown function '" << op->name << "' encountered.\n";
@@ -1,3 +1,5 @@
+#include <fstream>
+
 #include "CodeGen_PTX_Dev.h"
 #include "CodeGen_Internal.h"
 #include "IROperator.h"
@@ -6,6 +8,7 @@
 #include "Target.h"
 #include "LLVM_Headers.h"
 #include "LLVM_Runtime_Linker.h"
+#include "Util.h"
 
 // This is declared in NVPTX.h, which is not exported. Ugly, but seems better than
 // hardcoding a path to the .h file.
@@ -62,13 +65,21 @@ void CodeGen_PTX_Dev::add_kernel(Stmt stmt,
     function = llvm::Function::Create(func_t, llvm::Function::ExternalLinkage, name, module.get());
     set_function_attributes_for_target(function, target);
 
-    // Mark the buffer args as no alias
+    // Mark the buffer args as no alias, and the ones the kernel only
+    // reads as read only, so that loads from them on sm_32 and higher
+    // go through the read-only data cache (ld.global.nc).
     for (size_t i = 0; i < args.size(); i++) {
         if (args[i].is_buffer) {
             #if LLVM_VERSION < 50
             function->setDoesNotAlias(i+1);
+            if (!args[i].write) {
+                function->addAttribute(i+1, Attribute::ReadOnly);
+            }
             #else
             function->addParamAttr(i, Attribute::NoAlias);
+            if (!args[i].write) {
+                function->addParamAttr(i, Attribute::ReadOnly);
+            }
             #endif
         }
     }
@@ -207,7 +218,9 @@ void CodeGen_PTX_Dev::visit(const Allocate *alloc) {
         BasicBlock *here = builder->GetInsertBlock();
 
         builder->SetInsertPoint(entry_block);
-        Value *ptr = builder->CreateAlloca(llvm_type_of(alloc->type), ConstantInt::get(i32_t, size));
+        AllocaInst *ptr = builder->CreateAlloca(llvm_type_of(alloc->type), ConstantInt::get(i32_t, size));
+        // Dense vector loads and stores assume this alignment.
+        ptr->setAlignment(native_vector_bits() / 8);
         builder->SetInsertPoint(here);
         sym_push(allocation_name, ptr);
     }
@@ -224,12 +237,83 @@ void CodeGen_PTX_Dev::visit(const AssertStmt *op) {
     codegen(IfThenElse::make(!op->condition, Evaluate::make(trap)));
 }
 
+llvm::Value *CodeGen_PTX_Dev::call_wmma(const Call *op, Value *ptr) {
+    llvm::Function *fn = module->getFunction(op->name);
+    internal_assert(fn) << "Could not find " << op->name << " in the PTX runtime module\n";
+
+    // The wmma instructions take generic addresses, so pointers into
+    // shared memory must be converted.
+    auto generic = [&](Value *p) {
+        unsigned address_space = p->getType()->getPointerAddressSpace();
+        p = builder->CreatePointerCast(p, i8_t->getPointerTo(address_space));
+        if (address_space != 0) {
+            p = builder->CreateAddrSpaceCast(p, i8_t->getPointerTo());
+        }
+        return p;
+    };
+
+    vector<Value *> args;
+    if (ptr) {
+        args.push_back(generic(ptr));
+    }
+    for (Expr arg : op->args) {
+        if (const Load *load = arg.as<Load>()) {
+            args.push_back(generic(codegen_buffer_pointer(load->name, load->type, load->index)));
+        } else if (arg.type().is_vector()) {
+            Value *v = codegen(arg);
+            for (int i = 0; i < arg.type().lanes(); i++) {
+                args.push_back(builder->CreateExtractElement(v, ConstantInt::get(i32_t, i)));
+            }
+        } else {
+            args.push_back(codegen(arg));
+        }
+    }
+    return builder->CreateCall(fn, args);
+}
+
+void CodeGen_PTX_Dev::visit(const Call *op) {
+    if (op->call_type == Call::Extern && starts_with(op->name, "halide_ptx_wmma_")) {
+        // The fragment comes back as a struct of registers, which
+        // Halide treats as a vector.
+        internal_assert(op->type.is_vector())
+            << "Unexpected scalar call to " << op->name << "\n";
+        Value *result = call_wmma(op, nullptr);
+        value = UndefValue::get(llvm_type_of(op->type));
+        for (int i = 0; i < op->type.lanes(); i++) {
+            value = builder->CreateInsertElement(value,
+                                                 builder->CreateExtractValue(result, {(unsigned)i}),
+                                                 ConstantInt::get(i32_t, i));
+        }
+    } else {
+        CodeGen_LLVM::visit(op);
+    }
+}
+
+void CodeGen_PTX_Dev::visit(const Store *op) {
+    // A store of a whole fragment from inject_tensor_cores, to the
+    // matrix starting at the store's index.
+    const Call *call = op->value.as<Call>();
+    if (call && call->call_type == Call::Extern &&
+        starts_with(call->name, "halide_ptx_wmma_store_")) {
+        call_wmma(call, codegen_buffer_pointer(op->name, call->type, op->index));
+    } else {
+        CodeGen_LLVM::visit(op);
+    }
+}
+
 string CodeGen_PTX_Dev::march() const {
     return "nvptx64";
 }
 
 string CodeGen_PTX_Dev::mcpu() const {
-    if (target.has_feature(Target::CUDACapability61)) {
+    if (target.has_feature(Target::CUDACapability70)) {
+        #if LLVM_VERSION >= 50
+        return "sm_70";
+        #else
+        user_error << "cuda_capability_70 requires LLVM 5.0 or later.\n";
+        return "";
+        #endif
+    } else if (target.has_feature(Target::CUDACapability61)) {
         return "sm_61";
     } else if (target.has_feature(Target::CUDACapability50)) {
         return "sm_50";
@@ -245,7 +329,10 @@ string CodeGen_PTX_Dev::mcpu() const {
 }
 
 string CodeGen_PTX_Dev::mattrs() const {
-    if (target.has_feature(Target::CUDACapability61)) {
+    if (target.has_feature(Target::CUDACapability70)) {
+        // The wmma instructions need ptx isa 6.0.
+        return "+ptx60";
+    } else if (target.has_feature(Target::CUDACapability61)) {
         return "+ptx50";
     } else if (target.features_any_of({Target::CUDACapability32,
                                 Target::CUDACapability50})) {
@@ -402,15 +489,80 @@ vector<char> CodeGen_PTX_Dev::compile_to_src() {
     debug(1) << "PTX kernel:\n" << outstr.c_str() << "\n";
     vector<char> buffer(outstr.begin(), outstr.end());
     buffer.push_back(0);
-    return buffer;
+    return assemble_cubin(buffer);
 #else // WITH_PTX
     return vector<char>();
 #endif
 }
 
+vector<char> CodeGen_PTX_Dev::assemble_cubin(const vector<char> &ptx) {
+    // If a specific compute capability was asked for, and the path to
+    // ptxas is given, assemble the PTX ahead of time, so that the
+    // driver doesn't have to JIT compile it when the module is
+    // loaded. The PTX is kept after the cubin as a fallback in case
+    // it is run on a different GPU. The layout must match what
+    // halide_cuda_initialize_kernels expects.
+    std::string ptxas = get_env_variable("HL_CUDA_PTXAS");
+    if (ptxas.empty() ||
+        !target.features_any_of({Target::CUDACapability30,
+                                 Target::CUDACapability32,
+                                 Target::CUDACapability35,
+                                 Target::CUDACapability50,
+                                 Target::CUDACapability61,
+                                 Target::CUDACapability70})) {
+        return ptx;
+    }
+
+    TemporaryFile input("halide_kernel", ".ptx");
+    TemporaryFile output("halide_kernel", ".cubin");
+    {
+        std::ofstream f(input.pathname());
+        f.write(ptx.data(), ptx.size() - 1);
+        f.flush();
+        internal_assert(f.good());
+        f.close();
+    }
+
+    // Use the same register limit as the runtime does when it JIT
+    // compiles the PTX.
+    std::string cmd = ptxas + " --gpu-name " + mcpu() + " --maxrregcount 64 -o " +
+        output.pathname() + " " + input.pathname();
+    debug(1) << "Assembling PTX: " << cmd << "\n";
+    int result = system(cmd.c_str());
+    user_assert(result == 0)
+        << "HL_CUDA_PTXAS failed: result = " << result
+        << " for cmd (" << cmd << ")";
+
+    vector<char> cubin;
+    {
+        std::ifstream f(output.pathname(), std::ios::binary);
+        f.seekg(0, std::ifstream::end);
+        size_t size = f.tellg();
+        cubin.resize(size);
+        f.seekg(0, std::ifstream::beg);
+        f.read(cubin.data(), cubin.size());
+        internal_assert(f.good());
+        f.close();
+    }
+
+    // "HLCUBIN" and a null, the size of the cubin as a little-endian
+    // uint32, the cubin, and then the original PTX.
+    const char magic[] = "HLCUBIN";
+    vector<char> buffer(magic, magic + sizeof(magic));
+    uint32_t size = (uint32_t)cubin.size();
+    for (int i = 0; i < 4; i++) {
+        buffer.push_back((char)((size >> (8 * i)) & 0xff));
+    }
+    buffer.insert(buffer.end(), cubin.begin(), cubin.end());
+    buffer.insert(buffer.end(), ptx.begin(), ptx.end());
+    return buffer;
+}
+
 int CodeGen_PTX_Dev::native_vector_bits() const {
-    // PTX doesn't really do vectorization. The widest type is a double.
-    return 64;
+    // PTX doesn't really do vectorization, but it does have loads and
+    // stores of up to 128 bits (e.g. ld.global.v4.f32), which dense
+    // vector loads and stores within a thread are split into.
+    return 128;
 }
 
 string CodeGen_PTX_Dev::get_current_kernel_name() {
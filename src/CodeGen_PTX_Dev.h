@@ -11,6 +11,7 @@
 
 namespace llvm {
 class BasicBlock;
+class Value;
 }
 
 namespace Halide {
@@ -59,8 +60,18 @@ protected:
     void visit(const Allocate *);
     void visit(const Free *);
     void visit(const AssertStmt *);
+    void visit(const Call *);
+    void visit(const Store *);
     // @}
 
+    /** Call one of the wmma functions in the PTX runtime module for
+     * a call made by inject_tensor_cores. Loads among the arguments
+     * are passed as generic pointers to the loaded value, and vectors
+     * (the fragments) are passed one lane at a time. If ptr is
+     * non-null, it is passed first. Returns the struct the function
+     * returns. */
+    llvm::Value *call_wmma(const Call *op, llvm::Value *ptr);
+
     std::string march() const;
     std::string mcpu() const;
     std::string mattrs() const;
@@ -68,6 +79,12 @@ protected:
     int native_vector_bits() const;
     bool promote_indices() const {return false;}
 
+    /** If HL_CUDA_PTXAS is set and the target names a compute
+     * capability, run ptxas on the given null-terminated PTX and
+     * return the cubin with the PTX appended as a fallback. Otherwise
+     * returns the PTX unchanged. */
+    std::vector<char> assemble_cubin(const std::vector<char> &ptx);
+
     /** Map from simt variable names (e.g. foo.__block_id_x) to the llvm
      * ptx intrinsic functions to call to get them. */
     std::string simt_intrinsic(const std::string &name);
@@ -2,6 +2,7 @@
 #include "ConciseCasts.h"
 #include "IROperator.h"
 #include "IRMatch.h"
+#include "Simplify.h"
 #include "Util.h"
 #include "LLVM_Headers.h"
 
@@ -10,6 +11,7 @@ namespace Internal {
 
 using std::vector;
 using std::string;
+using std::pair;
 
 using namespace Halide::ConciseCasts;
 using namespace llvm;
@@ -40,6 +42,10 @@ const char* CodeGen_PowerPC::altivec_int_type_name(const Type& t) {
     return nullptr;  // not a recognized int type.
 }
 
+bool CodeGen_PowerPC::little_endian() const {
+    return module->getDataLayout().isLittleEndian();
+}
+
 void CodeGen_PowerPC::visit(const Cast *op) {
     if (!op->type.is_vector()) {
         // We only have peephole optimizations for vectors in here.
@@ -119,6 +125,123 @@ void CodeGen_PowerPC::visit(const Cast *op) {
         }
     }
 
+    // Saturating narrows pack the two halves of each pair of wide
+    // vectors into one narrow vector.
+    struct Pack {
+        bool needs_arch_2_07;
+        Type type;
+        string intrin;
+        Expr pattern;
+    };
+
+    static Pack packs[] = {
+        {false, Int(8, 16), "llvm.ppc.altivec.vpkshss", i8_sat(wild_i16x_)},
+        {false, UInt(8, 16), "llvm.ppc.altivec.vpkshus", u8_sat(wild_i16x_)},
+        {false, UInt(8, 16), "llvm.ppc.altivec.vpkuhus", u8_sat(wild_u16x_)},
+        {false, Int(16, 8), "llvm.ppc.altivec.vpkswss", i16_sat(wild_i32x_)},
+        {false, UInt(16, 8), "llvm.ppc.altivec.vpkswus", u16_sat(wild_i32x_)},
+        {false, UInt(16, 8), "llvm.ppc.altivec.vpkuwus", u16_sat(wild_u32x_)},
+        {true, Int(32, 4), "llvm.ppc.altivec.vpksdss", i32_sat(wild_i64x_)},
+        {true, UInt(32, 4), "llvm.ppc.altivec.vpksdus", u32_sat(wild_i64x_)},
+        {true, UInt(32, 4), "llvm.ppc.altivec.vpkudus", u32_sat(wild_u64x_)},
+    };
+
+    for (size_t i = 0; i < sizeof(packs)/sizeof(packs[0]); i++) {
+        const Pack &pack = packs[i];
+
+        if (!target.features_any_of({Target::POWER_ARCH_2_07, Target::POWER_ARCH_3_00}) &&
+            pack.needs_arch_2_07) {
+            continue;
+        }
+
+        if (expr_match(pack.pattern, op, matches)) {
+            Value *wide = codegen(matches[0]);
+            const int half = pack.type.lanes() / 2;
+            vector<Value *> results;
+            for (int l = 0; l < op->type.lanes(); l += pack.type.lanes()) {
+                Value *lo = slice_vector(wide, l, half);
+                Value *hi = slice_vector(wide, l + half, half);
+                if (little_endian()) {
+                    std::swap(lo, hi);
+                }
+                results.push_back(call_intrin(llvm_type_of(pack.type), pack.type.lanes(),
+                                              pack.intrin, {lo, hi}));
+            }
+            value = slice_vector(concat_vectors(results), 0, op->type.lanes());
+            return;
+        }
+    }
+
+    CodeGen_Posix::visit(op);
+}
+
+namespace {
+
+// Flatten a sum into the products of two factors that can be
+// losslessly narrowed to the given type, and everything else.
+void find_narrow_products(Expr e, Type narrow, vector<pair<Expr, Expr>> &products, Expr &rest) {
+    if (const Add *add = e.as<Add>()) {
+        find_narrow_products(add->a, narrow, products, rest);
+        find_narrow_products(add->b, narrow, products, rest);
+        return;
+    } else if (const Mul *mul = e.as<Mul>()) {
+        Expr a = lossless_cast(narrow, mul->a);
+        Expr b = lossless_cast(narrow, mul->b);
+        if (a.defined() && b.defined()) {
+            products.push_back({a, b});
+            return;
+        }
+    }
+    rest = rest.defined() ? Add::make(rest, e) : e;
+}
+
+}
+
+void CodeGen_PowerPC::visit(const Add *op) {
+    // Sums of widening 8-bit or 16-bit multiplies can use the vmsum
+    // instructions, which add four or two of them to each 32-bit
+    // lane. The sums are modulo, so the same instructions serve
+    // signed and unsigned results.
+    if (op->type.is_vector() && op->type.bits() == 32 && !op->type.is_float() &&
+        op->type.lanes() % 4 == 0) {
+        const int lanes = op->type.lanes();
+        struct MultiplySum {
+            Type narrow;
+            int terms;
+            string intrin;
+        };
+        vector<MultiplySum> sums = {
+            {UInt(8, lanes), 4, "llvm.ppc.altivec.vmsumubm"},
+            {UInt(16, lanes), 2, "llvm.ppc.altivec.vmsumuhm"},
+        };
+        if (op->type.is_int()) {
+            sums.push_back({Int(16, lanes), 2, "llvm.ppc.altivec.vmsumshm"});
+        }
+        for (const MultiplySum &sum : sums) {
+            vector<pair<Expr, Expr>> products;
+            Expr rest;
+            find_narrow_products(op, sum.narrow, products, rest);
+            if (products.empty() || products.size() % sum.terms != 0) {
+                continue;
+            }
+
+            Value *acc = rest.defined() ? codegen(rest) : codegen(make_zero(op->type));
+            for (size_t i = 0; i < products.size(); i += sum.terms) {
+                vector<Expr> a, b;
+                for (int k = 0; k < sum.terms; k++) {
+                    a.push_back(products[i + k].first);
+                    b.push_back(products[i + k].second);
+                }
+                Expr a_vec = simplify(Shuffle::make_interleave(a));
+                Expr b_vec = simplify(Shuffle::make_interleave(b));
+                acc = call_intrin(llvm_type_of(op->type), 4, sum.intrin,
+                                  {codegen(a_vec), codegen(b_vec), acc});
+            }
+            value = acc;
+            return;
+        }
+    }
+
     CodeGen_Posix::visit(op);
 }
 
@@ -174,11 +297,98 @@ void CodeGen_PowerPC::visit(const Max *op) {
     }
 }
 
+void CodeGen_PowerPC::visit(const Call *op) {
+#if LLVM_VERSION >= 40
+    // POWER ISA 3.00 has unsigned absolute differences.
+    if (op->is_intrinsic(Call::absd) && op->type.is_vector() &&
+        target.has_feature(Target::POWER_ARCH_3_00) &&
+        op->args[0].type().is_uint() && op->type.bits() <= 32) {
+        const char *element_type_name = altivec_int_type_name(op->type.element_of());
+        value = call_intrin(op->type, 128 / op->type.bits(),
+                            std::string("llvm.ppc.altivec.vabsdu") + element_type_name[1],
+                            op->args);
+        return;
+    }
+#endif
+    CodeGen_Posix::visit(op);
+}
+
+Value *CodeGen_PowerPC::interleave_vectors(const std::vector<Value *> &vecs) {
+    // As on x86, LLVM turns a three-way interleave of bytes or shorts
+    // (e.g. a store of packed RGB) into long chains of element
+    // inserts and extracts. Each 16 bytes of the result can instead
+    // be assembled with two vperms: one that takes the bytes from the
+    // first two inputs, and one that fills in the bytes from the
+    // third.
+    llvm::VectorType *vt = vecs.empty() ? nullptr : dyn_cast<llvm::VectorType>(vecs[0]->getType());
+    if (vecs.size() == 3 && vt && vt->getElementType()->isIntegerTy()) {
+        const int elem_bytes = vt->getElementType()->getIntegerBitWidth() / 8;
+        const int lanes = vt->getNumElements();
+        if ((elem_bytes == 1 || elem_bytes == 2) && (lanes * elem_bytes) % 16 == 0) {
+            const int chunk_lanes = 16 / elem_bytes;
+            llvm::Type *words_t = VectorType::get(i32_t, 4);
+            llvm::Type *chunk_t = VectorType::get(vt->getElementType(), chunk_lanes);
+
+            // vperm numbers the 32 bytes of its two inputs
+            // big-endian. On little-endian targets, swapping the
+            // inputs and reversing the byte indices gives the lane
+            // order LLVM uses.
+            const bool le = little_endian();
+            auto make_mask = [&](const int *indices) {
+                vector<Constant *> mask(16);
+                for (int k = 0; k < 16; k++) {
+                    mask[k] = ConstantInt::get(i8_t, le ? 31 - indices[k] : indices[k]);
+                }
+                return ConstantVector::get(mask);
+            };
+            auto perm = [&](Value *a, Value *b, Value *mask) {
+                if (le) {
+                    std::swap(a, b);
+                }
+                return call_intrin(words_t, 4, "llvm.ppc.altivec.vperm", {a, b, mask});
+            };
+
+            // The masks for each 16 bytes of the result.
+            Value *first_masks[3], *second_masks[3];
+            for (int out = 0; out < 3; out++) {
+                int first[16], second[16];
+                for (int k = 0; k < 16; k++) {
+                    int byte = out * 16 + k;
+                    int elem = byte / elem_bytes;
+                    int in = elem % 3;
+                    int src = (elem / 3) * elem_bytes + byte % elem_bytes;
+                    first[k] = in < 2 ? in * 16 + src : 0;
+                    second[k] = in < 2 ? k : 16 + src;
+                }
+                first_masks[out] = make_mask(first);
+                second_masks[out] = make_mask(second);
+            }
+
+            vector<Value *> result;
+            for (int c = 0; c < lanes; c += chunk_lanes) {
+                Value *src[3];
+                for (int in = 0; in < 3; in++) {
+                    src[in] = builder->CreateBitCast(slice_vector(vecs[in], c, chunk_lanes), words_t);
+                }
+                for (int out = 0; out < 3; out++) {
+                    Value *v = perm(src[0], src[1], first_masks[out]);
+                    v = perm(v, src[2], second_masks[out]);
+                    result.push_back(builder->CreateBitCast(v, chunk_t));
+                }
+            }
+            return concat_vectors(result);
+        }
+    }
+    return CodeGen_Posix::interleave_vectors(vecs);
+}
+
 string CodeGen_PowerPC::mcpu() const {
     if (target.bits == 32) {
         return "ppc32";
     } else {
-        if (target.has_feature(Target::POWER_ARCH_2_07))
+        if (target.has_feature(Target::POWER_ARCH_3_00))
+            return "pwr9";
+        else if (target.has_feature(Target::POWER_ARCH_2_07))
             return "pwr8";
         else if (target.has_feature(Target::VSX))
             return "pwr7";
@@ -199,7 +409,8 @@ string CodeGen_PowerPC::mattrs() const {
     features += separator + enable + "vsx";
     separator = ",";
 
-    enable = target.has_feature(Target::POWER_ARCH_2_07) ? "+" : "-";
+    bool arch_3_00 = target.has_feature(Target::POWER_ARCH_3_00);
+    enable = (arch_3_00 || target.has_feature(Target::POWER_ARCH_2_07)) ? "+" : "-";
     features += separator + enable + "power8-altivec";
     separator = ",";
 
@@ -209,6 +420,13 @@ string CodeGen_PowerPC::mattrs() const {
     features += separator + enable + "direct-move";
     separator = ",";
 
+    enable = arch_3_00 ? "+" : "-";
+    features += separator + enable + "power9-altivec";
+    separator = ",";
+
+    features += separator + enable + "power9-vector";
+    separator = ",";
+
     return features;
 }
 
@@ -31,13 +31,22 @@ protected:
     /** Nodes for which we want to emit specific sse/avx intrinsics */
     // @{
     void visit(const Cast *);
+    void visit(const Add *);
     void visit(const Min *);
     void visit(const Max *);
+    void visit(const Call *);
     // @}
 
+    /** Three-way interleaves of 8- and 16-bit lanes use vperm. */
+    llvm::Value *interleave_vectors(const std::vector<llvm::Value *> &);
+
     // Call an intrinsic as defined by a pattern. Dispatches to the
 private:
     static const char* altivec_int_type_name(const Type&);
+
+    /** Whether the target numbers vector lanes little-endian. The
+     * pack and permute instructions number them big-endian. */
+    bool little_endian() const;
 };
 
 }}
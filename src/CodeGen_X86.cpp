@@ -1,6 +1,7 @@
 #include <iostream>
 
 #include "CodeGen_X86.h"
+#include "Bounds.h"
 #include "ConciseCasts.h"
 #include "JITModule.h"
 #include "IROperator.h"
@@ -9,6 +10,7 @@
 #include "Util.h"
 #include "Var.h"
 #include "Param.h"
+#include "Simplify.h"
 #include "LLVM_Headers.h"
 #include "IRMutator.h"
 
@@ -88,6 +90,60 @@ void CodeGen_X86::visit(const Sub *op) {
     }
 }
 
+void CodeGen_X86::visit(const VectorReduce *op) {
+    const int lanes = op->value.type().lanes();
+    const int factor = lanes / op->type.lanes();
+
+    if (op->op == VectorReduce::Add && !op->type.is_float()) {
+        // Sums of groups of eight widened bytes can use psadbw
+        // against zero, which sums each eight bytes into a 64-bit
+        // lane. Those sums fit in 16 bits, so narrowing them is exact.
+        const Cast *cast = op->value.as<Cast>();
+        if (cast && cast->value.type() == UInt(8, lanes) &&
+            op->type.bits() >= 16 && factor % 8 == 0 && lanes % 16 == 0) {
+            bool avx2 = target.has_feature(Target::AVX2) && lanes % 32 == 0;
+            Type sums_t = UInt(64, lanes / 8);
+            Value *sums = call_intrin(sums_t, avx2 ? 4 : 2,
+                                      avx2 ? "llvm.x86.avx2.psad.bw" : "llvm.x86.sse2.psad.bw",
+                                      {cast->value, make_zero(cast->value.type())});
+            string name = unique_name('s');
+            sym_push(name, sums);
+            Expr partial = Cast::make(op->type.with_lanes(lanes / 8), Variable::make(sums_t, name));
+            codegen(VectorReduce::make(VectorReduce::Add, partial, op->type.lanes()));
+            sym_pop(name);
+            return;
+        }
+
+        // Sums of pairs of products of 16-bit values are dot
+        // products, which pmaddwd computes directly.
+        const Mul *mul = op->value.as<Mul>();
+        if (mul && op->type.is_int() && op->type.bits() == 32 &&
+            factor % 2 == 0 && lanes >= 8) {
+            Type narrow = Int(16, lanes);
+            Expr a = lossless_cast(narrow, mul->a);
+            Expr b = lossless_cast(narrow, mul->b);
+            if (a.defined() && b.defined()) {
+                string a_name = unique_name('a'), b_name = unique_name('b');
+                Expr a_var = Variable::make(narrow, a_name);
+                Expr b_var = Variable::make(narrow, b_name);
+                int pairs = lanes / 2;
+                Expr sums = Call::make(Int(32, pairs), "pmaddwd",
+                                       {Shuffle::make_slice(a_var, 0, 2, pairs),
+                                        Shuffle::make_slice(b_var, 0, 2, pairs),
+                                        Shuffle::make_slice(a_var, 1, 2, pairs),
+                                        Shuffle::make_slice(b_var, 1, 2, pairs)},
+                                       Call::Extern);
+                Expr e = VectorReduce::make(VectorReduce::Add, sums, op->type.lanes());
+                e = Let::make(a_name, a, Let::make(b_name, b, e));
+                codegen(e);
+                return;
+            }
+        }
+    }
+
+    CodeGen_Posix::visit(op);
+}
+
 void CodeGen_X86::visit(const GT *op) {
     if (op->type.is_vector()) {
         // Non-native vector widths get legalized poorly by llvm. We
@@ -207,6 +263,34 @@ void CodeGen_X86::visit(const Cast *op) {
         return;
     }
 
+    if (target.has_feature(Target::F16C) &&
+        op->value.type().element_of() == Float(16)) {
+        // LLVM does vector half conversions one lane at a time. The
+        // f16c instructions work on the bits as a vector of uint16.
+        // Widening to float is exact, so go via float32 for the other
+        // destination types too.
+        Type f32 = Float(32, op->type.lanes());
+        Expr bits = reinterpret(UInt(16, op->type.lanes()), op->value);
+        value = call_intrin(f32, 8, "llvm.x86.vcvtph2ps.256", {bits});
+        if (op->type != f32) {
+            string name = unique_name('t');
+            sym_push(name, value);
+            value = codegen(cast(op->type, Variable::make(f32, name)));
+            sym_pop(name);
+        }
+        return;
+    }
+
+    if (target.has_feature(Target::F16C) &&
+        op->type.element_of() == Float(16) &&
+        op->value.type().element_of() == Float(32)) {
+        // An immediate of zero rounds to nearest, ties to even.
+        value = call_intrin(UInt(16, op->type.lanes()), 8, "llvm.x86.vcvtps2ph.256",
+                            {op->value, 0});
+        value = builder->CreateBitCast(value, llvm_type_of(op->type));
+        return;
+    }
+
     vector<Expr> matches;
 
     struct Pattern {
@@ -236,6 +320,41 @@ void CodeGen_X86::visit(const Cast *op) {
         {Target::FeatureEnd, true, UInt(16, 8), 0, "llvm.x86.sse2.psubus.w",
          u16(max(wild_i32x_ - wild_i32x_, 0))},
 
+        // AVX-512BW versions, only used if we have more lanes than
+        // fit in a ymm register. The helpers are in x86_avx512.ll.
+        {Target::AVX512_Skylake, true, Int(8, 64), 33, "paddsbx64",
+         i8_sat(wild_i16x_ + wild_i16x_)},
+        {Target::AVX512_Skylake, true, Int(8, 64), 33, "psubsbx64",
+         i8_sat(wild_i16x_ - wild_i16x_)},
+        {Target::AVX512_Skylake, true, UInt(8, 64), 33, "paddusbx64",
+         u8_sat(wild_u16x_ + wild_u16x_)},
+        {Target::AVX512_Skylake, true, UInt(8, 64), 33, "psubusbx64",
+         u8(max(wild_i16x_ - wild_i16x_, 0))},
+        {Target::AVX512_Skylake, true, Int(16, 32), 17, "paddswx32",
+         i16_sat(wild_i32x_ + wild_i32x_)},
+        {Target::AVX512_Skylake, true, Int(16, 32), 17, "psubswx32",
+         i16_sat(wild_i32x_ - wild_i32x_)},
+        {Target::AVX512_Skylake, true, UInt(16, 32), 17, "padduswx32",
+         u16_sat(wild_u32x_ + wild_u32x_)},
+        {Target::AVX512_Skylake, true, UInt(16, 32), 17, "psubuswx32",
+         u16(max(wild_i32x_ - wild_i32x_, 0))},
+        {Target::AVX512_Skylake, true, Int(16, 32), 17, "pmulhwx32",
+         i16((wild_i32x_ * wild_i32x_) / 65536)},
+        {Target::AVX512_Skylake, true, UInt(16, 32), 17, "pmulhuwx32",
+         u16((wild_u32x_ * wild_u32x_) / 65536)},
+        {Target::AVX512_Skylake, true, UInt(8, 64), 33, "pavgbx64",
+         u8(((wild_u16x_ + wild_u16x_) + 1) / 2)},
+        {Target::AVX512_Skylake, true, UInt(16, 32), 17, "pavgwx32",
+         u16(((wild_u32x_ + wild_u32x_) + 1) / 2)},
+        {Target::AVX512_Skylake, false, Int(16, 32), 17, "packssdwx32",
+         i16_sat(wild_i32x_)},
+        {Target::AVX512_Skylake, false, Int(8, 64), 33, "packsswbx64",
+         i8_sat(wild_i16x_)},
+        {Target::AVX512_Skylake, false, UInt(8, 64), 33, "packuswbx64",
+         u8_sat(wild_i16x_)},
+        {Target::AVX512_Skylake, false, UInt(16, 32), 17, "packusdwx32",
+         u16_sat(wild_i32x_)},
+
         // Only use the avx2 version if we have > 8 lanes
         {Target::AVX2, true, Int(16, 16), 9, "llvm.x86.avx2.pmulh.w",
          i16((wild_i32x_ * wild_i32x_) / 65536)},
@@ -272,7 +391,10 @@ void CodeGen_X86::visit(const Cast *op) {
     for (size_t i = 0; i < sizeof(patterns)/sizeof(patterns[0]); i++) {
         const Pattern &pattern = patterns[i];
 
-        if (!target.has_feature(pattern.feature)) {
+        if (!target.has_feature(pattern.feature) &&
+            !(pattern.feature == Target::AVX512_Skylake &&
+              target.has_feature(Target::AVX512_Cannonlake))) {
+            // Cannonlake has everything Skylake does.
             continue;
         }
 
@@ -323,6 +445,178 @@ void CodeGen_X86::visit(const Cast *op) {
     CodeGen_Posix::visit(op);
 }
 
+void CodeGen_X86::visit(const Load *op) {
+    // Dense and strided loads are handled well by the default
+    // lowering. Here we handle gathers with 32-bit offsets.
+    if (!op->type.is_vector() || op->index.as<Ramp>() || !is_one(op->predicate) ||
+        !target.has_feature(Target::SSE41)) {
+        CodeGen_Posix::visit(op);
+        return;
+    }
+
+    // Split the index into a scalar base and a vector of offsets from it.
+    Expr base = make_zero(op->index.type().element_of());
+    Expr offset = op->index;
+    if (const Add *add = offset.as<Add>()) {
+        if (const Broadcast *b = add->b.as<Broadcast>()) {
+            base = b->value;
+            offset = add->a;
+        } else if (const Broadcast *b = add->a.as<Broadcast>()) {
+            base = b->value;
+            offset = add->b;
+        }
+    }
+    if (offset.type().element_of() == Int(64)) {
+        // With large buffers, the offsets may be 32-bit offsets that
+        // have been sign-extended (see NarrowIndices.h).
+        const Cast *c = offset.as<Cast>();
+        if (c && c->value.type().element_of() == Int(32)) {
+            offset = c->value;
+        }
+    }
+    if (offset.type().element_of() != Int(32)) {
+        CodeGen_Posix::visit(op);
+        return;
+    }
+
+    const int lanes = op->type.lanes();
+    const int bits = op->type.bits();
+
+    // If the offsets span a small enough range, load that range of
+    // the buffer densely and look the values up in registers.
+    Interval range = bounds_of_expr_in_scope(offset, Scope<Interval>::empty_scope());
+    const int64_t *lo = range.is_bounded() ? as_const_int(simplify(range.min)) : nullptr;
+    const int64_t *hi = range.is_bounded() ? as_const_int(simplify(range.max)) : nullptr;
+    int table_size = (bits == 8) ? 16 : 8;
+    bool small_table = (lo && hi && *hi > *lo && *hi - *lo < table_size &&
+                        (bits == 8 || (bits == 32 && target.has_feature(Target::AVX2))));
+    if (small_table) {
+        int n = (int)(*hi - *lo + 1);
+        Expr table_index = Ramp::make(base + make_const(base.type(), *lo), make_one(base.type()), n);
+        Expr table_load = Load::make(op->type.with_lanes(n), op->name, table_index,
+                                     op->image, op->param, const_true(n));
+        Value *table = slice_vector(codegen(table_load), 0, table_size);
+        Value *idx = codegen(cast(Int(bits).with_lanes(lanes), offset - (int)*lo));
+
+        vector<Value *> results;
+        if (bits == 8) {
+            // pshufb looks up each byte of the index in a table of 16
+            // bytes.
+            llvm::Type *bytes_t = VectorType::get(i8_t, 16);
+            table = builder->CreateBitCast(table, bytes_t);
+            for (int i = 0; i < lanes; i += 16) {
+                results.push_back(call_intrin(bytes_t, 16, "llvm.x86.ssse3.pshuf.b.128",
+                                              {table, slice_vector(idx, i, 16)}));
+            }
+        } else {
+            // vpermd looks up each 32-bit lane of the index in a table
+            // of 8 words.
+            llvm::Type *words_t = VectorType::get(i32_t, 8);
+            table = builder->CreateBitCast(table, words_t);
+            llvm::Function *permd = Intrinsic::getDeclaration(module.get(), Intrinsic::x86_avx2_permd);
+            for (int i = 0; i < lanes; i += 8) {
+                results.push_back(builder->CreateCall(permd, {table, slice_vector(idx, i, 8)}));
+            }
+        }
+        value = slice_vector(concat_vectors(results), 0, lanes);
+        value = builder->CreateBitCast(value, llvm_type_of(op->type));
+        return;
+    }
+
+    // Otherwise use AVX2 gathers for 32-bit values.
+    if (bits == 32 && target.has_feature(Target::AVX2)) {
+        Value *ptr = codegen_buffer_pointer(op->name, op->type.element_of(), base);
+        ptr = builder->CreatePointerCast(ptr, i8_t->getPointerTo());
+        Value *idx = codegen(offset);
+        llvm::Type *words_t = VectorType::get(i32_t, 8);
+        llvm::Function *gather = Intrinsic::getDeclaration(module.get(), Intrinsic::x86_avx2_gather_d_d_256);
+
+        vector<Value *> results;
+        for (int i = 0; i < lanes; i += 8) {
+            // Mask off the lanes past the end of the vector, so that
+            // they don't load from undefined addresses.
+            vector<Constant *> mask(8);
+            for (int j = 0; j < 8; j++) {
+                mask[j] = ConstantInt::get(i32_t, i + j < lanes ? -1 : 0);
+            }
+            Value *args[] = {UndefValue::get(words_t), ptr, slice_vector(idx, i, 8),
+                             ConstantVector::get(mask), ConstantInt::get(i8_t, 4)};
+            CallInst *call = builder->CreateCall(gather, args);
+            add_tbaa_metadata(call, op->name, op->index);
+            results.push_back(call);
+        }
+        value = slice_vector(concat_vectors(results), 0, lanes);
+        value = builder->CreateBitCast(value, llvm_type_of(op->type));
+        return;
+    }
+
+    CodeGen_Posix::visit(op);
+}
+
+bool CodeGen_X86::use_mask_registers(Type t) const {
+    // AVX-512 predicates loads and stores with mask registers, and
+    // has masked gathers and scatters of 32 and 64-bit values.
+    #if LLVM_VERSION >= 40
+    return ((target.has_feature(Target::AVX512) ||
+             target.has_feature(Target::AVX512_KNL) ||
+             target.has_feature(Target::AVX512_Skylake) ||
+             target.has_feature(Target::AVX512_Cannonlake)) &&
+            !t.is_handle() && (t.bits() == 32 || t.bits() == 64));
+    #else
+    return false;
+    #endif
+}
+
+Value *CodeGen_X86::codegen_vector_of_pointers(const std::string &name, Type t, Expr index) {
+    Value *base = sym_get(name);
+    llvm::Type *ptr_t = llvm_type_of(t.element_of())->getPointerTo(base->getType()->getPointerAddressSpace());
+    base = builder->CreatePointerCast(base, ptr_t);
+    Value *idx = codegen(index);
+    llvm::DataLayout d(module.get());
+    if (d.getPointerSize() == 8) {
+        idx = builder->CreateIntCast(idx, VectorType::get(i64_t, t.lanes()), true);
+    }
+    return builder->CreateInBoundsGEP(base, idx);
+}
+
+void CodeGen_X86::codegen_predicated_vector_load(const Load *op) {
+    // Dense predicated loads are already masked loads. Other indices
+    // would be scalarized, with a branch per lane; on AVX-512 keep the
+    // predicate in a mask register and gather instead.
+    const Ramp *ramp = op->index.as<Ramp>();
+    if ((ramp && (is_one(ramp->stride) || is_const(ramp->stride, -1))) ||
+        !use_mask_registers(op->type)) {
+        CodeGen_Posix::codegen_predicated_vector_load(op);
+        return;
+    }
+
+    debug(4) << "Masked gather\n\t" << Expr(op) << "\n";
+    Value *vpred = codegen(op->predicate);
+    Value *ptrs = codegen_vector_of_pointers(op->name, op->type, op->index);
+    // The lanes that aren't loaded are zero, as in the scalarized case.
+    Value *zero = Constant::getNullValue(llvm_type_of(op->type));
+    Instruction *gather = builder->CreateMaskedGather(ptrs, op->type.bytes(), vpred, zero);
+    add_tbaa_metadata(gather, op->name, op->index);
+    value = gather;
+}
+
+void CodeGen_X86::codegen_predicated_vector_store(const Store *op) {
+    // As above, but scatter.
+    Type t = op->value.type();
+    const Ramp *ramp = op->index.as<Ramp>();
+    if ((ramp && is_one(ramp->stride)) || !use_mask_registers(t)) {
+        CodeGen_Posix::codegen_predicated_vector_store(op);
+        return;
+    }
+
+    debug(4) << "Masked scatter\n\t" << Stmt(op) << "\n";
+    Value *vpred = codegen(op->predicate);
+    Value *val = codegen(op->value);
+    Value *ptrs = codegen_vector_of_pointers(op->name, t, op->index);
+    Instruction *scatter = builder->CreateMaskedScatter(val, ptrs, t.bytes(), vpred);
+    add_tbaa_metadata(scatter, op->name, op->index);
+}
+
 Expr CodeGen_X86::mulhi_shr(Expr a, Expr b, int shr) {
     Type ty = a.type();
     if (ty.is_vector() && ty.bits() == 16) {
@@ -368,6 +662,62 @@ void CodeGen_X86::visit(const Call *op) {
     }
 }
 
+Value *CodeGen_X86::interleave_vectors(const std::vector<Value *> &vecs) {
+    // LLVM turns a three-way interleave of bytes or shorts (e.g. a
+    // store of packed RGB) into long chains of element inserts and
+    // extracts. With pshufb, each 16 bytes of the result is just the
+    // bitwise or of one byte shuffle of each input. (Power-of-two
+    // interleaves become unpack instructions, which is already
+    // good.)
+    llvm::VectorType *vt = vecs.empty() ? nullptr : dyn_cast<llvm::VectorType>(vecs[0]->getType());
+    if (vecs.size() == 3 && vt && target.has_feature(Target::SSE41) &&
+        vt->getElementType()->isIntegerTy()) {
+        const int elem_bytes = vt->getElementType()->getIntegerBitWidth() / 8;
+        const int lanes = vt->getNumElements();
+        if ((elem_bytes == 1 || elem_bytes == 2) && (lanes * elem_bytes) % 16 == 0) {
+            const int chunk_lanes = 16 / elem_bytes;
+            llvm::Type *bytes_t = VectorType::get(i8_t, 16);
+            llvm::Type *chunk_t = VectorType::get(vt->getElementType(), chunk_lanes);
+
+            // The shuffle masks for each input, for each 16 bytes of
+            // the result. A mask byte with the high bit set gives a
+            // zero.
+            Value *masks[3][3];
+            for (int out = 0; out < 3; out++) {
+                for (int in = 0; in < 3; in++) {
+                    vector<Constant *> mask(16);
+                    for (int k = 0; k < 16; k++) {
+                        int byte = out * 16 + k;
+                        int elem = byte / elem_bytes;
+                        int src = (elem / 3) * elem_bytes + byte % elem_bytes;
+                        mask[k] = ConstantInt::get(i8_t, elem % 3 == in ? src : 0x80);
+                    }
+                    masks[out][in] = ConstantVector::get(mask);
+                }
+            }
+
+            vector<Value *> result;
+            for (int c = 0; c < lanes; c += chunk_lanes) {
+                Value *src[3];
+                for (int in = 0; in < 3; in++) {
+                    src[in] = builder->CreateBitCast(slice_vector(vecs[in], c, chunk_lanes), bytes_t);
+                }
+                for (int out = 0; out < 3; out++) {
+                    Value *v = nullptr;
+                    for (int in = 0; in < 3; in++) {
+                        Value *s = call_intrin(bytes_t, 16, "llvm.x86.ssse3.pshuf.b.128",
+                                               {src[in], masks[out][in]});
+                        v = v ? builder->CreateOr(v, s) : s;
+                    }
+                    result.push_back(builder->CreateBitCast(v, chunk_t));
+                }
+            }
+            return concat_vectors(result);
+        }
+    }
+    return CodeGen_Posix::interleave_vectors(vecs);
+}
+
 string CodeGen_X86::mcpu() const {
     #if LLVM_VERSION >= 40
     if (target.has_feature(Target::AVX512_Cannonlake)) return "cannonlake";
@@ -46,7 +46,26 @@ protected:
     void visit(const EQ *);
     void visit(const NE *);
     void visit(const Select *);
+    void visit(const VectorReduce *);
+    void visit(const Load *);
     // @}
+
+    llvm::Value *interleave_vectors(const std::vector<llvm::Value *> &);
+
+    /** On AVX-512, predicated loads and stores that aren't dense are
+     * masked gathers and scatters, rather than being scalarized. */
+    // @{
+    void codegen_predicated_vector_load(const Load *op);
+    void codegen_predicated_vector_store(const Store *op);
+    // @}
+
+    /** Whether vectors of the given type can be predicated using
+     * AVX-512 mask registers. */
+    bool use_mask_registers(Type t) const;
+
+    /** Compute a vector of the addresses of the given indices of a
+     * buffer. */
+    llvm::Value *codegen_vector_of_pointers(const std::string &name, Type t, Expr index);
 };
 
 }}
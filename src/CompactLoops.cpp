@@ -0,0 +1,208 @@
+#include "CompactLoops.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+#include "ExprUsesVar.h"
+#include "Function.h"
+#include "Debug.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::pair;
+using std::string;
+using std::vector;
+
+namespace {
+
+class CompactLoops : public IRMutator {
+    // The names of the compacted loops, and their vector widths.
+    const map<string, int> &compacted;
+
+    using IRMutator::visit;
+
+    void visit(const For *op) {
+        auto it = compacted.find(op->name);
+        if (it == compacted.end()) {
+            IRMutator::visit(op);
+            return;
+        }
+        const int vector_width = it->second;
+
+        // Peel off the loops, lets and ifs down to the update itself.
+        struct Container {
+            const For *loop;
+            string name;
+            Expr value;  // The value of a let, or the condition of an if.
+        };
+        vector<Container> nest;
+        vector<const For *> loops;
+        Stmt body = op;
+        while (true) {
+            if (const For *loop = body.as<For>()) {
+                user_assert(loop->for_type == ForType::Serial)
+                    << "Can't compact the loop over " << op->name
+                    << " because the loop over " << loop->name
+                    << " inside it isn't serial.\n";
+                for (const For *outer : loops) {
+                    user_assert(!expr_uses_var(loop->min, outer->name) &&
+                                !expr_uses_var(loop->extent, outer->name))
+                        << "Can't compact the loop over " << op->name
+                        << " because the bounds of the loop over " << loop->name
+                        << " depend on " << outer->name << ".\n";
+                }
+                loops.push_back(loop);
+                nest.push_back({loop, "", Expr()});
+                body = loop->body;
+            } else if (const LetStmt *let = body.as<LetStmt>()) {
+                nest.push_back({nullptr, let->name, let->value});
+                body = let->body;
+            } else if (const IfThenElse *if_then = body.as<IfThenElse>()) {
+                if (if_then->else_case.defined()) break;
+                nest.push_back({nullptr, "", if_then->condition});
+                body = if_then->then_case;
+            } else {
+                break;
+            }
+        }
+        int last_if = -1;
+        for (int i = 0; i < (int)nest.size(); i++) {
+            if (!nest[i].loop && nest[i].name.empty()) {
+                last_if = i;
+            }
+        }
+        user_assert(last_if >= 0)
+            << "Can't compact the loop over " << op->name
+            << " because there is no predicate directly inside it.\n";
+
+        // The loops and lets inside the innermost predicate are part
+        // of the update.
+        for (int i = (int)nest.size() - 1; i > last_if; i--) {
+            if (nest[i].loop) {
+                const For *loop = nest[i].loop;
+                body = For::make(loop->name, loop->min, loop->extent,
+                                 loop->for_type, loop->device_api, body);
+                loops.pop_back();
+            } else {
+                body = LetStmt::make(nest[i].name, nest[i].value, body);
+            }
+        }
+        Expr cond = nest[last_if].value;
+        nest.resize(last_if);
+
+        debug(3) << "Compacting the loop over " << op->name
+                 << " and " << loops.size() - 1 << " loops inside it\n";
+
+        string prefix = op->name + ".compact";
+        string indices = prefix + ".indices";
+        string count = prefix + ".count";
+        auto load = [](const string &buf, Expr index) {
+            return Load::make(Int(32), buf, index, Buffer<>(), Parameter(), const_true());
+        };
+        auto store = [](const string &buf, Expr value, Expr index) {
+            return Store::make(buf, value, index, Parameter(), const_true());
+        };
+
+        // The index of a point within the box the loops iterate over.
+        Expr linear = 0, total = 1;
+        for (const For *loop : loops) {
+            linear = linear * loop->extent + (Variable::make(Int(32), loop->name) - loop->min);
+            total *= loop->extent;
+        }
+
+        // Gather the indices of the points that satisfy the
+        // predicates. The index of every point that gets past the
+        // outer predicates is stored, and the count is only advanced
+        // past the ones that satisfy the innermost one, so that there
+        // is no branch on it.
+        Expr c = Variable::make(Int(32), count + ".value");
+        Stmt gather = Block::make(store(indices, linear, c),
+                                  store(count, c + select(cond, 1, 0), 0));
+        gather = LetStmt::make(count + ".value", load(count, 0), gather);
+        for (int i = (int)nest.size() - 1; i >= 0; i--) {
+            if (nest[i].loop) {
+                const For *loop = nest[i].loop;
+                gather = For::make(loop->name, loop->min, loop->extent,
+                                   loop->for_type, loop->device_api, gather);
+            } else if (!nest[i].name.empty()) {
+                gather = LetStmt::make(nest[i].name, nest[i].value, gather);
+            } else {
+                gather = IfThenElse::make(nest[i].value, gather);
+            }
+        }
+        gather = Block::make(store(count, 0, 0), gather);
+
+        // Iterate over the points gathered. Every point satisfies all
+        // of the predicates, so all the lets are safe to evaluate.
+        auto visit_point = [&](Expr index) {
+            Stmt s = body;
+            for (size_t i = nest.size(); i > 0; i--) {
+                if (!nest[i-1].loop && !nest[i-1].name.empty()) {
+                    s = LetStmt::make(nest[i-1].name, nest[i-1].value, s);
+                }
+            }
+            Expr rest = Variable::make(Int(32), prefix + ".point");
+            vector<pair<string, Expr>> coords;
+            for (size_t i = loops.size(); i > 1; i--) {
+                const For *loop = loops[i-1];
+                coords.push_back({loop->name, rest % loop->extent + loop->min});
+                rest = rest / loop->extent;
+            }
+            coords.push_back({loops[0]->name, rest + loops[0]->min});
+            for (const auto &coord : coords) {
+                s = LetStmt::make(coord.first, coord.second, s);
+            }
+            return LetStmt::make(prefix + ".point", load(indices, index), s);
+        };
+
+        Expr n = Variable::make(Int(32), count + ".total");
+        Stmt scatter;
+        if (vector_width > 1) {
+            string outer = prefix + ".vo", inner = prefix + ".vi", tail = prefix + ".tail";
+            Expr full = n / vector_width;
+            Expr point = Variable::make(Int(32), outer) * vector_width + Variable::make(Int(32), inner);
+            Stmt vectors = For::make(inner, 0, vector_width, ForType::Vectorized,
+                                     op->device_api, visit_point(point));
+            vectors = For::make(outer, 0, full, ForType::Serial, op->device_api, vectors);
+            Stmt rest = For::make(tail, full * vector_width, n - full * vector_width,
+                                  ForType::Serial, op->device_api,
+                                  visit_point(Variable::make(Int(32), tail)));
+            scatter = Block::make(vectors, rest);
+        } else {
+            string point = prefix + ".i";
+            scatter = For::make(point, 0, n, ForType::Serial, op->device_api,
+                                visit_point(Variable::make(Int(32), point)));
+        }
+        scatter = LetStmt::make(count + ".total", load(count, 0), scatter);
+
+        stmt = Block::make(gather, scatter);
+        stmt = Allocate::make(count, Int(32), {1}, const_true(), stmt);
+        stmt = Allocate::make(indices, Int(32), {total}, const_true(), stmt);
+    }
+
+public:
+    CompactLoops(const map<string, int> &compacted) : compacted(compacted) {}
+};
+
+}  // namespace
+
+Stmt compact_loops(Stmt s, const map<string, Function> &env) {
+    map<string, int> compacted;
+    for (const auto &p : env) {
+        const Function &f = p.second;
+        for (size_t i = 0; i < f.updates().size(); i++) {
+            const StageSchedule &sched = f.updates()[i].schedule();
+            if (!sched.compact_var().empty()) {
+                string loop = f.name() + ".s" + std::to_string(i + 1) + "." + sched.compact_var();
+                compacted[loop] = sched.compact_vector_width();
+            }
+        }
+    }
+    if (compacted.empty()) {
+        return s;
+    }
+    return CompactLoops(compacted).mutate(s);
+}
+
+}
+}
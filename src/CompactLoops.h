@@ -0,0 +1,28 @@
+#ifndef HALIDE_COMPACT_LOOPS_H
+#define HALIDE_COMPACT_LOOPS_H
+
+/** \file
+ *
+ * Defines the lowering pass that makes the loops of stages scheduled
+ * with Stage::compact iterate over only the points that satisfy the
+ * predicates of their reduction domains.
+ */
+
+#include <map>
+
+#include "IR.h"
+
+namespace Halide {
+namespace Internal {
+
+/** Replace the loop nests of compacted stages with a branch-free loop
+ * nest that gathers the indices of the points that satisfy the
+ * predicates, followed by a loop over those points only. Should be
+ * called after bounds inference, as the bounds of the loops over the
+ * points can no longer be inferred. */
+Stmt compact_loops(Stmt s, const std::map<std::string, Function> &env);
+
+}
+}
+
+#endif
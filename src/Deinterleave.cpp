@@ -295,6 +295,24 @@ private:
         }
     }
 
+    void visit(const VectorReduce *op) {
+        if (op->type.is_scalar()) {
+            expr = op;
+        } else {
+            // Reduce the groups of lanes of the input that make up
+            // the output lanes we want.
+            int factor = op->value.type().lanes() / op->type.lanes();
+            std::vector<int> indices;
+            for (int i = 0; i < new_lanes; i++) {
+                int lane = starting_lane + lane_stride * i;
+                for (int j = 0; j < factor; j++) {
+                    indices.push_back(lane * factor + j);
+                }
+            }
+            expr = VectorReduce::make(op->op, Shuffle::make({op->value}, indices), new_lanes);
+        }
+    }
+
     void visit(const Shuffle *op) {
         if (op->is_interleave()) {
             internal_assert(starting_lane >= 0 && starting_lane < lane_stride);
@@ -196,6 +196,26 @@ private:
         }
     }
 
+    void visit(const VectorReduce *op) {
+        Expr value = mutate(op->value);
+        if (op->value.type().is_bool() && !value.type().is_bool()) {
+            // The value is now a mask of zeros and all-ones
+            // (i.e. -1s), so all lanes are true if the max is -1, and
+            // any lane is true if the min is -1.
+            internal_assert(op->op == VectorReduce::And || op->op == VectorReduce::Or);
+            VectorReduce::Operator mask_op =
+                op->op == VectorReduce::And ? VectorReduce::Max : VectorReduce::Min;
+            expr = VectorReduce::make(mask_op, value, op->type.lanes());
+            if (op->type.is_scalar()) {
+                expr = expr != make_zero(expr.type());
+            }
+        } else if (value.same_as(op->value)) {
+            expr = op;
+        } else {
+            expr = VectorReduce::make(op->op, value, op->type.lanes());
+        }
+    }
+
     void visit(const Shuffle *op) {
         IRMutator::visit(op);
         if (op->is_extract_element() && op->type.is_bool()) {
@@ -5,6 +5,7 @@
  * Base classes for Halide expressions (\ref Halide::Expr) and statements (\ref Halide::Internal::Stmt)
  */
 
+#include <atomic>
 #include <string>
 #include <vector>
 
@@ -64,6 +65,7 @@ enum class IRNodeType {
     Evaluate,
     Shuffle,
     Prefetch,
+    VectorReduce,
 };
 
 /** The abstract base classes for a node in the Halide IR. */
@@ -77,6 +79,20 @@ struct IRNode {
     IRNode(IRNodeType t) : node_type(t) {}
     virtual ~IRNode() {}
 
+    /** Lowering creates and destroys IR nodes at a high rate. Small
+     * nodes are allocated from per-thread free lists carved out of
+     * large slabs instead of by malloc, which is faster and keeps
+     * nodes created together close together in memory. Memory given
+     * back to the free lists is reused for later nodes, but is never
+     * returned to the system. When a thread exits, its free lists are
+     * handed on to the threads still running. Set the environment variable
+     * HL_IR_ARENA=0 to use malloc for every node instead
+     * (e.g. when running under a memory checker). */
+    // @{
+    EXPORT static void *operator new(size_t size);
+    EXPORT static void operator delete(void *ptr, size_t size);
+    // @}
+
     /** These classes are all managed with intrusive reference
      * counting, so we also track a reference count. It's mutable
      * so that we can do reference counting even through const
@@ -118,8 +134,14 @@ struct BaseStmtNode : public IRNode {
 /** A base class for expression nodes. They all contain their types
  * (e.g. Int(32), Float(32)) */
 struct BaseExprNode : public IRNode {
-    BaseExprNode(IRNodeType t) : IRNode(t) {}
+    BaseExprNode(IRNodeType t) : IRNode(t), hash(0) {}
     Type type;
+
+    /** A hash of the structure of this expression, or zero if it
+     * hasn't been computed yet. Exprs are immutable once constructed,
+     * so this is filled in the first time it is needed, and is then
+     * valid for the life of the node. See \ref structural_hash */
+    mutable std::atomic<uint64_t> hash;
 };
 
 /** We use the "curiously recurring template pattern" to avoid
@@ -343,7 +365,9 @@ enum class ForType {
     Vectorized,
     Unrolled,
     GPUBlock,
-    GPUThread
+    GPUThread,
+    GPUWarpReduce,
+    GPUTensorCore
 };
 
 
@@ -30,6 +30,7 @@
 #include "Solve.h"
 #include "Associativity.h"
 #include "ApplySplit.h"
+#include "VectorizeLoops.h"
 #include "ImageParam.h"
 
 namespace Halide {
@@ -166,7 +167,27 @@ void Func::define_extern(const std::string &function_name,
                          NameMangling mangling,
                          DeviceAPI device_api,
                          bool uses_old_buffer_t) {
-    func.define_extern(function_name, args, types, dimensionality,
+    // Make some synthetic vars for scheduling purposes.
+    std::vector<Var> arguments;
+    for (int i = 0; i < dimensionality; i++) {
+        arguments.push_back(Var(unique_name('e')));
+    }
+    define_extern(function_name, args, types, arguments,
+                  mangling, device_api, uses_old_buffer_t);
+}
+
+void Func::define_extern(const std::string &function_name,
+                         const std::vector<ExternFuncArgument> &args,
+                         const std::vector<Type> &types,
+                         const std::vector<Var> &arguments,
+                         NameMangling mangling,
+                         DeviceAPI device_api,
+                         bool uses_old_buffer_t) {
+    std::vector<std::string> arg_names;
+    for (const Var &v : arguments) {
+        arg_names.push_back(v.name());
+    }
+    func.define_extern(function_name, args, types, arg_names,
                        mangling, device_api, uses_old_buffer_t);
 }
 
@@ -288,13 +309,16 @@ void Stage::set_dim_type(VarOrRVar var, ForType t) {
             if (!dims[i].is_pure() && var.is_rvar &&
                 (t == ForType::Vectorized || t == ForType::Parallel ||
                  t == ForType::GPUBlock || t == ForType::GPUThread)) {
-                user_assert(definition.schedule().allow_race_conditions())
+                user_assert(definition.schedule().allow_race_conditions() ||
+                            definition.schedule().atomic())
                     << "In schedule for " << stage_name
                     << ", marking var " << var.name()
                     << " as parallel or vectorized may introduce a race"
                     << " condition resulting in incorrect output."
                     << " It is possible to override this error using"
-                    << " the allow_race_conditions() method. Use this"
+                    << " the allow_race_conditions() method, or by making"
+                    << " the stores atomic with the atomic() method."
+                    << " Use allow_race_conditions()"
                     << " with great caution, and only when you are willing"
                     << " to accept non-deterministic output, or you can prove"
                     << " that any race conditions in this code do not change"
@@ -889,6 +913,184 @@ Func Stage::rfactor(vector<pair<RVar, Var>> preserved) {
     return intm;
 }
 
+vector<Func> Stage::parallel_scan(RVar r, Var b, Expr block_size) {
+    user_assert(!definition.is_init()) << "parallel_scan() must be called on an update definition\n";
+    user_assert(block_size.defined() && block_size.type().is_int())
+        << "In schedule for " << stage_name << ", the block size of parallel_scan() must be an integer\n";
+
+    string func_name;
+    {
+        vector<std::string> tmp = split_string(stage_name, ".update(");
+        internal_assert(!tmp.empty() && !tmp[0].empty());
+        func_name = tmp[0];
+    }
+
+    vector<Expr> &args = definition.args();
+    vector<Expr> &values = definition.values();
+    const vector<ReductionVariable> &rvars = definition.schedule().rvars();
+    Expr pred = definition.predicate();
+
+    user_assert(rvars.size() == 1 && var_name_match(rvars[0].var, r.name()))
+        << "In schedule for " << stage_name
+        << ", can't perform parallel_scan() on " << r.name()
+        << " since it is not the only variable of the reduction domain\n"
+        << dump_argument_list();
+    user_assert(definition.schedule().splits().empty())
+        << "In schedule for " << stage_name
+        << ", parallel_scan() must be called before the update is split or fused\n";
+    user_assert(!pred.defined() || is_one(pred))
+        << "In schedule for " << stage_name
+        << ", can't perform parallel_scan() on a reduction domain with a predicate\n";
+
+    // The scan runs along one argument, which must be exactly the
+    // RVar. The others must be the pure Vars of the Func.
+    const ReductionVariable rv = rvars[0];
+    Expr rvar = Variable::make(Int(32), rv.var);
+    int scan_dim = -1;
+    for (size_t i = 0; i < args.size(); i++) {
+        const Variable *v = args[i].as<Variable>();
+        if (v && v->name == rv.var) {
+            scan_dim = (int)i;
+        } else {
+            user_assert(v && v->name == dim_vars[i].name())
+                << "In schedule for " << stage_name
+                << ", can't perform parallel_scan() since argument " << i
+                << " of the update is neither " << r.name() << " nor the pure Var "
+                << dim_vars[i].name() << "\n";
+        }
+    }
+    user_assert(scan_dim >= 0)
+        << "In schedule for " << stage_name
+        << ", can't perform parallel_scan() since " << r.name()
+        << " is not one of the arguments of the update\n";
+
+    // The update must combine the value one step back with something
+    // that doesn't depend on the Func.
+    vector<Expr> prev_args = args;
+    prev_args[scan_dim] = rvar - 1;
+    const auto &prover_result = prove_associativity(func_name, prev_args, values);
+    user_assert(prover_result.associative())
+        << "Failed to call parallel_scan() on " << stage_name
+        << " since it can't prove that it is a scan with an associative operator\n";
+    internal_assert(prover_result.size() == values.size());
+    const size_t n = values.size();
+    for (size_t i = 0; i < n; i++) {
+        user_assert(!prover_result.xs[i].var.empty())
+            << "Failed to call parallel_scan() on " << stage_name
+            << " since its value at index " << i << " doesn't depend on the previous value\n";
+    }
+
+    // Apply the associative operator to two partial results.
+    auto combine = [&](const vector<Expr> &x, const vector<Expr> &y) {
+        map<string, Expr> replacements;
+        for (size_t i = 0; i < n; i++) {
+            replacements.emplace(prover_result.xs[i].var, x[i]);
+            if (!prover_result.ys[i].var.empty()) {
+                replacements.emplace(prover_result.ys[i].var, y[i]);
+            }
+        }
+        vector<Expr> result(n);
+        for (size_t i = 0; i < n; i++) {
+            result[i] = substitute(replacements, prover_result.pattern.ops[i]);
+        }
+        return result;
+    };
+    auto elements = [&](FuncRef ref) {
+        vector<Expr> result(n);
+        for (size_t i = 0; i < n; i++) {
+            result[i] = (n == 1) ? Expr(ref) : Expr(ref[i]);
+        }
+        return result;
+    };
+
+    user_assert(!var_name_match(rv.var, b.name()) &&
+                std::find_if(dim_vars.begin(), dim_vars.end(),
+                             [&b](const Var &v) { return v.name() == b.name(); }) == dim_vars.end())
+        << "In schedule for " << stage_name
+        << ", can't use " << b.name() << " as the block index of parallel_scan()"
+        << " since it is already used in this Func's schedule elsewhere.\n"
+        << dump_argument_list();
+
+    Var i(unique_name('i'));
+    vector<Expr> local_args, carry_args;
+    for (size_t d = 0; d < dim_vars.size(); d++) {
+        if ((int)d == scan_dim) {
+            local_args.push_back(i);
+        } else {
+            local_args.push_back(dim_vars[d]);
+            carry_args.push_back(dim_vars[d]);
+        }
+    }
+    local_args.push_back(b);
+    carry_args.push_back(b);
+    Tuple identities(prover_result.pattern.identities);
+
+    Expr r_min = rv.min, r_extent = rv.extent;
+    Expr num_blocks = (r_extent + block_size - 1) / block_size;
+
+    // Scan each block on its own. The padding at the end of the last
+    // block reads a clamped index and contributes the identity.
+    Func local(func_name + "_scan_local");
+    local(local_args) = identities;
+    RDom ri(0, block_size, func_name + "_scan_ri");
+    {
+        Expr pos = b * block_size + ri;
+        Expr index = r_min + min(pos, r_extent - 1);
+        vector<Expr> y(n);
+        for (size_t k = 0; k < n; k++) {
+            if (!prover_result.ys[k].var.empty()) {
+                y[k] = substitute(rv.var, index, prover_result.ys[k].expr);
+                y[k] = select(pos < r_extent, y[k], prover_result.pattern.identities[k]);
+            }
+        }
+        vector<Expr> store_args = local_args, load_args = local_args;
+        store_args[scan_dim] = ri;
+        load_args[scan_dim] = ri - 1;
+        local(store_args) = Tuple(combine(elements(local(load_args)), y));
+    }
+
+    // Scan the totals of the blocks to get the value carried into
+    // each one.
+    Func carry(func_name + "_scan_carry");
+    carry(carry_args) = identities;
+    RDom rb(1, num_blocks - 1, func_name + "_scan_rb");
+    {
+        vector<Expr> store_args = carry_args, load_args = carry_args;
+        store_args.back() = rb;
+        load_args.back() = rb - 1;
+        vector<Expr> total_args = local_args;
+        total_args[scan_dim] = block_size - 1;
+        total_args.back() = rb - 1;
+        carry(store_args) = Tuple(combine(elements(carry(load_args)), elements(local(total_args))));
+    }
+
+    // The new update combines the value before the scan started, the
+    // carry into the block, and the scan within the block.
+    {
+        Expr pos = rvar - r_min;
+        Expr block = pos / block_size;
+        vector<Expr> start_args = args, carry_load = carry_args, local_load = local_args;
+        start_args[scan_dim] = r_min - 1;
+        carry_load.back() = block;
+        local_load[scan_dim] = pos % block_size;
+        local_load.back() = block;
+        vector<Expr> start(n);
+        for (size_t k = 0; k < n; k++) {
+            start[k] = Call::make(values[k].type(), func_name, start_args,
+                                  Call::CallType::Halide, FunctionPtr(), k);
+        }
+        vector<Expr> f_values = combine(combine(start, elements(carry(carry_load))),
+                                        elements(local(local_load)));
+        values.swap(f_values);
+    }
+
+    local.compute_root().parallel(b);
+    local.update(0).parallel(b);
+    carry.compute_root();
+
+    return {local, carry};
+}
+
 void Stage::split(const string &old, const string &outer, const string &inner, Expr factor, bool exact, TailStrategy tail) {
     debug(4) << "In schedule for " << stage_name << ", split " << old << " into "
              << outer << " and " << inner << " with factor of " << factor << "\n";
@@ -989,14 +1191,14 @@ void Stage::split(const string &old, const string &outer, const string &inner, E
     }
 
     if (exact) {
-        user_assert(tail == TailStrategy::GuardWithIf)
+        user_assert(tail == TailStrategy::GuardWithIf || tail == TailStrategy::Predicate)
             << "When splitting Var " << old_name
-            << " the tail strategy must be GuardWithIf or Auto. "
+            << " the tail strategy must be GuardWithIf, Predicate, or Auto. "
             << "Anything else may change the meaning of the algorithm\n";
     }
 
     // Add the split to the splits list
-    Split split = {old_name, outer_name, inner_name, factor, exact, tail, Split::SplitVar};
+    Split split = {old_name, outer_name, inner_name, factor, exact, tail, Split::SplitVar, false};
     definition.schedule().splits().push_back(split);
 }
 
@@ -1078,11 +1280,17 @@ Stage &Stage::fuse(VarOrRVar inner, VarOrRVar outer, VarOrRVar fused) {
     }
 
     // Add the fuse to the splits list
-    Split split = {fused_name, outer_name, inner_name, Expr(), true, TailStrategy::RoundUp, Split::FuseVars};
+    Split split = {fused_name, outer_name, inner_name, Expr(), true, TailStrategy::RoundUp, Split::FuseVars, false};
     definition.schedule().splits().push_back(split);
     return *this;
 }
 
+Stage &Stage::fuse_z_order(Var inner, Var outer, Var fused) {
+    fuse(inner, outer, fused);
+    definition.schedule().splits().back().z_order = true;
+    return *this;
+}
+
 namespace Internal {
 class CheckForFreeVars : public IRGraphVisitor {
 public:
@@ -1171,7 +1379,7 @@ Stage &Stage::purify(VarOrRVar old_var, VarOrRVar new_var) {
             << dump_argument_list();
     }
 
-    Split split = {old_name, new_name, "", 1, false, TailStrategy::RoundUp, Split::PurifyRVar};
+    Split split = {old_name, new_name, "", 1, false, TailStrategy::RoundUp, Split::PurifyRVar, false};
     definition.schedule().splits().push_back(split);
     return *this;
 }
@@ -1354,7 +1562,7 @@ Stage &Stage::rename(VarOrRVar old_var, VarOrRVar new_var) {
     }
 
     if (!found) {
-        Split split = {old_name, new_name, "", 1, old_var.is_rvar, TailStrategy::RoundUp, Split::RenameVar};
+        Split split = {old_name, new_name, "", 1, old_var.is_rvar, TailStrategy::RoundUp, Split::RenameVar, false};
         definition.schedule().splits().push_back(split);
     }
 
@@ -1366,6 +1574,41 @@ Stage &Stage::allow_race_conditions() {
     return *this;
 }
 
+Stage &Stage::atomic() {
+    definition.schedule().atomic() = true;
+    return *this;
+}
+
+Stage &Stage::compact(VarOrRVar var, int vector_width) {
+    user_assert(!definition.split_predicate().empty())
+        << "In schedule for " << stage_name
+        << ", can't compact the loops over " << var.name()
+        << " because the stage has no reduction domain predicate to compact them by.\n";
+    user_assert(vector_width >= 0)
+        << "In schedule for " << stage_name
+        << ", the vector width of a compacted loop must not be negative.\n";
+    user_assert(vector_width <= 1 ||
+                definition.schedule().allow_race_conditions() ||
+                definition.schedule().atomic())
+        << "In schedule for " << stage_name
+        << ", vectorizing the compacted loops over " << var.name()
+        << " may introduce a race condition resulting in incorrect output."
+        << " Call allow_race_conditions() or atomic() first if it doesn't.\n";
+
+    const vector<Dim> &dims = definition.schedule().dims();
+    for (size_t i = 0; i < dims.size(); i++) {
+        if (var_name_match(dims[i].var, var.name())) {
+            definition.schedule().compact_var() = dims[i].var;
+            definition.schedule().compact_vector_width() = vector_width;
+            return *this;
+        }
+    }
+    user_error << "In schedule for " << stage_name
+               << ", could not find dimension " << var.name()
+               << " to compact.\n";
+    return *this;
+}
+
 Stage &Stage::serial(VarOrRVar var) {
     set_dim_type(var, ForType::Serial);
     return *this;
@@ -1398,6 +1641,28 @@ Stage &Stage::parallel(VarOrRVar var, Expr factor, TailStrategy tail) {
     return *this;
 }
 
+Stage &Stage::parallel(VarOrRVar var, TaskSize task_size, int min_task_size, int max_task_size) {
+    internal_assert(task_size == TaskSize::Auto);
+    user_assert(min_task_size >= 1 && max_task_size >= 0 &&
+                (max_task_size == 0 || max_task_size >= min_task_size))
+        << "In schedule for " << stage_name
+        << ", the bounds on the task size of the parallel loop over " << var.name()
+        << " must be positive, and the maximum must not be less than the minimum.\n";
+    parallel(var);
+    const vector<Dim> &dims = definition.schedule().dims();
+    for (size_t i = 0; i < dims.size(); i++) {
+        if (var_name_match(dims[i].var, var.name())) {
+            definition.schedule().auto_task_size_var() = dims[i].var;
+            definition.schedule().min_task_size() = min_task_size;
+            definition.schedule().max_task_size() = max_task_size;
+            return *this;
+        }
+    }
+    internal_error << "parallel(" << var.name() << ") didn't find the dimension in "
+                   << stage_name << "\n";
+    return *this;
+}
+
 Stage &Stage::vectorize(VarOrRVar var, Expr factor, TailStrategy tail) {
     if (var.is_rvar) {
         RVar tmp;
@@ -1411,6 +1676,11 @@ Stage &Stage::vectorize(VarOrRVar var, Expr factor, TailStrategy tail) {
     return *this;
 }
 
+Stage &Stage::vectorize(VarOrRVar var, VectorWidth width, TailStrategy tail) {
+    internal_assert(width == VectorWidth::Auto);
+    return vectorize(var, auto_vector_width(), tail);
+}
+
 Stage &Stage::unroll(VarOrRVar var, Expr factor, TailStrategy tail) {
     if (var.is_rvar) {
         RVar tmp;
@@ -1557,6 +1827,22 @@ Stage &Stage::gpu_single_thread(DeviceAPI device_api) {
     return *this;
 }
 
+Stage &Stage::gpu_warp_reduce(RVar r, DeviceAPI device_api) {
+    set_dim_device_api(r, device_api);
+    set_dim_type(r, ForType::GPUWarpReduce);
+    return *this;
+}
+
+Stage &Stage::gpu_tensor_core(VarOrRVar m, VarOrRVar n, RVar k, DeviceAPI device_api) {
+    set_dim_device_api(m, device_api);
+    set_dim_device_api(n, device_api);
+    set_dim_device_api(k, device_api);
+    set_dim_type(m, ForType::GPUTensorCore);
+    set_dim_type(n, ForType::GPUTensorCore);
+    set_dim_type(k, ForType::GPUTensorCore);
+    return *this;
+}
+
 Stage &Stage::gpu(VarOrRVar bx, VarOrRVar tx, DeviceAPI device_api) {
     return gpu_blocks(bx).gpu_threads(tx);
 }
@@ -1731,6 +2017,15 @@ Stage &Stage::prefetch(const Internal::Parameter &param, VarOrRVar var, Expr off
     return *this;
 }
 
+Stage &Stage::prefetch(const Func &f, VarOrRVar var, PrefetchBoundStrategy strategy) {
+    // An undefined offset makes lowering choose one.
+    return prefetch(f, var, Expr(), strategy);
+}
+
+Stage &Stage::prefetch(const Internal::Parameter &param, VarOrRVar var, PrefetchBoundStrategy strategy) {
+    return prefetch(param, var, Expr(), strategy);
+}
+
 void Func::invalidate_cache() {
     if (pipeline_.defined()) {
         pipeline_.invalidate_cache();
@@ -1837,6 +2132,63 @@ Func Func::in() {
     return get_wrapper(func, name() + "_global_wrapper", {}, false);
 }
 
+Func Func::stage_input(Func input, VarOrRVar at, int vector_width) {
+    user_assert(defined())
+        << "Can't stage the inputs of Func " << name() << " before it is defined.\n";
+    user_assert(input.defined())
+        << "Can't stage undefined Func " << input.name() << " into Func " << name() << ".\n";
+
+    const vector<Dim> &dims = func.definition().schedule().dims();
+    bool found = false, on_gpu = false;
+    int thread_dims = 0;
+    for (const Dim &d : dims) {
+        if (var_name_match(d.var, at.name())) {
+            found = true;
+            on_gpu = d.for_type == ForType::GPUBlock;
+        }
+        if (d.for_type == ForType::GPUThread) {
+            thread_dims++;
+        }
+    }
+    user_assert(found)
+        << "Can't stage " << input.name() << " at " << at.name()
+        << ", because " << at.name() << " is not a loop of " << name() << ".\n";
+
+    Func wrapper = input.in(*this);
+    wrapper.compute_at(LoopLevel(*this, at));
+
+    vector<Var> args = wrapper.args();
+    if (args.empty()) {
+        return wrapper;
+    }
+
+    if (on_gpu) {
+        user_assert(thread_dims > 0)
+            << "Can't stage " << input.name() << " into shared memory at " << at.name()
+            << ", because " << name() << " has no GPU thread loops to load it with. "
+            << "Schedule the GPU threads of " << name() << " first.\n";
+        // Use as many thread dimensions for the copy as the consumer
+        // has, so that the copy runs over the same threads.
+        int n = std::min(thread_dims, (int)args.size());
+        if (n == 1) {
+            wrapper.gpu_threads(args[0]);
+        } else if (n == 2) {
+            wrapper.gpu_threads(args[0], args[1]);
+        } else {
+            wrapper.gpu_threads(args[0], args[1], args[2]);
+        }
+    } else {
+        if (vector_width == 0) {
+            vector_width = get_target_from_environment().natural_vector_size(input.output_types()[0]);
+        }
+        if (vector_width > 1) {
+            wrapper.vectorize(args[0], vector_width, TailStrategy::GuardWithIf);
+        }
+    }
+
+    return wrapper;
+}
+
 Func Func::clone_in(const Func &f) {
     invalidate_cache();
     vector<Func> fs = {f};
@@ -1885,7 +2237,7 @@ Func Func::copy_to_device(DeviceAPI d) {
 
     ExternFuncArgument device_interface = make_device_interface_call(d);
     func.define_extern("halide_buffer_copy", {buffer, device_interface},
-                       {call->type}, (int)call->args.size(),
+                       {call->type}, func.args(),
                        NameMangling::C, d, false);
     return *this;
 }
@@ -1914,6 +2266,12 @@ Func &Func::fuse(VarOrRVar inner, VarOrRVar outer, VarOrRVar fused) {
     return *this;
 }
 
+Func &Func::fuse_z_order(Var inner, Var outer, Var fused) {
+    invalidate_cache();
+    Stage(func.definition(), name(), args(), func.schedule()).fuse_z_order(inner, outer, fused);
+    return *this;
+}
+
 Func &Func::rename(VarOrRVar old_name, VarOrRVar new_name) {
     invalidate_cache();
     Stage(func.definition(), name(), args(), func.schedule()).rename(old_name, new_name);
@@ -1925,12 +2283,83 @@ Func &Func::allow_race_conditions() {
     return *this;
 }
 
+Func &Func::atomic() {
+    invalidate_cache();
+    Stage(func.definition(), name(), args(), func.schedule()).atomic();
+    return *this;
+}
+
 Func &Func::memoize() {
     invalidate_cache();
     func.schedule().memoized() = true;
     return *this;
 }
 
+Func &Func::memoize_buffer_contents(int64_t max_bytes) {
+    user_assert(max_bytes > 0)
+        << "memoize_buffer_contents of Func " << name()
+        << " needs a positive maximum size\n";
+    invalidate_cache();
+    func.schedule().memoized() = true;
+    func.schedule().hashed_buffer_max_bytes() = max_bytes;
+    return *this;
+}
+
+Func &Func::async() {
+    invalidate_cache();
+    func.schedule().async() = true;
+    return *this;
+}
+
+Func &Func::store_nontemporal() {
+    invalidate_cache();
+    func.schedule().nontemporal() = true;
+    return *this;
+}
+
+Func &Func::store_tuple_interleaved() {
+    invalidate_cache();
+    func.schedule().interleave_tuple() = true;
+    return *this;
+}
+
+Func &Func::slide_in_tasks(Expr task_size) {
+    user_assert(task_size.defined() && task_size.type().is_int())
+        << "The task size passed to slide_in_tasks for " << name()
+        << " must be an integer.\n";
+    user_assert(!is_const(task_size) || is_positive_const(task_size))
+        << "The task size passed to slide_in_tasks for " << name()
+        << " must be positive.\n";
+    invalidate_cache();
+    func.schedule().slide_task_size() = cast<int>(task_size);
+    return *this;
+}
+
+Func &Func::compute_if(Expr condition) {
+    user_assert(condition.defined() && condition.type().is_bool() && condition.type().is_scalar())
+        << "The condition passed to compute_if for " << name()
+        << " must be a scalar boolean.\n";
+    Internal::CheckForFreeVars check;
+    condition.accept(&check);
+    if (!check.offending_var.empty()) {
+        user_error << "The condition " << condition << " passed to compute_if for " << name()
+                   << " depends on Var or RVar " << check.offending_var << ". "
+                   << "The condition may not depend on any Vars or RVars.\n";
+    }
+    invalidate_cache();
+    func.schedule().compute_if() = condition;
+    return *this;
+}
+
+Func &Func::stream(Var t, Expr extent) {
+    user_assert(extent.defined() && extent.type().is_int() && extent.type().is_scalar())
+        << "The extent passed to stream for " << name()
+        << " must be a scalar integer.\n";
+    fold_storage(t, extent, true);
+    func.schedule().stream_var() = t.name();
+    return *this;
+}
+
 Stage Func::specialize(Expr c) {
     invalidate_cache();
     return Stage(func.definition(), name(), args(), func.schedule()).specialize(c);
@@ -1971,12 +2400,24 @@ Func &Func::parallel(VarOrRVar var, Expr factor, TailStrategy tail) {
     return *this;
 }
 
+Func &Func::parallel(VarOrRVar var, TaskSize task_size, int min_task_size, int max_task_size) {
+    invalidate_cache();
+    Stage(func.definition(), name(), args(), func.schedule()).parallel(var, task_size, min_task_size, max_task_size);
+    return *this;
+}
+
 Func &Func::vectorize(VarOrRVar var, Expr factor, TailStrategy tail) {
     invalidate_cache();
     Stage(func.definition(), name(), args(), func.schedule()).vectorize(var, factor, tail);
     return *this;
 }
 
+Func &Func::vectorize(VarOrRVar var, VectorWidth width, TailStrategy tail) {
+    invalidate_cache();
+    Stage(func.definition(), name(), args(), func.schedule()).vectorize(var, width, tail);
+    return *this;
+}
+
 Func &Func::unroll(VarOrRVar var, Expr factor, TailStrategy tail) {
     invalidate_cache();
     Stage(func.definition(), name(), args(), func.schedule()).unroll(var, factor, tail);
@@ -2281,6 +2722,14 @@ Func &Func::prefetch(const Internal::Parameter &param, VarOrRVar var, Expr offse
     return *this;
 }
 
+Func &Func::prefetch(const Func &f, VarOrRVar var, PrefetchBoundStrategy strategy) {
+    return prefetch(f, var, Expr(), strategy);
+}
+
+Func &Func::prefetch(const Internal::Parameter &param, VarOrRVar var, PrefetchBoundStrategy strategy) {
+    return prefetch(param, var, Expr(), strategy);
+}
+
 Func &Func::reorder_storage(Var x, Var y) {
     invalidate_cache();
 
@@ -2351,6 +2800,41 @@ Func &Func::fold_storage(Var dim, Expr factor, bool fold_forward) {
     return *this;
 }
 
+Func &Func::store_tiled(Var x, Var y, Expr x_tile, Expr y_tile) {
+    user_assert(is_positive_const(x_tile) && is_positive_const(y_tile))
+        << "The tile extents passed to store_tiled for " << name()
+        << " must be positive constants.\n";
+    invalidate_cache();
+
+    vector<StorageDim> &dims = func.schedule().storage_dims();
+    for (StorageDim &d : dims) {
+        d.tile_extent = Expr();
+    }
+
+    user_assert(!x.same_as(y))
+        << "store_tiled for " << name() << " needs two different variables.\n";
+
+    // Move x, and then y, to the innermost storage dimensions
+    Var vars[] = {x, y};
+    Expr tiles[] = {x_tile, y_tile};
+    for (size_t j = 0; j < 2; j++) {
+        bool found = false;
+        for (size_t i = j; i < dims.size() && !found; i++) {
+            if (var_name_match(dims[i].var, vars[j].name())) {
+                StorageDim d = dims[i];
+                d.tile_extent = cast<int>(tiles[j]);
+                dims.erase(dims.begin() + i);
+                dims.insert(dims.begin() + j, d);
+                found = true;
+            }
+        }
+        user_assert(found)
+            << "Could not find variable " << vars[j].name()
+            << " to store in tiles in the schedule of " << name() << ".\n";
+    }
+    return *this;
+}
+
 Func &Func::compute_at(LoopLevel loop_level) {
     invalidate_cache();
     func.schedule().compute_level() = loop_level;
@@ -2368,6 +2852,14 @@ Func &Func::compute_at(Func f, Var var) {
     return compute_at(LoopLevel(f, var));
 }
 
+Func &Func::compute_with(Func f, Var var) {
+    invalidate_cache();
+    user_assert(!f.function().same_as(func))
+        << "Func " << name() << " can't be computed with itself.\n";
+    func.schedule().compute_with_level() = LoopLevel(f, var);
+    return *this;
+}
+
 Func &Func::compute_root() {
     return compute_at(LoopLevel::root());
 }
@@ -2390,6 +2882,24 @@ Func &Func::store_root() {
     return store_at(LoopLevel::root());
 }
 
+Func &Func::hoist_storage(LoopLevel loop_level) {
+    invalidate_cache();
+    func.schedule().hoist_storage_level() = loop_level;
+    return *this;
+}
+
+Func &Func::hoist_storage(Func f, RVar var) {
+    return hoist_storage(LoopLevel(f, var));
+}
+
+Func &Func::hoist_storage(Func f, Var var) {
+    return hoist_storage(LoopLevel(f, var));
+}
+
+Func &Func::hoist_storage_root() {
+    return hoist_storage(LoopLevel::root());
+}
+
 Func &Func::compute_inline() {
     return compute_at(LoopLevel::inlined());
 }
@@ -2914,8 +3424,9 @@ void Func::compile_to_c(const string &filename, const vector<Argument> &args,
 void Func::compile_to_lowered_stmt(const string &filename,
                                    const vector<Argument> &args,
                                    StmtOutputFormat fmt,
-                                   const Target &target) {
-    pipeline().compile_to_lowered_stmt(filename, args, fmt, target);
+                                   const Target &target,
+                                   const std::string &profile_filename) {
+    pipeline().compile_to_lowered_stmt(filename, args, fmt, target, profile_filename);
 }
 
 void Func::print_loop_nest() {
@@ -2998,6 +3509,17 @@ void Func::realize(Realization dst, const Target &target) {
     pipeline().realize(dst, target);
 }
 
+vector<pair<Expr, Expr>> Func::affected_region(const std::string &input,
+                                               const vector<pair<Expr, Expr>> &dirty,
+                                               const vector<pair<Expr, Expr>> &output_bounds) {
+    return pipeline().affected_region(input, dirty, output_bounds);
+}
+
+void Func::realize_dirty(Realization dst, const std::string &input,
+                         const vector<pair<Expr, Expr>> &dirty, const Target &target) {
+    pipeline().realize_dirty(dst, input, dirty, target);
+}
+
 void Func::infer_input_bounds(Realization dst) {
     pipeline().infer_input_bounds(dst);
 }
@@ -170,18 +170,61 @@ public:
     EXPORT Func rfactor(RVar r, Var v);
     // @}
 
+    /** Calling parallel_scan() on an update definition that is a scan
+     * along a one-dimensional RDom, i.e. of the form
+     * f(..., r, ...) = op(f(..., r - 1, ...), g(..., r, ...)) where op is
+     * associative and the other arguments are the pure Vars of f,
+     * rewrites it as a blocked scan that can run in parallel. The
+     * domain of r is cut into blocks of block_size. Two intermediate
+     * Funcs are added and returned: the first scans each block on its
+     * own, and the second scans the totals of the blocks to find the
+     * value carried into each. Both are indexed by the new pure Var b,
+     * the block index. The update of f then combines the value before
+     * the scan, the carry into the block and the scan within the block,
+     * so it no longer depends on its own previous value and r can be
+     * parallelized or vectorized. The associative operator and its
+     * identity are inferred, as for rfactor(). The operator does not
+     * need to be commutative.
+     *
+     * For example, a cumulative sum:
+     \code
+     f(x, y) = 0;
+     RDom r(0, 4096);
+     f(r, y) = f(r - 1, y) + g(r, y);
+     std::vector<Func> scans = f.update(0).parallel_scan(r, b, 256);
+     f.update(0).parallel(y).vectorize(r, 8);
+     \endcode
+     * is rewritten into:
+     \code
+     f_scan_local(i, y, b) = 0;
+     f_scan_local(ri, y, b) = f_scan_local(ri - 1, y, b) + g(256*b + ri, y);
+     f_scan_carry(y, b) = 0;
+     f_scan_carry(y, rb) = f_scan_carry(y, rb - 1) + f_scan_local(255, y, rb - 1);
+     f(x, y) = 0;
+     f(r, y) = (f(-1, y) + f_scan_carry(y, r / 256)) + f_scan_local(r % 256, y, r / 256);
+     \endcode
+     * with ri going from 0 to 255, and rb from 1 to 15. Both
+     * intermediates are computed at root, and the scans within the
+     * blocks run in parallel over b. They can be rescheduled like any
+     * other Func, e.g. with gpu_blocks over b. The last block is padded
+     * with the identity if block_size doesn't divide the extent of r. */
+    EXPORT std::vector<Func> parallel_scan(RVar r, Var b, Expr block_size);
+
     /** Scheduling calls that control how the domain of this stage is
      * traversed. See the documentation for Func for the meanings. */
     // @{
 
     EXPORT Stage &split(VarOrRVar old, VarOrRVar outer, VarOrRVar inner, Expr factor, TailStrategy tail = TailStrategy::Auto);
     EXPORT Stage &fuse(VarOrRVar inner, VarOrRVar outer, VarOrRVar fused);
+    EXPORT Stage &fuse_z_order(Var inner, Var outer, Var fused);
     EXPORT Stage &serial(VarOrRVar var);
     EXPORT Stage &parallel(VarOrRVar var);
     EXPORT Stage &vectorize(VarOrRVar var);
     EXPORT Stage &unroll(VarOrRVar var);
     EXPORT Stage &parallel(VarOrRVar var, Expr task_size, TailStrategy tail = TailStrategy::Auto);
+    EXPORT Stage &parallel(VarOrRVar var, TaskSize task_size, int min_task_size = 1, int max_task_size = 0);
     EXPORT Stage &vectorize(VarOrRVar var, Expr factor, TailStrategy tail = TailStrategy::Auto);
+    EXPORT Stage &vectorize(VarOrRVar var, VectorWidth width, TailStrategy tail = TailStrategy::Auto);
     EXPORT Stage &unroll(VarOrRVar var, Expr factor, TailStrategy tail = TailStrategy::Auto);
     EXPORT Stage &tile(VarOrRVar x, VarOrRVar y,
                        VarOrRVar xo, VarOrRVar yo,
@@ -210,6 +253,37 @@ public:
     EXPORT Stage &gpu_threads(VarOrRVar thread_x, VarOrRVar thread_y, VarOrRVar thread_z, DeviceAPI device_api = DeviceAPI::Default_GPU);
     EXPORT Stage &gpu_single_thread(DeviceAPI device_api = DeviceAPI::Default_GPU);
 
+    /** Compute this update's reduction over the RVar r, which must
+     * have extent 32, with one term per thread of a warp, and combine
+     * the terms with warp shuffles instead of by looping over them in
+     * one thread. The update must be of the form f(...) = f(...) op
+     * term, where op is +, *, min or max, and the sites updated must
+     * not depend on r. The terms are combined in a different order
+     * than the serial loop would, so floating-point results may
+     * differ slightly. r must be inside a loop over gpu blocks, and
+     * not inside a loop over gpu threads. Where warp shuffles aren't
+     * available (anything but CUDA with a cuda_capability of 30 or
+     * higher), the reduction is done serially instead. */
+    EXPORT Stage &gpu_warp_reduce(RVar r, DeviceAPI device_api = DeviceAPI::Default_GPU);
+
+    /** Compute this update, which must be of the form f(m, n) = f(m,
+     * n) + f32(a) * f32(b), where f is of type float and a and b are
+     * float16 values that depend on (m, k) and (k, n) respectively,
+     * on the tensor cores, one 16x16x16 tile at a time. The loops
+     * over m, n and the RVar k must have extent 16 (e.g. the inner
+     * loops of a split by 16), must be the innermost loops of the
+     * update, in any order, and must be inside a loop over gpu blocks
+     * and not inside a loop over gpu threads. The tile is multiplied
+     * by the first warp of the block. Each of the three matrices must
+     * be dense along its rows or columns, the distance between its
+     * rows (or columns) must be a multiple of 16 bytes, and the first
+     * element of each tile must be 32-byte aligned. The sums are
+     * computed in a different order than the serial loops would, so
+     * results may differ slightly. Where tensor cores aren't
+     * available (anything but CUDA with cuda_capability_70), the
+     * loops are run serially instead. */
+    EXPORT Stage &gpu_tensor_core(VarOrRVar m, VarOrRVar n, RVar k, DeviceAPI device_api = DeviceAPI::Default_GPU);
+
     EXPORT Stage &gpu_blocks(VarOrRVar block_x, DeviceAPI device_api = DeviceAPI::Default_GPU);
     EXPORT Stage &gpu_blocks(VarOrRVar block_x, VarOrRVar block_y, DeviceAPI device_api = DeviceAPI::Default_GPU);
     EXPORT Stage &gpu_blocks(VarOrRVar block_x, VarOrRVar block_y, VarOrRVar block_z, DeviceAPI device_api = DeviceAPI::Default_GPU);
@@ -286,6 +360,58 @@ public:
 
     EXPORT Stage &allow_race_conditions();
 
+    /** Make each store of this stage an atomic read-modify-write of
+     * the location stored to, so that the stage can be parallelized
+     * over RVars that would otherwise race. For example, a histogram
+     * can be computed in parallel without rfactor:
+     *
+     \code
+     hist(im(r.x, r.y)) += 1;
+     hist.update().atomic().parallel(r.y);
+     \endcode
+     *
+     * Call this before parallelizing the RVars. Integer additions
+     * become native atomic adds, and anything else becomes a
+     * compare-and-swap loop. Each value of a Tuple is updated
+     * atomically on its own, not together with the others. Supported
+     * on CPU and PTX targets, and for 32-bit types on OpenCL.
+     *
+     * An atomic stage can also be vectorized over an RVar, as long as
+     * the location stored to doesn't depend on it, and each update
+     * combines the old value with something that doesn't depend on
+     * it using +, *, min, max, && or ||. The vector of updates is
+     * reduced horizontally and then stored once, using native
+     * horizontal reductions where the target has them:
+     *
+     \code
+     dot() += cast<int>(a(r)) * b(r);
+     dot.update().atomic().vectorize(r, 16);
+     \endcode
+     */
+    EXPORT Stage &atomic();
+
+    /** Iterate the loop over the given dimension and the loops inside
+     * it over only the points that satisfy the predicates of the
+     * reduction domain (see \ref RDom::where). The points are first
+     * gathered into a list of indices with a branch-free pass over
+     * the whole box, and then the list is iterated over without
+     * any branches. This pays off when few of the points satisfy
+     * the predicates, e.g.:
+     *
+     \code
+     RDom r(0, W, 0, H);
+     r.where(mask(r.x, r.y) != 0);
+     score() += corner_response(r.x, r.y);
+     score.update().compact(r.y);
+     \endcode
+     *
+     * The loops compacted must be serial. If vector_width is greater
+     * than one, the list is iterated over in vectors of that many
+     * points, which requires the updates of different points not to
+     * race (see \ref Stage::allow_race_conditions and \ref
+     * Stage::atomic). */
+    EXPORT Stage &compact(VarOrRVar var, int vector_width = 0);
+
     EXPORT Stage &hexagon(VarOrRVar x = Var::outermost());
     EXPORT Stage &prefetch(const Func &f, VarOrRVar var, Expr offset = 1,
                            PrefetchBoundStrategy strategy = PrefetchBoundStrategy::GuardWithIf);
@@ -296,6 +422,12 @@ public:
                     PrefetchBoundStrategy strategy = PrefetchBoundStrategy::GuardWithIf) {
         return prefetch(image.parameter(), var, offset, strategy);
     }
+    EXPORT Stage &prefetch(const Func &f, VarOrRVar var, PrefetchBoundStrategy strategy);
+    EXPORT Stage &prefetch(const Internal::Parameter &param, VarOrRVar var, PrefetchBoundStrategy strategy);
+    template<typename T>
+    Stage &prefetch(const T &image, VarOrRVar var, PrefetchBoundStrategy strategy) {
+        return prefetch(image.parameter(), var, strategy);
+    }
     // @}
 };
 
@@ -596,6 +728,17 @@ public:
      * automatically copy data back from the GPU. */
     EXPORT void realize(Realization dst, const Target &target = Target());
 
+    /** See Pipeline::affected_region and Pipeline::realize_dirty */
+    // @{
+    EXPORT std::vector<std::pair<Expr, Expr>> affected_region(const std::string &input,
+                                                              const std::vector<std::pair<Expr, Expr>> &dirty,
+                                                              const std::vector<std::pair<Expr, Expr>> &output_bounds =
+                                                                  std::vector<std::pair<Expr, Expr>>());
+    EXPORT void realize_dirty(Realization dst, const std::string &input,
+                              const std::vector<std::pair<Expr, Expr>> &dirty,
+                              const Target &target = Target());
+    // @}
+
     /** For a given size of output, or a given output buffer,
      * determine the bounds required of all unbound ImageParams
      * referenced. Communicates the result by allocating new buffers
@@ -673,11 +816,16 @@ public:
 
     /** Write out an internal representation of lowered code. Useful
      * for analyzing and debugging scheduling. Can emit html or plain
-     * text. */
+     * text. For html, profile_filename may name a file containing the
+     * output of halide_profiler_report for a run of this pipeline
+     * compiled with the profile target feature; each producer and
+     * loop is then annotated with its share of the runtime and its
+     * heap usage, and colored accordingly. */
     EXPORT void compile_to_lowered_stmt(const std::string &filename,
                                         const std::vector<Argument> &args,
                                         StmtOutputFormat fmt = Text,
-                                        const Target &target = get_target_from_environment());
+                                        const Target &target = get_target_from_environment(),
+                                        const std::string &profile_filename = "");
 
     /** Write out the loop nests specified by the schedule for this
      * Function. Helpful for understanding what a schedule is
@@ -981,6 +1129,36 @@ public:
                               bool uses_old_buffer_t = false);
     // @}
 
+    /** Add an extern definition for this Func, with the given Vars as
+     * its pure arguments. The Vars can then be used to schedule the
+     * extern stage: splitting them and making the outer loops
+     * parallel or serial computes the output region as tiles, with
+     * one call to the extern function per tile, each passed a
+     * halide_buffer_t cropped to its tile. The extern function must
+     * be thread-safe if tiles are computed in parallel. The inner
+     * vars of the splits can't be scheduled further, and neither
+     * can the extern stage be vectorized or mapped to the GPU. */
+    // @{
+    EXPORT void define_extern(const std::string &function_name,
+                              const std::vector<ExternFuncArgument> &params,
+                              Type t,
+                              const std::vector<Var> &arguments,
+                              NameMangling mangling = NameMangling::Default,
+                              DeviceAPI device_api = DeviceAPI::Host,
+                              bool uses_old_buffer_t = false) {
+        define_extern(function_name, params, std::vector<Type>{t},
+                      arguments, mangling, device_api, uses_old_buffer_t);
+    }
+
+    EXPORT void define_extern(const std::string &function_name,
+                              const std::vector<ExternFuncArgument> &params,
+                              const std::vector<Type> &types,
+                              const std::vector<Var> &arguments,
+                              NameMangling mangling = NameMangling::Default,
+                              DeviceAPI device_api = DeviceAPI::Host,
+                              bool uses_old_buffer_t = false);
+    // @}
+
     /** Get the types of the outputs of this Func. */
     EXPORT const std::vector<Type> &output_types() const;
 
@@ -1155,6 +1333,34 @@ public:
     EXPORT Func clone_in(const std::vector<Func> &fs);
     //@}
 
+    /** Stage the values of an input Func (or ImageParam) that this Func
+     * reads into a local buffer, computed at the given loop level of
+     * this Func. This creates a wrapper with input.in(*this), computes
+     * it at that loop level, and schedules the copy, so that bounds
+     * inference sizes the buffer to the region of the input each
+     * iteration of the loop needs. If the loop level is a GPU block
+     * loop, the buffer lives in shared memory, and the copy is
+     * distributed over the GPU threads of this Func, so the threads
+     * load the tile cooperatively. Otherwise, the copy is vectorized
+     * across the innermost dimension of the input, using the given
+     * vector width, or the natural vector width of the target in the
+     * environment if it is zero. The tail of the copy is guarded
+     * rather than rounded up, so it never reads beyond the region of
+     * the input this Func needs. Schedule the loops of this Func
+     * before calling this. Returns the wrapper, for further
+     * scheduling. For example:
+     \code
+     g.tile(x, y, xo, yo, xi, yi, 64, 64);
+     g.stage_input(f, xo);
+     \endcode
+     * is shorthand for:
+     \code
+     g.tile(x, y, xo, yo, xi, yi, 64, 64);
+     f.in(g).compute_at(g, xo).vectorize(_0, natural_vector_size, TailStrategy::GuardWithIf);
+     \endcode
+     */
+    EXPORT Func stage_input(Func input, VarOrRVar at, int vector_width = 0);
+
     /** Declare that this function should be implemented by a call to
      * halide_buffer_copy with the given target device API. Asserts
      * that the Func has a pure definition which is a simple call to a
@@ -1193,6 +1399,24 @@ public:
      * outer dimensions given. */
     EXPORT Func &fuse(VarOrRVar inner, VarOrRVar outer, VarOrRVar fused);
 
+    /** Join two dimensions into a single fused dimension that visits
+     * their points in Z-order (also called Morton order), by
+     * interleaving the bits of the inner and outer coordinates. Fusing
+     * the outer dimensions of a tiling this way gives a traversal of
+     * the tiles that is local at every scale, so it makes good use of
+     * every level of the cache without tuning the tile size for any
+     * one of them:
+     *
+     \code
+     f.tile(x, y, xo, yo, xi, yi, 16, 16).fuse_z_order(xo, yo, t).parallel(t);
+     \endcode
+     *
+     * When the extents aren't powers of two, the fused dimension
+     * covers the enclosing powers of two, and the points outside the
+     * original extents are skipped, so it has at most four times as
+     * many iterations as an ordinary fuse. */
+    EXPORT Func &fuse_z_order(Var inner, Var outer, Var fused);
+
     /** Mark a dimension to be traversed serially. This is the default. */
     EXPORT Func &serial(VarOrRVar var);
 
@@ -1207,6 +1431,21 @@ public:
      * manually. */
     EXPORT Func &parallel(VarOrRVar var, Expr task_size, TailStrategy tail = TailStrategy::Auto);
 
+    /** Mark a dimension to be traversed in parallel, in tasks of
+     * several iterations each, with the number of iterations per task
+     * chosen at runtime when the loop starts. Tasks that are too small
+     * spend their time in the thread pool, and tasks that are too
+     * large leave threads idle at the end of the loop, so the tasks
+     * are sized to take long enough to make the overhead of each
+     * small, but to give each thread several of them. The time an
+     * iteration takes is estimated from the definition of the stage
+     * on the first run of the loop, and measured on the later
+     * ones. The task size is clamped to at least min_task_size, and,
+     * if max_task_size is positive, at most max_task_size. Unlike the
+     * version that takes a task size, this doesn't split the
+     * dimension, so var still refers to the whole of it. */
+    EXPORT Func &parallel(VarOrRVar var, TaskSize task_size, int min_task_size = 1, int max_task_size = 0);
+
     /** Mark a dimension to be computed all-at-once as a single
      * vector. The dimension should have constant extent -
      * e.g. because it is the inner dimension following a split by a
@@ -1228,6 +1467,14 @@ public:
      * split. 'factor' must be an integer. */
     EXPORT Func &vectorize(VarOrRVar var, Expr factor, TailStrategy tail = TailStrategy::Auto);
 
+    /** Split a dimension by a vector width chosen by the compiler
+     * for the target from the types the Func computes with, then
+     * vectorize the inner dimension. This is useful for Funcs that
+     * mix narrow and wide types, e.g. uint8 inputs and int32
+     * accumulators, for which the natural vector size of any one of
+     * the types is a poor fit. */
+    EXPORT Func &vectorize(VarOrRVar var, VectorWidth width, TailStrategy tail = TailStrategy::Auto);
+
     /** Split a dimension by the given factor, then unroll the inner
      * dimension. This is how you unroll a loop of unknown size by
      * some constant factor. After this call, var refers to the outer
@@ -1308,6 +1555,10 @@ public:
      * different values at different times or on different machines. */
     EXPORT Func &allow_race_conditions();
 
+    /** Make each store of the pure definition of this Func an atomic
+     * read-modify-write. See \ref Stage::atomic */
+    EXPORT Func &atomic();
+
 
     /** Specialize a Func. This creates a special-case version of the
      * Func where the given condition is true. The most effective
@@ -1661,6 +1912,22 @@ public:
      *   for x = ...
      *     prefetch(&f[x + 2, y], 1, 16);
      *     g(x, y) = 2 * f(x, y)
+     *
+     * On Hexagon, prefetches are done by the DSP's L2 prefetch engine,
+     * which runs in the background. Prefetching at a tile loop with
+     * an offset of 1 (e.g. g.tile(x, y, xo, yo, xi, yi, 128,
+     * 32).prefetch(f, xo)) streams the whole of the next tile into L2
+     * while the current one is being computed.
+     *
+     * If the offset is left out and only the bound strategy is given
+     * (e.g. g.prefetch(f, x, PrefetchBoundStrategy::GuardWithIf)),
+     * it is chosen automatically: the prefetch runs as many
+     * iterations ahead as it takes to cover the memory latency, given
+     * how many bytes of f one iteration uses. If one iteration uses
+     * less than a cache line, a single prefetch is made every few
+     * iterations, for all of them. The latency assumed (in
+     * nanoseconds) can be set with the HL_PREFETCH_LATENCY
+     * environment variable. On Hexagon the offset is always 1.
      */
     // @{
     EXPORT Func &prefetch(const Func &f, VarOrRVar var, Expr offset = 1,
@@ -1672,6 +1939,12 @@ public:
                    PrefetchBoundStrategy strategy = PrefetchBoundStrategy::GuardWithIf) {
         return prefetch(image.parameter(), var, offset, strategy);
     }
+    EXPORT Func &prefetch(const Func &f, VarOrRVar var, PrefetchBoundStrategy strategy);
+    EXPORT Func &prefetch(const Internal::Parameter &param, VarOrRVar var, PrefetchBoundStrategy strategy);
+    template<typename T>
+    Func &prefetch(const T &image, VarOrRVar var, PrefetchBoundStrategy strategy) {
+        return prefetch(image.parameter(), var, strategy);
+    }
     // @}
 
     /** Specify how the storage for the function is laid out. These
@@ -1744,6 +2017,28 @@ public:
      */
     EXPORT Func &fold_storage(Var dim, Expr extent, bool fold_forward = true);
 
+    /** Store this function in tiles of x_tile by y_tile
+     * elements. Each tile occupies a contiguous block of memory, in
+     * which x is the innermost dimension. The tiles are stored in
+     * order along x, and then along y, and then the remaining
+     * dimensions in their storage order. x and y become the two
+     * innermost storage dimensions. The tile extents must be positive
+     * constants, and are best as powers of two.
+     *
+     * This helps when the function is consumed in 2-D tiles, as in
+     * stencils and matrix multiplies, because a tile touches fewer
+     * cache lines and pages than it would in a row-major
+     * layout. Vector loads are dense as long as they don't cross the
+     * boundary of a tile, i.e. if the consumer's vectorized loop over
+     * x is split by a factor of x_tile or its divisor. Tiles are
+     * aligned to multiples of the tile extents in the coordinates of
+     * the function, not to the minimum of its realization.
+     *
+     * The layout can't be described by a halide_buffer_t, so a
+     * function stored in tiles must not be an output of the pipeline,
+     * be passed to an extern stage, or be copied to a device. */
+    EXPORT Func &store_tiled(Var x, Var y, Expr x_tile, Expr y_tile);
+
     /** Compute this function as needed for each unique value of the
      * given var for the given calling function f.
      *
@@ -1824,6 +2119,38 @@ public:
      * a given LoopLevel. */
     EXPORT Func &compute_at(LoopLevel loop_level);
 
+    /** Fuse the loop nest of this function with the loop nest of
+     * another function computed at the same site, down to and
+     * including the loop over var in f. For example:
+     *
+     \code
+     Func gx, gy, out;
+     gx(x, y) = in(x + 1, y) - in(x - 1, y);
+     gy(x, y) = in(x, y + 1) - in(x, y - 1);
+     out(x, y) = gx(x, y) * gx(x, y) + gy(x, y) * gy(x, y);
+     gx.compute_at(out, y);
+     gy.compute_at(out, y);
+     gy.compute_with(gx, x);
+     \endcode
+     *
+     * computes gx and gy in a single loop over y and x, so that the
+     * values of the input they share are loaded from cache once
+     * instead of once per Func. The fused loops iterate over the
+     * union of the regions required of the two functions, and each
+     * one only computes its own region. Funcs computed at one of the
+     * fused loops of f are shared by both functions, so they are
+     * computed once per iteration of the fused loop instead of once
+     * per function.
+     *
+     * The two functions must not depend on each other, they must
+     * have the same compute_at, and they must have neither update
+     * nor extern definitions, nor specializations. The loops fused
+     * must have the same types, and may only be serial or parallel.
+     * The fused loops take the names of the loops of f, so no
+     * sliding window or storage folding is done over the fused loops
+     * of this function. */
+    EXPORT Func &compute_with(Func f, Var var);
+
     /** Compute all of this function once ahead of time. Reusing
      * the example in \ref Func::compute_at:
      *
@@ -1867,6 +2194,132 @@ public:
      */
     EXPORT Func &memoize();
 
+    /** Memoize this Func, like \ref Func::memoize, and include a hash
+     * of the contents of the input buffers it depends on in the cache
+     * key, so that calls with identical inputs hit in the cache even
+     * if the inputs are at different addresses. Without this, a
+     * memoized Func can't depend on input buffers, except via
+     * memoize_tag. Buffers with contents larger than max_bytes are
+     * not hashed, and the cache always misses on them. The hash is
+     * recomputed on every call, so this is only worthwhile when
+     * computing the Func costs much more than reading its inputs. */
+    EXPORT Func &memoize_buffer_contents(int64_t max_bytes = 16 * 1024 * 1024);
+
+    /** Produce this Func asynchronously in a separate thread, running
+     * ahead of its consumer. The Func must be computed inside a
+     * serial loop of its consumer, and stored outside of it, e.g.:
+     *
+     \code
+     f.compute_at(g, y).store_root().async();
+     \endcode
+     *
+     * The loop over g.y is then run twice, concurrently: one copy
+     * only computes f, and the other only computes g. They
+     * synchronize with semaphores, so that the consumer waits until
+     * the values of f it needs for each iteration have been produced,
+     * and, if the storage of f is folded, so that the producer waits
+     * until the consumer is done with the values it would otherwise
+     * overwrite. This lets the computation of f overlap with the
+     * computation of g, which helps when one of them is bound by
+     * memory or by an extern stage and the other by compute. Any
+     * other Func computed at the same loop level must be used by only
+     * one of f and g.
+     */
+    EXPORT Func &async();
+
+    /** Hint that the values of this Func are written once and not read
+     * again for a long time (or only by another device), so its
+     * stores should bypass the caches instead of evicting data that
+     * will be reused. On CPU targets, dense vector stores that are
+     * aligned to their full width become non-temporal stores
+     * (e.g. movntps on x86, or stnp on ARM). Other stores, and stores
+     * on other targets, are unchanged. Best used on large compute_root
+     * Funcs and outputs. */
+    EXPORT Func &store_nontemporal();
+
+    /** Store the elements of this Tuple-valued Func interleaved in a
+     * single allocation, instead of in one allocation per element. All
+     * the elements must have the same type. Has no effect on outputs
+     * of the pipeline, which use the buffers passed in. The elements of a point become
+     * adjacent in memory, as if the Func had an extra innermost
+     * dimension indexing the Tuple, so a point touches one cache line
+     * instead of one per element. Vectorized accesses become strided
+     * loads and interleaving stores, which are single instructions on
+     * ARM (vld2-4 and vst2-4) and shuffles elsewhere. Good for complex
+     * numbers and other small structs that are always used together. */
+    EXPORT Func &store_tuple_interleaved();
+
+    /** Allow the sliding window optimization of this Func across a
+     * parallel loop of its consumer between its store and compute
+     * levels. For example, with:
+     *
+     \code
+     g(x, y) = f(x, y) + f(x, y + 1);
+     f.store_root().compute_at(g, y).slide_in_tasks(16);
+     g.parallel(y);
+     \endcode
+     *
+     * the loop over g.y is split into tasks of 16 rows. The tasks run
+     * in parallel, each with its own storage for f, and the rows
+     * within each task are computed serially. The first row of each
+     * task computes all the values of f it needs, and the later rows
+     * only compute the new ones. Larger tasks recompute less of f
+     * at the task boundaries, but leave fewer tasks to spread over
+     * the threads. Has no effect if there is no parallel loop between
+     * the store and compute levels. */
+    EXPORT Func &slide_in_tasks(Expr task_size);
+
+    /** Only compute this Func when a runtime condition holds. The
+     * condition may depend on Params and on other Funcs, such as the
+     * result of a reduction, but not on any Vars or RVars. For
+     * example:
+     *
+     \code
+     Func mean;
+     mean() = sum(input(r.x, r.y)) / (r.x.extent() * r.y.extent());
+     mean.compute_root();
+     detail.compute_root().compute_if(mean() > threshold);
+     out(x, y) = select(mean() > threshold, detail(x, y), input(x, y));
+     \endcode
+     *
+     * When the condition is false the Func is still allocated, but
+     * none of its stages run and its values are undefined, so its
+     * consumers should guard their uses of it with the same
+     * condition. The Funcs the condition calls are computed before
+     * this one, and bounds inference includes the regions of them
+     * that it needs. Can't be used on inlined Funcs or on the outputs
+     * of a pipeline. */
+    EXPORT Func &compute_if(Expr condition);
+
+    /** Keep the values of this Func from one call of the pipeline to
+     * the next, for pipelines that process an unbounded stream (of
+     * audio samples, or video frames) one chunk at a time along the
+     * dimension t. Each call only computes the values of this Func
+     * along t past those the previous call computed, and reuses the
+     * rest, as the sliding window optimization does between the
+     * iterations of a loop. For example, a filter over the last
+     * three frames of a video only computes the intermediate for the
+     * newest frame on each call:
+     *
+     \code
+     Func denoised;
+     denoised(x, y, t) = ...;
+     denoised.compute_root().stream(t, 4);
+     out(x, y, t) = (denoised(x, y, t - 2) + denoised(x, y, t - 1) + denoised(x, y, t)) / 3;
+     \endcode
+     *
+     * The storage of the Func is folded along t by the given extent,
+     * which must be at least the extent of the Func each call needs
+     * along t, including its history, and lives in the runtime until
+     * halide_stream_state_reset is called. A call continues the
+     * stream if the region it needs along t starts within the values
+     * that are still held and doesn't end before them, and the region
+     * needed in every other dimension is the same; otherwise the Func
+     * is computed from scratch. The Func must be computed at root,
+     * must have no update definitions, and can't be an output. Calls
+     * for one stream must not run concurrently. */
+    EXPORT Func &stream(Var t, Expr extent);
+
 
     /** Allocate storage for this function within f's loop over
      * var. Scheduling storage is optional, and can be used to
@@ -1977,6 +2430,39 @@ public:
      * outside the outermost loop. */
     EXPORT Func &store_root();
 
+    /** Hoist the allocation of this Func out to the loop over the
+     * given var, without changing where it is stored or computed. For
+     * example, if g is computed at each row of f:
+     *
+     \code
+     g.compute_at(f, y).hoist_storage_root();
+     \endcode
+     *
+     * then g is still computed from scratch for each row, and the
+     * buffer it is stored in still only covers one row, but it is
+     * allocated once, outside the loop over y, and reused for each
+     * row. Unlike store_at, this doesn't allow sliding window or
+     * storage folding optimizations, which change what is computed
+     * in each iteration. The allocation is as large as the largest
+     * region needed by any iteration, so the extents of the region
+     * must be bounded over the loops the allocation is hoisted out
+     * of, and those loops must be serial. The hoist level must be
+     * outside of or equal to the store level. */
+    EXPORT Func &hoist_storage(Func f, Var var);
+
+    /** Equivalent to the version of hoist_storage that takes a Var,
+     * but hoists the allocation to the loop over a dimension of a
+     * reduction domain */
+    EXPORT Func &hoist_storage(Func f, RVar var);
+
+    /** Equivalent to the version of hoist_storage that takes a Var,
+     * but hoists the allocation to a given LoopLevel. */
+    EXPORT Func &hoist_storage(LoopLevel loop_level);
+
+    /** Equivalent to \ref Func::hoist_storage, but hoists the
+     * allocation outside the outermost loop. */
+    EXPORT Func &hoist_storage_root();
+
     /** Aggressively inline all uses of this function. This is the
      * default schedule, so you're unlikely to need to call this. For
      * a Func with an update definition, that means it gets computed
@@ -666,7 +666,7 @@ void Function::define_update(const vector<Expr> &_args, vector<Expr> values) {
 void Function::define_extern(const std::string &function_name,
                              const std::vector<ExternFuncArgument> &args,
                              const std::vector<Type> &types,
-                             int dimensionality,
+                             const std::vector<string> &arg_names,
                              NameMangling mangling,
                              DeviceAPI device_api,
                              bool use_old_buffer_t) {
@@ -686,6 +686,7 @@ void Function::define_extern(const std::string &function_name,
     contents->extern_function_device_api = device_api;
     contents->extern_uses_old_buffer_t = use_old_buffer_t;
 
+    const int dimensionality = (int)arg_names.size();
     for (size_t i = 0; i < types.size(); i++) {
         string buffer_name = name();
         if (types.size() > 1) {
@@ -695,16 +696,33 @@ void Function::define_extern(const std::string &function_name,
         contents->output_buffers.push_back(output);
     }
 
-    // Make some synthetic var names for scheduling purposes (e.g. reorder_storage).
+    // The pure args are used for scheduling (e.g. reorder_storage,
+    // or splitting the region into tiles computed by separate
+    // calls). If they already exist (e.g. copy_to_device preserves
+    // the pure vars of a wrapper), keep them and their schedule.
     auto &pure_def_args = contents->init_def.args();
-    while ((int)pure_def_args.size() < dimensionality) {
-        pure_def_args.push_back(Var(unique_name('e')));
+    if (pure_def_args.empty()) {
+        auto &dims = contents->init_def.schedule().dims();
+        dims.clear();
+        for (int i = 0; i < dimensionality; i++) {
+            pure_def_args.push_back(Var(arg_names[i]));
+            Dim d = {arg_names[i], ForType::Serial, DeviceAPI::None, Dim::Type::PureVar};
+            dims.push_back(d);
+        }
+        // Add the dummy outermost dim
+        Dim d = {Var::outermost().name(), ForType::Serial, DeviceAPI::None, Dim::Type::PureVar};
+        dims.push_back(d);
     }
+    user_assert((int)pure_def_args.size() == dimensionality)
+        << "In extern definition for Func \"" << name() << "\":\n"
+        << "Extern definition has " << dimensionality << " dimensions, "
+        << "but the Func already has " << pure_def_args.size() << " pure arguments.\n";
+
     // Reset the storage dims to match the pure args
-    vector<string> arg_names = this->args();
+    vector<string> pure_names = this->args();
     contents->func_schedule.storage_dims().clear();
     for (int i = 0; i < dimensionality; i++) {
-        StorageDim sd {arg_names[i]};
+        StorageDim sd {pure_names[i]};
         contents->func_schedule.storage_dims().push_back(sd);
     }
 }
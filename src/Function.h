@@ -228,11 +228,12 @@ public:
     EXPORT Expr &extern_definition_proxy_expr();
     // @}
 
-    /** Add an external definition of this Func. */
+    /** Add an external definition of this Func, with the given names
+     * for its pure arguments. */
     EXPORT void define_extern(const std::string &function_name,
                               const std::vector<ExternFuncArgument> &args,
                               const std::vector<Type> &types,
-                              int dimensionality,
+                              const std::vector<std::string> &arg_names,
                               NameMangling mangling,
                               DeviceAPI device_api,
                               bool uses_old_buffer_t);
@@ -0,0 +1,414 @@
+#include <map>
+#include <set>
+
+#include "FuseGPUKernels.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+#include "Simplify.h"
+#include "Substitute.h"
+#include "Util.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::pair;
+using std::set;
+using std::string;
+using std::vector;
+
+namespace {
+
+typedef vector<pair<string, Expr>> LetList;
+
+// Substitute in the values of the given enclosing lets, innermost
+// first, so that expressions in different scopes can be compared.
+Expr expand(Expr e, const LetList &lets) {
+    for (size_t i = lets.size(); i > 0; i--) {
+        e = substitute(lets[i-1].first, lets[i-1].second, e);
+    }
+    return e;
+}
+
+bool is_gpu_loop(const For *op) {
+    return op && (op->for_type == ForType::GPUBlock ||
+                  op->for_type == ForType::GPUThread);
+}
+
+// A kernel launch, split into the parts that are run once per launch
+// on the host, the gpu loops (and lets between them), and the body
+// that each thread runs.
+struct Kernel {
+    LetList host_lets;
+    vector<Stmt> wrappers;
+    Stmt body;
+};
+
+bool split_kernel(Stmt s, Kernel &k) {
+    while (const LetStmt *let = s.as<LetStmt>()) {
+        k.host_lets.push_back({let->name, let->value});
+        s = let->body;
+    }
+    const For *loop = s.as<For>();
+    if (!loop || loop->for_type != ForType::GPUBlock ||
+        loop->device_api == DeviceAPI::GLSL) {
+        return false;
+    }
+    while (true) {
+        if (const LetStmt *let = s.as<LetStmt>()) {
+            k.wrappers.push_back(s);
+            s = let->body;
+        } else if (is_gpu_loop(s.as<For>())) {
+            k.wrappers.push_back(s);
+            s = s.as<For>()->body;
+        } else {
+            break;
+        }
+    }
+    k.body = s;
+    return true;
+}
+
+Stmt rewrap(const vector<Stmt> &wrappers, Stmt body) {
+    for (size_t i = wrappers.size(); i > 0; i--) {
+        Stmt w = wrappers[i-1];
+        if (const LetStmt *let = w.as<LetStmt>()) {
+            body = LetStmt::make(let->name, let->value, body);
+        } else {
+            const For *loop = w.as<For>();
+            body = For::make(loop->name, loop->min, loop->extent,
+                             loop->for_type, loop->device_api, body);
+        }
+    }
+    return body;
+}
+
+struct Access {
+    Expr index;
+    Type type;
+    // Whether the access might not happen on every thread.
+    bool conditional;
+};
+
+// Find all the loads and stores in some IR, with their indices in
+// terms of the variables outside of the given enclosing lets.
+class FindAccesses : public IRVisitor {
+    using IRVisitor::visit;
+
+    LetList lets;
+    int conditional = 0;
+
+    void visit(const Let *op) {
+        op->value.accept(this);
+        lets.push_back({op->name, op->value});
+        op->body.accept(this);
+        lets.pop_back();
+    }
+
+    void visit(const LetStmt *op) {
+        op->value.accept(this);
+        lets.push_back({op->name, op->value});
+        op->body.accept(this);
+        lets.pop_back();
+    }
+
+    void visit(const For *op) {
+        op->min.accept(this);
+        op->extent.accept(this);
+        bool gpu = is_gpu_loop(op);
+        if (!gpu) {
+            conditional++;
+        }
+        op->body.accept(this);
+        if (!gpu) {
+            conditional--;
+        }
+    }
+
+    void visit(const IfThenElse *op) {
+        op->condition.accept(this);
+        conditional++;
+        op->then_case.accept(this);
+        if (op->else_case.defined()) {
+            op->else_case.accept(this);
+        }
+        conditional--;
+    }
+
+    void visit(const Allocate *op) {
+        allocated.insert(op->name);
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Load *op) {
+        IRVisitor::visit(op);
+        loads[op->name].push_back({expand(op->index, lets), op->type,
+                    conditional > 0 || !is_one(op->predicate)});
+    }
+
+    void visit(const Store *op) {
+        IRVisitor::visit(op);
+        stores[op->name].push_back({expand(op->index, lets), op->value.type(),
+                    conditional > 0 || !is_one(op->predicate)});
+    }
+
+    void visit(const Call *op) {
+        // Extern calls may touch memory we can't see.
+        if (op->call_type == Call::Extern ||
+            op->call_type == Call::ExternCPlusPlus ||
+            op->call_type == Call::Image) {
+            opaque = true;
+        }
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Variable *op) {
+        if (ends_with(op->name, ".buffer")) {
+            opaque = true;
+        }
+    }
+
+public:
+    map<string, vector<Access>> loads, stores;
+    set<string> allocated;
+    bool opaque = false;
+
+    FindAccesses(const LetList &l) : lets(l) {}
+};
+
+// The gpu loops of a kernel, with their bounds in terms of the
+// variables outside of the given lets.
+struct LoopBounds {
+    const For *loop;
+    Expr min, extent;
+};
+
+vector<LoopBounds> loop_bounds(const Kernel &k, LetList lets) {
+    vector<LoopBounds> result;
+    lets.insert(lets.end(), k.host_lets.begin(), k.host_lets.end());
+    for (Stmt w : k.wrappers) {
+        if (const LetStmt *let = w.as<LetStmt>()) {
+            lets.push_back({let->name, let->value});
+        } else {
+            const For *loop = w.as<For>();
+            result.push_back({loop, expand(loop->min, lets), expand(loop->extent, lets)});
+        }
+    }
+    return result;
+}
+
+class FuseGPUKernels : public IRMutator {
+    using IRMutator::visit;
+
+    LetList lets;
+
+    void visit(const LetStmt *op) {
+        lets.push_back({op->name, op->value});
+        Stmt body = mutate(op->body);
+        lets.pop_back();
+        if (body.same_as(op->body)) {
+            stmt = op;
+        } else {
+            stmt = LetStmt::make(op->name, op->value, body);
+        }
+    }
+
+    void visit(const Block *op) {
+        Stmt first = mutate(op->first);
+        Stmt rest = mutate(op->rest);
+
+        // Peel off the ProducerConsumer markers around the first
+        // kernel. They stay where they are.
+        vector<const ProducerConsumer *> markers;
+        Stmt s = first;
+        while (const ProducerConsumer *pc = s.as<ProducerConsumer>()) {
+            markers.push_back(pc);
+            s = pc->body;
+        }
+
+        Kernel k1;
+        if (split_kernel(s, k1)) {
+            FindAccesses a1(lets);
+            s.accept(&a1);
+            LetList lets2 = lets;
+            Stmt fused = a1.opaque ? Stmt() : fuse_into(rest, k1, a1, lets2);
+            if (fused.defined()) {
+                first = Evaluate::make(0);
+                for (size_t i = markers.size(); i > 0; i--) {
+                    first = ProducerConsumer::make(markers[i-1]->name, markers[i-1]->is_producer, first);
+                }
+                rest = fused;
+            }
+        }
+
+        if (first.same_as(op->first) && rest.same_as(op->rest)) {
+            stmt = op;
+        } else {
+            stmt = Block::make(first, rest);
+        }
+    }
+
+    // Whether some IR run between two kernels reads memory the first
+    // one writes, which would make it wrong to run the first one later.
+    bool depends_on(Expr e, const FindAccesses &a1) {
+        if (!e.defined()) {
+            return false;
+        }
+        FindAccesses a(LetList{});
+        e.accept(&a);
+        if (a.opaque) {
+            return true;
+        }
+        for (const auto &l : a.loads) {
+            if (a1.stores.count(l.first)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Look for the next kernel launch at the start of s, going through
+    // the lets and allocations that come before it, and merge k1 into
+    // it if possible. Returns an undefined Stmt if not.
+    Stmt fuse_into(Stmt s, const Kernel &k1, const FindAccesses &a1, LetList &lets2) {
+        if (const ProducerConsumer *op = s.as<ProducerConsumer>()) {
+            Stmt body = fuse_into(op->body, k1, a1, lets2);
+            return body.defined() ? ProducerConsumer::make(op->name, op->is_producer, body) : Stmt();
+        } else if (const LetStmt *op = s.as<LetStmt>()) {
+            if (depends_on(op->value, a1)) {
+                return Stmt();
+            }
+            lets2.push_back({op->name, op->value});
+            Stmt body = fuse_into(op->body, k1, a1, lets2);
+            lets2.pop_back();
+            return body.defined() ? LetStmt::make(op->name, op->value, body) : Stmt();
+        } else if (const Allocate *op = s.as<Allocate>()) {
+            if (depends_on(op->condition, a1) || depends_on(op->new_expr, a1)) {
+                return Stmt();
+            }
+            for (Expr e : op->extents) {
+                if (depends_on(e, a1)) {
+                    return Stmt();
+                }
+            }
+            Stmt body = fuse_into(op->body, k1, a1, lets2);
+            return body.defined() ?
+                Allocate::make(op->name, op->type, op->extents, op->condition,
+                               body, op->new_expr, op->free_function) : Stmt();
+        } else if (const Block *op = s.as<Block>()) {
+            // Skip over the markers left behind by earlier fusions.
+            Stmt marker = op->first;
+            while (const ProducerConsumer *pc = marker.as<ProducerConsumer>()) {
+                marker = pc->body;
+            }
+            if (is_no_op(marker)) {
+                Stmt rest = fuse_into(op->rest, k1, a1, lets2);
+                return rest.defined() ? Block::make(op->first, rest) : Stmt();
+            } else {
+                Stmt first = fuse_into(op->first, k1, a1, lets2);
+                return first.defined() ? Block::make(first, op->rest) : Stmt();
+            }
+        } else {
+            Kernel k2;
+            if (split_kernel(s, k2)) {
+                return fuse(k1, a1, k2, lets2);
+            }
+            return Stmt();
+        }
+    }
+
+    Stmt fuse(const Kernel &k1, const FindAccesses &a1, const Kernel &k2, const LetList &lets2) {
+        // The loops must match up one to one.
+        vector<LoopBounds> loops1 = loop_bounds(k1, lets), loops2 = loop_bounds(k2, lets2);
+        if (loops1.size() != loops2.size()) {
+            return Stmt();
+        }
+        map<string, Expr> renaming;
+        for (size_t i = 0; i < loops1.size(); i++) {
+            const For *l1 = loops1[i].loop, *l2 = loops2[i].loop;
+            if (l1->for_type != l2->for_type ||
+                l1->device_api != l2->device_api ||
+                !can_prove(loops1[i].min == loops2[i].min) ||
+                !can_prove(loops1[i].extent == loops2[i].extent)) {
+                return Stmt();
+            }
+            renaming[l2->name] = Variable::make(Int(32), l1->name);
+        }
+
+        // Run the second kernel in terms of the first one's loop variables.
+        Stmt s2 = substitute(renaming, rewrap(k2.wrappers, k2.body));
+        FindAccesses a2(lets2);
+        s2.accept(&a2);
+        if (a2.opaque) {
+            return Stmt();
+        }
+
+        // Nothing either kernel stores to may be touched by the other,
+        // with the exception of values the second kernel loads that
+        // were stored by the same thread of the first kernel.
+        for (const auto &s : a1.stores) {
+            const string &name = s.first;
+            if (a1.allocated.count(name)) {
+                continue;
+            }
+            if (a1.loads.count(name) || a2.stores.count(name)) {
+                return Stmt();
+            }
+            auto l = a2.loads.find(name);
+            if (l == a2.loads.end()) {
+                continue;
+            }
+            const Access &store = s.second[0];
+            for (const Access &other : s.second) {
+                if (other.conditional || other.type != store.type || !other.type.is_scalar() ||
+                    !can_prove(other.index == store.index)) {
+                    return Stmt();
+                }
+            }
+            for (const Access &load : l->second) {
+                if (load.type != store.type ||
+                    !can_prove(load.index == store.index)) {
+                    return Stmt();
+                }
+            }
+        }
+        for (const auto &s : a2.stores) {
+            if (!a2.allocated.count(s.first) && a1.loads.count(s.first)) {
+                return Stmt();
+            }
+        }
+
+        debug(3) << "Fusing kernel " << loops2[0].loop->name
+                 << " into kernel " << loops1[0].loop->name << "\n";
+
+        // The second kernel's lets go inside its body, as its loops
+        // are replaced by the first kernel's.
+        Stmt body2 = s2;
+        vector<Stmt> lets_of_k2;
+        while (true) {
+            if (const LetStmt *let = body2.as<LetStmt>()) {
+                lets_of_k2.push_back(body2);
+                body2 = let->body;
+            } else if (is_gpu_loop(body2.as<For>())) {
+                body2 = body2.as<For>()->body;
+            } else {
+                break;
+            }
+        }
+        Stmt body = Block::make(k1.body, rewrap(lets_of_k2, body2));
+        Stmt result = rewrap(k1.wrappers, body);
+        for (size_t i = k1.host_lets.size(); i > 0; i--) {
+            result = LetStmt::make(k1.host_lets[i-1].first, k1.host_lets[i-1].second, result);
+        }
+        return result;
+    }
+};
+
+}  // namespace
+
+Stmt fuse_gpu_kernels(Stmt s) {
+    return FuseGPUKernels().mutate(s);
+}
+
+}
+}
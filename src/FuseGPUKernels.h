@@ -0,0 +1,29 @@
+#ifndef HALIDE_FUSE_GPU_KERNELS_H
+#define HALIDE_FUSE_GPU_KERNELS_H
+
+/** \file
+ * Defines the lowering pass that merges consecutive GPU kernel
+ * launches into one.
+ */
+
+#include "IR.h"
+
+namespace Halide {
+namespace Internal {
+
+/** Find GPU kernels (nests of gpu block and thread loops) that
+ * immediately follow each other, such as those of consecutive
+ * compute_root stages tiled the same way, and merge them into a
+ * single launch when that is safe without any synchronization: the
+ * loop nests must have the same geometry, and every value the second
+ * kernel loads from a buffer the first one stores to must be one that
+ * the same thread stored. This saves a launch, and the second kernel
+ * is likely to find its inputs in cache. Should be run after storage
+ * flattening and selecting a GPU API, and before injecting host <->
+ * device buffer copies. */
+Stmt fuse_gpu_kernels(Stmt s);
+
+}
+}
+
+#endif
@@ -551,6 +551,15 @@ public:
             sentinel.size = 0;
             mem_allocs.push_back(AllocGroup(sentinel));
 
+            // Work out the total size as an expression too, mirroring
+            // the offsets below.
+            shared_bytes = 0;
+            for (size_t i = 1; i < mem_allocs.size(); i++) {
+                int new_elem_size = mem_allocs[i].max_type_bytes;
+                shared_bytes += (((mem_allocs[i-1].max_size_bytes + new_elem_size - 1)/new_elem_size)*new_elem_size);
+            }
+            shared_bytes = simplify(shared_bytes);
+
             // Add a dummy allocation at the end to get the total size
             Expr total_size = Variable::make(Int(32), "group_" + std::to_string(mem_allocs.size()-1) + ".shared_offset");
             s = Allocate::make(shared_mem_name, UInt(8), {total_size}, const_true(), s);
@@ -580,9 +589,77 @@ public:
         return s;
     }
 
+    // The number of bytes of shared memory used per block, once
+    // rewrap has been called.
+    Expr shared_bytes = 0;
+
     ExtractSharedAllocations(DeviceAPI d) : in_threads(false), barrier_stage(0), device_api(d) {}
 };
 
+// Warn if the shared memory a kernel uses per block limits the
+// number of blocks that can run at once on one multiprocessor, so that
+// the fraction of the multiprocessor's warps in use (its occupancy)
+// falls below HL_GPU_MIN_OCCUPANCY (0.5 if unset). With few warps,
+// there's little other work to hide memory latency behind. Only done
+// for CUDA, for which the limits of each compute capability are
+// known, and only when the sizes are constant.
+void check_occupancy(const string &kernel, const ExtractBlockSize &block_size,
+                     Expr shared_bytes, const Target &target) {
+    int64_t threads = 1;
+    for (int i = 0; i < block_size.dimensions(); i++) {
+        const int64_t *e = as_const_int(simplify(block_size.extent(i)));
+        if (!e) {
+            return;
+        }
+        threads *= *e;
+    }
+    const int64_t *bytes = as_const_int(simplify(shared_bytes));
+    if (!bytes || *bytes <= 0) {
+        return;
+    }
+
+    // Shared memory, threads, and blocks per multiprocessor, and
+    // shared memory per block.
+    int64_t sm_shared = 48 * 1024, sm_threads = 1536, sm_blocks = 8, block_shared = 48 * 1024;
+    string arch = "sm_20";
+    if (target.has_feature(Target::CUDACapability70)) {
+        sm_shared = 96 * 1024, sm_threads = 2048, sm_blocks = 32, arch = "sm_70";
+    } else if (target.has_feature(Target::CUDACapability61)) {
+        sm_shared = 96 * 1024, sm_threads = 2048, sm_blocks = 32, arch = "sm_61";
+    } else if (target.has_feature(Target::CUDACapability50)) {
+        sm_shared = 64 * 1024, sm_threads = 2048, sm_blocks = 32, arch = "sm_50";
+    } else if (target.features_any_of({Target::CUDACapability30,
+                                       Target::CUDACapability32,
+                                       Target::CUDACapability35})) {
+        sm_threads = 2048, sm_blocks = 16, arch = "sm_3x";
+    }
+
+    if (*bytes > block_shared) {
+        user_warning << "Kernel " << kernel << " uses " << *bytes << " bytes of shared memory per block, "
+                     << "but at most " << block_shared << " are available on " << arch
+                     << ". It will fail to launch.\n";
+        return;
+    }
+
+    double min_occupancy = 0.5;
+    string env = get_env_variable("HL_GPU_MIN_OCCUPANCY");
+    if (!env.empty()) {
+        min_occupancy = std::atof(env.c_str());
+    }
+
+    int64_t warps = (threads + 31) / 32;
+    int64_t blocks_by_threads = std::min(sm_blocks, sm_threads / (warps * 32));
+    int64_t blocks = std::min(blocks_by_threads, sm_shared / *bytes);
+    double occupancy = (double)(blocks * warps * 32) / sm_threads;
+    if (blocks < blocks_by_threads && occupancy < min_occupancy) {
+        user_warning << "Kernel " << kernel << " uses " << *bytes << " bytes of shared memory per block of "
+                     << threads << " threads, so only " << blocks << " blocks fit on a multiprocessor on "
+                     << arch << ", for an occupancy of " << (int)(occupancy * 100) << "%. "
+                     << "Using less shared memory per block would allow up to " << blocks_by_threads
+                     << " blocks.\n";
+    }
+}
+
 class FuseGPUThreadLoopsSingleKernel : public IRMutator {
     using IRMutator::visit;
     const ExtractBlockSize &block_size;
@@ -647,6 +724,8 @@ public:
 class FuseGPUThreadLoops : public IRMutator {
     using IRMutator::visit;
 
+    const Target &target;
+
     void visit(const For *op) {
         if (op->device_api == DeviceAPI::GLSL) {
             stmt = op;
@@ -674,10 +753,17 @@ class FuseGPUThreadLoops : public IRMutator {
 
             // Mutate the inside of the kernel
             stmt = FuseGPUThreadLoopsSingleKernel(block_size, shared_mem).mutate(loop);
+
+            if (op->device_api == DeviceAPI::CUDA) {
+                check_occupancy(op->name, block_size, shared_mem.shared_bytes, target);
+            }
         } else {
             IRMutator::visit(op);
         }
     }
+
+public:
+    FuseGPUThreadLoops(const Target &t) : target(t) {}
 };
 
 class ZeroGPULoopMins : public IRMutator {
@@ -755,10 +841,10 @@ Stmt zero_gpu_loop_mins(Stmt s) {
     return ZeroGPULoopMins().mutate(s);
 }
 
-Stmt fuse_gpu_thread_loops(Stmt s) {
+Stmt fuse_gpu_thread_loops(Stmt s, const Target &t) {
     ValidateGPULoopNesting validate;
     s.accept(&validate);
-    s = FuseGPUThreadLoops().mutate(s);
+    s = FuseGPUThreadLoops(t).mutate(s);
     s = ZeroGPULoopMins().mutate(s);
     return s;
 }
@@ -7,6 +7,7 @@
  */
 
 #include "IR.h"
+#include "Target.h"
 
 namespace Halide {
 namespace Internal {
@@ -19,8 +20,9 @@ Stmt zero_gpu_loop_mins(Stmt s);
  * indices into a single loop (with predication to turn off
  * threads). Also injects synchronization points as needed, and hoists
  * allocations at the block level out into a single shared memory
- * array. */
-Stmt fuse_gpu_thread_loops(Stmt s);
+ * array. Warns if a CUDA kernel uses enough shared memory to limit
+ * its occupancy. */
+Stmt fuse_gpu_thread_loops(Stmt s, const Target &t);
 
 }
 }
@@ -0,0 +1,325 @@
+#include "FuseLoops.h"
+#include "FindCalls.h"
+#include "Func.h"
+#include "Function.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::pair;
+using std::set;
+using std::string;
+using std::vector;
+
+namespace {
+
+class FindProducers : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const ProducerConsumer *op) {
+        if (op->is_producer) {
+            producers.insert(op->name);
+        }
+        IRVisitor::visit(op);
+    }
+
+public:
+    set<string> producers;
+};
+
+// Merge the loop nest of a child Func into the loop nest of its
+// parent, down to some depth.
+class LoopNestFuser {
+    const string &parent_name, &child_name;
+    bool child_first;
+
+    // Strip the lets and ifs off the top of a statement, and return
+    // the loop underneath them.
+    const For *peel(Stmt s, vector<pair<string, Expr>> &lets, vector<Expr> &conditions) {
+        while (true) {
+            if (const LetStmt *let = s.as<LetStmt>()) {
+                lets.push_back({let->name, let->value});
+                s = let->body;
+            } else if (const IfThenElse *if_else = s.as<IfThenElse>()) {
+                if (if_else->else_case.defined()) {
+                    return nullptr;
+                }
+                conditions.push_back(if_else->condition);
+                s = if_else->then_case;
+            } else {
+                return s.as<For>();
+            }
+        }
+    }
+
+    Stmt guard(Stmt s, const vector<Expr> &conditions) {
+        for (size_t i = conditions.size(); i > 0; i--) {
+            s = IfThenElse::make(conditions[i-1], s);
+        }
+        return s;
+    }
+
+public:
+    LoopNestFuser(const string &parent_name, const string &child_name, bool child_first)
+        : parent_name(parent_name), child_name(child_name), child_first(child_first) {}
+
+    Stmt fuse(Stmt parent, Stmt child, int depth,
+              vector<Expr> parent_conditions, vector<Expr> child_conditions) {
+        if (depth == 0) {
+            parent = guard(parent, parent_conditions);
+            child = guard(child, child_conditions);
+            return child_first ? Block::make(child, parent) : Block::make(parent, child);
+        }
+
+        // The lets are pure, and don't depend on the loop below them,
+        // so they can all go outside the fused loop. The ifs only
+        // apply to one of the Funcs, so they move to its innermost
+        // body instead.
+        vector<pair<string, Expr>> lets;
+        const For *parent_loop = peel(parent, lets, parent_conditions);
+        const For *child_loop = peel(child, lets, child_conditions);
+        user_assert(parent_loop && child_loop)
+            << "Can't compute " << child_name << " with " << parent_name
+            << ", because other Funcs are computed inside the loops being fused.\n";
+        user_assert(parent_loop->for_type == child_loop->for_type &&
+                    parent_loop->device_api == child_loop->device_api)
+            << "Can't compute " << child_name << " with " << parent_name
+            << ", because the loops " << child_loop->name << " and " << parent_loop->name
+            << " have different types.\n";
+        user_assert(parent_loop->for_type == ForType::Serial ||
+                    parent_loop->for_type == ForType::Parallel)
+            << "Can't compute " << child_name << " with " << parent_name
+            << ", because the loops " << child_loop->name << " and " << parent_loop->name
+            << " are neither serial nor parallel.\n";
+
+        // The fused loop covers the iterations of both.
+        Expr var = Variable::make(Int(32), parent_loop->name);
+        Expr parent_end = parent_loop->min + parent_loop->extent;
+        Expr child_end = child_loop->min + child_loop->extent;
+        Expr min = Halide::min(parent_loop->min, child_loop->min);
+        Expr extent = Halide::max(parent_end, child_end) - min;
+        // Bounds inference only trims the range of a loop variable
+        // with an if over a single comparison, so guard each end of
+        // the range separately.
+        parent_conditions.push_back(var >= parent_loop->min);
+        parent_conditions.push_back(var < parent_end);
+        child_conditions.push_back(var >= child_loop->min);
+        child_conditions.push_back(var < child_end);
+
+        Stmt child_body = LetStmt::make(child_loop->name, var, child_loop->body);
+        Stmt body = fuse(parent_loop->body, child_body, depth - 1,
+                         parent_conditions, child_conditions);
+        Stmt stmt = For::make(parent_loop->name, min, extent,
+                              parent_loop->for_type, parent_loop->device_api, body);
+
+        for (size_t i = lets.size(); i > 0; i--) {
+            stmt = LetStmt::make(lets[i-1].first, lets[i-1].second, stmt);
+        }
+        return stmt;
+    }
+};
+
+// Whether a dim of a stage is the loop over the given var. The dims
+// made by splits are named after the var they came from too.
+bool is_loop_over(const Dim &dim, const string &var) {
+    return dim.var == var || ends_with(dim.var, "." + var);
+}
+
+// The Func whose loops are fused with the given one's, if any.
+string fused_with(const string &name, const map<string, Function> &env) {
+    for (const auto &iter : env) {
+        const LoopLevel &level = iter.second.schedule().compute_with_level();
+        if (iter.first == name && level.defined()) {
+            return level.func();
+        } else if (level.defined() && level.func() == name) {
+            return iter.first;
+        }
+    }
+    return "";
+}
+
+class FuseLoops : public IRMutator {
+    const map<string, Function> &env;
+
+    using IRMutator::visit;
+
+    void visit(const Block *op) {
+        Stmt first = mutate(op->first);
+        Stmt rest = mutate(op->rest);
+
+        // Funcs computed at the same site appear as a produce node,
+        // followed by a consume node holding the produce node of the
+        // next Func in the realization order, possibly under its
+        // bounds and its realization.
+        const ProducerConsumer *produce_a = first.as<ProducerConsumer>();
+        string b_name = produce_a && produce_a->is_producer ? fused_with(produce_a->name, env) : "";
+        if (b_name.empty() || !rest.defined()) {
+            if (first.same_as(op->first) && rest.same_as(op->rest)) {
+                stmt = op;
+            } else {
+                stmt = Block::make(first, rest);
+            }
+            return;
+        }
+        const string &a_name = produce_a->name;
+
+        Stmt s = rest;
+        const ProducerConsumer *consume_a = s.as<ProducerConsumer>();
+        if (consume_a && !consume_a->is_producer && consume_a->name == a_name) {
+            s = consume_a->body;
+        } else {
+            // Outputs have no consume nodes.
+            consume_a = nullptr;
+        }
+
+        vector<Stmt> wrappers;
+        while (true) {
+            if (const LetStmt *let = s.as<LetStmt>()) {
+                wrappers.push_back(s);
+                s = let->body;
+            } else if (const Realize *realize = s.as<Realize>()) {
+                wrappers.push_back(s);
+                s = realize->body;
+            } else {
+                break;
+            }
+        }
+
+        const ProducerConsumer *produce_b = s.as<ProducerConsumer>();
+        Stmt b_rest;
+        if (const Block *block = s.as<Block>()) {
+            produce_b = block->first.as<ProducerConsumer>();
+            b_rest = block->rest;
+        }
+        if (!produce_b || !produce_b->is_producer || produce_b->name != b_name) {
+            // Not adjacent. This gets reported below.
+            stmt = Block::make(first, rest);
+            return;
+        }
+
+        bool a_is_child = env.find(a_name)->second.schedule().compute_with_level().defined();
+        const string &child_name = a_is_child ? a_name : b_name;
+        const string &parent_name = a_is_child ? b_name : a_name;
+        Function parent = env.find(parent_name)->second;
+        const LoopLevel &level = env.find(child_name)->second.schedule().compute_with_level();
+
+        // Fuse the loops from the outermost one (the one over
+        // __outermost) down to the one over the given var.
+        const vector<Dim> &dims = parent.definition().schedule().dims();
+        int depth = 0;
+        for (size_t i = 0; i < dims.size(); i++) {
+            if (is_loop_over(dims[i], level.var().name())) {
+                depth = (int)(dims.size() - i);
+            }
+        }
+        user_assert(depth > 0)
+            << "Can't compute " << child_name << " with " << parent_name
+            << ", because " << parent_name << " has no loop over " << level.var().name() << ".\n";
+
+        LoopNestFuser fuser(parent_name, child_name, a_is_child);
+        Stmt parent_body = a_is_child ? produce_b->body : produce_a->body;
+        Stmt child_body = a_is_child ? produce_a->body : produce_b->body;
+        Stmt fused = fuser.fuse(parent_body, child_body, depth, {}, {});
+        fused = ProducerConsumer::make_produce(a_name, ProducerConsumer::make_produce(b_name, fused));
+
+        if (consume_a && b_rest.defined()) {
+            b_rest = ProducerConsumer::make_consume(a_name, b_rest);
+        }
+        stmt = b_rest.defined() ? Block::make(fused, b_rest) : fused;
+
+        // The bounds and storage of b can move outside of a, because a
+        // doesn't use b.
+        for (size_t i = wrappers.size(); i > 0; i--) {
+            if (const LetStmt *let = wrappers[i-1].as<LetStmt>()) {
+                stmt = LetStmt::make(let->name, let->value, stmt);
+            } else {
+                const Realize *realize = wrappers[i-1].as<Realize>();
+                stmt = Realize::make(realize->name, realize->types, realize->bounds,
+                                     realize->condition, stmt);
+            }
+        }
+
+        fused_funcs.insert(child_name);
+    }
+
+public:
+    set<string> fused_funcs;
+
+    FuseLoops(const map<string, Function> &env) : env(env) {}
+};
+
+}  // namespace
+
+bool is_fused_loop(const string &loop, const Function &parent, const Function &child) {
+    const LoopLevel &level = child.schedule().compute_with_level();
+    if (!level.defined() || level.func() != parent.name()) {
+        return false;
+    }
+    // The fused loops are the loop over the var, and the ones
+    // outside of it.
+    const vector<Dim> &dims = parent.definition().schedule().dims();
+    string prefix = parent.name() + ".s0.";
+    bool fused = false;
+    for (const Dim &dim : dims) {
+        fused = fused || is_loop_over(dim, level.var().name());
+        if (fused && loop == prefix + dim.var) {
+            return true;
+        }
+    }
+    return false;
+}
+
+Stmt fuse_loops(Stmt s, const Function &f, const map<string, Function> &env) {
+    string other = fused_with(f.name(), env);
+    if (other.empty()) {
+        return s;
+    }
+
+    bool f_is_child = f.schedule().compute_with_level().defined();
+    const string &child_name = f_is_child ? f.name() : other;
+    const string &parent_name = f_is_child ? other : f.name();
+    auto parent_iter = env.find(parent_name);
+    user_assert(parent_iter != env.end())
+        << "Can't compute " << child_name << " with " << parent_name
+        << ", because " << parent_name << " is not used in this pipeline.\n";
+    const Function &child = env.find(child_name)->second;
+    const Function &parent = parent_iter->second;
+
+    for (const Function &g : {child, parent}) {
+        user_assert(!g.has_update_definition() &&
+                    !g.has_extern_definition() &&
+                    g.definition().specializations().empty())
+            << "Can't compute " << child.name() << " with " << parent.name()
+            << ", because " << g.name() << " has an update or extern definition, "
+            << "or specializations.\n";
+    }
+    user_assert(child.schedule().compute_level() == parent.schedule().compute_level() &&
+                !child.schedule().compute_level().is_inline())
+        << "Can't compute " << child.name() << " with " << parent.name()
+        << ", because they aren't computed at the same loop level.\n";
+    user_assert(!find_transitive_calls(child).count(parent.name()) &&
+                !find_transitive_calls(parent).count(child.name()))
+        << "Can't compute " << child.name() << " with " << parent.name()
+        << ", because one of them depends on the other.\n";
+
+    // Wait until both have been injected.
+    FindProducers producers;
+    s.accept(&producers);
+    if (!producers.producers.count(other)) {
+        return s;
+    }
+
+    FuseLoops fuser(env);
+    s = fuser.mutate(s);
+    user_assert(fuser.fused_funcs.count(child_name))
+        << "Can't compute " << child_name << " with " << parent_name
+        << ", because other Funcs are computed between them.\n";
+
+    return s;
+}
+
+}
+}
@@ -0,0 +1,33 @@
+#ifndef HALIDE_FUSE_LOOPS_H
+#define HALIDE_FUSE_LOOPS_H
+
+/** \file
+ * Defines the lowering pass that fuses the loop nests of Funcs
+ * scheduled with Func::compute_with.
+ */
+
+#include <map>
+
+#include "IR.h"
+
+namespace Halide {
+namespace Internal {
+
+/** Once the realizations of both f and the Func it is scheduled to be
+ * computed with have been injected, merge their loop nests into one,
+ * down to the requested loop level. The fused loops cover the union
+ * of the regions of the two Funcs, and the body of each is guarded so
+ * that it only computes its own region. Called as each realization
+ * is injected, so that the Funcs computed at the fused loops are
+ * injected into the merged loop nest, and computed once for both. */
+Stmt fuse_loops(Stmt s, const Function &f, const std::map<std::string, Function> &env);
+
+/** Check if the given loop of parent is one of the loops the loop
+ * nest of child is merged into, because child is scheduled to be
+ * computed with parent. */
+bool is_fused_loop(const std::string &loop, const Function &parent, const Function &child);
+
+}
+}
+
+#endif
@@ -1,10 +1,14 @@
+#include <cctype>
 #include <cmath>
 #include <fstream>
 #include <set>
+#include <sstream>
 
 #include "Generator.h"
 #include "Outputs.h"
 #include "Simplify.h"
+#include "ThreadPool.h"
+#include "WrapExternStages.h"
 
 namespace Halide {
 namespace Internal {
@@ -86,6 +90,9 @@ Outputs compute_outputs(const Target &target,
     if (options.emit_stmt_html) {
         output_files.stmt_html_name = base_path + get_extension(".html", options);
     }
+    if (options.emit_memory_report) {
+        output_files.memory_report_name = base_path + get_extension(".memory.json", options);
+    }
     if (options.emit_static_library) {
         if (is_windows_coff) {
             output_files.static_library_name = base_path + get_extension(".lib", options);
@@ -128,6 +135,272 @@ Func make_param_func(const Parameter &p, const std::string &name) {
     return f;
 }
 
+// Move the entry point of a module lowered without checks (or with
+// another schedule) into the module holding the regular entry point,
+// so that both end up in the same object file and header. The moved
+// entry point gets plain External linkage: callers reach it directly,
+// never via argv.
+void append_trusted_entry_point(Module dst, const Module &trusted) {
+    for (const auto &b : trusted.buffers()) {
+        dst.append(b);
+    }
+    for (const auto &m : trusted.submodules()) {
+        dst.append(m);
+    }
+    bool found = false;
+    for (LoweredFunc f : trusted.functions()) {
+        if (f.name == trusted.name()) {
+            if (found) {
+                // This is the legacy buffer_t wrapper, which only
+                // exists to serve old callers.
+                continue;
+            }
+            found = true;
+            f.linkage = LoweredFunc::External;
+        } else if (f.name == trusted.name() + "_old_buffer_t") {
+            continue;
+        }
+        dst.append(f);
+    }
+    internal_assert(found) << "No function named " << trusted.name() << " in trusted module\n";
+}
+
+// Make a function that calls the given entry point once per set of
+// arguments. Each argument of the entry point becomes a pointer to an
+// array of count such arguments (so an array of halide_buffer_t
+// pointers for each buffer), except for the user context, which is
+// passed through to every call. Returns the first error. If parallel
+// is true, the calls are spread across the thread pool, which is
+// worthwhile when each one is too small to use it well by itself.
+LoweredFunc make_batch_entry_point(const LoweredFunc &callee, const std::string &name,
+                                   const Target &target, bool parallel) {
+    const std::string count_name = "__batch_count";
+    const std::string index_name = name + ".i";
+    Expr index = Variable::make(Int(32), index_name);
+
+    std::vector<LoweredArgument> args;
+    std::vector<Expr> call_args;
+    args.emplace_back(count_name, Argument::InputScalar, Int(32), 0);
+    for (const LoweredArgument &arg : callee.args) {
+        if (arg.name == "__user_context") {
+            args.push_back(arg);
+            call_args.push_back(Variable::make(arg.type, arg.name));
+            continue;
+        }
+        args.emplace_back(arg.name, Argument::InputScalar, Handle(), 0);
+        if (arg.is_buffer()) {
+            call_args.push_back(Load::make(type_of<struct halide_buffer_t *>(), arg.name, index,
+                                           Buffer<>(), Parameter(), const_true()));
+        } else if (arg.type.is_bool()) {
+            // Arrays of bool hold one byte per element.
+            call_args.push_back(Load::make(UInt(8), arg.name, index,
+                                           Buffer<>(), Parameter(), const_true()) != 0);
+        } else {
+            call_args.push_back(Load::make(arg.type, arg.name, index,
+                                           Buffer<>(), Parameter(), const_true()));
+        }
+    }
+
+    Call::CallType call_type = Call::Extern;
+    if (callee.name_mangling == NameMangling::CPlusPlus ||
+        (callee.name_mangling == NameMangling::Default &&
+         target.has_feature(Target::CPlusPlusMangling))) {
+        call_type = Call::ExternCPlusPlus;
+    }
+    const std::string result_name = name + ".result";
+    Expr result = Variable::make(Int(32), result_name);
+    Stmt body = AssertStmt::make(result == 0, result);
+    body = LetStmt::make(result_name, Call::make(Int(32), callee.name, call_args, call_type), body);
+    body = For::make(index_name, 0, Variable::make(Int(32), count_name),
+                     parallel ? ForType::Parallel : ForType::Serial, DeviceAPI::None, body);
+    return LoweredFunc(name, args, body, LoweredFunc::External, callee.name_mangling);
+}
+
+// One of the schedules given with -v.
+struct ScheduleVariant {
+    std::string name;
+    // If nonzero, the variant is used for outputs with at least this
+    // many elements (and fewer than the next larger threshold).
+    int64_t min_output_size = 0;
+    std::map<std::string, std::string> params;
+};
+
+// Parse variants of the form name[@min_output_size][:param=value[,param=value...]],
+// separated by slashes.
+bool parse_schedule_variants(const std::string &spec, std::vector<ScheduleVariant> *variants, std::ostream &cerr) {
+    for (const std::string &v : split_string(spec, "/")) {
+        if (v.empty()) {
+            continue;
+        }
+        ScheduleVariant variant;
+        std::string head = v, params;
+        size_t colon = v.find(':');
+        if (colon != std::string::npos) {
+            head = v.substr(0, colon);
+            params = v.substr(colon + 1);
+        }
+        size_t at = head.find('@');
+        if (at != std::string::npos) {
+            std::string size = head.substr(at + 1);
+            char *end = nullptr;
+            variant.min_output_size = strtoll(size.c_str(), &end, 10);
+            if (size.empty() || *end != 0 || variant.min_output_size < 0) {
+                cerr << "Malformed size threshold in -v option: " << v << "\n";
+                return false;
+            }
+            head = head.substr(0, at);
+        }
+        if (head.empty()) {
+            cerr << "Schedule variant without a name in -v option: " << v << "\n";
+            return false;
+        }
+        variant.name = head;
+        for (const std::string &p : split_string(params, ",")) {
+            if (p.empty()) {
+                continue;
+            }
+            std::vector<std::string> kv = split_string(p, "=");
+            if (kv.size() != 2 || kv[0].empty() || kv[1].empty() || kv[0] == "target") {
+                cerr << "Malformed generator param in -v option: " << p << "\n";
+                return false;
+            }
+            variant.params[kv[0]] = kv[1];
+        }
+        for (const ScheduleVariant &other : *variants) {
+            if (other.name == variant.name) {
+                cerr << "Duplicate schedule variant: " << variant.name << "\n";
+                return false;
+            }
+        }
+        variants->push_back(variant);
+    }
+    return true;
+}
+
+// Make the entry point that dispatches to one of the given schedule
+// variants of a pipeline, which must all take the same arguments. If
+// any variant has a size threshold, the choice is made on each call
+// from the number of elements of the first output. Otherwise the
+// runtime times each variant once, and the fastest is used from then
+// on. Bounds queries always go to the first variant.
+LoweredFunc make_schedule_variant_selector(const std::string &name, const std::vector<LoweredFunc> &callees,
+                                           const std::vector<ScheduleVariant> &variants, const Target &target) {
+    internal_assert(!callees.empty() && callees.size() == variants.size());
+    const std::vector<LoweredArgument> &args = callees[0].args;
+    for (const LoweredFunc &f : callees) {
+        bool same = f.args.size() == args.size();
+        for (size_t i = 0; same && i < args.size(); i++) {
+            same = (f.args[i].name == args[i].name &&
+                    f.args[i].kind == args[i].kind &&
+                    f.args[i].type == args[i].type &&
+                    f.args[i].dimensions == args[i].dimensions);
+        }
+        user_assert(same) << "Schedule variant " << f.name << " does not take the same arguments as "
+                          << callees[0].name << "\n";
+    }
+
+    std::vector<Expr> call_args, buffers;
+    std::vector<std::string> buffer_names;
+    Expr output;
+    int output_dims = 0;
+    for (const LoweredArgument &arg : args) {
+        if (arg.is_buffer()) {
+            Expr buf = Variable::make(type_of<struct halide_buffer_t *>(), arg.name + ".buffer");
+            call_args.push_back(buf);
+            buffers.push_back(buf);
+            buffer_names.push_back(arg.name);
+            if (!output.defined() && arg.is_output()) {
+                output = buf;
+                output_dims = arg.dimensions;
+            }
+        } else {
+            call_args.push_back(Variable::make(arg.type, arg.name));
+        }
+    }
+
+    Call::CallType call_type = Call::Extern;
+    if (callees[0].name_mangling == NameMangling::CPlusPlus ||
+        (callees[0].name_mangling == NameMangling::Default &&
+         target.has_feature(Target::CPlusPlusMangling))) {
+        call_type = Call::ExternCPlusPlus;
+    }
+    const std::string result_name = name + ".result";
+    Expr result = Variable::make(Int(32), result_name);
+    auto call_variant = [&](int i, Stmt after) {
+        Stmt s = AssertStmt::make(result == 0, result);
+        if (after.defined()) {
+            s = Block::make(after, s);
+        }
+        return LetStmt::make(result_name, Call::make(Int(32), callees[i].name, call_args, call_type), s);
+    };
+
+    bool thresholds = false;
+    for (const ScheduleVariant &v : variants) {
+        thresholds = thresholds || v.min_output_size > 0;
+    }
+
+    Stmt body;
+    if (thresholds) {
+        user_assert(output.defined()) << "Schedule variants selected by size need an output buffer\n";
+        std::vector<int> order;
+        int unbounded = 0;
+        for (size_t i = 0; i < variants.size(); i++) {
+            order.push_back((int)i);
+            unbounded += variants[i].min_output_size == 0;
+        }
+        user_assert(unbounded <= 1) << "At most one schedule variant may be used without a size threshold\n";
+        std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+            return variants[a].min_output_size < variants[b].min_output_size;
+        });
+        const std::string size_name = name + ".output_size";
+        Expr size = Variable::make(Int(64), size_name);
+        // The variant with the smallest threshold also handles
+        // anything smaller than it.
+        body = call_variant(order[0], Stmt());
+        for (size_t k = 1; k < order.size(); k++) {
+            body = IfThenElse::make(size >= make_const(Int(64), variants[order[k]].min_output_size),
+                                    call_variant(order[k], Stmt()), body);
+        }
+        Expr output_size = make_one(Int(64));
+        for (int d = 0; d < output_dims; d++) {
+            output_size *= cast<int64_t>(Call::make(Int(32), Call::buffer_get_extent,
+                                                    {output, d}, Call::Extern));
+        }
+        body = LetStmt::make(size_name, output_size, body);
+    } else {
+        const std::string token_name = name + ".variant_token";
+        Expr token = Variable::make(Int(32), token_name);
+        Expr n = (int)callees.size();
+        Expr variant = token % n;
+        Stmt end = Evaluate::make(Call::make(Int(32), "halide_schedule_variant_end",
+                                             {name, token, result}, Call::Extern));
+        body = call_variant((int)callees.size() - 1, end);
+        for (int i = (int)callees.size() - 2; i >= 0; i--) {
+            body = IfThenElse::make(variant == i, call_variant(i, end), body);
+        }
+        body = LetStmt::make(token_name, Call::make(Int(32), "halide_schedule_variant_begin",
+                                                    {name, n}, Call::Extern), body);
+    }
+
+    Expr bounds_query = const_false();
+    for (Expr buf : buffers) {
+        bounds_query = bounds_query || Call::make(Bool(), Call::buffer_is_bounds_query, {buf}, Call::Extern);
+    }
+    if (!buffers.empty()) {
+        body = IfThenElse::make(bounds_query, call_variant(0, Stmt()), body);
+    }
+
+    // The variants check their own arguments, but the code above
+    // reads the buffers first.
+    for (size_t i = 0; i < buffers.size(); i++) {
+        Expr error = Call::make(Int(32), "halide_error_buffer_argument_is_null",
+                                {buffer_names[i]}, Call::Extern);
+        body = Block::make(AssertStmt::make(reinterpret<uint64_t>(buffers[i]) != 0, error), body);
+    }
+
+    return LoweredFunc(name, args, body, LoweredFunc::ExternalPlusMetadata, callees[0].name_mangling);
+}
+
 }  // namespace
 
 std::vector<Type> parse_halide_type_list(const std::string &types) {
@@ -692,13 +965,104 @@ const std::map<std::string, LoopLevel> &get_halide_looplevel_enum_map() {
     return halide_looplevel_enum_map;
 }
 
+namespace {
+
+// Run generate_filter_main once for each line of a manifest, with up
+// to num_jobs lines being compiled at once. Each line holds the
+// arguments for one invocation, separated by whitespace. Empty lines
+// and lines starting with # are ignored.
+int generate_filter_manifest(const char *program_name, const std::string &manifest,
+                             size_t num_jobs, std::ostream &cerr) {
+    std::ifstream f(manifest);
+    if (!f.is_open()) {
+        cerr << "Unable to open manifest: " << manifest << "\n";
+        return 1;
+    }
+
+    struct Job {
+        int line;
+        std::vector<std::string> args;
+        std::ostringstream errors;
+    };
+    std::vector<std::unique_ptr<Job>> jobs;
+    std::string line;
+    for (int line_number = 1; std::getline(f, line); line_number++) {
+        std::istringstream words(line);
+        std::unique_ptr<Job> job(new Job);
+        job->line = line_number;
+        job->args.push_back(program_name);
+        std::string word;
+        while (words >> word) {
+            job->args.push_back(word);
+        }
+        if (job->args.size() == 1 || job->args[1][0] == '#') {
+            continue;
+        }
+        for (const std::string &arg : job->args) {
+            if (arg == "-m" || arg == "-j") {
+                cerr << manifest << ":" << line_number << ": " << arg << " may not be used in a manifest\n";
+                return 1;
+            }
+        }
+        jobs.emplace_back(std::move(job));
+    }
+
+    // Each invocation makes its own Generators, so they can run at
+    // the same time, as compile_multitarget already does for the
+    // targets of a single one.
+    ThreadPool<int> pool(std::max((size_t)1, std::min(num_jobs, jobs.size())));
+    std::vector<std::future<int>> results;
+    for (auto &job : jobs) {
+        results.emplace_back(pool.async([](Job *job) {
+            std::vector<char *> argv;
+            for (std::string &arg : job->args) {
+                argv.push_back(&arg[0]);
+            }
+            argv.push_back(nullptr);
+            return generate_filter_main((int)job->args.size(), argv.data(), job->errors);
+        }, job.get()));
+    }
+
+    int result = 0;
+    for (size_t i = 0; i < jobs.size(); i++) {
+        int r = results[i].get();
+        std::string errors = jobs[i]->errors.str();
+        if (!errors.empty()) {
+            cerr << manifest << ":" << jobs[i]->line << ":\n" << errors;
+        }
+        if (r != 0 && result == 0) {
+            result = r;
+        }
+    }
+    return result;
+}
+
+}  // namespace
+
 int generate_filter_main(int argc, char **argv, std::ostream &cerr) {
-    const char kUsage[] = "gengen [-g GENERATOR_NAME] [-f FUNCTION_NAME] [-o OUTPUT_DIR] [-r RUNTIME_NAME] [-e EMIT_OPTIONS] [-x EXTENSION_OPTIONS] [-n FILE_BASE_NAME] "
+    const char kUsage[] = "gengen [-m MANIFEST [-j JOBS]] [-g GENERATOR_NAME] [-f FUNCTION_NAME] [-o OUTPUT_DIR] [-r RUNTIME_NAME] [-e EMIT_OPTIONS] [-x EXTENSION_OPTIONS] [-n FILE_BASE_NAME] [-t ENTRY_POINTS] [-v SCHEDULE_VARIANTS] "
                           "target=target-string[,target-string...] [generator_arg=value [...]]\n\n"
                           "  -e  A comma separated list of files to emit. Accepted values are "
-                          "[assembly, bitcode, cpp, h, html, o, static_library, stmt, cpp_stub]. If omitted, default value is [static_library, h].\n"
+                          "[assembly, bitcode, cpp, h, html, o, static_library, stmt, cpp_stub, schedule, memory_report]. If omitted, default value is [static_library, h].\n"
                           "  -x  A comma separated list of file extension pairs to substitute during file naming, "
-                          "in the form [.old=.new[,.old2=.new2]]\n";
+                          "in the form [.old=.new[,.old2=.new2]]\n"
+                          "  -t  A comma separated list of extra entry points to emit alongside FUNCTION_NAME. Accepted values are "
+                          "[trusted, batch, parallel_batch]. FUNCTION_NAME_trusted is compiled without the checks on its arguments and without "
+                          "bounds query support, so the caller must pass valid buffers of sufficient size. FUNCTION_NAME_batch "
+                          "takes a count and, for each argument, a pointer to an array of that many arguments, and calls "
+                          "FUNCTION_NAME_trusted (or FUNCTION_NAME, if trusted is not requested) on each set in turn. "
+                          "parallel_batch emits the same FUNCTION_NAME_batch, but makes the calls in parallel. "
+                          "Not supported with multiple targets or with -x.\n"
+                          "  -v  A slash separated list of schedule variants to compile into FUNCTION_NAME, "
+                          "in the form [name[@min_size][:param=value[,param=value...]][/...]]. Each variant is the generator with "
+                          "the given generator params (or schedule params) overriding the ones on the command line, and is emitted as "
+                          "FUNCTION_NAME_name. If any variant has a min_size, FUNCTION_NAME calls the one with the largest "
+                          "min_size no greater than the number of elements of the first output. Otherwise each variant is timed on "
+                          "one call, and the fastest is used for the rest of the process. Not supported with multiple targets, "
+                          "with -x or with -t.\n"
+                          "  -m  A file with the arguments for one invocation per line, which are all compiled in this process. "
+                          "No other arguments may be given with -m.\n"
+                          "  -j  The number of lines of the manifest to compile at once. Defaults to the number of processors.\n";
 
     std::map<std::string, std::string> flags_info = { { "-f", "" },
                                                       { "-g", "" },
@@ -706,7 +1070,11 @@ int generate_filter_main(int argc, char **argv, std::ostream &cerr) {
                                                       { "-e", "" },
                                                       { "-n", "" },
                                                       { "-x", "" },
-                                                      { "-r", "" }};
+                                                      { "-r", "" },
+                                                      { "-t", "" },
+                                                      { "-v", "" },
+                                                      { "-m", "" },
+                                                      { "-j", "" }};
     std::map<std::string, std::string> generator_args;
 
     for (int i = 1; i < argc; ++i) {
@@ -734,6 +1102,26 @@ int generate_filter_main(int argc, char **argv, std::ostream &cerr) {
         return 1;
     }
 
+    if (!flags_info["-m"].empty()) {
+        size_t num_jobs = ThreadPool<int>::num_processors_online();
+        if (!flags_info["-j"].empty()) {
+            num_jobs = (size_t)std::max(atoi(flags_info["-j"].c_str()), 1);
+        }
+        for (const auto &flag : flags_info) {
+            if (flag.first != "-m" && flag.first != "-j" && !flag.second.empty()) {
+                cerr << "-m may not be combined with " << flag.first << "\n";
+                cerr << kUsage;
+                return 1;
+            }
+        }
+        if (!generator_args.empty()) {
+            cerr << "-m may not be combined with generator args\n";
+            cerr << kUsage;
+            return 1;
+        }
+        return generate_filter_manifest(argv[0], flags_info["-m"], num_jobs, cerr);
+    }
+
     std::string runtime_name = flags_info["-r"];
 
     std::vector<std::string> generator_names = GeneratorRegistry::enumerate();
@@ -811,9 +1199,13 @@ int generate_filter_main(int argc, char **argv, std::ostream &cerr) {
                 emit_options.emit_static_library = true;
             } else if (opt == "cpp_stub") {
                 emit_options.emit_cpp_stub = true;
+            } else if (opt == "schedule") {
+                emit_options.emit_schedule = true;
+            } else if (opt == "memory_report") {
+                emit_options.emit_memory_report = true;
             } else if (!opt.empty()) {
                 cerr << "Unrecognized emit option: " << opt
-                     << " not one of [assembly, bitcode, cpp, h, html, o, static_library, stmt, cpp_stub], ignoring.\n";
+                     << " not one of [assembly, bitcode, cpp, h, html, o, static_library, stmt, cpp_stub, schedule, memory_report], ignoring.\n";
             }
         }
     }
@@ -832,6 +1224,21 @@ int generate_filter_main(int argc, char **argv, std::ostream &cerr) {
         emit_options.substitutions[subst_pair[0]] = subst_pair[1];
     }
 
+    bool emit_trusted = false, emit_batch = false, parallel_batch = false;
+    for (const std::string &opt : split_string(flags_info["-t"], ",")) {
+        if (opt == "trusted") {
+            emit_trusted = true;
+        } else if (opt == "batch") {
+            emit_batch = true;
+        } else if (opt == "parallel_batch") {
+            emit_batch = parallel_batch = true;
+        } else if (!opt.empty()) {
+            cerr << "Unrecognized entry point: " << opt << " not one of [trusted, batch, parallel_batch]\n";
+            cerr << kUsage;
+            return 1;
+        }
+    }
+
     const auto target_string = generator_args["target"];
     auto target_strings = split_string(target_string, ",");
     std::vector<Target> targets;
@@ -839,6 +1246,22 @@ int generate_filter_main(int argc, char **argv, std::ostream &cerr) {
         targets.push_back(Target(s));
     }
 
+    if ((emit_trusted || emit_batch) && (targets.size() > 1 || !emit_options.substitutions.empty())) {
+        cerr << "-t is not supported with multiple targets or with -x\n";
+        return 1;
+    }
+
+    std::vector<ScheduleVariant> variants;
+    if (!parse_schedule_variants(flags_info["-v"], &variants, cerr)) {
+        cerr << kUsage;
+        return 1;
+    }
+    if (!variants.empty() && (targets.size() > 1 || !emit_options.substitutions.empty() ||
+                              emit_trusted || emit_batch)) {
+        cerr << "-v is not supported with multiple targets, with -x or with -t\n";
+        return 1;
+    }
+
     if (!runtime_name.empty()) {
         if (targets.size() != 1) {
             cerr << "Only one target allowed here";
@@ -862,22 +1285,80 @@ int generate_filter_main(int argc, char **argv, std::ostream &cerr) {
         // Don't bother with this if we're just emitting a cpp_stub.
         if (!stub_only) {
             Outputs output_files = compute_outputs(targets[0], base_path, emit_options);
-            auto module_producer = [&generator_name, &generator_args]
-                (const std::string &name, const Target &target) -> Module {
+            // Each call creates its own Generator instance, so
+            // compile_multitarget can build all the targets at once.
+            auto module_producer = [&generator_name, &generator_args, &emit_options, &base_path, &targets, &function_name]
+                (const std::string &name, const Target &target,
+                 const std::map<std::string, std::string> &overrides) -> Module {
                     auto sub_generator_args = generator_args;
                     sub_generator_args.erase("target");
+                    for (const auto &o : overrides) {
+                        sub_generator_args[o.first] = o.second;
+                    }
                     // Must re-create each time since each instance will have a different Target.
                     auto gen = GeneratorRegistry::create(generator_name, GeneratorContext(target));
                     gen->set_generator_and_schedule_param_values(sub_generator_args);
-                    return gen->build_module(name);
+                    Module module = gen->build_module(name);
+                    // Only the schedule for the first target, without
+                    // any variant's overrides, is kept.
+                    if (emit_options.emit_schedule && target == targets[0] && overrides.empty()) {
+                        gen->emit_schedule(base_path + get_extension(".schedule.h", emit_options), function_name);
+                    }
+                    return module;
                 };
             if (targets.size() > 1 || !emit_options.substitutions.empty()) {
-                compile_multitarget(function_name, output_files, targets, module_producer, emit_options.substitutions);
+                compile_multitarget(function_name, output_files, targets,
+                                    [&module_producer](const std::string &name, const Target &target) {
+                                        return module_producer(name, target, {});
+                                    },
+                                    emit_options.substitutions,
+                                    /* module_producer_is_reentrant */ true);
+            } else if (!variants.empty()) {
+                // Each variant is compiled under its own name, and a
+                // new entry point with the pipeline's name calls the
+                // one to use.
+                Module module(function_name, targets[0]);
+                std::vector<LoweredFunc> callees;
+                for (const ScheduleVariant &v : variants) {
+                    const std::string name = function_name + "_" + v.name;
+                    Module variant = module_producer(name, targets[0], v.params);
+                    if (callees.empty()) {
+                        // The variants share any external code.
+                        for (const auto &e : variant.external_code()) {
+                            module.append(e);
+                        }
+                    }
+                    append_trusted_entry_point(module, variant);
+                    callees.push_back(module.get_function_by_name(name));
+                }
+                LoweredFunc selector = make_schedule_variant_selector(function_name, callees, variants, targets[0]);
+                module.append(selector);
+                if (!targets[0].has_feature(Target::JIT)) {
+                    add_legacy_wrapper(module, selector);
+                }
+                module.compile(output_files);
             } else {
                 user_assert(emit_options.substitutions.empty()) << "substitutions not supported for single-target";
                 // compile_multitarget() will fail if we request anything but library and/or header,
                 // so defer directly to Module::compile if there is a single target.
-                module_producer(function_name, targets[0]).compile(output_files);
+                Module module = module_producer(function_name, targets[0], {});
+                std::string batch_callee = function_name;
+                if (emit_trusted) {
+                    // The argument checks and bounds query are left out
+                    // when lowering. The module providing the regular
+                    // entry point also provides the runtime.
+                    batch_callee = function_name + "_trusted";
+                    Target trusted_target = targets[0]
+                        .with_feature(Target::NoAsserts)
+                        .with_feature(Target::NoBoundsQuery)
+                        .with_feature(Target::NoRuntime);
+                    append_trusted_entry_point(module, module_producer(batch_callee, trusted_target, {}));
+                }
+                if (emit_batch) {
+                    module.append(make_batch_entry_point(module.get_function_by_name(batch_callee),
+                                                         function_name + "_batch", targets[0], parallel_batch));
+                }
+                module.compile(output_files);
             }
         }
     }
@@ -1313,11 +1794,13 @@ Pipeline GeneratorBase::get_pipeline() {
 }
 
 std::string GeneratorBase::auto_schedule_outputs(const MachineParams &arch_params) {
-    return get_pipeline().auto_schedule(get_target(), arch_params);
+    auto_schedule_result = get_pipeline().auto_schedule(get_target(), arch_params);
+    return auto_schedule_result;
 }
 
 std::string GeneratorBase::auto_schedule_outputs() {
-    return get_pipeline().auto_schedule(get_target());
+    auto_schedule_result = get_pipeline().auto_schedule(get_target());
+    return auto_schedule_result;
 }
 
 Module GeneratorBase::build_module(const std::string &function_name,
@@ -1363,6 +1846,47 @@ void GeneratorBase::emit_cpp_stub(const std::string &stub_file_path) {
     emit.emit();
 }
 
+void GeneratorBase::emit_schedule(const std::string &schedule_file_path,
+                                  const std::string &function_name) {
+    std::vector<std::string> namespaces;
+    std::string simple_name = extract_namespaces(function_name, namespaces);
+    std::string guard = "HALIDE_SCHEDULE_" + simple_name;
+    for (char &c : guard) {
+        c = isalnum(c) ? toupper(c) : '_';
+    }
+
+    if (auto_schedule_result.empty()) {
+        user_warning << "Generator " << generator_registered_name
+                     << " did not call auto_schedule_outputs(); the schedule emitted to "
+                     << schedule_file_path << " is empty.\n";
+    }
+
+    std::ofstream file(schedule_file_path);
+    file << "#ifndef " << guard << "_H\n";
+    file << "#define " << guard << "_H\n\n";
+    file << "// Schedule generated by the Halide auto-scheduler for " << function_name
+         << " (target=" << get_target().to_string() << ").\n";
+    file << "// Call apply_schedule_" << simple_name << "(get_pipeline()) from the schedule()\n";
+    file << "// method of the Generator instead of auto_schedule_outputs() to reuse it.\n\n";
+    file << "#include \"Halide.h\"\n\n";
+    for (const auto &ns : namespaces) {
+        file << "namespace " << ns << " {\n";
+    }
+    file << "\ninline void apply_schedule_" << simple_name << "(::Halide::Pipeline pipeline) {\n";
+    file << "    using namespace ::Halide;\n";
+    for (const std::string &line : split_string(auto_schedule_result, "\n")) {
+        if (!line.empty()) {
+            file << "    " << line;
+        }
+        file << "\n";
+    }
+    file << "}\n\n";
+    for (size_t i = namespaces.size(); i > 0; i--) {
+        file << "}  // namespace " << namespaces[i - 1] << "\n";
+    }
+    file << "\n#endif  // " << guard << "_H\n";
+}
+
 void GeneratorBase::check_scheduled(const char* m) const {
     check_min_phase(ScheduleCalled);
 }
@@ -1667,7 +2191,7 @@ void GeneratorOutputBase::init_internals() {
     funcs_.clear();
     if (array_size_defined()) {
         for (size_t i = 0; i < array_size(); ++i) {
-            funcs_.push_back(Func(array_name(i)));
+            funcs_.push_back(Func(generator->output_func_prefix + array_name(i)));
         }
     }
 }
@@ -1964,4 +2488,161 @@ void generator_test() {
 }
 
 }  // namespace Internal
+
+GeneratorComposition::GeneratorComposition(const GeneratorContext &context,
+                                           const std::string &manifest,
+                                           const std::map<std::string, Func> &funcs,
+                                           const std::map<std::string, Expr> &exprs) {
+    std::istringstream lines(manifest);
+    std::string line;
+    while (std::getline(lines, line)) {
+        line = line.substr(0, line.find('#'));
+        std::istringstream words(line);
+        std::string stage_name, generator_name;
+        if (!(words >> stage_name)) {
+            continue;
+        }
+        user_assert(Internal::is_valid_name(stage_name))
+            << "Invalid stage name in generator manifest: " << stage_name << "\n";
+        user_assert(words >> generator_name)
+            << "Stage " << stage_name << " of the generator manifest names no Generator.\n";
+        for (const Stage &s : stages_) {
+            user_assert(s.name != stage_name)
+                << "Stage " << stage_name << " appears twice in the generator manifest.\n";
+        }
+
+        Stage stage;
+        stage.name = stage_name;
+        stage.generator = Internal::GeneratorRegistry::create(generator_name, context);
+        stage.generator->output_func_prefix = stage_name + "_";
+        Internal::GeneratorBase::ParamInfo &pi = stage.generator->param_info();
+
+        // Settings naming an Input say where it comes from; the rest
+        // are GeneratorParams or ScheduleParams.
+        std::map<std::string, std::string> params, sources;
+        std::string word;
+        while (words >> word) {
+            size_t eq = word.find('=');
+            user_assert(eq != std::string::npos && eq > 0 && eq + 1 < word.size())
+                << "Invalid setting for stage " << stage_name << " in generator manifest: " << word << "\n";
+            std::string key = word.substr(0, eq);
+            bool is_input = false;
+            for (auto *input : pi.filter_inputs) {
+                is_input |= (input->name() == key);
+            }
+            std::map<std::string, std::string> &settings = is_input ? sources : params;
+            user_assert(settings.count(key) == 0)
+                << "Stage " << stage_name << " of the generator manifest sets " << key << " twice.\n";
+            settings[key] = word.substr(eq + 1);
+        }
+        stage.generator->set_generator_and_schedule_param_values(params);
+
+        std::vector<std::vector<Internal::StubInput>> inputs;
+        for (auto *input : pi.filter_inputs) {
+            auto it = sources.find(input->name());
+            user_assert(it != sources.end())
+                << "Stage " << stage_name << " of the generator manifest does not set Input "
+                << input->name() << ".\n";
+            inputs.push_back(resolve_input(stage, *input, it->second, funcs, exprs));
+        }
+        stage.generator->set_inputs_vector(inputs);
+        stage.generator->call_generate();
+        stages_.push_back(stage);
+    }
+    user_assert(!stages_.empty()) << "The generator manifest has no stages.\n";
+}
+
+std::vector<Internal::StubInput> GeneratorComposition::resolve_input(const Stage &stage,
+                                                                     const Internal::GeneratorInputBase &input,
+                                                                     const std::string &value,
+                                                                     const std::map<std::string, Func> &funcs,
+                                                                     const std::map<std::string, Expr> &exprs) const {
+    user_assert(input.kind() != Internal::IOKind::Buffer)
+        << "Input " << input.name() << " of stage " << stage.name
+        << " is an Input<Buffer<>>; only Input<Func> and scalar Inputs can be set by a generator manifest.\n";
+
+    std::vector<Internal::StubInput> result;
+    for (const std::string &v : Internal::split_string(value, ",")) {
+        user_assert(!v.empty())
+            << "Empty value for Input " << input.name() << " of stage " << stage.name << "\n";
+        if (v[0] == '$') {
+            const std::string name = v.substr(1);
+            if (input.kind() == Internal::IOKind::Function) {
+                auto it = funcs.find(name);
+                user_assert(it != funcs.end())
+                    << "No Func named " << name << " was passed for Input " << input.name()
+                    << " of stage " << stage.name << "\n";
+                result.push_back(it->second);
+            } else {
+                auto it = exprs.find(name);
+                user_assert(it != exprs.end())
+                    << "No Expr named " << name << " was passed for Input " << input.name()
+                    << " of stage " << stage.name << "\n";
+                result.push_back(it->second);
+            }
+        } else if (input.kind() == Internal::IOKind::Function) {
+            std::string output;
+            const Stage &source = find_stage(v, output);
+            for (const Func &f : source.generator->get_output_vector(output)) {
+                result.push_back(f);
+            }
+        } else {
+            std::istringstream iss(v);
+            double d;
+            iss >> d;
+            user_assert(!iss.fail() && iss.get() == EOF)
+                << "Unable to parse value " << v << " for Input " << input.name()
+                << " of stage " << stage.name << "\n";
+            result.push_back(Internal::make_const(input.type(), d));
+        }
+    }
+    return result;
+}
+
+const GeneratorComposition::Stage &GeneratorComposition::find_stage(const std::string &name,
+                                                                    std::string &output) const {
+    size_t dot = name.find('.');
+    user_assert(dot != std::string::npos)
+        << "Expected an Output of the form stage.output, but got: " << name << "\n";
+    const std::string stage_name = name.substr(0, dot);
+    output = name.substr(dot + 1);
+    for (const Stage &s : stages_) {
+        if (s.name == stage_name) {
+            bool found = false;
+            for (auto *o : s.generator->param_info().filter_outputs) {
+                found |= (o->name() == output);
+            }
+            user_assert(found) << "Stage " << stage_name << " has no Output named " << output << "\n";
+            return s;
+        }
+    }
+    user_error << "No stage named " << stage_name << " precedes its use in the generator manifest.\n";
+    return stages_.front();
+}
+
+Func GeneratorComposition::get_output(const std::string &name) const {
+    std::string output;
+    return find_stage(name, output).generator->get_output(output);
+}
+
+std::vector<Func> GeneratorComposition::get_output_vector(const std::string &name) const {
+    std::string output;
+    return find_stage(name, output).generator->get_output_vector(output);
+}
+
+GeneratorComposition &GeneratorComposition::schedule() {
+    for (const Stage &s : stages_) {
+        s.generator->call_schedule();
+    }
+    return *this;
+}
+
+std::vector<std::string> GeneratorComposition::stages() const {
+    std::vector<std::string> result;
+    for (const Stage &s : stages_) {
+        result.push_back(s.name);
+    }
+    return result;
+}
+
 }  // namespace Halide
@@ -1355,6 +1355,7 @@ public:
     HALIDE_INPUT_FORWARD_CONST(dim)
     HALIDE_INPUT_FORWARD_CONST(host_alignment)
     HALIDE_INPUT_FORWARD(set_host_alignment)
+    HALIDE_INPUT_FORWARD(trust_constraints)
     HALIDE_INPUT_FORWARD_CONST(dimensions)
     HALIDE_INPUT_FORWARD_CONST(left)
     HALIDE_INPUT_FORWARD_CONST(right)
@@ -2019,6 +2020,8 @@ public:
     HALIDE_OUTPUT_FORWARD_CONST(dim)
     HALIDE_OUTPUT_FORWARD_CONST(host_alignment)
     HALIDE_OUTPUT_FORWARD(set_host_alignment)
+    HALIDE_OUTPUT_FORWARD(trust_constraints)
+    HALIDE_OUTPUT_FORWARD(may_alias)
     HALIDE_OUTPUT_FORWARD_CONST(dimensions)
     HALIDE_OUTPUT_FORWARD_CONST(left)
     HALIDE_OUTPUT_FORWARD_CONST(right)
@@ -2394,6 +2397,8 @@ protected:
     static inline Type UInt(int bits, int lanes = 1) { return Halide::UInt(bits, lanes); }
 };
 
+class GeneratorComposition;
+
 namespace Internal {
 
 template<typename ...Args>
@@ -2417,7 +2422,7 @@ using GeneratorFactory = std::function<std::unique_ptr<GeneratorBase>(const Gene
 class GeneratorBase : public NamesInterface, public GeneratorContext {
 public:
     struct EmitOptions {
-        bool emit_o, emit_h, emit_cpp, emit_assembly, emit_bitcode, emit_stmt, emit_stmt_html, emit_static_library, emit_cpp_stub;
+        bool emit_o, emit_h, emit_cpp, emit_assembly, emit_bitcode, emit_stmt, emit_stmt_html, emit_static_library, emit_cpp_stub, emit_schedule, emit_memory_report;
         // This is an optional map used to replace the default extensions generated for
         // a file: if an key matches an output extension, emit those files with the
         // corresponding value instead (e.g., ".s" -> ".assembly_text"). This is
@@ -2427,7 +2432,8 @@ public:
         std::map<std::string, std::string> substitutions;
         EmitOptions()
             : emit_o(false), emit_h(true), emit_cpp(false), emit_assembly(false),
-              emit_bitcode(false), emit_stmt(false), emit_stmt_html(false), emit_static_library(true), emit_cpp_stub(false) {}
+              emit_bitcode(false), emit_stmt(false), emit_stmt_html(false), emit_static_library(true), emit_cpp_stub(false),
+              emit_schedule(false), emit_memory_report(false) {}
     };
 
     EXPORT virtual ~GeneratorBase();
@@ -2462,6 +2468,21 @@ public:
 
     EXPORT void emit_cpp_stub(const std::string &stub_file_path);
 
+    /** Write the schedule most recently generated by auto_schedule_outputs()
+     * as a header that defines
+     *
+     \code
+     inline void apply_schedule_<function_name>(Halide::Pipeline pipeline);
+     \endcode
+     *
+     * Including the header in the Generator and calling that function from
+     * schedule() (with get_pipeline()) reproduces the schedule without running
+     * the auto-scheduler again. The schedule refers to the Funcs by their
+     * position in the realization order, so it only applies to the same
+     * pipeline. Must be called after build_module(). */
+    EXPORT void emit_schedule(const std::string &schedule_file_path,
+                              const std::string &function_name);
+
     // Call build() and produce a Module for the result.
     // If function_name is empty, generator_name() will be used for the function.
     EXPORT Module build_module(const std::string &function_name = "",
@@ -2576,6 +2597,7 @@ private:
     friend class GeneratorStub;
     friend class SimpleGeneratorFactory;
     friend class StubOutputBufferBase;
+    friend class ::Halide::GeneratorComposition;
 
     struct ParamInfo {
         EXPORT ParamInfo(GeneratorBase *generator, const size_t size);
@@ -2622,6 +2644,13 @@ private:
     std::string generator_registered_name, generator_stub_name;
     Pipeline pipeline;
 
+    // Prepended to the names of the Funcs of our Outputs; set by
+    // GeneratorComposition to keep the stages of a composition apart.
+    std::string output_func_prefix;
+
+    // The schedule generated by the last call to auto_schedule_outputs(), if any.
+    std::string auto_schedule_result;
+
     // Return our ParamInfo (lazy-initing as needed).
     EXPORT ParamInfo &param_info();
 
@@ -3135,6 +3164,102 @@ private:
 
 }  // namespace Internal
 
+/** A GeneratorComposition builds the pipelines of several registered
+ * Generators into the code that creates it, so that the Funcs flowing
+ * from one to the next are never stored in full-size buffers unless
+ * the schedule says so. This is usually a Generator that wraps a chain
+ * of Generators which would otherwise be compiled, and called, one
+ * after the other. The chain is described by a manifest, with one
+ * stage per line:
+ *
+ \code
+ # stage     generator    settings
+ denoise     denoise      input=$raw sigma=2
+ sharpen     sharpen      input=denoise.output amount=1.5
+ \endcode
+ *
+ * Each stage creates the Generator registered under the given name,
+ * and each setting either sets a GeneratorParam or ScheduleParam of
+ * it, or says where one of its Inputs comes from. Every Input must be
+ * set, to one of:
+ *   - "$name", a Func or Expr passed to the GeneratorComposition;
+ *   - "stage.output", an Output of an earlier stage (all of it, for an
+ *     array Output);
+ *   - a number, for scalar Inputs.
+ * Values for array Inputs are separated by commas. Stages can only be
+ * composed through Inputs declared as Input<Func> (or scalar Inputs):
+ * an Input<Buffer<>> describes a buffer passed to the pipeline, which
+ * a Func computed by the pipeline can't stand in for.
+ *
+ * The Outputs of each stage are Funcs named "<stage>_<output>", and
+ * are computed inline unless scheduled otherwise; call schedule() to
+ * apply the schedules of all the stages instead, and adjust the
+ * schedule across the stages afterwards:
+ *
+ \code
+ class Fused : public Generator<Fused> {
+ public:
+     Input<Func> raw{"raw", UInt(16), 2};
+     Output<Func> output{"output", UInt(16), 2};
+
+     void generate() {
+         stages = GeneratorComposition(*this, manifest, {{"raw", raw}});
+         output(x, y) = stages.get_output("sharpen.output")(x, y);
+     }
+
+     void schedule() {
+         Func denoised = stages.get_output("denoise.output");
+         output.tile(x, y, xi, yi, 64, 16);
+         denoised.compute_at(output, x);
+     }
+
+ private:
+     GeneratorComposition stages;
+     Var x, y, xi, yi;
+ };
+ \endcode
+ *
+ * The stages are kept alive for as long as the GeneratorComposition,
+ * which must therefore outlive the compilation of the pipeline. */
+class GeneratorComposition {
+public:
+    GeneratorComposition() = default;
+
+    EXPORT GeneratorComposition(const GeneratorContext &context,
+                                const std::string &manifest,
+                                const std::map<std::string, Func> &funcs = {},
+                                const std::map<std::string, Expr> &exprs = {});
+
+    /** Get the Output of a stage, given as "stage.output". */
+    // @{
+    EXPORT Func get_output(const std::string &name) const;
+    EXPORT std::vector<Func> get_output_vector(const std::string &name) const;
+    // @}
+
+    /** Apply the schedules of all the stages, in the order they appear
+     * in the manifest. */
+    EXPORT GeneratorComposition &schedule();
+
+    /** The names of the stages, in the order they appear in the
+     * manifest. */
+    EXPORT std::vector<std::string> stages() const;
+
+private:
+    struct Stage {
+        std::string name;
+        std::shared_ptr<Internal::GeneratorBase> generator;
+    };
+    std::vector<Stage> stages_;
+
+    const Stage &find_stage(const std::string &name, std::string &output) const;
+
+    std::vector<Internal::StubInput> resolve_input(const Stage &stage,
+                                                   const Internal::GeneratorInputBase &input,
+                                                   const std::string &value,
+                                                   const std::map<std::string, Func> &funcs,
+                                                   const std::map<std::string, Expr> &exprs) const;
+};
+
 
 }  // namespace Halide
 
@@ -11,6 +11,7 @@
 #include "Scope.h"
 #include "Bounds.h"
 #include "Lerp.h"
+#include "ArithmeticIntrinsics.h"
 #include <unordered_map>
 
 namespace Halide {
@@ -531,9 +532,17 @@ private:
             } else {
                 mpy_count = find_mpy_ops(op, Int(8, lanes), Int(8, lanes), 4, mpys, rest);
                 suffix = ".vb.vb";
+                if (mpy_count == 0 || mpys.size() < 4) {
+                    // Try mixed signs. find_mpy_ops commutes each
+                    // multiply as needed to put the unsigned operand
+                    // first.
+                    mpys.clear();
+                    rest = Expr();
+                    mpy_count = find_mpy_ops(op, UInt(8, lanes), Int(8, lanes), 4, mpys, rest);
+                    suffix = ".vub.vb";
+                }
             }
 
-            // TODO: suffix = ".vub.vb"
             if (mpy_count > 0 && mpys.size() == 4) {
                 // TODO: It's possible that permuting the order of the
                 // multiply operands can simplify the shuffle away.
@@ -896,6 +905,10 @@ private:
             // that they generate.
             internal_assert(op->args.size() == 3);
             expr = mutate(lower_lerp(op->args[0], op->args[1], op->args[2]));
+        } else if (is_arithmetic_intrinsic(op)) {
+            // These become casts of wide arithmetic, which the
+            // patterns above turn into single HVX instructions.
+            expr = mutate(lower_arithmetic_intrinsic(op));
         } else if (op->is_intrinsic(Call::cast_mask)) {
             internal_assert(op->args.size() == 1);
             Type src_type = op->args[0].type();
@@ -1625,26 +1638,14 @@ public:
 class VtmpyGenerator : public IRGraphMutator {
 private:
     using IRMutator::visit;
-    typedef pair<Expr, size_t> LoadIndex;
-
-    // Check if vectors a and b point to the same buffer with the base of a
-    // shifted by diff i.e. base(a) = base(b) + diff.
-    bool is_base_shifted(const Expr &a, const Expr &b, int diff) {
-        Expr maybe_load_a = calc_load(a);
-        Expr maybe_load_b = calc_load(b);
-
-        if (maybe_load_a.defined() && maybe_load_b.defined()) {
-            const Load* load_a = maybe_load_a.as<Load>();
-            const Load* load_b = maybe_load_b.as<Load>();
-            if (load_a->name == load_b->name) {
-                Expr base_diff = simplify(load_a->index - load_b->index - diff);
-                if (is_const(base_diff, 0)) {
-                    return true;
-                }
-            }
-        }
-        return false;
-    }
+
+    // A multiply operand loaded from a buffer, the index of its
+    // multiply, and its offset from the first load of the same buffer.
+    struct LoadIndex {
+        Expr load;
+        size_t idx;
+        int64_t offset;
+    };
 
     // Return the load expression of first vector if all vector in exprs are
     // contiguous vectors pointing to the same buffer.
@@ -1692,21 +1693,19 @@ private:
         return Expr();
     }
 
-    // Loads comparator for sorting Load Expr of the same buffer.
-    static bool loads_comparator(LoadIndex a, LoadIndex b) {
-        if (a.first.defined() && b.first.defined()) {
-            const Load* load_a = a.first.as<Load>();
-            const Load* load_b = b.first.as<Load>();
-            if (load_a->name == load_b->name) {
-                Expr base_diff = simplify(load_b->index - load_a->index);
-                if (is_positive_const(base_diff)) {
-                    return true;
-                }
-            } else {
-                return load_a->name < load_b->name;
+    // Mutate the terms of a sum that has already been searched for
+    // vtmpy patterns. The sums within it are subsets of the one that
+    // was searched, so searching them again would only be slow.
+    Expr mutate_terms(const Expr &e) {
+        if (const Add *add = e.as<Add>()) {
+            Expr a = mutate_terms(add->a);
+            Expr b = mutate_terms(add->b);
+            if (a.same_as(add->a) && b.same_as(add->b)) {
+                return e;
             }
+            return Add::make(a, b);
         }
-        return false;
+        return mutate(e);
     }
 
     // Vtmpy helps in sliding window ops of the form a*v0 + b*v1 + v2.
@@ -1750,31 +1749,48 @@ private:
                 vector<Expr> vtmpy_exprs;
                 Expr new_expr;
 
-                for(size_t i = 0; i < mpy_size; i++) {
+                for (size_t i = 0; i < mpy_size; i++) {
                     Expr curr_load = calc_load(mpys[i].first);
-                    if (curr_load.defined()) {
-                        loads[curr_load.as<Load>()->name].emplace_back(curr_load, i);
-                    } else {
-                        new_expr = new_expr.defined() ? new_expr + curr_load : curr_load;
+                    if (!curr_load.defined()) {
+                        continue;
                     }
+                    const Load *load = curr_load.as<Load>();
+                    vector<LoadIndex> &bucket = loads[load->name];
+                    // Work out the offset of each load from the first
+                    // one once, rather than when comparing them.
+                    int64_t offset = 0;
+                    if (!bucket.empty()) {
+                        Expr diff = simplify(load->index - bucket[0].load.as<Load>()->index);
+                        if (const Broadcast *b = diff.as<Broadcast>()) {
+                            diff = b->value;
+                        }
+                        const int64_t *c = as_const_int(diff);
+                        if (!c) {
+                            // Not usable in a sliding window with the others.
+                            continue;
+                        }
+                        offset = *c;
+                    }
+                    bucket.push_back({curr_load, i, offset});
                 }
 
                 for (auto iter = loads.begin(); iter != loads.end(); iter++) {
-                    // Sort the bucket and compare bases of 3 adjacent vectors
-                    // at a time. If they differ by vector stride, we've
-                    // found a vtmpy
-                    std::sort(iter->second.begin(), iter->second.end(), loads_comparator);
-                    size_t vec_size = iter->second.size();
-                    for(size_t i = 0; i + 2 < vec_size; i++) {
-                        Expr v0 = iter->second[i].first;
-                        Expr v1 = iter->second[i+1].first;
-                        Expr v2 = iter->second[i+2].first;
-                        size_t v0_idx = iter->second[i].second;
-                        size_t v1_idx = iter->second[i+1].second;
-                        size_t v2_idx = iter->second[i+2].second;
+                    // Sort the bucket and compare offsets of 3 adjacent
+                    // vectors at a time. If they differ by vector
+                    // stride, we've found a vtmpy
+                    vector<LoadIndex> &bucket = iter->second;
+                    std::stable_sort(bucket.begin(), bucket.end(),
+                                     [](const LoadIndex &a, const LoadIndex &b) {
+                                         return a.offset < b.offset;
+                                     });
+                    size_t vec_size = bucket.size();
+                    for (size_t i = 0; i + 2 < vec_size; i++) {
+                        size_t v0_idx = bucket[i].idx;
+                        size_t v1_idx = bucket[i+1].idx;
+                        size_t v2_idx = bucket[i+2].idx;
                         if (is_const(mpys[v2_idx].second, 1) &&
-                            is_base_shifted(v2, v1, 1) &&
-                            is_base_shifted(v1, v0, 1)) {
+                            bucket[i+2].offset == bucket[i+1].offset + 1 &&
+                            bucket[i+1].offset == bucket[i].offset + 1) {
 
                             vtmpy_indices[v0_idx] = true;
                             vtmpy_indices[v1_idx] = true;
@@ -1812,6 +1828,8 @@ private:
                     return;
                 }
             }
+            expr = mutate_terms(op);
+            return;
         }
         IRMutator::visit(op);
     }
@@ -0,0 +1,208 @@
+#include <algorithm>
+
+#include "HoistStorage.h"
+#include "Bounds.h"
+#include "ExprUsesVar.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+#include "Function.h"
+#include "Simplify.h"
+#include "Substitute.h"
+#include "Debug.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::pair;
+using std::string;
+using std::vector;
+
+namespace {
+
+// Remove the allocations of the given buffers from a statement, and
+// compute extents that are large enough for all of them, in terms of
+// the variables defined outside of it.
+class LiftAllocations : public IRMutator {
+    const Function &func;
+    const vector<string> &names;
+
+    using IRMutator::visit;
+
+    // The lets and loops enclosing the current node.
+    vector<pair<string, Expr>> lets;
+    Scope<Interval> loops;
+    vector<string> non_serial_loops;
+
+    // Rewrite an expression in terms of the loop variables and the
+    // variables defined outside the statement.
+    Expr substitute_lets(Expr e) {
+        for (size_t i = lets.size(); i > 0; i--) {
+            const pair<string, Expr> &let = lets[i - 1];
+            if (expr_uses_var(e, let.first)) {
+                e = simplify(substitute(let.first, let.second, e));
+            }
+        }
+        return e;
+    }
+
+    void visit(const LetStmt *op) {
+        lets.push_back({op->name, op->value});
+        Stmt body = mutate(op->body);
+        lets.pop_back();
+        if (body.same_as(op->body)) {
+            stmt = op;
+        } else {
+            stmt = LetStmt::make(op->name, op->value, body);
+        }
+    }
+
+    void visit(const For *op) {
+        Expr min = substitute_lets(op->min);
+        Expr max = substitute_lets(op->min + op->extent - 1);
+        Interval i(bounds_of_expr_in_scope(min, loops).min,
+                   bounds_of_expr_in_scope(max, loops).max);
+        loops.push(op->name, i);
+        bool serial = op->for_type == ForType::Serial || op->for_type == ForType::Unrolled;
+        if (!serial) {
+            non_serial_loops.push_back(op->name);
+        }
+        Stmt body = mutate(op->body);
+        if (!serial) {
+            non_serial_loops.pop_back();
+        }
+        loops.pop(op->name);
+        if (body.same_as(op->body)) {
+            stmt = op;
+        } else {
+            stmt = For::make(op->name, op->min, op->extent, op->for_type, op->device_api, body);
+        }
+    }
+
+    void visit(const Allocate *op) {
+        if (std::find(names.begin(), names.end(), op->name) == names.end()) {
+            IRMutator::visit(op);
+            return;
+        }
+
+        user_assert(non_serial_loops.empty())
+            << "Can't hoist the storage of " << func.name()
+            << " out of the loop " << non_serial_loops.back()
+            << ", because that loop is not serial.\n";
+        user_assert(!op->new_expr.defined())
+            << "Can't hoist the storage of " << func.name()
+            << ", because it is memoized or streamed.\n";
+
+        vector<Expr> extents;
+        for (size_t i = 0; i < op->extents.size(); i++) {
+            Expr e = substitute_lets(op->extents[i]);
+            Interval bounds = bounds_of_expr_in_scope(e, loops);
+            user_assert(bounds.has_upper_bound())
+                << "Can't hoist the storage of " << func.name()
+                << ", because the extent of its dimension " << i
+                << " has no upper bound over the loops it is hoisted out of: "
+                << op->extents[i] << "\n";
+            extents.push_back(simplify(bounds.max));
+        }
+
+        // The same allocation can appear more than once, e.g. in
+        // the branches of a specialization.
+        auto iter = lifted.find(op->name);
+        if (iter == lifted.end()) {
+            lifted[op->name] = {op->type, extents};
+        } else {
+            internal_assert(iter->second.extents.size() == extents.size());
+            for (size_t i = 0; i < extents.size(); i++) {
+                iter->second.extents[i] = simplify(max(iter->second.extents[i], extents[i]));
+            }
+        }
+
+        debug(3) << "Hoisting the storage of " << op->name << "\n";
+        stmt = mutate(op->body);
+    }
+
+public:
+    struct Lifted {
+        Type type;
+        vector<Expr> extents;
+    };
+    map<string, Lifted> lifted;
+
+    LiftAllocations(const Function &func, const vector<string> &names) : func(func), names(names) {}
+};
+
+class HoistStorage : public IRMutator {
+    const Function &func;
+    vector<string> names;
+
+    using IRMutator::visit;
+
+    void visit(const For *op) {
+        if (func.schedule().hoist_storage_level().match(op->name)) {
+            found_loop = true;
+            stmt = For::make(op->name, op->min, op->extent, op->for_type,
+                             op->device_api, lift(op->body));
+        } else {
+            IRMutator::visit(op);
+        }
+    }
+
+public:
+    bool found_loop = false, lifted_any = false;
+
+    Stmt lift(Stmt s) {
+        LiftAllocations lifter(func, names);
+        s = lifter.mutate(s);
+        for (size_t i = names.size(); i > 0; i--) {
+            auto iter = lifter.lifted.find(names[i - 1]);
+            if (iter != lifter.lifted.end()) {
+                s = Allocate::make(iter->first, iter->second.type, iter->second.extents, const_true(), s);
+                lifted_any = true;
+            }
+        }
+        return s;
+    }
+
+    HoistStorage(const Function &func) : func(func) {
+        // Tuple elements are stored separately, unless they are
+        // interleaved.
+        if (func.outputs() == 1 || func.schedule().interleave_tuple()) {
+            names.push_back(func.name());
+        } else {
+            for (int i = 0; i < func.outputs(); i++) {
+                names.push_back(func.name() + "." + std::to_string(i));
+            }
+        }
+    }
+};
+
+}  // namespace
+
+Stmt hoist_storage(Stmt s, const map<string, Function> &env) {
+    for (const auto &p : env) {
+        const Function &f = p.second;
+        const LoopLevel &level = f.schedule().hoist_storage_level();
+        if (!level.defined()) continue;
+        user_assert(!level.is_inline())
+            << "Func " << f.name() << " can't hoist its storage to an inlined loop level.\n";
+        user_assert(!f.schedule().memoized())
+            << "Func " << f.name() << " can't hoist its storage, because it is memoized.\n";
+
+        HoistStorage hoister(f);
+        if (level.is_root()) {
+            s = hoister.lift(s);
+        } else {
+            s = hoister.mutate(s);
+            user_assert(hoister.found_loop)
+                << "Func " << f.name() << " is scheduled to hoist its storage to "
+                << level.to_string() << ", which is not a loop in the pipeline.\n";
+        }
+        user_assert(hoister.lifted_any)
+            << "Func " << f.name() << " is scheduled to hoist its storage to "
+            << level.to_string() << ", which is not outside of or equal to where it is stored.\n";
+    }
+    return s;
+}
+
+}
+}
@@ -0,0 +1,29 @@
+#ifndef HALIDE_HOIST_STORAGE_H
+#define HALIDE_HOIST_STORAGE_H
+
+/** \file
+ *
+ * Defines the lowering pass that hoists the allocations of Funcs
+ * scheduled with Func::hoist_storage out of the loops they are
+ * stored in.
+ */
+
+#include <map>
+
+#include "IR.h"
+
+namespace Halide {
+namespace Internal {
+
+/** Move the allocations of Funcs with a hoist_storage level out to
+ * that level, with extents large enough for every iteration of the
+ * loops they are moved out of. The lets defining the mins, extents
+ * and strides of the storage are left where they were, so each
+ * iteration still addresses its own region from the start of the
+ * allocation. Should be called after storage flattening. */
+Stmt hoist_storage(Stmt s, const std::map<std::string, Function> &env);
+
+}
+}
+
+#endif
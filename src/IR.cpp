@@ -1,10 +1,164 @@
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+
 #include "IR.h"
 #include "IRPrinter.h"
 #include "IRVisitor.h"
+#include "Util.h"
 
 namespace Halide {
 namespace Internal {
 
+namespace {
+
+// The free lists are kept for each size of node, in steps of 16
+// bytes, so that nodes stay 16-byte aligned. Larger nodes go to
+// malloc.
+const size_t node_size_step = 16;
+const size_t max_pooled_node_size = 256;
+const size_t node_slab_size = 64 * 1024;
+
+struct FreeNode {
+    FreeNode *next;
+};
+
+struct NodeFreeLists {
+    FreeNode *head[max_pooled_node_size / node_size_step];
+    char *slab;
+    size_t slab_remaining;
+};
+
+// Zero-initialized and trivially destructible, so it remains usable
+// for nodes destroyed during static destruction.
+thread_local NodeFreeLists node_free_lists;
+
+// The free lists of threads that have exited. Lowering runs on
+// short-lived threads too, so their nodes must be reused by other
+// threads rather than lost. Never destroyed, so that it outlives
+// every thread.
+struct SharedNodeFreeLists {
+    std::mutex mutex;
+    // Only changed with the mutex held, but peeked at without it.
+    std::atomic<FreeNode *> head[max_pooled_node_size / node_size_step];
+};
+
+SharedNodeFreeLists &shared_node_free_lists() {
+    static SharedNodeFreeLists *lists = new SharedNodeFreeLists();
+    return *lists;
+}
+
+// Hand the free lists of the calling thread, and the rest of its
+// slab, to the shared pool.
+void release_node_free_lists() {
+    NodeFreeLists &lists = node_free_lists;
+    // Cut the rest of the slab into nodes of the largest size that
+    // fits.
+    while (lists.slab_remaining >= node_size_step) {
+        size_t bytes = std::min(lists.slab_remaining, max_pooled_node_size);
+        bytes -= bytes % node_size_step;
+        FreeNode *node = (FreeNode *)lists.slab;
+        size_t idx = bytes / node_size_step - 1;
+        node->next = lists.head[idx];
+        lists.head[idx] = node;
+        lists.slab += bytes;
+        lists.slab_remaining -= bytes;
+    }
+    lists.slab = nullptr;
+    lists.slab_remaining = 0;
+
+    SharedNodeFreeLists &shared = shared_node_free_lists();
+    std::lock_guard<std::mutex> lock(shared.mutex);
+    for (size_t idx = 0; idx < max_pooled_node_size / node_size_step; idx++) {
+        FreeNode *first = lists.head[idx];
+        if (!first) continue;
+        lists.head[idx] = nullptr;
+        FreeNode *last = first;
+        while (last->next) {
+            last = last->next;
+        }
+        last->next = shared.head[idx].load(std::memory_order_relaxed);
+        shared.head[idx].store(first, std::memory_order_relaxed);
+    }
+}
+
+struct NodeFreeListsReleaser {
+    ~NodeFreeListsReleaser() {
+        release_node_free_lists();
+    }
+};
+
+// Arrange for the free lists of the calling thread to be released
+// when it exits. Called whenever a thread's lists may go from empty
+// to non-empty, so that it's off the common paths.
+void release_node_free_lists_at_thread_exit() {
+    thread_local NodeFreeListsReleaser releaser;
+    (void)releaser;
+}
+
+bool use_node_free_lists() {
+    static bool enabled = get_env_variable("HL_IR_ARENA") != "0";
+    return enabled;
+}
+
+}  // namespace
+
+void *IRNode::operator new(size_t size) {
+    if (size > max_pooled_node_size || !use_node_free_lists()) {
+        return ::operator new(size);
+    }
+    size_t idx = (size - 1) / node_size_step;
+    NodeFreeLists &lists = node_free_lists;
+    if (FreeNode *node = lists.head[idx]) {
+        lists.head[idx] = node->next;
+        return node;
+    }
+    size_t bytes = (idx + 1) * node_size_step;
+    // Take a slab's worth of the nodes left by threads that have
+    // exited, if any.
+    SharedNodeFreeLists &shared = shared_node_free_lists();
+    if (shared.head[idx].load(std::memory_order_relaxed)) {
+        std::lock_guard<std::mutex> lock(shared.mutex);
+        if (FreeNode *node = shared.head[idx].load(std::memory_order_relaxed)) {
+            release_node_free_lists_at_thread_exit();
+            FreeNode *last = node;
+            for (size_t i = 1; i < node_slab_size / bytes && last->next; i++) {
+                last = last->next;
+            }
+            shared.head[idx].store(last->next, std::memory_order_relaxed);
+            last->next = nullptr;
+            lists.head[idx] = node->next;
+            return node;
+        }
+    }
+    if (lists.slab_remaining < bytes) {
+        // The rest of the old slab is wasted. It's less than the
+        // size of the largest node.
+        release_node_free_lists_at_thread_exit();
+        lists.slab = (char *)::operator new(node_slab_size);
+        lists.slab_remaining = node_slab_size;
+    }
+    void *result = lists.slab;
+    lists.slab += bytes;
+    lists.slab_remaining -= bytes;
+    return result;
+}
+
+void IRNode::operator delete(void *ptr, size_t size) {
+    if (size > max_pooled_node_size || !use_node_free_lists()) {
+        ::operator delete(ptr);
+        return;
+    }
+    size_t idx = (size - 1) / node_size_step;
+    NodeFreeLists &lists = node_free_lists;
+    if (!lists.head[idx]) {
+        release_node_free_lists_at_thread_exit();
+    }
+    FreeNode *node = (FreeNode *)ptr;
+    node->next = lists.head[idx];
+    lists.head[idx] = node;
+}
+
 Expr Cast::make(Type t, Expr v) {
     internal_assert(v.defined()) << "Cast of undefined\n";
     internal_assert(t.lanes() == v.type().lanes()) << "Cast may not change vector widths\n";
@@ -732,6 +886,23 @@ bool Shuffle::is_extract_element() const {
     return indices.size() == 1;
 }
 
+Expr VectorReduce::make(VectorReduce::Operator op, Expr vec, int lanes) {
+    internal_assert(vec.defined()) << "VectorReduce of undefined Expr\n";
+    if (vec.type().is_bool()) {
+        internal_assert(op == VectorReduce::And || op == VectorReduce::Or)
+            << "The only legal vector reductions of bools are And and Or\n";
+    }
+    internal_assert(lanes > 0 && vec.type().lanes() % lanes == 0)
+        << "Can't reduce a vector of " << vec.type().lanes()
+        << " lanes down to " << lanes << " lanes\n";
+
+    VectorReduce *node = new VectorReduce;
+    node->type = vec.type().with_lanes(lanes);
+    node->op = op;
+    node->value = std::move(vec);
+    return node;
+}
+
 
 template<> EXPORT void ExprNode<IntImm>::accept(IRVisitor *v) const { v->visit((const IntImm *)this); }
 template<> EXPORT void ExprNode<UIntImm>::accept(IRVisitor *v) const { v->visit((const UIntImm *)this); }
@@ -761,6 +932,7 @@ template<> EXPORT void ExprNode<Ramp>::accept(IRVisitor *v) const { v->visit((co
 template<> EXPORT void ExprNode<Broadcast>::accept(IRVisitor *v) const { v->visit((const Broadcast *)this); }
 template<> EXPORT void ExprNode<Call>::accept(IRVisitor *v) const { v->visit((const Call *)this); }
 template<> EXPORT void ExprNode<Shuffle>::accept(IRVisitor *v) const { v->visit((const Shuffle *)this); }
+template<> EXPORT void ExprNode<VectorReduce>::accept(IRVisitor *v) const { v->visit((const VectorReduce *)this); }
 template<> EXPORT void ExprNode<Let>::accept(IRVisitor *v) const { v->visit((const Let *)this); }
 template<> EXPORT void StmtNode<LetStmt>::accept(IRVisitor *v) const { v->visit((const LetStmt *)this); }
 template<> EXPORT void StmtNode<AssertStmt>::accept(IRVisitor *v) const { v->visit((const AssertStmt *)this); }
@@ -786,8 +958,15 @@ Call::ConstString Call::shift_left = "shift_left";
 Call::ConstString Call::shift_right = "shift_right";
 Call::ConstString Call::abs = "abs";
 Call::ConstString Call::absd = "absd";
+Call::ConstString Call::saturating_add = "saturating_add";
+Call::ConstString Call::saturating_sub = "saturating_sub";
+Call::ConstString Call::halving_add = "halving_add";
+Call::ConstString Call::rounding_halving_add = "rounding_halving_add";
+Call::ConstString Call::rounding_shift_right = "rounding_shift_right";
+Call::ConstString Call::widening_mul = "widening_mul";
 Call::ConstString Call::lerp = "lerp";
 Call::ConstString Call::random = "random";
+Call::ConstString Call::counter_random = "counter_random";
 Call::ConstString Call::popcount = "popcount";
 Call::ConstString Call::count_leading_zeros = "count_leading_zeros";
 Call::ConstString Call::count_trailing_zeros = "count_trailing_zeros";
@@ -818,6 +997,9 @@ Call::ConstString Call::select_mask = "select_mask";
 Call::ConstString Call::extract_mask_element = "extract_mask_element";
 Call::ConstString Call::require = "require";
 Call::ConstString Call::size_of_halide_buffer_t = "size_of_halide_buffer_t";
+Call::ConstString Call::atomic_update = "atomic_update";
+Call::ConstString Call::nontemporal_store = "nontemporal_store";
+Call::ConstString Call::branch_profile = "branch_profile";
 
 Call::ConstString Call::buffer_get_min = "_halide_buffer_get_min";
 Call::ConstString Call::buffer_get_extent = "_halide_buffer_get_extent";
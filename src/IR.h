@@ -480,8 +480,15 @@ struct Call : public ExprNode<Call> {
         shift_right,
         abs,
         absd,
+        saturating_add,
+        saturating_sub,
+        halving_add,
+        rounding_halving_add,
+        rounding_shift_right,
+        widening_mul,
         rewrite_buffer,
         random,
+        counter_random,
         lerp,
         popcount,
         count_leading_zeros,
@@ -512,7 +519,10 @@ struct Call : public ExprNode<Call> {
         select_mask,
         extract_mask_element,
         require,
-        size_of_halide_buffer_t;
+        size_of_halide_buffer_t,
+        atomic_update,
+        nontemporal_store,
+        branch_profile;
 
     // We also declare some symbolic names for some of the runtime
     // functions that we want to construct Call nodes to here to avoid
@@ -740,6 +750,30 @@ struct Prefetch : public StmtNode<Prefetch> {
     static const IRNodeType _node_type = IRNodeType::Prefetch;
 };
 
+/** Horizontally reduce a vector to a scalar or a narrower vector
+ * using the given commutative and associative binary operator. Each
+ * lane of the result combines a group of adjacent lanes of the input,
+ * so the number of lanes of the input must be a multiple of the
+ * number of lanes of the result. */
+struct VectorReduce : public ExprNode<VectorReduce> {
+    // The associative binary operators the reduction may use.
+    typedef enum {
+        Add,
+        Mul,
+        Min,
+        Max,
+        And,
+        Or,
+    } Operator;
+
+    Expr value;
+    Operator op;
+
+    EXPORT static Expr make(Operator op, Expr vec, int lanes);
+
+    static const IRNodeType _node_type = IRNodeType::VectorReduce;
+};
+
 }
 }
 
@@ -2,6 +2,8 @@
 #include "IRVisitor.h"
 #include "IROperator.h"
 
+#include <string.h>
+
 namespace Halide {
 namespace Internal {
 
@@ -10,6 +12,159 @@ using std::vector;
 
 namespace {
 
+// Combine a value into a hash. The constant is from the FNV-1a hash.
+inline uint64_t hash_combine(uint64_t h, uint64_t v) {
+    h ^= v + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+    return h * 0x100000001b3ULL;
+}
+
+// Hash a string the same way on every platform, unlike std::hash.
+uint64_t hash_name(const string &s) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (char c : s) {
+        h = (h ^ (uint8_t)c) * 0x100000001b3ULL;
+    }
+    return h;
+}
+
+/** Compute the hash of a single node from the hashes of its
+ * children. Only uses what IRComparer compares, so that equal Exprs
+ * get equal hashes. */
+class ExprHasher : public IRVisitor {
+    using IRVisitor::visit;
+
+    void mix(uint64_t v) {
+        result = hash_combine(result, v);
+    }
+
+    void mix(const Expr &e) {
+        mix(e.defined() ? structural_hash(e) : 0);
+    }
+
+    void mix(const string &s) {
+        mix(hash_name(s));
+    }
+
+    void visit(const IntImm *op) {
+        mix((uint64_t)op->value);
+    }
+
+    void visit(const UIntImm *op) {
+        mix(op->value);
+    }
+
+    void visit(const FloatImm *op) {
+        // IRComparer considers 0 and -0 equal, and all NaNs equal.
+        double v = op->value;
+        uint64_t bits = 0;
+        if (v != v) {
+            bits = 1;
+        } else if (v != 0) {
+            memcpy(&bits, &v, sizeof(bits));
+        }
+        mix(bits);
+    }
+
+    void visit(const StringImm *op) {
+        mix(op->value);
+    }
+
+    void visit(const Cast *op) {
+        mix(op->value);
+    }
+
+    void visit(const Variable *op) {
+        mix(op->name);
+    }
+
+    template<typename T>
+    void visit_binary_operator(const T *op) {
+        mix(op->a);
+        mix(op->b);
+    }
+
+    void visit(const Add *op) {visit_binary_operator(op);}
+    void visit(const Sub *op) {visit_binary_operator(op);}
+    void visit(const Mul *op) {visit_binary_operator(op);}
+    void visit(const Div *op) {visit_binary_operator(op);}
+    void visit(const Mod *op) {visit_binary_operator(op);}
+    void visit(const Min *op) {visit_binary_operator(op);}
+    void visit(const Max *op) {visit_binary_operator(op);}
+    void visit(const EQ *op) {visit_binary_operator(op);}
+    void visit(const NE *op) {visit_binary_operator(op);}
+    void visit(const LT *op) {visit_binary_operator(op);}
+    void visit(const LE *op) {visit_binary_operator(op);}
+    void visit(const GT *op) {visit_binary_operator(op);}
+    void visit(const GE *op) {visit_binary_operator(op);}
+    void visit(const And *op) {visit_binary_operator(op);}
+    void visit(const Or *op) {visit_binary_operator(op);}
+
+    void visit(const Not *op) {
+        mix(op->a);
+    }
+
+    void visit(const Select *op) {
+        mix(op->condition);
+        mix(op->true_value);
+        mix(op->false_value);
+    }
+
+    void visit(const Load *op) {
+        mix(op->name);
+        mix(op->predicate);
+        mix(op->index);
+    }
+
+    void visit(const Ramp *op) {
+        mix(op->base);
+        mix(op->stride);
+    }
+
+    void visit(const Broadcast *op) {
+        mix(op->value);
+    }
+
+    void visit(const Call *op) {
+        mix(op->name);
+        mix((uint64_t)op->call_type);
+        mix((uint64_t)op->value_index);
+        for (const Expr &e : op->args) {
+            mix(e);
+        }
+    }
+
+    void visit(const Let *op) {
+        mix(op->name);
+        mix(op->value);
+        mix(op->body);
+    }
+
+    void visit(const Shuffle *op) {
+        for (const Expr &e : op->vectors) {
+            mix(e);
+        }
+        for (int i : op->indices) {
+            mix((uint64_t)i);
+        }
+    }
+
+    void visit(const VectorReduce *op) {
+        mix((uint64_t)op->op);
+        mix(op->value);
+    }
+
+public:
+    uint64_t result;
+
+    // The handle type is left out, because it's compared by address,
+    // which would make the hash differ between runs.
+    ExprHasher(const BaseExprNode *e) {
+        const Type &t = e->type;
+        result = hash_combine((uint64_t)e->node_type,
+                              ((uint64_t)t.code() << 32) | ((uint64_t)t.bits() << 16) | t.lanes());
+    }
+};
+
 /** The class that does the work of comparing two IR nodes. */
 class IRComparer : public IRVisitor {
 public:
@@ -90,6 +245,7 @@ private:
     void visit(const Evaluate *);
     void visit(const Shuffle *);
     void visit(const Prefetch *);
+    void visit(const VectorReduce *);
 };
 
 template<typename T>
@@ -130,11 +286,9 @@ IRComparer::CmpResult IRComparer::compare_expr(const Expr &a, const Expr &b) {
         return result;
     }
 
-    // If in the future we have hashes for Exprs, this is a good place
-    // to compare the hashes:
-    // if (compare_scalar(a.hash(), b.hash()) != Equal) {
-    //   return result;
-    // }
+    if (compare_scalar(structural_hash(a), structural_hash(b)) != Equal) {
+        return result;
+    }
 
     if (compare_scalar(a->node_type, b->node_type) != Equal) {
         return result;
@@ -462,10 +616,31 @@ void IRComparer::visit(const Prefetch *op) {
     }
 }
 
+void IRComparer::visit(const VectorReduce *op) {
+    const VectorReduce *e = expr.as<VectorReduce>();
+
+    compare_scalar(e->op, op->op);
+    compare_expr(e->value, op->value);
+}
+
 } // namespace
 
 
 // Now the methods exposed in the header.
+uint64_t structural_hash(const Expr &e) {
+    internal_assert(e.defined()) << "Hash of undefined Expr\n";
+    const BaseExprNode *node = static_cast<const BaseExprNode *>(e.get());
+    uint64_t h = node->hash.load(std::memory_order_relaxed);
+    if (h == 0) {
+        ExprHasher hasher(node);
+        e.accept(&hasher);
+        // Zero means not computed yet.
+        h = hasher.result ? hasher.result : 1;
+        node->hash.store(h, std::memory_order_relaxed);
+    }
+    return h;
+}
+
 bool equal(const Expr &a, const Expr &b) {
     return IRComparer().compare_expr(a, b) == IRComparer::Equal;
 }
@@ -560,6 +735,17 @@ void ir_equality_test() {
     e2 = e2*e2 + e2;
     check_not_equal(e1, e2);
 
+    // Equal Exprs must have equal hashes, including ones that only
+    // differ in the sign of a zero.
+    Expr y = Variable::make(Float(32), "y");
+    Expr f1 = y * 3.0f + y * 0.0f;
+    Expr f2 = y * 3.0f + y * -0.0f;
+    check_equal(f1, f2);
+    internal_assert(structural_hash(f1) == structural_hash(f2))
+        << "Equal Exprs have different hashes\n";
+    internal_assert(structural_hash(e1) != structural_hash(e2))
+        << "Unequal Exprs have the same hash\n";
+
     debug(0) << "ir_equality_test passed\n";
 }
 
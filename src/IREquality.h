@@ -11,7 +11,8 @@ namespace Halide {
 namespace Internal {
 
 /** A compare struct suitable for use in std::map and std::set that
- * computes a lexical ordering on IR nodes. */
+ * computes a lexical ordering on IR nodes. Exprs are ordered by their
+ * structural hashes before their contents. */
 struct IRDeepCompare {
     EXPORT bool operator()(const Expr &a, const Expr &b) const;
     EXPORT bool operator()(const Stmt &a, const Stmt &b) const;
@@ -101,6 +102,15 @@ struct ExprWithCompareCache {
     EXPORT bool operator<(const ExprWithCompareCache &other) const;
 };
 
+/** Get a hash of an Expr that depends only on its structure, so
+ * that Exprs that are equal by value have the same hash. The hash of
+ * each node is computed once and cached in the node, so this is
+ * linear in the number of distinct nodes the first time it is called
+ * on an Expr, and constant time afterwards. It's the same across runs
+ * and platforms. The comparisons below compare these hashes first,
+ * so unequal Exprs are usually told apart without traversing them. */
+EXPORT uint64_t structural_hash(const Expr &e);
+
 /** Compare IR nodes for equality of value. Traverses entire IR
  * tree. For equality of reference, use Expr::same_as. If you're
  * comparing non-CSE'd Exprs, use graph_equal, which is safe for nasty
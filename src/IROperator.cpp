@@ -575,6 +575,86 @@ Expr halide_exp(Expr x_full) {
     return result;
 }
 
+namespace {
+
+// Reduce x to the range [-pi/4, pi/4] for sin and cos. On return,
+// *octant is the even integer j nearest to |x| * 4/pi, and *reduced
+// is |x| - j * pi/4, computed with a three-part Cody-Waite reduction
+// of pi/4. This is accurate for |x| up to about 8192.
+void range_reduce_sin_cos(Expr x, Expr *octant, Expr *reduced) {
+    Type type = x.type();
+    Type int_type = Int(32, type.lanes());
+
+    const float four_over_pi = 1.27323954473516f;
+    const float pi_over_4_part1 = 0.78515625f;
+    const float pi_over_4_part2 = 2.4187564849853515625e-4f;
+    const float pi_over_4_part3 = 3.77489497744594108e-8f;
+
+    Expr j = cast(int_type, x * four_over_pi);
+    j = (j + 1) & ~1;
+    Expr y = cast(type, j);
+    *octant = j;
+    *reduced = ((x - y * pi_over_4_part1) - y * pi_over_4_part2) - y * pi_over_4_part3;
+}
+
+// Minimax polynomials for sin and cos on [-pi/4, pi/4], from Cephes.
+Expr sin_polynomial(Expr x) {
+    Expr z = x * x;
+    float coeff[] = {
+        -1.9515295891e-4f,
+        8.3321608736e-3f,
+        -1.6666654611e-1f,
+        0.0f};
+    return evaluate_polynomial(z, coeff, sizeof(coeff)/sizeof(coeff[0])) * x + x;
+}
+
+Expr cos_polynomial(Expr x) {
+    Expr z = x * x;
+    float coeff[] = {
+        2.443315711809948e-5f,
+        -1.388731625493765e-3f,
+        4.166664568298827e-2f,
+        -0.5f,
+        1.0f};
+    return evaluate_polynomial(z, coeff, sizeof(coeff)/sizeof(coeff[0]));
+}
+
+}  // namespace
+
+Expr halide_sin(Expr x_full) {
+    Type type = x_full.type();
+    internal_assert(type.element_of() == Float(32));
+
+    Expr octant, reduced;
+    range_reduce_sin_cos(abs(x_full), &octant, &reduced);
+
+    // Octants 2 and 6 are shifted by pi/2, and octants 4 and 6 are
+    // negated. sin is odd, so the sign of x flips the result too.
+    Expr use_cos = (octant & 2) != 0;
+    Expr negate = ((octant & 4) != 0) != (x_full < 0.0f);
+    Expr result = select(use_cos, cos_polynomial(reduced), sin_polynomial(reduced));
+    result = select(negate, -result, result);
+
+    return common_subexpression_elimination(result);
+}
+
+Expr halide_cos(Expr x_full) {
+    Type type = x_full.type();
+    internal_assert(type.element_of() == Float(32));
+
+    Expr octant, reduced;
+    range_reduce_sin_cos(abs(x_full), &octant, &reduced);
+
+    // Octants 2 and 6 are shifted by pi/2, and octants 2 and 4 are
+    // negated. cos is even, so the sign of x doesn't matter.
+    Expr use_sin = (octant & 2) != 0;
+    Expr negate = ((octant + 2) & 4) != 0;
+    Expr result = select(use_sin, sin_polynomial(reduced), cos_polynomial(reduced));
+    result = select(negate, -result, result);
+
+    return common_subexpression_elimination(result);
+}
+
 Expr halide_erf(Expr x_full) {
     user_assert(x_full.type() == Float(32)) << "halide_erf only works for Float(32)";
 
@@ -763,7 +843,7 @@ Expr strided_ramp_base(Expr e, int stride) {
 } // namespace Internal
 
 Expr fast_log(Expr x) {
-    user_assert(x.type() == Float(32)) << "fast_log only works for Float(32)";
+    user_assert(x.type().element_of() == Float(32)) << "fast_log only works for Float(32)";
 
     Expr reduced, exponent;
     range_reduce_log(x, &reduced, &exponent);
@@ -781,17 +861,20 @@ Expr fast_log(Expr x) {
         0.0f};
 
     Expr result = evaluate_polynomial(x1, coeff, sizeof(coeff)/sizeof(coeff[0]));
-    result = result + cast<float>(exponent) * logf(2);
+    result = result + cast(x.type(), exponent) * logf(2);
     result = common_subexpression_elimination(result);
     return result;
 }
 
 Expr fast_exp(Expr x_full) {
-    user_assert(x_full.type() == Float(32)) << "fast_exp only works for Float(32)";
+    // Vector types are accepted too, for codegen of the fast_math
+    // target feature.
+    user_assert(x_full.type().element_of() == Float(32)) << "fast_exp only works for Float(32)";
+    Type type = x_full.type();
 
     Expr scaled = x_full / logf(2.0);
     Expr k_real = floor(scaled);
-    Expr k = cast<int>(k_real);
+    Expr k = cast(Int(32, type.lanes()), k_real);
     Expr x = x_full - k_real * logf(2.0);
 
     float coeff[] = {
@@ -809,11 +892,34 @@ Expr fast_exp(Expr x_full) {
 
     // Shift the bits up into the exponent field and reinterpret this
     // thing as float.
-    Expr two_to_the_n = reinterpret<float>(biased << 23);
+    Expr two_to_the_n = reinterpret(type, biased << 23);
     result *= two_to_the_n;
     result = common_subexpression_elimination(result);
     return result;
 }
+Expr float_to_bfloat16(Expr x) {
+    user_assert(x.type().element_of() == Float(32)) << "float_to_bfloat16 only works for Float(32)";
+    const int lanes = x.type().lanes();
+    Type u16 = UInt(16, lanes), u32 = UInt(32, lanes);
+
+    Expr bits = reinterpret(u32, x);
+    // Add just under a half, plus one more if the result would
+    // otherwise be odd, and then truncate.
+    Expr rounded = bits + (Internal::make_const(u32, 0x7fff) + ((bits >> 16) & Internal::make_one(u32)));
+    Expr result = cast(u16, rounded >> 16);
+    // Rounding could carry a NaN into infinity, so make it quiet
+    // instead.
+    Expr quiet_nan = cast(u16, bits >> 16) | Internal::make_const(u16, 0x40);
+    result = select(is_nan(x), quiet_nan, result);
+    return common_subexpression_elimination(result);
+}
+
+Expr bfloat16_to_float(Expr bits) {
+    user_assert(bits.type().element_of() == UInt(16)) << "bfloat16_to_float only works for the bits of a bfloat16, as a UInt(16)";
+    Type u32 = UInt(32, bits.type().lanes());
+    return reinterpret(Float(32, bits.type().lanes()), cast(u32, bits) << 16);
+}
+
 Expr stringify(const std::vector<Expr> &args) {
     return Internal::Call::make(type_of<const char *>(), Internal::Call::stringify,
                                 args, Internal::Call::Intrinsic);
@@ -159,11 +159,14 @@ EXPORT Expr lossless_cast(Type t, Expr e);
  */
 EXPORT void match_types(Expr &a, Expr &b);
 
-/** Halide's vectorizable transcendentals. */
+/** Halide's vectorizable transcendentals. halide_sin and halide_cos
+ * are accurate to a few ULP for |a| up to about 8192. */
 // @{
 EXPORT Expr halide_log(Expr a);
 EXPORT Expr halide_exp(Expr a);
 EXPORT Expr halide_erf(Expr a);
+EXPORT Expr halide_sin(Expr a);
+EXPORT Expr halide_cos(Expr a);
 // @}
 
 /** Raise an expression to an integer power by repeatedly multiplying
@@ -865,6 +868,74 @@ inline Expr absd(Expr a, Expr b) {
                                 Internal::Call::PureIntrinsic);
 }
 
+namespace Internal {
+inline Expr make_arithmetic_intrinsic(const char *name, Type result_type, Expr a, Expr b) {
+    Type t = a.type();
+    user_assert((t.is_int() || t.is_uint()) && t.bits() <= 32)
+        << "The arguments to " << name << " must be integers of 32 bits or fewer, but instead are "
+        << a << " and " << b << " of type " << t << "\n";
+    return Call::make(result_type, name, {std::move(a), std::move(b)}, Call::PureIntrinsic);
+}
+}
+
+/** Return the sum of two integers, clamped to the range of their
+ * type instead of overflowing. Vectorizes cleanly, and is a single
+ * instruction for 8- and 16-bit vectors on x86, ARM and Hexagon. */
+inline Expr saturating_add(Expr a, Expr b) {
+    user_assert(a.defined() && b.defined()) << "saturating_add of undefined Expr\n";
+    Internal::match_types(a, b);
+    Type t = a.type();
+    return Internal::make_arithmetic_intrinsic(Internal::Call::saturating_add, t, std::move(a), std::move(b));
+}
+
+/** Return the difference of two integers, clamped to the range of
+ * their type instead of overflowing. See \ref saturating_add. */
+inline Expr saturating_sub(Expr a, Expr b) {
+    user_assert(a.defined() && b.defined()) << "saturating_sub of undefined Expr\n";
+    Internal::match_types(a, b);
+    Type t = a.type();
+    return Internal::make_arithmetic_intrinsic(Internal::Call::saturating_sub, t, std::move(a), std::move(b));
+}
+
+/** Return (a + b) / 2, rounding down, computed without
+ * overflow. Vectorizes cleanly. */
+inline Expr halving_add(Expr a, Expr b) {
+    user_assert(a.defined() && b.defined()) << "halving_add of undefined Expr\n";
+    Internal::match_types(a, b);
+    Type t = a.type();
+    return Internal::make_arithmetic_intrinsic(Internal::Call::halving_add, t, std::move(a), std::move(b));
+}
+
+/** Return (a + b + 1) / 2, rounding down, computed without
+ * overflow. This is the rounding average of two values. Vectorizes
+ * cleanly. */
+inline Expr rounding_halving_add(Expr a, Expr b) {
+    user_assert(a.defined() && b.defined()) << "rounding_halving_add of undefined Expr\n";
+    Internal::match_types(a, b);
+    Type t = a.type();
+    return Internal::make_arithmetic_intrinsic(Internal::Call::rounding_halving_add, t, std::move(a), std::move(b));
+}
+
+/** Return a shifted right by b bits, rounding to nearest with ties
+ * rounding up, computed without overflow. b must be at least zero
+ * and less than the bit width of a. Vectorizes cleanly. */
+inline Expr rounding_shift_right(Expr a, Expr b) {
+    user_assert(a.defined() && b.defined()) << "rounding_shift_right of undefined Expr\n";
+    Internal::match_types(a, b);
+    Type t = a.type();
+    return Internal::make_arithmetic_intrinsic(Internal::Call::rounding_shift_right, t, std::move(a), std::move(b));
+}
+
+/** Return the product of two integers in the integer type with twice
+ * their bit width, so that it can't overflow. Vectorizes cleanly. */
+inline Expr widening_mul(Expr a, Expr b) {
+    user_assert(a.defined() && b.defined()) << "widening_mul of undefined Expr\n";
+    Internal::match_types(a, b);
+    Type t = a.type();
+    return Internal::make_arithmetic_intrinsic(Internal::Call::widening_mul, t.with_bits(t.bits() * 2),
+                                               std::move(a), std::move(b));
+}
+
 /** Returns an expression similar to the ternary operator in C, except
  * that it always evaluates all arguments. If the first argument is
  * true, then return the second, else return the third. Typically
@@ -1231,6 +1302,16 @@ inline Expr fast_inverse_sqrt(Expr x) {
     return Internal::Call::make(t, "fast_inverse_sqrt_f32", {std::move(x)}, Internal::Call::PureExtern);
 }
 
+/** Round a Float(32) to bfloat16, the top half of a float32, with
+ * ties to even. There is no bfloat16 type, so the result is the bits
+ * as a UInt(16), which can be stored to halve the memory traffic of a
+ * Func. NaNs stay NaN. Vectorizes cleanly. */
+EXPORT Expr float_to_bfloat16(Expr x);
+
+/** Widen the bits of a bfloat16, stored as a UInt(16), to a
+ * Float(32). This is exact. Vectorizes cleanly. */
+EXPORT Expr bfloat16_to_float(Expr bits);
+
 /** Return the greatest whole number less than or equal to a
  * floating-point expression. If the argument is not floating-point,
  * it is cast to Float(32). The return value is still in floating
@@ -1721,6 +1802,47 @@ inline Expr random_int(Expr seed = Expr()) {
     return cast<int32_t>(random_uint(std::move(seed)));
 }
 
+namespace Internal {
+inline Expr make_counter_random(Type t, Expr seed, Expr stream) {
+    user_assert(seed.defined() && (seed.type() == Int(32) || seed.type() == UInt(32)))
+        << "The seed of a counter-based random number must have type Int(32) or UInt(32), but instead is "
+        << seed << " of type " << seed.type() << "\n";
+    user_assert(stream.defined() && (stream.type() == Int(32) || stream.type() == UInt(32)))
+        << "The stream of a counter-based random number must have type Int(32) or UInt(32), but instead is "
+        << stream << " of type " << stream.type() << "\n";
+    // Pure for the same reason as random().
+    return Call::make(t, Call::counter_random, {std::move(seed), std::move(stream)},
+                      Call::PureIntrinsic);
+}
+}
+
+/** Return a random variable representing a uniformly distributed
+ * unsigned 32-bit integer, from a counter-based generator
+ * (Threefry-2x32). The value is a fixed function of the seed, the
+ * stream, and the coordinates of the point being computed, so it is
+ * the same under any schedule, including parallel and vectorized
+ * ones, and it does not depend on the order in which Funcs are
+ * defined. Using a different stream gives an independent sequence
+ * for the same seed. Unlike random_uint, two calls with the same seed
+ * and stream in the same definition give the same value. It only
+ * uses adds, xors and shifts, so vectorizes cleanly. */
+inline Expr counter_random_uint(Expr seed, Expr stream = Expr(0)) {
+    return Internal::make_counter_random(UInt(32), std::move(seed), std::move(stream));
+}
+
+/** Return a random variable representing a uniformly distributed
+ * 32-bit integer. See \ref counter_random_uint. */
+inline Expr counter_random_int(Expr seed, Expr stream = Expr(0)) {
+    return Internal::make_counter_random(Int(32), std::move(seed), std::move(stream));
+}
+
+/** Return a random variable representing a uniformly distributed
+ * float in the half-open interval [0.0f, 1.0f). See \ref
+ * counter_random_uint. */
+inline Expr counter_random_float(Expr seed, Expr stream = Expr(0)) {
+    return Internal::make_counter_random(Float(32), std::move(seed), std::move(stream));
+}
+
 // Secondary args to print can be Exprs or const char *
 namespace Internal {
 inline NO_INLINE void collect_print_args(std::vector<Expr> &args) {
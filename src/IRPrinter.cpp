@@ -196,6 +196,36 @@ ostream &operator<<(ostream &out, const ForType &type) {
     case ForType::GPUThread:
         out << "gpu_thread";
         break;
+    case ForType::GPUWarpReduce:
+        out << "gpu_warp_reduce";
+        break;
+    case ForType::GPUTensorCore:
+        out << "gpu_tensor_core";
+        break;
+    }
+    return out;
+}
+
+ostream &operator<<(ostream &out, const VectorReduce::Operator &op) {
+    switch (op) {
+    case VectorReduce::Add:
+        out << "Add";
+        break;
+    case VectorReduce::Mul:
+        out << "Mul";
+        break;
+    case VectorReduce::Min:
+        out << "Min";
+        break;
+    case VectorReduce::Max:
+        out << "Max";
+        break;
+    case VectorReduce::And:
+        out << "And";
+        break;
+    case VectorReduce::Or:
+        out << "Or";
+        break;
     }
     return out;
 }
@@ -681,6 +711,16 @@ void IRPrinter::visit(const Prefetch *op) {
     stream << ")\n";
 }
 
+void IRPrinter::visit(const VectorReduce *op) {
+    stream << "("
+           << op->type
+           << ")vector_reduce_"
+           << op->op
+           << "(";
+    print(op->value);
+    stream << ")";
+}
+
 void IRPrinter::visit(const Block *op) {
     print(op->first);
     if (op->rest.defined()) print(op->rest);
@@ -60,6 +60,10 @@ EXPORT std::ostream &operator<<(std::ostream &stream, const Stmt &);
  * readable form */
 EXPORT std::ostream &operator<<(std::ostream &stream, const ForType &);
 
+/** Emit a horizontal vector reduction operator in a human-readable
+ * form */
+EXPORT std::ostream &operator<<(std::ostream &stream, const VectorReduce::Operator &);
+
 /** Emit a halide name mangling value in a human readable format */
 EXPORT std::ostream &operator<<(std::ostream &stream, const NameMangling &);
 
@@ -140,6 +144,7 @@ protected:
     void visit(const Evaluate *);
     void visit(const Shuffle *);
     void visit(const Prefetch *);
+    void visit(const VectorReduce *);
 };
 }
 }
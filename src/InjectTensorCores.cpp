@@ -0,0 +1,317 @@
+#include "InjectTensorCores.h"
+#include "DeviceInterface.h"
+#include "ExprUsesVar.h"
+#include "IREquality.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+#include "Simplify.h"
+#include "Substitute.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::pair;
+using std::string;
+using std::vector;
+
+namespace {
+
+// The only shape of wmma operation on half-precision matrices in ptx
+// isa 6.0 is m16n16k16.
+const int tile_size = 16;
+const int warp_size = 32;
+
+class SerializeTensorCoreLoops : public IRMutator {
+    using IRMutator::visit;
+
+    void visit(const For *op) {
+        Stmt body = mutate(op->body);
+        ForType for_type = op->for_type == ForType::GPUTensorCore ? ForType::Serial : op->for_type;
+        if (body.same_as(op->body) && for_type == op->for_type) {
+            stmt = op;
+        } else {
+            stmt = For::make(op->name, op->min, op->extent, for_type, op->device_api, body);
+        }
+    }
+};
+
+// One of the matrices of the multiplication: the index of its
+// element at the start of the loops, the distance between its rows
+// (or columns), and whether its rows are dense.
+struct Matrix {
+    Expr base, stride;
+    bool row_major;
+
+    string layout() const {
+        return row_major ? "row" : "col";
+    }
+};
+
+class InjectTensorCores : public IRMutator {
+    using IRMutator::visit;
+
+    const Target &target;
+
+    // The enclosing lets, innermost last, used to find loop extents
+    // and strides.
+    vector<pair<string, Expr>> lets;
+
+    int gpu_block_depth = 0, gpu_thread_depth = 0;
+
+    Expr resolve(Expr e) {
+        for (size_t i = lets.size(); i > 0; i--) {
+            if (expr_uses_var(e, lets[i-1].first)) {
+                e = substitute(lets[i-1].first, lets[i-1].second, e);
+            }
+        }
+        return simplify(e);
+    }
+
+    bool have_tensor_cores(DeviceAPI api) {
+        if (api == DeviceAPI::Default_GPU) {
+            api = get_default_device_api_for_target(target);
+        }
+        return api == DeviceAPI::CUDA && target.has_feature(Target::CUDACapability70);
+    }
+
+    void visit(const LetStmt *op) {
+        lets.push_back({op->name, op->value});
+        IRMutator::visit(op);
+        lets.pop_back();
+    }
+
+    // Find the layout of the matrix accessed at the given index, with
+    // rows indexed by the loop variable row and columns by col. The
+    // loops are given by their names and mins.
+    Matrix find_layout(Expr index, const string &row, const string &col,
+                       const vector<pair<string, Expr>> &loops, int element_bits,
+                       const string &what) {
+        auto stride_of = [&](const string &var) {
+            Expr next = substitute(var, Variable::make(Int(32), var) + 1, index);
+            Expr d = simplify(next - index);
+            for (const auto &l : loops) {
+                if (expr_uses_var(d, l.first)) {
+                    return Expr();
+                }
+            }
+            return d;
+        };
+        Expr row_stride = stride_of(row), col_stride = stride_of(col);
+        user_assert(row_stride.defined() && col_stride.defined())
+            << "Can't use tensor cores for " << what << ", because its index "
+            << index << " is not linear in the loops marked gpu_tensor_core.\n";
+
+        Matrix m;
+        if (is_one(resolve(col_stride))) {
+            m.row_major = true;
+            m.stride = row_stride;
+        } else if (is_one(resolve(row_stride))) {
+            m.row_major = false;
+            m.stride = col_stride;
+        } else {
+            user_error << "Can't use tensor cores for " << what << ", because neither "
+                       << "its rows nor its columns are dense.\n";
+        }
+
+        // The wmma instructions need the rows (or columns) to start
+        // on 16-byte boundaries.
+        const int64_t *s = as_const_int(resolve(m.stride));
+        user_assert(!s || (*s * element_bits) % 128 == 0)
+            << "Can't use tensor cores for " << what << ", because the stride of "
+            << *s << " elements between its " << (m.row_major ? "rows" : "columns")
+            << " is not a multiple of 16 bytes.\n";
+
+        m.base = index;
+        for (const auto &l : loops) {
+            m.base = substitute(l.first, l.second, m.base);
+        }
+        m.base = simplify(m.base);
+        return m;
+    }
+
+    void visit(const For *op) {
+        if (op->for_type != ForType::GPUTensorCore) {
+            int *depth = (op->for_type == ForType::GPUBlock ? &gpu_block_depth :
+                          op->for_type == ForType::GPUThread ? &gpu_thread_depth : nullptr);
+            if (depth) (*depth)++;
+            IRMutator::visit(op);
+            if (depth) (*depth)--;
+            return;
+        }
+
+        user_assert(gpu_block_depth > 0 && gpu_thread_depth == 0)
+            << "Loop " << op->name << " is marked gpu_tensor_core, so it must be "
+            << "inside a loop over gpu blocks and not inside a loop over gpu threads.\n";
+
+        // Find the three loops, and the lets between them.
+        vector<const For *> loops;
+        vector<pair<string, Expr>> inner_lets;
+        Stmt body = op;
+        while (true) {
+            if (const For *f = body.as<For>()) {
+                if (f->for_type != ForType::GPUTensorCore) {
+                    break;
+                }
+                loops.push_back(f);
+                body = f->body;
+            } else if (const LetStmt *l = body.as<LetStmt>()) {
+                inner_lets.push_back({l->name, l->value});
+                body = l->body;
+            } else {
+                break;
+            }
+        }
+        user_assert(loops.size() == 3)
+            << "Loop " << op->name << " is marked gpu_tensor_core, so it must be one "
+            << "of three directly nested loops marked gpu_tensor_core, but there are "
+            << loops.size() << ".\n";
+
+        if (!have_tensor_cores(op->device_api)) {
+            debug(1) << "No tensor cores for " << op->name << ", so multiplying serially\n";
+            stmt = SerializeTensorCoreLoops().mutate(op);
+            return;
+        }
+
+        auto inline_lets = [&](Expr e) {
+            for (size_t i = inner_lets.size(); i > 0; i--) {
+                if (expr_uses_var(e, inner_lets[i-1].first)) {
+                    e = substitute(inner_lets[i-1].first, inner_lets[i-1].second, e);
+                }
+            }
+            return e;
+        };
+
+        for (const For *f : loops) {
+            Expr extent = resolve(inline_lets(f->extent));
+            const int64_t *c = as_const_int(extent);
+            user_assert(c && *c == tile_size)
+                << "Loop " << f->name << " is marked gpu_tensor_core, so its extent must be "
+                << tile_size << ", but it is " << extent << ".\n";
+        }
+
+        // The body must be C(m, n) = C(m, n) + f32(A(m, k)) * f32(B(k, n)).
+        const Store *store = body.as<Store>();
+        user_assert(store && is_one(store->predicate))
+            << "Loop " << op->name << " is marked gpu_tensor_core, so the body of the "
+            << "loops must be a single update of a Func with one value.\n";
+        Expr value = inline_lets(store->value);
+        Expr c_index = inline_lets(store->index);
+
+        auto is_c = [&](Expr e) {
+            const Load *l = e.as<Load>();
+            return l && l->name == store->name && equal(l->index, c_index);
+        };
+        auto half_load = [](Expr e) -> const Load * {
+            const Cast *c = e.as<Cast>();
+            if (!c || c->type != Float(32)) {
+                return nullptr;
+            }
+            const Load *l = c->value.as<Load>();
+            return (l && l->type == Float(16)) ? l : nullptr;
+        };
+        const Mul *mul = nullptr;
+        if (const Add *add = value.as<Add>()) {
+            mul = is_c(add->a) ? add->b.as<Mul>() : is_c(add->b) ? add->a.as<Mul>() : nullptr;
+        }
+        const Load *a_load = mul ? half_load(mul->a) : nullptr;
+        const Load *b_load = mul ? half_load(mul->b) : nullptr;
+        user_assert(value.type() == Float(32) && a_load && b_load)
+            << "Loop " << op->name << " is marked gpu_tensor_core, so the update must be "
+            << "of the form f(...) = f(...) + f32(a) * f32(b), where f is a Func of "
+            << "type float, and a and b are values of type float16.\n";
+
+        // k is the loop C doesn't depend on. Of the other two, m is
+        // the one the first of the two loads depends on.
+        auto uses = [&](Expr e, const For *f) {
+            return expr_uses_var(e, f->name);
+        };
+        const For *k = nullptr;
+        vector<const For *> others;
+        for (const For *f : loops) {
+            if (uses(c_index, f)) {
+                others.push_back(f);
+            } else {
+                k = f;
+            }
+        }
+        const For *m = nullptr, *n = nullptr;
+        if (k && others.size() == 2) {
+            bool uses_first = uses(a_load->index, others[0]);
+            bool uses_second = uses(a_load->index, others[1]);
+            if (uses_first != uses_second) {
+                m = uses_first ? others[0] : others[1];
+                n = uses_first ? others[1] : others[0];
+            }
+        }
+        user_assert(m && uses(a_load->index, k) &&
+                    uses(b_load->index, k) && uses(b_load->index, n) && !uses(b_load->index, m))
+            << "Loop " << op->name << " is marked gpu_tensor_core, but the update is "
+            << "not a matrix multiplication over the three loops.\n";
+
+        vector<pair<string, Expr>> mins;
+        for (const For *f : loops) {
+            mins.push_back({f->name, inline_lets(f->min)});
+        }
+        Matrix a = find_layout(a_load->index, m->name, k->name, mins, 16, "the load from " + a_load->name);
+        Matrix b = find_layout(b_load->index, k->name, n->name, mins, 16, "the load from " + b_load->name);
+        Matrix c = find_layout(c_index, m->name, n->name, mins, 32, "the update of " + store->name);
+
+        // Every thread of the warp takes part in each wmma operation,
+        // so the loop variable isn't used.
+        string prefix = op->name + ".wmma";
+        Expr a_stride = Variable::make(Int(32), prefix + "_a_stride");
+        Expr b_stride = Variable::make(Int(32), prefix + "_b_stride");
+        Expr c_stride = Variable::make(Int(32), prefix + "_c_stride");
+        Expr a_frag = Variable::make(UInt(32, 8), prefix + "_a");
+        Expr b_frag = Variable::make(UInt(32, 8), prefix + "_b");
+        Expr c_frag = Variable::make(Float(32, 8), prefix + "_c");
+        Expr d_frag = Variable::make(Float(32, 8), prefix + "_d");
+
+        Expr load_a = Call::make(a_frag.type(), "halide_ptx_wmma_load_a_" + a.layout(),
+                                 {Load::make(Float(16), a_load->name, a.base, a_load->image,
+                                             a_load->param, const_true()), a_stride},
+                                 Call::Extern);
+        Expr load_b = Call::make(b_frag.type(), "halide_ptx_wmma_load_b_" + b.layout(),
+                                 {Load::make(Float(16), b_load->name, b.base, b_load->image,
+                                             b_load->param, const_true()), b_stride},
+                                 Call::Extern);
+        Expr load_c = Call::make(c_frag.type(), "halide_ptx_wmma_load_c_" + c.layout(),
+                                 {Load::make(Float(32), store->name, c.base, Buffer<>(),
+                                             store->param, const_true()), c_stride},
+                                 Call::Extern);
+        Expr mma = Call::make(d_frag.type(), "halide_ptx_wmma_mma_" + a.layout() + "_" + b.layout(),
+                              {a_frag, b_frag, c_frag}, Call::Extern);
+        Expr store_d = Call::make(Float(32), "halide_ptx_wmma_store_d_" + c.layout(),
+                                  {d_frag, c_stride}, Call::Extern);
+
+        Stmt s = Store::make(store->name, store_d, c.base, store->param, const_true());
+        s = LetStmt::make(prefix + "_d", mma, s);
+        s = LetStmt::make(prefix + "_c", load_c, s);
+        s = LetStmt::make(prefix + "_b", load_b, s);
+        s = LetStmt::make(prefix + "_a", load_a, s);
+        s = LetStmt::make(prefix + "_c_stride", cast(Int(32), c.stride), s);
+        s = LetStmt::make(prefix + "_b_stride", cast(Int(32), b.stride), s);
+        s = LetStmt::make(prefix + "_a_stride", cast(Int(32), a.stride), s);
+
+        debug(1) << "Multiplying " << a_load->name << " by " << b_load->name
+                 << " into " << store->name << " on the tensor cores, with layouts "
+                 << a.layout() << ", " << b.layout() << " and " << c.layout() << "\n";
+
+        // The loop is already past canonicalize_gpu_vars, so it gets
+        // the canonical name directly.
+        stmt = For::make(op->name + ".__thread_id_x", 0, warp_size,
+                         ForType::GPUThread, op->device_api, s);
+    }
+
+public:
+    InjectTensorCores(const Target &t) : target(t) {}
+};
+
+}  // namespace
+
+Stmt inject_tensor_cores(Stmt s, const Target &t) {
+    return InjectTensorCores(t).mutate(s);
+}
+
+}
+}
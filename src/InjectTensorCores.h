@@ -0,0 +1,29 @@
+#ifndef HALIDE_INJECT_TENSOR_CORES_H
+#define HALIDE_INJECT_TENSOR_CORES_H
+
+/** \file
+ * Defines the lowering pass that turns matrix multiplications
+ * scheduled with gpu_tensor_core into wmma operations.
+ */
+
+#include "IR.h"
+#include "Target.h"
+
+namespace Halide {
+namespace Internal {
+
+/** Rewrite each nest of three loops marked gpu_tensor_core, which
+ * must compute C(m, n) += f32(A(m, k)) * f32(B(k, n)) over a 16x16x16
+ * tile of half-precision A and B and single-precision C, into a loop
+ * over the 32 gpu threads of a warp that load the tiles into
+ * fragments, multiply them on the tensor cores, and store the result
+ * back. Where tensor cores aren't available (anything but CUDA with
+ * compute capability 7.0), the loops become serial loops
+ * instead. Must be called after storage flattening, and before the
+ * gpu thread loops are fused. */
+Stmt inject_tensor_cores(Stmt s, const Target &t);
+
+}
+}
+
+#endif
@@ -0,0 +1,226 @@
+#include "InjectWarpShuffles.h"
+#include "DeviceInterface.h"
+#include "ExprUsesVar.h"
+#include "IREquality.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+#include "Simplify.h"
+#include "Substitute.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::pair;
+using std::string;
+using std::vector;
+
+namespace {
+
+const int warp_size = 32;
+
+class CallsFunc : public IRVisitor {
+    using IRVisitor::visit;
+
+    const string &func;
+
+    void visit(const Call *op) {
+        IRVisitor::visit(op);
+        if (op->name == func && op->call_type == Call::Halide) {
+            result = true;
+        }
+    }
+
+public:
+    bool result = false;
+    CallsFunc(const string &f) : func(f) {}
+};
+
+bool calls_func(Expr e, const string &func) {
+    CallsFunc c(func);
+    e.accept(&c);
+    return c.result;
+}
+
+// Move the value of the given lane of the warp, plus delta, into the
+// given lane. Lanes past the end of the warp get their own value.
+Expr shuffle_down(Expr v, int delta) {
+    Type t = v.type();
+    if (t.is_float()) {
+        return Call::make(Float(32), "halide_ptx_shfl_down_f32", {v, delta}, Call::Extern);
+    }
+    Expr wide = t.bits() == 32 ? reinterpret(Int(32), v) : cast(Int(32), v);
+    Expr shuffled = Call::make(Int(32), "halide_ptx_shfl_down_i32", {wide, delta}, Call::Extern);
+    return t.bits() == 32 ? reinterpret(t, shuffled) : cast(t, shuffled);
+}
+
+class InjectWarpShuffles : public IRMutator {
+    using IRMutator::visit;
+
+    const Target &target;
+
+    // The enclosing lets, innermost last, used to find loop extents.
+    vector<pair<string, Expr>> lets;
+
+    int gpu_block_depth = 0, gpu_thread_depth = 0;
+
+    Expr resolve(Expr e) {
+        for (size_t i = lets.size(); i > 0; i--) {
+            if (expr_uses_var(e, lets[i-1].first)) {
+                e = substitute(lets[i-1].first, lets[i-1].second, e);
+            }
+        }
+        return simplify(e);
+    }
+
+    bool have_shuffles(DeviceAPI api) {
+        if (api == DeviceAPI::Default_GPU) {
+            api = get_default_device_api_for_target(target);
+        }
+        return (api == DeviceAPI::CUDA &&
+                target.features_any_of({Target::CUDACapability30,
+                                        Target::CUDACapability32,
+                                        Target::CUDACapability35,
+                                        Target::CUDACapability50,
+                                        Target::CUDACapability61,
+                                        Target::CUDACapability70}));
+    }
+
+    void visit(const LetStmt *op) {
+        lets.push_back({op->name, op->value});
+        IRMutator::visit(op);
+        lets.pop_back();
+    }
+
+    void visit(const For *op) {
+        if (op->for_type != ForType::GPUWarpReduce) {
+            int *depth = (op->for_type == ForType::GPUBlock ? &gpu_block_depth :
+                          op->for_type == ForType::GPUThread ? &gpu_thread_depth : nullptr);
+            if (depth) (*depth)++;
+            IRMutator::visit(op);
+            if (depth) (*depth)--;
+            return;
+        }
+
+        user_assert(gpu_block_depth > 0 && gpu_thread_depth == 0)
+            << "Loop " << op->name << " is marked gpu_warp_reduce, so it must be "
+            << "inside a loop over gpu blocks and not inside a loop over gpu threads.\n";
+        Expr extent = resolve(op->extent);
+        const int64_t *c = as_const_int(extent);
+        user_assert(c && *c == warp_size)
+            << "Loop " << op->name << " is marked gpu_warp_reduce, so its extent must be "
+            << warp_size << ", but it is " << extent << ".\n";
+
+        Stmt body = mutate(op->body);
+
+        if (!have_shuffles(op->device_api)) {
+            debug(1) << "No warp shuffles for " << op->name << ", so reducing serially\n";
+            stmt = For::make(op->name, op->min, op->extent, ForType::Serial, op->device_api, body);
+            return;
+        }
+
+        // Find the update inside any lets.
+        vector<pair<string, Expr>> body_lets;
+        while (const LetStmt *l = body.as<LetStmt>()) {
+            body_lets.push_back({l->name, l->value});
+            body = l->body;
+        }
+        const Provide *p = body.as<Provide>();
+        user_assert(p && p->values.size() == 1)
+            << "Loop " << op->name << " is marked gpu_warp_reduce, so its body must be "
+            << "a single update of a Func with one value.\n";
+        for (Expr arg : p->args) {
+            user_assert(!expr_uses_var(arg, op->name))
+                << "Loop " << op->name << " is marked gpu_warp_reduce, so the site it updates "
+                << "must not depend on it.\n";
+        }
+
+        // The update must combine the old value with one new term
+        // with an associative and commutative operator.
+        auto is_self = [&](Expr e) {
+            const Call *call = e.as<Call>();
+            if (!call || call->name != p->name || call->call_type != Call::Halide ||
+                call->value_index != 0 || call->args.size() != p->args.size()) {
+                return false;
+            }
+            for (size_t i = 0; i < p->args.size(); i++) {
+                if (!equal(call->args[i], p->args[i])) {
+                    return false;
+                }
+            }
+            return true;
+        };
+        Expr value = p->values[0], a, b;
+        if (const Add *add = value.as<Add>()) {
+            a = add->a;
+            b = add->b;
+        } else if (const Mul *mul = value.as<Mul>()) {
+            a = mul->a;
+            b = mul->b;
+        } else if (const Min *min = value.as<Min>()) {
+            a = min->a;
+            b = min->b;
+        } else if (const Max *max = value.as<Max>()) {
+            a = max->a;
+            b = max->b;
+        }
+        bool self_first = a.defined() && is_self(a);
+        Expr term = self_first ? b : a;
+        user_assert(a.defined() && (self_first || is_self(b)) && !calls_func(term, p->name))
+            << "Loop " << op->name << " is marked gpu_warp_reduce, so the update of "
+            << p->name << " must be of the form " << p->name << "(...) = " << p->name
+            << "(...) op term, where op is +, *, min or max, and term does not use "
+            << p->name << ".\n";
+        Type t = term.type();
+        user_assert(t.bits() <= 32 && (!t.is_float() || t.bits() == 32))
+            << "gpu_warp_reduce does not support reductions of type " << t << ".\n";
+
+        auto combine = [&](Expr x, Expr y) {
+            if (value.as<Add>()) {
+                return Add::make(x, y);
+            } else if (value.as<Mul>()) {
+                return Mul::make(x, y);
+            } else if (value.as<Min>()) {
+                return Min::make(x, y);
+            } else {
+                return Max::make(x, y);
+            }
+        };
+
+        // Each thread computes one term, and then the terms are
+        // combined in a tree. After the step for delta, the first
+        // delta lanes each hold the combination of 32 / delta terms.
+        vector<pair<string, Expr>> steps;
+        string name = op->name + ".warp_term";
+        steps.push_back({name, term});
+        for (int delta = warp_size / 2; delta > 0; delta /= 2) {
+            Expr prev = Variable::make(t, name);
+            name = op->name + ".warp_reduce_" + std::to_string(delta);
+            steps.push_back({name, combine(prev, shuffle_down(prev, delta))});
+        }
+        Expr total = Variable::make(t, name);
+
+        Expr self = self_first ? a : b;
+        Expr updated = self_first ? combine(self, total) : combine(total, self);
+        Expr lane = Variable::make(Int(32), op->name) - op->min;
+        Stmt s = IfThenElse::make(lane == 0, Provide::make(p->name, {updated}, p->args));
+        for (size_t i = steps.size(); i > 0; i--) {
+            s = LetStmt::make(steps[i-1].first, steps[i-1].second, s);
+        }
+        for (size_t i = body_lets.size(); i > 0; i--) {
+            s = LetStmt::make(body_lets[i-1].first, body_lets[i-1].second, s);
+        }
+        stmt = For::make(op->name, op->min, op->extent, ForType::GPUThread, op->device_api, s);
+    }
+
+public:
+    InjectWarpShuffles(const Target &t) : target(t) {}
+};
+
+}  // namespace
+
+Stmt inject_warp_shuffles(Stmt s, const Target &t) {
+    return InjectWarpShuffles(t).mutate(s);
+}
+
+}
+}
@@ -0,0 +1,27 @@
+#ifndef HALIDE_INJECT_WARP_SHUFFLES_H
+#define HALIDE_INJECT_WARP_SHUFFLES_H
+
+/** \file
+ * Defines the lowering pass that turns reductions marked
+ * gpu_warp_reduce into trees of warp shuffles.
+ */
+
+#include "IR.h"
+#include "Target.h"
+
+namespace Halide {
+namespace Internal {
+
+/** Rewrite each loop marked gpu_warp_reduce into a loop over 32 gpu
+ * threads, in which each thread computes one term of the reduction,
+ * the terms are combined in registers by shuffling them down the
+ * warp, and the first thread alone updates the result. Where warp
+ * shuffles aren't available (anything but CUDA with compute
+ * capability 3.0 or higher), the loop becomes a serial loop
+ * instead. Must be called before canonicalize_gpu_vars. */
+Stmt inject_warp_shuffles(Stmt s, const Target &t);
+
+}
+}
+
+#endif
@@ -8,6 +8,9 @@
 
 #include <string>
 #include <iostream>
+#include <atomic>
+#include <mutex>
+#include <set>
 #include <sstream>
 #include <stdio.h>
 
@@ -158,6 +161,13 @@ class DebugSections {
     };
     vector<TypeInfo> types;
 
+    // The offsets into debug_line of the line tables of the
+    // compilation units that include Halide.h. Only those can be
+    // queried (see test_compilation_unit), so the debug info of all
+    // the others is skipped. Empty if none could be found, in which
+    // case everything is parsed.
+    std::set<uint64_t> halide_line_tables;
+
 public:
 
     bool working;
@@ -928,6 +938,11 @@ private:
             return;
         }
 
+        {
+            llvm::DataExtractor e(debug_line, true, obj->getBytesInAddress());
+            find_halide_line_tables(e);
+        }
+
         {
             // Parse the debug_info section to populate the functions and local variables
             llvm::DataExtractor extractor(debug_info, true, obj->getBytesInAddress());
@@ -941,6 +956,62 @@ private:
         }
     }
 
+    // Find the line tables that list Halide.h (or Introspection.h)
+    // among their source files. Only the headers of the line tables
+    // are read.
+    void find_halide_line_tables(const llvm::DataExtractor &e) {
+        uint32_t off = 0;
+        while (1) {
+            uint32_t unit_start = off;
+            uint32_t unit_length = e.getU32(&off);
+            if (unit_length == 0) {
+                break;
+            }
+            uint32_t unit_end = off + unit_length;
+            uint16_t version = e.getU16(&off);
+            if (unit_length == 0xffffffff || version < 2 || version > 4) {
+                // We don't understand this header.
+                halide_line_tables.clear();
+                return;
+            }
+            uint32_t header_length = e.getU32(&off);
+            uint32_t end_header_off = off + header_length;
+            off += (version >= 4) ? 5 : 4;
+            uint8_t opcode_base = e.getU8(&off);
+            off += opcode_base - 1;
+
+            // Skip the include directories
+            while (off < end_header_off) {
+                const char *s = e.getCStr(&off);
+                if (!s || !s[0]) {
+                    break;
+                }
+            }
+
+            while (off < end_header_off) {
+                const char *name = e.getCStr(&off);
+                if (!name || !name[0]) {
+                    break;
+                }
+                e.getULEB128(&off);
+                e.getULEB128(&off);
+                e.getULEB128(&off);
+                std::string file = name;
+                size_t slash = file.rfind('/');
+                if (slash != std::string::npos) {
+                    file = file.substr(slash + 1);
+                }
+                if (file == "Halide.h" || file == "Introspection.h") {
+                    halide_line_tables.insert(unit_start);
+                    break;
+                }
+            }
+
+            off = unit_end;
+        }
+        debug(5) << "Found " << halide_line_tables.size() << " compilation units that include Halide.h\n";
+    }
+
     void parse_debug_ranges(const llvm::DataExtractor &e) {
 
     }
@@ -1026,6 +1097,7 @@ private:
             int stack_depth = 0;
 
             uint64_t compile_unit_base_pc = 0;
+            bool skip_unit = false;
 
             // From the dwarf 4 spec
             const unsigned tag_array_type = 0x01;
@@ -1050,6 +1122,7 @@ private:
             const unsigned attr_byte_size = 0x0b;
             const unsigned attr_low_pc = 0x11;
             const unsigned attr_high_pc = 0x12;
+            const unsigned attr_stmt_list = 0x10;
             const unsigned attr_upper_bound = 0x2f;
             const unsigned attr_abstract_origin = 0x31;
             const unsigned attr_count = 0x37;
@@ -1518,11 +1591,19 @@ private:
                     } else if (fmt.tag == tag_compile_unit) {
                         if (attr == attr_low_pc) {
                             compile_unit_base_pc = val;
+                        } else if (attr == attr_stmt_list) {
+                            skip_unit = !halide_line_tables.empty() && !halide_line_tables.count(val);
                         }
                     }
 
                 }
 
+                if (skip_unit) {
+                    // Nothing in this compilation unit can be queried.
+                    off = start_of_unit + unit_length;
+                    continue;
+                }
+
                 if (fmt.tag == tag_variable) {
                     if (func_stack.size() && !gvar.addr) {
                         if (live_range_stack.size()) {
@@ -1846,6 +1927,7 @@ private:
         // For every compilation unit
         while (1) {
             // Parse the header
+            uint32_t unit_start = off;
             uint32_t unit_length = e.getU32(&off);
 
             if (unit_length == 0) {
@@ -1855,6 +1937,11 @@ private:
 
             uint32_t unit_end = off + unit_length;
 
+            if (!halide_line_tables.empty() && !halide_line_tables.count(unit_start)) {
+                off = unit_end;
+                continue;
+            }
+
             debug(5) << "Parsing compilation unit from " << off << " to " << unit_end << "\n";
 
             uint16_t version = e.getU16(&off);
@@ -2161,51 +2248,174 @@ private:
 };
 
 namespace {
+
 DebugSections *debug_sections = nullptr;
+
+// The debug info is only loaded, and the compilation units tested,
+// when it is first needed. Once it has been, the queries go straight
+// to it without taking the lock.
+std::atomic<bool> loaded(false);
+bool loading = false;
+
+// -1 if off, 1 if on, or 0 if it hasn't been decided yet.
+std::atomic<int> enabled_state(0);
+
+struct PendingTest {
+    bool (*test)(bool (*)(const void *, const std::string &));
+    bool (*test_a)(const void *, const std::string &);
+    void (*calib)();
+};
+
+// These are used during static initialization, so they can't be
+// globals of their own.
+std::recursive_mutex &introspection_lock() {
+    static std::recursive_mutex lock;
+    return lock;
+}
+
+vector<PendingTest> &pending_tests() {
+    static vector<PendingTest> tests;
+    return tests;
+}
+
+map<const void *, pair<size_t, const void *>> &pending_heap_objects() {
+    static map<const void *, pair<size_t, const void *>> objects;
+    return objects;
+}
+
+bool introspection_enabled() {
+    int state = enabled_state;
+    if (state == 0) {
+        state = (get_env_variable("HL_INTROSPECTION") == "0") ? -1 : 1;
+        enabled_state = state;
+    }
+    return state > 0;
+}
+
+bool saves_frame_pointer(void *fn) {
+    // On x86-64, if we save the frame pointer, the first two instructions should be pushing the stack pointer and the frame pointer:
+    const uint8_t *ptr = (const uint8_t *)(fn);
+    return ptr[0] == 0x55; // push %rbp
+}
+
+void run_test(const PendingTest &t) {
+    debug(5) << "Testing compilation unit with offset_marker at " << reinterpret_bits<void *>(t.calib) << "\n";
+
+    if (!saves_frame_pointer(reinterpret_bits<void *>(&test_compilation_unit)) ||
+        !saves_frame_pointer(reinterpret_bits<void *>(t.test))) {
+        // Make sure libHalide and the test compilation unit both save the frame pointer
+        debug_sections->working = false;
+        debug(5) << "Failed because frame pointer not saved\n";
+    } else if (debug_sections->working) {
+        debug_sections->calibrate_pc_offset(t.calib);
+        if (!debug_sections->working) {
+            debug(5) << "Failed because offset calibration failed\n";
+            return;
+        }
+
+        debug_sections->working = (*t.test)(t.test_a);
+        if (!debug_sections->working) {
+            debug(5) << "Failed because test routine failed\n";
+            return;
+        }
+
+        debug(5) << "Test passed\n";
+    }
+
+    //debug_sections->dump();
+}
+
+// Get the debug info, loading it and running the pending tests if
+// this is the first time it's needed. Returns null if introspection
+// is off or isn't working.
+DebugSections *get_debug_sections() {
+    if (!introspection_enabled()) {
+        return nullptr;
+    }
+    if (!loaded) {
+        std::lock_guard<std::recursive_mutex> lock(introspection_lock());
+        // The tests run below query the debug info themselves.
+        if (!loaded && !loading) {
+            loading = true;
+            char path[2048];
+            get_program_name(path, sizeof(path));
+            debug_sections = new DebugSections(path);
+            for (const PendingTest &t : pending_tests()) {
+                run_test(t);
+            }
+            pending_tests().clear();
+            if (debug_sections->working) {
+                for (const auto &h : pending_heap_objects()) {
+                    debug_sections->register_heap_object(h.first, h.second.first, h.second.second);
+                }
+            }
+            pending_heap_objects().clear();
+            loading = false;
+            loaded = true;
+        }
+    }
+    if (!debug_sections || !debug_sections->working) {
+        return nullptr;
+    }
+    return debug_sections;
+}
+
 }
 
 std::string get_variable_name(const void *var, const std::string &expected_type) {
-    if (!debug_sections) return "";
-    if (!debug_sections->working) return "";
-    std::string name = debug_sections->get_stack_variable_name(var, expected_type);
+    DebugSections *ds = get_debug_sections();
+    if (!ds) return "";
+    std::string name = ds->get_stack_variable_name(var, expected_type);
     if (name.empty()) {
         // Maybe it's a member of a heap object.
-        name = debug_sections->get_heap_member_name(var, expected_type);
+        name = ds->get_heap_member_name(var, expected_type);
     }
     if (name.empty()) {
         // Maybe it's a global
-        name = debug_sections->get_global_variable_name(var, expected_type);
+        name = ds->get_global_variable_name(var, expected_type);
     }
 
     return name;
 }
 
 std::string get_source_location() {
-    if (!debug_sections) return "";
-    if (!debug_sections->working) return "";
-    return debug_sections->get_source_location();
+    DebugSections *ds = get_debug_sections();
+    if (!ds) return "";
+    return ds->get_source_location();
 }
 
 void register_heap_object(const void *obj, size_t size, const void *helper) {
-    if (!debug_sections) return;
-    if (!debug_sections->working) return;
     if (!helper) return;
+    if (!introspection_enabled()) return;
+    if (!loaded) {
+        std::lock_guard<std::recursive_mutex> lock(introspection_lock());
+        if (!loaded) {
+            // Don't load the debug info just for this. Remember the
+            // object until it is needed.
+            pending_heap_objects()[obj] = {size, helper};
+            return;
+        }
+    }
+    if (!debug_sections || !debug_sections->working) return;
     debug_sections->register_heap_object(obj, size, helper);
 }
 
 void deregister_heap_object(const void *obj, size_t size) {
-    if (!debug_sections) return;
-    if (!debug_sections->working) return;
+    if (!loaded) {
+        std::lock_guard<std::recursive_mutex> lock(introspection_lock());
+        if (!loaded) {
+            pending_heap_objects().erase(obj);
+            return;
+        }
+    }
+    if (!debug_sections || !debug_sections->working) return;
     debug_sections->deregister_heap_object(obj, size);
 }
 
-bool saves_frame_pointer(void *fn) {
-    // On x86-64, if we save the frame pointer, the first two instructions should be pushing the stack pointer and the frame pointer:
-    const uint8_t *ptr = (const uint8_t *)(fn);
-    return ptr[0] == 0x55; // push %rbp
+void set_enabled(bool enabled) {
+    enabled_state = enabled ? 1 : -1;
 }
 
-
 void test_compilation_unit(bool (*test)(bool (*)(const void *, const std::string &)),
                            bool (*test_a)(const void *, const std::string &),
                            void (*calib)()) {
@@ -2218,37 +2428,15 @@ void test_compilation_unit(bool (*test)(bool (*)(const void *, const std::string
         return;
     }
 
-    debug(5) << "Testing compilation unit with offset_marker at " << reinterpret_bits<void *>(calib) << "\n";
-
-    if (!debug_sections) {
-        char path[2048];
-        get_program_name(path, sizeof(path));
-        debug_sections = new DebugSections(path);
-    }
-
-    if (!saves_frame_pointer(reinterpret_bits<void *>(&test_compilation_unit)) ||
-        !saves_frame_pointer(reinterpret_bits<void *>(test))) {
-        // Make sure libHalide and the test compilation unit both save the frame pointer
-        debug_sections->working = false;
-        debug(5) << "Failed because frame pointer not saved\n";
-    } else if (debug_sections->working) {
-        debug_sections->calibrate_pc_offset(calib);
-        if (!debug_sections->working) {
-            debug(5) << "Failed because offset calibration failed\n";
-            return;
-        }
-
-        debug_sections->working = (*test)(test_a);
-        if (!debug_sections->working) {
-            debug(5) << "Failed because test routine failed\n";
-            return;
-        }
-
-        debug(5) << "Test passed\n";
+    std::lock_guard<std::recursive_mutex> lock(introspection_lock());
+    PendingTest t = {test, test_a, calib};
+    if (loaded && debug_sections) {
+        // A compilation unit loaded after the debug info was.
+        run_test(t);
+    } else if (!loaded) {
+        pending_tests().push_back(t);
     }
 
-    //debug_sections->dump();
-
     #endif
 }
 
@@ -2276,6 +2464,9 @@ void register_heap_object(const void *obj, size_t size, const void *helper) {
 void deregister_heap_object(const void *obj, size_t size) {
 }
 
+void set_enabled(bool enabled) {
+}
+
 void test_compilation_unit(bool (*test)(bool (*)(const void *, const std::string &)),
                            bool (*test_a)(const void *, const std::string &),
                            void (*calib)()) {
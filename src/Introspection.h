@@ -46,9 +46,19 @@ const void *get_introspection_helper() {
  * the Halide namespace. */
 EXPORT std::string get_source_location();
 
+/** Turn introspection on or off. It is on unless the environment
+ * variable HL_INTROSPECTION is set to 0. The debug info of the
+ * program is only read the first time a name or source location is
+ * asked for (typically when the first Func or Var is made without a
+ * name), and only for the compilation units that include Halide.h, so
+ * turning it off before then avoids reading it at all. Names fall
+ * back to unique ones while it is off. */
+EXPORT void set_enabled(bool enabled);
+
 // This gets called automatically by anyone who includes Halide.h by
 // the code below. It tests if this functionality works for the given
-// compilation unit, and disables it if not.
+// compilation unit, and disables it if not. The test is deferred
+// until the debug info is first needed.
 EXPORT void test_compilation_unit(bool (*test)(bool (*)(const void *, const std::string &)),
                                   bool (*test_a)(const void *, const std::string &),
                                   void (*calib)());
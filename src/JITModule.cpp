@@ -136,6 +136,8 @@ public:
     std::map<std::string, JITModule::Symbol> exports;
     llvm::LLVMContext context;
     ExecutionEngine *execution_engine;
+    // Must outlive the execution engine, which may consult it.
+    std::unique_ptr<llvm::ObjectCache> object_cache;
     std::vector<JITModule> dependencies;
     JITModule::Symbol entrypoint;
     JITModule::Symbol argv_entrypoint;
@@ -233,6 +235,75 @@ public:
     }
 };
 
+// An on-disk cache of compiled objects, enabled by setting
+// HL_JIT_CACHE_DIR. Objects are keyed by a hash of the textual llvm
+// IR (which captures the lowered pipeline, its schedule, and the
+// target triple and data layout) combined with the cpu, the target
+// features, and the llvm version. A hit skips llvm's code generation,
+// which dominates the cost of jitting the runtime and large pipelines.
+class HalideJITObjectCache : public llvm::ObjectCache {
+    std::string dir, key;
+
+public:
+    HalideJITObjectCache(const std::string &dir, const llvm::Module &m,
+                         const std::string &mcpu, const std::string &mattrs) : dir(dir) {
+        std::string ir;
+        llvm::raw_string_ostream ir_stream(ir);
+        m.print(ir_stream, nullptr);
+        ir_stream.flush();
+
+        llvm::MD5 hasher;
+        hasher.update(ir);
+        hasher.update(mcpu);
+        hasher.update(mattrs);
+        hasher.update(std::to_string(LLVM_VERSION));
+        llvm::MD5::MD5Result result;
+        hasher.final(result);
+        llvm::SmallString<32> digest;
+        llvm::MD5::stringifyResult(result, digest);
+        key = digest.str();
+
+        llvm::sys::fs::create_directories(dir);
+    }
+
+    std::string path() const {
+        return dir + "/" + key + ".o";
+    }
+
+    virtual void notifyObjectCompiled(const llvm::Module *, llvm::MemoryBufferRef obj) override {
+        // Write to a temporary and rename it into place, so that
+        // concurrent processes never see a partially written object.
+        std::string tmp = path() + ".tmp" + std::to_string((uintptr_t)this);
+        std::error_code err;
+        {
+            llvm::raw_fd_ostream out(tmp, err, llvm::sys::fs::F_None);
+            if (err) {
+                debug(1) << "Could not write JIT cache entry " << tmp << ": " << err.message() << "\n";
+                return;
+            }
+            out.write(obj.getBufferStart(), obj.getBufferSize());
+        }
+        err = llvm::sys::fs::rename(tmp, path());
+        if (err) {
+            debug(1) << "Could not write JIT cache entry " << path() << ": " << err.message() << "\n";
+            llvm::sys::fs::remove(tmp);
+            return;
+        }
+        debug(2) << "Wrote JIT cache entry " << path() << "\n";
+    }
+
+    virtual std::unique_ptr<llvm::MemoryBuffer> getObject(const llvm::Module *) override {
+        llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> buf = llvm::MemoryBuffer::getFile(path());
+        if (!buf) {
+            debug(2) << "JIT cache miss for " << path() << "\n";
+            return nullptr;
+        }
+        debug(2) << "JIT cache hit for " << path() << "\n";
+        // MCJIT takes ownership of the buffer, so hand it a copy.
+        return llvm::MemoryBuffer::getMemBufferCopy((*buf)->getBuffer());
+    }
+};
+
 }
 
 JITModule::JITModule() {
@@ -269,6 +340,12 @@ void JITModule::compile_module(std::unique_ptr<llvm::Module> m, const string &fu
     DataLayout initial_module_data_layout = m->getDataLayout();
     string module_name = m->getModuleIdentifier();
 
+    std::unique_ptr<llvm::ObjectCache> object_cache;
+    string cache_dir = get_env_variable("HL_JIT_CACHE_DIR");
+    if (!cache_dir.empty()) {
+        object_cache.reset(new HalideJITObjectCache(cache_dir, *m, mcpu, mattrs));
+    }
+
     llvm::EngineBuilder engine_builder((std::move(m)));
     engine_builder.setTargetOptions(options);
     engine_builder.setErrorStr(&error_string);
@@ -297,6 +374,10 @@ void JITModule::compile_module(std::unique_ptr<llvm::Module> m, const string &fu
     if (!ee) std::cerr << error_string << "\n";
     internal_assert(ee) << "Couldn't create execution engine\n";
 
+    if (object_cache) {
+        ee->setObjectCache(object_cache.get());
+    }
+
     // Do any target-specific initialization
     std::vector<llvm::JITEventListener *> listeners;
 
@@ -350,6 +431,7 @@ void JITModule::compile_module(std::unique_ptr<llvm::Module> m, const string &fu
     jit_module->entrypoint = entrypoint;
     jit_module->argv_entrypoint = argv_entrypoint;
     jit_module->name = function_name;
+    jit_module->object_cache = std::move(object_cache);
 }
 
 const std::map<std::string, JITModule::Symbol> &JITModule::exports() const {
@@ -453,6 +535,14 @@ void JITModule::memoization_cache_set_size(int64_t size) const {
     }
 }
 
+void JITModule::stream_state_reset() const {
+    std::map<std::string, Symbol>::const_iterator f =
+        exports().find("halide_stream_state_reset");
+    if (f != exports().end()) {
+        return (reinterpret_bits<void (*)(void *)>(f->second.address))(nullptr);
+    }
+}
+
 bool JITModule::compiled() const {
   return jit_module->execution_engine != nullptr;
 }
@@ -858,5 +948,10 @@ void JITSharedRuntime::memoization_cache_set_size(int64_t size) {
     }
 }
 
+void JITSharedRuntime::stream_state_reset() {
+    std::lock_guard<std::mutex> lock(shared_runtimes_mutex);
+    shared_runtimes(MainShared).stream_state_reset();
+}
+
 }
 }
@@ -116,6 +116,10 @@ struct JITModule {
     /** Encapsulate device (GPU) and buffer interactions. */
     EXPORT void memoization_cache_set_size(int64_t size) const;
 
+    /** Free the state kept by streamed Funcs, if this module is a
+     * runtime. See \ref Func::stream */
+    EXPORT void stream_state_reset() const;
+
     /** Return true if compile_module has been called on this module. */
     EXPORT bool compiled() const;
 };
@@ -138,6 +142,9 @@ struct JITHandlers {
 struct JITUserContext {
     void *user_context;
     JITHandlers handlers;
+    // The cache of scratch memory used by the allocator a
+    // RealizationContext installs, if any.
+    void *scratch_memory{nullptr};
 };
 
 class JITSharedRuntime {
@@ -153,6 +160,13 @@ public:
      */
     EXPORT static void memoization_cache_set_size(int64_t size);
 
+    /** Start every stream computed by Funcs scheduled with
+     * Func::stream over, freeing the state kept for them.
+     * If you are compiling statically, you should include HalideRuntime.h
+     * and call halide_stream_state_reset() instead.
+     */
+    EXPORT static void stream_state_reset();
+
     EXPORT static void release_all();
 };
 
@@ -22,11 +22,14 @@
 #include <llvm/ExecutionEngine/MCJIT.h>
 #include <llvm/ExecutionEngine/SectionMemoryManager.h>
 #include <llvm/ExecutionEngine/JITEventListener.h>
+#include <llvm/ExecutionEngine/ObjectCache.h>
 
 #include <llvm/IR/Verifier.h>
 #include <llvm/Linker/Linker.h>
 #include "llvm/Support/ErrorHandling.h"
 #include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MD5.h>
+#include <llvm/Support/MemoryBuffer.h>
 #if LLVM_VERSION >= 40
 #include <llvm/Bitcode/BitcodeReader.h>
 #include <llvm/Bitcode/BitcodeWriter.h>
@@ -49,7 +52,9 @@
 #include <llvm/Target/TargetSubtargetInfo.h>
 #include <llvm/Transforms/IPO/PassManagerBuilder.h>
 #include <llvm/Transforms/IPO.h>
+#include <llvm/Transforms/Utils/Cloning.h>
 #include <llvm/Transforms/Utils/ModuleUtils.h>
+#include <llvm/Transforms/Utils/SplitModule.h>
 #include <llvm/Transforms/Utils/SymbolRewriter.h>
 #include "llvm/ADT/APFloat.h"
 #include "llvm/ADT/SmallVector.h"
@@ -4,6 +4,7 @@
 #include "CodeGen_LLVM.h"
 #include "CodeGen_C.h"
 #include "CodeGen_Internal.h"
+#include "ThreadPool.h"
 
 #include <iostream>
 #include <fstream>
@@ -363,6 +364,66 @@ void compile_llvm_module_to_object(llvm::Module &module, Internal::LLVMOStream&
     emit_file(module, out, llvm::TargetMachine::CGFT_ObjectFile);
 }
 
+std::vector<std::vector<char>> compile_llvm_module_to_object_partitions(llvm::Module &module, int num_partitions) {
+    std::vector<std::vector<char>> objects;
+    if (num_partitions <= 1) {
+        llvm::SmallVector<char, 4096> object;
+        llvm::raw_svector_ostream object_stream(object);
+        compile_llvm_module_to_object(module, object_stream);
+        objects.emplace_back(object.begin(), object.end());
+        return objects;
+    }
+
+    // Split a copy of the module, keeping internal symbols internal
+    // (which places them in the same partition as their users), so
+    // that the objects don't export anything the whole module
+    // wouldn't. llvm contexts aren't thread-safe, so each partition
+    // is handed over as bitcode and parsed into a context of its own.
+    std::vector<std::string> partitions;
+    llvm::SplitModule(llvm::CloneModule(&module), num_partitions,
+                      [&](std::unique_ptr<llvm::Module> part) {
+        bool has_definitions = false;
+        for (const llvm::GlobalValue &g : part->global_values()) {
+            has_definitions |= !g.isDeclaration();
+        }
+        if (!has_definitions) return;
+        std::string bitcode;
+        llvm::raw_string_ostream bitcode_stream(bitcode);
+        llvm::WriteBitcodeToFile(part.get(), bitcode_stream);
+        bitcode_stream.flush();
+        partitions.emplace_back(std::move(bitcode));
+    }, true);
+
+    Internal::debug(1) << "Compiling " << module.getModuleIdentifier() << " as "
+             << partitions.size() << " partitions\n";
+
+    size_t num_threads = std::min(partitions.size(), Internal::ThreadPool<std::vector<char>>::num_processors_online());
+    Internal::ThreadPool<std::vector<char>> pool(std::max((size_t)1, num_threads));
+    std::vector<std::future<std::vector<char>>> futures;
+    for (size_t i = 0; i < partitions.size(); i++) {
+        futures.emplace_back(pool.async([](const std::string *bitcode, size_t idx) {
+            llvm::LLVMContext context;
+            std::string id = "partition" + std::to_string(idx);
+            llvm::MemoryBufferRef buffer(*bitcode, id);
+#if LLVM_VERSION >= 40
+            auto part = llvm::expectedToErrorOr(llvm::parseBitcodeFile(buffer, context));
+#else
+            auto part = llvm::parseBitcodeFile(buffer, context);
+#endif
+            internal_assert(part) << "Could not parse " << id << ": " << part.getError().message() << "\n";
+
+            llvm::SmallVector<char, 4096> object;
+            llvm::raw_svector_ostream object_stream(object);
+            compile_llvm_module_to_object(**part, object_stream);
+            return std::vector<char>(object.begin(), object.end());
+        }, &partitions[i], i));
+    }
+    for (auto &f : futures) {
+        objects.push_back(f.get());
+    }
+    return objects;
+}
+
 void compile_llvm_module_to_assembly(llvm::Module &module, Internal::LLVMOStream& out) {
     emit_file(module, out, llvm::TargetMachine::CGFT_AssemblyFile);
 }
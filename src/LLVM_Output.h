@@ -39,6 +39,12 @@ EXPORT void compile_llvm_module_to_object(llvm::Module &module, Internal::LLVMOS
 EXPORT void compile_llvm_module_to_assembly(llvm::Module &module, Internal::LLVMOStream& out);
 // @}
 
+/** Compile an LLVM module to native object code, split into at most
+ * num_partitions objects that are code-generated in parallel. The
+ * objects are returned in a deterministic order, and between them
+ * define the same symbols as compile_llvm_module_to_object would. */
+EXPORT std::vector<std::vector<char>> compile_llvm_module_to_object_partitions(llvm::Module &module, int num_partitions);
+
 /** Compile an LLVM module to LLVM targets (bitcode, LLVM assembly). */
 // @{
 EXPORT void compile_llvm_module_to_llvm_bitcode(llvm::Module &module, Internal::LLVMOStream& out);
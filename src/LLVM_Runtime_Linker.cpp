@@ -1,6 +1,9 @@
 #include "LLVM_Runtime_Linker.h"
 #include "LLVM_Headers.h"
 
+#include <map>
+#include <mutex>
+
 namespace Halide {
 
 using std::string;
@@ -83,6 +86,7 @@ DECLARE_CPP_INITMOD(cuda)
 DECLARE_CPP_INITMOD(destructors)
 DECLARE_CPP_INITMOD(device_interface)
 DECLARE_CPP_INITMOD(errors)
+DECLARE_CPP_INITMOD(fake_perf_counters)
 DECLARE_CPP_INITMOD(fake_thread_pool)
 DECLARE_CPP_INITMOD(float16_t)
 DECLARE_CPP_INITMOD(gcd_thread_pool)
@@ -92,7 +96,9 @@ DECLARE_CPP_INITMOD(ios_io)
 DECLARE_CPP_INITMOD(linux_clock)
 DECLARE_CPP_INITMOD(linux_host_cpu_count)
 DECLARE_CPP_INITMOD(linux_opengl_context)
+DECLARE_CPP_INITMOD(linux_perf_counters)
 DECLARE_CPP_INITMOD(matlab)
+DECLARE_CPP_INITMOD(memoization_hash)
 DECLARE_CPP_INITMOD(metadata)
 DECLARE_CPP_INITMOD(mingw_math)
 DECLARE_CPP_INITMOD(module_aot_ref_count)
@@ -103,15 +109,18 @@ DECLARE_CPP_INITMOD(old_buffer_t)
 DECLARE_CPP_INITMOD(opencl)
 DECLARE_CPP_INITMOD(opengl)
 DECLARE_CPP_INITMOD(openglcompute)
+DECLARE_CPP_INITMOD(openmp_thread_pool)
 DECLARE_CPP_INITMOD(osx_clock)
 DECLARE_CPP_INITMOD(osx_get_symbol)
 DECLARE_CPP_INITMOD(osx_host_cpu_count)
 DECLARE_CPP_INITMOD(osx_opengl_context)
+DECLARE_CPP_INITMOD(parallel_task_size)
 DECLARE_CPP_INITMOD(posix_allocator)
 DECLARE_CPP_INITMOD(posix_clock)
 DECLARE_CPP_INITMOD(posix_error_handler)
 DECLARE_CPP_INITMOD(posix_get_symbol)
 DECLARE_CPP_INITMOD(posix_io)
+DECLARE_CPP_INITMOD(posix_shared_cache)
 DECLARE_CPP_INITMOD(posix_tempfile)
 DECLARE_CPP_INITMOD(posix_print)
 DECLARE_CPP_INITMOD(posix_threads)
@@ -123,7 +132,10 @@ DECLARE_CPP_INITMOD(qurt_hvx)
 DECLARE_CPP_INITMOD(qurt_init_fini)
 DECLARE_CPP_INITMOD(qurt_thread_pool)
 DECLARE_CPP_INITMOD(runtime_api)
+DECLARE_CPP_INITMOD(schedule_variants)
+DECLARE_CPP_INITMOD(scratch_arena)
 DECLARE_CPP_INITMOD(ssp)
+DECLARE_CPP_INITMOD(stream_state)
 DECLARE_CPP_INITMOD(thread_pool)
 DECLARE_CPP_INITMOD(to_string)
 DECLARE_CPP_INITMOD(tracing)
@@ -186,11 +198,13 @@ DECLARE_LL_INITMOD(ptx_compute_35)
 
 #ifdef WITH_X86
 DECLARE_LL_INITMOD(x86_avx)
+DECLARE_LL_INITMOD(x86_avx512)
 DECLARE_LL_INITMOD(x86)
 DECLARE_LL_INITMOD(x86_sse41)
 DECLARE_CPP_INITMOD(x86_cpu_features)
 #else
 DECLARE_NO_INITMOD(x86_avx)
+DECLARE_NO_INITMOD(x86_avx512)
 DECLARE_NO_INITMOD(x86)
 DECLARE_NO_INITMOD(x86_sse41)
 DECLARE_NO_INITMOD(x86_cpu_features)
@@ -587,8 +601,9 @@ void add_underscores_to_posix_calls_on_windows(llvm::Module *m) {
     }
 }
 
-/** Create an llvm module containing the support code for a given target. */
-std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVMContext *c, bool for_shared_jit_runtime, bool just_gpu) {
+namespace {
+
+std::unique_ptr<llvm::Module> make_initial_module_for_target(Target t, llvm::LLVMContext *c, bool for_shared_jit_runtime, bool just_gpu) {
     enum InitialModuleType {
         ModuleAOT,
         ModuleAOTNoRuntime,
@@ -622,6 +637,10 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
 
     if (module_type != ModuleGPU) {
         if (module_type != ModuleJITInlined && module_type != ModuleAOTNoRuntime) {
+            user_assert(!t.has_feature(Target::OpenMP) ||
+                        t.os == Target::Linux || t.os == Target::Android)
+                << "The openmp target feature is only supported on Linux and Android.\n";
+
             // OS-dependent modules
             if (t.os == Target::Linux) {
                 modules.push_back(get_initmod_posix_allocator(c, bits_64, debug));
@@ -636,7 +655,11 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
                 modules.push_back(get_initmod_posix_tempfile(c, bits_64, debug));
                 modules.push_back(get_initmod_linux_host_cpu_count(c, bits_64, debug));
                 modules.push_back(get_initmod_posix_threads(c, bits_64, debug));
-                modules.push_back(get_initmod_thread_pool(c, bits_64, debug));
+                if (t.has_feature(Target::OpenMP)) {
+                    modules.push_back(get_initmod_openmp_thread_pool(c, bits_64, debug));
+                } else {
+                    modules.push_back(get_initmod_thread_pool(c, bits_64, debug));
+                }
                 modules.push_back(get_initmod_posix_get_symbol(c, bits_64, debug));
             } else if (t.os == Target::OSX) {
                 modules.push_back(get_initmod_posix_allocator(c, bits_64, debug));
@@ -645,6 +668,7 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
                 modules.push_back(get_initmod_osx_clock(c, bits_64, debug));
                 modules.push_back(get_initmod_posix_io(c, bits_64, debug));
                 modules.push_back(get_initmod_posix_tempfile(c, bits_64, debug));
+                modules.push_back(get_initmod_osx_host_cpu_count(c, bits_64, debug));
                 modules.push_back(get_initmod_gcd_thread_pool(c, bits_64, debug));
                 modules.push_back(get_initmod_osx_get_symbol(c, bits_64, debug));
             } else if (t.os == Target::Android) {
@@ -660,7 +684,11 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
                 modules.push_back(get_initmod_android_tempfile(c, bits_64, debug));
                 modules.push_back(get_initmod_android_host_cpu_count(c, bits_64, debug));
                 modules.push_back(get_initmod_posix_threads(c, bits_64, debug));
-                modules.push_back(get_initmod_thread_pool(c, bits_64, debug));
+                if (t.has_feature(Target::OpenMP)) {
+                    modules.push_back(get_initmod_openmp_thread_pool(c, bits_64, debug));
+                } else {
+                    modules.push_back(get_initmod_thread_pool(c, bits_64, debug));
+                }
                 modules.push_back(get_initmod_posix_get_symbol(c, bits_64, debug));
             } else if (t.os == Target::Windows) {
                 modules.push_back(get_initmod_posix_allocator(c, bits_64, debug));
@@ -682,6 +710,7 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
                 modules.push_back(get_initmod_posix_clock(c, bits_64, debug));
                 modules.push_back(get_initmod_ios_io(c, bits_64, debug));
                 modules.push_back(get_initmod_posix_tempfile(c, bits_64, debug));
+                modules.push_back(get_initmod_osx_host_cpu_count(c, bits_64, debug));
                 modules.push_back(get_initmod_gcd_thread_pool(c, bits_64, debug));
             } else if (t.os == Target::QuRT) {
                 modules.push_back(get_initmod_qurt_allocator(c, bits_64, debug));
@@ -730,9 +759,20 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
 
                 // TODO: Support this module in the Hexagon backend,
                 // currently generates assert at src/HexagonOffload.cpp:279
-                modules.push_back(get_initmod_cache(c, bits_64, debug));
+                if (t.has_feature(Target::SharedMemoizationCache)) {
+                    user_assert(t.os == Target::Linux || t.os == Target::OSX || t.os == Target::Android)
+                        << "The shared_memoization_cache target feature requires a posix OS.\n";
+                    modules.push_back(get_initmod_posix_shared_cache(c, bits_64, debug));
+                } else {
+                    modules.push_back(get_initmod_cache(c, bits_64, debug));
+                }
+                modules.push_back(get_initmod_memoization_hash(c, bits_64, debug));
             }
             modules.push_back(get_initmod_to_string(c, bits_64, debug));
+            modules.push_back(get_initmod_scratch_arena(c, bits_64, debug));
+            modules.push_back(get_initmod_schedule_variants(c, bits_64, debug));
+            modules.push_back(get_initmod_parallel_task_size(c, bits_64, debug));
+            modules.push_back(get_initmod_stream_state(c, bits_64, debug));
 
             if (t.arch == Target::Hexagon ||
                 t.has_feature(Target::HVX_64) ||
@@ -752,6 +792,11 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
                 t.os != Target::QuRT) {
                 // MIPS doesn't support the atomics the profiler requires.
                 modules.push_back(get_initmod_profiler(c, bits_64, debug));
+                if (t.os == Target::Linux && t.arch == Target::X86) {
+                    modules.push_back(get_initmod_linux_perf_counters(c, bits_64, debug));
+                } else {
+                    modules.push_back(get_initmod_fake_perf_counters(c, bits_64, debug));
+                }
             }
 
             if (t.has_feature(Target::MSAN)) {
@@ -799,6 +844,10 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
             if (t.has_feature(Target::AVX)) {
                 modules.push_back(get_initmod_x86_avx_ll(c));
             }
+            if (t.has_feature(Target::AVX512_Skylake) ||
+                t.has_feature(Target::AVX512_Cannonlake)) {
+                modules.push_back(get_initmod_x86_avx512_ll(c));
+            }
             if (t.has_feature(Target::Profile)) {
                 modules.push_back(get_initmod_profiler_inlined(c, bits_64, debug));
             }
@@ -918,6 +967,51 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
     return std::move(modules[0]);
 }
 
+}  // namespace
+
+/** Create an llvm module containing the support code for a given target. */
+std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVMContext *c, bool for_shared_jit_runtime, bool just_gpu) {
+    // Parsing and linking the runtime modules is a large fraction of
+    // the cost of compiling a small pipeline, and the result only
+    // depends on the target. Modules belong to the context they were
+    // made in, so we keep each linked runtime as bitcode, and parse
+    // it back into the caller's context.
+    struct CachedModule {
+        std::string id;
+        llvm::SmallVector<char, 0> bitcode;
+    };
+    static std::map<std::string, CachedModule> cache;
+    static std::mutex cache_mutex;
+
+    std::string key = t.to_string();
+    key += for_shared_jit_runtime ? "/shared" : "/inlined";
+    key += just_gpu ? "/gpu" : "/all";
+
+    {
+        std::lock_guard<std::mutex> lock(cache_mutex);
+        auto iter = cache.find(key);
+        if (iter != cache.end()) {
+            const CachedModule &m = iter->second;
+            llvm::StringRef buf(m.bitcode.data(), m.bitcode.size());
+            return parse_bitcode_file(buf, c, m.id.c_str());
+        }
+    }
+
+    std::unique_ptr<llvm::Module> module =
+        make_initial_module_for_target(t, c, for_shared_jit_runtime, just_gpu);
+
+    CachedModule m;
+    m.id = module->getModuleIdentifier();
+    {
+        llvm::raw_svector_ostream stream(m.bitcode);
+        llvm::WriteBitcodeToFile(module.get(), stream);
+    }
+
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    cache.emplace(key, std::move(m));
+    return module;
+}
+
 #ifdef WITH_PTX
 std::unique_ptr<llvm::Module> get_initial_module_for_ptx_device(Target target, llvm::LLVMContext *c) {
     std::vector<std::unique_ptr<llvm::Module>> modules;
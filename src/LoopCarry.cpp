@@ -192,9 +192,20 @@ class LoopCarryOverLoop : public IRMutator {
     const Scope<int> &in_consume;
 
     int max_carried_values;
+    int vector_bytes;
 
     using IRMutator::visit;
 
+    // The number of registers a carried value of the given type
+    // occupies.
+    int registers_used(Type t) const {
+        if (vector_bytes <= 0 || t.is_scalar()) {
+            return 1;
+        }
+        int bytes = t.bytes() * t.lanes();
+        return std::max(1, (bytes + vector_bytes - 1) / vector_bytes);
+    }
+
     void visit(const LetStmt *op) {
         // Track containing LetStmts and their linearity w.r.t. the
         // loop variable.
@@ -347,24 +358,32 @@ class LoopCarryOverLoop : public IRMutator {
             }
         }
 
-        // Only keep the top N carried values. Otherwise we'll just
-        // spray stack spills everywhere. This is ugly, because we're
-        // relying on a heuristic.
+        // Only keep as many carried values as fit in the register
+        // budget. Otherwise we'll just spray stack spills
+        // everywhere. This is ugly, because we're relying on a
+        // heuristic. Vectors wider than a register count once for
+        // each register they occupy.
         vector<vector<int>> trimmed;
-        size_t sz = 0;
+        int used = 0;
         for (const vector<int> &c : chains) {
-            if (sz + c.size() > (size_t)max_carried_values) {
-                if (sz < (size_t)max_carried_values - 1) {
+            int cost = registers_used(loads[c.front()][0]->type);
+            int fit = (max_carried_values - used) / cost;
+            if (fit < (int)c.size()) {
+                if (fit >= 2) {
                     // Take a partial chain
-                    trimmed.emplace_back(c.begin(), c.begin() + max_carried_values - sz);
+                    trimmed.emplace_back(c.begin(), c.begin() + fit);
                 }
                 break;
             }
             trimmed.push_back(c);
-            sz += c.size();
+            used += (int)c.size() * cost;
         }
         chains.swap(trimmed);
 
+        if (chains.empty()) {
+            return orig_stmt;
+        }
+
         // We now have chains of the form:
         // f[x] <- f[x+1] <- ... <- f[x+N-1]
 
@@ -480,8 +499,8 @@ class LoopCarryOverLoop : public IRMutator {
     }
 
 public:
-    LoopCarryOverLoop(const string &var, const Scope<int> &s, int max_carried_values)
-        : in_consume(s), max_carried_values(max_carried_values) {
+    LoopCarryOverLoop(const string &var, const Scope<int> &s, int max_carried_values, int vector_bytes)
+        : in_consume(s), max_carried_values(max_carried_values), vector_bytes(vector_bytes) {
         linear.push(var, 1);
     }
 
@@ -495,10 +514,228 @@ public:
     vector<ScratchAllocation> allocs;
 };
 
+// Find the names of all buffers stored to.
+class FindStores : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const Store *op) {
+        IRVisitor::visit(op);
+        result.insert(op->name);
+    }
+
+public:
+    set<string> result;
+};
+
+// Check if a loop body is straight-line code that only computes
+// values and stores them, so that it is safe to run the loads it does
+// at the top of the previous iteration.
+class IsStraightLine : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const For *op) {result = false;}
+    void visit(const IfThenElse *op) {result = false;}
+    void visit(const Evaluate *op) {result = false;}
+    void visit(const AssertStmt *op) {result = false;}
+    void visit(const Allocate *op) {result = false;}
+    void visit(const ProducerConsumer *op) {result = false;}
+    void visit(const Call *op) {
+        if (!op->is_pure() && op->call_type != Call::Halide && op->call_type != Call::Image) {
+            result = false;
+        }
+        IRVisitor::visit(op);
+    }
+
+public:
+    bool result = true;
+};
+
+/** Load values one iteration ahead in a single innermost serial loop. */
+class PipelineLoadsInLoop {
+    const Scope<int> &in_consume;
+    int max_pipelined_values;
+    int vector_bytes;
+
+    int registers_used(Type t) const {
+        if (vector_bytes <= 0 || t.is_scalar()) {
+            return 1;
+        }
+        int bytes = t.bytes() * t.lanes();
+        return std::max(1, (bytes + vector_bytes - 1) / vector_bytes);
+    }
+
+public:
+    PipelineLoadsInLoop(const Scope<int> &s, int max_pipelined_values, int vector_bytes)
+        : in_consume(s), max_pipelined_values(max_pipelined_values), vector_bytes(vector_bytes) {}
+
+    Stmt mutate(const For *op) {
+        IsStraightLine straight_line;
+        op->body.accept(&straight_line);
+        if (!straight_line.result) {
+            return op;
+        }
+
+        FindStores find_stores;
+        op->body.accept(&find_stores);
+
+        Stmt graph_stmt = substitute_in_all_lets(op->body);
+
+        FindLoads find_loads;
+        graph_stmt.accept(&find_loads);
+
+        Scope<Expr> linear;
+        linear.push(op->name, 1);
+
+        // Group equal loads, and find the ones it's safe to issue an
+        // iteration early.
+        vector<vector<const Load *>> loads;
+        vector<Expr> next_indices;
+        int used = 0;
+        for (const Load *load : find_loads.result) {
+            bool safe = ((load->image.defined() ||
+                          load->param.defined() ||
+                          in_consume.contains(load->name)) &&
+                         !find_stores.result.count(load->name) &&
+                         is_one(load->predicate));
+            if (!safe) continue;
+
+            bool represented = false;
+            for (vector<const Load *> &v : loads) {
+                if (graph_equal(Expr(load), Expr(v[0]))) {
+                    v.push_back(load);
+                    represented = true;
+                }
+            }
+            if (represented) continue;
+
+            // Indices that depend on other loads can't be computed an
+            // iteration early.
+            FindLoads nested;
+            load->index.accept(&nested);
+            if (!nested.result.empty()) continue;
+
+            // Loop invariants are lifted elsewhere.
+            Expr next = step_forwards(load->index, linear);
+            if (!next.defined() || graph_equal(next, load->index)) continue;
+
+            // Stay within the register budget.
+            int cost = registers_used(load->type);
+            if (used + cost > max_pipelined_values) continue;
+            used += cost;
+
+            loads.push_back({load});
+            next_indices.push_back(next);
+        }
+
+        if (loads.empty()) {
+            return op;
+        }
+
+        // For each load, we make a scratch buffer holding the value
+        // for the current iteration. Before the loop we load the
+        // value for the first iteration into it. On each iteration we
+        // read the current value out of it, then load the value for
+        // the next iteration into it, then do the original work using
+        // the current value.
+        Stmt core = graph_stmt;
+        vector<Stmt> prologue, next_stores;
+        vector<pair<string, Expr>> current_values;
+        vector<pair<string, Type>> scratches;
+        Expr not_last = Variable::make(Int(32), op->name) + 1 < op->min + op->extent;
+        for (size_t i = 0; i < loads.size(); i++) {
+            const Load *orig = loads[i][0];
+            string scratch = unique_name('p');
+            Expr idx = scratch_index(0, orig->type);
+            Expr current = Variable::make(orig->type, scratch + ".current");
+            for (const Load *l : loads[i]) {
+                core = graph_substitute(l, current, core);
+            }
+            current_values.push_back({scratch + ".current",
+                        Load::make(orig->type, scratch, idx, Buffer<>(), Parameter(),
+                                   const_true(orig->type.lanes()))});
+            Expr next = Load::make(orig->type, orig->name, next_indices[i],
+                                   orig->image, orig->param, orig->predicate);
+            next_stores.push_back(Store::make(scratch, next, idx, Parameter(),
+                                              const_true(orig->type.lanes())));
+            Expr first = graph_substitute(op->name, op->min, Expr(orig));
+            prologue.push_back(Store::make(scratch, first, idx, Parameter(),
+                                           const_true(orig->type.lanes())));
+            scratches.push_back({scratch, orig->type});
+        }
+
+        Stmt body = Block::make(IfThenElse::make(not_last, Block::make(next_stores)), core);
+        for (size_t i = current_values.size(); i > 0; i--) {
+            body = LetStmt::make(current_values[i-1].first, current_values[i-1].second, body);
+        }
+        body = common_subexpression_elimination(body);
+
+        Stmt result = For::make(op->name, op->min, op->extent, op->for_type, op->device_api, body);
+        result = Block::make(common_subexpression_elimination(Block::make(prologue)), result);
+        for (const auto &s : scratches) {
+            result = Allocate::make(s.first, s.second.element_of(), {s.second.lanes()}, const_true(), result);
+        }
+        return IfThenElse::make(op->extent > 0, result);
+    }
+};
+
+class PipelineLoads : public IRMutator {
+    using IRMutator::visit;
+
+    int max_pipelined_values;
+    int vector_bytes;
+    Scope<int> in_consume;
+
+    void visit(const ProducerConsumer *op) {
+        if (op->is_producer) {
+            IRMutator::visit(op);
+        } else {
+            in_consume.push(op->name, 0);
+            Stmt body = mutate(op->body);
+            in_consume.pop(op->name);
+            stmt = ProducerConsumer::make(op->name, op->is_producer, body);
+        }
+    }
+
+    void visit(const For *op) {
+        if (op->device_api != DeviceAPI::None &&
+            op->device_api != DeviceAPI::Host) {
+            // Leave code for other devices alone.
+            stmt = op;
+        } else if (op->for_type == ForType::Serial && !is_one(op->extent)) {
+            // Only innermost loops are straight-line, so loops
+            // containing other loops are just recursed into.
+            IRMutator::visit(op);
+            if (stmt.same_as(op)) {
+                PipelineLoadsInLoop pipeline(in_consume, max_pipelined_values, vector_bytes);
+                stmt = pipeline.mutate(op);
+            }
+        } else {
+            IRMutator::visit(op);
+        }
+    }
+
+public:
+    PipelineLoads(int max_pipelined_values, int vector_bytes) :
+        max_pipelined_values(max_pipelined_values), vector_bytes(vector_bytes) {}
+};
+
+int vector_registers(const Target &t) {
+    if (t.arch == Target::X86) {
+        bool avx512 = t.features_any_of({Target::AVX512, Target::AVX512_KNL,
+                                         Target::AVX512_Skylake, Target::AVX512_Cannonlake});
+        return (t.bits == 64 && avx512) ? 32 : (t.bits == 64 ? 16 : 8);
+    } else if (t.arch == Target::ARM) {
+        return t.bits == 64 ? 32 : 16;
+    } else {
+        return 16;
+    }
+}
+
 class LoopCarry : public IRMutator {
     using IRMutator::visit;
 
     int max_carried_values;
+    int vector_bytes;
     Scope<int> in_consume;
 
     void visit(const ProducerConsumer *op) {
@@ -513,9 +750,13 @@ class LoopCarry : public IRMutator {
     }
 
     void visit(const For *op) {
-        if (op->for_type == ForType::Serial && !is_one(op->extent)) {
+        if (op->device_api != DeviceAPI::None &&
+            op->device_api != DeviceAPI::Host) {
+            // Leave code for other devices alone.
+            stmt = op;
+        } else if (op->for_type == ForType::Serial && !is_one(op->extent)) {
             Stmt body = mutate(op->body);
-            LoopCarryOverLoop carry(op->name, in_consume, max_carried_values);
+            LoopCarryOverLoop carry(op->name, in_consume, max_carried_values, vector_bytes);
             body = carry.mutate(body);
             if (body.same_as(op->body)) {
                 stmt = op;
@@ -538,17 +779,30 @@ class LoopCarry : public IRMutator {
     }
 
 public:
-    LoopCarry(int max_carried_values) : max_carried_values(max_carried_values) {}
+    LoopCarry(int max_carried_values, int vector_bytes) :
+        max_carried_values(max_carried_values), vector_bytes(vector_bytes) {}
 };
 
 }
 
 
-Stmt loop_carry(Stmt s, int max_carried_values) {
-    s = LoopCarry(max_carried_values).mutate(s);
+Stmt loop_carry(Stmt s, int max_carried_values, int vector_bytes) {
+    s = LoopCarry(max_carried_values, vector_bytes).mutate(s);
     return s;
 }
 
+Stmt loop_carry(Stmt s, const Target &t) {
+    // Leave half of the vector register file for the computation
+    // itself.
+    return loop_carry(s, vector_registers(t) / 2, t.natural_vector_size(Int(8)));
+}
+
+Stmt pipeline_loads(Stmt s, const Target &t) {
+    // Values loaded ahead are live across the whole loop body, so
+    // only use a quarter of the vector register file for them.
+    return PipelineLoads(vector_registers(t) / 4, t.natural_vector_size(Int(8))).mutate(s);
+}
+
 
 }
 }
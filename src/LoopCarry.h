@@ -2,6 +2,7 @@
 #define HALIDE_LOOP_CARRY_H
 
 #include "Expr.h"
+#include "Target.h"
 
 namespace Halide {
 namespace Internal {
@@ -10,9 +11,26 @@ namespace Internal {
  * induction variables instead of redoing the load. If the loads are
  * predicated, the predicates need to match. Can be an optimization or
  * pessimization depending on how good the L1 cache is on the architecture
- * and how many memory issue slots there are. Currently only intended
- * for Hexagon. */
-Stmt loop_carry(Stmt, int max_carried_values = 8);
+ * and how many memory issue slots there are. Used by default for
+ * Hexagon, and for other targets with Target::LoopCarry.
+ *
+ * At most max_carried_values registers are used for carried
+ * values. If vector_bytes is positive, vectors wider than that many
+ * bytes count as several registers. */
+Stmt loop_carry(Stmt, int max_carried_values = 8, int vector_bytes = 0);
+
+/** Carry values across loop iterations using half of the target's
+ * vector register file. */
+Stmt loop_carry(Stmt, const Target &t);
+
+/** Software-pipeline the loads in innermost serial loops: each
+ * iteration loads the values the next iteration needs before doing
+ * its own work, so that the latency of those loads overlaps with the
+ * computation instead of stalling it. Only straight-line loop bodies
+ * are transformed, and only loads that step linearly with the loop
+ * variable from buffers the loop does not write. Used for targets
+ * with Target::SoftwarePipeline. */
+Stmt pipeline_loads(Stmt, const Target &t);
 
 }
 }
@@ -0,0 +1,260 @@
+#include "LoopInvariantDivision.h"
+#include "IREquality.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+#include "Scope.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::pair;
+using std::string;
+using std::vector;
+
+namespace {
+
+// Is it safe to compute an Expr once, outside of a loop.
+class IsInvariant : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const Call *op) {
+        if (!op->is_pure()) {
+            result = false;
+        } else {
+            IRVisitor::visit(op);
+        }
+    }
+
+    void visit(const Load *op) {
+        result = false;
+    }
+
+    void visit(const Variable *op) {
+        if (varying.contains(op->name)) {
+            result = false;
+        }
+    }
+
+    const Scope<int> &varying;
+
+public:
+    bool result {true};
+
+    IsInvariant(const Scope<int> &v) : varying(v) {}
+};
+
+Expr splat(Expr e, int lanes) {
+    return lanes == 1 ? e : Broadcast::make(e, lanes);
+}
+
+// The values precomputed for one divisor, using the method of figure
+// 4.1 of Granlund and Montgomery, "Division by Invariant Integers
+// using Multiplication". They are all scalars of the unsigned type
+// with the same bit width as the divisor.
+struct DivisorMagic {
+    Expr multiplier, shift1, shift2;
+    // An all-ones mask if the divisor is negative. Only defined for
+    // signed divisors.
+    Expr sign;
+};
+
+// Rewrite division by values that don't vary within a loop body, and
+// record the lets that compute the magic numbers for them.
+class ReplaceInvariantDivision : public IRMutator {
+    using IRMutator::visit;
+
+    Scope<int> varying;
+
+    map<Expr, DivisorMagic, IRDeepCompare> magic;
+
+    // Returns the scalar divisor if it's worth replacing a division
+    // of type t by it, or an undefined Expr if not.
+    Expr invariant_divisor(Type t, Expr b) {
+        if (!(t.is_int() || t.is_uint()) ||
+            !(t.bits() == 8 || t.bits() == 16 || t.bits() == 32)) {
+            return Expr();
+        }
+        if (const Broadcast *broadcast = b.as<Broadcast>()) {
+            b = broadcast->value;
+        }
+        if (b.type().is_vector() || is_const(b)) {
+            // Codegen already handles constant divisors.
+            return Expr();
+        }
+        IsInvariant check(varying);
+        b.accept(&check);
+        return check.result ? b : Expr();
+    }
+
+    Expr make_let(const string &name, Expr value) {
+        lets.push_back({name, value});
+        return Variable::make(value.type(), name);
+    }
+
+    const DivisorMagic &get_magic(Expr d) {
+        auto it = magic.find(d);
+        if (it != magic.end()) {
+            return it->second;
+        }
+
+        Type t = d.type();
+        Type ut = t.with_code(Type::UInt);
+        const int bits = t.bits();
+        string name = unique_name('d');
+
+        DivisorMagic m;
+        Expr ud = t.is_int() ? abs(d) : d;
+        // Division by zero is undefined, but it shouldn't trap out
+        // here, where the division might not even have been
+        // reached.
+        ud = make_let(name + ".divisor", max(ud, make_one(ut)));
+        // The log of the divisor, rounded up.
+        Expr l = make_let(name + ".log2", make_const(ut, bits) - count_leading_zeros(ud - 1));
+        // 2^bits * (2^l - d) / d + 1, which fits in the narrow type.
+        Expr one = make_one(UInt(64));
+        Expr wide_ud = cast(UInt(64), ud);
+        Expr mul = make_const(UInt(64), (uint64_t)1 << bits) * ((one << cast(UInt(64), l)) - wide_ud) / wide_ud + one;
+        m.multiplier = make_let(name + ".multiplier", cast(ut, mul));
+        m.shift1 = make_let(name + ".shift1", min(l, make_one(ut)));
+        m.shift2 = make_let(name + ".shift2", max(l, make_one(ut)) - make_one(ut));
+        if (t.is_int()) {
+            m.sign = make_let(name + ".sign", d >> make_const(t, bits - 1));
+        }
+        return magic[d] = m;
+    }
+
+    // Unsigned division of the (maybe vector) numerator n by the
+    // divisor the magic numbers were made for.
+    Expr unsigned_divide(Expr n, const DivisorMagic &m) {
+        Type t = n.type();
+        Type wide = t.with_bits(t.bits() * 2);
+        const int lanes = t.lanes();
+
+        string n_name = unique_name('n');
+        Expr nv = Variable::make(t, n_name);
+
+        // Multiply-keep-high-half
+        Expr hi = cast(wide, nv) * cast(wide, splat(m.multiplier, lanes));
+        if (t.bits() < 32) hi = hi / (1 << t.bits());
+        else hi = hi >> t.bits();
+        hi = cast(t, hi);
+
+        // Add half the difference between input and output so far,
+        // and then do the final shift.
+        Expr q = (hi + ((nv - hi) >> splat(m.shift1, lanes))) >> splat(m.shift2, lanes);
+        return Let::make(n_name, n, q);
+    }
+
+    // Euclidean division, to match the semantics of Div.
+    Expr divide(Expr n, Expr d) {
+        const DivisorMagic &m = get_magic(d);
+        Type t = n.type();
+        if (t.is_uint()) {
+            return unsigned_divide(n, m);
+        }
+
+        const int lanes = t.lanes();
+        string n_name = unique_name('n');
+        Expr nv = Variable::make(t, n_name);
+
+        // Rounding down is rounding towards zero of the numerator
+        // with its bits flipped if it's negative, and then flipping
+        // the bits back again.
+        Expr sign = nv >> make_const(t, t.bits() - 1);
+        Expr q = unsigned_divide(cast(t.with_code(Type::UInt), nv ^ sign), m);
+        q = cast(t, q) ^ sign;
+
+        // Negate the result if the divisor is negative.
+        Expr dsign = splat(m.sign, lanes);
+        q = (q ^ dsign) - dsign;
+        return Let::make(n_name, n, q);
+    }
+
+    void visit(const Div *op) {
+        Expr d = invariant_divisor(op->type, op->b);
+        if (d.defined()) {
+            expr = divide(mutate(op->a), d);
+        } else {
+            IRMutator::visit(op);
+        }
+    }
+
+    void visit(const Mod *op) {
+        Expr d = invariant_divisor(op->type, op->b);
+        if (d.defined()) {
+            string n_name = unique_name('n');
+            Expr nv = Variable::make(op->type, n_name);
+            expr = Let::make(n_name, mutate(op->a), nv - divide(nv, d) * op->b);
+        } else {
+            IRMutator::visit(op);
+        }
+    }
+
+    void visit(const Let *op) {
+        varying.push(op->name, 0);
+        IRMutator::visit(op);
+        varying.pop(op->name);
+    }
+
+    void visit(const LetStmt *op) {
+        varying.push(op->name, 0);
+        IRMutator::visit(op);
+        varying.pop(op->name);
+    }
+
+    void visit(const For *op) {
+        varying.push(op->name, 0);
+        IRMutator::visit(op);
+        varying.pop(op->name);
+    }
+
+public:
+    // The lets to wrap around the loop, outermost first.
+    vector<pair<string, Expr>> lets;
+
+    ReplaceInvariantDivision(const string &loop_var) {
+        varying.push(loop_var, 0);
+    }
+};
+
+class LoopInvariantDivision : public IRMutator {
+    using IRMutator::visit;
+
+    void visit(const For *op) {
+        if (op->for_type == ForType::GPUBlock ||
+            op->for_type == ForType::GPUThread ||
+            (op->device_api != DeviceAPI::None &&
+             op->device_api != DeviceAPI::Host)) {
+            // Leave device code alone.
+            stmt = op;
+            return;
+        }
+
+        ReplaceInvariantDivision replacer(op->name);
+        Stmt body = replacer.mutate(op->body);
+
+        // Divisors that depend on this loop's variable may still be
+        // invariant in an inner loop.
+        body = mutate(body);
+
+        Stmt s = For::make(op->name, op->min, op->extent, op->for_type, op->device_api, body);
+        for (auto it = replacer.lets.rbegin(); it != replacer.lets.rend(); it++) {
+            s = LetStmt::make(it->first, it->second, s);
+        }
+        stmt = s;
+    }
+};
+
+}  // namespace
+
+Stmt optimize_loop_invariant_division(Stmt s, const Target &t) {
+    if (t.arch == Target::Hexagon) {
+        // HVX has no wide enough multiplies for the 32-bit case.
+        return s;
+    }
+    return LoopInvariantDivision().mutate(s);
+}
+
+}
+}
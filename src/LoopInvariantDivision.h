@@ -0,0 +1,27 @@
+#ifndef HALIDE_LOOP_INVARIANT_DIVISION_H
+#define HALIDE_LOOP_INVARIANT_DIVISION_H
+
+/** \file
+ * Defines a lowering pass that replaces division by loop-invariant
+ * values with multiplies and shifts.
+ */
+
+#include "IR.h"
+#include "Target.h"
+
+namespace Halide {
+namespace Internal {
+
+/** Replace integer division and modulus by a divisor that is not a
+ * constant, but is invariant in some enclosing loop (e.g. a
+ * Param<int>), with a multiply-keep-high-half and shifts. The
+ * multiplier and shifts for each divisor are computed once, outside
+ * the outermost loop over which the divisor is invariant. Codegen
+ * already does this for small constant divisors. Loops that run on a
+ * device are left alone. */
+Stmt optimize_loop_invariant_division(Stmt s, const Target &t);
+
+}
+}
+
+#endif
@@ -1,3 +1,5 @@
+#include <chrono>
+#include <functional>
 #include <iostream>
 #include <set>
 #include <sstream>
@@ -8,10 +10,12 @@
 #include "AddImageChecks.h"
 #include "AddParameterChecks.h"
 #include "AllocationBoundsInference.h"
+#include "AsyncProducers.h"
 #include "Bounds.h"
 #include "BoundsInference.h"
 #include "CSE.h"
 #include "CanonicalizeGPUVars.h"
+#include "CompactLoops.h"
 #include "Debug.h"
 #include "DebugArguments.h"
 #include "DebugToFile.h"
@@ -20,19 +24,26 @@
 #include "FindCalls.h"
 #include "Func.h"
 #include "Function.h"
+#include "FuseGPUKernels.h"
 #include "FuseGPUThreadLoops.h"
 #include "FuzzFloatStores.h"
 #include "HexagonOffload.h"
+#include "HoistStorage.h"
 #include "InferArguments.h"
 #include "InjectHostDevBufferCopies.h"
 #include "InjectOpenGLIntrinsics.h"
+#include "InjectTensorCores.h"
+#include "InjectWarpShuffles.h"
 #include "Inline.h"
 #include "IRMutator.h"
 #include "IROperator.h"
 #include "IRPrinter.h"
 #include "LICM.h"
 #include "LoopCarry.h"
+#include "LoopInvariantDivision.h"
 #include "Memoization.h"
+#include "NarrowIndices.h"
+#include "PackAllocations.h"
 #include "PartitionLoops.h"
 #include "Prefetch.h"
 #include "Profiling.h"
@@ -42,14 +53,19 @@
 #include "RemoveTrivialForLoops.h"
 #include "RemoveUndef.h"
 #include "ScheduleFunctions.h"
+#include "ScratchArenas.h"
 #include "SelectGPUAPI.h"
 #include "SkipStages.h"
 #include "SlidingWindow.h"
 #include "Simplify.h"
 #include "SimplifySpecializations.h"
+#include "SizeParallelTasks.h"
+#include "SpecializeUnitStride.h"
 #include "SplitTuples.h"
 #include "StorageFlattening.h"
 #include "StorageFolding.h"
+#include "Streaming.h"
+#include "StrengthReduce.h"
 #include "Substitute.h"
 #include "Tracing.h"
 #include "TrimNoOps.h"
@@ -71,6 +87,175 @@ using std::string;
 using std::vector;
 using std::map;
 
+namespace {
+
+// A profile of the time spent in lower(), enabled by setting
+// HL_COMPILE_PROFILE=1. For each pass it records the wall time, the
+// number of distinct IR nodes before and after, and how much of that
+// time was spent in the simplifier, and prints the lot to stderr once
+// lowering is complete.
+class LoweringProfile {
+    struct Pass {
+        string name;
+        double seconds, simplify_seconds;
+        uint64_t simplify_calls;
+        size_t nodes_before, nodes_after;
+    };
+
+    class CountNodes : public IRGraphVisitor {
+    public:
+        size_t count() const {
+            return visited.size();
+        }
+    };
+
+    // Count the nodes in the IR tree of each Func's produce step,
+    // not including those of the Funcs produced inside it. It's a
+    // rough measure of how much code each Func contributes.
+    class CountFuncNodes : public IRGraphVisitor {
+        using IRGraphVisitor::visit;
+
+        vector<string> stack;
+
+        void include(const Expr &e) {
+            count();
+            e.accept(this);
+        }
+
+        void include(const Stmt &s) {
+            count();
+            s.accept(this);
+        }
+
+        void count() {
+            if (!stack.empty()) {
+                nodes[stack.back()]++;
+            }
+        }
+
+        void visit(const ProducerConsumer *op) {
+            if (op->is_producer) {
+                stack.push_back(op->name);
+                include(op->body);
+                stack.pop_back();
+            } else {
+                include(op->body);
+            }
+        }
+
+    public:
+        map<string, size_t> nodes;
+    };
+
+    bool enabled;
+    string pipeline_name;
+    vector<Pass> passes;
+    map<string, size_t> func_nodes;
+    std::chrono::steady_clock::time_point last_time;
+    SimplifyStats first_simplify, last_simplify;
+    size_t last_nodes;
+
+public:
+    LoweringProfile(const string &pipeline_name) :
+        enabled(get_env_variable("HL_COMPILE_PROFILE") == "1"),
+        pipeline_name(pipeline_name), last_nodes(0) {
+        if (enabled) {
+            set_simplify_timing(true);
+            first_simplify = last_simplify = get_simplify_stats();
+            last_time = std::chrono::steady_clock::now();
+        }
+    }
+
+    ~LoweringProfile() {
+        if (enabled) {
+            set_simplify_timing(false);
+        }
+    }
+
+    // Attribute everything since the last call to the named pass, which
+    // produced s.
+    void pass(const char *name, const Stmt &s) {
+        if (!enabled) return;
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - last_time;
+        SimplifyStats simplify = get_simplify_stats();
+
+        Pass p;
+        p.name = name;
+        p.seconds = elapsed.count();
+        p.simplify_seconds = simplify.seconds - last_simplify.seconds;
+        p.simplify_calls = simplify.calls - last_simplify.calls;
+        p.nodes_before = last_nodes;
+        if (s.defined()) {
+            CountNodes counter;
+            s.accept(&counter);
+            p.nodes_after = counter.count() + 1;
+        } else {
+            p.nodes_after = 0;
+        }
+        passes.push_back(p);
+
+        // Don't charge the node counting to the next pass.
+        last_nodes = p.nodes_after;
+        last_simplify = simplify;
+        last_time = std::chrono::steady_clock::now();
+    }
+
+    // Record the size of the code for each Func in the final
+    // statement.
+    void code_size(const Stmt &s) {
+        if (!enabled) return;
+        CountFuncNodes counter;
+        s.accept(&counter);
+        func_nodes = counter.nodes;
+    }
+
+    void report() const {
+        if (!enabled) return;
+        double total = 0, total_simplify = 0;
+        std::ostringstream out;
+        out << "Lowering profile for " << pipeline_name << ":\n";
+        char line[256];
+        snprintf(line, sizeof(line), "  %-36s %10s %14s %10s %10s %10s\n",
+                 "pass", "time (ms)", "simplify (ms)", "simplifies", "nodes in", "nodes out");
+        out << line;
+        for (const Pass &p : passes) {
+            snprintf(line, sizeof(line), "  %-36s %10.3f %14.3f %10llu %10llu %10llu\n",
+                     p.name.c_str(), p.seconds * 1000, p.simplify_seconds * 1000,
+                     (unsigned long long)p.simplify_calls,
+                     (unsigned long long)p.nodes_before,
+                     (unsigned long long)p.nodes_after);
+            out << line;
+            total += p.seconds;
+            total_simplify += p.simplify_seconds;
+        }
+        snprintf(line, sizeof(line), "  %-36s %10.3f %14.3f\n", "total", total * 1000, total_simplify * 1000);
+        out << line;
+        out << "  " << (get_simplify_stats().cache_hits - first_simplify.cache_hits)
+            << " calls to simplify were answered from the cache\n";
+        uint64_t over_budget = get_simplify_stats().budget_exceeded - first_simplify.budget_exceeded;
+        if (over_budget) {
+            out << "  " << over_budget << " calls to simplify ran out of budget\n";
+        }
+        if (!func_nodes.empty()) {
+            // Largest first, as that's where to look for code size.
+            vector<std::pair<size_t, string>> sizes;
+            for (const auto &f : func_nodes) {
+                sizes.push_back({f.second, f.first});
+            }
+            std::sort(sizes.begin(), sizes.end(), std::greater<std::pair<size_t, string>>());
+            out << "  IR nodes generated for each Func:\n";
+            for (const auto &f : sizes) {
+                snprintf(line, sizeof(line), "    %-34s %10llu\n",
+                         f.second.c_str(), (unsigned long long)f.first);
+                out << line;
+            }
+        }
+        std::cerr << out.str();
+    }
+};
+
+}
+
 Module lower(const vector<Function> &output_funcs, const string &pipeline_name, const Target &t,
              const vector<Argument> &args, const Internal::LoweredFunc::LinkageType linkage_type,
              const vector<IRMutator *> &custom_passes) {
@@ -79,6 +264,12 @@ Module lower(const vector<Function> &output_funcs, const string &pipeline_name,
 
     Module result_module(simple_pipeline_name, t);
 
+    LoweringProfile profile(pipeline_name);
+
+    // Lowering simplifies the same IR many times over, often with
+    // nothing having changed in between.
+    ScopedSimplifyCache simplify_cache;
+
     // Compute an environment
     map<string, Function> env;
     for (Function f : output_funcs) {
@@ -99,28 +290,49 @@ Module lower(const vector<Function> &output_funcs, const string &pipeline_name,
         f.second.substitute_schedule_param_exprs();
     }
 
+    // Choose the vector widths left to the compiler.
+    select_auto_vector_widths(env, t);
+
     // Substitute in wrapper Funcs
     env = wrap_func_calls(env);
 
     // Compute a realization order
     vector<string> order = realization_order(outputs, env);
 
+    // When lazily jit-compiling specializations, fix the conditions
+    // that depend only on the current values of the Params, so that
+    // only the branches taken get compiled. The Pipeline recompiles
+    // if those values later pick other branches.
+    if (t.has_feature(Target::JIT) && t.has_feature(Target::LazySpecializations)) {
+        evaluate_specializations(env, true);
+    }
+
     // Try to simplify the RHS/LHS of a function definition by propagating its
     // specializations' conditions
     simplify_specializations(env);
 
+    profile.pass("setup", Stmt());
+
     debug(1) << "Creating initial loop nests...\n";
     bool any_memoized = false;
     Stmt s = schedule_functions(outputs, order, env, t, any_memoized);
+    profile.pass("schedule_functions", s);
     debug(2) << "Lowering after creating initial loop nests:\n" << s << '\n';
 
+    debug(1) << "Injecting warp shuffles...\n";
+    s = inject_warp_shuffles(s, t);
+    profile.pass("inject_warp_shuffles", s);
+    debug(2) << "Lowering after injecting warp shuffles:\n" << s << '\n';
+
     debug(1) << "Canonicalizing GPU var names...\n";
     s = canonicalize_gpu_vars(s);
+    profile.pass("canonicalize_gpu_vars", s);
     debug(2) << "Lowering after canonicalizing GPU var names:\n" << s << '\n';
 
     if (any_memoized) {
         debug(1) << "Injecting memoization...\n";
         s = inject_memoization(s, env, pipeline_name, outputs);
+        profile.pass("inject_memoization", s);
         debug(2) << "Lowering after injecting memoization:\n" << s << '\n';
     } else {
         debug(1) << "Skipping injecting memoization...\n";
@@ -128,21 +340,26 @@ Module lower(const vector<Function> &output_funcs, const string &pipeline_name,
 
     debug(1) << "Injecting tracing...\n";
     s = inject_tracing(s, pipeline_name, env, outputs, t);
+    profile.pass("inject_tracing", s);
     debug(2) << "Lowering after injecting tracing:\n" << s << '\n';
 
     debug(1) << "Adding checks for parameters\n";
     s = add_parameter_checks(s, t);
+    profile.pass("add_parameter_checks", s);
     debug(2) << "Lowering after injecting parameter checks:\n" << s << '\n';
 
     // Compute the maximum and minimum possible value of each
     // function. Used in later bounds inference passes.
     debug(1) << "Computing bounds of each function's value\n";
     FuncValueBounds func_bounds = compute_function_value_bounds(order, env);
+    profile.pass("compute_function_value_bounds", s);
 
     // The checks will be in terms of the symbols defined by bounds
     // inference.
     debug(1) << "Adding checks for images\n";
-    s = add_image_checks(s, outputs, t, order, env, func_bounds);
+    map<string, vector<halide_dimension_t>> fixed_shapes;
+    s = add_image_checks(s, outputs, t, order, env, func_bounds, &fixed_shapes);
+    profile.pass("add_image_checks", s);
     debug(2) << "Lowering after injecting image checks:\n" << s << '\n';
 
     // This pass injects nested definitions of variable names, so we
@@ -150,62 +367,117 @@ Module lower(const vector<Function> &output_funcs, const string &pipeline_name,
     // can still simplify Exprs).
     debug(1) << "Performing computation bounds inference...\n";
     s = bounds_inference(s, outputs, order, env, func_bounds, t);
+    profile.pass("bounds_inference", s);
     debug(2) << "Lowering after computation bounds inference:\n" << s << '\n';
 
     debug(1) << "Performing sliding window optimization...\n";
     s = sliding_window(s, env);
+    profile.pass("sliding_window", s);
     debug(2) << "Lowering after sliding window:\n" << s << '\n';
 
     debug(1) << "Performing allocation bounds inference...\n";
     s = allocation_bounds_inference(s, env, func_bounds);
+    profile.pass("allocation_bounds_inference", s);
     debug(2) << "Lowering after allocation bounds inference:\n" << s << '\n';
 
     debug(1) << "Removing code that depends on undef values...\n";
     s = remove_undef(s);
+    profile.pass("remove_undef", s);
     debug(2) << "Lowering after removing code that depends on undef values:\n" << s << "\n\n";
 
+    debug(1) << "Compacting predicated loops...\n";
+    s = compact_loops(s, env);
+    profile.pass("compact_loops", s);
+    debug(2) << "Lowering after compacting predicated loops:\n" << s << "\n\n";
+
     // This uniquifies the variable names, so we're good to simplify
     // after this point. This lets later passes assume syntactic
     // equivalence means semantic equivalence.
     debug(1) << "Uniquifying variable names...\n";
     s = uniquify_variable_names(s);
+    profile.pass("uniquify_variable_names", s);
     debug(2) << "Lowering after uniquifying variable names:\n" << s << "\n\n";
 
+    debug(1) << "Injecting streaming state...\n";
+    s = inject_streaming(s, env, pipeline_name, outputs);
+    profile.pass("inject_streaming", s);
+    debug(2) << "Lowering after injecting streaming state:\n" << s << "\n\n";
+
     debug(1) << "Performing storage folding optimization...\n";
     s = storage_folding(s, env);
+    profile.pass("storage_folding", s);
     debug(2) << "Lowering after storage folding:\n" << s << '\n';
 
+    debug(1) << "Forking asynchronous producers...\n";
+    s = fork_async_producers(s, env);
+    profile.pass("fork_async_producers", s);
+    debug(2) << "Lowering after forking asynchronous producers:\n" << s << '\n';
+
     debug(1) << "Injecting debug_to_file calls...\n";
     s = debug_to_file(s, outputs, env);
+    profile.pass("debug_to_file", s);
     debug(2) << "Lowering after injecting debug_to_file calls:\n" << s << '\n';
 
     debug(1) << "Simplifying...\n"; // without removing dead lets, because storage flattening needs the strides
     s = simplify(s, false);
+    profile.pass("simplify", s);
     debug(2) << "Lowering after first simplification:\n" << s << "\n\n";
 
     debug(1) << "Injecting prefetches...\n";
-    s = inject_prefetch(s, env);
+    s = inject_prefetch(s, env, t);
+    profile.pass("inject_prefetch", s);
     debug(2) << "Lowering after injecting prefetches:\n" << s << "\n\n";
 
     debug(1) << "Dynamically skipping stages...\n";
-    s = skip_stages(s, order);
+    s = skip_stages(s, order, env);
+    profile.pass("skip_stages", s);
     debug(2) << "Lowering after dynamically skipping stages:\n" << s << "\n\n";
 
     debug(1) << "Destructuring tuple-valued realizations...\n";
     s = split_tuples(s, env);
+    profile.pass("split_tuples", s);
     debug(2) << "Lowering after destructuring tuple-valued realizations:\n" << s << "\n\n";
 
     debug(1) << "Performing storage flattening...\n";
     s = storage_flattening(s, outputs, env, t);
+    profile.pass("storage_flattening", s);
     debug(2) << "Lowering after storage flattening:\n" << s << "\n\n";
 
+    debug(1) << "Rewriting streamed allocations...\n";
+    s = rewrite_streamed_allocations(s, env);
+    profile.pass("rewrite_streamed_allocations", s);
+
+    debug(1) << "Hoisting storage...\n";
+    s = hoist_storage(s, env);
+    profile.pass("hoist_storage", s);
+    debug(2) << "Lowering after hoisting storage:\n" << s << "\n\n";
+
+    debug(1) << "Sizing parallel tasks...\n";
+    s = size_parallel_tasks(s, env, pipeline_name);
+    profile.pass("size_parallel_tasks", s);
+    debug(2) << "Lowering after sizing parallel tasks:\n" << s << "\n\n";
+
     debug(1) << "Unpacking buffer arguments...\n";
     s = unpack_buffers(s);
+    profile.pass("unpack_buffers", s);
     debug(2) << "Lowering after unpacking buffer arguments...\n" << s << "\n\n";
 
+    debug(1) << "Injecting tensor core operations...\n";
+    s = inject_tensor_cores(s, t);
+    profile.pass("inject_tensor_cores", s);
+    debug(2) << "Lowering after injecting tensor core operations:\n" << s << "\n\n";
+
+    if (t.has_feature(Target::SpecializeUnitStride)) {
+        debug(1) << "Specializing loop nests on unit stride inputs and outputs...\n";
+        s = specialize_unit_stride(s);
+        profile.pass("specialize_unit_stride", s);
+        debug(2) << "Lowering after specializing on unit strides:\n" << s << "\n\n";
+    }
+
     if (any_memoized) {
         debug(1) << "Rewriting memoized allocations...\n";
         s = rewrite_memoized_allocations(s, env);
+        profile.pass("rewrite_memoized_allocations", s);
         debug(2) << "Lowering after rewriting memoized allocations:\n" << s << "\n\n";
     } else {
         debug(1) << "Skipping rewriting memoized allocations...\n";
@@ -217,107 +489,217 @@ Module lower(const vector<Function> &output_funcs, const string &pipeline_name,
         (t.arch != Target::Hexagon && (t.features_any_of({Target::HVX_64, Target::HVX_128})))) {
         debug(1) << "Selecting a GPU API for GPU loops...\n";
         s = select_gpu_api(s, t);
+        profile.pass("select_gpu_api", s);
         debug(2) << "Lowering after selecting a GPU API:\n" << s << "\n\n";
 
+        if (t.has_feature(Target::FuseGPUKernels)) {
+            debug(1) << "Fusing consecutive GPU kernels...\n";
+            s = fuse_gpu_kernels(s);
+            profile.pass("fuse_gpu_kernels", s);
+            debug(2) << "Lowering after fusing consecutive GPU kernels:\n" << s << "\n\n";
+        }
+
         debug(1) << "Injecting host <-> dev buffer copies...\n";
         s = inject_host_dev_buffer_copies(s, t);
+        profile.pass("inject_host_dev_buffer_copies", s);
         debug(2) << "Lowering after injecting host <-> dev buffer copies:\n" << s << "\n\n";
 
         debug(1) << "Selecting a GPU API for extern stages...\n";
         s = select_gpu_api(s, t);
+        profile.pass("select_gpu_api", s);
         debug(2) << "Lowering after selecting a GPU API for extern stages:\n" << s << "\n\n";
     }
 
     if (t.has_feature(Target::OpenGL)) {
         debug(1) << "Injecting OpenGL texture intrinsics...\n";
         s = inject_opengl_intrinsics(s);
+        profile.pass("inject_opengl_intrinsics", s);
         debug(2) << "Lowering after OpenGL intrinsics:\n" << s << "\n\n";
     }
 
     if (t.has_gpu_feature() ||
         t.has_feature(Target::OpenGLCompute)) {
         debug(1) << "Injecting per-block gpu synchronization...\n";
-        s = fuse_gpu_thread_loops(s);
+        s = fuse_gpu_thread_loops(s, t);
+        profile.pass("fuse_gpu_thread_loops", s);
         debug(2) << "Lowering after injecting per-block gpu synchronization:\n" << s << "\n\n";
     }
 
     debug(1) << "Simplifying...\n";
     s = simplify(s);
+    profile.pass("simplify", s);
     s = unify_duplicate_lets(s);
+    profile.pass("unify_duplicate_lets", s);
     s = remove_trivial_for_loops(s);
+    profile.pass("remove_trivial_for_loops", s);
     debug(2) << "Lowering after second simplifcation:\n" << s << "\n\n";
 
     debug(1) << "Reduce prefetch dimension...\n";
     s = reduce_prefetch_dimension(s, t);
+    profile.pass("reduce_prefetch_dimension", s);
     debug(2) << "Lowering after reduce prefetch dimension:\n" << s << "\n";
 
     debug(1) << "Unrolling...\n";
     s = unroll_loops(s);
+    profile.pass("unroll_loops", s);
     s = simplify(s);
+    profile.pass("simplify", s);
     debug(2) << "Lowering after unrolling:\n" << s << "\n\n";
 
+    if (t.has_large_buffers()) {
+        debug(1) << "Narrowing indices in inner loops...\n";
+        s = narrow_large_buffer_indices(s);
+        profile.pass("narrow_large_buffer_indices", s);
+        debug(2) << "Lowering after narrowing indices:\n" << s << "\n\n";
+    }
+
     debug(1) << "Vectorizing...\n";
-    s = vectorize_loops(s, t);
+    s = vectorize_loops(s, env, t);
+    profile.pass("vectorize_loops", s);
     s = simplify(s);
+    profile.pass("simplify", s);
     debug(2) << "Lowering after vectorizing:\n" << s << "\n\n";
 
-    debug(1) << "Detecting vector interleavings...\n";
-    s = rewrite_interleavings(s);
-    s = simplify(s);
-    debug(2) << "Lowering after rewriting vector interleavings:\n" << s << "\n\n";
-
-    debug(1) << "Partitioning loops to simplify boundary conditions...\n";
-    s = partition_loops(s);
-    s = simplify(s);
-    debug(2) << "Lowering after partitioning loops:\n" << s << "\n\n";
+    if (t.opt_level() >= 2) {
+        debug(1) << "Detecting vector interleavings...\n";
+        s = rewrite_interleavings(s);
+        profile.pass("rewrite_interleavings", s);
+        s = simplify(s);
+        profile.pass("simplify", s);
+        debug(2) << "Lowering after rewriting vector interleavings:\n" << s << "\n\n";
+
+        debug(1) << "Partitioning loops to simplify boundary conditions...\n";
+        s = partition_loops(s);
+        profile.pass("partition_loops", s);
+        s = simplify(s);
+        profile.pass("simplify", s);
+        debug(2) << "Lowering after partitioning loops:\n" << s << "\n\n";
+
+        debug(1) << "Trimming loops to the region over which they do something...\n";
+        s = trim_no_ops(s);
+        profile.pass("trim_no_ops", s);
+        debug(2) << "Lowering after loop trimming:\n" << s << "\n\n";
+    } else {
+        // These passes only make the code faster. The likely tags
+        // that partition_loops would have consumed must still go.
+        s = remove_likely_tags(s);
+        profile.pass("remove_likely_tags", s);
+    }
 
-    debug(1) << "Trimming loops to the region over which they do something...\n";
-    s = trim_no_ops(s);
-    debug(2) << "Lowering after loop trimming:\n" << s << "\n\n";
+    if (t.opt_level() >= 1) {
+        debug(1) << "Optimizing division by loop invariants...\n";
+        s = optimize_loop_invariant_division(s, t);
+        profile.pass("optimize_loop_invariant_division", s);
+        debug(2) << "Lowering after optimizing division by loop invariants:\n" << s << "\n\n";
+    }
 
     debug(1) << "Injecting early frees...\n";
     s = inject_early_frees(s);
+    profile.pass("inject_early_frees", s);
     debug(2) << "Lowering after injecting early frees:\n" << s << "\n\n";
 
+    if (profile_branches(t)) {
+        debug(1) << "Applying branch profile...\n";
+        s = apply_branch_profile(s, pipeline_name);
+        profile.pass("apply_branch_profile", s);
+        debug(2) << "Lowering after applying branch profile:\n" << s << "\n\n";
+    }
+
     if (t.has_feature(Target::Profile)) {
         debug(1) << "Injecting profiling...\n";
         s = inject_profiling(s, pipeline_name);
+        profile.pass("inject_profiling", s);
         debug(2) << "Lowering after injecting profiling:\n" << s << "\n\n";
     }
 
     if (t.has_feature(Target::FuzzFloatStores)) {
         debug(1) << "Fuzzing floating point stores...\n";
         s = fuzz_float_stores(s);
+        profile.pass("fuzz_float_stores", s);
         debug(2) << "Lowering after fuzzing floating point stores:\n" << s << "\n\n";
     }
 
     debug(1) << "Simplifying...\n";
     s = common_subexpression_elimination(s);
-    s = loop_invariant_code_motion(s);
+    profile.pass("common_subexpression_elimination", s);
+    if (t.opt_level() >= 1) {
+        s = loop_invariant_code_motion(s);
+        profile.pass("loop_invariant_code_motion", s);
+    }
+
+    // Loop carrying and software pipelining need the load indices to
+    // stay linear in the loop variables, so they can't be replaced
+    // with induction variables first.
+    if (t.opt_level() >= 2 &&
+        t.arch != Target::Hexagon &&
+        !t.has_feature(Target::LoopCarry) &&
+        !t.has_feature(Target::SoftwarePipeline)) {
+        debug(1) << "Strength reducing address arithmetic...\n";
+        s = strength_reduce(s);
+        profile.pass("strength_reduce", s);
+        debug(2) << "Lowering after strength reducing address arithmetic:\n" << s << "\n\n";
+    }
 
     if (t.has_feature(Target::OpenGL)) {
         debug(1) << "Detecting varying attributes...\n";
         s = find_linear_expressions(s);
+        profile.pass("find_linear_expressions", s);
         debug(2) << "Lowering after detecting varying attributes:\n" << s << "\n\n";
 
         debug(1) << "Moving varying attribute expressions out of the shader...\n";
         s = setup_gpu_vertex_buffer(s);
+        profile.pass("setup_gpu_vertex_buffer", s);
         debug(2) << "Lowering after removing varying attributes:\n" << s << "\n\n";
     }
 
     s = remove_dead_allocations(s);
+    profile.pass("remove_dead_allocations", s);
     s = remove_trivial_for_loops(s);
+    profile.pass("remove_trivial_for_loops", s);
+
+    if (t.has_feature(Target::PackAllocations)) {
+        debug(1) << "Packing allocations...\n";
+        s = pack_allocations(s, t);
+        profile.pass("pack_allocations", s);
+        debug(2) << "Lowering after packing allocations:\n" << s << "\n\n";
+    }
+
+    debug(1) << "Using scratch arenas in parallel loops...\n";
+    s = use_scratch_arenas(s);
+    profile.pass("use_scratch_arenas", s);
+    debug(2) << "Lowering after using scratch arenas:\n" << s << "\n\n";
+
     s = simplify(s);
+    profile.pass("simplify", s);
     debug(1) << "Lowering after final simplification:\n" << s << "\n\n";
 
+    if (t.has_feature(Target::LoopCarry) && t.arch != Target::Hexagon && t.opt_level() >= 2) {
+        // Hexagon does this itself, after aligning loads.
+        debug(1) << "Carrying values across loop iterations...\n";
+        s = loop_carry(s, t);
+        s = simplify(s);
+        profile.pass("loop_carry", s);
+        debug(2) << "Lowering after carrying values across loop iterations:\n" << s << "\n\n";
+    }
+
+    if (t.has_feature(Target::SoftwarePipeline) && t.arch != Target::Hexagon && t.opt_level() >= 2) {
+        debug(1) << "Software-pipelining loads...\n";
+        s = pipeline_loads(s, t);
+        s = simplify(s);
+        profile.pass("pipeline_loads", s);
+        debug(2) << "Lowering after software-pipelining loads:\n" << s << "\n\n";
+    }
+
     debug(1) << "Splitting off Hexagon offload...\n";
     s = inject_hexagon_rpc(s, t, result_module);
+    profile.pass("inject_hexagon_rpc", s);
     debug(2) << "Lowering after splitting off Hexagon offload:\n" << s << '\n';
 
     if (!custom_passes.empty()) {
         for (size_t i = 0; i < custom_passes.size(); i++) {
             debug(1) << "Running custom lowering pass " << i << "...\n";
             s = custom_passes[i]->mutate(s);
+            profile.pass("custom pass", s);
             debug(1) << "Lowering after custom pass " << i << ":\n" << s << "\n\n";
         }
     }
@@ -396,6 +778,12 @@ Module lower(const vector<Function> &output_funcs, const string &pipeline_name,
     s = StrengthenRefs().mutate(s);
 
     LoweredFunc main_func(pipeline_name, public_args, s, linkage_type);
+    for (LoweredArgument &arg : main_func.args) {
+        auto it = fixed_shapes.find(arg.name);
+        if (arg.is_buffer() && it != fixed_shapes.end()) {
+            arg.fixed_shape = it->second;
+        }
+    }
 
     // If we're in debug mode, add code that prints the args.
     if (t.has_feature(Target::Debug)) {
@@ -414,6 +802,10 @@ Module lower(const vector<Function> &output_funcs, const string &pipeline_name,
     // Also append any wrappers for extern stages that expect the old buffer_t
     wrap_legacy_extern_stages(result_module);
 
+    profile.pass("finalize", s);
+    profile.code_size(s);
+    profile.report();
+
     return result_module;
 }
 
@@ -15,8 +15,12 @@ namespace Internal {
 namespace {
 
 class FindParameterDependencies : public IRGraphVisitor {
+    // The largest buffer to hash the contents of, or zero if buffers
+    // can't be part of the key.
+    int64_t hashed_buffer_max_bytes;
+
 public:
-    FindParameterDependencies() { }
+    FindParameterDependencies(int64_t max_bytes) : hashed_buffer_max_bytes(max_bytes) { }
     ~FindParameterDependencies() { }
 
     void visit_function(const Function &function) {
@@ -28,9 +32,11 @@ public:
             for (size_t i = 0; i < extern_args.size(); i++) {
                 if (extern_args[i].is_buffer()) {
                     // Function with an extern definition
-                    record(Halide::Internal::Parameter(extern_args[i].buffer.type(), true,
-                                                       extern_args[i].buffer.dimensions(),
-                                                       extern_args[i].buffer.name()));
+                    Halide::Internal::Parameter p(extern_args[i].buffer.type(), true,
+                                                  extern_args[i].buffer.dimensions(),
+                                                  extern_args[i].buffer.name());
+                    p.set_buffer(extern_args[i].buffer);
+                    record(p);
                 } else if (extern_args[i].is_image_param()) {
                     record(extern_args[i].image_param);
                 }
@@ -84,12 +90,22 @@ public:
 
         info.type = parameter.type();
 
-        if (parameter.is_buffer()) {
+        if (parameter.is_buffer() && hashed_buffer_max_bytes > 0) {
+            // Key on a hash of the contents of the buffer.
+            info.type = UInt(64);
+            info.size_expr = info.type.bytes();
+            Expr buffer = Variable::make(type_of<struct halide_buffer_t *>(),
+                                         parameter.name() + ".buffer", parameter);
+            info.value_expr = Call::make(UInt(64), "halide_memoization_hash_buffer",
+                                         {buffer, make_const(Int(64), hashed_buffer_max_bytes)},
+                                         Call::Extern);
+        } else if (parameter.is_buffer()) {
             internal_error << "Buffer parameter " << parameter.name() <<
                 " encountered in computed_cached computation.\n" <<
                 "Computations which depend on buffer parameters " <<
                 "cannot be scheduled compute_cached.\n" <<
-                "Use memoize_tag to provide cache key information for buffer.\n";
+                "Use memoize_tag to provide cache key information for buffer, " <<
+                "or memoize_buffer_contents to key on its contents.\n";
         } else if (info.type.is_handle()) {
             internal_error << "Handle parameter " << parameter.name() <<
                 " encountered in computed_cached computation.\n" <<
@@ -182,7 +198,8 @@ class KeyInfo {
 
 public:
   KeyInfo(const Function &function, const std::string &name)
-        : top_level_name(name), function_name(function.name())
+        : dependencies(function.schedule().hashed_buffer_max_bytes()),
+          top_level_name(name), function_name(function.name())
     {
         dependencies.visit_function(function);
         size_t size_so_far = 0;
@@ -0,0 +1,271 @@
+#include "MemoryReport.h"
+#include "CodeGen_Internal.h"
+#include "IROperator.h"
+#include "IRPrinter.h"
+#include "IRVisitor.h"
+#include "Simplify.h"
+#include "Util.h"
+
+#include <fstream>
+#include <map>
+#include <sstream>
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::ostream;
+using std::pair;
+using std::string;
+using std::vector;
+
+namespace {
+
+struct AllocationInfo {
+    string name;
+    Type type;
+    vector<Expr> extents;
+    // The size in bytes, and the same as a number if it's a
+    // constant. Zero otherwise.
+    Expr bytes;
+    int64_t constant_bytes;
+    // One of "stack", "heap", "scratch_arena", "custom",
+    // "gpu_shared" or "gpu_local".
+    string storage;
+    // The innermost enclosing loop, and the innermost enclosing
+    // parallel loop. Empty at the top level.
+    string loop, parallel_loop;
+    bool conditional;
+    // For the slabs made by pack_allocations, the buffers placed
+    // within it, and their sizes in bytes.
+    vector<pair<string, Expr>> members;
+};
+
+struct FunctionFootprint {
+    vector<AllocationInfo> allocations;
+    // The most constant-sized stack memory live at once on the
+    // calling thread, and on any thread running a parallel loop body.
+    int64_t stack_bytes = 0, stack_bytes_per_thread = 0;
+    // The sum of the constant-sized heap allocations (including those
+    // from scratch arenas) outside and inside parallel loops, and the
+    // number of heap allocations with sizes only known at runtime.
+    int64_t heap_bytes = 0, heap_bytes_per_thread = 0;
+    int symbolic_heap_allocations = 0;
+};
+
+class FindAllocations : public IRVisitor {
+    using IRVisitor::visit;
+
+    vector<string> loops;
+    string parallel_loop;
+    bool in_gpu_block = false, in_gpu_thread = false;
+    int64_t stack = 0, thread_stack = 0;
+    map<string, vector<pair<string, Expr>>> slab_members;
+
+    void visit(const For *op) {
+        bool old_gpu_block = in_gpu_block, old_gpu_thread = in_gpu_thread;
+        string old_parallel_loop = parallel_loop;
+        if (op->for_type == ForType::GPUBlock) {
+            in_gpu_block = true;
+        } else if (op->for_type == ForType::GPUThread) {
+            in_gpu_thread = true;
+        } else if (op->for_type == ForType::Parallel) {
+            parallel_loop = op->name;
+        }
+        loops.push_back(op->name);
+        IRVisitor::visit(op);
+        loops.pop_back();
+        in_gpu_block = old_gpu_block;
+        in_gpu_thread = old_gpu_thread;
+        parallel_loop = old_parallel_loop;
+    }
+
+    void visit(const LetStmt *op) {
+        // pack_allocations names the size of each buffer placed in a
+        // slab <slab>.<buffer>.size, and the size of the whole slab
+        // <slab>.size.
+        if (starts_with(op->name, "allocation_slab") && ends_with(op->name, ".size")) {
+            size_t dot = op->name.find('.');
+            size_t suffix = op->name.size() - 5;
+            if (dot < suffix) {
+                slab_members[op->name.substr(0, dot)].push_back({op->name.substr(dot + 1, suffix - dot - 1), op->value});
+            }
+        }
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Allocate *op) {
+        const Call *new_call = op->new_expr.as<Call>();
+        if (new_call && (new_call->name == "halide_scratch_arenas_create" ||
+                         new_call->name == "halide_scratch_arena_acquire")) {
+            // Bookkeeping for the scratch arenas, not a buffer.
+            IRVisitor::visit(op);
+            return;
+        }
+
+        AllocationInfo a;
+        a.name = op->name;
+        a.type = op->type;
+        a.extents = op->extents;
+        Expr bytes = make_const(Int(64), op->type.bytes());
+        for (Expr e : op->extents) {
+            bytes *= cast<int64_t>(e);
+        }
+        a.bytes = simplify(bytes);
+        const int64_t *c = as_const_int(a.bytes);
+        a.constant_bytes = c ? *c : 0;
+        a.loop = loops.empty() ? "" : loops.back();
+        a.parallel_loop = parallel_loop;
+        a.conditional = !is_one(op->condition);
+        auto it = slab_members.find(op->name);
+        if (it != slab_members.end()) {
+            a.members = it->second;
+        }
+
+        // Mirror the choices made by the code generators.
+        if (in_gpu_thread) {
+            a.storage = "gpu_local";
+        } else if (in_gpu_block) {
+            a.storage = "gpu_shared";
+        } else if (new_call && new_call->name == "halide_scratch_arena_alloc") {
+            a.storage = "scratch_arena";
+        } else if (op->new_expr.defined()) {
+            a.storage = "custom";
+        } else if (op->extents.empty() ||
+                   (a.constant_bytes > 0 && can_allocation_fit_on_stack(a.constant_bytes))) {
+            a.storage = "stack";
+        } else {
+            a.storage = "heap";
+        }
+
+        const bool per_thread = !parallel_loop.empty();
+        int64_t stack_bytes = 0;
+        if (a.storage == "stack") {
+            stack_bytes = a.constant_bytes;
+            int64_t &cur = per_thread ? thread_stack : stack;
+            cur += stack_bytes;
+            if (per_thread) {
+                result.stack_bytes_per_thread = std::max(result.stack_bytes_per_thread, cur);
+            } else {
+                result.stack_bytes = std::max(result.stack_bytes, cur);
+            }
+        } else if (a.storage == "heap" || a.storage == "scratch_arena") {
+            if (!a.constant_bytes) {
+                result.symbolic_heap_allocations++;
+            } else if (per_thread) {
+                result.heap_bytes_per_thread += a.constant_bytes;
+            } else {
+                result.heap_bytes += a.constant_bytes;
+            }
+        }
+        result.allocations.push_back(a);
+
+        IRVisitor::visit(op);
+
+        if (stack_bytes) {
+            (per_thread ? thread_stack : stack) -= stack_bytes;
+        }
+    }
+
+public:
+    FunctionFootprint result;
+};
+
+string json_string(const string &s) {
+    std::ostringstream os;
+    os << '"';
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            os << '\\' << c;
+        } else if (c == '\n') {
+            os << "\\n";
+        } else if ((unsigned char)c < 0x20) {
+            // Halide names and printed Exprs shouldn't contain any
+            // other control characters.
+            os << ' ';
+        } else {
+            os << c;
+        }
+    }
+    os << '"';
+    return os.str();
+}
+
+template<typename T>
+string json_string_of(const T &value) {
+    std::ostringstream os;
+    os << value;
+    return json_string(os.str());
+}
+
+void print_allocation(ostream &os, const AllocationInfo &a) {
+    os << "        {\n"
+       << "          \"name\": " << json_string(a.name) << ",\n"
+       << "          \"type\": " << json_string_of(a.type) << ",\n"
+       << "          \"extents\": [";
+    for (size_t i = 0; i < a.extents.size(); i++) {
+        os << (i ? ", " : "") << json_string_of(a.extents[i]);
+    }
+    os << "],\n"
+       << "          \"bytes\": " << json_string_of(a.bytes) << ",\n";
+    if (a.constant_bytes) {
+        os << "          \"constant_bytes\": " << a.constant_bytes << ",\n";
+    } else {
+        os << "          \"constant_bytes\": null,\n";
+    }
+    os << "          \"storage\": " << json_string(a.storage) << ",\n"
+       << "          \"conditional\": " << (a.conditional ? "true" : "false") << ",\n"
+       << "          \"loop\": " << json_string(a.loop) << ",\n"
+       << "          \"per_thread\": " << (a.parallel_loop.empty() ? "false" : "true") << ",\n"
+       << "          \"parallel_loop\": " << json_string(a.parallel_loop);
+    if (!a.members.empty()) {
+        os << ",\n"
+           << "          \"members\": [";
+        for (size_t i = 0; i < a.members.size(); i++) {
+            os << (i ? ", " : "") << "{\"name\": " << json_string(a.members[i].first)
+               << ", \"bytes\": " << json_string_of(a.members[i].second) << "}";
+        }
+        os << "]";
+    }
+    os << "\n"
+       << "        }";
+}
+
+}  // namespace
+
+void print_memory_report(const string &filename, const Module &m) {
+    std::ofstream os(filename);
+    user_assert(os.is_open()) << "Could not open " << filename << " for writing.\n";
+
+    os << "{\n"
+       << "  \"module\": " << json_string(m.name()) << ",\n"
+       << "  \"target\": " << json_string(m.target().to_string()) << ",\n"
+       << "  \"functions\": [";
+    const vector<LoweredFunc> &functions = m.functions();
+    for (size_t i = 0; i < functions.size(); i++) {
+        FindAllocations finder;
+        functions[i].body.accept(&finder);
+        const FunctionFootprint &f = finder.result;
+
+        os << (i ? ",\n" : "\n")
+           << "    {\n"
+           << "      \"name\": " << json_string(functions[i].name) << ",\n"
+           << "      \"stack_bytes\": " << f.stack_bytes << ",\n"
+           << "      \"stack_bytes_per_thread\": " << f.stack_bytes_per_thread << ",\n"
+           << "      \"heap_bytes\": " << f.heap_bytes << ",\n"
+           << "      \"heap_bytes_per_thread\": " << f.heap_bytes_per_thread << ",\n"
+           << "      \"symbolic_heap_allocations\": " << f.symbolic_heap_allocations << ",\n"
+           << "      \"allocations\": [";
+        for (size_t j = 0; j < f.allocations.size(); j++) {
+            os << (j ? ",\n" : "\n");
+            print_allocation(os, f.allocations[j]);
+        }
+        os << (f.allocations.empty() ? "]\n" : "\n      ]\n")
+           << "    }";
+    }
+    os << (functions.empty() ? "]\n" : "\n  ]\n")
+       << "}\n";
+}
+
+}
+}
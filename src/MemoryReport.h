@@ -0,0 +1,26 @@
+#ifndef HALIDE_MEMORY_REPORT_H
+#define HALIDE_MEMORY_REPORT_H
+
+/** \file
+ * Defines a function to write a JSON report of the memory allocated
+ * by the functions in a Module.
+ */
+
+#include "Module.h"
+
+namespace Halide {
+namespace Internal {
+
+/** Write a JSON description of the footprint of every allocation made
+ * by the lowered functions in a Module to filename. Each allocation
+ * records its size as a symbolic expression (and as a number when it
+ * is constant), whether it is placed on the stack, the heap, a
+ * scratch arena or in GPU memory, and whether one copy is made per
+ * thread because it is inside a parallel loop. Each function also gets totals of its
+ * constant-sized stack and heap use. */
+EXPORT void print_memory_report(const std::string &filename, const Module &m);
+
+}
+}
+
+#endif
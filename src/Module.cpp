@@ -13,6 +13,7 @@
 #include "LLVM_Runtime_Linker.h"
 #include "IROperator.h"
 #include "Outputs.h"
+#include "MemoryReport.h"
 #include "StmtToHtml.h"
 #include "WrapExternStages.h"
 #include "ThreadPool.h"
@@ -71,6 +72,20 @@ private:
     void operator=(const TemporaryObjectFileDir &) = delete;
 };
 
+// The number of pieces to split a module's code generation into when
+// producing a static library, from HL_CODEGEN_THREADS. Defaults to 1,
+// which generates a single object as usual.
+int codegen_partitions() {
+    std::string threads = get_env_variable("HL_CODEGEN_THREADS");
+    if (threads.empty()) {
+        return 1;
+    }
+    // Debug output from concurrent code generation is unreadable.
+    if (debug::debug_level() > 0) {
+        return 1;
+    }
+    return std::max(1, atoi(threads.c_str()));
+}
 
 // Given a pathname of the form /path/to/name.ext, append suffix before ext to produce /path/to/namesuffix.ext
 std::string add_suffix(const std::string &path, const std::string &suffix) {
@@ -90,6 +105,7 @@ Outputs add_suffixes(const Outputs &in, const std::string &suffix) {
     if (!in.c_source_name.empty()) out.c_source_name = add_suffix(in.c_source_name, suffix);
     if (!in.stmt_name.empty()) out.stmt_name = add_suffix(in.stmt_name, suffix);
     if (!in.stmt_html_name.empty()) out.stmt_html_name = add_suffix(in.stmt_html_name, suffix);
+    if (!in.memory_report_name.empty()) out.memory_report_name = add_suffix(in.memory_report_name, suffix);
     return out;
 }
 
@@ -330,7 +346,21 @@ void Module::compile(const Outputs &output_files) const {
             // at the same time, so there is no meaningful performance advantage
             // to be had.
             TemporaryObjectFileDir temp_dir;
-            {
+            // A library may hold several objects, so its code can be
+            // generated in parallel (see HL_CODEGEN_THREADS).
+            int num_partitions = codegen_partitions();
+            if (num_partitions > 1) {
+                std::vector<std::vector<char>> objects =
+                    compile_llvm_module_to_object_partitions(*llvm_module, num_partitions);
+                for (size_t i = 0; i < objects.size(); i++) {
+                    std::string object_name =
+                        temp_dir.add_temp_object_file(output_files.static_library_name, "_" + std::to_string(i), target());
+                    debug(1) << "Module.compile(): temporary object_name " << object_name << "\n";
+                    auto out = make_raw_fd_ostream(object_name);
+                    out->write(objects[i].data(), objects[i].size());
+                    out->flush();
+                }
+            } else {
                 std::string object_name = temp_dir.add_temp_object_file(output_files.static_library_name, "", target());
                 debug(1) << "Module.compile(): temporary object_name " << object_name << "\n";
                 auto out = make_raw_fd_ostream(object_name);
@@ -385,6 +415,10 @@ void Module::compile(const Outputs &output_files) const {
         debug(1) << "Module.compile(): stmt_html_name " << output_files.stmt_html_name << "\n";
         Internal::print_to_html(output_files.stmt_html_name, *this);
     }
+    if (!output_files.memory_report_name.empty()) {
+        debug(1) << "Module.compile(): memory_report_name " << output_files.memory_report_name << "\n";
+        Internal::print_memory_report(output_files.memory_report_name, *this);
+    }
 }
 
 Outputs compile_standalone_runtime(const Outputs &output_files, Target t) {
@@ -404,7 +438,8 @@ void compile_multitarget(const std::string &fn_name,
                          const Outputs &output_files,
                          const std::vector<Target> &targets,
                          ModuleProducer module_producer,
-                         const std::map<std::string, std::string> &suffixes) {
+                         const std::map<std::string, std::string> &suffixes,
+                         bool module_producer_is_reentrant) {
     user_assert(!fn_name.empty()) << "Function name must be specified.\n";
     user_assert(!targets.empty()) << "Must specify at least one target.\n";
 
@@ -450,6 +485,7 @@ void compile_multitarget(const std::string &fn_name,
     TemporaryObjectFileDir temp_dir;
     std::vector<Expr> wrapper_args;
     std::vector<LoweredArgument> base_target_args;
+    int base_target_future = -1;
     for (const Target &target : targets) {
         // arch-bits-os must be identical across all targets.
         if (target.os != base_target.os ||
@@ -490,18 +526,39 @@ void compile_multitarget(const std::string &fn_name,
             sub_fn_target = sub_fn_target.without_feature(Target::Matlab);
         }
 
-        Module sub_module = module_producer(sub_fn_name, sub_fn_target);
-        // Re-assign every time -- should be the same across all targets anyway,
-        // but base_target is always the last one we encounter.
-        base_target_args = sub_module.get_function_by_name(sub_fn_name).args;
-
         Outputs sub_out = add_suffixes(output_files, suffix);
         internal_assert(sub_out.object_name.empty());
         sub_out.object_name = temp_dir.add_temp_object_file(output_files.static_library_name, suffix, target);
-        futures.emplace_back(pool.async([](Module m, Outputs o) {
-            debug(1) << "compile_multitarget: compile_sub_target " << o.object_name << "\n";
-            m.compile(o);
-        }, std::move(sub_module), std::move(sub_out)));
+
+        // The arguments should be the same across all targets anyway,
+        // but take them from the base target, which is always the last
+        // one we encounter.
+        std::vector<LoweredArgument> *sub_args = (&target == &base_target) ? &base_target_args : nullptr;
+        if (module_producer_is_reentrant) {
+            // Lower and compile each sub-target concurrently.
+            futures.emplace_back(pool.async([&module_producer](std::string name, Target t, Outputs o,
+                                                               std::vector<LoweredArgument> *args) {
+                debug(1) << "compile_multitarget: lower_sub_target " << name << "\n";
+                Module m = module_producer(name, t);
+                if (args) {
+                    *args = m.get_function_by_name(name).args;
+                }
+                debug(1) << "compile_multitarget: compile_sub_target " << o.object_name << "\n";
+                m.compile(o);
+            }, sub_fn_name, sub_fn_target, std::move(sub_out), sub_args));
+            if (sub_args) {
+                base_target_future = futures.size() - 1;
+            }
+        } else {
+            Module sub_module = module_producer(sub_fn_name, sub_fn_target);
+            if (sub_args) {
+                *sub_args = sub_module.get_function_by_name(sub_fn_name).args;
+            }
+            futures.emplace_back(pool.async([](Module m, Outputs o) {
+                debug(1) << "compile_multitarget: compile_sub_target " << o.object_name << "\n";
+                m.compile(o);
+            }, std::move(sub_module), std::move(sub_out)));
+        }
 
         const uint64_t cur_target_mask = target_feature_mask(target);
         Expr can_use = (target == base_target) ?
@@ -538,6 +595,11 @@ void compile_multitarget(const std::string &fn_name,
         }, std::move(runtime_target), std::move(runtime_out)));
     }
 
+    // The wrapper and header need the base target's arguments.
+    if (base_target_future >= 0) {
+        futures[base_target_future].wait();
+    }
+
     if (needs_wrapper) {
         Expr indirect_result = Call::make(Int(32), Call::call_cached_indirect_function, wrapper_args, Call::Intrinsic);
         std::string private_result_name = unique_name(fn_name + "_result");
@@ -591,10 +653,15 @@ void compile_multitarget(const std::string &fn_name,
         }, std::move(header_module), std::move(header_out)));
     }
 
-    // Must wait for everything to finish before we create the static library
+    // Must wait for everything to finish before we create the static
+    // library. Wait for all of them before rethrowing any error, as the
+    // jobs refer to this frame.
     for (auto &f : futures) {
         f.wait();
     }
+    for (auto &f : futures) {
+        f.get();
+    }
 
     if (!output_files.static_library_name.empty()) {
         debug(1) << "compile_multitarget: static_library_name " << output_files.static_library_name << "\n";
@@ -26,6 +26,12 @@ struct LoweredArgument : public Argument {
      * argument. */
     ModulusRemainder alignment;
 
+    /** For buffer arguments, the shape a bounds query proposes when
+     * all the buffers passed in satisfy their constraints, if the
+     * constraints fix it. The stride of a dimension is zero if it
+     * isn't fixed. Empty if the shape isn't fixed. */
+    std::vector<halide_dimension_t> fixed_shape;
+
     LoweredArgument() {}
     LoweredArgument(const Argument &arg) : Argument(arg) {}
     LoweredArgument(const std::string &_name, Kind _kind, const Type &_type, uint8_t _dimensions,
@@ -143,11 +149,17 @@ EXPORT Outputs compile_standalone_runtime(const Outputs &output_files, Target t)
 
 typedef std::function<Module(const std::string &, const Target &)> ModuleProducer;
 
+/** Compile a function for several targets into a single static
+ * library, which picks the best one at runtime. The module producer is
+ * called once per target. If module_producer_is_reentrant is true, it
+ * may be called from several threads at once, so that lowering for
+ * each target happens in parallel as well as code generation. */
 EXPORT void compile_multitarget(const std::string &fn_name,
                                 const Outputs &output_files,
                                 const std::vector<Target> &targets,
                                 ModuleProducer module_producer,
-                                const std::map<std::string, std::string> &suffixes = {});
+                                const std::map<std::string, std::string> &suffixes = {},
+                                bool module_producer_is_reentrant = false);
 
 }
 
@@ -330,6 +330,24 @@ class MonotonicVisitor : public IRVisitor {
         result = Monotonic::Constant;
     }
 
+    void visit(const VectorReduce *op) {
+        op->value.accept(this);
+        switch (op->op) {
+        case VectorReduce::Add:
+        case VectorReduce::Min:
+        case VectorReduce::Max:
+            // Monotonic in each lane, so monotonic overall.
+            break;
+        case VectorReduce::Mul:
+        case VectorReduce::And:
+        case VectorReduce::Or:
+            if (result != Monotonic::Constant) {
+                result = Monotonic::Unknown;
+            }
+            break;
+        }
+    }
+
     void visit(const LetStmt *op) {
         internal_error << "Monotonic of statement\n";
     }
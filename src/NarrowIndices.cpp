@@ -0,0 +1,223 @@
+#include "NarrowIndices.h"
+#include "Bounds.h"
+#include "ExprUsesVar.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+#include "Scope.h"
+#include "Simplify.h"
+#include "Substitute.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::string;
+
+namespace {
+
+class ContainsLoop : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const For *) {
+        result = true;
+    }
+
+public:
+    bool result = false;
+};
+
+bool contains_loop(Stmt s) {
+    ContainsLoop c;
+    s.accept(&c);
+    return c.result;
+}
+
+// Compute the low 32 bits of a 64-bit index expression in unsigned
+// 32-bit arithmetic, which wraps instead of overflowing. Returns an
+// undefined Expr if the expression isn't made of sign-extended 32-bit
+// values and constants.
+Expr low_bits(Expr e) {
+    if (const Cast *c = e.as<Cast>()) {
+        if ((c->value.type().is_int() || c->value.type().is_uint()) && c->value.type().bits() <= 32) {
+            return cast(UInt(32), c->value);
+        }
+    } else if (const IntImm *i = e.as<IntImm>()) {
+        return make_const(UInt(32), (uint64_t)i->value & 0xffffffff);
+    } else if (const Add *a = e.as<Add>()) {
+        Expr x = low_bits(a->a), y = low_bits(a->b);
+        if (x.defined() && y.defined()) {
+            return x + y;
+        }
+    } else if (const Sub *s = e.as<Sub>()) {
+        Expr x = low_bits(s->a), y = low_bits(s->b);
+        if (x.defined() && y.defined()) {
+            return x - y;
+        }
+    } else if (const Mul *m = e.as<Mul>()) {
+        Expr x = low_bits(m->a), y = low_bits(m->b);
+        if (x.defined() && y.defined()) {
+            return x * y;
+        }
+    }
+    return Expr();
+}
+
+class NarrowIndices : public IRMutator {
+    using IRMutator::visit;
+
+    // The innermost loop we're in, if any.
+    string loop_var;
+    Expr loop_min;
+    Scope<Interval> bounds;
+    // Variables defined inside the loop body, whose values depend on
+    // the loop variable.
+    Scope<int> varying;
+
+    bool uses_varying(Expr e) {
+        return expr_uses_var(e, loop_var) || expr_uses_vars(e, varying);
+    }
+
+    Expr narrow(Expr index) {
+        if (loop_var.empty() || index.type() != Int(64)) {
+            return index;
+        }
+        Expr base = simplify(substitute(loop_var, loop_min, index));
+        if (uses_varying(base)) {
+            // The index depends on the loop through a let, so the
+            // base wouldn't be loop invariant.
+            return index;
+        }
+        Expr offset = simplify(index - base);
+        if (!uses_varying(offset)) {
+            return index;
+        }
+        Interval i = bounds_of_expr_in_scope(offset, bounds);
+        if (!i.is_bounded() ||
+            !can_prove(i.min >= Int(32).min() && i.max <= Int(32).max())) {
+            return index;
+        }
+
+        // Prefer a form that stays affine in the loop variable, so
+        // that vectorization still finds dense ramps.
+        Expr loop = Variable::make(Int(32), loop_var);
+        Expr stride = simplify(substitute(loop_var, loop_min + 1, index) - base);
+        const int64_t *s = as_const_int(stride);
+        Expr narrow_offset;
+        if (s && *s >= INT32_MIN && *s <= INT32_MAX &&
+            is_zero(simplify(offset - cast<int64_t>(loop - loop_min) * (int)*s))) {
+            // The offset is bounded, and |stride| >= 1 if it's used,
+            // so the product fits in 32 bits.
+            narrow_offset = (loop - loop_min) * (int)*s;
+        } else {
+            Expr a = low_bits(index), b = low_bits(base);
+            if (!a.defined() || !b.defined()) {
+                return index;
+            }
+            // The offset fits in 32 bits, so its low 32 bits are
+            // enough to recover it.
+            narrow_offset = cast(Int(32), a - b);
+        }
+        debug(4) << "Narrowing index " << index << " to " << base << " + " << narrow_offset << "\n";
+        return base + cast<int64_t>(narrow_offset);
+    }
+
+    void visit(const For *op) {
+        if (!loop_var.empty() ||
+            contains_loop(op->body) ||
+            op->for_type == ForType::GPUBlock ||
+            op->for_type == ForType::GPUThread ||
+            (op->device_api != DeviceAPI::None && op->device_api != DeviceAPI::Host)) {
+            IRMutator::visit(op);
+            return;
+        }
+
+        loop_var = op->name;
+        loop_min = op->min;
+        bounds.push(op->name, Interval(op->min, simplify(op->min + op->extent - 1)));
+        Stmt body = mutate(op->body);
+        bounds.pop(op->name);
+        loop_var.clear();
+        loop_min = Expr();
+
+        if (body.same_as(op->body)) {
+            stmt = op;
+        } else {
+            stmt = For::make(op->name, op->min, op->extent, op->for_type, op->device_api, body);
+        }
+    }
+
+    void visit(const LetStmt *op) {
+        if (loop_var.empty()) {
+            IRMutator::visit(op);
+            return;
+        }
+        Expr value = mutate(op->value);
+        bool is_varying = uses_varying(value);
+        bounds.push(op->name, bounds_of_expr_in_scope(value, bounds));
+        if (is_varying) {
+            varying.push(op->name, 0);
+        }
+        Stmt body = mutate(op->body);
+        if (is_varying) {
+            varying.pop(op->name);
+        }
+        bounds.pop(op->name);
+        if (value.same_as(op->value) && body.same_as(op->body)) {
+            stmt = op;
+        } else {
+            stmt = LetStmt::make(op->name, value, body);
+        }
+    }
+
+    void visit(const Let *op) {
+        if (loop_var.empty()) {
+            IRMutator::visit(op);
+            return;
+        }
+        Expr value = mutate(op->value);
+        bool is_varying = uses_varying(value);
+        bounds.push(op->name, bounds_of_expr_in_scope(value, bounds));
+        if (is_varying) {
+            varying.push(op->name, 0);
+        }
+        Expr body = mutate(op->body);
+        if (is_varying) {
+            varying.pop(op->name);
+        }
+        bounds.pop(op->name);
+        if (value.same_as(op->value) && body.same_as(op->body)) {
+            expr = op;
+        } else {
+            expr = Let::make(op->name, value, body);
+        }
+    }
+
+    void visit(const Load *op) {
+        Expr predicate = mutate(op->predicate);
+        Expr index = narrow(mutate(op->index));
+        if (predicate.same_as(op->predicate) && index.same_as(op->index)) {
+            expr = op;
+        } else {
+            expr = Load::make(op->type, op->name, index, op->image, op->param, predicate);
+        }
+    }
+
+    void visit(const Store *op) {
+        Expr predicate = mutate(op->predicate);
+        Expr value = mutate(op->value);
+        Expr index = narrow(mutate(op->index));
+        if (predicate.same_as(op->predicate) && value.same_as(op->value) && index.same_as(op->index)) {
+            stmt = op;
+        } else {
+            stmt = Store::make(op->name, value, index, op->param, predicate);
+        }
+    }
+};
+
+}  // namespace
+
+Stmt narrow_large_buffer_indices(Stmt s) {
+    return NarrowIndices().mutate(s);
+}
+
+}
+}
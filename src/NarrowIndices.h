@@ -0,0 +1,26 @@
+#ifndef HALIDE_NARROW_INDICES_H
+#define HALIDE_NARROW_INDICES_H
+
+/** \file
+ * Defines the lowering pass that computes the 64-bit indices of loads
+ * and stores in inner loops as a 64-bit base plus a 32-bit offset.
+ */
+
+#include "IR.h"
+
+namespace Halide {
+namespace Internal {
+
+/** With large buffers, storage flattening computes every index in
+ * 64-bit arithmetic. For each load and store in an innermost loop,
+ * split the index into its value at the start of the loop, which is
+ * computed once in 64 bits, and an offset from it, which is computed
+ * in 32 bits if bounds inference can prove it always fits. Vectors of
+ * offsets then have twice the lanes per register. Must be called
+ * after storage flattening and before the loops are vectorized. */
+Stmt narrow_large_buffer_indices(Stmt s);
+
+}
+}
+
+#endif
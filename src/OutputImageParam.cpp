@@ -38,6 +38,20 @@ OutputImageParam &OutputImageParam::set_host_alignment(int bytes) {
     return *this;
 }
 
+OutputImageParam &OutputImageParam::trust_constraints(bool trusted) {
+    param.set_constraints_trusted(trusted);
+    return *this;
+}
+
+OutputImageParam &OutputImageParam::may_alias(const OutputImageParam &input) {
+    user_assert(input.defined()) << "Output buffer " << name() << " can't alias an undefined buffer\n";
+    user_assert(input.dimensions() == dimensions() && input.type() == type())
+        << "Output buffer " << name() << " can't alias input buffer " << input.name()
+        << ", because they have different types or dimensionalities\n";
+    param.add_aliased_input(input.name());
+    return *this;
+}
+
 int OutputImageParam::dimensions() const {
     return param.dimensions();
 }
@@ -58,6 +58,28 @@ public:
     /** Set the expected alignment of the host pointer in bytes. */
     EXPORT OutputImageParam &set_host_alignment(int);
 
+    /** Declare that the buffers passed in always satisfy the
+     * constraints set on the min, extent, and stride of each dimension
+     * (and the host alignment), so that the pipeline doesn't check
+     * them. Instead, the other checks on the buffer that the
+     * constraints prove to pass (for example that a buffer constrained
+     * to the size of the output is large enough) are removed at compile
+     * time. Passing a buffer that breaks the constraints is undefined
+     * behavior. */
+    EXPORT OutputImageParam &trust_constraints(bool trusted = true);
+
+    /** Declare that this output buffer may be the same buffer as the
+     * given input buffer, so that the pipeline can run in place. The
+     * two must then either not overlap at all, or have the same host
+     * pointer, mins, and strides, which is checked when the pipeline
+     * runs. Lowering checks that computing in place is safe: the
+     * Func producing this output must have no update definitions and
+     * no splits that compute some sites twice (use
+     * TailStrategy::GuardWithIf rather than ShiftInwards), each of its
+     * sites must read the input only at that same site, and no other
+     * output may read the input at all. */
+    EXPORT OutputImageParam &may_alias(const OutputImageParam &input);
+
     /** Get the dimensionality of this image parameter */
     EXPORT int dimensions() const;
 
@@ -50,6 +50,10 @@ struct Outputs {
      * output is desired. */
     std::string static_library_name;
 
+    /** The name of the emitted JSON report of the memory allocated by
+     * each function. Empty if no memory report is desired. */
+    std::string memory_report_name;
+
     /** Make a new Outputs struct that emits everything this one does
      * and also an object file with the given name. */
     Outputs object(const std::string &object_name) const {
@@ -121,6 +125,14 @@ struct Outputs {
         updated.static_library_name = static_library_name;
         return updated;
     }
+
+    /** Make a new Outputs struct that emits everything this one does
+     * and also a JSON memory report with the given name. */
+    Outputs memory_report(const std::string &memory_report_name) const {
+        Outputs updated = *this;
+        updated.memory_report_name = memory_report_name;
+        return updated;
+    }
 };
 
 }
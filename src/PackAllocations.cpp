@@ -0,0 +1,275 @@
+#include <map>
+
+#include "PackAllocations.h"
+#include "CodeGen_Internal.h"
+#include "ExprUsesVar.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+#include "Scope.h"
+#include "Simplify.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::string;
+using std::vector;
+
+namespace {
+
+// Buffers within a slab start at multiples of this many bytes, which
+// is at least the alignment halide_malloc provides on any target.
+const int slab_alignment = 128;
+
+struct PackableAllocation {
+    string name;
+    Type type;
+    vector<Expr> extents;
+    // When the buffer becomes live and dead, in terms of the
+    // statement numbering below.
+    int start, end;
+};
+
+// Walk the part of a Stmt that runs straight through, without
+// entering loops or conditionals, numbering statements in the order
+// they run, and find the allocations that could be moved into a
+// slab allocated at the start of it.
+class FindPackableAllocations : public IRVisitor {
+    using IRVisitor::visit;
+
+    // LetStmts inside the region. Allocations with sizes that depend
+    // on them can't be made at the start of the region.
+    Scope<int> inner_lets;
+
+    map<string, int> index;
+
+    int time = 0;
+
+    void visit(const For *op) {
+        time++;
+    }
+
+    void visit(const IfThenElse *op) {
+        time++;
+    }
+
+    void visit(const LetStmt *op) {
+        time++;
+        inner_lets.push(op->name, 0);
+        op->body.accept(this);
+        inner_lets.pop(op->name);
+    }
+
+    bool packable(const Allocate *op) {
+        if (op->new_expr.defined() ||
+            !op->free_function.empty() ||
+            !is_one(op->condition) ||
+            op->extents.empty()) {
+            return false;
+        }
+        // Leave alone anything that will go on the stack.
+        int32_t constant_size = Allocate::constant_allocation_size(op->extents, op->name);
+        if (constant_size > 0 &&
+            can_allocation_fit_on_stack((int64_t)constant_size * op->type.bytes())) {
+            return false;
+        }
+        for (Expr e : op->extents) {
+            if (expr_uses_vars(e, inner_lets)) {
+                return false;
+            }
+        }
+        // Buffers with a buffer_t may have a device allocation or be
+        // handed to extern stages, which may do their own thing with
+        // the host pointer.
+        return !stmt_uses_var(op->body, op->name + ".buffer");
+    }
+
+    void visit(const Allocate *op) {
+        time++;
+        int idx = -1;
+        if (packable(op)) {
+            idx = (int)result.size();
+            index[op->name] = idx;
+            result.push_back({op->name, op->type, op->extents, time, -1});
+        }
+        op->body.accept(this);
+        time++;
+        if (idx >= 0 && result[idx].end < 0) {
+            // There was no early free.
+            result[idx].end = time;
+        }
+    }
+
+    void visit(const Free *op) {
+        time++;
+        map<string, int>::iterator iter = index.find(op->name);
+        if (iter != index.end() && result[iter->second].end < 0) {
+            result[iter->second].end = time;
+        }
+    }
+
+public:
+    // In order of their start times.
+    vector<PackableAllocation> result;
+};
+
+// Make the given allocations point into the slab instead of
+// allocating memory of their own.
+class UseSlab : public IRMutator {
+    using IRMutator::visit;
+
+    const map<string, Expr> &pointers;
+
+    void visit(const Allocate *op) {
+        map<string, Expr>::const_iterator iter = pointers.find(op->name);
+        if (iter == pointers.end()) {
+            IRMutator::visit(op);
+            return;
+        }
+        Stmt body = mutate(op->body);
+        // The slab owns the memory, so there's nothing to free.
+        stmt = Allocate::make(op->name, op->type, op->extents, op->condition, body,
+                              iter->second, "halide_device_host_nop_free");
+    }
+
+public:
+    UseSlab(const map<string, Expr> &p) : pointers(p) {}
+};
+
+class PackAllocations : public IRMutator {
+    using IRMutator::visit;
+
+    const Target &target;
+
+    void visit(const For *op) {
+        if (op->device_api != DeviceAPI::None &&
+            op->device_api != DeviceAPI::Host) {
+            // Don't touch allocations that belong to other devices.
+            stmt = op;
+            return;
+        }
+        Stmt body = pack_region(mutate(op->body));
+        if (body.same_as(op->body)) {
+            stmt = op;
+        } else {
+            stmt = For::make(op->name, op->min, op->extent, op->for_type, op->device_api, body);
+        }
+    }
+
+public:
+    PackAllocations(const Target &t) : target(t) {}
+
+    Stmt pack_region(Stmt s) {
+        FindPackableAllocations finder;
+        s.accept(&finder);
+        const vector<PackableAllocation> &allocs = finder.result;
+
+        // It's only worth it if some of the buffers can share memory.
+        bool any_disjoint = false;
+        for (size_t i = 0; i < allocs.size() && !any_disjoint; i++) {
+            for (size_t j = i + 1; j < allocs.size(); j++) {
+                if (allocs[j].start >= allocs[i].end) {
+                    any_disjoint = true;
+                    break;
+                }
+            }
+        }
+        if (!any_disjoint) {
+            return s;
+        }
+
+        string slab = unique_name("allocation_slab");
+        debug(3) << "Packing " << allocs.size() << " allocations into " << slab << "\n";
+
+        // Place the buffers in the order they become live. Each one
+        // goes at the first position that doesn't overlap any buffer
+        // still live at that point, out of the start of the slab and
+        // just after each of those buffers. Buffers that become live
+        // later are checked against it in turn. Sizes are generally
+        // only known at runtime, so the choice is made by the
+        // generated code.
+        vector<std::pair<string, Expr>> lets;
+        vector<Expr> offsets, sizes;
+        Expr slab_size = make_zero(Int(64));
+        for (size_t i = 0; i < allocs.size(); i++) {
+            const PackableAllocation &a = allocs[i];
+            Expr bytes = make_const(Int(64), a.type.bytes());
+            for (Expr e : a.extents) {
+                bytes *= cast<int64_t>(e);
+            }
+            // Pad the end the same way a heap allocation would be, as
+            // vector code may read one scalar past it.
+            bytes += a.type.bytes();
+            bytes = ((bytes + slab_alignment - 1) / slab_alignment) * slab_alignment;
+
+            string prefix = slab + "." + a.name;
+            lets.push_back({prefix + ".size", simplify(bytes)});
+            Expr size = Variable::make(Int(64), prefix + ".size");
+
+            vector<size_t> live;
+            for (size_t j = 0; j < i; j++) {
+                if (allocs[j].end > a.start) {
+                    live.push_back(j);
+                }
+            }
+            vector<Expr> candidates = {make_zero(Int(64))};
+            for (size_t j : live) {
+                candidates.push_back(offsets[j] + sizes[j]);
+            }
+            // Going past everything live always works.
+            Expr offset = candidates[0];
+            for (size_t k = 1; k < candidates.size(); k++) {
+                offset = max(offset, candidates[k]);
+            }
+            for (size_t k = candidates.size(); k > 0; k--) {
+                Expr c = candidates[k-1];
+                Expr fits = const_true();
+                for (size_t j : live) {
+                    fits = fits && (c + size <= offsets[j] || c >= offsets[j] + sizes[j]);
+                }
+                offset = select(fits, c, offset);
+            }
+
+            lets.push_back({prefix + ".offset", simplify(offset)});
+            sizes.push_back(size);
+            offsets.push_back(Variable::make(Int(64), prefix + ".offset"));
+            slab_size = max(slab_size, offsets[i] + sizes[i]);
+        }
+
+        Expr base = reinterpret(UInt(64), Variable::make(Handle(), slab));
+        map<string, Expr> pointers;
+        for (size_t i = 0; i < allocs.size(); i++) {
+            pointers[allocs[i].name] = reinterpret(Handle(), base + cast<uint64_t>(offsets[i]));
+        }
+        s = UseSlab(pointers).mutate(s);
+
+        // Allocate the slab in rows, so that the extents fit in 32
+        // bits even for large buffers.
+        const int row_bytes = 4096;
+        Expr slab_size_var = Variable::make(Int(64), slab + ".size");
+        Expr rows = cast<int32_t>((slab_size_var + (row_bytes - 1)) / row_bytes);
+        s = Allocate::make(slab, UInt(8), {row_bytes, rows}, const_true(), s);
+
+        Expr max_size = make_const(Int(64), target.maximum_buffer_size());
+        Expr error = Call::make(Int(32), "halide_error_buffer_allocation_too_large",
+                                {slab, cast<uint64_t>(slab_size_var), cast<uint64_t>(max_size)},
+                                Call::Extern);
+        s = Block::make(AssertStmt::make(slab_size_var <= max_size, error), s);
+        s = LetStmt::make(slab + ".size", simplify(slab_size), s);
+        for (size_t i = lets.size(); i > 0; i--) {
+            s = LetStmt::make(lets[i-1].first, lets[i-1].second, s);
+        }
+        return s;
+    }
+};
+
+}  // namespace
+
+Stmt pack_allocations(Stmt s, const Target &t) {
+    PackAllocations packer(t);
+    s = packer.mutate(s);
+    return packer.pack_region(s);
+}
+
+}
+}
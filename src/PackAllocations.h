@@ -0,0 +1,26 @@
+#ifndef HALIDE_PACK_ALLOCATIONS_H
+#define HALIDE_PACK_ALLOCATIONS_H
+
+/** \file
+ * Defines the lowering pass that packs heap allocations with
+ * non-overlapping lifetimes into a single shared allocation.
+ */
+
+#include "IR.h"
+#include "Target.h"
+
+namespace Halide {
+namespace Internal {
+
+/** Within each loop body (and at the top level), find the heap
+ * allocations whose sizes are known on entry to it, and place them
+ * at offsets within one shared slab, so that buffers that are never
+ * live at the same time use the same memory. This reduces both peak
+ * memory use and the number of calls to halide_malloc. Must be called
+ * after inject_early_frees, as lifetimes end at the Free nodes. */
+Stmt pack_allocations(Stmt s, const Target &t);
+
+}
+}
+
+#endif
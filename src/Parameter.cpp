@@ -1,3 +1,5 @@
+#include <algorithm>
+
 #include "IR.h"
 #include "IROperator.h"
 #include "ObjectInstanceRegistry.h"
@@ -16,6 +18,7 @@ struct ParameterContents {
     Buffer<> buffer;
     uint64_t data;
     int host_alignment;
+    bool constraints_trusted;
     std::vector<Expr> min_constraint;
     std::vector<Expr> extent_constraint;
     std::vector<Expr> stride_constraint;
@@ -23,6 +26,7 @@ struct ParameterContents {
     std::vector<Expr> extent_constraint_estimate;
     Expr min_value, max_value;
     Expr estimate;
+    std::vector<std::string> aliased_inputs;
 
     const bool is_buffer;
     const bool is_explicit_name;
@@ -30,7 +34,7 @@ struct ParameterContents {
     const bool is_bound_before_lowering;
     ParameterContents(Type t, bool b, int d, const std::string &n, bool e, bool r, bool is_bound_before_lowering)
         : type(t), dimensions(d), name(n), buffer(Buffer<>()), data(0),
-          host_alignment(t.bytes()), is_buffer(b), is_explicit_name(e), is_registered(r),
+          host_alignment(t.bytes()), constraints_trusted(false), is_buffer(b), is_explicit_name(e), is_registered(r),
           is_bound_before_lowering(is_bound_before_lowering) {
 
         min_constraint.resize(dimensions);
@@ -288,6 +292,29 @@ int Parameter::host_alignment() const {
     check_is_buffer();
     return contents->host_alignment;
 }
+
+void Parameter::set_constraints_trusted(bool trusted) {
+    check_is_buffer();
+    contents->constraints_trusted = trusted;
+}
+
+bool Parameter::constraints_trusted() const {
+    check_is_buffer();
+    return contents->constraints_trusted;
+}
+
+void Parameter::add_aliased_input(const std::string &input) {
+    check_is_buffer();
+    if (std::find(contents->aliased_inputs.begin(), contents->aliased_inputs.end(), input) ==
+        contents->aliased_inputs.end()) {
+        contents->aliased_inputs.push_back(input);
+    }
+}
+
+const std::vector<std::string> &Parameter::aliased_inputs() const {
+    check_is_buffer();
+    return contents->aliased_inputs;
+}
 void Parameter::set_min_value(Expr e) {
     check_is_scalar();
     if (e.defined()) {
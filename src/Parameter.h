@@ -138,6 +138,21 @@ public:
     EXPORT int host_alignment() const;
     //@}
 
+    /** Get and set whether the constraints on the min, extent, and
+     * stride are trusted rather than checked. See
+     * OutputImageParam::trust_constraints. */
+    //@{
+    EXPORT void set_constraints_trusted(bool trusted);
+    EXPORT bool constraints_trusted() const;
+    //@}
+
+    /** Get and add to the names of the input buffers that this output
+     * buffer may share memory with. See OutputImageParam::may_alias. */
+    //@{
+    EXPORT void add_aliased_input(const std::string &input);
+    EXPORT const std::vector<std::string> &aliased_inputs() const;
+    //@}
+
     /** Get and set constraints for scalar parameters. These are used
      * directly by Param, so they must be exported. */
     // @{
@@ -1,5 +1,6 @@
 #include <algorithm>
 #include <numeric>
+#include <stdlib.h>
 
 #include "PartitionLoops.h"
 #include "IRMutator.h"
@@ -81,7 +82,8 @@ class RemoveLikelyTags : public IRMutator {
     using IRMutator::visit;
 
     void visit(const Call *op) {
-        if (op->is_intrinsic(Call::likely)) {
+        if (op->is_intrinsic(Call::likely) ||
+            op->is_intrinsic(Call::likely_if_innermost)) {
             internal_assert(op->args.size() == 1);
             expr = mutate(op->args[0]);
         } else {
@@ -423,6 +425,43 @@ bool contains_thread_barrier(Stmt s) {
     return c.result;
 }
 
+// The largest loop body, in IR nodes, that partitioning may copy,
+// set by HL_PARTITION_BUDGET. Zero means no limit.
+int64_t partition_budget() {
+    static int64_t budget = std::max(0LL, atoll(get_env_variable("HL_PARTITION_BUDGET").c_str()));
+    return budget;
+}
+
+// Count the nodes of a statement as a tree, which is roughly how
+// much code it turns into, giving up once the count exceeds a limit.
+class CountNodes : public IRGraphVisitor {
+    using IRGraphVisitor::visit;
+
+    void include(const Expr &e) {
+        if (count <= limit) {
+            count++;
+            e.accept(this);
+        }
+    }
+
+    void include(const Stmt &s) {
+        if (count <= limit) {
+            count++;
+            s.accept(this);
+        }
+    }
+
+public:
+    int64_t count = 0, limit;
+    CountNodes(int64_t limit) : limit(limit) {}
+};
+
+bool larger_than(const Stmt &s, int64_t limit) {
+    CountNodes counter(limit);
+    s.accept(&counter);
+    return counter.count > limit;
+}
+
 class PartitionLoops : public IRMutator {
     using IRMutator::visit;
 
@@ -459,6 +498,18 @@ class PartitionLoops : public IRMutator {
             return;
         }
 
+        // Under a code size budget, only loops with small bodies are
+        // partitioned. These are the inner dimensions, which is where
+        // the time goes. The outer ones are left alone.
+        const int64_t budget = partition_budget();
+        if (budget > 0 && larger_than(body, budget)) {
+            debug(3) << "Not partitioning loop over " << op->name
+                     << ", because its body is larger than HL_PARTITION_BUDGET\n";
+            IRMutator::visit(op);
+            in_gpu_loop = old_in_gpu_loop;
+            return;
+        }
+
         debug(3) << "\n\n**** Partitioning loop over " << op->name << "\n";
 
         vector<Expr> min_vals, max_vals;
@@ -624,7 +675,24 @@ class PartitionLoops : public IRMutator {
         }
 
         // Bust serial for loops up into three.
-        if (op->for_type == ForType::Serial) {
+        if (op->for_type == ForType::Serial &&
+            budget > 0 && !in_gpu_loop &&
+            make_prologue && make_epilogue && equal(prologue, epilogue)) {
+            // Under a code size budget, the prologue and epilogue
+            // share one copy of the body. An outer loop of two
+            // iterations runs the prologue, then the steady state,
+            // then the epilogue, so the iterations still run in order.
+            string tail_name = unique_name(op->name + ".tail");
+            Expr tail = Variable::make(Int(32), tail_name);
+            Expr tail_min = select(tail == 0, op->min, max_steady);
+            Expr tail_extent = select(tail == 0, min_steady - op->min, op->min + op->extent - max_steady);
+            Stmt tails = For::make(op->name, tail_min, tail_extent,
+                                   op->for_type, op->device_api, prologue);
+            Stmt steady = For::make(op->name, min_steady, max_steady - min_steady,
+                                    op->for_type, op->device_api, simpler_body);
+            stmt = Block::make(tails, IfThenElse::make(tail == 0, steady));
+            stmt = For::make(tail_name, 0, 2, ForType::Serial, op->device_api, stmt);
+        } else if (op->for_type == ForType::Serial) {
             stmt = For::make(op->name, min_steady, max_steady - min_steady,
                              op->for_type, op->device_api, simpler_body);
 
@@ -982,6 +1050,10 @@ bool has_likely_tag(Expr e) {
     return h.result;
 }
 
+Stmt remove_likely_tags(Stmt s) {
+    return RemoveLikelyTags().mutate(s);
+}
+
 Stmt partition_loops(Stmt s) {
     s = LowerLikelyIfInnermost().mutate(s);
     s = MarkClampedRampsAsLikely().mutate(s);
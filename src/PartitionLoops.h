@@ -15,6 +15,11 @@ namespace Internal {
 /** Return true if an expression uses a likely tag. */
 bool has_likely_tag(Expr e);
 
+/** Remove any 'likely' and 'likely_if_innermost' intrinsics, leaving
+ * the loops unpartitioned. partition_loops does this itself; this is
+ * for when it is skipped. */
+EXPORT Stmt remove_likely_tags(Stmt s);
+
 /** Partitions loop bodies into a prologue, a steady state, and an
  * epilogue. Finds the steady state by hunting for use of clamped
  * ramps, or the 'likely' intrinsic. */
@@ -1,6 +1,10 @@
 #include <algorithm>
+#include <map>
+#include <mutex>
+#include <sstream>
 
 #include "Pipeline.h"
+#include "AffectedRegion.h"
 #include "Argument.h"
 #include "FindCalls.h"
 #include "Func.h"
@@ -12,6 +16,9 @@
 #include "Outputs.h"
 #include "PrintLoopNest.h"
 #include "RealizationOrder.h"
+#include "ScheduleParam.h"
+#include "SimplifySpecializations.h"
+#include "StmtToHtml.h"
 
 using namespace Halide::Internal;
 
@@ -20,6 +27,7 @@ namespace Halide {
 using std::vector;
 using std::string;
 using std::set;
+using std::pair;
 
 namespace {
 
@@ -56,11 +64,23 @@ struct PipelineContents {
     JITModule jit_module;
     Target jit_target;
 
+    // Lowering bakes in the values of the ScheduleParams, and, when
+    // compiling specializations lazily, which specializations are
+    // taken. This is the jit-compiled code for each combination of
+    // those seen so far, keyed by jit_module_key, along with the key
+    // of jit_module and the ScheduleParam generation it was last
+    // checked at.
+    std::map<string, JITModule> jit_modules;
+    string jit_key;
+    uint64_t jit_schedule_param_generation = 0;
+
     /** Clear all cached state */
     void invalidate_cache() {
         module = Module("", Target());
         jit_module = JITModule();
         jit_target = Target();
+        jit_modules.clear();
+        jit_key.clear();
         inferred_args.clear();
     }
 
@@ -123,6 +143,177 @@ EXPORT void destroy<PipelineContents>(const PipelineContents *p) {
 }
 }
 
+struct RealizationContextContents {
+    mutable RefCount ref_count;
+
+    // The pipeline and sizes the outputs below were made for.
+    const PipelineContents *pipeline = nullptr;
+    vector<int32_t> sizes;
+    vector<Buffer<>> outputs;
+
+    // The arguments last passed to the compiled pipeline, and the
+    // function they were passed to. The outputs stay the same from
+    // call to call; only the inputs need to be looked up again.
+    vector<const void *> args;
+    int (*argv_function)(const void **) = nullptr;
+
+    // Scratch memory freed by the pipeline, by size, and the
+    // allocator it came from. The pipeline may allocate from several
+    // threads at once.
+    std::mutex scratch_mutex;
+    std::multimap<size_t, void *> free_scratch;
+    void *(*underlying_malloc)(void *, size_t) = nullptr;
+    void (*underlying_free)(void *, void *) = nullptr;
+
+    static void *scratch_malloc(void *ctx, size_t x) {
+        JITUserContext *jit_context = (JITUserContext *)ctx;
+        RealizationContextContents *self = (RealizationContextContents *)jit_context->scratch_memory;
+        {
+            std::lock_guard<std::mutex> lock(self->scratch_mutex);
+            auto it = self->free_scratch.find(x);
+            if (it != self->free_scratch.end()) {
+                void *ptr = it->second;
+                self->free_scratch.erase(it);
+                return ptr;
+            }
+        }
+        // Over-allocate so that the size can be found again when the
+        // block is freed.
+        void *block = self->underlying_malloc(ctx, x + scratch_header_size);
+        if (!block) {
+            return nullptr;
+        }
+        *(size_t *)block = x;
+        return (uint8_t *)block + scratch_header_size;
+    }
+
+    static void scratch_free(void *ctx, void *ptr) {
+        if (!ptr) {
+            return;
+        }
+        JITUserContext *jit_context = (JITUserContext *)ctx;
+        RealizationContextContents *self = (RealizationContextContents *)jit_context->scratch_memory;
+        size_t x = *(size_t *)((uint8_t *)ptr - scratch_header_size);
+        std::lock_guard<std::mutex> lock(self->scratch_mutex);
+        self->free_scratch.emplace(x, ptr);
+    }
+
+    // Big enough to keep the alignment of the underlying allocator.
+    static const size_t scratch_header_size = 128;
+
+    void release_scratch() {
+        std::lock_guard<std::mutex> lock(scratch_mutex);
+        for (auto &b : free_scratch) {
+            underlying_free(nullptr, (uint8_t *)b.second - scratch_header_size);
+        }
+        free_scratch.clear();
+    }
+
+    void release() {
+        release_scratch();
+        pipeline = nullptr;
+        sizes.clear();
+        outputs.clear();
+        args.clear();
+        argv_function = nullptr;
+    }
+
+    ~RealizationContextContents() {
+        release();
+    }
+};
+
+namespace Internal {
+template<>
+EXPORT RefCount &ref_count<RealizationContextContents>(const RealizationContextContents *p) {
+    return p->ref_count;
+}
+
+template<>
+EXPORT void destroy<RealizationContextContents>(const RealizationContextContents *p) {
+    delete p;
+}
+}
+
+RealizationContext::RealizationContext() : contents(new RealizationContextContents) {}
+
+struct CompiledPipelineContents {
+    mutable RefCount ref_count;
+
+    JITModule jit_module;
+    vector<InferredArgument> inferred_args;
+    string user_context_name;
+    JITHandlers jit_handlers;
+
+    // The types and dimensionalities of the outputs.
+    vector<pair<Type, int>> outputs;
+};
+
+namespace Internal {
+template<>
+EXPORT RefCount &ref_count<CompiledPipelineContents>(const CompiledPipelineContents *p) {
+    return p->ref_count;
+}
+
+template<>
+EXPORT void destroy<CompiledPipelineContents>(const CompiledPipelineContents *p) {
+    delete p;
+}
+}
+
+CompiledPipeline::CompiledPipeline() : contents(nullptr) {}
+
+bool CompiledPipeline::defined() const {
+    return contents.defined();
+}
+
+vector<Argument> CompiledPipeline::arguments() const {
+    user_assert(defined()) << "CompiledPipeline is undefined\n";
+    vector<Argument> result;
+    for (const InferredArgument &arg : contents->inferred_args) {
+        if (!arg.buffer.defined() && arg.arg.name != contents->user_context_name) {
+            result.push_back(arg.arg);
+        }
+    }
+    return result;
+}
+
+void RealizationContext::release() {
+    contents->release();
+}
+
+namespace {
+
+void check_outputs_defined(const IntrusivePtr<PipelineContents> &contents) {
+    for (Function f : contents->outputs) {
+        user_assert(f.has_pure_definition() || f.has_extern_definition())
+            << "Can't compile Pipeline with undefined output Func: " << f.name() << ".\n";
+    }
+}
+
+vector<Argument> lowering_args_for(const IntrusivePtr<PipelineContents> &contents,
+                                   const vector<Argument> &args,
+                                   const Target &target) {
+    vector<Argument> lowering_args(args);
+
+    // If the target specifies user context but it's not in the args
+    // vector, add it at the start (the jit path puts it in there
+    // explicitly).
+    const bool requires_user_context = target.has_feature(Target::UserContext);
+    bool has_user_context = false;
+    for (Argument arg : lowering_args) {
+        if (arg.name == contents->user_context_arg.arg.name) {
+            has_user_context = true;
+        }
+    }
+    if (requires_user_context && !has_user_context) {
+        lowering_args.insert(lowering_args.begin(), contents->user_context_arg.arg);
+    }
+    return lowering_args;
+}
+
+}  // namespace
+
 Pipeline::Pipeline() : contents(nullptr) {
 }
 
@@ -248,10 +439,14 @@ void Pipeline::print_loop_nest() {
 void Pipeline::compile_to_lowered_stmt(const string &filename,
                                        const vector<Argument> &args,
                                        StmtOutputFormat fmt,
-                                       const Target &target) {
+                                       const Target &target,
+                                       const std::string &profile_filename) {
     Module m = compile_to_module(args, "", target);
     Outputs outputs;
-    if (fmt == HTML) {
+    if (fmt == HTML && !profile_filename.empty()) {
+        Internal::print_to_html(output_name(filename, m, ".html"), m, profile_filename);
+        return;
+    } else if (fmt == HTML) {
         outputs = Outputs().stmt_html(output_name(filename, m, ".html"));
     } else {
         outputs = Outputs().stmt(output_name(filename, m, ".stmt"));
@@ -271,11 +466,31 @@ void Pipeline::compile_to_static_library(const string &filename_prefix,
 void Pipeline::compile_to_multitarget_static_library(const std::string &filename_prefix,
                                                      const std::vector<Argument> &args,
                                                      const std::vector<Target> &targets) {
-    auto module_producer = [this, &args](const std::string &name, const Target &target) -> Module {
-        return compile_to_module(args, name, target);
+    user_assert(defined()) << "Can't compile undefined Pipeline.\n";
+    check_outputs_defined(contents);
+
+    // compile_to_module caches the lowered module in the Pipeline, so it
+    // can't be called for several targets at once. Lowering only reads
+    // the Func graph, so lower each target directly instead, and let
+    // compile_multitarget do them all concurrently. Custom lowering
+    // passes are stateful IRMutators though, so if there are any, only
+    // one target at a time may use them.
+    std::mutex custom_pass_mutex;
+    auto module_producer = [this, &args, &custom_pass_mutex](const std::string &name, const Target &target) -> Module {
+        vector<IRMutator *> custom_passes;
+        for (CustomLoweringPass p : contents->custom_lowering_passes) {
+            custom_passes.push_back(p.pass);
+        }
+        std::unique_lock<std::mutex> lock(custom_pass_mutex, std::defer_lock);
+        if (!custom_passes.empty()) {
+            lock.lock();
+        }
+        return lower(contents->outputs, name, target, lowering_args_for(contents, args, target),
+                     LoweredFunc::ExternalPlusMetadata, custom_passes);
     };
     Outputs outputs = static_library_outputs(filename_prefix, targets.back());
-    compile_multitarget(generate_function_name(), outputs, targets, module_producer);
+    compile_multitarget(generate_function_name(), outputs, targets, module_producer, {},
+                        /* module_producer_is_reentrant */ true);
 }
 
 void Pipeline::compile_to_file(const string &filename_prefix,
@@ -334,10 +549,7 @@ Module Pipeline::compile_to_module(const vector<Argument> &args,
                                    const Internal::LoweredFunc::LinkageType linkage_type) {
     user_assert(defined()) << "Can't compile undefined Pipeline.\n";
 
-    for (Function f : contents->outputs) {
-        user_assert(f.has_pure_definition() || f.has_extern_definition())
-            << "Can't compile Pipeline with undefined output Func: " << f.name() << ".\n";
-    }
+    check_outputs_defined(contents);
 
     string new_fn_name(fn_name);
     if (new_fn_name.empty()) {
@@ -346,21 +558,7 @@ Module Pipeline::compile_to_module(const vector<Argument> &args,
     internal_assert(!new_fn_name.empty()) << "new_fn_name cannot be empty\n";
     // TODO: Assert that the function name is legal
 
-    vector<Argument> lowering_args(args);
-
-    // If the target specifies user context but it's not in the args
-    // vector, add it at the start (the jit path puts it in there
-    // explicitly).
-    const bool requires_user_context = target.has_feature(Target::UserContext);
-    bool has_user_context = false;
-    for (Argument arg : lowering_args) {
-        if (arg.name == contents->user_context_arg.arg.name) {
-            has_user_context = true;
-        }
-    }
-    if (requires_user_context && !has_user_context) {
-        lowering_args.insert(lowering_args.begin(), contents->user_context_arg.arg);
-    }
+    vector<Argument> lowering_args = lowering_args_for(contents, args, target);
 
     const Module &old_module = contents->module;
 
@@ -410,6 +608,59 @@ std::string Pipeline::generate_function_name() const {
     return name;
 }
 
+namespace {
+
+// Find the values of the ScheduleParams used by some Functions.
+class FindScheduleParams : public IRGraphVisitor {
+    using IRGraphVisitor::visit;
+
+    void visit(const Variable *op) {
+        if (op->param.defined() && op->param.is_bound_before_lowering()) {
+            const uint8_t *value = (const uint8_t *)op->param.get_scalar_address();
+            std::ostringstream bytes;
+            for (int i = 0; i < op->param.type().bytes(); i++) {
+                bytes << (int)value[i] << ",";
+            }
+            values[op->param.name()] = bytes.str();
+        }
+    }
+
+public:
+    std::map<string, string> values;
+};
+
+// A string that identifies the things that lowering for the jit
+// bakes into the code, other than the schedule itself: the values of
+// the scalar ScheduleParams, the loop levels (which LoopLevel
+// ScheduleParams may change), and, if compiling lazily, the
+// specializations taken.
+string jit_module_key(const vector<Function> &outputs, bool lazy) {
+    std::map<string, Function> env;
+    for (Function f : outputs) {
+        populate_environment(f, env);
+    }
+
+    std::ostringstream key;
+    FindScheduleParams params;
+    for (const auto &iter : env) {
+        const FuncSchedule &s = iter.second.schedule();
+        iter.second.accept(&params);
+        key << iter.first << "@"
+            << (s.compute_level().defined() ? s.compute_level().to_string() : "") << "/"
+            << (s.store_level().defined() ? s.store_level().to_string() : "") << "/"
+            << (s.compute_with_level().defined() ? s.compute_with_level().to_string() : "") << ";";
+    }
+    for (const auto &iter : params.values) {
+        key << iter.first << "=" << iter.second << ";";
+    }
+    if (lazy) {
+        key << evaluate_specializations(env, false);
+    }
+    return key.str();
+}
+
+}  // namespace
+
 void *Pipeline::compile_jit(const Target &target_arg) {
     user_assert(defined()) << "Pipeline is undefined\n";
 
@@ -419,15 +670,38 @@ void *Pipeline::compile_jit(const Target &target_arg) {
 
     debug(2) << "jit-compiling for: " << target_arg.to_string() << "\n";
 
-    // If we're re-jitting for the same target, we can just keep the
-    // old jit module.
-    if (contents->jit_target == target &&
-        contents->jit_module.compiled()) {
+    bool lazy = target.has_feature(Target::LazySpecializations);
+    bool same_target = (contents->jit_target == target &&
+                        contents->jit_module.compiled());
+    uint64_t generation = ScheduleParamBase::generation();
+
+    // If we're re-jitting for the same target, and nothing lowering
+    // depends on can have changed, we can just keep the old jit
+    // module.
+    if (same_target && !lazy &&
+        generation == contents->jit_schedule_param_generation) {
         debug(2) << "Reusing old jit module compiled for :\n" << contents->jit_target.to_string() << "\n";
         return contents->jit_module.main_function();
     }
 
+    string key = jit_module_key(contents->outputs, lazy);
+    contents->jit_schedule_param_generation = generation;
+    if (same_target) {
+        auto iter = contents->jit_modules.find(key);
+        if (iter != contents->jit_modules.end()) {
+            debug(2) << "Reusing old jit module compiled for " << key << "\n";
+            contents->jit_module = iter->second;
+            contents->jit_key = key;
+            return contents->jit_module.main_function();
+        }
+        // The lowered module has the wrong values baked in.
+        contents->module = Module("", Target());
+    } else {
+        contents->jit_modules.clear();
+    }
+
     contents->jit_target = target;
+    contents->jit_key = key;
 
     // Infer an arguments vector
     infer_arguments();
@@ -466,6 +740,7 @@ void *Pipeline::compile_jit(const Target &target_arg) {
     }
 
     contents->jit_module = jit_module;
+    contents->jit_modules[key] = jit_module;
 
     return jit_module.main_function();
 }
@@ -683,6 +958,32 @@ struct JITFuncCallContext {
     }
 };
 
+// The void * to pass to the jit call for an input, using its currently
+// bound value.
+const void *jit_input_argument(const InferredArgument &arg) {
+    const void *ptr;
+    if (arg.param.defined() && arg.param.is_buffer()) {
+        // ImageParam arg
+        Buffer<> buf = arg.param.get_buffer();
+        if (buf.defined()) {
+            ptr = buf.raw_buffer();
+        } else {
+            // Unbound
+            ptr = nullptr;
+        }
+        debug(1) << "JIT input ImageParam argument ";
+    } else if (arg.param.defined()) {
+        ptr = arg.param.get_scalar_address();
+        debug(1) << "JIT input scalar argument ";
+    } else {
+        debug(1) << "JIT input Image argument ";
+        internal_assert(arg.buffer.defined());
+        ptr = arg.buffer.raw_buffer();
+    }
+    debug(1) << arg.arg.name << " @ " << ptr << "\n";
+    return ptr;
+}
+
 }  // namespace
 
 // Make a vector of void *'s to pass to the jit call using the
@@ -738,26 +1039,7 @@ vector<const void *> Pipeline::prepare_jit_call_arguments(Realization dst, const
     vector<const void *> arg_values;
 
     for (const InferredArgument &arg : contents->inferred_args) {
-        if (arg.param.defined() && arg.param.is_buffer()) {
-            // ImageParam arg
-            Buffer<> buf = arg.param.get_buffer();
-            if (buf.defined()) {
-                arg_values.push_back(buf.raw_buffer());
-            } else {
-                // Unbound
-                arg_values.push_back(nullptr);
-            }
-            debug(1) << "JIT input ImageParam argument ";
-        } else if (arg.param.defined()) {
-            arg_values.push_back(arg.param.get_scalar_address());
-            debug(1) << "JIT input scalar argument ";
-        } else {
-            debug(1) << "JIT input Image argument ";
-            internal_assert(arg.buffer.defined());
-            arg_values.push_back(arg.buffer.raw_buffer());
-        }
-        const void *ptr = arg_values.back();
-        debug(1) << arg.arg.name << " @ " << ptr << "\n";
+        arg_values.push_back(jit_input_argument(arg));
     }
 
     // Then the outputs
@@ -819,7 +1101,92 @@ Pipeline::make_externs_jit_module(const Target &target,
     return result;
 }
 
+Realization Pipeline::realize(RealizationContext ctx, vector<int32_t> sizes,
+                              const Target &target) {
+    user_assert(defined()) << "Pipeline is undefined\n";
+    RealizationContextContents *c = ctx.contents.get();
+    if (c->pipeline != contents.get() || c->sizes != sizes) {
+        c->release();
+        for (auto &out : contents->outputs) {
+            user_assert(out.has_pure_definition() || out.has_extern_definition()) <<
+                "Can't realize Pipeline with undefined output Func: " << out.name() << ".\n";
+            for (Type t : out.output_types()) {
+                c->outputs.emplace_back(t, sizes);
+            }
+        }
+        c->pipeline = contents.get();
+        c->sizes = sizes;
+    }
+    Realization r(c->outputs);
+    realize(r, target, c);
+    for (size_t i = 0; i < r.size(); i++) {
+        r[i].copy_to_host();
+    }
+    return r;
+}
+
 void Pipeline::realize(Realization dst, const Target &t) {
+    realize(dst, t, nullptr);
+}
+
+vector<pair<Expr, Expr>> Pipeline::affected_region(const std::string &input,
+                                                   const vector<pair<Expr, Expr>> &dirty,
+                                                   const vector<pair<Expr, Expr>> &output_bounds) {
+    user_assert(defined()) << "Can't compute the affected region of an undefined Pipeline\n";
+    Region dirty_region, output_region;
+    for (const auto &r : dirty) {
+        dirty_region.push_back(Range(r.first, r.second));
+    }
+    for (const auto &r : output_bounds) {
+        output_region.push_back(r.first.defined() ? Range(r.first, r.second) : Range());
+    }
+    vector<pair<Expr, Expr>> result;
+    for (const Range &r : Internal::affected_region(contents->outputs, input, dirty_region, output_region)) {
+        result.push_back({r.min, r.extent});
+    }
+    return result;
+}
+
+void Pipeline::realize_dirty(Realization dst, const std::string &input,
+                             const vector<pair<Expr, Expr>> &dirty, const Target &target) {
+    user_assert(dst.size() > 0) << "realize_dirty requires at least one output buffer\n";
+    vector<pair<Expr, Expr>> output_bounds;
+    for (int d = 0; d < dst[0].dimensions(); d++) {
+        output_bounds.push_back({dst[0].dim(d).min(), dst[0].dim(d).extent()});
+    }
+    vector<pair<Expr, Expr>> region = affected_region(input, dirty, output_bounds);
+
+    vector<Buffer<>> crops;
+    for (size_t i = 0; i < dst.size(); i++) {
+        user_assert(dst[i].dimensions() == (int)region.size())
+            << "Buffer " << i << " passed to realize_dirty has " << dst[i].dimensions()
+            << " dimensions, but the outputs of the pipeline have " << region.size() << "\n";
+        Buffer<> crop(Runtime::Buffer<>(*dst[i].get()), dst[i].name());
+        for (int d = 0; d < crop.dimensions(); d++) {
+            const auto &r = region[d];
+            if (!r.first.defined()) {
+                continue;
+            }
+            const int64_t *min_val = as_const_int(r.first);
+            const int64_t *extent_val = as_const_int(r.second);
+            user_assert(min_val && extent_val)
+                << "The region of the outputs affected by the change to " << input
+                << " is not constant in dimension " << d << ": "
+                << r.first << ", " << r.second << "\n";
+            int lo = std::max((int)*min_val, crop.dim(d).min());
+            int hi = std::min((int)(*min_val + *extent_val), crop.dim(d).min() + crop.dim(d).extent());
+            if (hi <= lo) {
+                // Nothing in this buffer is affected.
+                return;
+            }
+            crop.crop(d, lo, hi - lo);
+        }
+        crops.push_back(crop);
+    }
+    realize(Realization(crops), target);
+}
+
+void Pipeline::realize(Realization dst, const Target &t, RealizationContextContents *ctx) {
     Target target = t;
     user_assert(defined()) << "Can't realize an undefined Pipeline\n";
 
@@ -842,7 +1209,25 @@ void Pipeline::realize(Realization dst, const Target &t) {
         }
     }
 
-    vector<const void *> args = prepare_jit_call_arguments(dst, target);
+    vector<const void *> local_args;
+    vector<const void *> &args = ctx ? ctx->args : local_args;
+    if (ctx) {
+        // The outputs in dst are the ones in the context, so if the
+        // pipeline hasn't been recompiled, the checks on them have
+        // already been done.
+        compile_jit(target);
+        if (ctx->argv_function && ctx->argv_function == contents->jit_module.argv_function()) {
+            for (size_t i = 0; i < contents->inferred_args.size(); i++) {
+                args[i] = jit_input_argument(contents->inferred_args[i]);
+            }
+        } else {
+            ctx->argv_function = nullptr;
+            args = prepare_jit_call_arguments(dst, target);
+            ctx->argv_function = contents->jit_module.argv_function();
+        }
+    } else {
+        args = prepare_jit_call_arguments(dst, target);
+    }
 
     // We need to make a context for calling the jitted function to
     // carry the the set of custom handlers. Here's how handlers get
@@ -868,6 +1253,24 @@ void Pipeline::realize(Realization dst, const Target &t) {
 
     JITFuncCallContext jit_context(jit_handlers(), contents->user_context_arg.param);
 
+    // To reuse scratch memory across calls, the context puts its own
+    // allocator in front of the one that would otherwise be used. If
+    // that changes, the memory cached so far came from the wrong one.
+    if (ctx && !contents->jit_handlers.custom_malloc) {
+        JITHandlers &handlers = jit_context.jit_context.handlers;
+        if (ctx->underlying_malloc != handlers.custom_malloc ||
+            ctx->underlying_free != handlers.custom_free) {
+            if (ctx->underlying_free) {
+                ctx->release_scratch();
+            }
+            ctx->underlying_malloc = handlers.custom_malloc;
+            ctx->underlying_free = handlers.custom_free;
+        }
+        handlers.custom_malloc = RealizationContextContents::scratch_malloc;
+        handlers.custom_free = RealizationContextContents::scratch_free;
+        jit_context.jit_context.scratch_memory = ctx;
+    }
+
     // The handlers in the jit_context default to the default handlers
     // in the runtime of the shared module (e.g. halide_print_impl,
     // default_trace). As an example, here's what happens with a
@@ -928,6 +1331,101 @@ void Pipeline::realize(Realization dst, const Target &t) {
     jit_context.finalize(exit_status);
 }
 
+CompiledPipeline Pipeline::compile_to_compiled_pipeline(const Target &target) {
+    user_assert(defined()) << "Pipeline is undefined\n";
+
+    // A CompiledPipeline holds a single JITModule, so it must
+    // contain all of the specializations.
+    compile_jit(target.without_feature(Target::LazySpecializations));
+
+    CompiledPipeline result;
+    result.contents = new CompiledPipelineContents;
+    result.contents->jit_module = contents->jit_module;
+    result.contents->inferred_args = contents->inferred_args;
+    result.contents->user_context_name = contents->user_context_arg.arg.name;
+    result.contents->jit_handlers = contents->jit_handlers;
+    for (Function f : contents->outputs) {
+        for (Type t : f.output_types()) {
+            result.contents->outputs.push_back({t, f.dimensions()});
+        }
+    }
+    return result;
+}
+
+int CompiledPipeline::realize(Realization dst,
+                              const std::map<string, const void *> &inputs,
+                              JITUserContext *jit_context) const {
+    user_assert(defined()) << "CompiledPipeline is undefined\n";
+
+    user_assert(contents->outputs.size() == dst.size())
+        << "Realization contains wrong number of Images (" << dst.size()
+        << ") for realizing pipeline with " << contents->outputs.size()
+        << " outputs\n";
+    for (size_t i = 0; i < dst.size(); i++) {
+        user_assert(dst[i].data() != nullptr)
+            << "Buffer at " << &(dst[i]) << " is unallocated. "
+            << "The Buffers in a Realization passed to realize must all be allocated\n";
+        user_assert(dst[i].type() == contents->outputs[i].first &&
+                    dst[i].dimensions() == contents->outputs[i].second)
+            << "Can't realize output " << i << " into Buffer at " << (void *)dst[i].data()
+            << " because Buffer has type " << Type(dst[i].type())
+            << " and is " << dst[i].dimensions() << "-dimensional, but the output has type "
+            << contents->outputs[i].first << " and is "
+            << contents->outputs[i].second << "-dimensional.\n";
+    }
+
+    // Everything that differs from call to call lives on this stack
+    // frame, including the user context, which Pipeline::realize
+    // passes through a Parameter shared by all calls.
+    ErrorBuffer error_buffer;
+    JITUserContext local_context;
+    bool report_errors = false;
+    if (!jit_context) {
+        JITHandlers handlers = contents->jit_handlers;
+        void *user_context = nullptr;
+        if (handlers.custom_error == nullptr) {
+            handlers.custom_error = ErrorBuffer::handler;
+            user_context = &error_buffer;
+            report_errors = true;
+        }
+        JITSharedRuntime::init_jit_user_context(local_context, user_context, handlers);
+        jit_context = &local_context;
+    }
+    void *user_context_value = jit_context;
+
+    size_t inputs_used = 0;
+    vector<const void *> args;
+    for (const InferredArgument &arg : contents->inferred_args) {
+        auto iter = inputs.find(arg.arg.name);
+        if (arg.arg.name == contents->user_context_name) {
+            args.push_back(&user_context_value);
+        } else if (iter != inputs.end()) {
+            args.push_back(iter->second);
+            inputs_used++;
+        } else {
+            args.push_back(jit_input_argument(arg));
+        }
+    }
+    user_assert(inputs_used == inputs.size())
+        << "Some of the inputs passed to CompiledPipeline::realize are not inputs of the pipeline.\n";
+    for (size_t i = 0; i < dst.size(); i++) {
+        args.push_back(dst[i].raw_buffer());
+    }
+
+    int exit_status = contents->jit_module.argv_function()(&(args[0]));
+
+    if (exit_status && report_errors) {
+        std::string output = error_buffer.str();
+        if (output.empty()) {
+            output = ("The pipeline returned exit status " +
+                      std::to_string(exit_status) +
+                      " but halide_error was never called.\n");
+        }
+        halide_runtime_error << output;
+    }
+    return exit_status;
+}
+
 void Pipeline::infer_input_bounds(Realization dst) {
 
     Target target = get_jit_target_from_environment();
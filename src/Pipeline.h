@@ -7,6 +7,7 @@
  * pipeline.
  */
 
+#include <map>
 #include <vector>
 
 #include "AutoSchedule.h"
@@ -53,6 +54,65 @@ struct CustomLoweringPass {
 
 struct JITExtern;
 
+struct RealizationContextContents;
+struct CompiledPipelineContents;
+
+/** State that can be kept between calls to Pipeline::realize that
+ * produce outputs of the same size, such as the frames of an
+ * interactive application. It holds the output buffers, the
+ * prepared arguments to the compiled pipeline, and the scratch memory
+ * the pipeline allocates for its intermediates, so that later calls
+ * can reuse them instead of making them again. A context may be used
+ * with one Pipeline at a time, and by one thread at a time. */
+class RealizationContext {
+    Internal::IntrusivePtr<RealizationContextContents> contents;
+    friend class Pipeline;
+
+public:
+    /** Make an empty context. */
+    EXPORT RealizationContext();
+
+    /** Free the output buffers and scratch memory held by this
+     * context. The next call to realize using it starts afresh. */
+    EXPORT void release();
+};
+
+/** A jit-compiled Pipeline that can be called from several threads at
+ * once. Get one with Pipeline::compile_to_compiled_pipeline. It keeps
+ * the compiled code, the arguments, and the custom handlers the
+ * Pipeline had when it was made, and does not change with the
+ * Pipeline afterwards. */
+class CompiledPipeline {
+    Internal::IntrusivePtr<CompiledPipelineContents> contents;
+    friend class Pipeline;
+
+public:
+    /** Make an undefined handle. */
+    EXPORT CompiledPipeline();
+
+    /** Check if this handle holds a compiled pipeline. */
+    EXPORT bool defined() const;
+
+    /** The inputs of the compiled pipeline. */
+    EXPORT std::vector<Argument> arguments() const;
+
+    /** Run the pipeline, writing its outputs to dst. The inputs
+     * named in the map take the given values: a pointer to the value
+     * for scalars, and a pointer to a halide_buffer_t for
+     * buffers. The other inputs take the values bound to their Param
+     * or ImageParam when the call is made, so the inputs that differ
+     * across threads should always be passed here. If jit_context is
+     * null, a context using the Pipeline's handlers is made for the
+     * call, and errors are reported as Pipeline::realize does;
+     * otherwise the given one is used as it is, and should have been
+     * set up with JITSharedRuntime::init_jit_user_context. No state
+     * is shared between calls made this way. Returns the exit status
+     * of the pipeline. */
+    EXPORT int realize(Realization dst,
+                       const std::map<std::string, const void *> &inputs = std::map<std::string, const void *>(),
+                       Internal::JITUserContext *jit_context = nullptr) const;
+};
+
 /** A class representing a Halide pipeline. Constructed from the Func
  * or Funcs that it outputs. */
 class Pipeline {
@@ -61,6 +121,8 @@ class Pipeline {
     std::vector<Argument> infer_arguments(Internal::Stmt body);
     std::vector<const void *> prepare_jit_call_arguments(Realization dst, const Target &target);
 
+    void realize(Realization dst, const Target &t, RealizationContextContents *ctx);
+
     static std::vector<Internal::JITModule> make_externs_jit_module(const Target &target,
                                                                     std::map<std::string, JITExtern> &externs_in_out);
 
@@ -159,11 +221,16 @@ public:
 
     /** Write out an internal representation of lowered code. Useful
      * for analyzing and debugging scheduling. Can emit html or plain
-     * text. */
+     * text. For html, profile_filename may name a file containing the
+     * output of halide_profiler_report for a run of this pipeline
+     * compiled with the profile target feature; each producer and
+     * loop is then annotated with its share of the runtime and its
+     * heap usage, and colored accordingly. */
     EXPORT void compile_to_lowered_stmt(const std::string &filename,
                                         const std::vector<Argument> &args,
                                         StmtOutputFormat fmt = Text,
-                                        const Target &target = get_target_from_environment());
+                                        const Target &target = get_target_from_environment(),
+                                        const std::string &profile_filename = "");
 
     /** Write out the loop nests specified by the schedule for this
      * Pipeline's Funcs. Helpful for understanding what a schedule is
@@ -377,6 +444,54 @@ public:
      * back from the GPU. */
     EXPORT void realize(Realization dst, const Target &target = Target());
 
+    /** Compute a region of the outputs that contains every site whose
+     * value may change when the named input (an ImageParam, Buffer, or
+     * Func in this pipeline) changes over the region 'dirty'. Both
+     * regions are given as a (min, extent) pair per dimension. A
+     * dimension of the outputs is narrowed when the same dimension of
+     * the input is read at constant offsets from the site being
+     * computed, as in stencils, or when output_bounds gives the bounds
+     * of the outputs in that dimension and the part of the input a
+     * site reads only moves forward as the site does, as in stencils
+     * with clamped coordinates (such as the boundary conditions in
+     * BoundaryConditions.h). Otherwise its pair is undefined, meaning
+     * all of it. Reductions that move values between sites
+     * (such as scans and histograms) also leave every dimension
+     * undefined. */
+    EXPORT std::vector<std::pair<Expr, Expr>> affected_region(const std::string &input,
+                                                              const std::vector<std::pair<Expr, Expr>> &dirty,
+                                                              const std::vector<std::pair<Expr, Expr>> &output_bounds =
+                                                                  std::vector<std::pair<Expr, Expr>>());
+
+    /** Update the existing output buffers in dst after the named input
+     * changed over the region 'dirty', by realizing only the crop of
+     * them given by affected_region, using the bounds of dst as the
+     * bounds of the outputs. The rest of dst is left as it
+     * was, so it should hold the results of an earlier realization,
+     * and the Funcs computed at root are only computed over what that
+     * crop needs. The dirty region must be given in constants. */
+    EXPORT void realize_dirty(Realization dst, const std::string &input,
+                              const std::vector<std::pair<Expr, Expr>> &dirty,
+                              const Target &target = Target());
+
+    /** Jit-compile this Pipeline, and return a handle to the compiled
+     * code that may be called from several threads at once. Compiling
+     * modifies the Pipeline, so this should not be called at the same
+     * time as other methods of the Pipeline. Specializations are
+     * compiled eagerly, even if the target asks for lazy ones. */
+    EXPORT CompiledPipeline compile_to_compiled_pipeline(const Target &target = get_jit_target_from_environment());
+
+    /** Evaluate this Pipeline, using and updating the state cached in
+     * the given context. The first call, and any call with different
+     * sizes, allocates the output buffers as the realize methods above
+     * do. Later calls with the same sizes write into the same buffers
+     * and return them again, so a Realization returned by an earlier
+     * call is overwritten. Intermediates allocated by the pipeline
+     * reuse memory freed by earlier calls with the same context,
+     * unless the pipeline has a custom allocator. */
+    EXPORT Realization realize(RealizationContext ctx, std::vector<int32_t> sizes,
+                               const Target &target = Target());
+
     /** For a given size of output, or a given set of output buffers,
      * determine the bounds required of all unbound ImageParams
      * referenced. Communicates the result by allocating new buffers
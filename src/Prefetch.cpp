@@ -20,6 +20,40 @@ using std::vector;
 
 namespace {
 
+// The memory latency, in nanoseconds, and the rate at which one core
+// streams data from memory, in bytes per nanosecond, that automatic
+// prefetch distances are chosen for. Their product is the number of
+// bytes a loop consumes while waiting for a prefetch, so that is how
+// far ahead automatic prefetches fetch. The latency varies a lot
+// between machines, so it can be overridden with HL_PREFETCH_LATENCY.
+const int default_prefetch_latency = 100;
+const int default_prefetch_bandwidth = 10;
+
+int prefetch_latency() {
+    string latency = get_env_variable("HL_PREFETCH_LATENCY");
+    if (latency.empty()) {
+        return default_prefetch_latency;
+    }
+    int result = atoi(latency.c_str());
+    user_assert(result > 0) << "HL_PREFETCH_LATENCY must be a positive number of nanoseconds\n";
+    return result;
+}
+
+// The size of the block of memory each prefetch call fetches on the
+// given target, if it fetches a fixed size at all.
+int prefetch_cache_line_size(const Target &t) {
+    if (t.features_any_of({Target::HVX_64, Target::HVX_128})) {
+        // Hexagon prefetches whole boxes.
+        return 0;
+    } else if (t.arch == Target::ARM) {
+        // ARM's cache line size can be 32 or 64 bytes and it can switch the
+        // size at runtime. To be safe, we just use 32 bytes.
+        return 32;
+    } else {
+        return 64;
+    }
+}
+
 const Definition &get_stage_definition(const Function &f, int stage_num) {
     if (stage_num == 0) {
         return f.definition();
@@ -62,12 +96,13 @@ public:
 
 class InjectPrefetch : public IRMutator {
 public:
-    InjectPrefetch(const map<string, Function> &e, const map<string, Box> &buffers)
-        : env(e), external_buffers(buffers), current_func(nullptr), stage(-1) { }
+    InjectPrefetch(const map<string, Function> &e, const map<string, Box> &buffers, const Target &t)
+        : env(e), external_buffers(buffers), target(t), current_func(nullptr), stage(-1) { }
 
 private:
     const map<string, Function> &env;
     const map<string, Box> &external_buffers;
+    const Target &target;
     const Function *current_func;
     int stage;
     Scope<Interval> scope;
@@ -192,6 +227,24 @@ private:
         }
     }
 
+    int element_size(const string &buf_name, const Parameter &param) {
+        if (param.defined()) {
+            return param.type().bytes();
+        }
+        const auto &it = env.find(buf_name);
+        internal_assert(it != env.end());
+        return it->second.output_types()[0].bytes();
+    }
+
+    // The number of bytes of a box.
+    Expr box_size(const Box &box, int elem_size) {
+        Expr size = elem_size;
+        for (size_t i = 0; i < box.size(); i++) {
+            size *= box[i].max - box[i].min + 1;
+        }
+        return simplify(size);
+    }
+
     Stmt add_prefetch(string buf_name, const Parameter &param, const Box &box, Stmt body) {
         // Construct the region to be prefetched.
         Region bounds;
@@ -238,9 +291,44 @@ private:
                 }
                 seen.insert(p.name);
 
+                // If no offset was given, fetch as far ahead as the
+                // memory latency requires, given how much of the
+                // buffer one iteration uses. If that is less than a
+                // cache line, only prefetch once per cache line, at
+                // every few iterations, for all of them.
+                Expr offset = p.offset, guard;
+                int group = 1;
+                if (!offset.defined()) {
+                    scope.push(op->name, Interval(loop_var, loop_var));
+                    map<string, Box> boxes_one = boxes_touched(body, scope);
+                    scope.pop(op->name);
+                    const auto &b = boxes_one.find(p.name);
+                    if (b == boxes_one.end()) {
+                        continue;
+                    }
+
+                    int line_size = prefetch_cache_line_size(target);
+                    if (line_size == 0) {
+                        offset = 1;
+                    } else {
+                        Expr footprint = box_size(b->second, element_size(p.name, p.param));
+                        Expr ahead = prefetch_latency() * default_prefetch_bandwidth;
+                        const int64_t *const_footprint = as_const_int(footprint);
+                        if (const_footprint && *const_footprint > 0 && *const_footprint < line_size) {
+                            group = line_size / (int)(*const_footprint);
+                        }
+                        footprint = max(footprint, 1);
+                        offset = simplify(max((ahead + footprint - 1) / footprint, 1));
+                    }
+                    if (group > 1) {
+                        guard = ((loop_var - op->min) % group) == 0;
+                    }
+                }
+
                 // Add loop variable + prefetch offset to interval scope for box computation
-                Expr fetch_at = loop_var + p.offset;
-                scope.push(op->name, Interval(fetch_at, fetch_at));
+                Expr fetch_at = loop_var + offset;
+                Expr fetch_until = group > 1 ? fetch_at + (group - 1) : fetch_at;
+                scope.push(op->name, Interval(fetch_at, fetch_until));
                 map<string, Box> boxes_rw = boxes_touched(body, scope);
                 scope.pop(op->name);
 
@@ -258,6 +346,10 @@ private:
                     Box bounds = get_buffer_bounds(b->first, b->second.size());
                     internal_assert(prefetch_box.size() == bounds.size());
 
+                    if (guard.defined()) {
+                        prefetch_box.used = prefetch_box.used.defined() ? (prefetch_box.used && guard) : guard;
+                    }
+
                     if (p.strategy == PrefetchBoundStrategy::Clamp) {
                         prefetch_box = box_intersection(prefetch_box, bounds);
                     } else if (p.strategy == PrefetchBoundStrategy::GuardWithIf) {
@@ -357,7 +449,9 @@ class SplitPrefetch : public IRMutator {
             const Variable *base = call->args[0].as<Variable>();
             internal_assert(base && base->type.is_handle());
 
-            int elem_size = base->type.bytes();
+            // The offsets and strides are in elements of the type of
+            // the call, not of the base pointer.
+            int elem_size = call->type.bytes();
 
             vector<string> index_names;
             vector<Expr> extents;
@@ -377,12 +471,13 @@ class SplitPrefetch : public IRMutator {
                     // If 'max_byte_size' is smaller than the absolute value of the
                     // stride bytes, we can only prefetch one element per iteration.
                     outer_extent = extent;
-                    new_offset += outer_var * stride_bytes;
+                    new_offset += outer_var * stride;
                 } else {
                     // Otherwise, we just prefetch 'max_byte_size' per iteration.
                     Expr abs_stride_bytes = Call::make(stride_bytes.type(), Call::abs, {stride_bytes}, Call::PureIntrinsic);
                     outer_extent = simplify((extent * abs_stride_bytes + max_byte_size - 1)/max_byte_size);
-                    new_offset += outer_var * simplify(select(is_negative_stride, -max_byte_size, max_byte_size));
+                    Expr line_elems = simplify(max_byte_size / elem_size);
+                    new_offset += outer_var * simplify(select(is_negative_stride, -line_elems, line_elems));
                 }
                 extents.push_back(outer_extent);
             }
@@ -404,10 +499,10 @@ public:
 
 } // anonymous namespace
 
-Stmt inject_prefetch(Stmt s, const map<string, Function> &env) {
+Stmt inject_prefetch(Stmt s, const map<string, Function> &env, const Target &t) {
     CollectExternalBufferBounds finder;
     s.accept(&finder);
-    return InjectPrefetch(env, finder.buffers).mutate(s);
+    return InjectPrefetch(env, finder.buffers, t).mutate(s);
 }
 
 Stmt reduce_prefetch_dimension(Stmt stmt, const Target &t) {
@@ -418,14 +513,9 @@ Stmt reduce_prefetch_dimension(Stmt stmt, const Target &t) {
     // two dimension. Other architectures generate one prefetch per cache line.
     if (t.features_any_of({Target::HVX_64, Target::HVX_128})) {
         max_dim = 2;
-    } else if (t.arch == Target::ARM) {
-        // ARM's cache line size can be 32 or 64 bytes and it can switch the
-        // size at runtime. To be safe, we just use 32 bytes.
-        max_dim = 1;
-        max_byte_size = 32;
     } else {
         max_dim = 1;
-        max_byte_size = 64;
+        max_byte_size = prefetch_cache_line_size(t);
     }
     internal_assert(max_dim > 0);
 
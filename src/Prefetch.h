@@ -14,7 +14,11 @@
 namespace Halide {
 namespace Internal {
 
-Stmt inject_prefetch(Stmt s, const std::map<std::string, Function> &env);
+/** Inject placeholder prefetches to 's'. Prefetches without an
+ * offset fetch as far ahead as the memory latency requires, and at
+ * most once per cache line. The latency can be set with the
+ * HL_PREFETCH_LATENCY environment variable, in nanoseconds. */
+Stmt inject_prefetch(Stmt s, const std::map<std::string, Function> &env, const Target &t);
 
 /** Reduce a multi-dimensional prefetch into a prefetch of lower dimension
  * (max dimension of the prefetch is specified by target architecture).
@@ -1,4 +1,5 @@
 #include <algorithm>
+#include <fstream>
 #include <map>
 #include <string>
 #include <limits>
@@ -23,10 +24,16 @@ class InjectProfiling : public IRMutator {
 public:
     map<string, int> indices;   // maps from func name -> index in buffer.
 
+    map<string, int> branches;  // maps from branch name -> index in buffer.
+
     vector<int> stack; // What produce nodes are we currently inside of.
 
     string pipeline_name;
 
+    // The variable holding the per-thread slot in which the current
+    // func id is recorded. Each parallel task claims its own.
+    string thread_slot = "profiler_thread_slot";
+
     InjectProfiling(const string &pipeline_name) : pipeline_name(pipeline_name) {
         indices["overhead"] = 0;
         stack.push_back(0);
@@ -47,6 +54,10 @@ private:
 
     bool profiling_memory = true;
 
+    // Inside offloaded code there are no thread slots, so we fall
+    // back to setting the shared current func.
+    bool in_offload = false;
+
     // Strip down the tuple name, e.g. f.0 into f
     string normalize_name(const string &name) {
         vector<string> v = split_string(name, ".");
@@ -197,17 +208,49 @@ private:
         }
 
         Expr profiler_token = Variable::make(Int(32), "profiler_token");
-        Expr profiler_state = Variable::make(Handle(), "profiler_state");
 
         // This call gets inlined and becomes a single store instruction.
-        Expr set_task = Call::make(Int(32), "halide_profiler_set_current_func",
-                                   {profiler_state, profiler_token, idx}, Call::Extern);
+        Expr set_task;
+        if (in_offload) {
+            Expr profiler_state = Variable::make(Handle(), "profiler_state");
+            set_task = Call::make(Int(32), "halide_profiler_set_current_func",
+                                  {profiler_state, profiler_token, idx}, Call::Extern);
+        } else {
+            Expr slot = Variable::make(Handle(), thread_slot);
+            set_task = Call::make(Int(32), "halide_profiler_set_thread_func",
+                                  {slot, profiler_token, idx}, Call::Extern);
+        }
 
         body = Block::make(Evaluate::make(set_task), body);
 
         stmt = ProducerConsumer::make(op->name, op->is_producer, body);
     }
 
+    void visit(const Evaluate *op) {
+        const Call *call = op->value.as<Call>();
+        if (!call || !call->is_intrinsic(Call::branch_profile) || in_offload) {
+            IRMutator::visit(op);
+            return;
+        }
+
+        // Count the branch this marker starts. Leave the marker in
+        // place, in case the branch is also being weighted.
+        const StringImm *name = call->args[0].as<StringImm>();
+        internal_assert(name);
+        int idx;
+        map<string, int>::iterator iter = branches.find(name->value);
+        if (iter == branches.end()) {
+            idx = (int)branches.size();
+            branches[name->value] = idx;
+        } else {
+            idx = iter->second;
+        }
+        Expr profiler_pipeline_state = Variable::make(Handle(), "profiler_pipeline_state");
+        Expr taken = Call::make(Int(32), "halide_profiler_branch_taken",
+                                {profiler_pipeline_state, idx}, Call::Extern);
+        stmt = Block::make(op, Evaluate::make(taken));
+    }
+
     void visit(const For *op) {
         Stmt body = op->body;
 
@@ -237,9 +280,12 @@ private:
             // hexagon. We don't support per-func stats remotely,
             // which means we can't do memory accounting.
             bool old_profiling_memory = profiling_memory;
+            bool old_in_offload = in_offload;
             profiling_memory = false;
+            in_offload = true;
             body = mutate(body);
             profiling_memory = old_profiling_memory;
+            in_offload = old_in_offload;
 
             // Get the profiler state pointer from scratch inside the
             // kernel. There will be a separate copy of the state on
@@ -249,7 +295,24 @@ private:
             body = LetStmt::make("hvx_profiler_state", get_state, body);
         } else if (op->device_api == DeviceAPI::None ||
                    op->device_api == DeviceAPI::Host) {
-            body = mutate(body);
+            if (op->is_parallel() && !in_offload) {
+                // Each task records its func in its own slot, which
+                // it claims on entry and gives back on exit.
+                string outer_slot = thread_slot;
+                thread_slot = op->name + ".profiler_thread_slot";
+                body = mutate(body);
+                Expr profiler_token = Variable::make(Int(32), "profiler_token");
+                Expr claim = Call::make(Handle(), "halide_profiler_claim_thread_slot",
+                                        {state, profiler_token + stack.back()}, Call::Extern);
+                Expr release = Call::make(Int(32), Call::register_destructor,
+                                          {Expr("halide_profiler_release_thread_slot"),
+                                           Variable::make(Handle(), thread_slot)}, Call::Intrinsic);
+                body = Block::make(Evaluate::make(release), body);
+                body = LetStmt::make(thread_slot, claim, body);
+                thread_slot = outer_slot;
+            } else {
+                body = mutate(body);
+            }
         } else {
             body = op->body;
         }
@@ -259,6 +322,22 @@ private:
         if (update_active_threads) {
             stmt = Block::make({decr_active_threads, stmt, incr_active_threads});
         }
+
+        if (op->is_parallel() && !in_offload &&
+            (op->device_api == DeviceAPI::None ||
+             op->device_api == DeviceAPI::Host)) {
+            // While the tasks run, the launching thread is only
+            // waiting for them (or running some of them under their
+            // own slots), so don't bill it to anything.
+            Expr profiler_token = Variable::make(Int(32), "profiler_token");
+            Expr slot = Variable::make(Handle(), thread_slot);
+            // -1 is halide_profiler_outside_of_halide.
+            Stmt leave = Evaluate::make(Call::make(Int(32), "halide_profiler_set_thread_func",
+                                                   {slot, -1, 0}, Call::Extern));
+            Stmt enter = Evaluate::make(Call::make(Int(32), "halide_profiler_set_thread_func",
+                                                   {slot, profiler_token, stack.back()}, Call::Extern));
+            stmt = Block::make({leave, stmt, enter});
+        }
     }
 };
 
@@ -301,6 +380,25 @@ Stmt inject_profiling(Stmt s, string pipeline_name) {
                                   {profiler_state}, Call::Extern));
     s = Block::make({incr_active_threads, s, decr_active_threads});
 
+    // The calling thread records its current func in a slot of its
+    // own, given back when the pipeline exits.
+    Expr claim_slot = Call::make(Handle(), "halide_profiler_claim_thread_slot",
+                                 {profiler_state, profiler_token}, Call::Extern);
+    Expr release_slot = Call::make(Int(32), Call::register_destructor,
+                                   {Expr("halide_profiler_release_thread_slot"),
+                                    Variable::make(Handle(), "profiler_thread_slot")}, Call::Intrinsic);
+    s = Block::make(Evaluate::make(release_slot), s);
+    s = LetStmt::make("profiler_thread_slot", claim_slot, s);
+
+    int num_branches = (int)(profiling.branches.size());
+    if (num_branches > 0) {
+        Expr branch_names_buf = Variable::make(Handle(), "profiling_branch_names");
+        Expr profiler_pipeline_state = Variable::make(Handle(), "profiler_pipeline_state");
+        Expr register_branches = Call::make(Int(32), "halide_profiler_register_branches",
+                                            {profiler_pipeline_state, num_branches, branch_names_buf}, Call::Extern);
+        s = Block::make(AssertStmt::make(register_branches == 0, register_branches), s);
+    }
+
     s = LetStmt::make("profiler_pipeline_state", get_pipeline_state, s);
     s = LetStmt::make("profiler_state", get_state, s);
     // If there was a problem starting the profiler, it will call an
@@ -319,6 +417,14 @@ Stmt inject_profiling(Stmt s, string pipeline_name) {
         s = Allocate::make("profiling_func_stack_peak_buf", UInt(64), {num_funcs}, const_true(), s);
     }
 
+    if (num_branches > 0) {
+        for (std::pair<string, int> p : profiling.branches) {
+            s = Block::make(Store::make("profiling_branch_names", p.first, p.second, Parameter(), const_true()), s);
+        }
+        s = Block::make(s, Free::make("profiling_branch_names"));
+        s = Allocate::make("profiling_branch_names", Handle(), {num_branches}, const_true(), s);
+    }
+
     for (std::pair<string, int> p : profiling.indices) {
         s = Block::make(Store::make("profiling_func_names", p.first, p.second, Parameter(), const_true()), s);
     }
@@ -330,5 +436,65 @@ Stmt inject_profiling(Stmt s, string pipeline_name) {
     return s;
 }
 
+bool profile_branches(const Target &t) {
+    return t.has_feature(Target::Profile) || !get_env_variable("HL_PGO_PROFILE").empty();
+}
+
+namespace {
+
+class ApplyBranchProfile : public IRMutator {
+    using IRMutator::visit;
+
+    const map<string, uint64_t> &counts;
+
+    void visit(const Call *op) {
+        if (!op->is_intrinsic(Call::branch_profile) || op->args.size() != 1) {
+            IRMutator::visit(op);
+            return;
+        }
+        const StringImm *name = op->args[0].as<StringImm>();
+        internal_assert(name);
+        map<string, uint64_t>::const_iterator iter = counts.find(name->value);
+        if (iter == counts.end()) {
+            debug(2) << "No profile for branch " << name->value << "\n";
+            expr = op;
+        } else {
+            expr = Call::make(op->type, Call::branch_profile,
+                              {op->args[0], make_const(UInt(64), iter->second)}, Call::Intrinsic);
+        }
+    }
+
+public:
+    ApplyBranchProfile(const map<string, uint64_t> &c) : counts(c) {}
+};
+
+}
+
+Stmt apply_branch_profile(Stmt s, const string &pipeline_name) {
+    string filename = get_env_variable("HL_PGO_PROFILE");
+    if (filename.empty()) {
+        return s;
+    }
+
+    std::ifstream file(filename);
+    user_assert(file.is_open())
+        << "Could not open the profile named by HL_PGO_PROFILE: " << filename << "\n";
+
+    // The same branch appears once for each run that appended to the
+    // profile, so add them up.
+    map<string, uint64_t> counts;
+    string pipeline, branch;
+    uint64_t count;
+    while (file >> pipeline >> branch >> count) {
+        if (pipeline == pipeline_name) {
+            counts[branch] += count;
+        }
+    }
+    debug(1) << "Found " << counts.size() << " branch counts for " << pipeline_name
+             << " in " << filename << "\n";
+
+    return ApplyBranchProfile(counts).mutate(s);
+}
+
 }
 }
@@ -25,6 +25,7 @@
  */
 
 #include "IR.h"
+#include "Target.h"
 
 namespace Halide {
 namespace Internal {
@@ -38,6 +39,21 @@ namespace Internal {
  */
 Stmt inject_profiling(Stmt, std::string);
 
+/** Whether the dispatch between the specializations of each stage
+ * should be marked with branch_profile intrinsics naming the way
+ * taken. They are needed when profiling, which counts how often each
+ * is taken, and when the environment variable HL_PGO_PROFILE names a
+ * file of such counts to compile with. */
+bool profile_branches(const Target &t);
+
+/** Replace the branch_profile markers with the counts found in the
+ * file named by HL_PGO_PROFILE for the given pipeline, so that code
+ * generation can weight the branches they start. Branches not in the
+ * profile keep no count. The file is written by a pipeline compiled
+ * with the profiler when HL_PROFILER_BRANCH_PROFILE names it, and
+ * holds one "\<pipeline_name\> \<branch\> \<count\>" line per branch. */
+Stmt apply_branch_profile(Stmt, const std::string &pipeline_name);
+
 }
 }
 
@@ -61,6 +61,59 @@ Expr rng32(Expr x) {
     return (((C2 * x) + C1) * x) + C0;
 }
 
+// Map 32 random bits to a float in [0, 1).
+Expr bits_to_float(Expr bits) {
+    // Set the exponent to one, and fill the mantissa with 23 random bits.
+    Expr result = (127 << 23) | (cast<uint32_t>(bits) >> 9);
+    // The clamp is purely for the benefit of bounds inference.
+    return clamp(reinterpret(Float(32), result) - 1.0f, 0.0f, 1.0f);
+}
+
+// Builds one Threefry-2x32 block: 20 rounds of adds, rotates and
+// xors, with the key injected every four rounds. Every intermediate
+// value is used twice, so each is bound to a let.
+class Threefry {
+    vector<std::pair<string, Expr>> lets;
+
+    Expr bind(Expr e) {
+        string name = unique_name('R');
+        lets.push_back({name, e});
+        return Variable::make(UInt(32), name);
+    }
+
+    Expr rotate_left(Expr x, int r) {
+        return (x << r) | (x >> (32 - r));
+    }
+
+public:
+    // Encrypt the counter (x0, x1) with the key (k0, k1) in place.
+    void block(Expr k0, Expr k1, Expr &x0, Expr &x1) {
+        static const int rotations[8] = {13, 15, 26, 6, 17, 29, 16, 24};
+        k0 = bind(k0);
+        k1 = bind(k1);
+        Expr ks[3] = {k0, k1, bind((k0 ^ k1) ^ make_const(UInt(32), 0x1BD11BDA))};
+        x0 = bind(x0 + ks[0]);
+        x1 = bind(x1 + ks[1]);
+        for (int r = 0; r < 20; r++) {
+            x0 = bind(x0 + x1);
+            x1 = bind(rotate_left(x1, rotations[r % 8]) ^ x0);
+            if (r % 4 == 3) {
+                int s = (r + 1) / 4;
+                x0 = bind(x0 + ks[s % 3]);
+                x1 = bind(x1 + (ks[(s + 1) % 3] + s));
+            }
+        }
+    }
+
+    // Wrap the lets made so far around an Expr.
+    Expr wrap(Expr e) {
+        for (auto it = lets.rbegin(); it != lets.rend(); it++) {
+            e = Let::make(it->first, it->second, e);
+        }
+        return e;
+    }
+};
+
 }
 
 Expr random_int(const vector<Expr> &e) {
@@ -86,11 +139,33 @@ Expr random_int(const vector<Expr> &e) {
 }
 
 Expr random_float(const vector<Expr> &e) {
-    Expr result = random_int(e);
-    // Set the exponent to one, and fill the mantissa with 23 random bits.
-    result = (127 << 23) | (cast<uint32_t>(result) >> 9);
-    // The clamp is purely for the benefit of bounds inference.
-    return clamp(reinterpret(Float(32), result) - 1.0f, 0.0f, 1.0f);
+    return bits_to_float(random_int(e));
+}
+
+Expr counter_random_int(Expr seed, Expr stream, const vector<Expr> &counter) {
+    vector<Expr> words;
+    for (Expr c : counter) {
+        internal_assert(c.type() == Int(32) || c.type() == UInt(32));
+        words.push_back(cast(UInt(32), c));
+    }
+    // The counter is consumed two words at a time. Beyond the first
+    // block, the output of each block is the key for the next.
+    if (words.size() % 2) {
+        words.push_back(make_zero(UInt(32)));
+    }
+    if (words.empty()) {
+        words.resize(2, make_zero(UInt(32)));
+    }
+
+    Threefry threefry;
+    Expr k0 = cast(UInt(32), seed), k1 = cast(UInt(32), stream);
+    for (size_t i = 0; i < words.size(); i += 2) {
+        Expr x0 = words[i], x1 = words[i + 1];
+        threefry.block(k0, k1, x0, x1);
+        k0 = x0;
+        k1 = x1;
+    }
+    return threefry.wrap(k0);
 }
 
 class LowerRandom : public IRMutator {
@@ -109,19 +184,35 @@ class LowerRandom : public IRMutator {
             } else {
                 internal_error << "The intrinsic random() returns an Int(32), UInt(32) or a Float(32).\n";
             }
+        } else if (op->is_intrinsic(Call::counter_random)) {
+            // Only depends on the key and the coordinates, not on
+            // the tag, so that the values don't depend on the order
+            // in which Funcs were defined.
+            internal_assert(op->args.size() == 2);
+            Expr bits = counter_random_int(op->args[0], op->args[1], free_vars);
+            if (op->type == Float(32)) {
+                expr = bits_to_float(bits);
+            } else if (op->type == Int(32)) {
+                expr = cast<int32_t>(bits);
+            } else if (op->type == UInt(32)) {
+                expr = bits;
+            } else {
+                internal_error << "The intrinsic counter_random() returns an Int(32), UInt(32) or a Float(32).\n";
+            }
         } else {
             IRMutator::visit(op);
         }
     }
 
-    vector<Expr> extra_args;
+    vector<Expr> extra_args, free_vars;
 public:
-    LowerRandom(const vector<string> &free_vars, int tag) {
+    LowerRandom(const vector<string> &free_var_names, int tag) {
         extra_args.push_back(tag);
-        for (size_t i = 0; i < free_vars.size(); i++) {
-            internal_assert(!free_vars[i].empty());
-            extra_args.push_back(Variable::make(Int(32), free_vars[i]));
+        for (size_t i = 0; i < free_var_names.size(); i++) {
+            internal_assert(!free_var_names[i].empty());
+            free_vars.push_back(Variable::make(Int(32), free_var_names[i]));
         }
+        extra_args.insert(extra_args.end(), free_vars.begin(), free_vars.end());
     }
 };
 
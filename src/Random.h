@@ -20,9 +20,18 @@ Expr random_float(const std::vector<Expr> &);
  * be integers or unsigned integers). */
 Expr random_int(const std::vector<Expr> &);
 
+/** Return a random unsigned integer between zero and 2^32-1 from the
+ * Threefry-2x32 counter-based generator with 20 rounds (Salmon et al.,
+ * "Parallel Random Numbers: As Easy as 1, 2, 3"). The key is the seed
+ * and the stream, and the counter is made of the remaining
+ * expressions (which must be integers or unsigned integers). */
+Expr counter_random_int(Expr seed, Expr stream, const std::vector<Expr> &counter);
+
 /** Convert calls to random() to IR generated by random_float and
- * random_int. Tags all calls with the variables in free_vars, and the
- * integer given as the last argument. */
+ * random_int, and calls to counter_random() to IR generated by
+ * counter_random_int. Tags all calls with the variables in free_vars,
+ * and calls to random() also with the integer given as the last
+ * argument. */
 Expr lower_random(Expr e, const std::vector<std::string> &free_vars, int tag);
 
 }
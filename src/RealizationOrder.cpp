@@ -65,6 +65,49 @@ vector<string> realization_order(const vector<Function> &outputs,
         }
     }
 
+    auto calls = [&graph](const string &caller, const string &callee) {
+        const auto iter = std::find_if(graph.begin(), graph.end(),
+            [&caller](const pair<string, vector<string>> &p) { return (p.first == caller); });
+        internal_assert(iter != graph.end());
+        return std::find(iter->second.begin(), iter->second.end(), callee) != iter->second.end();
+    };
+
+    // Funcs with fused loops (see Func::compute_with) must be
+    // realized one right after the other. Move each one next to the
+    // Func it is fused with, if nothing in between depends on it, or
+    // is depended on by it.
+    for (const pair<string, Function> &iter : env) {
+        const LoopLevel &level = iter.second.schedule().compute_with_level();
+        if (!level.defined()) {
+            continue;
+        }
+        const string &child = iter.first;
+        auto child_pos = std::find(order.begin(), order.end(), child);
+        auto parent_pos = std::find(order.begin(), order.end(), level.func());
+        if (child_pos == order.end() || parent_pos == order.end()) {
+            continue;
+        }
+        bool can_move = true;
+        if (child_pos < parent_pos) {
+            for (auto i = child_pos + 1; i != parent_pos; i++) {
+                can_move = can_move && !calls(*i, child);
+            }
+            if (can_move) {
+                order.insert(parent_pos, child);
+                order.erase(std::find(order.begin(), order.end(), child));
+            }
+        } else {
+            for (auto i = parent_pos + 1; i != child_pos; i++) {
+                can_move = can_move && !calls(child, *i);
+            }
+            if (can_move) {
+                order.erase(child_pos);
+                parent_pos = std::find(order.begin(), order.end(), level.func());
+                order.insert(parent_pos + 1, child);
+            }
+        }
+    }
+
     return order;
 }
 
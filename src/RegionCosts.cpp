@@ -212,6 +212,11 @@ class ExprCost : public IRVisitor {
         cost.arith += 1;
     }
 
+    void visit(const VectorReduce *op) {
+        op->value.accept(this);
+        cost.arith += op->value.type().lanes() / op->type.lanes() - 1;
+    }
+
     void visit(const Let *let) {
         let->value.accept(this);
         let->body.accept(this);
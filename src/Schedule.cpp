@@ -120,16 +120,23 @@ typedef std::map<FunctionPtr, FunctionPtr> DeepCopyMap;
 struct FuncScheduleContents {
     mutable RefCount ref_count;
 
-    LoopLevel store_level, compute_level;
+    LoopLevel store_level, compute_level, compute_with_level, hoist_storage_level;
     std::vector<StorageDim> storage_dims;
     std::vector<Bound> bounds;
     std::vector<Bound> estimates;
     std::map<std::string, Internal::FunctionPtr> wrappers;
     bool memoized;
+    int64_t hashed_buffer_max_bytes;
+    bool async;
+    bool nontemporal;
+    bool interleave_tuple;
+    Expr slide_task_size;
+    Expr compute_if;
+    std::string stream_var;
 
     FuncScheduleContents() :
         store_level(LoopLevel::inlined()), compute_level(LoopLevel::inlined()),
-        memoized(false) {};
+        memoized(false), hashed_buffer_max_bytes(0), async(false), nontemporal(false), interleave_tuple(false) {};
 
     // Pass an IRMutator through to all Exprs referenced in the FuncScheduleContents
     void mutate(IRMutator *mutator) {
@@ -161,6 +168,12 @@ struct FuncScheduleContents {
                 b.remainder = mutator->mutate(b.remainder);
             }
         }
+        if (slide_task_size.defined()) {
+            slide_task_size = mutator->mutate(slide_task_size);
+        }
+        if (compute_if.defined()) {
+            compute_if = mutator->mutate(compute_if);
+        }
     }
 };
 
@@ -186,8 +199,14 @@ struct StageScheduleContents {
     std::vector<PrefetchDirective> prefetches;
     bool touched;
     bool allow_race_conditions;
+    bool atomic;
+    std::string compact_var;
+    int compact_vector_width;
+    std::string auto_task_size_var;
+    int min_task_size, max_task_size;
 
-    StageScheduleContents() : touched(false), allow_race_conditions(false) {};
+    StageScheduleContents() : touched(false), allow_race_conditions(false), atomic(false),
+                              compact_vector_width(0), min_task_size(1), max_task_size(0) {};
 
     // Pass an IRMutator through to all Exprs referenced in the StageScheduleContents
     void mutate(IRMutator *mutator) {
@@ -232,10 +251,19 @@ FuncSchedule FuncSchedule::deep_copy(
     FuncSchedule copy;
     copy.contents->store_level = contents->store_level;
     copy.contents->compute_level = contents->compute_level;
+    copy.contents->compute_with_level = contents->compute_with_level;
+    copy.contents->hoist_storage_level = contents->hoist_storage_level;
     copy.contents->storage_dims = contents->storage_dims;
     copy.contents->bounds = contents->bounds;
     copy.contents->estimates = contents->estimates;
     copy.contents->memoized = contents->memoized;
+    copy.contents->hashed_buffer_max_bytes = contents->hashed_buffer_max_bytes;
+    copy.contents->async = contents->async;
+    copy.contents->nontemporal = contents->nontemporal;
+    copy.contents->interleave_tuple = contents->interleave_tuple;
+    copy.contents->slide_task_size = contents->slide_task_size;
+    copy.contents->compute_if = contents->compute_if;
+    copy.contents->stream_var = contents->stream_var;
 
     // Deep-copy wrapper functions.
     for (const auto &iter : contents->wrappers) {
@@ -255,6 +283,62 @@ bool FuncSchedule::memoized() const {
     return contents->memoized;
 }
 
+int64_t &FuncSchedule::hashed_buffer_max_bytes() {
+    return contents->hashed_buffer_max_bytes;
+}
+
+int64_t FuncSchedule::hashed_buffer_max_bytes() const {
+    return contents->hashed_buffer_max_bytes;
+}
+
+bool &FuncSchedule::async() {
+    return contents->async;
+}
+
+bool FuncSchedule::async() const {
+    return contents->async;
+}
+
+bool &FuncSchedule::nontemporal() {
+    return contents->nontemporal;
+}
+
+bool FuncSchedule::nontemporal() const {
+    return contents->nontemporal;
+}
+
+bool &FuncSchedule::interleave_tuple() {
+    return contents->interleave_tuple;
+}
+
+bool FuncSchedule::interleave_tuple() const {
+    return contents->interleave_tuple;
+}
+
+Expr &FuncSchedule::slide_task_size() {
+    return contents->slide_task_size;
+}
+
+Expr FuncSchedule::slide_task_size() const {
+    return contents->slide_task_size;
+}
+
+Expr &FuncSchedule::compute_if() {
+    return contents->compute_if;
+}
+
+Expr FuncSchedule::compute_if() const {
+    return contents->compute_if;
+}
+
+std::string &FuncSchedule::stream_var() {
+    return contents->stream_var;
+}
+
+const std::string &FuncSchedule::stream_var() const {
+    return contents->stream_var;
+}
+
 std::vector<StorageDim> &FuncSchedule::storage_dims() {
     return contents->storage_dims;
 }
@@ -316,6 +400,22 @@ const LoopLevel &FuncSchedule::compute_level() const {
     return contents->compute_level;
 }
 
+LoopLevel &FuncSchedule::compute_with_level() {
+    return contents->compute_with_level;
+}
+
+const LoopLevel &FuncSchedule::compute_with_level() const {
+    return contents->compute_with_level;
+}
+
+LoopLevel &FuncSchedule::hoist_storage_level() {
+    return contents->hoist_storage_level;
+}
+
+const LoopLevel &FuncSchedule::hoist_storage_level() const {
+    return contents->hoist_storage_level;
+}
+
 void FuncSchedule::accept(IRVisitor *visitor) const {
     for (const Bound &b : bounds()) {
         if (b.min.defined()) {
@@ -345,6 +445,12 @@ void FuncSchedule::accept(IRVisitor *visitor) const {
             b.remainder.accept(visitor);
         }
     }
+    if (slide_task_size().defined()) {
+        slide_task_size().accept(visitor);
+    }
+    if (compute_if().defined()) {
+        compute_if().accept(visitor);
+    }
 }
 
 void FuncSchedule::mutate(IRMutator *mutator) {
@@ -365,6 +471,12 @@ StageSchedule StageSchedule::get_copy() const {
     copy.contents->prefetches = contents->prefetches;
     copy.contents->touched = contents->touched;
     copy.contents->allow_race_conditions = contents->allow_race_conditions;
+    copy.contents->atomic = contents->atomic;
+    copy.contents->compact_var = contents->compact_var;
+    copy.contents->compact_vector_width = contents->compact_vector_width;
+    copy.contents->auto_task_size_var = contents->auto_task_size_var;
+    copy.contents->min_task_size = contents->min_task_size;
+    copy.contents->max_task_size = contents->max_task_size;
     return copy;
 }
 
@@ -416,6 +528,54 @@ bool StageSchedule::allow_race_conditions() const {
     return contents->allow_race_conditions;
 }
 
+bool &StageSchedule::atomic() {
+    return contents->atomic;
+}
+
+bool StageSchedule::atomic() const {
+    return contents->atomic;
+}
+
+std::string &StageSchedule::compact_var() {
+    return contents->compact_var;
+}
+
+const std::string &StageSchedule::compact_var() const {
+    return contents->compact_var;
+}
+
+int &StageSchedule::compact_vector_width() {
+    return contents->compact_vector_width;
+}
+
+int StageSchedule::compact_vector_width() const {
+    return contents->compact_vector_width;
+}
+
+std::string &StageSchedule::auto_task_size_var() {
+    return contents->auto_task_size_var;
+}
+
+const std::string &StageSchedule::auto_task_size_var() const {
+    return contents->auto_task_size_var;
+}
+
+int &StageSchedule::min_task_size() {
+    return contents->min_task_size;
+}
+
+int StageSchedule::min_task_size() const {
+    return contents->min_task_size;
+}
+
+int &StageSchedule::max_task_size() {
+    return contents->max_task_size;
+}
+
+int StageSchedule::max_task_size() const {
+    return contents->max_task_size;
+}
+
 void StageSchedule::accept(IRVisitor *visitor) const {
     for (const ReductionVariable &r : rvars()) {
         if (r.min.defined()) {
@@ -63,12 +63,46 @@ enum class TailStrategy {
      * instead of a multiple of the split factor as with RoundUp. */
     ShiftInwards,
 
+    /** Guard the inner loop like GuardWithIf, but if the inner loop
+     * is vectorized, handle the tail case with predicated (masked)
+     * vector loads and stores instead of scalarizing it. Always
+     * legal. Pros: the tail case runs at close to full vector
+     * throughput, which matters when the extent is not much larger
+     * than the vector width. Cons: masked loads and stores are
+     * slower than plain ones on most targets, and are emulated on
+     * targets without them (e.g. ARM). Falls back to scalarizing if
+     * the tail contains anything that can't be predicated, such as
+     * calls with side-effects. */
+    Predicate,
+
     /** For pure definitions use ShiftInwards. For pure vars in
      * update definitions use RoundUp. For RVars in update
      * definitions use GuardWithIf. */
     Auto
 };
 
+/** Vector widths that can be passed to Func::vectorize in place of a
+ * constant, to let the compiler choose one. */
+enum class VectorWidth {
+    /** Choose the width from the natural vector sizes on the target
+     * of the narrowest and widest types the definitions of the Func
+     * compute with, so that the narrowest type fills a vector
+     * register, but the widest type doesn't spread across more than
+     * four of them. */
+    Auto
+};
+
+/** Task sizes that can be passed to Func::parallel in place of a
+ * constant, to let the runtime choose one. */
+enum class TaskSize {
+    /** Group the iterations of the loop into tasks sized at runtime
+     * from the extent of the loop, the number of threads, and the
+     * time each iteration takes: estimated from the definition of
+     * the stage at first, and then measured on earlier runs of the
+     * loop. */
+    Auto
+};
+
 /** Different ways to handle accesses outside the original extents in a prefetch. */
 enum class PrefetchBoundStrategy {
     /** Clamp the prefetched exprs by intersecting the prefetched region with
@@ -190,6 +224,10 @@ struct Split {
     // split, it joins the outer and inner into the old_var.
     SplitType split_type;
 
+    // If this is a fuse, whether the fused var visits the points of
+    // the inner and outer vars in Z-order, instead of row by row.
+    bool z_order;
+
     bool is_rename() const {return split_type == RenameVar;}
     bool is_split() const {return split_type == SplitVar;}
     bool is_fuse() const {return split_type == FuseVars;}
@@ -223,11 +261,16 @@ struct StorageDim {
     Expr alignment;
     Expr fold_factor;
     bool fold_forward;
+    // The extent of a tile along this dimension, if it is one of the
+    // two innermost storage dimensions, and they are stored in
+    // tiles. See Func::store_tiled.
+    Expr tile_extent;
 };
 
 struct PrefetchDirective {
     std::string name;
     std::string var;
+    // Undefined if the offset should be chosen during lowering.
     Expr offset;
     PrefetchBoundStrategy strategy;
     // If it's a prefetch load from an image parameter, this points to that.
@@ -267,6 +310,61 @@ public:
     bool memoized() const;
     // @}
 
+    /** The largest input buffer, in bytes, whose contents are hashed
+     * into the cache key of a memoized Func, or zero if buffers can't
+     * be part of the cache key. See \ref Func::memoize_buffer_contents */
+    // @{
+    int64_t &hashed_buffer_max_bytes();
+    int64_t hashed_buffer_max_bytes() const;
+    // @}
+
+    /** This flag is set to true if the function should be computed
+     * asynchronously with its consumer. See \ref Func::async */
+    // @{
+    bool &async();
+    bool async() const;
+    // @}
+
+    /** This flag is set to true if the stores to the function should
+     * bypass the caches where possible. See \ref Func::store_nontemporal */
+    // @{
+    bool &nontemporal();
+    bool nontemporal() const;
+    // @}
+
+    /** This flag is set to true if the elements of a Tuple-valued
+     * function should be stored interleaved in a single
+     * allocation. See \ref Func::store_tuple_interleaved */
+    // @{
+    bool &interleave_tuple();
+    bool interleave_tuple() const;
+    // @}
+
+    /** The number of iterations of a parallel loop between the store
+     * and compute levels of the function to run as one serial task,
+     * so that it can be slid over within each task. Undefined if the
+     * loop should be left alone. See \ref Func::slide_in_tasks */
+    // @{
+    Expr &slide_task_size();
+    Expr slide_task_size() const;
+    // @}
+
+    /** A boolean condition that must hold at runtime for the function
+     * to be computed. Undefined if the function is always
+     * computed. See \ref Func::compute_if */
+    // @{
+    Expr &compute_if();
+    Expr compute_if() const;
+    // @}
+
+    /** The dimension along which the function is streamed, keeping
+     * its values from one call of the pipeline to the next. Empty if
+     * the function isn't streamed. See \ref Func::stream */
+    // @{
+    std::string &stream_var();
+    const std::string &stream_var() const;
+    // @}
+
     /** The list and order of dimensions used to store this
      * function. The first dimension in the vector corresponds to the
      * innermost dimension for storage (i.e. which dimension is
@@ -315,6 +413,24 @@ public:
     LoopLevel &compute_level();
     // @}
 
+    /** The loop level of another Func computed at the same site that
+     * the loops of this Func are fused with, down to and including
+     * that level. Undefined if the loops aren't fused. See \ref
+     * Func::compute_with */
+    // @{
+    const LoopLevel &compute_with_level() const;
+    LoopLevel &compute_with_level();
+    // @}
+
+    /** The loop level the allocation of this function is hoisted to,
+     * while it is still computed and stored at its compute and store
+     * levels. Undefined if the allocation isn't hoisted. See \ref
+     * Func::hoist_storage */
+    // @{
+    const LoopLevel &hoist_storage_level() const;
+    LoopLevel &hoist_storage_level();
+    // @}
+
     /** Pass an IRVisitor through to all Exprs referenced in the
      * Schedule. */
     void accept(IRVisitor *) const;
@@ -388,6 +504,37 @@ public:
     bool &allow_race_conditions();
     // @}
 
+    /** Should the stores of this stage be atomic read-modify-write
+     * operations? See \ref Stage::atomic */
+    // @{
+    bool atomic() const;
+    bool &atomic();
+    // @}
+
+    /** The loop from which the loops of this stage iterate over only
+     * the points that satisfy the predicates of the reduction
+     * domain, and the vector width used to do so. Empty if the stage
+     * isn't compacted. See \ref Stage::compact */
+    // @{
+    const std::string &compact_var() const;
+    std::string &compact_var();
+    int compact_vector_width() const;
+    int &compact_vector_width();
+    // @}
+
+    /** The parallel loop of this stage whose iterations are grouped
+     * into tasks sized at runtime, and the bounds on the size of
+     * those tasks (zero for no upper bound). Empty if there is no
+     * such loop. See \ref Stage::parallel */
+    // @{
+    const std::string &auto_task_size_var() const;
+    std::string &auto_task_size_var();
+    int min_task_size() const;
+    int &min_task_size();
+    int max_task_size() const;
+    int &max_task_size();
+    // @}
+
     /** Pass an IRVisitor through to all Exprs referenced in the
      * Schedule. */
     void accept(IRVisitor *) const;
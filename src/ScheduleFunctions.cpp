@@ -11,8 +11,10 @@
 #include "CodeGen_GPU_Dev.h"
 #include "IRPrinter.h"
 #include "Func.h"
+#include "FuseLoops.h"
 #include "ApplySplit.h"
 #include "IREquality.h"
+#include "Profiling.h"
 
 namespace Halide {
 namespace Internal {
@@ -73,8 +75,21 @@ Stmt build_provide_loop_nest_helper(string func_name,
     // We'll build it from inside out, starting from a store node,
     // then wrapping it in for loops.
 
-    // Make the (multi-dimensional multi-valued) store node.
-    Stmt stmt = Provide::make(func_name, values, site);
+    // Make the (multi-dimensional multi-valued) store node. If the
+    // stage is atomic, mark each value so that codegen makes its
+    // store a read-modify-write. If the Func is stored
+    // non-temporally, mark each value with that hint instead.
+    Stmt stmt;
+    if (stage_s.atomic() || func_s.nontemporal()) {
+        string marker = stage_s.atomic() ? Call::atomic_update : Call::nontemporal_store;
+        vector<Expr> marked_values;
+        for (Expr v : values) {
+            marked_values.push_back(Call::make(v.type(), marker, {v}, Call::Intrinsic));
+        }
+        stmt = Provide::make(func_name, marked_values, site);
+    } else {
+        stmt = Provide::make(func_name, values, site);
+    }
 
     // A map of the dimensions for which we know the extent is a
     // multiple of some Expr. This can happen due to a bound, or
@@ -267,7 +282,8 @@ Stmt build_provide_loop_nest(string func_name,
                              const vector<string> &dims,
                              const FuncSchedule &f_sched,
                              const Definition &def,
-                             bool is_update) {
+                             bool is_update,
+                             bool profile_branches) {
 
     internal_assert(!is_update == def.is_init());
 
@@ -293,15 +309,30 @@ Stmt build_provide_loop_nest(string func_name,
     Stmt stmt = build_provide_loop_nest_helper(
         func_name, prefix, dims, site, values, def.split_predicate(), f_sched, def.schedule(), is_update);
 
-    // Make any specialized copies
+    // Mark each way through the specializations, so that the
+    // profiler can count them and a profile can weight the branches.
+    auto mark_branch = [&](const string &branch, Stmt s) {
+        Expr marker = Call::make(Int(32), Call::branch_profile,
+                                 {prefix + "specialization." + branch}, Call::Intrinsic);
+        return Block::make(Evaluate::make(marker), s);
+    };
+
     const vector<Specialization> &specializations = def.specializations();
+    if (profile_branches && !specializations.empty()) {
+        stmt = mark_branch("default", stmt);
+    }
+
+    // Make any specialized copies
     for (size_t i = specializations.size(); i > 0; i--) {
         const Specialization &s = specializations[i-1];
         Expr c = s.condition;
         const Definition &s_def = s.definition;
         Stmt then_case;
         if (s.failure_message.empty()) {
-            then_case = build_provide_loop_nest(func_name, prefix, dims, f_sched, s_def, is_update);
+            then_case = build_provide_loop_nest(func_name, prefix, dims, f_sched, s_def, is_update, profile_branches);
+            if (profile_branches) {
+                then_case = mark_branch(std::to_string(i-1), then_case);
+            }
         } else {
             internal_assert(equal(c, const_true()));
             // specialize_fail() should only be possible on the final specialization
@@ -319,6 +350,109 @@ Stmt build_provide_loop_nest(string func_name,
     return stmt;
 }
 
+// A loop over the tiles of the output of an extern stage.
+struct ExternTileLoop {
+    string name;
+    Expr min, extent;
+    ForType for_type;
+};
+
+// Work out the region of the output of an extern stage computed by
+// each call to the extern function, and the loops over the tiles
+// (innermost first). Extern stages can only have their pure vars
+// split once each, with the outer vars serial, parallel or
+// unrolled. Unsplit vars that aren't serial get one call per
+// coordinate.
+void compute_extern_tiles(Function f,
+                          vector<Expr> &mins, vector<Expr> &extents,
+                          vector<ExternTileLoop> &loops) {
+    const StageSchedule &s = f.definition().schedule();
+    const string prefix = f.name() + ".s0.";
+    const vector<string> f_args = f.args();
+
+    // The split of each pure var, and the inner vars of the splits.
+    map<string, Split> splits;
+    set<string> inner_vars;
+    for (const Split &split : s.splits()) {
+        user_assert(split.is_split())
+            << "In schedule for extern Func " << f.name() << ":\n"
+            << "The pure vars of extern Funcs may be split, but not renamed or fused.\n";
+        user_assert(std::find(f_args.begin(), f_args.end(), split.old_var) != f_args.end() &&
+                    !splits.count(split.old_var))
+            << "In schedule for extern Func " << f.name() << ":\n"
+            << "Can't split " << split.old_var << ". Each pure var of an extern "
+            << "Func may only be split once.\n";
+        splits[split.old_var] = split;
+        inner_vars.insert(split.inner);
+    }
+    for (const auto &p : splits) {
+        user_assert(!splits.count(p.second.outer) || p.second.outer == p.first)
+            << "In schedule for extern Func " << f.name() << ":\n"
+            << "The outer var of a split of an extern Func may not be split again.\n";
+    }
+
+    map<string, Expr> tile_min, tile_extent;
+    for (const Dim &d : s.dims()) {
+        if (d.var == Var::outermost().name()) {
+            continue;
+        }
+        user_assert(d.device_api == DeviceAPI::None || d.device_api == DeviceAPI::Host)
+            << "In schedule for extern Func " << f.name() << ":\n"
+            << "Extern Funcs can't have their loops mapped to a device.\n";
+        user_assert(d.for_type == ForType::Serial ||
+                    d.for_type == ForType::Parallel ||
+                    d.for_type == ForType::Unrolled)
+            << "In schedule for extern Func " << f.name() << ":\n"
+            << "The loops over an extern Func may only be serial, parallel, or unrolled.\n";
+
+        if (inner_vars.count(d.var)) {
+            user_assert(d.for_type == ForType::Serial)
+                << "In schedule for extern Func " << f.name() << ":\n"
+                << "The inner var " << d.var << " of a split of an extern Func "
+                << "covers the region passed to one call, so it can't be "
+                << d.for_type << ".\n";
+            continue;
+        }
+
+        string old_var = d.var;
+        Expr factor;
+        for (const auto &p : splits) {
+            if (p.second.outer == d.var) {
+                old_var = p.first;
+                factor = p.second.factor;
+            }
+        }
+        Expr min = Variable::make(Int(32), prefix + old_var + ".min");
+        Expr max = Variable::make(Int(32), prefix + old_var + ".max");
+        Expr loop_var = Variable::make(Int(32), prefix + d.var);
+        if (factor.defined()) {
+            // Shift the last tile inwards so that the calls never
+            // compute outside the region required.
+            Expr base = min + loop_var * factor;
+            base = Max::make(Min::make(base, max - factor + 1), min);
+            tile_min[old_var] = base;
+            tile_extent[old_var] = Min::make(factor, max - min + 1);
+            loops.push_back({prefix + d.var, 0, (max - min + factor) / factor, d.for_type});
+        } else if (d.for_type != ForType::Serial) {
+            tile_min[old_var] = loop_var;
+            tile_extent[old_var] = 1;
+            loops.push_back({prefix + d.var, min, max - min + 1, d.for_type});
+        }
+    }
+
+    for (const string &arg : f_args) {
+        if (tile_min.count(arg)) {
+            mins.push_back(tile_min[arg]);
+            extents.push_back(tile_extent[arg]);
+        } else {
+            Expr min = Variable::make(Int(32), prefix + arg + ".min");
+            Expr max = Variable::make(Int(32), prefix + arg + ".max");
+            mins.push_back(min);
+            extents.push_back(max - min + 1);
+        }
+    }
+}
+
 // Turn a function into a loop nest that computes it. It will
 // refer to external vars of the form function_name.arg_name.min
 // and function_name.arg_name.extent to define the bounds over
@@ -431,13 +565,20 @@ Stmt build_produce(Function f, const Target &target) {
             }
         }
 
+        // The region of the output computed by each call.
+        vector<Expr> output_mins, output_extents;
+        vector<ExternTileLoop> tile_loops;
+        compute_extern_tiles(f, output_mins, output_extents, tile_loops);
+
         // Grab the halide_buffer_t's representing the output. If the
-        // store level matches the compute level, then we can use the
-        // ones already injected by allocation bounds inference. If
-        // it's the output to the pipeline then it will similarly be
-        // in the symbol table.
+        // store level matches the compute level, and each call
+        // computes the whole region, then we can use the ones
+        // already injected by allocation bounds inference. If it's
+        // the output to the pipeline then it will similarly be in the
+        // symbol table.
         vector<pair<Expr, Expr>> cropped_buffers;
-        if (f.schedule().store_level() == f.schedule().compute_level()) {
+        if (f.schedule().store_level() == f.schedule().compute_level() &&
+            tile_loops.empty()) {
             for (int j = 0; j < f.outputs(); j++) {
                 string buf_name = f.name();
                 if (f.outputs() > 1) {
@@ -451,10 +592,9 @@ Stmt build_produce(Function f, const Target &target) {
                 buffers_to_annotate.push_back({buffer, f.dimensions()});
             }
         } else {
-            // Store level doesn't match compute level. Make an output
-            // buffer just for this subregion.
-            string stage_name = f.name() + ".s0.";
-            const vector<string> f_args = f.args();
+            // Store level doesn't match compute level, or the output
+            // is computed in tiles. Make an output buffer just for
+            // this subregion.
             for (int j = 0; j < f.outputs(); j++) {
                 string src_buf_name = f.name();
                 if (f.outputs() > 1) {
@@ -473,17 +613,9 @@ Stmt build_produce(Function f, const Target &target) {
                                      {(int)sizeof(halide_dimension_t) * f.dimensions()}, Call::Intrinsic);
                 args[2] = src_buffer;
 
-                vector<Expr> mins, extents;
-                internal_assert(f.dimensions() == (int)f.args().size());
-                for (const string arg : f.args()) {
-                    string var = stage_name + arg;
-                    Expr min = Variable::make(Int(32), var + ".min");
-                    Expr max = Variable::make(Int(32), var + ".max");
-                    mins.push_back(min);
-                    extents.push_back(max - min + 1);
-                }
-                args[3] = Call::make(Handle(), Call::make_struct, mins, Call::Intrinsic);
-                args[4] = Call::make(Handle(), Call::make_struct, extents, Call::Intrinsic);
+                internal_assert(f.dimensions() == (int)output_mins.size());
+                args[3] = Call::make(Handle(), Call::make_struct, output_mins, Call::Intrinsic);
+                args[4] = Call::make(Handle(), Call::make_struct, output_extents, Call::Intrinsic);
 
                 output_buffer_t = Call::make(type_of<struct halide_buffer_t *>(), Call::buffer_crop, args, Call::Extern);
 
@@ -586,6 +718,12 @@ Stmt build_produce(Function f, const Target &target) {
             check = Block::make(annotate, check);
         }
 
+        // Add the loops over the tiles.
+        for (const ExternTileLoop &loop : tile_loops) {
+            check = For::make(loop.name, loop.min, loop.extent,
+                              loop.for_type, DeviceAPI::None, check);
+        }
+
         // Add the dummy outermost loop.
         string outermost = f.name() + ".s0." + Var::outermost().name();
         check = For::make(outermost, 0, 1, ForType::Serial, DeviceAPI::None, check);
@@ -595,12 +733,13 @@ Stmt build_produce(Function f, const Target &target) {
 
         string prefix = f.name() + ".s0.";
         vector<string> dims = f.args();
-        return build_provide_loop_nest(f.name(), prefix, dims, f.schedule(), f.definition(), false);
+        return build_provide_loop_nest(f.name(), prefix, dims, f.schedule(), f.definition(), false,
+                                       profile_branches(target));
     }
 }
 
 // Build the loop nests that update a function (assuming it's a reduction).
-vector<Stmt> build_update(Function f) {
+vector<Stmt> build_update(Function f, const Target &target) {
 
     vector<Stmt> updates;
 
@@ -610,7 +749,8 @@ vector<Stmt> build_update(Function f) {
         string prefix = f.name() + ".s" + std::to_string(i+1) + ".";
 
         vector<string> dims = f.args();
-        Stmt loop = build_provide_loop_nest(f.name(), prefix, dims, f.schedule(), def, true);
+        Stmt loop = build_provide_loop_nest(f.name(), prefix, dims, f.schedule(), def, true,
+                                            profile_branches(target));
         updates.push_back(loop);
     }
 
@@ -619,7 +759,7 @@ vector<Stmt> build_update(Function f) {
 
 pair<Stmt, Stmt> build_production(Function func, const Target &target) {
     Stmt produce = build_produce(func, target);
-    vector<Stmt> updates = build_update(func);
+    vector<Stmt> updates = build_update(func, target);
 
     // Combine the update steps
     Stmt merged_updates = Block::make(updates);
@@ -1283,6 +1423,13 @@ Stmt schedule_functions(const vector<Function> &outputs,
             s = injector.mutate(s);
             internal_assert(injector.found_store_level && injector.found_compute_level);
         }
+
+        // Funcs computed with each other are next to each other in
+        // the realization order. Merge their loop nests as soon as
+        // both are in, so that the Funcs computed within the fused
+        // loops are injected once for both of them.
+        s = fuse_loops(s, f, env);
+
         any_memoized = any_memoized || f.schedule().memoized();
         debug(2) << s << '\n';
     }
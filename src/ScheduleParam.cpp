@@ -1,9 +1,23 @@
 #include "ScheduleParam.h"
 #include "ObjectInstanceRegistry.h"
 
+#include <atomic>
+
 namespace Halide {
 namespace Internal {
 
+namespace {
+std::atomic<uint64_t> schedule_param_generation(0);
+}
+
+uint64_t ScheduleParamBase::generation() {
+    return schedule_param_generation;
+}
+
+void ScheduleParamBase::value_changed() {
+    schedule_param_generation++;
+}
+
 ScheduleParamBase::ScheduleParamBase(const Type &t, const std::string &name, bool is_explicit_name)
     : sp_name(name),
       type(t),
@@ -66,6 +66,12 @@ public:
 
 #undef HALIDE_SCHEDULE_PARAM_TYPED_SETTER
 
+    /** A count of the times any ScheduleParam has been set. Lowering
+     * bakes in the values of the ScheduleParams, so jit-compiled
+     * Pipelines check this to see if they may need to be compiled
+     * again. */
+    EXPORT static uint64_t generation();
+
 protected:
     friend class GeneratorBase;
 
@@ -76,6 +82,8 @@ protected:
     LoopLevel loop_level;
 
     EXPORT ScheduleParamBase(const Type &t, const std::string &name, bool is_explicit_name);
+
+    EXPORT static void value_changed();
     EXPORT virtual ~ScheduleParamBase();
 
     // This is provided only for GeneratorBase; other code should not need to use it.
@@ -135,12 +143,14 @@ class ScheduleParam : public Internal::ScheduleParamBase {
             }
         }
         scalar_parameter.set_scalar<T>(Convert<T2, T>::value(value));
+        value_changed();
     }
 
     template <typename T2, typename std::enable_if<std::is_same<T2, LoopLevel>::value>::type * = nullptr>
     HALIDE_ALWAYS_INLINE void typed_setter_impl(const LoopLevel &value, const char *msg) {
         user_assert(is_looplevel_param()) << "Only ScheduleParam<LoopLevel> can be set withLoopLevel.";
         loop_level.copy_from(value);
+        value_changed();
     }
 
     template <typename T2, typename std::enable_if<!std::is_convertible<T2, T>::value>::type * = nullptr>
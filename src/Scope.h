@@ -4,6 +4,7 @@
 #include <string>
 #include <map>
 #include <stack>
+#include <unordered_map>
 #include <utility>
 #include <iostream>
 
@@ -73,7 +74,12 @@ public:
 template<typename T>
 class Scope {
 private:
-    std::map<std::string, SmallStack<T>> table;
+    // Scopes are looked up far more often than they are iterated
+    // over, and are often large (e.g. all the bounds of all the
+    // Funcs in a pipeline), so they are hash tables. Iteration order
+    // is unspecified.
+    typedef std::unordered_map<std::string, SmallStack<T>> Table;
+    Table table;
 
     // Copying a scope object copies a large table full of strings and
     // stacks. Bad idea.
@@ -103,7 +109,7 @@ public:
 
     /** Retrieve the value referred to by a name */
     T get(const std::string &name) const {
-        typename std::map<std::string, SmallStack<T>>::const_iterator iter = table.find(name);
+        typename Table::const_iterator iter = table.find(name);
         if (iter == table.end() || iter->second.empty()) {
             if (containing_scope) {
                 return containing_scope->get(name);
@@ -116,7 +122,7 @@ public:
 
     /** Return a reference to an entry. Does not consider the containing scope. */
     T &ref(const std::string &name) {
-        typename std::map<std::string, SmallStack<T>>::iterator iter = table.find(name);
+        typename Table::iterator iter = table.find(name);
         if (iter == table.end() || iter->second.empty()) {
             internal_error << "Symbol '" << name << "' not found\n";
         }
@@ -125,7 +131,7 @@ public:
 
     /** Tests if a name is in scope */
     bool contains(const std::string &name) const {
-        typename std::map<std::string, SmallStack<T>>::const_iterator iter = table.find(name);
+        typename Table::const_iterator iter = table.find(name);
         if (iter == table.end() || iter->second.empty()) {
             if (containing_scope) {
                 return containing_scope->contains(name);
@@ -147,7 +153,7 @@ public:
      * was (or remove it entirely if there was nothing else of the
      * same name in an outer scope) */
     void pop(const std::string &name) {
-        typename std::map<std::string, SmallStack<T>>::iterator iter = table.find(name);
+        typename Table::iterator iter = table.find(name);
         internal_assert(iter != table.end()) << "Name not in symbol table: " << name << "\n";
         iter->second.pop();
         if (iter->second.empty()) {
@@ -157,9 +163,9 @@ public:
 
     /** Iterate through the scope. Does not capture any containing scope. */
     class const_iterator {
-        typename std::map<std::string, SmallStack<T>>::const_iterator iter;
+        typename Table::const_iterator iter;
     public:
-        explicit const_iterator(const typename std::map<std::string, SmallStack<T>>::const_iterator &i) :
+        explicit const_iterator(const typename Table::const_iterator &i) :
             iter(i) {
         }
 
@@ -195,9 +201,9 @@ public:
     }
 
     class iterator {
-        typename std::map<std::string, SmallStack<T>>::iterator iter;
+        typename Table::iterator iter;
     public:
-        explicit iterator(typename std::map<std::string, SmallStack<T>>::iterator i) :
+        explicit iterator(typename Table::iterator i) :
             iter(i) {
         }
 
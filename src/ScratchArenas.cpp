@@ -0,0 +1,107 @@
+#include "ScratchArenas.h"
+#include "CodeGen_Internal.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+#include "Simplify.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::string;
+
+namespace {
+
+class UseScratchArenas : public IRMutator {
+    using IRMutator::visit;
+
+    // The arena of the task of the innermost enclosing parallel loop,
+    // and whether anything has used it yet.
+    string arena;
+    bool arena_used = false;
+
+    void visit(const For *op) {
+        if (op->device_api != DeviceAPI::None &&
+            op->device_api != DeviceAPI::Host) {
+            // Don't touch allocations that belong to other devices.
+            stmt = op;
+            return;
+        }
+        if (op->for_type != ForType::Parallel) {
+            IRMutator::visit(op);
+            return;
+        }
+
+        string old_arena = arena;
+        bool old_arena_used = arena_used;
+        arena = op->name + ".scratch_arena";
+        arena_used = false;
+        Stmt body = mutate(op->body);
+        bool used = arena_used;
+        string task_arena = arena;
+        arena = old_arena;
+        arena_used = old_arena_used;
+
+        if (!used) {
+            if (body.same_as(op->body)) {
+                stmt = op;
+            } else {
+                stmt = For::make(op->name, op->min, op->extent, op->for_type, op->device_api, body);
+            }
+            return;
+        }
+
+        // Each task takes an arena from a set made for this run of
+        // the loop. The destructors give the arena back, and free the
+        // set, on error paths as well.
+        string arenas = op->name + ".scratch_arenas";
+        Expr acquire = Call::make(Handle(), "halide_scratch_arena_acquire",
+                                  {Variable::make(Handle(), arenas)}, Call::Extern);
+        body = Allocate::make(task_arena, UInt(8), {}, const_true(), body,
+                              acquire, "halide_scratch_arena_release");
+        stmt = For::make(op->name, op->min, op->extent, op->for_type, op->device_api, body);
+        Expr create = Call::make(Handle(), "halide_scratch_arenas_create", {}, Call::Extern);
+        stmt = Allocate::make(arenas, UInt(8), {}, const_true(), stmt,
+                              create, "halide_scratch_arenas_destroy");
+    }
+
+    void visit(const Allocate *op) {
+        if (arena.empty() || op->new_expr.defined() || op->extents.empty()) {
+            IRMutator::visit(op);
+            return;
+        }
+        int64_t constant_bytes = (int64_t)op->constant_allocation_size() * op->type.bytes();
+        if (constant_bytes > 0 && can_allocation_fit_on_stack(constant_bytes)) {
+            // This is going on the stack anyway.
+            IRMutator::visit(op);
+            return;
+        }
+
+        Stmt body = mutate(op->body);
+
+        Expr bytes = make_const(Int(64), op->type.bytes());
+        for (Expr e : op->extents) {
+            bytes *= cast<int64_t>(e);
+        }
+        // Pad the end the same way a heap allocation would be, as
+        // vector code may read one scalar past it.
+        bytes += op->type.bytes();
+        if (!is_one(op->condition)) {
+            bytes = select(op->condition, bytes, make_zero(Int(64)));
+        }
+        Expr alloc = Call::make(Handle(), "halide_scratch_arena_alloc",
+                                {Variable::make(Handle(), arena), cast<uint64_t>(simplify(bytes))},
+                                Call::Extern);
+        arena_used = true;
+        stmt = Allocate::make(op->name, op->type, op->extents, op->condition, body,
+                              alloc, "halide_scratch_arena_free");
+    }
+};
+
+}  // namespace
+
+Stmt use_scratch_arenas(Stmt s) {
+    return UseScratchArenas().mutate(s);
+}
+
+}
+}
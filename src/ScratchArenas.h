@@ -0,0 +1,26 @@
+#ifndef HALIDE_SCRATCH_ARENAS_H
+#define HALIDE_SCRATCH_ARENAS_H
+
+/** \file
+ * Defines the lowering pass that serves heap allocations inside
+ * parallel loops from per-task scratch arenas.
+ */
+
+#include "IR.h"
+
+namespace Halide {
+namespace Internal {
+
+/** Make the heap allocations within the body of each parallel loop
+ * come from a scratch arena that the task takes when it starts and
+ * gives back when it finishes. The arenas keep their memory between
+ * tasks, so a loop whose body allocates calls halide_malloc about once
+ * per thread rather than once per buffer per iteration. Allocations
+ * small enough for the stack, allocations with a custom new_expr, and
+ * allocations belonging to other devices are left alone. */
+Stmt use_scratch_arenas(Stmt s);
+
+}
+}
+
+#endif
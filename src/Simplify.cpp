@@ -1,7 +1,11 @@
 #include <iostream>
 #include <algorithm>
+#include <chrono>
 #include <cmath>
 #include <limits>
+#include <mutex>
+#include <set>
+#include <unordered_map>
 #include <stdio.h>
 
 #include "Simplify.h"
@@ -36,6 +40,25 @@ using std::vector;
 
 namespace {
 
+// The number of nodes the outermost call to simplify on a thread may
+// visit before giving up on simplifying the rest, set by
+// HL_SIMPLIFY_BUDGET. Zero means no limit.
+int64_t simplify_budget() {
+    static int64_t budget = std::max(0LL, atoll(get_env_variable("HL_SIMPLIFY_BUDGET").c_str()));
+    return budget;
+}
+
+thread_local int64_t simplify_work = 0;
+thread_local bool simplify_budget_exceeded = false;
+
+bool over_simplify_budget() {
+    int64_t budget = simplify_budget();
+    if (budget && ++simplify_work > budget) {
+        simplify_budget_exceeded = true;
+    }
+    return simplify_budget_exceeded;
+}
+
 // Things that we can constant fold: Immediates and broadcasts of immediates.
 bool is_simple_const(const Expr &e) {
     if (e.as<IntImm>()) return true;
@@ -158,8 +181,11 @@ public:
 
     }
 
-#if LOG_EXPR_MUTATIONS
     Expr mutate(const Expr &e) {
+        if (over_simplify_budget() && !e.as<Variable>()) {
+            return Unsimplified(this).mutate(e);
+        }
+#if LOG_EXPR_MUTATIONS
         const std::string spaces(debug_indent, ' ');
         debug(1) << spaces << "Simplifying Expr: " << e << "\n";
         debug_indent++;
@@ -171,11 +197,16 @@ public:
                 << spaces << "After:  " << new_e << "\n";
         }
         return new_e;
-    }
+#else
+        return IRMutator::mutate(e);
 #endif
+    }
 
-#if LOG_STMT_MUTATIONS
     Stmt mutate(const Stmt &s) {
+        if (over_simplify_budget()) {
+            return Unsimplified(this).mutate(s);
+        }
+#if LOG_STMT_MUTATIONS
         const std::string spaces(debug_indent, ' ');
         debug(1) << spaces << "Simplifying Stmt: " << s << "\n";
         debug_indent++;
@@ -187,14 +218,53 @@ public:
                 << spaces << "After:  " << new_s << "\n";
         }
         return new_s;
-    }
+#else
+        return IRMutator::mutate(s);
 #endif
-    using IRMutator::mutate;
-
+    }
 
 private:
     bool simplify_lets;
 
+    // Once the budget is spent, the rest of the IR is rebuilt without
+    // being simplified. The variables in it still go through the
+    // simplifier, so that the lets being simplified around them see
+    // their uses.
+    class Unsimplified : public IRMutator {
+        Simplify *simplify;
+
+        using IRMutator::visit;
+
+        void visit(const Variable *op) {
+            expr = simplify->mutate(op);
+        }
+
+        void visit(const Load *op) {
+            simplify->found_buffer_reference(op->name);
+            IRMutator::visit(op);
+        }
+
+        void visit(const Store *op) {
+            simplify->found_buffer_reference(op->name);
+            IRMutator::visit(op);
+        }
+
+        void visit(const Call *op) {
+            if (op->call_type == Call::Image || op->call_type == Call::Halide) {
+                simplify->found_buffer_reference(op->name, op->args.size());
+            }
+            IRMutator::visit(op);
+        }
+
+        void visit(const Provide *op) {
+            simplify->found_buffer_reference(op->name, op->args.size());
+            IRMutator::visit(op);
+        }
+
+    public:
+        Unsimplified(Simplify *s) : simplify(s) {}
+    };
+
     struct VarInfo {
         Expr replacement;
         int old_uses, new_uses;
@@ -4830,6 +4900,51 @@ private:
         }
     }
 
+    void visit(const VectorReduce *op) {
+        Expr value = mutate(op->value);
+        int lanes = op->type.lanes();
+        int factor = value.type().lanes() / lanes;
+        if (factor == 1) {
+            expr = value;
+            return;
+        }
+
+        if (const Broadcast *b = value.as<Broadcast>()) {
+            // Reducing a broadcast combines equal values.
+            Expr v = b->value;
+            bool simplified = false;
+            switch (op->op) {
+            case VectorReduce::Add:
+                if (!v.type().is_float()) {
+                    v = mutate(v * make_const(v.type(), factor));
+                    simplified = true;
+                }
+                break;
+            case VectorReduce::Min:
+            case VectorReduce::Max:
+            case VectorReduce::And:
+            case VectorReduce::Or:
+                simplified = true;
+                break;
+            case VectorReduce::Mul:
+                break;
+            }
+            if (simplified) {
+                if (lanes > 1) {
+                    v = Broadcast::make(v, lanes);
+                }
+                expr = v;
+                return;
+            }
+        }
+
+        if (value.same_as(op->value)) {
+            expr = op;
+        } else {
+            expr = VectorReduce::make(op->op, value, lanes);
+        }
+    }
+
     template <typename T>
     Expr hoist_slice_vector(Expr e) {
         const T *op = e.as<T>();
@@ -5301,16 +5416,259 @@ private:
     }
 };
 
+namespace {
+
+thread_local bool simplify_timing = false;
+thread_local int simplify_depth = 0;
+thread_local SimplifyStats simplify_stats;
+
+// Accumulates the time spent in the outermost call to simplify on
+// this thread. The simplifier calls itself (e.g. via can_prove), and
+// those nested calls are already accounted for.
+class SimplifyTimer {
+    std::chrono::steady_clock::time_point start;
+    bool outermost;
+public:
+    SimplifyTimer() : outermost(simplify_depth++ == 0) {
+        if (outermost) {
+            simplify_stats.calls++;
+            simplify_work = 0;
+            simplify_budget_exceeded = false;
+            if (simplify_timing) {
+                start = std::chrono::steady_clock::now();
+            }
+        }
+    }
+
+    ~SimplifyTimer() {
+        simplify_depth--;
+        if (outermost && simplify_timing) {
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            simplify_stats.seconds += elapsed.count();
+        }
+    }
+};
+
+// Results of top-level calls to simplify without any bounds or
+// alignment information depend only on the input node and
+// simplify_lets, so they can be remembered. Both the input and the
+// output are recorded, so that simplifying the result of an earlier
+// call again (e.g. because no pass touched it since) is free. The
+// entries hold references to the nodes, so their addresses can't be
+// reused while they're in the cache.
+struct SimplifyCacheKey {
+    const IRNode *node;
+    bool simplify_lets;
+    bool operator==(const SimplifyCacheKey &other) const {
+        return node == other.node && simplify_lets == other.simplify_lets;
+    }
+};
+
+struct SimplifyCacheKeyHash {
+    size_t operator()(const SimplifyCacheKey &k) const {
+        return std::hash<const IRNode *>()(k.node) ^ (size_t)k.simplify_lets;
+    }
+};
+
+// Poison values are numbered so that distinct ones can't cancel
+// against each other. Handing out the same one twice would defeat
+// that, so results containing them are never cached.
+class ContainsPoison : public IRGraphVisitor {
+    using IRGraphVisitor::visit;
+    void visit(const Call *op) {
+        if (op->is_intrinsic(Call::signed_integer_overflow) ||
+            op->is_intrinsic(Call::indeterminate_expression)) {
+            result = true;
+        } else {
+            IRGraphVisitor::visit(op);
+        }
+    }
+public:
+    bool result = false;
+};
+
+}
+
+struct SimplifyCache {
+    template<typename T>
+    using Map = std::unordered_map<SimplifyCacheKey, std::pair<T, T>, SimplifyCacheKeyHash>;
+    Map<Expr> exprs;
+    Map<Stmt> stmts;
+
+    Map<Expr> &entries(const Expr &) {
+        return exprs;
+    }
+    Map<Stmt> &entries(const Stmt &) {
+        return stmts;
+    }
+
+    // Bound the memory held by the cache. When full, start over.
+    static const size_t max_entries = 1 << 16;
+};
+
+namespace {
+
+thread_local SimplifyCache *simplify_cache = nullptr;
+
+template<typename T>
+bool can_use_simplify_cache(const T &node,
+                            const Scope<Interval> &bounds,
+                            const Scope<ModulusRemainder> &alignment) {
+    return (simplify_cache && node.defined() &&
+            &bounds == &Scope<Interval>::empty_scope() &&
+            &alignment == &Scope<ModulusRemainder>::empty_scope());
+}
+
+template<typename T>
+bool find_in_simplify_cache(const T &node, bool simplify_lets, T *result) {
+    auto &entries = simplify_cache->entries(node);
+    auto it = entries.find({node.get(), simplify_lets});
+    if (it == entries.end()) {
+        return false;
+    }
+    simplify_stats.cache_hits++;
+    *result = it->second.second;
+    return true;
+}
+
+template<typename T>
+void add_to_simplify_cache(const T &node, bool simplify_lets, const T &result) {
+    if (simplify_budget_exceeded) {
+        // Only partially simplified.
+        return;
+    }
+    ContainsPoison poison;
+    result.accept(&poison);
+    if (poison.result) {
+        return;
+    }
+    auto &entries = simplify_cache->entries(node);
+    if (entries.size() >= SimplifyCache::max_entries) {
+        entries.clear();
+    }
+    // Only the input is recorded. The simplifier isn't idempotent, so
+    // the result isn't known to simplify to itself.
+    entries[{node.get(), simplify_lets}] = {node, result};
+}
+
+}
+
+ScopedSimplifyCache::ScopedSimplifyCache() : old_cache(simplify_cache) {
+    cache = new SimplifyCache;
+    simplify_cache = cache;
+}
+
+ScopedSimplifyCache::~ScopedSimplifyCache() {
+    simplify_cache = old_cache;
+    delete cache;
+}
+
+void set_simplify_timing(bool enabled) {
+    simplify_timing = enabled;
+}
+
+SimplifyStats get_simplify_stats() {
+    return simplify_stats;
+}
+
+namespace {
+
+// Find the Funcs and buffers some IR refers to, to say where the
+// simplifier ran out of budget.
+class FindFuncNames : public IRGraphVisitor {
+    using IRGraphVisitor::visit;
+
+    void visit(const Call *op) {
+        if (op->call_type == Call::Halide || op->call_type == Call::Image) {
+            names.insert(op->name);
+        }
+        IRGraphVisitor::visit(op);
+    }
+
+    void visit(const Provide *op) {
+        names.insert(op->name);
+        IRGraphVisitor::visit(op);
+    }
+
+    void visit(const Load *op) {
+        names.insert(op->name);
+        IRGraphVisitor::visit(op);
+    }
+
+    void visit(const Store *op) {
+        names.insert(op->name);
+        IRGraphVisitor::visit(op);
+    }
+
+    void visit(const For *op) {
+        names.insert(op->name.substr(0, op->name.find('.')));
+        IRGraphVisitor::visit(op);
+    }
+
+public:
+    std::set<string> names;
+};
+
+template<typename T>
+void report_simplify_budget_exceeded(const T &input) {
+    if (!simplify_budget_exceeded || simplify_depth != 1) {
+        return;
+    }
+    simplify_stats.budget_exceeded++;
+
+    FindFuncNames finder;
+    input.accept(&finder);
+    ostringstream names;
+    for (const string &n : finder.names) {
+        names << (names.tellp() ? ", " : "") << n;
+    }
+
+    // Report each set of Funcs once.
+    static std::mutex reported_mutex;
+    static std::set<string> reported;
+    std::lock_guard<std::mutex> lock(reported_mutex);
+    if (reported.insert(names.str()).second) {
+        user_warning << "The simplifier visited more than " << simplify_budget()
+                     << " nodes (HL_SIMPLIFY_BUDGET) while simplifying "
+                     << (finder.names.empty() ? string("an expression") : "IR involving " + names.str())
+                     << ", and left the rest unsimplified\n";
+    }
+}
+
+}
+
 Expr simplify(Expr e, bool simplify_lets,
               const Scope<Interval> &bounds,
               const Scope<ModulusRemainder> &alignment) {
-    return Simplify(simplify_lets, &bounds, &alignment).mutate(e);
+    SimplifyTimer timer;
+    Expr result;
+    if (can_use_simplify_cache(e, bounds, alignment)) {
+        if (!find_in_simplify_cache(e, simplify_lets, &result)) {
+            result = Simplify(simplify_lets, &bounds, &alignment).mutate(e);
+            add_to_simplify_cache(e, simplify_lets, result);
+        }
+    } else {
+        result = Simplify(simplify_lets, &bounds, &alignment).mutate(e);
+    }
+    report_simplify_budget_exceeded(e);
+    return result;
 }
 
 Stmt simplify(Stmt s, bool simplify_lets,
               const Scope<Interval> &bounds,
               const Scope<ModulusRemainder> &alignment) {
-    return Simplify(simplify_lets, &bounds, &alignment).mutate(s);
+    SimplifyTimer timer;
+    Stmt result;
+    if (can_use_simplify_cache(s, bounds, alignment)) {
+        if (!find_in_simplify_cache(s, simplify_lets, &result)) {
+            result = Simplify(simplify_lets, &bounds, &alignment).mutate(s);
+            add_to_simplify_cache(s, simplify_lets, result);
+        }
+    } else {
+        result = Simplify(simplify_lets, &bounds, &alignment).mutate(s);
+    }
+    report_simplify_budget_exceeded(s);
+    return result;
 }
 
 class SimplifyExprs : public IRMutator {
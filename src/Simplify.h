@@ -38,6 +38,41 @@ EXPORT bool can_prove(Expr e);
  * stage in lowering than full simplification of a stmt. */
 EXPORT Stmt simplify_exprs(Stmt);
 
+/** Cumulative work done by outermost calls to simplify (and hence
+ * can_prove) on the calling thread. Timing is only recorded while
+ * enabled with set_simplify_timing, so that it costs nothing when
+ * not profiling compilation. */
+struct SimplifyStats {
+    uint64_t calls = 0;
+    uint64_t cache_hits = 0;
+    // Calls that ran out of budget. See HL_SIMPLIFY_BUDGET.
+    uint64_t budget_exceeded = 0;
+    double seconds = 0;
+};
+
+/** Turn timing of the simplifier on the calling thread on or off. */
+EXPORT void set_simplify_timing(bool enabled);
+
+/** Get the simplifier statistics for the calling thread so far. */
+EXPORT SimplifyStats get_simplify_stats();
+
+struct SimplifyCache;
+
+/** While one of these is alive, calls to simplify on the calling
+ * thread that pass no bounds or alignment information remember their
+ * results, so simplifying the same node again is a lookup. The result
+ * of a call is not assumed to simplify to itself, as simplifying it
+ * again can simplify it further. lower() uses one, because it
+ * repeatedly simplifies IR that earlier passes left untouched. */
+class ScopedSimplifyCache {
+    SimplifyCache *cache, *old_cache;
+public:
+    EXPORT ScopedSimplifyCache();
+    EXPORT ~ScopedSimplifyCache();
+    ScopedSimplifyCache(const ScopedSimplifyCache &) = delete;
+    ScopedSimplifyCache &operator=(const ScopedSimplifyCache &) = delete;
+};
+
 /** Implementations of division and mod that are specific to Halide.
  * Use these implementations; do not use native C division or mod to
  * simplify Halide expressions. Halide division and modulo satisify
@@ -5,6 +5,8 @@
 #include "Substitute.h"
 #include "Definition.h"
 #include "IREquality.h"
+#include "Function.h"
+#include "Buffer.h"
 
 #include <set>
 
@@ -149,9 +151,80 @@ vector<Definition> propagate_specialization_in_definition(Definition &def, const
     return result;
 }
 
+// Replace the Params and image fields in an expression with their
+// current values.
+class SubstituteParamValues : public IRMutator {
+    using IRMutator::visit;
+
+    void visit(const Variable *op) {
+        Buffer<> buf;
+        string buf_name;
+        if (op->param.defined() && !op->param.is_buffer()) {
+            if (op->param.type() == op->type && !op->type.is_handle()) {
+                expr = op->param.get_scalar_expr();
+                return;
+            }
+        } else if (op->param.defined()) {
+            buf = op->param.get_buffer();
+            buf_name = op->param.name();
+        } else if (op->image.defined()) {
+            buf = op->image;
+            buf_name = op->image.name();
+        }
+
+        if (buf.defined() && starts_with(op->name, buf_name + ".")) {
+            // Buffer fields are named <buffer>.<field>.<dimension>
+            string field = op->name.substr(buf_name.size() + 1);
+            for (int i = 0; i < buf.dimensions(); i++) {
+                string d = "." + std::to_string(i);
+                if (field == "min" + d) {
+                    expr = buf.dim(i).min();
+                    return;
+                } else if (field == "extent" + d) {
+                    expr = buf.dim(i).extent();
+                    return;
+                } else if (field == "stride" + d) {
+                    expr = buf.dim(i).stride();
+                    return;
+                }
+            }
+        }
+
+        expr = op;
+    }
+};
+
+void evaluate_specializations_in_definition(Definition def, bool bind, string &result) {
+    for (Specialization &s : def.specializations()) {
+        Expr c = simplify(SubstituteParamValues().mutate(s.condition));
+        if (is_one(c)) {
+            result += '1';
+        } else if (is_zero(c)) {
+            result += '0';
+        } else {
+            result += '?';
+        }
+        if (bind && is_const(c)) {
+            s.condition = c;
+        }
+        evaluate_specializations_in_definition(s.definition, bind, result);
+    }
 }
 
+}
 
+string evaluate_specializations(map<string, Function> &env, bool bind) {
+    string result;
+    for (auto &iter : env) {
+        Function &func = iter.second;
+        evaluate_specializations_in_definition(func.definition(), bind, result);
+        for (size_t i = 0; i < func.updates().size(); i++) {
+            evaluate_specializations_in_definition(func.update(i), bind, result);
+        }
+        result += ';';
+    }
+    return result;
+}
 
 void simplify_specializations(map<string, Function> &env) {
     for (auto &iter : env) {
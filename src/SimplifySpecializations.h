@@ -18,6 +18,15 @@ namespace Internal {
  * specializations. */
 EXPORT void simplify_specializations(std::map<std::string, Function> &env);
 
+/** Evaluate the conditions of all the specializations in an
+ * environment using the current values of the Params and images they
+ * refer to. Returns a string with a character per specialization,
+ * which is '1' or '0' if its condition could be evaluated, and '?'
+ * otherwise. If bind is true, the conditions that could be evaluated
+ * are replaced with their values, so that simplify_specializations
+ * prunes the branches that won't be taken. */
+EXPORT std::string evaluate_specializations(std::map<std::string, Function> &env, bool bind);
+
 }
 }
 
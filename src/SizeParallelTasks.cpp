@@ -0,0 +1,189 @@
+#include <memory>
+
+#include "SizeParallelTasks.h"
+#include "ExprUsesVar.h"
+#include "Function.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+#include "RegionCosts.h"
+#include "Simplify.h"
+#include "Debug.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::set;
+using std::string;
+using std::vector;
+
+namespace {
+
+// A parallel loop whose tasks are sized at runtime.
+struct AutoTaskSizeLoop {
+    Function func;
+    int stage;
+    int min_task_size, max_task_size;
+};
+
+// Find the number of points of a stage one iteration of a loop
+// computes, from the loops of the same stage inside it whose extents
+// don't depend on the iteration.
+class CountPoints : public IRVisitor {
+    const string &prefix;
+    const string &func;
+
+    using IRVisitor::visit;
+
+    // The variables defined inside the loop.
+    Scope<int> inner;
+
+    void combine(Expr p) {
+        points = points.defined() ? max(points, p) : p;
+    }
+
+    void visit(const LetStmt *op) {
+        op->value.accept(this);
+        inner.push(op->name, 0);
+        op->body.accept(this);
+        inner.pop(op->name);
+    }
+
+    void visit(const For *op) {
+        Expr old_points = points;
+        points = Expr();
+        inner.push(op->name, 0);
+        op->body.accept(this);
+        inner.pop(op->name);
+        if (points.defined() &&
+            starts_with(op->name, prefix) &&
+            op->for_type != ForType::Vectorized &&
+            !expr_uses_vars(op->extent, inner)) {
+            points *= op->extent;
+        }
+        Expr p = points;
+        points = old_points;
+        if (p.defined()) {
+            combine(p);
+        }
+    }
+
+    void visit(const Store *op) {
+        if (op->name == func || starts_with(op->name, func + ".")) {
+            combine(1);
+        }
+    }
+
+public:
+    Expr points;
+
+    CountPoints(const string &prefix, const string &func) : prefix(prefix), func(func) {}
+};
+
+class SizeParallelTasks : public IRMutator {
+    const map<string, AutoTaskSizeLoop> &loops;
+    const map<string, Function> &env;
+    const string &pipeline_name;
+
+    using IRMutator::visit;
+
+    // Only built if there is a loop to size.
+    std::unique_ptr<RegionCosts> costs;
+    set<string> inlines;
+
+    // The estimated cost in nanoseconds of one iteration of a loop
+    // over the given stage, or zero if it can't be estimated.
+    Expr iteration_cost(const AutoTaskSizeLoop &loop, Stmt body) {
+        if (!costs) {
+            costs.reset(new RegionCosts(env));
+        }
+        Cost cost = costs->get_func_stage_cost(loop.func, loop.stage, inlines);
+        if (!cost.defined()) {
+            return make_zero(Int(64));
+        }
+
+        string prefix = loop.func.name() + ".s" + std::to_string(loop.stage) + ".";
+        CountPoints counter(prefix, loop.func.name());
+        body.accept(&counter);
+        Expr points = counter.points.defined() ? counter.points : 1;
+
+        // The costs count arithmetic operations and bytes loaded or
+        // stored. Assume a few of them run per nanosecond.
+        Expr ops = cast(Int(64), cost.arith + cost.memory) * cast(Int(64), points);
+        return simplify(ops / 4);
+    }
+
+    void visit(const For *op) {
+        auto iter = loops.find(op->name);
+        if (iter == loops.end() || op->for_type != ForType::Parallel) {
+            IRMutator::visit(op);
+            return;
+        }
+        const AutoTaskSizeLoop &loop = iter->second;
+        Stmt body = mutate(op->body);
+
+        debug(3) << "Sizing the tasks of the parallel loop " << op->name << " at runtime\n";
+
+        Expr key = StringImm::make(pipeline_name + "." + op->name);
+        Expr extent = Variable::make(Int(32), op->name + ".auto_extent");
+        Expr task_size = Variable::make(Int(32), op->name + ".task_size");
+        Expr start_time = Variable::make(Int(64), op->name + ".start_time");
+        Expr task = Variable::make(Int(32), op->name + ".task");
+
+        Stmt chunk = For::make(op->name, op->min + task * task_size,
+                               min(task_size, extent - task * task_size),
+                               ForType::Serial, op->device_api, body);
+        Stmt tasks = For::make(task.as<Variable>()->name, 0, (extent + task_size - 1) / task_size,
+                               ForType::Parallel, op->device_api, chunk);
+
+        Expr feedback = Call::make(Int(32), "halide_parallel_task_size_feedback",
+                                   {key, extent, task_size, start_time}, Call::Extern);
+        stmt = Block::make(tasks, Evaluate::make(feedback));
+
+        Expr now = Call::make(Int(64), "halide_current_time_ns", {}, Call::Extern);
+        stmt = LetStmt::make(start_time.as<Variable>()->name, now, stmt);
+        Expr size = Call::make(Int(32), "halide_parallel_task_size",
+                               {key, extent, iteration_cost(loop, body),
+                                loop.min_task_size, loop.max_task_size},
+                               Call::Extern);
+        stmt = LetStmt::make(task_size.as<Variable>()->name, size, stmt);
+        stmt = LetStmt::make(extent.as<Variable>()->name, op->extent, stmt);
+    }
+
+public:
+    SizeParallelTasks(const map<string, AutoTaskSizeLoop> &loops,
+                      const map<string, Function> &env,
+                      const string &pipeline_name)
+        : loops(loops), env(env), pipeline_name(pipeline_name) {
+        for (const auto &p : env) {
+            if (p.second.schedule().compute_level().is_inline()) {
+                inlines.insert(p.first);
+            }
+        }
+    }
+};
+
+}  // namespace
+
+Stmt size_parallel_tasks(Stmt s, const map<string, Function> &env,
+                         const string &pipeline_name) {
+    map<string, AutoTaskSizeLoop> loops;
+    for (const auto &p : env) {
+        const Function &f = p.second;
+        if (f.has_extern_definition()) continue;
+        for (int stage = 0; stage <= (int)f.updates().size(); stage++) {
+            const Definition &def = stage == 0 ? f.definition() : f.update(stage - 1);
+            const StageSchedule &sched = def.schedule();
+            if (sched.auto_task_size_var().empty()) continue;
+            string name = f.name() + ".s" + std::to_string(stage) + "." + sched.auto_task_size_var();
+            loops[name] = {f, stage, sched.min_task_size(), sched.max_task_size()};
+        }
+    }
+    if (loops.empty()) {
+        return s;
+    }
+    return SizeParallelTasks(loops, env, pipeline_name).mutate(s);
+}
+
+}
+}
@@ -0,0 +1,30 @@
+#ifndef HALIDE_SIZE_PARALLEL_TASKS_H
+#define HALIDE_SIZE_PARALLEL_TASKS_H
+
+/** \file
+ *
+ * Defines the lowering pass that groups the iterations of parallel
+ * loops scheduled with TaskSize::Auto into tasks sized at runtime.
+ */
+
+#include <map>
+
+#include "IR.h"
+
+namespace Halide {
+namespace Internal {
+
+/** Rewrite each parallel loop scheduled with TaskSize::Auto as a
+ * parallel loop over tasks, each of which runs a serial loop over a
+ * chunk of the original iterations. The number of iterations per
+ * task comes from halide_parallel_task_size, given an estimate of the
+ * cost of an iteration, and the time the loop takes is passed back to
+ * the runtime afterwards. Should be called after storage flattening,
+ * and before loops are vectorized or unrolled. */
+Stmt size_parallel_tasks(Stmt s, const std::map<std::string, Function> &env,
+                         const std::string &pipeline_name);
+
+}
+}
+
+#endif
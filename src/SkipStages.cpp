@@ -303,13 +303,18 @@ private:
 
 class StageSkipper : public IRMutator {
 public:
-    StageSkipper(const string &f) : func(f), in_vector_loop(false) {}
+    StageSkipper(const string &f, Expr c) : func(f), condition(c), in_vector_loop(false), found(false) {}
+    bool found_realization() const {return found;}
 private:
     string func;
+    // An extra condition that must hold for the stage to be
+    // computed. Undefined if there isn't one.
+    Expr condition;
     using IRMutator::visit;
 
     Scope<int> vector_vars;
     bool in_vector_loop;
+    bool found;
 
     void visit(const For *op) {
         bool old_in_vector_loop = in_vector_loop;
@@ -346,6 +351,7 @@ private:
 
     void visit(const Realize *op) {
         if (op->name == func) {
+            found = true;
             debug(3) << "Finding compute predicate for " << op->name << "\n";
             PredicateFinder find_compute(op->name, true);
             op->body.accept(&find_compute);
@@ -363,6 +369,12 @@ private:
                 compute_predicate = const_true();
             }
 
+            if (condition.defined()) {
+                compute_predicate = simplify(compute_predicate && condition);
+                debug(3) << "Compute predicate for " << op->name
+                         << " including compute_if condition: " << compute_predicate << "\n";
+            }
+
             if (!is_one(compute_predicate)) {
 
                 debug(3) << "Finding allocate predicate for " << op->name << "\n";
@@ -455,17 +467,30 @@ public:
     MightBeSkippable(string f) : func(f), guarded(false), result(false) {}
 };
 
-Stmt skip_stages(Stmt stmt, const vector<string> &order) {
+Stmt skip_stages(Stmt stmt, const vector<string> &order, const map<string, Function> &env) {
     // Don't consider the last stage, because it's the output, so it's
     // never skippable.
+    auto last = env.find(order.back());
+    user_assert(last == env.end() || !last->second.schedule().compute_if().defined())
+        << "Func " << order.back() << " is scheduled with compute_if, but is an "
+        << "output of the pipeline, so it is always computed.\n";
     for (size_t i = order.size()-1; i > 0; i--) {
         debug(2) << "skip_stages checking " << order[i-1] << "\n";
+        Expr condition;
+        auto it = env.find(order[i-1]);
+        if (it != env.end()) {
+            condition = it->second.schedule().compute_if();
+        }
         MightBeSkippable check(order[i-1]);
         stmt.accept(&check);
-        if (check.result) {
+        if (check.result || condition.defined()) {
             debug(2) << "skip_stages can skip " << order[i-1] << "\n";
-            StageSkipper skipper(order[i-1]);
+            StageSkipper skipper(order[i-1], condition);
             stmt = skipper.mutate(stmt);
+            user_assert(!condition.defined() || skipper.found_realization())
+                << "Func " << order[i-1] << " is scheduled with compute_if, "
+                << "but is not realized. compute_if can't be used on inlined Funcs "
+                << "or on the outputs of a pipeline.\n";
         }
     }
     return stmt;
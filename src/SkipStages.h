@@ -1,7 +1,10 @@
 #ifndef HALIDE_SKIP_STAGES
 #define HALIDE_SKIP_STAGES
 
+#include <map>
+
 #include "IR.h"
+#include "Function.h"
 
 /** \file
  * Defines a pass that dynamically avoids realizing unnecessary stages.
@@ -14,8 +17,10 @@ namespace Internal {
  * to check that tells us they won't be used. Does this by analyzing
  * all reads of each buffer allocated, and inferring some condition
  * that tells us if the reads occur. If the condition is non-trivial,
- * inject ifs that guard the production. */
-Stmt skip_stages(Stmt s, const std::vector<std::string> &order);
+ * inject ifs that guard the production. Funcs scheduled with
+ * compute_if are also guarded by their condition. */
+Stmt skip_stages(Stmt s, const std::vector<std::string> &order,
+                 const std::map<std::string, Function> &env);
 
 }
 }
@@ -14,6 +14,7 @@ namespace Internal {
 
 using std::string;
 using std::map;
+using std::set;
 
 namespace {
 
@@ -362,10 +363,109 @@ public:
     SlidingWindowOnFunction(Function f) : func(f) {}
 };
 
+// Split the outermost parallel loop within a realization that
+// contains the production of the function into tasks, each of which
+// runs a serial chunk of the loop, and move the realization inside
+// the tasks, so that each has its own storage to slide over.
+class SplitIntoTasks : public IRMutator {
+    const Realize *realize;
+    Expr task_size;
+
+    class FindProducer : public IRVisitor {
+        using IRVisitor::visit;
+
+        void visit(const ProducerConsumer *op) {
+            if (op->is_producer && op->name == func) {
+                found = true;
+            } else {
+                IRVisitor::visit(op);
+            }
+        }
+
+    public:
+        const string &func;
+        bool found = false;
+        FindProducer(const string &func) : func(func) {}
+    };
+
+    using IRMutator::visit;
+
+    void visit(const For *op) {
+        if (found || op->for_type != ForType::Parallel) {
+            IRMutator::visit(op);
+            return;
+        }
+
+        FindProducer producer(realize->name);
+        op->body.accept(&producer);
+        if (!producer.found) {
+            stmt = op;
+            return;
+        }
+
+        debug(3) << "Splitting " << op->name << " into tasks of " << task_size
+                 << " iterations to slide " << realize->name << " within\n";
+
+        string task_name = op->name + ".task";
+        Expr task = Variable::make(Int(32), task_name);
+        Expr chunk_min = op->min + task * task_size;
+        Expr chunk_extent = min(task_size, op->min + op->extent - chunk_min);
+        Expr tasks = (op->extent + task_size - 1) / task_size;
+
+        Stmt body = For::make(op->name, chunk_min, chunk_extent,
+                              ForType::Serial, op->device_api, op->body);
+        body = Realize::make(realize->name, realize->types, realize->bounds,
+                             realize->condition, body);
+        stmt = For::make(task_name, 0, tasks, ForType::Parallel, op->device_api, body);
+        found = true;
+    }
+
+public:
+    bool found = false;
+
+    SplitIntoTasks(const Realize *r, Expr t) : realize(r), task_size(t) {}
+};
+
+// Does a statement refer to a function outside of its realizations?
+class UsedOutsideRealize : public IRVisitor {
+    const string &func;
+
+    using IRVisitor::visit;
+
+    void visit(const Realize *op) {
+        if (op->name != func) {
+            IRVisitor::visit(op);
+        }
+    }
+
+    void visit(const ProducerConsumer *op) {
+        result = result || op->name == func;
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Provide *op) {
+        result = result || op->name == func;
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Call *op) {
+        result = result || op->name == func;
+        IRVisitor::visit(op);
+    }
+
+public:
+    bool result = false;
+    UsedOutsideRealize(const string &func) : func(func) {}
+};
+
 // Perform sliding window optimization for all functions
 class SlidingWindow : public IRMutator {
     const map<string, Function> &env;
 
+    // The functions whose realizations have already been moved
+    // inside tasks.
+    set<string> split;
+
     using IRMutator::visit;
 
     void visit(const Realize *op) {
@@ -387,6 +487,22 @@ class SlidingWindow : public IRMutator {
             return;
         }
 
+        if (sched.slide_task_size().defined() && !sched.async() && !split.count(op->name)) {
+            SplitIntoTasks splitter(op, sched.slide_task_size());
+            Stmt body = splitter.mutate(op->body);
+            UsedOutsideRealize uses(op->name);
+            body.accept(&uses);
+            if (splitter.found && !uses.result) {
+                // The new realizations inside the tasks get processed
+                // on the way back down.
+                split.insert(op->name);
+                stmt = mutate(body);
+                split.erase(op->name);
+                return;
+            }
+            debug(3) << "Not splitting the loops around " << op->name << " into tasks\n";
+        }
+
         Stmt new_body = op->body;
 
         debug(3) << "Doing sliding window analysis on realization of " << op->name << "\n";
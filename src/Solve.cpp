@@ -16,6 +16,14 @@ using std::vector;
 
 namespace {
 
+// The number of distinct subexpressions one call to solve_expression
+// may rewrite before giving up, set by HL_SOLVE_BUDGET. Zero means no
+// limit.
+int64_t solve_budget() {
+    static int64_t budget = std::max(0LL, atoll(get_env_variable("HL_SOLVE_BUDGET").c_str()));
+    return budget;
+}
+
 /** A mutator that moves all instances of a free variable as far left
  * and as far outermost as possible. See the test cases at the bottom
  * of this file.
@@ -36,6 +44,16 @@ public:
     Expr mutate(const Expr &e) {
         map<Expr, CacheEntry, ExprCompare>::iterator iter = cache.find(e);
         if (iter == cache.end()) {
+            if (solve_budget() && cache.size() >= (size_t)solve_budget()) {
+                // Out of budget. Leave the rest alone, and assume it
+                // depends on the variable.
+                if (!failed) {
+                    debug(1) << "solve_expression for " << var << " ran out of budget (HL_SOLVE_BUDGET)\n";
+                }
+                failed = true;
+                uses_var = true;
+                return e;
+            }
             // Not in the cache, call the base class version.
             debug(4) << "Mutating " << e << " (" << uses_var << ")\n";
             bool old_uses_var = uses_var;
@@ -100,6 +118,13 @@ private:
     // flag "failed" to true.
     using IRMutator::visit;
 
+    // Whether a factor or divisor that doesn't depend on the variable
+    // is known to be positive. Other variables, such as those of
+    // enclosing loops, are positive if the simplifier can prove it.
+    bool is_positive(Expr e) {
+        return is_positive_const(e) || (e.type().is_int() && can_prove(e > 0));
+    }
+
     // Admit defeat. Isolated in a method for ease of debugging.
     void fail(Expr e) {
         debug(3) << "Failed to solve: " << e << "\n";
@@ -135,6 +160,11 @@ private:
         const Sub *sub_b = b.as<Sub>();
         const Mul *mul_a = a.as<Mul>();
         const Mul *mul_b = b.as<Mul>();
+        const Div *div_a = a.as<Div>();
+        const Div *div_b = b.as<Div>();
+        // Integer division can absorb the terms added to it. Only
+        // safe if the type is not subject to overflow.
+        bool exact_div = op->type.is_int() && op->type.bits() >= 32;
 
         expr = Expr();
 
@@ -173,6 +203,12 @@ private:
             } else if (mul_b && equal(mul_b->a, a)) {
                 // f(x) + f(x)*a -> f(x) * (a + 1)
                 expr = mutate(a * (mul_b->b + 1));
+            } else if (div_a && exact_div && is_positive_const(div_a->b)) {
+                // f(x)/a + g(x) -> (f(x) + g(x)*a)/a
+                expr = mutate(Div::make(div_a->a + b * div_a->b, div_a->b));
+            } else if (div_b && exact_div && is_positive_const(div_b->b)) {
+                // f(x) + g(x)/a -> (f(x)*a + g(x))/a
+                expr = mutate(Div::make(a * div_b->b + div_b->a, div_b->b));
             } else {
                 fail(a + b);
             }
@@ -215,6 +251,9 @@ private:
         const Sub *sub_b = b.as<Sub>();
         const Mul *mul_a = a.as<Mul>();
         const Mul *mul_b = b.as<Mul>();
+        const Div *div_a = a.as<Div>();
+        const Div *div_b = b.as<Div>();
+        bool exact_div = op->type.is_int() && op->type.bits() >= 32;
 
         expr = Expr();
 
@@ -264,6 +303,19 @@ private:
             } else if (mul_a && mul_b && equal(mul_a->b, mul_b->b)) {
                 // f(x)*a - g(x)*a -> (f(x) - g(x))*a;
                 expr = mutate((mul_a->a - mul_b->a) * mul_a->b);
+            } else if (mul_a && equal(mul_a->a, b)) {
+                // f(x)*a - f(x) -> f(x) * (a - 1)
+                expr = mutate(b * (mul_a->b - 1));
+            } else if (mul_b && equal(mul_b->a, a)) {
+                // f(x) - f(x)*a -> f(x) * (1 - a)
+                expr = mutate(a * (1 - mul_b->b));
+            } else if (div_a && exact_div && is_positive_const(div_a->b)) {
+                // f(x)/a - g(x) -> (f(x) - g(x)*a)/a
+                expr = mutate(Div::make(div_a->a - b * div_a->b, div_a->b));
+            } else if (div_b && exact_div && is_positive_const(div_b->b)) {
+                // With Euclidean division, -(g(x)/a) == (a - 1 - g(x))/a, so
+                // f(x) - g(x)/a -> (f(x)*a - g(x) + (a - 1))/a
+                expr = mutate(Div::make(a * div_b->b - div_b->a + (div_b->b - 1), div_b->b));
             } else {
                 fail(a - b);
             }
@@ -601,8 +653,8 @@ private:
                 } else {
                     // Don't use operator/ and operator % to sneak
                     // past the division-by-zero check. We'll only
-                    // actually use these when mul_a->b is a positive
-                    // or negative constant.
+                    // actually use these when mul_a->b is a constant,
+                    // or known to be positive.
                     Expr div = Div::make(b, mul_a->b);
                     Expr rem = Mod::make(b, mul_a->b);
                     if (is_eq) {
@@ -611,7 +663,7 @@ private:
                     } else if (is_ne) {
                         // f(x) * c != b -> f(x) != b/c || b%c != 0
                         expr = mutate((mul_a->a != div) || (rem != 0));
-                    } else if (is_positive_const(mul_a->b)) {
+                    } else if (is_positive(mul_a->b)) {
                         if (is_le) {
                             expr = mutate(mul_a->a <= div);
                         } else if (is_lt) {
@@ -639,7 +691,7 @@ private:
                         internal_assert(!a.type().is_uint()) << "Negating unsigned is not legal\n";
                         // With Euclidean division, (a/(-b)) == -(a/b)
                         expr = mutate(Cmp::make(negate(div_a->a / negate(div_a->b)), b));
-                    } else if (is_positive_const(div_a->b)) {
+                    } else if (is_positive(div_a->b)) {
                         if (is_lt) {
                             // f(x) / b < c  <==>  f(x) < c * b
                             expr = mutate(div_a->a < b * div_a->b);
@@ -728,6 +780,43 @@ private:
 
 };
 
+// Find the outermost scalar min, max, or select in an expression that
+// depends on a variable.
+class FindPiece : public IRVisitor {
+    const string &var;
+
+    using IRVisitor::visit;
+
+    template<typename T>
+    void visit_piece(const T *op) {
+        if (piece.defined()) {
+            return;
+        }
+        if (op->type.is_scalar() && expr_uses_var(op, var)) {
+            piece = op;
+        } else {
+            IRVisitor::visit(op);
+        }
+    }
+
+    void visit(const Min *op) {
+        visit_piece(op);
+    }
+
+    void visit(const Max *op) {
+        visit_piece(op);
+    }
+
+    void visit(const Select *op) {
+        visit_piece(op);
+    }
+
+public:
+    Expr piece;
+
+    FindPiece(const string &v) : var(v) {}
+};
+
 class SolveForInterval : public IRVisitor {
 
     // The var we're solving for
@@ -748,6 +837,10 @@ class SolveForInterval : public IRVisitor {
     // Has this expression already been rearranged by solve_expression?
     bool already_solved = false;
 
+    // The number of mins, maxes, and selects split out of the
+    // comparison being solved. See solve_piecewise.
+    int pieces = 0;
+
     using IRVisitor::visit;
 
     void fail() {
@@ -858,6 +951,56 @@ class SolveForInterval : public IRVisitor {
         }
     }
 
+    // A comparison that solve_expression couldn't rearrange, because it
+    // uses the variable in more than one place, may still be solvable
+    // piece by piece. A min, max, or select that depends on the
+    // variable takes the value of one of its sides, so the comparison
+    // is equivalent to one comparison per side, each guarded by the
+    // condition under which that side is taken. This covers clamps
+    // nested inside other arithmetic, and several clamps of the same
+    // variable. Each split doubles the work, so only a few are made.
+    void solve_piecewise(Expr cond) {
+        if (pieces >= 4) {
+            fail();
+            return;
+        }
+        cond = substitute_in_all_lets(cond);
+        FindPiece finder(var);
+        cond.accept(&finder);
+        Expr piece = finder.piece;
+        Expr c, a, b;
+        if (const Min *op = piece.as<Min>()) {
+            c = op->a <= op->b;
+            a = op->a;
+            b = op->b;
+        } else if (const Max *op = piece.as<Max>()) {
+            c = op->a >= op->b;
+            a = op->a;
+            b = op->b;
+        } else if (const Select *op = piece.as<Select>()) {
+            c = op->condition;
+            a = op->true_value;
+            b = op->false_value;
+        } else {
+            fail();
+            return;
+        }
+        Expr split = ((c && graph_substitute(piece, a, cond)) ||
+                      (!c && graph_substitute(piece, b, cond)));
+        debug(3) << "Splitting " << cond << " on " << piece << "\n";
+        pieces++;
+        bool old_already_solved = already_solved;
+        already_solved = false;
+        split.accept(this);
+        already_solved = old_already_solved;
+        pieces--;
+        // The solutions of the comparisons within may be wrapped in
+        // lets of the same names as the ones this comparison is
+        // wrapped in, so flatten them.
+        result.min = substitute_in_all_lets(result.min);
+        result.max = substitute_in_all_lets(result.max);
+    }
+
     void visit(const Variable *op) {
         internal_assert(op->type.is_bool());
         if (scope.contains(op->name)) {
@@ -911,6 +1054,22 @@ class SolveForInterval : public IRVisitor {
         }
     }
 
+    // Bind the abstract variables in the solution of a cached
+    // comparison to their values. The lets get fresh names, because
+    // the values may themselves refer to the abstract variables of an
+    // enclosing comparison.
+    Expr bind_abstract(Expr e, const string &b_name, Expr b, const string &c_name, Expr c) {
+        if (!expr_uses_var(e, b_name) && !expr_uses_var(e, c_name)) {
+            return e;
+        }
+        string b_fresh = unique_name('b'), c_fresh = unique_name('c');
+        // The solutions don't contain lets of the abstract names
+        // themselves, so there's nothing to shadow them.
+        e = graph_substitute(b_name, Variable::make(b.type(), b_fresh), e);
+        e = graph_substitute(c_name, Variable::make(c.type(), c_fresh), e);
+        return Let::make(c_fresh, c, Let::make(b_fresh, b, e));
+    }
+
     void visit(const LE *le) {
         static string b_name = unique_name('b');
         static string c_name = unique_name('c');
@@ -919,7 +1078,7 @@ class SolveForInterval : public IRVisitor {
         if (!already_solved) {
             SolverResult solved = solve_expression(le, var, scope);
             if (!solved.fully_solved) {
-                fail();
+                solve_piecewise(solved.result);
             } else {
                 already_solved = true;
                 solved.result.accept(this);
@@ -941,30 +1100,18 @@ class SolveForInterval : public IRVisitor {
             Expr b_var = Variable::make(b.type(), b_name);
             Expr c_var = Variable::make(c.type(), c_name);
             cached_solve((a <= c_var) && (b_var <= c_var || a >= b_var));
-            if (result.has_upper_bound()) {
-                result.min = Let::make(b_name, b, result.min);
-                result.min = Let::make(c_name, c, result.min);
-            }
-            if (result.has_upper_bound()) {
-                result.max = Let::make(b_name, b, result.max);
-                result.max = Let::make(c_name, c, result.max);
-            }
+            result.min = bind_abstract(result.min, b_name, b, c_name, c);
+            result.max = bind_abstract(result.max, b_name, b, c_name, c);
         } else if (const Min *min_a = le->a.as<Min>()) {
             // Rewrite (min(a, b) <= c) <==> (a <= c || (b <= c && a >= b))
             Expr a = min_a->a, b = min_a->b, c = le->b;
             Expr b_var = Variable::make(b.type(), b_name);
             Expr c_var = Variable::make(c.type(), c_name);
             cached_solve((a <= c_var) || (b_var <= c_var && a >= b_var));
-            if (result.has_lower_bound()) {
-                result.min = Let::make(b_name, b, result.min);
-                result.min = Let::make(c_name, c, result.min);
-            }
-            if (result.has_upper_bound()) {
-                result.max = Let::make(b_name, b, result.max);
-                result.max = Let::make(c_name, c, result.max);
-            }
+            result.min = bind_abstract(result.min, b_name, b, c_name, c);
+            result.max = bind_abstract(result.max, b_name, b, c_name, c);
         } else {
-            fail();
+            solve_piecewise(le);
         }
     }
 
@@ -976,7 +1123,7 @@ class SolveForInterval : public IRVisitor {
         if (!already_solved) {
             SolverResult solved = solve_expression(ge, var, scope);
             if (!solved.fully_solved) {
-                fail();
+                solve_piecewise(solved.result);
             } else {
                 already_solved = true;
                 solved.result.accept(this);
@@ -995,30 +1142,18 @@ class SolveForInterval : public IRVisitor {
             Expr b_var = Variable::make(b.type(), b_name);
             Expr c_var = Variable::make(c.type(), c_name);
             cached_solve((a >= c_var) || (b_var >= c_var && a <= b_var));
-            if (result.has_lower_bound()) {
-                result.min = Let::make(b_name, b, result.min);
-                result.min = Let::make(c_name, c, result.min);
-            }
-            if (result.has_upper_bound()) {
-                result.max = Let::make(b_name, b, result.max);
-                result.max = Let::make(c_name, c, result.max);
-            }
+            result.min = bind_abstract(result.min, b_name, b, c_name, c);
+            result.max = bind_abstract(result.max, b_name, b, c_name, c);
         } else if (const Min *min_a = ge->a.as<Min>()) {
             // Rewrite (min(a, b) >= c) <==> (a >= c && (b >= c || a <= b))
             Expr a = min_a->a, b = min_a->b, c = ge->b;
             Expr b_var = Variable::make(b.type(), b_name);
             Expr c_var = Variable::make(c.type(), c_name);
             cached_solve((a >= c_var) && (b_var >= c_var || a <= b_var));
-            if (result.has_lower_bound()) {
-                result.min = Let::make(b_name, b, result.min);
-                result.min = Let::make(c_name, c, result.min);
-            }
-            if (result.has_upper_bound()) {
-                result.max = Let::make(b_name, b, result.max);
-                result.max = Let::make(c_name, c, result.max);
-            }
+            result.min = bind_abstract(result.min, b_name, b, c_name, c);
+            result.max = bind_abstract(result.max, b_name, b, c_name, c);
         } else {
-            fail();
+            solve_piecewise(ge);
         }
     }
 
@@ -1442,8 +1577,9 @@ void solve_test() {
         if (den == 0) continue;
         for (int num = 5; num <= 10; num++) {
             Expr in[] = {x*den < num, x*den <= num, x*den == num, x*den != num, x*den >= num, x*den > num,
-                         x/den < num, x/den <= num, x/den == num, x/den != num, x/den >= num, x/den > num};
-            for (int j = 0; j < 12; j++) {
+                         x/den < num, x/den <= num, x/den == num, x/den != num, x/den >= num, x/den > num,
+                         x/3 + x*den < num, x*den - x/3 <= num, x/3 - x*den >= num, (x + den)/2 + x > num};
+            for (int j = 0; j < 16; j++) {
                 SolverResult solved = solve_expression(in[j], "x");
                 internal_assert(solved.fully_solved) << "Error: failed to solve for x in " << in[j] << "\n";
                 Expr out = simplify(solved.result);
@@ -1509,6 +1645,23 @@ void solve_test() {
     check_inner_interval(x/5 < 17, Interval::neg_inf, 84);
     check_outer_interval(x/5 < 17, Interval::neg_inf, 84);
 
+    // Divisions absorb the terms added to them.
+    check_inner_interval(x/2 + x < 10, Interval::neg_inf, 6);
+    check_outer_interval(x - x/3 >= 4, 5, Interval::pos_inf);
+    check_inner_interval(x/3 - x <= 5, -8, Interval::pos_inf);
+
+    // Clamps and selects that can't be solved for as a whole are
+    // solved for one piece at a time.
+    check_inner_interval(clamp(x, 0, 100) + clamp(x + 1, 0, 100) < 150, 0, 74);
+    check_inner_interval(min(x, 100)*2 + x <= 200, Interval::neg_inf, 66);
+    check_outer_interval(min(x, 100)*2 + x <= 200, Interval::neg_inf, 66);
+    check_inner_interval(select(x > 10, x*2, x + 10) <= 50, 11, 25);
+    check_outer_interval(select(x > 10, x*2, x + 10) <= 50, Interval::neg_inf, 25);
+
+    // Products with other variables can be inverted when they're
+    // known to be positive.
+    check_solve(x*max(y, 1) <= 100, x <= 100/max(y, 1));
+
     // Test anding a condition over a domain
     check_and_condition(x > 0, const_true(), Interval(1, y));
     check_and_condition(x > 0, const_true(), Interval(5, y));
@@ -0,0 +1,237 @@
+#include "Sorting.h"
+#include "IROperator.h"
+#include "Util.h"
+
+#include <algorithm>
+#include <set>
+
+namespace Halide {
+namespace Sorting {
+
+using std::pair;
+using std::string;
+using std::vector;
+
+using Internal::Let;
+using Internal::Variable;
+using Internal::unique_name;
+
+namespace {
+
+struct Comparator {
+    int a, b;
+    // Whether the min (stored back to a) and the max (stored back
+    // to b) are needed by the results.
+    bool need_min, need_max;
+};
+
+// The comparators of Batcher's odd-even merge sort on n elements, in
+// order.
+vector<Comparator> odd_even_merge_sort(int n) {
+    vector<Comparator> result;
+    for (int p = 1; p < n; p *= 2) {
+        for (int k = p; k >= 1; k /= 2) {
+            for (int j = k % p; j + k < n; j += 2 * k) {
+                for (int i = 0; i < std::min(k, n - j - k); i++) {
+                    if ((i + j) / (p * 2) == (i + j + k) / (p * 2)) {
+                        result.push_back({i + j, i + j + k, false, false});
+                    }
+                }
+            }
+        }
+    }
+    return result;
+}
+
+// Run a sorting network over the values, keeping only the
+// comparators that the elements at the given indices depend on. The
+// intermediate values are bound in lets, which are returned in
+// order, so that the size of the Exprs stays linear in the size of
+// the network.
+vector<Expr> run_network(const vector<Expr> &values, const std::set<int> &wanted,
+                         vector<pair<string, Expr>> *lets) {
+    user_assert(!values.empty()) << "Can't sort an empty list of Exprs\n";
+    const Type t = values[0].type();
+    for (const Expr &e : values) {
+        user_assert(e.defined()) << "Can't sort an undefined Expr\n";
+        user_assert(e.type() == t)
+            << "All the Exprs to sort must have the same type, but "
+            << e << " has type " << e.type() << " instead of " << t << "\n";
+    }
+
+    auto bind = [&](Expr e) {
+        string name = unique_name('s');
+        lets->push_back({name, e});
+        return Variable::make(t, name);
+    };
+
+    vector<Comparator> network = odd_even_merge_sort((int)values.size());
+    std::set<int> live = wanted;
+    for (auto it = network.rbegin(); it != network.rend(); it++) {
+        it->need_min = live.count(it->a) != 0;
+        it->need_max = live.count(it->b) != 0;
+        if (it->need_min || it->need_max) {
+            live.insert(it->a);
+            live.insert(it->b);
+        }
+    }
+
+    vector<Expr> cur(values.size());
+    for (size_t i = 0; i < values.size(); i++) {
+        cur[i] = live.count((int)i) ? bind(values[i]) : values[i];
+    }
+    for (const Comparator &c : network) {
+        Expr a = cur[c.a], b = cur[c.b];
+        if (c.need_min) {
+            cur[c.a] = bind(min(a, b));
+        }
+        if (c.need_max) {
+            cur[c.b] = bind(max(a, b));
+        }
+    }
+    return cur;
+}
+
+Expr wrap_lets(Expr e, const vector<pair<string, Expr>> &lets) {
+    for (auto it = lets.rbegin(); it != lets.rend(); it++) {
+        e = Let::make(it->first, it->second, e);
+    }
+    return e;
+}
+
+}  // namespace
+
+vector<Expr> sort(const vector<Expr> &values) {
+    std::set<int> wanted;
+    for (int i = 0; i < (int)values.size(); i++) {
+        wanted.insert(i);
+    }
+    vector<pair<string, Expr>> lets;
+    vector<Expr> result = run_network(values, wanted, &lets);
+    for (Expr &e : result) {
+        e = wrap_lets(e, lets);
+    }
+    return result;
+}
+
+Expr nth_element(const vector<Expr> &values, int n) {
+    user_assert(n >= 0 && n < (int)values.size())
+        << "Can't select element " << n << " of a list of " << values.size() << " Exprs\n";
+    vector<pair<string, Expr>> lets;
+    vector<Expr> result = run_network(values, {n}, &lets);
+    return wrap_lets(result[n], lets);
+}
+
+Expr median(const vector<Expr> &values) {
+    return nth_element(values, ((int)values.size() - 1) / 2);
+}
+
+Func sort(Func input, int size, int tile_size) {
+    user_assert(input.defined() && input.dimensions() == 1 && input.outputs() == 1)
+        << "Sorting::sort() requires a one-dimensional Func with a single value\n";
+    user_assert(size > 0) << "Sorting::sort() requires a positive size\n";
+    user_assert(tile_size >= 8) << "Sorting::sort() requires a tile size of at least 8\n";
+
+    const Type t = input.output_types()[0];
+    const int run_size = 8;
+    int padded_size = run_size;
+    while (padded_size < size) {
+        padded_size *= 2;
+    }
+    int tile = run_size;
+    while (tile * 2 <= tile_size) {
+        tile *= 2;
+    }
+
+    Var x("x"), xo("xo"), xi("xi"), y("y"), tv("t");
+
+    // Pad to a power of two with the largest value of the type, which
+    // sorts to the end.
+    Func padded(input.name() + "_sort_padded");
+    padded(x) = select(x < size, input(clamp(x, 0, size - 1)), t.max());
+
+    // Sort runs of eight with a sorting network.
+    Func run(input.name() + "_sort_run");
+    {
+        vector<Expr> elems;
+        for (int i = 0; i < run_size; i++) {
+            elems.push_back(padded(run_size * y + i));
+        }
+        run(y) = Tuple(sort(elems));
+    }
+    Func prev(input.name() + "_sort_runs");
+    {
+        Expr e = run(x / run_size)[run_size - 1];
+        for (int i = run_size - 2; i >= 0; i--) {
+            e = select(x % run_size == i, run(x / run_size)[i], e);
+        }
+        prev(x) = e;
+    }
+    run.compute_at(prev, xo);
+    prev.compute_root().split(x, xo, xi, std::min(tile, padded_size)).parallel(xo);
+
+    // Merge pairs of runs until there is just one.
+    for (int len = run_size; len < padded_size; len *= 2) {
+        const int tile_len = std::min(tile, 2 * len);
+        Expr tile_start = tv * tile_len;
+        Expr pair_start = (tile_start / (2 * len)) * (2 * len);
+        Expr k = tile_start - pair_start;
+        auto run_a = [&](Expr i) { return prev(pair_start + clamp(i, 0, len - 1)); };
+        auto run_b = [&](Expr j) { return prev(pair_start + len + clamp(j, 0, len - 1)); };
+
+        // Find how many of the first k outputs of this merge come
+        // from the first run, with a binary search along the merge
+        // path. Ties go to the first run.
+        Func path(input.name() + "_sort_path");
+        if (tile_len == 2 * len) {
+            path(tv) = 0;
+        } else {
+            vector<pair<string, Expr>> lets;
+            auto bind = [&](Expr e) {
+                string name = unique_name('p');
+                lets.push_back({name, e});
+                return Variable::make(Int(32), name);
+            };
+            Expr lo = bind(max(k - len, 0)), hi = bind(min(k, len));
+            for (int steps = 1; steps <= 2 * len; steps *= 2) {
+                Expr mid = bind((lo + hi) / 2);
+                Expr searching = lo < hi;
+                Expr take = bind(searching && run_a(mid) <= run_b(k - mid - 1));
+                Expr new_lo = select(take, mid + 1, lo);
+                Expr new_hi = select(searching && !take, mid, hi);
+                lo = bind(new_lo);
+                hi = bind(new_hi);
+            }
+            path(tv) = wrap_lets(lo, lets);
+        }
+
+        // Merge the tile serially, starting from where the merge path
+        // says.
+        Func merge(input.name() + "_sort_merge");
+        merge(x, tv) = Tuple(path(tv), k - path(tv), cast(t, 0));
+        RDom r(0, tile_len);
+        {
+            Expr a = merge(r - 1, tv)[0];
+            Expr b = merge(r - 1, tv)[1];
+            Expr va = run_a(a), vb = run_b(b);
+            Expr take_a = a < len && (b >= len || va <= vb);
+            merge(r, tv) = Tuple(select(take_a, a + 1, a),
+                                 select(take_a, b, b + 1),
+                                 select(take_a, va, vb));
+        }
+
+        Func next(input.name() + "_sort_merged");
+        next(x) = merge(x % tile_len, x / tile_len)[2];
+        path.compute_at(next, xo);
+        merge.compute_at(next, xo);
+        next.compute_root().split(x, xo, xi, tile_len).parallel(xo);
+        prev = next;
+    }
+
+    Func result(input.name() + "_sorted");
+    result(x) = prev(x);
+    return result;
+}
+
+}
+}
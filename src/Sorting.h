@@ -0,0 +1,56 @@
+#ifndef HALIDE_SORTING_H
+#define HALIDE_SORTING_H
+
+/** \file
+ * Sorting and selection of Halide Exprs and Funcs.
+ */
+
+#include <vector>
+
+#include "Func.h"
+#include "IR.h"
+
+namespace Halide {
+
+/** namespace to hold functions for sorting and selecting values.
+ *
+ * The functions over a list of Exprs build a sorting network out of
+ * min and max, so they have no branches or data-dependent memory
+ * accesses, and vectorize across pixels like any other
+ * arithmetic. They are meant for small windows, such as the pixels
+ * under a median filter. The comparators that don't contribute to
+ * the requested results are left out, so selecting one element costs
+ * less than sorting them all.
+ *
+ * The function over a Func sorts a large one-dimensional Func with a
+ * merge sort that can run in parallel.
+ */
+namespace Sorting {
+
+/** Sort a list of Exprs of the same type into ascending order. */
+EXPORT std::vector<Expr> sort(const std::vector<Expr> &values);
+
+/** Return the element that would be at index n if the list of Exprs
+ * were sorted into ascending order. */
+EXPORT Expr nth_element(const std::vector<Expr> &values, int n);
+
+/** Return the median of a list of Exprs of the same type. For an even
+ * number of values, this is the lower of the two middle ones. */
+EXPORT Expr median(const std::vector<Expr> &values);
+
+/** Return a one-dimensional Func whose values over [0, size) are the
+ * values of a one-dimensional Func over [0, size), sorted into
+ * ascending order. Runs of eight values are first sorted with a
+ * sorting network, and the runs are then merged pairwise until one
+ * remains. Each merge is cut into tiles of tile_size outputs, and a
+ * binary search (the "merge path") finds where in the two input runs
+ * each tile starts, so the tiles of even the last merge are merged in
+ * parallel. All the stages are computed at root. The result must be
+ * realized over [0, size). */
+EXPORT Func sort(Func input, int size, int tile_size = 1024);
+
+}
+
+}
+
+#endif
@@ -0,0 +1,91 @@
+#include "SpecializeUnitStride.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+#include "Substitute.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::set;
+using std::string;
+
+namespace {
+
+// Find the innermost strides of the buffer parameters with no stride
+// constraint that are used inside vectorized loops. Loops on other
+// devices are left alone.
+class FindUnconstrainedStrides : public IRVisitor {
+    using IRVisitor::visit;
+
+    int vector_depth = 0;
+
+    void visit(const For *op) {
+        if (op->for_type == ForType::GPUBlock ||
+            op->for_type == ForType::GPUThread ||
+            (op->device_api != DeviceAPI::None &&
+             op->device_api != DeviceAPI::Host)) {
+            return;
+        }
+        op->min.accept(this);
+        op->extent.accept(this);
+        if (op->for_type == ForType::Vectorized) {
+            vector_depth++;
+        }
+        op->body.accept(this);
+        if (op->for_type == ForType::Vectorized) {
+            vector_depth--;
+        }
+    }
+
+    void visit(const Variable *op) {
+        const Parameter &param = op->param;
+        if (vector_depth > 0 &&
+            param.defined() &&
+            param.is_buffer() &&
+            op->name == param.name() + ".stride.0" &&
+            !param.stride_constraint(0).defined()) {
+            strides.insert(op->name);
+        }
+    }
+
+public:
+    set<string> strides;
+};
+
+class SpecializeUnitStride : public IRMutator {
+    using IRMutator::visit;
+
+    void visit(const For *op) {
+        // Only the outermost loops are versioned, so the test is made
+        // once per loop nest. The strides are defined at the top of
+        // the pipeline by unpack_buffers.
+        FindUnconstrainedStrides finder;
+        op->accept(&finder);
+        if (finder.strides.empty()) {
+            stmt = op;
+            return;
+        }
+
+        Expr condition;
+        map<string, Expr> unit;
+        for (const string &name : finder.strides) {
+            Expr is_unit = Variable::make(Int(32), name) == 1;
+            condition = condition.defined() ? condition && is_unit : is_unit;
+            unit[name] = 1;
+        }
+
+        debug(3) << "Specializing loop nest " << op->name << " on " << condition << "\n";
+        Stmt dense = substitute(unit, Stmt(op));
+        stmt = IfThenElse::make(condition, dense, op);
+    }
+};
+
+}  // namespace
+
+Stmt specialize_unit_stride(Stmt s) {
+    return SpecializeUnitStride().mutate(s);
+}
+
+}
+}
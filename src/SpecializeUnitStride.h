@@ -0,0 +1,27 @@
+#ifndef HALIDE_SPECIALIZE_UNIT_STRIDE_H
+#define HALIDE_SPECIALIZE_UNIT_STRIDE_H
+
+/** \file
+ * Defines the lowering pass that adds a dense fast path to loop nests
+ * over buffers with an unconstrained innermost stride.
+ */
+
+#include "IR.h"
+
+namespace Halide {
+namespace Internal {
+
+/** For each outermost loop nest containing vectorized loops that
+ * access an input or output buffer with no constraint on the stride
+ * of its innermost dimension, emit a second version of the loop nest
+ * in which that stride is one, and select between the two at runtime,
+ * so that the common dense case gets dense vector loads and
+ * stores. This is equivalent to specializing every Func on
+ * buffer.dim(0).stride() == 1 by hand. Must be called after
+ * unpack_buffers, and before the loops are vectorized. */
+Stmt specialize_unit_stride(Stmt s);
+
+}
+}
+
+#endif
@@ -58,7 +58,23 @@ class SplitTuples : public IRMutator {
 
     void visit(const Realize *op) {
         realizations.push(op->name, 0);
-        if (op->types.size() > 1) {
+        auto it = env.find(op->name);
+        if (op->types.size() > 1 &&
+            it != env.end() && it->second.schedule().interleave_tuple()) {
+            for (Type t : op->types) {
+                user_assert(t == op->types[0])
+                    << "Can't store the Tuple elements of " << op->name
+                    << " interleaved, because they don't all have the same type.\n";
+            }
+            // Make a single realize node with a new innermost
+            // dimension for the tuple index.
+            interleaved.push(op->name, 0);
+            Stmt body = mutate(op->body);
+            interleaved.pop(op->name);
+            Region bounds = op->bounds;
+            bounds.insert(bounds.begin(), Range(0, (int)op->types.size()));
+            stmt = Realize::make(op->name, {op->types[0]}, bounds, op->condition, body);
+        } else if (op->types.size() > 1) {
             // Make a nested set of realize nodes for each tuple element
             Stmt body = mutate(op->body);
             for (int i = (int)op->types.size() - 1; i >= 0; i--) {
@@ -83,7 +99,12 @@ class SplitTuples : public IRMutator {
     }
 
     void visit(const Prefetch *op) {
-        if (!op->param.defined() && (op->types.size() > 1)) {
+        if (!op->param.defined() && interleaved.contains(op->name)) {
+            // One prefetch covers all the elements.
+            Region bounds = op->bounds;
+            bounds.insert(bounds.begin(), Range(0, (int)op->types.size()));
+            stmt = Prefetch::make(op->name, {op->types[0]}, bounds);
+        } else if (!op->param.defined() && (op->types.size() > 1)) {
             // Split the prefetch from a multi-dimensional halide tuple to
             // prefetches of each tuple element. Keep only prefetches of
             // elements that are actually used in the loop body.
@@ -108,10 +129,12 @@ class SplitTuples : public IRMutator {
             internal_assert(it != env.end());
             Function f = it->second;
             string name = op->name;
-            if (f.outputs() > 1) {
+            vector<Expr> args;
+            if (interleaved.contains(op->name)) {
+                args.push_back(op->value_index);
+            } else if (f.outputs() > 1) {
                 name += "." + std::to_string(op->value_index);
             }
-            vector<Expr> args;
             for (Expr e : op->args) {
                 args.push_back(mutate(e));
             }
@@ -175,7 +198,13 @@ class SplitTuples : public IRMutator {
                 lets.push_back({ var_name, val });
                 val = Variable::make(val.type(), var_name);
             }
-            provides.push_back(Provide::make(name, {val}, args));
+            if (interleaved.contains(op->name)) {
+                vector<Expr> element_args = args;
+                element_args.insert(element_args.begin(), (int)i);
+                provides.push_back(Provide::make(op->name, {val}, element_args));
+            } else {
+                provides.push_back(Provide::make(name, {val}, args));
+            }
         }
 
         Stmt result = Block::make(provides);
@@ -192,6 +221,9 @@ class SplitTuples : public IRMutator {
     const map<string, Function> &env;
     Scope<int> realizations;
 
+    // The realizations that store their Tuple elements interleaved.
+    Scope<int> interleaved;
+
 public:
 
     SplitTuples(const map<string, Function> &e) : env(e) {}
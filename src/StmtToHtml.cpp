@@ -2,8 +2,10 @@
 #include "IRVisitor.h"
 #include "IROperator.h"
 #include "Scope.h"
+#include "Util.h"
 
 #include <iterator>
+#include <map>
 #include <iostream>
 #include <fstream>
 #include <sstream>
@@ -22,10 +24,89 @@ std::string to_string(T value) {
     return os.str() ;
 }
 
+// The numbers reported for one Func by halide_profiler_report.
+struct FuncProfile {
+    float time_ms = 0;
+    int percent = 0;
+    size_t memory_peak = 0, num_allocs = 0, stack_peak = 0;
+};
+
+// Parse the per-Func lines of halide_profiler_report output, which
+// look like:
+//   name:     1.23ms    (45%)   threads: 3.2   peak: 1024  num: 2  avg: 512  stack: 64
+// Lines for pipelines, and any other lines, are skipped.
+std::map<string, FuncProfile> load_profile(const string &filename) {
+    std::ifstream in(filename.c_str());
+    user_assert(in.is_open()) << "Could not open profile " << filename << "\n";
+
+    std::map<string, FuncProfile> result;
+    string line;
+    while (std::getline(in, line)) {
+        if (!starts_with(line, "  ") || starts_with(line, "   ")) {
+            continue;
+        }
+        size_t colon = line.find(": ");
+        if (colon == string::npos) {
+            continue;
+        }
+        string name = line.substr(2, colon - 2);
+        std::istringstream fields(line.substr(colon + 1));
+        FuncProfile p;
+        string token;
+        if (!(fields >> p.time_ms) || !(fields >> token) || !starts_with(token, "ms")) {
+            continue;
+        }
+        while (fields >> token) {
+            if (starts_with(token, "(") && ends_with(token, "%)")) {
+                p.percent = atoi(token.substr(1).c_str());
+            } else if (token == "peak:") {
+                fields >> p.memory_peak;
+            } else if (token == "num:") {
+                fields >> p.num_allocs;
+            } else if (token == "stack:") {
+                fields >> p.stack_peak;
+            }
+        }
+        // Names can appear in more than one pipeline. Keep the
+        // numbers for the pipeline where the Func takes longest.
+        auto it = result.find(name);
+        if (it == result.end() || it->second.time_ms < p.time_ms) {
+            result[name] = p;
+        }
+    }
+    return result;
+}
+
+// Sum the time shares of the producers in some IR. The profiler
+// attributes each sample to the innermost producer only, so the sum
+// over nested producers doesn't double-count.
+class ProfileShare : public IRVisitor {
+    using IRVisitor::visit;
+
+    const std::map<string, FuncProfile> &profile;
+
+    void visit(const ProducerConsumer *op) {
+        if (op->is_producer) {
+            auto it = profile.find(op->name);
+            if (it != profile.end()) {
+                percent += it->second.percent;
+            }
+        }
+        IRVisitor::visit(op);
+    }
+
+public:
+    int percent = 0;
+    ProfileShare(const std::map<string, FuncProfile> &p) : profile(p) {}
+};
+
 class StmtToHtml : public IRVisitor {
 
     static const std::string css, js;
 
+    // The profile to annotate the output with, if any.
+    std::map<string, FuncProfile> profile;
+
     // This allows easier access to individual elements.
     int id_count;
 
@@ -109,6 +190,31 @@ private:
         return s.str();
     }
 
+    // A heat map color for a share of the runtime, from transparent
+    // for nothing to strong red for everything.
+    string heat_style(int percent) {
+        std::stringstream s;
+        s << "style='background-color: rgba(255, 0, 0, " << std::min(100, percent) / 100.0 << ");'";
+        return s.str();
+    }
+
+    string profile_annotation(int percent, const FuncProfile *p = nullptr) {
+        std::stringstream s;
+        s << "<span class='Profile' " << heat_style(percent) << ">";
+        s << percent << "%";
+        if (p) {
+            s << " " << p->time_ms << "ms";
+            if (p->num_allocs) {
+                s << " heap peak: " << p->memory_peak << " bytes in " << p->num_allocs << " allocations";
+            }
+            if (p->stack_peak) {
+                s << " stack: " << p->stack_peak << " bytes";
+            }
+        }
+        s << "</span>";
+        return s.str();
+    }
+
     void print_list(const std::vector<Expr> &args) {
         for (size_t i = 0; i < args.size(); i++) {
             if (i > 0) {
@@ -334,6 +440,12 @@ private:
         stream << var(op->name);
         stream << close_expand_button() << " {";
         stream << close_span();;
+        if (op->is_producer && !profile.empty()) {
+            auto it = profile.find(op->name);
+            if (it != profile.end()) {
+                stream << " " << profile_annotation(it->second.percent, &it->second);
+            }
+        }
         stream << open_div(op->is_producer ? "ProduceBody Indent" : "ConsumeBody Indent", produce_id);
         print(op->body);
         stream << close_div();
@@ -369,6 +481,13 @@ private:
         stream << matched(")");
         stream << close_expand_button();
         stream << " " << matched("{");
+        if (!profile.empty()) {
+            ProfileShare share(profile);
+            op->body.accept(&share);
+            if (share.percent) {
+                stream << " " << profile_annotation(share.percent);
+            }
+        }
         stream << open_div("ForBody Indent", id);
         print(op->body);
         stream << close_div();
@@ -563,6 +682,15 @@ private:
         stream << close_div();
     }
 
+    void visit(const VectorReduce *op) {
+        stream << open_span("VectorReduce");
+        stream << open_span("Type") << op->type << close_span();
+        std::ostringstream name;
+        name << "vector_reduce_" << op->op << "(";
+        print_list(symbol(name.str()), {op->value}, ")");
+        stream << close_span();
+    }
+
     void visit(const Shuffle *op) {
         stream << open_span("Shuffle");
         if (op->is_concat()) {
@@ -632,7 +760,10 @@ public:
         stream << close_div();
     }
 
-    StmtToHtml(string filename) : id_count(0), context_stack(1, 0) {
+    StmtToHtml(string filename, const string &profile_filename = "") : id_count(0), context_stack(1, 0) {
+        if (!profile_filename.empty()) {
+            profile = load_profile(profile_filename);
+        }
         stream.open(filename.c_str());
         stream << "<head>";
         stream << "<style type='text/css'>" << css << "</style>\n";
@@ -671,6 +802,7 @@ span.Type { color: #445588; font-weight: bold; }\n \
 span.StringImm { color: #d14; }\n \
 span.IntImm { color: #099; }\n \
 span.FloatImm { color: #099; }\n \
+span.Profile { color: #333; font-style: italic; padding: 0px 4px; border-radius: 3px; }\n \
 b.Highlight { font-weight: bold; background-color: #DDD; }\n \
 span.Highlight { font-weight: bold; background-color: #FF0; }\n \
 ";
@@ -698,8 +830,8 @@ void print_to_html(string filename, Stmt s) {
     sth.print(s);
 }
 
-void print_to_html(string filename, const Module &m) {
-    StmtToHtml sth(filename);
+void print_to_html(string filename, const Module &m, const std::string &profile_filename) {
+    StmtToHtml sth(filename, profile_filename);
     for (const auto &b : m.buffers()) {
         sth.print(b);
     }
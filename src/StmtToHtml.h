@@ -15,8 +15,12 @@ namespace Internal {
  */
 EXPORT void print_to_html(std::string filename, Stmt s);
 
-/** Dump an HTML-formatted print of a Module to filename. */
-EXPORT void print_to_html(std::string filename, const Module &m);
+/** Dump an HTML-formatted print of a Module to filename. If
+ * profile_filename is not empty, it should contain the output of
+ * halide_profiler_report, which is used to annotate the producers and
+ * loops of the Module with their share of the runtime. */
+EXPORT void print_to_html(std::string filename, const Module &m,
+                          const std::string &profile_filename = "");
 
 }}
 
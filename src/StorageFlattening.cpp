@@ -1,11 +1,13 @@
 #include "StorageFlattening.h"
 
 #include "Bounds.h"
+#include "ExprUsesVar.h"
 #include "FuseGPUThreadLoops.h"
 #include "IRMutator.h"
 #include "IROperator.h"
 #include "Parameter.h"
 #include "Scope.h"
+#include "Simplify.h"
 
 #include <sstream>
 
@@ -21,6 +23,49 @@ using std::set;
 
 namespace {
 
+// Does the realization with the given name store all the elements of
+// f's Tuple interleaved. See split_tuples.
+bool is_interleaved_tuple(const Function &f, const string &name) {
+    return f.outputs() > 1 && name == f.name();
+}
+
+// Two dimensions of an internal allocation that are stored in tiles,
+// as indices into the args of the realization. See Func::store_tiled.
+struct Tiling {
+    int x = -1, y = -1;
+    Expr x_tile, y_tile;
+
+    bool defined() const {
+        return x >= 0;
+    }
+};
+
+Tiling find_tiling(const Function &f, const string &name) {
+    Tiling tiling;
+    const vector<StorageDim> &storage_dims = f.schedule().storage_dims();
+    const vector<string> &args = f.args();
+    if (storage_dims.size() < 2 || !storage_dims[0].tile_extent.defined()) {
+        return tiling;
+    }
+    int offset = is_interleaved_tuple(f, name) ? 1 : 0;
+    for (size_t i = 0; i < args.size(); i++) {
+        if (args[i] == storage_dims[0].var) {
+            tiling.x = (int)i + offset;
+        } else if (args[i] == storage_dims[1].var) {
+            tiling.y = (int)i + offset;
+        }
+    }
+    for (size_t i = 2; i < storage_dims.size(); i++) {
+        user_assert(!storage_dims[i].tile_extent.defined())
+            << "Can't store " << f.name() << " in tiles, because the tiled dimensions are not "
+            << "the innermost storage dimensions. Don't call reorder_storage after store_tiled.\n";
+    }
+    internal_assert(tiling.x >= 0 && tiling.y >= 0 && storage_dims[1].tile_extent.defined());
+    tiling.x_tile = storage_dims[0].tile_extent;
+    tiling.y_tile = storage_dims[1].tile_extent;
+    return tiling;
+}
+
 class FlattenDimensions : public IRMutator {
 public:
     FlattenDimensions(const map<string, pair<Function, int>> &e,
@@ -37,7 +82,40 @@ private:
     set<string> outputs;
     const Target &target;
     Scope<int> realizations, shader_scope_realizations;
+    Scope<Tiling> tilings;
     bool in_shader = false;
+    int gpu_block_depth = 0, gpu_thread_depth = 0;
+
+    // Realizations inside a loop over gpu blocks, but not inside a
+    // loop over gpu threads, go in shared memory. Shared memory is
+    // split into 32 banks of 4-byte words, and the threads of a warp
+    // can only access different words of the same bank one at a
+    // time. Walking down a column of a 2D allocation whose rows span
+    // an even number of words (e.g. to transpose a tile) therefore
+    // makes the threads collide, on every bank at once if a row is a
+    // multiple of 128 bytes. Padding a row so that each one spans an
+    // odd number of words (or, for 8-byte types, an odd number of
+    // elements) spreads the column across all the banks. Returns the
+    // padded extent, or the extent itself if it isn't known or
+    // doesn't need padding.
+    Expr pad_for_shared_memory_banks(Expr extent, Type t) {
+        const int64_t *e = as_const_int(simplify(extent));
+        int bytes = t.bytes();
+        if (!e || *e <= 1 || bytes > 8 || (*e * bytes) % 4 != 0) {
+            return extent;
+        }
+        int64_t words = (*e * bytes) / 4;
+        int64_t padded = *e;
+        if (bytes <= 4 && words % 2 == 0) {
+            padded += 4 / bytes;
+        } else if (bytes == 8 && *e % 2 == 0) {
+            padded += 1;
+        }
+        if (padded != *e) {
+            debug(3) << "Padding shared extent " << *e << " to " << padded << "\n";
+        }
+        return make_const(extent.type(), padded);
+    }
 
     Expr make_shape_var(string name, string field, size_t dim,
                         const Buffer<> &buf, const Parameter &param) {
@@ -60,7 +138,37 @@ private:
             mins[i] = make_shape_var(name, "min", i, buf, param);
         }
 
-        if (internal) {
+        if (internal && tilings.contains(name)) {
+            // The tiles start at multiples of the tile extents, so
+            // that the tiles line up with loops split by them. Within
+            // a run of tiles along x, tile i starts at i * x_tile *
+            // y_tile, and each run spans y_tile rows.
+            const Tiling &tiling = tilings.get(name);
+            Expr u = args[tiling.x] - (mins[tiling.x] / tiling.x_tile) * tiling.x_tile;
+            Expr v = args[tiling.y] - (mins[tiling.y] / tiling.y_tile) * tiling.y_tile;
+            Expr within = (u % tiling.x_tile) + (v % tiling.y_tile) * tiling.x_tile +
+                (u / tiling.x_tile) * (tiling.x_tile * tiling.y_tile);
+            Expr row_of_tiles = v / tiling.y_tile;
+            Expr row_stride = strides[tiling.y] * tiling.y_tile;
+            for (size_t i = 0; i < args.size(); i++) {
+                Expr offset, stride;
+                if ((int)i == tiling.x) {
+                    offset = within;
+                    stride = strides[i];
+                } else if ((int)i == tiling.y) {
+                    offset = row_of_tiles;
+                    stride = row_stride;
+                } else {
+                    offset = args[i] - mins[i];
+                    stride = strides[i];
+                }
+                if (target.has_large_buffers()) {
+                    idx += cast<int64_t>(offset) * cast<int64_t>(stride);
+                } else {
+                    idx += offset * stride;
+                }
+            }
+        } else if (internal) {
             // f(x, y) -> f[(x-xmin)*xstride + (y-ymin)*ystride] This
             // strategy makes sense when we expect x to cancel with
             // something in xmin.  We use this for internal allocations
@@ -102,8 +210,25 @@ private:
             shader_scope_realizations.push(op->name, 0);
         }
 
+        Tiling tiling;
+        {
+            auto iter = env.find(op->name);
+            internal_assert(iter != env.end()) << "Realize node refers to function not in environment.\n";
+            tiling = find_tiling(iter->second.first, op->name);
+        }
+        if (tiling.defined()) {
+            tilings.push(op->name, tiling);
+        }
+
         Stmt body = mutate(op->body);
 
+        if (tiling.defined()) {
+            tilings.pop(op->name);
+            user_assert(!stmt_uses_var(body, op->name + ".buffer"))
+                << "Can't store " << op->name << " in tiles, because it is used by an "
+                << "extern stage or other code that needs a halide_buffer_t for it.\n";
+        }
+
         // Compute the size
         vector<Expr> extents;
         for (size_t i = 0; i < op->bounds.size(); i++) {
@@ -130,19 +255,44 @@ private:
             Function f = iter->second.first;
             const vector<StorageDim> &storage_dims = f.schedule().storage_dims();
             const vector<string> &args = f.args();
+            // The Tuple index of an interleaved Tuple is the
+            // innermost dimension.
+            size_t offset = 0;
+            if (is_interleaved_tuple(f, op->name)) {
+                storage_permutation.push_back(0);
+                allocation_extents[0] = extents[0];
+                offset = 1;
+            }
             for (size_t i = 0; i < storage_dims.size(); i++) {
                 for (size_t j = 0; j < args.size(); j++) {
                     if (args[j] == storage_dims[i].var) {
-                        storage_permutation.push_back((int)j);
+                        size_t k = j + offset;
+                        storage_permutation.push_back((int)k);
                         Expr alignment = storage_dims[i].alignment;
                         if (alignment.defined()) {
-                            allocation_extents[j] = ((extents[j] + alignment - 1)/alignment)*alignment;
+                            allocation_extents[k] = ((extents[k] + alignment - 1)/alignment)*alignment;
+                        } else if (i == 0 && storage_dims.size() > 1 &&
+                                   gpu_block_depth > 0 && gpu_thread_depth == 0 && !in_shader) {
+                            allocation_extents[k] = pad_for_shared_memory_banks(extents[k], op->types[0]);
                         } else {
-                            allocation_extents[j] = extents[j];
+                            allocation_extents[k] = extents[k];
                         }
                     }
                 }
-                internal_assert(storage_permutation.size() == i+1);
+                internal_assert(storage_permutation.size() == i+1+offset);
+            }
+        }
+
+        if (tiling.defined()) {
+            // Cover the realization with whole tiles, starting from
+            // the multiple of the tile extent at or below the min.
+            for (auto dim : {std::make_pair(tiling.x, tiling.x_tile),
+                             std::make_pair(tiling.y, tiling.y_tile)}) {
+                int j = dim.first;
+                Expr tile = dim.second;
+                Expr min = mutate(op->bounds[j].min);
+                Expr start = (min / tile) * tile;
+                allocation_extents[j] = ((min + extents[j] - start + tile - 1) / tile) * tile;
             }
         }
 
@@ -316,13 +466,18 @@ private:
                 Function f = iter->second.first;
                 const vector<StorageDim> &storage_dims = f.schedule().storage_dims();
                 const vector<string> &args = f.args();
+                size_t offset = 0;
+                if (is_interleaved_tuple(f, op->name)) {
+                    storage_permutation.push_back(0);
+                    offset = 1;
+                }
                 for (size_t i = 0; i < storage_dims.size(); i++) {
                     for (size_t j = 0; j < args.size(); j++) {
                         if (args[j] == storage_dims[i].var) {
-                            storage_permutation.push_back((int)j);
+                            storage_permutation.push_back((int)(j + offset));
                         }
                     }
-                    internal_assert(storage_permutation.size() == i+1);
+                    internal_assert(storage_permutation.size() == i+1+offset);
                 }
             }
             internal_assert(storage_permutation.size() == op->bounds.size());
@@ -363,7 +518,11 @@ private:
             loop->device_api == DeviceAPI::GLSL) {
             in_shader = true;
         }
+        int *depth = (loop->for_type == ForType::GPUBlock ? &gpu_block_depth :
+                      loop->for_type == ForType::GPUThread ? &gpu_thread_depth : nullptr);
+        if (depth) (*depth)++;
         IRMutator::visit(loop);
+        if (depth) (*depth)--;
         in_shader = old_in_shader;
     }
 
@@ -432,6 +591,10 @@ Stmt storage_flattening(Stmt s,
             for (int i = 0; i < p.second.outputs(); i++) {
                 tuple_env[p.first + "." + std::to_string(i)] = {p.second, i};
             }
+            if (p.second.schedule().interleave_tuple()) {
+                // Interleaved Tuples keep the name of the Function.
+                tuple_env[p.first] = {p.second, 0};
+            }
         } else {
             tuple_env[p.first] = {p.second, 0};
         }
@@ -293,11 +293,106 @@ public:
 
 
 
+// Check if the produce node of a func lies within a statement, but
+// not within any loop inside it.
+class ProducedOutsideLoops : public IRVisitor {
+    const string &name;
+
+    using IRVisitor::visit;
+
+    void visit(const For *op) {
+    }
+
+    void visit(const ProducerConsumer *op) {
+        if (op->is_producer && op->name == name) {
+            result = true;
+        } else {
+            IRVisitor::visit(op);
+        }
+    }
+
+public:
+    bool result = false;
+
+    ProducedOutsideLoops(const string &name) : name(name) {}
+};
+
+bool produced_outside_loops(Stmt s, const string &name) {
+    ProducedOutsideLoops p(name);
+    s.accept(&p);
+    return p.result;
+}
+
+// An async producer runs ahead of its consumer, so when its storage
+// is folded over the loop it is computed in, it must wait for the
+// consumer to be done with the slots in the fold it is about to
+// overwrite. Track the free slots with a semaphore, which is acquired
+// before each produce node and released after each consume node. The
+// pass that forks async producers keeps the acquires in the producer
+// and the releases in the consumer.
+class InjectFoldingSemaphore : public IRMutator {
+    const string &func;
+    Expr semaphore, to_acquire, to_release;
+
+    using IRMutator::visit;
+
+    void visit(const ProducerConsumer *op) {
+        if (op->name != func) {
+            IRMutator::visit(op);
+        } else if (op->is_producer) {
+            string result_name = unique_name('t');
+            Expr result = Variable::make(Int(32), result_name);
+            Expr acquire = Call::make(Int(32), "halide_semaphore_acquire",
+                                      {semaphore, to_acquire}, Call::Extern);
+            Stmt check = LetStmt::make(result_name, acquire,
+                                       AssertStmt::make(result == 0, result));
+            stmt = Block::make(check, op);
+        } else {
+            Expr release = Call::make(Int(32), "halide_semaphore_release",
+                                      {semaphore, to_release}, Call::Extern);
+            stmt = Block::make(op, Evaluate::make(release));
+        }
+    }
+
+public:
+    InjectFoldingSemaphore(const string &func, Expr semaphore, Expr to_acquire, Expr to_release)
+        : func(func), semaphore(semaphore), to_acquire(to_acquire), to_release(to_release) {}
+};
+
+// Check if an Expr uses any of the variables in a scope.
+class UsesVarsInScope : public IRVisitor {
+    const Scope<int> &scope;
+
+    using IRVisitor::visit;
+
+    void visit(const Variable *op) {
+        if (scope.contains(op->name)) {
+            result = true;
+        }
+    }
+
+public:
+    bool result = false;
+
+    UsesVarsInScope(const Scope<int> &scope) : scope(scope) {}
+};
+
+bool uses_vars_in_scope(Expr e, const Scope<int> &scope) {
+    UsesVarsInScope u(scope);
+    e.accept(&u);
+    return u.result;
+}
+
 // Attempt to fold the storage of a particular function in a statement
 class AttemptStorageFoldingOfFunction : public IRMutator {
     Function func;
     bool explicit_only;
 
+    // The variables defined inside the realization of the function,
+    // which fold factors chosen at runtime can't depend on, because
+    // they are computed outside of it.
+    Scope<int> inner_vars;
+
     using IRMutator::visit;
 
     void visit(const ProducerConsumer *op) {
@@ -309,6 +404,32 @@ class AttemptStorageFoldingOfFunction : public IRMutator {
         }
     }
 
+    void visit(const LetStmt *op) {
+        inner_vars.push(op->name, 0);
+        IRMutator::visit(op);
+        inner_vars.pop(op->name);
+    }
+
+    // Find an upper bound on the extent of the footprint over all
+    // iterations of a loop that can be computed outside of the
+    // realization, to use as a fold factor chosen at runtime.
+    Expr runtime_fold_factor(Expr extent, const For *op) {
+        Scope<Interval> scope;
+        scope.push(op->name, Interval::everything());
+        Interval bounds = bounds_of_expr_in_scope(extent, scope);
+        scope.pop(op->name);
+        if (!bounds.has_upper_bound()) {
+            return Expr();
+        }
+        Expr max_extent = simplify(bounds.max);
+        if (!is_pure(max_extent) ||
+            expr_uses_var(max_extent, op->name) ||
+            uses_vars_in_scope(max_extent, inner_vars)) {
+            return Expr();
+        }
+        return max_extent;
+    }
+
     void visit(const For *op) {
         if (op->for_type != ForType::Serial && op->for_type != ForType::Unrolled) {
             // We can't proceed into a parallel for loop.
@@ -327,7 +448,11 @@ class AttemptStorageFoldingOfFunction : public IRMutator {
         Box required = box_required(body, func.name());
         Box box = box_union(provided, required);
 
-        string dynamic_footprint;
+        vector<string> dynamic_footprints;
+        vector<Expr> dynamic_footprint_inits;
+        string folding_semaphore;
+        Expr folding_semaphore_init;
+        bool overlaps = false;
 
         // Try each dimension in turn from outermost in
         for (size_t i = box.size(); i > 0; i--) {
@@ -336,6 +461,7 @@ class AttemptStorageFoldingOfFunction : public IRMutator {
             Expr max = simplify(box[dim].max);
 
             const StorageDim &storage_dim = func.schedule().storage_dims()[dim];
+            string dynamic_footprint;
             Expr explicit_factor;
             if (!is_pure(min) ||
                 !is_pure(max) ||
@@ -369,7 +495,7 @@ class AttemptStorageFoldingOfFunction : public IRMutator {
                 // some stack space to store the valid footprint,
                 // update it outside produce nodes, and check it
                 // outside consume nodes.
-                dynamic_footprint = func.name() + "." + op->name + ".footprint";
+                dynamic_footprint = func.name() + "." + op->name + "." + storage_dim.var + ".footprint";
 
                 body = InjectFoldingCheck(func,
                                           dynamic_footprint,
@@ -410,8 +536,24 @@ class AttemptStorageFoldingOfFunction : public IRMutator {
 
                     const int max_fold = 1024;
                     const int64_t *const_max_extent = as_const_int(max_extent);
+                    Expr runtime_factor;
                     if (const_max_extent && *const_max_extent <= max_fold) {
                         factor = static_cast<int>(next_power_of_two(*const_max_extent));
+                    } else if (!const_max_extent &&
+                               (runtime_factor = runtime_fold_factor(extent, op)).defined()) {
+                        // The extent is bounded, but only by something
+                        // known at runtime. Compute the fold factor
+                        // just before the allocation, and check it at
+                        // each iteration in case the bound above was
+                        // too optimistic.
+                        string factor_name = func.name() + "." + storage_dim.var + ".fold_factor";
+                        factor = Variable::make(Int(32), factor_name);
+                        Expr error = Call::make(Int(32), "halide_error_fold_factor_too_small",
+                                                {func.name(), storage_dim.var, factor, op->name, extent},
+                                                Call::Extern);
+                        body = Block::make(AssertStmt::make(extent <= factor, error), body);
+                        debug(3) << "Folding by a factor computed at runtime: " << runtime_factor << "\n";
+                        runtime_factors.push_back({factor_name, dim, runtime_factor});
                     } else {
                         debug(3) << "Not folding because extent not bounded by a constant not greater than " << max_fold << "\n"
                                  << "extent = " << extent << "\n"
@@ -419,6 +561,15 @@ class AttemptStorageFoldingOfFunction : public IRMutator {
                     }
                 }
 
+                bool async_fold = func.schedule().async() && produced_outside_loops(op->body, func.name());
+                if (factor.defined() && async_fold && !folding_semaphore.empty()) {
+                    // The semaphore can only track the free slots
+                    // of a fold in one dimension.
+                    debug(3) << "Not folding " << func.name() << " in another dimension over "
+                             << op->name << ", because it is scheduled async\n";
+                    factor = Expr();
+                }
+
                 if (factor.defined()) {
                     debug(3) << "Proceeding with factor " << factor << "\n";
 
@@ -426,31 +577,52 @@ class AttemptStorageFoldingOfFunction : public IRMutator {
                     dims_folded.push_back(fold);
                     body = FoldStorageOfFunction(func.name(), (int)i - 1, factor, dynamic_footprint).mutate(body);
 
-                    Expr next_var = Variable::make(Int(32), op->name) + 1;
+                    Expr loop_var = Variable::make(Int(32), op->name);
+                    Expr next_var = loop_var + 1;
                     Expr next_min = substitute(op->name, next_var, min);
-                    if (can_prove(max < next_min)) {
-                        // There's no overlapping usage between loop
-                        // iterations, so we can continue to search
-                        // for further folding opportinities
-                        // recursively.
-                    } else if (!body.same_as(op->body)) {
-                        stmt = For::make(op->name, op->min, op->extent, op->for_type, op->device_api, body);
-                        if (!dynamic_footprint.empty()) {
-                            Expr init_val;
-                            if (min_monotonic_increasing) {
-                                init_val = Int(32).min();
-                            } else {
-                                init_val = Int(32).max();
-                            }
-                            Stmt init_min = Store::make(dynamic_footprint, init_val, 0, Parameter(), const_true());
-                            stmt = Block::make(init_min, stmt);
-                            stmt = Allocate::make(dynamic_footprint, Int(32), {}, const_true(), stmt);
+
+                    if (async_fold) {
+                        // The first iteration produces the whole
+                        // window, and each later one the part of it
+                        // that slid in. After each iteration the
+                        // consumer is done with the part of the window
+                        // that slides out.
+                        Expr prev_var = loop_var - 1;
+                        Expr to_acquire, to_release;
+                        if (min_monotonic_increasing) {
+                            to_acquire = max - substitute(op->name, prev_var, max);
+                            to_release = next_min - min;
+                        } else {
+                            to_acquire = substitute(op->name, prev_var, min) - min;
+                            to_release = max - substitute(op->name, next_var, max);
                         }
-                        return;
-                    } else {
-                        stmt = op;
-                        return;
+                        to_acquire = select(loop_var == op->min, extent, to_acquire);
+                        to_acquire = Halide::min(Halide::max(to_acquire, 0), factor);
+                        to_release = Halide::max(to_release, 0);
+
+                        folding_semaphore = func.name() + ".folding_semaphore." + op->name;
+                        folding_semaphore_init =
+                            Call::make(Handle(), Call::make_struct, {factor, 0, 0, 0}, Call::Intrinsic);
+                        Expr sema = Variable::make(Handle(), folding_semaphore);
+                        body = InjectFoldingSemaphore(func.name(), sema,
+                                                      simplify(to_acquire),
+                                                      simplify(to_release)).mutate(body);
+                    }
+                    if (!dynamic_footprint.empty()) {
+                        dynamic_footprints.push_back(dynamic_footprint);
+                        dynamic_footprint_inits.push_back(min_monotonic_increasing ? Int(32).min() : Int(32).max());
+                    }
+
+                    if (!can_prove(max < next_min)) {
+                        // There's overlapping usage between loop
+                        // iterations, so we can't fold in any inner
+                        // loops. Each dimension is folded
+                        // independently, so we can still fold the
+                        // remaining ones over this loop.
+                        overlaps = true;
                     }
+                    // Otherwise we can continue to search for further
+                    // folding opportunities recursively.
                 }
             } else {
                 debug(3) << "Not folding because loop min or max not monotonic in the loop variable\n"
@@ -462,14 +634,25 @@ class AttemptStorageFoldingOfFunction : public IRMutator {
         // If there's no communication of values from one loop
         // iteration to the next (which may happen due to sliding),
         // then we're safe to fold an inner loop.
-        if (box_contains(provided, required)) {
+        if (!overlaps && box_contains(provided, required)) {
+            inner_vars.push(op->name, 0);
             body = mutate(body);
+            inner_vars.pop(op->name);
         }
 
         if (body.same_as(op->body)) {
             stmt = op;
-        } else {
-            stmt = For::make(op->name, op->min, op->extent, op->for_type, op->device_api, body);
+            return;
+        }
+
+        stmt = For::make(op->name, op->min, op->extent, op->for_type, op->device_api, body);
+        for (size_t i = 0; i < dynamic_footprints.size(); i++) {
+            Stmt init = Store::make(dynamic_footprints[i], dynamic_footprint_inits[i], 0, Parameter(), const_true());
+            stmt = Block::make(init, stmt);
+            stmt = Allocate::make(dynamic_footprints[i], Int(32), {}, const_true(), stmt);
+        }
+        if (!folding_semaphore.empty()) {
+            stmt = LetStmt::make(folding_semaphore, folding_semaphore_init, stmt);
         }
     }
 
@@ -480,6 +663,15 @@ public:
     };
     vector<Fold> dims_folded;
 
+    // The fold factors chosen at runtime, which must be defined
+    // outside the realization.
+    struct RuntimeFactor {
+        string name;
+        int dim;
+        Expr value;
+    };
+    vector<RuntimeFactor> runtime_factors;
+
     AttemptStorageFoldingOfFunction(Function f, bool explicit_only)
         : func(f), explicit_only(explicit_only) {}
 };
@@ -498,6 +690,28 @@ class StorageFolding : public IRMutator {
         auto func_it = env.find(op->name);
         Function func = func_it != env.end() ? func_it->second : Function();
 
+        if (func_it != env.end() && !func.schedule().stream_var().empty()) {
+            // Streamed Funcs are folded along the streaming dimension
+            // over the whole pipeline, so that each value stays where
+            // the next call of the pipeline expects to find it.
+            const vector<string> args = func.args();
+            for (size_t i = 0; i < args.size(); i++) {
+                if (args[i] != func.schedule().stream_var()) continue;
+                const StorageDim &storage_dim = func.schedule().storage_dims()[i];
+                Expr factor = storage_dim.fold_factor;
+                body = FoldStorageOfFunction(op->name, (int)i, factor, "").mutate(body);
+                Region bounds = op->bounds;
+                Expr extent = bounds[i].extent;
+                bounds[i] = Range(0, factor);
+                Expr error = Call::make(Int(32), "halide_error_fold_factor_too_small",
+                                        {func.name(), storage_dim.var, factor, op->name + ".stream", extent},
+                                        Call::Extern);
+                stmt = Realize::make(op->name, op->types, bounds, op->condition, body);
+                stmt = Block::make(AssertStmt::make(extent <= factor, error), stmt);
+                return;
+            }
+        }
+
         // Don't attempt automatic storage folding if there is
         // more than one produce node for this func.
         bool explicit_only = count_producers(body, op->name) != 1;
@@ -522,6 +736,13 @@ class StorageFolding : public IRMutator {
             }
 
             stmt = Realize::make(op->name, op->types, bounds, op->condition, body);
+
+            // There's no point making a runtime fold factor larger than
+            // the extent of the realization.
+            for (const auto &f : folder.runtime_factors) {
+                Expr value = Halide::max(Halide::min(f.value, op->bounds[f.dim].extent), 1);
+                stmt = LetStmt::make(f.name, simplify(value), stmt);
+            }
         }
     }
 
@@ -0,0 +1,225 @@
+#include "Streaming.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+#include "Function.h"
+#include "Debug.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::string;
+using std::vector;
+
+namespace {
+
+// The index of the dimension a Func is streamed along.
+int stream_dim(const Function &f) {
+    const vector<string> args = f.args();
+    for (size_t i = 0; i < args.size(); i++) {
+        if (args[i] == f.schedule().stream_var()) {
+            return (int)i;
+        }
+    }
+    internal_error << "Could not find the streaming dimension of " << f.name() << "\n";
+    return -1;
+}
+
+// Start the loop over the streaming dimension of the producer at the
+// first value the previous call didn't compute.
+class SkipComputedValues : public IRMutator {
+    const string &var;
+    Expr start;
+
+    using IRMutator::visit;
+
+    void visit(const LetStmt *op) {
+        if (op->name == var + ".loop_min") {
+            stmt = LetStmt::make(op->name, start, mutate(op->body));
+        } else if (op->name == var + ".loop_extent") {
+            Expr max = Variable::make(Int(32), var + ".loop_max");
+            stmt = LetStmt::make(op->name, max + 1 - start, mutate(op->body));
+        } else {
+            IRMutator::visit(op);
+        }
+    }
+
+public:
+    SkipComputedValues(const string &var, Expr start) : var(var), start(start) {}
+};
+
+class InjectStreaming : public IRMutator {
+    const map<string, Function> &env;
+    const string &pipeline_name;
+
+    using IRMutator::visit;
+
+    // The name of the streamed Func whose realization we're in, what
+    // to start its producer at, and how to update its header once
+    // it's done.
+    string func;
+    Expr start;
+    Stmt update_header;
+
+    void visit(const ProducerConsumer *op) {
+        if (op->is_producer && op->name == func) {
+            const Function &f = env.find(func)->second;
+            string var = f.name() + ".s0." + f.args()[stream_dim(f)];
+            Stmt produce = SkipComputedValues(var, start).mutate(op);
+            stmt = Block::make(produce, update_header);
+        } else {
+            IRMutator::visit(op);
+        }
+    }
+
+    void visit(const Realize *op) {
+        auto iter = env.find(op->name);
+        if (iter == env.end() || iter->second.schedule().stream_var().empty()) {
+            IRMutator::visit(op);
+            return;
+        }
+        const Function &f = iter->second;
+        const int dim = stream_dim(f);
+        const Expr factor = f.schedule().storage_dims()[dim].fold_factor;
+        internal_assert(factor.defined());
+
+        // The header is an array of int32s: whether the previous call
+        // computed anything, the range along the streaming dimension
+        // that is still held in the folded storage, and the min and
+        // extent of the realization in each of the other dimensions.
+        string state = f.name() + ".stream.state";
+        auto header = [&](int i) {
+            return Load::make(Int(32), state, i, Buffer<>(), Parameter(), const_true());
+        };
+        auto set_header = [&](int i, Expr value) {
+            return Store::make(state, value, i, Parameter(), const_true());
+        };
+
+        string prefix = f.name() + ".s0." + f.args()[dim];
+        Expr t_min = Variable::make(Int(32), prefix + ".min");
+        Expr t_max = Variable::make(Int(32), prefix + ".max");
+
+        // The stream continues if this call needs a region that starts
+        // within the values held and doesn't end before them, and the
+        // storage has the same shape as in the previous call.
+        Expr resume = (header(0) != 0 &&
+                       t_min >= header(1) &&
+                       t_min <= header(2) + 1 &&
+                       t_max >= header(2));
+        Expr resume_var = Variable::make(Bool(), f.name() + ".stream.resume");
+        Expr start_var = Variable::make(Int(32), f.name() + ".stream.start");
+        Expr valid_min_var = Variable::make(Int(32), f.name() + ".stream.valid_min");
+
+        vector<Stmt> updates;
+        updates.push_back(set_header(0, 1));
+        updates.push_back(set_header(1, valid_min_var));
+        updates.push_back(set_header(2, t_max));
+        int slots = 3;
+        for (int i = 0; i < (int)op->bounds.size(); i++) {
+            if (i == dim) continue;
+            resume = resume && (header(slots) == op->bounds[i].min &&
+                                header(slots + 1) == op->bounds[i].extent);
+            updates.push_back(set_header(slots, op->bounds[i].min));
+            updates.push_back(set_header(slots + 1, op->bounds[i].extent));
+            slots += 2;
+        }
+
+        string old_func = func;
+        Expr old_start = start;
+        Stmt old_update_header = update_header;
+        func = op->name;
+        start = start_var;
+        update_header = Block::make(updates);
+        Stmt body = mutate(op->body);
+        func = old_func;
+        start = old_start;
+        update_header = old_update_header;
+
+        debug(3) << "Streaming " << f.name() << " along " << f.args()[dim] << "\n";
+
+        stmt = Realize::make(op->name, op->types, op->bounds, op->condition, body);
+
+        // After this call, the folded storage holds the values from
+        // where the stream started, up to the fold factor back from
+        // the last one computed.
+        Expr valid_min = max(select(resume_var, header(1), t_min), t_max - factor + 1);
+        stmt = LetStmt::make(valid_min_var.as<Variable>()->name, valid_min, stmt);
+        stmt = LetStmt::make(start_var.as<Variable>()->name,
+                             select(resume_var, header(2) + 1, t_min), stmt);
+        stmt = LetStmt::make(resume_var.as<Variable>()->name, resume, stmt);
+
+        Expr acquire = Call::make(Handle(), "halide_stream_state_acquire",
+                                  {pipeline_name + "." + f.name(), slots * 4},
+                                  Call::Extern);
+        stmt = Allocate::make(state, Int(32), {slots}, const_true(), stmt,
+                              acquire, "halide_stream_state_release");
+    }
+
+public:
+    InjectStreaming(const map<string, Function> &env, const string &pipeline_name)
+        : env(env), pipeline_name(pipeline_name) {}
+};
+
+class RewriteStreamedAllocations : public IRMutator {
+    const map<string, Function> &env;
+
+    using IRMutator::visit;
+
+    void visit(const Allocate *op) {
+        auto iter = env.find(op->name);
+        if (iter == env.end() ||
+            iter->second.schedule().stream_var().empty() ||
+            op->new_expr.defined()) {
+            IRMutator::visit(op);
+            return;
+        }
+
+        Expr size = make_const(UInt(64), op->type.bytes());
+        for (Expr e : op->extents) {
+            size *= cast(UInt(64), e);
+        }
+        Expr header = Variable::make(Handle(), op->name + ".stream.state");
+        Expr data = Call::make(Handle(), "halide_stream_state_data", {header, size}, Call::Extern);
+        stmt = Allocate::make(op->name, op->type, op->extents, op->condition, mutate(op->body),
+                              data, "halide_stream_state_release");
+    }
+
+public:
+    RewriteStreamedAllocations(const map<string, Function> &env) : env(env) {}
+};
+
+}  // namespace
+
+Stmt inject_streaming(Stmt s, const map<string, Function> &env,
+                      const string &pipeline_name,
+                      const vector<Function> &outputs) {
+    bool any_streamed = false;
+    for (const auto &p : env) {
+        const Function &f = p.second;
+        if (f.schedule().stream_var().empty()) continue;
+        any_streamed = true;
+        for (const Function &o : outputs) {
+            user_assert(!f.same_as(o))
+                << "Func " << f.name() << " cannot be streamed because it is an output of pipeline "
+                << pipeline_name << ".\n";
+        }
+        user_assert(f.schedule().compute_level().is_root())
+            << "Func " << f.name() << " cannot be streamed because it is not computed at root.\n";
+        user_assert(!f.has_update_definition() && !f.has_extern_definition())
+            << "Func " << f.name() << " cannot be streamed because it has update definitions "
+            << "or an extern definition.\n";
+        user_assert(f.outputs() == 1)
+            << "Func " << f.name() << " cannot be streamed because it is Tuple-valued.\n";
+    }
+    if (!any_streamed) {
+        return s;
+    }
+    return InjectStreaming(env, pipeline_name).mutate(s);
+}
+
+Stmt rewrite_streamed_allocations(Stmt s, const map<string, Function> &env) {
+    return RewriteStreamedAllocations(env).mutate(s);
+}
+
+}
+}
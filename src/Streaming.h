@@ -0,0 +1,34 @@
+#ifndef HALIDE_STREAMING_H
+#define HALIDE_STREAMING_H
+
+/** \file
+ *
+ * Defines the lowering passes that keep the values of Funcs scheduled
+ * with Func::stream from one call of a pipeline to the next.
+ */
+
+#include <map>
+
+#include "IR.h"
+
+namespace Halide {
+namespace Internal {
+
+/** Only compute the part of each streamed Func that the previous call
+ * of the pipeline didn't, and record the part computed by this
+ * one. The header recording it lives in the runtime. Should be
+ * called after allocation bounds inference, and before storage
+ * folding folds the storage of streamed Funcs along the streaming
+ * dimension. */
+Stmt inject_streaming(Stmt s, const std::map<std::string, Function> &env,
+                      const std::string &pipeline_name,
+                      const std::vector<Function> &outputs);
+
+/** Point the allocations of streamed Funcs at the storage the runtime
+ * keeps for them. Should be called after storage flattening. */
+Stmt rewrite_streamed_allocations(Stmt s, const std::map<std::string, Function> &env);
+
+}
+}
+
+#endif
@@ -0,0 +1,252 @@
+#include "StrengthReduce.h"
+#include "ExprUsesVar.h"
+#include "IREquality.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+#include "Scope.h"
+#include "Simplify.h"
+#include "Substitute.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::string;
+using std::vector;
+
+namespace {
+
+// The most induction variables to introduce per loop. Each one
+// occupies a scalar register for the duration of the loop.
+const int max_induction_variables = 4;
+
+// Check if an Expr is a function of only the variables it uses. Unlike
+// is_pure, this rejects loads from inputs, because an output could be
+// written in the loop.
+class IsArithmetic : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const Load *op) {
+        result = false;
+    }
+
+    void visit(const Call *op) {
+        if (!op->is_pure()) {
+            result = false;
+        } else {
+            IRVisitor::visit(op);
+        }
+    }
+
+public:
+    bool result = true;
+};
+
+bool is_arithmetic(const Expr &e) {
+    IsArithmetic check;
+    e.accept(&check);
+    return check.result;
+}
+
+// Replace the index expressions in the body of a single loop that
+// step by a non-constant amount with induction variables. Doesn't
+// look inside nested loops; they are handled when the loops
+// themselves are visited.
+class ReduceLoopBody : public IRMutator {
+    using IRMutator::visit;
+
+    string loop_var;
+
+    // The values of the LetStmts containing the current node, with
+    // the values of any LetStmts they use substituted in.
+    map<string, Expr> lets;
+
+    // Names bound by Lets inside exprs. Expressions that use them
+    // can't be moved to the loop top.
+    Scope<int> inner_lets;
+
+    Expr reduce(const Expr &e) {
+        if (e.type() != Int(32) ||
+            is_const(e) ||
+            e.as<Variable>()) {
+            return mutate(e);
+        }
+
+        Expr expanded = substitute(lets, e);
+        if (expr_uses_vars(expanded, inner_lets) ||
+            !expr_uses_var(expanded, loop_var) ||
+            !is_arithmetic(expanded)) {
+            return mutate(e);
+        }
+
+        Expr v = Variable::make(Int(32), loop_var);
+        Expr step = simplify(substitute(loop_var, v + 1, expanded) - expanded);
+        if (expr_uses_var(step, loop_var) || is_const(step)) {
+            // Either the expression isn't linear in the loop
+            // variable, or it steps by a constant, which LLVM
+            // strength reduces just fine by itself.
+            return mutate(e);
+        }
+
+        for (const InductionVariable &iv : result) {
+            if (equal(iv.value, expanded)) {
+                return Variable::make(Int(32), iv.name);
+            }
+        }
+
+        if ((int)result.size() >= max_induction_variables) {
+            return mutate(e);
+        }
+
+        InductionVariable iv = {unique_name('i'), expanded, step};
+        result.push_back(iv);
+        debug(3) << "Strength reducing " << e << " in loop over " << loop_var
+                 << " with step " << step << "\n";
+        return Variable::make(Int(32), iv.name);
+    }
+
+    void visit(const LetStmt *op) {
+        Expr value = reduce(op->value);
+        lets[op->name] = substitute(lets, op->value);
+        Stmt body = mutate(op->body);
+        lets.erase(op->name);
+        if (value.same_as(op->value) && body.same_as(op->body)) {
+            stmt = op;
+        } else {
+            stmt = LetStmt::make(op->name, value, body);
+        }
+    }
+
+    void visit(const Let *op) {
+        Expr value = mutate(op->value);
+        inner_lets.push(op->name, 0);
+        Expr body = mutate(op->body);
+        inner_lets.pop(op->name);
+        if (value.same_as(op->value) && body.same_as(op->body)) {
+            expr = op;
+        } else {
+            expr = Let::make(op->name, value, body);
+        }
+    }
+
+    Expr reduce_index(const Expr &index) {
+        if (const Ramp *r = index.as<Ramp>()) {
+            Expr base = reduce(r->base);
+            Expr stride = mutate(r->stride);
+            if (base.same_as(r->base) && stride.same_as(r->stride)) {
+                return index;
+            }
+            return Ramp::make(base, stride, r->lanes);
+        } else {
+            return reduce(index);
+        }
+    }
+
+    void visit(const Load *op) {
+        Expr index = reduce_index(op->index);
+        Expr predicate = mutate(op->predicate);
+        if (index.same_as(op->index) && predicate.same_as(op->predicate)) {
+            expr = op;
+        } else {
+            expr = Load::make(op->type, op->name, index, op->image, op->param, predicate);
+        }
+    }
+
+    void visit(const Store *op) {
+        Expr value = mutate(op->value);
+        Expr index = reduce_index(op->index);
+        Expr predicate = mutate(op->predicate);
+        if (value.same_as(op->value) && index.same_as(op->index) && predicate.same_as(op->predicate)) {
+            stmt = op;
+        } else {
+            stmt = Store::make(op->name, value, index, op->param, predicate);
+        }
+    }
+
+    void visit(const For *op) {
+        stmt = op;
+    }
+
+public:
+    struct InductionVariable {
+        string name;
+        Expr value, step;
+    };
+    vector<InductionVariable> result;
+
+    ReduceLoopBody(const string &v) : loop_var(v) {}
+};
+
+class StrengthReduce : public IRMutator {
+    using IRMutator::visit;
+
+    void visit(const For *op) {
+        if (op->device_api != DeviceAPI::None &&
+            op->device_api != DeviceAPI::Host) {
+            // Leave code for other devices alone.
+            stmt = op;
+            return;
+        }
+
+        Stmt body = mutate(op->body);
+
+        if (op->for_type != ForType::Serial || is_one(op->extent)) {
+            if (body.same_as(op->body)) {
+                stmt = op;
+            } else {
+                stmt = For::make(op->name, op->min, op->extent, op->for_type, op->device_api, body);
+            }
+            return;
+        }
+
+        ReduceLoopBody reducer(op->name);
+        body = reducer.mutate(body);
+
+        // Each induction variable lives in a one-element stack
+        // allocation, which LLVM promotes to a register. It's read at
+        // the top of each iteration and incremented at the bottom.
+        vector<Stmt> increments;
+        for (const auto &iv : reducer.result) {
+            string scratch = iv.name + ".iv";
+            Expr current = Variable::make(Int(32), iv.name);
+            increments.push_back(Store::make(scratch, current + iv.step, 0, Parameter(), const_true()));
+        }
+        if (!increments.empty()) {
+            body = Block::make(body, Block::make(increments));
+        }
+        for (size_t i = reducer.result.size(); i > 0; i--) {
+            const auto &iv = reducer.result[i-1];
+            Expr current = Load::make(Int(32), iv.name + ".iv", 0, Buffer<>(), Parameter(), const_true());
+            body = LetStmt::make(iv.name, current, body);
+        }
+
+        if (body.same_as(op->body)) {
+            stmt = op;
+        } else {
+            stmt = For::make(op->name, op->min, op->extent, op->for_type, op->device_api, body);
+        }
+
+        // The initial values are lets, so that if they depend on an
+        // enclosing loop they are strength reduced in turn.
+        for (size_t i = reducer.result.size(); i > 0; i--) {
+            const auto &iv = reducer.result[i-1];
+            string scratch = iv.name + ".iv";
+            string initial = iv.name + ".initial";
+            Expr value = simplify(substitute(op->name, op->min, iv.value));
+            Stmt init = Store::make(scratch, Variable::make(Int(32), initial), 0, Parameter(), const_true());
+            init = LetStmt::make(initial, value, init);
+            // Early frees have already been injected, so free it here.
+            stmt = Block::make({init, stmt, Free::make(scratch)});
+            stmt = Allocate::make(scratch, Int(32), {1}, const_true(), stmt);
+        }
+    }
+};
+
+}
+
+Stmt strength_reduce(Stmt s) {
+    return StrengthReduce().mutate(s);
+}
+
+}
+}
@@ -0,0 +1,27 @@
+#ifndef HALIDE_STRENGTH_REDUCE_H
+#define HALIDE_STRENGTH_REDUCE_H
+
+/** \file
+ * Defines the lowering pass that replaces address arithmetic in loops
+ * with induction variables.
+ */
+
+#include "IR.h"
+
+namespace Halide {
+namespace Internal {
+
+/** Find integer index expressions in serial loops that grow by a
+ * runtime amount on each iteration (e.g. y * stride + offset in a
+ * loop over y), and compute them by adding that amount to an
+ * induction variable on each iteration instead of from scratch. The
+ * expressions considered are load and store indices and the values of
+ * lets that LICM has lifted out of inner loops, so the base address
+ * of each inner loop is also computed incrementally across the loop
+ * nest. Done after loop invariant code motion. */
+Stmt strength_reduce(Stmt s);
+
+}
+}
+
+#endif
@@ -51,12 +51,14 @@ struct Target {
         NoNEON = halide_target_feature_no_neon,
         VSX = halide_target_feature_vsx,
         POWER_ARCH_2_07 = halide_target_feature_power_arch_2_07,
+        POWER_ARCH_3_00 = halide_target_feature_power_arch_3_00,
         CUDA = halide_target_feature_cuda,
         CUDACapability30 = halide_target_feature_cuda_capability30,
         CUDACapability32 = halide_target_feature_cuda_capability32,
         CUDACapability35 = halide_target_feature_cuda_capability35,
         CUDACapability50 = halide_target_feature_cuda_capability50,
         CUDACapability61 = halide_target_feature_cuda_capability61,
+        CUDACapability70 = halide_target_feature_cuda_capability70,
         OpenCL = halide_target_feature_opencl,
         CLDoubles = halide_target_feature_cl_doubles,
         OpenGL = halide_target_feature_opengl,
@@ -85,6 +87,20 @@ struct Target {
         TraceLoads = halide_target_feature_trace_loads,
         TraceStores = halide_target_feature_trace_stores,
         TraceRealizations = halide_target_feature_trace_realizations,
+        PackAllocations = halide_target_feature_pack_allocations,
+        ARMDotProd = halide_target_feature_arm_dot_prod,
+        LoopCarry = halide_target_feature_loop_carry,
+        FuseGPUKernels = halide_target_feature_fuse_gpu_kernels,
+        SpecializeUnitStride = halide_target_feature_specialize_unit_stride,
+        LazySpecializations = halide_target_feature_lazy_specializations,
+        OptLevel0 = halide_target_feature_opt_level_0,
+        OptLevel1 = halide_target_feature_opt_level_1,
+        PreciseMath = halide_target_feature_precise_math,
+        FastMath = halide_target_feature_fast_math,
+        ARMFp16 = halide_target_feature_arm_fp16,
+        SharedMemoizationCache = halide_target_feature_shared_memoization_cache,
+        SoftwarePipeline = halide_target_feature_software_pipeline,
+        OpenMP = halide_target_feature_openmp,
         FeatureEnd = halide_target_feature_end
     };
     Target() : os(OSUnknown), arch(ArchUnknown), bits(0) {}
@@ -169,6 +185,19 @@ struct Target {
         return copy;
     }
 
+    /** The optimization level to compile at, from 0 to 2. This is 2
+     * (the default) unless the OptLevel0 or OptLevel1 features are
+     * set. If both are set, the lower level wins. */
+    int opt_level() const {
+        if (has_feature(OptLevel0)) {
+            return 0;
+        } else if (has_feature(OptLevel1)) {
+            return 1;
+        } else {
+            return 2;
+        }
+    }
+
     /** Is a fully feature GPU compute runtime enabled? I.e. is
      * Func::gpu_tile and similar going to work? Currently includes
      * CUDA, OpenCL, and Metal. We do not include OpenGL, because it
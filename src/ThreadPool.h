@@ -135,20 +135,36 @@ public:
     }
 };
 
+// Exceptions thrown by a job (e.g. Halide errors) are handed to
+// whoever waits on its future, rather than escaping the worker thread.
 template<typename T>
 inline void ThreadPool<T>::Job::run_unlocked(std::unique_lock<std::mutex> &unique_lock) {
     unique_lock.unlock();
-    T r = func();
-    unique_lock.lock();
-    result.set_value(std::move(r));
+    try {
+        T r = func();
+        unique_lock.lock();
+        result.set_value(std::move(r));
+    } catch (...) {
+        if (!unique_lock.owns_lock()) {
+            unique_lock.lock();
+        }
+        result.set_exception(std::current_exception());
+    }
 }
 
 template<>
 inline void ThreadPool<void>::Job::run_unlocked(std::unique_lock<std::mutex> &unique_lock) {
     unique_lock.unlock();
-    func();
-    unique_lock.lock();
-    result.set_value();
+    try {
+        func();
+        unique_lock.lock();
+        result.set_value();
+    } catch (...) {
+        if (!unique_lock.owns_lock()) {
+            unique_lock.lock();
+        }
+        result.set_exception(std::current_exception());
+    }
 }
 
 
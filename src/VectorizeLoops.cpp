@@ -1,4 +1,5 @@
 #include <algorithm>
+#include <set>
 
 #include "VectorizeLoops.h"
 #include "IRMutator.h"
@@ -13,6 +14,7 @@
 #include "Simplify.h"
 #include "CSE.h"
 #include "CodeGen_GPU_Dev.h"
+#include "CodeGen_Internal.h"
 
 namespace Halide {
 namespace Internal {
@@ -20,6 +22,7 @@ namespace Internal {
 using std::string;
 using std::vector;
 using std::pair;
+using std::map;
 
 namespace {
 
@@ -236,6 +239,9 @@ class PredicateLoadStore : public IRMutator {
     string var;
     Expr vector_predicate;
     bool in_hexagon;
+    // Whether the loop was split with TailStrategy::Predicate, in
+    // which case we predicate regardless of the target.
+    bool force;
     const Target &target;
     int lanes;
     bool valid;
@@ -248,6 +254,10 @@ class PredicateLoadStore : public IRMutator {
             internal_assert(target.features_any_of({Target::HVX_64, Target::HVX_128}))
                 << "We are inside a hexagon loop, but the target doesn't have hexagon's features\n";
             return true;
+        } else if (force) {
+            // Codegen will use masked loads and stores where the
+            // target has them, and emulate them otherwise.
+            return true;
         } else if (target.arch == Target::X86) {
             // Should only attempt to predicate store/load if the lane size is
             // no less than 4
@@ -338,8 +348,8 @@ class PredicateLoadStore : public IRMutator {
     }
 
 public:
-    PredicateLoadStore(string v, Expr vpred, bool in_hexagon, const Target &t) :
-            var(v), vector_predicate(vpred), in_hexagon(in_hexagon), target(t),
+    PredicateLoadStore(string v, Expr vpred, bool in_hexagon, bool force, const Target &t) :
+            var(v), vector_predicate(vpred), in_hexagon(in_hexagon), force(force), target(t),
             lanes(vpred.type().lanes()), valid(true), vectorized(false) {
         internal_assert(lanes > 1);
     }
@@ -362,6 +372,8 @@ class VectorSubs : public IRMutator {
 
     bool in_hexagon; // Are we inside the hexagon loop?
 
+    bool force_predicate; // Was the loop split with TailStrategy::Predicate?
+
     // A suffix to attach to widened variables.
     string widening_suffix;
 
@@ -651,7 +663,102 @@ class VectorSubs : public IRMutator {
         }
     }
 
+    // Vectorize an atomic read-modify-write of a single location by
+    // reducing the vector of updates to a scalar first.
+    Stmt vectorize_atomic_store(const Store *op, Expr value) {
+        Expr predicate = mutate(op->predicate);
+        Expr index = mutate(op->index);
+        user_assert(index.type().is_scalar() && predicate.type().is_scalar())
+            << "The stores to " << op->name << " are atomic, so they can only be "
+            << "vectorized over RVars that don't change the location stored to.\n";
+
+        // Peel off any lets, to be reapplied to the update.
+        vector<pair<string, Expr>> lets;
+        while (const Let *let = value.as<Let>()) {
+            lets.push_back({let->name, let->value});
+            value = let->body;
+        }
+
+        VectorReduce::Operator reduce_op = VectorReduce::Add;
+        Expr a, b;
+        if (const Add *add = value.as<Add>()) {
+            a = add->a;
+            b = add->b;
+        } else if (const Mul *mul = value.as<Mul>()) {
+            reduce_op = VectorReduce::Mul;
+            a = mul->a;
+            b = mul->b;
+        } else if (const Min *min = value.as<Min>()) {
+            reduce_op = VectorReduce::Min;
+            a = min->a;
+            b = min->b;
+        } else if (const Max *max = value.as<Max>()) {
+            reduce_op = VectorReduce::Max;
+            a = max->a;
+            b = max->b;
+        } else if (const And *and_ = value.as<And>()) {
+            reduce_op = VectorReduce::And;
+            a = and_->a;
+            b = and_->b;
+        } else if (const Or *or_ = value.as<Or>()) {
+            reduce_op = VectorReduce::Or;
+            a = or_->a;
+            b = or_->b;
+        }
+
+        // One side must be the old value, and the other must not
+        // depend on it.
+        const Load *old = a.as<Load>();
+        Expr update = b;
+        if (!old || old->name != op->name || !equal(old->index, op->index)) {
+            old = b.as<Load>();
+            update = a;
+        }
+        user_assert(old && old->name == op->name && equal(old->index, op->index) &&
+                    substitute_atomic_location(update, op->name, op->index, 0).same_as(update))
+            << "The stores to " << op->name << " are atomic, so they can only be "
+            << "vectorized if each update combines the old value with something that"
+            << " doesn't depend on it using +, *, min, max, && or ||.\n";
+
+        for (size_t i = lets.size(); i > 0; i--) {
+            update = Let::make(lets[i-1].first, lets[i-1].second, update);
+        }
+        update = widen(mutate(update), replacement.type().lanes());
+        Expr reduced = VectorReduce::make(reduce_op, update, 1);
+
+        Expr old_value = Load::make(old->type, old->name, index, old->image, old->param, predicate);
+        Expr new_value;
+        switch (reduce_op) {
+        case VectorReduce::Add:
+            new_value = old_value + reduced;
+            break;
+        case VectorReduce::Mul:
+            new_value = old_value * reduced;
+            break;
+        case VectorReduce::Min:
+            new_value = Min::make(old_value, reduced);
+            break;
+        case VectorReduce::Max:
+            new_value = Max::make(old_value, reduced);
+            break;
+        case VectorReduce::And:
+            new_value = old_value && reduced;
+            break;
+        case VectorReduce::Or:
+            new_value = old_value || reduced;
+            break;
+        }
+        new_value = Call::make(new_value.type(), Call::atomic_update, {new_value}, Call::Intrinsic);
+        return Store::make(op->name, new_value, index, op->param, predicate);
+    }
+
     void visit(const Store *op) {
+        Expr atomic_value = unwrap_atomic_update(op->value);
+        if (atomic_value.defined()) {
+            stmt = vectorize_atomic_store(op, atomic_value);
+            return;
+        }
+
         Expr predicate = mutate(op->predicate);
         Expr value = mutate(op->value);
         Expr index = mutate(op->index);
@@ -691,12 +798,12 @@ class VectorSubs : public IRMutator {
             bool vectorize_predicate = !uses_gpu_vars(cond);
             Stmt predicated_stmt;
             if (vectorize_predicate) {
-                PredicateLoadStore p(var, cond, in_hexagon, target);
+                PredicateLoadStore p(var, cond, in_hexagon, force_predicate, target);
                 predicated_stmt = p.mutate(then_case);
                 vectorize_predicate = p.is_vectorized();
             }
             if (vectorize_predicate && else_case.defined()) {
-                PredicateLoadStore p(var, !cond, in_hexagon, target);
+                PredicateLoadStore p(var, !cond, in_hexagon, force_predicate, target);
                 predicated_stmt = Block::make(predicated_stmt, p.mutate(else_case));
                 vectorize_predicate = p.is_vectorized();
             }
@@ -907,8 +1014,8 @@ class VectorSubs : public IRMutator {
     }
 
 public:
-    VectorSubs(string v, Expr r, bool in_hexagon, const Target &t) :
-            var(v), replacement(r), target(t), in_hexagon(in_hexagon) {
+    VectorSubs(string v, Expr r, bool in_hexagon, bool force_predicate, const Target &t) :
+            var(v), replacement(r), target(t), in_hexagon(in_hexagon), force_predicate(force_predicate) {
         widening_suffix = ".x" + std::to_string(replacement.type().lanes());
     }
 };
@@ -916,6 +1023,7 @@ public:
 // Vectorize all loops marked as such in a Stmt
 class VectorizeLoops : public IRMutator {
     const Target &target;
+    const std::set<string> &predicated_loops;
     bool in_hexagon;
 
     using IRMutator::visit;
@@ -938,7 +1046,9 @@ class VectorizeLoops : public IRMutator {
             // Replace the var with a ramp within the body
             Expr for_var = Variable::make(Int(32), for_loop->name);
             Expr replacement = Ramp::make(for_loop->min, 1, extent->value);
-            stmt = VectorSubs(for_loop->name, replacement, in_hexagon, target).mutate(for_loop->body);
+            bool force_predicate = predicated_loops.count(for_loop->name) > 0;
+            stmt = VectorSubs(for_loop->name, replacement, in_hexagon,
+                              force_predicate, target).mutate(for_loop->body);
         } else {
             IRMutator::visit(for_loop);
         }
@@ -949,13 +1059,132 @@ class VectorizeLoops : public IRMutator {
     }
 
 public:
-    VectorizeLoops(const Target &t) : target(t), in_hexagon(false) {}
+    VectorizeLoops(const Target &t, const std::set<string> &p) :
+        target(t), predicated_loops(p), in_hexagon(false) {}
+};
+
+// Find the loops that descend from the inner var of a split with
+// TailStrategy::Predicate.
+void find_predicated_loops(const Function &f, int stage, const Definition &def,
+                           std::set<string> &result) {
+    std::set<string> vars;
+    for (const Split &s : def.schedule().splits()) {
+        if (s.is_split() && s.tail == TailStrategy::Predicate) {
+            vars.insert(s.inner);
+        } else if (s.is_split() && vars.count(s.old_var)) {
+            vars.insert(s.inner);
+            vars.insert(s.outer);
+        } else if (s.is_fuse() && (vars.count(s.inner) || vars.count(s.outer))) {
+            vars.insert(s.old_var);
+        } else if ((s.is_rename() || s.is_purify()) && vars.count(s.old_var)) {
+            vars.insert(s.outer);
+        }
+    }
+    string prefix = f.name() + ".s" + std::to_string(stage) + ".";
+    for (const string &v : vars) {
+        result.insert(prefix + v);
+    }
+}
+
+// Find the narrowest and widest types a definition computes
+// with. The arguments of calls to Funcs and images are coordinates,
+// not values, so they don't count.
+class FindVectorTypes : public IRGraphVisitor {
+    using IRGraphVisitor::visit;
+
+    void include(const Expr &e) {
+        Type t = e.type();
+        if (!t.is_handle() && !t.is_bool()) {
+            if (narrowest.bits() == 0 || t.bits() < narrowest.bits()) {
+                narrowest = t.element_of();
+            }
+            if (t.bits() > widest.bits()) {
+                widest = t.element_of();
+            }
+        }
+        IRGraphVisitor::include(e);
+    }
+
+    void visit(const Call *op) {
+        if (op->call_type != Call::Halide && op->call_type != Call::Image) {
+            IRGraphVisitor::visit(op);
+        }
+    }
+
+public:
+    Type narrowest, widest;
+
+    void find(const Definition &def) {
+        for (const Expr &e : def.values()) {
+            include(e);
+        }
+        for (const Specialization &s : def.specializations()) {
+            find(s.definition);
+        }
+    }
 };
 
+void replace_auto_vector_width(Definition &def, Expr width) {
+    const string &marker = auto_vector_width().as<Variable>()->name;
+    for (Split &s : def.schedule().splits()) {
+        const Variable *v = s.factor.as<Variable>();
+        if (v && v->name == marker) {
+            s.factor = width;
+        }
+    }
+    for (Specialization &s : def.specializations()) {
+        replace_auto_vector_width(s.definition, width);
+    }
+}
+
 } // Anonymous namespace
 
-Stmt vectorize_loops(Stmt s, const Target &t) {
-    return VectorizeLoops(t).mutate(s);
+Stmt vectorize_loops(Stmt s, const map<string, Function> &env, const Target &t) {
+    std::set<string> predicated_loops;
+    for (const auto &p : env) {
+        const Function &f = p.second;
+        find_predicated_loops(f, 0, f.definition(), predicated_loops);
+        for (size_t i = 0; i < f.updates().size(); i++) {
+            find_predicated_loops(f, (int)(i + 1), f.updates()[i], predicated_loops);
+        }
+    }
+    return VectorizeLoops(t, predicated_loops).mutate(s);
+}
+
+Expr auto_vector_width() {
+    return Variable::make(Int(32), "auto.vector.width");
+}
+
+void select_auto_vector_widths(map<string, Function> &env, const Target &t) {
+    for (auto &p : env) {
+        Function &f = p.second;
+        if (!f.has_pure_definition()) {
+            continue;
+        }
+        FindVectorTypes types;
+        types.find(f.definition());
+        for (const Definition &def : f.updates()) {
+            types.find(def);
+        }
+        if (types.widest.bits() == 0) {
+            types.narrowest = types.widest = f.output_types()[0];
+        }
+
+        // Fill a vector register with the narrowest type, unless that
+        // would spread the widest type across more than four of them,
+        // which costs more in widening shuffles and register spills
+        // than it gains.
+        int narrow_width = t.natural_vector_size(types.narrowest);
+        int wide_width = t.natural_vector_size(types.widest);
+        int width = std::max(wide_width, std::min(narrow_width, 4 * wide_width));
+        debug(3) << "Auto vector width of " << f.name() << " is " << width
+                 << " (from " << types.narrowest << " and " << types.widest << ")\n";
+
+        replace_auto_vector_width(f.definition(), width);
+        for (size_t i = 0; i < f.updates().size(); i++) {
+            replace_auto_vector_width(f.update((int)i), width);
+        }
+    }
 }
 
 }
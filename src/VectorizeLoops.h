@@ -5,6 +5,9 @@
  * Defines the lowering pass that vectorizes loops marked as such
  */
 
+#include <map>
+
+#include "Function.h"
 #include "IR.h"
 #include "Target.h"
 
@@ -13,9 +16,22 @@ namespace Internal {
 
 /** Take a statement with for loops marked for vectorization, and turn
  * them into single statements that operate on vectors. The loops in
- * question must have constant extent.
+ * question must have constant extent. Loops that came from a split
+ * with TailStrategy::Predicate have their tail cases turned into
+ * predicated loads and stores on any target.
  */
-Stmt vectorize_loops(Stmt s, const Target &t);
+Stmt vectorize_loops(Stmt s, const std::map<std::string, Function> &env, const Target &t);
+
+/** The placeholder split factor used by vectorize(var, VectorWidth::Auto). */
+Expr auto_vector_width();
+
+/** Replace the placeholder split factors made by
+ * vectorize(var, VectorWidth::Auto) with a vector width chosen for
+ * each Function from the narrowest and widest types its definitions
+ * compute with, and the natural vector sizes of the target. Should be
+ * called on the deep copy of the environment made by lowering,
+ * before the loop nests are created. */
+void select_auto_vector_widths(std::map<std::string, Function> &env, const Target &t);
 
 }
 }
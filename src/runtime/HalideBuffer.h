@@ -31,8 +31,12 @@
 namespace Halide {
 namespace Runtime {
 
+/** The value of the Dims template parameter of a Buffer whose
+ * dimensionality is only known at runtime. */
+constexpr int AnyDims = -1;
+
 // Forward-declare our Buffer class
-template<typename T, int D> class Buffer;
+template<typename T, int D, int Dims> class Buffer;
 
 // A helper to check if a parameter pack is entirely implicitly
 // int-convertible to use with std::enable_if
@@ -93,15 +97,37 @@ struct DeviceRefCount {
  * space inside the class itself. Set it to the maximum dimensionality
  * you expect this buffer to be. If the actual dimensionality exceeds
  * this, heap storage is allocated to track the shape of the buffer. D
- * defaults to 4, which should cover nearly all usage.
+ * defaults to 4, which should cover nearly all usage. As long as the
+ * dimensionality fits, copying a Buffer and making views of it
+ * (e.g. with cropped, sliced, embedded, transposed or translated)
+ * never touches the heap.
+ *
+ * Dims is the number of dimensions, if it is known at compile
+ * time. It defaults to AnyDims, meaning it is only known at
+ * runtime. With a fixed Dims, dimensions() is a
+ * compile-time constant, so the loops over the dimensions in indexing,
+ * for_each_value, for_each_element and copy_from unroll, and
+ * constructing or converting from a Buffer of a different
+ * dimensionality fails to compile, or asserts at runtime if the other
+ * Buffer's dimensionality is only known then. Such buffers can't be
+ * sliced or embedded in place, but sliced and embedded return
+ * Buffers of one fewer or one more static dimension. For example:
+ *
+ \code
+ Buffer<float, 3, 3> im(100, 100, 3);
+ Buffer<float, 3, 2> red = im.sliced(2, 0);
+ \endcode
  *
  * The class optionally allocates and owns memory for the image using
  * a shared pointer allocated with the provided allocator. If they are
  * null, malloc and free are used.  Any device-side allocation is
  * considered as owned if and only if the host-side allocation is
  * owned. */
-template<typename T = void, int D = 4>
+template<typename T = void, int D = 4, int Dims = AnyDims>
 class Buffer {
+    static_assert(Dims == AnyDims || Dims >= 0,
+                  "The static dimensionality of a Buffer can't be negative");
+
     /** The underlying buffer_t */
     halide_buffer_t buf = {0};
 
@@ -139,6 +165,12 @@ public:
     /** True if the Halide type is not void (or const void). */
     static constexpr bool has_static_halide_type = !T_is_void;
 
+    /** True if the number of dimensions is known at compile time. */
+    static constexpr bool has_static_dimensions = (Dims != AnyDims);
+
+    /** The number of dimensions, if has_static_dimensions is true. */
+    static constexpr int static_dimensions = Dims;
+
     /** Get the Halide type of T. Callers should not use the result if
      * has_static_halide_type is false. */
     static halide_type_t static_halide_type() {
@@ -222,6 +254,8 @@ private:
     }
 
     void make_shape_storage() {
+        assert((Dims == AnyDims || buf.dimensions == Dims) &&
+               "Buffer does not have the number of dimensions of its static dimensionality");
         if (buf.dimensions <= D) {
             buf.dim = shape;
         } else {
@@ -237,8 +271,10 @@ private:
         }
     }
 
-    template<typename T2, int D2>
-    void move_shape_from(Buffer<T2, D2> &&other) {
+    template<typename T2, int D2, int Dims2>
+    void move_shape_from(Buffer<T2, D2, Dims2> &&other) {
+        assert((Dims == AnyDims || other.buf.dimensions == Dims) &&
+               "Buffer does not have the number of dimensions of its static dimensionality");
         if (other.shape == other.buf.dim) {
             copy_shape_from(other.buf);
         } else {
@@ -422,9 +458,10 @@ public:
         return s;
     }
 
-    /** Get the dimensionality of the buffer. */
-    int dimensions() const {
-        return buf.dimensions;
+    /** Get the dimensionality of the buffer. A compile-time
+     * constant if it is static. */
+    HALIDE_ALWAYS_INLINE int dimensions() const {
+        return Dims == AnyDims ? buf.dimensions : Dims;
     }
 
     /** Get the type of the elements. */
@@ -463,7 +500,13 @@ public:
 
     Buffer() {
         buf.type = static_halide_type();
+        // A Buffer with a static dimensionality is empty in all of
+        // its dimensions.
+        buf.dimensions = (Dims == AnyDims) ? 0 : Dims;
         make_shape_storage();
+        for (int i = 0; i < buf.dimensions; i++) {
+            buf.dim[i] = {0, 0, 0};
+        }
     }
 
     /** Make a Buffer from a halide_buffer_t */
@@ -508,34 +551,40 @@ public:
     }
 
     /** Give Buffers access to the members of Buffers of different dimensionalities and types. */
-    template<typename T2, int D2> friend class Buffer;
+    template<typename T2, int D2, int Dims2> friend class Buffer;
 
-    /** Determine if if an Buffer<T, D> can be constructed from some other Buffer type.
+    /** Determine if if an Buffer<T, D, Dims> can be constructed from some other Buffer type.
      * If this can be determined at compile time, fail with a static assert; otherwise
      * return a boolean based on runtime typing. */
-    template<typename T2, int D2>
-    static bool can_convert_from(const Buffer<T2, D2> &other) {
+    template<typename T2, int D2, int Dims2>
+    static bool can_convert_from(const Buffer<T2, D2, Dims2> &other) {
         static_assert((!std::is_const<T2>::value || std::is_const<T>::value),
                       "Can't convert from a Buffer<const T> to a Buffer<T>");
         static_assert(std::is_same<typename std::remove_const<T>::type,
                                    typename std::remove_const<T2>::type>::value ||
-                      T_is_void || Buffer<T2, D2>::T_is_void,
+                      T_is_void || Buffer<T2, D2, Dims2>::T_is_void,
                       "type mismatch constructing Buffer");
-        if (Buffer<T2, D2>::T_is_void && !T_is_void) {
-            return other.type() == static_halide_type();
+        static_assert(Dims == AnyDims || Dims2 == AnyDims || Dims == Dims2,
+                      "dimensionality mismatch constructing Buffer");
+        if (Buffer<T2, D2, Dims2>::T_is_void && !T_is_void &&
+            other.type() != static_halide_type()) {
+            return false;
+        }
+        if (Dims != AnyDims && Dims2 == AnyDims) {
+            return other.dimensions() == Dims;
         }
         return true;
     }
 
-    /** Fail an assertion at runtime or compile-time if an Buffer<T, D>
+    /** Fail an assertion at runtime or compile-time if an Buffer<T, D, Dims>
      * cannot be constructed from some other Buffer type. */
-    template<typename T2, int D2>
-    static void assert_can_convert_from(const Buffer<T2, D2> &other) {
+    template<typename T2, int D2, int Dims2>
+    static void assert_can_convert_from(const Buffer<T2, D2, Dims2> &other) {
         assert(can_convert_from(other));
     }
 
     /** Copy constructor. Does not copy underlying data. */
-    Buffer(const Buffer<T, D> &other) : buf(other.buf),
+    Buffer(const Buffer<T, D, Dims> &other) : buf(other.buf),
                                         alloc(other.alloc) {
         other.incref();
         dev_ref_count = other.dev_ref_count;
@@ -548,8 +597,8 @@ public:
      * implicit. This, for example, lets you pass things like
      * Buffer<T> or Buffer<const void> to functions expected
      * Buffer<const T>. */
-    template<typename T2, int D2>
-    Buffer(const Buffer<T2, D2> &other) : buf(other.buf),
+    template<typename T2, int D2, int Dims2>
+    Buffer(const Buffer<T2, D2, Dims2> &other) : buf(other.buf),
                                           alloc(other.alloc) {
         assert_can_convert_from(other);
         other.incref();
@@ -558,35 +607,35 @@ public:
     }
 
     /** Move constructor */
-    Buffer(Buffer<T, D> &&other) : buf(other.buf),
+    Buffer(Buffer<T, D, Dims> &&other) : buf(other.buf),
                                    alloc(other.alloc),
                                    dev_ref_count(other.dev_ref_count) {
         other.dev_ref_count = nullptr;
         other.alloc = nullptr;
         other.buf.device = 0;
         other.buf.device_interface = nullptr;
-        move_shape_from(std::forward<Buffer<T, D>>(other));
+        move_shape_from(std::forward<Buffer<T, D, Dims>>(other));
     }
 
     /** Move-construct a Buffer from a Buffer of different
      * dimensionality and type. Asserts that the types match (at
      * runtime if one of the types is void). */
-    template<typename T2, int D2>
-    Buffer(Buffer<T2, D2> &&other) : buf(other.buf),
+    template<typename T2, int D2, int Dims2>
+    Buffer(Buffer<T2, D2, Dims2> &&other) : buf(other.buf),
                                      alloc(other.alloc),
                                      dev_ref_count(other.dev_ref_count) {
         other.dev_ref_count = nullptr;
         other.alloc = nullptr;
         other.buf.device = 0;
         other.buf.device_interface = nullptr;
-        move_shape_from(std::forward<Buffer<T2, D2>>(other));
+        move_shape_from(std::forward<Buffer<T2, D2, Dims2>>(other));
     }
 
     /** Assign from another Buffer of possibly-different
      * dimensionality and type. Asserts that the types match (at
      * runtime if one of the types is void). */
-    template<typename T2, int D2>
-    Buffer<T, D> &operator=(const Buffer<T2, D2> &other) {
+    template<typename T2, int D2, int Dims2>
+    Buffer<T, D, Dims> &operator=(const Buffer<T2, D2, Dims2> &other) {
         if ((const void *)this == (const void *)&other) {
             return *this;
         }
@@ -602,7 +651,7 @@ public:
     }
 
     /** Standard assignment operator */
-    Buffer<T, D> &operator=(const Buffer<T, D> &other) {
+    Buffer<T, D, Dims> &operator=(const Buffer<T, D, Dims> &other) {
         if (this == &other) {
             return *this;
         }
@@ -619,8 +668,8 @@ public:
     /** Move from another Buffer of possibly-different
      * dimensionality and type. Asserts that the types match (at
      * runtime if one of the types is void). */
-    template<typename T2, int D2>
-    Buffer<T, D> &operator=(Buffer<T2, D2> &&other) {
+    template<typename T2, int D2, int Dims2>
+    Buffer<T, D, Dims> &operator=(Buffer<T2, D2, Dims2> &&other) {
         assert_can_convert_from(other);
         decref();
         alloc = other.alloc;
@@ -631,12 +680,12 @@ public:
         buf = other.buf;
         other.buf.device = 0;
         other.buf.device_interface = nullptr;
-        move_shape_from(std::forward<Buffer<T2, D2>>(other));
+        move_shape_from(std::forward<Buffer<T2, D2, Dims2>>(other));
         return *this;
     }
 
     /** Standard move-assignment operator */
-    Buffer<T, D> &operator=(Buffer<T, D> &&other) {
+    Buffer<T, D, Dims> &operator=(Buffer<T, D, Dims> &&other) {
         decref();
         alloc = other.alloc;
         other.alloc = nullptr;
@@ -646,7 +695,7 @@ public:
         buf = other.buf;
         other.buf.device = 0;
         other.buf.device_interface = nullptr;
-        move_shape_from(std::forward<Buffer<T, D>>(other));
+        move_shape_from(std::forward<Buffer<T, D, Dims>>(other));
         return *this;
     }
 
@@ -712,6 +761,8 @@ public:
     template<typename ...Args,
              typename = typename std::enable_if<AllInts<Args...>::value>::type>
     Buffer(halide_type_t t, int first, Args... rest) {
+        static_assert(Dims == AnyDims || Dims == 1 + (int)(sizeof...(rest)),
+                      "Number of sizes does not match the static dimensionality of the Buffer");
         if (!T_is_void) {
             assert(static_halide_type() == t);
         }
@@ -735,6 +786,8 @@ public:
     explicit Buffer(int first) {
         static_assert(!T_is_void,
                       "To construct an Buffer<void>, pass a halide_type_t as the first argument to the constructor");
+        static_assert(Dims == AnyDims || Dims == 1,
+                      "Number of sizes does not match the static dimensionality of the Buffer");
         buf.type = static_halide_type();
         buf.dimensions = 1;
         make_shape_storage();
@@ -750,6 +803,8 @@ public:
     Buffer(int first, int second, Args... rest) {
         static_assert(!T_is_void,
                       "To construct an Buffer<void>, pass a halide_type_t as the first argument to the constructor");
+        static_assert(Dims == AnyDims || Dims == 2 + (int)(sizeof...(rest)),
+                      "Number of sizes does not match the static dimensionality of the Buffer");
         buf.type = static_halide_type();
         buf.dimensions = 2 + (int)(sizeof...(rest));
         make_shape_storage();
@@ -806,6 +861,8 @@ public:
     template<typename ...Args,
              typename = typename std::enable_if<AllInts<Args...>::value>::type>
     explicit Buffer(halide_type_t t, add_const_if_T_is_const<void> *data, int first, Args&&... rest) {
+        static_assert(Dims == AnyDims || Dims == 1 + (int)(sizeof...(rest)),
+                      "Number of sizes does not match the static dimensionality of the Buffer");
         if (!T_is_void) {
             assert(static_halide_type() == t);
         }
@@ -822,6 +879,8 @@ public:
     template<typename ...Args,
              typename = typename std::enable_if<AllInts<Args...>::value>::type>
     explicit Buffer(T *data, int first, Args&&... rest) {
+        static_assert(Dims == AnyDims || Dims == 1 + (int)(sizeof...(rest)),
+                      "Number of sizes does not match the static dimensionality of the Buffer");
         buf.type = static_halide_type();
         buf.dimensions = 1 + (int)(sizeof...(rest));
         buf.host = (uint8_t *)data;
@@ -913,31 +972,34 @@ public:
     /** Return a typed reference to this Buffer. Useful for converting
      * a reference to a Buffer<void> to a reference to, for example, a
      * Buffer<const uint8_t>. Does a runtime assert if the source
-     * buffer type is void. */
-    template<typename T2, int D2 = D,
+     * buffer type is void, or if the result has a static
+     * dimensionality that the source may not match. */
+    template<typename T2, int D2 = D, int Dims2 = Dims,
              typename = typename std::enable_if<(D2 <= D)>::type>
-    Buffer<T2, D2> &as() & {
-        Buffer<T2, D>::assert_can_convert_from(*this);
-        return *((Buffer<T2, D2> *)this);
+    Buffer<T2, D2, Dims2> &as() & {
+        Buffer<T2, D, Dims2>::assert_can_convert_from(*this);
+        return *((Buffer<T2, D2, Dims2> *)this);
     }
 
     /** Return a const typed reference to this Buffer. Useful for
      * converting a conference reference to one Buffer type to a const
      * reference to another Buffer type. Does a runtime assert if the
-     * source buffer type is void. */
-    template<typename T2, int D2 = D,
+     * source buffer type is void, or if the dimensionalities may not
+     * match. */
+    template<typename T2, int D2 = D, int Dims2 = Dims,
              typename = typename std::enable_if<(D2 <= D)>::type>
-    const Buffer<T2, D2> &as() const &  {
-        Buffer<T2, D>::assert_can_convert_from(*this);
-        return *((const Buffer<T2, D2> *)this);
+    const Buffer<T2, D2, Dims2> &as() const &  {
+        Buffer<T2, D, Dims2>::assert_can_convert_from(*this);
+        return *((const Buffer<T2, D2, Dims2> *)this);
     }
 
     /** Returns this rval Buffer with a different type attached. Does
-     * a dynamic type check if the source type is void. */
-    template<typename T2, int D2 = D>
-    Buffer<T2, D2> as() && {
-        Buffer<T2, D2>::assert_can_convert_from(*this);
-        return *((Buffer<T2, D2> *)this);
+     * a dynamic type check if the source type is void, and a dynamic
+     * dimensionality check if the dimensionalities may not match. */
+    template<typename T2, int D2 = D, int Dims2 = Dims>
+    Buffer<T2, D2, Dims2> as() && {
+        Buffer<T2, D2, Dims2>::assert_can_convert_from(*this);
+        return *((Buffer<T2, D2, Dims2> *)this);
     }
 
     /** Conventional names for the first three dimensions. */
@@ -976,9 +1038,9 @@ public:
      * or slice followed by copy to make a copy of only a portion of
      * the image. The new image uses the same memory layout as the
      * original, with holes compacted away. */
-    Buffer<T, D> copy(void *(*allocate_fn)(size_t) = nullptr,
+    Buffer<T, D, Dims> copy(void *(*allocate_fn)(size_t) = nullptr,
                       void (*deallocate_fn)(void *) = nullptr) const {
-        Buffer<T, D> dst = make_with_shape_of(*this, allocate_fn, deallocate_fn);
+        Buffer<T, D, Dims> dst = make_with_shape_of(*this, allocate_fn, deallocate_fn);
         dst.copy_from(*this);
         return dst;
     }
@@ -992,13 +1054,13 @@ public:
      * to the correct location first like so: \code
      * framebuffer.copy_from(sprite.translated({x, y})); \endcode
     */
-    template<typename T2, int D2>
-    void copy_from(const Buffer<T2, D2> &other) {
+    template<typename T2, int D2, int Dims2>
+    void copy_from(const Buffer<T2, D2, Dims2> &other) {
         assert(!device_dirty() && "Cannot call Halide::Runtime::Buffer::copy_from on a device dirty destination.");
         assert(!other.device_dirty() && "Cannot call Halide::Runtime::Buffer::copy_from on a device dirty source.");
 
-        Buffer<const T, D> src(other);
-        Buffer<T, D> dst(*this);
+        Buffer<const T, D, Dims> src(other);
+        Buffer<T, D, Dims> dst(*this);
 
         assert(src.dimensions() == dst.dimensions());
 
@@ -1019,24 +1081,24 @@ public:
         // about the element size.
         if (type().bytes() == 1) {
             using MemType = uint8_t;
-            auto &typed_dst = (Buffer<MemType, D> &)dst;
-            auto &typed_src = (Buffer<const MemType, D> &)src;
-            typed_dst.for_each_value([&](MemType &dst, MemType src) {dst = src;}, typed_src);
+            auto &typed_dst = (Buffer<MemType, D, Dims> &)dst;
+            auto &typed_src = (Buffer<const MemType, D, Dims> &)src;
+            typed_dst.copy_rows_from(typed_src);
         } else if (type().bytes() == 2) {
             using MemType = uint16_t;
-            auto &typed_dst = (Buffer<MemType, D> &)dst;
-            auto &typed_src = (Buffer<const MemType, D> &)src;
-            typed_dst.for_each_value([&](MemType &dst, MemType src) {dst = src;}, typed_src);
+            auto &typed_dst = (Buffer<MemType, D, Dims> &)dst;
+            auto &typed_src = (Buffer<const MemType, D, Dims> &)src;
+            typed_dst.copy_rows_from(typed_src);
         } else if (type().bytes() == 4) {
             using MemType = uint32_t;
-            auto &typed_dst = (Buffer<MemType, D> &)dst;
-            auto &typed_src = (Buffer<const MemType, D> &)src;
-            typed_dst.for_each_value([&](MemType &dst, MemType src) {dst = src;}, typed_src);
+            auto &typed_dst = (Buffer<MemType, D, Dims> &)dst;
+            auto &typed_src = (Buffer<const MemType, D, Dims> &)src;
+            typed_dst.copy_rows_from(typed_src);
         } else if (type().bytes() == 8) {
             using MemType = uint64_t;
-            auto &typed_dst = (Buffer<MemType, D> &)dst;
-            auto &typed_src = (Buffer<const MemType, D> &)src;
-            typed_dst.for_each_value([&](MemType &dst, MemType src) {dst = src;}, typed_src);
+            auto &typed_dst = (Buffer<MemType, D, Dims> &)dst;
+            auto &typed_src = (Buffer<const MemType, D, Dims> &)src;
+            typed_dst.copy_rows_from(typed_src);
         } else {
             assert(false && "type().bytes() must be 1, 2, 4, or 8");
         }
@@ -1047,10 +1109,10 @@ public:
      * the given dimension. Does not assert the crop region is within
      * the existing bounds. The cropped image drops any device
      * handle. */
-    Buffer<T, D> cropped(int d, int min, int extent) const {
+    Buffer<T, D, Dims> cropped(int d, int min, int extent) const {
         // Make a fresh copy of the underlying buffer (but not a fresh
         // copy of the allocation, if there is one).
-        Buffer<T, D> im = *this;
+        Buffer<T, D, Dims> im = *this;
         im.crop(d, min, extent);
         return im;
     }
@@ -1073,10 +1135,10 @@ public:
     /** Make an image that refers to a sub-rectangle of this image along
      * the first N dimensions. Does not assert the crop region is within
      * the existing bounds. The cropped image drops any device handle. */
-    Buffer<T, D> cropped(const std::vector<std::pair<int, int>> &rect) const {
+    Buffer<T, D, Dims> cropped(const std::vector<std::pair<int, int>> &rect) const {
         // Make a fresh copy of the underlying buffer (but not a fresh
         // copy of the allocation, if there is one).
-        Buffer<T, D> im = *this;
+        Buffer<T, D, Dims> im = *this;
         im.crop(rect);
         return im;
     }
@@ -1095,8 +1157,8 @@ public:
      * translated coordinates in the given dimension. Positive values
      * move the image data to the right or down relative to the
      * coordinate system. Drops any device handle. */
-    Buffer<T, D> translated(int d, int dx) const {
-        Buffer<T, D> im = *this;
+    Buffer<T, D, Dims> translated(int d, int dx) const {
+        Buffer<T, D, Dims> im = *this;
         im.translate(d, dx);
         return im;
     }
@@ -1109,8 +1171,8 @@ public:
 
     /** Make an image which refers to the same data translated along
      * the first N dimensions. */
-    Buffer<T, D> translated(const std::vector<int> &delta) {
-        Buffer<T, D> im = *this;
+    Buffer<T, D, Dims> translated(const std::vector<int> &delta) {
+        Buffer<T, D, Dims> im = *this;
         im.translate(delta);
         return im;
     }
@@ -1152,8 +1214,8 @@ public:
 
     /** Make an image which refers to the same data using a different
      * ordering of the dimensions. */
-    Buffer<T, D> transposed(int d1, int d2) const {
-        Buffer<T, D> im = *this;
+    Buffer<T, D, Dims> transposed(int d1, int d2) const {
+        Buffer<T, D, Dims> im = *this;
         im.transpose(d1, d2);
         return im;
     }
@@ -1165,7 +1227,7 @@ public:
 
     /** Make a lower-dimensional image that refers to one slice of this
      * image. */
-    Buffer<T, D> sliced(int d, int pos) const {
+    Buffer<T, D, (Dims == AnyDims ? AnyDims : Dims - 1)> sliced(int d, int pos) const {
         Buffer<T, D> im = *this;
         im.slice(d, pos);
         return im;
@@ -1173,6 +1235,8 @@ public:
 
     /** Slice an image in-place */
     void slice(int d, int pos) {
+        static_assert(Dims == AnyDims,
+                      "Can't change the dimensionality of a Buffer with a static dimensionality in place. Use sliced or embedded instead.");
         // assert(pos >= dim(d).min() && pos <= dim(d).max());
         device_deallocate();
         buf.dimensions--;
@@ -1197,7 +1261,7 @@ public:
      &im(x, y, c) == &im2(x, 17, y, c);
      \endcode
      */
-    Buffer<T, D> embedded(int d, int pos) const {
+    Buffer<T, D, (Dims == AnyDims ? AnyDims : Dims + 1)> embedded(int d, int pos) const {
         assert(d >= 0 && d <= dimensions());
         Buffer<T, D> im(*this);
         im.embed(d, pos);
@@ -1207,6 +1271,8 @@ public:
     /** Embed an image in-place, increasing the
      * dimensionality. */
     void embed(int d, int pos) {
+        static_assert(Dims == AnyDims,
+                      "Can't change the dimensionality of a Buffer with a static dimensionality in place. Use sliced or embedded instead.");
         assert(d >= 0 && d <= dimensions());
         add_dimension();
         translate(dimensions() - 1, pos);
@@ -1220,6 +1286,8 @@ public:
      * its stride. The new dimension is the last dimension. This is a
      * special case of embed. */
     void add_dimension() {
+        static_assert(Dims == AnyDims,
+                      "Can't change the dimensionality of a Buffer with a static dimensionality in place. Use sliced or embedded instead.");
         const int dims = buf.dimensions;
         buf.dimensions++;
         if (buf.dim != shape) {
@@ -1400,8 +1468,8 @@ public:
      * using (x, y, c). Passing it to a generator requires that the
      * generator has been compiled with support for interleaved (also
      * known as packed or chunky) memory layouts. */
-    static Buffer<void, D> make_interleaved(halide_type_t t, int width, int height, int channels) {
-        Buffer<void, D> im(t, channels, width, height);
+    static Buffer<void, D, Dims> make_interleaved(halide_type_t t, int width, int height, int channels) {
+        Buffer<void, D, Dims> im(t, channels, width, height);
         im.transpose(0, 1);
         im.transpose(1, 2);
         return im;
@@ -1413,39 +1481,39 @@ public:
      * using (x, y, c). Passing it to a generator requires that the
      * generator has been compiled with support for interleaved (also
      * known as packed or chunky) memory layouts. */
-    static Buffer<T, D> make_interleaved(int width, int height, int channels) {
-        Buffer<T, D> im(channels, width, height);
+    static Buffer<T, D, Dims> make_interleaved(int width, int height, int channels) {
+        Buffer<T, D, Dims> im(channels, width, height);
         im.transpose(0, 1);
         im.transpose(1, 2);
         return im;
     }
 
     /** Wrap an existing interleaved image. */
-    static Buffer<add_const_if_T_is_const<void>, D>
+    static Buffer<add_const_if_T_is_const<void>, D, Dims>
     make_interleaved(halide_type_t t, T *data, int width, int height, int channels) {
-        Buffer<add_const_if_T_is_const<void>, D> im(t, data, channels, width, height);
+        Buffer<add_const_if_T_is_const<void>, D, Dims> im(t, data, channels, width, height);
         im.transpose(0, 1);
         im.transpose(1, 2);
         return im;
     }
 
     /** Wrap an existing interleaved image. */
-    static Buffer<T, D> make_interleaved(T *data, int width, int height, int channels) {
-        Buffer<T, D> im(data, channels, width, height);
+    static Buffer<T, D, Dims> make_interleaved(T *data, int width, int height, int channels) {
+        Buffer<T, D, Dims> im(data, channels, width, height);
         im.transpose(0, 1);
         im.transpose(1, 2);
         return im;
     }
 
     /** Make a zero-dimensional Buffer */
-    static Buffer<add_const_if_T_is_const<void>, D> make_scalar(halide_type_t t) {
+    static Buffer<add_const_if_T_is_const<void>, D, Dims> make_scalar(halide_type_t t) {
         Buffer<add_const_if_T_is_const<void>, 1> buf(t, 1);
         buf.slice(0, 0);
         return buf;
     }
 
     /** Make a zero-dimensional Buffer */
-    static Buffer<T, D> make_scalar() {
+    static Buffer<T, D, Dims> make_scalar() {
         Buffer<T, 1> buf(1);
         buf.slice(0, 0);
         return buf;
@@ -1453,17 +1521,20 @@ public:
 
     /** Make a buffer with the same shape and memory nesting order as
      * another buffer. It may have a different type. */
-    template<typename T2, int D2>
-    static Buffer<T, D> make_with_shape_of(Buffer<T2, D2> src,
+    template<typename T2, int D2, int Dims2>
+    static Buffer<T, D, Dims> make_with_shape_of(Buffer<T2, D2, Dims2> src,
                                            void *(*allocate_fn)(size_t) = nullptr,
                                            void (*deallocate_fn)(void *) = nullptr) {
-        // Reorder the dimensions of src to have strides in increasing order
-        std::vector<int> swaps;
+        // Reorder the dimensions of src to have strides in increasing
+        // order. This bubble sort does at most n*(n-1)/2 swaps.
+        const int max_swaps = src.dimensions() * (src.dimensions() - 1) / 2;
+        int *swaps = (int *)HALIDE_ALLOCA((max_swaps + 1) * sizeof(int));
+        int num_swaps = 0;
         for (int i = src.dimensions()-1; i > 0; i--) {
             for (int j = i; j > 0; j--) {
                 if (src.dim(j-1).stride() > src.dim(j).stride()) {
                     src.transpose(j-1, j);
-                    swaps.push_back(j);
+                    swaps[num_swaps++] = j;
                 }
             }
         }
@@ -1480,13 +1551,12 @@ public:
         }
 
         // Undo the dimension reordering
-        while (!swaps.empty()) {
-            int j = swaps.back();
+        while (num_swaps > 0) {
+            int j = swaps[--num_swaps];
             std::swap(shape[j-1], shape[j]);
-            swaps.pop_back();
         }
 
-        Buffer<T, D> dst(nullptr, src.dimensions(), shape);
+        Buffer<T, D, Dims> dst(nullptr, src.dimensions(), shape);
         dst.allocate(allocate_fn, deallocate_fn);
 
         return dst;
@@ -1559,6 +1629,8 @@ public:
     const not_void_T &operator()(int first, Args... rest) const {
         static_assert(!T_is_void,
                       "Cannot use operator() on Buffer<void> types");
+        static_assert(Dims == AnyDims || 1 + (int)(sizeof...(rest)) <= Dims,
+                      "Too many coordinates for the static dimensionality of the Buffer");
         assert(!device_dirty());
         return *((const not_void_T *)(address_of(first, rest...)));
     }
@@ -1587,6 +1659,8 @@ public:
     not_void_T &operator()(int first, Args... rest) {
         static_assert(!T_is_void,
                       "Cannot use operator() on Buffer<void> types");
+        static_assert(Dims == AnyDims || 1 + (int)(sizeof...(rest)) <= Dims,
+                      "Too many coordinates for the static dimensionality of the Buffer");
         set_host_dirty();
         return *((not_void_T *)(address_of(first, rest...)));
     }
@@ -1612,6 +1686,24 @@ public:
 
     void fill(not_void_T val) {
         set_host_dirty();
+        // If all the bytes of the value are the same (e.g. it's
+        // zero), contiguous runs of elements can be memset.
+        const uint8_t *bytes = (const uint8_t *)&val;
+        bool splat = true;
+        for (size_t i = 1; i < sizeof(not_void_T); i++) {
+            splat = splat && bytes[i] == bytes[0];
+        }
+        if (splat && dimensions() > 0) {
+            for_each_value_task_dim<1> *t =
+                (for_each_value_task_dim<1> *)HALIDE_ALLOCA((dimensions()+1) * sizeof(for_each_value_task_dim<1>));
+            if (for_each_value_prep(t) && t[0].extent > 1) {
+                const size_t row_bytes = (size_t)t[0].extent * sizeof(not_void_T);
+                const uint8_t b = bytes[0];
+                t[0].extent = 1;
+                for_each_value_dispatch<false>([=](T &v) {memset(&v, b, row_bytes);}, t, begin());
+                return;
+            }
+        }
         for_each_value([=](T &v) {v = val;});
     }
 
@@ -1647,8 +1739,8 @@ private:
     // Given a bunch of pointers to buffers of different types, read
     // out their strides in the d'th dimension, and assert that their
     // sizes match in that dimension.
-    template<typename T2, int D2, typename ...Args>
-    void extract_strides(int d, int *strides, const Buffer<T2, D2> *first, Args... rest) {
+    template<typename T2, int D2, int Dims2, typename ...Args>
+    void extract_strides(int d, int *strides, const Buffer<T2, D2, Dims2> *first, Args... rest) {
         assert(first->dimensions() == dimensions());
         assert(first->dim(d).min() == dim(d).min() &&
                first->dim(d).max() == dim(d).max());
@@ -1658,6 +1750,76 @@ private:
 
     void extract_strides(int d, int *strides) {}
 
+    // Fill in the loop nest to iterate over this buffer and some
+    // number of others, with the dimensions ordered by stride and
+    // flattened together where possible, so that the innermost loop
+    // is as long as possible. Returns whether the innermost strides
+    // are all one.
+    template<int N, typename ...Args>
+    bool for_each_value_prep(for_each_value_task_dim<N> *t, const Args *... other_buffers) {
+        for (int i = 0; i <= dimensions(); i++) {
+            for (int j = 0; j < N; j++) {
+                t[i].stride[j] = 0;
+            }
+            t[i].extent = 1;
+        }
+
+        for (int i = 0; i < dimensions(); i++) {
+            extract_strides(i, t[i].stride, this, other_buffers...);
+            t[i].extent = dim(i).extent();
+            // Order the dimensions by stride, so that the traversal is cache-coherent.
+            for (int j = i; j > 0 && t[j].stride[0] < t[j-1].stride[0]; j--) {
+                std::swap(t[j], t[j-1]);
+            }
+        }
+
+        // flatten dimensions where possible to make a larger inner
+        // loop for autovectorization.
+        int d = dimensions();
+        for (int i = 1; i < d; i++) {
+            bool flat = true;
+            for (int j = 0; j < N; j++) {
+                flat = flat && t[i-1].stride[j] * t[i-1].extent == t[i].stride[j];
+            }
+            if (flat) {
+                t[i-1].extent *= t[i].extent;
+                for (int j = i; j < dimensions(); j++) {
+                    t[j] = t[j+1];
+                }
+                i--;
+                d--;
+            }
+        }
+
+        bool innermost_strides_are_one = false;
+        if (dimensions() > 0) {
+            innermost_strides_are_one = true;
+            for (int j = 0; j < N; j++) {
+                innermost_strides_are_one &= t[0].stride[j] == 1;
+            }
+        }
+        return innermost_strides_are_one;
+    }
+
+    // Copy the values of another buffer of the same size and element
+    // size into this one. Where the innermost dimension is dense in
+    // both, whole rows are copied with memcpy.
+    template<typename T2, int D2, int Dims2>
+    void copy_rows_from(const Buffer<T2, D2, Dims2> &src) {
+        const int N = 2;
+        for_each_value_task_dim<N> *t =
+            (for_each_value_task_dim<N> *)HALIDE_ALLOCA((dimensions()+1) * sizeof(for_each_value_task_dim<N>));
+        if (dimensions() > 0 && for_each_value_prep(t, &src) && t[0].extent > 1) {
+            const size_t row_bytes = (size_t)t[0].extent * sizeof(not_void_T);
+            t[0].extent = 1;
+            for_each_value_dispatch<false>([=](not_void_T &d, const typename Buffer<T2, D2, Dims2>::not_void_T &s) {
+                    memcpy(&d, &s, row_bytes);
+                }, t, begin(), src.begin());
+        } else {
+            for_each_value([&](not_void_T &d, typename Buffer<T2, D2, Dims2>::not_void_T s) {d = s;}, src);
+        }
+    }
+
     // The template function that constructs the loop nest for for_each_value
     template<int d, bool innermost_strides_are_one, typename Fn, typename... Ptrs>
     static void for_each_value_helper(Fn &&f, const for_each_value_task_dim<sizeof...(Ptrs)> *t, Ptrs... ptrs) {
@@ -1696,6 +1858,18 @@ private:
             }
         }
     }
+
+    // Build the loop nest over all the dimensions of this
+    // buffer. When the dimensionality is known statically, the whole
+    // loop nest is unrolled at compile time.
+    template<bool innermost_strides_are_one, typename Fn, typename... Ptrs>
+    void for_each_value_dispatch(Fn &&f, const for_each_value_task_dim<sizeof...(Ptrs)> *t, Ptrs... ptrs) const {
+        if (Dims != AnyDims) {
+            for_each_value_helper<(Dims == AnyDims ? 0 : Dims) - 1, innermost_strides_are_one>(f, t, ptrs...);
+        } else {
+            for_each_value_helper<innermost_strides_are_one>(f, dimensions() - 1, t, ptrs...);
+        }
+    }
     // @}
 
 public:
@@ -1711,52 +1885,12 @@ public:
     void for_each_value(Fn &&f, Args... other_buffers) {
         for_each_value_task_dim<N> *t =
             (for_each_value_task_dim<N> *)HALIDE_ALLOCA((dimensions()+1) * sizeof(for_each_value_task_dim<N>));
-        for (int i = 0; i <= dimensions(); i++) {
-            for (int j = 0; j < N; j++) {
-                t[i].stride[j] = 0;
-            }
-            t[i].extent = 1;
-        }
-
-        for (int i = 0; i < dimensions(); i++) {
-            extract_strides(i, t[i].stride, this, &other_buffers...);
-            t[i].extent = dim(i).extent();
-            // Order the dimensions by stride, so that the traversal is cache-coherent.
-            for (int j = i; j > 0 && t[j].stride[0] < t[j-1].stride[0]; j--) {
-                std::swap(t[j], t[j-1]);
-            }
-        }
-
-        // flatten dimensions where possible to make a larger inner
-        // loop for autovectorization.
-        int d = dimensions();
-        for (int i = 1; i < d; i++) {
-            bool flat = true;
-            for (int j = 0; j < N; j++) {
-                flat = flat && t[i-1].stride[j] * t[i-1].extent == t[i].stride[j];
-            }
-            if (flat) {
-                t[i-1].extent *= t[i].extent;
-                for (int j = i; j < dimensions(); j++) {
-                    t[j] = t[j+1];
-                }
-                i--;
-                d--;
-            }
-        }
-
-        bool innermost_strides_are_one = false;
-        if (dimensions() > 0) {
-            innermost_strides_are_one = true;
-            for (int j = 0; j < N; j++) {
-                innermost_strides_are_one &= t[0].stride[j] == 1;
-            }
-        }
+        bool innermost_strides_are_one = for_each_value_prep(t, &other_buffers...);
 
         if (innermost_strides_are_one) {
-            for_each_value_helper<true>(f, dimensions() - 1, t, begin(), (other_buffers.begin())...);
+            for_each_value_dispatch<true>(f, t, begin(), (other_buffers.begin())...);
         } else {
-            for_each_value_helper<false>(f, dimensions() - 1, t, begin(), (other_buffers.begin())...);
+            for_each_value_dispatch<false>(f, t, begin(), (other_buffers.begin())...);
         }
     }
 
@@ -1870,7 +2004,11 @@ private:
              typename = decltype(std::declval<Fn>()((const int *)nullptr))>
     static void for_each_element(int, int dims, const for_each_element_task_dim *t, Fn &&f, int check = 0) {
         int *pos = (int *)HALIDE_ALLOCA(dims * sizeof(int));
-        for_each_element_array(dims - 1, t, std::forward<Fn>(f), pos);
+        if (Dims != AnyDims) {
+            for_each_element_array_helper<(Dims == AnyDims ? 0 : Dims) - 1, Fn>(0, t, std::forward<Fn>(f), pos);
+        } else {
+            for_each_element_array(dims - 1, t, std::forward<Fn>(f), pos);
+        }
     }
 
     /** This one triggers otherwise. It treats the callable as
@@ -1955,7 +2093,7 @@ private:
     template<typename Fn>
     struct FillHelper {
         Fn f;
-        Buffer<T, D> *buf;
+        Buffer<T, D, Dims> *buf;
 
         template<typename... Args,
                  typename = decltype(std::declval<Fn>()(std::declval<Args>()...))>
@@ -1963,7 +2101,7 @@ private:
             (*buf)(args...) = f(args...);
         }
 
-        FillHelper(Fn &&f, Buffer<T, D> *buf) : f(std::forward<Fn>(f)), buf(buf) {}
+        FillHelper(Fn &&f, Buffer<T, D, Dims> *buf) : f(std::forward<Fn>(f)), buf(buf) {}
     };
 
 public:
@@ -162,6 +162,38 @@ extern struct halide_thread *halide_spawn_thread(void (*f)(void *), void *closur
 /** Join a thread. */
 extern void halide_join_thread(struct halide_thread *);
 
+/** Run tasks min through min + size - 1 concurrently, each on a
+ * thread of its own, and wait for them all to finish. Unlike
+ * halide_do_par_for, the tasks may block on each other. Used to fork
+ * the producer and consumer of a Func scheduled with
+ * Func::async. Returns zero if all the tasks return zero, or the
+ * return value of one of the tasks otherwise. */
+extern int halide_do_fork(void *user_context, halide_task_t task,
+                          int min, int size, uint8_t *closure);
+
+/** A counting semaphore, used by a Func scheduled with Func::async to
+ * synchronize with its consumer. Generated code initializes one by
+ * setting the first 32-bit word to the initial count, and the rest
+ * to zero. */
+struct halide_semaphore_t {
+    uint64_t _private[2];
+};
+
+/** Add n to the count of a semaphore, waking up any threads waiting
+ * on it. */
+extern int halide_semaphore_release(struct halide_semaphore_t *, int n);
+
+/** Wait until the count of a semaphore is at least n, and then
+ * subtract n from it. Returns zero on success, or an error code if
+ * the semaphore was aborted before that could happen. */
+extern int halide_semaphore_acquire(struct halide_semaphore_t *, int n);
+
+/** Abort a semaphore, so that all current and future waits on it
+ * that can't be satisfied fail instead of blocking. Called on exit
+ * from each of the tasks of a fork, so that if one of them fails the
+ * other doesn't wait forever for it. */
+extern void halide_semaphore_abort_as_destructor(void *user_context, void *semaphore);
+
 /** Set the number of threads used by Halide's thread pool. Returns
  * the old number.
  *
@@ -180,6 +212,58 @@ extern void halide_join_thread(struct halide_thread *);
  */
 extern int halide_set_num_threads(int n);
 
+/** Set how long idle threads in Halide's thread pool spin, watching
+ * for new work, before going to sleep. Returns the old value. The
+ * units are iterations of a loop that polls the work queue, roughly
+ * a few nanoseconds each. Spinning trades cpu time for a faster start
+ * to each parallel loop, which helps pipelines with many short
+ * parallel stages. The thread pool adapts the time actually spent
+ * spinning to between 1/16 of this value and this value, depending
+ * on whether spinning has been finding work.
+ *
+ * n < 0  : error condition
+ * n == 0 : never spin
+ * n > 0  : spin for at most n iterations
+ *
+ * The default is 4096, or the value of the environment variable
+ * HL_SPIN_COUNT if it is set. This has no effect on OS X or iOS,
+ * which use grand central dispatch, or with custom implementations
+ * of halide_do_par_for().
+ */
+extern int halide_set_thread_pool_spin_count(int n);
+
+/** Priority classes for the parallel loops of a pipeline. See
+ * halide_get_thread_budget. */
+typedef enum halide_thread_priority_t {
+    halide_thread_priority_normal = 0,
+    halide_thread_priority_high = 1
+} halide_thread_priority_t;
+
+/** Halide's thread pool calls this at the start of each parallel loop
+ * to find how the loop may use the pool. Set *max_threads to the most
+ * threads that may work on the loop at once, counting the calling
+ * thread, or to zero for no limit beyond the size of the pool. Set
+ * *priority to halide_thread_priority_high to let the loop use the
+ * reserved threads (see halide_set_num_reserved_threads). High
+ * priority loops are also run ahead of other waiting loops.
+ *
+ * Implement this yourself to give pipelines different budgets and
+ * priorities depending on the user_context they are called
+ * with. The default implementation sets no limit and normal
+ * priority. It has no effect on OS X or iOS, which use grand central
+ * dispatch, or with custom implementations of halide_do_par_for(). */
+extern void halide_get_thread_budget(void *user_context, int *max_threads,
+                                     halide_thread_priority_t *priority);
+
+/** Reserve the first n threads of Halide's thread pool for high
+ * priority parallel loops, so that they never wait for threads busy
+ * with other work. Returns the old number. Reserved threads count
+ * towards the size of the pool set by halide_set_num_threads, and
+ * the thread calling halide_do_par_for always works on its own loop.
+ * If never called, Halide uses the environment variable
+ * HL_RESERVED_THREADS, or reserves no threads if that is unset. */
+extern int halide_set_num_reserved_threads(int n);
+
 /** Halide calls these functions to allocate and free memory. To
  * replace in AOT code, use the halide_set_custom_malloc and
  * halide_set_custom_free, or (on platforms that support weak
@@ -208,6 +292,84 @@ extern halide_malloc_t halide_set_custom_malloc(halide_malloc_t user_malloc);
 extern halide_free_t halide_set_custom_free(halide_free_t user_free);
 //@}
 
+/** An allocator that keeps freed blocks in a pool, in size classes,
+ * and hands them out again to later allocations of similar size,
+ * instead of going to the system allocator every time a pipeline
+ * runs. Install them with halide_set_custom_malloc and
+ * halide_set_custom_free, or set the environment variable
+ * HL_REUSE_ALLOCATIONS to a limit in megabytes to make the default
+ * allocator use the pool. Freed blocks go back to the system once the
+ * pool holds more than the limit, which is zero unless set by the
+ * environment variable or halide_reuse_allocations_set_limit. Use
+ * halide_reuse_allocations_flush to return everything in the pool to
+ * the system. */
+//@{
+extern void *halide_reuse_allocations_malloc(void *user_context, size_t x);
+extern void halide_reuse_allocations_free(void *user_context, void *ptr);
+extern void halide_reuse_allocations_set_limit(size_t bytes);
+extern void halide_reuse_allocations_flush(void *user_context);
+//@}
+
+/** Scratch arenas used by the code Halide generates for heap
+ * allocations inside parallel loops. A set of arenas is created for
+ * each run of the loop, each task acquires an arena from it, and
+ * allocations within the task bump-allocate from a block the arena
+ * keeps between tasks. All memory comes from halide_malloc and is
+ * returned with halide_free. Not intended to be called directly. */
+//@{
+extern void *halide_scratch_arenas_create(void *user_context);
+extern void halide_scratch_arenas_destroy(void *user_context, void *arenas);
+extern void *halide_scratch_arena_acquire(void *user_context, void *arenas);
+extern void halide_scratch_arena_release(void *user_context, void *arena);
+extern void *halide_scratch_arena_alloc(void *user_context, void *arena, uint64_t size);
+extern void halide_scratch_arena_free(void *user_context, void *ptr);
+//@}
+
+/** The state that Funcs scheduled with Func::stream keep from one call
+ * of a pipeline to the next, looked up by the names of the pipeline
+ * and the Func. halide_stream_state_acquire returns the header in
+ * which the pipeline records what it has computed (zeroed on first
+ * use), and halide_stream_state_data the values, reallocated if their
+ * size changed. halide_stream_state_release does nothing: the state
+ * lives until halide_stream_state_reset, which frees all of it, so
+ * that each stream starts over on the next call. Apart from
+ * halide_stream_state_reset, not intended to be called directly. */
+//@{
+extern void *halide_stream_state_acquire(void *user_context, const char *name, int32_t header_size);
+extern void *halide_stream_state_data(void *user_context, void *header, uint64_t size);
+extern void halide_stream_state_release(void *user_context, void *ptr);
+extern void halide_stream_state_reset(void *user_context);
+//@}
+
+/** Used by entry points built from several schedule variants to pick
+ * one by timing. halide_schedule_variant_begin returns a token whose
+ * value modulo num_variants is the variant to run, and
+ * halide_schedule_variant_end must be passed the token and the
+ * variant's result when it finishes. Each variant is timed once, and
+ * the fastest is used from then on by the whole process. Not intended
+ * to be called directly. */
+//@{
+extern int halide_schedule_variant_begin(void *user_context, const char *name, int num_variants);
+extern int halide_schedule_variant_end(void *user_context, const char *name, int token, int result);
+//@}
+
+/** Used by parallel loops scheduled with TaskSize::Auto to decide how
+ * many iterations each task runs. halide_parallel_task_size returns
+ * the number of iterations per task for a loop of the given extent,
+ * from the estimated cost of an iteration in nanoseconds (zero if
+ * unknown), the time measured for earlier runs of the same loop, and
+ * the size of the thread pool, clamped to [min_size, max_size] (no
+ * upper bound if max_size is zero). halide_parallel_task_size_feedback
+ * records the time taken by a run that started at start_time, as
+ * returned by halide_current_time_ns. Not intended to be called
+ * directly. */
+//@{
+extern int halide_parallel_task_size(void *user_context, const char *name, int extent,
+                                     int64_t cost, int min_size, int max_size);
+extern int halide_parallel_task_size_feedback(void *user_context, const char *name, int extent,
+                                              int task_size, int64_t start_time);
+//@}
+
 /** Halide calls these functions to interact with the underlying
  * system runtime functions. To replace in AOT code on platforms that
  * support weak linking, define these functions yourself, or use
@@ -582,6 +744,25 @@ extern int halide_device_crop(void *user_context,
 extern int halide_device_release_crop(void *user_context,
                                       struct halide_buffer_t *buf);
 
+/** Mark a sub-region of a buffer as dirty on the host, and set
+ * host_dirty. min and extent give the region in each dimension. If
+ * the buffer wasn't already dirty on the host, the next
+ * halide_copy_to_device only copies the regions marked in this way
+ * (as long as the device interface supports cropping). Regions that
+ * overlap or are too numerous are merged into their bounding
+ * boxes. Any other write to the host memory of the buffer before the
+ * next copy must also be marked with this function, because setting
+ * host_dirty directly doesn't discard the recorded regions. Returns
+ * an error if the buffer is dirty on the device. */
+extern int halide_buffer_add_host_dirty_region(void *user_context, struct halide_buffer_t *buf,
+                                               const int *min, const int *extent);
+
+/** The same as halide_buffer_add_host_dirty_region, but for a region
+ * written on the device, which limits the next halide_copy_to_host
+ * instead. */
+extern int halide_buffer_add_device_dirty_region(void *user_context, struct halide_buffer_t *buf,
+                                                 const int *min, const int *extent);
+
 /** Wait for current GPU operations to complete. Calling this explicitly
  * should rarely be necessary, except maybe for profiling. */
 extern int halide_device_sync(void *user_context, struct halide_buffer_t *buf);
@@ -635,7 +816,9 @@ extern int halide_get_gpu_device(void *user_context);
  *  cache will use to memoize Func results.  This is not a strict
  *  maximum in that concurrency and simultaneous use of memoized
  *  reults larger than the cache size can both cause it to
- *  temporariliy be larger than the size specified here.
+ *  temporariliy be larger than the size specified here. Passing zero
+ *  restores the default, which is 64MB unless overridden by the
+ *  environment variable HL_MEMOIZATION_CACHE_SIZE.
  */
 extern void halide_memoization_cache_set_size(int64_t size);
 
@@ -701,6 +884,31 @@ extern void halide_memoization_cache_release(void *user_context, void *host);
  */
 extern void halide_memoization_cache_cleanup();
 
+/** Counters kept by the default memoization cache for a single
+ * memoized Func. The name identifies the pipeline and the Func, in
+ * the form "<length>:<pipeline name><length>:<func name>". */
+struct halide_memoization_cache_stats_t {
+    const char *name;
+    uint64_t hits, misses, evictions;
+};
+
+/** Fill in the counters for up to max_stats memoized Funcs that have
+ * used the cache, and return the number of such Funcs (which may be
+ * more than max_stats). The names remain valid until
+ * halide_memoization_cache_cleanup is called. */
+extern int halide_memoization_cache_get_stats(struct halide_memoization_cache_stats_t *stats,
+                                              int max_stats);
+
+/** Compute a hash of the contents, type, and shape of a buffer, for
+ * use in the cache key of a Func memoized with
+ * Func::memoize_buffer_contents. The hash doesn't depend on the
+ * location of the buffer in memory or its strides. If the contents
+ * would take more than max_bytes, the host side isn't valid, or the
+ * device side is dirty, returns a value unique to this call, so that
+ * the lookup misses. */
+extern uint64_t halide_memoization_hash_buffer(void *user_context, struct halide_buffer_t *buf,
+                                               int64_t max_bytes);
+
 /** Create a unique file with a name of the form prefixXXXXXsuffix in an arbitrary
  * (but writable) directory; this is typically $TMP or /tmp, but the specific
  * location is not guaranteed. (Note that the exact form of the file name
@@ -914,6 +1122,11 @@ enum halide_error_code_t {
      * existed on a different device interface. Free the old one
      * first. */
     halide_error_code_incompatible_device_interface = -42,
+
+    /** An output buffer declared to alias an input buffer shares
+     * memory with it, but is not the same buffer: it has a different
+     * host pointer, min, or stride. */
+    halide_error_code_bad_alias = -43,
 };
 
 /** Halide calls the functions below on various error conditions. The
@@ -971,6 +1184,7 @@ extern int halide_error_debug_to_file_failed(void *user_context, const char *fun
                                              const char *filename, int error_code);
 extern int halide_error_unaligned_host_ptr(void *user_context, const char *func_name, int alignment);
 extern int halide_error_host_is_null(void *user_context, const char *func_name);
+extern int halide_error_bad_alias(void *user_context, const char *output_name, const char *input_name);
 extern int halide_error_failed_to_upgrade_buffer_t(void *user_context,
                                                    const char *input_name,
                                                    const char *reason);
@@ -1026,7 +1240,7 @@ typedef enum halide_target_feature_t {
     halide_target_feature_opengl = 21,  ///< Enable the OpenGL runtime.
     halide_target_feature_openglcompute = 22, ///< Enable OpenGL Compute runtime.
 
-    halide_target_feature_unused_23 = 23, ///< Unused. (Formerly: Enable the RenderScript runtime.)
+    halide_target_feature_power_arch_3_00 = 23, ///< Use POWER ISA 3.00 (POWER9) new instructions. Only relevant on POWERPC. (Formerly: Enable the RenderScript runtime.)
 
     halide_target_feature_user_context = 24,  ///< Generated code takes a user_context pointer as first argument
 
@@ -1059,7 +1273,22 @@ typedef enum halide_target_feature_t {
     halide_target_feature_cuda_capability61 = 46,  ///< Enable CUDA compute capability 6.1 (Pascal)
     halide_target_feature_hvx_v65 = 47, ///< Enable Hexagon v65 architecture.
     halide_target_feature_hvx_v66 = 48, ///< Enable Hexagon v66 architecture.
-    halide_target_feature_end = 49, ///< A sentinel. Every target is considered to have this feature, and setting this feature does nothing.
+    halide_target_feature_pack_allocations = 49, ///< Pack heap allocations with non-overlapping lifetimes into shared slabs.
+    halide_target_feature_arm_dot_prod = 50, ///< Enable the ARMv8.2 dot product instructions (sdot/udot). 64-bit ARM only.
+    halide_target_feature_loop_carry = 51, ///< Reuse values loaded on one loop iteration on the next, instead of loading them again. Always done for Hexagon.
+    halide_target_feature_fuse_gpu_kernels = 52, ///< Merge consecutive GPU kernels with the same geometry and thread-local dependencies into a single launch.
+    halide_target_feature_specialize_unit_stride = 53, ///< Add a fast path to each vectorized loop nest for when the buffers it accesses that have no stride constraint are dense in their innermost dimension.
+    halide_target_feature_lazy_specializations = 54, ///< When jitting, only compile the specializations taken with the current values of the Params, and compile the others the first time they are taken.
+    halide_target_feature_opt_level_0 = 55, ///< Compile quickly: skip the lowering passes and LLVM optimizations that only make the code faster. For small pipelines that are jitted and run a few times.
+    halide_target_feature_opt_level_1 = 56, ///< Compile faster than the default: skip the most expensive lowering passes, and optimize with LLVM at -O1 without the loop and SLP vectorizers.
+    halide_target_feature_precise_math = 57, ///< Compute exp, log, pow, sin and cos on the host with the system math library (about 1 ULP), even when that means calling it once per vector lane.
+    halide_target_feature_fast_math = 58, ///< Compute exp, log and pow on the host with the fast_exp, fast_log and fast_pow approximations instead of the default vectorized polynomials (about 4 ULP).
+    halide_target_feature_arm_fp16 = 59, ///< Enable the ARMv8.2 half-precision arithmetic instructions, and the conversions to and from half precision on 32-bit ARM.
+    halide_target_feature_shared_memoization_cache = 60, ///< Keep the memoization cache in a memory-mapped file shared between processes. See posix_shared_cache.cpp.
+    halide_target_feature_software_pipeline = 61, ///< Load the values the next iteration of innermost serial loops needs one iteration ahead, to hide load latency in latency-bound loops.
+    halide_target_feature_openmp = 62, ///< Run parallel loops on the OpenMP runtime instead of Halide's own thread pool. The program must be linked against an OpenMP runtime. See openmp_thread_pool.cpp.
+    halide_target_feature_cuda_capability70 = 63,  ///< Enable CUDA compute capability 7.0 (Volta), including the tensor cores used by gpu_tensor_core.
+    halide_target_feature_end = 64, ///< A sentinel. Every target is considered to have this feature, and setting this feature does nothing.
 } halide_target_feature_t;
 
 /** This function is called internally by Halide in some situations to determine
@@ -1373,10 +1602,17 @@ struct halide_filter_argument_t {
     const struct halide_scalar_value_t *def;
     const struct halide_scalar_value_t *min;
     const struct halide_scalar_value_t *max;
+    // For buffer arguments whose shape is fixed by the constraints of
+    // the filter, the shape a bounds query proposes for the buffer
+    // when all the buffers passed in satisfy their constraints, with
+    // one entry per dimension. The stride of a dimension is zero if
+    // it isn't fixed. Null otherwise, and for scalar arguments. (Only
+    // present when the version of the metadata is at least 1.)
+    const struct halide_dimension_t *fixed_shape;
 };
 
 struct halide_filter_metadata_t {
-    /** version of this metadata; currently always 0. */
+    /** version of this metadata; currently always 1. */
     int32_t version;
 
     /** The number of entries in the arguments field. This is always >= 1. */
@@ -1400,6 +1636,15 @@ struct halide_filter_metadata_t {
  * the -profile target flag, which runs a sampling profiler thread
  * alongside the pipeline. */
 
+/** The hardware performance counters the profiler can record, as
+ * indices into the counters arrays below. */
+enum {
+    halide_profiler_counter_instructions = 0,
+    halide_profiler_counter_cycles,
+    halide_profiler_counter_cache_misses,
+    halide_profiler_num_counters
+};
+
 /** Per-Func state tracked by the sampling profiler. */
 struct halide_profiler_func_stats {
     /** Total time taken evaluating this Func (in nanoseconds). */
@@ -1420,6 +1665,12 @@ struct halide_profiler_func_stats {
     /** The average number of thread pool worker threads active while computing this Func. */
     uint64_t active_threads_numerator, active_threads_denominator;
 
+    /** Hardware performance counter totals for this Func's threads,
+     * indexed by halide_profiler_counter_*. Only recorded if the
+     * environment variable HL_PROFILER_COUNTERS=1 is set and the
+     * platform supports it (currently x86 Linux). */
+    uint64_t counters[halide_profiler_num_counters];
+
     /** The name of this Func. A global constant string. */
     const char *name;
 
@@ -1427,6 +1678,17 @@ struct halide_profiler_func_stats {
     int num_allocs;
 };
 
+/** Per-branch state tracked by the profiler. The branches are the
+ * ways through the specializations of each stage of a pipeline. */
+struct halide_profiler_branch_stats {
+    /** The number of times this branch was taken. */
+    uint64_t count;
+
+    /** The name of this branch, e.g. "f.s0.specialization.1" or
+     * "f.s0.specialization.default". A global constant string. */
+    const char *name;
+};
+
 /** Per-pipeline state tracked by the sampling profiler. These exist
  * in a linked list. */
 struct halide_profiler_pipeline_stats {
@@ -1446,12 +1708,20 @@ struct halide_profiler_pipeline_stats {
      * work while computing this pipeline. */
     uint64_t active_threads_numerator, active_threads_denominator;
 
+    /** Hardware performance counter totals for this pipeline. See
+     * halide_profiler_func_stats::counters. */
+    uint64_t counters[halide_profiler_num_counters];
+
     /** The name of this pipeline. A global constant string. */
     const char *name;
 
     /** An array containing states for each Func in this pipeline. */
     struct halide_profiler_func_stats *funcs;
 
+    /** An array containing states for each branch in this
+     * pipeline. Null until the pipeline first registers them. */
+    struct halide_profiler_branch_stats *branches;
+
     /** The next pipeline_stats pointer. It's a void * because types
      * in the Halide runtime may not currently be recursive. */
     void *next;
@@ -1459,6 +1729,9 @@ struct halide_profiler_pipeline_stats {
     /** The number of funcs in this pipeline. */
     int num_funcs;
 
+    /** The number of branches in this pipeline. */
+    int num_branches;
+
     /** An internal base id used to identify the funcs in this pipeline. */
     int first_func_id;
 
@@ -1472,6 +1745,10 @@ struct halide_profiler_pipeline_stats {
     int num_allocs;
 };
 
+/** The number of threads whose current Func the profiler can track
+ * separately. Threads beyond this share a single slot. */
+#define HALIDE_PROFILER_MAX_THREAD_SLOTS 256
+
 /** The global state of the profiler. */
 struct halide_profiler_state {
     /** Guards access to the fields below. If not locked, the sampling
@@ -1503,6 +1780,33 @@ struct halide_profiler_state {
 
     /** Is the profiler thread running. */
     bool started;
+
+    /** The interval between samples in microseconds. If nonzero,
+     * this is used instead of sleep_time, which allows sampling more
+     * often than once per millisecond. When the profiler thread
+     * starts, this is initialized from the environment variable
+     * HL_PROFILER_SAMPLE_US if it is zero. */
+    int sleep_time_us;
+
+    /** The id of the Func currently running on each thread doing
+     * work for a Halide pipeline, so that parallel work is attributed
+     * to the right Funcs. Each pipeline invocation and parallel task
+     * claims a slot for its duration. Free slots hold
+     * halide_profiler_slot_free. If all slots are taken, current_func
+     * above is shared instead. */
+    int thread_funcs[HALIDE_PROFILER_MAX_THREAD_SLOTS];
+
+    /** Whether thread_funcs has been initialized. */
+    bool thread_funcs_initialized;
+
+    /** The OS id of the thread that claimed each slot of
+     * thread_funcs. Only recorded if counters_enabled is set. */
+    int thread_ids[HALIDE_PROFILER_MAX_THREAD_SLOTS];
+
+    /** Whether to sample hardware performance counters along with
+     * time. Initialized from the environment variable
+     * HL_PROFILER_COUNTERS. */
+    bool counters_enabled;
 };
 
 /** Profiler func ids with special meanings. */
@@ -1512,7 +1816,9 @@ enum {
     /// Set current_func to this value to tell the profiling thread to
     /// halt. It will start up again next time you run a pipeline with
     /// profiling enabled.
-    halide_profiler_please_stop = -2
+    halide_profiler_please_stop = -2,
+    /// A thread slot that isn't in use by any thread.
+    halide_profiler_slot_free = -3
 };
 
 /** Get a pointer to the global profiler state for programmatic
@@ -1534,6 +1840,23 @@ extern void halide_profiler_reset();
  * reset. Also happens at process exit. */
 extern void halide_profiler_report(void *user_context);
 
+/** Print out the time spent in each Func since the last reset in the
+ * "folded stacks" format understood by flamegraph tools: one line per
+ * Func of the form "pipeline;func microseconds". Setting the
+ * environment variable HL_PROFILER_FLAMEGRAPH=1 makes the report at
+ * process exit use this format. */
+extern void halide_profiler_report_folded(void *user_context);
+
+/** Write the time, memory and thread usage of each pipeline and Func
+ * since the last reset into buf as a JSON object, for tools that
+ * would otherwise have to parse the output of
+ * halide_profiler_report. At most size bytes are written, including
+ * a null terminator. Returns the length of the full report (not
+ * including the terminator), so if the result is size or more, the
+ * report was truncated and should be retried with a larger buffer.
+ * Times are in nanoseconds and memory in bytes. */
+extern int halide_profiler_report_json(void *user_context, char *buf, int size);
+
 /// \name "Float16" functions
 /// These functions operate of bits (``uint16_t``) representing a half
 /// precision floating point number (IEEE-754 2008 binary16).
@@ -1547,7 +1870,9 @@ extern float halide_float16_bits_to_float(uint16_t);
  *  the double that represents the same value */
 extern double halide_float16_bits_to_double(uint16_t);
 
-// TODO: Conversion functions to half
+/** Round a float to the nearest half precision floating point number,
+ * with ties to even, and return its bits. */
+extern uint16_t halide_float_to_float16_bits(float);
 
 //@}
 
@@ -57,6 +57,37 @@ extern int halide_cuda_detach_device_ptr(void *user_context, struct halide_buffe
  */
 extern uintptr_t halide_cuda_get_device_ptr(void *user_context, struct halide_buffer_t *buf);
 
+/** A recording of the kernel launches and copies made by one or more
+ * pipeline calls, which can be replayed with a single call. */
+struct halide_cuda_graph;
+
+/** Start recording the kernel launches and copies made through the
+ * Halide Cuda runtime into a CUDA graph, instead of running them. This
+ * lets a pipeline that launches many small kernels be run again with
+ * one call to halide_cuda_graph_launch, which is much cheaper for the
+ * host than launching each kernel in turn. Nothing is run until
+ * halide_cuda_graph_end_capture is called, so the host code of the
+ * pipeline must not read data computed on the device (e.g. because
+ * of a stage computed on the CPU). Only one graph can be captured at
+ * a time. Device memory the pipeline frees while capturing is kept
+ * alive until the graph is released. Requires CUDA 10.1 or later. */
+extern int halide_cuda_graph_begin_capture(void *user_context);
+
+/** Stop capturing, and run what was captured once. On success, *graph
+ * is set to the new graph. */
+extern int halide_cuda_graph_end_capture(void *user_context, struct halide_cuda_graph **graph);
+
+/** Run the kernels and copies in a graph again, on the stream given
+ * by halide_cuda_get_stream. This is only the same as calling the
+ * pipelines again if they would make exactly the same calls: the
+ * buffers must have the same shapes, host and device pointers, and
+ * dirty bits as during capture, and any scalar parameters must be the
+ * same. The contents of the buffers can differ. */
+extern int halide_cuda_graph_launch(void *user_context, struct halide_cuda_graph *graph);
+
+/** Release a graph and any memory it kept alive. */
+extern int halide_cuda_graph_release(void *user_context, struct halide_cuda_graph *graph);
+
 #ifdef __cplusplus
 } // End extern "C"
 #endif
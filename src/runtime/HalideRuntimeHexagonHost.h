@@ -43,6 +43,23 @@ extern int halide_hexagon_detach_device_handle(void *user_context, struct halide
 extern void *halide_hexagon_get_device_handle(void *user_context, struct halide_buffer_t *buf);
 extern uint64_t halide_hexagon_get_device_size(void *user_context, struct halide_buffer_t *buf);
 
+/** Enable or disable asynchronous offloading. When enabled,
+ * halide_hexagon_run returns as soon as the remote call has started,
+ * so the host can get on with other work (such as the next frame)
+ * while the DSP runs. Call halide_device_sync on an output of the
+ * pipeline to wait for it to finish; this returns any error the run
+ * had. Copying a buffer to or from the device, freeing device memory,
+ * and starting another run also wait for it. Off by default. */
+extern void halide_hexagon_set_async_run(bool async);
+
+/** Enable or disable lazy loading of offloaded kernels. When enabled,
+ * the code of an offloaded pipeline isn't loaded onto the DSP until
+ * the first halide_hexagon_run that needs it, rather than on the first
+ * call to the pipeline. Either way, a pipeline's kernels stay loaded
+ * until halide_hexagon_device_release, and pipelines with identical
+ * kernels share one copy. Off by default. */
+extern void halide_hexagon_set_lazy_loading(bool lazy);
+
 /** Power HVX on and off. Calling a Halide pipeline will do this
  * automatically on each pipeline invocation; however, it costs a
  * small but possibly significant amount of time for short running
@@ -32,6 +32,11 @@ extern int halide_metal_run(void *user_context,
                             float* vertex_buffer,
                             int num_coords_dim0,
                             int num_coords_dim1);
+
+/** Kernel dispatches are encoded into one command buffer, which is
+ * committed when the host needs to see the results, or at the end of
+ * the pipeline, when this is called. */
+extern void halide_metal_finish_pipeline_as_destructor(void *user_context, void *obj);
 // @}
 
 /** Set the underlying MTLBuffer for a halide_buffer_t. This memory should be
@@ -61,6 +61,20 @@ extern void halide_opencl_set_device_type(const char *n);
  * halide_set_ocl_device_type. */
 extern const char *halide_opencl_get_device_type(void *user_context);
 
+/** Set the directory in which compiled OpenCL programs are cached, so
+ * that later runs on the same device and driver can skip building
+ * them from source. Pass NULL or the empty string to disable the
+ * cache. Halide makes its own copy of the string. */
+extern void halide_opencl_set_program_cache_dir(const char *n);
+
+/** Halide calls this to get the directory in which compiled OpenCL
+ * programs are cached. Implement this yourself to use a different
+ * directory per user_context. The default implementation returns the
+ * value set by halide_opencl_set_program_cache_dir, or the environment
+ * variable HL_OCL_PROGRAM_CACHE_DIR. An empty string means that
+ * programs are not cached. */
+extern const char *halide_opencl_get_program_cache_dir(void *user_context);
+
 /** Set the underlying cl_mem for a halide_buffer_t. This memory should be
  * allocated using clCreateBuffer or similar and must have an extent
  * large enough to cover that specified by the halide_buffer_t extent
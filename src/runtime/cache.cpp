@@ -65,6 +65,15 @@ WEAK bool buffer_has_shape(const halide_buffer_t *buf, const halide_dimension_t
     return true;
 }
 
+// Hit, miss and eviction counts for one memoized Func.
+struct FuncCacheStats {
+    FuncCacheStats *next;
+    // A copy of the name stored at the start of the cache key.
+    char *name;
+    // Modified atomically.
+    uint64_t hits, misses, evictions;
+};
+
 struct CacheEntry {
     CacheEntry *next;
     CacheEntry *more_recent;
@@ -72,8 +81,25 @@ struct CacheEntry {
     uint8_t *metadata_storage;
     size_t key_size;
     uint8_t *key;
-    uint32_t hash;
-    uint32_t in_use_count; // 0 if none returned from halide_cache_lookup
+    uint64_t hash;
+    // The number of buffers returned from halide_cache_lookup that
+    // haven't been released yet, or kEntryEvicted once the entry has
+    // been removed from the cache. Modified atomically.
+    uint32_t in_use_count;
+    // Set by lookups that hit without taking the shard lock, which
+    // leave the LRU chain alone. See eviction_candidate.
+    uint32_t referenced;
+    // When this entry was last looked up or stored, in units of cache
+    // operations. Used to break ties between eviction candidates.
+    uint64_t last_used;
+    // How long the entry took to compute, in nanoseconds per KB of
+    // storage. Expensive entries stay in the cache longer.
+    uint64_t cost;
+    // The eviction priority (lowest goes first), which is the cache's
+    // inflation value at the time the entry was last used plus its
+    // cost. See prune_cache.
+    uint64_t priority;
+    FuncCacheStats *stats;
     uint32_t tuple_count;
     // The shape of the computed data. There may be more data allocated than this.
     int32_t dimensions;
@@ -82,7 +108,7 @@ struct CacheEntry {
     halide_buffer_t *buf;
 
     bool init(const uint8_t *cache_key, size_t cache_key_size,
-              uint32_t key_hash,
+              uint64_t key_hash,
               const halide_buffer_t *computed_bounds_buf,
               int32_t tuples, halide_buffer_t **tuple_buffers);
     void destroy();
@@ -92,14 +118,19 @@ struct CacheEntry {
 
 struct CacheBlockHeader {
     CacheEntry *entry;
-    uint32_t hash;
+    uint64_t hash;
+    // When the cache miss that allocated this block happened, so that
+    // the cost of computing its contents is known when it is stored.
+    int64_t miss_time_ns;
+    FuncCacheStats *stats;
 };
 
 // Each host block has extra space to store a header just before the
 // contents. This block must respect the same alignment as
 // halide_malloc, because it offsets the return value from
-// halide_malloc. The header holds the cache key hash and pointer to
-// the hash entry.
+// halide_malloc. The header holds the cache key hash, pointer to
+// the hash entry, and the bookkeeping needed to record the entry's
+// cost and statistics when it is stored.
 WEAK __attribute((always_inline)) size_t header_bytes() {
     size_t s = sizeof(CacheBlockHeader);
     size_t mask = halide_malloc_alignment() - 1;
@@ -111,14 +142,16 @@ WEAK CacheBlockHeader *get_pointer_to_header(uint8_t * host) {
 }
 
 WEAK bool CacheEntry::init(const uint8_t *cache_key, size_t cache_key_size,
-                           uint32_t key_hash, const halide_buffer_t *computed_bounds_buf,
+                           uint64_t key_hash, const halide_buffer_t *computed_bounds_buf,
                            int32_t tuples, halide_buffer_t **tuple_buffers) {
     next = NULL;
     more_recent = NULL;
     less_recent = NULL;
+    stats = NULL;
     key_size = cache_key_size;
     hash = key_hash;
     in_use_count = 0;
+    referenced = 0;
     tuple_count = tuples;
     dimensions = computed_bounds_buf->dimensions;
 
@@ -177,70 +210,345 @@ WEAK void CacheEntry::destroy() {
     halide_free(NULL, metadata_storage);
 }
 
-WEAK uint32_t djb_hash(const uint8_t *key, size_t key_size)  {
-    uint32_t h = 5381;
-    for (size_t i = 0; i < key_size; i++) {
-      h = (h << 5) + h + key[i];
-    }
+// A MurmurHash64A-style hash that consumes the key eight bytes at a
+// time. Cache keys are dominated by scalar parameter values and
+// buffer addresses, so this is much cheaper than hashing byte by
+// byte, and mixes better.
+WEAK uint64_t cache_key_hash(const uint8_t *key, size_t key_size) {
+    const uint64_t m = UINT64_C(0xc6a4a7935bd1e995);
+    const int r = 47;
+    uint64_t h = UINT64_C(0x8445d61a4e774912) ^ (key_size * m);
+    size_t words = key_size / 8;
+    for (size_t i = 0; i < words; i++) {
+        uint64_t k;
+        memcpy(&k, key + i * 8, 8);
+        k *= m;
+        k ^= k >> r;
+        k *= m;
+        h ^= k;
+        h *= m;
+    }
+    size_t tail = key_size & 7;
+    if (tail) {
+        uint64_t k = 0;
+        memcpy(&k, key + words * 8, tail);
+        h ^= k;
+        h *= m;
+    }
+    h ^= h >> r;
+    h *= m;
+    h ^= h >> r;
     return h;
 }
 
-WEAK halide_mutex memoization_lock;
+const uint32_t kEntryEvicted = 0x80000000;
+
+// The cache is divided into independently locked shards, selected by
+// the high bits of the key hash, so that lookups of unrelated keys
+// from different threads don't contend. Each shard has its own hash
+// table, which grows as entries are added, and its own LRU chain. The
+// memory budget is shared by all shards.
+//
+// Lookups that hit don't take the lock: they walk the hash chain
+// concurrently with updates, and take their reference to the entry
+// with an atomic increment of its use count. Updates publish new
+// entries and tables with release stores, and never free memory a
+// lookup may still be looking at until every lookup that started
+// before it was unlinked has finished (see wait_for_readers).
+struct CacheShard {
+    halide_mutex lock;
+    CacheEntry **entries;
+    // Always a power of two (or zero if the table hasn't been
+    // allocated yet).
+    size_t table_size;
+    size_t num_entries;
+    CacheEntry *most_recently_used;
+    CacheEntry *least_recently_used;
+    // The number of lock-free lookups in progress, counted separately
+    // for the lookups that started before and after the last time
+    // the low bit of epoch changed. Modified atomically.
+    uint32_t epoch;
+    uint32_t readers[2];
+};
+
+const size_t kNumCacheShards = 16;
+const size_t kInitialShardTableSize = 16;
+
+WEAK CacheShard cache_shards[kNumCacheShards];
 
-const size_t kHashTableSize = 256;
+// Used to timestamp entries when they are used, so that pruning can
+// tell which of two equally valuable entries was used least recently,
+// even though each shard only orders its own entries.
+WEAK uint64_t cache_use_counter = 0;
 
-WEAK CacheEntry *cache_entries[kHashTableSize];
+// The priority of the most recently evicted entry. Modified atomically.
+WEAK uint64_t cache_inflation = 0;
 
-WEAK CacheEntry *most_recently_used = NULL;
-WEAK CacheEntry *least_recently_used = NULL;
+// How many entries from the least recently used end of each shard are
+// considered for eviction.
+const int kEvictionCandidatesPerShard = 8;
 
-const uint64_t kDefaultCacheSize = 1 << 20;
-WEAK int64_t max_cache_size = kDefaultCacheSize;
+// The budget used if none is set, which can be overridden with the
+// HL_MEMOIZATION_CACHE_SIZE environment variable.
+const int64_t kDefaultCacheSize = 64 << 20;
+// Zero means not yet initialized.
+WEAK int64_t max_cache_size = 0;
+// Modified atomically.
 WEAK int64_t current_cache_size = 0;
 
-#if CACHE_DEBUGGING
-WEAK void validate_cache() {
-    print(NULL) << "validating cache, "
-                << "current size " << current_cache_size
-                << " of maximum " << max_cache_size << "\n";
-    int entries_in_hash_table = 0;
-    for (size_t i = 0; i < kHashTableSize; i++) {
-        CacheEntry *entry = cache_entries[i];
-        while (entry != NULL) {
-            entries_in_hash_table++;
-            if (entry->more_recent == NULL && entry != most_recently_used) {
-                halide_print(NULL, "cache invalid case 1\n");
-                __builtin_trap();
+WEAK halide_mutex func_stats_lock;
+WEAK FuncCacheStats *func_stats = NULL;
+
+WEAK int64_t default_cache_size() {
+    const char *str = getenv("HL_MEMOIZATION_CACHE_SIZE");
+    if (str) {
+        int64_t size = atoi(str);
+        if (size > 0) {
+            return size;
+        }
+    }
+    return kDefaultCacheSize;
+}
+
+WEAK int64_t get_max_cache_size() {
+    int64_t size = __atomic_load_n(&max_cache_size, __ATOMIC_ACQUIRE);
+    if (size == 0) {
+        size = default_cache_size();
+        __atomic_store_n(&max_cache_size, size, __ATOMIC_RELEASE);
+    }
+    return size;
+}
+
+// Find (or make) the statistics for the Func a cache key belongs
+// to. The key starts with a pointer to a string naming the pipeline
+// and the Func.
+WEAK FuncCacheStats *find_func_stats(const uint8_t *cache_key, int32_t size) {
+    if (size < (int32_t)sizeof(const char *)) {
+        return NULL;
+    }
+    const char *name;
+    memcpy(&name, cache_key, sizeof(name));
+
+    ScopedMutexLock lock(&func_stats_lock);
+    for (FuncCacheStats *stats = func_stats; stats != NULL; stats = stats->next) {
+        if (strcmp(stats->name, name) == 0) {
+            return stats;
+        }
+    }
+    FuncCacheStats *stats = (FuncCacheStats *)malloc(sizeof(FuncCacheStats));
+    if (!stats) {
+        return NULL;
+    }
+    size_t len = strlen(name);
+    stats->name = (char *)malloc(len + 1);
+    if (!stats->name) {
+        free(stats);
+        return NULL;
+    }
+    memcpy(stats->name, name, len + 1);
+    stats->hits = stats->misses = stats->evictions = 0;
+    stats->next = func_stats;
+    func_stats = stats;
+    return stats;
+}
+
+WEAK CacheShard &shard_for_hash(uint64_t h) {
+    return cache_shards[(h >> 32) % kNumCacheShards];
+}
+
+WEAK size_t bucket_for_hash(const CacheShard &shard, uint64_t h) {
+    return (size_t)h & (shard.table_size - 1);
+}
+
+// Start a lookup that doesn't hold the shard lock. Returns the
+// epoch to pass to end_read.
+WEAK uint32_t begin_read(CacheShard &shard) {
+    while (true) {
+        uint32_t epoch = __atomic_load_n(&shard.epoch, __ATOMIC_SEQ_CST) & 1;
+        __atomic_fetch_add(&shard.readers[epoch], 1, __ATOMIC_SEQ_CST);
+        // If the epoch changed under us, an update may already have
+        // stopped waiting for the readers of this one.
+        if ((__atomic_load_n(&shard.epoch, __ATOMIC_SEQ_CST) & 1) == epoch) {
+            return epoch;
+        }
+        __atomic_fetch_sub(&shard.readers[epoch], 1, __ATOMIC_SEQ_CST);
+    }
+}
+
+WEAK void end_read(CacheShard &shard, uint32_t epoch) {
+    __atomic_fetch_sub(&shard.readers[epoch], 1, __ATOMIC_RELEASE);
+}
+
+// Wait until no lookup that started before this call is still
+// walking the shard, after which anything it could have reached but
+// that has since been unlinked can be freed. Called with the shard
+// lock held.
+WEAK void wait_for_readers(CacheShard &shard) {
+    uint32_t old_epoch = __atomic_fetch_add(&shard.epoch, 1, __ATOMIC_SEQ_CST) & 1;
+    while (__atomic_load_n(&shard.readers[old_epoch], __ATOMIC_SEQ_CST) != 0) {
+    }
+}
+
+WEAK bool entry_matches(const CacheEntry *entry, uint64_t h,
+                        const uint8_t *cache_key, int32_t size,
+                        const halide_buffer_t *computed_bounds,
+                        int32_t tuple_count, halide_buffer_t **tuple_buffers) {
+    if (entry->hash == h && entry->key_size == (size_t)size &&
+        keys_equal(entry->key, cache_key, size) &&
+        buffer_has_shape(computed_bounds, entry->computed_bounds) &&
+        entry->tuple_count == (uint32_t)tuple_count) {
+        // Check all the tuple buffers have the same bounds (they should).
+        for (int32_t i = 0; i < tuple_count; i++) {
+            if (!buffer_has_shape(tuple_buffers[i], entry->buf[i].dim)) {
+                return false;
             }
-            if (entry->less_recent == NULL && entry != least_recently_used) {
-                halide_print(NULL, "cache invalid case 2\n");
-                __builtin_trap();
+        }
+        return true;
+    }
+    return false;
+}
+
+// Find a matching entry without taking the shard lock, and take
+// tuple_count references to it. Returns NULL if there is none, or if
+// it is being evicted, or if a concurrent update of the shard hid it;
+// the caller then looks again with the lock held.
+WEAK CacheEntry *acquire_entry_lock_free(CacheShard &shard, uint64_t h,
+                                         const uint8_t *cache_key, int32_t size,
+                                         const halide_buffer_t *computed_bounds,
+                                         int32_t tuple_count, halide_buffer_t **tuple_buffers) {
+    uint32_t epoch = begin_read(shard);
+    CacheEntry *result = NULL;
+    // The table is replaced before its size is updated, so this may
+    // index the new table with the old size, but never the reverse.
+    size_t table_size = __atomic_load_n(&shard.table_size, __ATOMIC_ACQUIRE);
+    if (table_size) {
+        CacheEntry **entries = __atomic_load_n(&shard.entries, __ATOMIC_ACQUIRE);
+        CacheEntry *entry = __atomic_load_n(&entries[(size_t)h & (table_size - 1)], __ATOMIC_ACQUIRE);
+        while (entry != NULL) {
+            if (entry_matches(entry, h, cache_key, size, computed_bounds, tuple_count, tuple_buffers)) {
+                uint32_t count = __atomic_load_n(&entry->in_use_count, __ATOMIC_RELAXED);
+                do {
+                    if (count & kEntryEvicted) {
+                        break;
+                    }
+                } while (!__atomic_compare_exchange_n(&entry->in_use_count, &count, count + tuple_count,
+                                                      true, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+                if (!(count & kEntryEvicted)) {
+                    result = entry;
+                }
+                break;
             }
-            entry = entry->next;
+            entry = __atomic_load_n(&entry->next, __ATOMIC_ACQUIRE);
         }
     }
-    int entries_from_mru = 0;
-    CacheEntry *mru_chain = most_recently_used;
-    while (mru_chain != NULL) {
-        entries_from_mru++;
-        mru_chain = mru_chain->less_recent;
+    end_read(shard, epoch);
+    return result;
+}
+
+// Double the size of a shard's hash table (or allocate it, if it is
+// empty). Called with the shard lock held. If the allocation fails,
+// the old table is left in place. Lookups walking the old table while
+// its entries are moved may miss, but never loop: the entries moved
+// so far only lead to each other.
+WEAK void grow_shard_table(CacheShard &shard) {
+    size_t new_size = shard.table_size ? shard.table_size * 2 : kInitialShardTableSize;
+    CacheEntry **new_entries = (CacheEntry **)halide_malloc(NULL, new_size * sizeof(CacheEntry *));
+    if (!new_entries) {
+        return;
+    }
+    memset(new_entries, 0, new_size * sizeof(CacheEntry *));
+    for (size_t i = 0; i < shard.table_size; i++) {
+        CacheEntry *entry = shard.entries[i];
+        while (entry != NULL) {
+            CacheEntry *next = entry->next;
+            size_t index = (size_t)entry->hash & (new_size - 1);
+            __atomic_store_n(&entry->next, new_entries[index], __ATOMIC_RELEASE);
+            new_entries[index] = entry;
+            entry = next;
+        }
     }
-    int entries_from_lru = 0;
-    CacheEntry *lru_chain = least_recently_used;
-    while (lru_chain != NULL) {
-        entries_from_lru++;
-        lru_chain = lru_chain->more_recent;
+    CacheEntry **old_entries = shard.entries;
+    __atomic_store_n(&shard.entries, new_entries, __ATOMIC_RELEASE);
+    __atomic_store_n(&shard.table_size, new_size, __ATOMIC_RELEASE);
+    if (old_entries) {
+        wait_for_readers(shard);
+        halide_free(NULL, old_entries);
     }
-    print(NULL) << "hash entries " << entries_in_hash_table
-                << ", mru entries " << entries_from_mru
-                << ", lru entries " << entries_from_lru << "\n";
-    if (entries_in_hash_table != entries_from_mru) {
-        halide_print(NULL, "cache invalid case 3\n");
-        __builtin_trap();
+}
+
+// Move an entry to the front of its shard's LRU chain, and refresh its
+// eviction priority. Called with the shard lock held.
+WEAK void mark_most_recently_used(void *user_context, CacheShard &shard, CacheEntry *entry) {
+    entry->last_used = __sync_add_and_fetch(&cache_use_counter, 1);
+    entry->priority = __atomic_load_n(&cache_inflation, __ATOMIC_ACQUIRE) + entry->cost;
+    if (entry == shard.most_recently_used) {
+        return;
+    }
+    halide_assert(user_context, entry->more_recent != NULL);
+    if (entry->less_recent != NULL) {
+        entry->less_recent->more_recent = entry->more_recent;
+    } else {
+        halide_assert(user_context, shard.least_recently_used == entry);
+        shard.least_recently_used = entry->more_recent;
     }
-    if (entries_in_hash_table != entries_from_lru) {
-        halide_print(NULL, "cache invalid case 4\n");
-        __builtin_trap();
+    entry->more_recent->less_recent = entry->less_recent;
+
+    entry->more_recent = NULL;
+    entry->less_recent = shard.most_recently_used;
+    if (shard.most_recently_used != NULL) {
+        shard.most_recently_used->more_recent = entry;
+    }
+    shard.most_recently_used = entry;
+}
+
+#if CACHE_DEBUGGING
+WEAK void validate_cache() {
+    print(NULL) << "validating cache, "
+                << "current size " << current_cache_size
+                << " of maximum " << get_max_cache_size() << "\n";
+    for (size_t s = 0; s < kNumCacheShards; s++) {
+        CacheShard &shard = cache_shards[s];
+        size_t entries_in_hash_table = 0;
+        for (size_t i = 0; i < shard.table_size; i++) {
+            CacheEntry *entry = shard.entries[i];
+            while (entry != NULL) {
+                entries_in_hash_table++;
+                if (entry->more_recent == NULL && entry != shard.most_recently_used) {
+                    halide_print(NULL, "cache invalid case 1\n");
+                    __builtin_trap();
+                }
+                if (entry->less_recent == NULL && entry != shard.least_recently_used) {
+                    halide_print(NULL, "cache invalid case 2\n");
+                    __builtin_trap();
+                }
+                entry = entry->next;
+            }
+        }
+        size_t entries_from_mru = 0;
+        CacheEntry *mru_chain = shard.most_recently_used;
+        while (mru_chain != NULL) {
+            entries_from_mru++;
+            mru_chain = mru_chain->less_recent;
+        }
+        size_t entries_from_lru = 0;
+        CacheEntry *lru_chain = shard.least_recently_used;
+        while (lru_chain != NULL) {
+            entries_from_lru++;
+            lru_chain = lru_chain->more_recent;
+        }
+        print(NULL) << "shard " << (int)s
+                    << ": hash entries " << (int)entries_in_hash_table
+                    << ", mru entries " << (int)entries_from_mru
+                    << ", lru entries " << (int)entries_from_lru << "\n";
+        if (entries_in_hash_table != entries_from_mru ||
+            entries_in_hash_table != shard.num_entries) {
+            halide_print(NULL, "cache invalid case 3\n");
+            __builtin_trap();
+        }
+        if (entries_in_hash_table != entries_from_lru) {
+            halide_print(NULL, "cache invalid case 4\n");
+            __builtin_trap();
+        }
     }
     if (current_cache_size < 0) {
         halide_print(NULL, "cache size is negative\n");
@@ -249,62 +557,160 @@ WEAK void validate_cache() {
 }
 #endif
 
-WEAK void prune_cache() {
-#if CACHE_DEBUGGING
-    validate_cache();
-#endif
-    CacheEntry *prune_candidate = least_recently_used;
-    while (current_cache_size > max_cache_size &&
-           prune_candidate != NULL) {
-        CacheEntry *more_recent = prune_candidate->more_recent;
-
-        if (prune_candidate->in_use_count == 0) {
-            uint32_t h = prune_candidate->hash;
-            uint32_t index = h % kHashTableSize;
-
-            // Remove from hash table
-            CacheEntry *prev_hash_entry = cache_entries[index];
-            if (prev_hash_entry == prune_candidate) {
-                cache_entries[index] = prune_candidate->next;
-            } else {
-                while (prev_hash_entry != NULL && prev_hash_entry->next != prune_candidate) {
-                    prev_hash_entry = prev_hash_entry->next;
-                }
-                halide_assert(NULL, prev_hash_entry != NULL);
-                prev_hash_entry->next = prune_candidate->next;
-            }
+// Remove an entry that is not in use from its shard. Called with the
+// shard lock held. Lock-free lookups may still be looking at the
+// entry, so it is only freed once they are done (see prune_cache).
+WEAK void unlink_entry(CacheShard &shard, CacheEntry *prune_candidate) {
+    CacheEntry *more_recent = prune_candidate->more_recent;
+    size_t index = bucket_for_hash(shard, prune_candidate->hash);
+
+    // Remove from hash table
+    CacheEntry *prev_hash_entry = shard.entries[index];
+    if (prev_hash_entry == prune_candidate) {
+        __atomic_store_n(&shard.entries[index], prune_candidate->next, __ATOMIC_RELEASE);
+    } else {
+        while (prev_hash_entry != NULL && prev_hash_entry->next != prune_candidate) {
+            prev_hash_entry = prev_hash_entry->next;
+        }
+        halide_assert(NULL, prev_hash_entry != NULL);
+        __atomic_store_n(&prev_hash_entry->next, prune_candidate->next, __ATOMIC_RELEASE);
+    }
+    shard.num_entries--;
 
-            // Remove from less recent chain.
-            if (least_recently_used == prune_candidate) {
-                least_recently_used = more_recent;
-            }
-            if (more_recent != NULL) {
-                more_recent->less_recent = prune_candidate->less_recent;
-            }
+    // Remove from less recent chain.
+    if (shard.least_recently_used == prune_candidate) {
+        shard.least_recently_used = more_recent;
+    }
+    if (more_recent != NULL) {
+        more_recent->less_recent = prune_candidate->less_recent;
+    }
 
-            // Remove from more recent chain.
-            if (most_recently_used == prune_candidate) {
-                most_recently_used = prune_candidate->less_recent;
-            }
-            if (prune_candidate->less_recent != NULL) {
-                prune_candidate->less_recent = more_recent;
-            }
+    // Remove from more recent chain.
+    if (shard.most_recently_used == prune_candidate) {
+        shard.most_recently_used = prune_candidate->less_recent;
+    }
+    if (prune_candidate->less_recent != NULL) {
+        prune_candidate->less_recent->more_recent = more_recent;
+    }
 
-            // Decrease cache used amount.
-            for (uint32_t i = 0; i < prune_candidate->tuple_count; i++) {
-                current_cache_size -= prune_candidate->buf[i].size_in_bytes();
-            }
+    // Decrease cache used amount.
+    for (uint32_t i = 0; i < prune_candidate->tuple_count; i++) {
+        __sync_sub_and_fetch(&current_cache_size, (int64_t)prune_candidate->buf[i].size_in_bytes());
+    }
+
+    if (prune_candidate->stats) {
+        __sync_add_and_fetch(&prune_candidate->stats->evictions, 1);
+    }
+}
 
-            // Deallocate the entry.
-            prune_candidate->destroy();
-            halide_free(NULL, prune_candidate);
+// Whether entry a should be evicted before entry b.
+WEAK bool evict_before(const CacheEntry *a, const CacheEntry *b) {
+    if (a->priority != b->priority) {
+        return a->priority < b->priority;
+    }
+    return a->last_used < b->last_used;
+}
+
+// The best entry to evict from among the least recently used entries
+// in a shard that aren't currently in use. Called with the shard lock
+// held. Lookups that hit without the lock only mark the entry as
+// referenced, so the LRU chain is a CLOCK: a referenced entry found
+// here gets a second chance, and is moved to the most recently used
+// end instead of being considered.
+WEAK CacheEntry *eviction_candidate(CacheShard &shard) {
+    CacheEntry *best = NULL;
+    int considered = 0;
+    size_t visited = 0;
+    CacheEntry *entry = shard.least_recently_used;
+    while (entry != NULL && considered < kEvictionCandidatesPerShard &&
+           visited++ < shard.num_entries) {
+        CacheEntry *more_recent = entry->more_recent;
+        if (__atomic_load_n(&entry->referenced, __ATOMIC_RELAXED)) {
+            __atomic_store_n(&entry->referenced, 0, __ATOMIC_RELAXED);
+            mark_most_recently_used(NULL, shard, entry);
+        } else if (__atomic_load_n(&entry->in_use_count, __ATOMIC_ACQUIRE) == 0) {
+            considered++;
+            if (best == NULL || evict_before(entry, best)) {
+                best = entry;
+            }
         }
+        entry = more_recent;
+    }
+    return best;
+}
 
-        prune_candidate = more_recent;
+// Evict entries until the cache fits in its budget. Must be called
+// without any shard lock held. Pruning only happens when the cache is
+// over budget, so it takes every shard lock (always in the same order)
+// in order to compare eviction candidates across shards.
+//
+// Entries are evicted using the GreedyDual-Size policy: each entry's
+// priority is its cost to recompute per byte, plus the priority of the
+// last entry evicted at the time the entry was last used. Cheap
+// entries go first, but expensive entries that stop being used
+// eventually age out as the inflation value rises past them. Only the
+// least recently used few entries of each shard are considered, so
+// this degrades to LRU when everything costs the same.
+WEAK void prune_cache() {
+    int64_t max_size = get_max_cache_size();
+    if (__atomic_load_n(&current_cache_size, __ATOMIC_ACQUIRE) <= max_size) {
+        return;
+    }
+    for (size_t s = 0; s < kNumCacheShards; s++) {
+        halide_mutex_lock(&cache_shards[s].lock);
     }
 #if CACHE_DEBUGGING
     validate_cache();
 #endif
+    // Evicted entries are chained through less_recent, which lookups
+    // don't use, until no lookup can reach them.
+    CacheEntry *evicted = NULL;
+    bool shard_evicted[kNumCacheShards] = {false};
+    while (current_cache_size > max_size) {
+        size_t victim_shard = 0;
+        CacheEntry *victim = NULL;
+        for (size_t s = 0; s < kNumCacheShards; s++) {
+            CacheEntry *candidate = eviction_candidate(cache_shards[s]);
+            if (candidate != NULL &&
+                (victim == NULL || evict_before(candidate, victim))) {
+                victim = candidate;
+                victim_shard = s;
+            }
+        }
+        if (victim == NULL) {
+            // Everything left is in use.
+            break;
+        }
+        // A lock-free lookup may have taken a reference since the
+        // candidates were chosen.
+        if (!__sync_bool_compare_and_swap(&victim->in_use_count, 0, kEntryEvicted)) {
+            continue;
+        }
+        if (victim->priority > cache_inflation) {
+            __atomic_store_n(&cache_inflation, victim->priority, __ATOMIC_RELEASE);
+        }
+        unlink_entry(cache_shards[victim_shard], victim);
+        victim->less_recent = evicted;
+        evicted = victim;
+        shard_evicted[victim_shard] = true;
+    }
+#if CACHE_DEBUGGING
+    validate_cache();
+#endif
+    for (size_t s = 0; s < kNumCacheShards; s++) {
+        if (shard_evicted[s]) {
+            wait_for_readers(cache_shards[s]);
+        }
+    }
+    while (evicted != NULL) {
+        CacheEntry *next = evicted->less_recent;
+        evicted->destroy();
+        halide_free(NULL, evicted);
+        evicted = next;
+    }
+    for (size_t s = kNumCacheShards; s > 0; s--) {
+        halide_mutex_unlock(&cache_shards[s - 1].lock);
+    }
 }
 
 }}} // namespace Halide::Runtime::Internal
@@ -313,21 +719,35 @@ extern "C" {
 
 WEAK void halide_memoization_cache_set_size(int64_t size) {
     if (size == 0) {
-        size = kDefaultCacheSize;
+        size = default_cache_size();
     }
 
-    ScopedMutexLock lock(&memoization_lock);
-
-    max_cache_size = size;
+    __atomic_store_n(&max_cache_size, size, __ATOMIC_RELEASE);
     prune_cache();
 }
 
 WEAK int halide_memoization_cache_lookup(void *user_context, const uint8_t *cache_key, int32_t size,
                                          halide_buffer_t *computed_bounds, int32_t tuple_count, halide_buffer_t **tuple_buffers) {
-    uint32_t h = djb_hash(cache_key, size);
-    uint32_t index = h % kHashTableSize;
+    uint64_t h = cache_key_hash(cache_key, size);
+    CacheShard &shard = shard_for_hash(h);
+
+    // Most lookups hit, so try that without the lock first.
+    CacheEntry *hit = acquire_entry_lock_free(shard, h, cache_key, size, computed_bounds,
+                                              tuple_count, tuple_buffers);
+    if (hit != NULL) {
+        if (!__atomic_load_n(&hit->referenced, __ATOMIC_RELAXED)) {
+            __atomic_store_n(&hit->referenced, 1, __ATOMIC_RELAXED);
+        }
+        for (int32_t i = 0; i < tuple_count; i++) {
+            *tuple_buffers[i] = hit->buf[i];
+        }
+        if (hit->stats) {
+            __sync_add_and_fetch(&hit->stats->hits, 1);
+        }
+        return 0;
+    }
 
-    ScopedMutexLock lock(&memoization_lock);
+    ScopedMutexLock lock(&shard.lock);
 
 #if CACHE_DEBUGGING
     debug_print_key(user_context, "halide_memoization_cache_lookup", cache_key, size);
@@ -342,52 +762,35 @@ WEAK int halide_memoization_cache_lookup(void *user_context, const uint8_t *cach
     }
 #endif
 
-    CacheEntry *entry = cache_entries[index];
+    CacheEntry *entry = shard.table_size ? shard.entries[bucket_for_hash(shard, h)] : NULL;
     while (entry != NULL) {
-        if (entry->hash == h && entry->key_size == (size_t)size &&
-            keys_equal(entry->key, cache_key, size) &&
-            buffer_has_shape(computed_bounds, entry->computed_bounds) &&
-            entry->tuple_count == (uint32_t)tuple_count) {
-
-            // Check all the tuple buffers have the same bounds (they should).
-            bool all_bounds_equal = true;
-            for (int32_t i = 0; all_bounds_equal && i < tuple_count; i++) {
-                all_bounds_equal = buffer_has_shape(tuple_buffers[i], entry->buf[i].dim);
-            }
-
-            if (all_bounds_equal) {
-                if (entry != most_recently_used) {
-                    halide_assert(user_context, entry->more_recent != NULL);
-                    if (entry->less_recent != NULL) {
-                        entry->less_recent->more_recent = entry->more_recent;
-                    } else {
-                        halide_assert(user_context, least_recently_used == entry);
-                        least_recently_used = entry->more_recent;
-                    }
-                    halide_assert(user_context, entry->more_recent != NULL);
-                    entry->more_recent->less_recent = entry->less_recent;
-
-                    entry->more_recent = NULL;
-                    entry->less_recent = most_recently_used;
-                    if (most_recently_used != NULL) {
-                        most_recently_used->more_recent = entry;
-                    }
-                    most_recently_used = entry;
-                }
+        if (entry_matches(entry, h, cache_key, size, computed_bounds, tuple_count, tuple_buffers)) {
+            mark_most_recently_used(user_context, shard, entry);
 
-                for (int32_t i = 0; i < tuple_count; i++) {
-                    halide_buffer_t *buf = tuple_buffers[i];
-                    *buf = entry->buf[i];
-                }
+            for (int32_t i = 0; i < tuple_count; i++) {
+                halide_buffer_t *buf = tuple_buffers[i];
+                *buf = entry->buf[i];
+            }
 
-                entry->in_use_count += tuple_count;
+            __sync_add_and_fetch(&entry->in_use_count, tuple_count);
 
-                return 0;
+            if (entry->stats) {
+                __sync_add_and_fetch(&entry->stats->hits, 1);
             }
+
+            return 0;
         }
         entry = entry->next;
     }
 
+    // A miss. The caller is about to compute the result, so we don't
+    // mind taking the statistics lock here.
+    FuncCacheStats *stats = find_func_stats(cache_key, size);
+    if (stats) {
+        __sync_add_and_fetch(&stats->misses, 1);
+    }
+    int64_t miss_time_ns = halide_current_time_ns(user_context);
+
     for (int32_t i = 0; i < tuple_count; i++) {
         halide_buffer_t *buf = tuple_buffers[i];
 
@@ -403,12 +806,10 @@ WEAK int halide_memoization_cache_lookup(void *user_context, const uint8_t *cach
         CacheBlockHeader *header = get_pointer_to_header(buf->host);
         header->hash = h;
         header->entry = NULL;
+        header->miss_time_ns = miss_time_ns;
+        header->stats = stats;
     }
 
-#if CACHE_DEBUGGING
-    validate_cache();
-#endif
-
     return 1;
 }
 
@@ -417,107 +818,124 @@ WEAK int halide_memoization_cache_store(void *user_context, const uint8_t *cache
                                         int32_t tuple_count, halide_buffer_t **tuple_buffers) {
     debug(user_context) << "halide_memoization_cache_store\n";
 
-    uint32_t h = get_pointer_to_header(tuple_buffers[0]->host)->hash;
+    CacheBlockHeader *first_header = get_pointer_to_header(tuple_buffers[0]->host);
+    uint64_t h = first_header->hash;
+    CacheShard &shard = shard_for_hash(h);
 
-    uint32_t index = h % kHashTableSize;
+    int64_t compute_time_ns = halide_current_time_ns(user_context) - first_header->miss_time_ns;
+    if (compute_time_ns < 0) {
+        compute_time_ns = 0;
+    }
 
-    ScopedMutexLock lock(&memoization_lock);
+    {
+        ScopedMutexLock lock(&shard.lock);
 
 #if CACHE_DEBUGGING
-    debug_print_key(user_context, "halide_memoization_cache_store", cache_key, size);
+        debug_print_key(user_context, "halide_memoization_cache_store", cache_key, size);
 
-    debug_print_buffer(user_context, "computed_bounds", *computed_bounds);
+        debug_print_buffer(user_context, "computed_bounds", *computed_bounds);
 
-    {
-        for (int32_t i = 0; i < tuple_count; i++) {
-            halide_buffer_t *buf = tuple_buffers[i];
-            debug_print_buffer(user_context, "Allocation bounds", *buf);
+        {
+            for (int32_t i = 0; i < tuple_count; i++) {
+                halide_buffer_t *buf = tuple_buffers[i];
+                debug_print_buffer(user_context, "Allocation bounds", *buf);
+            }
         }
-    }
 #endif
 
-    CacheEntry *entry = cache_entries[index];
-    while (entry != NULL) {
-        if (entry->hash == h && entry->key_size == (size_t)size &&
-            keys_equal(entry->key, cache_key, size) &&
-            buffer_has_shape(computed_bounds, entry->computed_bounds) &&
-            entry->tuple_count == (uint32_t)tuple_count) {
-
-            bool all_bounds_equal = true;
-            bool no_host_pointers_equal = true;
-            {
-                for (int32_t i = 0; all_bounds_equal && i < tuple_count; i++) {
-                    halide_buffer_t *buf = tuple_buffers[i];
-                    all_bounds_equal = buffer_has_shape(tuple_buffers[i], entry->buf[i].dim);
-                    if (entry->buf[i].host == buf->host) {
-                        no_host_pointers_equal = false;
+        CacheEntry *entry = shard.table_size ? shard.entries[bucket_for_hash(shard, h)] : NULL;
+        while (entry != NULL) {
+            if (entry->hash == h && entry->key_size == (size_t)size &&
+                keys_equal(entry->key, cache_key, size) &&
+                buffer_has_shape(computed_bounds, entry->computed_bounds) &&
+                entry->tuple_count == (uint32_t)tuple_count) {
+
+                bool all_bounds_equal = true;
+                bool no_host_pointers_equal = true;
+                {
+                    for (int32_t i = 0; all_bounds_equal && i < tuple_count; i++) {
+                        halide_buffer_t *buf = tuple_buffers[i];
+                        all_bounds_equal = buffer_has_shape(tuple_buffers[i], entry->buf[i].dim);
+                        if (entry->buf[i].host == buf->host) {
+                            no_host_pointers_equal = false;
+                        }
                     }
                 }
-            }
-            if (all_bounds_equal) {
-                halide_assert(user_context, no_host_pointers_equal);
-                // This entry is still in use by the caller. Mark it as having no cache entry
-                // so halide_memoization_cache_release can free the buffer.
-                for (int32_t i = 0; i < tuple_count; i++) {
-                    get_pointer_to_header(tuple_buffers[i]->host)->entry = NULL;
+                if (all_bounds_equal) {
+                    halide_assert(user_context, no_host_pointers_equal);
+                    // This entry is still in use by the caller. Mark it as having no cache entry
+                    // so halide_memoization_cache_release can free the buffer.
+                    for (int32_t i = 0; i < tuple_count; i++) {
+                        get_pointer_to_header(tuple_buffers[i]->host)->entry = NULL;
 
+                    }
+                    return 0;
                 }
-                return 0;
             }
+            entry = entry->next;
         }
-        entry = entry->next;
-    }
 
-    uint64_t added_size = 0;
-    {
-        for (int32_t i = 0; i < tuple_count; i++) {
-            halide_buffer_t *buf = tuple_buffers[i];
-            added_size += buf->size_in_bytes();
+        // Grow the table if the chains are getting long.
+        if (shard.num_entries >= shard.table_size * 2) {
+            grow_shard_table(shard);
         }
-    }
-    current_cache_size += added_size;
-    prune_cache();
 
-    CacheEntry *new_entry = (CacheEntry *)halide_malloc(NULL, sizeof(CacheEntry));
-    bool inited = false;
-    if (new_entry) {
-        inited = new_entry->init(cache_key, size, h, computed_bounds, tuple_count, tuple_buffers);
-    }
-    if (!inited) {
-        current_cache_size -= added_size;
+        CacheEntry *new_entry = NULL;
+        bool inited = false;
+        if (shard.table_size) {
+            new_entry = (CacheEntry *)halide_malloc(NULL, sizeof(CacheEntry));
+            if (new_entry) {
+                inited = new_entry->init(cache_key, size, h, computed_bounds, tuple_count, tuple_buffers);
+            }
+        }
+        if (!inited) {
+            // This entry is still in use by the caller. Mark it as having no cache entry
+            // so halide_memoization_cache_release can free the buffer.
+            for (int32_t i = 0; i < tuple_count; i++) {
+                get_pointer_to_header(tuple_buffers[i]->host)->entry = NULL;
+            }
 
-        // This entry is still in use by the caller. Mark it as having no cache entry
-        // so halide_memoization_cache_release can free the buffer.
-        for (int32_t i = 0; i < tuple_count; i++) {
-            get_pointer_to_header(tuple_buffers[i]->host)->entry = NULL;
+            if (new_entry) {
+                halide_free(user_context, new_entry);
+            }
+            return 0;
         }
 
-        if (new_entry) {
-            halide_free(user_context, new_entry);
+        size_t index = bucket_for_hash(shard, h);
+        new_entry->next = shard.entries[index];
+        new_entry->less_recent = shard.most_recently_used;
+        if (shard.most_recently_used != NULL) {
+            shard.most_recently_used->more_recent = new_entry;
         }
-        return 0;
-    }
+        shard.most_recently_used = new_entry;
+        if (shard.least_recently_used == NULL) {
+            shard.least_recently_used = new_entry;
+        }
+        new_entry->in_use_count = tuple_count;
+        new_entry->stats = first_header->stats;
 
-    new_entry->next = cache_entries[index];
-    new_entry->less_recent = most_recently_used;
-    if (most_recently_used != NULL) {
-        most_recently_used->more_recent = new_entry;
-    }
-    most_recently_used = new_entry;
-    if (least_recently_used == NULL) {
-        least_recently_used = new_entry;
-    }
-    cache_entries[index] = new_entry;
+        // Publish the entry to lock-free lookups once it's complete.
+        __atomic_store_n(&shard.entries[index], new_entry, __ATOMIC_RELEASE);
+        shard.num_entries++;
 
-    new_entry->in_use_count = tuple_count;
+        for (int32_t i = 0; i < tuple_count; i++) {
+            get_pointer_to_header(tuple_buffers[i]->host)->entry = new_entry;
+        }
 
-    for (int32_t i = 0; i < tuple_count; i++) {
-        get_pointer_to_header(tuple_buffers[i]->host)->entry = new_entry;
+        uint64_t added_size = 0;
+        for (int32_t i = 0; i < tuple_count; i++) {
+            added_size += tuple_buffers[i]->size_in_bytes();
+        }
+        __sync_add_and_fetch(&current_cache_size, (int64_t)added_size);
+
+        new_entry->cost = ((uint64_t)compute_time_ns * 1024) / (added_size ? added_size : 1);
+        new_entry->last_used = __sync_add_and_fetch(&cache_use_counter, 1);
+        new_entry->priority = __atomic_load_n(&cache_inflation, __ATOMIC_ACQUIRE) + new_entry->cost;
     }
 
-#if CACHE_DEBUGGING
-    validate_cache();
-#endif
+    // The new entry is in use, so it won't be evicted.
+    prune_cache();
+
     debug(user_context) << "Exiting halide_memoization_cache_store\n";
 
     return 0;
@@ -531,13 +949,9 @@ WEAK void halide_memoization_cache_release(void *user_context, void *host) {
     if (entry == NULL) {
         halide_free(user_context, header);
     } else {
-        ScopedMutexLock lock(&memoization_lock);
-
-        halide_assert(user_context, entry->in_use_count > 0);
-        entry->in_use_count--;
-#if CACHE_DEBUGGING
-        validate_cache();
-#endif
+        // An entry in use can't be evicted, so this needs no lock.
+        uint32_t count = __sync_fetch_and_sub(&entry->in_use_count, 1);
+        halide_assert(user_context, count > 0 && !(count & kEntryEvicted));
     }
 
     debug(user_context) << "Exited halide_memoization_cache_release.\n";
@@ -545,20 +959,54 @@ WEAK void halide_memoization_cache_release(void *user_context, void *host) {
 
 WEAK void halide_memoization_cache_cleanup() {
     debug(NULL) << "halide_memoization_cache_cleanup\n";
-    for (size_t i = 0; i < kHashTableSize; i++) {
-        CacheEntry *entry = cache_entries[i];
-        cache_entries[i] = NULL;
-        while (entry != NULL) {
-            CacheEntry *next = entry->next;
-            entry->destroy();
-            halide_free(NULL, entry);
-            entry = next;
+    for (size_t s = 0; s < kNumCacheShards; s++) {
+        CacheShard &shard = cache_shards[s];
+        for (size_t i = 0; i < shard.table_size; i++) {
+            CacheEntry *entry = shard.entries[i];
+            shard.entries[i] = NULL;
+            while (entry != NULL) {
+                CacheEntry *next = entry->next;
+                entry->destroy();
+                halide_free(NULL, entry);
+                entry = next;
+            }
         }
+        halide_free(NULL, shard.entries);
+        shard.entries = NULL;
+        shard.table_size = 0;
+        shard.num_entries = 0;
+        shard.most_recently_used = NULL;
+        shard.least_recently_used = NULL;
+        shard.readers[0] = shard.readers[1] = 0;
+        halide_mutex_destroy(&shard.lock);
     }
     current_cache_size = 0;
-    most_recently_used = NULL;
-    least_recently_used = NULL;
-    halide_mutex_destroy(&memoization_lock);
+    cache_inflation = 0;
+
+    FuncCacheStats *stats = func_stats;
+    func_stats = NULL;
+    while (stats != NULL) {
+        FuncCacheStats *next = stats->next;
+        free(stats->name);
+        free(stats);
+        stats = next;
+    }
+    halide_mutex_destroy(&func_stats_lock);
+}
+
+WEAK int halide_memoization_cache_get_stats(halide_memoization_cache_stats_t *stats, int max_stats) {
+    ScopedMutexLock lock(&func_stats_lock);
+    int count = 0;
+    for (FuncCacheStats *s = func_stats; s != NULL; s = s->next) {
+        if (count < max_stats) {
+            stats[count].name = s->name;
+            stats[count].hits = __atomic_load_n(&s->hits, __ATOMIC_ACQUIRE);
+            stats[count].misses = __atomic_load_n(&s->misses, __ATOMIC_ACQUIRE);
+            stats[count].evictions = __atomic_load_n(&s->evictions, __ATOMIC_ACQUIRE);
+        }
+        count++;
+    }
+    return count;
 }
 
 namespace {
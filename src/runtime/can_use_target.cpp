@@ -17,12 +17,14 @@ WEAK int halide_can_use_target_features(uint64_t features) {
 }
 
 WEAK int halide_default_can_use_target_features(uint64_t features) {
-    // cpu features should never change, so call once and cache.
+    // cpu features should never change, so call once and cache. Racing
+    // initializations all compute the same value, but the features
+    // must be visible to other threads before the flag is.
     static bool initialized = false;
     static CpuFeatures cpu_features;
-    if (!initialized) {
+    if (!__atomic_load_n(&initialized, __ATOMIC_ACQUIRE)) {
         cpu_features = halide_get_cpu_features();
-        initialized = true;
+        __atomic_store_n(&initialized, true, __ATOMIC_RELEASE);
     }
 
     uint64_t m;
@@ -1,6 +1,8 @@
 #include "HalideRuntimeCuda.h"
+#include "scoped_spin_lock.h"
 #include "device_buffer_utils.h"
 #include "device_interface.h"
+#include "device_memory_pool.h"
 #include "printer.h"
 #include "mini_cuda.h"
 
@@ -74,9 +76,40 @@ extern WEAK halide_device_interface_t cuda_device_interface;
 WEAK const char *get_error_name(CUresult error);
 WEAK CUresult create_cuda_context(void *user_context, CUcontext *ctx);
 
-// A cuda context defined in this module with weak linkage
-CUcontext WEAK context = 0;
-volatile int WEAK thread_lock = 0;
+// The cuda contexts defined in this module with weak linkage, one
+// per device, indexed by the device number from
+// halide_get_gpu_device plus one. The first one is for a device
+// picked automatically. Each has its own lock, so that pipelines
+// using different devices don't wait on each other.
+#define MAX_CUDA_DEVICES 16
+CUcontext WEAK contexts[MAX_CUDA_DEVICES + 1] = {0};
+volatile int WEAK thread_locks[MAX_CUDA_DEVICES + 1] = {0};
+
+// The slot in contexts for the device a user_context should use.
+WEAK int context_slot(void *user_context) {
+    int device = halide_get_gpu_device(user_context);
+    if (device < 0 || device >= MAX_CUDA_DEVICES) {
+        return 0;
+    }
+    return device + 1;
+}
+
+// Freed device allocations, kept for reuse by the context they belong to.
+WEAK device_pool memory_pool = {0, {NULL}, 0, -1};
+
+// Return the blocks the pool holds for the given context to the
+// driver. The context must be current.
+WEAK void release_pooled_memory(void *user_context, CUcontext ctx) {
+    device_pool_block *block = device_pool_detach(&memory_pool, ctx);
+    while (block) {
+        device_pool_block *next = block->next;
+        debug(user_context) << "    cuMemFree " << (void *)(block->handle) << " (pooled)\n";
+        CUresult err = cuMemFree((CUdeviceptr)block->handle);
+        halide_assert(user_context, err == CUDA_SUCCESS || err == CUDA_ERROR_DEINITIALIZED);
+        free(block);
+        block = next;
+    }
+}
 
 }}}} // namespace Halide::Runtime::Internal::Cuda
 
@@ -86,7 +119,11 @@ using namespace Halide::Runtime::Internal::Cuda;
 extern "C" {
 
 // The default implementation of halide_cuda_acquire_context uses the global
-// pointers above, and serializes access with a spin lock.
+// pointers above, with one context per device, selected for each
+// user_context by halide_get_gpu_device. Access to each is serialized
+// with a spin lock. Overriding halide_get_gpu_device is enough to run
+// different calls to a pipeline (e.g. on different parts of an image)
+// on different devices at the same time.
 // Overriding implementations of acquire/release must implement the following
 // behavior:
 // - halide_cuda_acquire_context should always store a valid context/command
@@ -99,31 +136,30 @@ WEAK int halide_cuda_acquire_context(void *user_context, CUcontext *ctx, bool cr
     // not block execution on failure.
     halide_assert(user_context, ctx != NULL);
 
-    halide_assert(user_context, &thread_lock != NULL);
-    while (__sync_lock_test_and_set(&thread_lock, 1)) { }
+    int slot = context_slot(user_context);
+    while (__sync_lock_test_and_set(&thread_locks[slot], 1)) { }
 
     // If the context has not been initialized, initialize it now.
-    halide_assert(user_context, &context != NULL);
-    if (context == NULL && create) {
-        CUresult error = create_cuda_context(user_context, &context);
+    if (contexts[slot] == NULL && create) {
+        CUresult error = create_cuda_context(user_context, &contexts[slot]);
         if (error != CUDA_SUCCESS) {
-            __sync_lock_release(&thread_lock);
+            __sync_lock_release(&thread_locks[slot]);
             return error;
         }
     }
 
-    *ctx = context;
+    *ctx = contexts[slot];
     return 0;
 }
 
 WEAK int halide_cuda_release_context(void *user_context) {
-    __sync_lock_release(&thread_lock);
+    __sync_lock_release(&thread_locks[context_slot(user_context)]);
     return 0;
 }
 
-// Return the stream to use for executing kernels and synchronization. Only called
-// for versions of cuda which support streams. Default is to use the main stream
-// for the context (NULL stream). The context is passed in for convenience, but
+// Return the stream to use for executing kernels, copies and synchronization. Only
+// called for versions of cuda which support streams. Default is to use the main
+// stream for the context (NULL stream). The context is passed in for convenience, but
 // any sort of scoping must be handled by that of the
 // halide_cuda_acquire_context/halide_cuda_release_context pair, not this call.
 WEAK int halide_cuda_get_stream(void *user_context, CUcontext ctx, CUstream *stream) {
@@ -171,16 +207,158 @@ public:
     }
 };
 
+// Device and page-locked host memory freed while a graph was being
+// captured, which the graph still uses whenever it is launched.
+struct retained_allocation {
+    CUdeviceptr device;
+    void *host;
+    retained_allocation *next;
+};
+
+}}}} // namespace Halide::Runtime::Internal::Cuda
+
+struct halide_cuda_graph {
+    CUcontext context;
+    CUgraph graph;
+    CUgraphExec exec;
+    retained_allocation *retained;
+};
+
+namespace Halide { namespace Runtime { namespace Internal { namespace Cuda {
+
+// The graph being captured, if any, and the stream it is captured
+// from. Only accessed with the context held.
+WEAK halide_cuda_graph *capture_graph = NULL;
+WEAK CUstream capture_stream = NULL;
+
+// Get the stream to use for kernels, copies and synchronization: the
+// one being captured if there's a capture in progress, and otherwise
+// whatever halide_cuda_get_stream says, for versions of cuda that
+// support streams. Must be called with the context held.
+WEAK int get_stream(void *user_context, CUcontext ctx, CUstream *stream) {
+    *stream = NULL;
+    if (capture_graph) {
+        *stream = capture_stream;
+        return 0;
+    }
+    // We use whether this routine was defined in the cuda driver library
+    // as a test for streams support in the cuda implementation.
+    if (cuStreamSynchronize != NULL) {
+        return halide_cuda_get_stream(user_context, ctx, stream);
+    }
+    return 0;
+}
+
+// Keep some memory alive for as long as the graph being captured.
+WEAK bool retain_allocation(CUdeviceptr device, void *host) {
+    retained_allocation *r = (retained_allocation *)malloc(sizeof(retained_allocation));
+    if (!r) {
+        return false;
+    }
+    r->device = device;
+    r->host = host;
+    r->next = capture_graph->retained;
+    capture_graph->retained = r;
+    return true;
+}
+
+// Keep a device allocation in the pool for reuse if it is one we
+// made, i.e. it starts at the beginning of a block with a pooled size,
+// and otherwise give it back to the driver. The context must be
+// current.
+WEAK CUresult free_device_allocation(void *user_context, CUcontext ctx, CUdeviceptr dev_ptr) {
+    CUdeviceptr base = 0;
+    size_t size = 0;
+    CUresult err = cuMemGetAddressRange(&base, &size, dev_ptr);
+    if (err == CUDA_SUCCESS && base == dev_ptr &&
+        device_pool_give(&memory_pool, ctx, (uint64_t)dev_ptr, size)) {
+        debug(user_context) << "    returning " << (void *)(dev_ptr) << " to pool\n";
+        return CUDA_SUCCESS;
+    }
+    debug(user_context) <<  "    cuMemFree " << (void *)(dev_ptr) << "\n";
+    return cuMemFree(dev_ptr);
+}
+
+// Destroy a graph and release the memory it retained. The graph's
+// context must be current.
+WEAK void release_graph(void *user_context, halide_cuda_graph *g) {
+    // A launch of the graph may still be using the retained memory.
+    cuCtxSynchronize();
+    if (g->exec) {
+        cuGraphExecDestroy(g->exec);
+    }
+    if (g->graph) {
+        cuGraphDestroy(g->graph);
+    }
+    while (g->retained) {
+        retained_allocation *r = g->retained;
+        g->retained = r->next;
+        if (r->device) {
+            free_device_allocation(user_context, g->context, r->device);
+        }
+        if (r->host) {
+            debug(user_context) << "    cuMemFreeHost " << r->host << "\n";
+            cuMemFreeHost(r->host);
+        }
+        free(r);
+    }
+    free(g);
+}
+
+WEAK CUresult launch_graph(void *user_context, CUcontext ctx, halide_cuda_graph *g) {
+    CUstream stream = NULL;
+    int result = get_stream(user_context, ctx, &stream);
+    if (result != 0) {
+        error(user_context) << "CUDA: In halide_cuda_graph_launch, halide_cuda_get_stream returned " << result << "\n";
+        return (CUresult)result;
+    }
+    CUresult err = cuGraphLaunch(g->exec, stream);
+    if (err != CUDA_SUCCESS) {
+        error(user_context) << "CUDA: cuGraphLaunch failed: "
+                            << get_error_name(err);
+    }
+    return err;
+}
+
 // Structure to hold the state of a module attached to the context.
 // Also used as a linked-list to keep track of all the different
 // modules that are attached to a context in order to release them all
-// when then context is released.
+// when then context is released. A pipeline may run in several
+// contexts, so this also records what to look up in the module cache
+// below to find the module for any of them.
 struct module_state {
     CUmodule module;
+    CUcontext context;
+    uint64_t hash;
+    int size;
+    unsigned int max_regs;
     module_state *next;
 };
 WEAK module_state *state_list = NULL;
 
+// Modules loaded so far, keyed by a hash of their PTX, so that
+// pipelines containing the same kernels share one module per context
+// rather than each paying for the JIT compilation.
+struct module_cache_entry {
+    CUcontext context;
+    uint64_t hash;
+    int size;
+    unsigned int max_regs;
+    CUmodule module;
+    module_cache_entry *next;
+};
+WEAK module_cache_entry *module_cache = NULL;
+WEAK volatile int module_cache_lock = 0;
+
+WEAK uint64_t hash_ptx(const char *src, int size) {
+    // FNV-1a
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (int i = 0; i < size; i++) {
+        h = (h ^ (uint8_t)src[i]) * 0x100000001b3ULL;
+    }
+    return h;
+}
+
 WEAK CUresult create_cuda_context(void *user_context, CUcontext *ctx) {
     // Initialize CUDA
     CUresult err = cuInit(0);
@@ -333,7 +511,8 @@ WEAK CUresult create_cuda_context(void *user_context, CUcontext *ctx) {
     }
     // Creation automatically pushes the context, but we'll pop to allow the caller
     // to decide when to push.
-    err = cuCtxPopCurrent(&context);
+    CUcontext popped;
+    err = cuCtxPopCurrent(&popped);
     if (err != CUDA_SUCCESS) {
       error(user_context) << "CUDA: cuCtxPopCurrent failed: "
                           << get_error_name(err);
@@ -399,16 +578,31 @@ WEAK int halide_cuda_initialize_kernels(void *user_context, void **state_ptr, co
     // of how many times halide_initialize_kernels/halide_release is called.
     // halide_release traverses this list and releases the module objects, but
     // it does not modify the list nodes created/inserted here.
+    // Pipelines containing the same kernels (such as a JIT pipeline
+    // that is compiled again) share a state object, so that the list
+    // doesn't grow each time one is compiled.
     module_state **state = (module_state**)state_ptr;
+    uint64_t hash = hash_ptx(ptx_src, size);
     if (!(*state)) {
-        *state = (module_state*)malloc(sizeof(module_state));
-        (*state)->module = NULL;
-        (*state)->next = state_list;
-        state_list = *state;
+        ScopedSpinLock lock(&module_cache_lock);
+        module_state *s = state_list;
+        while (s && !(s->hash == hash && s->size == size)) {
+            s = s->next;
+        }
+        if (!s) {
+            s = (module_state*)malloc(sizeof(module_state));
+            s->module = NULL;
+            s->context = NULL;
+            s->hash = hash;
+            s->size = size;
+            s->next = state_list;
+            state_list = s;
+        }
+        *state = s;
     }
 
     // Create the module itself if necessary.
-    if (!(*state)->module) {
+    if (!(*state)->module || (*state)->context != ctx.context) {
         debug(user_context) <<  "    cuModuleLoadData " << (void *)ptx_src << ", " << size << " -> ";
 
         CUjit_option options[] = { CU_JIT_MAX_REGISTERS };
@@ -422,15 +616,67 @@ WEAK int halide_cuda_initialize_kernels(void *user_context, void **state_ptr, co
             max_regs_per_thread = atoi(regs);
         }
         void *optionValues[] = { (void*)(uintptr_t) max_regs_per_thread };
-        CUresult err = cuModuleLoadDataEx(&(*state)->module, ptx_src, 1, options, optionValues);
 
-        if (err != CUDA_SUCCESS) {
-            debug(user_context) << get_error_name(err) << "\n";
-            error(user_context) << "CUDA: cuModuleLoadData failed: "
-                                << get_error_name(err);
-            return err;
+        (*state)->context = ctx.context;
+        (*state)->max_regs = max_regs_per_thread;
+        ScopedSpinLock lock(&module_cache_lock);
+        module_cache_entry *entry = module_cache;
+        while (entry && !(entry->context == ctx.context &&
+                          entry->hash == hash &&
+                          entry->size == size &&
+                          entry->max_regs == max_regs_per_thread)) {
+            entry = entry->next;
+        }
+        if (entry) {
+            (*state)->module = entry->module;
+            debug(user_context) << (void *)((*state)->module) << " (cached)\n";
         } else {
-            debug(user_context) << (void *)((*state)->module) << "\n";
+            // The cache owns the module, so make room for it first.
+            entry = (module_cache_entry *)malloc(sizeof(module_cache_entry));
+            if (!entry) {
+                error(user_context) << "CUDA: Out of memory allocating module cache entry\n";
+                return CUDA_ERROR_OUT_OF_MEMORY;
+            }
+
+            // The compiler may have assembled the PTX ahead of time
+            // (see CodeGen_PTX_Dev::assemble_cubin), in which case the
+            // source starts with "HLCUBIN\0", then the size of the cubin
+            // as a little-endian uint32, the cubin, and the PTX.
+            CUresult err = CUDA_ERROR_INVALID_IMAGE;
+            const char *ptx = ptx_src;
+            const int header_size = 12;
+            if (size > header_size && memcmp(ptx_src, "HLCUBIN", 8) == 0) {
+                const uint8_t *b = (const uint8_t *)ptx_src + 8;
+                uint32_t cubin_size = b[0] | (b[1] << 8) | (b[2] << 16) | ((uint32_t)b[3] << 24);
+                halide_assert(user_context, (int64_t)cubin_size + header_size < (int64_t)size);
+                err = cuModuleLoadData(&(*state)->module, ptx_src + header_size);
+                if (err != CUDA_SUCCESS) {
+                    // Probably built for a different GPU.
+                    debug(user_context) << "cubin rejected (" << get_error_name(err) << "), using PTX -> ";
+                }
+                ptx = ptx_src + header_size + cubin_size;
+            }
+            if (err != CUDA_SUCCESS) {
+                err = cuModuleLoadDataEx(&(*state)->module, ptx, 1, options, optionValues);
+            }
+
+            if (err != CUDA_SUCCESS) {
+                free(entry);
+                debug(user_context) << get_error_name(err) << "\n";
+                error(user_context) << "CUDA: cuModuleLoadData failed: "
+                                    << get_error_name(err);
+                return err;
+            } else {
+                debug(user_context) << (void *)((*state)->module) << "\n";
+            }
+
+            entry->context = ctx.context;
+            entry->hash = hash;
+            entry->size = size;
+            entry->max_regs = max_regs_per_thread;
+            entry->module = (*state)->module;
+            entry->next = module_cache;
+            module_cache = entry;
         }
     }
 
@@ -466,8 +712,14 @@ WEAK int halide_cuda_device_free(void *user_context, halide_buffer_t* buf) {
 
     halide_assert(user_context, validate_device_pointer(user_context, buf));
 
-    debug(user_context) <<  "    cuMemFree " << (void *)(dev_ptr) << "\n";
-    CUresult err = cuMemFree(dev_ptr);
+    CUresult err = CUDA_SUCCESS;
+    if (capture_graph && retain_allocation(dev_ptr, NULL)) {
+        // The captured kernels and copies haven't run yet, and will
+        // use this memory again each time the graph is launched.
+        debug(user_context) << "    retaining " << (void *)(dev_ptr) << " for graph\n";
+    } else {
+        err = free_device_allocation(user_context, ctx.context, dev_ptr);
+    }
     // If cuMemFree fails, it isn't likely to succeed later, so just drop
     // the reference.
     buf->device_interface->impl->release_module();
@@ -507,32 +759,50 @@ WEAK int halide_cuda_device_release(void *user_context) {
         }
         halide_assert(user_context, err == CUDA_SUCCESS || err == CUDA_ERROR_DEINITIALIZED);
 
-        // Unload the modules attached to this context. Note that the list
-        // nodes themselves are not freed, only the module objects are
-        // released. Subsequent calls to halide_init_kernels might re-create
-        // the program object using the same list node to store the module
-        // object.
+        release_pooled_memory(user_context, ctx);
+
+        // Detach the modules from the pipelines' states. Note that the
+        // list nodes themselves are not freed. Subsequent calls to
+        // halide_init_kernels might re-create the module object using
+        // the same list node to store the module object.
         module_state *state = state_list;
         while (state) {
-            if (state->module) {
-                debug(user_context) << "    cuModuleUnload " << state->module << "\n";
-                err = cuModuleUnload(state->module);
-                halide_assert(user_context, err == CUDA_SUCCESS || err == CUDA_ERROR_DEINITIALIZED);
+            if (state->context == ctx) {
                 state->module = 0;
             }
             state = state->next;
         }
 
+        // Unload the modules belonging to this context, which the
+        // module cache owns.
+        {
+            ScopedSpinLock lock(&module_cache_lock);
+            module_cache_entry **prev = &module_cache;
+            while (*prev) {
+                module_cache_entry *entry = *prev;
+                if (entry->context == ctx) {
+                    debug(user_context) << "    cuModuleUnload " << entry->module << "\n";
+                    err = cuModuleUnload(entry->module);
+                    halide_assert(user_context, err == CUDA_SUCCESS || err == CUDA_ERROR_DEINITIALIZED);
+                    *prev = entry->next;
+                    free(entry);
+                } else {
+                    prev = &entry->next;
+                }
+            }
+        }
+
         CUcontext old_ctx;
         cuCtxPopCurrent(&old_ctx);
 
         // Only destroy the context if we own it
-        if (ctx == context) {
-            debug(user_context) << "    cuCtxDestroy " << context << "\n";
+        int slot = context_slot(user_context);
+        if (ctx == contexts[slot]) {
+            debug(user_context) << "    cuCtxDestroy " << ctx << "\n";
             err = cuProfilerStop();
-            err = cuCtxDestroy(context);
+            err = cuCtxDestroy(ctx);
             halide_assert(user_context, err == CUDA_SUCCESS || err == CUDA_ERROR_DEINITIALIZED);
-            context = NULL;
+            contexts[slot] = NULL;
         }
     }
 
@@ -570,9 +840,20 @@ WEAK int halide_cuda_device_malloc(void *user_context, halide_buffer_t *buf) {
     uint64_t t_before = halide_current_time_ns(user_context);
     #endif
 
-    CUdeviceptr p;
-    debug(user_context) << "    cuMemAlloc " << (uint64_t)size << " -> ";
-    CUresult err = cuMemAlloc(&p, size);
+    CUdeviceptr p = (CUdeviceptr)device_pool_take(&memory_pool, ctx.context, size);
+    CUresult err = CUDA_SUCCESS;
+    if (p) {
+        debug(user_context) << "    reusing pooled allocation -> ";
+    } else {
+        size_t alloc_size = device_pool_allocation_size(&memory_pool, size);
+        debug(user_context) << "    cuMemAlloc " << (uint64_t)alloc_size << " -> ";
+        err = cuMemAlloc(&p, alloc_size);
+        if (err == CUDA_ERROR_OUT_OF_MEMORY) {
+            // Give the memory held by the pool back and try again.
+            release_pooled_memory(user_context, ctx.context);
+            err = cuMemAlloc(&p, alloc_size);
+        }
+    }
     if (err != CUDA_SUCCESS) {
         debug(user_context) << get_error_name(err) << "\n";
         error(user_context) << "CUDA: cuMemAlloc failed: "
@@ -595,8 +876,11 @@ WEAK int halide_cuda_device_malloc(void *user_context, halide_buffer_t *buf) {
 }
 
 namespace {
+// Copies between devices pass the contexts the source and destination
+// memory belong to if they differ, and NULL otherwise.
 WEAK int do_multidimensional_copy(void *user_context, const device_copy &c,
-                                  uint64_t src, uint64_t dst, int d, bool from_host, bool to_host) {
+                                  uint64_t src, uint64_t dst, int d, bool from_host, bool to_host,
+                                  CUstream stream, CUcontext src_ctx, CUcontext dst_ctx) {
     if (d > MAX_COPY_DIMS) {
         error(user_context) << "Buffer has too many dimensions to copy to/from GPU\n";
         return -1;
@@ -606,12 +890,21 @@ WEAK int do_multidimensional_copy(void *user_context, const device_copy &c,
         debug(user_context) << "    from " << (from_host ? "host" : "device")
                             << " to " << (to_host ? "host" : "device") << ", "
                             << (void *)src << " -> " << (void *)dst << ", " << c.chunk_size << " bytes\n";
+        // The copies are queued on the stream the kernels run on, so
+        // that they are ordered with respect to them without
+        // synchronizing the whole context.
         if (!from_host && to_host) {
-            err = cuMemcpyDtoH((void *)dst, (CUdeviceptr)src, c.chunk_size);
+            copy_name = "cuMemcpyDtoHAsync";
+            err = cuMemcpyDtoHAsync((void *)dst, (CUdeviceptr)src, c.chunk_size, stream);
         } else if (from_host && !to_host) {
-            err = cuMemcpyHtoD((CUdeviceptr)dst, (void *)src, c.chunk_size);
+            copy_name = "cuMemcpyHtoDAsync";
+            err = cuMemcpyHtoDAsync((CUdeviceptr)dst, (void *)src, c.chunk_size, stream);
+        } else if (!from_host && !to_host && src_ctx != dst_ctx) {
+            copy_name = "cuMemcpyPeerAsync";
+            err = cuMemcpyPeerAsync((CUdeviceptr)dst, dst_ctx, (CUdeviceptr)src, src_ctx, c.chunk_size, stream);
         } else if (!from_host && !to_host) {
-            err = cuMemcpyDtoD((CUdeviceptr)dst, (CUdeviceptr)src, c.chunk_size);
+            copy_name = "cuMemcpyDtoDAsync";
+            err = cuMemcpyDtoDAsync((CUdeviceptr)dst, (CUdeviceptr)src, c.chunk_size, stream);
         } else if (dst != src) {
             // Could reach here if a user called directly into the
             // cuda API for a device->host copy on a source buffer
@@ -625,7 +918,8 @@ WEAK int do_multidimensional_copy(void *user_context, const device_copy &c,
     } else {
         ssize_t src_off = 0, dst_off = 0;
         for (int i = 0; i < (int)c.extent[d-1]; i++) {
-            int err = do_multidimensional_copy(user_context, c, src + src_off, dst + dst_off, d - 1, from_host, to_host);
+            int err = do_multidimensional_copy(user_context, c, src + src_off, dst + dst_off, d - 1, from_host, to_host,
+                                               stream, src_ctx, dst_ctx);
             dst_off += c.dst_stride_bytes[d-1];
             src_off += c.src_stride_bytes[d-1];
             if (err) {
@@ -635,6 +929,59 @@ WEAK int do_multidimensional_copy(void *user_context, const device_copy &c,
     }
     return 0;
 }
+
+// Find the contexts the memory of a device to device copy belongs to,
+// for copies between buffers allocated by different contexts (usually
+// on different devices). Sets both to NULL if they're the same, or
+// can't be determined, in which case a plain device to device copy
+// is used. Otherwise, finishes any work the source context has queued
+// on the source, and enables direct access to it from the destination
+// context where possible, so that the copy doesn't go through host
+// memory. Called with the destination context current.
+WEAK int get_peer_contexts(void *user_context, uint64_t src, uint64_t dst,
+                           CUcontext *src_ctx, CUcontext *dst_ctx) {
+    *src_ctx = NULL;
+    *dst_ctx = NULL;
+    if (cuMemcpyPeerAsync == NULL) {
+        return 0;
+    }
+    CUcontext s = NULL, d = NULL;
+    if (cuPointerGetAttribute(&s, CU_POINTER_ATTRIBUTE_CONTEXT, (CUdeviceptr)src) != CUDA_SUCCESS ||
+        cuPointerGetAttribute(&d, CU_POINTER_ATTRIBUTE_CONTEXT, (CUdeviceptr)dst) != CUDA_SUCCESS ||
+        s == d || s == NULL || d == NULL) {
+        return 0;
+    }
+
+    debug(user_context) << "    peer copy from context " << (void *)s << " to context " << (void *)d << "\n";
+
+    // The copy is queued on a stream of the destination context, so
+    // it isn't ordered with respect to the source context's work.
+    CUresult err = cuCtxPushCurrent(s);
+    if (err == CUDA_SUCCESS) {
+        err = cuCtxSynchronize();
+        CUcontext old;
+        cuCtxPopCurrent(&old);
+    }
+    if (err != CUDA_SUCCESS) {
+        error(user_context) << "CUDA: synchronizing the source of a peer copy failed: "
+                            << get_error_name(err);
+        return err;
+    }
+
+    // Peer access is only possible between some pairs of devices. If
+    // it isn't, cuMemcpyPeerAsync still works, but stages the copy in
+    // host memory.
+    if (cuCtxEnablePeerAccess != NULL) {
+        err = cuCtxEnablePeerAccess(s, 0);
+        if (err != CUDA_SUCCESS && err != CUDA_ERROR_PEER_ACCESS_ALREADY_ENABLED) {
+            debug(user_context) << "    cuCtxEnablePeerAccess failed: " << get_error_name(err) << "\n";
+        }
+    }
+
+    *src_ctx = s;
+    *dst_ctx = d;
+    return 0;
+}
 }
 
 WEAK int halide_cuda_buffer_copy(void *user_context, struct halide_buffer_t *src,
@@ -684,7 +1031,47 @@ WEAK int halide_cuda_buffer_copy(void *user_context, struct halide_buffer_t *src
         }
         #endif
 
-        err = do_multidimensional_copy(user_context, c, c.src + c.src_begin, c.dst, dst->dimensions, from_host, to_host);
+        CUstream stream = NULL;
+        int result = get_stream(user_context, ctx.context, &stream);
+        if (result != 0) {
+            error(user_context) << "CUDA: In halide_cuda_buffer_copy, halide_cuda_get_stream returned " << result << "\n";
+            return result;
+        }
+
+        CUcontext src_ctx = NULL, dst_ctx = NULL;
+        if (!from_host && !to_host) {
+            err = get_peer_contexts(user_context, c.src + c.src_begin, c.dst, &src_ctx, &dst_ctx);
+            if (err) {
+                return err;
+            }
+        }
+
+        err = do_multidimensional_copy(user_context, c, c.src + c.src_begin, c.dst, dst->dimensions, from_host, to_host,
+                                       stream, src_ctx, dst_ctx);
+
+        // The host may read the result as soon as we return. Copies to
+        // the device only need to be ordered before the kernels that
+        // read them, which the stream does for us, unless the source
+        // is page-locked: then the copy reads it directly, so the host
+        // must not write to it again until the copy is done. Likewise,
+        // the source context of a peer copy doesn't know to wait for
+        // it before writing to the source again.
+        bool must_sync = (to_host && !from_host) || src_ctx != dst_ctx;
+        unsigned int host_flags;
+        if (from_host && !to_host &&
+            cuMemHostGetFlags(&host_flags, (void *)(c.src + c.src_begin)) == CUDA_SUCCESS) {
+            must_sync = true;
+        }
+        // While capturing a graph, nothing runs, so there's nothing to
+        // wait for.
+        if (err == 0 && must_sync && !capture_graph) {
+            CUresult result = (cuStreamSynchronize != NULL) ? cuStreamSynchronize(stream) : cuCtxSynchronize();
+            if (result != CUDA_SUCCESS) {
+                error(user_context) << "CUDA: synchronizing after copy failed: "
+                                    << get_error_name(result);
+                err = result;
+            }
+        }
 
         #ifdef DEBUG_RUNTIME
         uint64_t t_after = halide_current_time_ns(user_context);
@@ -735,10 +1122,14 @@ WEAK int halide_cuda_device_sync(void *user_context, struct halide_buffer_t *) {
     uint64_t t_before = halide_current_time_ns(user_context);
     #endif
 
+    if (capture_graph) {
+        return 0;
+    }
+
     CUresult err;
     if (cuStreamSynchronize != NULL) {
         CUstream stream;
-        int result = halide_cuda_get_stream(user_context, ctx.context, &stream);
+        int result = get_stream(user_context, ctx.context, &stream);
         if (result != 0) {
             error(user_context) << "CUDA: In halide_cuda_device_sync, halide_cuda_get_stream returned " << result << "\n";
         }
@@ -794,7 +1185,22 @@ WEAK int halide_cuda_run(void *user_context,
     #endif
 
     halide_assert(user_context, state_ptr);
-    CUmodule mod = ((module_state*)state_ptr)->module;
+    // Other calls to this pipeline may be running in other contexts at
+    // the same time, so find the module for this one in the cache.
+    module_state *state = (module_state *)state_ptr;
+    CUmodule mod = NULL;
+    {
+        ScopedSpinLock lock(&module_cache_lock);
+        for (module_cache_entry *entry = module_cache; entry; entry = entry->next) {
+            if (entry->context == ctx.context &&
+                entry->hash == state->hash &&
+                entry->size == state->size &&
+                entry->max_regs == state->max_regs) {
+                mod = entry->module;
+                break;
+            }
+        }
+    }
     debug(user_context) << "Got module " << mod << "\n";
     halide_assert(user_context, mod);
     CUfunction f;
@@ -832,13 +1238,9 @@ WEAK int halide_cuda_run(void *user_context,
     }
 
     CUstream stream = NULL;
-    // We use whether this routine was defined in the cuda driver library
-    // as a test for streams support in the cuda implementation.
-    if (cuStreamSynchronize != NULL) {
-        int result = halide_cuda_get_stream(user_context, ctx.context, &stream);
-        if (result != 0) {
-            error(user_context) << "CUDA: In halide_cuda_run, halide_cuda_get_stream returned " << result << "\n";
-        }
+    int result = get_stream(user_context, ctx.context, &stream);
+    if (result != 0) {
+        error(user_context) << "CUDA: In halide_cuda_run, halide_cuda_get_stream returned " << result << "\n";
     }
 
     err = cuLaunchKernel(f,
@@ -857,11 +1259,13 @@ WEAK int halide_cuda_run(void *user_context,
     }
 
     #ifdef DEBUG_RUNTIME
-    err = cuCtxSynchronize();
-    if (err != CUDA_SUCCESS) {
-        error(user_context) << "CUDA: cuCtxSynchronize failed: "
-                            << get_error_name(err);
-        return err;
+    if (!capture_graph) {
+        err = cuCtxSynchronize();
+        if (err != CUDA_SUCCESS) {
+            error(user_context) << "CUDA: cuCtxSynchronize failed: "
+                                << get_error_name(err);
+            return err;
+        }
     }
     uint64_t t_after = halide_current_time_ns(user_context);
     debug(user_context) << "    Time: " << (t_after - t_before) / 1.0e6 << " ms\n";
@@ -870,11 +1274,77 @@ WEAK int halide_cuda_run(void *user_context,
 }
 
 WEAK int halide_cuda_device_and_host_malloc(void *user_context, struct halide_buffer_t *buf) {
-    return halide_default_device_and_host_malloc(user_context, buf, &cuda_device_interface);
+    debug(user_context)
+        << "CUDA: halide_cuda_device_and_host_malloc (user_context: " << user_context
+        << ", buf: " << buf << ")\n";
+
+    // Use page-locked host memory, so that copies to and from the
+    // device can be done by DMA without staging them through a driver
+    // buffer.
+    void *host = NULL;
+    {
+        Context ctx(user_context);
+        if (ctx.error != CUDA_SUCCESS) {
+            return ctx.error;
+        }
+        size_t size = buf->size_in_bytes();
+        debug(user_context) << "    cuMemHostAlloc " << (uint64_t)size << " -> ";
+        CUresult err = cuMemHostAlloc(&host, size, 0);
+        if (err != CUDA_SUCCESS) {
+            // Pinned memory is a limited resource, so fall back to
+            // ordinary host memory.
+            debug(user_context) << get_error_name(err) << "\n";
+            host = NULL;
+        } else {
+            debug(user_context) << host << "\n";
+        }
+    }
+    if (!host) {
+        return halide_default_device_and_host_malloc(user_context, buf, &cuda_device_interface);
+    }
+
+    buf->host = (uint8_t *)host;
+    int result = halide_cuda_device_malloc(user_context, buf);
+    if (result != 0) {
+        Context ctx(user_context);
+        cuMemFreeHost(host);
+        buf->host = NULL;
+    }
+    return result;
 }
 
 WEAK int halide_cuda_device_and_host_free(void *user_context, struct halide_buffer_t *buf) {
-    return halide_default_device_and_host_free(user_context, buf, &cuda_device_interface);
+    debug(user_context)
+        << "CUDA: halide_cuda_device_and_host_free (user_context: " << user_context
+        << ", buf: " << buf << ")\n";
+
+    bool pinned = false;
+    if (buf->host) {
+        Context ctx(user_context);
+        if (ctx.error != CUDA_SUCCESS) {
+            return ctx.error;
+        }
+        unsigned int flags;
+        pinned = cuMemHostGetFlags(&flags, buf->host) == CUDA_SUCCESS;
+    }
+    if (!pinned) {
+        return halide_default_device_and_host_free(user_context, buf, &cuda_device_interface);
+    }
+
+    int result = halide_cuda_device_free(user_context, buf);
+    {
+        Context ctx(user_context);
+        if (capture_graph && retain_allocation(0, buf->host)) {
+            debug(user_context) << "    retaining " << buf->host << " for graph\n";
+        } else {
+            debug(user_context) << "    cuMemFreeHost " << buf->host << "\n";
+            cuMemFreeHost(buf->host);
+        }
+        buf->host = NULL;
+    }
+    buf->set_host_dirty(false);
+    buf->set_device_dirty(false);
+    return result;
 }
 
 WEAK int halide_cuda_wrap_device_ptr(void *user_context, struct halide_buffer_t *buf, uint64_t device_ptr) {
@@ -915,6 +1385,129 @@ WEAK uintptr_t halide_cuda_get_device_ptr(void *user_context, struct halide_buff
     return (uintptr_t)buf->device;
 }
 
+WEAK int halide_cuda_graph_begin_capture(void *user_context) {
+    debug(user_context)
+        << "CUDA: halide_cuda_graph_begin_capture (user_context: " << user_context << ")\n";
+
+    Context ctx(user_context);
+    if (ctx.error != CUDA_SUCCESS) {
+        return ctx.error;
+    }
+
+    if (cuStreamCreate == NULL || cuStreamBeginCapture_v2 == NULL ||
+        cuGraphInstantiate == NULL) {
+        error(user_context) << "CUDA: Capturing graphs requires CUDA 10.1 or later\n";
+        return -1;
+    }
+    if (capture_graph) {
+        error(user_context) << "CUDA: halide_cuda_graph_begin_capture called while already capturing a graph\n";
+        return -1;
+    }
+
+    halide_cuda_graph *g = (halide_cuda_graph *)malloc(sizeof(halide_cuda_graph));
+    if (!g) {
+        return CUDA_ERROR_OUT_OF_MEMORY;
+    }
+    g->context = ctx.context;
+    g->graph = NULL;
+    g->exec = NULL;
+    g->retained = NULL;
+
+    // Capture from a stream of our own, as the default stream can't
+    // be captured. Relaxed mode allows allocating memory as we go.
+    CUresult err = cuStreamCreate(&capture_stream, CU_STREAM_NON_BLOCKING);
+    if (err == CUDA_SUCCESS) {
+        err = cuStreamBeginCapture_v2(capture_stream, CU_STREAM_CAPTURE_MODE_RELAXED);
+        if (err != CUDA_SUCCESS) {
+            cuStreamDestroy_v2(capture_stream);
+        }
+    }
+    if (err != CUDA_SUCCESS) {
+        error(user_context) << "CUDA: Starting graph capture failed: "
+                            << get_error_name(err);
+        capture_stream = NULL;
+        free(g);
+        return err;
+    }
+
+    capture_graph = g;
+    return 0;
+}
+
+WEAK int halide_cuda_graph_end_capture(void *user_context, struct halide_cuda_graph **graph) {
+    debug(user_context)
+        << "CUDA: halide_cuda_graph_end_capture (user_context: " << user_context << ")\n";
+
+    Context ctx(user_context);
+    if (ctx.error != CUDA_SUCCESS) {
+        return ctx.error;
+    }
+
+    *graph = NULL;
+    if (!capture_graph) {
+        error(user_context) << "CUDA: halide_cuda_graph_end_capture called without a capture in progress\n";
+        return -1;
+    }
+
+    halide_cuda_graph *g = capture_graph;
+    capture_graph = NULL;
+    CUresult err = cuStreamEndCapture(capture_stream, &g->graph);
+    cuStreamDestroy_v2(capture_stream);
+    capture_stream = NULL;
+    if (err == CUDA_SUCCESS) {
+        err = cuGraphInstantiate(&g->exec, g->graph, NULL, NULL, 0);
+    }
+    if (err != CUDA_SUCCESS) {
+        error(user_context) << "CUDA: Capturing graph failed: "
+                            << get_error_name(err);
+        release_graph(user_context, g);
+        return err;
+    }
+
+    // Nothing has actually run yet.
+    err = launch_graph(user_context, ctx.context, g);
+    if (err != CUDA_SUCCESS) {
+        release_graph(user_context, g);
+        return err;
+    }
+
+    *graph = g;
+    return 0;
+}
+
+WEAK int halide_cuda_graph_launch(void *user_context, struct halide_cuda_graph *graph) {
+    debug(user_context)
+        << "CUDA: halide_cuda_graph_launch (user_context: " << user_context
+        << ", graph: " << graph << ")\n";
+
+    Context ctx(user_context);
+    if (ctx.error != CUDA_SUCCESS) {
+        return ctx.error;
+    }
+    halide_assert(user_context, graph && graph->context == ctx.context);
+
+    return launch_graph(user_context, ctx.context, graph);
+}
+
+WEAK int halide_cuda_graph_release(void *user_context, struct halide_cuda_graph *graph) {
+    debug(user_context)
+        << "CUDA: halide_cuda_graph_release (user_context: " << user_context
+        << ", graph: " << graph << ")\n";
+
+    if (!graph) {
+        return 0;
+    }
+
+    Context ctx(user_context);
+    if (ctx.error != CUDA_SUCCESS) {
+        return ctx.error;
+    }
+    halide_assert(user_context, graph->context == ctx.context);
+
+    release_graph(user_context, graph);
+    return 0;
+}
+
 WEAK const halide_device_interface_t *halide_cuda_device_interface() {
     return &cuda_device_interface;
 }
@@ -32,10 +32,17 @@ CUDA_FN(CUresult, cuModuleUnload, (CUmodule module));
 CUDA_FN(CUresult, cuModuleGetFunction, (CUfunction *hfunc, CUmodule hmod, const char *name));
 CUDA_FN_3020(CUresult, cuMemAlloc, cuMemAlloc_v2, (CUdeviceptr *dptr, size_t bytesize));
 CUDA_FN_3020(CUresult, cuMemFree, cuMemFree_v2, (CUdeviceptr dptr));
+CUDA_FN(CUresult, cuMemHostAlloc, (void **pp, size_t bytesize, unsigned int Flags));
+CUDA_FN(CUresult, cuMemFreeHost, (void *p));
+CUDA_FN(CUresult, cuMemHostGetFlags, (unsigned int *pFlags, void *p));
+CUDA_FN_3020(CUresult, cuMemGetAddressRange, cuMemGetAddressRange_v2, (CUdeviceptr *pbase, size_t *psize, CUdeviceptr dptr));
 CUDA_FN_3020(CUresult, cuMemcpyHtoD, cuMemcpyHtoD_v2, (CUdeviceptr dstDevice, const void *srcHost, size_t ByteCount));
 CUDA_FN_3020(CUresult, cuMemcpyDtoH, cuMemcpyDtoH_v2, (void *dstHost, CUdeviceptr srcDevice, size_t ByteCount));
 CUDA_FN_3020(CUresult, cuMemcpyDtoD, cuMemcpyDtoD_v2, (CUdeviceptr dstHost, CUdeviceptr srcDevice, size_t ByteCount));
 CUDA_FN_3020(CUresult, cuMemcpy3D, cuMemcpy3D_v2, (const CUDA_MEMCPY3D *pCopy));
+CUDA_FN_3020(CUresult, cuMemcpyHtoDAsync, cuMemcpyHtoDAsync_v2, (CUdeviceptr dstDevice, const void *srcHost, size_t ByteCount, CUstream hStream));
+CUDA_FN_3020(CUresult, cuMemcpyDtoHAsync, cuMemcpyDtoHAsync_v2, (void *dstHost, CUdeviceptr srcDevice, size_t ByteCount, CUstream hStream));
+CUDA_FN_3020(CUresult, cuMemcpyDtoDAsync, cuMemcpyDtoDAsync_v2, (CUdeviceptr dstDevice, CUdeviceptr srcDevice, size_t ByteCount, CUstream hStream));
 CUDA_FN(CUresult, cuLaunchKernel, (CUfunction f,
                                    unsigned int gridDimX,
                                    unsigned int gridDimY,
@@ -56,6 +63,21 @@ CUDA_FN(CUresult, cuPointerGetAttribute, (void *result, int query, CUdeviceptr p
 
 CUDA_FN_OPTIONAL(CUresult, cuStreamSynchronize, (CUstream hStream));
 
+// Copies between the memory of different contexts, which need CUDA 4.0
+// or later.
+CUDA_FN_OPTIONAL(CUresult, cuMemcpyPeerAsync, (CUdeviceptr dstDevice, CUcontext dstContext, CUdeviceptr srcDevice, CUcontext srcContext, size_t ByteCount, CUstream hStream));
+CUDA_FN_OPTIONAL(CUresult, cuCtxEnablePeerAccess, (CUcontext peerContext, unsigned int Flags));
+
+// Graph capture, which needs CUDA 10.1 or later.
+CUDA_FN_OPTIONAL(CUresult, cuStreamCreate, (CUstream *phStream, unsigned int Flags));
+CUDA_FN_OPTIONAL(CUresult, cuStreamDestroy_v2, (CUstream hStream));
+CUDA_FN_OPTIONAL(CUresult, cuStreamBeginCapture_v2, (CUstream hStream, CUstreamCaptureMode mode));
+CUDA_FN_OPTIONAL(CUresult, cuStreamEndCapture, (CUstream hStream, CUgraph *phGraph));
+CUDA_FN_OPTIONAL(CUresult, cuGraphInstantiate, (CUgraphExec *phGraphExec, CUgraph hGraph, CUgraphNode *phErrorNode, char *logBuffer, size_t bufferSize));
+CUDA_FN_OPTIONAL(CUresult, cuGraphLaunch, (CUgraphExec hGraphExec, CUstream hStream));
+CUDA_FN_OPTIONAL(CUresult, cuGraphExecDestroy, (CUgraphExec hGraphExec));
+CUDA_FN_OPTIONAL(CUresult, cuGraphDestroy, (CUgraph hGraph));
+
 #undef CUDA_FN
 #undef CUDA_FN_OPTIONAL
 #undef CUDA_FN_3020
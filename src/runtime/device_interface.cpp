@@ -26,6 +26,155 @@ struct device_handle_wrapper {
 // a copy internaly as well.
 WEAK halide_mutex device_copy_mutex;
 
+// Sub-regions of a buffer that are known to be the only parts of it
+// that are dirty, as recorded by halide_buffer_add_host_dirty_region
+// or halide_buffer_add_device_dirty_region. When a buffer has an entry
+// here, copies between host and device only transfer these
+// regions. Buffers without an entry are copied in full. The table is
+// protected by device_copy_mutex.
+#define MAX_DIRTY_BUFFERS 16
+#define MAX_DIRTY_REGIONS 4
+
+struct dirty_region {
+    int min[MAX_COPY_DIMS];
+    int extent[MAX_COPY_DIMS];
+};
+
+struct dirty_region_set {
+    const halide_buffer_t *buf;
+    // Whether the regions are dirty on the device (as opposed to the
+    // host).
+    bool on_device;
+    int count;
+    dirty_region regions[MAX_DIRTY_REGIONS];
+};
+
+WEAK dirty_region_set dirty_region_sets[MAX_DIRTY_BUFFERS];
+
+WEAK dirty_region_set *find_dirty_regions_already_locked(const halide_buffer_t *buf) {
+    for (int i = 0; i < MAX_DIRTY_BUFFERS; i++) {
+        if (dirty_region_sets[i].buf == buf) {
+            return &dirty_region_sets[i];
+        }
+    }
+    return NULL;
+}
+
+WEAK void forget_dirty_regions_already_locked(const halide_buffer_t *buf) {
+    dirty_region_set *set = find_dirty_regions_already_locked(buf);
+    if (set) {
+        set->buf = NULL;
+        set->count = 0;
+    }
+}
+
+WEAK int64_t dirty_region_volume(const dirty_region &r, int dimensions) {
+    int64_t volume = 1;
+    for (int i = 0; i < dimensions; i++) {
+        volume *= r.extent[i];
+    }
+    return volume;
+}
+
+// Grow a to also cover b.
+WEAK void merge_dirty_regions(dirty_region &a, const dirty_region &b, int dimensions) {
+    for (int i = 0; i < dimensions; i++) {
+        int min = a.min[i] < b.min[i] ? a.min[i] : b.min[i];
+        int a_end = a.min[i] + a.extent[i];
+        int b_end = b.min[i] + b.extent[i];
+        int end = a_end > b_end ? a_end : b_end;
+        a.min[i] = min;
+        a.extent[i] = end - min;
+    }
+}
+
+WEAK void insert_dirty_region(dirty_region_set *set, const dirty_region &r, int dimensions) {
+    // Already covered?
+    for (int i = 0; i < set->count; i++) {
+        bool contained = true;
+        for (int j = 0; j < dimensions; j++) {
+            contained = contained &&
+                r.min[j] >= set->regions[i].min[j] &&
+                r.min[j] + r.extent[j] <= set->regions[i].min[j] + set->regions[i].extent[j];
+        }
+        if (contained) {
+            return;
+        }
+    }
+
+    if (set->count < MAX_DIRTY_REGIONS) {
+        set->regions[set->count++] = r;
+        return;
+    }
+
+    // Out of space. Merge the region into whichever existing one
+    // grows the least, which may cause some clean data to be copied.
+    int best = 0;
+    int64_t best_growth = 0;
+    for (int i = 0; i < set->count; i++) {
+        dirty_region merged = set->regions[i];
+        merge_dirty_regions(merged, r, dimensions);
+        int64_t growth = (dirty_region_volume(merged, dimensions) -
+                          dirty_region_volume(set->regions[i], dimensions));
+        if (i == 0 || growth < best_growth) {
+            best = i;
+            best_growth = growth;
+        }
+    }
+    merge_dirty_regions(set->regions[best], r, dimensions);
+}
+
+// Copy just the dirty regions recorded for a buffer, using device
+// crops of it. Returns halide_error_code_device_crop_unsupported if
+// the device interface can't crop the buffer, in which case the
+// caller should copy the whole thing instead.
+WEAK int copy_dirty_regions_already_locked(void *user_context, struct halide_buffer_t *buf,
+                                           const halide_device_interface_t *interface,
+                                           const dirty_region_set *set, bool to_device) {
+    if (interface->impl->device_crop == halide_default_device_crop) {
+        return halide_error_code_device_crop_unsupported;
+    }
+
+    halide_dimension_t dims[MAX_COPY_DIMS];
+    for (int i = 0; i < set->count; i++) {
+        const dirty_region &r = set->regions[i];
+        halide_buffer_t crop = *buf;
+        crop.dim = dims;
+        crop.device = 0;
+        crop.device_interface = NULL;
+        crop.flags = 0;
+        int64_t offset = 0;
+        for (int j = 0; j < buf->dimensions; j++) {
+            dims[j] = buf->dim[j];
+            dims[j].min = r.min[j];
+            dims[j].extent = r.extent[j];
+            offset += (int64_t)(r.min[j] - buf->dim[j].min) * buf->dim[j].stride;
+        }
+        if (crop.host) {
+            crop.host += offset * buf->type.bytes();
+        }
+
+        debug(user_context) << "copy_dirty_regions_already_locked " << buf
+                            << " copying region " << crop << "\n";
+
+        int result = interface->impl->device_crop(user_context, buf, &crop);
+        if (result != 0) {
+            return halide_error_code_device_crop_unsupported;
+        }
+        if (to_device) {
+            result = interface->impl->copy_to_device(user_context, &crop);
+        } else {
+            result = interface->impl->copy_to_host(user_context, &crop);
+        }
+        interface->impl->device_release_crop(user_context, &crop);
+        if (result != 0) {
+            return to_device ? halide_error_code_copy_to_device_failed :
+                halide_error_code_copy_to_host_failed;
+        }
+    }
+    return 0;
+}
+
 WEAK int copy_to_host_already_locked(void *user_context, struct halide_buffer_t *buf) {
     if (!buf->device_dirty()) {
         return 0;  // my, that was easy
@@ -41,11 +190,19 @@ WEAK int copy_to_host_already_locked(void *user_context, struct halide_buffer_t
         debug(user_context) << "copy_to_host_already_locked " << buf << " interface is NULL\n";
         return halide_error_code_no_device_interface;
     }
-    int result = interface->impl->copy_to_host(user_context, buf);
+    int result = halide_error_code_device_crop_unsupported;
+    dirty_region_set *regions = find_dirty_regions_already_locked(buf);
+    if (regions && regions->on_device) {
+        result = copy_dirty_regions_already_locked(user_context, buf, interface, regions, false);
+    }
+    if (result == halide_error_code_device_crop_unsupported) {
+        result = interface->impl->copy_to_host(user_context, buf);
+    }
     if (result != 0) {
         debug(user_context) << "copy_to_host_already_locked " << buf << " device copy_to_host returned an error\n";
         return halide_error_code_copy_to_host_failed;
     }
+    forget_dirty_regions_already_locked(buf);
     buf->set_device_dirty(false);
     halide_msan_annotate_buffer_is_initialized(user_context, buf);
 
@@ -144,7 +301,10 @@ WEAK int copy_to_device_already_locked(void *user_context,
         return halide_error_code_incompatible_device_interface;
     }
 
-    if (buf->device == 0) {
+    // A fresh device allocation needs all of the host data, not just
+    // the dirty regions.
+    bool fresh = (buf->device == 0);
+    if (fresh) {
         result = halide_device_malloc(user_context, buf, device_interface);
         if (result != 0) {
             debug(user_context) << "halide_copy_to_device " << buf
@@ -159,8 +319,16 @@ WEAK int copy_to_device_already_locked(void *user_context,
             debug(user_context) << "halide_copy_to_device " << buf << " dev_dirty is true error\n";
             return halide_error_code_copy_to_device_failed;
         } else {
-            result = device_interface->impl->copy_to_device(user_context, buf);
+            result = halide_error_code_device_crop_unsupported;
+            dirty_region_set *regions = find_dirty_regions_already_locked(buf);
+            if (regions && !regions->on_device && !fresh) {
+                result = copy_dirty_regions_already_locked(user_context, buf, device_interface, regions, true);
+            }
+            if (result == halide_error_code_device_crop_unsupported) {
+                result = device_interface->impl->copy_to_device(user_context, buf);
+            }
             if (result == 0) {
+                forget_dirty_regions_already_locked(buf);
                 buf->set_host_dirty(false);
             } else {
                 debug(user_context) << "halide_copy_to_device "
@@ -237,6 +405,11 @@ WEAK int halide_device_free(void *user_context, struct halide_buffer_t *buf) {
         return result;
     }
 
+    {
+        ScopedMutexLock lock(&device_copy_mutex);
+        forget_dirty_regions_already_locked(buf);
+    }
+
     const halide_device_interface_t *device_interface = buf->device_interface;
     if (device_interface != NULL) {
         // Ensure interface is not freed prematurely.
@@ -545,6 +718,7 @@ WEAK int halide_buffer_copy(void *user_context, struct halide_buffer_t *src,
     }
 
     if (dst != src) {
+        forget_dirty_regions_already_locked(dst);
         if (dst_device_interface) {
             dst->set_device_dirty(true);
         } else {
@@ -621,3 +795,89 @@ WEAK int halide_device_release_crop(void *user_context,
 }
 
 } // extern "C" linkage
+
+namespace {
+
+int add_dirty_region(void *user_context, struct halide_buffer_t *buf,
+                     const int *min, const int *extent, bool on_device,
+                     const char *routine) {
+    int result = debug_log_and_validate_buf(user_context, buf, routine);
+    if (result != 0) {
+        return result;
+    }
+
+    ScopedMutexLock lock(&device_copy_mutex);
+
+    bool this_dirty = on_device ? buf->device_dirty() : buf->host_dirty();
+    bool other_dirty = on_device ? buf->host_dirty() : buf->device_dirty();
+    if (other_dirty) {
+        return halide_error_host_and_device_dirty(user_context);
+    }
+
+    // Clamp the region to the buffer.
+    dirty_region r;
+    for (int i = 0; i < buf->dimensions && i < MAX_COPY_DIMS; i++) {
+        int buf_min = buf->dim[i].min;
+        int buf_end = buf_min + buf->dim[i].extent;
+        int r_min = min[i] > buf_min ? min[i] : buf_min;
+        int r_end = min[i] + extent[i] < buf_end ? min[i] + extent[i] : buf_end;
+        if (r_end <= r_min) {
+            // Nothing to mark.
+            return 0;
+        }
+        r.min[i] = r_min;
+        r.extent[i] = r_end - r_min;
+    }
+
+    dirty_region_set *set = find_dirty_regions_already_locked(buf);
+    if (set && set->on_device != on_device) {
+        // Left over from before the last copy in the other direction.
+        forget_dirty_regions_already_locked(buf);
+        set = NULL;
+    }
+
+    if (this_dirty && !set) {
+        // The whole buffer is already dirty.
+        return 0;
+    }
+
+    if (!set && buf->dimensions <= MAX_COPY_DIMS) {
+        set = find_dirty_regions_already_locked(NULL);
+        if (set) {
+            set->buf = buf;
+            set->on_device = on_device;
+            set->count = 0;
+        }
+    }
+
+    // If there was no room to track the region, the whole buffer is
+    // marked dirty instead.
+    if (set) {
+        insert_dirty_region(set, r, buf->dimensions);
+    }
+
+    if (on_device) {
+        buf->set_device_dirty(true);
+    } else {
+        buf->set_host_dirty(true);
+    }
+    return 0;
+}
+
+}
+
+extern "C" {
+
+WEAK int halide_buffer_add_host_dirty_region(void *user_context, struct halide_buffer_t *buf,
+                                             const int *min, const int *extent) {
+    return add_dirty_region(user_context, buf, min, extent, false,
+                            "halide_buffer_add_host_dirty_region");
+}
+
+WEAK int halide_buffer_add_device_dirty_region(void *user_context, struct halide_buffer_t *buf,
+                                               const int *min, const int *extent) {
+    return add_dirty_region(user_context, buf, min, extent, true,
+                            "halide_buffer_add_device_dirty_region");
+}
+
+} // extern "C" linkage
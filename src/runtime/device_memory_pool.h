@@ -0,0 +1,157 @@
+#ifndef HALIDE_RUNTIME_DEVICE_MEMORY_POOL_H
+#define HALIDE_RUNTIME_DEVICE_MEMORY_POOL_H
+
+#include "HalideRuntime.h"
+#include "runtime_internal.h"
+#include "scoped_spin_lock.h"
+
+namespace Halide { namespace Runtime { namespace Internal {
+
+// Allocating and freeing device memory is slow, and often
+// synchronizes with the device, so GPU runtimes keep freed
+// allocations in a pool and hand them out again to later requests of
+// a similar size. Allocations are rounded up to one of four size
+// classes per power of two, so at most 25% is wasted by rounding
+// up. Each pooled block remembers the context it belongs to, so that
+// only that context reuses it, and so that the blocks can be released
+// along with the context in the runtime's device_release.
+#define DEVICE_POOL_MIN_SIZE ((size_t)4096)
+#define DEVICE_POOL_NUM_CLASSES 256
+
+struct device_pool_block {
+    void *context;
+    uint64_t handle;
+    size_t size;
+    device_pool_block *next;
+};
+
+struct device_pool {
+    volatile int lock;
+    device_pool_block *free_lists[DEVICE_POOL_NUM_CLASSES];
+    size_t cached_bytes;
+    // Freed blocks are released instead of kept once the pool holds
+    // this many bytes. Set from HL_DEVICE_POOL_LIMIT (in megabytes)
+    // on first use; -1 means not yet read.
+    int64_t limit;
+};
+
+// Round a size up to its size class. Returns 0 if the size is too
+// large to pool.
+WEAK size_t device_pool_class(size_t x, int *idx) {
+    if (x <= DEVICE_POOL_MIN_SIZE) {
+        *idx = 0;
+        return DEVICE_POOL_MIN_SIZE;
+    }
+    // 2^b < x <= 2^(b+1)
+    int b = 63 - __builtin_clzll((uint64_t)(x - 1));
+    size_t step = (size_t)1 << (b - 2);
+    size_t rounded = (x + step - 1) & ~(step - 1);
+    *idx = 1 + (b - 12) * 4 + (int)(rounded >> (b - 2)) - 5;
+    if (*idx >= DEVICE_POOL_NUM_CLASSES) {
+        return 0;
+    }
+    return rounded;
+}
+
+WEAK int64_t device_pool_limit(device_pool *pool) {
+    if (pool->limit < 0) {
+        const char *limit = getenv("HL_DEVICE_POOL_LIMIT");
+        pool->limit = (limit ? (int64_t)atoi(limit) : 256) << 20;
+    }
+    return pool->limit;
+}
+
+// The size to actually allocate for a request of x bytes.
+WEAK size_t device_pool_allocation_size(device_pool *pool, size_t x) {
+    int idx;
+    size_t rounded = device_pool_class(x, &idx);
+    ScopedSpinLock lock(&pool->lock);
+    if (rounded == 0 || device_pool_limit(pool) == 0) {
+        return x;
+    }
+    return rounded;
+}
+
+// Take a free block of the size class for x bytes that belongs to the
+// given context. Returns 0 if there isn't one.
+WEAK uint64_t device_pool_take(device_pool *pool, void *context, size_t x) {
+    int idx;
+    if (device_pool_class(x, &idx) == 0) {
+        return 0;
+    }
+    device_pool_block *block = NULL;
+    {
+        ScopedSpinLock lock(&pool->lock);
+        device_pool_block **prev = &pool->free_lists[idx];
+        while (*prev && (*prev)->context != context) {
+            prev = &(*prev)->next;
+        }
+        block = *prev;
+        if (block) {
+            *prev = block->next;
+            pool->cached_bytes -= block->size;
+        }
+    }
+    if (!block) {
+        return 0;
+    }
+    uint64_t handle = block->handle;
+    free(block);
+    return handle;
+}
+
+// Offer a block of size bytes to the pool. Returns false if the
+// caller should release it instead, because its size isn't exactly a
+// size class (e.g. because it was allocated by someone else), or
+// because the pool is full.
+WEAK bool device_pool_give(device_pool *pool, void *context, uint64_t handle, size_t size) {
+    int idx;
+    if (device_pool_class(size, &idx) != size) {
+        return false;
+    }
+    device_pool_block *block = (device_pool_block *)malloc(sizeof(device_pool_block));
+    if (!block) {
+        return false;
+    }
+    block->context = context;
+    block->handle = handle;
+    block->size = size;
+    {
+        ScopedSpinLock lock(&pool->lock);
+        if (pool->cached_bytes + size <= (size_t)device_pool_limit(pool)) {
+            block->next = pool->free_lists[idx];
+            pool->free_lists[idx] = block;
+            pool->cached_bytes += size;
+            return true;
+        }
+    }
+    free(block);
+    return false;
+}
+
+// Remove all the free blocks belonging to the given context from the
+// pool, and return them as a list. The caller must release each
+// handle and then free the list nodes.
+WEAK device_pool_block *device_pool_detach(device_pool *pool, void *context) {
+    device_pool_block *result = NULL;
+    ScopedSpinLock lock(&pool->lock);
+    for (int i = 0; i < DEVICE_POOL_NUM_CLASSES; i++) {
+        device_pool_block **prev = &pool->free_lists[i];
+        while (*prev) {
+            device_pool_block *block = *prev;
+            if (block->context == context) {
+                *prev = block->next;
+                pool->cached_bytes -= block->size;
+                block->next = result;
+                result = block;
+            } else {
+                prev = &block->next;
+            }
+        }
+    }
+    return result;
+}
+
+}}} // namespace Halide::Runtime::Internal
+
+#endif
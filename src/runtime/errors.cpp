@@ -277,4 +277,12 @@ WEAK int halide_error_buffer_is_null(void *user_context, const char *routine) {
     return halide_error_code_buffer_is_null;
 }
 
+WEAK int halide_error_bad_alias(void *user_context, const char *output_name, const char *input_name) {
+    error(user_context) << "Output buffer " << output_name
+                        << " has the same host pointer as input buffer " << input_name
+                        << ", but a different min or stride. To compute " << output_name
+                        << " in place, pass the same buffer for both.\n";
+    return halide_error_code_bad_alias;
+}
+
 }  // extern "C"
@@ -0,0 +1,16 @@
+#include "HalideRuntime.h"
+
+// For platforms where the profiler can't read hardware performance
+// counters.
+
+extern "C" {
+
+WEAK int halide_profiler_current_thread_id() {
+    return 0;
+}
+
+WEAK int halide_profiler_read_thread_counters(int thread_id, uint64_t *values) {
+    return 0;
+}
+
+}
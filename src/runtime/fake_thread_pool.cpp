@@ -25,6 +25,10 @@ namespace Halide { namespace Runtime { namespace Internal {
 WEAK halide_do_task_t custom_do_task = halide_default_do_task;
 WEAK halide_do_par_for_t custom_do_par_for = halide_default_do_par_for;
 
+WEAK int thread_pool_num_threads() {
+    return 1;
+}
+
 }}} // namespace Halide::Runtime::Internal
 
 extern "C" {
@@ -47,6 +51,33 @@ WEAK void halide_mutex_unlock(halide_mutex *mutex) {
 WEAK void halide_shutdown_thread_pool() {
 }
 
+WEAK int halide_do_fork(void *user_context, halide_task_t f,
+                        int min, int size, uint8_t *closure) {
+    // The tasks of a fork may block on each other, so they can't be
+    // run one after the other.
+    halide_error(user_context, "halide_do_fork not implemented on this platform. "
+                 "Func::async requires a threaded runtime.");
+    return halide_error_code_generic_error;
+}
+
+WEAK int halide_semaphore_release(halide_semaphore_t *s, int n) {
+    *(int *)s += n;
+    return 0;
+}
+
+WEAK int halide_semaphore_acquire(halide_semaphore_t *s, int n) {
+    int *count = (int *)s;
+    if (*count < n) {
+        // With only one thread, no one could ever release it.
+        return halide_error_code_generic_error;
+    }
+    *count -= n;
+    return 0;
+}
+
+WEAK void halide_semaphore_abort_as_destructor(void *user_context, void *s) {
+}
+
 WEAK int halide_set_num_threads(int n) {
     if (n < 0) {
         halide_error(NULL, "halide_set_num_threads: must be >= 0.");
@@ -54,6 +85,27 @@ WEAK int halide_set_num_threads(int n) {
     return 1;
 }
 
+WEAK int halide_set_num_reserved_threads(int n) {
+    if (n < 0) {
+        halide_error(NULL, "halide_set_num_reserved_threads: must be >= 0.");
+    }
+    return 0;
+}
+
+WEAK void halide_get_thread_budget(void *user_context, int *max_threads,
+                                   halide_thread_priority_t *priority) {
+    *max_threads = 0;
+    *priority = halide_thread_priority_normal;
+}
+
+WEAK int halide_set_thread_pool_spin_count(int n) {
+    if (n < 0) {
+        halide_error(NULL, "halide_set_thread_pool_spin_count: must be >= 0.");
+    }
+    // There are no worker threads to spin.
+    return 0;
+}
+
 WEAK halide_do_task_t halide_set_custom_do_task(halide_do_task_t f) {
     halide_do_task_t result = custom_do_task;
     custom_do_task = f;
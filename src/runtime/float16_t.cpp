@@ -72,4 +72,66 @@ WEAK double halide_float16_bits_to_double(uint16_t bits) {
     return (double) valueAsFloat;
 }
 
+WEAK uint16_t halide_float_to_float16_bits(float value) {
+    union {
+        float asFloat;
+        uint32_t asUInt;
+    } in;
+    in.asFloat = value;
+    uint16_t sign = (in.asUInt >> 16) & 0x8000;
+    uint32_t bits = in.asUInt & 0x7fffffff;
+
+    if (bits >= 0x7f800000) {
+        // Infinity, or NaN, which stays a quiet NaN.
+        return sign | 0x7c00 | (bits > 0x7f800000 ? 0x200 : 0);
+    } else if (bits >= 0x477ff000) {
+        // Rounds to a magnitude of at least 65520, which overflows
+        // to infinity.
+        return sign | 0x7c00;
+    } else if (bits < 0x33000000) {
+        // Smaller than half the smallest subnormal, which rounds to
+        // zero.
+        return sign;
+    }
+
+    uint32_t significand, shift;
+    if (bits < 0x38800000) {
+        // A subnormal in half precision. Count it in units of the
+        // smallest subnormal, 2^-24.
+        significand = (bits & 0x7fffff) | 0x800000;
+        shift = 126 - (bits >> 23);
+    } else {
+        // A normal number. Rebias the exponent and drop 13 bits of
+        // significand. Rounding up may carry into the exponent,
+        // which is what we want.
+        significand = bits - ((127 - 15) << 23);
+        shift = 13;
+    }
+    uint32_t result = significand >> shift;
+    uint32_t remainder = significand & ((1 << shift) - 1);
+    uint32_t halfway = 1 << (shift - 1);
+    if (remainder > halfway || (remainder == halfway && (result & 1))) {
+        result++;
+    }
+    return sign | result;
+}
+
+// The helpers LLVM calls to convert to and from half precision when
+// the target has no instructions for it (e.g. x86 without f16c).
+WEAK float __gnu_h2f_ieee(uint16_t bits) {
+    return halide_float16_bits_to_float(bits);
+}
+
+WEAK uint16_t __gnu_f2h_ieee(float value) {
+    return halide_float_to_float16_bits(value);
+}
+
+WEAK float __extendhfsf2(uint16_t bits) {
+    return halide_float16_bits_to_float(bits);
+}
+
+WEAK uint16_t __truncsfhf2(float value) {
+    return halide_float_to_float16_bits(value);
+}
+
 }
@@ -24,6 +24,8 @@ extern long dispatch_semaphore_wait(dispatch_semaphore_t dsema, dispatch_time_t
 extern long dispatch_semaphore_signal(dispatch_semaphore_t dsema);
 extern void dispatch_release(void *object);
 
+extern int halide_host_cpu_count();
+
 }
 
 namespace Halide { namespace Runtime { namespace Internal {
@@ -63,6 +65,10 @@ namespace Halide { namespace Runtime { namespace Internal {
 
 WEAK int custom_num_threads = 0;
 
+WEAK int thread_pool_num_threads() {
+    return custom_num_threads ? custom_num_threads : halide_host_cpu_count();
+}
+
 struct gcd_mutex {
     dispatch_once_t once;
     dispatch_semaphore_t semaphore;
@@ -130,6 +136,45 @@ namespace Halide { namespace Runtime { namespace Internal {
 WEAK halide_do_task_t custom_do_task = halide_default_do_task;
 WEAK halide_do_par_for_t custom_do_par_for = halide_default_do_par_for;
 
+// The state behind a halide_semaphore_t. Generated code initializes
+// the count directly, so it must come first.
+struct semaphore_impl {
+    int count;
+    int aborted;
+};
+
+// There are no condition variables here, so threads waiting on any
+// semaphore sleep on one dispatch semaphore, which is signaled once
+// per waiter whenever any semaphore changes. Waiters then recheck
+// their own semaphore.
+WEAK halide_mutex semaphore_mutex = { { 0 } };
+WEAK dispatch_semaphore_t semaphore_wakeup = NULL;
+WEAK int semaphore_waiters = 0;
+
+// Called with the semaphore lock held. Releases it.
+WEAK void wake_semaphore_waiters() {
+    int waiters = semaphore_waiters;
+    semaphore_waiters = 0;
+    halide_mutex_unlock(&semaphore_mutex);
+    for (int i = 0; i < waiters; i++) {
+        dispatch_semaphore_signal(semaphore_wakeup);
+    }
+}
+
+struct fork_task {
+    void *user_context;
+    halide_task_t f;
+    int idx;
+    uint8_t *closure;
+    int result;
+    halide_thread *thread;
+};
+
+WEAK void fork_task_thread(void *arg) {
+    fork_task *task = (fork_task *)arg;
+    task->result = halide_do_task(task->user_context, task->f, task->idx, task->closure);
+}
+
 }}}  // namespace Halide::Runtime::Internal
 
 extern "C" {
@@ -156,6 +201,80 @@ WEAK void halide_mutex_unlock(halide_mutex *mutex_arg) {
 WEAK void halide_shutdown_thread_pool() {
 }
 
+WEAK int halide_do_fork(void *user_context, halide_task_t f,
+                        int min, int size, uint8_t *closure) {
+    if (size <= 0) {
+        return 0;
+    }
+    fork_task *tasks = (fork_task *)malloc(size * sizeof(fork_task));
+    if (!tasks) {
+        return halide_error_code_out_of_memory;
+    }
+
+    // The tasks may block on each other, so they can't be run with
+    // dispatch_apply_f. Run the first one on this thread, and give
+    // each of the others a thread of its own.
+    for (int i = 0; i < size; i++) {
+        tasks[i].user_context = user_context;
+        tasks[i].f = f;
+        tasks[i].idx = min + i;
+        tasks[i].closure = closure;
+        tasks[i].result = 0;
+        tasks[i].thread = NULL;
+    }
+    for (int i = 1; i < size; i++) {
+        tasks[i].thread = halide_spawn_thread(fork_task_thread, &tasks[i]);
+    }
+    fork_task_thread(&tasks[0]);
+
+    int result = tasks[0].result;
+    for (int i = 1; i < size; i++) {
+        halide_join_thread(tasks[i].thread);
+        if (result == 0) {
+            result = tasks[i].result;
+        }
+    }
+    free(tasks);
+    return result;
+}
+
+WEAK int halide_semaphore_release(halide_semaphore_t *s, int n) {
+    semaphore_impl *sem = (semaphore_impl *)s;
+    halide_mutex_lock(&semaphore_mutex);
+    sem->count += n;
+    wake_semaphore_waiters();
+    return 0;
+}
+
+WEAK int halide_semaphore_acquire(halide_semaphore_t *s, int n) {
+    semaphore_impl *sem = (semaphore_impl *)s;
+    halide_mutex_lock(&semaphore_mutex);
+    if (!semaphore_wakeup) {
+        semaphore_wakeup = dispatch_semaphore_create(0);
+    }
+    while (sem->count < n && !sem->aborted) {
+        semaphore_waiters++;
+        halide_mutex_unlock(&semaphore_mutex);
+        dispatch_semaphore_wait(semaphore_wakeup, DISPATCH_TIME_FOREVER);
+        halide_mutex_lock(&semaphore_mutex);
+    }
+    int result = 0;
+    if (sem->count >= n) {
+        sem->count -= n;
+    } else {
+        result = halide_error_code_generic_error;
+    }
+    halide_mutex_unlock(&semaphore_mutex);
+    return result;
+}
+
+WEAK void halide_semaphore_abort_as_destructor(void *user_context, void *s) {
+    semaphore_impl *sem = (semaphore_impl *)s;
+    halide_mutex_lock(&semaphore_mutex);
+    sem->aborted = 1;
+    wake_semaphore_waiters();
+}
+
 WEAK int halide_set_num_threads(int n) {
     if (n < 0) {
         halide_error(NULL, "halide_set_num_threads: must be >= 0.");
@@ -165,6 +284,28 @@ WEAK int halide_set_num_threads(int n) {
     return old_custom_num_threads;
 }
 
+WEAK int halide_set_num_reserved_threads(int n) {
+    if (n < 0) {
+        halide_error(NULL, "halide_set_num_reserved_threads: must be >= 0.");
+    }
+    // Grand central dispatch manages its own threads.
+    return 0;
+}
+
+WEAK void halide_get_thread_budget(void *user_context, int *max_threads,
+                                   halide_thread_priority_t *priority) {
+    *max_threads = 0;
+    *priority = halide_thread_priority_normal;
+}
+
+WEAK int halide_set_thread_pool_spin_count(int n) {
+    if (n < 0) {
+        halide_error(NULL, "halide_set_thread_pool_spin_count: must be >= 0.");
+    }
+    // Grand central dispatch manages its own threads.
+    return 0;
+}
+
 WEAK halide_do_task_t halide_set_custom_do_task(halide_do_task_t f) {
     halide_do_task_t result = custom_do_task;
     custom_do_task = f;
@@ -1,6 +1,7 @@
 #include "runtime_internal.h"
 #include "device_buffer_utils.h"
 #include "device_interface.h"
+#include "device_memory_pool.h"
 #include "HalideRuntimeHexagonHost.h"
 #include "printer.h"
 #include "scoped_mutex_lock.h"
@@ -56,6 +57,26 @@ WEAK host_malloc_init_fn host_malloc_deinit = NULL;
 WEAK host_malloc_fn host_malloc = NULL;
 WEAK host_free_fn host_free = NULL;
 
+// Freed ION allocations, kept for reuse. Besides the cost of the
+// allocation itself, each new ION buffer has to be mapped into this
+// process and registered with FastRPC (see host_malloc.cpp) before
+// Hexagon can use it without a copy, so reusing buffers keeps those
+// mappings alive from one frame to the next. The pool only holds
+// buffers for the one remote session, so the context is always NULL.
+WEAK device_pool ion_pool = {0, {NULL}, 0, -1};
+
+// Return the ION buffers the pool holds to the allocator.
+WEAK void release_pooled_ion_buffers(void *user_context) {
+    device_pool_block *block = device_pool_detach(&ion_pool, NULL);
+    while (block) {
+        device_pool_block *next = block->next;
+        debug(user_context) << "    host_free ion=" << (void *)block->handle << " (pooled)\n";
+        host_free((void *)block->handle);
+        free(block);
+        block = next;
+    }
+}
+
 // This checks if there are any log messages available on the remote
 // side. It should be called after every remote call.
 WEAK void poll_log(void *user_context) {
@@ -80,6 +101,100 @@ WEAK void poll_log(void *user_context) {
     }
 }
 
+// When asynchronous runs are enabled, halide_hexagon_run makes the
+// remote call on a thread of its own, and returns without waiting for
+// it. At most one run is in flight at a time. Anything that needs the
+// results, or might free memory the DSP is using, waits for it first.
+struct async_run {
+    halide_hexagon_handle_t module;
+    halide_hexagon_handle_t function;
+    remote_buffer *input_buffers;
+    remote_buffer *output_buffers;
+    remote_buffer *input_scalars;
+    int input_buffer_count;
+    int output_buffer_count;
+    int input_scalar_count;
+    int result;
+};
+
+WEAK bool async_runs_enabled = false;
+WEAK halide_mutex pending_run_lock = { { 0 } };
+WEAK halide_thread *pending_run_thread = NULL;
+WEAK async_run *pending_run = NULL;
+
+WEAK void do_async_run(void *closure) {
+    async_run *run = (async_run *)closure;
+    run->result = remote_run(run->module, run->function,
+                             run->input_buffers, run->input_buffer_count,
+                             run->output_buffers, run->output_buffer_count,
+                             run->input_scalars, run->input_scalar_count);
+    poll_log(NULL);
+}
+
+// Start a remote run on another thread. The arguments are copied, as
+// they usually live on the caller's stack.
+WEAK int start_async_run(void *user_context,
+                         halide_hexagon_handle_t module, halide_hexagon_handle_t function,
+                         const remote_buffer *args, int input_buffer_count,
+                         int output_buffer_count, int input_scalar_count) {
+    int arg_count = input_buffer_count + output_buffer_count + input_scalar_count;
+    const remote_buffer *scalars = args + input_buffer_count + output_buffer_count;
+    size_t scalar_bytes = 0;
+    for (int i = 0; i < input_scalar_count; i++) {
+        scalar_bytes += scalars[i].dataLen;
+    }
+
+    size_t size = sizeof(async_run) + arg_count * sizeof(remote_buffer) + scalar_bytes;
+    async_run *run = (async_run *)malloc(size);
+    if (!run) {
+        error(user_context) << "Hexagon: out of memory starting asynchronous run\n";
+        return -1;
+    }
+    remote_buffer *run_args = (remote_buffer *)(run + 1);
+    memcpy(run_args, args, arg_count * sizeof(remote_buffer));
+    run->module = module;
+    run->function = function;
+    run->input_buffers = run_args;
+    run->output_buffers = run_args + input_buffer_count;
+    run->input_scalars = run->output_buffers + output_buffer_count;
+    run->input_buffer_count = input_buffer_count;
+    run->output_buffer_count = output_buffer_count;
+    run->input_scalar_count = input_scalar_count;
+    run->result = 0;
+
+    uint8_t *scalar_data = (uint8_t *)(run_args + arg_count);
+    for (int i = 0; i < input_scalar_count; i++) {
+        memcpy(scalar_data, scalars[i].data, scalars[i].dataLen);
+        run->input_scalars[i].data = scalar_data;
+        scalar_data += scalars[i].dataLen;
+    }
+
+    ScopedMutexLock lock(&pending_run_lock);
+    halide_assert(user_context, pending_run_thread == NULL);
+    pending_run = run;
+    pending_run_thread = halide_spawn_thread(do_async_run, run);
+    return 0;
+}
+
+// Wait for the run in flight, if there is one, and return its result.
+WEAK int wait_for_pending_run(void *user_context) {
+    ScopedMutexLock lock(&pending_run_lock);
+    if (!pending_run_thread) {
+        return 0;
+    }
+    debug(user_context) << "    waiting for halide_hexagon_remote_run -> ";
+    halide_join_thread(pending_run_thread);
+    int result = pending_run->result;
+    debug(user_context) << "        " << result << "\n";
+    free(pending_run);
+    pending_run = NULL;
+    pending_run_thread = NULL;
+    if (result != 0) {
+        error(user_context) << "Hexagon pipeline failed.\n";
+    }
+    return result;
+}
+
 WEAK void get_remote_profiler_state(int *func, int *threads) {
     if (!remote_poll_profiler_state) {
         // This should only have been called if there's a remote profiler func installed.
@@ -157,13 +272,60 @@ WEAK int init_hexagon_runtime(void *user_context) {
 // Structure to hold the state of a module attached to the context.
 // Also used as a linked-list to keep track of all the different
 // modules that are attached to a context in order to release them all
-// when then context is released.
+// when then context is released. Pipelines with identical code share
+// one remote module, so several states may have the same module.
 struct module_state {
     halide_hexagon_handle_t module;
     module_state *next;
+    // The code to load, kept so that loading can wait until the
+    // first run, and its hash for finding identical modules.
+    const uint8_t *code;
+    uint64_t code_size;
+    uint64_t code_hash;
 };
 WEAK module_state *state_list = NULL;
 WEAK halide_hexagon_handle_t shared_runtime = 0;
+WEAK bool lazy_loading_enabled = false;
+
+WEAK uint64_t hash_code(const uint8_t *code, uint64_t size) {
+    // 64 bit FNV-1a.
+    uint64_t h = 14695981039346656037ULL;
+    for (uint64_t i = 0; i < size; i++) {
+        h = (h ^ code[i]) * 1099511628211ULL;
+    }
+    return h;
+}
+
+// Load the module for a state, or share the module of another state
+// with the same code. Called with thread_lock held.
+WEAK int load_module(void *user_context, module_state *state) {
+    for (module_state *s = state_list; s; s = s->next) {
+        if (s != state && s->module &&
+            s->code_hash == state->code_hash &&
+            s->code_size == state->code_size &&
+            (s->code == state->code || memcmp(s->code, state->code, state->code_size) == 0)) {
+            debug(user_context) << "    sharing module " << s->module << " of identical state " << s << "\n";
+            state->module = s->module;
+            return 0;
+        }
+    }
+
+    static int unique_id = 0;
+    stringstream soname(user_context);
+    soname << "libhalide_kernels" << unique_id++ << ".so";
+    debug(user_context) << "    halide_remote_load_library(" << soname.str() << ") -> ";
+    halide_hexagon_handle_t module = 0;
+    int result = remote_load_library(soname.str(), soname.size() + 1, state->code, state->code_size, &module);
+    poll_log(user_context);
+    if (result == 0) {
+        debug(user_context) << "        " << module << "\n";
+        state->module = module;
+    } else {
+        debug(user_context) << "        " << result << "\n";
+        error(user_context) << "Initialization of Hexagon kernels failed\n";
+    }
+    return result;
+}
 
 }}}}  // namespace Halide::Runtime::Internal::Hexagon
 
@@ -232,25 +394,19 @@ WEAK int halide_hexagon_initialize_kernels(void *user_context, void **state_ptr,
         *state = (module_state*)malloc(sizeof(module_state));
         debug(user_context) << "        " << *state << "\n";
         (*state)->module = 0;
+        (*state)->code = code;
+        (*state)->code_size = code_size;
+        (*state)->code_hash = hash_code(code, code_size);
         (*state)->next = state_list;
         state_list = *state;
     }
 
     // Create the module itself if necessary.
     if (!(*state)->module) {
-        static int unique_id = 0;
-        stringstream soname(user_context);
-        soname << "libhalide_kernels" << unique_id++ << ".so";
-        debug(user_context) << "    halide_remote_load_library(" << soname.str() << ") -> ";
-        halide_hexagon_handle_t module = 0;
-        result = remote_load_library(soname.str(), soname.size() + 1, code, code_size, &module);
-        poll_log(user_context);
-        if (result == 0) {
-            debug(user_context) << "        " << module << "\n";
-            (*state)->module = module;
+        if (lazy_loading_enabled) {
+            debug(user_context) << "    deferring loading of module until its first run\n";
         } else {
-            debug(user_context) << "        " << result << "\n";
-            error(user_context) << "Initialization of Hexagon kernels failed\n";
+            result = load_module(user_context, *state);
         }
     } else {
         debug(user_context) << "    re-using existing module " << (*state)->module << "\n";
@@ -308,7 +464,17 @@ WEAK int halide_hexagon_run(void *user_context,
     int result = init_hexagon_runtime(user_context);
     if (result != 0) return result;
 
-    halide_hexagon_handle_t module = state_ptr ? ((module_state *)state_ptr)->module : 0;
+    module_state *state = (module_state *)state_ptr;
+    if (!state->module) {
+        // Loading was deferred to the first run.
+        ScopedMutexLock lock(&thread_lock);
+        if (!state->module) {
+            result = load_module(user_context, state);
+            if (result != 0) return -1;
+        }
+    }
+
+    halide_hexagon_handle_t module = state->module;
     debug(user_context) << "Hexagon: halide_hexagon_run ("
                         << "user_context: " << user_context << ", "
                         << "state_ptr: " << state_ptr << " (" << module << "), "
@@ -354,6 +520,16 @@ WEAK int halide_hexagon_run(void *user_context,
                                            input_scalars);
     if (input_scalar_count < 0) return input_scalar_count;
 
+    // This run probably depends on the results of the last one.
+    result = wait_for_pending_run(user_context);
+    if (result != 0) return result;
+
+    if (async_runs_enabled) {
+        debug(user_context) << "    halide_hexagon_remote_run (asynchronous)\n";
+        return start_async_run(user_context, module, *function, mapped_buffers,
+                               input_buffer_count, output_buffer_count, input_scalar_count);
+    }
+
     #ifdef DEBUG_RUNTIME
     uint64_t t_before = halide_current_time_ns(user_context);
     #endif
@@ -393,22 +569,32 @@ WEAK int halide_hexagon_device_release(void *user_context) {
     debug(user_context)
         << "Hexagon: halide_hexagon_device_release (user_context: " <<  user_context << ")\n";
 
+    wait_for_pending_run(user_context);
+
     ScopedMutexLock lock(&thread_lock);
 
-    // Release all of the remote side modules.
+    release_pooled_ion_buffers(user_context);
+
+    // Release all of the remote side modules. Modules may be shared
+    // by several states, so forget a module in all of them once it's
+    // released.
     module_state *state = state_list;
     while (state) {
         if (state->module) {
+            halide_hexagon_handle_t module = state->module;
             debug(user_context) << "    halide_remote_release_library " << state
-                                << " (" << state->module << ") -> ";
-            int result = remote_release_library(state->module);
+                                << " (" << module << ") -> ";
+            int result = remote_release_library(module);
             poll_log(user_context);
             debug(user_context) << "        " << result << "\n";
-            state->module = 0;
+            for (module_state *s = state; s; s = s->next) {
+                if (s->module == module) {
+                    s->module = 0;
+                }
+            }
         }
         state = state->next;
     }
-    state_list = NULL;
 
     if (shared_runtime) {
         debug(user_context) << "    releasing shared runtime\n";
@@ -464,9 +650,22 @@ WEAK int halide_hexagon_device_malloc(void *user_context, halide_buffer_t *buf)
 
     void *ion;
     if (size >= min_ion_allocation_size) {
-        debug(user_context) << "    host_malloc len=" << (uint64_t)size << " -> ";
-        ion = host_malloc(size);
-        debug(user_context) << "        " << ion << "\n";
+        // Round up to a size class, so that the buffer can go back
+        // in the pool when it is freed.
+        size = device_pool_allocation_size(&ion_pool, size);
+        ion = (void *)device_pool_take(&ion_pool, NULL, size);
+        if (ion) {
+            debug(user_context) << "    reusing pooled ion=" << ion << "\n";
+        } else {
+            debug(user_context) << "    host_malloc len=" << (uint64_t)size << " -> ";
+            ion = host_malloc(size);
+            if (!ion) {
+                // Give the memory held by the pool back and try again.
+                release_pooled_ion_buffers(user_context);
+                ion = host_malloc(size);
+            }
+            debug(user_context) << "        " << ion << "\n";
+        }
         if (!ion) {
             error(user_context) << "host_malloc failed\n";
             return -1;
@@ -511,6 +710,9 @@ WEAK int halide_hexagon_device_free(void *user_context, halide_buffer_t* buf) {
         << "Hexagon: halide_hexagon_device_free (user_context: " << user_context
         << ", buf: " << buf << ")\n";
 
+    // The DSP may still be using the memory.
+    wait_for_pending_run(user_context);
+
     #ifdef DEBUG_RUNTIME
     uint64_t t_before = halide_current_time_ns(user_context);
     #endif
@@ -519,8 +721,12 @@ WEAK int halide_hexagon_device_free(void *user_context, halide_buffer_t* buf) {
     void *ion = halide_hexagon_get_device_handle(user_context, buf);
     halide_hexagon_detach_device_handle(user_context, buf);
     if (size >= min_ion_allocation_size) {
-        debug(user_context) << "    host_free ion=" << ion << "\n";
-        host_free(ion);
+        if (device_pool_give(&ion_pool, NULL, (uint64_t)ion, size)) {
+            debug(user_context) << "    returning ion=" << ion << " to pool\n";
+        } else {
+            debug(user_context) << "    host_free ion=" << ion << "\n";
+            host_free(ion);
+        }
     } else {
         debug(user_context) << "    halide_free ion=" << ion << "\n";
         halide_free(user_context, ion);
@@ -556,6 +762,12 @@ WEAK int halide_hexagon_copy_to_device(void *user_context, halide_buffer_t* buf)
     uint64_t t_before = halide_current_time_ns(user_context);
     #endif
 
+    // Don't overwrite memory the DSP may still be reading.
+    err = wait_for_pending_run(user_context);
+    if (err) {
+        return err;
+    }
+
     halide_assert(user_context, buf->host && buf->device);
     device_copy c = make_host_to_device_copy(buf);
 
@@ -580,6 +792,11 @@ WEAK int halide_hexagon_copy_to_host(void *user_context, struct halide_buffer_t
     uint64_t t_before = halide_current_time_ns(user_context);
     #endif
 
+    int err = wait_for_pending_run(user_context);
+    if (err) {
+        return err;
+    }
+
     halide_assert(user_context, buf->host && buf->device);
     device_copy c = make_device_to_host_copy(buf);
 
@@ -598,8 +815,15 @@ WEAK int halide_hexagon_copy_to_host(void *user_context, struct halide_buffer_t
 WEAK int halide_hexagon_device_sync(void *user_context, struct halide_buffer_t *) {
     debug(user_context)
         << "Hexagon: halide_hexagon_device_sync (user_context: " << user_context << ")\n";
-    // Nothing to do.
-    return 0;
+    return wait_for_pending_run(user_context);
+}
+
+WEAK void halide_hexagon_set_async_run(bool async) {
+    async_runs_enabled = async;
+}
+
+WEAK void halide_hexagon_set_lazy_loading(bool lazy) {
+    lazy_loading_enabled = lazy;
 }
 
 WEAK int halide_hexagon_wrap_device_handle(void *user_context, struct halide_buffer_t *buf,
@@ -705,6 +929,7 @@ WEAK int halide_hexagon_power_hvx_off(void *user_context) {
     if (result != 0) return result;
 
     debug(user_context) << "halide_hexagon_power_hvx_off\n";
+    wait_for_pending_run(user_context);
     if (!remote_power_hvx_off) {
         // The function is not available in this version of the
         // runtime, this runtime always powers HVX on.
@@ -0,0 +1,132 @@
+#include "HalideRuntime.h"
+
+// Reads hardware performance counters for the profiler using
+// perf_event_open. Counting is restricted to user space so that this
+// works with the default perf_event_paranoid setting.
+
+// The syscall numbers for perf_event_open and gettid vary across
+// platforms:
+// -- x64 is 298 and 186
+// -- i386 is 336 and 224
+
+#ifdef BITS_64
+#define SYS_PERF_EVENT_OPEN 298
+#define SYS_GETTID 186
+#endif
+
+#ifdef BITS_32
+#define SYS_PERF_EVENT_OPEN 336
+#define SYS_GETTID 224
+#endif
+
+namespace Halide { namespace Runtime { namespace Internal {
+
+// The first version of struct perf_event_attr, which all kernels
+// that have perf_event_open accept.
+struct perf_event_attr {
+    uint32_t type;
+    uint32_t size;
+    uint64_t config;
+    uint64_t sample_period;
+    uint64_t sample_type;
+    uint64_t read_format;
+    uint64_t flags;
+    uint32_t wakeup_events;
+    uint32_t bp_type;
+    uint64_t config1;
+};
+
+#define PERF_TYPE_HARDWARE          0
+#define PERF_COUNT_HW_CPU_CYCLES    0
+#define PERF_COUNT_HW_INSTRUCTIONS  1
+#define PERF_COUNT_HW_CACHE_MISSES  3
+#define PERF_FORMAT_GROUP           (1 << 3)
+#define PERF_ATTR_FLAG_EXCLUDE_KERNEL (1 << 5)
+#define PERF_ATTR_FLAG_EXCLUDE_HV     (1 << 6)
+
+// The counters opened so far, keyed by thread id. Only the sampling
+// thread touches this.
+struct perf_thread_counters {
+    int thread_id;
+    int fds[halide_profiler_num_counters];
+};
+
+#define MAX_PERF_THREADS HALIDE_PROFILER_MAX_THREAD_SLOTS
+
+WEAK perf_thread_counters perf_threads[MAX_PERF_THREADS];
+WEAK int num_perf_threads = 0;
+
+extern "C" int syscall(int num, ...);
+extern "C" ssize_t read(int fd, void *buf, size_t bytes);
+
+WEAK int perf_event_open(int thread_id, uint64_t event, int group_fd) {
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = event;
+    attr.read_format = PERF_FORMAT_GROUP;
+    attr.flags = PERF_ATTR_FLAG_EXCLUDE_KERNEL | PERF_ATTR_FLAG_EXCLUDE_HV;
+    return syscall(SYS_PERF_EVENT_OPEN, &attr, thread_id, -1, group_fd, 0);
+}
+
+WEAK perf_thread_counters *get_perf_thread_counters(int thread_id) {
+    for (int i = 0; i < num_perf_threads; i++) {
+        if (perf_threads[i].thread_id == thread_id) {
+            return perf_threads + i;
+        }
+    }
+    if (num_perf_threads == MAX_PERF_THREADS) {
+        return NULL;
+    }
+    // The order matches halide_profiler_counter_*.
+    const uint64_t events[halide_profiler_num_counters] = {
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_CACHE_MISSES
+    };
+    perf_thread_counters *c = perf_threads + num_perf_threads;
+    c->thread_id = thread_id;
+    // The first counter leads the group, so that all of them can be
+    // read with one syscall.
+    for (int i = 0; i < halide_profiler_num_counters; i++) {
+        c->fds[i] = perf_event_open(thread_id, events[i], i == 0 ? -1 : c->fds[0]);
+        if (c->fds[i] < 0) {
+            for (int j = 0; j < i; j++) {
+                close(c->fds[j]);
+            }
+            c->fds[0] = -1;
+            break;
+        }
+    }
+    // Remember failures too, so we don't retry them on every sample.
+    num_perf_threads++;
+    return c;
+}
+
+}}} // namespace Halide::Runtime::Internal
+
+extern "C" {
+
+WEAK int halide_profiler_current_thread_id() {
+    return syscall(SYS_GETTID);
+}
+
+WEAK int halide_profiler_read_thread_counters(int thread_id, uint64_t *values) {
+    using namespace Halide::Runtime::Internal;
+    perf_thread_counters *c = get_perf_thread_counters(thread_id);
+    if (!c || c->fds[0] < 0) {
+        return 0;
+    }
+    uint64_t buf[halide_profiler_num_counters + 1];
+    if (read(c->fds[0], buf, sizeof(buf)) != (ssize_t)sizeof(buf) ||
+        buf[0] != halide_profiler_num_counters) {
+        return 0;
+    }
+    for (int i = 0; i < halide_profiler_num_counters; i++) {
+        values[i] = buf[i + 1];
+    }
+    return halide_profiler_num_counters;
+}
+
+}
@@ -247,6 +247,11 @@ WEAK int halide_matlab_init(void *user_context) {
     halide_set_custom_print(halide_matlab_print);
     halide_set_error_handler(halide_matlab_error);
 
+    // Keep the mex library, and the state the runtime builds up in it
+    // (the thread pool, compiled GPU kernels, caches), resident until
+    // the user calls munlock, rather than reloading it after a clear.
+    mexLock();
+
     return halide_error_code_success;
 }
 
@@ -291,7 +296,9 @@ WEAK int halide_matlab_array_to_halide_buffer_t(void *user_context,
     buf->host = (uint8_t *)mxGetData(arr);
     buf->type = arg->type;
     buf->dimensions = arg->dimensions;
-    buf->set_host_dirty(true);
+    // The contents of outputs are overwritten by the pipeline, so
+    // only inputs need to be copied to a device.
+    buf->set_host_dirty(arg->kind == halide_argument_kind_input_buffer);
 
     for (int i = 0; i < dim_count && i < expected_dims; i++) {
         buf->dim[i].extent = static_cast<int32_t>(get_dimension(arr, i));
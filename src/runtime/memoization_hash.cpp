@@ -0,0 +1,97 @@
+#include "HalideRuntime.h"
+#include "runtime_internal.h"
+
+namespace Halide { namespace Runtime { namespace Internal {
+
+// Hashes the contents of buffers for use in cache keys. There are
+// four independent lanes, so that the loop over each contiguous span
+// of memory can be vectorized.
+struct BufferHasher {
+    uint64_t lanes[4];
+
+    void mix(int lane, uint64_t k) {
+        const uint64_t m = UINT64_C(0xc6a4a7935bd1e995);
+        k *= m;
+        k ^= k >> 47;
+        k *= m;
+        lanes[lane] = (lanes[lane] ^ k) * m;
+    }
+
+    void span(const uint8_t *p, size_t bytes) {
+        size_t blocks = bytes / 32;
+        for (size_t i = 0; i < blocks; i++) {
+            for (int j = 0; j < 4; j++) {
+                uint64_t k;
+                memcpy(&k, p + i * 32 + j * 8, 8);
+                mix(j, k);
+            }
+        }
+        p += blocks * 32;
+        bytes -= blocks * 32;
+        while (bytes > 0) {
+            uint64_t k = 0;
+            size_t n = bytes < 8 ? bytes : 8;
+            memcpy(&k, p, n);
+            mix(0, k);
+            p += n;
+            bytes -= n;
+        }
+    }
+
+    // Visit the elements of dimensions d and below, starting at p,
+    // in coordinate order, so that the hash doesn't depend on the
+    // strides.
+    void dims(const halide_buffer_t *buf, int d, const uint8_t *p) {
+        const int elem_bytes = buf->type.bytes();
+        if (d == 0) {
+            span(p, elem_bytes);
+        } else if (d == 1 && buf->dim[0].stride == 1) {
+            span(p, (size_t)buf->dim[0].extent * elem_bytes);
+        } else {
+            for (int i = 0; i < buf->dim[d - 1].extent; i++) {
+                dims(buf, d - 1, p + (ptrdiff_t)i * buf->dim[d - 1].stride * elem_bytes);
+            }
+        }
+    }
+};
+
+// Hashes of buffers that can't be hashed are unique, so that the
+// cache always misses on them.
+WEAK uint64_t unhashable_buffer_counter = 0;
+
+}}} // namespace Halide::Runtime::Internal
+
+extern "C" {
+
+WEAK uint64_t halide_memoization_hash_buffer(void *user_context, halide_buffer_t *buf,
+                                             int64_t max_bytes) {
+    if (buf->host == NULL || buf->device_dirty() ||
+        (int64_t)(buf->number_of_elements() * buf->type.bytes()) > max_bytes) {
+        return __atomic_add_fetch(&unhashable_buffer_counter, 1, __ATOMIC_SEQ_CST) |
+            (UINT64_C(1) << 63);
+    }
+
+    BufferHasher hasher;
+    for (int i = 0; i < 4; i++) {
+        hasher.lanes[i] = UINT64_C(0x8445d61a4e774912) + i;
+    }
+    hasher.dims(buf, buf->dimensions, buf->host);
+
+    // Mix in the type and shape, and then the lanes.
+    const uint64_t m = UINT64_C(0xc6a4a7935bd1e995);
+    uint64_t h = buf->type.code | (buf->type.bits << 8) | (buf->type.lanes << 16);
+    h = (h ^ ((uint64_t)buf->dimensions << 32)) * m;
+    for (int i = 0; i < buf->dimensions; i++) {
+        h = (h ^ (uint32_t)buf->dim[i].min) * m;
+        h = (h ^ (uint32_t)buf->dim[i].extent) * m;
+    }
+    for (int i = 0; i < 4; i++) {
+        h = (h ^ hasher.lanes[i]) * m;
+        h ^= h >> 47;
+    }
+    // Keep the top bit clear, so that this can't match the hash of a
+    // buffer that couldn't be hashed.
+    return h & ~(UINT64_C(1) << 63);
+}
+
+}
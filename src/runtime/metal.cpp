@@ -337,6 +337,30 @@ WEAK command_buffer_completed_handler_block_literal command_buffer_completed_han
     &command_buffer_completed_handler_descriptor
 };
 
+// Creating and committing a command buffer for every dispatch is
+// expensive, so dispatches are encoded into one pending command buffer,
+// which is committed at the end of the pipeline, or as soon as the host
+// needs to wait for the results. These are retained, as the autorelease
+// pool they are created in is drained at the end of each call. Only
+// accessed with the context held.
+WEAK mtl_command_buffer *pending_command_buffer = NULL;
+WEAK mtl_compute_command_encoder *pending_encoder = NULL;
+WEAK mtl_command_queue *pending_queue = NULL;
+
+WEAK void commit_pending_command_buffer() {
+    if (pending_command_buffer == NULL) {
+        return;
+    }
+    end_encoding(pending_encoder);
+    add_command_buffer_completed_handler(pending_command_buffer, &command_buffer_completed_handler_block);
+    commit_command_buffer(pending_command_buffer);
+    release_ns_object(pending_encoder);
+    release_ns_object(pending_command_buffer);
+    pending_encoder = NULL;
+    pending_command_buffer = NULL;
+    pending_queue = NULL;
+}
+
 }}}} // namespace Halide::Runtime::Internal::Metal
 
 using namespace Halide::Runtime::Internal::Metal;
@@ -466,6 +490,7 @@ WEAK int halide_metal_initialize_kernels(void *user_context, void **state_ptr, c
 namespace {
 
 inline void halide_metal_device_sync_internal(mtl_command_queue *queue, struct halide_buffer_t *buffer) {
+    commit_pending_command_buffer();
     mtl_command_buffer *sync_command_buffer = new_command_buffer(queue);
     if (buffer != NULL) {
         mtl_buffer *metal_buffer = (mtl_buffer *)buffer->device;
@@ -559,6 +584,12 @@ WEAK int halide_metal_copy_to_device(void *user_context, halide_buffer_t* buffer
 
     halide_assert(user_context, buffer->host && buffer->device);
 
+    // Dispatches that haven't been committed yet may use the old
+    // contents.
+    if (pending_command_buffer != NULL) {
+        halide_metal_device_sync_internal(metal_context.queue, NULL);
+    }
+
     device_copy c = make_host_to_device_copy(buffer);
     mtl_buffer *metal_buffer = (mtl_buffer *)c.dst;
     c.dst = (uint64_t)buffer_contents(metal_buffer);
@@ -567,9 +598,15 @@ WEAK int halide_metal_copy_to_device(void *user_context, halide_buffer_t* buffer
                         << " metal_buffer = " << metal_buffer
                         << " host = " << buffer->host << "\n";
 
-    copy_memory(c, user_context);
+    // Buffers from halide_metal_device_and_host_malloc use the
+    // contents of the Metal buffer as their host memory, so there is
+    // nothing to copy.
+    if (c.src != c.dst) {
+        copy_memory(c, user_context);
+    }
 
-    if (is_buffer_managed(metal_buffer)) {
+    bool managed = is_buffer_managed(metal_buffer);
+    if (managed) {
         size_t total_size = buffer->size_in_bytes();
         halide_assert(user_context, total_size != 0);
         NSRange total_extent;
@@ -577,7 +614,9 @@ WEAK int halide_metal_copy_to_device(void *user_context, halide_buffer_t* buffer
         total_extent.length = total_size;
         did_modify_range(metal_buffer, total_extent);
     }
-    halide_metal_device_sync_internal(metal_context.queue, buffer);
+    if (managed || c.src != c.dst) {
+        halide_metal_device_sync_internal(metal_context.queue, buffer);
+    }
 
     #ifdef DEBUG_RUNTIME
     uint64_t t_after = halide_current_time_ns(user_context);
@@ -609,7 +648,9 @@ WEAK int halide_metal_copy_to_host(void *user_context, halide_buffer_t* buffer)
     device_copy c = make_device_to_host_copy(buffer);
     c.src = (uint64_t)buffer_contents((mtl_buffer *)c.src);
 
-    copy_memory(c, user_context);
+    if (c.src != c.dst) {
+        copy_memory(c, user_context);
+    }
 
     #ifdef DEBUG_RUNTIME
     uint64_t t_after = halide_current_time_ns(user_context);
@@ -641,17 +682,28 @@ WEAK int halide_metal_run(void *user_context,
         return metal_context.error;
     }
 
-    mtl_command_buffer *command_buffer = new_command_buffer(metal_context.queue);
-    if (command_buffer == 0) {
-        error(user_context) << "Metal: Could not allocate command buffer.\n";
-        return -1;
+    if (pending_command_buffer != NULL && pending_queue != metal_context.queue) {
+        commit_pending_command_buffer();
     }
+    if (pending_command_buffer == NULL) {
+        mtl_command_buffer *command_buffer = new_command_buffer(metal_context.queue);
+        if (command_buffer == 0) {
+            error(user_context) << "Metal: Could not allocate command buffer.\n";
+            return -1;
+        }
 
-    mtl_compute_command_encoder *encoder = new_compute_command_encoder(command_buffer);
-    if (encoder == 0) {
-        error(user_context) << "Metal: Could not allocate compute command encoder.\n";
-        return -1;
+        // Dispatches in one compute encoder run in order, and see the
+        // results of earlier ones.
+        mtl_compute_command_encoder *encoder = new_compute_command_encoder(command_buffer);
+        if (encoder == 0) {
+            error(user_context) << "Metal: Could not allocate compute command encoder.\n";
+            return -1;
+        }
+        pending_command_buffer = (mtl_command_buffer *)retain_ns_object(command_buffer);
+        pending_encoder = (mtl_compute_command_encoder *)retain_ns_object(encoder);
+        pending_queue = metal_context.queue;
     }
+    mtl_compute_command_encoder *encoder = pending_encoder;
 
     halide_assert(user_context, state_ptr);
     module_state *state = (module_state*)state_ptr;
@@ -750,11 +802,6 @@ WEAK int halide_metal_run(void *user_context,
     dispatch_threadgroups(encoder,
                           blocksX, blocksY, blocksZ,
                           threadsX, threadsY, threadsZ);
-    end_encoding(encoder);
-
-    add_command_buffer_completed_handler(command_buffer, &command_buffer_completed_handler_block);
-
-    commit_command_buffer(command_buffer);
 
     release_ns_object(pipeline_state);
     release_ns_object(function);
@@ -767,6 +814,13 @@ WEAK int halide_metal_run(void *user_context,
     return 0;
 }
 
+WEAK void halide_metal_finish_pipeline_as_destructor(void *user_context, void *obj) {
+    MetalContextHolder metal_context(user_context, false);
+    if (metal_context.error == 0) {
+        commit_pending_command_buffer();
+    }
+}
+
 WEAK int halide_metal_device_and_host_malloc(void *user_context, struct halide_buffer_t *buffer) {
     debug(user_context) << "halide_metal_device_and_host_malloc called.\n";
     int result = halide_metal_device_malloc(user_context, buffer);
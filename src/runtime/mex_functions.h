@@ -43,7 +43,7 @@ MEX_FN(void, mexWarnMsgTxt, (const char*));
 //MEX_FN(int, mexPutVariable, (const char*, const char*, const mxArray*));
 //MEX_FN(const mxArray*, mexGetVariablePtr, (const char*, const char*));
 //MEX_FN(mxArray*, mexGetVariable, (const char*, const char*));
-//MEX_FN(void, mexLock, (void));
+MEX_FN(void, mexLock, (void));
 //MEX_FN(void, mexUnlock, (void));
 //MEX_FN(bool, mexIsLocked, (void));
 //MEX_FN(const char*, mexFunctionName, (void));
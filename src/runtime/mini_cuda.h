@@ -22,6 +22,17 @@ typedef struct CUfunc_st *CUfunction;                     /**< CUDA function */
 typedef struct CUstream_st *CUstream;                     /**< CUDA stream */
 typedef struct CUevent_st *CUevent;                       /**< CUDA event */
 typedef struct CUarray_st* CUarray;
+typedef struct CUgraph_st *CUgraph;                       /**< CUDA graph */
+typedef struct CUgraphExec_st *CUgraphExec;               /**< CUDA executable graph */
+typedef struct CUgraphNode_st *CUgraphNode;               /**< CUDA graph node */
+
+typedef enum CUstreamCaptureMode_enum {
+    CU_STREAM_CAPTURE_MODE_GLOBAL = 0,
+    CU_STREAM_CAPTURE_MODE_THREAD_LOCAL = 1,
+    CU_STREAM_CAPTURE_MODE_RELAXED = 2
+} CUstreamCaptureMode;
+
+#define CU_STREAM_NON_BLOCKING 0x1
 
 typedef enum CUjit_option_enum {
     CU_JIT_MAX_REGISTERS = 0,
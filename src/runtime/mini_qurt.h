@@ -201,6 +201,7 @@ extern int qurt_thread_create (qurt_thread_t *thread_id, qurt_thread_attr_t *att
    None.
  */
 extern int qurt_thread_join(unsigned int tid, int *status);
+extern qurt_thread_t qurt_thread_get_id(void);
 
 /** QuRT mutex type.
 
@@ -251,5 +252,9 @@ typedef enum {
 extern int qurt_hvx_lock(qurt_hvx_mode_t lock_mode);
 extern int qurt_hvx_unlock(void);
 extern int qurt_hvx_get_mode(void);
+// Returns the number of HVX contexts of each size in the low two
+// bytes: 64 byte contexts in bits 0-7, 128 byte contexts in bits
+// 8-15. Not all versions of QuRT have this.
+__attribute__((weak)) extern int qurt_hvx_get_units(void);
 
 }
@@ -2,6 +2,7 @@
 #include "scoped_spin_lock.h"
 #include "device_buffer_utils.h"
 #include "device_interface.h"
+#include "device_memory_pool.h"
 #include "printer.h"
 
 #include "mini_cl.h"
@@ -84,6 +85,10 @@ WEAK char device_type[256];
 WEAK int device_type_lock = 0;
 WEAK bool device_type_initialized = false;
 
+WEAK char program_cache_dir[1024];
+WEAK int program_cache_dir_lock = 0;
+WEAK bool program_cache_dir_initialized = false;
+
 }}}} // namespace Halide::Runtime::Internal::OpenCL
 
 using namespace Halide::Runtime::Internal::OpenCL;
@@ -130,6 +135,24 @@ WEAK const char *halide_opencl_get_device_type(void *user_context) {
     return device_type;
 }
 
+WEAK void halide_opencl_set_program_cache_dir(const char *n) {
+    if (n) {
+        strncpy(program_cache_dir, n, 1023);
+    } else {
+        program_cache_dir[0] = 0;
+    }
+    program_cache_dir_initialized = true;
+}
+
+WEAK const char *halide_opencl_get_program_cache_dir(void *user_context) {
+    ScopedSpinLock lock(&program_cache_dir_lock);
+    if (!program_cache_dir_initialized) {
+        const char *name = getenv("HL_OCL_PROGRAM_CACHE_DIR");
+        halide_opencl_set_program_cache_dir(name);
+    }
+    return program_cache_dir;
+}
+
 // The default implementation of halide_acquire_cl_context uses the global
 // pointers above, and serializes access with a spin lock.
 // Overriding implementations of acquire/release must implement the following
@@ -210,10 +233,209 @@ public:
 // when then context is released.
 struct module_state {
     cl_program program;
+    // A hash of the source of the program, and its size.
+    uint64_t hash, check;
+    int size;
     module_state *next;
 };
 WEAK module_state *state_list = NULL;
 
+// Freed device allocations, kept for reuse by the context they belong to.
+WEAK device_pool memory_pool = {0, {NULL}, 0, -1};
+
+// Return the buffers the pool holds for the given context to the driver.
+WEAK void release_pooled_memory(void *user_context, cl_context ctx) {
+    device_pool_block *block = device_pool_detach(&memory_pool, ctx);
+    while (block) {
+        device_pool_block *next = block->next;
+        debug(user_context) << "    clReleaseMemObject " << (void *)(block->handle) << " (pooled)\n";
+        cl_int err = clReleaseMemObject((cl_mem)block->handle);
+        halide_assert(user_context, err == CL_SUCCESS);
+        free(block);
+        block = next;
+    }
+}
+
+// Host allocations made by halide_opencl_device_and_host_malloc. Each
+// is a buffer created with CL_MEM_ALLOC_HOST_PTR, so that the driver
+// can put it in page-locked memory, which stays mapped for as long as
+// the host pointer is in use.
+//
+// On devices that share memory with the host, the buffer is instead
+// created with CL_MEM_USE_HOST_PTR around memory we allocate (alloc),
+// and is also used as the device allocation. Copies between the two
+// then become mapping (on the way to the host) and unmapping (on the
+// way to the device) the buffer, which the driver does without moving
+// any data.
+struct pinned_host_allocation {
+    cl_mem mem;
+    void *host;
+    void *alloc;
+    size_t size;
+    bool mapped;
+    pinned_host_allocation *next;
+};
+WEAK pinned_host_allocation *pinned_host_allocations = NULL;
+
+// Find the zero-copy allocation the host memory of a buffer lies in,
+// if there is one.
+WEAK pinned_host_allocation *find_zero_copy_allocation(const halide_buffer_t *buf) {
+    if (!buf->host) {
+        return NULL;
+    }
+    for (pinned_host_allocation *p = pinned_host_allocations; p; p = p->next) {
+        if (p->alloc &&
+            buf->host >= (uint8_t *)p->host &&
+            buf->host < (uint8_t *)p->host + p->size) {
+            return p;
+        }
+    }
+    return NULL;
+}
+
+// Make a zero-copy allocation visible to the host (by mapping it) or
+// to the device (by unmapping it). Must be called with the context
+// held.
+WEAK int set_zero_copy_mapped(void *user_context, ClContext &ctx,
+                              pinned_host_allocation *p, bool mapped) {
+    if (p->mapped == mapped) {
+        return CL_SUCCESS;
+    }
+    cl_int err = CL_SUCCESS;
+    if (mapped) {
+        debug(user_context) << "    clEnqueueMapBuffer " << (void *)p->mem << "\n";
+        void *host = clEnqueueMapBuffer(ctx.cmd_queue, p->mem, CL_TRUE, CL_MAP_READ | CL_MAP_WRITE,
+                                        0, p->size, 0, NULL, NULL, &err);
+        // A buffer created with CL_MEM_USE_HOST_PTR always maps to
+        // the memory it was created with.
+        halide_assert(user_context, err != CL_SUCCESS || host == p->host);
+    } else {
+        debug(user_context) << "    clEnqueueUnmapMemObject " << (void *)p->mem << "\n";
+        err = clEnqueueUnmapMemObject(ctx.cmd_queue, p->mem, p->host, 0, NULL, NULL);
+    }
+    if (err != CL_SUCCESS) {
+        error(user_context) << "CL: " << (mapped ? "clEnqueueMapBuffer" : "clEnqueueUnmapMemObject")
+                            << " failed: " << get_opencl_error_name(err);
+        return err;
+    }
+    p->mapped = mapped;
+    return CL_SUCCESS;
+}
+
+// As above, for the zero-copy allocation a buffer's memory belongs
+// to. Does nothing for other buffers.
+WEAK int sync_zero_copy_buffer(void *user_context, ClContext &ctx,
+                               const halide_buffer_t *buf, bool to_host) {
+    pinned_host_allocation *p = find_zero_copy_allocation(buf);
+    return p ? set_zero_copy_mapped(user_context, ctx, p, to_host) : CL_SUCCESS;
+}
+
+// Whether the device the context uses shares memory with the host.
+WEAK bool has_unified_memory(ClContext &ctx) {
+    cl_device_id dev;
+    cl_bool unified = CL_FALSE;
+    return (clGetContextInfo(ctx.context, CL_CONTEXT_DEVICES, sizeof(dev), &dev, NULL) == CL_SUCCESS &&
+            clGetDeviceInfo(dev, CL_DEVICE_HOST_UNIFIED_MEMORY, sizeof(unified), &unified, NULL) == CL_SUCCESS &&
+            unified == CL_TRUE);
+}
+
+// Unmap and release the pinned allocation with the given host
+// pointer, if there is one. Must be called with the context held.
+WEAK bool release_pinned_host_allocation(void *user_context, ClContext &ctx, void *host) {
+    pinned_host_allocation **prev = &pinned_host_allocations;
+    while (*prev && (*prev)->host != host) {
+        prev = &(*prev)->next;
+    }
+    pinned_host_allocation *p = *prev;
+    if (!p) {
+        return false;
+    }
+    *prev = p->next;
+    cl_int err = CL_SUCCESS;
+    if (p->mapped) {
+        debug(user_context) << "    clEnqueueUnmapMemObject " << (void *)p->mem << "\n";
+        err = clEnqueueUnmapMemObject(ctx.cmd_queue, p->mem, p->host, 0, NULL, NULL);
+        halide_assert(user_context, err == CL_SUCCESS);
+    }
+    err = clReleaseMemObject(p->mem);
+    halide_assert(user_context, err == CL_SUCCESS);
+    if (p->alloc) {
+        // The driver may still be using the memory until the release
+        // above completes.
+        clFinish(ctx.cmd_queue);
+        free(p->alloc);
+    }
+    free(p);
+    return true;
+}
+
+// Allocate the host and device memory of a buffer as one zero-copy
+// allocation. Returns false if the driver won't make one. Must be
+// called with the context held.
+WEAK bool zero_copy_malloc(void *user_context, ClContext &ctx, halide_buffer_t *buf) {
+    // Drivers generally only avoid copying memory that is aligned to
+    // a page, and a whole number of cache lines long.
+    const size_t page_size = 4096;
+    size_t size = (buf->size_in_bytes() + 63) & ~(size_t)63;
+    void *alloc = malloc(size + page_size - 1);
+    if (!alloc) {
+        return false;
+    }
+    void *host = (void *)(((uintptr_t)alloc + page_size - 1) & ~(uintptr_t)(page_size - 1));
+
+    cl_int err = CL_SUCCESS;
+    debug(user_context) << "    clCreateBuffer (CL_MEM_USE_HOST_PTR) -> " << (int)size << " ";
+    cl_mem mem = clCreateBuffer(ctx.context, CL_MEM_READ_WRITE | CL_MEM_USE_HOST_PTR, size, host, &err);
+    pinned_host_allocation *p = NULL;
+    if (err == CL_SUCCESS && mem) {
+        p = (pinned_host_allocation *)malloc(sizeof(pinned_host_allocation));
+        if (!p) {
+            clReleaseMemObject(mem);
+        }
+    }
+    if (!p) {
+        debug(user_context) << get_opencl_error_name(err) << "\n";
+        free(alloc);
+        return false;
+    }
+    debug(user_context) << (void *)mem << "\n";
+    p->mem = mem;
+    p->host = host;
+    p->alloc = alloc;
+    p->size = size;
+    p->mapped = false;
+    p->next = pinned_host_allocations;
+    pinned_host_allocations = p;
+
+    // The host owns the memory to begin with.
+    if (set_zero_copy_mapped(user_context, ctx, p, true) != CL_SUCCESS) {
+        release_pinned_host_allocation(user_context, ctx, host);
+        return false;
+    }
+
+    // The device allocation holds a reference of its own, which also
+    // keeps halide_opencl_device_free from putting it in the pool.
+    clRetainMemObject(mem);
+    buf->host = (uint8_t *)host;
+    buf->device = (uint64_t)mem;
+    buf->device_interface = &opencl_device_interface;
+    buf->device_interface->impl->use_module();
+    return true;
+}
+
+// Whether a buffer being freed can go back in the pool: it must be one
+// we allocated, rather than a sub-buffer or a cl_mem shared with
+// someone else.
+WEAK bool can_pool(cl_mem mem, size_t *size) {
+    cl_mem parent = NULL;
+    cl_uint refs = 0;
+    return (clGetMemObjectInfo(mem, CL_MEM_ASSOCIATED_MEMOBJECT, sizeof(parent), &parent, NULL) == CL_SUCCESS &&
+            parent == NULL &&
+            clGetMemObjectInfo(mem, CL_MEM_REFERENCE_COUNT, sizeof(refs), &refs, NULL) == CL_SUCCESS &&
+            refs == 1 &&
+            clGetMemObjectInfo(mem, CL_MEM_SIZE, sizeof(*size), size, NULL) == CL_SUCCESS);
+}
+
 WEAK bool validate_device_pointer(void *user_context, halide_buffer_t* buf, size_t size=0) {
     if (buf->device == 0) {
         return true;
@@ -483,8 +705,15 @@ WEAK int halide_opencl_device_free(void *user_context, halide_buffer_t* buf) {
     #endif
 
     halide_assert(user_context, validate_device_pointer(user_context, buf));
-    debug(user_context) << "    clReleaseMemObject " << (void *)dev_ptr << "\n";
-    cl_int result = clReleaseMemObject((cl_mem)dev_ptr);
+    size_t size = 0;
+    cl_int result = CL_SUCCESS;
+    if (can_pool(dev_ptr, &size) &&
+        device_pool_give(&memory_pool, ctx.context, (uint64_t)dev_ptr, size)) {
+        debug(user_context) << "    returning " << (void *)dev_ptr << " to pool\n";
+    } else {
+        debug(user_context) << "    clReleaseMemObject " << (void *)dev_ptr << "\n";
+        result = clReleaseMemObject((cl_mem)dev_ptr);
+    }
     // If clReleaseMemObject fails, it is unlikely to succeed in a later call, so
     // we just end our reference to it regardless.
     buf->device = 0;
@@ -504,6 +733,110 @@ WEAK int halide_opencl_device_free(void *user_context, halide_buffer_t* buf) {
     return 0;
 }
 
+} // extern "C"
+
+namespace Halide { namespace Runtime { namespace Internal { namespace OpenCL {
+
+// Compiled programs are cached in files named after a hash of
+// everything that goes into building them: the device, the driver
+// version, the build options, and the source. Each file starts with a
+// header holding a second, independent hash of the same things, to
+// catch collisions, and files written by something else.
+#define PROGRAM_CACHE_MAGIC 0x4c434c48
+
+struct program_cache_header {
+    uint32_t magic;
+    uint32_t binary_size;
+    uint64_t check;
+};
+
+WEAK void program_cache_hash(uint64_t *name, uint64_t *check, const char *s, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        uint8_t c = (uint8_t)s[i];
+        *name = (*name ^ c) * 1099511628211ULL;
+        *check = (*check + c + 1) * 0x9e3779b97f4a7c15ULL;
+        *check ^= *check >> 29;
+    }
+    // Separate the strings, so that moving characters from one to the
+    // next changes the hash.
+    *name = (*name ^ len) * 1099511628211ULL;
+    *check = (*check + len) * 0x9e3779b97f4a7c15ULL;
+}
+
+// Load a program from the cache, or return NULL if there isn't one.
+WEAK cl_program load_cached_program(void *user_context, cl_context ctx, cl_device_id dev,
+                                    const char *path, uint64_t check) {
+    void *f = fopen(path, "rb");
+    if (!f) {
+        return NULL;
+    }
+    cl_program program = NULL;
+    program_cache_header header;
+    if (fread(&header, sizeof(header), 1, f) == 1 &&
+        header.magic == PROGRAM_CACHE_MAGIC &&
+        header.check == check &&
+        header.binary_size > 0) {
+        unsigned char *binary = (unsigned char *)malloc(header.binary_size);
+        if (binary && fread(binary, header.binary_size, 1, f) == 1) {
+            size_t binary_size = header.binary_size;
+            const unsigned char *binaries[] = { binary };
+            cl_int status = CL_SUCCESS, err = CL_SUCCESS;
+            debug(user_context) << "    clCreateProgramWithBinary " << path << " -> ";
+            program = clCreateProgramWithBinary(ctx, 1, &dev, &binary_size, binaries, &status, &err);
+            if (err != CL_SUCCESS || status != CL_SUCCESS) {
+                debug(user_context) << get_opencl_error_name(err != CL_SUCCESS ? err : status) << "\n";
+                if (err == CL_SUCCESS) {
+                    clReleaseProgram(program);
+                }
+                program = NULL;
+            } else {
+                debug(user_context) << (void *)program << "\n";
+            }
+        }
+        free(binary);
+    }
+    fclose(f);
+    return program;
+}
+
+// Write the binary for a built program to the cache. Failures are
+// ignored, as the cache is only an optimization.
+WEAK void save_cached_program(void *user_context, cl_program program,
+                              const char *path, uint64_t check) {
+    size_t binary_size = 0;
+    if (clGetProgramInfo(program, CL_PROGRAM_BINARY_SIZES, sizeof(binary_size), &binary_size, NULL) != CL_SUCCESS ||
+        binary_size == 0 || binary_size > 0xffffffffULL) {
+        return;
+    }
+    unsigned char *binary = (unsigned char *)malloc(binary_size);
+    if (!binary) {
+        return;
+    }
+    unsigned char *binaries[] = { binary };
+    if (clGetProgramInfo(program, CL_PROGRAM_BINARIES, sizeof(binaries), binaries, NULL) == CL_SUCCESS) {
+        // Write to a temporary file and move it into place, so that
+        // other processes never see part of a file.
+        stringstream tmp_path(user_context);
+        tmp_path << path << "." << (uint64_t)(uintptr_t)binary << ".tmp";
+        void *f = fopen(tmp_path.str(), "wb");
+        if (f) {
+            program_cache_header header = {PROGRAM_CACHE_MAGIC, (uint32_t)binary_size, check};
+            bool ok = (fwrite(&header, sizeof(header), 1, f) == 1 &&
+                       fwrite(binary, binary_size, 1, f) == 1);
+            ok = (fclose(f) == 0) && ok;
+            if (ok && rename(tmp_path.str(), path) == 0) {
+                debug(user_context) << "    Saved program binary to " << path << "\n";
+            } else {
+                remove(tmp_path.str());
+            }
+        }
+    }
+    free(binary);
+}
+
+}}}} // namespace Halide::Runtime::Internal::OpenCL
+
+extern "C" {
 
 WEAK int halide_opencl_initialize_kernels(void *user_context, void **state_ptr, const char* src, int size) {
     debug(user_context)
@@ -525,12 +858,28 @@ WEAK int halide_opencl_initialize_kernels(void *user_context, void **state_ptr,
     // of how many times halide_init_kernels/halide_release is called.
     // halide_release traverses this list and releases the program objects, but
     // it does not modify the list nodes created/inserted here.
+    //
+    // Pipelines with the same source (such as a JIT pipeline that is
+    // compiled again) share a state object, and so the program built
+    // for it. The context lock serializes access to the list.
     module_state **state = (module_state**)state_ptr;
     if (!(*state)) {
-        *state = (module_state*)malloc(sizeof(module_state));
-        (*state)->program = NULL;
-        (*state)->next = state_list;
-        state_list = *state;
+        uint64_t hash = 14695981039346656037ULL, check = 0;
+        program_cache_hash(&hash, &check, src, size);
+        module_state *s = state_list;
+        while (s && !(s->hash == hash && s->check == check && s->size == size)) {
+            s = s->next;
+        }
+        if (!s) {
+            s = (module_state*)malloc(sizeof(module_state));
+            s->program = NULL;
+            s->hash = hash;
+            s->check = check;
+            s->size = size;
+            s->next = state_list;
+            state_list = s;
+        }
+        *state = s;
     }
 
     // Create the program if necessary. TODO: The program object needs to not
@@ -571,41 +920,77 @@ WEAK int halide_opencl_initialize_kernels(void *user_context, void **state_ptr,
         options << "-D MAX_CONSTANT_BUFFER_SIZE=" << max_constant_buffer_size
                 << " -D MAX_CONSTANT_ARGS=" << max_constant_args;
 
-        const char * sources[] = { src };
-        debug(user_context) << "    clCreateProgramWithSource -> ";
-        cl_program program = clCreateProgramWithSource(ctx.context, 1, &sources[0], NULL, &err );
-        if (err != CL_SUCCESS) {
-            debug(user_context) << get_opencl_error_name(err) << "\n";
-            error(user_context) << "CL: clCreateProgramWithSource failed: "
-                                << get_opencl_error_name(err);
-            return err;
-        } else {
-            debug(user_context) << (void *)program << "\n";
+        // Building programs from source can be very slow, so try the
+        // binary cache first, if there is one. Built binaries still
+        // need to be passed to clBuildProgram.
+        const char *cache_dir = halide_opencl_get_program_cache_dir(user_context);
+        stringstream cache_path(user_context);
+        uint64_t cache_name = 14695981039346656037ULL, cache_check = 0;
+        if (cache_dir[0]) {
+            char device_name[256] = {0}, driver_version[256] = {0};
+            clGetDeviceInfo(dev, CL_DEVICE_NAME, sizeof(device_name) - 1, device_name, NULL);
+            clGetDeviceInfo(dev, CL_DRIVER_VERSION, sizeof(driver_version) - 1, driver_version, NULL);
+            program_cache_hash(&cache_name, &cache_check, device_name, strlen(device_name));
+            program_cache_hash(&cache_name, &cache_check, driver_version, strlen(driver_version));
+            program_cache_hash(&cache_name, &cache_check, options.str(), strlen(options.str()));
+            program_cache_hash(&cache_name, &cache_check, src, size);
+            cache_path << cache_dir << "/halide_opencl_" << cache_name << ".bin";
+
+            cl_program program = load_cached_program(user_context, ctx.context, dev,
+                                                     cache_path.str(), cache_check);
+            if (program) {
+                err = clBuildProgram(program, 1, devices, options.str(), NULL, NULL);
+                if (err == CL_SUCCESS) {
+                    (*state)->program = program;
+                } else {
+                    debug(user_context) << "    clBuildProgram of cached binary failed: "
+                                        << get_opencl_error_name(err) << "\n";
+                    clReleaseProgram(program);
+                }
+            }
         }
-        (*state)->program = program;
-
-        debug(user_context) << "    clBuildProgram " << (void *)program
-                            << " " << options.str() << "\n";
-        err = clBuildProgram(program, 1, devices, options.str(), NULL, NULL );
-        if (err != CL_SUCCESS) {
 
-            // Allocate an appropriately sized buffer for the build log.
-            char buffer[8192];
-
-            // Get build log
-            if (clGetProgramBuildInfo(program, dev,
-                                      CL_PROGRAM_BUILD_LOG,
-                                      sizeof(buffer), buffer,
-                                      NULL) == CL_SUCCESS) {
-                error(user_context) << "CL: clBuildProgram failed: "
-                                    << get_opencl_error_name(err)
-                                    << "\nBuild Log:\n"
-                                    << buffer << "\n";
+        if (!(*state)->program) {
+            const char * sources[] = { src };
+            debug(user_context) << "    clCreateProgramWithSource -> ";
+            cl_program program = clCreateProgramWithSource(ctx.context, 1, &sources[0], NULL, &err );
+            if (err != CL_SUCCESS) {
+                debug(user_context) << get_opencl_error_name(err) << "\n";
+                error(user_context) << "CL: clCreateProgramWithSource failed: "
+                                    << get_opencl_error_name(err);
+                return err;
             } else {
-                error(user_context) << "clGetProgramBuildInfo failed";
+                debug(user_context) << (void *)program << "\n";
             }
+            (*state)->program = program;
 
-            return err;
+            debug(user_context) << "    clBuildProgram " << (void *)program
+                                << " " << options.str() << "\n";
+            err = clBuildProgram(program, 1, devices, options.str(), NULL, NULL );
+            if (err != CL_SUCCESS) {
+
+                // Allocate an appropriately sized buffer for the build log.
+                char buffer[8192];
+
+                // Get build log
+                if (clGetProgramBuildInfo(program, dev,
+                                          CL_PROGRAM_BUILD_LOG,
+                                          sizeof(buffer), buffer,
+                                          NULL) == CL_SUCCESS) {
+                    error(user_context) << "CL: clBuildProgram failed: "
+                                        << get_opencl_error_name(err)
+                                        << "\nBuild Log:\n"
+                                        << buffer << "\n";
+                } else {
+                    error(user_context) << "clGetProgramBuildInfo failed";
+                }
+
+                return err;
+            }
+
+            if (cache_dir[0]) {
+                save_cached_program(user_context, program, cache_path.str(), cache_check);
+            }
         }
     }
 
@@ -661,6 +1046,8 @@ WEAK int halide_opencl_device_release(void *user_context) {
         err = clFinish(q);
         halide_assert(user_context, err == CL_SUCCESS);
 
+        release_pooled_memory(user_context, ctx);
+
         // Unload the modules attached to this context. Note that the list
         // nodes themselves are not freed, only the program objects are
         // released. Subsequent calls to halide_init_kernels might re-create
@@ -724,9 +1111,20 @@ WEAK int halide_opencl_device_malloc(void *user_context, halide_buffer_t* buf) {
     uint64_t t_before = halide_current_time_ns(user_context);
     #endif
 
-    cl_int err;
-    debug(user_context) << "    clCreateBuffer -> " << (int)size << " ";
-    cl_mem dev_ptr = clCreateBuffer(ctx.context, CL_MEM_READ_WRITE, size, NULL, &err);
+    cl_int err = CL_SUCCESS;
+    cl_mem dev_ptr = (cl_mem)device_pool_take(&memory_pool, ctx.context, size);
+    if (dev_ptr) {
+        debug(user_context) << "    reusing pooled buffer -> ";
+    } else {
+        size_t alloc_size = device_pool_allocation_size(&memory_pool, size);
+        debug(user_context) << "    clCreateBuffer -> " << (int)alloc_size << " ";
+        dev_ptr = clCreateBuffer(ctx.context, CL_MEM_READ_WRITE, alloc_size, NULL, &err);
+        if (err == CL_MEM_OBJECT_ALLOCATION_FAILURE) {
+            // Give the memory held by the pool back and try again.
+            release_pooled_memory(user_context, ctx.context);
+            dev_ptr = clCreateBuffer(ctx.context, CL_MEM_READ_WRITE, alloc_size, NULL, &err);
+        }
+    }
     if (err != CL_SUCCESS || dev_ptr == 0) {
         debug(user_context) << get_opencl_error_name(err) << "\n";
         error(user_context) << "CL: clCreateBuffer failed: "
@@ -855,6 +1253,29 @@ WEAK int halide_opencl_buffer_copy(void *user_context, struct halide_buffer_t *s
         }
         #endif
 
+        // Copies between the host and device memory of a zero-copy
+        // allocation just hand the memory over.
+        if (src == dst && from_host != to_host) {
+            pinned_host_allocation *p = find_zero_copy_allocation(src);
+            cl_mem parent = NULL;
+            if (p && ((cl_mem)src->device == p->mem ||
+                      (clGetMemObjectInfo((cl_mem)src->device, CL_MEM_ASSOCIATED_MEMOBJECT,
+                                          sizeof(parent), &parent, NULL) == CL_SUCCESS &&
+                       parent == p->mem))) {
+                return set_zero_copy_mapped(user_context, ctx, p, to_host);
+            }
+        }
+
+        // Otherwise make sure any zero-copy memory involved is usable
+        // by whichever side is going to touch it.
+        err = sync_zero_copy_buffer(user_context, ctx, src, from_host);
+        if (err == 0) {
+            err = sync_zero_copy_buffer(user_context, ctx, dst, to_host);
+        }
+        if (err != 0) {
+            return err;
+        }
+
         err = do_multidimensional_copy(user_context, ctx, c, c.src_begin, 0, dst->dimensions, from_host, to_host);
 
         // The reads/writes above are all non-blocking, so empty the command
@@ -945,6 +1366,12 @@ WEAK int halide_opencl_run(void *user_context,
 
         if (arg_is_buffer[i]) {
             halide_assert(user_context, arg_sizes[i] == sizeof(uint64_t));
+            // Zero-copy memory must be unmapped before a kernel uses it.
+            err = sync_zero_copy_buffer(user_context, ctx, (halide_buffer_t *)this_arg, false);
+            if (err != CL_SUCCESS) {
+                clReleaseKernel(f);
+                return err;
+            }
             uint64_t opencl_handle = ((halide_buffer_t *)this_arg)->device;
             debug(user_context) << "Mapped dev handle is: " << (void *)opencl_handle << "\n";
             // In 32-bit mode, opencl only wants the bottom 32 bits of
@@ -1008,11 +1435,95 @@ WEAK int halide_opencl_run(void *user_context,
 }
 
 WEAK int halide_opencl_device_and_host_malloc(void *user_context, struct halide_buffer_t *buf) {
-    return halide_default_device_and_host_malloc(user_context, buf, &opencl_device_interface);
+    debug(user_context)
+        << "CL: halide_opencl_device_and_host_malloc (user_context: " << user_context
+        << ", buf: " << buf << ")\n";
+
+    // Allocate the host memory as a mapped buffer that the driver can
+    // pin, so that copies to and from the device don't have to be
+    // staged through a driver buffer.
+    void *host = NULL;
+    {
+        ClContext ctx(user_context);
+        if (ctx.error != CL_SUCCESS) {
+            return ctx.error;
+        }
+        // If the device shares memory with the host, use the same
+        // memory for both.
+        if (has_unified_memory(ctx) && zero_copy_malloc(user_context, ctx, buf)) {
+            return 0;
+        }
+
+        size_t size = buf->size_in_bytes();
+        cl_int err;
+        debug(user_context) << "    clCreateBuffer (CL_MEM_ALLOC_HOST_PTR) -> " << (int)size << " ";
+        cl_mem mem = clCreateBuffer(ctx.context, CL_MEM_READ_WRITE | CL_MEM_ALLOC_HOST_PTR, size, NULL, &err);
+        if (err == CL_SUCCESS && mem) {
+            host = clEnqueueMapBuffer(ctx.cmd_queue, mem, CL_TRUE, CL_MAP_READ | CL_MAP_WRITE,
+                                      0, size, 0, NULL, NULL, &err);
+            if (err != CL_SUCCESS) {
+                clReleaseMemObject(mem);
+                host = NULL;
+            }
+        }
+        pinned_host_allocation *p = NULL;
+        if (host) {
+            p = (pinned_host_allocation *)malloc(sizeof(pinned_host_allocation));
+            if (!p) {
+                clEnqueueUnmapMemObject(ctx.cmd_queue, mem, host, 0, NULL, NULL);
+                clReleaseMemObject(mem);
+                host = NULL;
+            }
+        }
+        if (host) {
+            debug(user_context) << host << "\n";
+            p->mem = mem;
+            p->host = host;
+            p->alloc = NULL;
+            p->size = size;
+            p->mapped = true;
+            p->next = pinned_host_allocations;
+            pinned_host_allocations = p;
+        } else {
+            // Fall back to ordinary host memory.
+            debug(user_context) << get_opencl_error_name(err) << "\n";
+        }
+    }
+    if (!host) {
+        return halide_default_device_and_host_malloc(user_context, buf, &opencl_device_interface);
+    }
+
+    buf->host = (uint8_t *)host;
+    int result = halide_opencl_device_malloc(user_context, buf);
+    if (result != 0) {
+        ClContext ctx(user_context);
+        release_pinned_host_allocation(user_context, ctx, host);
+        buf->host = NULL;
+    }
+    return result;
 }
 
 WEAK int halide_opencl_device_and_host_free(void *user_context, struct halide_buffer_t *buf) {
-    return halide_default_device_and_host_free(user_context, buf, &opencl_device_interface);
+    debug(user_context)
+        << "CL: halide_opencl_device_and_host_free (user_context: " << user_context
+        << ", buf: " << buf << ")\n";
+
+    int result = halide_opencl_device_free(user_context, buf);
+    bool pinned = false;
+    if (buf->host) {
+        ClContext ctx(user_context);
+        if (ctx.error != CL_SUCCESS) {
+            return ctx.error;
+        }
+        pinned = release_pinned_host_allocation(user_context, ctx, buf->host);
+    }
+    if (!pinned && buf->host) {
+        halide_free(user_context, buf->host);
+    }
+    buf->host = NULL;
+    buf->set_host_dirty(false);
+    buf->set_device_dirty(false);
+    return result;
 }
 
 WEAK int halide_opencl_wrap_cl_mem(void *user_context, struct halide_buffer_t *buf, uint64_t mem) {
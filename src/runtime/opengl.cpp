@@ -170,6 +170,22 @@ struct ModuleState {
     ModuleState *next;
 };
 
+// A texture allocated by halide_opengl_device_malloc. Textures freed
+// by halide_opengl_device_free are kept, up to a limit, and handed out
+// again to later allocations of the same size and format, so that
+// pipelines run repeatedly on frames of the same size don't allocate
+// textures in the steady state.
+struct TextureInfo {
+    GLuint id;
+    GLint width, height;
+    GLint internal_format, format, type;
+    bool in_use;
+    TextureInfo *next;
+};
+
+// The most freed textures to keep for reuse.
+#define MAX_POOLED_TEXTURES 16
+
 
 // All persistent state maintained by the runtime.
 struct GlobalState {
@@ -188,6 +204,12 @@ struct GlobalState {
 
     // Various objects shared by all filter kernels
     GLuint framebuffer_id;
+    // The texture known to be attached to framebuffer_id as a complete
+    // color attachment, if any.
+    GLuint framebuffer_texture;
+    // All textures allocated by the runtime, in use or pooled.
+    TextureInfo *textures;
+    int num_pooled_textures;
     GLuint vertex_array_object;
     GLuint vertex_buffer;
     GLuint element_buffer;
@@ -554,6 +576,9 @@ WEAK void GlobalState::init() {
     major_version = 2;
     minor_version = 0;
     framebuffer_id = 0;
+    framebuffer_texture = 0;
+    textures = NULL;
+    num_pooled_textures = 0;
     vertex_array_object = vertex_buffer = element_buffer = 0;
     have_vertex_array_objects = false;
     have_texture_rg = false;
@@ -730,6 +755,56 @@ WEAK int halide_opengl_init(void *user_context) {
     return 0;
 }
 
+WEAK TextureInfo *find_pooled_texture(GLint width, GLint height, GLint internal_format,
+                                      GLint format, GLint type) {
+    for (TextureInfo *info = global_state.textures; info; info = info->next) {
+        if (!info->in_use &&
+            info->width == width && info->height == height &&
+            info->internal_format == internal_format &&
+            info->format == format && info->type == type) {
+            return info;
+        }
+    }
+    return NULL;
+}
+
+// Only the attachment of textures the runtime allocated is
+// remembered, as the application could delete any of its own
+// textures and reuse the name.
+WEAK void remember_framebuffer_texture(GLuint tex) {
+    global_state.framebuffer_texture = 0;
+    for (TextureInfo *info = global_state.textures; info; info = info->next) {
+        if (info->id == tex) {
+            global_state.framebuffer_texture = tex;
+            return;
+        }
+    }
+}
+
+WEAK void delete_texture(GLuint tex) {
+    if (global_state.framebuffer_texture == tex) {
+        global_state.framebuffer_texture = 0;
+    }
+    global_state.DeleteTextures(1, &tex);
+}
+
+// Forget about all textures allocated by the runtime, deleting the
+// pooled ones if the context is still valid. Textures still in use
+// belong to their buffers, and are deleted by halide_opengl_device_free.
+WEAK void release_textures(bool delete_pooled) {
+    TextureInfo *info = global_state.textures;
+    while (info) {
+        TextureInfo *next = info->next;
+        if (delete_pooled && !info->in_use) {
+            delete_texture(info->id);
+        }
+        free(info);
+        info = next;
+    }
+    global_state.textures = NULL;
+    global_state.num_pooled_textures = 0;
+}
+
 // Release all data allocated by the runtime.
 //
 // The OpenGL context itself is generally managed by the host application, so
@@ -740,6 +815,7 @@ WEAK int halide_opengl_device_release(void *user_context) {
     }
 
     debug(user_context) << "halide_opengl_release\n";
+    release_textures(true);
     global_state.DeleteFramebuffers(1, &global_state.framebuffer_id);
 
     ModuleState *mod = state_list;
@@ -871,7 +947,7 @@ WEAK bool get_texture_dimensions(void *user_context, halide_buffer_t *buf, GLint
 }
 
 // Allocate a new texture matching the dimension and color format of the
-// specified buffer.
+// specified buffer, or reuse a pooled one.
 WEAK int halide_opengl_device_malloc(void *user_context, halide_buffer_t *buf) {
     if (int error = halide_opengl_init(user_context)) {
         return error;
@@ -916,29 +992,9 @@ WEAK int halide_opengl_device_malloc(void *user_context, halide_buffer_t *buf) {
             return 1;
         }
 
-        // Generate texture ID
-        global_state.GenTextures(1, &tex);
-        if (global_state.CheckAndReportError(user_context, "halide_opengl_device_malloc GenTextures")) {
-            global_state.DeleteTextures(1, &tex);
-            return 1;
-        }
-
-        // Set parameters for this texture: no interpolation and clamp to edges.
-        global_state.BindTexture(GL_TEXTURE_2D, tex);
-        global_state.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-        global_state.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-        global_state.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        global_state.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        if (global_state.CheckAndReportError(user_context, "halide_opengl_device_malloc binding texture")) {
-            global_state.DeleteTextures(1, &tex);
-            return 1;
-        }
-
-        // Create empty texture here and fill it with glTexSubImage2D later.
         GLint internal_format, format, type;
         if (!get_texture_format(user_context, buf, &internal_format, &format, &type)) {
             error(user_context) << "Invalid texture format";
-            global_state.DeleteTextures(1, &tex);
             return 1;
         }
 
@@ -948,26 +1004,70 @@ WEAK int halide_opengl_device_malloc(void *user_context, halide_buffer_t *buf) {
             return 1;
         }
 
-        global_state.TexImage2D(GL_TEXTURE_2D, 0, internal_format, width, height, 0, format, type, NULL);
-        if (global_state.CheckAndReportError(user_context, "halide_opengl_device_malloc TexImage2D")) {
-            global_state.DeleteTextures(1, &tex);
-            return 1;
+        TextureInfo *info = find_pooled_texture(width, height, internal_format, format, type);
+        if (info) {
+            info->in_use = true;
+            global_state.num_pooled_textures--;
+            tex = info->id;
+            debug(user_context) << "Reusing texture " << tex
+                                << " of size " << width << " x " << height << "\n";
+        } else {
+            // Generate texture ID
+            global_state.GenTextures(1, &tex);
+            if (global_state.CheckAndReportError(user_context, "halide_opengl_device_malloc GenTextures")) {
+                global_state.DeleteTextures(1, &tex);
+                return 1;
+            }
+
+            // Set parameters for this texture: no interpolation and clamp to edges.
+            global_state.BindTexture(GL_TEXTURE_2D, tex);
+            global_state.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            global_state.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            global_state.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            global_state.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            if (global_state.CheckAndReportError(user_context, "halide_opengl_device_malloc binding texture")) {
+                global_state.DeleteTextures(1, &tex);
+                return 1;
+            }
+
+            // Create empty texture here and fill it with glTexSubImage2D later.
+            global_state.TexImage2D(GL_TEXTURE_2D, 0, internal_format, width, height, 0, format, type, NULL);
+            if (global_state.CheckAndReportError(user_context, "halide_opengl_device_malloc TexImage2D")) {
+                global_state.DeleteTextures(1, &tex);
+                return 1;
+            }
+            global_state.BindTexture(GL_TEXTURE_2D, 0);
+
+            info = (TextureInfo *)malloc(sizeof(TextureInfo));
+            if (!info) {
+                error(user_context) << "halide_opengl_device_malloc: malloc failed";
+                global_state.DeleteTextures(1, &tex);
+                return 1;
+            }
+            info->id = tex;
+            info->width = width;
+            info->height = height;
+            info->internal_format = internal_format;
+            info->format = format;
+            info->type = type;
+            info->in_use = true;
+            info->next = global_state.textures;
+            global_state.textures = info;
+            debug(user_context) << "Allocated texture " << tex
+                                << " of size " << width << " x " << height << "\n";
         }
 
         buf->device = tex;
         buf->device_interface = &opengl_device_interface;
         buf->device_interface->impl->use_module();
         halide_allocated = true;
-        debug(user_context) << "Allocated texture " << tex
-                            << " of size " << width << " x " << height << "\n";
-
-        global_state.BindTexture(GL_TEXTURE_2D, 0);
     }
 
     return 0;
 }
 
-// Delete all texture information associated with a buffer.
+// Release the texture of a buffer, keeping it for reuse if the runtime
+// allocated it and the pool isn't full, and deleting it otherwise.
 WEAK int halide_opengl_device_free(void *user_context, halide_buffer_t *buf) {
     if (!global_state.initialized) {
         error(user_context) << "OpenGL runtime not initialized in call to halide_opengl_device_free.";
@@ -981,9 +1081,30 @@ WEAK int halide_opengl_device_free(void *user_context, halide_buffer_t *buf) {
     uint64_t handle = buf->device;
     GLuint tex = (handle == HALIDE_OPENGL_RENDER_TARGET) ? 0 : (GLuint)handle;
 
+    // If the runtime allocated this texture, keep it for reuse.
+    TextureInfo **prev = &global_state.textures;
+    TextureInfo *info = global_state.textures;
+    while (info && info->id != tex) {
+        prev = &info->next;
+        info = info->next;
+    }
+    if (info && info->in_use && global_state.num_pooled_textures < MAX_POOLED_TEXTURES) {
+        debug(user_context) << "halide_opengl_device_free: Pooling texture " << tex << "\n";
+        info->in_use = false;
+        global_state.num_pooled_textures++;
+        buf->device = 0;
+        buf->device_interface->impl->release_module();
+        buf->device_interface = NULL;
+        return 0;
+    }
+    if (info) {
+        *prev = info->next;
+        free(info);
+    }
+
     int result = 0;
     debug(user_context) << "halide_opengl_device_free: Deleting texture " << tex << "\n";
-    global_state.DeleteTextures(1, &tex);
+    delete_texture(tex);
     if (global_state.CheckAndReportError(user_context, "halide_opengl_device_free DeleteTextures")) {
         result = 1;
         // do not return: we want to zero out the interface and
@@ -1177,27 +1298,39 @@ WEAK int halide_opengl_copy_to_host(void *user_context, halide_buffer_t *buf) {
 
 
     uint64_t handle = buf->device;
+    GLuint tex = 0;
+    bool framebuffer_changed = true;
     if (handle != HALIDE_OPENGL_RENDER_TARGET) {
-        GLuint tex = (GLuint)handle;
+        tex = (GLuint)handle;
         debug(user_context) << "halide_copy_to_host: texture " << tex << "\n";
         global_state.BindFramebuffer(GL_FRAMEBUFFER, global_state.framebuffer_id);
         if (global_state.CheckAndReportError(user_context, "copy_to_host BindFramebuffer")) {
             return 1;
         }
-        global_state.FramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, tex, 0);
-        if (global_state.CheckAndReportError(user_context, "copy_to_host FramebufferTexture2D")) {
-            return 1;
+        // The texture the last kernel rendered to is usually still
+        // attached.
+        if (tex == global_state.framebuffer_texture) {
+            framebuffer_changed = false;
+        } else {
+            global_state.framebuffer_texture = 0;
+            global_state.FramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, tex, 0);
+            if (global_state.CheckAndReportError(user_context, "copy_to_host FramebufferTexture2D")) {
+                return 1;
+            }
         }
     } else {
         debug(user_context) << "halide_copy_to_host: HALIDE_OPENGL_RENDER_TARGET\n";
     }
 
-    // Check that framebuffer is set up correctly
-    GLenum status = global_state.CheckFramebufferStatus(GL_FRAMEBUFFER);
-    if (status != GL_FRAMEBUFFER_COMPLETE) {
-        error(user_context)
-            << "Setting up GL framebuffer " << global_state.framebuffer_id << " failed " << status;
-        return 1;
+    if (framebuffer_changed) {
+        // Check that framebuffer is set up correctly
+        GLenum status = global_state.CheckFramebufferStatus(GL_FRAMEBUFFER);
+        if (status != GL_FRAMEBUFFER_COMPLETE) {
+            error(user_context)
+                << "Setting up GL framebuffer " << global_state.framebuffer_id << " failed " << status;
+            return 1;
+        }
+        remember_framebuffer_texture(tex);
     }
 
     // The only format/type pairs guaranteed to be readable in GLES2 are GL_RGBA+GL_UNSIGNED_BYTE,
@@ -1558,6 +1691,10 @@ WEAK int halide_opengl_run(void *user_context,
     global_state.Disable(GL_DEPTH_TEST);
 
     GLint num_output_textures = 0;
+    // Whether the attachments of the framebuffer changed, and need
+    // checking for completeness.
+    bool framebuffer_changed = false;
+    GLuint framebuffer_texture = 0;
     kernel_arg = kernel->arguments;
     for (int i = 0; args[i]; i++, kernel_arg = kernel_arg->next) {
         if (kernel_arg->kind != Argument::Outbuf) continue;
@@ -1580,16 +1717,22 @@ WEAK int halide_opengl_run(void *user_context,
         }
         GLuint tex = (handle == HALIDE_OPENGL_RENDER_TARGET) ? 0 : (GLuint)handle;
 
-        // Check to see if the object name is actually a FBO
-        if (bind_render_targets) {
+        // Check to see if the object name is actually a FBO. Passes
+        // that render to the same texture as the previous one, or to
+        // a pooled texture that was attached before, reuse the
+        // attachment as it is.
+        if (bind_render_targets && tex != global_state.framebuffer_texture) {
             debug(user_context)
                 << "Output texture " << num_output_textures << ": " << tex << "\n";
+            global_state.framebuffer_texture = 0;
             global_state.FramebufferTexture2D(GL_FRAMEBUFFER,
                                     GL_COLOR_ATTACHMENT0 + num_output_textures,
                                     GL_TEXTURE_2D, tex, 0);
             if (global_state.CheckAndReportError(user_context, "halide_opengl_run FramebufferTexture2D")) {
                 return 1;
             }
+            framebuffer_changed = true;
+            framebuffer_texture = tex;
         }
 
         output_min[0] = buf->dim[0].min;
@@ -1625,7 +1768,7 @@ WEAK int halide_opengl_run(void *user_context,
         }
     }
 
-    if (bind_render_targets) {
+    if (bind_render_targets && framebuffer_changed) {
         // Check that framebuffer is set up correctly
         GLenum status = global_state.CheckFramebufferStatus(GL_FRAMEBUFFER);
         if (global_state.CheckAndReportError(user_context, "halide_opengl_run CheckFramebufferStatus")) {
@@ -1638,6 +1781,7 @@ WEAK int halide_opengl_run(void *user_context,
             // TODO: cleanup
             return 1;
         }
+        remember_framebuffer_texture(framebuffer_texture);
     }
 
     // Set vertex attributes
@@ -1965,6 +2109,8 @@ WEAK void halide_opengl_context_lost(void *user_context) {
         mod->kernel->program_id = 0;
     }
 
+    // The textures went with the context.
+    release_textures(false);
     global_state.init();
     return;
 }
@@ -0,0 +1,155 @@
+#include "HalideRuntime.h"
+#include "thread_pool_common.h"
+
+// A thread pool that runs parallel loops on the OpenMP runtime
+// instead of Halide's own worker threads, so that Halide shares
+// threads with the rest of an application that uses OpenMP. Selected
+// by the openmp target feature. It uses the entry points of the GNU
+// OpenMP runtime, which the LLVM and Intel OpenMP runtimes also
+// provide, so the application must be linked against one of them
+// (e.g. with -fopenmp). Everything other than halide_do_par_for,
+// including halide_do_fork and the semaphores, comes from the common
+// thread pool.
+
+extern "C" {
+
+extern void GOMP_parallel(void (*fn)(void *), void *data, unsigned num_threads, unsigned flags);
+extern int omp_get_max_threads();
+
+}
+
+namespace Halide { namespace Runtime { namespace Internal {
+
+struct openmp_job {
+    halide_task_t f;
+    void *user_context;
+    uint8_t *closure;
+    int min, size;
+    // The number of consecutive tasks each thread claims at once.
+    int grain;
+    // The offset of the next unclaimed task. Modified atomically.
+    int next;
+    int exit_status;
+};
+
+WEAK void openmp_worker(void *arg) {
+    openmp_job *job = (openmp_job *)arg;
+    while (true) {
+        int start = __sync_fetch_and_add(&job->next, job->grain);
+        if (start >= job->size) {
+            return;
+        }
+        int end = start + job->grain;
+        if (end > job->size) {
+            end = job->size;
+        }
+        for (int i = start; i < end; i++) {
+            int result = halide_do_task(job->user_context, job->f, job->min + i, job->closure);
+            if (result) {
+                __atomic_store_n(&job->exit_status, result, __ATOMIC_RELAXED);
+            }
+        }
+    }
+}
+
+}}}  // namespace Halide::Runtime::Internal
+
+using namespace Halide::Runtime::Internal;
+
+extern "C" {
+
+WEAK int halide_openmp_do_par_for(void *user_context, halide_task_t f,
+                                  int min, int size, uint8_t *closure) {
+    if (size <= 0) {
+        return 0;
+    }
+
+    int max_threads = 0;
+    halide_thread_priority_t priority = halide_thread_priority_normal;
+    halide_get_thread_budget(user_context, &max_threads, &priority);
+
+    // Use the number of threads set by halide_set_num_threads or
+    // HL_NUM_THREADS if there is one, and OpenMP's own default
+    // otherwise.
+    halide_mutex_lock(&work_queue.mutex);
+    int num_threads = work_queue.desired_num_threads;
+    if (!num_threads && (getenv("HL_NUM_THREADS") || getenv("HL_NUMTHREADS"))) {
+        num_threads = clamp_num_threads(default_desired_num_threads());
+    }
+    halide_mutex_unlock(&work_queue.mutex);
+    if (!num_threads) {
+        num_threads = omp_get_max_threads();
+    }
+    if (max_threads > 0 && num_threads > max_threads) {
+        num_threads = max_threads;
+    }
+    if (num_threads > size) {
+        num_threads = size;
+    }
+    if (num_threads < 1) {
+        num_threads = 1;
+    }
+
+    openmp_job job;
+    job.f = f;
+    job.user_context = user_context;
+    job.closure = closure;
+    job.min = min;
+    job.size = size;
+    // Aim for about four claims per thread, so that threads that
+    // finish early can pick up some of the slack, without every task
+    // being an atomic operation.
+    job.grain = size / (num_threads * 4);
+    if (job.grain < 1) {
+        job.grain = 1;
+    }
+    job.next = 0;
+    job.exit_status = 0;
+
+    if (num_threads == 1) {
+        openmp_worker(&job);
+    } else {
+        GOMP_parallel(openmp_worker, &job, num_threads, 0);
+    }
+    return job.exit_status;
+}
+
+namespace {
+__attribute__((destructor))
+WEAK void halide_thread_pool_cleanup() {
+    halide_shutdown_thread_pool();
+}
+}
+
+}  // extern "C"
+
+namespace Halide { namespace Runtime { namespace Internal {
+WEAK halide_do_task_t custom_do_task = halide_default_do_task;
+WEAK halide_do_par_for_t custom_do_par_for = halide_openmp_do_par_for;
+}}}
+
+extern "C" {
+
+WEAK halide_do_task_t halide_set_custom_do_task(halide_do_task_t f) {
+    halide_do_task_t result = custom_do_task;
+    custom_do_task = f;
+    return result;
+}
+
+WEAK halide_do_par_for_t halide_set_custom_do_par_for(halide_do_par_for_t f) {
+    halide_do_par_for_t result = custom_do_par_for;
+    custom_do_par_for = f;
+    return result;
+}
+
+WEAK int halide_do_task(void *user_context, halide_task_t f, int idx,
+                        uint8_t *closure) {
+    return (*custom_do_task)(user_context, f, idx, closure);
+}
+
+WEAK int halide_do_par_for(void *user_context, halide_task_t f,
+                           int min, int size, uint8_t *closure) {
+    return (*custom_do_par_for)(user_context, f, min, size, closure);
+}
+
+}  // extern "C"
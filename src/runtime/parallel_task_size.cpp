@@ -0,0 +1,114 @@
+#include "HalideRuntime.h"
+#include "runtime_internal.h"
+#include "printer.h"
+#include "scoped_mutex_lock.h"
+
+// Picks the number of iterations each task of a parallel loop
+// scheduled with TaskSize::Auto runs. Tasks should be large enough
+// that the cost of handing them out is small next to the work they
+// do, and small enough that there are several per thread to balance
+// the load. The first run of a loop goes by the cost of an iteration
+// estimated by the compiler. Each run is timed, and later runs go by
+// the time per iteration measured so far instead.
+
+namespace Halide { namespace Runtime { namespace Internal {
+
+struct parallel_task_size_state {
+    parallel_task_size_state *next;
+    char *name;
+    // The measured time per iteration in nanoseconds, as the time a
+    // single thread would take, or zero if the loop hasn't run yet.
+    int64_t cost;
+};
+
+WEAK parallel_task_size_state *parallel_task_size_states = NULL;
+WEAK halide_mutex parallel_task_size_lock = { { 0 } };
+
+// Tasks should take at least this long, so that handing them out to
+// the thread pool is cheap in comparison.
+WEAK int64_t min_task_time_ns = 20000;
+// Aim for at least this many tasks per thread when the tasks are
+// large enough, so that threads that finish early can pick up more.
+WEAK int tasks_per_thread = 8;
+
+// Must be called with the lock held.
+WEAK parallel_task_size_state *find_parallel_task_size_state(void *user_context, const char *name) {
+    for (parallel_task_size_state *s = parallel_task_size_states; s; s = s->next) {
+        if (strcmp(s->name, name) == 0) {
+            return s;
+        }
+    }
+    // Like the schedule variants, this lives as long as the process,
+    // so it comes from malloc rather than halide_malloc.
+    size_t name_size = strlen(name) + 1;
+    parallel_task_size_state *s = (parallel_task_size_state *)malloc(sizeof(parallel_task_size_state) + name_size);
+    if (!s) {
+        return NULL;
+    }
+    memset(s, 0, sizeof(parallel_task_size_state));
+    s->name = (char *)(s + 1);
+    memcpy(s->name, name, name_size);
+    s->next = parallel_task_size_states;
+    parallel_task_size_states = s;
+    halide_start_clock(user_context);
+    return s;
+}
+
+}}}  // namespace Halide::Runtime::Internal
+
+using namespace Halide::Runtime::Internal;
+
+extern "C" {
+
+WEAK int halide_parallel_task_size(void *user_context, const char *name, int extent,
+                                   int64_t cost, int min_size, int max_size) {
+    if (extent <= 1) {
+        return 1;
+    }
+    {
+        ScopedMutexLock lock(&parallel_task_size_lock);
+        parallel_task_size_state *s = find_parallel_task_size_state(user_context, name);
+        if (s && s->cost > 0) {
+            cost = s->cost;
+        }
+    }
+
+    int threads = max(thread_pool_num_threads(), 1);
+    int64_t size = extent / ((int64_t)threads * tasks_per_thread);
+    if (cost > 0) {
+        size = max(size, (min_task_time_ns + cost - 1) / cost);
+    }
+    // Never make fewer tasks than there are threads.
+    size = min(size, ((int64_t)extent + threads - 1) / threads);
+    if (max_size > 0) {
+        size = min(size, (int64_t)max_size);
+    }
+    size = max(size, (int64_t)max(min_size, 1));
+    return (int)min(size, (int64_t)extent);
+}
+
+WEAK int halide_parallel_task_size_feedback(void *user_context, const char *name, int extent,
+                                            int task_size, int64_t start_time) {
+    if (extent <= 0 || task_size <= 0) {
+        return 0;
+    }
+    int64_t elapsed = halide_current_time_ns(user_context) - start_time;
+    // The loop ran on at most as many threads as there were tasks.
+    int tasks = (extent + task_size - 1) / task_size;
+    int threads = min(max(thread_pool_num_threads(), 1), tasks);
+    int64_t cost = max(elapsed * threads / extent, (int64_t)1);
+
+    ScopedMutexLock lock(&parallel_task_size_lock);
+    parallel_task_size_state *s = find_parallel_task_size_state(user_context, name);
+    if (!s) {
+        return 0;
+    }
+    // Keep a running average, so that a single slow run (for example
+    // one that had to start the thread pool) doesn't skew it.
+    s->cost = s->cost > 0 ? (3 * s->cost + cost) / 4 : cost;
+    debug(user_context) << "Parallel loop " << name << " takes " << s->cost
+                        << " ns per iteration\n";
+    return 0;
+}
+
+}
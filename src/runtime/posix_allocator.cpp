@@ -1,12 +1,139 @@
 #include "HalideRuntime.h"
 #include "runtime_internal.h"
+#include "scoped_mutex_lock.h"
 
 extern "C" {
 
 extern void *malloc(size_t);
 extern void free(void *);
 
+}
+
+namespace Halide { namespace Runtime { namespace Internal {
+
+// A pool of freed allocations, kept in size classes so that blocks
+// can be handed out again to later requests of a similar size. There
+// are four classes per power of two, so at most 25% is wasted by
+// rounding up. Blocks carry the original pointer and their class in
+// the two words before the aligned pointer, and are linked through
+// their first word while in the pool.
+#define REUSE_ALLOCATIONS_MIN_SIZE ((size_t)4096)
+#define REUSE_ALLOCATIONS_NUM_CLASSES 256
+
+WEAK halide_mutex reuse_allocations_lock;
+WEAK void *reuse_allocations_free_lists[REUSE_ALLOCATIONS_NUM_CLASSES];
+WEAK size_t reuse_allocations_cached_bytes = 0;
+// Freed blocks are returned to the system instead of kept once the
+// pool holds this many bytes.
+WEAK size_t reuse_allocations_limit = 0;
+// -1 means not yet decided. Otherwise whether halide_default_malloc
+// and free go through the pool, fixed at the first allocation so
+// that blocks are always freed the way they were allocated.
+WEAK int reuse_allocations_by_default = -1;
+
+WEAK size_t reuse_allocations_class(size_t x, int *idx) {
+    if (x <= REUSE_ALLOCATIONS_MIN_SIZE) {
+        *idx = 0;
+        return REUSE_ALLOCATIONS_MIN_SIZE;
+    }
+    // 2^b < x <= 2^(b+1)
+    int b = 63 - __builtin_clzll((uint64_t)(x - 1));
+    size_t step = (size_t)1 << (b - 2);
+    size_t rounded = (x + step - 1) & ~(step - 1);
+    *idx = 1 + (b - 12) * 4 + (int)(rounded >> (b - 2)) - 5;
+    return rounded;
+}
+
+WEAK bool reuse_allocations_enabled() {
+    if (reuse_allocations_by_default < 0) {
+        const char *limit = getenv("HL_REUSE_ALLOCATIONS");
+        if (limit && atoi(limit) > 0) {
+            // The limit is in megabytes.
+            reuse_allocations_limit = (size_t)atoi(limit) << 20;
+            reuse_allocations_by_default = 1;
+        } else {
+            reuse_allocations_by_default = 0;
+        }
+    }
+    return reuse_allocations_by_default;
+}
+
+}}} // namespace Halide::Runtime::Internal
+
+extern "C" {
+
+WEAK void *halide_reuse_allocations_malloc(void *user_context, size_t x) {
+    using namespace Halide::Runtime::Internal;
+    int idx;
+    size_t size = reuse_allocations_class(x, &idx);
+    halide_assert(user_context, idx < REUSE_ALLOCATIONS_NUM_CLASSES);
+    {
+        ScopedMutexLock lock(&reuse_allocations_lock);
+        void *ptr = reuse_allocations_free_lists[idx];
+        if (ptr) {
+            reuse_allocations_free_lists[idx] = ((void **)ptr)[0];
+            reuse_allocations_cached_bytes -= size;
+            return ptr;
+        }
+    }
+    const size_t alignment = halide_malloc_alignment();
+    void *orig = malloc(size + alignment + sizeof(void *));
+    if (orig == NULL) {
+        // Will result in a failed assertion and a call to halide_error
+        return NULL;
+    }
+    void *ptr = (void *)(((size_t)orig + alignment + 2 * sizeof(void*) - 1) & ~(alignment - 1));
+    ((void **)ptr)[-1] = orig;
+    ((size_t *)ptr)[-2] = (size_t)idx;
+    return ptr;
+}
+
+WEAK void halide_reuse_allocations_free(void *user_context, void *ptr) {
+    using namespace Halide::Runtime::Internal;
+    int idx = (int)((size_t *)ptr)[-2];
+    size_t size = idx == 0 ? REUSE_ALLOCATIONS_MIN_SIZE : 0;
+    if (idx > 0) {
+        // Invert reuse_allocations_class.
+        int b = (idx - 1) / 4 + 12;
+        size = ((size_t)((idx - 1) % 4 + 5)) << (b - 2);
+    }
+    {
+        ScopedMutexLock lock(&reuse_allocations_lock);
+        if (reuse_allocations_cached_bytes + size <= reuse_allocations_limit) {
+            ((void **)ptr)[0] = reuse_allocations_free_lists[idx];
+            reuse_allocations_free_lists[idx] = ptr;
+            reuse_allocations_cached_bytes += size;
+            return;
+        }
+    }
+    free(((void**)ptr)[-1]);
+}
+
+WEAK void halide_reuse_allocations_set_limit(size_t bytes) {
+    using namespace Halide::Runtime::Internal;
+    ScopedMutexLock lock(&reuse_allocations_lock);
+    reuse_allocations_limit = bytes;
+}
+
+WEAK void halide_reuse_allocations_flush(void *user_context) {
+    using namespace Halide::Runtime::Internal;
+    ScopedMutexLock lock(&reuse_allocations_lock);
+    for (int i = 0; i < REUSE_ALLOCATIONS_NUM_CLASSES; i++) {
+        void *ptr = reuse_allocations_free_lists[i];
+        while (ptr) {
+            void *next = ((void **)ptr)[0];
+            free(((void**)ptr)[-1]);
+            ptr = next;
+        }
+        reuse_allocations_free_lists[i] = NULL;
+    }
+    reuse_allocations_cached_bytes = 0;
+}
+
 WEAK void *halide_default_malloc(void *user_context, size_t x) {
+    if (Halide::Runtime::Internal::reuse_allocations_enabled()) {
+        return halide_reuse_allocations_malloc(user_context, x);
+    }
     // Allocate enough space for aligning the pointer we return.
     const size_t alignment = halide_malloc_alignment();
     void *orig = malloc(x + alignment);
@@ -21,6 +148,10 @@ WEAK void *halide_default_malloc(void *user_context, size_t x) {
 }
 
 WEAK void halide_default_free(void *user_context, void *ptr) {
+    if (Halide::Runtime::Internal::reuse_allocations_by_default == 1) {
+        halide_reuse_allocations_free(user_context, ptr);
+        return;
+    }
     free(((void**)ptr)[-1]);
 }
 
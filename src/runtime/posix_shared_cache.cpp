@@ -0,0 +1,653 @@
+#include "HalideRuntime.h"
+#include "printer.h"
+#include "scoped_mutex_lock.h"
+
+// An implementation of the halide_memoization_cache_* interface that
+// keeps the cached data in a memory-mapped file, so that it is shared
+// by every process that uses the same file, and survives the
+// processes that computed it. It's used in place of cache.cpp when
+// the target has the shared_memoization_cache feature.
+//
+// The file is named by the HL_MEMOIZATION_CACHE_FILE environment
+// variable (by default /tmp/halide_memoization_cache). It is created
+// on first use with room for the cache budget, which can be set with
+// halide_memoization_cache_set_size or HL_MEMOIZATION_CACHE_SIZE
+// before the first lookup. An existing file keeps its size.
+//
+// Accesses are serialized across processes with flock on the file,
+// and within a process with a mutex. Nothing in the file points into
+// the address space of a process: lookups copy the cached data out
+// into memory owned by the caller, and stores copy it in. Entries
+// are evicted least recently used first. If a process dies while
+// modifying the cache, the next process to lock it finds it marked
+// dirty and empties it.
+
+extern "C" {
+
+extern void *mmap(void *addr, size_t length, int prot, int flags, int fd, long offset);
+extern int munmap(void *addr, size_t length);
+extern int ftruncate(int fd, long length);
+extern long lseek(int fd, long offset, int whence);
+extern int flock(int fd, int operation);
+extern void *memmove(void *dst, const void *src, size_t n);
+
+}
+
+namespace Halide { namespace Runtime { namespace Internal { namespace SharedCache {
+
+// These have the same values on Linux, Android and OS X.
+const int kProtRead = 1;
+const int kProtWrite = 2;
+const int kMapShared = 1;
+const int kSeekEnd = 2;
+const int kLockExclusive = 2;
+const int kLockUnlock = 8;
+
+// "HLCACHE" and a version number.
+const uint64_t kMagic = UINT64_C(0x484c434143484501);
+const uint32_t kMaxEntries = 4096;
+const int64_t kDefaultCacheSize = 64 << 20;
+
+struct Entry {
+    uint64_t hash;
+    // The location of the record in the data region.
+    uint64_t offset, bytes;
+    // The value of the use counter when the entry was last looked
+    // up or stored.
+    uint64_t last_used;
+};
+
+// The start of the file.
+struct Header {
+    uint64_t magic;
+    uint64_t file_size;
+    uint64_t data_offset, data_capacity;
+    // The end of the last record in the data region. Records are
+    // compacted when there's no room after it.
+    uint64_t data_used;
+    // The total size of the records, and the maximum it may reach.
+    uint64_t live_bytes, budget;
+    uint64_t use_counter;
+    uint64_t hits, misses, evictions;
+    // Set while the entries or records are being modified.
+    uint32_t dirty;
+    uint32_t num_entries;
+    Entry entries[kMaxEntries];
+};
+
+// Each cache entry is a record in the data region made of this
+// struct, followed by the key, the computed bounds, and then the
+// shape, the size, and the contents of each tuple element. Every
+// part starts on an 8-byte boundary.
+struct Record {
+    uint32_t key_size;
+    // The length of the name at the start of the key.
+    uint32_t name_size;
+    int32_t tuple_count;
+    int32_t dimensions;
+};
+
+// Hit, miss and eviction counts for one memoized Func, kept by each
+// process for the operations it does.
+struct FuncCacheStats {
+    FuncCacheStats *next;
+    char *name;
+    uint64_t hits, misses, evictions;
+};
+
+WEAK halide_mutex lock;
+WEAK void *file = NULL;
+WEAK int fd = -1;
+WEAK Header *header = NULL;
+WEAK bool attach_failed = false;
+// The budget to use for a new file, or zero for the default.
+WEAK int64_t requested_size = 0;
+WEAK FuncCacheStats *func_stats = NULL;
+
+WEAK __attribute__((always_inline)) uint64_t round_up(uint64_t x) {
+    return (x + 7) & ~(uint64_t)7;
+}
+
+WEAK uint8_t *data() {
+    return (uint8_t *)header + header->data_offset;
+}
+
+WEAK Record *record(const Entry &e) {
+    return (Record *)(data() + e.offset);
+}
+
+WEAK uint8_t *record_key(Record *r) {
+    return (uint8_t *)r + sizeof(Record);
+}
+
+WEAK halide_dimension_t *record_bounds(Record *r) {
+    return (halide_dimension_t *)(record_key(r) + round_up(r->key_size));
+}
+
+WEAK uint8_t *first_tuple(Record *r) {
+    return (uint8_t *)(record_bounds(r) + r->dimensions);
+}
+
+WEAK uint64_t tuple_bytes(Record *r, uint8_t *t) {
+    uint64_t bytes;
+    memcpy(&bytes, t + r->dimensions * sizeof(halide_dimension_t), sizeof(bytes));
+    return bytes;
+}
+
+WEAK uint8_t *tuple_contents(Record *r, uint8_t *t) {
+    return t + r->dimensions * sizeof(halide_dimension_t) + sizeof(uint64_t);
+}
+
+WEAK uint8_t *next_tuple(Record *r, uint8_t *t) {
+    return tuple_contents(r, t) + round_up(tuple_bytes(r, t));
+}
+
+WEAK uint64_t record_size(size_t key_size, int32_t dimensions,
+                          int32_t tuple_count, halide_buffer_t **tuple_buffers) {
+    uint64_t size = sizeof(Record) + round_up(key_size) + dimensions * sizeof(halide_dimension_t);
+    for (int32_t i = 0; i < tuple_count; i++) {
+        size += dimensions * sizeof(halide_dimension_t) + sizeof(uint64_t);
+        size += round_up(tuple_buffers[i]->size_in_bytes());
+    }
+    return size;
+}
+
+WEAK bool buffer_has_shape(const halide_buffer_t *buf, const halide_dimension_t *shape) {
+    for (int i = 0; i < buf->dimensions; i++) {
+        if (buf->dim[i] != shape[i]) return false;
+    }
+    return true;
+}
+
+// The same hash as cache.cpp uses.
+WEAK uint64_t key_hash(const uint8_t *key, size_t key_size) {
+    const uint64_t m = UINT64_C(0xc6a4a7935bd1e995);
+    const int r = 47;
+    uint64_t h = UINT64_C(0x8445d61a4e774912) ^ (key_size * m);
+    size_t words = key_size / 8;
+    for (size_t i = 0; i < words; i++) {
+        uint64_t k;
+        memcpy(&k, key + i * 8, 8);
+        k *= m;
+        k ^= k >> r;
+        k *= m;
+        h ^= k;
+        h *= m;
+    }
+    size_t tail = key_size & 7;
+    if (tail) {
+        uint64_t k = 0;
+        memcpy(&k, key + words * 8, tail);
+        h ^= k;
+        h *= m;
+    }
+    h ^= h >> r;
+    h *= m;
+    h ^= h >> r;
+    return h;
+}
+
+// A cache key in a form that means the same thing in every
+// process. The key made by the pipeline starts with a pointer to a
+// string naming the pipeline and the Func, so that is replaced by the
+// string itself.
+struct CanonicalKey {
+    uint8_t *key;
+    size_t size, name_size;
+    // The name in this process.
+    const char *name;
+
+    bool init(void *user_context, const uint8_t *cache_key, int32_t cache_key_size) {
+        name = NULL;
+        name_size = 0;
+        if (cache_key_size >= (int32_t)sizeof(const char *)) {
+            memcpy(&name, cache_key, sizeof(name));
+            name_size = strlen(name);
+            cache_key += sizeof(name);
+            cache_key_size -= sizeof(name);
+        }
+        size = name_size + cache_key_size;
+        key = (uint8_t *)halide_malloc(user_context, size ? size : 1);
+        if (!key) {
+            return false;
+        }
+        memcpy(key, name, name_size);
+        memcpy(key + name_size, cache_key, cache_key_size);
+        return true;
+    }
+};
+
+// Find the statistics for a Func, making them if create is true.
+// Called with the process lock held.
+WEAK FuncCacheStats *find_func_stats(const char *name, bool create) {
+    if (name == NULL) {
+        return NULL;
+    }
+    for (FuncCacheStats *stats = func_stats; stats != NULL; stats = stats->next) {
+        if (strcmp(stats->name, name) == 0) {
+            return stats;
+        }
+    }
+    if (!create) {
+        return NULL;
+    }
+    FuncCacheStats *stats = (FuncCacheStats *)malloc(sizeof(FuncCacheStats));
+    if (!stats) {
+        return NULL;
+    }
+    size_t len = strlen(name);
+    stats->name = (char *)malloc(len + 1);
+    if (!stats->name) {
+        free(stats);
+        return NULL;
+    }
+    memcpy(stats->name, name, len + 1);
+    stats->hits = stats->misses = stats->evictions = 0;
+    stats->next = func_stats;
+    func_stats = stats;
+    return stats;
+}
+
+// Empty the cache. Called with the lock held.
+WEAK void reset() {
+    header->dirty = 1;
+    header->num_entries = 0;
+    header->data_used = 0;
+    header->live_bytes = 0;
+    header->dirty = 0;
+}
+
+WEAK int64_t default_cache_size() {
+    if (requested_size > 0) {
+        return requested_size;
+    }
+    const char *str = getenv("HL_MEMOIZATION_CACHE_SIZE");
+    if (str) {
+        int64_t size = atoi(str);
+        if (size > 0) {
+            return size;
+        }
+    }
+    return kDefaultCacheSize;
+}
+
+// Open and map the file, creating it if it doesn't exist or isn't a
+// cache. Called with the process lock held.
+WEAK bool attach(void *user_context) {
+    if (header != NULL) {
+        return true;
+    }
+    if (attach_failed) {
+        return false;
+    }
+    attach_failed = true;
+
+    const char *path = getenv("HL_MEMOIZATION_CACHE_FILE");
+    if (path == NULL) {
+        path = "/tmp/halide_memoization_cache";
+    }
+    // Use fopen rather than open, because the flags passed to open
+    // differ between platforms.
+    file = fopen(path, "a+");
+    if (file == NULL) {
+        debug(user_context) << "Could not open memoization cache file " << path << "\n";
+        return false;
+    }
+    fd = fileno(file);
+    flock(fd, kLockExclusive);
+
+    long size = lseek(fd, 0, kSeekEnd);
+    void *mapping = (void *)-1;
+    if (size >= (long)sizeof(Header)) {
+        mapping = mmap(NULL, size, kProtRead | kProtWrite, kMapShared, fd, 0);
+        if (mapping != (void *)-1 &&
+            (((Header *)mapping)->magic != kMagic ||
+             ((Header *)mapping)->file_size != (uint64_t)size)) {
+            munmap(mapping, size);
+            mapping = (void *)-1;
+        }
+    }
+    if (mapping == (void *)-1) {
+        // Make a new cache.
+        uint64_t data_offset = round_up(sizeof(Header));
+        uint64_t budget = (uint64_t)default_cache_size();
+        size = (long)(data_offset + budget);
+        if (ftruncate(fd, size) == 0) {
+            mapping = mmap(NULL, size, kProtRead | kProtWrite, kMapShared, fd, 0);
+        }
+        if (mapping != (void *)-1) {
+            Header *h = (Header *)mapping;
+            memset(h, 0, sizeof(Header));
+            h->file_size = size;
+            h->data_offset = data_offset;
+            h->data_capacity = budget;
+            h->budget = budget;
+            h->magic = kMagic;
+        }
+    }
+
+    flock(fd, kLockUnlock);
+    if (mapping == (void *)-1) {
+        debug(user_context) << "Could not map memoization cache file " << path << "\n";
+        fclose(file);
+        file = NULL;
+        fd = -1;
+        return false;
+    }
+    header = (Header *)mapping;
+    attach_failed = false;
+    return true;
+}
+
+// Takes the process lock, attaches to the cache, and takes the file
+// lock. If attaching fails, the cache is skipped.
+struct ScopedCacheLock {
+    bool attached;
+
+    ScopedCacheLock(void *user_context) {
+        halide_mutex_lock(&lock);
+        attached = attach(user_context);
+        if (attached) {
+            flock(fd, kLockExclusive);
+            if (header->dirty) {
+                // A process died while modifying the cache.
+                reset();
+            }
+        }
+    }
+
+    ~ScopedCacheLock() {
+        if (attached) {
+            flock(fd, kLockUnlock);
+        }
+        halide_mutex_unlock(&lock);
+    }
+};
+
+// The index of the entry for a key, or -1. Called with the lock held.
+WEAK int find_entry(const CanonicalKey &key, uint64_t h,
+                    const halide_buffer_t *computed_bounds,
+                    int32_t tuple_count, halide_buffer_t **tuple_buffers) {
+    for (uint32_t i = 0; i < header->num_entries; i++) {
+        const Entry &e = header->entries[i];
+        if (e.hash != h) {
+            continue;
+        }
+        Record *r = record(e);
+        if (r->key_size != key.size ||
+            r->tuple_count != tuple_count ||
+            r->dimensions != computed_bounds->dimensions ||
+            memcmp(record_key(r), key.key, key.size) != 0 ||
+            !buffer_has_shape(computed_bounds, record_bounds(r))) {
+            continue;
+        }
+        bool all_bounds_equal = true;
+        uint8_t *t = first_tuple(r);
+        for (int32_t j = 0; all_bounds_equal && j < tuple_count; j++) {
+            all_bounds_equal = buffer_has_shape(tuple_buffers[j], (halide_dimension_t *)t);
+            t = next_tuple(r, t);
+        }
+        if (all_bounds_equal) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+// Called with the lock held, and the cache marked dirty.
+WEAK void evict_entry(uint32_t i) {
+    Entry &e = header->entries[i];
+    Record *r = record(e);
+    char *name = (char *)malloc(r->name_size + 1);
+    if (name) {
+        memcpy(name, record_key(r), r->name_size);
+        name[r->name_size] = 0;
+        FuncCacheStats *stats = find_func_stats(name, false);
+        if (stats) {
+            stats->evictions++;
+        }
+        free(name);
+    }
+    header->live_bytes -= e.bytes;
+    header->evictions++;
+    header->entries[i] = header->entries[--header->num_entries];
+}
+
+// Evict the least recently used entries until the live records fit
+// in the budget with bytes to spare. Called with the lock held, and
+// the cache marked dirty.
+WEAK void evict_until(uint64_t bytes) {
+    while (header->num_entries > 0 &&
+           (header->live_bytes + bytes > header->budget ||
+            header->num_entries == kMaxEntries)) {
+        uint32_t victim = 0;
+        for (uint32_t i = 1; i < header->num_entries; i++) {
+            if (header->entries[i].last_used < header->entries[victim].last_used) {
+                victim = i;
+            }
+        }
+        evict_entry(victim);
+    }
+}
+
+// Move the records to the start of the data region. Called with the
+// lock held, and the cache marked dirty.
+WEAK void compact() {
+    Entry *entries = header->entries;
+    for (uint32_t i = 1; i < header->num_entries; i++) {
+        Entry e = entries[i];
+        uint32_t j = i;
+        while (j > 0 && entries[j - 1].offset > e.offset) {
+            entries[j] = entries[j - 1];
+            j--;
+        }
+        entries[j] = e;
+    }
+    uint64_t cursor = 0;
+    for (uint32_t i = 0; i < header->num_entries; i++) {
+        if (entries[i].offset != cursor) {
+            memmove(data() + cursor, data() + entries[i].offset, entries[i].bytes);
+            entries[i].offset = cursor;
+        }
+        cursor += entries[i].bytes;
+    }
+    header->data_used = cursor;
+}
+
+}}}} // namespace Halide::Runtime::Internal::SharedCache
+
+using namespace Halide::Runtime::Internal::SharedCache;
+
+extern "C" {
+
+WEAK void halide_memoization_cache_set_size(int64_t size) {
+    if (size == 0) {
+        requested_size = 0;
+        size = default_cache_size();
+    } else {
+        requested_size = size;
+    }
+
+    ScopedCacheLock l(NULL);
+    if (l.attached) {
+        header->dirty = 1;
+        header->budget = (uint64_t)size < header->data_capacity ? size : header->data_capacity;
+        evict_until(0);
+        header->dirty = 0;
+    }
+}
+
+WEAK int halide_memoization_cache_lookup(void *user_context, const uint8_t *cache_key, int32_t size,
+                                         halide_buffer_t *computed_bounds, int32_t tuple_count, halide_buffer_t **tuple_buffers) {
+    CanonicalKey key;
+    if (!key.init(user_context, cache_key, size)) {
+        return -1;
+    }
+    uint64_t h = key_hash(key.key, key.size);
+
+    for (int32_t i = 0; i < tuple_count; i++) {
+        halide_buffer_t *buf = tuple_buffers[i];
+        buf->host = (uint8_t *)halide_malloc(user_context, buf->size_in_bytes());
+        if (buf->host == NULL) {
+            for (int32_t j = i; j > 0; j--) {
+                halide_free(user_context, tuple_buffers[j - 1]->host);
+                tuple_buffers[j - 1]->host = NULL;
+            }
+            halide_free(user_context, key.key);
+            return -1;
+        }
+    }
+
+    int result = 1;
+    {
+        ScopedCacheLock l(user_context);
+        FuncCacheStats *stats = find_func_stats(key.name, true);
+        int i = l.attached ? find_entry(key, h, computed_bounds, tuple_count, tuple_buffers) : -1;
+        if (i >= 0) {
+            Entry &e = header->entries[i];
+            Record *r = record(e);
+            uint8_t *t = first_tuple(r);
+            for (int32_t j = 0; j < tuple_count; j++) {
+                memcpy(tuple_buffers[j]->host, tuple_contents(r, t), tuple_bytes(r, t));
+                t = next_tuple(r, t);
+            }
+            e.last_used = ++header->use_counter;
+            header->hits++;
+            if (stats) {
+                stats->hits++;
+            }
+            result = 0;
+        } else {
+            if (l.attached) {
+                header->misses++;
+            }
+            if (stats) {
+                stats->misses++;
+            }
+        }
+    }
+
+    halide_free(user_context, key.key);
+    return result;
+}
+
+WEAK int halide_memoization_cache_store(void *user_context, const uint8_t *cache_key, int32_t size,
+                                        halide_buffer_t *computed_bounds,
+                                        int32_t tuple_count, halide_buffer_t **tuple_buffers) {
+    debug(user_context) << "halide_memoization_cache_store\n";
+
+    CanonicalKey key;
+    if (!key.init(user_context, cache_key, size)) {
+        return 0;
+    }
+    uint64_t h = key_hash(key.key, key.size);
+    const int32_t dimensions = computed_bounds->dimensions;
+    uint64_t bytes = record_size(key.size, dimensions, tuple_count, tuple_buffers);
+
+    {
+        ScopedCacheLock l(user_context);
+        if (l.attached &&
+            bytes <= header->budget &&
+            find_entry(key, h, computed_bounds, tuple_count, tuple_buffers) < 0) {
+            header->dirty = 1;
+
+            evict_until(bytes);
+            if (header->data_used + bytes > header->data_capacity) {
+                compact();
+            }
+
+            Entry &e = header->entries[header->num_entries];
+            e.hash = h;
+            e.offset = header->data_used;
+            e.bytes = bytes;
+            e.last_used = ++header->use_counter;
+
+            Record *r = record(e);
+            r->key_size = key.size;
+            r->name_size = key.name_size;
+            r->tuple_count = tuple_count;
+            r->dimensions = dimensions;
+            memcpy(record_key(r), key.key, key.size);
+            for (int i = 0; i < dimensions; i++) {
+                record_bounds(r)[i] = computed_bounds->dim[i];
+            }
+            uint8_t *t = first_tuple(r);
+            for (int32_t j = 0; j < tuple_count; j++) {
+                halide_buffer_t *buf = tuple_buffers[j];
+                for (int i = 0; i < dimensions; i++) {
+                    ((halide_dimension_t *)t)[i] = buf->dim[i];
+                }
+                uint64_t n = buf->size_in_bytes();
+                memcpy(t + dimensions * sizeof(halide_dimension_t), &n, sizeof(n));
+                memcpy(tuple_contents(r, t), buf->host, n);
+                t = next_tuple(r, t);
+            }
+
+            header->num_entries++;
+            header->data_used += bytes;
+            header->live_bytes += bytes;
+            header->dirty = 0;
+        }
+    }
+
+    halide_free(user_context, key.key);
+    debug(user_context) << "Exiting halide_memoization_cache_store\n";
+    return 0;
+}
+
+WEAK void halide_memoization_cache_release(void *user_context, void *host) {
+    // Lookups always return memory owned by the caller.
+    halide_free(user_context, host);
+}
+
+WEAK void halide_memoization_cache_cleanup() {
+    debug(NULL) << "halide_memoization_cache_cleanup\n";
+    halide_mutex_lock(&lock);
+    if (header != NULL) {
+        munmap(header, header->file_size);
+        header = NULL;
+    }
+    if (file != NULL) {
+        fclose(file);
+        file = NULL;
+        fd = -1;
+    }
+    attach_failed = false;
+
+    FuncCacheStats *stats = func_stats;
+    func_stats = NULL;
+    while (stats != NULL) {
+        FuncCacheStats *next = stats->next;
+        free(stats->name);
+        free(stats);
+        stats = next;
+    }
+    halide_mutex_unlock(&lock);
+    halide_mutex_destroy(&lock);
+}
+
+WEAK int halide_memoization_cache_get_stats(halide_memoization_cache_stats_t *stats, int max_stats) {
+    ScopedMutexLock l(&lock);
+    int count = 0;
+    for (FuncCacheStats *s = func_stats; s != NULL; s = s->next) {
+        if (count < max_stats) {
+            stats[count].name = s->name;
+            stats[count].hits = s->hits;
+            stats[count].misses = s->misses;
+            stats[count].evictions = s->evictions;
+        }
+        count++;
+    }
+    return count;
+}
+
+namespace {
+
+__attribute__((destructor))
+WEAK void halide_shared_cache_cleanup() {
+    halide_memoization_cache_cleanup();
+}
+
+}
+
+}
@@ -28,6 +28,8 @@ extern int pthread_mutex_init(halide_mutex *mutex, const void *attr);
 extern int pthread_mutex_lock(halide_mutex *mutex);
 extern int pthread_mutex_unlock(halide_mutex *mutex);
 extern int pthread_mutex_destroy(halide_mutex *mutex);
+extern int sched_setaffinity(int pid, size_t cpusetsize, const void *mask);
+extern size_t fread(void *ptr, size_t size, size_t nmemb, void *stream);
 
 } // extern "C"
 
@@ -42,6 +44,60 @@ WEAK void *spawn_thread_helper(void *arg) {
     t->f(t->closure);
     return NULL;
 }
+
+// Large enough for a cpu_set_t covering 1024 cpus.
+#define CPU_SET_WORDS 16
+
+WEAK int get_numa_node_cpus(int node, int *cpus, int max_cpus) {
+    // The cpus belonging to each node are listed in sysfs as ranges,
+    // e.g. "0-11,24-35".
+    char path[64];
+    char *dst = halide_string_to_string(path, path + sizeof(path), "/sys/devices/system/node/node");
+    dst = halide_int64_to_string(dst, path + sizeof(path), node, 1);
+    halide_string_to_string(dst, path + sizeof(path), "/cpulist");
+    void *f = fopen(path, "r");
+    if (!f) {
+        return -1;
+    }
+    char buf[1024];
+    size_t len = fread(buf, 1, sizeof(buf) - 1, f);
+    fclose(f);
+    buf[len] = 0;
+
+    int count = 0;
+    const char *p = buf;
+    while (*p >= '0' && *p <= '9') {
+        int first = atoi(p), last = first;
+        while (*p >= '0' && *p <= '9') p++;
+        if (*p == '-') {
+            p++;
+            last = atoi(p);
+            while (*p >= '0' && *p <= '9') p++;
+        }
+        for (int cpu = first; cpu <= last && count < max_cpus; cpu++) {
+            cpus[count++] = cpu;
+        }
+        if (*p == ',') {
+            p++;
+        }
+    }
+    return count;
+}
+
+WEAK bool pin_current_thread_to_cpu(int cpu) {
+    if (cpu < 0 || cpu >= CPU_SET_WORDS * 64) {
+        return false;
+    }
+    uint64_t mask[CPU_SET_WORDS];
+    memset(mask, 0, sizeof(mask));
+    mask[cpu / 64] = (uint64_t)1 << (cpu % 64);
+    return sched_setaffinity(0, sizeof(mask), mask) == 0;
+}
+
+// Tasks don't keep anything between them here.
+WEAK void release_task_resources() {
+}
+
 }}} // namespace Halide::Runtime::Internal
 
 extern "C" {
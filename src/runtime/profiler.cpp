@@ -16,6 +16,78 @@ WEAK halide_profiler_state *halide_profiler_get_state() {
 
 namespace Halide { namespace Runtime { namespace Internal {
 
+// A binary log of heap allocations and frees, written to the file
+// named by HL_PROFILER_ALLOC_LOG. It is a sequence of
+// alloc_log_records. Name records are followed by the name, padded
+// with nulls to a multiple of eight bytes. util/HalideAllocReport.cpp
+// reads the log.
+enum alloc_log_event {
+    alloc_log_name = 0,
+    alloc_log_allocate = 1,
+    alloc_log_free = 2
+};
+
+struct alloc_log_record {
+    uint32_t event;
+    // A func id that is unique across pipelines.
+    int32_t func_id;
+    uint64_t time_ns;
+    // The size of the allocation in bytes, or the length of the name
+    // for name records.
+    uint64_t size;
+};
+
+WEAK void *alloc_log_file = NULL;
+WEAK int alloc_log_fd = -1;
+WEAK bool alloc_log_initialized = false;
+WEAK halide_mutex alloc_log_lock;
+
+// Called with the profiler state lock held, so the log can't be
+// opened twice.
+WEAK void init_alloc_log() {
+    if (alloc_log_initialized) return;
+    const char *name = getenv("HL_PROFILER_ALLOC_LOG");
+    if (name) {
+        alloc_log_file = fopen(name, "wb");
+        if (alloc_log_file) {
+            alloc_log_fd = fileno(alloc_log_file);
+        } else {
+            halide_print(NULL, "Could not open the file named by HL_PROFILER_ALLOC_LOG\n");
+        }
+    }
+    alloc_log_initialized = true;
+}
+
+// Record the names of a pipeline's funcs as "pipeline/func".
+WEAK void log_func_names(halide_profiler_pipeline_stats *p) {
+    ScopedMutexLock lock(&alloc_log_lock);
+    size_t pipeline_len = strlen(p->name);
+    for (int i = 0; i < p->num_funcs; i++) {
+        size_t func_len = strlen(p->funcs[i].name);
+        alloc_log_record r;
+        r.event = alloc_log_name;
+        r.func_id = p->first_func_id + i;
+        r.time_ns = 0;
+        r.size = pipeline_len + 1 + func_len;
+        write(alloc_log_fd, &r, sizeof(r));
+        write(alloc_log_fd, p->name, pipeline_len);
+        write(alloc_log_fd, "/", 1);
+        write(alloc_log_fd, p->funcs[i].name, func_len);
+        const uint64_t zero = 0;
+        write(alloc_log_fd, &zero, (8 - (r.size & 7)) & 7);
+    }
+}
+
+WEAK void log_alloc_event(alloc_log_event event, int func_id, uint64_t size) {
+    alloc_log_record r;
+    r.event = event;
+    r.func_id = func_id;
+    r.time_ns = halide_current_time_ns(NULL);
+    r.size = size;
+    ScopedMutexLock lock(&alloc_log_lock);
+    write(alloc_log_fd, &r, sizeof(r));
+}
+
 WEAK halide_profiler_pipeline_stats *find_or_create_pipeline(const char *pipeline_name, int num_funcs, const uint64_t *func_names) {
     halide_profiler_state *s = halide_profiler_get_state();
 
@@ -36,6 +108,8 @@ WEAK halide_profiler_pipeline_stats *find_or_create_pipeline(const char *pipelin
     p->name = pipeline_name;
     p->first_func_id = s->first_free_id;
     p->num_funcs = num_funcs;
+    p->branches = NULL;
+    p->num_branches = 0;
     p->runs = 0;
     p->time = 0;
     p->samples = 0;
@@ -45,6 +119,9 @@ WEAK halide_profiler_pipeline_stats *find_or_create_pipeline(const char *pipelin
     p->num_allocs = 0;
     p->active_threads_numerator = 0;
     p->active_threads_denominator = 0;
+    for (int j = 0; j < halide_profiler_num_counters; j++) {
+        p->counters[j] = 0;
+    }
     p->funcs = (halide_profiler_func_stats *)malloc(num_funcs * sizeof(halide_profiler_func_stats));
     if (!p->funcs) {
         free(p);
@@ -60,9 +137,17 @@ WEAK halide_profiler_pipeline_stats *find_or_create_pipeline(const char *pipelin
         p->funcs[i].stack_peak = 0;
         p->funcs[i].active_threads_numerator = 0;
         p->funcs[i].active_threads_denominator = 0;
+        for (int j = 0; j < halide_profiler_num_counters; j++) {
+            p->funcs[i].counters[j] = 0;
+        }
     }
     s->first_free_id += num_funcs;
     s->pipelines = p;
+
+    init_alloc_log();
+    if (alloc_log_fd >= 0) {
+        log_func_names(p);
+    }
     return p;
 }
 
@@ -92,40 +177,153 @@ WEAK void bill_func(halide_profiler_state *s, int func_id, uint64_t time, int ac
     // Someone must have called reset_state while a kernel was running. Do nothing.
 }
 
+WEAK void bill_func_counters(halide_profiler_state *s, int func_id, const uint64_t *counters) {
+    for (halide_profiler_pipeline_stats *p = s->pipelines; p;
+         p = (halide_profiler_pipeline_stats *)(p->next)) {
+        if (func_id >= p->first_func_id && func_id < p->first_func_id + p->num_funcs) {
+            halide_profiler_func_stats *f = p->funcs + func_id - p->first_func_id;
+            for (int i = 0; i < halide_profiler_num_counters; i++) {
+                f->counters[i] += counters[i];
+                p->counters[i] += counters[i];
+            }
+            return;
+        }
+    }
+}
+
+// The counter values seen at the last sample for each thread that
+// has claimed a slot. Only the sampling thread touches these.
+struct thread_counter_state {
+    int thread_id;
+    uint64_t sample;
+    uint64_t values[halide_profiler_num_counters];
+};
+
+WEAK thread_counter_state counter_threads[HALIDE_PROFILER_MAX_THREAD_SLOTS];
+WEAK int num_counter_threads = 0;
+WEAK uint64_t counter_sample = 0;
+
+// Bill the counter increments since the last sample on each thread to
+// the func that thread is running now, the same way time is billed.
+WEAK void bill_thread_counters(halide_profiler_state *s) {
+    counter_sample++;
+    for (int i = 0; i < HALIDE_PROFILER_MAX_THREAD_SLOTS; i++) {
+        int func = s->thread_funcs[i];
+        int thread_id = s->thread_ids[i];
+        if (func < 0 || thread_id == 0) continue;
+
+        thread_counter_state *t = NULL;
+        for (int j = 0; j < num_counter_threads; j++) {
+            if (counter_threads[j].thread_id == thread_id) {
+                t = counter_threads + j;
+                break;
+            }
+        }
+        if (!t) {
+            if (num_counter_threads == HALIDE_PROFILER_MAX_THREAD_SLOTS) continue;
+            t = counter_threads + num_counter_threads++;
+            t->thread_id = thread_id;
+            t->sample = 0;
+        }
+        if (t->sample == counter_sample) {
+            // Another slot on the same thread, e.g. one waiting for a
+            // parallel loop it launched. Already billed.
+            continue;
+        }
+
+        uint64_t values[halide_profiler_num_counters];
+        if (!halide_profiler_read_thread_counters(thread_id, values)) continue;
+
+        // Only bill the increments if the thread was also running
+        // Halide code at the last sample. Otherwise they may be due to
+        // whatever else the thread was doing in between.
+        if (t->sample + 1 == counter_sample) {
+            uint64_t deltas[halide_profiler_num_counters];
+            for (int j = 0; j < halide_profiler_num_counters; j++) {
+                deltas[j] = values[j] - t->values[j];
+            }
+            bill_func_counters(s, func, deltas);
+        }
+        for (int j = 0; j < halide_profiler_num_counters; j++) {
+            t->values[j] = values[j];
+        }
+        t->sample = counter_sample;
+    }
+}
+
+// Bill the time since the last sample to the funcs running on each
+// thread, splitting it evenly between them, so that the per-func
+// times still add up to the wall-clock time spent in the pipeline.
+WEAK void bill_thread_funcs(halide_profiler_state *s, uint64_t time, int active_threads) {
+    int funcs[HALIDE_PROFILER_MAX_THREAD_SLOTS + 1];
+    int num_funcs = 0;
+    int shared = s->current_func;
+    if (shared >= 0) {
+        funcs[num_funcs++] = shared;
+    }
+    for (int i = 0; i < HALIDE_PROFILER_MAX_THREAD_SLOTS; i++) {
+        int func = s->thread_funcs[i];
+        if (func >= 0) {
+            funcs[num_funcs++] = func;
+        }
+    }
+    if (num_funcs == 0) {
+        return;
+    }
+    uint64_t share = time / num_funcs;
+    for (int i = 0; i < num_funcs; i++) {
+        bill_func(s, funcs[i], share, active_threads);
+    }
+}
+
 WEAK void sampling_profiler_thread(void *) {
     halide_profiler_state *s = halide_profiler_get_state();
 
     // grab the lock
     halide_mutex_lock(&s->lock);
 
+    if (s->sleep_time_us == 0) {
+        const char *interval = getenv("HL_PROFILER_SAMPLE_US");
+        if (interval) {
+            s->sleep_time_us = atoi(interval);
+        }
+    }
+
     while (s->current_func != halide_profiler_please_stop) {
 
         uint64_t t1 = halide_current_time_ns(NULL);
         uint64_t t = t1;
         while (1) {
-            int func, active_threads;
-            if (s->get_remote_profiler_state) {
+            uint64_t t_now = halide_current_time_ns(NULL);
+            if (s->current_func == halide_profiler_please_stop) {
+                break;
+            } else if (s->get_remote_profiler_state) {
                 // Execution has disappeared into remote code running
                 // on an accelerator (e.g. Hexagon DSP)
+                int func, active_threads;
                 s->get_remote_profiler_state(&func, &active_threads);
+                if (func >= 0) {
+                    // Assume all time since I was last awake is due to
+                    // the currently running func.
+                    bill_func(s, func, t_now - t, active_threads);
+                }
             } else {
-                func = s->current_func;
-                active_threads = s->active_threads;
-            }
-            uint64_t t_now = halide_current_time_ns(NULL);
-            if (func == halide_profiler_please_stop) {
-                break;
-            } else if (func >= 0) {
-                // Assume all time since I was last awake is due to
-                // the currently running func.
-                bill_func(s, func, t_now - t, active_threads);
+                bill_thread_funcs(s, t_now - t, s->active_threads);
+                if (s->counters_enabled) {
+                    bill_thread_counters(s);
+                }
             }
             t = t_now;
 
             // Release the lock, sleep, reacquire.
+            int sleep_us = s->sleep_time_us;
             int sleep_ms = s->sleep_time;
             halide_mutex_unlock(&s->lock);
-            halide_sleep_ms(NULL, sleep_ms);
+            if (sleep_us > 0) {
+                halide_sleep_us(NULL, sleep_us);
+            } else {
+                halide_sleep_ms(NULL, sleep_ms);
+            }
             halide_mutex_lock(&s->lock);
         }
     }
@@ -180,6 +378,15 @@ WEAK int halide_profiler_pipeline_start(void *user_context,
 
     ScopedMutexLock lock(&s->lock);
 
+    if (!s->thread_funcs_initialized) {
+        for (int i = 0; i < HALIDE_PROFILER_MAX_THREAD_SLOTS; i++) {
+            s->thread_funcs[i] = halide_profiler_slot_free;
+        }
+        const char *counters = getenv("HL_PROFILER_COUNTERS");
+        s->counters_enabled = counters && atoi(counters);
+        s->thread_funcs_initialized = true;
+    }
+
     if (!s->started) {
         halide_start_clock(user_context);
         halide_spawn_thread(sampling_profiler_thread, NULL);
@@ -197,6 +404,74 @@ WEAK int halide_profiler_pipeline_start(void *user_context,
     return p->first_func_id;
 }
 
+// Called at the start of each run of a pipeline that counts its
+// branches. The names are only copied on the first run.
+WEAK int halide_profiler_register_branches(void *user_context,
+                                           void *pipeline_state,
+                                           int num_branches,
+                                           const uint64_t *branch_names) {
+    halide_profiler_state *s = halide_profiler_get_state();
+    halide_profiler_pipeline_stats *p = (halide_profiler_pipeline_stats *)pipeline_state;
+
+    ScopedMutexLock lock(&s->lock);
+
+    if (p->branches) {
+        return 0;
+    }
+    p->branches = (halide_profiler_branch_stats *)malloc(num_branches * sizeof(halide_profiler_branch_stats));
+    if (!p->branches) {
+        return halide_error_out_of_memory(user_context);
+    }
+    for (int i = 0; i < num_branches; i++) {
+        p->branches[i].count = 0;
+        p->branches[i].name = (const char *)(branch_names[i]);
+    }
+    p->num_branches = num_branches;
+    return 0;
+}
+
+WEAK void halide_profiler_branch_taken(void *user_context,
+                                       void *pipeline_state,
+                                       int branch) {
+    halide_profiler_pipeline_stats *p = (halide_profiler_pipeline_stats *)pipeline_state;
+    __sync_add_and_fetch(&p->branches[branch].count, 1);
+}
+
+// Claim a slot in which the calling thread records the func it's
+// running, starting with func. Called at the start of each pipeline
+// and of each parallel task, so it must be cheap.
+WEAK int *halide_profiler_claim_thread_slot(void *state, int func) {
+    halide_profiler_state *s = (halide_profiler_state *)state;
+    static int next_slot = 0;
+    int start = __sync_fetch_and_add(&next_slot, 1);
+    for (int i = 0; i < HALIDE_PROFILER_MAX_THREAD_SLOTS; i++) {
+        int *slot = &s->thread_funcs[(start + i) % HALIDE_PROFILER_MAX_THREAD_SLOTS];
+        if (*slot == halide_profiler_slot_free &&
+            __sync_bool_compare_and_swap(slot, halide_profiler_slot_free, func)) {
+            if (s->counters_enabled) {
+                s->thread_ids[slot - s->thread_funcs] = halide_profiler_current_thread_id();
+            }
+            return slot;
+        }
+    }
+    // Everything's taken. Fall back to sharing one slot.
+    s->current_func = func;
+    return &s->current_func;
+}
+
+// Give back a slot claimed above. Registered as a destructor, so that
+// it happens on error paths too.
+WEAK void halide_profiler_release_thread_slot(void *user_context, void *obj) {
+    halide_profiler_state *s = halide_profiler_get_state();
+    int *slot = (int *)obj;
+    __sync_synchronize();
+    if (slot == &s->current_func) {
+        *slot = halide_profiler_outside_of_halide;
+    } else {
+        *slot = halide_profiler_slot_free;
+    }
+}
+
 WEAK void halide_profiler_stack_peak_update(void *user_context,
                                             void *pipeline_state,
                                             uint64_t *f_values) {
@@ -251,6 +526,10 @@ WEAK void halide_profiler_memory_allocate(void *user_context,
     __sync_add_and_fetch(&f_stats->memory_total, incr);
     uint64_t f_mem_current = __sync_add_and_fetch(&f_stats->memory_current, incr);
     sync_compare_max_and_swap(&f_stats->memory_peak, f_mem_current);
+
+    if (alloc_log_fd >= 0) {
+        log_alloc_event(alloc_log_allocate, p_stats->first_func_id + func_id, incr);
+    }
 }
 
 WEAK void halide_profiler_memory_free(void *user_context,
@@ -281,6 +560,10 @@ WEAK void halide_profiler_memory_free(void *user_context,
 
     // Update per-func memory stats
     __sync_sub_and_fetch(&f_stats->memory_current, decr);
+
+    if (alloc_log_fd >= 0) {
+        log_alloc_event(alloc_log_free, p_stats->first_func_id + func_id, decr);
+    }
 }
 
 WEAK void halide_profiler_report_unlocked(void *user_context, halide_profiler_state *s) {
@@ -309,6 +592,12 @@ WEAK void halide_profiler_report_unlocked(void *user_context, halide_profiler_st
         }
         sstr << " heap allocations: " << p->num_allocs
              << "  peak heap usage: " << p->memory_peak << " bytes\n";
+        bool counters = p->counters[halide_profiler_counter_cycles] != 0;
+        if (counters) {
+            sstr << " instructions: " << p->counters[halide_profiler_counter_instructions]
+                 << "  cycles: " << p->counters[halide_profiler_counter_cycles]
+                 << "  cache misses: " << p->counters[halide_profiler_counter_cache_misses] << "\n";
+        }
         halide_print(user_context, sstr.str());
 
         bool print_f_states = p->time || p->memory_total;
@@ -377,12 +666,233 @@ WEAK void halide_profiler_report_unlocked(void *user_context, halide_profiler_st
                 if (fs->stack_peak > 0) {
                     sstr << " stack: " << fs->stack_peak;
                 }
+                if (counters && fs->counters[halide_profiler_counter_cycles]) {
+                    // Estimate the memory bandwidth assuming each cache
+                    // miss fetches one 64-byte line.
+                    float ipc = (float)fs->counters[halide_profiler_counter_instructions] /
+                        fs->counters[halide_profiler_counter_cycles];
+                    float mpki = fs->counters[halide_profiler_counter_cache_misses] * 1000.0f /
+                        (fs->counters[halide_profiler_counter_instructions] + 1);
+                    float bandwidth = fs->time == 0 ? 0.0f :
+                        fs->counters[halide_profiler_counter_cache_misses] * 64.0f * 1000.0f / fs->time;
+                    sstr << " ipc: " << ipc;
+                    sstr.erase(3);
+                    sstr << " misses/kinstr: " << mpki;
+                    sstr.erase(3);
+                    sstr << " bandwidth: " << bandwidth;
+                    sstr.erase(3);
+                    sstr << "MB/s";
+                }
                 sstr << "\n";
 
                 halide_print(user_context, sstr.str());
             }
         }
+
+        for (int i = 0; i < p->num_branches; i++) {
+            sstr.clear();
+            sstr << "  " << p->branches[i].name << ": taken "
+                 << p->branches[i].count << " times\n";
+            halide_print(user_context, sstr.str());
+        }
+    }
+}
+
+// Append the branch counts to the file named by
+// HL_PROFILER_BRANCH_PROFILE, one "pipeline branch count" line
+// each. Compiling with HL_PGO_PROFILE set to the file then weights
+// the branches. Appending means the counts of several runs add up.
+WEAK void write_branch_profile_unlocked(halide_profiler_state *s) {
+    const char *name = getenv("HL_PROFILER_BRANCH_PROFILE");
+    if (!name) return;
+    void *file = fopen(name, "a");
+    if (!file) {
+        halide_print(NULL, "Could not open the file named by HL_PROFILER_BRANCH_PROFILE\n");
+        return;
+    }
+    int fd = fileno(file);
+
+    char line_buf[1024];
+    Printer<StringStreamPrinter, sizeof(line_buf)> sstr(NULL, line_buf);
+    for (halide_profiler_pipeline_stats *p = s->pipelines; p;
+         p = (halide_profiler_pipeline_stats *)(p->next)) {
+        for (int i = 0; i < p->num_branches; i++) {
+            sstr.clear();
+            sstr << p->name << " " << p->branches[i].name << " " << p->branches[i].count << "\n";
+            write(fd, sstr.str(), sstr.size());
+        }
+    }
+    fclose(file);
+}
+
+WEAK void halide_profiler_report_folded_unlocked(void *user_context, halide_profiler_state *s) {
+    char line_buf[1024];
+    Printer<StringStreamPrinter, sizeof(line_buf)> sstr(user_context, line_buf);
+
+    for (halide_profiler_pipeline_stats *p = s->pipelines; p;
+         p = (halide_profiler_pipeline_stats *)(p->next)) {
+        for (int i = 0; i < p->num_funcs; i++) {
+            halide_profiler_func_stats *fs = p->funcs + i;
+            uint64_t us = fs->time / 1000;
+            if (us == 0) continue;
+            sstr.clear();
+            sstr << p->name << ";" << fs->name << " " << us << "\n";
+            halide_print(user_context, sstr.str());
+        }
+    }
+}
+
+WEAK void halide_profiler_report_folded(void *user_context) {
+    halide_profiler_state *s = halide_profiler_get_state();
+    ScopedMutexLock lock(&s->lock);
+    halide_profiler_report_folded_unlocked(user_context, s);
+}
+
+}
+
+namespace Halide { namespace Runtime { namespace Internal {
+
+// Accumulates a report into a caller-provided buffer, counting how
+// much space the whole thing needs even if it doesn't fit.
+struct ReportWriter {
+    char *dst, *end;
+    int length;
+
+    void append(const char *str) {
+        while (*str) {
+            if (dst < end) {
+                *dst++ = *str;
+            }
+            str++;
+            length++;
+        }
+    }
+
+    void append_json_string(const char *str) {
+        char c[3] = {0, 0, 0};
+        append("\"");
+        for (; *str; str++) {
+            if (*str == '"' || *str == '\\') {
+                c[0] = '\\';
+                c[1] = *str;
+            } else if ((unsigned char)*str < 0x20) {
+                // Func names never contain control characters, but
+                // don't produce invalid JSON if they somehow do.
+                c[0] = '?';
+                c[1] = 0;
+            } else {
+                c[0] = *str;
+                c[1] = 0;
+            }
+            append(c);
+        }
+        append("\"");
+    }
+
+    void append_uint(uint64_t val) {
+        char buf[32];
+        halide_uint64_to_string(buf, buf + sizeof(buf), val, 1);
+        append(buf);
     }
+
+    void append_double(double val) {
+        char buf[64];
+        halide_double_to_string(buf, buf + sizeof(buf), val, 0);
+        append(buf);
+    }
+
+    void append_counters(const uint64_t *counters) {
+        append(", \"instructions\": ");
+        append_uint(counters[halide_profiler_counter_instructions]);
+        append(", \"cycles\": ");
+        append_uint(counters[halide_profiler_counter_cycles]);
+        append(", \"cache_misses\": ");
+        append_uint(counters[halide_profiler_counter_cache_misses]);
+    }
+};
+
+WEAK int halide_profiler_report_json_unlocked(halide_profiler_state *s, char *buf, int size) {
+    ReportWriter w;
+    w.dst = buf;
+    // Leave room for the null terminator.
+    w.end = buf + (size > 0 ? size - 1 : 0);
+    w.length = 0;
+
+    w.append("{\"pipelines\": [");
+    bool first_pipeline = true;
+    for (halide_profiler_pipeline_stats *p = s->pipelines; p;
+         p = (halide_profiler_pipeline_stats *)(p->next)) {
+        if (!p->runs) continue;
+        if (!first_pipeline) w.append(", ");
+        first_pipeline = false;
+
+        w.append("{\"name\": ");
+        w.append_json_string(p->name);
+        w.append(", \"runs\": ");
+        w.append_uint(p->runs);
+        w.append(", \"time_ns\": ");
+        w.append_uint(p->time);
+        w.append(", \"samples\": ");
+        w.append_uint(p->samples);
+        w.append(", \"average_threads\": ");
+        w.append_double(p->active_threads_numerator / (p->active_threads_denominator + 1e-10));
+        w.append(", \"num_allocs\": ");
+        w.append_uint(p->num_allocs);
+        w.append(", \"memory_peak\": ");
+        w.append_uint(p->memory_peak);
+        w.append(", \"memory_total\": ");
+        w.append_uint(p->memory_total);
+        w.append_counters(p->counters);
+        w.append(", \"funcs\": [");
+        for (int i = 0; i < p->num_funcs; i++) {
+            halide_profiler_func_stats *fs = p->funcs + i;
+            if (i > 0) w.append(", ");
+            w.append("{\"name\": ");
+            w.append_json_string(fs->name);
+            w.append(", \"time_ns\": ");
+            w.append_uint(fs->time);
+            w.append(", \"percent\": ");
+            w.append_double(p->time ? (100.0 * fs->time) / p->time : 0.0);
+            w.append(", \"average_threads\": ");
+            w.append_double(fs->active_threads_numerator / (fs->active_threads_denominator + 1e-10));
+            w.append(", \"num_allocs\": ");
+            w.append_uint(fs->num_allocs);
+            w.append(", \"memory_peak\": ");
+            w.append_uint(fs->memory_peak);
+            w.append(", \"memory_total\": ");
+            w.append_uint(fs->memory_total);
+            w.append(", \"stack_peak\": ");
+            w.append_uint(fs->stack_peak);
+            w.append_counters(fs->counters);
+            w.append("}");
+        }
+        w.append("], \"branches\": [");
+        for (int i = 0; i < p->num_branches; i++) {
+            if (i > 0) w.append(", ");
+            w.append("{\"name\": ");
+            w.append_json_string(p->branches[i].name);
+            w.append(", \"count\": ");
+            w.append_uint(p->branches[i].count);
+            w.append("}");
+        }
+        w.append("]}");
+    }
+    w.append("]}");
+
+    if (size > 0) {
+        *w.dst = 0;
+    }
+    return w.length;
+}
+
+}}} // namespace Halide::Runtime::Internal
+
+extern "C" {
+
+WEAK int halide_profiler_report_json(void *user_context, char *buf, int size) {
+    halide_profiler_state *s = halide_profiler_get_state();
+    ScopedMutexLock lock(&s->lock);
+    return halide_profiler_report_json_unlocked(s, buf, size);
 }
 
 WEAK void halide_profiler_report(void *user_context) {
@@ -405,6 +915,7 @@ WEAK void halide_profiler_reset() {
         halide_profiler_pipeline_stats *p = s->pipelines;
         s->pipelines = (halide_profiler_pipeline_stats *)(p->next);
         free(p->funcs);
+        free(p->branches);
         free(p);
     }
     s->first_free_id = 0;
@@ -413,6 +924,12 @@ WEAK void halide_profiler_reset() {
 namespace {
 __attribute__((destructor))
 WEAK void halide_profiler_shutdown() {
+    if (alloc_log_file) {
+        alloc_log_fd = -1;
+        fclose(alloc_log_file);
+        alloc_log_file = NULL;
+    }
+
     halide_profiler_state *s = halide_profiler_get_state();
     if (!s->started) return;
     s->current_func = halide_profiler_please_stop;
@@ -424,7 +941,13 @@ WEAK void halide_profiler_shutdown() {
 
     // Print results. No need to lock anything because we just shut
     // down the thread.
-    halide_profiler_report_unlocked(NULL, s);
+    const char *flamegraph = getenv("HL_PROFILER_FLAMEGRAPH");
+    if (flamegraph && atoi(flamegraph)) {
+        halide_profiler_report_folded_unlocked(NULL, s);
+    } else {
+        halide_profiler_report_unlocked(NULL, s);
+    }
+    write_branch_profile_unlocked(s);
 
     // Leak the memory. Not all implementations of ScopedMutexLock may
     // be safe to use at static destruction time (windows).
@@ -12,6 +12,15 @@ WEAK __attribute__((always_inline)) int halide_profiler_set_current_func(halide_
     return 0;
 }
 
+WEAK __attribute__((always_inline)) int halide_profiler_set_thread_func(int *slot, int tok, int t) {
+    // As above, but for the slot claimed by the current thread.
+    volatile int *ptr = slot;
+    asm volatile ("":::);
+    *ptr = tok + t;
+    asm volatile ("":::);
+    return 0;
+}
+
 WEAK __attribute__((always_inline)) int halide_profiler_incr_active_threads(halide_profiler_state *state) {
     volatile int *ptr = &(state->active_threads);
     asm volatile ("":::);
@@ -339,6 +339,84 @@ define weak_odr i32 @halide_gpu_thread_barrier() nounwind uwtable alwaysinline {
        ret i32 0
 }
 
+; Used for reductions scheduled with gpu_warp_reduce. The source lane is
+; clamped to the end of the warp.
+define weak_odr i32 @halide_ptx_shfl_down_i32(i32 %a, i32 %delta) nounwind uwtable alwaysinline {
+       %b = tail call i32 asm sideeffect "shfl.down.b32 $0, $1, $2, 0x1f;", "=r,r,r"(i32 %a, i32 %delta) nounwind
+       ret i32 %b
+}
+
+define weak_odr float @halide_ptx_shfl_down_f32(float %a, i32 %delta) nounwind uwtable alwaysinline {
+       %b = tail call float asm sideeffect "shfl.down.b32 $0, $1, $2, 0x1f;", "=f,f,r"(float %a, i32 %delta) nounwind
+       ret float %b
+}
+
+; The wmma operations used by updates scheduled with gpu_tensor_core,
+; which need cuda_capability_70. Each fragment of a 16x16 f16 matrix is
+; eight registers holding pairs of halves, and each fragment of a 16x16
+; f32 accumulator is eight floats. The pointers are generic, and the
+; strides are in elements.
+
+define weak_odr {i32, i32, i32, i32, i32, i32, i32, i32} @halide_ptx_wmma_load_a_row(i8* %p, i32 %stride) nounwind uwtable alwaysinline {
+       %r = tail call {i32, i32, i32, i32, i32, i32, i32, i32} asm sideeffect "wmma.load.a.sync.row.m16n16k16.f16 {$0, $1, $2, $3, $4, $5, $6, $7}, [$8], $9;", "=r,=r,=r,=r,=r,=r,=r,=r,l,r"(i8* %p, i32 %stride) nounwind
+       ret {i32, i32, i32, i32, i32, i32, i32, i32} %r
+}
+
+define weak_odr {i32, i32, i32, i32, i32, i32, i32, i32} @halide_ptx_wmma_load_a_col(i8* %p, i32 %stride) nounwind uwtable alwaysinline {
+       %r = tail call {i32, i32, i32, i32, i32, i32, i32, i32} asm sideeffect "wmma.load.a.sync.col.m16n16k16.f16 {$0, $1, $2, $3, $4, $5, $6, $7}, [$8], $9;", "=r,=r,=r,=r,=r,=r,=r,=r,l,r"(i8* %p, i32 %stride) nounwind
+       ret {i32, i32, i32, i32, i32, i32, i32, i32} %r
+}
+
+define weak_odr {i32, i32, i32, i32, i32, i32, i32, i32} @halide_ptx_wmma_load_b_row(i8* %p, i32 %stride) nounwind uwtable alwaysinline {
+       %r = tail call {i32, i32, i32, i32, i32, i32, i32, i32} asm sideeffect "wmma.load.b.sync.row.m16n16k16.f16 {$0, $1, $2, $3, $4, $5, $6, $7}, [$8], $9;", "=r,=r,=r,=r,=r,=r,=r,=r,l,r"(i8* %p, i32 %stride) nounwind
+       ret {i32, i32, i32, i32, i32, i32, i32, i32} %r
+}
+
+define weak_odr {i32, i32, i32, i32, i32, i32, i32, i32} @halide_ptx_wmma_load_b_col(i8* %p, i32 %stride) nounwind uwtable alwaysinline {
+       %r = tail call {i32, i32, i32, i32, i32, i32, i32, i32} asm sideeffect "wmma.load.b.sync.col.m16n16k16.f16 {$0, $1, $2, $3, $4, $5, $6, $7}, [$8], $9;", "=r,=r,=r,=r,=r,=r,=r,=r,l,r"(i8* %p, i32 %stride) nounwind
+       ret {i32, i32, i32, i32, i32, i32, i32, i32} %r
+}
+
+define weak_odr {float, float, float, float, float, float, float, float} @halide_ptx_wmma_load_c_row(i8* %p, i32 %stride) nounwind uwtable alwaysinline {
+       %r = tail call {float, float, float, float, float, float, float, float} asm sideeffect "wmma.load.c.sync.row.m16n16k16.f32 {$0, $1, $2, $3, $4, $5, $6, $7}, [$8], $9;", "=f,=f,=f,=f,=f,=f,=f,=f,l,r"(i8* %p, i32 %stride) nounwind
+       ret {float, float, float, float, float, float, float, float} %r
+}
+
+define weak_odr {float, float, float, float, float, float, float, float} @halide_ptx_wmma_load_c_col(i8* %p, i32 %stride) nounwind uwtable alwaysinline {
+       %r = tail call {float, float, float, float, float, float, float, float} asm sideeffect "wmma.load.c.sync.col.m16n16k16.f32 {$0, $1, $2, $3, $4, $5, $6, $7}, [$8], $9;", "=f,=f,=f,=f,=f,=f,=f,=f,l,r"(i8* %p, i32 %stride) nounwind
+       ret {float, float, float, float, float, float, float, float} %r
+}
+
+define weak_odr {float, float, float, float, float, float, float, float} @halide_ptx_wmma_mma_row_row(i32 %a0, i32 %a1, i32 %a2, i32 %a3, i32 %a4, i32 %a5, i32 %a6, i32 %a7, i32 %b0, i32 %b1, i32 %b2, i32 %b3, i32 %b4, i32 %b5, i32 %b6, i32 %b7, float %c0, float %c1, float %c2, float %c3, float %c4, float %c5, float %c6, float %c7) nounwind uwtable alwaysinline {
+       %r = tail call {float, float, float, float, float, float, float, float} asm sideeffect "wmma.mma.sync.row.row.m16n16k16.f32.f32 {$0, $1, $2, $3, $4, $5, $6, $7}, {$8, $9, $10, $11, $12, $13, $14, $15}, {$16, $17, $18, $19, $20, $21, $22, $23}, {$24, $25, $26, $27, $28, $29, $30, $31};", "=f,=f,=f,=f,=f,=f,=f,=f,r,r,r,r,r,r,r,r,r,r,r,r,r,r,r,r,f,f,f,f,f,f,f,f"(i32 %a0, i32 %a1, i32 %a2, i32 %a3, i32 %a4, i32 %a5, i32 %a6, i32 %a7, i32 %b0, i32 %b1, i32 %b2, i32 %b3, i32 %b4, i32 %b5, i32 %b6, i32 %b7, float %c0, float %c1, float %c2, float %c3, float %c4, float %c5, float %c6, float %c7) nounwind
+       ret {float, float, float, float, float, float, float, float} %r
+}
+
+define weak_odr {float, float, float, float, float, float, float, float} @halide_ptx_wmma_mma_row_col(i32 %a0, i32 %a1, i32 %a2, i32 %a3, i32 %a4, i32 %a5, i32 %a6, i32 %a7, i32 %b0, i32 %b1, i32 %b2, i32 %b3, i32 %b4, i32 %b5, i32 %b6, i32 %b7, float %c0, float %c1, float %c2, float %c3, float %c4, float %c5, float %c6, float %c7) nounwind uwtable alwaysinline {
+       %r = tail call {float, float, float, float, float, float, float, float} asm sideeffect "wmma.mma.sync.row.col.m16n16k16.f32.f32 {$0, $1, $2, $3, $4, $5, $6, $7}, {$8, $9, $10, $11, $12, $13, $14, $15}, {$16, $17, $18, $19, $20, $21, $22, $23}, {$24, $25, $26, $27, $28, $29, $30, $31};", "=f,=f,=f,=f,=f,=f,=f,=f,r,r,r,r,r,r,r,r,r,r,r,r,r,r,r,r,f,f,f,f,f,f,f,f"(i32 %a0, i32 %a1, i32 %a2, i32 %a3, i32 %a4, i32 %a5, i32 %a6, i32 %a7, i32 %b0, i32 %b1, i32 %b2, i32 %b3, i32 %b4, i32 %b5, i32 %b6, i32 %b7, float %c0, float %c1, float %c2, float %c3, float %c4, float %c5, float %c6, float %c7) nounwind
+       ret {float, float, float, float, float, float, float, float} %r
+}
+
+define weak_odr {float, float, float, float, float, float, float, float} @halide_ptx_wmma_mma_col_row(i32 %a0, i32 %a1, i32 %a2, i32 %a3, i32 %a4, i32 %a5, i32 %a6, i32 %a7, i32 %b0, i32 %b1, i32 %b2, i32 %b3, i32 %b4, i32 %b5, i32 %b6, i32 %b7, float %c0, float %c1, float %c2, float %c3, float %c4, float %c5, float %c6, float %c7) nounwind uwtable alwaysinline {
+       %r = tail call {float, float, float, float, float, float, float, float} asm sideeffect "wmma.mma.sync.col.row.m16n16k16.f32.f32 {$0, $1, $2, $3, $4, $5, $6, $7}, {$8, $9, $10, $11, $12, $13, $14, $15}, {$16, $17, $18, $19, $20, $21, $22, $23}, {$24, $25, $26, $27, $28, $29, $30, $31};", "=f,=f,=f,=f,=f,=f,=f,=f,r,r,r,r,r,r,r,r,r,r,r,r,r,r,r,r,f,f,f,f,f,f,f,f"(i32 %a0, i32 %a1, i32 %a2, i32 %a3, i32 %a4, i32 %a5, i32 %a6, i32 %a7, i32 %b0, i32 %b1, i32 %b2, i32 %b3, i32 %b4, i32 %b5, i32 %b6, i32 %b7, float %c0, float %c1, float %c2, float %c3, float %c4, float %c5, float %c6, float %c7) nounwind
+       ret {float, float, float, float, float, float, float, float} %r
+}
+
+define weak_odr {float, float, float, float, float, float, float, float} @halide_ptx_wmma_mma_col_col(i32 %a0, i32 %a1, i32 %a2, i32 %a3, i32 %a4, i32 %a5, i32 %a6, i32 %a7, i32 %b0, i32 %b1, i32 %b2, i32 %b3, i32 %b4, i32 %b5, i32 %b6, i32 %b7, float %c0, float %c1, float %c2, float %c3, float %c4, float %c5, float %c6, float %c7) nounwind uwtable alwaysinline {
+       %r = tail call {float, float, float, float, float, float, float, float} asm sideeffect "wmma.mma.sync.col.col.m16n16k16.f32.f32 {$0, $1, $2, $3, $4, $5, $6, $7}, {$8, $9, $10, $11, $12, $13, $14, $15}, {$16, $17, $18, $19, $20, $21, $22, $23}, {$24, $25, $26, $27, $28, $29, $30, $31};", "=f,=f,=f,=f,=f,=f,=f,=f,r,r,r,r,r,r,r,r,r,r,r,r,r,r,r,r,f,f,f,f,f,f,f,f"(i32 %a0, i32 %a1, i32 %a2, i32 %a3, i32 %a4, i32 %a5, i32 %a6, i32 %a7, i32 %b0, i32 %b1, i32 %b2, i32 %b3, i32 %b4, i32 %b5, i32 %b6, i32 %b7, float %c0, float %c1, float %c2, float %c3, float %c4, float %c5, float %c6, float %c7) nounwind
+       ret {float, float, float, float, float, float, float, float} %r
+}
+
+define weak_odr void @halide_ptx_wmma_store_d_row(i8* %p, float %d0, float %d1, float %d2, float %d3, float %d4, float %d5, float %d6, float %d7, i32 %stride) nounwind uwtable alwaysinline {
+       tail call void asm sideeffect "wmma.store.d.sync.row.m16n16k16.f32 [$0], {$1, $2, $3, $4, $5, $6, $7, $8}, $9;", "l,f,f,f,f,f,f,f,f,r"(i8* %p, float %d0, float %d1, float %d2, float %d3, float %d4, float %d5, float %d6, float %d7, i32 %stride) nounwind
+       ret void
+}
+
+define weak_odr void @halide_ptx_wmma_store_d_col(i8* %p, float %d0, float %d1, float %d2, float %d3, float %d4, float %d5, float %d6, float %d7, i32 %stride) nounwind uwtable alwaysinline {
+       tail call void asm sideeffect "wmma.store.d.sync.col.m16n16k16.f32 [$0], {$1, $2, $3, $4, $5, $6, $7, $8}, $9;", "l,f,f,f,f,f,f,f,f,r"(i8* %p, float %d0, float %d1, float %d2, float %d3, float %d4, float %d5, float %d6, float %d7, i32 %stride) nounwind
+       ret void
+}
+
 define weak_odr i32 @halide_ptx_trap() nounwind uwtable alwaysinline {
        tail call void asm sideeffect "
        trap;
@@ -5,6 +5,21 @@
 
 using namespace Halide::Runtime::Internal::Qurt;
 
+namespace Halide { namespace Runtime { namespace Internal { namespace Qurt {
+
+__attribute__((always_inline))
+WEAK void l2fetch(const void *ptr, uint32_t width_bytes, uint32_t height, uint32_t stride_bytes) {
+    const int dir = 1;
+    uint64_t desc =
+        (static_cast<uint64_t>(dir) << 48) |
+        (static_cast<uint64_t>(stride_bytes) << 32) |
+        (static_cast<uint64_t>(width_bytes) << 16) |
+        (static_cast<uint64_t>(height) << 0);
+    __asm__ __volatile__ ("l2fetch(%0,%1)" : : "r"(ptr), "r"(desc));
+}
+
+}}}}  // namespace Halide::Runtime::Internal::Qurt
+
 extern "C" {
 
 WEAK int halide_qurt_hvx_lock(void *user_context, int size) {
@@ -55,13 +70,42 @@ WEAK int _halide_prefetch_2d(const void *ptr, int width_bytes, int height, int s
     //  - A l2fetch with any subfield set to zero cancels all pending prefetches
     //  - The l2fetch starting address must be in mapped memory but the range
     //    prefetched can go into unmapped memory without raising an exception
-    const int dir = 1;
-    uint64_t desc =
-        (static_cast<uint64_t>(dir) << 48) |
-        (static_cast<uint64_t>(stride_bytes) << 32) |
-        (static_cast<uint64_t>(width_bytes) << 16) |
-        (static_cast<uint64_t>(height) << 0);
-    __asm__ __volatile__ ("l2fetch(%0,%1)" : : "r"(ptr), "r"(desc));
+    //  - The stride, width, and height fields are 16 bits each
+    //
+    // The l2fetch engine runs in the background, so prefetching the
+    // whole of the next tile at a tile loop streams it into L2 while
+    // the current one is computed. Tiles are usually larger than one
+    // request can describe, so reshape them to fit.
+    const uint32_t max_field = 0xffff;
+    if (width_bytes <= 0 || height <= 0) {
+        // Don't cancel the pending prefetches.
+        return 0;
+    }
+    if (height == 1 || stride_bytes == width_bytes) {
+        // The region is contiguous. Fetch it as rows of a fixed
+        // width instead, so that up to 2GB takes one request.
+        uint64_t size = (uint64_t)width_bytes * (uint64_t)height;
+        if (size <= max_field) {
+            l2fetch(ptr, (uint32_t)size, 1, (uint32_t)size);
+        } else {
+            const uint32_t row = 0x8000;
+            uint64_t rows = (size + row - 1) / row;
+            l2fetch(ptr, row, rows < max_field ? (uint32_t)rows : max_field, row);
+        }
+    } else if (stride_bytes > 0 && (uint32_t)stride_bytes <= max_field &&
+               (uint32_t)width_bytes <= max_field) {
+        for (int y = 0; y < height; y += max_field) {
+            uint32_t h = (uint32_t)(height - y) < max_field ? (uint32_t)(height - y) : max_field;
+            l2fetch((const uint8_t *)ptr + (int64_t)y * stride_bytes, width_bytes, h, stride_bytes);
+        }
+    } else {
+        // The stride can't be described, so fetch the rows one at a
+        // time. Only the last few requests stay queued, so fetch the
+        // rows from last to first, to keep the ones needed first.
+        for (int y = height - 1; y >= 0; y--) {
+            _halide_prefetch_2d((const uint8_t *)ptr + (int64_t)y * stride_bytes, width_bytes, 1, width_bytes);
+        }
+    }
     return 0;
 }
 
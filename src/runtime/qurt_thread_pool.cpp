@@ -87,6 +87,88 @@ WEAK void halide_cond_wait(struct halide_cond *cond, struct halide_mutex *mutex)
 
 #include "thread_pool_common.h"
 
+namespace Halide { namespace Runtime { namespace Internal {
+
+// Hexagon has no NUMA nodes, and qurt threads are not pinned.
+WEAK int get_numa_node_cpus(int node, int *cpus, int max_cpus) {
+    return -1;
+}
+
+WEAK bool pin_current_thread_to_cpu(int cpu) {
+    return false;
+}
+
+// Locking an HVX context is expensive, so a thread in the pool keeps
+// the one it locked to run a task for the tasks that follow, and only
+// unlocks it before it blocks. There is no thread local storage here,
+// so the threads holding a context are tracked by thread id.
+struct hvx_context_holder {
+    qurt_thread_t thread;
+    int hvx_mode;
+};
+
+#define MAX_HVX_CONTEXT_HOLDERS 64
+WEAK hvx_context_holder hvx_context_holders[MAX_HVX_CONTEXT_HOLDERS];
+
+// Find the entry for the calling thread, claiming a free one if it
+// doesn't have one yet. Returns NULL if they are all taken.
+WEAK hvx_context_holder *find_hvx_context_holder(bool claim) {
+    qurt_thread_t self = qurt_thread_get_id();
+    for (int i = 0; i < MAX_HVX_CONTEXT_HOLDERS; i++) {
+        if (__atomic_load_n(&hvx_context_holders[i].thread, __ATOMIC_ACQUIRE) == self) {
+            return &hvx_context_holders[i];
+        }
+    }
+    if (!claim) {
+        return NULL;
+    }
+    for (int i = 0; i < MAX_HVX_CONTEXT_HOLDERS; i++) {
+        qurt_thread_t expected = 0;
+        if (__atomic_compare_exchange_n(&hvx_context_holders[i].thread, &expected, self,
+                                        false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+            hvx_context_holders[i].hvx_mode = -1;
+            return &hvx_context_holders[i];
+        }
+    }
+    return NULL;
+}
+
+// Unlock the context the calling thread kept from a previous task, if
+// any. Returns the mode it was locked in, or -1.
+WEAK int release_kept_hvx_context() {
+    hvx_context_holder *h = find_hvx_context_holder(false);
+    if (!h) {
+        return -1;
+    }
+    int mode = h->hvx_mode;
+    h->hvx_mode = -1;
+    __atomic_store_n(&h->thread, 0, __ATOMIC_RELEASE);
+    return mode;
+}
+
+WEAK void release_task_resources() {
+    if (release_kept_hvx_context() != -1) {
+        qurt_hvx_unlock();
+    }
+}
+
+// The number of threads to use for parallel loops in the given HVX
+// mode: one per HVX context, so that every unit is kept busy.
+WEAK int hvx_num_threads(int hvx_mode) {
+    if (qurt_hvx_get_units) {
+        int units = qurt_hvx_get_units();
+        int n = (hvx_mode == QURT_HVX_MODE_128B) ? ((units >> 8) & 0xff) : (units & 0xff);
+        if (n > 0) {
+            return n;
+        }
+    }
+    // Assume a Snapdragon 820, which has two 128 byte contexts,
+    // or four 64 byte ones.
+    return (hvx_mode == QURT_HVX_MODE_128B) ? 2 : 4;
+}
+
+}}} // namespace Halide::Runtime::Internal
+
 namespace {
 // We wrap the closure passed to jobs with extra info we
 // need. Currently just the hvx mode to use.
@@ -120,14 +202,17 @@ WEAK int halide_do_par_for(void *user_context,
 
     wrapped_closure c = {closure, qurt_hvx_get_mode()};
 
-    // Set the desired number of threads based on the current HVX
-    // mode.
-    int old_num_threads =
-        halide_set_num_threads((c.hvx_mode == QURT_HVX_MODE_128B) ? 2 : 4);
     // We're about to acquire the thread-pool lock, so we must drop
     // the hvx context lock, even though we'll likely reacquire it
-    // immediately to do some work on this thread.
-    if (c.hvx_mode != -1) {
+    // immediately to do some work on this thread. If this thread is
+    // itself running a task of an enclosing parallel loop, it is
+    // holding a context it kept from an earlier task. That one gets
+    // handed back to the task once this loop is done.
+    int kept_mode = release_kept_hvx_context();
+    if (kept_mode != -1) {
+        c.hvx_mode = kept_mode;
+        qurt_hvx_unlock();
+    } else if (c.hvx_mode != -1) {
         // The docs say that qurt_hvx_get_mode should return -1 when
         // "not available". However, it appears to actually return 0,
         // which is the value of QURT_HVX_MODE_64B!  This means that
@@ -143,10 +228,31 @@ WEAK int halide_do_par_for(void *user_context,
             c.hvx_mode = -1;
         }
     }
+
+    // Use a thread per HVX context available in the current mode.
+    int old_num_threads = halide_set_num_threads(c.hvx_mode != -1 ? hvx_num_threads(c.hvx_mode) : 4);
+
     int ret = halide_default_do_par_for(user_context, task, min, size, (uint8_t *)&c);
 
     if (c.hvx_mode != -1) {
-        qurt_hvx_lock((qurt_hvx_mode_t)c.hvx_mode);
+        // This thread may have kept a context from running one of
+        // the tasks. Take it over if it's in the right mode.
+        int mode = release_kept_hvx_context();
+        if (mode != c.hvx_mode) {
+            if (mode != -1) {
+                qurt_hvx_unlock();
+            }
+            qurt_hvx_lock((qurt_hvx_mode_t)c.hvx_mode);
+        }
+        if (kept_mode != -1) {
+            // Keep it for the enclosing task again.
+            hvx_context_holder *h = find_hvx_context_holder(true);
+            if (h) {
+                h->hvx_mode = c.hvx_mode;
+            } else {
+                qurt_hvx_unlock();
+            }
+        }
     }
 
     // Set the desired number of threads back to what it was, in case
@@ -163,7 +269,23 @@ WEAK int halide_do_task(void *user_context, halide_task_t f,
     // acquire the hvx context lock (if needed) to run some code.
 
     if (c->hvx_mode != -1) {
+        // Keep the context locked after the task, so that the next
+        // one this thread runs doesn't have to lock it again.
+        hvx_context_holder *h = find_hvx_context_holder(true);
+        if (h && h->hvx_mode == c->hvx_mode) {
+            return f(user_context, idx, c->closure);
+        }
+        if (h && h->hvx_mode != -1) {
+            qurt_hvx_unlock();
+            h->hvx_mode = -1;
+        }
         qurt_hvx_lock((qurt_hvx_mode_t)c->hvx_mode);
+        if (h) {
+            // Record it before running the task, in case the task
+            // runs a nested parallel loop.
+            h->hvx_mode = c->hvx_mode;
+            return f(user_context, idx, c->closure);
+        }
         int ret = f(user_context, idx, c->closure);
         qurt_hvx_unlock();
         return ret;
@@ -15,6 +15,8 @@
 // cat src/runtime/runtime_internal.h src/runtime/HalideRuntime*.h | grep "^[^ ][^(]*halide_[^ ]*(" | grep -v '#define' | sed "s/[^(]*halide/halide/" | sed "s/(.*//" | sed "s/^h/    \(void *)\&h/" | sed "s/$/,/" | sort | uniq
 
 extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
+    (void *)&halide_buffer_add_device_dirty_region,
+    (void *)&halide_buffer_add_host_dirty_region,
     (void *)&halide_buffer_copy,
     (void *)&halide_buffer_to_string,
     (void *)&halide_can_use_target_features,
@@ -30,6 +32,10 @@ extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
     (void *)&halide_cuda_detach_device_ptr,
     (void *)&halide_cuda_device_interface,
     (void *)&halide_cuda_get_device_ptr,
+    (void *)&halide_cuda_graph_begin_capture,
+    (void *)&halide_cuda_graph_end_capture,
+    (void *)&halide_cuda_graph_launch,
+    (void *)&halide_cuda_graph_release,
     (void *)&halide_cuda_initialize_kernels,
     (void *)&halide_cuda_run,
     (void *)&halide_cuda_wrap_device_ptr,
@@ -48,6 +54,7 @@ extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
     (void *)&halide_device_release,
     (void *)&halide_device_sync,
     (void *)&halide_device_sync_legacy,
+    (void *)&halide_do_fork,
     (void *)&halide_do_par_for,
     (void *)&halide_do_task,
     (void *)&halide_double_to_string,
@@ -55,6 +62,7 @@ extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
     (void *)&halide_downgrade_buffer_t_device_fields,
     (void *)&halide_error,
     (void *)&halide_error_access_out_of_bounds,
+    (void *)&halide_error_bad_alias,
     (void *)&halide_error_bad_fold,
     (void *)&halide_error_bad_extern_fold,
     (void *)&halide_error_bad_type,
@@ -82,11 +90,13 @@ extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
     (void *)&halide_error_unaligned_host_ptr,
     (void *)&halide_float16_bits_to_double,
     (void *)&halide_float16_bits_to_float,
+    (void *)&halide_float_to_float16_bits,
     (void *)&halide_free,
     (void *)&halide_get_cpu_features,
     (void *)&halide_get_gpu_device,
     (void *)&halide_get_library_symbol,
     (void *)&halide_get_symbol,
+    (void *)&halide_get_thread_budget,
     (void *)&halide_get_trace_file,
     (void *)&halide_hexagon_detach_device_handle,
     (void *)&halide_hexagon_device_interface,
@@ -98,6 +108,8 @@ extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
     (void *)&halide_hexagon_power_hvx_off_as_destructor,
     (void *)&halide_hexagon_power_hvx_on,
     (void *)&halide_hexagon_run,
+    (void *)&halide_hexagon_set_async_run,
+    (void *)&halide_hexagon_set_lazy_loading,
     (void *)&halide_hexagon_set_performance,
     (void *)&halide_hexagon_set_performance_mode,
     (void *)&halide_hexagon_wrap_device_handle,
@@ -107,6 +119,8 @@ extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
     (void *)&halide_malloc,
     (void *)&halide_matlab_call_pipeline,
     (void *)&halide_memoization_cache_cleanup,
+    (void *)&halide_memoization_cache_get_stats,
+    (void *)&halide_memoization_hash_buffer,
     (void *)&halide_memoization_cache_lookup,
     (void *)&halide_memoization_cache_release,
     (void *)&halide_memoization_cache_set_size,
@@ -114,6 +128,7 @@ extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
     (void *)&halide_metal_acquire_context,
     (void *)&halide_metal_detach_buffer,
     (void *)&halide_metal_device_interface,
+    (void *)&halide_metal_finish_pipeline_as_destructor,
     (void *)&halide_metal_get_buffer,
     (void *)&halide_metal_initialize_kernels,
     (void *)&halide_metal_release_context,
@@ -130,10 +145,12 @@ extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
     (void *)&halide_opencl_get_cl_mem,
     (void *)&halide_opencl_get_device_type,
     (void *)&halide_opencl_get_platform_name,
+    (void *)&halide_opencl_get_program_cache_dir,
     (void *)&halide_opencl_initialize_kernels,
     (void *)&halide_opencl_run,
     (void *)&halide_opencl_set_device_type,
     (void *)&halide_opencl_set_platform_name,
+    (void *)&halide_opencl_set_program_cache_dir,
     (void *)&halide_opencl_wrap_cl_mem,
     (void *)&halide_opengl_context_lost,
     (void *)&halide_opengl_create_context,
@@ -148,20 +165,43 @@ extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
     (void *)&halide_openglcompute_device_interface,
     (void *)&halide_openglcompute_initialize_kernels,
     (void *)&halide_openglcompute_run,
+    (void *)&halide_parallel_task_size,
+    (void *)&halide_parallel_task_size_feedback,
     (void *)&halide_pointer_to_string,
     (void *)&halide_print,
+    (void *)&halide_profiler_branch_taken,
     (void *)&halide_profiler_get_pipeline_state,
     (void *)&halide_profiler_get_state,
     (void *)&halide_profiler_memory_allocate,
     (void *)&halide_profiler_memory_free,
+    (void *)&halide_profiler_claim_thread_slot,
     (void *)&halide_profiler_pipeline_start,
+    (void *)&halide_profiler_register_branches,
+    (void *)&halide_profiler_release_thread_slot,
     (void *)&halide_profiler_report,
+    (void *)&halide_profiler_report_folded,
+    (void *)&halide_profiler_report_json,
     (void *)&halide_profiler_reset,
     (void *)&halide_profiler_stack_peak_update,
     (void *)&halide_qurt_hvx_lock,
     (void *)&halide_qurt_hvx_unlock,
     (void *)&halide_qurt_hvx_unlock_as_destructor,
     (void *)&halide_release_jit_module,
+    (void *)&halide_reuse_allocations_flush,
+    (void *)&halide_reuse_allocations_free,
+    (void *)&halide_reuse_allocations_malloc,
+    (void *)&halide_reuse_allocations_set_limit,
+    (void *)&halide_schedule_variant_begin,
+    (void *)&halide_schedule_variant_end,
+    (void *)&halide_scratch_arena_acquire,
+    (void *)&halide_scratch_arena_alloc,
+    (void *)&halide_scratch_arena_free,
+    (void *)&halide_scratch_arena_release,
+    (void *)&halide_scratch_arenas_create,
+    (void *)&halide_scratch_arenas_destroy,
+    (void *)&halide_semaphore_abort_as_destructor,
+    (void *)&halide_semaphore_acquire,
+    (void *)&halide_semaphore_release,
     (void *)&halide_set_custom_can_use_target_features,
     (void *)&halide_set_custom_do_par_for,
     (void *)&halide_set_custom_do_task,
@@ -174,13 +214,20 @@ extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
     (void *)&halide_set_custom_trace,
     (void *)&halide_set_error_handler,
     (void *)&halide_set_gpu_device,
+    (void *)&halide_set_num_reserved_threads,
     (void *)&halide_set_num_threads,
+    (void *)&halide_set_thread_pool_spin_count,
     (void *)&halide_set_trace_file,
     (void *)&halide_shutdown_thread_pool,
     (void *)&halide_shutdown_trace,
     (void *)&halide_sleep_ms,
+    (void *)&halide_sleep_us,
     (void *)&halide_spawn_thread,
     (void *)&halide_start_clock,
+    (void *)&halide_stream_state_acquire,
+    (void *)&halide_stream_state_data,
+    (void *)&halide_stream_state_release,
+    (void *)&halide_stream_state_reset,
     (void *)&halide_string_to_string,
     (void *)&halide_trace,
     (void *)&halide_trace_helper,
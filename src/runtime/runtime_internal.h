@@ -78,6 +78,8 @@ int fileno(void *);
 int fclose(void *);
 int close(int);
 size_t fwrite(const void *, size_t, size_t, void *);
+size_t fread(void *, size_t, size_t, void *);
+int rename(const char *oldpath, const char *newpath);
 ssize_t write(int fd, const void *buf, size_t bytes);
 int remove(const char *pathname);
 int ioctl(int fd, unsigned long request, ...);
@@ -113,6 +115,7 @@ WEAK void *halide_get_library_symbol(void *lib, const char *name);
 WEAK int halide_start_clock(void *user_context);
 WEAK int64_t halide_current_time_ns(void *user_context);
 WEAK void halide_sleep_ms(void *user_context, int ms);
+WEAK void halide_sleep_us(void *user_context, int us);
 WEAK void halide_device_free_as_destructor(void *user_context, void *obj);
 WEAK void halide_device_and_host_free_as_destructor(void *user_context, void *obj);
 WEAK void halide_device_host_nop_free(void *user_context, void *obj);
@@ -134,6 +137,21 @@ WEAK int halide_profiler_pipeline_start(void *user_context,
                                         const char *pipeline_name,
                                         int num_funcs,
                                         const uint64_t *func_names);
+WEAK int halide_profiler_register_branches(void *user_context,
+                                           void *pipeline_state,
+                                           int num_branches,
+                                           const uint64_t *branch_names);
+WEAK void halide_profiler_branch_taken(void *user_context,
+                                       void *pipeline_state,
+                                       int branch);
+// Similarly, the state is a halide_profiler_state *.
+WEAK int *halide_profiler_claim_thread_slot(void *state, int func);
+WEAK void halide_profiler_release_thread_slot(void *user_context, void *obj);
+// Hardware performance counters for the profiler. Reading returns the
+// number of counters written to values (halide_profiler_num_counters),
+// or zero if they're unavailable.
+WEAK int halide_profiler_current_thread_id();
+WEAK int halide_profiler_read_thread_counters(int thread_id, uint64_t *values);
 WEAK int halide_host_cpu_count();
 
 WEAK int halide_device_and_host_malloc(void *user_context, struct halide_buffer_t *buf,
@@ -193,6 +211,9 @@ struct CpuFeatures {
 };
 extern WEAK CpuFeatures halide_get_cpu_features();
 
+// The number of threads the thread pool runs parallel loops on.
+extern WEAK int thread_pool_num_threads();
+
 template <typename T>
 __attribute__((always_inline)) void swap(T &a, T &b) {
     T t = a;
@@ -0,0 +1,114 @@
+#include "HalideRuntime.h"
+#include "runtime_internal.h"
+#include "printer.h"
+#include "scoped_mutex_lock.h"
+
+// Picks among the schedule variants compiled into one entry point by
+// timing each of them once. The very first call runs variant zero
+// untimed, which also pays for anything done once per process (such
+// as starting the thread pool). The next calls each time a different
+// variant, and once all of them have been measured every later call
+// uses the fastest. Calls made while the variants are still being
+// timed by other threads use the fastest measured so far, or variant
+// zero. The choice is made once per process.
+
+namespace Halide { namespace Runtime { namespace Internal {
+
+struct schedule_variant_state {
+    schedule_variant_state *next;
+    char *name;
+    int num_variants;
+    // Set once the first call has been made.
+    bool warmed_up;
+    // The number of variants handed out to be timed, and the number
+    // that have finished.
+    int started, measured;
+    // The fastest variant measured so far, or -1.
+    int best;
+    int64_t best_time;
+    // The start time of each variant being timed.
+    int64_t *start_times;
+};
+
+WEAK schedule_variant_state *schedule_variant_states = NULL;
+WEAK halide_mutex schedule_variant_lock = { { 0 } };
+
+// Must be called with the lock held.
+WEAK schedule_variant_state *find_schedule_variant_state(const char *name, int num_variants) {
+    for (schedule_variant_state *s = schedule_variant_states; s; s = s->next) {
+        if (strcmp(s->name, name) == 0) {
+            return s;
+        }
+    }
+    // This lives as long as the process, like the choice it holds, so
+    // it comes from malloc rather than halide_malloc.
+    size_t name_size = strlen(name) + 1;
+    size_t size = sizeof(schedule_variant_state) + num_variants * sizeof(int64_t) + name_size;
+    schedule_variant_state *s = (schedule_variant_state *)malloc(size);
+    if (!s) {
+        return NULL;
+    }
+    memset(s, 0, size);
+    s->num_variants = num_variants;
+    s->best = -1;
+    s->start_times = (int64_t *)(s + 1);
+    s->name = (char *)(s->start_times + num_variants);
+    memcpy(s->name, name, name_size);
+    s->next = schedule_variant_states;
+    schedule_variant_states = s;
+    return s;
+}
+
+}}}  // namespace Halide::Runtime::Internal
+
+using namespace Halide::Runtime::Internal;
+
+extern "C" {
+
+WEAK int halide_schedule_variant_begin(void *user_context, const char *name, int num_variants) {
+    if (num_variants <= 1) {
+        return 0;
+    }
+    ScopedMutexLock lock(&schedule_variant_lock);
+    schedule_variant_state *s = find_schedule_variant_state(name, num_variants);
+    if (!s) {
+        return 0;
+    }
+    if (!s->warmed_up) {
+        s->warmed_up = true;
+        halide_start_clock(user_context);
+        return 0;
+    }
+    if (s->started < s->num_variants) {
+        int variant = s->started++;
+        s->start_times[variant] = halide_current_time_ns(user_context);
+        // Tokens at or above num_variants mark a timed call.
+        return variant + s->num_variants;
+    }
+    return s->best < 0 ? 0 : s->best;
+}
+
+WEAK int halide_schedule_variant_end(void *user_context, const char *name, int token, int result) {
+    ScopedMutexLock lock(&schedule_variant_lock);
+    schedule_variant_state *s = schedule_variant_states;
+    while (s && strcmp(s->name, name) != 0) {
+        s = s->next;
+    }
+    if (!s || token < s->num_variants) {
+        return 0;
+    }
+    int variant = token - s->num_variants;
+    int64_t elapsed = halide_current_time_ns(user_context) - s->start_times[variant];
+    s->measured++;
+    if (result == 0 && (s->best < 0 || elapsed < s->best_time)) {
+        s->best = variant;
+        s->best_time = elapsed;
+    }
+    if (s->measured == s->num_variants) {
+        debug(user_context) << "Schedule variant " << s->best << " of " << name
+                            << " is the fastest (" << s->best_time << " ns)\n";
+    }
+    return 0;
+}
+
+}
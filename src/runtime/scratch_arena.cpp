@@ -0,0 +1,181 @@
+#include "HalideRuntime.h"
+#include "runtime_internal.h"
+
+// Scratch arenas for the heap allocations made inside the body of a
+// parallel loop. Rather than calling halide_malloc and halide_free
+// for every buffer on every iteration, each task takes an arena from a
+// set made for the loop when it runs, bump-allocates from a block the
+// arena keeps between tasks, and hands the arena back when it is
+// done. A task that needs more than the block holds gets the rest from
+// halide_malloc, and the block is grown to the largest amount any task
+// has needed the next time the arena is taken, so each arena settles
+// at the size of the largest task after a few iterations. All memory
+// comes from halide_malloc with the pipeline's user context, and goes
+// back to halide_free when the loop is done.
+
+namespace Halide { namespace Runtime { namespace Internal {
+
+// The number of tasks of one loop that can use a cached block at
+// once. Any more than this get a temporary arena with no block.
+#define SCRATCH_ARENAS_PER_SET 64
+
+struct scratch_arena_set;
+
+struct scratch_arena {
+    scratch_arena_set *set;
+    // Nonzero while a task is using this arena. Claimed atomically.
+    int in_use;
+    uint8_t *block;
+    size_t capacity;
+    // The bytes of the block in use by the current task.
+    size_t used;
+    // The bytes requested so far by the current task, including the
+    // ones that didn't fit in the block, and the most requested at
+    // once by any task.
+    size_t requested, high_water;
+};
+
+struct scratch_arena_set {
+    scratch_arena arenas[SCRATCH_ARENAS_PER_SET];
+};
+
+// Each allocation is preceded by a header recording where it came
+// from.
+struct scratch_header {
+    scratch_arena *arena;
+    // The arena's used bytes before this allocation, or ~0 if the
+    // allocation was made with halide_malloc instead.
+    size_t prev_used;
+    size_t size;
+};
+
+WEAK size_t scratch_footprint(size_t size) {
+    const size_t alignment = halide_malloc_alignment();
+    return ((size + alignment - 1) & ~(alignment - 1)) + alignment;
+}
+
+}}}  // namespace Halide::Runtime::Internal
+
+using namespace Halide::Runtime::Internal;
+
+extern "C" {
+
+WEAK void *halide_scratch_arenas_create(void *user_context) {
+    scratch_arena_set *set = (scratch_arena_set *)halide_malloc(user_context, sizeof(scratch_arena_set));
+    if (set) {
+        memset(set, 0, sizeof(scratch_arena_set));
+        for (int i = 0; i < SCRATCH_ARENAS_PER_SET; i++) {
+            set->arenas[i].set = set;
+        }
+    }
+    return set;
+}
+
+WEAK void halide_scratch_arenas_destroy(void *user_context, void *ptr) {
+    scratch_arena_set *set = (scratch_arena_set *)ptr;
+    for (int i = 0; i < SCRATCH_ARENAS_PER_SET; i++) {
+        if (set->arenas[i].block) {
+            halide_free(user_context, set->arenas[i].block);
+        }
+    }
+    halide_free(user_context, set);
+}
+
+WEAK void *halide_scratch_arena_acquire(void *user_context, void *ptr) {
+    scratch_arena_set *set = (scratch_arena_set *)ptr;
+    scratch_arena *arena = NULL;
+    for (int i = 0; i < SCRATCH_ARENAS_PER_SET; i++) {
+        scratch_arena *a = &set->arenas[i];
+        if (!__atomic_load_n(&a->in_use, __ATOMIC_RELAXED) &&
+            __sync_bool_compare_and_swap(&a->in_use, 0, 1)) {
+            arena = a;
+            break;
+        }
+    }
+
+    if (!arena) {
+        // More tasks are running than there are arenas. Use a
+        // temporary one, which satisfies every request with
+        // halide_malloc.
+        arena = (scratch_arena *)halide_malloc(user_context, sizeof(scratch_arena));
+        if (arena) {
+            memset(arena, 0, sizeof(scratch_arena));
+        }
+        return arena;
+    }
+
+    if (arena->high_water > arena->capacity) {
+        // A previous task didn't fit. Grow the block to what it
+        // needed.
+        if (arena->block) {
+            halide_free(user_context, arena->block);
+        }
+        arena->block = (uint8_t *)halide_malloc(user_context, arena->high_water);
+        arena->capacity = arena->block ? arena->high_water : 0;
+    }
+    arena->used = 0;
+    arena->requested = 0;
+    return arena;
+}
+
+WEAK void halide_scratch_arena_release(void *user_context, void *ptr) {
+    scratch_arena *arena = (scratch_arena *)ptr;
+    if (!arena->set) {
+        halide_free(user_context, arena);
+        return;
+    }
+    arena->used = 0;
+    __sync_lock_release(&arena->in_use);
+}
+
+WEAK void *halide_scratch_arena_alloc(void *user_context, void *ptr, uint64_t size) {
+    const size_t alignment = halide_malloc_alignment();
+    scratch_arena *arena = (scratch_arena *)ptr;
+    size_t footprint = scratch_footprint((size_t)size);
+
+    arena->requested += footprint;
+    if (arena->requested > arena->high_water) {
+        arena->high_water = arena->requested;
+    }
+
+    uint8_t *result;
+    scratch_header *header;
+    if (arena->used + footprint <= arena->capacity) {
+        // The block is aligned, and so is every footprint, so the
+        // allocation is too.
+        result = arena->block + arena->used + alignment;
+        header = (scratch_header *)result - 1;
+        header->prev_used = arena->used;
+        arena->used += footprint;
+    } else {
+        uint8_t *p = (uint8_t *)halide_malloc(user_context, (size_t)size + alignment);
+        if (!p) {
+            arena->requested -= footprint;
+            return NULL;
+        }
+        result = p + alignment;
+        header = (scratch_header *)result - 1;
+        header->prev_used = ~(size_t)0;
+    }
+    header->arena = arena;
+    header->size = (size_t)size;
+    return result;
+}
+
+WEAK void halide_scratch_arena_free(void *user_context, void *ptr) {
+    const size_t alignment = halide_malloc_alignment();
+    scratch_header *header = (scratch_header *)ptr - 1;
+    scratch_arena *arena = header->arena;
+    size_t footprint = scratch_footprint(header->size);
+    arena->requested -= footprint;
+    if (header->prev_used == ~(size_t)0) {
+        halide_free(user_context, (uint8_t *)ptr - alignment);
+    } else if (header->prev_used + footprint == arena->used) {
+        // The most recent allocation in the block. Its space can be
+        // used again. Space freed out of order is reclaimed when the
+        // task is done.
+        arena->used = header->prev_used;
+    }
+}
+
+}  // extern "C"
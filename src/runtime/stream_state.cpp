@@ -0,0 +1,114 @@
+#include "HalideRuntime.h"
+#include "runtime_internal.h"
+#include "scoped_mutex_lock.h"
+
+// The state kept across calls to a pipeline for the Funcs scheduled
+// with Func::stream. Each streamed Func has a small header, in which
+// the pipeline records which part of the Func it has computed so far,
+// and a block holding its values. Both are looked up by name, so a
+// stream carries on from one call to the next for as long as the
+// pipeline keeps its name, and starts over after
+// halide_stream_state_reset. The memory comes from halide_malloc and
+// is only returned by halide_stream_state_reset.
+
+namespace Halide { namespace Runtime { namespace Internal {
+
+struct stream_state {
+    stream_state *next;
+    char *name;
+    void *header;
+    void *data;
+    uint64_t data_size;
+};
+
+WEAK stream_state *stream_states = NULL;
+WEAK halide_mutex stream_state_lock;
+
+WEAK void free_stream_state(void *user_context, stream_state *s) {
+    if (s->data) {
+        halide_free(user_context, s->data);
+    }
+    if (s->header) {
+        halide_free(user_context, s->header);
+    }
+    if (s->name) {
+        halide_free(user_context, s->name);
+    }
+    halide_free(user_context, s);
+}
+
+}}}  // namespace Halide::Runtime::Internal
+
+using namespace Halide::Runtime::Internal;
+
+extern "C" {
+
+WEAK void *halide_stream_state_acquire(void *user_context, const char *name, int32_t header_size) {
+    ScopedMutexLock lock(&stream_state_lock);
+
+    for (stream_state *s = stream_states; s; s = s->next) {
+        if (strcmp(s->name, name) == 0) {
+            return s->header;
+        }
+    }
+
+    // The first call of this stream. A zero header means nothing has
+    // been computed yet.
+    stream_state *s = (stream_state *)halide_malloc(user_context, sizeof(stream_state));
+    if (!s) {
+        return NULL;
+    }
+    memset(s, 0, sizeof(stream_state));
+    size_t name_size = strlen(name) + 1;
+    s->name = (char *)halide_malloc(user_context, name_size);
+    s->header = halide_malloc(user_context, header_size);
+    if (!s->name || !s->header) {
+        free_stream_state(user_context, s);
+        return NULL;
+    }
+    memcpy(s->name, name, name_size);
+    memset(s->header, 0, header_size);
+
+    s->next = stream_states;
+    stream_states = s;
+    return s->header;
+}
+
+WEAK void *halide_stream_state_data(void *user_context, void *header, uint64_t size) {
+    ScopedMutexLock lock(&stream_state_lock);
+
+    stream_state *s = stream_states;
+    while (s && s->header != header) {
+        s = s->next;
+    }
+    if (!s) {
+        return NULL;
+    }
+
+    // The size only changes along with the shape recorded in the
+    // header, so the pipeline has already decided to start over.
+    if (s->data_size != size || !s->data) {
+        if (s->data) {
+            halide_free(user_context, s->data);
+        }
+        s->data = halide_malloc(user_context, size ? size : 1);
+        s->data_size = s->data ? size : 0;
+    }
+    return s->data;
+}
+
+WEAK void halide_stream_state_release(void *user_context, void *ptr) {
+    // The state stays alive until halide_stream_state_reset.
+}
+
+WEAK void halide_stream_state_reset(void *user_context) {
+    ScopedMutexLock lock(&stream_state_lock);
+
+    while (stream_states) {
+        stream_state *s = stream_states;
+        stream_states = s->next;
+        free_stream_state(user_context, s);
+    }
+}
+
+}
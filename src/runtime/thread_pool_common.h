@@ -1,6 +1,19 @@
 
 namespace Halide { namespace Runtime { namespace Internal {
 
+// Platform-specific hooks for thread placement, implemented alongside
+// halide_spawn_thread. Fill cpus with the ids of the cpus belonging
+// to the given NUMA node and return how many there were, or return -1
+// if there is no such node (or the topology can't be queried).
+WEAK int get_numa_node_cpus(int node, int *cpus, int max_cpus);
+// Restrict the calling thread to run only on the given cpu. Returns
+// false if this isn't supported.
+WEAK bool pin_current_thread_to_cpu(int cpu);
+// Give back anything the calling thread kept hold of between the
+// tasks it ran. Called before a thread in the pool blocks, and before
+// a thread spawned for a fork exits.
+WEAK void release_task_resources();
+
 struct work {
     work *next_job;
     int (*f)(void *, int, uint8_t *);
@@ -9,11 +22,49 @@ struct work {
     uint8_t *closure;
     int active_workers;
     int exit_status;
-    bool running() { return next < max || active_workers > 0; }
+
+    // The most threads that may work on this job at once, counting
+    // the owner, or zero for no limit. One place is always kept free
+    // for the owner. Set from halide_get_thread_budget.
+    int max_workers;
+    // Whether the reserved threads of the pool may work on this job.
+    bool high_priority;
+
+    // Only used when the thread pool is in work-stealing mode. The
+    // task interval [next, max) is split into num_ranges contiguous
+    // ranges, one per participating thread. Each range is packed
+    // into a single 64-bit word, so that the thread that owns a range
+    // can claim tasks from its front, and other threads can steal
+    // from its back, using nothing more than a compare-and-swap.
+    uint64_t *ranges;
+    int num_ranges;
+    // Which ranges have been handed out to threads that joined this
+    // job. Protected by the work queue mutex.
+    bool *range_taken;
+    // The NUMA node of the thread each range is normally given to, or
+    // -1 if unknown. Range zero goes to threads that aren't part of the
+    // pool (e.g. the one that called halide_do_par_for), and range i +
+    // 1 goes to pool thread i.
+    int *range_numa_node;
+    // The number of tasks not yet claimed by any thread. Modified
+    // atomically.
+    int tasks_remaining;
+
+    bool stealing() { return ranges != NULL; }
+    bool tasks_pending() {
+        if (stealing()) {
+            return __atomic_load_n(&tasks_remaining, __ATOMIC_ACQUIRE) > 0;
+        } else {
+            return next < max;
+        }
+    }
+    bool running() { return tasks_pending() || active_workers > 0; }
 };
 
-// The work queue and thread pool is weak, so one big work queue is shared by all halide functions
-#define MAX_THREADS 64
+// The work queue and thread pool is weak, so one big work queue is
+// shared by all halide functions. Storage for threads is allocated as
+// needed, so this is only a sanity limit on HL_NUM_THREADS.
+#define MAX_THREADS 1024
 struct work_queue_t {
     // all fields are protected by this mutex.
     halide_mutex mutex;
@@ -39,12 +90,25 @@ struct work_queue_t {
     // more threads are required than are currently in the A team.
     halide_cond wakeup_b_team;
 
-    // Keep track of threads so they can be joined at shutdown
-    halide_thread *threads[MAX_THREADS];
+    // Keep track of threads so they can be joined at shutdown, along
+    // with the NUMA node each one was pinned to (or -1 if it
+    // wasn't). Both arrays have threads_capacity entries.
+    halide_thread **threads;
+    int *thread_numa_node;
+    int threads_capacity;
 
     // The number threads created
     int threads_created;
 
+    // Whether to pin each thread to its own cpu, set from
+    // HL_THREAD_AFFINITY at initialization. The cpus are listed in
+    // cpu_order grouped by NUMA node, and threads are assigned to
+    // them in that order, so that threads with adjacent ids (and thus
+    // adjacent ranges of tasks in work-stealing mode) share a node.
+    bool pin_threads;
+    int *cpu_order, *cpu_numa_node;
+    int num_cpus;
+
     // The desired number threads doing work.
     int desired_num_threads;
 
@@ -52,6 +116,33 @@ struct work_queue_t {
     // whether the thread pool has been initialized.
     bool shutdown, initialized;
 
+    // Whether jobs are distributed using per-thread ranges and
+    // work-stealing instead of claiming one task at a time from the
+    // shared job stack. Set from HL_WORK_STEALING at initialization.
+    bool work_stealing;
+
+    // Idle workers spin for up to spin_count iterations, watching for
+    // new jobs, before going to sleep on a condition variable. This
+    // saves each parallel loop in a sequence of short ones a wakeup
+    // per worker. spin_count adapts between max_spin_count / 16 and
+    // max_spin_count: it grows when spinning finds work, and shrinks
+    // when it doesn't. max_spin_count comes from HL_SPIN_COUNT at
+    // initialization, unless set by halide_set_thread_pool_spin_count.
+    int spin_count, max_spin_count;
+    bool max_spin_count_set;
+
+    // Incremented whenever a job is pushed, so that spinning threads
+    // can tell when there's a new job, even if the ones already on
+    // the stack are jobs they can't help with.
+    int jobs_pushed;
+
+    // The pool threads with ids below num_reserved_threads only work
+    // on high-priority jobs, so that those never wait for threads
+    // busy with other work. Set from HL_RESERVED_THREADS at
+    // initialization, unless set by halide_set_num_reserved_threads.
+    int num_reserved_threads;
+    bool num_reserved_threads_set;
+
     bool running() {
         return !shutdown;
     }
@@ -83,7 +174,337 @@ WEAK int default_desired_num_threads() {
     return desired_num_threads;
 }
 
-WEAK void worker_thread_already_locked(work *owned_job) {
+// The number of threads parallel loops are shared between.
+WEAK int thread_pool_num_threads() {
+    halide_mutex_lock(&work_queue.mutex);
+    int n = work_queue.desired_num_threads;
+    halide_mutex_unlock(&work_queue.mutex);
+    return clamp_num_threads(n ? n : default_desired_num_threads());
+}
+
+WEAK bool default_work_stealing() {
+    char *str = getenv("HL_WORK_STEALING");
+    return str && atoi(str) != 0;
+}
+
+WEAK int default_max_spin_count() {
+    char *str = getenv("HL_SPIN_COUNT");
+    if (str) {
+        int n = atoi(str);
+        return n > 0 ? n : 0;
+    }
+    return 4096;
+}
+
+WEAK int default_num_reserved_threads() {
+    char *str = getenv("HL_RESERVED_THREADS");
+    if (str) {
+        int n = atoi(str);
+        return n > 0 ? n : 0;
+    }
+    return 0;
+}
+
+WEAK bool default_pin_threads() {
+    char *str = getenv("HL_THREAD_AFFINITY");
+    return str && atoi(str) != 0;
+}
+
+// Work out which cpus to pin threads to, and in which order. Called
+// with the work queue lock held.
+WEAK void init_cpu_order() {
+    int max_cpus = halide_host_cpu_count();
+    if (max_cpus < 1) {
+        max_cpus = 1;
+    }
+    work_queue.cpu_order = (int *)malloc(max_cpus * sizeof(int));
+    work_queue.cpu_numa_node = (int *)malloc(max_cpus * sizeof(int));
+    work_queue.num_cpus = 0;
+    if (!work_queue.cpu_order || !work_queue.cpu_numa_node) {
+        // Run without pinning threads instead.
+        free(work_queue.cpu_order);
+        free(work_queue.cpu_numa_node);
+        work_queue.cpu_order = NULL;
+        work_queue.cpu_numa_node = NULL;
+        work_queue.pin_threads = false;
+        return;
+    }
+    for (int node = 0; work_queue.num_cpus < max_cpus; node++) {
+        int *cpus = work_queue.cpu_order + work_queue.num_cpus;
+        int n = get_numa_node_cpus(node, cpus, max_cpus - work_queue.num_cpus);
+        if (n < 0) {
+            break;
+        }
+        for (int i = 0; i < n; i++) {
+            work_queue.cpu_numa_node[work_queue.num_cpus++] = node;
+        }
+    }
+    if (work_queue.num_cpus == 0) {
+        // No NUMA topology available. Treat it as a single node.
+        for (int i = 0; i < max_cpus; i++) {
+            work_queue.cpu_order[i] = i;
+            work_queue.cpu_numa_node[i] = 0;
+        }
+        work_queue.num_cpus = max_cpus;
+    }
+}
+
+// Ranges of task indices are packed as (max << 32) | next.
+WEAK uint64_t pack_range(int next, int max) {
+    return ((uint64_t)(uint32_t)max << 32) | (uint64_t)(uint32_t)next;
+}
+
+WEAK int range_next(uint64_t r) {
+    return (int)(uint32_t)r;
+}
+
+WEAK int range_max(uint64_t r) {
+    return (int)(uint32_t)(r >> 32);
+}
+
+// Claim a single task from the front of a range. Returns false if
+// the range is empty.
+WEAK bool claim_from_front(uint64_t *range, int *idx) {
+    uint64_t old = __atomic_load_n(range, __ATOMIC_ACQUIRE);
+    while (true) {
+        int next = range_next(old), max = range_max(old);
+        if (next >= max) {
+            return false;
+        }
+        uint64_t seen = __sync_val_compare_and_swap(range, old, pack_range(next + 1, max));
+        if (seen == old) {
+            *idx = next;
+            return true;
+        }
+        old = seen;
+    }
+}
+
+// Steal either the back half of a range (rounding up, so that a range
+// with a single task can be stolen), or just its last task. Returns
+// false if the range is empty.
+WEAK bool steal_from_back(uint64_t *range, bool take_half, int *stolen_min, int *stolen_max) {
+    uint64_t old = __atomic_load_n(range, __ATOMIC_ACQUIRE);
+    while (true) {
+        int next = range_next(old), max = range_max(old);
+        if (next >= max) {
+            return false;
+        }
+        int mid = take_half ? next + (max - next) / 2 : max - 1;
+        uint64_t seen = __sync_val_compare_and_swap(range, old, pack_range(next, mid));
+        if (seen == old) {
+            *stolen_min = mid;
+            *stolen_max = max;
+            return true;
+        }
+        old = seen;
+    }
+}
+
+// Find a task to do on a work-stealing job, first from our own range
+// (if we have one), and then by stealing from the largest other
+// range, preferring ranges that belong to threads on our own NUMA
+// node. Called without the work queue lock held. Returns false if
+// there are no unclaimed tasks left in any range.
+WEAK bool find_task(work *job, int home, int numa_node, int *idx) {
+    uint64_t *my_range = home >= 0 ? job->ranges + home : NULL;
+    if (my_range && claim_from_front(my_range, idx)) {
+        __sync_fetch_and_sub(&job->tasks_remaining, 1);
+        return true;
+    }
+
+    while (job->tasks_pending()) {
+        int victim = -1, victim_size = 0;
+        int local_victim = -1, local_victim_size = 0;
+        for (int i = 0; i < job->num_ranges; i++) {
+            uint64_t r = __atomic_load_n(job->ranges + i, __ATOMIC_ACQUIRE);
+            int size = range_max(r) - range_next(r);
+            if (size > victim_size) {
+                victim = i;
+                victim_size = size;
+            }
+            if (numa_node >= 0 && size > local_victim_size &&
+                job->range_numa_node[i] == numa_node) {
+                local_victim = i;
+                local_victim_size = size;
+            }
+        }
+        if (local_victim >= 0) {
+            victim = local_victim;
+        }
+        if (victim < 0) {
+            // Every range is empty. Any remaining tasks are in the
+            // middle of being moved by another thief, which will do
+            // them itself.
+            return false;
+        }
+        // Threads with a range of their own to refill steal half of
+        // the victim's tasks. Threads without one take a single task.
+        int stolen_min, stolen_max;
+        if (steal_from_back(job->ranges + victim, my_range != NULL, &stolen_min, &stolen_max)) {
+            if (stolen_max - stolen_min > 1) {
+                // Our range is empty, and no other thread modifies an
+                // empty range, so we can refill it with a plain store.
+                __atomic_store_n(my_range, pack_range(stolen_min + 1, stolen_max), __ATOMIC_RELEASE);
+            }
+            *idx = stolen_min;
+            __sync_fetch_and_sub(&job->tasks_remaining, 1);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Remove a job from wherever it is on the job stack. Called with the
+// work queue lock held.
+WEAK void remove_job(work *job) {
+    work **ptr = &work_queue.jobs;
+    while (*ptr) {
+        if (*ptr == job) {
+            *ptr = job->next_job;
+            return;
+        }
+        ptr = &((*ptr)->next_job);
+    }
+}
+
+// Participate in a work-stealing job until there are no unclaimed
+// tasks left in it. thread_id is the calling thread's index in the
+// pool, or -1 if it isn't a pool thread. Called with the work queue
+// lock held.
+WEAK void do_stealing_job_already_locked(work *job, int thread_id) {
+    // Threads take the same range of every job when they can, so
+    // that a given part of a buffer tends to be touched by the same
+    // thread (and thus NUMA node) each time.
+    int home = -1;
+    int preferred = thread_id + 1;
+    if (preferred < job->num_ranges && !job->range_taken[preferred]) {
+        home = preferred;
+    } else {
+        for (int i = 0; i < job->num_ranges; i++) {
+            if (!job->range_taken[i]) {
+                home = i;
+                break;
+            }
+        }
+    }
+    if (home >= 0) {
+        job->range_taken[home] = true;
+    }
+    int numa_node = thread_id >= 0 ? work_queue.thread_numa_node[thread_id] : -1;
+    job->active_workers++;
+    halide_mutex_unlock(&work_queue.mutex);
+
+    int exit_status = 0;
+    int idx;
+    while (find_task(job, home, numa_node, &idx)) {
+        int result = halide_do_task(job->user_context, job->f, idx, job->closure);
+        if (result) {
+            exit_status = result;
+        }
+    }
+
+    halide_mutex_lock(&work_queue.mutex);
+    if (exit_status) {
+        job->exit_status = exit_status;
+    }
+    if (!job->tasks_pending()) {
+        remove_job(job);
+    }
+    job->active_workers--;
+}
+
+// Check if a thread may start working on a job, given the job's
+// thread budget and priority. Owners can always work on their own
+// jobs. Called with the work queue lock held.
+WEAK bool can_join_job(work *job, work *owned_job, int thread_id) {
+    if (job == owned_job) {
+        return true;
+    }
+    if (!job->high_priority && thread_id >= 0 &&
+        thread_id < work_queue.num_reserved_threads) {
+        return false;
+    }
+    return job->max_workers <= 0 || job->active_workers < job->max_workers - 1;
+}
+
+// Find a job that still has tasks to claim and that the calling
+// thread may join. Prefers high-priority jobs, and then jobs nearer
+// the top of the stack. Drops work-stealing jobs whose tasks have all
+// been claimed along the way. An owner waiting for its own job to
+// finish only looks as far down as that job. The jobs below it belong
+// to enclosing parallel loops or to other callers, and one of their
+// tasks could run for much longer than the rest of the owner's job,
+// or block on it. The jobs above it, which include any loops nested
+// inside its own tasks, are fair game. Called with the work queue
+// lock held.
+WEAK work *find_job_already_locked(work *owned_job, int thread_id) {
+    work *result = NULL;
+    work **ptr = &work_queue.jobs;
+    while (*ptr) {
+        work *job = *ptr;
+        if (!job->tasks_pending()) {
+            // Every task has been claimed. The threads still working
+            // on it will wake the owner when they're done.
+            *ptr = job->next_job;
+        } else {
+            if (can_join_job(job, owned_job, thread_id)) {
+                if (job->high_priority) {
+                    return job;
+                } else if (!result) {
+                    result = job;
+                }
+            }
+            ptr = &job->next_job;
+        }
+        if (job == owned_job) {
+            break;
+        }
+    }
+    return result;
+}
+
+// Wait a little while for a job to be enqueued without going to
+// sleep. Called with the work queue lock held, which is released
+// while spinning. Returns true if a job was pushed (or the pool is
+// shutting down) by the time the lock is reacquired.
+WEAK bool spin_for_work_already_locked() {
+    int n = work_queue.spin_count;
+    if (n <= 0) {
+        return false;
+    }
+    int jobs_pushed = work_queue.jobs_pushed;
+    halide_mutex_unlock(&work_queue.mutex);
+    for (int i = 0; i < n; i++) {
+        // The lock isn't held, so these are only hints.
+        if (__atomic_load_n(&work_queue.jobs_pushed, __ATOMIC_RELAXED) != jobs_pushed ||
+            __atomic_load_n(&work_queue.shutdown, __ATOMIC_RELAXED)) {
+            break;
+        }
+        // Stop the compiler from optimizing the loop away or
+        // hoisting the loads out of it.
+        __asm__ __volatile__("" ::: "memory");
+    }
+    halide_mutex_lock(&work_queue.mutex);
+
+    bool found = work_queue.jobs_pushed != jobs_pushed || work_queue.shutdown;
+    // Round up, so that spinning is never adapted away entirely.
+    int min_spin_count = (work_queue.max_spin_count + 15) / 16;
+    if (found) {
+        work_queue.spin_count *= 2;
+        if (work_queue.spin_count > work_queue.max_spin_count) {
+            work_queue.spin_count = work_queue.max_spin_count;
+        }
+    } else {
+        work_queue.spin_count /= 2;
+        if (work_queue.spin_count < min_spin_count) {
+            work_queue.spin_count = min_spin_count;
+        }
+    }
+    return found;
+}
+
+WEAK void worker_thread_already_locked(work *owned_job, int thread_id) {
     // If I'm a job owner, then I was the thread that called
     // do_par_for, and I should only stay in this function until my
     // job is complete. If I'm a lowly worker thread, I should stay in
@@ -91,34 +512,48 @@ WEAK void worker_thread_already_locked(work *owned_job) {
     while (owned_job != NULL ? owned_job->running()
            : work_queue.running()) {
 
-        if (work_queue.jobs == NULL) {
+        work *job = find_job_already_locked(owned_job, thread_id);
+        if (job == NULL) {
             if (owned_job) {
-                // There are no jobs pending. Wait for the last worker
-                // to signal that the job is finished.
+                // There are no jobs we can help with. Wait for the
+                // last worker to signal that the job is finished, or
+                // for a nested job to be enqueued.
+                release_task_resources();
                 halide_cond_wait(&work_queue.wakeup_owners, &work_queue.mutex);
+            } else if (spin_for_work_already_locked()) {
+                // A job arrived while spinning. Threads in excess of
+                // the A team also spin before moving to the B team,
+                // so that a larger parallel loop right after a small
+                // one still finds them awake.
+                continue;
             } else if (work_queue.a_team_size <= work_queue.target_a_team_size) {
                 // There are no jobs pending. Wait until more jobs are enqueued.
+                release_task_resources();
                 halide_cond_wait(&work_queue.wakeup_a_team, &work_queue.mutex);
             } else {
                 // There are no jobs pending, and there are too many
                 // threads in the A team. Transition to the B team
                 // until the wakeup_b_team condition is fired.
                 work_queue.a_team_size--;
+                release_task_resources();
                 halide_cond_wait(&work_queue.wakeup_b_team, &work_queue.mutex);
                 work_queue.a_team_size++;
             }
-        } else {
-            // Grab the next job.
-            work *job = work_queue.jobs;
+        } else if (job->stealing()) {
+            do_stealing_job_already_locked(job, thread_id);
 
-            // Claim a task from it.
+            if (!job->running() && job != owned_job) {
+                halide_cond_broadcast(&work_queue.wakeup_owners);
+            }
+        } else {
+            // Claim a task from the job.
             work myjob = *job;
             job->next++;
 
             // If there were no more tasks pending for this job,
             // remove it from the stack.
             if (job->next == job->max) {
-                work_queue.jobs = job->next_job;
+                remove_job(job);
             }
 
             // Increment the active_worker count so that other threads
@@ -149,12 +584,84 @@ WEAK void worker_thread_already_locked(work *owned_job) {
     }
 }
 
-WEAK void worker_thread(void *) {
+WEAK void worker_thread(void *arg) {
+    int thread_id = (int)(intptr_t)arg;
     halide_mutex_lock(&work_queue.mutex);
-    worker_thread_already_locked(NULL);
+    if (work_queue.pin_threads) {
+        int cpu = (thread_id + 1) % work_queue.num_cpus;
+        if (pin_current_thread_to_cpu(work_queue.cpu_order[cpu])) {
+            work_queue.thread_numa_node[thread_id] = work_queue.cpu_numa_node[cpu];
+        }
+    }
+    worker_thread_already_locked(NULL, thread_id);
     halide_mutex_unlock(&work_queue.mutex);
 }
 
+// Make sure there is room to keep track of at least n threads, if
+// memory allows. Called with the work queue lock held.
+WEAK void reserve_threads(int n) {
+    if (n <= work_queue.threads_capacity) {
+        return;
+    }
+    int capacity = work_queue.threads_capacity * 2;
+    if (capacity < n) {
+        capacity = n;
+    }
+    halide_thread **threads = (halide_thread **)malloc(capacity * sizeof(halide_thread *));
+    int *thread_numa_node = (int *)malloc(capacity * sizeof(int));
+    if (!threads || !thread_numa_node) {
+        // Keep the old arrays. Callers spawn no more threads than fit.
+        free(threads);
+        free(thread_numa_node);
+        return;
+    }
+    if (work_queue.threads_created) {
+        memcpy(threads, work_queue.threads, work_queue.threads_created * sizeof(halide_thread *));
+        memcpy(thread_numa_node, work_queue.thread_numa_node, work_queue.threads_created * sizeof(int));
+    }
+    free(work_queue.threads);
+    free(work_queue.thread_numa_node);
+    work_queue.threads = threads;
+    work_queue.thread_numa_node = thread_numa_node;
+    work_queue.threads_capacity = capacity;
+}
+
+// The state behind a halide_semaphore_t. Generated code initializes
+// the count directly, so it must come first.
+struct semaphore_impl {
+    int count;
+    int aborted;
+};
+
+// Semaphores are only waited on by the tasks of a fork, so they
+// share one lock and condition variable.
+WEAK halide_mutex semaphore_mutex = { { 0 } };
+WEAK halide_cond semaphore_cond;
+WEAK bool semaphore_cond_initialized = false;
+
+// Called with the semaphore lock held.
+WEAK void init_semaphore_cond() {
+    if (!semaphore_cond_initialized) {
+        halide_cond_init(&semaphore_cond);
+        semaphore_cond_initialized = true;
+    }
+}
+
+struct fork_task {
+    void *user_context;
+    halide_task_t f;
+    int idx;
+    uint8_t *closure;
+    int result;
+    halide_thread *thread;
+};
+
+WEAK void fork_task_thread(void *arg) {
+    fork_task *task = (fork_task *)arg;
+    task->result = halide_do_task(task->user_context, task->f, task->idx, task->closure);
+    release_task_resources();
+}
+
 }}}  // namespace Halide::Runtime::Internal
 
 using namespace Halide::Runtime::Internal;
@@ -166,6 +673,12 @@ WEAK int halide_default_do_task(void *user_context, halide_task_t f, int idx,
     return f(user_context, idx, closure);
 }
 
+WEAK void halide_get_thread_budget(void *user_context, int *max_threads,
+                                   halide_thread_priority_t *priority) {
+    *max_threads = 0;
+    *priority = halide_thread_priority_normal;
+}
+
 WEAK int halide_default_do_par_for(void *user_context, halide_task_t f,
                                    int min, int size, uint8_t *closure) {
     // Our for loops are expected to gracefully handle sizes <= 0
@@ -173,6 +686,10 @@ WEAK int halide_default_do_par_for(void *user_context, halide_task_t f,
         return 0;
     }
 
+    int max_threads = 0;
+    halide_thread_priority_t priority = halide_thread_priority_normal;
+    halide_get_thread_budget(user_context, &max_threads, &priority);
+
     // Grab the lock. If it hasn't been initialized yet, then the
     // field will be zero-initialized because it's a static global.
     halide_mutex_lock(&work_queue.mutex);
@@ -196,14 +713,33 @@ WEAK int halide_default_do_par_for(void *user_context, halide_task_t f,
         // Everyone starts on the a team.
         work_queue.a_team_size = work_queue.desired_num_threads;
 
+        if (!work_queue.max_spin_count_set) {
+            work_queue.max_spin_count = default_max_spin_count();
+        }
+        work_queue.spin_count = work_queue.max_spin_count;
+        if (!work_queue.num_reserved_threads_set) {
+            work_queue.num_reserved_threads = default_num_reserved_threads();
+        }
+
+        work_queue.work_stealing = default_work_stealing();
+        work_queue.pin_threads = default_pin_threads();
+        if (work_queue.pin_threads) {
+            init_cpu_order();
+        }
+
         work_queue.initialized = true;
     }
 
-    while (work_queue.threads_created < work_queue.desired_num_threads - 1) {
+    if (work_queue.threads_created < work_queue.desired_num_threads - 1) {
+        reserve_threads(work_queue.desired_num_threads - 1);
+    }
+    while (work_queue.threads_created < work_queue.desired_num_threads - 1 &&
+           work_queue.threads_created < work_queue.threads_capacity) {
         // We might need to make some new threads, if work_queue.desired_num_threads has
         // increased.
-        work_queue.threads[work_queue.threads_created++] =
-            halide_spawn_thread(worker_thread, NULL);
+        int id = work_queue.threads_created++;
+        work_queue.thread_numa_node[id] = -1;
+        work_queue.threads[id] = halide_spawn_thread(worker_thread, (void *)(intptr_t)id);
     }
 
     // Make the job.
@@ -215,13 +751,46 @@ WEAK int halide_default_do_par_for(void *user_context, halide_task_t f,
     job.closure = closure;   // Use this closure.
     job.exit_status = 0;     // The job hasn't failed yet
     job.active_workers = 0;  // Nobody is working on this yet
+    job.ranges = NULL;       // Not a work-stealing job unless set below
+    job.max_workers = max_threads;
+    job.high_priority = priority == halide_thread_priority_high;
+
+    if (work_queue.work_stealing) {
+        // Give each thread that might join this job an equal share of
+        // the task interval to start with.
+        int n = work_queue.desired_num_threads;
+        if (n > size) {
+            n = size;
+        }
+        if (max_threads > 0 && n > max_threads) {
+            n = max_threads;
+        }
+        job.ranges = (uint64_t *)__builtin_alloca(n * sizeof(uint64_t));
+        job.range_taken = (bool *)__builtin_alloca(n * sizeof(bool));
+        job.range_numa_node = (int *)__builtin_alloca(n * sizeof(int));
+        for (int i = 0; i < n; i++) {
+            int range_min = min + (int)(((int64_t)size * i) / n);
+            int range_max = min + (int)(((int64_t)size * (i + 1)) / n);
+            job.ranges[i] = pack_range(range_min, range_max);
+            job.range_taken[i] = false;
+            job.range_numa_node[i] = (i > 0 && i <= work_queue.threads_created) ?
+                work_queue.thread_numa_node[i - 1] : -1;
+        }
+        job.num_ranges = n;
+        job.tasks_remaining = size;
+    }
 
-    if (!work_queue.jobs && size < work_queue.desired_num_threads) {
+    int useful_threads = size;
+    if (max_threads > 0 && max_threads < useful_threads) {
+        useful_threads = max_threads;
+    }
+    if (!work_queue.jobs && useful_threads < work_queue.desired_num_threads) {
         // If there's no nested parallelism happening and there are
-        // fewer tasks to do than threads, then set the target A team
-        // size so that some threads will put themselves to sleep
-        // until a larger job arrives.
-        work_queue.target_a_team_size = size;
+        // fewer tasks to do (or fewer threads allowed to do them)
+        // than threads, then set the target A team size so that some
+        // threads will put themselves to sleep until a larger job
+        // arrives.
+        work_queue.target_a_team_size = useful_threads;
     } else {
         // Otherwise the target A team size is
         // desired_num_threads. This may still be less than
@@ -233,6 +802,7 @@ WEAK int halide_default_do_par_for(void *user_context, halide_task_t f,
     // Push the job onto the stack.
     job.next_job = work_queue.jobs;
     work_queue.jobs = &job;
+    __atomic_fetch_add(&work_queue.jobs_pushed, 1, __ATOMIC_RELAXED);
 
     // Wake up our A team.
     halide_cond_broadcast(&work_queue.wakeup_a_team);
@@ -243,8 +813,15 @@ WEAK int halide_default_do_par_for(void *user_context, halide_task_t f,
         halide_cond_broadcast(&work_queue.wakeup_b_team);
     }
 
-    // Do some work myself.
-    worker_thread_already_locked(&job);
+    // If this job is nested inside another, owners waiting for their
+    // own jobs to finish can help with it instead of sitting idle.
+    if (job.next_job) {
+        halide_cond_broadcast(&work_queue.wakeup_owners);
+    }
+
+    // Do some work myself. We don't know whether or not we're one of
+    // the pool's threads, so we don't claim any particular range.
+    worker_thread_already_locked(&job, -1);
 
     halide_mutex_unlock(&work_queue.mutex);
 
@@ -253,6 +830,79 @@ WEAK int halide_default_do_par_for(void *user_context, halide_task_t f,
     return job.exit_status;
 }
 
+WEAK int halide_do_fork(void *user_context, halide_task_t f,
+                        int min, int size, uint8_t *closure) {
+    if (size <= 0) {
+        return 0;
+    }
+    fork_task *tasks = (fork_task *)malloc(size * sizeof(fork_task));
+    if (!tasks) {
+        return halide_error_code_out_of_memory;
+    }
+
+    // The tasks may block on each other, so they can't share the
+    // worker threads of the pool. Run the first one on this thread,
+    // and give each of the others a thread of its own.
+    for (int i = 0; i < size; i++) {
+        tasks[i].user_context = user_context;
+        tasks[i].f = f;
+        tasks[i].idx = min + i;
+        tasks[i].closure = closure;
+        tasks[i].result = 0;
+        tasks[i].thread = NULL;
+    }
+    for (int i = 1; i < size; i++) {
+        tasks[i].thread = halide_spawn_thread(fork_task_thread, &tasks[i]);
+    }
+    fork_task_thread(&tasks[0]);
+
+    int result = tasks[0].result;
+    for (int i = 1; i < size; i++) {
+        halide_join_thread(tasks[i].thread);
+        if (result == 0) {
+            result = tasks[i].result;
+        }
+    }
+    free(tasks);
+    return result;
+}
+
+WEAK int halide_semaphore_release(halide_semaphore_t *s, int n) {
+    semaphore_impl *sem = (semaphore_impl *)s;
+    halide_mutex_lock(&semaphore_mutex);
+    init_semaphore_cond();
+    sem->count += n;
+    halide_cond_broadcast(&semaphore_cond);
+    halide_mutex_unlock(&semaphore_mutex);
+    return 0;
+}
+
+WEAK int halide_semaphore_acquire(halide_semaphore_t *s, int n) {
+    semaphore_impl *sem = (semaphore_impl *)s;
+    halide_mutex_lock(&semaphore_mutex);
+    init_semaphore_cond();
+    while (sem->count < n && !sem->aborted) {
+        halide_cond_wait(&semaphore_cond, &semaphore_mutex);
+    }
+    int result = 0;
+    if (sem->count >= n) {
+        sem->count -= n;
+    } else {
+        result = halide_error_code_generic_error;
+    }
+    halide_mutex_unlock(&semaphore_mutex);
+    return result;
+}
+
+WEAK void halide_semaphore_abort_as_destructor(void *user_context, void *s) {
+    semaphore_impl *sem = (semaphore_impl *)s;
+    halide_mutex_lock(&semaphore_mutex);
+    init_semaphore_cond();
+    sem->aborted = 1;
+    halide_cond_broadcast(&semaphore_cond);
+    halide_mutex_unlock(&semaphore_mutex);
+}
+
 WEAK int halide_set_num_threads(int n) {
     if (n < 0) {
         halide_error(NULL, "halide_set_num_threads: must be >= 0.");
@@ -270,6 +920,35 @@ WEAK int halide_set_num_threads(int n) {
     return old;
 }
 
+WEAK int halide_set_thread_pool_spin_count(int n) {
+    if (n < 0) {
+        halide_error(NULL, "halide_set_thread_pool_spin_count: must be >= 0.");
+        n = 0;
+    }
+    halide_mutex_lock(&work_queue.mutex);
+    int old = work_queue.max_spin_count_set || work_queue.initialized ?
+        work_queue.max_spin_count : default_max_spin_count();
+    work_queue.max_spin_count = n;
+    work_queue.max_spin_count_set = true;
+    work_queue.spin_count = n;
+    halide_mutex_unlock(&work_queue.mutex);
+    return old;
+}
+
+WEAK int halide_set_num_reserved_threads(int n) {
+    if (n < 0) {
+        halide_error(NULL, "halide_set_num_reserved_threads: must be >= 0.");
+        n = 0;
+    }
+    halide_mutex_lock(&work_queue.mutex);
+    int old = work_queue.num_reserved_threads_set || work_queue.initialized ?
+        work_queue.num_reserved_threads : default_num_reserved_threads();
+    work_queue.num_reserved_threads = n;
+    work_queue.num_reserved_threads_set = true;
+    halide_mutex_unlock(&work_queue.mutex);
+    return old;
+}
+
 WEAK void halide_shutdown_thread_pool() {
     if (!work_queue.initialized) return;
 
@@ -288,6 +967,15 @@ WEAK void halide_shutdown_thread_pool() {
     }
 
     // Tidy up
+    free(work_queue.threads);
+    free(work_queue.thread_numa_node);
+    work_queue.threads = NULL;
+    work_queue.thread_numa_node = NULL;
+    work_queue.threads_capacity = 0;
+    free(work_queue.cpu_order);
+    free(work_queue.cpu_numa_node);
+    work_queue.cpu_order = NULL;
+    work_queue.cpu_numa_node = NULL;
     halide_mutex_destroy(&work_queue.mutex);
     halide_cond_destroy(&work_queue.wakeup_owners);
     halide_cond_destroy(&work_queue.wakeup_a_team);
@@ -15,6 +15,109 @@ WEAK int halide_trace_file_lock = 0;
 WEAK bool halide_trace_file_initialized = false;
 WEAK void *halide_trace_file_internally_opened = NULL;
 
+// Keep only one in this many load and store events. Set from
+// HL_TRACE_SAMPLE along with the trace file.
+WEAK int halide_trace_sample_rate = 1;
+
+// An asynchronous sink for binary trace packets, used when
+// HL_TRACE_BUFFER_SIZE is set. Threads reserve space in a ring buffer
+// with an atomic add, copy their packet in, and then publish it by
+// writing its size field last. A background thread writes published
+// packets to the trace file in the order they were reserved, and
+// zeroes the space behind it so that it reads as unpublished the next
+// time around.
+struct TraceBuffer {
+    uint8_t *buf;
+    // A power of two.
+    uint64_t size;
+    // The number of bytes reserved and written out so far.
+    volatile uint64_t head, tail;
+    volatile bool stop;
+    int fd;
+    halide_thread *flusher;
+};
+
+WEAK TraceBuffer *halide_trace_buffer = NULL;
+
+WEAK void trace_buffer_copy_in(TraceBuffer *b, uint64_t offset, const void *src, uint32_t bytes) {
+    uint64_t start = offset & (b->size - 1);
+    uint64_t first = b->size - start;
+    if (first >= bytes) {
+        memcpy(b->buf + start, src, bytes);
+    } else {
+        memcpy(b->buf + start, src, first);
+        memcpy(b->buf, (const uint8_t *)src + first, bytes - first);
+    }
+}
+
+WEAK void trace_buffer_write_out(TraceBuffer *b, uint64_t begin, uint64_t end) {
+    while (begin < end) {
+        uint64_t start = begin & (b->size - 1);
+        uint64_t bytes = b->size - start;
+        if (bytes > end - begin) {
+            bytes = end - begin;
+        }
+        // If this fails there's nobody to tell, so drop the data.
+        write(b->fd, b->buf + start, bytes);
+        memset(b->buf + start, 0, bytes);
+        begin += bytes;
+    }
+}
+
+WEAK void trace_buffer_flusher(void *arg) {
+    TraceBuffer *b = (TraceBuffer *)arg;
+    while (true) {
+        uint64_t t = b->tail, h = b->head, end = t;
+        // Find the run of consecutive published packets.
+        while (end < h) {
+            uint32_t size = *(volatile uint32_t *)(b->buf + (end & (b->size - 1)));
+            if (size == 0) break;
+            end += size;
+        }
+        if (end == t) {
+            if (b->stop && h == t) break;
+            halide_sleep_ms(NULL, 1);
+            continue;
+        }
+        __sync_synchronize();
+        trace_buffer_write_out(b, t, end);
+        __sync_synchronize();
+        b->tail = end;
+    }
+}
+
+WEAK TraceBuffer *trace_buffer_create(void *user_context, int fd, uint64_t size) {
+    // Round up to a power of two, and make sure a large packet fits.
+    uint64_t rounded = 1 << 16;
+    while (rounded < size) rounded <<= 1;
+    TraceBuffer *b = (TraceBuffer *)malloc(sizeof(TraceBuffer));
+    if (!b) return NULL;
+    b->buf = (uint8_t *)malloc(rounded);
+    if (!b->buf) {
+        free(b);
+        return NULL;
+    }
+    memset(b->buf, 0, rounded);
+    b->size = rounded;
+    b->head = b->tail = 0;
+    b->stop = false;
+    b->fd = fd;
+    b->flusher = halide_spawn_thread(trace_buffer_flusher, b);
+    if (!b->flusher) {
+        free(b->buf);
+        free(b);
+        return NULL;
+    }
+    return b;
+}
+
+WEAK void trace_buffer_destroy(TraceBuffer *b) {
+    b->stop = true;
+    halide_join_thread(b->flusher);
+    free(b->buf);
+    free(b);
+}
+
 }}}
 
 extern "C" {
@@ -24,8 +127,15 @@ WEAK int32_t halide_default_trace(void *user_context, const halide_trace_event_t
 
     int32_t my_id = __sync_fetch_and_add(&ids, 1);
 
-    // If we're dumping to a file, use a binary format
     int fd = halide_get_trace_file(user_context);
+
+    if (halide_trace_sample_rate > 1 &&
+        (e->event == halide_trace_load || e->event == halide_trace_store) &&
+        (my_id % halide_trace_sample_rate) != 0) {
+        return my_id;
+    }
+
+    // If we're dumping to a file, use a binary format
     if (fd > 0) {
         // Compute the total packet size
         uint32_t value_bytes = (uint32_t)(e->type.lanes * e->type.bytes());
@@ -46,6 +156,33 @@ WEAK int32_t halide_default_trace(void *user_context, const halide_trace_event_t
         header.value_index = e->value_index;
         header.dimensions = e->dimensions;
 
+        TraceBuffer *b = halide_trace_buffer;
+        if (b) {
+            halide_assert(user_context, total_size <= b->size && "Trace packet larger than HL_TRACE_BUFFER_SIZE");
+            uint64_t offset = __sync_fetch_and_add(&b->head, (uint64_t)total_size);
+            // Wait for the flusher to make room.
+            while (offset + total_size - b->tail > b->size) { }
+            uint64_t o = offset + sizeof(header);
+            if (e->coordinates) {
+                trace_buffer_copy_in(b, o, e->coordinates, coords_bytes);
+            }
+            o += coords_bytes;
+            if (e->value) {
+                trace_buffer_copy_in(b, o, e->value, value_bytes);
+            }
+            o += value_bytes;
+            trace_buffer_copy_in(b, o, e->func, name_bytes);
+            // The padding is already zero. Publish the packet by
+            // writing the header, with the size going in last. The
+            // size is at a multiple of four bytes into a buffer
+            // whose size is a multiple of four, so it doesn't wrap.
+            header.size = 0;
+            trace_buffer_copy_in(b, offset, &header, sizeof(header));
+            __sync_synchronize();
+            *(volatile uint32_t *)(b->buf + (offset & (b->size - 1))) = total_size;
+            return my_id;
+        }
+
         size_t written = 0;
         {
             ScopedSpinLock lock(&halide_trace_file_lock);
@@ -202,6 +339,14 @@ WEAK int halide_get_trace_file(void *user_context) {
         } else {
             halide_set_trace_file(0);
         }
+        const char *sample = getenv("HL_TRACE_SAMPLE");
+        if (sample && atoi(sample) > 1) {
+            halide_trace_sample_rate = atoi(sample);
+        }
+        const char *buffer_size = getenv("HL_TRACE_BUFFER_SIZE");
+        if (buffer_size && atoi(buffer_size) > 0 && halide_trace_file > 0) {
+            halide_trace_buffer = trace_buffer_create(user_context, halide_trace_file, atoi(buffer_size));
+        }
     }
     return halide_trace_file;
 }
@@ -211,6 +356,11 @@ WEAK int32_t halide_trace(void *user_context, const halide_trace_event_t *e) {
 }
 
 WEAK int halide_shutdown_trace() {
+    if (halide_trace_buffer) {
+        // Write out everything still in flight before closing the file.
+        trace_buffer_destroy(halide_trace_buffer);
+        halide_trace_buffer = NULL;
+    }
     if (halide_trace_file_internally_opened) {
         int ret = fclose(halide_trace_file_internally_opened);
         halide_trace_file = 0;
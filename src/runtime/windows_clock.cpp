@@ -38,4 +38,9 @@ WEAK void halide_sleep_ms(void *user_context, int ms) {
     Sleep(ms);
 }
 
+WEAK void halide_sleep_us(void *user_context, int us) {
+    // Sleep has millisecond granularity. Sleep(0) just yields.
+    Sleep(us / 1000);
+}
+
 }
@@ -28,6 +28,18 @@ extern WIN32API void LeaveCriticalSection(CriticalSection *);
 extern WIN32API int32_t WaitForSingleObject(Thread, int32_t timeout);
 extern WIN32API bool InitOnceExecuteOnce(InitOnce *, bool WIN32API (*f)(InitOnce *, void *, void **), void *, void **);
 
+// The cpus of a processor group, as a bitmask.
+typedef struct {
+    uintptr_t mask;
+    uint16_t group;
+    uint16_t reserved[3];
+} GroupAffinity;
+
+extern WIN32API bool GetNumaHighestNodeNumber(uint32_t *);
+extern WIN32API bool GetNumaNodeProcessorMaskEx(uint16_t, GroupAffinity *);
+extern WIN32API bool SetThreadGroupAffinity(Thread, const GroupAffinity *, GroupAffinity *);
+extern WIN32API Thread GetCurrentThread();
+
 } // extern "C"
 
 namespace Halide { namespace Runtime { namespace Internal {
@@ -53,6 +65,42 @@ WEAK void *spawn_thread_helper(void *arg) {
     return NULL;
 }
 
+// Cpus are numbered by processor group and then by their bit within
+// the group's mask.
+const int cpus_per_group = sizeof(uintptr_t) * 8;
+
+WEAK int get_numa_node_cpus(int node, int *cpus, int max_cpus) {
+    uint32_t highest = 0;
+    if (!GetNumaHighestNodeNumber(&highest) || node > (int)highest) {
+        return -1;
+    }
+    GroupAffinity affinity;
+    memset(&affinity, 0, sizeof(affinity));
+    if (!GetNumaNodeProcessorMaskEx((uint16_t)node, &affinity)) {
+        // A node with no cpus.
+        return 0;
+    }
+    int count = 0;
+    for (int i = 0; i < cpus_per_group && count < max_cpus; i++) {
+        if (affinity.mask & ((uintptr_t)1 << i)) {
+            cpus[count++] = affinity.group * cpus_per_group + i;
+        }
+    }
+    return count;
+}
+
+WEAK bool pin_current_thread_to_cpu(int cpu) {
+    GroupAffinity affinity;
+    memset(&affinity, 0, sizeof(affinity));
+    affinity.mask = (uintptr_t)1 << (cpu % cpus_per_group);
+    affinity.group = (uint16_t)(cpu / cpus_per_group);
+    return SetThreadGroupAffinity(GetCurrentThread(), &affinity, NULL);
+}
+
+// Tasks don't keep anything between them here.
+WEAK void release_task_resources() {
+}
+
 }}} // namespace Halide::Runtime::Internal
 
 extern "C" {
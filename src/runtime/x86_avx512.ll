@@ -0,0 +1,141 @@
+; Helpers for AVX-512BW. Most of the 512-bit integer intrinsics are only
+; available in masked form in the llvm versions we support, so these
+; wrap them with an all-true mask.
+
+declare <64 x i8> @llvm.x86.avx512.mask.padds.b.512(<64 x i8>, <64 x i8>, <64 x i8>, i64)
+
+define weak_odr <64 x i8> @paddsbx64(<64 x i8> %a, <64 x i8> %b) nounwind alwaysinline {
+  %1 = tail call <64 x i8> @llvm.x86.avx512.mask.padds.b.512(<64 x i8> %a, <64 x i8> %b, <64 x i8> undef, i64 -1)
+  ret <64 x i8> %1
+}
+
+declare <64 x i8> @llvm.x86.avx512.mask.psubs.b.512(<64 x i8>, <64 x i8>, <64 x i8>, i64)
+
+define weak_odr <64 x i8> @psubsbx64(<64 x i8> %a, <64 x i8> %b) nounwind alwaysinline {
+  %1 = tail call <64 x i8> @llvm.x86.avx512.mask.psubs.b.512(<64 x i8> %a, <64 x i8> %b, <64 x i8> undef, i64 -1)
+  ret <64 x i8> %1
+}
+
+declare <64 x i8> @llvm.x86.avx512.mask.paddus.b.512(<64 x i8>, <64 x i8>, <64 x i8>, i64)
+
+define weak_odr <64 x i8> @paddusbx64(<64 x i8> %a, <64 x i8> %b) nounwind alwaysinline {
+  %1 = tail call <64 x i8> @llvm.x86.avx512.mask.paddus.b.512(<64 x i8> %a, <64 x i8> %b, <64 x i8> undef, i64 -1)
+  ret <64 x i8> %1
+}
+
+declare <64 x i8> @llvm.x86.avx512.mask.psubus.b.512(<64 x i8>, <64 x i8>, <64 x i8>, i64)
+
+define weak_odr <64 x i8> @psubusbx64(<64 x i8> %a, <64 x i8> %b) nounwind alwaysinline {
+  %1 = tail call <64 x i8> @llvm.x86.avx512.mask.psubus.b.512(<64 x i8> %a, <64 x i8> %b, <64 x i8> undef, i64 -1)
+  ret <64 x i8> %1
+}
+
+declare <32 x i16> @llvm.x86.avx512.mask.padds.w.512(<32 x i16>, <32 x i16>, <32 x i16>, i32)
+
+define weak_odr <32 x i16> @paddswx32(<32 x i16> %a, <32 x i16> %b) nounwind alwaysinline {
+  %1 = tail call <32 x i16> @llvm.x86.avx512.mask.padds.w.512(<32 x i16> %a, <32 x i16> %b, <32 x i16> undef, i32 -1)
+  ret <32 x i16> %1
+}
+
+declare <32 x i16> @llvm.x86.avx512.mask.psubs.w.512(<32 x i16>, <32 x i16>, <32 x i16>, i32)
+
+define weak_odr <32 x i16> @psubswx32(<32 x i16> %a, <32 x i16> %b) nounwind alwaysinline {
+  %1 = tail call <32 x i16> @llvm.x86.avx512.mask.psubs.w.512(<32 x i16> %a, <32 x i16> %b, <32 x i16> undef, i32 -1)
+  ret <32 x i16> %1
+}
+
+declare <32 x i16> @llvm.x86.avx512.mask.paddus.w.512(<32 x i16>, <32 x i16>, <32 x i16>, i32)
+
+define weak_odr <32 x i16> @padduswx32(<32 x i16> %a, <32 x i16> %b) nounwind alwaysinline {
+  %1 = tail call <32 x i16> @llvm.x86.avx512.mask.paddus.w.512(<32 x i16> %a, <32 x i16> %b, <32 x i16> undef, i32 -1)
+  ret <32 x i16> %1
+}
+
+declare <32 x i16> @llvm.x86.avx512.mask.psubus.w.512(<32 x i16>, <32 x i16>, <32 x i16>, i32)
+
+define weak_odr <32 x i16> @psubuswx32(<32 x i16> %a, <32 x i16> %b) nounwind alwaysinline {
+  %1 = tail call <32 x i16> @llvm.x86.avx512.mask.psubus.w.512(<32 x i16> %a, <32 x i16> %b, <32 x i16> undef, i32 -1)
+  ret <32 x i16> %1
+}
+
+declare <32 x i16> @llvm.x86.avx512.mask.pmulh.w.512(<32 x i16>, <32 x i16>, <32 x i16>, i32)
+
+define weak_odr <32 x i16> @pmulhwx32(<32 x i16> %a, <32 x i16> %b) nounwind alwaysinline {
+  %1 = tail call <32 x i16> @llvm.x86.avx512.mask.pmulh.w.512(<32 x i16> %a, <32 x i16> %b, <32 x i16> undef, i32 -1)
+  ret <32 x i16> %1
+}
+
+declare <32 x i16> @llvm.x86.avx512.mask.pmulhu.w.512(<32 x i16>, <32 x i16>, <32 x i16>, i32)
+
+define weak_odr <32 x i16> @pmulhuwx32(<32 x i16> %a, <32 x i16> %b) nounwind alwaysinline {
+  %1 = tail call <32 x i16> @llvm.x86.avx512.mask.pmulhu.w.512(<32 x i16> %a, <32 x i16> %b, <32 x i16> undef, i32 -1)
+  ret <32 x i16> %1
+}
+
+define weak_odr <64 x i8> @pavgbx64(<64 x i8> %a, <64 x i8> %b) nounwind alwaysinline {
+  %1 = zext <64 x i8> %a to <64 x i32>
+  %2 = zext <64 x i8> %b to <64 x i32>
+  %3 = add nuw nsw <64 x i32> %1, <i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1>
+  %4 = add nuw nsw <64 x i32> %3, %2
+  %5 = lshr <64 x i32> %4, <i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1>
+  %6 = trunc <64 x i32> %5 to <64 x i8>
+  ret <64 x i8> %6
+}
+
+define weak_odr <32 x i16> @pavgwx32(<32 x i16> %a, <32 x i16> %b) nounwind alwaysinline {
+  %1 = zext <32 x i16> %a to <32 x i32>
+  %2 = zext <32 x i16> %b to <32 x i32>
+  %3 = add nuw nsw <32 x i32> %1, <i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1>
+  %4 = add nuw nsw <32 x i32> %3, %2
+  %5 = lshr <32 x i32> %4, <i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1, i32 1>
+  %6 = trunc <32 x i32> %5 to <32 x i16>
+  ret <32 x i16> %6
+}
+
+; The 512-bit packs work within each 128-bit lane, so we deal the
+; input out to the two halves such that the result comes out in order.
+
+declare <64 x i8> @llvm.x86.avx512.mask.packsswb.512(<32 x i16>, <32 x i16>, <64 x i8>, i64)
+
+define weak_odr <64 x i8> @packsswbx64(<64 x i16> %arg) nounwind alwaysinline {
+  %1 = shufflevector <64 x i16> %arg, <64 x i16> undef, <32 x i32> <i32 0, i32 1, i32 2, i32 3, i32 4, i32 5, i32 6, i32 7, i32 16, i32 17, i32 18, i32 19, i32 20, i32 21, i32 22, i32 23, i32 32, i32 33, i32 34, i32 35, i32 36, i32 37, i32 38, i32 39, i32 48, i32 49, i32 50, i32 51, i32 52, i32 53, i32 54, i32 55>
+  %2 = shufflevector <64 x i16> %arg, <64 x i16> undef, <32 x i32> <i32 8, i32 9, i32 10, i32 11, i32 12, i32 13, i32 14, i32 15, i32 24, i32 25, i32 26, i32 27, i32 28, i32 29, i32 30, i32 31, i32 40, i32 41, i32 42, i32 43, i32 44, i32 45, i32 46, i32 47, i32 56, i32 57, i32 58, i32 59, i32 60, i32 61, i32 62, i32 63>
+  %3 = tail call <64 x i8> @llvm.x86.avx512.mask.packsswb.512(<32 x i16> %1, <32 x i16> %2, <64 x i8> undef, i64 -1)
+  ret <64 x i8> %3
+}
+
+declare <64 x i8> @llvm.x86.avx512.mask.packuswb.512(<32 x i16>, <32 x i16>, <64 x i8>, i64)
+
+define weak_odr <64 x i8> @packuswbx64(<64 x i16> %arg) nounwind alwaysinline {
+  %1 = shufflevector <64 x i16> %arg, <64 x i16> undef, <32 x i32> <i32 0, i32 1, i32 2, i32 3, i32 4, i32 5, i32 6, i32 7, i32 16, i32 17, i32 18, i32 19, i32 20, i32 21, i32 22, i32 23, i32 32, i32 33, i32 34, i32 35, i32 36, i32 37, i32 38, i32 39, i32 48, i32 49, i32 50, i32 51, i32 52, i32 53, i32 54, i32 55>
+  %2 = shufflevector <64 x i16> %arg, <64 x i16> undef, <32 x i32> <i32 8, i32 9, i32 10, i32 11, i32 12, i32 13, i32 14, i32 15, i32 24, i32 25, i32 26, i32 27, i32 28, i32 29, i32 30, i32 31, i32 40, i32 41, i32 42, i32 43, i32 44, i32 45, i32 46, i32 47, i32 56, i32 57, i32 58, i32 59, i32 60, i32 61, i32 62, i32 63>
+  %3 = tail call <64 x i8> @llvm.x86.avx512.mask.packuswb.512(<32 x i16> %1, <32 x i16> %2, <64 x i8> undef, i64 -1)
+  ret <64 x i8> %3
+}
+
+declare <32 x i16> @llvm.x86.avx512.mask.packssdw.512(<16 x i32>, <16 x i32>, <32 x i16>, i32)
+
+define weak_odr <32 x i16> @packssdwx32(<32 x i32> %arg) nounwind alwaysinline {
+  %1 = shufflevector <32 x i32> %arg, <32 x i32> undef, <16 x i32> <i32 0, i32 1, i32 2, i32 3, i32 8, i32 9, i32 10, i32 11, i32 16, i32 17, i32 18, i32 19, i32 24, i32 25, i32 26, i32 27>
+  %2 = shufflevector <32 x i32> %arg, <32 x i32> undef, <16 x i32> <i32 4, i32 5, i32 6, i32 7, i32 12, i32 13, i32 14, i32 15, i32 20, i32 21, i32 22, i32 23, i32 28, i32 29, i32 30, i32 31>
+  %3 = tail call <32 x i16> @llvm.x86.avx512.mask.packssdw.512(<16 x i32> %1, <16 x i32> %2, <32 x i16> undef, i32 -1)
+  ret <32 x i16> %3
+}
+
+declare <32 x i16> @llvm.x86.avx512.mask.packusdw.512(<16 x i32>, <16 x i32>, <32 x i16>, i32)
+
+define weak_odr <32 x i16> @packusdwx32(<32 x i32> %arg) nounwind alwaysinline {
+  %1 = shufflevector <32 x i32> %arg, <32 x i32> undef, <16 x i32> <i32 0, i32 1, i32 2, i32 3, i32 8, i32 9, i32 10, i32 11, i32 16, i32 17, i32 18, i32 19, i32 24, i32 25, i32 26, i32 27>
+  %2 = shufflevector <32 x i32> %arg, <32 x i32> undef, <16 x i32> <i32 4, i32 5, i32 6, i32 7, i32 12, i32 13, i32 14, i32 15, i32 20, i32 21, i32 22, i32 23, i32 28, i32 29, i32 30, i32 31>
+  %3 = tail call <32 x i16> @llvm.x86.avx512.mask.packusdw.512(<16 x i32> %1, <16 x i32> %2, <32 x i16> undef, i32 -1)
+  ret <32 x i16> %3
+}
+
+declare <16 x i32> @llvm.x86.avx512.mask.pmaddw.d.512(<32 x i16>, <32 x i16>, <16 x i32>, i16)
+
+define weak_odr <16 x i32> @pmaddwdx16(<16 x i16> %a, <16 x i16> %b, <16 x i16> %c, <16 x i16> %d) nounwind alwaysinline {
+  %1 = shufflevector <16 x i16> %a, <16 x i16> %c, <32 x i32> <i32 0, i32 16, i32 1, i32 17, i32 2, i32 18, i32 3, i32 19, i32 4, i32 20, i32 5, i32 21, i32 6, i32 22, i32 7, i32 23, i32 8, i32 24, i32 9, i32 25, i32 10, i32 26, i32 11, i32 27, i32 12, i32 28, i32 13, i32 29, i32 14, i32 30, i32 15, i32 31>
+  %2 = shufflevector <16 x i16> %b, <16 x i16> %d, <32 x i32> <i32 0, i32 16, i32 1, i32 17, i32 2, i32 18, i32 3, i32 19, i32 4, i32 20, i32 5, i32 21, i32 6, i32 22, i32 7, i32 23, i32 8, i32 24, i32 9, i32 25, i32 10, i32 26, i32 11, i32 27, i32 12, i32 28, i32 13, i32 29, i32 14, i32 30, i32 15, i32 31>
+  %3 = tail call <16 x i32> @llvm.x86.avx512.mask.pmaddw.d.512(<32 x i16> %1, <32 x i16> %2, <16 x i32> undef, i16 -1)
+  ret <16 x i32> %3
+}
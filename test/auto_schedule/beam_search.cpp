@@ -0,0 +1,66 @@
+#include "Halide.h"
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    int W = 1000;
+    int H = 1000;
+    Buffer<uint16_t> input(W + 8, H + 8);
+
+    for (int y = 0; y < input.height(); y++) {
+        for (int x = 0; x < input.width(); x++) {
+            input(x, y) = rand() & 0xfff;
+        }
+    }
+
+    Var x("x"), y("y");
+
+    const int num_stages = 8;
+    std::vector<Func> stages;
+    for (int i = 0; i < num_stages; i++) {
+        stages.push_back(Func("stage_" + std::to_string(i)));
+    }
+
+    stages[0](x, y) = input(x, y) + input(x + 1, y + 1);
+    for (int i = 1; i < num_stages; i++) {
+        // Alternate between horizontal and vertical stencils, with some
+        // stages used by more than one consumer.
+        Expr e = (i % 2) ? stages[i-1](x, y) + stages[i-1](x + 1, y)
+                         : stages[i-1](x, y) + stages[i-1](x, y + 1);
+        if (i >= 2) {
+            e += stages[i-2](x, y);
+        }
+        stages[i](x, y) = e / 2;
+    }
+    Func out = stages[num_stages - 1];
+
+    Buffer<uint16_t> reference = out.realize(W, H);
+
+    // Provide estimates on the pipeline output
+    out.estimate(x, 0, W).estimate(y, 0, H);
+
+    // Search with a beam, and a budget that is long enough to not matter.
+    Target target = get_jit_target_from_environment();
+    Pipeline p(out);
+    MachineParams params(16, 16 * 1024 * 1024, 40);
+    params.beam_width = 4;
+    params.time_budget = 600;
+    std::cout << "\n\n******************************************\nSCHEDULE:\n"
+              << "******************************************\n"
+              << p.auto_schedule(target, params)
+              << "\n******************************************\n\n";
+
+    Buffer<uint16_t> result = p.realize(W, H);
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            if (result(x, y) != reference(x, y)) {
+                printf("result(%d, %d) = %d instead of %d\n",
+                       x, y, result(x, y), reference(x, y));
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,58 @@
+#include "Halide.h"
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    Target target = get_jit_target_from_environment();
+    if (!target.has_gpu_feature()) {
+        printf("No gpu target enabled. Skipping test.\n");
+        return 0;
+    }
+
+    int W = 1536;
+    int H = 2560;
+    Buffer<float> input(W + 2, H + 2);
+    for (int y = 0; y < input.height(); y++) {
+        for (int x = 0; x < input.width(); x++) {
+            input(x, y) = (float)((x + y) % 7);
+        }
+    }
+
+    Var x("x"), y("y");
+    Func blur_x("blur_x"), blur_y("blur_y");
+    blur_x(x, y) = (input(x, y) + input(x+1, y) + input(x+2, y)) / 3;
+    blur_y(x, y) = (blur_x(x, y) + blur_x(x, y+1) + blur_x(x, y+2)) / 3;
+
+    // Provide estimates on the pipeline output
+    blur_y.estimate(x, 0, W).estimate(y, 0, H);
+
+    Pipeline p(blur_y);
+    std::string schedule = p.auto_schedule(target);
+    std::cout << "\n\n******************************************\nSCHEDULE:\n"
+              << "******************************************\n"
+              << schedule
+              << "\n******************************************\n\n";
+
+    if (schedule.find("gpu_blocks") == std::string::npos ||
+        schedule.find("gpu_threads") == std::string::npos) {
+        printf("Expected the schedule to use the gpu\n");
+        return -1;
+    }
+
+    Buffer<float> out = p.realize(W, H);
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            float bx0 = (input(x, y) + input(x+1, y) + input(x+2, y)) / 3;
+            float bx1 = (input(x, y+1) + input(x+1, y+1) + input(x+2, y+1)) / 3;
+            float bx2 = (input(x, y+2) + input(x+1, y+2) + input(x+2, y+2)) / 3;
+            float correct = (bx0 + bx1 + bx2) / 3;
+            if (std::abs(out(x, y) - correct) > 1e-5f) {
+                printf("out(%d, %d) = %f instead of %f\n", x, y, out(x, y), correct);
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
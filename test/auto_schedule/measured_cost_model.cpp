@@ -0,0 +1,48 @@
+#include "Halide.h"
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    // The measured cost model times candidate schedules on the host, so
+    // scalar params need estimates as well as the outputs. Input images
+    // are allocated to fit.
+    ImageParam input(Float(32), 2);
+    Param<float> scale;
+    scale.set_estimate(2.0f);
+
+    Var x("x"), y("y");
+
+    Func blur_x("blur_x"), blur_y("blur_y"), out("out");
+    blur_x(x, y) = (input(x, y) + input(x+1, y) + input(x+2, y)) / 3;
+    blur_y(x, y) = (blur_x(x, y) + blur_x(x, y+1) + blur_x(x, y+2)) / 3;
+    out(x, y) = blur_y(x, y) * scale;
+
+    out.estimate(x, 0, 1024).estimate(y, 0, 1024);
+
+    Target target = get_jit_target_from_environment();
+    Pipeline p(out);
+
+    MachineParams params(16, 16 * 1024 * 1024, 40, MachineParams::CostModel::Measured);
+    std::cout << "\n\n******************************************\nSCHEDULE:\n"
+              << "******************************************\n"
+              << p.auto_schedule(target, params)
+              << "\n******************************************\n\n";
+
+    Buffer<float> in(1030, 1030);
+    in.fill(1.0f);
+    input.set(in);
+    scale.set(2.0f);
+
+    Buffer<float> result = p.realize(1024, 1024);
+    for (int y = 0; y < result.height(); y++) {
+        for (int x = 0; x < result.width(); x++) {
+            if (result(x, y) != 2.0f) {
+                printf("result(%d, %d) = %f instead of 2.0\n", x, y, result(x, y));
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
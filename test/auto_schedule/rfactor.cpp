@@ -0,0 +1,54 @@
+#include "Halide.h"
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    int W = 2000;
+    int H = 2000;
+    Buffer<uint8_t> input(W, H);
+
+    for (int y = 0; y < input.height(); y++) {
+        for (int x = 0; x < input.width(); x++) {
+            input(x, y) = rand() & 0xff;
+        }
+    }
+
+    // Reductions over the whole image have no pure dimensions to
+    // parallelize, so the auto-scheduler has to rfactor them.
+    Var x("x");
+    RDom r(0, W, 0, H);
+
+    Func hist("hist");
+    hist(x) = 0;
+    hist(input(r.x, r.y)) += 1;
+
+    Func total("total");
+    total() = cast<uint32_t>(0);
+    total() += cast<uint32_t>(input(r.x, r.y));
+
+    Func out("out");
+    out(x) = hist(x) + cast<int32_t>(total() % 256);
+
+    Buffer<int32_t> reference = out.realize(256);
+
+    // Provide estimates on the pipeline output
+    out.estimate(x, 0, 256);
+
+    Target target = get_jit_target_from_environment();
+    Pipeline p(out);
+    std::cout << "\n\n******************************************\nSCHEDULE:\n"
+              << "******************************************\n"
+              << p.auto_schedule(target)
+              << "\n******************************************\n\n";
+
+    Buffer<int32_t> result = p.realize(256);
+    for (int x = 0; x < 256; x++) {
+        if (result(x) != reference(x)) {
+            printf("result(%d) = %d instead of %d\n", x, result(x), reference(x));
+            return -1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,59 @@
+#include "Halide.h"
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    int W = 2048;
+    int H = 2048;
+    Buffer<float> input(W + 8, H + 8);
+
+    for (int y = 0; y < input.height(); y++) {
+        for (int x = 0; x < input.width(); x++) {
+            input(x, y) = rand() & 0xff;
+        }
+    }
+
+    Var x("x"), y("y");
+
+    // A chain of vertical stencils, where consecutive tiles along y share
+    // most of the intermediates they need.
+    const int num_stencils = 4;
+    std::vector<Func> stencils;
+    for (int i = 0; i < num_stencils; i++) {
+        stencils.push_back(Func("stencil_" + std::to_string(i)));
+    }
+    stencils[0](x, y) = input(x, y) + input(x + 1, y) + input(x + 2, y);
+    for (int i = 1; i < num_stencils; i++) {
+        stencils[i](x, y) = (stencils[i-1](x, y) + stencils[i-1](x, y + 1) +
+                             stencils[i-1](x, y + 2)) / 3;
+    }
+    Func out = stencils[num_stencils - 1];
+
+    Buffer<float> reference = out.realize(W, H);
+
+    // Provide estimates on the pipeline output
+    out.estimate(x, 0, W).estimate(y, 0, H);
+
+    // With little parallelism required, the rows of tiles can be computed
+    // serially with a sliding window.
+    Target target = get_jit_target_from_environment();
+    Pipeline p(out);
+    std::cout << "\n\n******************************************\nSCHEDULE:\n"
+              << "******************************************\n"
+              << p.auto_schedule(target, MachineParams(1, 16 * 1024 * 1024, 40))
+              << "\n******************************************\n\n";
+
+    Buffer<float> result = p.realize(W, H);
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            if (result(x, y) != reference(x, y)) {
+                printf("result(%d, %d) = %f instead of %f\n",
+                       x, y, result(x, y), reference(x, y));
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,93 @@
+#include "Halide.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits>
+#include <type_traits>
+
+using namespace Halide;
+
+template<typename T> struct Widen;
+template<> struct Widen<uint8_t> { typedef uint16_t type; };
+template<> struct Widen<int8_t> { typedef int16_t type; };
+template<> struct Widen<uint16_t> { typedef uint32_t type; };
+template<> struct Widen<int16_t> { typedef int32_t type; };
+template<> struct Widen<uint32_t> { typedef uint64_t type; };
+template<> struct Widen<int32_t> { typedef int64_t type; };
+
+template<typename T>
+bool test(int vector_width) {
+    typedef typename std::conditional<std::numeric_limits<T>::is_signed, int64_t, uint64_t>::type wide_t;
+    const int W = 1024;
+    const int bits = sizeof(T) * 8;
+    const wide_t lo = std::numeric_limits<T>::min(), hi = std::numeric_limits<T>::max();
+
+    Buffer<T> a(W), b(W), n(W);
+    for (int i = 0; i < W; i++) {
+        a(i) = (T)rand();
+        b(i) = (T)rand();
+        n(i) = (T)(rand() % bits);
+    }
+    a(0) = lo; b(0) = lo;
+    a(1) = hi; b(1) = hi;
+    a(2) = lo; b(2) = hi;
+    a(3) = hi; b(3) = lo;
+
+    Var x;
+    Func f;
+    f(x) = Tuple(saturating_add(a(x), b(x)),
+                 saturating_sub(a(x), b(x)),
+                 halving_add(a(x), b(x)),
+                 rounding_halving_add(a(x), b(x)),
+                 rounding_shift_right(a(x), n(x)),
+                 widening_mul(a(x), b(x)));
+    f.vectorize(x, vector_width);
+    Realization r = f.realize(W);
+    Buffer<T> sat_add = r[0], sat_sub = r[1], avg_down = r[2], avg_up = r[3], rshr = r[4];
+
+    for (int i = 0; i < W; i++) {
+        wide_t wa = a(i), wb = b(i);
+        wide_t correct[] = {
+            std::min(std::max(wa + wb, lo), hi),
+            std::numeric_limits<T>::is_signed ? std::min(std::max(wa - wb, lo), hi) : (wa > wb ? wa - wb : 0),
+            (wide_t)((int64_t)(wa + wb) >> 1),
+            (wide_t)((int64_t)(wa + wb + 1) >> 1),
+            (wide_t)((int64_t)(wa + (((wide_t)1 << n(i)) >> 1)) >> n(i)),
+        };
+        T actual[] = {sat_add(i), sat_sub(i), avg_down(i), avg_up(i), rshr(i)};
+        for (int j = 0; j < 5; j++) {
+            if (actual[j] != (T)correct[j]) {
+                printf("Intrinsic %d of %lld and %lld with type %s and vector width %d: %lld instead of %lld\n",
+                       j, (long long)wa, (long long)wb, type_of<T>().is_int() ? "signed" : "unsigned",
+                       vector_width, (long long)actual[j], (long long)correct[j]);
+                return false;
+            }
+        }
+    }
+
+    Buffer<typename Widen<T>::type> product = r[5];
+    for (int i = 0; i < W; i++) {
+        wide_t correct = (wide_t)a(i) * (wide_t)b(i);
+        if (product(i) != correct) {
+            printf("widening_mul of %lld and %lld: %lld instead of %lld\n",
+                   (long long)a(i), (long long)b(i), (long long)product(i), (long long)correct);
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    for (int w : {1, 8, 16, 32}) {
+        if (!test<uint8_t>(w) ||
+            !test<int8_t>(w) ||
+            !test<uint16_t>(w) ||
+            !test<int16_t>(w) ||
+            !test<uint32_t>(w) ||
+            !test<int32_t>(w)) {
+            return -1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,115 @@
+#include "Halide.h"
+#include <algorithm>
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    const int W = 256, H = 256, bins = 32;
+
+    Buffer<uint8_t> im(W, H);
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            im(x, y) = (x * 7 + y * 13 + (x * y) % 5) % bins;
+        }
+    }
+
+    int correct[bins] = {0};
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            correct[im(x, y)]++;
+        }
+    }
+
+    Var x;
+    RDom r(0, W, 0, H);
+
+    {
+        // An integer histogram computed in parallel over the rows of
+        // the input, without rfactor.
+        Func hist;
+        hist(x) = 0;
+        hist(cast<int>(im(r.x, r.y))) += 1;
+
+        hist.update().atomic().parallel(r.y);
+
+        Buffer<int> result = hist.realize(bins);
+        for (int i = 0; i < bins; i++) {
+            if (result(i) != correct[i]) {
+                printf("hist(%d) = %d instead of %d\n", i, result(i), correct[i]);
+                return -1;
+            }
+        }
+    }
+
+    {
+        // A float histogram, which updates each bin with a compare
+        // and swap loop. The bins are small integers, so the sums are
+        // exact in any order.
+        Func hist;
+        hist(x) = 0.0f;
+        hist(cast<int>(im(r.x, r.y))) += 0.5f;
+
+        hist.update().atomic().parallel(r.y);
+
+        Buffer<float> result = hist.realize(bins);
+        for (int i = 0; i < bins; i++) {
+            if (result(i) != correct[i] * 0.5f) {
+                printf("hist(%d) = %f instead of %f\n", i, result(i), correct[i] * 0.5f);
+                return -1;
+            }
+        }
+    }
+
+    {
+        // An update that isn't an addition, which also needs a
+        // compare and swap loop.
+        Func hist_max;
+        hist_max(x) = 0;
+        hist_max(cast<int>(im(r.x, r.y))) = max(hist_max(cast<int>(im(r.x, r.y))), r.x + r.y);
+
+        hist_max.update().atomic().parallel(r.y);
+
+        Buffer<int> result = hist_max.realize(bins);
+        for (int i = 0; i < bins; i++) {
+            int c = 0;
+            for (int y = 0; y < H; y++) {
+                for (int x = 0; x < W; x++) {
+                    if (im(x, y) == i) {
+                        c = std::max(c, x + y);
+                    }
+                }
+            }
+            if (result(i) != c) {
+                printf("hist_max(%d) = %d instead of %d\n", i, result(i), c);
+                return -1;
+            }
+        }
+    }
+
+    Target target = get_jit_target_from_environment();
+    if (target.has_gpu_feature()) {
+        // The same integer histogram, with a GPU thread per pixel.
+        Func hist;
+        hist(x) = 0;
+        hist(cast<int>(im(r.x, r.y))) += 1;
+
+        hist.compute_root();
+        RVar rxo, rxi;
+        hist.update().atomic().split(r.x, rxo, rxi, 16).gpu_blocks(r.y).gpu_threads(rxi);
+
+        Func out;
+        out(x) = hist(x);
+
+        Buffer<int> result = out.realize(bins, target);
+        for (int i = 0; i < bins; i++) {
+            if (result(i) != correct[i]) {
+                printf("GPU hist(%d) = %d instead of %d\n", i, result(i), correct[i]);
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
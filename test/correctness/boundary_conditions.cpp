@@ -294,6 +294,17 @@ bool test_all(int vector_width, Target t) {
             repeat_image(input),
             test_min, test_extent, test_min, test_extent,
             vector_width, t);
+        // With index tables.
+        success &= check_repeat_image(
+            input,
+            repeat_image_with_index_tables(input_f, 0, W, 0, H),
+            test_min, test_extent, test_min, test_extent,
+            vector_width, t);
+        success &= check_repeat_image(
+            input,
+            repeat_image_with_index_tables(input),
+            test_min, test_extent, test_min, test_extent,
+            vector_width, t);
     }
 
     // mirror_image:
@@ -330,6 +341,17 @@ bool test_all(int vector_width, Target t) {
             mirror_image(input),
             test_min, test_extent, test_min, test_extent,
             vector_width, t);
+        // With index tables.
+        success &= check_mirror_image(
+            input,
+            mirror_image_with_index_tables(input_f, 0, W, 0, H),
+            test_min, test_extent, test_min, test_extent,
+            vector_width, t);
+        success &= check_mirror_image(
+            input,
+            mirror_image_with_index_tables(input),
+            test_min, test_extent, test_min, test_extent,
+            vector_width, t);
     }
 
     // mirror_interior:
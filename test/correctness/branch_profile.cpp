@@ -0,0 +1,71 @@
+#include "Halide.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <fstream>
+#include <sstream>
+
+#include "test/common/halide_test_dirs.h"
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    Param<int> p("p");
+    Var x("x");
+    Func f("f");
+    f(x) = x * p;
+    f.specialize(p == 1);
+    f.specialize(p == 2);
+
+    // Count the branches with the profiler. Both specializations and
+    // the fallback still compute the right thing.
+    {
+        Target t = get_jit_target_from_environment().with_feature(Target::Profile);
+        for (int i = 0; i < 4; i++) {
+            p.set(i);
+            Buffer<int> out = f.realize(16, t);
+            for (int j = 0; j < 16; j++) {
+                if (out(j) != j * i) {
+                    printf("out(%d) = %d instead of %d\n", j, out(j), j * i);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    // The first specialization is hot, the second cold.
+    std::string profile = Internal::get_test_tmp_dir() + "branch_profile.txt";
+    std::string assembly = Internal::get_test_tmp_dir() + "branch_profile.ll";
+    {
+        std::ofstream file(profile);
+        file << "branch_profile_test f.s0.specialization.0 1000\n"
+             << "branch_profile_test f.s0.specialization.1 3\n"
+             << "branch_profile_test f.s0.specialization.default 4\n"
+             << "some_other_pipeline f.s0.specialization.0 5\n";
+    }
+#ifdef _WIN32
+    _putenv_s("HL_PGO_PROFILE", profile.c_str());
+#else
+    setenv("HL_PGO_PROFILE", profile.c_str(), 1);
+#endif
+
+    Internal::ensure_no_file_exists(assembly);
+    f.compile_to_llvm_assembly(assembly, {p}, "branch_profile_test");
+    Internal::assert_file_exists(assembly);
+
+    std::ifstream file(assembly);
+    std::stringstream contents;
+    contents << file.rdbuf();
+    std::string ll = contents.str();
+
+    // The dispatch to the first specialization is weighted by its
+    // count against those of the rest of the chain. LLVM may have
+    // flipped the branch.
+    if (ll.find("!\"branch_weights\", i32 1000, i32 7}") == std::string::npos &&
+        ll.find("!\"branch_weights\", i32 7, i32 1000}") == std::string::npos) {
+        printf("Did not find the branch weights of the first specialization\n");
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
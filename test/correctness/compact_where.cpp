@@ -0,0 +1,95 @@
+#include "Halide.h"
+#include <stdio.h>
+#include <fstream>
+#include <sstream>
+
+#include "test/common/halide_test_dirs.h"
+
+using namespace Halide;
+
+std::string lowered(Func f, const std::string &name) {
+    std::string stmt_file = Internal::get_test_tmp_dir() + name + ".stmt";
+    Internal::ensure_no_file_exists(stmt_file);
+    f.compile_to_lowered_stmt(stmt_file, {});
+    std::ifstream file(stmt_file);
+    std::stringstream contents;
+    contents << file.rdbuf();
+    return contents.str();
+}
+
+int main(int argc, char **argv) {
+    const int W = 100, H = 80;
+    Buffer<uint8_t> mask(W, H), values(W, H);
+    mask.fill(0);
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            values(x, y) = (uint8_t)(x * 7 + y * 3);
+            if ((x * 31 + y * 17) % 23 == 0) {
+                mask(x, y) = 1;
+            }
+        }
+    }
+
+    int correct_total = 0;
+    Buffer<int> correct_hist(16);
+    correct_hist.fill(0);
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            if (mask(x, y) && x > 3) {
+                correct_total += values(x, y);
+                correct_hist(values(x, y) % 16) += 1;
+            }
+        }
+    }
+
+    for (int vector_width : {0, 8}) {
+        RDom r(0, W, 0, H);
+        r.where(mask(r.x, r.y) != 0);
+        r.where(r.x > 3);
+
+        // A sum over the points in the mask.
+        Func total("total");
+        total() = 0;
+        total() += cast<int>(values(r.x, r.y));
+        if (vector_width) {
+            total.update().atomic();
+        }
+        total.update().compact(r.y, vector_width);
+
+        std::string stmt = lowered(total, "compact_where_" + std::to_string(vector_width));
+        if (stmt.find(".compact.indices") == std::string::npos) {
+            printf("Expected the loops over r to be compacted:\n%s\n", stmt.c_str());
+            return -1;
+        }
+
+        Buffer<int> t = total.realize();
+        if (t() != correct_total) {
+            printf("total = %d instead of %d\n", t(), correct_total);
+            return -1;
+        }
+    }
+
+    {
+        // A histogram of the points in the mask, compacting only the
+        // inner loop.
+        RDom r(0, W, 0, H);
+        r.where(mask(r.x, r.y) != 0);
+        r.where(r.x > 3);
+        Var i;
+        Func hist("hist");
+        hist(i) = 0;
+        hist(cast<int>(values(r.x, r.y)) % 16) += 1;
+        hist.update().compact(r.x);
+
+        Buffer<int> h = hist.realize(16);
+        for (int i = 0; i < 16; i++) {
+            if (h(i) != correct_hist(i)) {
+                printf("hist(%d) = %d instead of %d\n", i, h(i), correct_hist(i));
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
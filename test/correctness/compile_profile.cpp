@@ -0,0 +1,48 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "Halide.h"
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    char env[] = "HL_COMPILE_PROFILE=1";
+    putenv(env);
+
+    Var x, y;
+    Func f, g;
+    f(x, y) = x + y;
+    g(x, y) = f(x, y) + f(x + 1, y - 1);
+    f.compute_at(g, y).vectorize(x, 4);
+    g.parallel(y).vectorize(x, 8);
+
+    Internal::SimplifyStats before = Internal::get_simplify_stats();
+    g.compile_jit();
+    Internal::SimplifyStats after = Internal::get_simplify_stats();
+
+    if (after.calls <= before.calls) {
+        printf("Expected lowering to call the simplifier\n");
+        return -1;
+    }
+    if (after.cache_hits <= before.cache_hits) {
+        printf("Expected lowering to reuse some simplifier results\n");
+        return -1;
+    }
+    if (after.seconds <= before.seconds) {
+        printf("Expected time spent in the simplifier to be recorded\n");
+        return -1;
+    }
+
+    Buffer<int> im = g.realize(32, 32);
+    for (int y = 0; y < 32; y++) {
+        for (int x = 0; x < 32; x++) {
+            int correct = 2 * (x + y);
+            if (im(x, y) != correct) {
+                printf("im(%d, %d) = %d instead of %d\n", x, y, im(x, y), correct);
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
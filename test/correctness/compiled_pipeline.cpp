@@ -0,0 +1,61 @@
+#include "Halide.h"
+#include <stdio.h>
+#include <atomic>
+#include <thread>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    Var x("x"), y("y");
+    Param<int> offset("offset");
+    ImageParam input(Int(32), 2, "input");
+
+    Func f("f");
+    f(x, y) = input(x, y) * 2 + offset;
+    f.vectorize(x, 8).parallel(y);
+
+    CompiledPipeline compiled = Pipeline(f).compile_to_compiled_pipeline();
+
+    std::vector<Argument> args = compiled.arguments();
+    if (args.size() != 2) {
+        printf("The compiled pipeline has %d arguments instead of 2\n", (int)args.size());
+        return -1;
+    }
+
+    // Each thread passes its own input and offset, and writes its own
+    // output, so no Param or ImageParam is ever set.
+    const int num_threads = 8, iters = 32;
+    std::atomic<int> failures(0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_threads; t++) {
+        threads.emplace_back([&, t] {
+            Buffer<int> in(64, 32), out(64, 32);
+            in.for_each_element([&](int x, int y) { in(x, y) = x + y * t; });
+            for (int i = 0; i < iters; i++) {
+                int o = t * 100 + i;
+                int status = compiled.realize(out, {{"offset", &o}, {"input", in.raw_buffer()}});
+                if (status != 0) {
+                    failures++;
+                    return;
+                }
+                out.for_each_element([&](int x, int y) {
+                    if (out(x, y) != in(x, y) * 2 + o) {
+                        failures++;
+                    }
+                });
+            }
+        });
+    }
+
+    for (auto &t : threads) {
+        t.join();
+    }
+
+    if (failures) {
+        printf("%d values were wrong\n", (int)failures);
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
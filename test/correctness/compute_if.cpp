@@ -0,0 +1,74 @@
+#include <stdio.h>
+#include "Halide.h"
+
+using namespace Halide;
+
+#ifdef _WIN32
+#define DLLEXPORT __declspec(dllexport)
+#else
+#define DLLEXPORT
+#endif
+
+int call_count = 0;
+
+// out(x, y) = x + y
+extern "C" DLLEXPORT int expensive_stage(halide_buffer_t *out) {
+    if (!out->is_bounds_query()) {
+        call_count++;
+        Halide::Runtime::Buffer<int32_t> buf(*out);
+        buf.for_each_element([&](int x, int y) {buf(x, y) = x + y;});
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    const int W = 64, H = 32;
+
+    Buffer<int32_t> input(W, H);
+    input.for_each_element([&](int xx, int yy) {input(xx, yy) = (xx * 7 + yy * 3) % 10;});
+
+    Param<int32_t> threshold;
+    Func mean, detail, out;
+    Var x, y;
+    RDom r(0, W, 0, H);
+    mean() = sum(input(r.x, r.y)) / (W * H);
+    mean.compute_root();
+
+    detail.define_extern("expensive_stage", {}, Int(32), 2);
+    Expr use_detail = mean() > threshold;
+    detail.compute_root().compute_if(use_detail);
+
+    out(x, y) = select(use_detail, detail(x, y), input(x, y));
+
+    int m = 0;
+    input.for_each_element([&](int xx, int yy) {m += input(xx, yy);});
+    m /= W * H;
+
+    for (int t = m - 2; t <= m + 2; t++) {
+        call_count = 0;
+        threshold.set(t);
+        Buffer<int32_t> result = out.realize(W, H);
+
+        bool skipped = !(m > t);
+        for (int yy = 0; yy < H; yy++) {
+            for (int xx = 0; xx < W; xx++) {
+                int correct = skipped ? input(xx, yy) : xx + yy;
+                if (result(xx, yy) != correct) {
+                    printf("threshold %d: result(%d, %d) = %d instead of %d\n",
+                           t, xx, yy, result(xx, yy), correct);
+                    return -1;
+                }
+            }
+        }
+
+        int expected_calls = skipped ? 0 : 1;
+        if (call_count != expected_calls) {
+            printf("threshold %d: expensive stage called %d times instead of %d\n",
+                   t, call_count, expected_calls);
+            return -1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,194 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+// Check that no loops over a Func are left once its loops are fused
+// with another's.
+class CheckNoLoopsOver : public IRMutator {
+    std::string prefix;
+
+    class FindLoops : public IRVisitor {
+        using IRVisitor::visit;
+
+        void visit(const For *op) {
+            if (starts_with(op->name, prefix)) {
+                found = true;
+            }
+            IRVisitor::visit(op);
+        }
+
+    public:
+        const std::string &prefix;
+        bool found = false;
+        FindLoops(const std::string &prefix) : prefix(prefix) {}
+    };
+
+public:
+    CheckNoLoopsOver(const std::string &func) : prefix(func + ".s0.") {}
+    using IRMutator::mutate;
+
+    Stmt mutate(Stmt s) {
+        FindLoops f(prefix);
+        s.accept(&f);
+        if (f.found) {
+            printf("There are still loops over %s\n", prefix.c_str());
+            exit(-1);
+        }
+        return s;
+    }
+};
+
+// Count the places a Func is produced.
+class CountProductions : public IRMutator {
+    std::string func;
+
+    class Counter : public IRVisitor {
+        using IRVisitor::visit;
+
+        void visit(const ProducerConsumer *op) {
+            if (op->is_producer && op->name == func) {
+                count++;
+            }
+            IRVisitor::visit(op);
+        }
+
+    public:
+        const std::string &func;
+        int count = 0;
+        Counter(const std::string &func) : func(func) {}
+    };
+
+public:
+    CountProductions(const std::string &func) : func(func) {}
+    using IRMutator::mutate;
+    int count = 0;
+
+    Stmt mutate(Stmt s) {
+        Counter c(func);
+        s.accept(&c);
+        count = c.count;
+        return s;
+    }
+};
+
+int main(int argc, char **argv) {
+    Var x("x"), y("y");
+
+    Func in("in");
+    in(x, y) = x * 3 + y * 5;
+
+    {
+        // Two gradients of the same input, fused at the innermost
+        // loop of their consumer.
+        Func gx("gx"), gy("gy"), out("out");
+        gx(x, y) = in(x + 1, y) - in(x - 1, y);
+        gy(x, y) = in(x, y + 1) - in(x, y - 1);
+        out(x, y) = gx(x, y) * gx(x, y) + gy(x, y) * gy(x, y);
+
+        in.compute_root();
+        gx.compute_at(out, y);
+        gy.compute_at(out, y).compute_with(gx, x);
+
+        out.add_custom_lowering_pass(new CheckNoLoopsOver("gy"));
+        Buffer<int> result = out.realize(64, 64);
+        for (int y = 0; y < result.height(); y++) {
+            for (int x = 0; x < result.width(); x++) {
+                int correct = 6 * 6 + 10 * 10;
+                if (result(x, y) != correct) {
+                    printf("result(%d, %d) = %d instead of %d\n", x, y, result(x, y), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    {
+        // Fused Funcs with different bounds. Each must only compute
+        // its own region.
+        Func f("f"), g("g"), out("out");
+        f(x, y) = x + y;
+        g(x, y) = x - y;
+        out(x, y) = f(x, y) + g(x + 5, y - 3) + g(x - 2, y);
+
+        f.compute_root();
+        g.compute_root().compute_with(f, x);
+
+        Buffer<int> result = out.realize(32, 32);
+        for (int y = 0; y < result.height(); y++) {
+            for (int x = 0; x < result.width(); x++) {
+                int correct = (x + y) + (x + 5 - (y - 3)) + (x - 2 - y);
+                if (result(x, y) != correct) {
+                    printf("result(%d, %d) = %d instead of %d\n", x, y, result(x, y), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    {
+        // A multi-output pipeline, fused at the outer loop only.
+        Func gx("gx"), gy("gy");
+        gx(x, y) = in(x + 1, y) - in(x - 1, y);
+        gy(x, y) = in(x, y + 1) - in(x, y - 1);
+
+        gx.vectorize(x, 8);
+        gy.vectorize(x, 8).compute_with(gx, y);
+
+        Buffer<int> rx(64, 64), ry(64, 64);
+        Pipeline({gx, gy}).realize({rx, ry});
+        for (int y = 0; y < rx.height(); y++) {
+            for (int x = 0; x < rx.width(); x++) {
+                if (rx(x, y) != 6 || ry(x, y) != 10) {
+                    printf("rx(%d, %d) = %d, ry(%d, %d) = %d instead of 6, 10\n",
+                           x, y, rx(x, y), x, y, ry(x, y));
+                    return -1;
+                }
+            }
+        }
+    }
+
+    {
+        // A Func computed at the fused loops is shared by both Funcs,
+        // even though the outputs have different sizes.
+        Func g("g"), a("a"), b("b");
+        Var xo("xo"), xi("xi");
+        g(x, y) = in(x, y) * 2;
+        a(x, y) = g(x + 1, y) - g(x, y);
+        b(x, y) = g(x, y + 1) - g(x, y);
+
+        a.split(y, xo, xi, 8);
+        b.split(y, xo, xi, 8).compute_with(a, xo);
+        g.compute_at(a, xo);
+
+        Pipeline p({a, b});
+        CountProductions *counter = new CountProductions("g");
+        p.add_custom_lowering_pass(counter);
+        Buffer<int> ra(37, 29), rb(45, 53);
+        p.realize({ra, rb});
+        if (counter->count != 1) {
+            printf("g is produced in %d places instead of 1\n", counter->count);
+            return -1;
+        }
+        for (int y = 0; y < ra.height(); y++) {
+            for (int x = 0; x < ra.width(); x++) {
+                if (ra(x, y) != 6) {
+                    printf("ra(%d, %d) = %d instead of 6\n", x, y, ra(x, y));
+                    return -1;
+                }
+            }
+        }
+        for (int y = 0; y < rb.height(); y++) {
+            for (int x = 0; x < rb.width(); x++) {
+                if (rb(x, y) != 10) {
+                    printf("rb(%d, %d) = %d instead of 10\n", x, y, rb(x, y));
+                    return -1;
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
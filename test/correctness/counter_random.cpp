@@ -0,0 +1,104 @@
+#include "Halide.h"
+#include <stdio.h>
+#include <math.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    const int W = 256, H = 256;
+    Var x, y, xi, yi;
+    Param<int> seed;
+
+    // Known answer for Threefry-2x32-20 with a zero key and counter.
+    {
+        Func f;
+        f(x) = counter_random_uint(seed, 0);
+        seed.set(0);
+        Buffer<uint32_t> result = f.realize(1);
+        if (result(0) != 0x6b200159) {
+            printf("Threefry of zero is 0x%08x instead of 0x6b200159\n", result(0));
+            return -1;
+        }
+    }
+
+    // The values should not depend on the schedule.
+    Func ref;
+    ref(x, y) = counter_random_uint(seed, 3);
+    seed.set(17);
+    Buffer<uint32_t> correct = ref.realize(W, H);
+
+    for (int i = 0; i < 4; i++) {
+        Func f;
+        f(x, y) = counter_random_uint(seed, 3);
+        switch (i) {
+        case 0:
+            f.vectorize(x, 8);
+            break;
+        case 1:
+            f.parallel(y).vectorize(x, 16);
+            break;
+        case 2:
+            f.tile(x, y, xi, yi, 16, 8).vectorize(xi, 4).parallel(y);
+            break;
+        case 3:
+            f.reorder(y, x).vectorize(y, 8);
+            break;
+        }
+        Buffer<uint32_t> result = f.realize(W, H);
+        for (int yy = 0; yy < H; yy++) {
+            for (int xx = 0; xx < W; xx++) {
+                if (result(xx, yy) != correct(xx, yy)) {
+                    printf("Schedule %d: result(%d, %d) = 0x%08x instead of 0x%08x\n",
+                           i, xx, yy, result(xx, yy), correct(xx, yy));
+                    return -1;
+                }
+            }
+        }
+    }
+
+    // Different streams should be unrelated.
+    {
+        Func f;
+        f(x, y) = counter_random_uint(seed, 4);
+        Buffer<uint32_t> other = f.realize(W, H);
+        int same = 0;
+        for (int yy = 0; yy < H; yy++) {
+            for (int xx = 0; xx < W; xx++) {
+                same += (other(xx, yy) == correct(xx, yy));
+            }
+        }
+        if (same > 2) {
+            printf("Streams 3 and 4 agree in %d places\n", same);
+            return -1;
+        }
+    }
+
+    // Floats should be uniform on [0, 1).
+    {
+        Func f;
+        f(x, y) = counter_random_float(seed);
+        f.vectorize(x, 8);
+        Buffer<float> result = f.realize(W, H);
+        double sum = 0, sum_sq = 0;
+        for (int yy = 0; yy < H; yy++) {
+            for (int xx = 0; xx < W; xx++) {
+                float v = result(xx, yy);
+                if (v < 0 || v >= 1) {
+                    printf("Random float out of range: %f\n", v);
+                    return -1;
+                }
+                sum += v;
+                sum_sq += v * v;
+            }
+        }
+        double mean = sum / (W * H);
+        double var = sum_sq / (W * H) - mean * mean;
+        if (fabs(mean - 0.5) > 0.01 || fabs(var - 1.0 / 12) > 0.01) {
+            printf("Random floats have mean %f and variance %f\n", mean, var);
+            return -1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
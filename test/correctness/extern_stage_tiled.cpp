@@ -0,0 +1,123 @@
+#include "Halide.h"
+#include <atomic>
+#include <stdio.h>
+
+#ifdef _WIN32
+#define DLLEXPORT __declspec(dllexport)
+#else
+#define DLLEXPORT
+#endif
+
+std::atomic<int> calls;
+std::atomic<int> max_extent_x, max_extent_y;
+
+void update_max(std::atomic<int> &m, int v) {
+    int old = m;
+    while (v > old && !m.compare_exchange_weak(old, v)) {}
+}
+
+// out(x, y) = in(x, y) + x + y * 1000. Must be thread-safe, because
+// tiles may be computed in parallel.
+extern "C" DLLEXPORT int tiled_extern_stage(halide_buffer_t *in, halide_buffer_t *out) {
+    if (in->is_bounds_query()) {
+        for (int i = 0; i < 2; i++) {
+            in->dim[i].min = out->dim[i].min;
+            in->dim[i].extent = out->dim[i].extent;
+        }
+        return 0;
+    }
+    if (out->is_bounds_query()) {
+        return 0;
+    }
+    calls++;
+    update_max(max_extent_x, out->dim[0].extent);
+    update_max(max_extent_y, out->dim[1].extent);
+    for (int y = out->dim[1].min; y < out->dim[1].min + out->dim[1].extent; y++) {
+        for (int x = out->dim[0].min; x < out->dim[0].min + out->dim[0].extent; x++) {
+            int coords[] = {x, y};
+            *(int *)out->address_of(coords) = *(int *)in->address_of(coords) + x + y * 1000;
+        }
+    }
+    return 0;
+}
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    const int W = 100, H = 50;
+
+    for (int i = 0; i < 5; i++) {
+        Func f, g, h;
+        Var x, y, xo, yo, xi, yi;
+        f(x, y) = x * y;
+        f.compute_root();
+
+        g.define_extern("tiled_extern_stage", {f}, Int(32), {x, y});
+        h(x, y) = g(x, y) * 2;
+
+        int expected_calls = 0, tile_x = W, tile_y = H;
+        if (i == 0) {
+            // Serial tiles along x
+            g.compute_root().split(x, xo, xi, 16);
+            expected_calls = 7;
+            tile_x = 16;
+        } else if (i == 1) {
+            // Parallel strips along y
+            g.compute_root().split(y, yo, yi, 8).parallel(yo);
+            expected_calls = 7;
+            tile_y = 8;
+        } else if (i == 2) {
+            // Parallel 2D tiles
+            g.compute_root()
+                .split(x, xo, xi, 32).split(y, yo, yi, 16)
+                .reorder(xi, yi, xo, yo).parallel(yo);
+            expected_calls = 4 * 4;
+            tile_x = 32;
+            tile_y = 16;
+        } else if (i == 3) {
+            // One call per row, in parallel.
+            g.compute_root().parallel(y);
+            expected_calls = H;
+            tile_y = 1;
+        } else {
+            // Tiles of an extern stage computed inside the tiles of
+            // its consumer.
+            h.split(y, yo, y, 10).parallel(yo);
+            g.compute_at(h, yo).split(x, xo, xi, 25);
+            expected_calls = 5 * 4;
+            tile_x = 25;
+            tile_y = 10;
+        }
+
+        calls = 0;
+        max_extent_x = 0;
+        max_extent_y = 0;
+        Buffer<int> result = h.realize(W, H);
+
+        for (int yy = 0; yy < H; yy++) {
+            for (int xx = 0; xx < W; xx++) {
+                int correct = (xx * yy + xx + yy * 1000) * 2;
+                if (result(xx, yy) != correct) {
+                    printf("Schedule %d: result(%d, %d) = %d instead of %d\n",
+                           i, xx, yy, result(xx, yy), correct);
+                    return -1;
+                }
+            }
+        }
+
+        if (calls != expected_calls) {
+            printf("Schedule %d: extern stage called %d times instead of %d\n",
+                   i, (int)calls, expected_calls);
+            return -1;
+        }
+
+        if (max_extent_x != tile_x || max_extent_y != tile_y) {
+            printf("Schedule %d: extern stage computed tiles of size %d x %d instead of %d x %d\n",
+                   i, (int)max_extent_x, (int)max_extent_y, tile_x, tile_y);
+            return -1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
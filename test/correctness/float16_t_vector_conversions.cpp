@@ -0,0 +1,112 @@
+#include "Halide.h"
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+using namespace Halide;
+
+// Check vectorized conversions between half and single precision,
+// for every half and for a range of floats, and the bfloat16 helpers.
+bool test_float16(const Target &t) {
+    Buffer<float16_t> halves(65536);
+    for (int i = 0; i < 65536; i++) {
+        halves(i) = float16_t::make_from_bits((uint16_t)i);
+    }
+
+    // Floats around every half, to exercise the rounding.
+    Buffer<float> floats(65536 * 3);
+    for (int i = 0; i < 65536; i++) {
+        float f = (float)halves(i);
+        uint32_t bits;
+        memcpy(&bits, &f, sizeof(bits));
+        for (int j = 0; j < 3; j++) {
+            uint32_t b = bits + (j - 1) * 0x1000;
+            memcpy(&floats(i * 3 + j), &b, sizeof(b));
+        }
+    }
+
+    Var x;
+    Func widen, narrow;
+    widen(x) = cast<float>(halves(x));
+    narrow(x) = cast<float16_t>(floats(x));
+    widen.vectorize(x, 16);
+    narrow.vectorize(x, 16);
+
+    Buffer<float> wide = widen.realize(65536, t);
+    Buffer<float16_t> narrowed = narrow.realize(65536 * 3, t);
+
+    for (int i = 0; i < 65536; i++) {
+        float correct = (float)halves(i);
+        if (halves(i).is_nan() ? wide(i) == wide(i) : wide(i) != correct) {
+            printf("Widening 0x%04x gave %f instead of %f\n", i, wide(i), correct);
+            return false;
+        }
+    }
+    for (int i = 0; i < 65536 * 3; i++) {
+        float16_t correct(floats(i));
+        if (correct.is_nan() ? !narrowed(i).is_nan() : narrowed(i).to_bits() != correct.to_bits()) {
+            printf("Narrowing %g gave 0x%04x instead of 0x%04x\n",
+                   floats(i), narrowed(i).to_bits(), correct.to_bits());
+            return false;
+        }
+    }
+    return true;
+}
+
+bool test_bfloat16(const Target &t) {
+    Buffer<float> floats(1 << 16);
+    for (int i = 0; i < floats.width(); i++) {
+        // Every bfloat16 exponent, with bits below the top half to round.
+        uint32_t bits = ((uint32_t)i << 16) | (((uint32_t)i * 0x9e37u) & 0xffff);
+        memcpy(&floats(i), &bits, sizeof(bits));
+    }
+
+    Var x;
+    Func narrow, widen;
+    narrow(x) = float_to_bfloat16(floats(x));
+    widen(x) = bfloat16_to_float(narrow(x));
+    narrow.compute_root().vectorize(x, 8);
+    widen.vectorize(x, 8);
+
+    Buffer<float> result = widen.realize(floats.width(), t);
+    for (int i = 0; i < floats.width(); i++) {
+        uint32_t bits;
+        memcpy(&bits, &floats(i), sizeof(bits));
+        float f = floats(i);
+        if (f != f) {
+            if (result(i) == result(i)) {
+                printf("bfloat16 of a NaN is not a NaN\n");
+                return false;
+            }
+            continue;
+        }
+        uint32_t lsb = (bits >> 16) & 1;
+        uint32_t rounded = (bits + 0x7fff + lsb) & 0xffff0000;
+        float correct;
+        memcpy(&correct, &rounded, sizeof(correct));
+        if (result(i) != correct) {
+            printf("bfloat16 of %g is %g instead of %g\n", f, result(i), correct);
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    Target t = get_jit_target_from_environment();
+    std::vector<Target> targets = {t};
+    if (t.arch == Target::X86 && !t.has_feature(Target::F16C) &&
+        get_host_target().has_feature(Target::F16C)) {
+        targets.push_back(t.with_feature(Target::F16C));
+    }
+
+    for (const Target &target : targets) {
+        if (!test_float16(target) || !test_bfloat16(target)) {
+            printf("Failed for target %s\n", target.to_string().c_str());
+            return -1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,87 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+// Count the kernel launches in a pipeline.
+class CountKernels : public IRVisitor {
+    using IRVisitor::visit;
+
+    bool in_kernel = false;
+
+    void visit(const For *op) {
+        if (op->for_type == ForType::GPUBlock && !in_kernel) {
+            count++;
+            in_kernel = true;
+            IRVisitor::visit(op);
+            in_kernel = false;
+        } else {
+            IRVisitor::visit(op);
+        }
+    }
+
+public:
+    int count = 0;
+};
+
+class CheckKernelCount : public IRMutator {
+    int correct;
+public:
+    CheckKernelCount(int correct) : correct(correct) {}
+    using IRMutator::mutate;
+
+    Stmt mutate(Stmt s) {
+        CountKernels c;
+        s.accept(&c);
+
+        if (c.count != correct) {
+            printf("There were %d kernels. There were supposed to be %d\n", c.count, correct);
+            exit(-1);
+        }
+
+        return s;
+    }
+};
+
+int main(int argc, char **argv) {
+    Target target = get_jit_target_from_environment();
+    if (!target.has_gpu_feature()) {
+        printf("No gpu target enabled. Skipping test.\n");
+        return 0;
+    }
+    target.set_feature(Target::FuseGPUKernels);
+
+    Var x, y, xi, yi;
+
+    // A chain of pointwise stages, followed by one that reads its
+    // input at a neighbouring pixel.
+    Func f, g, h, out;
+    f(x, y) = x + y * 256;
+    g(x, y) = f(x, y) * 3;
+    h(x, y) = g(x, y) - f(x, y);
+    out(x, y) = h(x + 1, y) + h(x, y);
+
+    f.compute_root().gpu_tile(x, y, xi, yi, 16, 16);
+    g.compute_root().gpu_tile(x, y, xi, yi, 16, 16);
+    h.compute_root().gpu_tile(x, y, xi, yi, 16, 16);
+    out.gpu_tile(x, y, xi, yi, 16, 16);
+
+    // f, g, and h can run in one kernel, but out can't, because each
+    // of its threads reads values of h computed by another thread.
+    out.add_custom_lowering_pass(new CheckKernelCount(2));
+
+    Buffer<int> result = out.realize(128, 128, target);
+    for (int y = 0; y < result.height(); y++) {
+        for (int x = 0; x < result.width(); x++) {
+            int correct = 2 * (x + 1 + y * 256) + 2 * (x + y * 256);
+            if (result(x, y) != correct) {
+                printf("result(%d, %d) = %d instead of %d\n", x, y, result(x, y), correct);
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,71 @@
+#include "Halide.h"
+#include <stdio.h>
+#include <vector>
+
+using namespace Halide;
+
+#ifdef _WIN32
+#define DLLEXPORT __declspec(dllexport)
+#else
+#define DLLEXPORT
+#endif
+
+std::vector<std::pair<int, int>> visited;
+extern "C" DLLEXPORT int record_visit(int x, int y) {
+    visited.push_back({x, y});
+    return x + y * 100;
+}
+HalideExtern_2(int, record_visit, int, int);
+
+int main(int argc, char **argv) {
+    // 5x3 tiles, so neither extent is a power of two.
+    const int W = 20, H = 12, T = 4;
+
+    Var x("x"), y("y"), xo("xo"), yo("yo"), xi("xi"), yi("yi"), t("t");
+    Func f("f");
+    f(x, y) = record_visit(x, y);
+    f.tile(x, y, xo, yo, xi, yi, T, T).fuse_z_order(xo, yo, t);
+
+    Buffer<int> result = f.realize(W, H);
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            if (result(x, y) != x + y * 100) {
+                printf("result(%d, %d) = %d instead of %d\n", x, y, result(x, y), x + y * 100);
+                return -1;
+            }
+        }
+    }
+
+    if (visited.size() != (size_t)(W * H)) {
+        printf("%d points were visited instead of %d\n", (int)visited.size(), W * H);
+        return -1;
+    }
+
+    // Each tile is visited in one go. The tiles go in Z-order.
+    std::vector<std::pair<int, int>> tiles;
+    for (size_t i = 0; i < visited.size(); i += T * T) {
+        std::pair<int, int> tile = {visited[i].first / T, visited[i].second / T};
+        for (size_t j = i; j < i + T * T; j++) {
+            if (visited[j].first / T != tile.first || visited[j].second / T != tile.second) {
+                printf("Tile (%d, %d) was not visited in one go\n", tile.first, tile.second);
+                return -1;
+            }
+        }
+        tiles.push_back(tile);
+    }
+    std::vector<std::pair<int, int>> correct = {
+        {0, 0}, {1, 0}, {0, 1}, {1, 1}, {2, 0}, {3, 0}, {2, 1}, {3, 1},
+        {0, 2}, {1, 2}, {2, 2}, {3, 2}, {4, 0}, {4, 1}, {4, 2}
+    };
+    if (tiles != correct) {
+        printf("The tiles were visited in the wrong order:\n");
+        for (auto tile : tiles) {
+            printf(" (%d, %d)", tile.first, tile.second);
+        }
+        printf("\n");
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
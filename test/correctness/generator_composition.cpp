@@ -0,0 +1,128 @@
+#include "Halide.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <fstream>
+#include <sstream>
+
+#include "test/common/halide_test_dirs.h"
+
+using namespace Halide;
+
+class Scale : public Generator<Scale> {
+public:
+    GeneratorParam<int> factor{"factor", 2};
+
+    Input<Func> input{"input", Int(32), 2};
+    Input<int> offset{"offset"};
+
+    Output<Func> output{"output", Int(32), 2};
+
+    void generate() {
+        output(x, y) = input(x, y) * factor + offset;
+    }
+
+    void schedule() {
+        output.compute_root();
+    }
+
+private:
+    Var x{"x"}, y{"y"};
+};
+
+class Blur : public Generator<Blur> {
+public:
+    Input<Func> input{"input", Int(32), 2};
+
+    Output<Func> output{"output", Int(32), 2};
+
+    void generate() {
+        output(x, y) = input(x - 1, y) + input(x, y) + input(x + 1, y);
+    }
+
+    void schedule() {
+    }
+
+private:
+    Var x{"x"}, y{"y"};
+};
+
+HALIDE_REGISTER_GENERATOR(Scale, composition_scale)
+HALIDE_REGISTER_GENERATOR(Blur, composition_blur)
+
+const char *manifest =
+    "# stage  generator          settings\n"
+    "scale    composition_scale  input=$in offset=3 factor=5\n"
+    "blur     composition_blur   input=scale.output\n"
+    "blur2    composition_blur   input=blur.output  # the same Generator again\n";
+
+std::string lowered(Func f, const std::string &name) {
+    std::string stmt_file = Internal::get_test_tmp_dir() + name + ".stmt";
+    Internal::ensure_no_file_exists(stmt_file);
+    f.compile_to_lowered_stmt(stmt_file, {});
+    std::ifstream file(stmt_file);
+    std::stringstream contents;
+    contents << file.rdbuf();
+    return contents.str();
+}
+
+int check(Func out) {
+    const int W = 32, H = 8;
+    Buffer<int> result = out.realize(W, H);
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            int correct = 0;
+            for (int i = x - 2; i <= x + 2; i++) {
+                // The number of ways to get from i to x in two steps of the blur.
+                int weight = 3 - std::abs(i - x);
+                correct += weight * ((i * 7 + y) * 5 + 3);
+            }
+            if (result(x, y) != correct) {
+                printf("result(%d, %d) = %d instead of %d\n", x, y, result(x, y), correct);
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    GeneratorContext context(get_jit_target_from_environment());
+    Var x, y;
+    Func in("in");
+    in(x, y) = x * 7 + y;
+
+    {
+        // Unless scheduled otherwise, each stage is inlined into the
+        // next one.
+        GeneratorComposition stages(context, manifest, {{"in", in}});
+        Func out = stages.get_output("blur2.output");
+        if (stages.stages().size() != 3 || out.name() != "blur2_output") {
+            printf("Unexpected stages\n");
+            return -1;
+        }
+        if (lowered(out, "generator_composition_inline").find("scale_output") != std::string::npos) {
+            printf("Expected the scale stage to be inlined\n");
+            return -1;
+        }
+        if (check(out) != 0) return -1;
+    }
+
+    {
+        // The schedules of the stages can be applied, and then
+        // changed across the stages.
+        GeneratorComposition stages(context, manifest, {{"in", in}});
+        stages.schedule();
+        Func out = stages.get_output("blur2.output");
+        stages.get_output("blur.output").compute_at(out, y);
+        std::string stmt = lowered(out, "generator_composition_scheduled");
+        if (stmt.find("produce scale_output") == std::string::npos ||
+            stmt.find("produce blur_output") == std::string::npos) {
+            printf("Expected the scale and blur stages to be computed separately\n");
+            return -1;
+        }
+        if (check(out) != 0) return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
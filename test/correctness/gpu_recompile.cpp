@@ -0,0 +1,38 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    Target target = get_jit_target_from_environment();
+    if (!target.has_gpu_feature()) {
+        printf("Not running test because no gpu target enabled\n");
+        return 0;
+    }
+
+    // Compiling the same pipeline again, as an interactive tool does
+    // each time it is edited, should reuse the kernels already loaded
+    // by the shared GPU runtime, in the same context.
+    for (int i = 0; i < 20; i++) {
+        Var x, y, xi, yi;
+        Func f;
+        // Only some of the pipelines have the same kernels.
+        f(x, y) = x * 2 + y + (i % 3);
+        f.gpu_tile(x, y, xi, yi, 8, 8);
+
+        Buffer<int> out = f.realize(32, 32, target);
+        for (int y = 0; y < 32; y++) {
+            for (int x = 0; x < 32; x++) {
+                int correct = x * 2 + y + (i % 3);
+                if (out(x, y) != correct) {
+                    printf("out(%d, %d) = %d instead of %d in iteration %d\n",
+                           x, y, out(x, y), correct, i);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
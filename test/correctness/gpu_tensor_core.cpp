@@ -0,0 +1,62 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    Target target = get_jit_target_from_environment();
+    if (!target.has_feature(Target::CUDA)) {
+        printf("Not running with CUDA. Skipping test.\n");
+        return 0;
+    }
+
+    // Small integers, so that the sums are exact whatever order the
+    // tensor cores add them in.
+    const int size = 64;
+    Buffer<float16_t> a(size, size), b(size, size);
+    for (int y = 0; y < size; y++) {
+        for (int x = 0; x < size; x++) {
+            a(x, y) = float16_t((float)((x * 3 + y * 5) % 7 - 3));
+            b(x, y) = float16_t((float)((x * 2 + y * 7) % 5 - 2));
+        }
+    }
+
+    for (int transpose_a = 0; transpose_a < 2; transpose_a++) {
+        Var x, y, xo, yo, xi, yi;
+        RDom r(0, size);
+        RVar ro, ri;
+
+        // With transpose_a, the columns of A are dense instead of its rows.
+        Func c;
+        Expr a_val = transpose_a ? a(y, r) : a(r, y);
+        c(x, y) = 0.0f;
+        c(x, y) += cast<float>(a_val) * cast<float>(b(x, r));
+
+        c.gpu_tile(x, y, xo, yo, xi, yi, 16, 16);
+        c.update()
+            .split(x, xo, xi, 16)
+            .split(y, yo, yi, 16)
+            .split(r, ro, ri, 16)
+            .reorder(ri, xi, yi, ro, xo, yo)
+            .gpu_blocks(xo, yo)
+            .gpu_tensor_core(yi, xi, ri);
+
+        Buffer<float> out = c.realize(size, size);
+        for (int y = 0; y < size; y++) {
+            for (int x = 0; x < size; x++) {
+                float correct = 0.0f;
+                for (int k = 0; k < size; k++) {
+                    float a_k = (float)(transpose_a ? a(y, k) : a(k, y));
+                    correct += a_k * (float)b(x, k);
+                }
+                if (out(x, y) != correct) {
+                    printf("out(%d, %d) = %f instead of %f\n", x, y, out(x, y), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
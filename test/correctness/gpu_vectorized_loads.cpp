@@ -0,0 +1,67 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    Target target = get_jit_target_from_environment();
+    if (!target.has_gpu_feature()) {
+        printf("No gpu target enabled. Skipping test.\n");
+        return 0;
+    }
+
+    const int size = 4096;
+    Buffer<float> input(size + 8);
+    for (int i = 0; i < size + 8; i++) {
+        input(i) = (float)((i * 17) % 101);
+    }
+
+    Var x, xo, xi, xv;
+
+    {
+        // Each thread loads four contiguous values from a read-only
+        // input, both at aligned and at misaligned offsets.
+        Func f;
+        f(x) = input(x) * 2.0f + input(x + 4) + input(x + 1);
+        f.split(x, xo, xi, 256)
+            .split(xi, xi, xv, 4)
+            .gpu_blocks(xo)
+            .gpu_threads(xi)
+            .vectorize(xv);
+
+        Buffer<float> out = f.realize(size);
+        for (int i = 0; i < size; i++) {
+            float correct = input(i) * 2.0f + input(i + 4) + input(i + 1);
+            if (out(i) != correct) {
+                printf("out(%d) = %f instead of %f\n", i, out(i), correct);
+                return -1;
+            }
+        }
+    }
+
+    {
+        // When kernels are fused, a buffer can be written and then
+        // read by the same kernel, so it must not be treated as read
+        // only.
+        Target fused = target;
+        fused.set_feature(Target::FuseGPUKernels);
+
+        Func f, g;
+        f(x) = input(x) + 1.0f;
+        g(x) = f(x) * 3.0f;
+        f.compute_root().gpu_tile(x, xo, xi, 64);
+        g.gpu_tile(x, xo, xi, 64);
+
+        Buffer<float> out = g.realize(size, fused);
+        for (int i = 0; i < size; i++) {
+            float correct = (input(i) + 1.0f) * 3.0f;
+            if (out(i) != correct) {
+                printf("fused out(%d) = %f instead of %f\n", i, out(i), correct);
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
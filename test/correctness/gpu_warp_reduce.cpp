@@ -0,0 +1,73 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    Target target = get_jit_target_from_environment();
+    if (!target.has_gpu_feature()) {
+        printf("No gpu target enabled. Skipping test.\n");
+        return 0;
+    }
+
+    const int rows = 100;
+    Buffer<int> input(32, rows);
+    for (int y = 0; y < rows; y++) {
+        for (int x = 0; x < 32; x++) {
+            input(x, y) = (x * 7 + y * 13) % 101 - 50;
+        }
+    }
+
+    Var x, xo, xi;
+    RDom r(0, 32);
+
+    {
+        // A sum of each row, with a term per thread.
+        Func f;
+        f(x) = 0;
+        f(x) += input(r, x);
+
+        f.gpu_blocks(x);
+        f.update().gpu_blocks(x).gpu_warp_reduce(r);
+
+        Buffer<int> out = f.realize(rows);
+        for (int y = 0; y < rows; y++) {
+            int correct = 0;
+            for (int i = 0; i < 32; i++) {
+                correct += input(i, y);
+            }
+            if (out(y) != correct) {
+                printf("sum(%d) = %d instead of %d\n", y, out(y), correct);
+                return -1;
+            }
+        }
+    }
+
+    {
+        // A max of the terms computed by an earlier stage at the
+        // block level, with a different block and thread structure.
+        Func g, h;
+        g(x, xi) = cast<float>(input(xi, x)) * 0.5f;
+        h(x) = -1000.0f;
+        h(x) = max(h(x), g(x, r));
+
+        h.gpu_tile(x, xo, xi, 4);
+        h.update().split(x, xo, xi, 4).gpu_blocks(xo).gpu_warp_reduce(r);
+        g.compute_at(h, xo).gpu_threads(xi);
+
+        Buffer<float> out = h.realize(rows);
+        for (int y = 0; y < rows; y++) {
+            float correct = -1000.0f;
+            for (int i = 0; i < 32; i++) {
+                correct = std::max(correct, input(i, y) * 0.5f);
+            }
+            if (out(y) != correct) {
+                printf("max(%d) = %f instead of %f\n", y, out(y), correct);
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
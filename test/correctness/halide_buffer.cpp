@@ -3,6 +3,28 @@
 
 using namespace Halide::Runtime;
 
+// Count heap allocations, to check that making views of buffers
+// doesn't allocate.
+int heap_allocations = 0;
+
+void *operator new(size_t size) {
+    heap_allocations++;
+    return malloc(size);
+}
+
+void *operator new[](size_t size) {
+    heap_allocations++;
+    return malloc(size);
+}
+
+void operator delete(void *p) noexcept {
+    free(p);
+}
+
+void operator delete[](void *p) noexcept {
+    free(p);
+}
+
 template<typename T1, typename T2>
 void check_equal_shape(const Buffer<T1> &a, const Buffer<T2> &b) {
     if (a.dimensions() != b.dimensions()) abort();
@@ -126,6 +148,110 @@ int main(int argc, char **argv) {
         });
     }
 
+    {
+        // Check the fast paths for copying and filling buffers whose
+        // elements are dense in memory, and for crops of them.
+        Buffer<uint16_t> a(64, 32, 3), b(64, 32, 3);
+        a.for_each_element([&](int x, int y, int c) {
+            a(x, y, c) = x + 64 * y + 4096 * c;
+        });
+        b.copy_from(a);
+        check_equal(a, b);
+
+        Buffer<uint16_t> a_window = a.cropped(0, 8, 40).cropped(1, 4, 20);
+        b.fill(0);
+        b.copy_from(a_window);
+        b.for_each_element([&](int x, int y, int c) {
+            uint16_t correct = (x >= 8 && x < 48 && y >= 4 && y < 24) ? a(x, y, c) : 0;
+            if (b(x, y, c) != correct) {
+                printf("b(%d, %d, %d) = %d instead of %d\n", x, y, c, b(x, y, c), correct);
+                abort();
+            }
+        });
+
+        // Filling with values that are and aren't a repeated byte.
+        Buffer<uint16_t> b_window = b.cropped(0, 8, 40);
+        for (uint16_t v : {0x0000, 0x1212, 0x1234}) {
+            b.fill(1);
+            b_window.fill(v);
+            b.for_each_element([&](int x, int y, int c) {
+                uint16_t correct = (x >= 8 && x < 48) ? v : 1;
+                if (b(x, y, c) != correct) {
+                    printf("b(%d, %d, %d) = %d instead of %d\n", x, y, c, b(x, y, c), correct);
+                    abort();
+                }
+            });
+        }
+    }
+
+    {
+        // Check that views of buffers with no more than D dimensions
+        // don't touch the heap.
+        Buffer<float> a(100, 80, 3);
+        int before = heap_allocations;
+        float sum = 0;
+        for (int i = 0; i < 10; i++) {
+            Buffer<float> tile = a.cropped(0, i * 10, 10).cropped(1, i * 8, 8);
+            Buffer<float> row = tile.sliced(1, i * 8);
+            Buffer<float> embedded = row.embedded(1, 3);
+            Buffer<const float> transposed = embedded.transposed(0, 1);
+            sum += transposed.dim(0).extent() + tile.translated(0, 5).dim(0).min();
+        }
+        if (heap_allocations != before) {
+            printf("Making views of a buffer did %d heap allocations\n", heap_allocations - before);
+            return -1;
+        }
+
+        // Deep copies allocate the data with malloc, and nothing else.
+        before = heap_allocations;
+        Buffer<float> b = a.transposed(0, 2).copy();
+        if (heap_allocations != before) {
+            printf("Copying a buffer did %d heap allocations with new\n", heap_allocations - before);
+            return -1;
+        }
+    }
+
+    {
+        // Buffers with a static dimensionality interoperate with
+        // dynamic ones, and slicing and embedding change the static
+        // dimensionality.
+        Buffer<int, 4, 3> a(20, 10, 3);
+        static_assert(Buffer<int, 4, 3>::static_dimensions == 3, "Wrong static dimensionality");
+        a.for_each_element([&](int x, int y, int c) {
+            a(x, y, c) = x + y * 100 + c * 10000;
+        });
+
+        Buffer<int, 4, 2> green = a.sliced(2, 1);
+        Buffer<int, 4, 3> embedded = green.embedded(0, 7);
+        Buffer<int> dynamic = embedded;
+        Buffer<const int, 4, 3> back = dynamic;
+        if (back.dimensions() != 3 || back(7, 4, 5) != 4 + 5 * 100 + 10000) {
+            printf("back(7, 4, 5) = %d instead of %d\n", back(7, 4, 5), 4 + 5 * 100 + 10000);
+            return -1;
+        }
+
+        Buffer<int, 4, 3> b(20, 10, 3);
+        b.fill(0);
+        b.copy_from(a);
+        int errors = 0;
+        b.for_each_value([&](int x, int y) {
+            errors += (x != y);
+        }, a);
+        b.for_each_element([&](const int *pos) {
+            errors += (b(pos) != a(pos));
+        });
+        if (errors) {
+            printf("Copying a statically-shaped buffer produced %d errors\n", errors);
+            return -1;
+        }
+
+        Buffer<void, 4, 3> untyped = b;
+        if (untyped.as<int>()(3, 2, 1) != 3 + 200 + 10000) {
+            printf("Wrong value after round trip through Buffer<void>\n");
+            return -1;
+        }
+    }
+
     printf("Success!\n");
     return 0;
 }
@@ -0,0 +1,100 @@
+#include "Halide.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace Halide;
+
+int malloc_count = 0;
+
+void *my_malloc(void *user_context, size_t x) {
+    malloc_count++;
+    void *orig = malloc(x + 32);
+    void *ptr = (void *)((((size_t)orig + 32) >> 5) << 5);
+    ((void **)ptr)[-1] = orig;
+    return ptr;
+}
+
+void my_free(void *user_context, void *ptr) {
+    free(((void **)ptr)[-1]);
+}
+
+int run(bool hoist, bool tuple) {
+    Var x("x"), y("y");
+    Func g("g"), f("f");
+    if (tuple) {
+        g(x, y) = Tuple(x * 2 + y, x - y);
+        // The region of g needed varies from row to row.
+        f(x, y) = g(min(x, y), y)[0] + g(min(x, y) + 1, y)[1];
+    } else {
+        g(x, y) = x * 2 + y;
+        f(x, y) = g(min(x, y), y) + g(min(x, y) + 1, y);
+    }
+
+    g.compute_at(f, y);
+    if (hoist) {
+        g.hoist_storage_root();
+    }
+    f.set_custom_allocator(my_malloc, my_free);
+
+    const int W = 100, H = 64;
+    malloc_count = 0;
+    Buffer<int> out = f.realize(W, H);
+    int expected_mallocs = hoist ? 1 : H;
+    if (tuple) expected_mallocs *= 2;
+    if (malloc_count != expected_mallocs) {
+        printf("%d allocations instead of %d (hoist = %d, tuple = %d)\n",
+               malloc_count, expected_mallocs, hoist, tuple);
+        return -1;
+    }
+
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            int i = std::min(x, y);
+            int correct = tuple ? (i * 2 + y) + (i + 1 - y) : (i * 2 + y) + ((i + 1) * 2 + y);
+            if (out(x, y) != correct) {
+                printf("out(%d, %d) = %d instead of %d (hoist = %d, tuple = %d)\n",
+                       x, y, out(x, y), correct, hoist, tuple);
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    for (bool tuple : {false, true}) {
+        for (bool hoist : {false, true}) {
+            if (run(hoist, tuple) != 0) return -1;
+        }
+    }
+
+    {
+        // Hoisting to a loop level between the compute level and the
+        // root allocates once per iteration of that loop.
+        Var x("x"), y("y"), yo("yo"), yi("yi");
+        Func g("g"), f("f");
+        g(x, y) = x + y;
+        f(x, y) = g(x, y) + g(x + 1, y);
+        f.split(y, yo, yi, 8);
+        g.compute_at(f, yi).hoist_storage(f, yo);
+        f.set_custom_allocator(my_malloc, my_free);
+        malloc_count = 0;
+        Buffer<int> out = f.realize(100, 64);
+        if (malloc_count != 8) {
+            printf("%d allocations instead of 8\n", malloc_count);
+            return -1;
+        }
+        for (int y = 0; y < 64; y++) {
+            for (int x = 0; x < 100; x++) {
+                int correct = 2 * (x + y) + 1;
+                if (out(x, y) != correct) {
+                    printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -154,6 +154,64 @@ Func make_noise(int depth) {
     return f;
 }
 
+// Check that an image saved as .tmp, or written as .npy, can be
+// mapped back in without a copy.
+template<typename T>
+void test_map(Buffer<T> buf) {
+    std::cout << "Testing mapping .tmp and .npy files for " << halide_type_of<T>() << "\n";
+
+    // Both formats are dense and planar, with zero mins.
+    Buffer<T> dense = buf.copy();
+    dense.set_min(0, 0, 0);
+
+    std::string tmp_file = Internal::get_test_tmp_dir() + "test_mapped.tmp";
+    Buffer<T> dense4 = dense.embedded(3, 0);
+    Tools::save_image(dense4, tmp_file);
+
+    // numpy lists the outermost dimension first
+    std::string npy_file = Internal::get_test_tmp_dir() + "test_mapped.npy";
+    {
+        std::ostringstream header;
+        header << "{'descr': '<" << (halide_type_of<T>().code == halide_type_uint ? 'u' : 'i')
+               << sizeof(T) << "', 'fortran_order': False, 'shape': ("
+               << dense.channels() << ", " << dense.height() << ", " << dense.width() << "), }";
+        std::string h = header.str();
+        // Pad the header with spaces and a newline so that the data is 16-byte aligned.
+        while ((10 + h.size() + 1) % 16) {
+            h += ' ';
+        }
+        h += '\n';
+        FILE *f = fopen(npy_file.c_str(), "wb");
+        const uint8_t preamble[10] = {0x93, 'N', 'U', 'M', 'P', 'Y', 1, 0,
+                                      (uint8_t)(h.size() & 0xff), (uint8_t)(h.size() >> 8)};
+        fwrite(preamble, 1, sizeof(preamble), f);
+        fwrite(h.data(), 1, h.size(), f);
+        fwrite(dense.data(), 1, dense.size_in_bytes(), f);
+        fclose(f);
+    }
+
+    for (std::string file : {tmp_file, npy_file}) {
+        Tools::MappedFile mapping;
+        Buffer<T> mapped;
+        if (!Tools::map_image(file, &mapping, &mapped)) {
+            printf("Failed to map %s\n", file.c_str());
+            abort();
+        }
+        if (mapped.width() != dense.width() ||
+            mapped.height() != dense.height() ||
+            mapped.channels() != dense.channels()) {
+            printf("Mapped %s has the wrong shape\n", file.c_str());
+            abort();
+        }
+        mapped.for_each_element([&](const int *pos) {
+            if (mapped(pos) != dense(pos)) {
+                printf("Mismatch in %s at %d %d %d\n", file.c_str(), pos[0], pos[1], pos[2]);
+                abort();
+            }
+        });
+    }
+}
+
 template<typename T>
 void do_test() {
     const int width = 1600;
@@ -176,6 +234,7 @@ void do_test() {
     test_convert_image_s2d<T>(color_buf);
     test_convert_image_d2s<T>(color_buf);
     test_convert_image_d2d<T>(color_buf);
+    test_map<T>(color_buf);
 
     Buffer<T> luma_buf(width, height, 1);
     luma_buf.copy_from(color_buf);
@@ -623,6 +623,46 @@ int multi_folds_wrapper_test() {
     return 0;
 }
 
+int stage_input_test() {
+    Func source("source"), g("g");
+    Var x("x"), y("y"), xo("xo"), yo("yo"), xi("xi"), yi("yi");
+
+    source(x, y) = x + y;
+    ImageParam img(Int(32), 2, "img");
+    Buffer<int> buf = source.realize(201, 200);
+    img.set(buf);
+
+    g(x, y) = img(x, y) + img(x + 1, y);
+
+    Target target = get_jit_target_from_environment();
+    if (target.has_gpu_feature()) {
+        g.gpu_tile(x, y, xo, yo, xi, yi, 16, 16);
+    } else {
+        g.tile(x, y, xo, yo, xi, yi, 16, 16);
+    }
+    Func wrapper = g.stage_input(img, xo);
+
+    // Expect 'g' to call 'wrapper', and 'wrapper' to call 'img'
+    Module m = g.compile_to_module({g.infer_arguments()});
+    CheckCalls c;
+    m.functions().front().body.accept(&c);
+
+    CallGraphs expected = {
+        {g.name(), {wrapper.name()}},
+        {wrapper.name(), {img.name()}},
+    };
+    if (check_call_graphs(c.calls, expected) != 0) {
+        return -1;
+    }
+
+    Buffer<int> im = g.realize(200, 200, target);
+    auto func = [](int x, int y) { return 2*(x + y) + 1; };
+    if (check_image(im, func)) {
+        return -1;
+    }
+    return 0;
+}
+
 int main(int argc, char **argv) {
     printf("Running calling wrap no op test\n");
     if (calling_wrapper_no_op_test() != 0) {
@@ -684,6 +724,11 @@ int main(int argc, char **argv) {
         return -1;
     }
 
+    printf("Running stage input test\n");
+    if (stage_input_test() != 0) {
+        return -1;
+    }
+
     printf("Success!\n");
     return 0;
 }
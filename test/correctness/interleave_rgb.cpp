@@ -4,7 +4,7 @@
 using namespace Halide;
 
 template <typename T>
-bool test_interleave() {
+bool test_interleave(int vector_factor) {
     Var x("x"), y("y"), c("c");
 
     Func input("input");
@@ -30,7 +30,7 @@ bool test_interleave() {
         const int vector_width = 128 / sizeof(T);
         interleaved.hexagon().vectorize(x, vector_width).unroll(c);
     } else {
-        interleaved.vectorize(x, target.natural_vector_size<uint8_t>()).unroll(c);
+        interleaved.vectorize(x, target.natural_vector_size<uint8_t>() * vector_factor).unroll(c);
     }
     Buffer<T> buff = Buffer<T>::make_interleaved(256, 128, 3);
     interleaved.realize(buff, target);
@@ -50,9 +50,12 @@ bool test_interleave() {
 }
 
 int main(int argc, char **argv) {
-    if (!test_interleave<uint8_t>()) return -1;
-    if (!test_interleave<uint16_t>()) return -1;
-    if (!test_interleave<uint32_t>()) return -1;
+    // Check vectors of one and two native vectors of bytes.
+    for (int vector_factor : {1, 2}) {
+        if (!test_interleave<uint8_t>(vector_factor)) return -1;
+        if (!test_interleave<uint16_t>(vector_factor)) return -1;
+        if (!test_interleave<uint32_t>(vector_factor)) return -1;
+    }
 
     printf("Success!\n");
     return 0;
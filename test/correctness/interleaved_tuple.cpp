@@ -0,0 +1,108 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+// Count the allocations in a pipeline.
+class CountAllocations : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const Allocate *op) {
+        count++;
+        IRVisitor::visit(op);
+    }
+
+public:
+    int count = 0;
+};
+
+class CheckAllocationCount : public IRMutator {
+    int correct;
+public:
+    CheckAllocationCount(int correct) : correct(correct) {}
+    using IRMutator::mutate;
+
+    Stmt mutate(Stmt s) {
+        CountAllocations c;
+        s.accept(&c);
+
+        if (c.count != correct) {
+            printf("There were %d allocations. There were supposed to be %d\n", c.count, correct);
+            exit(-1);
+        }
+
+        return s;
+    }
+};
+
+int main(int argc, char **argv) {
+    const int W = 256, H = 64;
+    Var x, y;
+
+    Buffer<float> input(W, H);
+    for (int yy = 0; yy < H; yy++) {
+        for (int xx = 0; xx < W; xx++) {
+            input(xx, yy) = (float)((xx * 17 + yy * 3) % 31);
+        }
+    }
+
+    for (int vector_width : {1, 2, 4, 8}) {
+        // A complex number stored as one interleaved buffer.
+        Func c, out;
+        c(x, y) = Tuple(input(x, y), input(x, y) * 2 - 3);
+        // An update that swaps its elements must read both before
+        // writing either.
+        c(x, y) = Tuple(c(x, y)[1], c(x, y)[0]);
+        out(x, y) = c(x, y)[0] * c(x, y)[0] - c(x, y)[1] * c(x, y)[1];
+
+        c.compute_root().store_tuple_interleaved();
+        if (vector_width > 1) {
+            c.vectorize(x, vector_width);
+            c.update().vectorize(x, vector_width);
+            out.vectorize(x, vector_width);
+        }
+        out.add_custom_lowering_pass(new CheckAllocationCount(1));
+
+        Buffer<float> result = out.realize(W, H);
+        for (int yy = 0; yy < H; yy++) {
+            for (int xx = 0; xx < W; xx++) {
+                float re = input(xx, yy) * 2 - 3, im = input(xx, yy);
+                float correct = re * re - im * im;
+                if (result(xx, yy) != correct) {
+                    printf("result(%d, %d) = %f instead of %f with vector width %d\n",
+                           xx, yy, result(xx, yy), correct, vector_width);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    // Interleaving composes with storage reordering, and a Tuple
+    // stored without interleaving still gets one allocation per
+    // element.
+    for (bool interleave : {true, false}) {
+        Func f, g;
+        f(x, y) = Tuple(x + y, x - y, x * y);
+        g(x, y) = f(x, y)[0] + f(x, y)[1] * 2 + f(x, y)[2] * 3;
+        f.compute_at(g, y).reorder_storage(y, x);
+        if (interleave) {
+            f.store_tuple_interleaved();
+        }
+        g.add_custom_lowering_pass(new CheckAllocationCount(interleave ? 1 : 3));
+        Buffer<int> result = g.realize(W, H);
+        for (int yy = 0; yy < H; yy++) {
+            for (int xx = 0; xx < W; xx++) {
+                int correct = (xx + yy) + (xx - yy) * 2 + (xx * yy) * 3;
+                if (result(xx, yy) != correct) {
+                    printf("result(%d, %d) = %d instead of %d\n",
+                           xx, yy, result(xx, yy), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,105 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <map>
+#include <string>
+#include "Halide.h"
+
+#ifndef _WIN32
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace Halide;
+
+// Explicitly named, so that both compilations lower to identical IR.
+Func make_pipeline() {
+    Var x("x"), y("y");
+    Func f("f"), g("g");
+    f(x, y) = x * 3 + y;
+    g(x, y) = f(x, y) + f(x + 1, y) * 2;
+    f.compute_root().vectorize(x, 8);
+    g.parallel(y);
+    return g;
+}
+
+int check(const Buffer<int> &im) {
+    for (int y = 0; y < im.height(); y++) {
+        for (int x = 0; x < im.width(); x++) {
+            int correct = (x * 3 + y) + (x * 3 + 3 + y) * 2;
+            if (im(x, y) != correct) {
+                printf("im(%d, %d) = %d instead of %d\n", x, y, im(x, y), correct);
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+#ifndef _WIN32
+// The files in a directory, with their inode numbers. The cache renames
+// each object it writes into place, so a rewritten entry gets a new
+// inode.
+std::map<std::string, ino_t> list_dir(const std::string &dir) {
+    std::map<std::string, ino_t> entries;
+    DIR *d = opendir(dir.c_str());
+    if (!d) {
+        return entries;
+    }
+    while (dirent *e = readdir(d)) {
+        std::string name = e->d_name;
+        struct stat st;
+        if (name != "." && name != ".." &&
+            stat((dir + "/" + name).c_str(), &st) == 0) {
+            entries[name] = st.st_ino;
+        }
+    }
+    closedir(d);
+    return entries;
+}
+#endif
+
+int main(int argc, char **argv) {
+#ifdef _WIN32
+    printf("Skipping test because it lists the cache directory with posix calls\n");
+    return 0;
+#else
+    static std::string dir = Internal::dir_make_temp();
+    static std::string env = "HL_JIT_CACHE_DIR=" + dir;
+    putenv(&env[0]);
+    Internal::JITSharedRuntime::release_all();
+
+    // The first compilation populates the cache, and the second (with
+    // a fresh runtime) should load the pipeline and the runtime back
+    // out of it without writing anything.
+    std::map<std::string, ino_t> cached;
+    for (int i = 0; i < 2; i++) {
+        Buffer<int> im = make_pipeline().realize(64, 64);
+        if (check(im) != 0) {
+            return -1;
+        }
+        Internal::JITSharedRuntime::release_all();
+
+        std::map<std::string, ino_t> entries = list_dir(dir);
+        if (i == 0) {
+            // The pipeline and the runtime.
+            if (entries.size() < 2) {
+                printf("Expected at least two cache entries, found %d\n", (int)entries.size());
+                return -1;
+            }
+            cached = entries;
+        } else if (entries != cached) {
+            printf("The second compilation wrote to the cache instead of reading from it\n");
+            return -1;
+        }
+    }
+
+    for (const auto &e : cached) {
+        Internal::file_unlink(dir + "/" + e.first);
+    }
+    Internal::dir_rmdir(dir);
+
+    printf("Success!\n");
+    return 0;
+#endif
+}
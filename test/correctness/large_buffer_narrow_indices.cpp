@@ -0,0 +1,53 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+// With large buffers, the indices of the loads and stores in inner
+// loops are computed as a 64-bit base plus a 32-bit offset. Check
+// that this doesn't change the results, both for dense accesses and
+// for gathers through a lookup table.
+int main(int argc, char **argv) {
+    const int W = 300, H = 100;
+
+    Buffer<uint8_t> in(W + 2, H);
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W + 2; x++) {
+            in(x, y) = (uint8_t)(x * 7 + y * 13);
+        }
+    }
+    Buffer<int> lut(256);
+    for (int i = 0; i < 256; i++) {
+        lut(i) = i * i - 1000;
+    }
+
+    Buffer<int> results[2];
+    for (int large = 0; large < 2; large++) {
+        Var x, y, xi;
+        Func blur, f;
+        blur(x, y) = cast<int>(in(x, y)) + in(x + 1, y) + in(x + 2, y);
+        f(x, y) = blur(x, y) + lut(clamp(blur(x, y) / 3, 0, 255)) + lut(in(x, y));
+
+        blur.compute_at(f, y).vectorize(x, 8);
+        f.split(x, x, xi, 16).vectorize(xi, 8).unroll(xi);
+
+        Target t = get_jit_target_from_environment();
+        if (large) {
+            t.set_feature(Target::LargeBuffers);
+        }
+        results[large] = f.realize(W, H, t);
+    }
+
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            if (results[0](x, y) != results[1](x, y)) {
+                printf("result(%d, %d) = %d with large buffers instead of %d\n",
+                       x, y, results[1](x, y), results[0](x, y));
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,80 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+// Count the times a pipeline is lowered, and the loops over f in the
+// most recent lowering.
+class CountLoops : public IRMutator {
+    class Counter : public IRVisitor {
+        using IRVisitor::visit;
+
+        void visit(const For *op) {
+            if (starts_with(op->name, "f.s0.x")) {
+                loops++;
+            }
+            IRVisitor::visit(op);
+        }
+
+    public:
+        int loops = 0;
+    };
+
+public:
+    int lowerings = 0, loops = 0;
+
+    using IRMutator::mutate;
+
+    Stmt mutate(Stmt s) {
+        Counter c;
+        s.accept(&c);
+        lowerings++;
+        loops = c.loops;
+        return s;
+    }
+};
+
+int main(int argc, char **argv) {
+    Var x("x");
+    Param<int> p("p");
+
+    Func f("f");
+    f(x) = x * p;
+    f.specialize(p == 1).vectorize(x, 8);
+    f.specialize(p == 2).vectorize(x, 4);
+    f.specialize(p == 3).parallel(x);
+
+    CountLoops *counter = new CountLoops;
+    f.add_custom_lowering_pass(counter);
+
+    Target target = get_jit_target_from_environment().with_feature(Target::LazySpecializations);
+
+    const int values[] = {2, 2, 5, 2, 1};
+    const int lowerings[] = {1, 1, 2, 2, 3};
+    for (int i = 0; i < 5; i++) {
+        p.set(values[i]);
+        Buffer<int> result = f.realize(64, target);
+        for (int x = 0; x < result.width(); x++) {
+            if (result(x) != x * values[i]) {
+                printf("result(%d) = %d instead of %d\n", x, result(x), x * values[i]);
+                return -1;
+            }
+        }
+
+        if (counter->lowerings != lowerings[i]) {
+            printf("After realizing with p = %d, the pipeline has been lowered %d times instead of %d\n",
+                   values[i], counter->lowerings, lowerings[i]);
+            return -1;
+        }
+
+        // Only the branch taken is compiled.
+        if (counter->loops != 1) {
+            printf("There are %d loops over f instead of 1\n", counter->loops);
+            return -1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
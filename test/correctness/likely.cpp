@@ -121,6 +121,24 @@ int main(int argc, char **argv) {
         count_partitions(h, 5);
     }
 
+    // This also holds for constant_exterior, which checks the bounds
+    // of each dimension separately, and for inputs with sizes that
+    // are only known at runtime.
+    {
+        Var y;
+        Func g;
+        g(x, y) = x + y;
+        g.compute_root();
+        Func h = BoundaryConditions::constant_exterior(g, 0, 0, 10, 0, 10);
+        count_partitions(h, 5);
+    }
+
+    {
+        ImageParam input(Int(32), 2);
+        Func h = BoundaryConditions::mirror_interior(input);
+        count_partitions(h, 5);
+    }
+
     // If you split and also have a boundary condition, or have
     // multiple boundary conditions at play (e.g. because you're
     // blurring an inlined Func that uses a boundary condition), then
@@ -0,0 +1,90 @@
+#include "Halide.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits>
+
+using namespace Halide;
+
+// Euclidean division and modulus, which is what Halide's division means.
+template<typename T>
+T div_ref(T a, T b) {
+    T q = a / b;
+    T r = a - q * b;
+    if (r < 0) {
+        q = (b > 0) ? q - 1 : q + 1;
+    }
+    return q;
+}
+
+template<typename T>
+T mod_ref(T a, T b) {
+    return a - div_ref(a, b) * b;
+}
+
+template<typename T>
+bool test(int vector_width) {
+    const int W = 256;
+    Buffer<T> input(W);
+    for (int i = 0; i < W; i++) {
+        input(i) = (T)rand();
+    }
+    input(0) = std::numeric_limits<T>::min();
+    input(1) = std::numeric_limits<T>::max();
+
+    Var x;
+    Param<T> divisor;
+    Func f;
+    f(x) = Tuple(input(x) / divisor, input(x) % divisor);
+    if (vector_width > 1) {
+        f.vectorize(x, vector_width);
+    }
+
+    std::vector<T> divisors;
+    for (int i = 1; i < 300; i++) {
+        divisors.push_back((T)i);
+        divisors.push_back((T)(-i));
+    }
+    for (int i = 0; i < 100; i++) {
+        divisors.push_back((T)rand());
+    }
+    divisors.push_back(std::numeric_limits<T>::min());
+    divisors.push_back(std::numeric_limits<T>::max());
+
+    for (T d : divisors) {
+        if (d == 0) continue;
+        divisor.set(d);
+        Realization r = f.realize(W);
+        Buffer<T> q = r[0], m = r[1];
+        for (int i = 0; i < W; i++) {
+            T a = input(i);
+            // Skip the one quotient that overflows
+            if (std::numeric_limits<T>::is_signed &&
+                a == std::numeric_limits<T>::min() && d == (T)(-1)) continue;
+            T correct_q = div_ref(a, d), correct_m = mod_ref(a, d);
+            if (q(i) != correct_q || m(i) != correct_m) {
+                printf("%lld / %lld with vector width %d: got %lld, %lld instead of %lld, %lld\n",
+                       (long long)a, (long long)d, vector_width,
+                       (long long)q(i), (long long)m(i),
+                       (long long)correct_q, (long long)correct_m);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    for (int w : {1, 8, 16}) {
+        if (!test<int32_t>(w) ||
+            !test<uint32_t>(w) ||
+            !test<int16_t>(w) ||
+            !test<uint16_t>(w) ||
+            !test<int8_t>(w) ||
+            !test<uint8_t>(w)) {
+            return -1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
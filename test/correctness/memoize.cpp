@@ -455,6 +455,41 @@ int main(int argc, char **argv) {
         Internal::JITSharedRuntime::memoization_cache_set_size(0);
     }
 
+    {
+        // Test a large number of distinct keys, enough to spread over
+        // every shard of the cache and make the hash tables grow.
+        Param<int32_t> key;
+
+        call_count_with_arg = 0;
+        Func count_calls;
+        count_calls.define_extern("count_calls_with_arg", {cast<uint8_t>(key)}, UInt(8), 2);
+
+        Func f;
+        Var x, y;
+        f(x, y) = count_calls(x, y) + cast<uint8_t>(key >> 8);
+        count_calls.compute_root().memoize();
+
+        // Each entry is 16 bytes, so this is plenty of room for all of them.
+        Internal::JITSharedRuntime::memoization_cache_set_size(1000000);
+
+        const int num_keys = 2000;
+        for (int pass = 0; pass < 2; pass++) {
+            for (int k = 0; k < num_keys; k++) {
+                key.set(k);
+                Buffer<uint8_t> out = f.realize(4, 4);
+                for (int y = 0; y < 4; y++) {
+                    for (int x = 0; x < 4; x++) {
+                        assert(out(x, y) == (uint8_t)(k + (k >> 8)));
+                    }
+                }
+            }
+        }
+        assert(call_count_with_arg == num_keys);
+
+        // Return cache size to default.
+        Internal::JITSharedRuntime::memoization_cache_set_size(0);
+    }
+
     {
         // Test parallel cache access
         Param<float> val;
@@ -0,0 +1,124 @@
+#include <stdio.h>
+#include "Halide.h"
+
+using namespace Halide;
+
+#ifdef _WIN32
+#define DLLEXPORT __declspec(dllexport)
+#else
+#define DLLEXPORT
+#endif
+
+int call_count = 0;
+
+// out(x, y) = in(x, y) + 1
+extern "C" DLLEXPORT int add_one_and_count(halide_buffer_t *in, halide_buffer_t *out) {
+    if (in->is_bounds_query()) {
+        for (int i = 0; i < out->dimensions; i++) {
+            in->dim[i] = out->dim[i];
+        }
+    } else if (!out->is_bounds_query()) {
+        call_count++;
+        Halide::Runtime::Buffer<uint8_t> out_buf(*out), in_buf(*in);
+        out_buf.for_each_value([&](uint8_t &o, uint8_t &i) {o = i + 1;}, in_buf);
+    }
+    return 0;
+}
+
+bool check(const Buffer<uint8_t> &result, const Buffer<uint8_t> &input, const char *msg) {
+    for (int y = 0; y < result.height(); y++) {
+        for (int x = 0; x < result.width(); x++) {
+            uint8_t correct = (uint8_t)((input(x, y) + 1) * 2);
+            if (result(x, y) != correct) {
+                printf("%s: result(%d, %d) = %d instead of %d\n",
+                       msg, x, y, result(x, y), correct);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    const int W = 100, H = 100;
+
+    ImageParam in(UInt(8), 2);
+    Func f, g, h;
+    Var x, y;
+    f.define_extern("add_one_and_count", {in}, UInt(8), 2);
+    f.compute_root().memoize_buffer_contents();
+    g(x, y) = f(x, y) * 2;
+
+    Buffer<uint8_t> a(W, H);
+    for (int yy = 0; yy < H; yy++) {
+        for (int xx = 0; xx < W; xx++) {
+            a(xx, yy) = (uint8_t)(xx * 3 + yy * 7);
+        }
+    }
+
+    in.set(a);
+    Buffer<uint8_t> result = g.realize(W, H);
+    if (!check(result, a, "First call") || call_count != 1) {
+        printf("Expected one call, got %d\n", call_count);
+        return -1;
+    }
+
+    // The same contents at a different address should hit in the cache.
+    Buffer<uint8_t> b(W, H);
+    for (int yy = 0; yy < H; yy++) {
+        for (int xx = 0; xx < W; xx++) {
+            b(xx, yy) = a(xx, yy);
+        }
+    }
+    in.set(b);
+    result = g.realize(W, H);
+    if (!check(result, b, "Copy of input") || call_count != 1) {
+        printf("Expected a hit for a copy of the input, got %d calls\n", call_count);
+        return -1;
+    }
+
+    // As should the same contents with a different row stride.
+    Buffer<uint8_t> c(W + 20, H);
+    for (int yy = 0; yy < H; yy++) {
+        for (int xx = 0; xx < W + 20; xx++) {
+            c(xx, yy) = (xx >= 10 && xx < W + 10) ? a(xx - 10, yy) : 0;
+        }
+    }
+    c.crop(0, 10, W);
+    c.translate(0, -10);
+    in.set(c);
+    result = g.realize(W, H);
+    if (!check(result, a, "Strided input") || call_count != 1) {
+        printf("Expected a hit for a strided copy of the input, got %d calls\n", call_count);
+        return -1;
+    }
+
+    // Changing a single value should miss.
+    b(W / 2, H / 2)++;
+    in.set(b);
+    result = g.realize(W, H);
+    if (!check(result, b, "Modified input") || call_count != 2) {
+        printf("Expected a miss for a modified input, got %d calls\n", call_count);
+        return -1;
+    }
+
+    // Buffers larger than the limit are never hashed, so always miss.
+    call_count = 0;
+    f.memoize_buffer_contents(W * H / 2);
+    in.set(a);
+    for (int i = 0; i < 3; i++) {
+        result = g.realize(W, H);
+        if (!check(result, a, "Input too large to hash")) {
+            return -1;
+        }
+    }
+    if (call_count != 3) {
+        printf("Expected every call to miss for a large input, got %d calls\n", call_count);
+        return -1;
+    }
+
+    Internal::JITSharedRuntime::memoization_cache_set_size(0);
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,96 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "Halide.h"
+
+#ifndef _WIN32
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+using namespace Halide;
+
+#ifdef _WIN32
+#define DLLEXPORT __declspec(dllexport)
+#else
+#define DLLEXPORT
+#endif
+
+int call_count = 0;
+
+extern "C" DLLEXPORT int count_calls(halide_buffer_t *out) {
+    if (!out->is_bounds_query()) {
+        call_count++;
+        Halide::Runtime::Buffer<int32_t> buf(*out);
+        buf.for_each_element([&](int x, int y) {buf(x, y) = x * 100 + y;});
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+#ifdef _WIN32
+    printf("Skipping test because the shared memoization cache requires a posix OS\n");
+    return 0;
+#else
+    Target t = get_jit_target_from_environment();
+    if (t.os != Target::Linux && t.os != Target::OSX) {
+        printf("Skipping test because the shared memoization cache requires a posix OS\n");
+        return 0;
+    }
+
+    char path[] = "/tmp/halide_memoize_shared_cacheXXXXXX";
+    int fd = mkstemp(path);
+    if (fd == -1) {
+        printf("Could not make a temporary file\n");
+        return -1;
+    }
+    close(fd);
+    // Start from an empty file, so that the cache is created.
+    unlink(path);
+    setenv("HL_MEMOIZATION_CACHE_FILE", path, 1);
+
+    Func f, g;
+    Var x, y;
+    f.define_extern("count_calls", {}, Int(32), 2);
+    f.compute_root().memoize();
+    g(x, y) = f(x, y) * 2;
+    g.compile_jit(t.with_feature(Target::SharedMemoizationCache));
+
+    // Compute the result in another process, which stores it in the
+    // cache file when it exits.
+    pid_t pid = fork();
+    if (pid == 0) {
+        Buffer<int32_t> result = g.realize(64, 32);
+        _exit(call_count == 1 ? 0 : 1);
+    }
+    int status = 0;
+    if (pid == -1 || waitpid(pid, &status, 0) != pid ||
+        !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        printf("Child process failed\n");
+        unlink(path);
+        return -1;
+    }
+
+    // This process should find the result in the cache.
+    Buffer<int32_t> result = g.realize(64, 32);
+    unlink(path);
+
+    for (int yy = 0; yy < 32; yy++) {
+        for (int xx = 0; xx < 64; xx++) {
+            int correct = (xx * 100 + yy) * 2;
+            if (result(xx, yy) != correct) {
+                printf("result(%d, %d) = %d instead of %d\n", xx, yy, result(xx, yy), correct);
+                return -1;
+            }
+        }
+    }
+
+    if (call_count != 0) {
+        printf("Expected the result computed by the other process to be cached, "
+               "but the extern stage was called %d times\n", call_count);
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+#endif
+}
@@ -0,0 +1,57 @@
+#include "Halide.h"
+#include <fstream>
+#include <sstream>
+#include <stdio.h>
+
+#include "test/common/halide_test_dirs.h"
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    ImageParam input(Float(32), 2, "input");
+    Func small("small"), big("big"), scratch("scratch"), out("out");
+    Var x, y, xi;
+
+    // Constant-sized allocations small enough for the stack inside a
+    // parallel loop, and one that depends on the output size.
+    small(x, y) = input(x, y) * 2;
+    big(x, y) = input(x, y) + 1;
+    scratch(x, y) = small(x, y) + big(x, y);
+    out(x, y) = scratch(x, y) + scratch(x + 1, y);
+
+    out.split(x, x, xi, 64, TailStrategy::RoundUp).parallel(y);
+    scratch.compute_at(out, x);
+    small.compute_at(scratch, y);
+    big.compute_root();
+
+    std::string result_file = Internal::get_test_tmp_dir() + "memory_report.memory.json";
+    Internal::ensure_no_file_exists(result_file);
+
+    out.compile_to(Outputs().memory_report(result_file), {input}, "memory_report");
+
+    Internal::assert_file_exists(result_file);
+
+    std::ifstream f(result_file);
+    std::stringstream ss;
+    ss << f.rdbuf();
+    std::string report = ss.str();
+
+    const char *expected[] = {
+        "\"name\": \"memory_report\"",
+        "\"name\": \"big\"",
+        "\"storage\": \"heap\"",
+        "\"name\": \"scratch\"",
+        "\"storage\": \"stack\"",
+        "\"per_thread\": true",
+        "\"constant_bytes\": null",
+    };
+    for (const char *e : expected) {
+        if (report.find(e) == std::string::npos) {
+            printf("Memory report does not contain %s:\n%s\n", e, report.c_str());
+            return -1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,68 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+// Check that the stores to a Func carry the non-temporal hint.
+class CheckNontemporal : public IRMutator {
+    class FindHint : public IRVisitor {
+        using IRVisitor::visit;
+
+        void visit(const Store *op) {
+            const Call *call = op->value.as<Call>();
+            if (op->name == func && call && call->is_intrinsic(Call::nontemporal_store)) {
+                found = true;
+            }
+            IRVisitor::visit(op);
+        }
+
+    public:
+        const std::string &func;
+        bool found = false;
+        FindHint(const std::string &func) : func(func) {}
+    };
+
+    std::string func;
+
+public:
+    CheckNontemporal(const std::string &func) : func(func) {}
+    using IRMutator::mutate;
+
+    Stmt mutate(Stmt s) {
+        FindHint f(func);
+        s.accept(&f);
+        if (!f.found) {
+            printf("The stores to %s are not marked non-temporal\n", func.c_str());
+            exit(-1);
+        }
+        return s;
+    }
+};
+
+int main(int argc, char **argv) {
+    Var x("x"), y("y");
+
+    Func f("f"), g("g");
+    f(x, y) = x * 2.0f + y;
+    g(x, y) = f(x, y) + f(x + 1, y);
+
+    // f is written once and read by a separate loop nest.
+    f.compute_root().vectorize(x, 8).store_nontemporal();
+    g.vectorize(x, 8).store_nontemporal();
+
+    g.add_custom_lowering_pass(new CheckNontemporal("f"));
+    Buffer<float> result = g.realize(256, 64);
+    for (int y = 0; y < result.height(); y++) {
+        for (int x = 0; x < result.width(); x++) {
+            float correct = (x * 2.0f + y) + ((x + 1) * 2.0f + y);
+            if (result(x, y) != correct) {
+                printf("result(%d, %d) = %f instead of %f\n", x, y, result(x, y), correct);
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
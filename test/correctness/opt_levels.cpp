@@ -0,0 +1,45 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    const int W = 67, H = 33;
+    Buffer<int> in(W, H);
+    in.for_each_element([&](int x, int y) { in(x, y) = x * 5 + y * 11; });
+
+    // Boundary conditions, vectorization and interleaving exercise
+    // the passes that are skipped at the lower levels.
+    Var x("x"), y("y"), c("c");
+    Func clamped = BoundaryConditions::repeat_edge(in);
+    Func blur("blur"), out("out");
+    blur(x, y) = clamped(x - 1, y) + clamped(x, y) + clamped(x + 1, y);
+    out(x, y, c) = select(c == 0, blur(x, y), blur(x, y) * 2);
+    out.bound(c, 0, 2).reorder(c, x, y).unroll(c).vectorize(x, 8);
+    blur.compute_at(out, y).vectorize(x, 8);
+
+    const Target::Feature levels[] = {Target::OptLevel0, Target::OptLevel1, Target::FeatureEnd};
+    for (Target::Feature level : levels) {
+        Target target = get_jit_target_from_environment().with_feature(level);
+        Buffer<int> result = out.realize(W, H, 2, target);
+        for (int y = 0; y < H; y++) {
+            for (int x = 0; x < W; x++) {
+                int correct = 0;
+                for (int dx = -1; dx <= 1; dx++) {
+                    correct += in(std::min(std::max(x + dx, 0), W - 1), y);
+                }
+                for (int c = 0; c < 2; c++) {
+                    int expected = correct * (c + 1);
+                    if (result(x, y, c) != expected) {
+                        printf("At opt level %d, result(%d, %d, %d) = %d instead of %d\n",
+                               target.opt_level(), x, y, c, result(x, y, c), expected);
+                        return -1;
+                    }
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,60 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+bool error_occurred = false;
+void my_error_handler(void *user_context, const char *msg) {
+    error_occurred = true;
+}
+
+int main(int argc, char **argv) {
+    const int W = 123, H = 45;
+
+    ImageParam input(Float(32), 2, "input");
+    Func f("f");
+    Var x("x"), y("y");
+
+    f(x, y) = input(x, y) * 2.0f + 1.0f;
+    f.output_buffer().may_alias(input);
+    f.vectorize(x, 8, TailStrategy::GuardWithIf).parallel(y);
+    f.set_error_handler(my_error_handler);
+
+    Buffer<float> buf(W, H);
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            buf(x, y) = (float)(x + y);
+        }
+    }
+
+    // Run the pipeline with the same buffer as input and output.
+    input.set(buf);
+    f.realize(buf);
+    if (error_occurred) {
+        printf("Unexpected error computing f in place\n");
+        return -1;
+    }
+
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            float correct = (x + y) * 2.0f + 1.0f;
+            if (buf(x, y) != correct) {
+                printf("buf(%d, %d) = %f instead of %f\n", x, y, buf(x, y), correct);
+                return -1;
+            }
+        }
+    }
+
+    // A view of the same memory with a different min is not the same
+    // buffer, and should be rejected.
+    Buffer<float> shifted(Runtime::Buffer<float>(*buf.get()));
+    shifted.set_min(1, 0);
+    f.realize(shifted);
+    if (!error_occurred) {
+        printf("There should have been an error for a shifted alias\n");
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
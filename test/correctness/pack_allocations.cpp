@@ -0,0 +1,82 @@
+#include <stdio.h>
+#include "Halide.h"
+
+using namespace Halide;
+
+int mallocs = 0;
+size_t bytes_allocated = 0, peak_bytes = 0;
+
+void *my_malloc(void *user_context, size_t x) {
+    mallocs++;
+    bytes_allocated += x;
+    if (bytes_allocated > peak_bytes) peak_bytes = bytes_allocated;
+    void *orig = malloc(x + 128 + sizeof(size_t) * 2);
+    void *ptr = (void *)((((size_t)orig + 128 + sizeof(size_t) * 2) >> 7) << 7);
+    ((void **)ptr)[-1] = orig;
+    ((size_t *)ptr)[-2] = x;
+    return ptr;
+}
+
+void my_free(void *user_context, void *ptr) {
+    bytes_allocated -= ((size_t *)ptr)[-2];
+    free(((void**)ptr)[-1]);
+}
+
+int run(bool pack, int size, Buffer<int> &out) {
+    // A long linear chain of compute_root stages. Only two
+    // consecutive ones are ever live at once.
+    const int stages = 8;
+    Func f[stages];
+    Var x, y;
+    f[0](x, y) = x + y;
+    for (int i = 1; i < stages; i++) {
+        f[i](x, y) = f[i-1](x, y) + f[i-1](x + 1, y) + i;
+        f[i-1].compute_root();
+    }
+    f[stages-1].set_custom_allocator(my_malloc, my_free);
+
+    Target t = get_jit_target_from_environment();
+    if (pack) {
+        t.set_feature(Target::PackAllocations);
+    }
+    mallocs = 0;
+    bytes_allocated = peak_bytes = 0;
+    out = f[stages-1].realize(size, size, t);
+    return mallocs;
+}
+
+int main(int argc, char **argv) {
+    Buffer<int> unpacked, packed;
+    int unpacked_mallocs = run(false, 300, unpacked);
+    size_t unpacked_peak = peak_bytes;
+    int packed_mallocs = run(true, 300, packed);
+    size_t packed_peak = peak_bytes;
+
+    for (int y = 0; y < packed.height(); y++) {
+        for (int x = 0; x < packed.width(); x++) {
+            if (packed(x, y) != unpacked(x, y)) {
+                printf("packed(%d, %d) = %d instead of %d\n",
+                       x, y, packed(x, y), unpacked(x, y));
+                return -1;
+            }
+        }
+    }
+
+    printf("mallocs: %d -> %d, peak bytes: %d -> %d\n",
+           unpacked_mallocs, packed_mallocs, (int)unpacked_peak, (int)packed_peak);
+
+    if (packed_mallocs != 1) {
+        printf("Expected a single allocation for the packed pipeline\n");
+        return -1;
+    }
+
+    // Only two stages are live at once either way, but the slab
+    // rounds things up a little.
+    if (packed_peak > unpacked_peak + unpacked_peak / 10) {
+        printf("Packing allocations increased the peak memory use\n");
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
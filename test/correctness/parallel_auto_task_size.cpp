@@ -0,0 +1,96 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+// The number of tasks of the last parallel loop run.
+int num_tasks = 0;
+
+int count_tasks(void *ctx, int (*f)(void *, int, uint8_t *), int min, int extent, uint8_t *closure) {
+    num_tasks = extent;
+    for (int i = min; i < min + extent; i++) {
+        int result = f(ctx, i, closure);
+        if (result) return result;
+    }
+    return 0;
+}
+
+int check(Func f, int W, int H) {
+    Buffer<int> out = f.realize(W, H);
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            int correct = x * y + 3;
+            if (out(x, y) != correct) {
+                printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), correct);
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    Var x("x"), y("y");
+    const int W = 64, H = 1000;
+
+    {
+        Func f("f");
+        f(x, y) = x * y + 3;
+        f.parallel(y, TaskSize::Auto).vectorize(x, 8);
+
+        // Run it a few times, so that later runs are sized by the
+        // time measured for the earlier ones.
+        for (int i = 0; i < 4; i++) {
+            if (check(f, W, H) != 0) return -1;
+        }
+    }
+
+    {
+        // A task size of at most one makes a task per iteration.
+        Func f("f_max");
+        f(x, y) = x * y + 3;
+        f.parallel(y, TaskSize::Auto, 1, 1);
+        f.set_custom_do_par_for(count_tasks);
+        for (int i = 0; i < 2; i++) {
+            if (check(f, W, H) != 0) return -1;
+            if (num_tasks != H) {
+                printf("Expected %d tasks instead of %d\n", H, num_tasks);
+                return -1;
+            }
+        }
+    }
+
+    {
+        // A task size of at least the extent makes a single task.
+        Func f("f_min");
+        f(x, y) = x * y + 3;
+        f.parallel(y, TaskSize::Auto, H);
+        f.set_custom_do_par_for(count_tasks);
+        for (int i = 0; i < 2; i++) {
+            if (check(f, W, H) != 0) return -1;
+            if (num_tasks != 1) {
+                printf("Expected a single task instead of %d\n", num_tasks);
+                return -1;
+            }
+        }
+    }
+
+    {
+        // The tasks of an update stage, and a loop whose extent isn't
+        // a multiple of the task size.
+        Func f("f_update");
+        RDom r(0, 8);
+        f(x, y) = 3;
+        f(x, y) += select(r == 0, x * y, 0);
+        f.update().parallel(y, TaskSize::Auto, 7, 7);
+        f.set_custom_do_par_for(count_tasks);
+        if (check(f, W, H) != 0) return -1;
+        if (num_tasks != (H + 6) / 7) {
+            printf("Expected %d tasks instead of %d\n", (H + 6) / 7, num_tasks);
+            return -1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
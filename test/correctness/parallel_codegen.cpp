@@ -0,0 +1,44 @@
+#include "Halide.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "test/common/halide_test_dirs.h"
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    // Split code generation of the library (including the runtime)
+    // into several objects compiled in parallel.
+    char env[] = "HL_CODEGEN_THREADS=4";
+    putenv(env);
+
+    Param<float> factor("factor");
+    Func f, g, h;
+    Var x, y;
+    f(x, y) = x + y;
+    g(x, y) = cast<float>(f(x, y) + f(x+1, y));
+    h(x, y) = g(x, y) * factor;
+    f.compute_root().parallel(y);
+    g.compute_root().vectorize(x, 8);
+    h.parallel(y);
+
+    std::string fn_object = Internal::get_test_tmp_dir() + "parallel_codegen";
+    Target t = get_host_target();
+#ifdef _MSC_VER
+    std::string expected_lib = fn_object + ".lib";
+#else
+    std::string expected_lib = fn_object + ".a";
+#endif
+    std::string expected_h = fn_object + ".h";
+
+    Internal::ensure_no_file_exists(expected_lib);
+    Internal::ensure_no_file_exists(expected_h);
+
+    h.compile_to_static_library(fn_object, {factor}, "parallel_codegen", t);
+
+    Internal::assert_file_exists(expected_lib);
+    Internal::assert_file_exists(expected_h);
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,36 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "Halide.h"
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    // Use more threads than the thread pool used to support, and pin
+    // them to cores. These must be set before the thread pool is
+    // initialized, so drop any existing JIT runtime first.
+    char num_threads[] = "HL_NUM_THREADS=96";
+    char affinity[] = "HL_THREAD_AFFINITY=1";
+    char work_stealing[] = "HL_WORK_STEALING=1";
+    putenv(num_threads);
+    putenv(affinity);
+    putenv(work_stealing);
+    Internal::JITSharedRuntime::release_all();
+
+    Var x, y;
+    Func f;
+    f(x, y) = x * 3 + y;
+    f.parallel(y);
+
+    Buffer<int> im = f.realize(100, 1000);
+    for (int y = 0; y < im.height(); y++) {
+        for (int x = 0; x < im.width(); x++) {
+            if (im(x, y) != x * 3 + y) {
+                printf("im(%d, %d) = %d\n", x, y, im(x, y));
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
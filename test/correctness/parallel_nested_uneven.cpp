@@ -0,0 +1,43 @@
+#include <stdio.h>
+#include "Halide.h"
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    Var x, y, xo, xi, yo, yi;
+
+    // An outer parallel loop with fewer tasks than threads, each of
+    // which runs inner parallel loops with uneven amounts of work per
+    // task. Threads waiting for their own loops to finish should
+    // help with the inner loops of other tasks.
+    Func f, g;
+    RDom r(0, 100);
+    f(x, y) = sum(select(r < (x * 7 + y * 3) % 100, r + x, 0));
+    g(x, y) = f(x, y) + f(x + 1, y);
+
+    g.split(y, yo, yi, 2).parallel(yo);
+    f.compute_at(g, yi).split(x, xo, xi, 4).parallel(xo);
+
+    for (int i = 0; i < 10; i++) {
+        Buffer<int> im = g.realize(97, 6);
+        for (int yy = 0; yy < 6; yy++) {
+            for (int xx = 0; xx < 97; xx++) {
+                int correct = 0;
+                for (int dx = 0; dx < 2; dx++) {
+                    int fx = xx + dx;
+                    int extent = (fx * 7 + yy * 3) % 100;
+                    for (int rr = 0; rr < extent; rr++) {
+                        correct += rr + fx;
+                    }
+                }
+                if (im(xx, yy) != correct) {
+                    printf("im(%d, %d) = %d instead of %d\n", xx, yy, im(xx, yy), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
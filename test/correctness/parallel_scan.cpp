@@ -0,0 +1,70 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    const int W = 1000, H = 20;
+
+    Func g;
+    Var x, y, b;
+    g(x, y) = (x * 17 + y * 31) % 23 - 11;
+
+    {
+        // A cumulative sum along x, which isn't a multiple of the
+        // block size.
+        Func f;
+        f(x, y) = 7;
+        RDom r(0, W);
+        f(r, y) = f(r - 1, y) + g(r, y);
+
+        f.update(0).parallel_scan(r, b, 64);
+        f.update(0).parallel(y).vectorize(r, 8);
+
+        Buffer<int> result = f.realize(W, H);
+        for (int yy = 0; yy < H; yy++) {
+            int correct = 7;
+            for (int xx = 0; xx < W; xx++) {
+                correct += (xx * 17 + yy * 31) % 23 - 11;
+                if (result(xx, yy) != correct) {
+                    printf("sum: result(%d, %d) = %d instead of %d\n", xx, yy, result(xx, yy), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    {
+        // A running maximum along y, with the scan domain not
+        // starting at zero.
+        Func f;
+        f(x, y) = -100;
+        RDom r(3, H - 3);
+        f(x, r) = max(f(x, r - 1), g(x, r));
+
+        std::vector<Func> scans = f.update(0).parallel_scan(r, b, 4);
+        if (scans.size() != 2) {
+            printf("parallel_scan should return two Funcs\n");
+            return -1;
+        }
+        f.update(0).parallel(r);
+
+        Buffer<int> result = f.realize(W, H);
+        for (int xx = 0; xx < W; xx++) {
+            int correct = -100;
+            for (int yy = 0; yy < H; yy++) {
+                if (yy >= 3) {
+                    correct = std::max(correct, (xx * 17 + yy * 31) % 23 - 11);
+                }
+                int expected = yy >= 3 ? correct : -100;
+                if (result(xx, yy) != expected) {
+                    printf("max: result(%d, %d) = %d instead of %d\n", xx, yy, result(xx, yy), expected);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,59 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "Halide.h"
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    // Switch the thread pool into work-stealing mode. This must
+    // happen before the thread pool is initialized, so drop any
+    // existing JIT runtime first.
+    char env[] = "HL_WORK_STEALING=1";
+    putenv(env);
+    Internal::JITSharedRuntime::release_all();
+
+    Var x, y, z;
+
+    // Uneven amounts of work per task, so that threads run out of
+    // their initial share at different times and have to steal.
+    Func f;
+    RDom r(0, 64);
+    f(x, y) = sum(select(r < x % 64, r * y, 0));
+    f.parallel(y);
+
+    // Nested parallelism, with varying numbers of tasks per level.
+    Func g;
+    g(x, y, z) = x*y+z+1;
+    g.parallel(x).parallel(y).parallel(z);
+
+    for (int size = 1; size < 100; size += 7) {
+        Buffer<int> im_f = f.realize(64, size);
+        for (int y = 0; y < size; y++) {
+            for (int x = 0; x < 64; x++) {
+                int correct = 0;
+                for (int r = 0; r < x % 64; r++) {
+                    correct += r * y;
+                }
+                if (im_f(x, y) != correct) {
+                    printf("im_f(%d, %d) = %d instead of %d\n", x, y, im_f(x, y), correct);
+                    return -1;
+                }
+            }
+        }
+
+        Buffer<int> im_g = g.realize(size, 13, 5);
+        for (int z = 0; z < 5; z++) {
+            for (int y = 0; y < 13; y++) {
+                for (int x = 0; x < size; x++) {
+                    if (im_g(x, y, z) != x*y+z+1) {
+                        printf("im_g(%d, %d, %d) = %d\n", x, y, z, im_g(x, y, z));
+                        return -1;
+                    }
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,80 @@
+#include "Halide.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <fstream>
+#include <sstream>
+
+#include "test/common/halide_test_dirs.h"
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    // Only small loop bodies get partitioned, and their prologues and
+    // epilogues share code when they're the same.
+#ifdef _WIN32
+    _putenv_s("HL_PARTITION_BUDGET", "500");
+#else
+    setenv("HL_PARTITION_BUDGET", "500", 1);
+#endif
+
+    const int W = 100, H = 40;
+    Buffer<int> in(W, H);
+    in.for_each_element([&](int x, int y) { in(x, y) = x * 3 + y * 7; });
+
+    Var x("x"), y("y");
+
+    {
+        // Outside the image, the input is zero on both sides, so the
+        // prologue and epilogue of the loop over x are the same.
+        Func padded = BoundaryConditions::constant_exterior(in, 0);
+        Func blur("blur");
+        blur(x, y) = padded(x - 1, y) + padded(x, y) + padded(x + 1, y);
+
+        Buffer<int> out = blur.realize(W, H);
+        for (int j = 0; j < H; j++) {
+            for (int i = 0; i < W; i++) {
+                int correct = in(i, j);
+                if (i > 0) correct += in(i - 1, j);
+                if (i < W - 1) correct += in(i + 1, j);
+                if (out(i, j) != correct) {
+                    printf("blur(%d, %d) = %d instead of %d\n", i, j, out(i, j), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    {
+        // A scan depends on the order of its iterations, so the
+        // shared prologue and epilogue must still run before and
+        // after the steady state.
+        Func scan("scan");
+        RDom r(1, W - 1);
+        scan(x) = in(0, 0);
+        scan(r) = (scan(r - 1) * 3 + select(likely(r > 10 && r < 90), in(r, 0), 1)) % 1000;
+
+        std::string stmt_file = Internal::get_test_tmp_dir() + "partition_budget.stmt";
+        Internal::ensure_no_file_exists(stmt_file);
+        scan.compile_to_lowered_stmt(stmt_file, {});
+        std::ifstream file(stmt_file);
+        std::stringstream contents;
+        contents << file.rdbuf();
+        if (contents.str().find(".tail") == std::string::npos) {
+            printf("Expected the prologue and epilogue to share a loop\n");
+            return -1;
+        }
+
+        Buffer<int> out = scan.realize(W);
+        int correct = in(0, 0);
+        for (int i = 1; i < W; i++) {
+            correct = (correct * 3 + ((i > 10 && i < 90) ? in(i, 0) : 1)) % 1000;
+            if (out(i) != correct) {
+                printf("scan(%d) = %d instead of %d\n", i, out(i), correct);
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -113,6 +113,42 @@ int vectorized_predicated_store_scalarized_predicated_load_test() {
     return 0;
 }
 
+int vectorized_predicated_strided_store_test() {
+    // On AVX-512 the strided predicated loads and stores here are
+    // masked gathers and scatters.
+    Var x("x"), y("y");
+    Func f ("f"), g("g"), ref("ref");
+
+    g(x, y) = cast<float>(x * y + 3);
+    g.compute_root();
+
+    RDom r(0, 50, 0, 50);
+    r.where(r.x * 3 > r.y * 2 + 7);
+
+    ref(x, y) = cast<float>(x - y);
+    ref(2*r.x, r.y) += g(3*r.x, r.y);
+    ref(2*r.x + 1, r.y) = g(r.x, r.y) * 2.0f;
+    Buffer<float> im_ref = ref.realize(120, 60);
+
+    f(x, y) = cast<float>(x - y);
+    f(2*r.x, r.y) += g(3*r.x, r.y);
+    f(2*r.x + 1, r.y) = g(r.x, r.y) * 2.0f;
+
+    Target target = get_jit_target_from_environment();
+    if (target.arch == Target::X86) {
+        f.update(0).vectorize(r.x, 16);
+        f.update(1).vectorize(r.x, 16);
+        f.add_custom_lowering_pass(new CheckPredicatedStoreLoad(true, true));
+    }
+
+    Buffer<float> im = f.realize(120, 60);
+    auto func = [im_ref](int x, int y, int z) { return im_ref(x, y, z); };
+    if (check_image(im, func)) {
+        return -1;
+    }
+    return 0;
+}
+
 int vectorized_dense_load_with_stride_minus_one_test() {
     int size = 73;
     Var x("x"), y("y");
@@ -405,6 +441,11 @@ int main(int argc, char **argv) {
         return -1;
     }
 
+    printf("Running vectorized predicated strided store test\n");
+    if (vectorized_predicated_strided_store_test() != 0) {
+        return -1;
+    }
+
     printf("Running scalar load test\n");
     if (scalar_load_test() != 0) {
         return -1;
@@ -0,0 +1,96 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+// Count the prefetches, and how many of them are only made at some
+// iterations.
+class CountPrefetches : public IRMutator {
+    class Counter : public IRVisitor {
+        using IRVisitor::visit;
+
+        int if_depth = 0;
+
+        void visit(const IfThenElse *op) {
+            op->condition.accept(this);
+            if_depth++;
+            op->then_case.accept(this);
+            if_depth--;
+            if (op->else_case.defined()) {
+                op->else_case.accept(this);
+            }
+        }
+
+        void visit(const Call *op) {
+            if (op->is_intrinsic(Call::prefetch)) {
+                prefetches++;
+                if (if_depth > 0) {
+                    guarded++;
+                }
+            }
+            IRVisitor::visit(op);
+        }
+
+    public:
+        int prefetches = 0, guarded = 0;
+    };
+
+public:
+    int prefetches = 0, guarded = 0;
+
+    using IRMutator::mutate;
+
+    Stmt mutate(Stmt s) {
+        Counter c;
+        s.accept(&c);
+        prefetches = c.prefetches;
+        guarded = c.guarded;
+        return s;
+    }
+};
+
+int main(int argc, char **argv) {
+    Target target = get_jit_target_from_environment();
+    if (target.features_any_of({Target::HVX_64, Target::HVX_128})) {
+        printf("Skipping test, Hexagon prefetches whole boxes\n");
+        return 0;
+    }
+
+    Var x("x"), y("y");
+    Func f("f"), g("g");
+    f(x, y) = cast<uint8_t>(x + y);
+    g(x, y) = f(x, y) * 2;
+
+    f.compute_root();
+    // Each iteration of x reads a single byte of f, so the prefetch
+    // should only be made once per cache line.
+    g.prefetch(f, x, PrefetchBoundStrategy::NonFaulting);
+
+    CountPrefetches *counter = new CountPrefetches;
+    g.add_custom_lowering_pass(counter);
+
+    Buffer<uint8_t> result = g.realize(256, 16);
+    for (int y = 0; y < result.height(); y++) {
+        for (int x = 0; x < result.width(); x++) {
+            uint8_t correct = (uint8_t)(x + y) * 2;
+            if (result(x, y) != correct) {
+                printf("result(%d, %d) = %d instead of %d\n", x, y, result(x, y), correct);
+                return -1;
+            }
+        }
+    }
+
+    if (counter->prefetches == 0) {
+        printf("No prefetches were injected\n");
+        return -1;
+    }
+    if (counter->guarded != counter->prefetches) {
+        printf("%d of %d prefetches are made at every iteration\n",
+               counter->prefetches - counter->guarded, counter->prefetches);
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,56 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    Param<int> offset;
+    Var x, y;
+
+    // Make a pipeline with an intermediate on the heap.
+    Func f, g;
+    f(x, y) = x + y + offset;
+    g(x, y) = f(x, y) * 2 + f(x + 1, y);
+    f.compute_root();
+
+    Pipeline p(g);
+    RealizationContext ctx;
+
+    int32_t *data = nullptr;
+    for (int i = 0; i < 5; i++) {
+        offset.set(i);
+        Buffer<int> out = p.realize(ctx, {64, 32});
+        if (i == 0) {
+            data = out.data();
+        } else if (out.data() != data) {
+            printf("Output buffer was not reused\n");
+            return -1;
+        }
+        for (int y = 0; y < out.height(); y++) {
+            for (int x = 0; x < out.width(); x++) {
+                int correct = (x + y + i) * 2 + (x + 1 + y + i);
+                if (out(x, y) != correct) {
+                    printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    // A different size starts afresh.
+    Buffer<int> out = p.realize(ctx, {16, 16});
+    if (out.width() != 16 || out.height() != 16) {
+        printf("Output has the wrong size\n");
+        return -1;
+    }
+    int correct = (3 + 4 + 4) * 2 + (3 + 1 + 4 + 4);
+    if (out(3, 4) != correct) {
+        printf("out(3, 4) = %d instead of %d\n", out(3, 4), correct);
+        return -1;
+    }
+
+    ctx.release();
+
+    printf("Success!\n");
+    return 0;
+}
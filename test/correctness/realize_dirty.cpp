@@ -0,0 +1,115 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    Var x("x"), y("y");
+
+    ImageParam input(Int(32), 2, "input");
+    Func clamped("clamped"), blur_x("blur_x"), blur_y("blur_y");
+    clamped(x, y) = input(clamp(x, 0, input.width() - 1), clamp(y, 0, input.height() - 1));
+    blur_x(x, y) = clamped(x - 1, y) + clamped(x, y) + clamped(x + 1, y);
+    blur_y(x, y) = blur_x(x, y - 2) + blur_x(x, y) + blur_x(x, y + 2);
+    blur_x.compute_root();
+
+    const int W = 64, H = 48;
+    Buffer<int> in(W, H);
+    for (int j = 0; j < H; j++) {
+        for (int i = 0; i < W; i++) {
+            in(i, j) = i * 3 + j * 5;
+        }
+    }
+    input.set(in);
+
+    Buffer<int> out(W, H);
+    blur_y.realize(out);
+
+    // Change a rectangle of the input.
+    const int x0 = 10, y0 = 20, w = 5, h = 3;
+    for (int j = y0; j < y0 + h; j++) {
+        for (int i = x0; i < x0 + w; i++) {
+            in(i, j) = 1000 + i * j;
+        }
+    }
+
+    // Each output reads one column either side and two rows either
+    // side of the input. The coordinates are clamped, so this needs
+    // the bounds of the output.
+    std::vector<std::pair<Expr, Expr>> dirty = {{x0, w}, {y0, h}};
+    std::vector<std::pair<Expr, Expr>> bounds = {{0, W}, {0, H}};
+    std::vector<std::pair<Expr, Expr>> affected = blur_y.affected_region(input.name(), dirty, bounds);
+    if (affected.size() != 2 ||
+        !affected[0].first.defined() || !affected[1].first.defined() ||
+        !Internal::is_const(affected[0].first, x0 - 1) || !Internal::is_const(affected[0].second, w + 2) ||
+        !Internal::is_const(affected[1].first, y0 - 2) || !Internal::is_const(affected[1].second, h + 4)) {
+        printf("Unexpected affected region\n");
+        return -1;
+    }
+
+    // At the edge, the clamp makes the first column of the input
+    // affect the first two columns of the output.
+    {
+        std::vector<std::pair<Expr, Expr>> edge = {{0, 1}, {y0, h}};
+        std::vector<std::pair<Expr, Expr>> affected = blur_y.affected_region(input.name(), edge, bounds);
+        if (!affected[0].first.defined() ||
+            !Internal::is_const(affected[0].first, 0) || !Internal::is_const(affected[0].second, 2)) {
+            printf("Unexpected affected region at the edge\n");
+            return -1;
+        }
+    }
+
+    // Without the bounds of the output, a clamped dimension is
+    // affected everywhere.
+    {
+        std::vector<std::pair<Expr, Expr>> affected = blur_y.affected_region(input.name(), dirty);
+        if (affected[0].first.defined() || affected[1].first.defined()) {
+            printf("Expected the clamped dimensions to be affected everywhere\n");
+            return -1;
+        }
+    }
+
+    // Mark the outputs, so we can check that only the affected ones
+    // are computed.
+    for (int j = 0; j < H; j++) {
+        for (int i = 0; i < W; i++) {
+            bool inside = (i >= x0 - 1 && i < x0 + w + 1 && j >= y0 - 2 && j < y0 + h + 2);
+            if (!inside) {
+                out(i, j) = -1;
+            }
+        }
+    }
+    Buffer<int> before(W, H);
+    before.copy_from(out);
+
+    blur_y.realize_dirty(out, input.name(), dirty);
+
+    Buffer<int> correct = blur_y.realize(W, H);
+    for (int j = 0; j < H; j++) {
+        for (int i = 0; i < W; i++) {
+            bool inside = (i >= x0 - 1 && i < x0 + w + 1 && j >= y0 - 2 && j < y0 + h + 2);
+            int expected = inside ? correct(i, j) : before(i, j);
+            if (out(i, j) != expected) {
+                printf("out(%d, %d) = %d instead of %d\n", i, j, out(i, j), expected);
+                return -1;
+            }
+        }
+    }
+
+    // A scan moves values between sites, so the whole of the scanned
+    // dimension is affected.
+    {
+        Func scan("scan");
+        RDom r(1, W - 1);
+        scan(x, y) = input(x, y);
+        scan(r, y) += scan(r - 1, y);
+        std::vector<std::pair<Expr, Expr>> affected = scan.affected_region(input.name(), dirty);
+        if (affected.size() != 2 || affected[0].first.defined() || affected[1].first.defined()) {
+            printf("Expected the scan to be affected everywhere\n");
+            return -1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
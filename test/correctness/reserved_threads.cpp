@@ -0,0 +1,68 @@
+#include "Halide.h"
+#include <atomic>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+
+using namespace Halide;
+
+#ifdef _WIN32
+#define DLLEXPORT __declspec(dllexport)
+#else
+#define DLLEXPORT
+#endif
+
+// The number of tasks running at once, and the most seen so far.
+std::atomic<int> active(0), max_active(0);
+extern "C" DLLEXPORT int busy(int x) {
+    int a = ++active;
+    int m = max_active;
+    while (a > m && !max_active.compare_exchange_weak(m, a)) {
+    }
+    // Take long enough that every thread allowed to join gets a task.
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    active--;
+    return x;
+}
+HalideExtern_1(int, busy, int);
+
+int main(int argc, char **argv) {
+    // Three worker threads, two of which are reserved for
+    // high-priority jobs. These must be set before the thread pool is
+    // initialized, so drop any existing JIT runtime first. Without
+    // spinning, the workers go straight to sleep between jobs.
+    char num_threads[] = "HL_NUM_THREADS=4";
+    char reserved_threads[] = "HL_RESERVED_THREADS=2";
+    char spin_count[] = "HL_SPIN_COUNT=0";
+    putenv(num_threads);
+    putenv(reserved_threads);
+    putenv(spin_count);
+    Internal::JITSharedRuntime::release_all();
+
+    Var x;
+    Func f;
+    f(x) = busy(x);
+    f.parallel(x);
+
+    // Only the calling thread and the one unreserved worker may work
+    // on a normal-priority job.
+    for (int i = 0; i < 4; i++) {
+        Buffer<int> im = f.realize(64);
+        for (int x = 0; x < im.width(); x++) {
+            if (im(x) != x) {
+                printf("im(%d) = %d\n", x, im(x));
+                return -1;
+            }
+        }
+    }
+
+    if (max_active > 2) {
+        printf("%d threads worked on a normal-priority job at once, "
+               "but two of the four are reserved\n", (int)max_active);
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
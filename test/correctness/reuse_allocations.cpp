@@ -0,0 +1,42 @@
+#include "Halide.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    // Make the default allocator keep freed blocks around. This is
+    // decided at the first allocation, so drop any existing JIT
+    // runtime first.
+    char env[] = "HL_REUSE_ALLOCATIONS=64";
+    putenv(env);
+    Internal::JITSharedRuntime::release_all();
+
+    // A pipeline with heap-allocated intermediates of a few different
+    // sizes, run repeatedly at different sizes so that blocks get
+    // recycled between runs.
+    Func f, g, h;
+    Var x, y;
+    f(x, y) = x + y;
+    g(x, y) = f(x - 1, y) + f(x + 1, y);
+    h(x, y) = g(x, y - 1) + g(x, y + 1);
+    f.compute_root();
+    g.compute_root();
+
+    for (int i = 0; i < 10; i++) {
+        int w = 100 + (i % 3) * 300, hgt = 200 + (i % 4) * 50;
+        Buffer<int> out = h.realize(w, hgt);
+        for (int yy = 0; yy < hgt; yy++) {
+            for (int xx = 0; xx < w; xx++) {
+                int correct = 4 * (xx + yy);
+                if (out(xx, yy) != correct) {
+                    printf("out(%d, %d) = %d instead of %d\n", xx, yy, out(xx, yy), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,79 @@
+#include <stdio.h>
+#include "Halide.h"
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+// Count the times a pipeline is lowered, and record the vector width
+// used by the most recent lowering.
+class CheckVectorWidth : public IRMutator {
+    class FindRamps : public IRVisitor {
+        using IRVisitor::visit;
+
+        void visit(const Ramp *op) {
+            lanes = op->lanes;
+            IRVisitor::visit(op);
+        }
+
+    public:
+        int lanes = 0;
+    };
+
+public:
+    int lowerings = 0, lanes = 0;
+
+    using IRMutator::mutate;
+
+    Stmt mutate(Stmt s) {
+        FindRamps f;
+        s.accept(&f);
+        lowerings++;
+        lanes = f.lanes;
+        return s;
+    }
+};
+
+int main(int argc, char **argv) {
+    ScheduleParam<int> vector_width("vector_width", 4);
+
+    Var x("x"), y("y");
+    Func f("f");
+    f(x, y) = x + y;
+    f.vectorize(x, vector_width);
+
+    CheckVectorWidth *checker = new CheckVectorWidth;
+    f.add_custom_lowering_pass(checker);
+
+    // Setting a ScheduleParam between realizations recompiles the
+    // pipeline, and returning to an earlier value reuses the code
+    // compiled for it.
+    const int widths[] = {4, 8, 4, 8, 16};
+    const int lowerings[] = {1, 2, 2, 2, 3};
+    for (int i = 0; i < 5; i++) {
+        vector_width.set(widths[i]);
+        Buffer<int> result = f.realize(64, 8);
+        for (int y = 0; y < result.height(); y++) {
+            for (int x = 0; x < result.width(); x++) {
+                if (result(x, y) != x + y) {
+                    printf("result(%d, %d) = %d instead of %d\n", x, y, result(x, y), x + y);
+                    return -1;
+                }
+            }
+        }
+
+        if (checker->lowerings != lowerings[i]) {
+            printf("After realizing with a vector width of %d, the pipeline has been lowered %d times instead of %d\n",
+                   widths[i], checker->lowerings, lowerings[i]);
+            return -1;
+        }
+        bool lowered = lowerings[i] != (i > 0 ? lowerings[i - 1] : 0);
+        if (lowered && checker->lanes != widths[i]) {
+            printf("The pipeline was compiled with a vector width of %d instead of %d\n",
+                   checker->lanes, widths[i]);
+            return -1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,71 @@
+#include <atomic>
+#include <stdio.h>
+#include "Halide.h"
+
+using namespace Halide;
+
+std::atomic<int> mallocs, frees;
+
+void *my_malloc(void *user_context, size_t x) {
+    mallocs++;
+    void *orig = malloc(x+32);
+    void *ptr = (void *)((((size_t)orig + 32) >> 5) << 5);
+    ((void **)ptr)[-1] = orig;
+    return ptr;
+}
+
+void my_free(void *user_context, void *ptr) {
+    frees++;
+    free(((void**)ptr)[-1]);
+}
+
+int main(int argc, char **argv) {
+    Func f, g, h;
+    Var x, y;
+    Param<int> offset;
+
+    // f and g are too big for the stack, and their sizes are only
+    // known at runtime, so without scratch arenas every task of the
+    // parallel loop would call malloc twice.
+    f(x, y) = x + y + offset;
+    g(x, y) = f(x, y) * 2 + f(x + 1, y);
+    h(x, y) = g(x, y) - g(x + 2, y);
+
+    f.compute_at(h, y);
+    g.compute_at(h, y);
+    h.parallel(y);
+    h.set_custom_allocator(my_malloc, my_free);
+
+    const int W = 20000, H = 1000;
+    for (int i = 0; i < 3; i++) {
+        mallocs = 0;
+        frees = 0;
+        offset.set(i);
+        Buffer<int> im = h.realize(W, H);
+
+        for (int yy = 0; yy < H; yy++) {
+            for (int xx = 0; xx < W; xx++) {
+                auto fv = [&](int a) { return a + yy + i; };
+                auto gv = [&](int a) { return fv(a) * 2 + fv(a + 1); };
+                int correct = gv(xx) - gv(xx + 2);
+                if (im(xx, yy) != correct) {
+                    printf("im(%d, %d) = %d instead of %d\n", xx, yy, im(xx, yy), correct);
+                    return -1;
+                }
+            }
+        }
+
+        if (mallocs != frees) {
+            printf("%d mallocs but %d frees\n", (int)mallocs, (int)frees);
+            return -1;
+        }
+
+        if (mallocs >= H) {
+            printf("%d mallocs for %d tasks. Scratch arenas should have been used.\n", (int)mallocs, H);
+            return -1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
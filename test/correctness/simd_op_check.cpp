@@ -51,6 +51,7 @@ struct Test {
     bool use_avx512_skylake{false};
     bool use_avx{false};
     bool use_power_arch_2_07{false};
+    bool use_power_arch_3_00{false};
     bool use_sse41{false};
     bool use_sse42{false};
     bool use_ssse3{false};
@@ -58,6 +59,9 @@ struct Test {
 
     string filter{"*"};
     string output_directory{Internal::get_test_tmp_dir()};
+    // Whether to also compile the vectorized Func of each test on its
+    // own, for the throughput benchmark in apps/simd_op_check.
+    bool compile_benchmarks{false};
     vector<Task> tasks;
 
     Target target;
@@ -97,7 +101,8 @@ struct Test {
         use_sse42 = use_avx;
 
         use_vsx = target.has_feature(Target::VSX);
-        use_power_arch_2_07 = target.has_feature(Target::POWER_ARCH_2_07);
+        use_power_arch_3_00 = target.has_feature(Target::POWER_ARCH_3_00);
+        use_power_arch_2_07 = use_power_arch_3_00 || target.has_feature(Target::POWER_ARCH_2_07);
 
         // We are going to call realize, i.e. we are going to JIT code.
         // Not all platforms support JITting. One indirect yet quick
@@ -139,7 +144,7 @@ struct Test {
         for (Target::Feature f : {Target::SSE41, Target::AVX,
                     Target::AVX2, Target::AVX512,
                     Target::FMA, Target::FMA4, Target::F16C,
-                    Target::VSX, Target::POWER_ARCH_2_07,
+                    Target::VSX, Target::POWER_ARCH_2_07, Target::POWER_ARCH_3_00,
                     Target::ARMv7s, Target::NoNEON, Target::MinGW}) {
             if (target.has_feature(f) != host_target.has_feature(f)) {
                 can_run_the_code = false;
@@ -240,6 +245,11 @@ struct Test {
         string fn_name = "test_" + name;
         error.compile_to_file(output_directory + fn_name, arg_types, fn_name, target);
 
+        if (compile_benchmarks) {
+            string bench_name = "bench_" + name;
+            f.compile_to_file(output_directory + bench_name, arg_types, bench_name, target);
+        }
+
         bool can_run_the_code = can_run_code();
         if (can_run_the_code) {
             Realization r = error.realize(target.without_feature(Target::NoRuntime));
@@ -276,8 +286,10 @@ struct Test {
     void check_sse_all() {
         #if LLVM_VERSION > 39
         #define YMM "*ymm"
+        #define ZMM "*zmm"
         #else
         #define YMM
+        #define ZMM
         #endif
 
         Expr f64_1 = in_f64(x), f64_2 = in_f64(x+16), f64_3 = in_f64(x+32);
@@ -656,6 +668,25 @@ struct Test {
             check("vpminuq", 8, min(u64_1, u64_2));
             check("vpmaxsq", 8, max(i64_1, i64_2));
             check("vpminsq", 8, min(i64_1, i64_2));
+
+            // AVX-512BW
+            check("vpaddsb" ZMM, 64, i8_sat(i16(i8_1) + i16(i8_2)));
+            check("vpsubsb" ZMM, 64, i8_sat(i16(i8_1) - i16(i8_2)));
+            check("vpaddusb" ZMM, 64, u8(min(u16(u8_1) + u16(u8_2), max_u8)));
+            check("vpsubusb" ZMM, 64, u8(max(i16(u8_1) - i16(u8_2), 0)));
+            check("vpaddsw" ZMM, 32, i16_sat(i32(i16_1) + i32(i16_2)));
+            check("vpsubsw" ZMM, 32, i16_sat(i32(i16_1) - i32(i16_2)));
+            check("vpaddusw" ZMM, 32, u16(min(u32(u16_1) + u32(u16_2), max_u16)));
+            check("vpsubusw" ZMM, 32, u16(max(i32(u16_1) - i32(u16_2), 0)));
+            check("vpmulhw" ZMM, 32, i16((i32(i16_1) * i32(i16_2)) / (256*256)));
+            check("vpmulhuw" ZMM, 32, u16((u32(u16_1) * u32(u16_2)) / (256*256)));
+            check("vpavgb" ZMM, 64, u8((u16(u8_1) + u16(u8_2) + 1)/2));
+            check("vpavgw" ZMM, 32, u16((u32(u16_1) + u32(u16_2) + 1)/2));
+            check("vpackssdw" ZMM, 32, i16_sat(i32_1));
+            check("vpacksswb" ZMM, 64, i8_sat(i16_1));
+            check("vpackuswb" ZMM, 64, u8_sat(i16_1));
+            check("vpackusdw" ZMM, 32, u16_sat(i32_1));
+            check("vpmaddwd" ZMM, 16, i32(i16_1) * 3 + i32(i16_2) * 4);
         }
     }
 
@@ -1427,6 +1458,21 @@ struct Test {
         // Interleave or deinterleave two vectors. Given that we use
         // interleaving loads and stores, it's hard to hit this op with
         // halide.
+
+        // SDOT/UDOT  I     -       Dot Product (ARMv8.2)
+        if (!arm32 && target.has_feature(Target::ARMDotProd)) {
+            for (int w = 1; w <= 4; w++) {
+                Expr u_dot = u32(0), s_dot = i32(0);
+                for (int k = 0; k < 4; k++) {
+                    u_dot += u32(in_u8(4*x + k)) * u32(in_u8(4*x + k + 64));
+                    s_dot += i32(in_i8(4*x + k)) * i32(in_i8(4*x + k + 64));
+                }
+                check("udot", 2*w, u_dot);
+                check("sdot", 2*w, s_dot);
+                check("udot", 2*w, u32_1 + u_dot);
+                check("sdot", 2*w, i32_1 + s_dot);
+            }
+        }
     }
 
     void check_hvx_all() {
@@ -1874,8 +1920,6 @@ struct Test {
         check("vmpa(v*.h,r*.b)", hvx_width/2, 2*i32(i16_1) + 3*i32(i16_2));
         check("v*.w += vmpa(v*.h,r*.b)", hvx_width/2, 2*i32(i16_1) + 3*i32(i16_2) + i32_1);
 
-#if 0
-        // TODO: Re-enable these when vtmpy codegen is re-enabled.
         check("v*:*.h = vtmpy(v*:*.ub, r*.b)", hvx_width/1, 2*i16(in_u8(x - 1)) + 3*i16(in_u8(x)) + i16(in_u8(x + 1)));
         check("v*:*.h = vtmpy(v*:*.ub, r*.b)", hvx_width/1, i16(in_u8(x - 1)) + 3*i16(in_u8(x)) + i16(in_u8(x + 1)));
         check("v*:*.h = vtmpy(v*:*.ub, r*.b)", hvx_width/1, i16(in_u8(x - 1))*2 + i16(in_u8(x)) + i16(in_u8(x + 1)));
@@ -1890,7 +1934,6 @@ struct Test {
         check("v*:*.w = vtmpy(v*:*.h, r*.b)", hvx_width/2, i32(in_i16(x - 1)) + 3*i32(in_i16(x)) + i32(in_i16(x + 1)));
         check("v*:*.w = vtmpy(v*:*.h, r*.b)", hvx_width/2, i32(in_i16(x - 1))*2 + i32(in_i16(x)) + i32(in_i16(x + 1)));
         check("v*:*.w = vtmpy(v*:*.h, r*.b)", hvx_width/2, i32(in_i16(x - 1)) + i32(in_i16(x)) + i32(in_i16(x + 1)));
-#endif
 
         // We only generate vdmpy if the inputs are interleaved (otherwise we would use vmpa).
         check("vdmpy(v*.ub,r*.b)", hvx_width/2, i16(in_u8(2*x))*127 + i16(in_u8(2*x + 1))*-128);
@@ -1925,10 +1968,12 @@ struct Test {
         check("v*.uw += vrmpy(v*.ub,v*.ub)", hvx_width, u32_1 + u32(u8_1)*u8_1 + u32(u8_2)*u8_2 + u32(u8_3)*u8_3 + u32(u8_4)*u8_4);
 check("v*.w += vrmpy(v*.b,v*.b)", hvx_width, i32_1 + i32(i8_1)*i8_1 + i32(i8_2)*i8_2 + i32(i8_3)*i8_3 + i32(i8_4)*i8_4);
 
-#if 0
-        // These don't generate yet because we don't support mixed signs yet.
-        check("vrmpy(v*.ub,v*.b)", hvx_width, i32(u8_1)*i8_1) + i32(u8_2)*i8_2) + i32(u8_3)*i8_3 + i32(u8_4)*i8_4);
+        check("vrmpy(v*.ub,v*.b)", hvx_width, i32(u8_1)*i8_1 + i32(u8_2)*i8_2 + i32(u8_3)*i8_3 + i32(u8_4)*i8_4);
+        check("vrmpy(v*.ub,v*.b)", hvx_width, i32(i8_1)*u8_1 + i32(u8_2)*i8_2 + i32(i8_3)*u8_3 + i32(u8_4)*i8_4);
         check("v*.w += vrmpy(v*.ub,v*.b)", hvx_width, i32_1 + i32(u8_1)*i8_1 + i32(u8_2)*i8_2 + i32(u8_3)*i8_3 + i32(u8_4)*i8_4);
+#if 0
+        // This doesn't generate because the interleaves don't simplify
+        // away, so it's not profitable for 16 bit results.
         check("vrmpy(v*.ub,v*.b)", hvx_width, i16(u8_1)*i8_1 + i16(u8_2)*i8_2 + i16(u8_3)*i8_3 + i16(u8_4)*i8_4);
 #endif
 
@@ -2026,6 +2071,28 @@ check("v*.w += vrmpy(v*.b,v*.b)", hvx_width, i32_1 + i32(i8_1)*i8_1 + i32(i8_2)*
             // Vector Floating-Point Maximum and Minimum Instructions
             check("vmaxfp", 4*w, max(f32_1, f32_2));
             check("vminfp", 4*w, min(f32_1, f32_2));
+
+            // Vector Pack Saturate Instructions
+            check("vpkshss", 16*w, i8_sat(i16_1));
+            check("vpkshus", 16*w, u8_sat(i16_1));
+            check("vpkuhus", 16*w, u8_sat(u16_1));
+            check("vpkswss",  8*w, i16_sat(i32_1));
+            check("vpkswus",  8*w, u16_sat(i32_1));
+            check("vpkuwus",  8*w, u16_sat(u32_1));
+
+            // Vector Multiply-Sum Instructions
+            Expr u8_sum = u32(0), i16_sum = i32(0), u16_sum = u32(0);
+            for (int k = 0; k < 4; k++) {
+                u8_sum += u32(in_u8(4*x + k)) * u32(in_u8(4*x + k + 64));
+            }
+            for (int k = 0; k < 2; k++) {
+                i16_sum += i32(in_i16(2*x + k)) * i32(in_i16(2*x + k + 64));
+                u16_sum += u32(in_u16(2*x + k)) * u32(in_u16(2*x + k + 64));
+            }
+            check("vmsumubm", 4*w, u8_sum);
+            check("vmsumubm", 4*w, u32_1 + u8_sum);
+            check("vmsumshm", 4*w, i32_1 + i16_sum);
+            check("vmsumuhm", 4*w, u32_1 + u16_sum);
         }
 
         // Check these if target supports VSX.
@@ -2054,6 +2121,19 @@ check("v*.w += vrmpy(v*.b,v*.b)", hvx_width, i32_1 + i32(i8_1)*i8_1 + i32(i8_2)*
                 check("vmaxud",  2*w, max(u64_1, u64_2));
                 check("vminsd",  2*w, min(i64_1, i64_2));
                 check("vminud",  2*w, min(u64_1, u64_2));
+
+                check("vpksdss", 4*w, i32_sat(i64_1));
+                check("vpksdus", 4*w, u32_sat(i64_1));
+                check("vpkudus", 4*w, u32_sat(u64_1));
+            }
+        }
+
+        // Check these if target supports POWER ISA 3.00 (POWER9).
+        if (use_power_arch_3_00) {
+            for (int w = 1; w <= 4; w++) {
+                check("vabsdub", 16*w, absd(u8_1, u8_2));
+                check("vabsduh",  8*w, absd(u16_1, u16_2));
+                check("vabsduw",  4*w, absd(u32_1, u32_2));
             }
         }
     }
@@ -2110,6 +2190,8 @@ int main(int argc, char **argv) {
         test.output_directory = argv[2];
     }
 
+    test.compile_benchmarks = Internal::get_env_variable("HL_SIMD_OP_CHECK_BENCHMARKS") == "1";
+
     bool success = test.test_all();
 
     // Compile a runtime for this target, for use in the static test.
@@ -0,0 +1,53 @@
+#include "Halide.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    // Give the simplifier a tiny budget, so that most of the
+    // pipeline is left unsimplified. The code must still be correct.
+#ifdef _WIN32
+    _putenv_s("HL_SIMPLIFY_BUDGET", "100");
+#else
+    setenv("HL_SIMPLIFY_BUDGET", "100", 1);
+#endif
+
+    const int W = 32, H = 16;
+    Buffer<int> in(W, H);
+    in.for_each_element([&](int x, int y) { in(x, y) = x * 3 + y * 7; });
+
+    Var x("x"), y("y");
+    Func clamped = BoundaryConditions::mirror_interior(in);
+    Func blur_x("blur_x"), blur_y("blur_y");
+    blur_x(x, y) = clamped(x - 1, y) + clamped(x, y) + clamped(x + 1, y);
+    blur_y(x, y) = blur_x(x, y - 1) + blur_x(x, y) + blur_x(x, y + 1);
+
+    blur_x.compute_at(blur_y, y).vectorize(x, 4);
+    blur_y.split(y, y, Var("yi"), 4).vectorize(x, 8);
+
+    Buffer<int> result = blur_y.realize(W, H);
+
+    auto mirror = [](int v, int n) {
+        if (v < 0) return -v;
+        if (v >= n) return 2 * (n - 1) - v;
+        return v;
+    };
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            int correct = 0;
+            for (int dy = -1; dy <= 1; dy++) {
+                for (int dx = -1; dx <= 1; dx++) {
+                    correct += in(mirror(x + dx, W), mirror(y + dy, H));
+                }
+            }
+            if (result(x, y) != correct) {
+                printf("result(%d, %d) = %d instead of %d\n", x, y, result(x, y), correct);
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -1,3 +1,4 @@
+#include <atomic>
 #include <stdio.h>
 #include "Halide.h"
 
@@ -9,7 +10,7 @@ using namespace Halide;
 #define DLLEXPORT
 #endif
 
-int count = 0;
+std::atomic<int> count(0);
 extern "C" DLLEXPORT int call_counter(int x, int y) {
     count++;
     return 0;
@@ -39,7 +40,7 @@ int main(int argc, char **argv) {
 
         // f should be able to tell that it only needs to compute each value once
         if (count != 101) {
-            printf("f was called %d times instead of %d times\n", count, 101);
+            printf("f was called %d times instead of %d times\n", (int)count, 101);
             return -1;
         }
     }
@@ -57,7 +58,7 @@ int main(int argc, char **argv) {
 
         Buffer<int> im = h.realize(100);
         if (count != 101) {
-            printf("f was called %d times instead of %d times\n", count, 101);
+            printf("f was called %d times instead of %d times\n", (int)count, 101);
             return -1;
         }
     }
@@ -84,7 +85,7 @@ int main(int argc, char **argv) {
 
         Buffer<int> im = h.realize(100, 4);
         if (count != 404) {
-            printf("f was called %d times instead of %d times\n", count, 404);
+            printf("f was called %d times instead of %d times\n", (int)count, 404);
             return -1;
         }
     }
@@ -107,7 +108,7 @@ int main(int argc, char **argv) {
         // x, and (y .. y-1) in y. Sliding window optimization means that
         // we can skip the y-1 case in all but the first iteration.
         if (count != 100 * 11) {
-            printf("f was called %d times instead of %d times\n", count, 100*11);
+            printf("f was called %d times instead of %d times\n", (int)count, 100*11);
             return -1;
         }
     }
@@ -124,7 +125,7 @@ int main(int argc, char **argv) {
         Buffer<int> im = g.realize(10, 10);
 
         if (count != 11*11) {
-            printf("f was called %d times instead of %d times\n", count, 11*11);
+            printf("f was called %d times instead of %d times\n", (int)count, 11*11);
             return -1;
         }
     }
@@ -141,7 +142,7 @@ int main(int argc, char **argv) {
 
         Buffer<int> im = g.realize(10, 10);
         if (count != 1500) {
-            printf("f was called %d times instead of %d times\n", count, 1500);
+            printf("f was called %d times instead of %d times\n", (int)count, 1500);
             return -1;
         }
     }
@@ -172,7 +173,27 @@ int main(int argc, char **argv) {
 
         // f should be able to tell that it only needs to compute each value once
         if (count != 6) {
-            printf("f was called %d times instead of %d times\n", count, 6);
+            printf("f was called %d times instead of %d times\n", (int)count, 6);
+            return -1;
+        }
+    }
+
+    {
+        // Sliding within the tasks of a parallel loop. Each task of
+        // 8 rows computes the row of f it shares with the next task
+        // again.
+        Func f, g;
+        f(x, y) = call_counter(x, y);
+        g(x, y) = f(x, y) + f(x, y + 1);
+
+        f.store_root().compute_at(g, y).slide_in_tasks(8);
+        g.parallel(y);
+
+        count = 0;
+        Buffer<int> im = g.realize(10, 64);
+
+        if (count != 8 * 9 * 10) {
+            printf("f was called %d times instead of %d times\n", (int)count, 8 * 9 * 10);
             return -1;
         }
     }
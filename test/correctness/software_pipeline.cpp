@@ -0,0 +1,76 @@
+#include <stdio.h>
+#include "Halide.h"
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    const int W = 67, H = 45;
+    Target t = get_jit_target_from_environment().with_feature(Target::SoftwarePipeline);
+
+    Buffer<int> input(W, H);
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            input(x, y) = (x * 17 + y * 31) % 23;
+        }
+    }
+
+    // A first order IIR filter down the columns, vectorized across
+    // them. Each row is a short latency-bound dependency chain on the
+    // previous row, fed by loads of the input.
+    {
+        Func blur;
+        Var x, y;
+        RDom ry(1, H - 1);
+        blur(x, y) = input(x, y);
+        blur(x, ry) = blur(x, ry - 1) / 2 + input(x, ry) + input(x + 1, ry);
+        blur.bound(x, 0, W - 1);
+        blur.update().vectorize(x, 8, TailStrategy::GuardWithIf);
+
+        Buffer<int> result = blur.realize(W - 1, H, t);
+
+        Buffer<int> correct(W - 1, H);
+        for (int x = 0; x < W - 1; x++) {
+            correct(x, 0) = input(x, 0);
+        }
+        for (int y = 1; y < H; y++) {
+            for (int x = 0; x < W - 1; x++) {
+                correct(x, y) = correct(x, y - 1) / 2 + input(x, y) + input(x + 1, y);
+            }
+        }
+
+        for (int y = 0; y < H; y++) {
+            for (int x = 0; x < W - 1; x++) {
+                if (result(x, y) != correct(x, y)) {
+                    printf("blur(%d, %d) = %d instead of %d\n", x, y, result(x, y), correct(x, y));
+                    return -1;
+                }
+            }
+        }
+    }
+
+    // A scalar recurrence along a row, partially unrolled.
+    {
+        Func f;
+        Var x;
+        RDom r(1, W - 1);
+        f(x) = input(x, 0);
+        f(r) = f(r - 1) * 3 / 4 + input(r, 1) + input(r, 2);
+        f.update().unroll(r, 4, TailStrategy::GuardWithIf);
+
+        Buffer<int> result = f.realize(W, t);
+
+        int correct = input(0, 0);
+        for (int x = 0; x < W; x++) {
+            if (x > 0) {
+                correct = correct * 3 / 4 + input(x, 1) + input(x, 2);
+            }
+            if (result(x) != correct) {
+                printf("f(%d) = %d instead of %d\n", x, result(x), correct);
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,87 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+// Count the branches on an innermost stride.
+class CountStrideTests : public IRMutator {
+    class Counter : public IRVisitor {
+        using IRVisitor::visit;
+
+        void visit(const IfThenElse *op) {
+            if (expr_uses_var(op->condition, "input.stride.0")) {
+                tests++;
+            }
+            IRVisitor::visit(op);
+        }
+
+    public:
+        int tests = 0;
+    };
+
+public:
+    int tests = 0;
+
+    using IRMutator::mutate;
+
+    Stmt mutate(Stmt s) {
+        Counter c;
+        s.accept(&c);
+        tests = c.tests;
+        return s;
+    }
+};
+
+int main(int argc, char **argv) {
+    const int W = 64, H = 32;
+
+    ImageParam input(Float(32), 2, "input");
+    // Allow any stride, as for a channel of an interleaved image.
+    input.dim(0).set_stride(Expr());
+
+    Var x("x"), y("y");
+    Func f("f");
+    f(x, y) = input(x, y) * 2.0f + input(x + 1, y);
+    f.vectorize(x, 8);
+
+    CountStrideTests *counter = new CountStrideTests;
+    f.add_custom_lowering_pass(counter);
+
+    Target t = get_jit_target_from_environment().with_feature(Target::SpecializeUnitStride);
+    f.compile_jit(t);
+
+    if (counter->tests == 0) {
+        printf("The loop nest was not specialized on the stride of the input\n");
+        return -1;
+    }
+
+    // Run it on a dense buffer and on a transposed one, which take
+    // different paths.
+    Buffer<float> dense(W + 1, H);
+    Buffer<float> transposed_storage(H, W + 1);
+    Buffer<float> transposed = transposed_storage.transposed(0, 1);
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W + 1; x++) {
+            dense(x, y) = transposed(x, y) = (float)(x * 3 + y);
+        }
+    }
+
+    for (Buffer<float> *in : {&dense, &transposed}) {
+        input.set(*in);
+        Buffer<float> result = f.realize(W, H, t);
+        for (int y = 0; y < H; y++) {
+            for (int x = 0; x < W; x++) {
+                float correct = (x * 3 + y) * 2.0f + ((x + 1) * 3 + y);
+                if (result(x, y) != correct) {
+                    printf("result(%d, %d) = %f instead of %f (input stride %d)\n",
+                           x, y, result(x, y), correct, in->dim(0).stride());
+                    return -1;
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
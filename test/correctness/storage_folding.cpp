@@ -425,6 +425,35 @@ int main(int argc, char **argv) {
             });
     }
 
+    {
+        // The extent of the footprint of f depends on a parameter, so
+        // the fold factor is only known at runtime.
+        Func f, g;
+        Param<int> r;
+        f(x, y) = x + y;
+        g(x, y) = f(x, y - r) + f(x, y + r);
+        f.store_root().compute_at(g, y);
+
+        g.set_custom_allocator(my_malloc, my_free);
+
+        r.set(2);
+        custom_malloc_size = 0;
+        Buffer<int> out = g.realize(100, 1000);
+
+        size_t expected_size = 100*5*sizeof(int) + sizeof(int);
+        if (custom_malloc_size == 0 || custom_malloc_size != expected_size) {
+            printf("Scratch space allocated was %d instead of %d\n", (int)custom_malloc_size, (int)expected_size);
+            return -1;
+        }
+
+        out.for_each_element([&](int x, int y) {
+                if (out(x, y) != 2 * (x + y)) {
+                    printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), 2 * (x + y));
+                    abort();
+                }
+            });
+    }
+
     // Now we check some error cases.
 
     {
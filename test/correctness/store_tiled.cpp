@@ -0,0 +1,64 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    Var x, y, c, xi, yi;
+
+    // A stencil over a producer stored in 8x8 tiles, consumed in
+    // tiles that don't line up with the producer's.
+    for (int vector_width : {1, 4, 8}) {
+        Func f, g;
+        f(x, y) = x * 3 + y * 1000;
+        g(x, y) = f(x - 1, y) + f(x + 1, y) + f(x, y - 1) * 2 + f(x, y + 1) * 3;
+
+        f.compute_at(g, x).store_tiled(x, y, 8, 8);
+        g.tile(x, y, xi, yi, 32, 16);
+        if (vector_width > 1) {
+            f.vectorize(x, vector_width);
+            g.vectorize(xi, vector_width);
+        }
+
+        Buffer<int> result(100, 50);
+        result.set_min(-7, 3);
+        g.realize(result);
+        for (int yy = result.dim(1).min(); yy <= result.dim(1).max(); yy++) {
+            for (int xx = result.dim(0).min(); xx <= result.dim(0).max(); xx++) {
+                auto fr = [](int a, int b) { return a * 3 + b * 1000; };
+                int correct = fr(xx - 1, yy) + fr(xx + 1, yy) + fr(xx, yy - 1) * 2 + fr(xx, yy + 1) * 3;
+                if (result(xx, yy) != correct) {
+                    printf("result(%d, %d) = %d instead of %d with vector width %d\n",
+                           xx, yy, result(xx, yy), correct, vector_width);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    // Tiles of a 3-D Func with a Tuple stored interleaved, and tile
+    // extents that aren't powers of two.
+    {
+        Func f, g;
+        f(c, x, y) = Tuple(c + x * 10 + y * 100, c - x);
+        g(x, y, c) = f(c, x, y)[0] + f(c, x + 1, y + 1)[1];
+
+        f.compute_root().store_tiled(x, y, 5, 3).store_tuple_interleaved();
+        Buffer<int> result = g.realize(37, 23, 3);
+        for (int cc = 0; cc < 3; cc++) {
+            for (int yy = 0; yy < 23; yy++) {
+                for (int xx = 0; xx < 37; xx++) {
+                    int correct = (cc + xx * 10 + yy * 100) + (cc - (xx + 1));
+                    if (result(xx, yy, cc) != correct) {
+                        printf("result(%d, %d, %d) = %d instead of %d\n",
+                               xx, yy, cc, result(xx, yy, cc), correct);
+                        return -1;
+                    }
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,66 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+#ifdef _WIN32
+#define DLLEXPORT __declspec(dllexport)
+#else
+#define DLLEXPORT
+#endif
+
+int call_count = 0;
+
+extern "C" DLLEXPORT int count_calls(int t) {
+    call_count++;
+    return t * 3 + 1;
+}
+HalideExtern_1(int, count_calls, int);
+
+int check_chunk(Func out, int start, int size, int expected_calls) {
+    Buffer<int> chunk(size);
+    chunk.set_min(start);
+    call_count = 0;
+    out.realize(chunk);
+    for (int t = start; t < start + size; t++) {
+        int correct = 0;
+        for (int i = t - 2; i <= t; i++) {
+            correct += i * 3 + 1;
+        }
+        if (chunk(t) != correct) {
+            printf("out(%d) = %d instead of %d\n", t, chunk(t), correct);
+            return -1;
+        }
+    }
+    if (call_count != expected_calls) {
+        printf("The chunk at %d computed f %d times instead of %d\n", start, call_count, expected_calls);
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    Var t("t");
+    Func f("f"), out("out");
+    f(t) = count_calls(t);
+    out(t) = f(t - 2) + f(t - 1) + f(t);
+    f.compute_root().stream(t, 32);
+
+    // The first chunk computes f over the chunk and its history, and
+    // each chunk after it only the new values.
+    if (check_chunk(out, 0, 16, 18) != 0) return -1;
+    for (int i = 1; i < 4; i++) {
+        if (check_chunk(out, i * 16, 16, 16) != 0) return -1;
+    }
+
+    // Jumping ahead in the stream starts over.
+    if (check_chunk(out, 1000, 16, 18) != 0) return -1;
+    if (check_chunk(out, 1016, 8, 8) != 0) return -1;
+
+    // So does resetting the stream.
+    Internal::JITSharedRuntime::stream_state_reset();
+    if (check_chunk(out, 1024, 16, 18) != 0) return -1;
+
+    printf("Success!\n");
+    return 0;
+}
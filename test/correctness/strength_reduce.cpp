@@ -0,0 +1,63 @@
+#include <stdio.h>
+#include "Halide.h"
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    // A 4-D pipeline over an input with runtime strides, so that the
+    // address arithmetic in the loop nest is done with induction
+    // variables.
+    const int W = 19, H = 13, D = 7, N = 5;
+
+    Buffer<int> full(W + 3, H + 2, D + 1, N);
+    full.for_each_element([&](int x, int y, int z, int w) {
+        full(x, y, z, w) = x + y * 31 + z * 7 + w * 1000;
+    });
+    Buffer<int> input = full;
+    input.crop(0, 1, W + 1);
+    input.crop(1, 0, H + 1);
+    input.crop(2, 0, D);
+    input.translate(0, -1);
+
+    ImageParam in(Int(32), 4);
+    Func f, g;
+    Var x, y, z, w, xi;
+    f(x, y, z, w) = in(x, y, z, w) * 2 + in(x + 1, y + 1, z, w);
+    g(x, y, z, w) = f(x, y, z, w) + f(x, y, (z + 1) % D, w);
+
+    for (int i = 0; i < 3; i++) {
+        if (i == 0) {
+            f.compute_root();
+        } else if (i == 1) {
+            f.compute_at(g, w).vectorize(x, 4);
+            g.reorder(y, x, z, w);
+        } else {
+            f.compute_at(g, z);
+            g.split(x, x, xi, 4).reorder(xi, y, z, x, w).vectorize(xi);
+        }
+
+        in.set(input);
+        Buffer<int> result = g.realize(W, H, D, N);
+
+        for (int ww = 0; ww < N; ww++) {
+            for (int zz = 0; zz < D; zz++) {
+                for (int yy = 0; yy < H; yy++) {
+                    for (int xx = 0; xx < W; xx++) {
+                        auto fv = [&](int z) {
+                            return input(xx, yy, z, ww) * 2 + input(xx + 1, yy + 1, z, ww);
+                        };
+                        int correct = fv(zz) + fv((zz + 1) % D);
+                        if (result(xx, yy, zz, ww) != correct) {
+                            printf("Schedule %d: result(%d, %d, %d, %d) = %d instead of %d\n",
+                                   i, xx, yy, zz, ww, result(xx, yy, zz, ww), correct);
+                            return -1;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,64 @@
+#include "Halide.h"
+#include <stdio.h>
+#include <fstream>
+#include <sstream>
+
+#include "test/common/halide_test_dirs.h"
+
+using namespace Halide;
+
+std::string lowered(Func f, const std::vector<Argument> &args, const std::string &name) {
+    std::string stmt_file = Internal::get_test_tmp_dir() + name + ".stmt";
+    Internal::ensure_no_file_exists(stmt_file);
+    f.compile_to_lowered_stmt(stmt_file, args);
+    std::ifstream file(stmt_file);
+    std::stringstream contents;
+    contents << file.rdbuf();
+    return contents.str();
+}
+
+int main(int argc, char **argv) {
+    for (bool trusted : {false, true}) {
+        ImageParam in(Int(32), 2, "in");
+        Var x("x"), y("y");
+        Func f("f");
+        f(x, y) = in(x + 1, y) * 2;
+
+        in.dim(0).set_bounds(0, 18).dim(1).set_bounds(0, 8);
+        f.output_buffer().dim(0).set_bounds(0, 16).dim(1).set_bounds(0, 8);
+        if (trusted) {
+            in.trust_constraints();
+            f.output_buffer().trust_constraints();
+        }
+
+        std::string stmt = lowered(f, {in}, trusted ? "trusted_constraints" : "untrusted_constraints");
+        bool has_bounds_check = stmt.find("halide_error_access_out_of_bounds(\"Input buffer in\"") != std::string::npos;
+        bool has_constraint_check = stmt.find("halide_error_constraint_violated") != std::string::npos;
+        if (has_bounds_check == trusted || has_constraint_check == trusted) {
+            printf("Unexpected checks with trusted = %d:\n%s\n", trusted, stmt.c_str());
+            return -1;
+        }
+        // The type of the buffer is checked either way.
+        if (stmt.find("halide_error_bad_type") == std::string::npos) {
+            printf("Missing type check with trusted = %d\n", trusted);
+            return -1;
+        }
+
+        Buffer<int> input(18, 8);
+        input.for_each_element([&](int x, int y) { input(x, y) = x * 3 + y; });
+        in.set(input);
+        Buffer<int> out = f.realize(16, 8);
+        for (int y = 0; y < 8; y++) {
+            for (int x = 0; x < 16; x++) {
+                int correct = ((x + 1) * 3 + y) * 2;
+                if (out(x, y) != correct) {
+                    printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,87 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+// Vectorized data-dependent loads can be lowered to gathers, or to
+// in-register table lookups when the table is small. Check the
+// results of each kind of lookup against the unvectorized version.
+template<typename T>
+int test_lookup(int table_size, int vector_width) {
+    const int W = 157, H = 11;
+
+    Buffer<T> table(table_size);
+    for (int i = 0; i < table_size; i++) {
+        table(i) = (T)(i * 37 + 11);
+    }
+    Buffer<uint8_t> in(W, H);
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            in(x, y) = (uint8_t)(rand() & 0xff);
+        }
+    }
+
+    Buffer<T> results[2];
+    for (int vectorize = 0; vectorize < 2; vectorize++) {
+        Var x, y;
+        Func f;
+        // The clamp bounds the index, so the whole table may be
+        // loaded into registers if it is small.
+        f(x, y) = table(clamp(cast<int>(in(x, y)) % table_size, 0, table_size - 1)) +
+            table(clamp(cast<int>(in(x, y)) - 3, 0, table_size - 1));
+        if (vectorize) {
+            f.vectorize(x, vector_width);
+        }
+        results[vectorize] = f.realize(W, H);
+    }
+
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            if (results[0](x, y) != results[1](x, y)) {
+                printf("Table of %d elements with vector width %d: "
+                       "result(%d, %d) = %f instead of %f\n",
+                       table_size, vector_width, x, y,
+                       (double)results[1](x, y), (double)results[0](x, y));
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    for (int vector_width : {8, 16, 32}) {
+        for (int table_size : {2, 9, 16, 17, 256}) {
+            if (test_lookup<uint8_t>(table_size, vector_width) ||
+                test_lookup<int32_t>(table_size, vector_width) ||
+                test_lookup<float>(table_size, vector_width)) {
+                return -1;
+            }
+        }
+    }
+
+    // An index computed in 32 bits, but loading from a buffer with 64-bit
+    // indices.
+    {
+        Buffer<float> table(1000);
+        for (int i = 0; i < 1000; i++) {
+            table(i) = i * 0.5f;
+        }
+        Var x;
+        Func f;
+        f(x) = table(clamp((x * 17) % 1000, 0, 999));
+        f.vectorize(x, 12);
+        Target t = get_jit_target_from_environment().with_feature(Target::LargeBuffers);
+        Buffer<float> result = f.realize(100, t);
+        for (int i = 0; i < 100; i++) {
+            float correct = ((i * 17) % 1000) * 0.5f;
+            if (result(i) != correct) {
+                printf("result(%d) = %f instead of %f\n", i, result(i), correct);
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,106 @@
+#include "Halide.h"
+#include <algorithm>
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    const int W = 256, H = 16;
+
+    Buffer<uint8_t> bytes(W, H);
+    Buffer<int16_t> a(W), b(W);
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            bytes(x, y) = (uint8_t)(x * 17 + y * 31);
+        }
+    }
+    for (int x = 0; x < W; x++) {
+        a(x) = (int16_t)(x * 11 - 1400);
+        b(x) = (int16_t)(900 - x * 7);
+    }
+
+    Var y;
+    RDom r(0, W);
+
+    {
+        // Sums of rows of bytes, computed in vectors along each row.
+        Func row_sum;
+        row_sum(y) = cast<uint32_t>(0);
+        row_sum(y) += cast<uint32_t>(bytes(r, y));
+
+        row_sum.update().atomic().vectorize(r, 32);
+
+        Buffer<uint32_t> result = row_sum.realize(H);
+        for (int yy = 0; yy < H; yy++) {
+            uint32_t correct = 0;
+            for (int x = 0; x < W; x++) {
+                correct += bytes(x, yy);
+            }
+            if (result(yy) != correct) {
+                printf("row_sum(%d) = %u instead of %u\n", yy, result(yy), correct);
+                return -1;
+            }
+        }
+    }
+
+    {
+        // A dot product of 16-bit vectors.
+        Func dot;
+        dot() = 0;
+        dot() += cast<int>(a(r)) * b(r);
+
+        dot.update().atomic().vectorize(r, 16);
+
+        Buffer<int> result = dot.realize();
+        int correct = 0;
+        for (int x = 0; x < W; x++) {
+            correct += a(x) * b(x);
+        }
+        if (result() != correct) {
+            printf("dot() = %d instead of %d\n", result(), correct);
+            return -1;
+        }
+    }
+
+    {
+        // The max of each row, vectorized and parallelized.
+        Func row_max;
+        row_max(y) = cast<uint8_t>(0);
+        row_max(y) = max(row_max(y), bytes(r, y));
+
+        row_max.update().atomic().vectorize(r, 16).parallel(y);
+
+        Buffer<uint8_t> result = row_max.realize(H);
+        for (int yy = 0; yy < H; yy++) {
+            uint8_t correct = 0;
+            for (int x = 0; x < W; x++) {
+                correct = std::max(correct, bytes(x, yy));
+            }
+            if (result(yy) != correct) {
+                printf("row_max(%d) = %d instead of %d\n", yy, result(yy), correct);
+                return -1;
+            }
+        }
+    }
+
+    {
+        // A vector narrower than a native vector.
+        Func total;
+        total() = 0;
+        total() += cast<int>(bytes(r, 0));
+        total.update().atomic().vectorize(r, 8);
+
+        Buffer<int> result = total.realize();
+        int correct = 0;
+        for (int x = 0; x < W; x++) {
+            correct += bytes(x, 0);
+        }
+        if (result() != correct) {
+            printf("total() = %d instead of %d\n", result(), correct);
+            return -1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
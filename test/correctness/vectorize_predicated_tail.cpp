@@ -0,0 +1,51 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+template<typename T>
+bool test(int vec_width, int w) {
+    Buffer<T> input(w + 2);
+    for (int i = 0; i < w + 2; i++) {
+        input(i) = (T)(i * 3 + 1);
+    }
+
+    Var x;
+    Func f, g;
+    f(x) = input(x) + input(x + 2);
+    f.vectorize(x, vec_width, TailStrategy::Predicate);
+
+    // An update definition over an RDom, where only Predicate or
+    // GuardWithIf are legal.
+    RDom r(0, w);
+    g(x) = cast<T>(0);
+    g(r) += f(r);
+    g.update().vectorize(r, vec_width, TailStrategy::Predicate);
+    f.compute_root();
+
+    Buffer<T> result = g.realize(w);
+    for (int i = 0; i < w; i++) {
+        T correct = (T)(input(i) + input(i + 2));
+        if (result(i) != correct) {
+            printf("result(%d) = %d instead of %d (vector width %d, width %d)\n",
+                   i, (int)result(i), (int)correct, vec_width, w);
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    for (int w : {7, 37, 100}) {
+        if (!test<uint8_t>(32, w) ||
+            !test<int16_t>(16, w) ||
+            !test<int32_t>(8, w) ||
+            !test<float>(8, w) ||
+            !test<double>(4, w)) {
+            return -1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
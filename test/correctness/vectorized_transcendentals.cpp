@@ -0,0 +1,59 @@
+#include "Halide.h"
+#include <stdio.h>
+#include <cmath>
+
+using namespace Halide;
+
+// Evaluate some vectorized transcendentals for the given target and
+// check them against libm.
+bool test(const char *name, Target t, float sincos_tolerance, float explog_tolerance) {
+    const int N = 4096;
+    Var x;
+    // Covers a few hundred periods of sin and cos.
+    Expr arg = (x - N / 2) * 0.1f;
+    Func f;
+    f(x) = Tuple(sin(arg), cos(arg), exp(arg / 100), log(abs(arg) + 0.5f), pow(abs(arg) + 0.5f, 1.7f));
+    f.vectorize(x, 8);
+
+    Realization r = f.realize(N, t);
+    Buffer<float> s = r[0], c = r[1], e = r[2], l = r[3], p = r[4];
+
+    for (int i = 0; i < N; i++) {
+        double a = (i - N / 2) * 0.1f;
+        float a_pos = (float)std::abs(a) + 0.5f;
+        struct {
+            const char *fn;
+            float actual;
+            double correct;
+            float tolerance;
+        } checks[] = {
+            {"sin", s(i), std::sin(a), sincos_tolerance},
+            {"cos", c(i), std::cos(a), sincos_tolerance},
+            {"exp", e(i), std::exp((float)a / 100), explog_tolerance},
+            {"log", l(i), std::log(a_pos), explog_tolerance},
+            {"pow", p(i), std::pow(a_pos, 1.7f), explog_tolerance},
+        };
+        for (const auto &check : checks) {
+            double error = std::abs(check.actual - check.correct) / std::max(1.0, std::abs(check.correct));
+            if (!(error <= check.tolerance)) {
+                printf("%s: %s(%f) = %f instead of %f\n",
+                       name, check.fn, a, check.actual, check.correct);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    Target t = get_jit_target_from_environment();
+
+    if (!test("default", t, 1e-6f, 1e-5f) ||
+        !test("precise_math", t.with_feature(Target::PreciseMath), 1e-6f, 1e-5f) ||
+        !test("fast_math", t.with_feature(Target::FastMath), 1e-6f, 1e-3f)) {
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,22 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    Func f("f"), g("g");
+    Var x("x"), y("y");
+
+    g(x, y) = x + y;
+    f(x, y) = g(x, y) + g(x + 1, y);
+
+    // The rows of f are computed in parallel, so they can't share
+    // the storage of g.
+    f.parallel(y);
+    g.compute_at(f, y).hoist_storage_root();
+
+    f.realize(10, 10);
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,21 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    ImageParam input(Float(32), 1, "input");
+    Func f("f");
+    Var x("x");
+
+    f(x) = input(x - 1) + input(x + 1);
+
+    // Computing f in place would read sites of the input that f has
+    // already overwritten.
+    f.output_buffer().may_alias(input);
+
+    f.compile_jit();
+
+    printf("Success!\n");
+    return 0;
+}
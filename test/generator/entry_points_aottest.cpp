@@ -0,0 +1,67 @@
+#include <stdio.h>
+
+#include "HalideRuntime.h"
+#include "HalideBuffer.h"
+#include "entry_points.h"
+
+using namespace Halide::Runtime;
+
+const int W = 16, H = 8, N = 8;
+
+bool check(const Buffer<int32_t> &input, int32_t offset, bool negate, const Buffer<int32_t> &output) {
+    bool ok = true;
+    output.for_each_element([&](int x, int y) {
+        int32_t v = input(x, y) + offset;
+        int32_t expected = negate ? -v : v;
+        if (ok && output(x, y) != expected) {
+            printf("output(%d, %d) = %d instead of %d\n", x, y, output(x, y), expected);
+            ok = false;
+        }
+    });
+    return ok;
+}
+
+int main(int argc, char **argv) {
+    Buffer<int32_t> input(W, H);
+    input.for_each_element([&](int x, int y) {
+        input(x, y) = x + y * W;
+    });
+
+    // The regular and trusted entry points compute the same thing.
+    Buffer<int32_t> output(W, H);
+    if (entry_points(input, 3, false, output) != 0 ||
+        !check(input, 3, false, output)) {
+        return -1;
+    }
+    output.fill(0);
+    if (entry_points_trusted(input, 5, true, output) != 0 ||
+        !check(input, 5, true, output)) {
+        return -1;
+    }
+
+    // Run a batch of pipelines, each on different arguments. They run
+    // in parallel.
+    Buffer<int32_t> outputs[N];
+    halide_buffer_t *inputs_array[N], *outputs_array[N];
+    int32_t offsets[N];
+    bool negates[N];
+    for (int i = 0; i < N; i++) {
+        outputs[i] = Buffer<int32_t>(W, H);
+        inputs_array[i] = input.raw_buffer();
+        outputs_array[i] = outputs[i].raw_buffer();
+        offsets[i] = i * 10;
+        negates[i] = (i % 2) == 1;
+    }
+    if (entry_points_batch(N, inputs_array, offsets, negates, outputs_array) != 0) {
+        printf("entry_points_batch failed\n");
+        return -1;
+    }
+    for (int i = 0; i < N; i++) {
+        if (!check(input, offsets[i], negates[i], outputs[i])) {
+            return -1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
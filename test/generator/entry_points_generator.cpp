@@ -0,0 +1,21 @@
+#include "Halide.h"
+
+namespace {
+
+class EntryPoints : public Halide::Generator<EntryPoints> {
+public:
+    Input<Buffer<int32_t>> input{"input", 2};
+    Input<int32_t> offset{"offset"};
+    Input<bool> negate{"negate"};
+    Output<Buffer<int32_t>> output{"output", 2};
+
+    void generate() {
+        Var x, y;
+        Expr v = input(x, y) + offset;
+        output(x, y) = select(negate, -v, v);
+    }
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(EntryPoints, entry_points)
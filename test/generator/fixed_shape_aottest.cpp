@@ -0,0 +1,88 @@
+#include "HalideRuntime.h"
+#include "HalideBuffer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fixed_shape.h"
+
+using namespace Halide::Runtime;
+
+const halide_filter_argument_t *find_argument(const halide_filter_metadata_t *md, const char *name) {
+    for (int i = 0; i < md->num_arguments; i++) {
+        if (!strcmp(md->arguments[i].name, name)) {
+            return &md->arguments[i];
+        }
+    }
+    printf("No argument named %s\n", name);
+    exit(-1);
+    return nullptr;
+}
+
+int check_shape(const halide_filter_argument_t *arg, const halide_dimension_t *expected) {
+    if (!arg->fixed_shape) {
+        printf("Expected %s to have a fixed shape\n", arg->name);
+        return -1;
+    }
+    for (int i = 0; i < arg->dimensions; i++) {
+        const halide_dimension_t &d = arg->fixed_shape[i];
+        if (d.min != expected[i].min || d.extent != expected[i].extent || d.stride != expected[i].stride) {
+            printf("Dimension %d of %s is (%d, %d, %d) instead of (%d, %d, %d)\n",
+                   i, arg->name, d.min, d.extent, d.stride,
+                   expected[i].min, expected[i].extent, expected[i].stride);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    const halide_filter_metadata_t *md = fixed_shape_metadata();
+    if (md->version < 1) {
+        printf("Unexpected metadata version %d\n", md->version);
+        return -1;
+    }
+
+    const halide_dimension_t input_shape[] = {{-1, 66, 1}, {0, 32, 66}};
+    const halide_dimension_t output_shape[] = {{0, 64, 1}, {0, 32, 64}};
+    if (check_shape(find_argument(md, "input"), input_shape) != 0 ||
+        check_shape(find_argument(md, "output"), output_shape) != 0) {
+        return -1;
+    }
+
+    // The region of the lut used depends on a scalar argument.
+    if (find_argument(md, "lut")->fixed_shape || find_argument(md, "lut_max")->fixed_shape) {
+        printf("Expected lut and lut_max to have no fixed shape\n");
+        return -1;
+    }
+
+    // Allocate the input and output from the metadata, without a
+    // bounds query.
+    Buffer<int> input(nullptr, 2, find_argument(md, "input")->fixed_shape);
+    input.allocate();
+    Buffer<int> output(nullptr, 2, find_argument(md, "output")->fixed_shape);
+    output.allocate();
+    input.for_each_element([&](int x, int y) { input(x, y) = x + y; });
+
+    Buffer<int> lut(256);
+    lut.for_each_element([&](int i) { lut(i) = i * 3; });
+
+    if (fixed_shape(input, lut, 255, output) != 0) {
+        printf("Pipeline failed\n");
+        return -1;
+    }
+    for (int y = 0; y < 32; y++) {
+        for (int x = 0; x < 64; x++) {
+            int sum = 2 * (x + y);
+            int correct = (sum > 255 ? 255 : sum) * 3;
+            if (output(x, y) != correct) {
+                printf("output(%d, %d) = %d instead of %d\n", x, y, output(x, y), correct);
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
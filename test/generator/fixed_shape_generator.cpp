@@ -0,0 +1,28 @@
+#include "Halide.h"
+
+namespace {
+
+class FixedShape : public Halide::Generator<FixedShape> {
+public:
+    GeneratorParam<int> width{"width", 64};
+    GeneratorParam<int> height{"height", 32};
+
+    Input<Buffer<int>> input{"input", 2};
+    Input<Buffer<int>> lut{"lut", 1};
+    Input<int> lut_max{"lut_max"};
+    Output<Buffer<int>> output{"output", 2};
+
+    void generate() {
+        Var x, y;
+
+        Expr sum = input(x - 1, y) + input(x + 1, y);
+        output(x, y) = lut(clamp(sum, 0, lut_max));
+
+        output.dim(0).set_bounds(0, width);
+        output.dim(1).set_bounds(0, height);
+    }
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(FixedShape, fixed_shape)
@@ -58,6 +58,42 @@ int main(int argc, char **argv) {
         }
     }
 
+#if defined(TEST_CUDA)
+    // Record the same call into a graph, and then replay it with
+    // different input data.
+    output.fill(0);
+    output_no_host.host = (uint8_t *)1;
+    output_no_host.set_device_dirty(false);
+    struct halide_cuda_graph *graph = nullptr;
+    if (halide_cuda_graph_begin_capture(nullptr) == 0) {
+        gpu_only(&input_no_host, &output_no_host);
+        if (halide_cuda_graph_end_capture(nullptr, &graph) != 0) {
+            printf("Capturing graph failed\n");
+            return -1;
+        }
+
+        input.for_each_value([](int &v) { v += 1; });
+        input.set_host_dirty();
+        input.copy_to_device(halide_cuda_device_interface());
+        halide_cuda_graph_launch(nullptr, graph);
+
+        output_no_host.host = (uint8_t *)output.data();
+        halide_copy_to_host(nullptr, &output_no_host);
+        halide_cuda_graph_release(nullptr, graph);
+
+        for (int y = 0; y < H; y++) {
+            for (int x = 0; x < W; x++) {
+                if (input(x, y) * 2 != output(x, y)) {
+                    printf("Error after replaying graph at %d, %d: %d != %d\n", x, y, input(x, y), output(x, y));
+                    return -1;
+                }
+            }
+        }
+    } else {
+        printf("CUDA graphs not supported, skipping graph test\n");
+    }
+#endif
+
     printf("Success!\n");
 #else
     printf("No GPU target enabled, skipping...\n");
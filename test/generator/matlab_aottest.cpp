@@ -68,6 +68,12 @@ DLLEXPORT int mexWarnMsgTxt(const char *msg) {
     return 0;
 }
 
+int lock_count = 0;
+
+DLLEXPORT void mexLock() {
+    lock_count++;
+}
+
 DLLEXPORT size_t mxGetNumberOfDimensions_730(const mxArray *a) {
     return a->get_number_of_dimensions();
 }
@@ -169,6 +175,17 @@ int main(int argc, char **argv) {
         }
     }
 
+    // The mex library should lock itself once, however many times it
+    // is called.
+    mexFunction(1, lhs, 4, rhs);
+    assert(lhs[0]->get_scalar() == 0);
+    delete lhs[0];
+    lhs[0] = nullptr;
+    if (lock_count != 1) {
+        printf("mexLock called %d times instead of once\n", lock_count);
+        return -1;
+    }
+
     printf("Success!\n");
     return 0;
 }
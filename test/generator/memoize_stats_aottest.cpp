@@ -0,0 +1,68 @@
+#include "HalideRuntime.h"
+#include "HalideBuffer.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "memoize_stats.h"
+
+using namespace Halide::Runtime;
+
+bool get_expensive_stats(halide_memoization_cache_stats_t *result) {
+    halide_memoization_cache_stats_t stats[8];
+    int count = halide_memoization_cache_get_stats(stats, 8);
+    for (int i = 0; i < count && i < 8; i++) {
+        if (strstr(stats[i].name, "expensive")) {
+            *result = stats[i];
+            return true;
+        }
+    }
+    return false;
+}
+
+int main(int argc, char **argv) {
+    Buffer<int> out(32, 32);
+
+    // Three distinct keys, each used three times.
+    for (int pass = 0; pass < 3; pass++) {
+        for (int offset = 0; offset < 3; offset++) {
+            if (memoize_stats(offset, out) != 0) {
+                printf("Pipeline failed\n");
+                return -1;
+            }
+            for (int y = 0; y < 32; y++) {
+                for (int x = 0; x < 32; x++) {
+                    if (out(x, y) != x * y + offset + 1) {
+                        printf("out(%d, %d) = %d instead of %d\n",
+                               x, y, out(x, y), x * y + offset + 1);
+                        return -1;
+                    }
+                }
+            }
+        }
+    }
+
+    halide_memoization_cache_stats_t stats;
+    if (!get_expensive_stats(&stats)) {
+        printf("No statistics recorded for the memoized Func\n");
+        return -1;
+    }
+    printf("%s: %d hits, %d misses, %d evictions\n", stats.name,
+           (int)stats.hits, (int)stats.misses, (int)stats.evictions);
+    if (stats.hits != 6 || stats.misses != 3 || stats.evictions != 0) {
+        printf("Unexpected cache statistics\n");
+        return -1;
+    }
+
+    // Shrink the cache until only one entry fits. The two older
+    // entries should be evicted.
+    halide_memoization_cache_set_size(32 * 32 * sizeof(int));
+    get_expensive_stats(&stats);
+    if (stats.evictions != 2) {
+        printf("Expected 2 evictions, got %d\n", (int)stats.evictions);
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,23 @@
+#include "Halide.h"
+
+namespace {
+
+class MemoizeStats : public Halide::Generator<MemoizeStats> {
+public:
+    Input<int> offset{"offset"};
+    Output<Buffer<int>> output{"output", 2};
+
+    void generate() {
+        Var x, y;
+
+        Func expensive("expensive");
+        expensive(x, y) = x * y + offset;
+        expensive.compute_root().memoize();
+
+        output(x, y) = expensive(x, y) + 1;
+    }
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(MemoizeStats, memoize_stats)
@@ -87,6 +87,18 @@ int main(int argc, char **argv) {
 
     validate(state);
 
+    // Check the machine-readable report agrees.
+    int json_size = halide_profiler_report_json(nullptr, nullptr, 0);
+    assert(json_size > 0);
+    std::string json(json_size + 1, ' ');
+    int written = halide_profiler_report_json(nullptr, &json[0], (int)json.size());
+    assert(written == json_size);
+    json.resize(json_size);
+    printf("%s\n", json.c_str());
+    assert(json.find("\"name\": \"mandelbrot") != std::string::npos);
+    std::string allocs = "\"num_allocs\": " + std::to_string(mandelbrot_n_mallocs);
+    assert(json.find(allocs) != std::string::npos);
+
     printf("Success!\n");
     return 0;
 }
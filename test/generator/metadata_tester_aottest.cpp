@@ -110,6 +110,8 @@ void match_argument(const halide_filter_argument_t &e, const halide_filter_argum
     EXPECT_SCALAR_UNION_EQ(e.type.code, e.type.bits, e.def, a.def);
     EXPECT_SCALAR_UNION_EQ(e.type.code, e.type.bits, e.min, a.min);
     EXPECT_SCALAR_UNION_EQ(e.type.code, e.type.bits, e.max, a.max);
+    // None of the buffers have their shape fixed by constraints.
+    EXPECT_EQ(e.fixed_shape == nullptr, a.fixed_shape == nullptr);
 }
 
 template <typename Type>
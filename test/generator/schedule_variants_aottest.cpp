@@ -0,0 +1,49 @@
+#include <stdio.h>
+
+#include "HalideRuntime.h"
+#include "HalideBuffer.h"
+#include "schedule_variants.h"
+
+using namespace Halide::Runtime;
+
+bool check(int w, int h, int expected_scale,
+           int (*fn)(halide_buffer_t *, halide_buffer_t *), const char *name) {
+    Buffer<int32_t> input(w, h), output(w, h);
+    input.for_each_element([&](int x, int y) {
+        input(x, y) = x + y * w;
+    });
+    if (fn(input, output) != 0) {
+        printf("%s failed\n", name);
+        return false;
+    }
+    bool ok = true;
+    output.for_each_element([&](int x, int y) {
+        int32_t expected = input(x, y) * expected_scale;
+        if (ok && output(x, y) != expected) {
+            printf("%s on %dx%d: output(%d, %d) = %d instead of %d\n",
+                   name, w, h, x, y, output(x, y), expected);
+            ok = false;
+        }
+    });
+    return ok;
+}
+
+int main(int argc, char **argv) {
+    // The variants can be called directly.
+    if (!check(8, 8, 1, schedule_variants_small, "schedule_variants_small") ||
+        !check(8, 8, 2, schedule_variants_medium, "schedule_variants_medium") ||
+        !check(8, 8, 3, schedule_variants_large, "schedule_variants_large")) {
+        return -1;
+    }
+
+    // The regular entry point picks one by the size of the output.
+    if (!check(10, 10, 1, schedule_variants, "schedule_variants") ||
+        !check(40, 25, 2, schedule_variants, "schedule_variants") ||
+        !check(99, 99, 2, schedule_variants, "schedule_variants") ||
+        !check(100, 100, 3, schedule_variants, "schedule_variants")) {
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,26 @@
+#include "Halide.h"
+
+namespace {
+
+class ScheduleVariants : public Halide::Generator<ScheduleVariants> {
+public:
+    // Each variant sets a different scale, so the tests can tell
+    // which one ran. A real pipeline would only change its schedule.
+    GeneratorParam<int> scale{"scale", 1};
+    GeneratorParam<int> vectorize{"vectorize", 1};
+
+    Input<Buffer<int32_t>> input{"input", 2};
+    Output<Buffer<int32_t>> output{"output", 2};
+
+    void generate() {
+        Var x, y;
+        output(x, y) = input(x, y) * scale;
+        if (vectorize > 1) {
+            output.vectorize(x, vectorize, TailStrategy::GuardWithIf);
+        }
+    }
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(ScheduleVariants, schedule_variants)
@@ -62,6 +62,32 @@ struct Test {
 
         printf("%-20s: %f us\n", name, time * 1e6);
     }
+
+    // Test a vertical stencil with the rows innermost, so that each
+    // row loaded can be reused on the next two iterations. Compare
+    // recomputing them against carrying them across iterations in
+    // registers.
+    void test3() {
+        Func g(name);
+        Var x, y, xi;
+        g(x, y) = f(x, y - 1) + f(x, y) + f(x, y + 1);
+        g.split(x, x, xi, 8).reorder(xi, y, x).vectorize(xi).parallel(x);
+
+        Buffer<float> out = g.realize(W, H, target);
+        double reload_time = benchmark([&]() {
+                g.realize(out, target);
+        });
+
+        Target carry_target = target.with_feature(Target::LoopCarry);
+        g.realize(out, carry_target);
+        time = benchmark([&]() {
+                g.realize(out, carry_target);
+        });
+
+        printf("%-20s: %f us reloading, %f us carrying\n", name,
+               reload_time * 1e6, time * 1e6);
+        time = time / reload_time;
+    }
 };
 
 int main(int argc, char **argv) {
@@ -114,6 +140,19 @@ int main(int argc, char **argv) {
         }
     }
 
+    if (!target.has_gpu_feature()) {
+        for (int i = 0; tests[i].name; i++) {
+            tests[i].test3();
+            // Carrying values should never be much worse than
+            // reloading them.
+            if (tests[i].time > 1.5) {
+                printf("Error: %s is %f times slower with loop carry\n",
+                       tests[i].name, tests[i].time);
+                return -1;
+            }
+        }
+    }
+
     printf("Success!\n");
     return 0;
 }
@@ -1,6 +1,7 @@
 #include "Halide.h"
 
 #include <cstdio>
+#include <vector>
 #include "halide_benchmark.h"
 
 using namespace Halide;
@@ -26,6 +27,24 @@ int main(int argc, char **argv) {
 
     printf("%g ms per jit compilation\n", t * 1e3);
 
+    // The compile time of a deep pipeline, in which every stage is
+    // specialized. The specializations share most of their
+    // definitions, which stresses bounds inference.
+    Param<bool> p;
+    const int depth = 100;
+    t = benchmark(1, 3, [&]() {
+        std::vector<Func> fs(depth);
+        fs[0](x) = a(x);
+        for (int i = 1; i < depth; i++) {
+            fs[i](x) = fs[i-1](x) * 2 + fs[i-1](x + 1);
+            fs[i].compute_root();
+            fs[i].specialize(p).vectorize(x, 4);
+        }
+        fs[depth-1].compile_jit();
+    });
+
+    printf("%g ms per jit compilation of a pipeline %d Funcs deep\n", t * 1e3, depth);
+
     printf("Success!\n");
     return 0;
 }
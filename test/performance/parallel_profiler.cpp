@@ -0,0 +1,52 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int percentage = 0;
+float ms = 0;
+void my_print(void *, const char *msg) {
+    float this_ms;
+    int this_percentage;
+    int val = sscanf(msg, " expensive: %fms (%d", &this_ms, &this_percentage);
+    if (val == 2) {
+        ms = this_ms;
+        percentage = this_percentage;
+    }
+}
+
+int main(int argc, char **argv) {
+    // An expensive Func and a cheap one, interleaved within the tasks
+    // of a parallel loop. Each worker thread records which Func it's
+    // in separately, so the expensive one should get most of the time.
+    Func cheap("cheap"), expensive("expensive"), out("out");
+    Var x, y;
+
+    cheap(x, y) = cast<float>(x + y);
+    Expr e = cheap(x, y);
+    for (int j = 0; j < 200; j++) {
+        e = sin(e);
+    }
+    expensive(x, y) = e;
+    out(x, y) = expensive(x, y) + cheap(x, y) * 2.0f;
+
+    out.set_custom_print(&my_print);
+    out.parallel(y);
+    cheap.compute_at(out, y);
+    expensive.compute_at(out, y);
+
+    Target t = get_jit_target_from_environment().with_feature(Target::Profile);
+    Buffer<float> im = out.realize(1000, 1000, t);
+
+    printf("Time spent in expensive: %fms\n", ms);
+
+    if (percentage < 40) {
+        printf("Percentage of runtime spent in expensive: %d\n"
+               "This is suspiciously low. It should be more like 90%%\n",
+               percentage);
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
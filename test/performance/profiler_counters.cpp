@@ -0,0 +1,70 @@
+#include "Halide.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace Halide;
+
+bool saw_counters = false;
+float compute_ipc = -1, stream_ipc = -1;
+void my_print(void *, const char *msg) {
+    if (strstr(msg, " instructions: ")) {
+        saw_counters = true;
+    }
+    const char *ipc = strstr(msg, " ipc: ");
+    if (ipc) {
+        float val = 0;
+        sscanf(ipc, " ipc: %f", &val);
+        if (strstr(msg, " compute: ")) {
+            compute_ipc = val;
+        } else if (strstr(msg, " stream: ")) {
+            stream_ipc = val;
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    // The counters setting is read when the profiler first starts.
+    char env[] = "HL_PROFILER_COUNTERS=1";
+    putenv(env);
+    Internal::JITSharedRuntime::release_all();
+
+    // A compute-bound Func and a memory-bound one.
+    ImageParam in(Float(32), 1);
+    Func compute("compute"), stream("stream"), out("out");
+    Var x;
+    Expr e = cast<float>(x);
+    for (int i = 0; i < 100; i++) {
+        e = e * 1.0001f + 0.5f;
+    }
+    compute(x) = e;
+    stream(x) = in(x) + in((x * 4099) % 4000000);
+    out(x) = compute(x) + stream(x);
+    compute.compute_root().vectorize(x, 8);
+    stream.compute_root();
+
+    Buffer<float> input(4000000);
+    input.fill(1.0f);
+    in.set(input);
+
+    out.set_custom_print(&my_print);
+    Target t = get_jit_target_from_environment().with_feature(Target::Profile);
+    out.realize(4000000, t);
+
+    if (!saw_counters) {
+        // The platform or the sandbox we're running in doesn't let us
+        // read hardware counters.
+        printf("No hardware performance counters on this platform\n");
+        printf("Success!\n");
+        return 0;
+    }
+
+    printf("ipc of compute: %f, stream: %f\n", compute_ipc, stream_ipc);
+    if (compute_ipc <= 0 || stream_ipc <= 0) {
+        printf("Missing per-Func counters\n");
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
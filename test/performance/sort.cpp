@@ -172,6 +172,16 @@ int main(int argc, char **argv) {
         f.realize(merge_sorted);
     });
 
+    printf("Sorting::sort...\n");
+    f = Sorting::sort(input, N, 256);
+    f.compile_jit();
+    printf("Running...\n");
+    Buffer<int> library_sorted(N);
+    f.realize(library_sorted);
+    double t_library = benchmark([&]() {
+        f.realize(library_sorted);
+    });
+
     Buffer<int> correct(N);
     for (int i = 0; i < N; i++) {
         correct(i) = data(i);
@@ -184,13 +194,14 @@ int main(int argc, char **argv) {
     printf("Times:\n"
            "bitonic sort: %fms \n"
            "merge sort: %fms \n"
+           "Sorting::sort: %fms \n"
            "std::sort %fms\n",
-           t_bitonic * 1e3, t_merge * 1e3, t_std * 1e3);
+           t_bitonic * 1e3, t_merge * 1e3, t_library * 1e3, t_std * 1e3);
 
     if (N <= 100) {
         for (int i = 0; i < N; i++) {
-            printf("%8d %8d %8d\n",
-                   correct(i), bitonic_sorted(i), merge_sorted(i));
+            printf("%8d %8d %8d %8d\n",
+                   correct(i), bitonic_sorted(i), merge_sorted(i), library_sorted(i));
         }
     }
 
@@ -203,6 +214,103 @@ int main(int argc, char **argv) {
             printf("merge sort failed: %d -> %d instead of %d\n", i, merge_sorted(i), correct(i));
             return -1;
         }
+        if (library_sorted(i) != correct(i)) {
+            printf("Sorting::sort failed: %d -> %d instead of %d\n", i, library_sorted(i), correct(i));
+            return -1;
+        }
+    }
+
+    // Sorting::sort on something big and not a power of two, where
+    // the last merges are split across threads along the merge path.
+    {
+        const int big_N = (1 << 20) + 123;
+        Buffer<int> big_data(big_N);
+        for (int i = 0; i < big_N; i++) {
+            big_data(i) = rand() & 0xfffff;
+        }
+        Func big_input = lambda(x, big_data(x));
+        Func big_sort = Sorting::sort(big_input, big_N);
+        big_sort.compile_jit();
+        Buffer<int> big_sorted(big_N);
+        big_sort.realize(big_sorted);
+        double t_big = benchmark([&]() {
+            big_sort.realize(big_sorted);
+        });
+
+        std::vector<int> big_correct(big_data.data(), big_data.data() + big_N);
+        double t_big_std = benchmark(1, 1, [&]() {
+            std::sort(big_correct.begin(), big_correct.end());
+        });
+
+        printf("Sorting %d values:\n"
+               "Sorting::sort: %fms\n"
+               "std::sort: %fms\n",
+               big_N, t_big * 1e3, t_big_std * 1e3);
+
+        for (int i = 0; i < big_N; i++) {
+            if (big_sorted(i) != big_correct[i]) {
+                printf("Sorting::sort failed: %d -> %d instead of %d\n", i, big_sorted(i), big_correct[i]);
+                return -1;
+            }
+        }
+    }
+
+    // A 3x3 median filter using a selection network, against
+    // std::nth_element.
+    {
+        const int W = 1024, H = 1024;
+        Buffer<uint8_t> im(W + 2, H + 2);
+        for (int j = 0; j < H + 2; j++) {
+            for (int i = 0; i < W + 2; i++) {
+                im(i, j) = rand() & 0xff;
+            }
+        }
+
+        std::vector<Expr> window;
+        for (int dy = 0; dy < 3; dy++) {
+            for (int dx = 0; dx < 3; dx++) {
+                window.push_back(im(x + dx, y + dy));
+            }
+        }
+        Func median_filter;
+        median_filter(x, y) = Sorting::median(window);
+        median_filter.vectorize(x, 32).parallel(y);
+        median_filter.compile_jit();
+
+        Buffer<uint8_t> median_out(W, H);
+        median_filter.realize(median_out);
+        double t_median = benchmark([&]() {
+            median_filter.realize(median_out);
+        });
+
+        Buffer<uint8_t> median_correct(W, H);
+        double t_median_std = benchmark(1, 1, [&]() {
+            uint8_t v[9];
+            for (int j = 0; j < H; j++) {
+                for (int i = 0; i < W; i++) {
+                    for (int k = 0; k < 9; k++) {
+                        v[k] = im(i + k % 3, j + k / 3);
+                    }
+                    std::nth_element(v, v + 4, v + 9);
+                    median_correct(i, j) = v[4];
+                }
+            }
+        });
+
+        printf("3x3 median filter:\n"
+               "Sorting::median: %fms\n"
+               "std::nth_element: %fms\n",
+               t_median * 1e3, t_median_std * 1e3);
+
+        for (int j = 0; j < H; j++) {
+            for (int i = 0; i < W; i++) {
+                if (median_out(i, j) != median_correct(i, j)) {
+                    printf("Sorting::median failed at %d, %d: %d instead of %d\n",
+                           i, j, median_out(i, j), median_correct(i, j));
+                    return -1;
+                }
+            }
+        }
     }
 
     return 0;
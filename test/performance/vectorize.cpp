@@ -1,4 +1,5 @@
 #include "Halide.h"
+#include <algorithm>
 #include <cstdio>
 #include "halide_benchmark.h"
 
@@ -90,6 +91,67 @@ bool test(int vec_width) {
     return true;
 }
 
+// A Func that reads uint8 and accumulates in int32. Vectorizing it at
+// the natural vector size of either type alone is a poor fit, so let
+// the compiler choose.
+bool test_mixed_types() {
+    const int W = 1024, H = 2000;
+
+    Buffer<uint8_t> input(W, H + 8);
+    for (int y = 0; y < H + 8; y++) {
+        for (int x = 0; x < W; x++) {
+            input(x, y) = (uint8_t)rand();
+        }
+    }
+
+    Target target = get_jit_target_from_environment();
+    double times[3];
+    Buffer<uint8_t> outputs[3];
+    for (int i = 0; i < 3; i++) {
+        Var x, y;
+        Func f;
+        Expr sum = 0;
+        for (int j = 0; j < 8; j++) {
+            sum += cast<int32_t>(input(x, y + j)) * (j + 1);
+        }
+        f(x, y) = cast<uint8_t>(sum >> 6);
+
+        if (i == 0) {
+            f.vectorize(x, target.natural_vector_size<int32_t>());
+        } else if (i == 1) {
+            f.vectorize(x, target.natural_vector_size<uint8_t>());
+        } else {
+            f.vectorize(x, VectorWidth::Auto);
+        }
+
+        outputs[i] = f.realize(W, H);
+        times[i] = benchmark([&]() {
+            f.realize(outputs[i]);
+        });
+    }
+
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            if (outputs[2](x, y) != outputs[0](x, y) ||
+                outputs[2](x, y) != outputs[1](x, y)) {
+                printf("Mixed types failed at %d %d: %d %d %d\n", x, y,
+                       outputs[0](x, y), outputs[1](x, y), outputs[2](x, y));
+                return false;
+            }
+        }
+    }
+
+    printf("Vector width of int32 vs uint8 vs auto: %1.3gms %1.3gms %1.3gms\n",
+           times[0] * 1e3, times[1] * 1e3, times[2] * 1e3);
+
+    // Allow for some noise in the timings.
+    if (times[2] > 1.1 * std::min(times[0], times[1])) {
+        return false;
+    }
+
+    return true;
+}
+
 int main(int argc, char **argv) {
 
     bool ok = true;
@@ -104,6 +166,7 @@ int main(int argc, char **argv) {
     ok = ok && test<int16_t>(8);
     ok = ok && test<uint32_t>(4);
     ok = ok && test<int32_t>(4);
+    ok = ok && test_mixed_types();
 
     if (!ok) return -1;
     printf("Success!\n");
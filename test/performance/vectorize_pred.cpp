@@ -12,6 +12,7 @@ const char *string_of_type();
     template<>                                                  \
     const char *string_of_type<name>() {return #name;}
 
+DECL_SOT(uint16_t);
 DECL_SOT(float);
 
 template<typename A>
@@ -82,12 +83,77 @@ bool test(int vec_width) {
     return true;
 }
 
+// Compare handling the tail of a vectorized loop with predicated
+// loads and stores against scalarizing it, on an image only a little
+// wider than the vector.
+template<typename A>
+bool test_tail(int vec_width) {
+    int W = vec_width + vec_width/4;
+    int H = 50000;
+
+    Buffer<A> input(W, H+5);
+    for (int y = 0; y < H+5; y++) {
+        for (int x = 0; x < W; x++) {
+            input(x, y) = (A)(rand() & 0xff);
+        }
+    }
+
+    Var x, y;
+    Func f, g;
+
+    Expr e = input(x, y);
+    for (int i = 1; i < 5; i++) {
+        e = e + input(x, y+i);
+    }
+
+    f(x, y) = e;
+    g(x, y) = e;
+    f.vectorize(x, vec_width, TailStrategy::Predicate);
+    g.vectorize(x, vec_width, TailStrategy::GuardWithIf);
+
+    Buffer<A> outputg = g.realize(W, H);
+    Buffer<A> outputf = f.realize(W, H);
+
+    double t_g = benchmark([&]() {
+        g.realize(outputg);
+    });
+    double t_f = benchmark([&]() {
+        f.realize(outputf);
+    });
+
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            if (outputf(x, y) != outputg(x, y)) {
+                printf("Predicated tail %s x %d failed at %d %d: %d vs %d\n",
+                       string_of_type<A>(), vec_width,
+                       x, y,
+                       (int)outputf(x, y),
+                       (int)outputg(x, y)
+                    );
+                return false;
+            }
+        }
+    }
+
+    printf("Predicated vs guarded tail (%s x %d, width %d): %1.3gms %1.3gms. Speedup = %1.3f\n",
+           string_of_type<A>(), vec_width, W, t_f * 1e3, t_g * 1e3, t_g / t_f);
+
+    if (t_f > t_g) {
+        return false;
+    }
+
+    return true;
+}
+
 int main(int argc, char **argv) {
     // As for now, we would only vectorize predicated store/load on Hexagon or
     // if it is of type 32-bit value and has lanes no less than 4 on x86
     test<float>(4);
     test<float>(8);
 
+    // TailStrategy::Predicate predicates on any target and type.
+    if (!test_tail<uint16_t>(16)) return -1;
+
     printf("Success!\n");
     return 0;
 }
@@ -3,15 +3,19 @@
 #include "halide_benchmark.h"
 #include "halide_image_io.h"
 
+#include <algorithm>
 #include <cstdio>
 #include <cstdlib>
+#include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <map>
 #include <mutex>
+#include <random>
 #include <set>
 #include <sstream>
 #include <string>
+#include <type_traits>
 #include <vector>
 
 extern "C" int halide_rungen_redirect_argv(void **args);
@@ -26,6 +30,8 @@ namespace {
 using Halide::Runtime::Buffer;
 using Halide::Tools::FormatInfo;
 using Halide::Tools::BenchmarkConfig;
+using Halide::Tools::BenchmarkResult;
+using Halide::Tools::BenchmarkStatistics;
 
 bool verbose = false;
 bool quiet = false;
@@ -632,27 +638,139 @@ Buffer<> load_input_from_file(const std::string &pathname,
     return b;
 }
 
-Buffer<> load_input(const std::string &pathname,
-                    const halide_filter_argument_t &metadata) {
-    std::vector<std::string> v = split_string(pathname, ":");
-    if (v.size() != 2 || v[0].size() == 1) {
-        return load_input_from_file(pathname, metadata);
+// Functor to fill a buffer with synthetic data for a pseudo-file input.
+template<typename T>
+struct FillBuffer {
+    void operator()(const std::string &kind, const std::string &value, Buffer<> &buf) {
+        Buffer<T> &b = buf.as<T>();
+        if (kind == "zero") {
+            memset(b.data(), 0, b.size_in_bytes());
+        } else if (kind == "constant") {
+            halide_scalar_value_t v;
+            if (!parse_scalar(buf.type(), value, &v)) {
+                fail() << "Invalid value for constant input: " << value;
+            }
+            b.fill(*(T *)&v);
+        } else if (kind == "random") {
+            uint32_t seed;
+            if (!parse_scalar(value, &seed)) {
+                fail() << "Invalid seed for random input: " << value;
+            }
+            std::mt19937_64 rng(seed);
+            b.for_each_value([&](T &v) { v = random_value(rng); });
+        } else if (kind == "gradient") {
+            // The sum of the coordinates; for floating-point types, scaled
+            // so that the far corner of the buffer is 1.
+            int64_t range = 0;
+            for (int i = 0; i < b.dimensions(); i++) {
+                range += std::max(1, b.dim(i).extent() - 1);
+            }
+            b.for_each_element([&](const int *pos) {
+                int64_t sum = 0;
+                for (int i = 0; i < b.dimensions(); i++) {
+                    sum += pos[i] - b.dim(i).min();
+                }
+                b(pos) = gradient_value(sum, range);
+            });
+        } else {
+            fail() << "Unknown input kind: " << kind;
+        }
     }
 
-    // Assume it's a special std::string of the form key:values
-    if (v[0] == "zero") {
-        auto shape = parse_extents(v[1]);
-        Buffer<> b = allocate_buffer(metadata.type, shape);
-        memset(b.data(), 0, b.size_in_bytes());
-        return b;
+private:
+    template<typename T2 = T, typename std::enable_if<std::is_floating_point<T2>::value>::type * = nullptr>
+    static T random_value(std::mt19937_64 &rng) {
+        // Uniform in [0, 1)
+        return (T) std::uniform_real_distribution<double>(0.0, 1.0)(rng);
     }
 
-    // TODO: add random options.
-    // TODO: add granger-rainbow.
-    // TODO: add gradients.
+    template<typename T2 = T, typename std::enable_if<!std::is_floating_point<T2>::value>::type * = nullptr>
+    static T random_value(std::mt19937_64 &rng) {
+        // Uniform over all values of the type.
+        uint64_t r = rng();
+        return std::is_same<T, bool>::value ? (T) (r & 1) : (T) r;
+    }
+
+    template<typename T2 = T, typename std::enable_if<std::is_floating_point<T2>::value>::type * = nullptr>
+    static T gradient_value(int64_t sum, int64_t range) {
+        return (T) ((double) sum / range);
+    }
+
+    template<typename T2 = T, typename std::enable_if<!std::is_floating_point<T2>::value>::type * = nullptr>
+    static T gradient_value(int64_t sum, int64_t range) {
+        // Wraps around for small integer types.
+        return (T) sum;
+    }
+};
+
+// Handles can't usefully be synthesized.
+template<>
+void FillBuffer<void*>::operator()(const std::string &kind, const std::string &value, Buffer<> &buf) {
+    fail() << "Can't synthesize input data of type " << buf.type();
+}
+
+void fill_buffer(const std::string &kind, const std::string &value, Buffer<> &buf) {
+    dynamic_type_dispatch<FillBuffer>(buf.type(), kind, value, buf);
+}
+
+// A pseudo-file input specifier: the kind of data to synthesize, an
+// optional value (the constant, or the random seed), and the extents,
+// which are empty if they are to be inferred by a bounds query.
+struct PseudoFile {
+    std::string kind, value;
+    Shape shape;
+    bool infer_shape{false};
+};
 
-    fail() << "Unknown input: " << pathname;
-    return Buffer<>();
+bool parse_pseudo_file(const std::string &pathname, PseudoFile *result) {
+    std::vector<std::string> v = split_string(pathname, ":");
+    if (v.size() < 2 || v[0].size() == 1) {
+        // Not a pseudo file (perhaps a Windows path, e.g. C:\foo.png)
+        return false;
+    }
+    const std::string &kind = v[0];
+    if (kind == "zero" || kind == "gradient") {
+        if (v.size() != 2) {
+            fail() << "Invalid input: " << pathname;
+        }
+    } else if (kind == "constant" || kind == "random") {
+        if (v.size() != 3) {
+            fail() << "Invalid input: " << pathname;
+        }
+        result->value = v[1];
+    } else {
+        return false;
+    }
+    result->kind = kind;
+    if (v.back() == "auto") {
+        result->infer_shape = true;
+    } else {
+        result->shape = parse_extents(v.back());
+    }
+    return true;
+}
+
+// Load an input, or synthesize it if the pathname is a pseudo-file.
+// If the shape of a pseudo-file is to be inferred, the returned
+// Buffer is unallocated and has all-zero extents, and *infer_shape
+// is set; the caller should use it in a bounds query, then allocate
+// it with the resulting shape and call fill_buffer on it.
+Buffer<> load_input(const std::string &pathname,
+                    const halide_filter_argument_t &metadata,
+                    PseudoFile *pseudo_file) {
+    if (!parse_pseudo_file(pathname, pseudo_file)) {
+        return load_input_from_file(pathname, metadata);
+    }
+    if (pseudo_file->infer_shape) {
+        return make_with_shape(metadata.type, Shape(metadata.dimensions, halide_dimension_t{0, 0, 0}));
+    }
+    if ((int) pseudo_file->shape.size() != metadata.dimensions) {
+        fail() << "Input " << metadata.name << " requires " << metadata.dimensions
+               << " dimensions, but " << pathname << " has " << pseudo_file->shape.size();
+    }
+    Buffer<> b = allocate_buffer(metadata.type, pseudo_file->shape);
+    fill_buffer(pseudo_file->kind, pseudo_file->value, b);
+    return b;
 }
 
 struct ArgData {
@@ -661,6 +779,7 @@ struct ArgData {
     std::string raw_string;
     halide_scalar_value_t scalar_value;
     Buffer<> buffer_value;
+    PseudoFile pseudo_file;
 };
 
 // Run a bounds-query call with the given args, and return the shapes
@@ -762,8 +881,30 @@ Arguments:
         set to zero of the appropriate type. (This is useful for benchmarking
         filters that don't have performance variances with different data.)
 
-        (We anticipate adding other pseudo-file inputs in the future, e.g.
-        various random distributions, gradients, rainbows, etc.)
+        constant:VALUE:[NUM,NUM,...]
+
+        As above, but with all elements set to VALUE.
+
+        random:SEED:[NUM,NUM,...]
+
+        As above, but with all elements set to pseudorandom values generated
+        from the given integer SEED: uniform in [0, 1) for floating-point
+        types, and uniform over all values for integer types.
+
+        gradient:[NUM,NUM,...]
+
+        As above, but with each element set to the sum of its coordinates
+        (wrapping around for small integer types); for floating-point
+        types, this is scaled to be 1 at the far corner of the image.
+
+        For any of these, the extents may be given as 'auto' instead, e.g.
+
+            some_input_buffer=random:42:auto
+
+        in which case the input is sized (by a bounds query) to exactly the
+        region required to produce outputs of the size given by
+        --output_extents. This makes it possible to benchmark any Generator
+        at any output size without knowing how large its inputs must be.
 
 Flags:
 
@@ -789,10 +930,28 @@ Flags:
         Don't log calls to halide_print() to stdout.
 
     --benchmarks=all:
+    --benchmark:
         Run the filter with the given arguments many times to
-        produce an estimate of average execution time; this currently
-        runs "samples" sets of "iterations" each, and chooses the fastest
-        sample set.
+        produce an estimate of average execution time. The filter is
+        first run --benchmark_warmup times, then the number of
+        iterations per sample is calibrated so that a sample takes a
+        measurable amount of time, and the fastest sample is reported.
+        Finally, --benchmark_samples more samples are taken and their
+        median, 95th and 99th percentile times are reported.
+
+    --benchmark_warmup=NUM [default = 1]:
+        Run the filter this many times before taking any measurements;
+        ignored if --benchmarks is not also specified.
+
+    --benchmark_samples=NUM [default = 20]:
+        The number of samples to take for the median and percentile
+        statistics. Zero skips them. Ignored if --benchmarks is not
+        also specified.
+
+    --benchmark_json=PATH:
+        Also write the benchmark results to PATH as a JSON object
+        (or to stdout if PATH is '-'); ignored if --benchmarks is not
+        also specified.
 
     --benchmark_min_time=DURATION_SECONDS [default = 0.1]:
         Override the default minimum desired benchmarking time; ignored if
@@ -806,6 +965,10 @@ Flags:
         Override the default maximum number of benchmarking iterations; ignored
         if --benchmarks is not also specified.
 
+    --num_threads=NUM:
+        Run the filter with this many threads in the Halide thread pool,
+        instead of the default (the number of cores, or HL_NUM_THREADS).
+
     --track_memory:
         Override Halide memory allocator to track high-water mark of memory
         allocation during run; note that this may slow down execution, so
@@ -823,6 +986,50 @@ Known Issues:
     std::cout << replace_all(usage, "$NAME$", basename);
 }
 
+// Write a string as a JSON string literal.
+std::string json_string(const std::string &s) {
+    std::ostringstream o;
+    o << '"';
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            o << '\\' << c;
+        } else if ((unsigned char)c < 0x20) {
+            o << "\\u" << std::hex << std::setw(4) << std::setfill('0') << (int)c << std::dec;
+        } else {
+            o << c;
+        }
+    }
+    o << '"';
+    return o.str();
+}
+
+void write_benchmark_json(std::ostream &o, const halide_filter_metadata_t *md,
+                          int num_threads, double megapixels,
+                          const BenchmarkResult &best, const BenchmarkStatistics *stats) {
+    o << std::setprecision(9);
+    o << "{\n"
+      << "  \"name\": " << json_string(md->name) << ",\n"
+      << "  \"target\": " << json_string(md->target) << ",\n"
+      << "  \"num_threads\": " << num_threads << ",\n"
+      << "  \"megapixels_out\": " << megapixels << ",\n"
+      << "  \"best_time\": " << best.wall_time << ",\n"
+      << "  \"best_samples\": " << best.samples << ",\n"
+      << "  \"best_iterations\": " << best.iterations << ",\n"
+      << "  \"best_accuracy\": " << best.accuracy;
+    if (stats) {
+        o << ",\n"
+          << "  \"samples\": " << stats->samples << ",\n"
+          << "  \"iterations_per_sample\": " << stats->iterations_per_sample << ",\n"
+          << "  \"min_time\": " << stats->min << ",\n"
+          << "  \"median_time\": " << stats->median << ",\n"
+          << "  \"mean_time\": " << stats->mean << ",\n"
+          << "  \"p95_time\": " << stats->p95 << ",\n"
+          << "  \"p99_time\": " << stats->p99 << ",\n"
+          << "  \"max_time\": " << stats->max;
+    }
+    o << "\n}\n";
+}
+
 void do_describe(const halide_filter_metadata_t *md) {
     std::cout << "Filter name: \"" << md->name << "\"\n";
     for (size_t i = 0; i < (size_t) md->num_arguments; ++i) {
@@ -903,6 +1110,10 @@ int main(int argc, char **argv) {
     double benchmark_min_time = BenchmarkConfig().min_time;
     int benchmark_min_iters = BenchmarkConfig().min_iters;
     int benchmark_max_iters = BenchmarkConfig().max_iters;
+    int benchmark_warmup = 1;
+    int benchmark_samples = 20;
+    std::string benchmark_json;
+    int num_threads = 0;
     for (int i = 1; i < argc; ++i) {
         if (argv[i][0] == '-') {
             const char *p = argv[i] + 1; // skip -
@@ -948,6 +1159,30 @@ int main(int argc, char **argv) {
                     fail() << "The only valid value for --benchmarks is 'all'";
                 }
                 benchmark = true;
+            } else if (flag_name == "benchmark") {
+                if (flag_value.empty()) {
+                    flag_value = "true";
+                }
+                if (!parse_scalar(flag_value, &benchmark)) {
+                    fail() << "Invalid value for flag: " << flag_name;
+                }
+            } else if (flag_name == "benchmark_warmup") {
+                if (!parse_scalar(flag_value, &benchmark_warmup) || benchmark_warmup < 0) {
+                    fail() << "Invalid value for flag: " << flag_name;
+                }
+            } else if (flag_name == "benchmark_samples") {
+                if (!parse_scalar(flag_value, &benchmark_samples) || benchmark_samples < 0) {
+                    fail() << "Invalid value for flag: " << flag_name;
+                }
+            } else if (flag_name == "benchmark_json") {
+                if (flag_value.empty()) {
+                    fail() << "Invalid value for flag: " << flag_name;
+                }
+                benchmark_json = flag_value;
+            } else if (flag_name == "num_threads") {
+                if (!parse_scalar(flag_value, &num_threads) || num_threads <= 0) {
+                    fail() << "Invalid value for flag: " << flag_name;
+                }
             } else if (flag_name == "benchmark_min_time") {
                 if (!parse_scalar(flag_value, &benchmark_min_time)) {
                     fail() << "Invalid value for flag: " << flag_name;
@@ -999,6 +1234,10 @@ int main(int argc, char **argv) {
         return 0;
     }
 
+    if (num_threads > 0) {
+        halide_set_num_threads(num_threads);
+    }
+
     // It's OK to omit output arguments when we are benchmarking or tracking memory.
     bool ok_to_omit_outputs = (benchmark || track_memory);
 
@@ -1041,7 +1280,11 @@ int main(int argc, char **argv) {
             break;
         }
         case halide_argument_kind_input_buffer: {
-            arg.buffer_value = load_input(arg.raw_string, *arg.metadata);
+            arg.buffer_value = load_input(arg.raw_string, *arg.metadata, &arg.pseudo_file);
+            if (arg.pseudo_file.infer_shape) {
+                info() << "Input " << arg_name << ": Shape will be inferred";
+                break;
+            }
             info() << "Input " << arg_name << ": Shape is " << get_shape(arg.buffer_value);
             // If there was no default_output_shape specified, use the shape of
             // the first input buffer (if any).
@@ -1067,6 +1310,14 @@ int main(int argc, char **argv) {
         const Shape &constrained_shape = constrained_shapes[arg.index];
         switch (arg.metadata->kind) {
             case halide_argument_kind_input_buffer: {
+                if (arg.pseudo_file.infer_shape) {
+                    // Allocate exactly the region the bounds query asked for.
+                    info() << "Input " << arg_name << ": BoundsQuery result is " << constrained_shape;
+                    arg.buffer_value = allocate_buffer(arg.metadata->type, make_legal_output_buffer_shape(constrained_shape));
+                    fill_buffer(arg.pseudo_file.kind, arg.pseudo_file.value, arg.buffer_value);
+                    info() << "Input " << arg_name << ": Shape is " << get_shape(arg.buffer_value);
+                    break;
+                }
                 info() << "Input " << arg_name << ": Shape is " << get_shape(arg.buffer_value);
                 bool updated = adapt_input_buffer_layout(constrained_shape, &arg.buffer_value);
                 info() << "Input " << arg_name << ": BoundsQuery result is " << constrained_shape;
@@ -1125,6 +1376,10 @@ int main(int argc, char **argv) {
 
             info() << "Benchmarking filter...";
 
+            for (int i = 0; i < benchmark_warmup; i++) {
+                benchmark_inner();
+            }
+
             BenchmarkConfig config;
             config.min_time = benchmark_min_time;
             config.max_time = benchmark_min_time * 4;
@@ -1138,6 +1393,32 @@ int main(int argc, char **argv) {
                 << "accuracy " << std::setprecision(2) << (result.accuracy * 100.0) << "%).\n";
             std::cout << "Best output throughput is " << (megapixels / result.wall_time) << " mpix/sec.\n";
 
+            BenchmarkStatistics stats;
+            if (benchmark_samples > 0) {
+                // Use the iteration count the calibration above settled on.
+                uint64_t iters_per_sample = result.iterations / std::max((uint64_t)1, result.samples);
+                stats = Halide::Tools::benchmark_statistics(benchmark_inner, iters_per_sample,
+                                                            benchmark_samples);
+                std::cout << "Over " << stats.samples << " samples of " << stats.iterations_per_sample
+                    << " iterations: median " << stats.median << " sec/iter, "
+                    << "p95 " << stats.p95 << " sec/iter, "
+                    << "p99 " << stats.p99 << " sec/iter.\n";
+            }
+
+            if (!benchmark_json.empty()) {
+                const int threads = num_threads > 0 ? num_threads : halide_set_num_threads(0);
+                const BenchmarkStatistics *s = benchmark_samples > 0 ? &stats : nullptr;
+                if (benchmark_json == "-") {
+                    write_benchmark_json(std::cout, md, threads, megapixels, result, s);
+                } else {
+                    std::ofstream f(benchmark_json);
+                    write_benchmark_json(f, md, threads, megapixels, result, s);
+                    if (!f.good()) {
+                        fail() << "Unable to write benchmark results to: " << benchmark_json;
+                    }
+                }
+            }
+
         } else {
             info() << "Running filter...";
             // Ignore result since our halide_error() should catch everything.
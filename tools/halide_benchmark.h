@@ -6,6 +6,7 @@
 #include <chrono>
 #include <functional>
 #include <limits>
+#include <vector>
 
 namespace Halide {
 namespace Tools {
@@ -177,6 +178,61 @@ inline BenchmarkResult benchmark(std::function<void()> op, const BenchmarkConfig
     return result;
 }
 
+struct BenchmarkStatistics {
+    // Time per iteration (seconds) of the fastest, median, and
+    // slowest samples, and of the samples at the 95th and 99th
+    // percentiles.
+    double min, median, p95, p99, max;
+
+    // Mean time per iteration over all samples (seconds).
+    double mean;
+
+    // Number of samples taken, and the number of iterations run for
+    // each sample.
+    uint64_t samples;
+    uint64_t iterations_per_sample;
+};
+
+// Run the operation 'op' for the given number of samples of
+// iterations_per_sample iterations each, and report the distribution
+// of the times per iteration. Unlike benchmark() above, which
+// reports the best time, this is intended for tracking the typical
+// and worst-case runtime of an operation. Use benchmark() first to
+// find a reasonable iterations_per_sample, and call 'op' a few times
+// beforehand to warm up caches and thread pools.
+inline BenchmarkStatistics benchmark_statistics(std::function<void()> op,
+                                                uint64_t iterations_per_sample,
+                                                uint64_t samples) {
+    iterations_per_sample = std::max((uint64_t)1, iterations_per_sample);
+    samples = std::max((uint64_t)1, samples);
+
+    std::vector<double> times(samples);
+    double total = 0;
+    for (uint64_t i = 0; i < samples; i++) {
+        times[i] = benchmark(1, (int)iterations_per_sample, op);
+        total += times[i];
+    }
+    std::sort(times.begin(), times.end());
+
+    // Nearest-rank percentiles.
+    const auto percentile = [&](double p) {
+        size_t rank = (size_t)(p * samples + 0.999999);
+        rank = std::min(std::max(rank, (size_t)1), (size_t)samples);
+        return times[rank - 1];
+    };
+
+    BenchmarkStatistics result;
+    result.min = times.front();
+    result.median = percentile(0.5);
+    result.p95 = percentile(0.95);
+    result.p99 = percentile(0.99);
+    result.max = times.back();
+    result.mean = total / samples;
+    result.samples = samples;
+    result.iterations_per_sample = iterations_per_sample;
+    return result;
+}
+
 }   // namespace Tools
 }   // mamespace Halide
 
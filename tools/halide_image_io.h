@@ -14,6 +14,14 @@
 #include <string>
 #include <vector>
 #include <cctype>
+#include <cstring>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 #ifndef HALIDE_NO_PNG
 #include "png.h"
@@ -324,27 +332,99 @@ struct FileOpener {
     FILE * const f;
 };
 
+// Convert between a row of big-endian, channel-interleaved ElemTypes in
+// a byte buffer and a row of an image with the given strides. These
+// are the inner loops of loading and saving most formats, so the
+// layouts of images loaded and saved most often (planar, or
+// interleaved like the file) get loops simple enough for the compiler
+// to vectorize, specialized for common channel counts.
+template<typename ElemType, int kChannels>
+void read_big_endian_row_strided(const uint8_t *src, ElemType *dst, int width, int channels,
+                                 ptrdiff_t x_stride, ptrdiff_t c_stride) {
+    const int c_count = kChannels ? kChannels : channels;
+    const int src_x_stride = c_count * sizeof(ElemType);
+    if (x_stride == 1) {
+        // Planar
+        for (int c = 0; c < c_count; c++) {
+            ElemType *d = dst + c * c_stride;
+            const uint8_t *s = src + c * sizeof(ElemType);
+            for (int x = 0; x < width; x++) {
+                d[x] = read_big_endian<ElemType>(s + x * src_x_stride);
+            }
+        }
+    } else if (x_stride == c_count && (c_stride == 1 || c_count == 1)) {
+        // Interleaved
+        for (int i = 0; i < width * c_count; i++) {
+            dst[i] = read_big_endian<ElemType>(src + i * sizeof(ElemType));
+        }
+    } else {
+        for (int x = 0; x < width; x++) {
+            for (int c = 0; c < c_count; c++) {
+                dst[x * x_stride + c * c_stride] = read_big_endian<ElemType>(src);
+                src += sizeof(ElemType);
+            }
+        }
+    }
+}
+
+template<typename ElemType, int kChannels>
+void write_big_endian_row_strided(const ElemType *src, uint8_t *dst, int width, int channels,
+                                  ptrdiff_t x_stride, ptrdiff_t c_stride) {
+    const int c_count = kChannels ? kChannels : channels;
+    const int dst_x_stride = c_count * sizeof(ElemType);
+    if (x_stride == 1) {
+        // Planar
+        for (int c = 0; c < c_count; c++) {
+            const ElemType *s = src + c * c_stride;
+            uint8_t *d = dst + c * sizeof(ElemType);
+            for (int x = 0; x < width; x++) {
+                write_big_endian<ElemType>(s[x], d + x * dst_x_stride);
+            }
+        }
+    } else if (x_stride == c_count && (c_stride == 1 || c_count == 1)) {
+        // Interleaved
+        for (int i = 0; i < width * c_count; i++) {
+            write_big_endian<ElemType>(src[i], dst + i * sizeof(ElemType));
+        }
+    } else {
+        for (int x = 0; x < width; x++) {
+            for (int c = 0; c < c_count; c++) {
+                write_big_endian<ElemType>(src[x * x_stride + c * c_stride], dst);
+                dst += sizeof(ElemType);
+            }
+        }
+    }
+}
+
 // Read a row of ElemTypes from a byte buffer and copy them into a specific image row.
 // Multibyte elements are assumed to be big-endian.
 template<typename ElemType, typename ImageType>
 void read_big_endian_row(const uint8_t *src, int y, ImageType *im) {
-    auto im_typed = im->template as<ElemType>();
-    const int xmin = im_typed.dim(0).min();
-    const int xmax = im_typed.dim(0).max();
+    auto &im_typed = im->template as<ElemType>();
+    const int width = im_typed.dim(0).extent();
+    const ptrdiff_t x_stride = im_typed.dim(0).stride();
+    int channels = 1;
+    ptrdiff_t c_stride = 0;
+    ElemType *dst;
     if (im_typed.dimensions() > 2) {
-        const int cmin = im_typed.dim(2).min();
-        const int cmax = im_typed.dim(2).max();
-        for (int x = xmin; x <= xmax; x++) {
-            for (int c = cmin; c <= cmax; c++) {
-                im_typed(x, y, c+cmin) = read_big_endian<ElemType>(src);
-                src += sizeof(ElemType);
-            }
-        }
+        channels = im_typed.dim(2).extent();
+        c_stride = im_typed.dim(2).stride();
+        dst = &im_typed(im_typed.dim(0).min(), y, im_typed.dim(2).min());
     } else {
-        for (int x = xmin; x <= xmax; x++) {
-            im_typed(x, y) = read_big_endian<ElemType>(src);
-            src += sizeof(ElemType);
-        }
+        dst = &im_typed(im_typed.dim(0).min(), y);
+    }
+    switch (channels) {
+    case 1:
+        read_big_endian_row_strided<ElemType, 1>(src, dst, width, channels, x_stride, c_stride);
+        break;
+    case 3:
+        read_big_endian_row_strided<ElemType, 3>(src, dst, width, channels, x_stride, c_stride);
+        break;
+    case 4:
+        read_big_endian_row_strided<ElemType, 4>(src, dst, width, channels, x_stride, c_stride);
+        break;
+    default:
+        read_big_endian_row_strided<ElemType, 0>(src, dst, width, channels, x_stride, c_stride);
     }
 }
 
@@ -352,23 +432,31 @@ void read_big_endian_row(const uint8_t *src, int y, ImageType *im) {
 // Multibyte elements are written in big-endian layout.
 template<typename ElemType, typename ImageType>
 void write_big_endian_row(const ImageType &im, int y, uint8_t *dst) {
-    auto im_typed = im.template as<ElemType>();
-    const int xmin = im_typed.dim(0).min();
-    const int xmax = im_typed.dim(0).max();
+    const auto &im_typed = im.template as<ElemType>();
+    const int width = im_typed.dim(0).extent();
+    const ptrdiff_t x_stride = im_typed.dim(0).stride();
+    int channels = 1;
+    ptrdiff_t c_stride = 0;
+    const ElemType *src;
     if (im_typed.dimensions() > 2) {
-        const int cmin = im_typed.dim(2).min();
-        const int cmax = im_typed.dim(2).max();
-        for (int x = xmin; x <= xmax; x++) {
-            for (int c = cmin; c <= cmax; c++) {
-                write_big_endian<ElemType>(im_typed(x, y, c), dst);
-                dst += sizeof(ElemType);
-            }
-        }
+        channels = im_typed.dim(2).extent();
+        c_stride = im_typed.dim(2).stride();
+        src = &im_typed(im_typed.dim(0).min(), y, im_typed.dim(2).min());
     } else {
-        for (int x = xmin; x <= xmax; x++) {
-            write_big_endian<ElemType>(im_typed(x, y), dst);
-            dst += sizeof(ElemType);
-        }
+        src = &im_typed(im_typed.dim(0).min(), y);
+    }
+    switch (channels) {
+    case 1:
+        write_big_endian_row_strided<ElemType, 1>(src, dst, width, channels, x_stride, c_stride);
+        break;
+    case 3:
+        write_big_endian_row_strided<ElemType, 3>(src, dst, width, channels, x_stride, c_stride);
+        break;
+    case 4:
+        write_big_endian_row_strided<ElemType, 4>(src, dst, width, channels, x_stride, c_stride);
+        break;
+    default:
+        write_big_endian_row_strided<ElemType, 0>(src, dst, width, channels, x_stride, c_stride);
     }
 }
 
@@ -1300,6 +1388,133 @@ bool save_mat(ImageType &im, const std::string &filename) {
     return true;
 }
 
+// Parse the header of a .tmp file held in memory, returning the
+// offset, type and shape of the payload.
+template<CheckFunc check = CheckReturn>
+bool parse_tmp_header(const uint8_t *data, size_t size, size_t *offset,
+                      halide_type_t *type, std::vector<halide_dimension_t> *shape) {
+    int32_t header[5];
+    if (!check(size >= sizeof(header), "Count not read .tmp header")) {
+        return false;
+    }
+    memcpy(header, data, sizeof(header));
+    if (!check(header[0] > 0 && header[1] > 0 && header[2] > 0 && header[3] > 0 &&
+               header[4] >= 0 && header[4] < kNumTmpCodes, "Bad header on .tmp file")) {
+        return false;
+    }
+    *offset = sizeof(header);
+    *type = tmp_code_to_halide_type()[header[4]];
+    shape->clear();
+    int stride = 1;
+    for (int i = 0; i < 4; i++) {
+        shape->push_back({0, header[i], stride});
+        stride *= header[i];
+    }
+    return true;
+}
+
+// ".npy" is the numpy array format documented here:
+// https://docs.scipy.org/doc/numpy/neps/npy-format.html
+// Parse the header of one held in memory, returning the offset, type
+// and shape of the payload. Only little-endian data is supported.
+template<CheckFunc check = CheckReturn>
+bool parse_npy_header(const uint8_t *data, size_t size, size_t *offset,
+                      halide_type_t *type, std::vector<halide_dimension_t> *shape) {
+    if (!check(size >= 10 && memcmp(data, "\x93NUMPY", 6) == 0, "File is not recognized as a .npy file")) {
+        return false;
+    }
+    const int major_version = data[6];
+    size_t header_start, header_len;
+    if (major_version == 1) {
+        header_start = 10;
+        header_len = data[8] | (data[9] << 8);
+    } else {
+        if (!check(size >= 12, "Could not read .npy header")) {
+            return false;
+        }
+        header_start = 12;
+        header_len = data[8] | (data[9] << 8) | (data[10] << 16) | ((size_t) data[11] << 24);
+    }
+    if (!check(header_start + header_len <= size, "Could not read .npy header")) {
+        return false;
+    }
+    const std::string header((const char *) data + header_start, header_len);
+    *offset = header_start + header_len;
+
+    // The header is a python dict literal, e.g.
+    // {'descr': '<f4', 'fortran_order': False, 'shape': (480, 640, 3), }
+    auto value_of = [&](const std::string &key) -> std::string {
+        size_t pos = header.find("'" + key + "'");
+        if (pos == std::string::npos) {
+            return "";
+        }
+        pos = header.find(':', pos);
+        if (pos == std::string::npos) {
+            return "";
+        }
+        pos = header.find_first_not_of(" ", pos + 1);
+        size_t end;
+        if (pos == std::string::npos) {
+            return "";
+        } else if (header[pos] == '\'') {
+            end = header.find('\'', pos + 1);
+            pos++;
+        } else if (header[pos] == '(') {
+            end = header.find(')', pos);
+            pos++;
+        } else {
+            end = header.find_first_of(",}", pos);
+        }
+        return end == std::string::npos ? "" : header.substr(pos, end - pos);
+    };
+
+    const std::string descr = value_of("descr");
+    if (!check(descr.size() >= 3, "Could not parse .npy header: bad descr")) {
+        return false;
+    }
+    const char byte_order = descr[0], kind = descr[1];
+    const int bytes = atoi(descr.c_str() + 2);
+    if (!check(byte_order == '<' || byte_order == '|' || (byte_order == '=' && bytes == 1) ||
+               (byte_order == '>' && bytes == 1), "Big-endian .npy files are not supported")) {
+        return false;
+    }
+    if (kind == 'f' && (bytes == 4 || bytes == 8)) {
+        *type = halide_type_t(halide_type_float, bytes * 8);
+    } else if (kind == 'i' && (bytes == 1 || bytes == 2 || bytes == 4 || bytes == 8)) {
+        *type = halide_type_t(halide_type_int, bytes * 8);
+    } else if (kind == 'u' && (bytes == 1 || bytes == 2 || bytes == 4 || bytes == 8)) {
+        *type = halide_type_t(halide_type_uint, bytes * 8);
+    } else if (kind == 'b' && bytes == 1) {
+        // Stored as one byte per element, like uint8.
+        *type = halide_type_t(halide_type_uint, 8);
+    } else {
+        return check(false, "Unsupported type in .npy file");
+    }
+
+    std::vector<int> extents;
+    std::string shape_str = value_of("shape");
+    for (size_t pos = 0; pos < shape_str.size();) {
+        pos = shape_str.find_first_of("0123456789", pos);
+        if (pos == std::string::npos) {
+            break;
+        }
+        extents.push_back(atoi(shape_str.c_str() + pos));
+        pos = shape_str.find_first_not_of("0123456789", pos);
+    }
+
+    // numpy lists the outermost dimension first, unless the array is
+    // in fortran order, but Halide lists the innermost first.
+    if (value_of("fortran_order") != "True") {
+        std::reverse(extents.begin(), extents.end());
+    }
+    shape->clear();
+    int stride = 1;
+    for (int e : extents) {
+        shape->push_back({0, e, stride});
+        stride *= e;
+    }
+    return true;
+}
 
 template<typename ImageType, Internal::CheckFunc check>
 struct ImageIO {
@@ -1617,6 +1832,134 @@ bool save_query(const std::string &filename, std::set<FormatInfo> *info) {
     return true;
 }
 
+// A private memory mapping of a whole file, for use with map_image()
+// below. Writes to the mapped memory are never written back to the
+// file. Images that alias the mapping must not be used after the
+// MappedFile is closed or destroyed.
+class MappedFile {
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    ~MappedFile() {
+        close();
+    }
+
+    bool open(const std::string &filename) {
+        close();
+#ifndef _WIN32
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            void *p = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) {
+                data_ = (uint8_t *) p;
+                size_ = st.st_size;
+            }
+        }
+        ::close(fd);
+#endif
+        return data_ != nullptr;
+    }
+
+    void close() {
+#ifndef _WIN32
+        if (data_) {
+            munmap(data_, size_);
+        }
+#endif
+        data_ = nullptr;
+        size_ = 0;
+    }
+
+    uint8_t *data() const {
+        return data_;
+    }
+
+    size_t size() const {
+        return size_;
+    }
+
+private:
+    uint8_t *data_ = nullptr;
+    size_t size_ = 0;
+};
+
+namespace Internal {
+
+template<typename ImageType, CheckFunc check>
+bool wrap_mapped_file(MappedFile *mapping, size_t offset, const halide_type_t &type,
+                      const std::vector<halide_dimension_t> &shape, ImageType *im) {
+    using DynamicImageType = typename ImageTypeWithElemType<ImageType, void>::type;
+    size_t bytes = type.bytes();
+    for (const halide_dimension_t &d : shape) {
+        bytes *= d.extent;
+    }
+    if (!check(offset + bytes <= mapping->size(), "File is too small for the image it describes")) {
+        return false;
+    }
+    if (ImageType::has_static_halide_type) {
+        const halide_type_t expected_type = ImageType::static_halide_type();
+        if (!check(type == expected_type, "Image mapped did not match the expected type")) {
+            return false;
+        }
+    }
+    DynamicImageType im_d(type, mapping->data() + offset, (int) shape.size(), shape.data());
+    *im = im_d.template as<typename ImageType::ElemType>();
+    im->set_host_dirty();
+    return true;
+}
+
+}  // namespace Internal
+
+// Map the image in a .tmp or .npy file into memory, and wrap it as an
+// Image without copying or converting it, which is much faster than
+// load() for large files. (Note that the data in a .tmp file starts
+// 20 bytes into the file, so it is only 4-byte aligned.) The Image
+// aliases the mapping, so must not be used after it is destroyed.
+// Returns false upon failure.
+template<typename ImageType, Internal::CheckFunc check = Internal::CheckReturn>
+bool map_image(const std::string &filename, MappedFile *mapping, ImageType *im) {
+    const std::string ext = Internal::get_lowercase_extension(filename);
+    if (!check(ext == "tmp" || ext == "npy", "Only .tmp and .npy files can be mapped")) {
+        return false;
+    }
+    if (!check(mapping->open(filename), "File could not be mapped")) {
+        return false;
+    }
+    size_t offset;
+    halide_type_t type;
+    std::vector<halide_dimension_t> shape;
+    bool ok = (ext == "tmp") ?
+        Internal::parse_tmp_header<check>(mapping->data(), mapping->size(), &offset, &type, &shape) :
+        Internal::parse_npy_header<check>(mapping->data(), mapping->size(), &offset, &type, &shape);
+    return ok && Internal::wrap_mapped_file<ImageType, check>(mapping, offset, type, shape, im);
+}
+
+// Map a file of raw, headerless, planar data (e.g. a sensor dump)
+// into memory and wrap it as an Image of the given type and extents,
+// starting the given number of bytes into the file. As with
+// map_image(), the Image must not be used after the mapping is
+// destroyed. Returns false upon failure.
+template<typename ImageType, Internal::CheckFunc check = Internal::CheckReturn>
+bool map_raw_image(const std::string &filename, MappedFile *mapping,
+                   const halide_type_t &type, const std::vector<int> &extents,
+                   ImageType *im, size_t offset = 0) {
+    if (!check(mapping->open(filename), "File could not be mapped")) {
+        return false;
+    }
+    std::vector<halide_dimension_t> shape;
+    int stride = 1;
+    for (int e : extents) {
+        shape.push_back({0, e, stride});
+        stride *= e;
+    }
+    return Internal::wrap_mapped_file<ImageType, check>(mapping, offset, type, shape, im);
+}
+
 // Fancy wrapper to call load() with CheckFail, inferring the return type;
 // this allows you to simply use
 //
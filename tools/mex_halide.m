@@ -17,6 +17,14 @@ function mex_halide( generator_filename, varargin )
 % If a target is specified by a generator param with target=..., the
 % 'matlab' feature flag must be present.
 %
+% The arguments of the resulting mex function are passed to the
+% pipeline in place: the data of input arrays is not copied, and
+% outputs must be preallocated arrays of the right size, which the
+% pipeline writes directly. The mex library locks itself in memory the
+% first time it is called, so that the runtime state (the thread pool,
+% GPU kernels) is kept between calls; use munlock to allow it to be
+% cleared.
+%
 % This script uses two environment variables that can optionally be
 % set or changed:
 %  - HALIDE_PATH: The path to the root directory of Halide. If
@@ -130,10 +130,16 @@ public:
             // Halide C++ source, which is readily copy-pasteable back into
             // this very same source file with few modifications. Programmers
             // can use this as a starting schedule and iteratively improve the
-            // schedule. Note that the current auto-scheduler is only able to
-            // generate CPU schedules and only does tiling, simple vectorization
-            // and parallelization. It doesn't deal with line buffering, storage
-            // reordering, or factoring reductions.
+            // schedule. Note that the current auto-scheduler only does tiling,
+            // sliding windows, simple vectorization, parallelization and
+            // factoring of reductions. It doesn't deal with storage reordering.
+            //
+            // Adding "schedule" to the files to emit (e.g. "-e static_library,h,schedule")
+            // also writes the schedule to auto_schedule_true.schedule.h, as a
+            // function apply_schedule_auto_schedule_true(Pipeline). A later build
+            // can include that file and call it with get_pipeline() from
+            // schedule() to use the same schedule without running the
+            // auto-scheduler again.
 
             // At the time of writing, the auto-scheduler will return the
             // following schedule for the estimates and machine parameters
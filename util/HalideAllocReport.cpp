@@ -0,0 +1,293 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+/** \file
+ *
+ * A tool which reads the heap allocation log written by the Halide
+ * profiler when HL_PROFILER_ALLOC_LOG is set, and reports which Funcs
+ * contribute to the peak memory usage, the buffers that are live at
+ * the peak, and how each Func allocates over time.
+ */
+
+using std::map;
+using std::pair;
+using std::string;
+using std::vector;
+
+namespace {
+
+// These must match the definitions in src/runtime/profiler.cpp
+enum AllocLogEvent {
+    Name = 0,
+    Allocate = 1,
+    Free = 2
+};
+
+struct AllocLogRecord {
+    uint32_t event;
+    int32_t func_id;
+    uint64_t time_ns;
+    uint64_t size;
+};
+
+struct Event {
+    uint32_t event;
+    int32_t func_id;
+    uint64_t time_ns;
+    uint64_t size;
+    // Filled in while replaying. For frees, the index of the matching
+    // allocate event.
+    size_t alloc_idx;
+};
+
+struct FuncStats {
+    uint64_t num_allocs = 0;
+    uint64_t total_bytes = 0;
+    uint64_t largest = 0;
+    uint64_t current = 0;
+    uint64_t peak = 0;
+    uint64_t at_global_peak = 0;
+    double total_lifetime_ms = 0;
+    uint64_t num_freed = 0;
+};
+
+void usage(char * const *argv) {
+    const string usage =
+        "Usage: " + string(argv[0]) + " [-t timeline_points] [-n top_buffers] alloc_log\n"
+        "\n"
+        "This tool reads the heap allocation log written by a program\n"
+        "containing pipelines compiled with the profile target feature,\n"
+        "when run with HL_PROFILER_ALLOC_LOG=<filename>. It reports the peak\n"
+        "live heap memory, which buffers were live at the peak, and how\n"
+        "much each Func allocated. With -t, it also prints a timeline of\n"
+        "the live memory sampled at the given number of points.\n"
+        "\n"
+        "Allocation addresses are not logged, so frees are matched to\n"
+        "the most recent live allocation of the same size by the same\n"
+        "Func.\n";
+    fprintf(stderr, "%s\n", usage.c_str());
+    exit(1);
+}
+
+string format_bytes(uint64_t bytes) {
+    char buf[64];
+    if (bytes >= (1ULL << 30)) {
+        snprintf(buf, sizeof(buf), "%.2f GB", bytes / (double)(1ULL << 30));
+    } else if (bytes >= (1ULL << 20)) {
+        snprintf(buf, sizeof(buf), "%.2f MB", bytes / (double)(1ULL << 20));
+    } else if (bytes >= (1ULL << 10)) {
+        snprintf(buf, sizeof(buf), "%.2f KB", bytes / (double)(1ULL << 10));
+    } else {
+        snprintf(buf, sizeof(buf), "%llu bytes", (unsigned long long)bytes);
+    }
+    return buf;
+}
+
+}  // namespace
+
+int main(int argc, char * const *argv) {
+    int timeline_points = 0;
+    int top_buffers = 20;
+    const char *filename = nullptr;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "-t" && i + 1 < argc) {
+            timeline_points = atoi(argv[++i]);
+        } else if (arg == "-n" && i + 1 < argc) {
+            top_buffers = atoi(argv[++i]);
+        } else if (!filename) {
+            filename = argv[i];
+        } else {
+            usage(argv);
+        }
+    }
+    if (!filename) {
+        usage(argv);
+    }
+
+    FILE *f = fopen(filename, "rb");
+    if (!f) {
+        fprintf(stderr, "Error opening file: %s. Exiting.\n", filename);
+        exit(1);
+    }
+
+    map<int, string> names;
+    vector<Event> events;
+    AllocLogRecord r;
+    while (fread(&r, sizeof(r), 1, f) == 1) {
+        if (r.event == Name) {
+            size_t padded = (r.size + 7) & ~(uint64_t)7;
+            vector<char> name(padded + 1, 0);
+            if (fread(name.data(), 1, padded, f) != padded) {
+                fprintf(stderr, "Unexpected end of file in a name record\n");
+                exit(1);
+            }
+            names[r.func_id] = string(name.data(), r.size);
+        } else if (r.event == Allocate || r.event == Free) {
+            events.push_back({r.event, r.func_id, r.time_ns, r.size, 0});
+        } else {
+            fprintf(stderr, "Bad record in allocation log\n");
+            exit(1);
+        }
+    }
+    fclose(f);
+
+    if (events.empty()) {
+        printf("No heap allocations were logged.\n");
+        return 0;
+    }
+
+    // Records from different threads can be slightly out of order.
+    std::stable_sort(events.begin(), events.end(), [](const Event &a, const Event &b) {
+        return a.time_ns < b.time_ns;
+    });
+    const uint64_t start_ns = events.front().time_ns;
+    const uint64_t end_ns = events.back().time_ns;
+
+    // First pass: match frees to allocations, and find the peak.
+    map<int, FuncStats> funcs;
+    map<pair<int, uint64_t>, vector<size_t>> live;
+    uint64_t current = 0, peak = 0;
+    size_t peak_idx = 0;
+    uint64_t unmatched_frees = 0;
+    for (size_t i = 0; i < events.size(); i++) {
+        Event &e = events[i];
+        FuncStats &fs = funcs[e.func_id];
+        if (e.event == Allocate) {
+            fs.num_allocs++;
+            fs.total_bytes += e.size;
+            fs.largest = std::max(fs.largest, e.size);
+            fs.current += e.size;
+            fs.peak = std::max(fs.peak, fs.current);
+            current += e.size;
+            live[{e.func_id, e.size}].push_back(i);
+            if (current > peak) {
+                peak = current;
+                peak_idx = i;
+            }
+        } else {
+            auto &candidates = live[{e.func_id, e.size}];
+            if (candidates.empty()) {
+                // Allocated before logging started.
+                unmatched_frees++;
+                e.alloc_idx = (size_t)-1;
+                continue;
+            }
+            e.alloc_idx = candidates.back();
+            candidates.pop_back();
+            fs.current -= e.size;
+            current -= e.size;
+            fs.num_freed++;
+            fs.total_lifetime_ms += (e.time_ns - events[e.alloc_idx].time_ns) / 1e6;
+        }
+    }
+
+    // Second pass: replay up to the peak to find the live set there.
+    vector<bool> freed(events.size(), false);
+    for (size_t i = 0; i <= peak_idx; i++) {
+        if (events[i].event == Free && events[i].alloc_idx != (size_t)-1) {
+            freed[events[i].alloc_idx] = true;
+        }
+    }
+    vector<size_t> live_at_peak;
+    for (size_t i = 0; i <= peak_idx; i++) {
+        if (events[i].event == Allocate && !freed[i]) {
+            live_at_peak.push_back(i);
+            funcs[events[i].func_id].at_global_peak += events[i].size;
+        }
+    }
+    std::sort(live_at_peak.begin(), live_at_peak.end(), [&](size_t a, size_t b) {
+        return events[a].size > events[b].size;
+    });
+
+    auto func_name = [&](int id) {
+        auto it = names.find(id);
+        return it == names.end() ? string("<unknown>") : it->second;
+    };
+
+    uint64_t total_allocated = 0, num_allocs = 0;
+    for (const auto &it : funcs) {
+        total_allocated += it.second.total_bytes;
+        num_allocs += it.second.num_allocs;
+    }
+
+    printf("%llu allocations over %.3f ms. Total allocated: %s\n",
+           (unsigned long long)num_allocs, (end_ns - start_ns) / 1e6,
+           format_bytes(total_allocated).c_str());
+    printf("Peak live heap memory: %s at %.3f ms, in %d buffers. Total allocated is %.1fx the peak.\n",
+           format_bytes(peak).c_str(), (events[peak_idx].time_ns - start_ns) / 1e6,
+           (int)live_at_peak.size(), peak ? (double)total_allocated / peak : 0.0);
+    if (unmatched_frees) {
+        printf("%llu frees had no matching logged allocation.\n", (unsigned long long)unmatched_frees);
+    }
+
+    printf("\nLargest buffers live at the peak:\n");
+    for (size_t i = 0; i < live_at_peak.size() && (int)i < top_buffers; i++) {
+        const Event &e = events[live_at_peak[i]];
+        printf("  %-40s %12s  allocated at %.3f ms\n", func_name(e.func_id).c_str(),
+               format_bytes(e.size).c_str(), (e.time_ns - start_ns) / 1e6);
+    }
+
+    // Funcs, ordered by their contribution to the peak.
+    vector<pair<int, FuncStats>> sorted(funcs.begin(), funcs.end());
+    std::sort(sorted.begin(), sorted.end(), [](const pair<int, FuncStats> &a, const pair<int, FuncStats> &b) {
+        if (a.second.at_global_peak != b.second.at_global_peak) {
+            return a.second.at_global_peak > b.second.at_global_peak;
+        }
+        return a.second.total_bytes > b.second.total_bytes;
+    });
+    printf("\nFuncs:\n");
+    for (const auto &it : sorted) {
+        const FuncStats &fs = it.second;
+        printf("  %s:\n", func_name(it.first).c_str());
+        printf("    at the peak: %s (%.1f%%)\n", format_bytes(fs.at_global_peak).c_str(),
+               peak ? 100.0 * fs.at_global_peak / peak : 0.0);
+        printf("    own peak: %s  allocations: %llu  total: %s  largest: %s\n",
+               format_bytes(fs.peak).c_str(), (unsigned long long)fs.num_allocs,
+               format_bytes(fs.total_bytes).c_str(), format_bytes(fs.largest).c_str());
+        if (fs.num_freed) {
+            printf("    average lifetime: %.3f ms\n", fs.total_lifetime_ms / fs.num_freed);
+        }
+        if (fs.num_freed < fs.num_allocs) {
+            printf("    never freed: %llu allocations\n", (unsigned long long)(fs.num_allocs - fs.num_freed));
+        }
+    }
+
+    if (timeline_points > 0) {
+        // The highest live memory within each interval.
+        vector<uint64_t> timeline(timeline_points, 0);
+        uint64_t duration = std::max((uint64_t)1, end_ns - start_ns);
+        current = 0;
+        int last_bucket = 0;
+        for (const Event &e : events) {
+            int bucket = (int)(((double)(e.time_ns - start_ns) * timeline_points) / duration);
+            bucket = std::min(bucket, timeline_points - 1);
+            // Intervals without events hold whatever was live.
+            for (int b = last_bucket + 1; b <= bucket; b++) {
+                timeline[b] = current;
+            }
+            last_bucket = bucket;
+            if (e.event == Allocate) {
+                current += e.size;
+            } else if (e.alloc_idx != (size_t)-1) {
+                current -= e.size;
+            }
+            timeline[bucket] = std::max(timeline[bucket], current);
+        }
+        printf("\nLive memory over time:\n");
+        for (int i = 0; i < timeline_points; i++) {
+            int bar = peak ? (int)((60 * timeline[i]) / peak) : 0;
+            printf("  %10.3f ms %12s |%s\n", (duration * (double)i / timeline_points) / 1e6,
+                   format_bytes(timeline[i]).c_str(), string(bar, '#').c_str());
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,357 @@
+#include "HalideTraceUtils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <algorithm>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <string>
+#include <string.h>
+
+/** \file
+ *
+ * A tool which reads a binary Halide trace file containing loads and
+ * stores, and reports statistics about the memory access patterns of
+ * each traced Func: reuse distance histograms, estimated miss rates
+ * for a cache of a given size, the distribution of strides between
+ * consecutive accesses, and how many times each point was stored to.
+ */
+
+using namespace Halide;
+using namespace Internal;
+
+using std::map;
+using std::vector;
+using std::string;
+using std::unordered_map;
+
+namespace {
+
+// Reuse distances are bucketed by powers of two: bucket 0 counts a
+// reuse of the most recently touched line, bucket i > 0 counts
+// distances in [2^(i-1), 2^i).
+const int num_reuse_buckets = 40;
+
+// Strides between consecutive accesses are bucketed as follows.
+enum StrideBucket {
+    SameElement = 0,
+    UnitForward,
+    UnitBackward,
+    SmallForward,   // 2 to 16 elements
+    SmallBackward,
+    LargeForward,
+    LargeBackward,
+    OtherDims,      // An outer coordinate changed.
+    NumStrideBuckets
+};
+
+const char *stride_bucket_names[NumStrideBuckets] = {
+    "0", "+1", "-1", "+2..+16", "-2..-16", "> +16", "< -16", "outer dim"
+};
+
+struct AccessStats {
+    uint64_t count = 0;
+    uint64_t cold = 0;
+    uint64_t misses = 0;
+    uint64_t reuse[num_reuse_buckets] = {0};
+    uint64_t stride[NumStrideBuckets] = {0};
+};
+
+struct FuncInfo {
+    AccessStats loads, stores;
+    int bytes = 0;
+    uint64_t distinct_points_stored = 0;
+
+    // The coordinates of the last access, used to compute strides.
+    vector<int> last_coords;
+    bool has_last = false;
+};
+
+// Counts the number of distinct cache lines touched between two
+// points in time. Each line contributes a one at the time of its most
+// recent access, so the number of distinct lines touched since a time
+// t is the number of ones after t.
+class ReuseTracker {
+    vector<int64_t> tree;
+    unordered_map<uint64_t, int64_t> last_access;
+    int64_t now = 0;
+
+    void add(int64_t i, int64_t delta) {
+        for (i++; i <= (int64_t)tree.size(); i += i & -i) {
+            tree[i - 1] += delta;
+        }
+    }
+
+    int64_t prefix_sum(int64_t i) const {
+        // Sum of entries [0, i).
+        int64_t result = 0;
+        for (; i > 0; i -= i & -i) {
+            result += tree[i - 1];
+        }
+        return result;
+    }
+
+    // Renumber the live entries densely in time order, so that the
+    // tree only ever needs to be about twice the number of distinct
+    // lines.
+    void compact() {
+        vector<std::pair<int64_t, uint64_t>> live;
+        live.reserve(last_access.size());
+        for (const auto &it : last_access) {
+            live.push_back({it.second, it.first});
+        }
+        std::sort(live.begin(), live.end());
+        size_t size = std::max((size_t)1024, live.size() * 2);
+        tree.assign(size, 0);
+        for (size_t i = 0; i < live.size(); i++) {
+            last_access[live[i].second] = i;
+            add(i, 1);
+        }
+        now = live.size();
+    }
+
+public:
+    // Returns the number of distinct lines touched since the last access
+    // of this one, or -1 if this is the first access.
+    int64_t access(uint64_t line) {
+        if (now == (int64_t)tree.size()) {
+            compact();
+        }
+        int64_t distance = -1;
+        auto it = last_access.find(line);
+        if (it != last_access.end()) {
+            distance = prefix_sum(now) - prefix_sum(it->second + 1);
+            add(it->second, -1);
+            it->second = now;
+        } else {
+            last_access[line] = now;
+        }
+        add(now, 1);
+        now++;
+        return distance;
+    }
+};
+
+uint64_t hash_combine(uint64_t h, uint64_t v) {
+    return (h ^ v) * 1099511628211ULL;
+}
+
+int reuse_bucket(int64_t distance) {
+    int bucket = 0;
+    while (distance > 0 && bucket < num_reuse_buckets - 1) {
+        distance >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+void report_access_stats(const char *kind, const AccessStats &s) {
+    if (!s.count) {
+        return;
+    }
+    printf("  %s: %llu\n", kind, (unsigned long long)s.count);
+    printf("    estimated miss rate: %.2f%% (%.2f%% of accesses are first touches)\n",
+           100.0 * s.misses / s.count, 100.0 * s.cold / s.count);
+    printf("    reuse distance in cache lines:\n");
+    for (int i = 0; i < num_reuse_buckets; i++) {
+        if (!s.reuse[i]) continue;
+        int64_t lo = i == 0 ? 0 : ((int64_t)1 << (i - 1));
+        int64_t hi = ((int64_t)1 << i) - 1;
+        printf("      [%lld, %lld]: %.2f%%\n", (long long)lo, (long long)hi, 100.0 * s.reuse[i] / s.count);
+    }
+    printf("    stride from the previous access in elements:\n");
+    for (int i = 0; i < NumStrideBuckets; i++) {
+        if (!s.stride[i]) continue;
+        printf("      %s: %.2f%%\n", stride_bucket_names[i], 100.0 * s.stride[i] / s.count);
+    }
+}
+
+void usage(char * const *argv) {
+    const string usage =
+        "Usage: " + string(argv[0]) + " -i trace_file [-c cache_bytes] [-l line_bytes]\n"
+        "\n"
+        "This tool reads a binary trace produced by Halide, and reports\n"
+        "memory access statistics for each traced Func. Use - as the\n"
+        "trace file to read from stdin. To generate a suitable binary\n"
+        "trace, use Func::trace_loads() and Func::trace_stores(), or the\n"
+        "target features trace_loads and trace_stores, and run with\n"
+        "HL_TRACE_FILE=<filename>.\n"
+        "\n"
+        "Funcs are assumed to be laid out densely with the first dimension\n"
+        "innermost, so that consecutive values of the first coordinate\n"
+        "share cache lines. The miss rate is estimated for a fully\n"
+        "associative LRU cache of cache_bytes (default 32768) with lines\n"
+        "of line_bytes (default 64), shared by all Funcs. Reuse distances\n"
+        "count the distinct cache lines of any Func touched between two\n"
+        "accesses to the same line. Stores per distinct point above one\n"
+        "indicate redundant recompute, or update definitions.\n";
+    fprintf(stderr, "%s\n", usage.c_str());
+    exit(1);
+}
+
+}  // namespace
+
+int main(int argc, char * const *argv) {
+    const char *filename = nullptr;
+    int64_t cache_bytes = 32768;
+    int line_bytes = 64;
+    for (int i = 1; i < argc - 1; i++) {
+        string arg = argv[i];
+        if (arg == "-i") {
+            filename = argv[++i];
+        } else if (arg == "-c") {
+            cache_bytes = atoll(argv[++i]);
+        } else if (arg == "-l") {
+            line_bytes = atoi(argv[++i]);
+        }
+    }
+    if (filename == nullptr || cache_bytes <= 0 || line_bytes <= 0) {
+        usage(argv);
+    }
+
+    FILE *file_desc = strcmp(filename, "-") ? fopen(filename, "r") : stdin;
+    if (file_desc == nullptr) {
+        fprintf(stderr, "Error opening file: %s. Exiting.\n", filename);
+        exit(1);
+    }
+
+    const int64_t cache_lines = cache_bytes / line_bytes;
+
+    map<string, int> func_ids;
+    vector<string> func_names;
+    vector<FuncInfo> funcs;
+    ReuseTracker tracker;
+    // The number of times each point of each Func has been stored to,
+    // keyed by a hash of the Func and the coordinates.
+    unordered_map<uint64_t, uint32_t> store_counts;
+
+    uint64_t packet_count = 0;
+    vector<int> coords;
+    for (;;) {
+        Packet p;
+        if (!p.read_from_filedesc(file_desc)) {
+            break;
+        }
+        packet_count++;
+
+        if (p.event != halide_trace_load && p.event != halide_trace_store) {
+            continue;
+        }
+
+        auto id_it = func_ids.find(p.func());
+        int id;
+        if (id_it == func_ids.end()) {
+            id = (int)funcs.size();
+            func_ids[p.func()] = id;
+            func_names.push_back(p.func());
+            funcs.emplace_back();
+        } else {
+            id = id_it->second;
+        }
+        FuncInfo &fi = funcs[id];
+        fi.bytes = p.type.bytes();
+
+        const bool is_store = p.event == halide_trace_store;
+        AccessStats &stats = is_store ? fi.stores : fi.loads;
+        const int lanes = p.type.lanes;
+        const int dims = p.dimensions / lanes;
+        const int elems_per_line = std::max(1, line_bytes / fi.bytes);
+
+        for (int lane = 0; lane < lanes; lane++) {
+            coords.resize(dims);
+            for (int d = 0; d < dims; d++) {
+                coords[d] = p.get_coord(d * lanes + lane);
+            }
+
+            // Stride from the previous access to this Func.
+            StrideBucket bucket = OtherDims;
+            if (fi.has_last && (int)fi.last_coords.size() == dims && dims > 0) {
+                bool outer_same = true;
+                for (int d = 1; d < dims; d++) {
+                    outer_same = outer_same && coords[d] == fi.last_coords[d];
+                }
+                if (outer_same) {
+                    int64_t delta = (int64_t)coords[0] - fi.last_coords[0];
+                    if (delta == 0) {
+                        bucket = SameElement;
+                    } else if (delta == 1) {
+                        bucket = UnitForward;
+                    } else if (delta == -1) {
+                        bucket = UnitBackward;
+                    } else if (delta > 0) {
+                        bucket = delta <= 16 ? SmallForward : LargeForward;
+                    } else {
+                        bucket = delta >= -16 ? SmallBackward : LargeBackward;
+                    }
+                }
+            } else if (fi.has_last && dims == 0) {
+                bucket = SameElement;
+            }
+            if (fi.has_last) {
+                stats.stride[bucket]++;
+            } else {
+                // Count the first access as a jump.
+                stats.stride[OtherDims]++;
+            }
+            fi.last_coords = coords;
+            fi.has_last = true;
+
+            // The cache line, and the point itself.
+            uint64_t line = hash_combine(14695981039346656037ULL, id);
+            uint64_t point = line;
+            for (int d = 0; d < dims; d++) {
+                int c = coords[d];
+                point = hash_combine(point, (uint32_t)c);
+                if (d == 0) {
+                    // Round down to a multiple of the elements per line.
+                    c = c >= 0 ? c / elems_per_line : -((-c - 1) / elems_per_line) - 1;
+                }
+                line = hash_combine(line, (uint32_t)c);
+            }
+
+            int64_t distance = tracker.access(line);
+            stats.count++;
+            if (distance < 0) {
+                stats.cold++;
+                stats.misses++;
+            } else {
+                stats.reuse[reuse_bucket(distance)]++;
+                if (distance >= cache_lines) {
+                    stats.misses++;
+                }
+            }
+
+            if (is_store) {
+                if (store_counts[point]++ == 0) {
+                    fi.distinct_points_stored++;
+                }
+            }
+        }
+    }
+
+    if (file_desc != stdin) {
+        fclose(file_desc);
+    }
+
+    printf("Read %llu packets. Estimating misses for a %lld byte cache with %d byte lines.\n",
+           (unsigned long long)packet_count, (long long)cache_bytes, line_bytes);
+
+    for (size_t i = 0; i < funcs.size(); i++) {
+        const FuncInfo &fi = funcs[i];
+        printf("Func %s:\n", func_names[i].c_str());
+        report_access_stats("loads", fi.loads);
+        report_access_stats("stores", fi.stores);
+        if (fi.distinct_points_stored) {
+            printf("  stores per distinct point: %.3f\n",
+                   (double)fi.stores.count / fi.distinct_points_stored);
+        }
+        if (fi.loads.count && fi.distinct_points_stored) {
+            printf("  loads per distinct point stored: %.3f\n",
+                   (double)fi.loads.count / fi.distinct_points_stored);
+        }
+    }
+
+    return 0;
+}
@@ -11,6 +11,7 @@
 #include <queue>
 #include <iostream>
 #include <algorithm>
+#include <thread>
 #ifdef _MSC_VER
 #include <io.h>
 typedef int64_t ssize_t;
@@ -259,6 +260,21 @@ parameters should be set zero or one times:
  --hold frames: How many frames to output after the end of the
     trace. Defaults to 250.
 
+ --first frame: Don't output the frames before the given one. The
+     whole trace is still processed, but producing the skipped frames
+     is much cheaper. Defaults to 0.
+
+ --last frame: Stop after outputting the given frame, without reading
+     the rest of the trace. Defaults to no limit.
+
+ --every n: Only output every n-th frame, starting from the first
+     one. Frames in between are processed but not output, which
+     speeds up long traces. Note that this changes the frame rate of
+     the output. Defaults to 1.
+
+ --threads n: The number of threads to use to render frames. Defaults
+     to the number of cores.
+
 The following parameters can be set once per Func. With the exception
 of label, they continue to take effect for all subsequently defined
 Funcs.
@@ -335,6 +351,27 @@ void expect(bool cond, int i) {
     }
 }
 
+// Run f(begin, end) over disjoint ranges covering [0, n) on up to
+// the given number of threads.
+template<typename F>
+void parallel_for_range(int n, int threads, F f) {
+    // Not worth spawning a thread for less work than this.
+    const int min_range = 64 * 1024;
+    threads = std::max(1, std::min(threads, n / min_range));
+    if (threads == 1) {
+        f(0, n);
+        return;
+    }
+    vector<std::thread> workers;
+    for (int t = 1; t < threads; t++) {
+        workers.emplace_back(f, (int)(((int64_t)n * t) / threads), (int)(((int64_t)n * (t + 1)) / threads));
+    }
+    f(0, (int)(n / threads));
+    for (auto &w : workers) {
+        w.join();
+    }
+}
+
 // See all boxes corresponding to positions in a Func's allocation to
 // the given color. Recursive to handle arbitrary
 // dimensionalities. Used by begin and end realization events.
@@ -378,6 +415,8 @@ int run(int argc, char **argv) {
 
     int timestep = 10000;
     int hold_frames = 250;
+    int first_frame = 0, last_frame = -1, frame_interval = 1;
+    int num_threads = std::max(1, (int)std::thread::hardware_concurrency());
 
     FuncInfo::Config config;
     config.x = config.y = 0;
@@ -490,6 +529,20 @@ int run(int argc, char **argv) {
         } else if (next == "--hold") {
             expect(i + 1 < argc, i);
             hold_frames = atoi(argv[++i]);
+        } else if (next == "--first") {
+            expect(i + 1 < argc, i);
+            first_frame = atoi(argv[++i]);
+        } else if (next == "--last") {
+            expect(i + 1 < argc, i);
+            last_frame = atoi(argv[++i]);
+        } else if (next == "--every") {
+            expect(i + 1 < argc, i);
+            frame_interval = atoi(argv[++i]);
+            expect(frame_interval > 0, i);
+        } else if (next == "--threads") {
+            expect(i + 1 < argc, i);
+            num_threads = atoi(argv[++i]);
+            expect(num_threads > 0, i);
         } else if (next == "--uninit") {
             expect(i + 3 < argc, i);
             int r = atoi(argv[++i]);
@@ -531,6 +584,9 @@ int run(int argc, char **argv) {
 
     map<uint32_t, PipelineInfo> pipeline_info;
 
+    // Traces can be many gigabytes, so read them in large chunks.
+    setvbuf(stdin, nullptr, _IOFBF, 1 << 20);
+
     size_t end_counter = 0;
     size_t packet_clock = 0;
     for (;;) {
@@ -544,57 +600,78 @@ int run(int argc, char **argv) {
 
         if (halide_clock >= video_clock) {
             const ssize_t frame_bytes = 4 * frame_width * frame_height;
+            const int frame_pixels = frame_width * frame_height;
 
             while (halide_clock >= video_clock) {
-                // Composite text over anim over image
-                for (int i = 0; i < frame_width * frame_height; i++) {
-                    uint8_t *anim_decay_px  = (uint8_t *)(anim_decay + i);
-                    uint8_t *anim_px  = (uint8_t *)(anim + i);
-                    uint8_t *image_px = (uint8_t *)(image + i);
-                    uint8_t *text_px  = (uint8_t *)(text + i);
-                    uint8_t *blend_px = (uint8_t *)(blend + i);
-                    // anim over anim_decay
-                    composite(anim_decay_px, anim_px, anim_decay_px);
-                    // anim_decay over image
-                    composite(image_px, anim_decay_px, blend_px);
-                    // text over image
-                    composite(blend_px, text_px, blend_px);
-                }
-
-                // Dump the frame
-                ssize_t bytes_written = write(1, blend, frame_bytes);
-                if (bytes_written < frame_bytes) {
-                    fprintf(stderr, "Could not write frame to stdout.\n");
-                    return -1;
+                const int frame = (int)(video_clock / timestep);
+                const bool output_frame = (frame >= first_frame &&
+                                           (frame - first_frame) % frame_interval == 0);
+
+                parallel_for_range(frame_pixels, num_threads, [&](int begin, int end) {
+                    for (int i = begin; i < end; i++) {
+                        uint8_t *anim_decay_px  = (uint8_t *)(anim_decay + i);
+                        uint8_t *anim_px  = (uint8_t *)(anim + i);
+                        // anim over anim_decay
+                        composite(anim_decay_px, anim_px, anim_decay_px);
+                        if (output_frame) {
+                            // Composite text over anim over image
+                            uint8_t *image_px = (uint8_t *)(image + i);
+                            uint8_t *text_px  = (uint8_t *)(text + i);
+                            uint8_t *blend_px = (uint8_t *)(blend + i);
+                            // anim_decay over image
+                            composite(image_px, anim_decay_px, blend_px);
+                            // text over image
+                            composite(blend_px, text_px, blend_px);
+                        }
+                    }
+                });
+
+                if (output_frame) {
+                    // Dump the frame
+                    ssize_t bytes_written = write(1, blend, frame_bytes);
+                    if (bytes_written < frame_bytes) {
+                        fprintf(stderr, "Could not write frame to stdout.\n");
+                        return -1;
+                    }
                 }
 
                 video_clock += timestep;
 
-                // Decay the anim_decay
-                if (decay_factor[1] != 1) {
-                    const uint32_t inv_d1 = (1 << 24) / decay_factor[1];
-                    for (int i = 0; i < frame_width * frame_height; i++) {
-                        uint32_t color = anim_decay[i];
+                const uint32_t inv_d0 = (1 << 24) / decay_factor[0];
+                const uint32_t inv_d1 = (1 << 24) / decay_factor[1];
+                parallel_for_range(frame_pixels, num_threads, [&](int begin, int end) {
+                    // Decay the anim_decay
+                    if (decay_factor[1] != 1) {
+                        for (int i = begin; i < end; i++) {
+                            uint32_t color = anim_decay[i];
+                            uint32_t rgb = color & 0x00ffffff;
+                            uint32_t alpha = (color >> 24);
+                            alpha *= inv_d1;
+                            alpha &= 0xff000000;
+                            anim_decay[i] = alpha | rgb;
+                        }
+                    }
+
+                    // Also decay the anim
+                    for (int i = begin; i < end; i++) {
+                        uint32_t color = anim[i];
                         uint32_t rgb = color & 0x00ffffff;
                         uint32_t alpha = (color >> 24);
-                        alpha *= inv_d1;
+                        alpha *= inv_d0;
                         alpha &= 0xff000000;
-                        anim_decay[i] = alpha | rgb;
+                        anim[i] = alpha | rgb;
                     }
-                }
+                });
 
-                // Also decay the anim
-                const uint32_t inv_d0 = (1 << 24) / decay_factor[0];
-                for (int i = 0; i < frame_width * frame_height; i++) {
-                    uint32_t color = anim[i];
-                    uint32_t rgb = color & 0x00ffffff;
-                    uint32_t alpha = (color >> 24);
-                    alpha *= inv_d0;
-                    alpha &= 0xff000000;
-                    anim[i] = alpha | rgb;
+                if (last_frame >= 0 && frame >= last_frame) {
+                    break;
                 }
             }
 
+            if (last_frame >= 0 && video_clock / timestep > (size_t)last_frame) {
+                break;
+            }
+
             // Blank anim
             memset(anim, 0, frame_bytes);
         }